@@ -15,6 +15,8 @@
 
 #define JUMP_LABEL_NOP_SIZE		AARCH64_INSN_SIZE
 
+#define HAVE_JUMP_LABEL_BATCH
+
 static __always_inline bool arch_static_branch(struct static_key *key,
 					       bool branch)
 {
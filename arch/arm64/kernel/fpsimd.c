@@ -1816,6 +1816,8 @@ void fpsimd_save_and_flush_cpu_state(void)
  *
  * Must not be called unless may_use_simd() returns true.
  * Task context in the FPSIMD registers is saved back to memory as necessary.
+ * Once it is, the registers belong to no one until a task state is loaded
+ * again, so back-to-back calls from the same task only save it once.
  *
  * A matching call to kernel_neon_end() must be made before returning from the
  * calling context.
@@ -1832,6 +1834,11 @@ void kernel_neon_begin(void)
 
 	get_cpu_fpsimd_context();
 
+	/* Nothing live to save or invalidate since the previous call? */
+	if (test_thread_flag(TIF_FOREIGN_FPSTATE) &&
+	    !__this_cpu_read(fpsimd_last_state.st))
+		return;
+
 	/* Save unsaved fpsimd state, if any: */
 	fpsimd_save();
 
@@ -18,12 +18,38 @@
 #include <asm/patching.h>
 
 #ifdef CONFIG_DYNAMIC_FTRACE
+/*
+ * While arch_ftrace_update_code() runs, the call sites are patched in
+ * batches. The batch is only touched with ftrace_lock held.
+ */
+#define FTRACE_BATCH_MAX	128
+
+static bool ftrace_batching;
+static void *ftrace_batch_addrs[FTRACE_BATCH_MAX];
+static u32 ftrace_batch_insns[FTRACE_BATCH_MAX];
+static int ftrace_batch_cnt;
+
+static int ftrace_batch_flush(void)
+{
+	int ret = 0;
+
+	if (ftrace_batch_cnt)
+		ret = aarch64_insn_patch_text_batch(ftrace_batch_addrs,
+						    ftrace_batch_insns,
+						    ftrace_batch_cnt);
+	ftrace_batch_cnt = 0;
+
+	return ret;
+}
+
 /*
  * Replace a single instruction, which may be a branch or NOP.
  * If @validate == true, a replaced instruction is checked against 'old'.
+ * A call site, patched once per update, is queued if @batch == true and
+ * a batch is open. Anything else is patched after the queued call sites.
  */
-static int ftrace_modify_code(unsigned long pc, u32 old, u32 new,
-			      bool validate)
+static int __ftrace_modify_code(unsigned long pc, u32 old, u32 new,
+				bool validate, bool batch)
 {
 	u32 replaced;
 
@@ -42,12 +68,35 @@ static int ftrace_modify_code(unsigned long pc, u32 old, u32 new,
 		if (replaced != old)
 			return -EINVAL;
 	}
-	if (aarch64_insn_patch_text_nosync((void *)pc, new))
+
+	if (batch && ftrace_batching) {
+		if (ftrace_batch_cnt == FTRACE_BATCH_MAX && ftrace_batch_flush())
+			return -EPERM;
+
+		ftrace_batch_addrs[ftrace_batch_cnt] = (void *)pc;
+		ftrace_batch_insns[ftrace_batch_cnt] = new;
+		ftrace_batch_cnt++;
+		return 0;
+	}
+
+	if (ftrace_batch_flush() ||
+	    aarch64_insn_patch_text_nosync((void *)pc, new))
 		return -EPERM;
 
 	return 0;
 }
 
+static int ftrace_modify_code(unsigned long pc, u32 old, u32 new,
+			      bool validate)
+{
+	return __ftrace_modify_code(pc, old, new, validate, false);
+}
+
+static int ftrace_modify_callsite(unsigned long pc, u32 old, u32 new)
+{
+	return __ftrace_modify_code(pc, old, new, true, true);
+}
+
 /*
  * Replace tracer function in ftrace_caller()
  */
@@ -151,7 +200,7 @@ int ftrace_make_call(struct dyn_ftrace *rec, unsigned long addr)
 	old = aarch64_insn_gen_nop();
 	new = aarch64_insn_gen_branch_imm(pc, addr, AARCH64_INSN_BRANCH_LINK);
 
-	return ftrace_modify_code(pc, old, new, true);
+	return ftrace_modify_callsite(pc, old, new);
 }
 
 #ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
@@ -170,7 +219,7 @@ int ftrace_modify_call(struct dyn_ftrace *rec, unsigned long old_addr,
 					  AARCH64_INSN_BRANCH_LINK);
 	new = aarch64_insn_gen_branch_imm(pc, addr, AARCH64_INSN_BRANCH_LINK);
 
-	return ftrace_modify_code(pc, old, new, true);
+	return ftrace_modify_callsite(pc, old, new);
 }
 
 /*
@@ -238,13 +287,18 @@ int ftrace_make_nop(struct module *mod, struct dyn_ftrace *rec,
 
 	old = aarch64_insn_gen_branch_imm(pc, addr, AARCH64_INSN_BRANCH_LINK);
 
-	return ftrace_modify_code(pc, old, new, true);
+	return ftrace_modify_callsite(pc, old, new);
 }
 
 void arch_ftrace_update_code(int command)
 {
 	command |= FTRACE_MAY_SLEEP;
+
+	ftrace_batching = true;
 	ftrace_modify_all_code(command);
+	ftrace_batching = false;
+
+	WARN_ON_ONCE(ftrace_batch_flush());
 }
 #endif /* CONFIG_DYNAMIC_FTRACE */
 
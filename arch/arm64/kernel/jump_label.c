@@ -10,19 +10,54 @@
 #include <asm/insn.h>
 #include <asm/patching.h>
 
+#define JUMP_LABEL_BATCH_MAX	128
+
+/* Entries queued for patching, under jump_label_mutex */
+static void *jump_label_batch_addrs[JUMP_LABEL_BATCH_MAX];
+static u32 jump_label_batch_insns[JUMP_LABEL_BATCH_MAX];
+static int jump_label_batch_cnt;
+
+static u32 jump_label_insn(struct jump_entry *entry,
+			   enum jump_label_type type)
+{
+	if (type == JUMP_LABEL_JMP)
+		return aarch64_insn_gen_branch_imm(jump_entry_code(entry),
+						   jump_entry_target(entry),
+						   AARCH64_INSN_BRANCH_NOLINK);
+
+	return aarch64_insn_gen_nop();
+}
+
 void arch_jump_label_transform(struct jump_entry *entry,
 			       enum jump_label_type type)
 {
 	void *addr = (void *)jump_entry_code(entry);
-	u32 insn;
 
-	if (type == JUMP_LABEL_JMP) {
-		insn = aarch64_insn_gen_branch_imm(jump_entry_code(entry),
-						   jump_entry_target(entry),
-						   AARCH64_INSN_BRANCH_NOLINK);
-	} else {
-		insn = aarch64_insn_gen_nop();
-	}
+	aarch64_insn_patch_text_nosync(addr, jump_label_insn(entry, type));
+}
+
+bool arch_jump_label_transform_queue(struct jump_entry *entry,
+				     enum jump_label_type type)
+{
+	if (jump_label_batch_cnt == JUMP_LABEL_BATCH_MAX)
+		return false;
+
+	jump_label_batch_addrs[jump_label_batch_cnt] =
+		(void *)jump_entry_code(entry);
+	jump_label_batch_insns[jump_label_batch_cnt] =
+		jump_label_insn(entry, type);
+	jump_label_batch_cnt++;
+
+	return true;
+}
+
+void arch_jump_label_transform_apply(void)
+{
+	if (!jump_label_batch_cnt)
+		return;
 
-	aarch64_insn_patch_text_nosync(addr, insn);
+	aarch64_insn_patch_text_batch(jump_label_batch_addrs,
+				      jump_label_batch_insns,
+				      jump_label_batch_cnt);
+	jump_label_batch_cnt = 0;
 }
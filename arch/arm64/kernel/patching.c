@@ -15,6 +15,9 @@
 
 static DEFINE_RAW_SPINLOCK(patch_lock);
 
+/* Above this many instructions, invalidate the whole I-cache once */
+#define PATCH_BATCH_ICACHE_ALL	16
+
 static bool is_exit_text(unsigned long addr)
 {
 	/* discarded with init text/data */
@@ -105,6 +108,69 @@ int __kprobes aarch64_insn_patch_text_nosync(void *addr, u32 insn)
 	return ret;
 }
 
+/**
+ * aarch64_insn_patch_text_batch - Patch instructions without synchronisation
+ * @addrs: addresses of the instructions, preferably in ascending order
+ * @insns: new instructions
+ * @cnt: number of instructions
+ *
+ * Like aarch64_insn_patch_text_nosync() on each instruction, but the text
+ * is mapped once for each run of instructions in the same page, and large
+ * batches invalidate the I-cache once rather than line by line.
+ *
+ * Return: 0 on success, the error of the first failed write otherwise, the
+ * instructions before it being patched.
+ */
+int __kprobes aarch64_insn_patch_text_batch(void *addrs[], u32 insns[], int cnt)
+{
+	unsigned long flags, addr, page = 0;
+	void *waddr = NULL;
+	__le32 insn;
+	int i, ret = 0;
+
+	/* A64 instructions must be word aligned */
+	for (i = 0; i < cnt; i++)
+		if ((uintptr_t)addrs[i] & 0x3)
+			return -EINVAL;
+
+	raw_spin_lock_irqsave(&patch_lock, flags);
+	for (i = 0; i < cnt; i++) {
+		addr = (unsigned long)addrs[i];
+		if (!waddr || (addr & PAGE_MASK) != page) {
+			if (waddr)
+				patch_unmap(FIX_TEXT_POKE0);
+			page = addr & PAGE_MASK;
+			waddr = patch_map((void *)page, FIX_TEXT_POKE0);
+		}
+
+		insn = cpu_to_le32(insns[i]);
+		ret = copy_to_kernel_nofault(waddr + offset_in_page(addr),
+					     &insn, AARCH64_INSN_SIZE);
+		if (ret)
+			break;
+	}
+	if (waddr)
+		patch_unmap(FIX_TEXT_POKE0);
+	raw_spin_unlock_irqrestore(&patch_lock, flags);
+
+	cnt = i;
+	if (cnt > PATCH_BATCH_ICACHE_ALL) {
+		for (i = 0; i < cnt; i++) {
+			addr = (unsigned long)addrs[i];
+			dcache_clean_pou(addr, addr + AARCH64_INSN_SIZE);
+		}
+		icache_inval_all_pou();
+		isb();
+	} else {
+		for (i = 0; i < cnt; i++) {
+			addr = (unsigned long)addrs[i];
+			caches_clean_inval_pou(addr, addr + AARCH64_INSN_SIZE);
+		}
+	}
+
+	return ret;
+}
+
 struct aarch64_insn_patch {
 	void		**text_addrs;
 	u32		*new_insns;
@@ -76,11 +76,13 @@ struct loop_device {
 	struct gendisk		*lo_disk;
 	struct mutex		lo_mutex;
 	bool			idr_visible;
+	atomic_t		*inflight;
 };
 
 struct loop_cmd {
 	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
+	bool use_nowait; /* aio issued from ->queue_rq with IOCB_NOWAIT */
 	atomic_t ref; /* only for aio */
 	long ret;
 	struct kiocb iocb;
@@ -96,6 +98,8 @@ static DEFINE_IDR(loop_index_idr);
 static DEFINE_MUTEX(loop_ctl_mutex);
 static DEFINE_MUTEX(loop_validate_mutex);
 
+static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd);
+
 /**
  * loop_global_lock_killable() - take locks for safe loop_validate_file() test
  *
@@ -339,8 +343,11 @@ static int lo_req_flush(struct loop_device *lo, struct request *rq)
 static void lo_complete_rq(struct request *rq)
 {
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
+	struct loop_device *lo = rq->q->queuedata;
 	blk_status_t ret = BLK_STS_OK;
 
+	atomic_dec(&lo->inflight[rq->mq_hctx->queue_num]);
+
 	if (!cmd->use_aio || cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -379,6 +386,21 @@ static void lo_rw_aio_do_completion(struct loop_cmd *cmd)
 		return;
 	kfree(cmd->bvec);
 	cmd->bvec = NULL;
+
+	/*
+	 * An I/O issued with IOCB_NOWAIT which would have blocked, or a short
+	 * write, is issued again from the worker without IOCB_NOWAIT. This
+	 * may be called from interrupt context.
+	 */
+	if (cmd->use_nowait &&
+	    (cmd->ret == -EAGAIN ||
+	     (op_is_write(req_op(rq)) && cmd->ret >= 0 &&
+	      cmd->ret != blk_rq_bytes(rq)))) {
+		cmd->use_nowait = false;
+		loop_queue_work(rq->q->queuedata, cmd);
+		return;
+	}
+
 	if (likely(!blk_should_fake_timeout(rq->q)))
 		blk_mq_complete_request(rq);
 }
@@ -446,6 +468,8 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	cmd->iocb.ki_filp = file;
 	cmd->iocb.ki_complete = lo_rw_aio_complete;
 	cmd->iocb.ki_flags = IOCB_DIRECT;
+	if (cmd->use_nowait)
+		cmd->iocb.ki_flags |= IOCB_NOWAIT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
 
 	if (rw == WRITE)
@@ -719,12 +743,26 @@ static ssize_t loop_attr_dio_show(struct loop_device *lo, char *buf)
 	return sysfs_emit(buf, "%s\n", dio ? "1" : "0");
 }
 
+static ssize_t loop_attr_inflight_show(struct loop_device *lo, char *buf)
+{
+	ssize_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < lo->tag_set.nr_hw_queues; i++)
+		len += sysfs_emit_at(buf, len, "%s%d", i ? " " : "",
+				     atomic_read(&lo->inflight[i]));
+	len += sysfs_emit_at(buf, len, "\n");
+
+	return len;
+}
+
 LOOP_ATTR_RO(backing_file);
 LOOP_ATTR_RO(offset);
 LOOP_ATTR_RO(sizelimit);
 LOOP_ATTR_RO(autoclear);
 LOOP_ATTR_RO(partscan);
 LOOP_ATTR_RO(dio);
+LOOP_ATTR_RO(inflight);
 
 static struct attribute *loop_attrs[] = {
 	&loop_attr_backing_file.attr,
@@ -733,6 +771,7 @@ static struct attribute *loop_attrs[] = {
 	&loop_attr_autoclear.attr,
 	&loop_attr_partscan.attr,
 	&loop_attr_dio.attr,
+	&loop_attr_inflight.attr,
 	NULL,
 };
 
@@ -834,8 +873,9 @@ static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
 	struct loop_worker *cur_worker, *worker = NULL;
 	struct work_struct *work;
 	struct list_head *cmd_list;
+	unsigned long flags;
 
-	spin_lock_irq(&lo->lo_work_lock);
+	spin_lock_irqsave(&lo->lo_work_lock, flags);
 
 	if (queue_on_root_worker(cmd->blkcg_css))
 		goto queue_work;
@@ -895,7 +935,7 @@ static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
 	}
 	list_add_tail(&cmd->list_entry, cmd_list);
 	queue_work(lo->workqueue, work);
-	spin_unlock_irq(&lo->lo_work_lock);
+	spin_unlock_irqrestore(&lo->lo_work_lock, flags);
 }
 
 static void loop_set_timer(struct loop_device *lo)
@@ -1796,9 +1836,64 @@ static const struct kernel_param_ops loop_hw_qdepth_param_ops = {
 device_param_cb(hw_queue_depth, &loop_hw_qdepth_param_ops, &hw_queue_depth, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: 128");
 
+static unsigned int nr_hw_queues;
+module_param(nr_hw_queues, uint, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues. Default: number of CPUs");
+
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
+/*
+ * Direct I/O to a backing file supporting IOCB_NOWAIT is issued right from
+ * ->queue_rq, on the CPU of the hardware queue, and is only handed over to
+ * a worker if it would block. The I/O must be charged to the same cgroup as
+ * from the worker, so this is only done for the root cgroup or from the
+ * task which submitted the bio.
+ */
+static bool loop_can_submit_nowait(struct loop_device *lo,
+				   struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	bool ret = false;
+
+	if (!cmd->use_aio || !(lo->lo_backing_file->f_mode & FMODE_NOWAIT))
+		return false;
+	if (req_op(rq) != REQ_OP_READ && req_op(rq) != REQ_OP_WRITE)
+		return false;
+	if (req_op(rq) == REQ_OP_WRITE && (lo->lo_flags & LO_FLAGS_READ_ONLY))
+		return false;
+	if (queue_on_root_worker(cmd->blkcg_css))
+		return true;
+#ifdef CONFIG_BLK_CGROUP
+	rcu_read_lock();
+	ret = task_css(current, io_cgrp_id) == cmd->blkcg_css;
+	rcu_read_unlock();
+#endif
+	return ret;
+}
+
+static int loop_submit_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	loff_t pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	unsigned int noio_flag;
+	int ret;
+
+	/* Direct I/O doesn't go through the page cache, nothing to charge */
+	if (cmd->memcg_css)
+		css_put(cmd->memcg_css);
+	cmd->memcg_css = NULL;
+
+	cmd->use_nowait = true;
+	noio_flag = memalloc_noio_save();
+	ret = lo_rw_aio(lo, cmd, pos,
+			req_op(rq) == REQ_OP_WRITE ? WRITE : READ);
+	memalloc_noio_restore(noio_flag);
+	if (ret)
+		cmd->use_nowait = false;
+	return ret;
+}
+
 static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		const struct blk_mq_queue_data *bd)
 {
@@ -1811,6 +1906,9 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 	if (lo->lo_state != Lo_bound)
 		return BLK_STS_IOERR;
 
+	atomic_inc(&lo->inflight[hctx->queue_num]);
+	cmd->use_nowait = false;
+
 	switch (req_op(rq)) {
 	case REQ_OP_FLUSH:
 	case REQ_OP_DISCARD:
@@ -1837,6 +1935,9 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 #endif
 	}
 #endif
+	if (loop_can_submit_nowait(lo, cmd) && !loop_submit_nowait(lo, cmd))
+		return BLK_STS_OK;
+
 	loop_queue_work(lo, cmd);
 
 	return BLK_STS_OK;
@@ -1968,18 +2069,25 @@ static int loop_add(int i)
 	i = err;
 
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
+	lo->tag_set.nr_hw_queues = nr_hw_queues ?: num_possible_cpus();
 	lo->tag_set.queue_depth = hw_queue_depth;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
+	/* ->queue_rq may issue the I/O to the backing file itself */
 	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING |
-		BLK_MQ_F_NO_SCHED_BY_DEFAULT;
+		BLK_MQ_F_NO_SCHED_BY_DEFAULT | BLK_MQ_F_BLOCKING;
 	lo->tag_set.driver_data = lo;
 
 	err = blk_mq_alloc_tag_set(&lo->tag_set);
 	if (err)
 		goto out_free_idr;
 
+	err = -ENOMEM;
+	lo->inflight = kcalloc(lo->tag_set.nr_hw_queues,
+			       sizeof(*lo->inflight), GFP_KERNEL);
+	if (!lo->inflight)
+		goto out_cleanup_tags;
+
 	disk = lo->lo_disk = blk_mq_alloc_disk(&lo->tag_set, lo);
 	if (IS_ERR(disk)) {
 		err = PTR_ERR(disk);
@@ -2053,6 +2161,7 @@ static int loop_add(int i)
 	idr_remove(&loop_index_idr, i);
 	mutex_unlock(&loop_ctl_mutex);
 out_free_dev:
+	kfree(lo->inflight);
 	kfree(lo);
 out:
 	return err;
@@ -2068,6 +2177,7 @@ static void loop_remove(struct loop_device *lo)
 	idr_remove(&loop_index_idr, lo->lo_number);
 	mutex_unlock(&loop_ctl_mutex);
 
+	kfree(lo->inflight);
 	put_disk(lo->lo_disk);
 }
 
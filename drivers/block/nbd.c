@@ -34,6 +34,7 @@
 #include <linux/slab.h>
 #include <net/sock.h>
 #include <linux/net.h>
+#include <linux/tcp.h>
 #include <linux/kthread.h>
 #include <linux/types.h>
 #include <linux/debugfs.h>
@@ -60,6 +61,7 @@ struct nbd_sock {
 	struct request *pending;
 	int sent;
 	bool dead;
+	bool corked;
 	int fallback_index;
 	int cookie;
 };
@@ -537,6 +539,59 @@ static int sock_xmit(struct nbd_device *nbd, int index, int send,
 	return result;
 }
 
+/*
+ * Send a page of the payload of a write without copying it, the request is
+ * only completed once the server replied, so after it received the page.
+ */
+static int sock_send_page(struct nbd_device *nbd, int index,
+			  struct page *page, int offset, size_t size,
+			  int msg_flags, int *sent)
+{
+	struct socket *sock = nbd->config->socks[index]->sock;
+	unsigned int noreclaim_flag;
+	int result = 0;
+
+	if (unlikely(!sock)) {
+		dev_err_ratelimited(disk_to_dev(nbd->disk),
+			"Attempted send on closed socket in sock_send_page\n");
+		return -EINVAL;
+	}
+
+	if (msg_flags & MSG_MORE)
+		msg_flags |= MSG_SENDPAGE_NOTLAST;
+
+	noreclaim_flag = memalloc_noreclaim_save();
+	while (size) {
+		sock->sk->sk_allocation = GFP_NOIO | __GFP_MEMALLOC;
+		result = kernel_sendpage(sock, page, offset, size,
+					 msg_flags | MSG_NOSIGNAL);
+		if (result <= 0) {
+			if (result == 0)
+				result = -EPIPE;
+			break;
+		}
+		if (sent)
+			*sent += result;
+		offset += result;
+		size -= result;
+	}
+	memalloc_noreclaim_restore(noreclaim_flag);
+
+	return result;
+}
+
+/*
+ * Push out what was queued on the socket with MSG_MORE.
+ */
+static void sock_push(struct socket *sock)
+{
+	struct sock *sk = sock->sk;
+
+	if (sk->sk_type == SOCK_STREAM && sk->sk_protocol == IPPROTO_TCP &&
+	    (sk->sk_family == AF_INET || sk->sk_family == AF_INET6))
+		tcp_sock_set_cork(sk, false);
+}
+
 /*
  * Different settings for sk->sk_sndtimeo can result in different return values
  * if there is a signal pending when we enter sendmsg, because reasons?
@@ -546,8 +601,12 @@ static inline int was_interrupted(int result)
 	return result == -ERESTARTSYS || result == -EINTR;
 }
 
-/* always call with the tx_lock held */
-static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
+/*
+ * always call with the tx_lock held, @last is false when more requests are
+ * about to be sent on the socket and the request can be sent with MSG_MORE
+ */
+static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index,
+			bool last)
 {
 	struct request *req = blk_mq_rq_from_pdu(cmd);
 	struct nbd_config *config = nbd->config;
@@ -613,7 +672,7 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 		req, nbdcmd_to_ascii(type),
 		(unsigned long long)blk_rq_pos(req) << 9, blk_rq_bytes(req));
 	result = sock_xmit(nbd, index, 1, &from,
-			(type == NBD_CMD_WRITE) ? MSG_MORE : 0, &sent);
+			(type == NBD_CMD_WRITE || !last) ? MSG_MORE : 0, &sent);
 	trace_nbd_header_sent(req, handle);
 	if (result < 0) {
 		if (was_interrupted(result)) {
@@ -645,7 +704,7 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 
 		bio_for_each_segment(bvec, bio, iter) {
 			bool is_last = !next && bio_iter_last(bvec, iter);
-			int flags = is_last ? 0 : MSG_MORE;
+			int flags = (is_last && last) ? 0 : MSG_MORE;
 
 			dev_dbg(nbd_to_dev(nbd), "request %p: sending %d bytes data\n",
 				req, bvec.bv_len);
@@ -658,7 +717,14 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 				iov_iter_advance(&from, skip);
 				skip = 0;
 			}
-			result = sock_xmit(nbd, index, 1, &from, flags, &sent);
+			if (sendpage_ok(bvec.bv_page))
+				result = sock_send_page(nbd, index, bvec.bv_page,
+					bvec.bv_offset + bvec.bv_len -
+					iov_iter_count(&from),
+					iov_iter_count(&from), flags, &sent);
+			else
+				result = sock_xmit(nbd, index, 1, &from, flags,
+						   &sent);
 			if (result < 0) {
 				if (was_interrupted(result)) {
 					/* We've already sent the header, we
@@ -690,6 +756,7 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 	trace_nbd_payload_sent(req, handle);
 	nsock->pending = NULL;
 	nsock->sent = 0;
+	nsock->corked = !last;
 	return 0;
 }
 
@@ -966,7 +1033,7 @@ static int wait_for_reconnect(struct nbd_device *nbd)
 	return !test_bit(NBD_RT_DISCONNECTED, &config->runtime_flags);
 }
 
-static int nbd_handle_cmd(struct nbd_cmd *cmd, int index)
+static int nbd_handle_cmd(struct nbd_cmd *cmd, int index, bool last)
 {
 	struct request *req = blk_mq_rq_from_pdu(cmd);
 	struct nbd_device *nbd = cmd->nbd;
@@ -1028,7 +1095,8 @@ static int nbd_handle_cmd(struct nbd_cmd *cmd, int index)
 	 * Some failures are related to the link going down, so anything that
 	 * returns EAGAIN can be retried on a different socket.
 	 */
-	ret = nbd_send_cmd(nbd, cmd, index);
+	ret = nbd_send_cmd(nbd, cmd, index,
+			   last || index != req->mq_hctx->queue_num);
 	/*
 	 * Access to this flag is protected by cmd->lock, thus it's safe to set
 	 * the flag after nbd_send_cmd() succeed to send request to server.
@@ -1071,7 +1139,7 @@ static blk_status_t nbd_queue_rq(struct blk_mq_hw_ctx *hctx,
 	 * this case we need to return that we are busy, otherwise error out as
 	 * appropriate.
 	 */
-	ret = nbd_handle_cmd(cmd, hctx->queue_num);
+	ret = nbd_handle_cmd(cmd, hctx->queue_num, bd->last);
 	if (ret < 0)
 		ret = BLK_STS_IOERR;
 	else if (!ret)
@@ -1081,6 +1149,31 @@ static blk_status_t nbd_queue_rq(struct blk_mq_hw_ctx *hctx,
 	return ret;
 }
 
+/*
+ * The last request sent on the socket of the hardware queue may have been sent
+ * with MSG_MORE, waiting for a request which is not coming.
+ */
+static void nbd_commit_rqs(struct blk_mq_hw_ctx *hctx)
+{
+	struct nbd_device *nbd = hctx->queue->tag_set->driver_data;
+	struct nbd_config *config;
+	struct nbd_sock *nsock;
+
+	if (!refcount_inc_not_zero(&nbd->config_refs))
+		return;
+	config = nbd->config;
+
+	if (hctx->queue_num < config->num_connections) {
+		nsock = config->socks[hctx->queue_num];
+		mutex_lock(&nsock->tx_lock);
+		if (nsock->corked && nsock->sock && !nsock->dead)
+			sock_push(nsock->sock);
+		nsock->corked = false;
+		mutex_unlock(&nsock->tx_lock);
+	}
+	nbd_config_put(nbd);
+}
+
 static struct socket *nbd_get_socket(struct nbd_device *nbd, unsigned long fd,
 				     int *err)
 {
@@ -1732,6 +1825,7 @@ static int nbd_init_request(struct blk_mq_tag_set *set, struct request *rq,
 
 static const struct blk_mq_ops nbd_mq_ops = {
 	.queue_rq	= nbd_queue_rq,
+	.commit_rqs	= nbd_commit_rqs,
 	.complete	= nbd_complete_rq,
 	.init_request	= nbd_init_request,
 	.timeout	= nbd_xmit_timeout,
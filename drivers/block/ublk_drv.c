@@ -51,7 +51,8 @@
 		| UBLK_F_URING_CMD_COMP_IN_TASK \
 		| UBLK_F_NEED_GET_DATA \
 		| UBLK_F_USER_RECOVERY \
-		| UBLK_F_USER_RECOVERY_REISSUE)
+		| UBLK_F_USER_RECOVERY_REISSUE \
+		| UBLK_F_BATCH_IO)
 
 /* All UBLK_PARAM_TYPE_* should be included here */
 #define UBLK_PARAM_TYPE_ALL (UBLK_PARAM_TYPE_BASIC | UBLK_PARAM_TYPE_DISCARD)
@@ -59,10 +60,17 @@
 struct ublk_rq_data {
 	struct llist_node node;
 	struct callback_head work;
+	/* held by the server and by the buffers of the request, zero copy */
+	refcount_t ref;
 };
 
 struct ublk_uring_cmd_pdu {
 	struct ublk_queue *ubq;
+
+	/* UBLK_IO_COMMIT_AND_FETCH_BATCH */
+	u64 fetch_addr;
+	u64 buf_addr;
+	u16 nr_fetch;
 };
 
 /*
@@ -122,6 +130,9 @@ struct ublk_queue {
 
 	struct llist_head	io_cmds;
 
+	/* armed UBLK_IO_COMMIT_AND_FETCH_BATCH, claimed with xchg() */
+	struct io_uring_cmd	*batch_cmd;
+
 	unsigned long io_addr;	/* mapped vm address */
 	unsigned int max_io_sz;
 	bool force_abort;
@@ -286,6 +297,16 @@ static inline bool ublk_need_get_data(const struct ublk_queue *ubq)
 	return false;
 }
 
+static inline bool ublk_support_zero_copy(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_SUPPORT_ZERO_COPY;
+}
+
+static inline bool ublk_support_batch_io(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_BATCH_IO;
+}
+
 static struct ublk_device *ublk_get_device(struct ublk_device *ub)
 {
 	if (kobject_get_unless_zero(&ub->cdev_dev.kobj))
@@ -470,6 +491,11 @@ static int ublk_map_io(const struct ublk_queue *ubq, const struct request *req,
 		struct ublk_io *io)
 {
 	const unsigned int rq_bytes = blk_rq_bytes(req);
+
+	/* zero copy, ublksrv registers the request pages as buffer */
+	if (ublk_support_zero_copy(ubq))
+		return rq_bytes;
+
 	/*
 	 * no zero copy, we delay copy WRITE request data into ublksrv
 	 * context and the big benefit is that pinning pages in current
@@ -499,6 +525,9 @@ static int ublk_unmap_io(const struct ublk_queue *ubq,
 {
 	const unsigned int rq_bytes = blk_rq_bytes(req);
 
+	if (ublk_support_zero_copy(ubq))
+		return rq_bytes;
+
 	if (req_op(req) == REQ_OP_READ && ublk_rq_has_data(req)) {
 		struct ublk_map_data data = {
 			.ubq	=	ubq,
@@ -591,7 +620,7 @@ static inline bool ubq_daemon_is_dying(struct ublk_queue *ubq)
 }
 
 /* todo: handle partial completion */
-static void ublk_complete_rq(struct request *req)
+static void __ublk_complete_rq(struct request *req)
 {
 	struct ublk_queue *ubq = req->mq_hctx->driver_data;
 	struct ublk_io *io = &ubq->ios[req->tag];
@@ -634,6 +663,32 @@ static void ublk_complete_rq(struct request *req)
 		__blk_mq_end_request(req, BLK_STS_OK);
 }
 
+/* Return true if the last reference to a zero copy request is dropped */
+static inline bool ublk_drop_req_ref(struct request *req)
+{
+	struct ublk_rq_data *data = blk_mq_rq_to_pdu(req);
+
+	return refcount_dec_and_test(&data->ref);
+}
+
+static void ublk_complete_rq(struct request *req)
+{
+	struct ublk_queue *ubq = req->mq_hctx->driver_data;
+
+	/* the pages may still be in use through a registered buffer */
+	if (!ublk_support_zero_copy(ubq) || ublk_drop_req_ref(req))
+		__ublk_complete_rq(req);
+}
+
+/* Buffer release callback, the request's io_uring users are done with it */
+static void ublk_io_buf_release(void *priv)
+{
+	struct request *req = priv;
+
+	if (ublk_drop_req_ref(req))
+		__ublk_complete_rq(req);
+}
+
 /*
  * Since __ublk_rq_task_work always fails requests immediately during
  * exiting, __ublk_fail_req() is only called from abort context during
@@ -649,6 +704,10 @@ static void __ublk_fail_req(struct ublk_queue *ubq, struct ublk_io *io,
 
 	if (!(io->flags & UBLK_IO_FLAG_ABORTED)) {
 		io->flags |= UBLK_IO_FLAG_ABORTED;
+		/* the release of the last buffer of the request fails it */
+		io->res = -EIO;
+		if (ublk_support_zero_copy(ubq) && !ublk_drop_req_ref(req))
+			return;
 		if (ublk_queue_can_use_recovery_reissue(ubq))
 			blk_mq_requeue_request(req, false);
 		else
@@ -791,6 +850,87 @@ static void ublk_rq_task_work_cb(struct io_uring_cmd *cmd)
 	ublk_forward_io_cmds(ubq);
 }
 
+/*
+ * Hand the pending requests over to ublksrv through the batch command,
+ * in the context of ubq_daemon. The requests beyond nr_fetch stay queued
+ * for the next batch command.
+ */
+static void ublk_batch_deliver(struct ublk_queue *ubq,
+		struct io_uring_cmd *cmd)
+{
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+	u16 __user *tags = u64_to_user_ptr(pdu->fetch_addr);
+	struct llist_node *io_cmds = llist_del_all(&ubq->io_cmds);
+	u32 buf_sz = ubq->dev->dev_info.max_io_buf_bytes;
+	struct ublk_rq_data *data, *tmp;
+	unsigned int nr = 0;
+	int ret = 0;
+
+	/* see __ublk_rq_task_work(), the command isn't owned by anyone else */
+	if (unlikely(current != ubq->ubq_daemon || current->flags & PF_EXITING)) {
+		llist_for_each_entry_safe(data, tmp, io_cmds, node)
+			__ublk_abort_rq(ubq, blk_mq_rq_from_pdu(data));
+		io_uring_cmd_done(cmd, UBLK_IO_RES_ABORT, 0);
+		return;
+	}
+
+	io_cmds = llist_reverse_order(io_cmds);
+	llist_for_each_entry_safe(data, tmp, io_cmds, node) {
+		struct request *req = blk_mq_rq_from_pdu(data);
+		struct ublk_io *io = &ubq->ios[req->tag];
+		unsigned int mapped_bytes;
+
+		if (nr >= pdu->nr_fetch || ret) {
+			llist_add(&data->node, &ubq->io_cmds);
+			continue;
+		}
+
+		if (put_user(req->tag, &tags[nr])) {
+			ret = -EFAULT;
+			llist_add(&data->node, &ubq->io_cmds);
+			continue;
+		}
+
+		io->addr = pdu->buf_addr ?
+			pdu->buf_addr + (u64)req->tag * buf_sz : 0;
+		ublk_get_iod(ubq, req->tag)->addr = io->addr;
+
+		/* same as __ublk_rq_task_work() */
+		mapped_bytes = ublk_map_io(ubq, req, io);
+		if (unlikely(mapped_bytes != blk_rq_bytes(req))) {
+			if (unlikely(!mapped_bytes)) {
+				blk_mq_requeue_request(req, false);
+				blk_mq_delay_kick_requeue_list(req->q,
+						UBLK_REQUEUE_DELAY_MS);
+				continue;
+			}
+			ublk_get_iod(ubq, req->tag)->nr_sectors =
+				mapped_bytes >> 9;
+		}
+
+		io->flags |= UBLK_IO_FLAG_OWNED_BY_SRV;
+		nr++;
+	}
+
+	io_uring_cmd_done(cmd, nr ? nr : ret, 0);
+}
+
+static void ublk_batch_task_work_cb(struct io_uring_cmd *cmd)
+{
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+
+	ublk_batch_deliver(pdu->ubq, cmd);
+}
+
+/* The first request queued completes the armed batch command */
+static void ublk_batch_kick(struct ublk_queue *ubq)
+{
+	struct io_uring_cmd *cmd = xchg(&ubq->batch_cmd, NULL);
+
+	if (cmd)
+		io_uring_cmd_complete_in_task(cmd, ublk_batch_task_work_cb);
+}
+
 static void ublk_rq_task_work_fn(struct callback_head *work)
 {
 	struct ublk_rq_data *data = container_of(work,
@@ -824,6 +964,8 @@ static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
 	 */
 	if (unlikely(io->flags & UBLK_IO_FLAG_ABORTED)) {
 		ublk_abort_io_cmds(ubq);
+	} else if (ublk_support_batch_io(ubq)) {
+		ublk_batch_kick(ubq);
 	} else if (ublk_can_use_task_work(ubq)) {
 		if (task_work_add(ubq->ubq_daemon, &data->work,
 					TWA_SIGNAL_NO_IPI))
@@ -863,6 +1005,12 @@ static blk_status_t ublk_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	blk_mq_start_request(bd->rq);
 
+	if (ublk_support_zero_copy(ubq)) {
+		struct ublk_rq_data *data = blk_mq_rq_to_pdu(rq);
+
+		refcount_set(&data->ref, 1);
+	}
+
 	if (unlikely(ubq_daemon_is_dying(ubq))) {
 		__ublk_abort_rq(ubq, rq);
 		return BLK_STS_OK;
@@ -986,6 +1134,27 @@ static void ublk_abort_queue(struct ublk_device *ub, struct ublk_queue *ubq)
 	if (!ublk_get_device(ub))
 		return;
 
+	/*
+	 * Without the io commands of the tags, only the requests handed over
+	 * to ublksrv are failed here, the pending ones are aborted from the
+	 * queue.
+	 */
+	if (ublk_support_batch_io(ubq)) {
+		ublk_abort_io_cmds(ubq);
+		for (i = 0; i < ubq->q_depth; i++) {
+			struct ublk_io *io = &ubq->ios[i];
+			struct request *rq;
+
+			if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV))
+				continue;
+			rq = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], i);
+			if (rq)
+				__ublk_fail_req(ubq, io, rq);
+		}
+		ublk_put_device(ub);
+		return;
+	}
+
 	for (i = 0; i < ubq->q_depth; i++) {
 		struct ublk_io *io = &ubq->ios[i];
 
@@ -1043,11 +1212,16 @@ static inline bool ublk_queue_ready(struct ublk_queue *ubq)
 
 static void ublk_cancel_queue(struct ublk_queue *ubq)
 {
+	struct io_uring_cmd *cmd;
 	int i;
 
 	if (!ublk_queue_ready(ubq))
 		return;
 
+	cmd = xchg(&ubq->batch_cmd, NULL);
+	if (cmd)
+		io_uring_cmd_done(cmd, UBLK_IO_RES_ABORT, 0);
+
 	for (i = 0; i < ubq->q_depth; i++) {
 		struct ublk_io *io = &ubq->ios[i];
 
@@ -1171,10 +1345,11 @@ static void ublk_stop_dev(struct ublk_device *ub)
 }
 
 /* device can only be started after all IOs are ready */
-static void ublk_mark_io_ready(struct ublk_device *ub, struct ublk_queue *ubq)
+static void ublk_mark_io_ready(struct ublk_device *ub, struct ublk_queue *ubq,
+		unsigned int nr)
 {
 	mutex_lock(&ub->mutex);
-	ubq->nr_io_ready++;
+	ubq->nr_io_ready += nr;
 	if (ublk_queue_ready(ubq)) {
 		ubq->ubq_daemon = current;
 		get_task_struct(ubq->ubq_daemon);
@@ -1194,6 +1369,128 @@ static void ublk_handle_need_get_data(struct ublk_device *ub, int q_id,
 	ublk_queue_cmd(ubq, req);
 }
 
+static int ublk_register_io_buf(struct io_uring_cmd *cmd,
+		struct ublk_queue *ubq, unsigned int tag, u64 index,
+		unsigned int issue_flags)
+{
+	struct ublk_device *ub = ubq->dev;
+	struct ublk_io *io = &ubq->ios[tag];
+	struct ublk_rq_data *data;
+	struct request *req;
+	int ret;
+
+	if (!ublk_support_zero_copy(ubq) || index > U16_MAX)
+		return -EINVAL;
+
+	/* only the request being handled by ublksrv has pages to lend */
+	if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV) ||
+	    io->flags & UBLK_IO_FLAG_ABORTED)
+		return -EINVAL;
+
+	req = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], tag);
+	if (!req || !ublk_rq_has_data(req))
+		return -EINVAL;
+
+	/* the reference of ublksrv is held until the request is committed */
+	data = blk_mq_rq_to_pdu(req);
+	if (!refcount_inc_not_zero(&data->ref))
+		return -EINVAL;
+
+	ret = io_buffer_register_bvec(cmd, req, ublk_io_buf_release, req,
+				      index, issue_flags);
+	if (ret)
+		refcount_dec(&data->ref);
+	return ret;
+}
+
+static int ublk_unregister_io_buf(struct io_uring_cmd *cmd,
+		struct ublk_queue *ubq, u64 index, unsigned int issue_flags)
+{
+	if (!ublk_support_zero_copy(ubq) || index > U16_MAX)
+		return -EINVAL;
+
+	return io_buffer_unregister_bvec(cmd, index, issue_flags);
+}
+
+static int ublk_batch_commit(struct ublk_device *ub, struct ublk_queue *ubq,
+		const struct ublksrv_batch_io_cmd *bc)
+{
+	struct ublk_batch_commit_elem __user *uelems =
+		u64_to_user_ptr(bc->commit_addr);
+	struct ublk_batch_commit_elem elems[32];
+	unsigned int i, j, n;
+
+	for (i = 0; i < bc->nr_commit; i += n) {
+		n = min_t(unsigned int, bc->nr_commit - i, ARRAY_SIZE(elems));
+		if (copy_from_user(elems, &uelems[i], n * sizeof(elems[0])))
+			return -EFAULT;
+
+		for (j = 0; j < n; j++) {
+			struct ublksrv_io_cmd ub_cmd = {
+				.q_id	= ubq->q_id,
+				.tag	= elems[j].tag,
+				.result	= elems[j].result,
+			};
+
+			if (ub_cmd.tag >= ubq->q_depth ||
+			    !(ubq->ios[ub_cmd.tag].flags &
+			      UBLK_IO_FLAG_OWNED_BY_SRV))
+				return -EINVAL;
+			ublk_commit_completion(ub, &ub_cmd);
+		}
+	}
+	return 0;
+}
+
+static int ublk_ch_batch_cmd(struct io_uring_cmd *cmd, struct ublk_queue *ubq,
+		unsigned int issue_flags)
+{
+	const struct ublksrv_batch_io_cmd *bc = cmd->cmd;
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+	struct ublk_device *ub = ubq->dev;
+	int ret = -EINVAL;
+
+	if (!ublk_support_batch_io(ubq) || !bc->nr_fetch)
+		goto out;
+
+	/* only one batch command per queue */
+	if (READ_ONCE(ubq->batch_cmd)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (!ublk_queue_ready(ubq)) {
+		if (bc->nr_commit)
+			goto out;
+		ublk_mark_io_ready(ub, ubq, ubq->q_depth);
+	}
+
+	ret = ublk_batch_commit(ub, ubq, bc);
+	if (ret)
+		goto out;
+
+	pdu->ubq = ubq;
+	pdu->fetch_addr = bc->fetch_addr;
+	pdu->buf_addr = bc->buf_addr;
+	pdu->nr_fetch = bc->nr_fetch;
+
+	/*
+	 * Pairs with the xchg() of ublk_batch_kick() after queueing, either
+	 * side sees the other one.
+	 */
+	xchg(&ubq->batch_cmd, cmd);
+	if (!llist_empty(&ubq->io_cmds)) {
+		cmd = xchg(&ubq->batch_cmd, NULL);
+		if (cmd)
+			ublk_batch_deliver(ubq, cmd);
+	}
+	return -EIOCBQUEUED;
+
+ out:
+	io_uring_cmd_done(cmd, ret, 0);
+	return -EIOCBQUEUED;
+}
+
 static int ublk_ch_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
 {
 	struct ublksrv_io_cmd *ub_cmd = (struct ublksrv_io_cmd *)cmd->cmd;
@@ -1221,11 +1518,30 @@ static int ublk_ch_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
 	if (ubq->ubq_daemon && ubq->ubq_daemon != current)
 		goto out;
 
+	if (cmd_op == UBLK_IO_COMMIT_AND_FETCH_BATCH)
+		return ublk_ch_batch_cmd(cmd, ubq, issue_flags);
+
 	if (tag >= ubq->q_depth)
 		goto out;
 
 	io = &ubq->ios[tag];
 
+	/* buffer commands complete right away, they don't own the io slot */
+	if (cmd_op == UBLK_IO_REGISTER_IO_BUF) {
+		ret = ublk_register_io_buf(cmd, ubq, tag, ub_cmd->addr,
+					   issue_flags);
+		goto out;
+	}
+	if (cmd_op == UBLK_IO_UNREGISTER_IO_BUF) {
+		ret = ublk_unregister_io_buf(cmd, ubq, ub_cmd->addr,
+					     issue_flags);
+		goto out;
+	}
+
+	/* the ios of batch queues have no command of their own */
+	if (ublk_support_batch_io(ubq))
+		goto out;
+
 	/* there is pending io cmd, something must be wrong */
 	if (io->flags & UBLK_IO_FLAG_ACTIVE) {
 		ret = -EBUSY;
@@ -1253,18 +1569,18 @@ static int ublk_ch_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
 		 */
 		if (io->flags & UBLK_IO_FLAG_OWNED_BY_SRV)
 			goto out;
-		/* FETCH_RQ has to provide IO buffer */
-		if (!ub_cmd->addr)
+		/* FETCH_RQ has to provide IO buffer, unless zero copy */
+		if (!ub_cmd->addr && !ublk_support_zero_copy(ubq))
 			goto out;
 		io->cmd = cmd;
 		io->flags |= UBLK_IO_FLAG_ACTIVE;
 		io->addr = ub_cmd->addr;
 
-		ublk_mark_io_ready(ub, ubq);
+		ublk_mark_io_ready(ub, ubq, 1);
 		break;
 	case UBLK_IO_COMMIT_AND_FETCH_REQ:
-		/* FETCH_RQ has to provide IO buffer */
-		if (!ub_cmd->addr)
+		/* FETCH_RQ has to provide IO buffer, unless zero copy */
+		if (!ub_cmd->addr && !ublk_support_zero_copy(ubq))
 			goto out;
 		if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV))
 			goto out;
@@ -1673,8 +1989,9 @@ static int ublk_ctrl_add_dev(struct io_uring_cmd *cmd)
 	if (!IS_BUILTIN(CONFIG_BLK_DEV_UBLK))
 		ub->dev_info.flags |= UBLK_F_URING_CMD_COMP_IN_TASK;
 
-	/* We are not ready to support zero copy */
-	ub->dev_info.flags &= ~UBLK_F_SUPPORT_ZERO_COPY;
+	/* batches are fetched after the data of all writes is copied */
+	if (ub->dev_info.flags & UBLK_F_BATCH_IO)
+		ub->dev_info.flags &= ~UBLK_F_NEED_GET_DATA;
 
 	ub->dev_info.nr_hw_queues = min_t(unsigned int,
 			ub->dev_info.nr_hw_queues, nr_cpu_ids);
@@ -67,6 +67,9 @@
 #define WZRD_O_MAX			128
 #define WZRD_MIN_ERR			20000
 #define WZRD_FRAC_POINTS		1000
+/* The fractional output divider has a resolution of 1/8 */
+#define WZRD_FRAC_STEP			(WZRD_FRAC_POINTS / 8)
+#define WZRD_FRAC_O_MIN			2
 
 /* Get the mask from width */
 #define div_mask(width)			((1 << (width)) - 1)
@@ -106,6 +109,23 @@ struct clk_wzrd {
 	bool suspended;
 };
 
+/**
+ * struct clk_wzrd_cfg - Dividers producing an output rate
+ *
+ * @rate:		output rate
+ * @parent_rate:	rate of the input clock
+ * @m:			value of the multiplier
+ * @d:			value of the common divider
+ * @o:			value of the leaf divider, in 1/WZRD_FRAC_POINTS
+ */
+struct clk_wzrd_cfg {
+	unsigned long rate;
+	unsigned long parent_rate;
+	u32 m;
+	u32 d;
+	u32 o;
+};
+
 /**
  * struct clk_wzrd_divider - clock divider specific to clk_wzrd
  *
@@ -116,9 +136,9 @@ struct clk_wzrd {
  * @width:	width of the divider bit field
  * @flags:	clk_wzrd divider flags
  * @table:	array of value/divider pairs, last entry should have div = 0
- * @valuem:	value of the multiplier
- * @valued:	value of the common divider
- * @valueo:	value of the leaf divider
+ * @cfgs:	dividers of the common rates, computed at registration
+ * @nr_cfgs:	number of entries of @cfgs
+ * @frac:	true if the leaf divider can be fractional
  * @lock:	register lock
  */
 struct clk_wzrd_divider {
@@ -129,9 +149,9 @@ struct clk_wzrd_divider {
 	u8 width;
 	u8 flags;
 	const struct clk_div_table *table;
-	u32 valuem;
-	u32 valued;
-	u32 valueo;
+	struct clk_wzrd_cfg *cfgs;
+	unsigned int nr_cfgs;
+	bool frac;
 	spinlock_t *lock;  /* divider lock */
 };
 
@@ -144,6 +164,14 @@ static const unsigned long clk_wzrd_max_freq[] = {
 	1066000000UL
 };
 
+/* CEA-861 and VESA DMT/CVT pixel clocks, as requested by the display modes */
+static const unsigned long clk_wzrd_common_rates[] = {
+	25175000, 25200000, 27000000, 27027000, 40000000, 54000000,
+	65000000, 74176000, 74250000, 108000000, 138500000, 148352000,
+	148500000, 154000000, 162000000, 193250000, 241500000, 268500000,
+	296703000, 297000000, 533250000, 593407000, 594000000,
+};
+
 /* spin lock variable for clk_wzrd */
 static DEFINE_SPINLOCK(clkwzrd_lock);
 
@@ -178,7 +206,13 @@ static int clk_wzrd_dynamic_reconfig(struct clk_hw *hw, unsigned long rate,
 	value = DIV_ROUND_CLOSEST(parent_rate, rate);
 
 	/* Cap the value to max */
-	min_t(u32, value, WZRD_DR_MAX_INT_DIV_VALUE);
+	value = min_t(u32, value, WZRD_DR_MAX_INT_DIV_VALUE);
+
+	/* Nothing to reconfigure if the divisor is already in place */
+	err = 0;
+	if (((readl(div_addr) >> divider->shift) & div_mask(divider->width)) ==
+	    value)
+		goto err_reconfig;
 
 	/* Set divisor and clear phase offset */
 	writel(value, div_addr);
@@ -223,71 +257,137 @@ static long clk_wzrd_round_rate(struct clk_hw *hw, unsigned long rate,
 	return *prate / div;
 }
 
-static int clk_wzrd_get_divisors(struct clk_hw *hw, unsigned long rate,
-				 unsigned long parent_rate)
+/*
+ * Only the common dividers keeping the VCO in range are tried, the leaf
+ * divider closest to the rate is then computed rather than searched.
+ */
+static int clk_wzrd_get_divisors(unsigned long rate, unsigned long parent_rate,
+				 bool frac, struct clk_wzrd_cfg *cfg)
 {
-	struct clk_wzrd_divider *divider = to_clk_wzrd_divider(hw);
-	unsigned long vco_freq, freq, diff;
-	u32 m, d, o;
-	u64 diff2 = U64_MAX;
+	u32 step = frac ? WZRD_FRAC_STEP : WZRD_FRAC_POINTS;
+	u64 vco_freq, freq, diff, best = U64_MAX;
+	u32 m, d, d_min, d_max, o;
+
+	if (!rate || !parent_rate)
+		return -EINVAL;
 
 	for (m = WZRD_M_MIN; m <= WZRD_M_MAX; m++) {
-		for (d = WZRD_D_MIN; d <= WZRD_D_MAX; d++) {
-			vco_freq = DIV_ROUND_CLOSEST((parent_rate * m), d);
-			if (vco_freq >= WZRD_VCO_MIN && vco_freq <= WZRD_VCO_MAX) {
-				for (o = WZRD_O_MIN; o <= WZRD_O_MAX; o++) {
-					freq = DIV_ROUND_CLOSEST_ULL(vco_freq, o);
-					diff = abs(freq - rate);
-
-					if (diff < WZRD_MIN_ERR) {
-						divider->valuem = m;
-						divider->valued = d;
-						divider->valueo = o;
-						return 0;
-					}
-					if (diff < diff2) {
-						divider->valuem = m;
-						divider->valued = d;
-						divider->valueo = o;
-						diff2 = diff;
-					}
-				}
+		d_min = max_t(u64, WZRD_D_MIN,
+			      div_u64((u64)parent_rate * m, WZRD_VCO_MAX));
+		d_max = min_t(u64, WZRD_D_MAX,
+			      DIV_ROUND_UP_ULL((u64)parent_rate * m,
+					       WZRD_VCO_MIN));
+
+		for (d = d_min; d <= d_max; d++) {
+			vco_freq = DIV_ROUND_CLOSEST_ULL((u64)parent_rate * m,
+							 d);
+			if (vco_freq < WZRD_VCO_MIN || vco_freq > WZRD_VCO_MAX)
+				continue;
+
+			o = DIV_ROUND_CLOSEST_ULL(vco_freq * WZRD_FRAC_POINTS,
+						  (u64)rate * step) * step;
+			/* Fractional division needs a leaf divider above 2 */
+			if (o < WZRD_FRAC_O_MIN * WZRD_FRAC_POINTS)
+				o = roundup(o, WZRD_FRAC_POINTS);
+			o = clamp_t(u32, o, WZRD_O_MIN * WZRD_FRAC_POINTS,
+				    WZRD_O_MAX * WZRD_FRAC_POINTS);
+
+			freq = DIV_ROUND_CLOSEST_ULL(vco_freq * WZRD_FRAC_POINTS,
+						     o);
+			diff = freq > rate ? freq - rate : rate - freq;
+			if (diff >= best)
+				continue;
+
+			cfg->m = m;
+			cfg->d = d;
+			cfg->o = o;
+			best = diff;
+			if (diff < WZRD_MIN_ERR) {
+				cfg->rate = rate;
+				cfg->parent_rate = parent_rate;
+				return 0;
 			}
 		}
 	}
+
 	return -EBUSY;
 }
 
-static int clk_wzrd_dynamic_all_nolock(struct clk_hw *hw, unsigned long rate,
-				       unsigned long parent_rate)
+static int clk_wzrd_find_divisors(struct clk_wzrd_divider *divider,
+				  unsigned long rate,
+				  unsigned long parent_rate,
+				  struct clk_wzrd_cfg *cfg)
 {
-	struct clk_wzrd_divider *divider = to_clk_wzrd_divider(hw);
-	unsigned long vco_freq, rate_div, f, clockout0_div;
-	u32 reg, pre, value;
-	int err;
+	unsigned int i;
 
-	err = clk_wzrd_get_divisors(hw, rate, parent_rate);
-	if (err)
-		return err;
+	for (i = 0; i < divider->nr_cfgs; i++) {
+		if (divider->cfgs[i].rate == rate &&
+		    divider->cfgs[i].parent_rate == parent_rate) {
+			*cfg = divider->cfgs[i];
+			return 0;
+		}
+	}
 
-	vco_freq = DIV_ROUND_CLOSEST((parent_rate * divider->valuem), divider->valued);
-	rate_div = DIV_ROUND_CLOSEST_ULL((vco_freq * WZRD_FRAC_POINTS), rate);
+	return clk_wzrd_get_divisors(rate, parent_rate, divider->frac, cfg);
+}
 
-	clockout0_div = div_u64(rate_div,  WZRD_FRAC_POINTS);
+/* Compute the dividers of the common rates that can be produced */
+static int clk_wzrd_init_cfgs(struct device *dev,
+			      struct clk_wzrd_divider *divider,
+			      unsigned long parent_rate)
+{
+	struct clk_wzrd_cfg cfg;
+	unsigned int i;
 
-	pre = DIV_ROUND_CLOSEST_ULL((vco_freq * WZRD_FRAC_POINTS), rate);
-	f = (u32)(pre - (clockout0_div * WZRD_FRAC_POINTS));
-	f = f & WZRD_CLKOUT_FRAC_MASK;
+	divider->cfgs = devm_kcalloc(dev, ARRAY_SIZE(clk_wzrd_common_rates),
+				     sizeof(*divider->cfgs), GFP_KERNEL);
+	if (!divider->cfgs)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(clk_wzrd_common_rates); i++) {
+		if (clk_wzrd_get_divisors(clk_wzrd_common_rates[i],
+					  parent_rate, divider->frac, &cfg))
+			continue;
+
+		divider->cfgs[divider->nr_cfgs++] = cfg;
+	}
+
+	return 0;
+}
 
-	reg = FIELD_PREP(WZRD_CLKOUT_DIVIDE_MASK, clockout0_div) |
+static int clk_wzrd_dynamic_all_nolock(struct clk_hw *hw,
+				       const struct clk_wzrd_cfg *cfg)
+{
+	struct clk_wzrd_divider *divider = to_clk_wzrd_divider(hw);
+	u32 reg, mul_div, value, f;
+	int err;
+
+	f = cfg->o % WZRD_FRAC_POINTS;
+	reg = FIELD_PREP(WZRD_CLKOUT_DIVIDE_MASK, cfg->o / WZRD_FRAC_POINTS) |
 	      FIELD_PREP(WZRD_CLKOUT0_FRAC_MASK, f);
+	if (f)
+		reg |= WZRD_CLKOUT0_FRAC_EN;
+
+	mul_div = FIELD_PREP(WZRD_CLKFBOUT_MULT_MASK, cfg->m) |
+		  FIELD_PREP(WZRD_DIVCLK_DIVIDE_MASK, cfg->d);
+
+	/*
+	 * Any reconfiguration relocks the MMCM, skip it when the dividers are
+	 * already in place and leave the multiplier alone when only the leaf
+	 * divider changes.
+	 */
+	value = readl(divider->base + WZRD_CLK_CFG_REG(0));
+	if ((value & (WZRD_CLKFBOUT_MULT_MASK | WZRD_CLKFBOUT_FRAC_MASK |
+		      WZRD_CLKFBOUT_FRAC_EN | WZRD_DIVCLK_DIVIDE_MASK)) ==
+	    mul_div) {
+		if (readl(divider->base + WZRD_CLK_CFG_REG(2)) == reg)
+			return 0;
+	} else {
+		writel(mul_div, divider->base + WZRD_CLK_CFG_REG(0));
+	}
 
-	writel(reg, divider->base + WZRD_CLK_CFG_REG(2));
 	/* Set divisor and clear phase offset */
-	reg = FIELD_PREP(WZRD_CLKFBOUT_MULT_MASK, divider->valuem) |
-	      FIELD_PREP(WZRD_DIVCLK_DIVIDE_MASK, divider->valued);
-	writel(reg, divider->base + WZRD_CLK_CFG_REG(0));
-	writel(divider->valueo, divider->base + WZRD_CLK_CFG_REG(2));
+	writel(reg, divider->base + WZRD_CLK_CFG_REG(2));
 	writel(0, divider->base + WZRD_CLK_CFG_REG(3));
 	/* Check status register */
 	err = readl_poll_timeout(divider->base + WZRD_DR_STATUS_REG_OFFSET, value,
@@ -314,15 +414,20 @@ static int clk_wzrd_dynamic_all(struct clk_hw *hw, unsigned long rate,
 				unsigned long parent_rate)
 {
 	struct clk_wzrd_divider *divider = to_clk_wzrd_divider(hw);
+	struct clk_wzrd_cfg cfg;
 	unsigned long flags = 0;
 	int ret;
 
+	ret = clk_wzrd_find_divisors(divider, rate, parent_rate, &cfg);
+	if (ret)
+		return ret;
+
 	if (divider->lock)
 		spin_lock_irqsave(divider->lock, flags);
 	else
 		__acquire(divider->lock);
 
-	ret = clk_wzrd_dynamic_all_nolock(hw, rate, parent_rate);
+	ret = clk_wzrd_dynamic_all_nolock(hw, &cfg);
 
 	if (divider->lock)
 		spin_unlock_irqrestore(divider->lock, flags);
@@ -491,6 +596,7 @@ static struct clk *clk_wzrd_register_divider(struct device *dev,
 					     u32 div_type,
 					     spinlock_t *lock)
 {
+	struct device_node *np = dev->of_node;
 	struct clk_wzrd_divider *div;
 	struct clk_hw *hw;
 	struct clk_init_data init;
@@ -519,11 +625,20 @@ static struct clk *clk_wzrd_register_divider(struct device *dev,
 	div->lock = lock;
 	div->hw.init = &init;
 	div->table = NULL;
+	/* The MMCME5 of the Versal wizard has no fractional leaf divider */
+	div->frac = !of_device_is_compatible(np, "xlnx,clocking-wizard-v6.0");
 
 	hw = &div->hw;
 	ret = devm_clk_hw_register(dev, hw);
 	if (ret)
-		hw = ERR_PTR(ret);
+		return ERR_PTR(ret);
+
+	if (init.ops == &clk_wzrd_clk_div_all_ops) {
+		ret = clk_wzrd_init_cfgs(dev, div,
+					 clk_hw_get_rate(clk_hw_get_parent(hw)));
+		if (ret)
+			return ERR_PTR(ret);
+	}
 
 	return hw->clk;
 }
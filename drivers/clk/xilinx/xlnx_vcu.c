@@ -19,6 +19,8 @@
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include <dt-bindings/clock/xlnx-vcu.h>
 
@@ -47,6 +49,11 @@
 #define FVCO_MIN			(1500U * MHZ)
 #define FVCO_MAX			(3000U * MHZ)
 
+static unsigned int pll_off_delay_ms = 100;
+module_param(pll_off_delay_ms, uint, 0644);
+MODULE_PARM_DESC(pll_off_delay_ms,
+		 "Delay before powering down the unused PLL, in ms (default: 100)");
+
 static struct regmap_config vcu_settings_regmap_config = {
 	.name = "regmap",
 	.reg_bits = 32,
@@ -276,11 +283,32 @@ EXPORT_SYMBOL_GPL(xvcu_get_num_cores);
 
 #define to_vcu_pll(_hw) container_of(_hw, struct vcu_pll, hw)
 
+/**
+ * struct vcu_pll - VCU PLL
+ * @hw: handle of the PLL clock
+ * @reg_base: vcu_slcr register base address
+ * @fvco_min: minimum VCO frequency
+ * @fvco_max: maximum VCO frequency
+ * @cfg: settings programmed in the PLL, NULL until the first rate change
+ * @lock: protects @enabled against the delayed power down
+ * @enabled: true while the PLL clock is enabled
+ * @off_work: powers the PLL down once it stayed unused for
+ *	      pll_off_delay_ms
+ *
+ * The encoder and the decoder are gated independently by their leaf
+ * clocks, the PLL is only powered down when both stayed off for a while
+ * so that switching from encoding to decoding does not wait for it to
+ * lock again.
+ */
 struct vcu_pll {
 	struct clk_hw hw;
 	void __iomem *reg_base;
 	unsigned long fvco_min;
 	unsigned long fvco_max;
+	const struct xvcu_pll_cfg *cfg;
+	spinlock_t lock; /* enable state */
+	bool enabled;
+	struct delayed_work off_work;
 };
 
 static int xvcu_pll_wait_for_lock(struct vcu_pll *pll)
@@ -299,6 +327,44 @@ static int xvcu_pll_wait_for_lock(struct vcu_pll *pll)
 	return -ETIMEDOUT;
 }
 
+/* Out of reset, locked and no longer bypassed since the last enable */
+static bool xvcu_pll_is_running(struct vcu_pll *pll)
+{
+	void __iomem *base = pll->reg_base;
+	u32 vcu_pll_ctrl;
+
+	vcu_pll_ctrl = xvcu_read(base, VCU_PLL_CTRL);
+	if (vcu_pll_ctrl & (VCU_PLL_CTRL_RESET | VCU_PLL_CTRL_POR_IN |
+			    VCU_PLL_CTRL_PWR_POR | VCU_PLL_CTRL_BYPASS))
+		return false;
+
+	return xvcu_read(base, VCU_PLL_STATUS) & VCU_PLL_STATUS_LOCK_STATUS;
+}
+
+static void xvcu_pll_power_off(struct vcu_pll *pll)
+{
+	void __iomem *base = pll->reg_base;
+	u32 vcu_pll_ctrl;
+
+	vcu_pll_ctrl = xvcu_read(base, VCU_PLL_CTRL);
+	vcu_pll_ctrl |= VCU_PLL_CTRL_POR_IN;
+	vcu_pll_ctrl |= VCU_PLL_CTRL_PWR_POR;
+	vcu_pll_ctrl |= VCU_PLL_CTRL_RESET;
+	xvcu_write(base, VCU_PLL_CTRL, vcu_pll_ctrl);
+}
+
+static void xvcu_pll_off_work(struct work_struct *work)
+{
+	struct vcu_pll *pll = container_of(to_delayed_work(work),
+					   struct vcu_pll, off_work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pll->lock, flags);
+	if (!pll->enabled)
+		xvcu_pll_power_off(pll);
+	spin_unlock_irqrestore(&pll->lock, flags);
+}
+
 static struct clk_hw *xvcu_register_pll_post(struct device *dev,
 					     const char *name,
 					     const struct clk_hw *parent_hw,
@@ -337,6 +403,7 @@ static int xvcu_pll_set_div(struct vcu_pll *pll, int div)
 {
 	void __iomem *base = pll->reg_base;
 	const struct xvcu_pll_cfg *cfg = NULL;
+	unsigned long flags;
 	u32 vcu_pll_ctrl;
 	u32 cfg_val;
 
@@ -344,6 +411,18 @@ static int xvcu_pll_set_div(struct vcu_pll *pll, int div)
 	if (!cfg)
 		return -EINVAL;
 
+	/* Keep the PLL locked if its settings are already in place */
+	if (cfg == pll->cfg &&
+	    FIELD_GET(VCU_PLL_CTRL_FBDIV, xvcu_read(base, VCU_PLL_CTRL)) ==
+	    cfg->fbdiv)
+		return 0;
+
+	/* A PLL left running for a fast wake has to relock on the next enable */
+	spin_lock_irqsave(&pll->lock, flags);
+	if (!pll->enabled)
+		xvcu_pll_power_off(pll);
+	spin_unlock_irqrestore(&pll->lock, flags);
+
 	vcu_pll_ctrl = xvcu_read(base, VCU_PLL_CTRL);
 	vcu_pll_ctrl &= ~VCU_PLL_CTRL_FBDIV;
 	vcu_pll_ctrl |= FIELD_PREP(VCU_PLL_CTRL_FBDIV, cfg->fbdiv);
@@ -356,6 +435,8 @@ static int xvcu_pll_set_div(struct vcu_pll *pll, int div)
 		  FIELD_PREP(VCU_PLL_CFG_LOCK_DLY, cfg->lock_dly);
 	xvcu_write(base, VCU_PLL_CFG, cfg_val);
 
+	pll->cfg = cfg;
+
 	return 0;
 }
 
@@ -399,8 +480,16 @@ static int xvcu_pll_enable(struct clk_hw *hw)
 {
 	struct vcu_pll *pll = to_vcu_pll(hw);
 	void __iomem *base = pll->reg_base;
+	unsigned long flags;
 	u32 vcu_pll_ctrl;
-	int ret;
+	int ret = 0;
+
+	spin_lock_irqsave(&pll->lock, flags);
+	pll->enabled = true;
+
+	/* Still running since the last disable, no need to wait for a lock */
+	if (xvcu_pll_is_running(pll))
+		goto err;
 
 	vcu_pll_ctrl = xvcu_read(base, VCU_PLL_CTRL);
 	vcu_pll_ctrl |= VCU_PLL_CTRL_BYPASS;
@@ -423,20 +512,26 @@ static int xvcu_pll_enable(struct clk_hw *hw)
 	xvcu_write(base, VCU_PLL_CTRL, vcu_pll_ctrl);
 
 err:
+	if (ret)
+		pll->enabled = false;
+	spin_unlock_irqrestore(&pll->lock, flags);
 	return ret;
 }
 
 static void xvcu_pll_disable(struct clk_hw *hw)
 {
 	struct vcu_pll *pll = to_vcu_pll(hw);
-	void __iomem *base = pll->reg_base;
-	u32 vcu_pll_ctrl;
-
-	vcu_pll_ctrl = xvcu_read(base, VCU_PLL_CTRL);
-	vcu_pll_ctrl |= VCU_PLL_CTRL_POR_IN;
-	vcu_pll_ctrl |= VCU_PLL_CTRL_PWR_POR;
-	vcu_pll_ctrl |= VCU_PLL_CTRL_RESET;
-	xvcu_write(base, VCU_PLL_CTRL, vcu_pll_ctrl);
+	unsigned int delay = READ_ONCE(pll_off_delay_ms);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pll->lock, flags);
+	pll->enabled = false;
+	if (delay)
+		mod_delayed_work(system_wq, &pll->off_work,
+				 msecs_to_jiffies(delay));
+	else
+		xvcu_pll_power_off(pll);
+	spin_unlock_irqrestore(&pll->lock, flags);
 }
 
 static const struct clk_ops vcu_pll_ops = {
@@ -471,6 +566,10 @@ static struct clk_hw *xvcu_register_pll(struct device *dev,
 	pll->reg_base = reg_base;
 	pll->fvco_min = FVCO_MIN;
 	pll->fvco_max = FVCO_MAX;
+	pll->cfg = NULL;
+	pll->enabled = false;
+	spin_lock_init(&pll->lock);
+	INIT_DELAYED_WORK(&pll->off_work, xvcu_pll_off_work);
 
 	hw = &pll->hw;
 	ret = devm_clk_hw_register(dev, hw);
@@ -630,6 +729,10 @@ static void xvcu_unregister_clock_provider(struct xvcu_device *xvcu)
 	struct clk_hw_onecell_data *data = xvcu->clk_data;
 	struct clk_hw **hws = data->hws;
 
+	/* Power the PLL down while the registers are still clocked */
+	if (!IS_ERR_OR_NULL(xvcu->pll))
+		flush_delayed_work(&to_vcu_pll(xvcu->pll)->off_work);
+
 	if (!IS_ERR_OR_NULL(hws[CLK_XVCU_DEC_MCU]))
 		xvcu_clk_hw_unregister_leaf(hws[CLK_XVCU_DEC_MCU]);
 	if (!IS_ERR_OR_NULL(hws[CLK_XVCU_DEC_CORE]))
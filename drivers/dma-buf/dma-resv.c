@@ -350,6 +350,56 @@ void dma_resv_replace_fences(struct dma_resv *obj, uint64_t context,
 }
 EXPORT_SYMBOL(dma_resv_replace_fences);
 
+/*
+ * Fast path of the unlocked readers for the common case of a single fence.
+ * Peek at the fences under RCU, without the restarts and the reference
+ * counting of the iterator, for the ones used as @usage and not yet flagged
+ * as signaled.
+ *
+ * Returns true when there is at most one such fence, with @fence set to it,
+ * holding a reference, or to NULL. Returns false when the caller has to walk
+ * the fences with the iterator.
+ */
+static bool dma_resv_get_single_unlocked(struct dma_resv *obj,
+					 enum dma_resv_usage usage,
+					 struct dma_fence **fence)
+{
+	struct dma_fence *single = NULL;
+	struct dma_resv_list *list;
+	unsigned int i, num_fences;
+	bool ret = true;
+
+	rcu_read_lock();
+	list = dma_resv_fences_list(obj);
+	num_fences = list ? READ_ONCE(list->num_fences) : 0;
+	for (i = 0; i < num_fences; ++i) {
+		enum dma_resv_usage fence_usage;
+		struct dma_fence *f;
+
+		dma_resv_list_entry(list, i, obj, &f, &fence_usage);
+		if (fence_usage > usage ||
+		    test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &f->flags))
+			continue;
+
+		if (single) {
+			ret = false;
+			goto out;
+		}
+		single = f;
+	}
+
+	/* A fence without references is being replaced, take the slow path */
+	if (single) {
+		single = dma_fence_get_rcu(single);
+		ret = !!single;
+	}
+	*fence = single;
+out:
+	rcu_read_unlock();
+
+	return ret;
+}
+
 /* Restart the unlocked iteration by initializing the cursor object. */
 static void dma_resv_iter_restart_unlocked(struct dma_resv_iter *cursor)
 {
@@ -562,6 +612,20 @@ int dma_resv_get_fences(struct dma_resv *obj, enum dma_resv_usage usage,
 	*num_fences = 0;
 	*fences = NULL;
 
+	if (dma_resv_get_single_unlocked(obj, usage, &fence)) {
+		if (!fence)
+			return 0;
+
+		*fences = kmalloc(sizeof(void *), GFP_KERNEL);
+		if (!*fences) {
+			dma_fence_put(fence);
+			return -ENOMEM;
+		}
+
+		(*fences)[(*num_fences)++] = fence;
+		return 0;
+	}
+
 	dma_resv_iter_begin(&cursor, obj, usage);
 	dma_resv_for_each_fence_unlocked(&cursor, fence) {
 
@@ -614,6 +678,10 @@ int dma_resv_get_singleton(struct dma_resv *obj, enum dma_resv_usage usage,
 	unsigned count;
 	int r;
 
+	/* No array to allocate and free for a single fence */
+	if (dma_resv_get_single_unlocked(obj, usage, fence))
+		return 0;
+
 	r = dma_resv_get_fences(obj, usage, &count, &fences);
         if (r)
 		return r;
@@ -664,6 +732,14 @@ long dma_resv_wait_timeout(struct dma_resv *obj, enum dma_resv_usage usage,
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
 
+	if (dma_resv_get_single_unlocked(obj, usage, &fence)) {
+		if (fence) {
+			ret = dma_fence_wait_timeout(fence, intr, ret);
+			dma_fence_put(fence);
+		}
+		return ret;
+	}
+
 	dma_resv_iter_begin(&cursor, obj, usage);
 	dma_resv_for_each_fence_unlocked(&cursor, fence) {
 
@@ -697,6 +773,16 @@ bool dma_resv_test_signaled(struct dma_resv *obj, enum dma_resv_usage usage)
 {
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
+	bool signaled;
+
+	if (dma_resv_get_single_unlocked(obj, usage, &fence)) {
+		if (!fence)
+			return true;
+
+		signaled = dma_fence_is_signaled(fence);
+		dma_fence_put(fence);
+		return signaled;
+	}
 
 	dma_resv_iter_begin(&cursor, obj, usage);
 	dma_resv_for_each_fence_unlocked(&cursor, fence) {
@@ -5,6 +5,7 @@
 * Copyright © 2021 Advanced Micro Devices, Inc.
 */
 
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/dma-resv.h>
@@ -293,8 +294,104 @@ static int test_get_fences(void *arg)
 	return r;
 }
 
+#define BENCH_LOOPS	100000
+
+/* Time the unlocked readers of a reservation object holding @num_fences */
+static int bench_readers(unsigned int num_fences)
+{
+	struct dma_fence *fences[2], *f;
+	unsigned int i, n = 0;
+	struct dma_resv resv;
+	s64 test_ns, wait_ns, get_ns;
+	ktime_t start;
+	int r;
+
+	dma_resv_init(&resv);
+	for (n = 0; n < num_fences; ++n) {
+		fences[n] = kmalloc(sizeof(*fences[n]), GFP_KERNEL);
+		if (!fences[n]) {
+			r = -ENOMEM;
+			goto err_put;
+		}
+
+		/* Distinct contexts, the fences must not replace each other */
+		dma_fence_init(fences[n], &fence_ops, &fence_lock,
+			       dma_fence_context_alloc(1), 1);
+		dma_fence_enable_sw_signaling(fences[n]);
+	}
+
+	r = dma_resv_lock(&resv, NULL);
+	if (r) {
+		pr_err("Resv locking failed\n");
+		goto err_put;
+	}
+
+	r = dma_resv_reserve_fences(&resv, num_fences);
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		dma_resv_unlock(&resv);
+		goto err_put;
+	}
+
+	for (i = 0; i < num_fences; ++i)
+		dma_resv_add_fence(&resv, fences[i], DMA_RESV_USAGE_READ);
+	dma_resv_unlock(&resv);
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; ++i) {
+		if (dma_resv_test_signaled(&resv, DMA_RESV_USAGE_READ)) {
+			pr_err("Resv unexpectedly signaled\n");
+			r = -EINVAL;
+			goto err_put;
+		}
+	}
+	test_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; ++i)
+		dma_resv_wait_timeout(&resv, DMA_RESV_USAGE_READ, false, 0);
+	wait_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; ++i) {
+		r = dma_resv_get_singleton(&resv, DMA_RESV_USAGE_READ, &f);
+		if (r) {
+			pr_err("get_singleton failed\n");
+			goto err_put;
+		}
+		dma_fence_put(f);
+	}
+	get_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("%u fence(s): test_signaled %lld ns, wait_timeout %lld ns, get_singleton %lld ns\n",
+		num_fences, div_s64(test_ns, BENCH_LOOPS),
+		div_s64(wait_ns, BENCH_LOOPS), div_s64(get_ns, BENCH_LOOPS));
+
+err_put:
+	dma_resv_fini(&resv);
+	while (n--) {
+		dma_fence_signal(fences[n]);
+		dma_fence_put(fences[n]);
+	}
+	return r;
+}
+
+static int bench_single_fence(void *arg)
+{
+	return bench_readers(1);
+}
+
+static int bench_two_fences(void *arg)
+{
+	return bench_readers(2);
+}
+
 int dma_resv(void)
 {
+	static const struct subtest benchmarks[] = {
+		SUBTEST(bench_single_fence),
+		SUBTEST(bench_two_fences),
+	};
 	static const struct subtest tests[] = {
 		SUBTEST(sanitycheck),
 		SUBTEST(test_signaling),
@@ -312,5 +409,5 @@ int dma_resv(void)
 		if (r)
 			return r;
 	}
-	return 0;
+	return subtests(benchmarks, NULL);
 }
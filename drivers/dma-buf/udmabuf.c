@@ -67,6 +67,7 @@ static struct sg_table *get_sg_table(struct device *dev, struct dma_buf *buf,
 	sg = kzalloc(sizeof(*sg), GFP_KERNEL);
 	if (!sg)
 		return ERR_PTR(-ENOMEM);
+	/* The pages of a huge page or folio end up in a single entry */
 	ret = sg_alloc_table_from_pages(sg, ubuf->pages, ubuf->pagecount,
 					0, ubuf->pagecount << PAGE_SHIFT,
 					GFP_KERNEL);
@@ -115,7 +116,7 @@ static void release_udmabuf(struct dma_buf *buf)
 
 	for (pg = 0; pg < ubuf->pagecount; pg++)
 		put_page(ubuf->pages[pg]);
-	kfree(ubuf->pages);
+	kvfree(ubuf->pages);
 	kfree(ubuf);
 }
 
@@ -177,7 +178,8 @@ static long udmabuf_create(struct miscdevice *device,
 	struct dma_buf *buf;
 	pgoff_t pgoff, pgcnt, pgidx, pgbuf = 0, pglimit;
 	struct page *page, *hpage = NULL;
-	pgoff_t subpgoff, maxsubpgs;
+	pgoff_t subpgoff, maxsubpgs, nr;
+	struct folio *folio;
 	struct hstate *hpstate;
 	int seals, ret = -EINVAL;
 	u32 i, flags;
@@ -200,8 +202,8 @@ static long udmabuf_create(struct miscdevice *device,
 	if (!ubuf->pagecount)
 		goto err;
 
-	ubuf->pages = kmalloc_array(ubuf->pagecount, sizeof(*ubuf->pages),
-				    GFP_KERNEL);
+	ubuf->pages = kvmalloc_array(ubuf->pagecount, sizeof(*ubuf->pages),
+				     GFP_KERNEL);
 	if (!ubuf->pages) {
 		ret = -ENOMEM;
 		goto err;
@@ -258,6 +260,21 @@ static long udmabuf_create(struct miscdevice *device,
 					ret = PTR_ERR(page);
 					goto err;
 				}
+
+				/*
+				 * Take the following pages of a transparent
+				 * huge page without looking each one up.
+				 */
+				folio = page_folio(page);
+				nr = folio_nr_pages(folio) -
+				     folio_page_idx(folio, page);
+				nr = min(nr, pgcnt - pgidx);
+				while (--nr) {
+					folio_get(folio);
+					ubuf->pages[pgbuf++] = page;
+					page = nth_page(page, 1);
+					pgidx++;
+				}
 			}
 			ubuf->pages[pgbuf++] = page;
 		}
@@ -289,9 +306,11 @@ static long udmabuf_create(struct miscdevice *device,
 err:
 	while (pgbuf > 0)
 		put_page(ubuf->pages[--pgbuf]);
+	if (hpage)
+		put_page(hpage);
 	if (memfd)
 		fput(memfd);
-	kfree(ubuf->pages);
+	kvfree(ubuf->pages);
 	kfree(ubuf);
 	return ret;
 }
@@ -34,7 +34,6 @@
  */
 
 #include <linux/bitops.h>
-#include <linux/dmapool.h>
 #include <linux/dma/xilinx_dma.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
@@ -45,12 +44,16 @@
 #include <linux/of_dma.h>
 #include <linux/of_platform.h>
 #include <linux/of_irq.h>
+#include <linux/sched/cpufreq.h>
 #include <linux/slab.h>
 #include <linux/clk.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
 
 #include "../dmaengine.h"
 
+#define CREATE_TRACE_POINTS
+#include "xilinx_dma_trace.h"
+
 /* Register/Descriptor Offsets */
 #define XILINX_DMA_MM2S_CTRL_OFFSET		0x0000
 #define XILINX_DMA_S2MM_CTRL_OFFSET		0x0030
@@ -179,8 +182,13 @@
 #define XILINX_DMA_BD_EOP		BIT(26)
 #define XILINX_DMA_COALESCE_MAX		255
 #define XILINX_DMA_NUM_DESCS		255
+#define XILINX_DMA_MIN_DESCS		2
 #define XILINX_DMA_NUM_APP_WORDS	5
 
+/* Completions in one tasklet run hinting a burst to cpufreq, and its hint */
+#define XILINX_DMA_HINT_BATCH		8
+#define XILINX_DMA_HINT_US		1000
+
 /* AXI CDMA Specific Registers/Offsets */
 #define XILINX_CDMA_REG_SRCADDR		0x18
 #define XILINX_CDMA_REG_DSTADDR		0x20
@@ -215,6 +223,11 @@
 #define XILINX_MCDMA_BD_EOP			BIT(30)
 #define XILINX_MCDMA_BD_SOP			BIT(31)
 
+static unsigned int num_descs = XILINX_DMA_NUM_DESCS;
+module_param(num_descs, uint, 0444);
+MODULE_PARM_DESC(num_descs,
+		 "Number of pre-allocated segments per channel, overridden by xlnx,num-descs (default: 255)");
+
 /**
  * struct xilinx_vdma_desc_hw - Hardware Descriptor
  * @next_desc: Next Descriptor Pointer @0x00
@@ -372,6 +385,19 @@ struct xilinx_dma_tx_descriptor {
 	u32 residue;
 };
 
+/**
+ * enum xilinx_dma_compl_mode - How descriptor completions are processed
+ * @XILINX_DMA_COMPL_TASKLET: Callbacks run from the channel tasklet
+ * @XILINX_DMA_COMPL_THREADED: Callbacks run from a threaded IRQ handler
+ * @XILINX_DMA_COMPL_POLL: Completion interrupts are disabled, completions
+ *			   are reaped from device_tx_status()
+ */
+enum xilinx_dma_compl_mode {
+	XILINX_DMA_COMPL_TASKLET,
+	XILINX_DMA_COMPL_THREADED,
+	XILINX_DMA_COMPL_POLL,
+};
+
 /**
  * struct xilinx_dma_chan - Driver specific DMA channel structure
  * @xdev: Driver specific device structure
@@ -383,7 +409,6 @@ struct xilinx_dma_tx_descriptor {
  * @done_list: Complete descriptors
  * @free_seg_list: Free descriptors
  * @common: DMA common channel
- * @desc_pool: Descriptors pool
  * @dev: The dma device
  * @irq: Channel IRQ
  * @id: Channel ID
@@ -403,6 +428,8 @@ struct xilinx_dma_tx_descriptor {
  * @desc_submitcount: Descriptor h/w submitted count
  * @seg_v: Statically allocated segments base
  * @seg_mv: Statically allocated segments base for MCDMA
+ * @seg_cv: Statically allocated segments base for CDMA
+ * @seg_vv: Statically allocated segments base for VDMA
  * @seg_p: Physical allocated segments base
  * @cyclic_seg_v: Statically allocated segment base for cyclic transfers
  * @cyclic_seg_p: Physical allocated segments base for cyclic dma
@@ -410,6 +437,8 @@ struct xilinx_dma_tx_descriptor {
  * @stop_transfer: Differentiate b/w DMA IP's quiesce
  * @tdest: TDEST value for mcdma
  * @has_vflip: S2MM vertical flip
+ * @compl_mode: Completion processing mode
+ * @irq_cpu: CPU the threaded completion IRQ is pinned to, -1 if not pinned
  */
 struct xilinx_dma_chan {
 	struct xilinx_dma_device *xdev;
@@ -421,7 +450,6 @@ struct xilinx_dma_chan {
 	struct list_head done_list;
 	struct list_head free_seg_list;
 	struct dma_chan common;
-	struct dma_pool *desc_pool;
 	struct device *dev;
 	int irq;
 	int id;
@@ -441,6 +469,8 @@ struct xilinx_dma_chan {
 	u32 desc_submitcount;
 	struct xilinx_axidma_tx_segment *seg_v;
 	struct xilinx_aximcdma_tx_segment *seg_mv;
+	struct xilinx_cdma_tx_segment *seg_cv;
+	struct xilinx_vdma_tx_segment *seg_vv;
 	dma_addr_t seg_p;
 	struct xilinx_axidma_tx_segment *cyclic_seg_v;
 	dma_addr_t cyclic_seg_p;
@@ -448,6 +478,8 @@ struct xilinx_dma_chan {
 	int (*stop_transfer)(struct xilinx_dma_chan *chan);
 	u16 tdest;
 	bool has_vflip;
+	enum xilinx_dma_compl_mode compl_mode;
+	int irq_cpu;
 };
 
 /**
@@ -493,6 +525,7 @@ struct xilinx_dma_config {
  * @s2mm_chan_id: DMA s2mm channel identifier
  * @mm2s_chan_id: DMA mm2s channel identifier
  * @max_buffer_len: Max buffer length
+ * @num_descs: Number of pre-allocated segments per channel
  */
 struct xilinx_dma_device {
 	void __iomem *regs;
@@ -511,6 +544,7 @@ struct xilinx_dma_device {
 	u32 s2mm_chan_id;
 	u32 mm2s_chan_id;
 	u32 max_buffer_len;
+	u32 num_descs;
 };
 
 /* Macros */
@@ -556,6 +590,21 @@ static inline void dma_ctrl_clr(struct xilinx_dma_chan *chan, u32 reg,
 	dma_ctrl_write(chan, reg, dma_ctrl_read(chan, reg) & ~clr);
 }
 
+/**
+ * xilinx_dma_irq_mask - Interrupts used by a channel
+ * @chan: Driver specific DMA channel
+ *
+ * Return: The DMACR/DMASR interrupt bits handled by the IRQ handler.
+ */
+static inline u32 xilinx_dma_irq_mask(struct xilinx_dma_chan *chan)
+{
+	/* Completions are reaped from device_tx_status() in poll mode */
+	if (chan->compl_mode == XILINX_DMA_COMPL_POLL)
+		return XILINX_DMA_DMASR_ERR_IRQ;
+
+	return XILINX_DMA_DMAXR_ALL_IRQ_MASK;
+}
+
 static inline void dma_ctrl_set(struct xilinx_dma_chan *chan, u32 reg,
 				 u32 set)
 {
@@ -636,14 +685,17 @@ static inline void xilinx_aximcdma_buf(struct xilinx_dma_chan *chan,
 static struct xilinx_vdma_tx_segment *
 xilinx_vdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_vdma_tx_segment *segment;
-	dma_addr_t phys;
-
-	segment = dma_pool_zalloc(chan->desc_pool, GFP_ATOMIC, &phys);
-	if (!segment)
-		return NULL;
+	struct xilinx_vdma_tx_segment *segment = NULL;
+	unsigned long flags;
 
-	segment->phys = phys;
+	spin_lock_irqsave(&chan->lock, flags);
+	if (!list_empty(&chan->free_seg_list)) {
+		segment = list_first_entry(&chan->free_seg_list,
+					   struct xilinx_vdma_tx_segment,
+					   node);
+		list_del(&segment->node);
+	}
+	spin_unlock_irqrestore(&chan->lock, flags);
 
 	return segment;
 }
@@ -657,14 +709,17 @@ xilinx_vdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 static struct xilinx_cdma_tx_segment *
 xilinx_cdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_cdma_tx_segment *segment;
-	dma_addr_t phys;
-
-	segment = dma_pool_zalloc(chan->desc_pool, GFP_ATOMIC, &phys);
-	if (!segment)
-		return NULL;
+	struct xilinx_cdma_tx_segment *segment = NULL;
+	unsigned long flags;
 
-	segment->phys = phys;
+	spin_lock_irqsave(&chan->lock, flags);
+	if (!list_empty(&chan->free_seg_list)) {
+		segment = list_first_entry(&chan->free_seg_list,
+					   struct xilinx_cdma_tx_segment,
+					   node);
+		list_del(&segment->node);
+	}
+	spin_unlock_irqrestore(&chan->lock, flags);
 
 	return segment;
 }
@@ -777,7 +832,9 @@ static void xilinx_mcdma_free_tx_segment(struct xilinx_dma_chan *chan,
 static void xilinx_cdma_free_tx_segment(struct xilinx_dma_chan *chan,
 				struct xilinx_cdma_tx_segment *segment)
 {
-	dma_pool_free(chan->desc_pool, segment, segment->phys);
+	memset(&segment->hw, 0, sizeof(segment->hw));
+
+	list_add_tail(&segment->node, &chan->free_seg_list);
 }
 
 /**
@@ -788,7 +845,9 @@ static void xilinx_cdma_free_tx_segment(struct xilinx_dma_chan *chan,
 static void xilinx_vdma_free_tx_segment(struct xilinx_dma_chan *chan,
 					struct xilinx_vdma_tx_segment *segment)
 {
-	dma_pool_free(chan->desc_pool, segment, segment->phys);
+	memset(&segment->hw, 0, sizeof(segment->hw));
+
+	list_add_tail(&segment->node, &chan->free_seg_list);
 }
 
 /**
@@ -856,6 +915,71 @@ xilinx_dma_free_tx_descriptor(struct xilinx_dma_chan *chan,
 	kfree(desc);
 }
 
+/**
+ * xilinx_dma_discard_tx_descriptor - Free a descriptor that was never queued
+ * @chan: Driver specific DMA channel
+ * @desc: DMA transaction descriptor
+ *
+ * Same as xilinx_dma_free_tx_descriptor() for callers that do not hold the
+ * channel lock, which protects the free segment list.
+ */
+static void
+xilinx_dma_discard_tx_descriptor(struct xilinx_dma_chan *chan,
+				 struct xilinx_dma_tx_descriptor *desc)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	xilinx_dma_free_tx_descriptor(chan, desc);
+	spin_unlock_irqrestore(&chan->lock, flags);
+}
+
+/**
+ * xilinx_dma_desc_free - Free a reusable descriptor
+ * @tx: Async transaction descriptor
+ *
+ * Called through dmaengine_desc_free() once the client is done with a
+ * descriptor marked DMA_CTRL_REUSE.
+ *
+ * Return: Always '0'
+ */
+static int xilinx_dma_desc_free(struct dma_async_tx_descriptor *tx)
+{
+	xilinx_dma_discard_tx_descriptor(to_xilinx_chan(tx->chan),
+					 to_dma_tx_descriptor(tx));
+
+	return 0;
+}
+
+/**
+ * xilinx_dma_desc_reset - Prepare a reusable descriptor for resubmission
+ * @chan: Driver specific DMA channel
+ * @desc: DMA transaction descriptor
+ *
+ * The BD chain built at prep time is kept as is, only the status words
+ * written back by the hardware are cleared so the BDs are owned by the
+ * DMA engine again.
+ */
+static void xilinx_dma_desc_reset(struct xilinx_dma_chan *chan,
+				  struct xilinx_dma_tx_descriptor *desc)
+{
+	struct xilinx_axidma_tx_segment *axidma_segment;
+	struct xilinx_aximcdma_tx_segment *aximcdma_segment;
+
+	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
+		list_for_each_entry(axidma_segment, &desc->segments, node)
+			axidma_segment->hw.status = 0;
+	} else if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIMCDMA) {
+		list_for_each_entry(aximcdma_segment, &desc->segments, node) {
+			aximcdma_segment->hw.status = 0;
+			aximcdma_segment->hw.sideband_status = 0;
+		}
+	}
+
+	desc->err = false;
+	desc->residue = 0;
+}
+
 /* Required functions */
 
 /**
@@ -870,7 +994,9 @@ static void xilinx_dma_free_desc_list(struct xilinx_dma_chan *chan,
 
 	list_for_each_entry_safe(desc, next, list, node) {
 		list_del(&desc->node);
-		xilinx_dma_free_tx_descriptor(chan, desc);
+		/* Reusable descriptors are freed by dmaengine_desc_free() */
+		if (!dmaengine_desc_test_reuse(&desc->async_tx))
+			xilinx_dma_free_tx_descriptor(chan, desc);
 	}
 }
 
@@ -898,44 +1024,39 @@ static void xilinx_dma_free_descriptors(struct xilinx_dma_chan *chan)
 static void xilinx_dma_free_chan_resources(struct dma_chan *dchan)
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
+	u32 num_descs = chan->xdev->num_descs;
 	unsigned long flags;
 
 	dev_dbg(chan->dev, "Free all channel resources.\n");
 
 	xilinx_dma_free_descriptors(chan);
 
-	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
-		spin_lock_irqsave(&chan->lock, flags);
-		INIT_LIST_HEAD(&chan->free_seg_list);
-		spin_unlock_irqrestore(&chan->lock, flags);
+	spin_lock_irqsave(&chan->lock, flags);
+	INIT_LIST_HEAD(&chan->free_seg_list);
+	spin_unlock_irqrestore(&chan->lock, flags);
 
-		/* Free memory that is allocated for BD */
-		dma_free_coherent(chan->dev, sizeof(*chan->seg_v) *
-				  XILINX_DMA_NUM_DESCS, chan->seg_v,
-				  chan->seg_p);
+	/* Free memory that is allocated for BD */
+	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
+		dma_free_coherent(chan->dev, sizeof(*chan->seg_v) * num_descs,
+				  chan->seg_v, chan->seg_p);
+		chan->seg_v = NULL;
 
 		/* Free Memory that is allocated for cyclic DMA Mode */
 		dma_free_coherent(chan->dev, sizeof(*chan->cyclic_seg_v),
 				  chan->cyclic_seg_v, chan->cyclic_seg_p);
+	} else if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIMCDMA) {
+		dma_free_coherent(chan->dev, sizeof(*chan->seg_mv) * num_descs,
+				  chan->seg_mv, chan->seg_p);
+		chan->seg_mv = NULL;
+	} else if (chan->xdev->dma_config->dmatype == XDMA_TYPE_CDMA) {
+		dma_free_coherent(chan->dev, sizeof(*chan->seg_cv) * num_descs,
+				  chan->seg_cv, chan->seg_p);
+		chan->seg_cv = NULL;
+	} else {
+		dma_free_coherent(chan->dev, sizeof(*chan->seg_vv) * num_descs,
+				  chan->seg_vv, chan->seg_p);
+		chan->seg_vv = NULL;
 	}
-
-	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIMCDMA) {
-		spin_lock_irqsave(&chan->lock, flags);
-		INIT_LIST_HEAD(&chan->free_seg_list);
-		spin_unlock_irqrestore(&chan->lock, flags);
-
-		/* Free memory that is allocated for BD */
-		dma_free_coherent(chan->dev, sizeof(*chan->seg_mv) *
-				  XILINX_DMA_NUM_DESCS, chan->seg_mv,
-				  chan->seg_p);
-	}
-
-	if (chan->xdev->dma_config->dmatype != XDMA_TYPE_AXIDMA &&
-	    chan->xdev->dma_config->dmatype != XDMA_TYPE_AXIMCDMA) {
-		dma_pool_destroy(chan->desc_pool);
-		chan->desc_pool = NULL;
-	}
-
 }
 
 /**
@@ -988,6 +1109,89 @@ static u32 xilinx_dma_get_residue(struct xilinx_dma_chan *chan,
 	return residue;
 }
 
+/**
+ * xilinx_dma_desc_len - Compute the length of a given descriptor
+ * @chan: Driver specific dma channel
+ * @desc: dma transaction descriptor
+ *
+ * Return: The number of bytes to transfer for the descriptor.
+ */
+static u32 xilinx_dma_desc_len(struct xilinx_dma_chan *chan,
+			       struct xilinx_dma_tx_descriptor *desc)
+{
+	struct xilinx_vdma_tx_segment *vdma_seg;
+	struct xilinx_cdma_tx_segment *cdma_seg;
+	struct xilinx_axidma_tx_segment *axidma_seg;
+	struct xilinx_aximcdma_tx_segment *aximcdma_seg;
+	u32 max_len = chan->xdev->max_buffer_len;
+	struct list_head *entry;
+	u32 len = 0;
+
+	list_for_each(entry, &desc->segments) {
+		switch (chan->xdev->dma_config->dmatype) {
+		case XDMA_TYPE_VDMA:
+			vdma_seg = list_entry(entry,
+					      struct xilinx_vdma_tx_segment,
+					      node);
+			len += vdma_seg->hw.hsize * vdma_seg->hw.vsize;
+			break;
+		case XDMA_TYPE_CDMA:
+			cdma_seg = list_entry(entry,
+					      struct xilinx_cdma_tx_segment,
+					      node);
+			len += cdma_seg->hw.control & max_len;
+			break;
+		case XDMA_TYPE_AXIDMA:
+			axidma_seg = list_entry(entry,
+						struct xilinx_axidma_tx_segment,
+						node);
+			len += axidma_seg->hw.control & max_len;
+			break;
+		default:
+			aximcdma_seg =
+				list_entry(entry,
+					   struct xilinx_aximcdma_tx_segment,
+					   node);
+			len += aximcdma_seg->hw.control & max_len;
+			break;
+		}
+	}
+
+	return len;
+}
+
+/**
+ * xilinx_dma_trace_callback - Trace the callback of a completed descriptor
+ * @chan: Driver specific dma channel
+ * @desc: completed dma transaction descriptor
+ */
+static void xilinx_dma_trace_callback(struct xilinx_dma_chan *chan,
+				      struct xilinx_dma_tx_descriptor *desc)
+{
+	if (trace_xilinx_dma_callback_enabled())
+		trace_xilinx_dma_callback(&chan->common, desc->async_tx.cookie,
+					  xilinx_dma_desc_len(chan, desc) -
+					  desc->residue);
+}
+
+/**
+ * xilinx_dma_trace_start - Trace the descriptors handed to the hardware
+ * @chan: Driver specific dma channel
+ *
+ * To be called before the pending descriptors are moved to the active list.
+ */
+static void xilinx_dma_trace_start(struct xilinx_dma_chan *chan)
+{
+	struct xilinx_dma_tx_descriptor *desc;
+
+	if (!trace_xilinx_dma_start_enabled())
+		return;
+
+	list_for_each_entry(desc, &chan->pending_list, node)
+		trace_xilinx_dma_start(&chan->common, desc->async_tx.cookie,
+				       xilinx_dma_desc_len(chan, desc));
+}
+
 /**
  * xilinx_dma_chan_handle_cyclic - Cyclic dma callback
  * @chan: Driver specific dma channel
@@ -1002,6 +1206,7 @@ static void xilinx_dma_chan_handle_cyclic(struct xilinx_dma_chan *chan,
 
 	dmaengine_desc_get_callback(&desc->async_tx, &cb);
 	if (dmaengine_desc_callback_valid(&cb)) {
+		xilinx_dma_trace_callback(chan, desc);
 		spin_unlock_irqrestore(&chan->lock, *flags);
 		dmaengine_desc_callback_invoke(&cb, NULL);
 		spin_lock_irqsave(&chan->lock, *flags);
@@ -1011,10 +1216,13 @@ static void xilinx_dma_chan_handle_cyclic(struct xilinx_dma_chan *chan,
 /**
  * xilinx_dma_chan_desc_cleanup - Clean channel descriptors
  * @chan: Driver specific DMA channel
+ *
+ * Return: the number of descriptors completed
  */
-static void xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
+static unsigned int xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
 {
 	struct xilinx_dma_tx_descriptor *desc, *next;
+	unsigned int completed = 0;
 	unsigned long flags;
 
 	spin_lock_irqsave(&chan->lock, flags);
@@ -1029,6 +1237,7 @@ static void xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
 
 		/* Remove from the list of running transactions */
 		list_del(&desc->node);
+		completed++;
 
 		if (unlikely(desc->err)) {
 			if (chan->direction == DMA_DEV_TO_MEM)
@@ -1041,14 +1250,20 @@ static void xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
 
 		result.residue = desc->residue;
 
+		xilinx_dma_trace_callback(chan, desc);
+
 		/* Run the link descriptor callback function */
 		spin_unlock_irqrestore(&chan->lock, flags);
 		dmaengine_desc_get_callback_invoke(&desc->async_tx, &result);
 		spin_lock_irqsave(&chan->lock, flags);
 
-		/* Run any dependencies, then free the descriptor */
+		/*
+		 * Run any dependencies, then free the descriptor unless the
+		 * client wants to submit it again.
+		 */
 		dma_run_dependencies(&desc->async_tx);
-		xilinx_dma_free_tx_descriptor(chan, desc);
+		if (!dmaengine_desc_test_reuse(&desc->async_tx))
+			xilinx_dma_free_tx_descriptor(chan, desc);
 
 		/*
 		 * While we ran a callback the user called a terminate function,
@@ -1059,6 +1274,8 @@ static void xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
 	}
 
 	spin_unlock_irqrestore(&chan->lock, flags);
+
+	return completed;
 }
 
 /**
@@ -1069,7 +1286,12 @@ static void xilinx_dma_do_tasklet(struct tasklet_struct *t)
 {
 	struct xilinx_dma_chan *chan = from_tasklet(chan, t, tasklet);
 
-	xilinx_dma_chan_desc_cleanup(chan);
+	/*
+	 * A batch of completions is likely to be followed by more, let the
+	 * CPU ramp up without waiting for PELT.
+	 */
+	if (xilinx_dma_chan_desc_cleanup(chan) >= XILINX_DMA_HINT_BATCH)
+		cpufreq_util_hint(SCHED_CAPACITY_SCALE, XILINX_DMA_HINT_US);
 }
 
 /**
@@ -1081,20 +1303,24 @@ static void xilinx_dma_do_tasklet(struct tasklet_struct *t)
 static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
+	u32 num_descs = chan->xdev->num_descs;
 	int i;
 
 	/* Has this channel already been allocated? */
-	if (chan->desc_pool)
+	if (chan->seg_v || chan->seg_mv || chan->seg_cv || chan->seg_vv)
 		return 0;
 
 	/*
-	 * We need the descriptor to be aligned to 64bytes
-	 * for meeting Xilinx VDMA specification requirement.
+	 * All segments of a channel are allocated up front and recycled
+	 * through free_seg_list so that the prep callbacks never have to
+	 * allocate DMA memory. The arrays are page aligned and the segment
+	 * structures are padded as required by the hardware, which meets
+	 * the 64 byte descriptor alignment of the Xilinx DMA IPs.
 	 */
 	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
 		/* Allocate the buffer descriptors. */
 		chan->seg_v = dma_alloc_coherent(chan->dev,
-						 sizeof(*chan->seg_v) * XILINX_DMA_NUM_DESCS,
+						 sizeof(*chan->seg_v) * num_descs,
 						 &chan->seg_p, GFP_KERNEL);
 		if (!chan->seg_v) {
 			dev_err(chan->dev,
@@ -1116,19 +1342,19 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 			dev_err(chan->dev,
 				"unable to allocate desc segment for cyclic DMA\n");
 			dma_free_coherent(chan->dev, sizeof(*chan->seg_v) *
-				XILINX_DMA_NUM_DESCS, chan->seg_v,
-				chan->seg_p);
+				num_descs, chan->seg_v, chan->seg_p);
+			chan->seg_v = NULL;
 			return -ENOMEM;
 		}
 		chan->cyclic_seg_v->phys = chan->cyclic_seg_p;
 
-		for (i = 0; i < XILINX_DMA_NUM_DESCS; i++) {
+		for (i = 0; i < num_descs; i++) {
 			chan->seg_v[i].hw.next_desc =
 			lower_32_bits(chan->seg_p + sizeof(*chan->seg_v) *
-				((i + 1) % XILINX_DMA_NUM_DESCS));
+				((i + 1) % num_descs));
 			chan->seg_v[i].hw.next_desc_msb =
 			upper_32_bits(chan->seg_p + sizeof(*chan->seg_v) *
-				((i + 1) % XILINX_DMA_NUM_DESCS));
+				((i + 1) % num_descs));
 			chan->seg_v[i].phys = chan->seg_p +
 				sizeof(*chan->seg_v) * i;
 			list_add_tail(&chan->seg_v[i].node,
@@ -1138,7 +1364,7 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 		/* Allocate the buffer descriptors. */
 		chan->seg_mv = dma_alloc_coherent(chan->dev,
 						  sizeof(*chan->seg_mv) *
-						  XILINX_DMA_NUM_DESCS,
+						  num_descs,
 						  &chan->seg_p, GFP_KERNEL);
 		if (!chan->seg_mv) {
 			dev_err(chan->dev,
@@ -1146,39 +1372,53 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 				chan->id);
 			return -ENOMEM;
 		}
-		for (i = 0; i < XILINX_DMA_NUM_DESCS; i++) {
+		for (i = 0; i < num_descs; i++) {
 			chan->seg_mv[i].hw.next_desc =
 			lower_32_bits(chan->seg_p + sizeof(*chan->seg_mv) *
-				((i + 1) % XILINX_DMA_NUM_DESCS));
+				((i + 1) % num_descs));
 			chan->seg_mv[i].hw.next_desc_msb =
 			upper_32_bits(chan->seg_p + sizeof(*chan->seg_mv) *
-				((i + 1) % XILINX_DMA_NUM_DESCS));
+				((i + 1) % num_descs));
 			chan->seg_mv[i].phys = chan->seg_p +
 				sizeof(*chan->seg_mv) * i;
 			list_add_tail(&chan->seg_mv[i].node,
 				      &chan->free_seg_list);
 		}
 	} else if (chan->xdev->dma_config->dmatype == XDMA_TYPE_CDMA) {
-		chan->desc_pool = dma_pool_create("xilinx_cdma_desc_pool",
-				   chan->dev,
-				   sizeof(struct xilinx_cdma_tx_segment),
-				   __alignof__(struct xilinx_cdma_tx_segment),
-				   0);
+		/* CDMA and VDMA link their segments at prep time. */
+		chan->seg_cv = dma_alloc_coherent(chan->dev,
+						  sizeof(*chan->seg_cv) *
+						  num_descs,
+						  &chan->seg_p, GFP_KERNEL);
+		if (!chan->seg_cv) {
+			dev_err(chan->dev,
+				"unable to allocate channel %d descriptors\n",
+				chan->id);
+			return -ENOMEM;
+		}
+		for (i = 0; i < num_descs; i++) {
+			chan->seg_cv[i].phys = chan->seg_p +
+				sizeof(*chan->seg_cv) * i;
+			list_add_tail(&chan->seg_cv[i].node,
+				      &chan->free_seg_list);
+		}
 	} else {
-		chan->desc_pool = dma_pool_create("xilinx_vdma_desc_pool",
-				     chan->dev,
-				     sizeof(struct xilinx_vdma_tx_segment),
-				     __alignof__(struct xilinx_vdma_tx_segment),
-				     0);
-	}
-
-	if (!chan->desc_pool &&
-	    ((chan->xdev->dma_config->dmatype != XDMA_TYPE_AXIDMA) &&
-		chan->xdev->dma_config->dmatype != XDMA_TYPE_AXIMCDMA)) {
-		dev_err(chan->dev,
-			"unable to allocate channel %d descriptor pool\n",
-			chan->id);
-		return -ENOMEM;
+		chan->seg_vv = dma_alloc_coherent(chan->dev,
+						  sizeof(*chan->seg_vv) *
+						  num_descs,
+						  &chan->seg_p, GFP_KERNEL);
+		if (!chan->seg_vv) {
+			dev_err(chan->dev,
+				"unable to allocate channel %d descriptors\n",
+				chan->id);
+			return -ENOMEM;
+		}
+		for (i = 0; i < num_descs; i++) {
+			chan->seg_vv[i].phys = chan->seg_p +
+				sizeof(*chan->seg_vv) * i;
+			list_add_tail(&chan->seg_vv[i].node,
+				      &chan->free_seg_list);
+		}
 	}
 
 	dma_cookie_init(dchan);
@@ -1188,7 +1428,7 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 		 * other channel as well so enable the interrupts here.
 		 */
 		dma_ctrl_set(chan, XILINX_DMA_REG_DMACR,
-			      XILINX_DMA_DMAXR_ALL_IRQ_MASK);
+			      xilinx_dma_irq_mask(chan));
 	}
 
 	if ((chan->xdev->dma_config->dmatype == XDMA_TYPE_CDMA) && chan->has_sg)
@@ -1226,6 +1466,40 @@ static int xilinx_dma_calc_copysize(struct xilinx_dma_chan *chan,
 	return copy;
 }
 
+/**
+ * xilinx_dma_poll_complete - Reap completed descriptors without interrupts
+ * @chan: Driver specific DMA channel
+ *
+ * Does the completion part of xilinx_dma_irq_handler() for channels in poll
+ * mode and runs the callbacks of the completed descriptors from the caller's
+ * context.
+ *
+ * Return: The DMASR value read from the channel.
+ */
+static u32 xilinx_dma_poll_complete(struct xilinx_dma_chan *chan)
+{
+	unsigned long flags;
+	u32 status;
+
+	status = dma_ctrl_read(chan, XILINX_DMA_REG_DMASR);
+	if (!(status & XILINX_DMA_DMASR_FRM_CNT_IRQ))
+		return status;
+
+	dma_ctrl_write(chan, XILINX_DMA_REG_DMASR,
+		       XILINX_DMA_DMASR_FRM_CNT_IRQ |
+		       XILINX_DMA_DMASR_DLY_CNT_IRQ);
+
+	spin_lock_irqsave(&chan->lock, flags);
+	xilinx_dma_complete_descriptor(chan);
+	chan->idle = true;
+	chan->start_transfer(chan);
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	xilinx_dma_chan_desc_cleanup(chan);
+
+	return status;
+}
+
 /**
  * xilinx_dma_tx_status - Get DMA transaction status
  * @dchan: DMA channel
@@ -1243,8 +1517,14 @@ static enum dma_status xilinx_dma_tx_status(struct dma_chan *dchan,
 	enum dma_status ret;
 	unsigned long flags;
 	u32 residue = 0;
+	u32 status;
 
 	ret = dma_cookie_status(dchan, cookie, txstate);
+	if (ret != DMA_COMPLETE && chan->compl_mode == XILINX_DMA_COMPL_POLL) {
+		status = xilinx_dma_poll_complete(chan);
+		ret = dma_cookie_status(dchan, cookie, txstate);
+		trace_xilinx_dma_poll(dchan, cookie, status, ret);
+	}
 	if (ret == DMA_COMPLETE || !txstate)
 		return ret;
 
@@ -1416,6 +1696,10 @@ static void xilinx_vdma_start_transfer(struct xilinx_dma_chan *chan)
 			last->hw.stride);
 	vdma_desc_write(chan, XILINX_DMA_REG_VSIZE, last->hw.vsize);
 
+	if (trace_xilinx_dma_start_enabled())
+		trace_xilinx_dma_start(&chan->common, desc->async_tx.cookie,
+				       xilinx_dma_desc_len(chan, desc));
+
 	chan->desc_submitcount++;
 	chan->desc_pendingcount--;
 	list_move_tail(&desc->node, &chan->active_list);
@@ -1492,6 +1776,7 @@ static void xilinx_cdma_start_transfer(struct xilinx_dma_chan *chan)
 				hw->control & chan->xdev->max_buffer_len);
 	}
 
+	xilinx_dma_trace_start(chan);
 	list_splice_tail_init(&chan->pending_list, &chan->active_list);
 	chan->desc_pendingcount = 0;
 	chan->idle = false;
@@ -1566,6 +1851,7 @@ static void xilinx_dma_start_transfer(struct xilinx_dma_chan *chan)
 			       hw->control & chan->xdev->max_buffer_len);
 	}
 
+	xilinx_dma_trace_start(chan);
 	list_splice_tail_init(&chan->pending_list, &chan->active_list);
 	chan->desc_pendingcount = 0;
 	chan->idle = false;
@@ -1636,6 +1922,7 @@ static void xilinx_mcdma_start_transfer(struct xilinx_dma_chan *chan)
 	xilinx_write(chan, XILINX_MCDMA_CHAN_TDESC_OFFSET(chan->tdest),
 		     tail_segment->phys);
 
+	xilinx_dma_trace_start(chan);
 	list_splice_tail_init(&chan->pending_list, &chan->active_list);
 	chan->desc_pendingcount = 0;
 	chan->idle = false;
@@ -1688,6 +1975,14 @@ static void xilinx_dma_complete_descriptor(struct xilinx_dma_chan *chan)
 			desc->residue = 0;
 		desc->err = chan->err;
 
+		if (trace_xilinx_dma_done_enabled()) {
+			u32 len = xilinx_dma_desc_len(chan, desc);
+
+			trace_xilinx_dma_done(&chan->common,
+					      desc->async_tx.cookie,
+					      len - desc->residue);
+		}
+
 		list_del(&desc->node);
 		if (!desc->cyclic)
 			dma_cookie_complete(&desc->async_tx);
@@ -1744,8 +2039,7 @@ static int xilinx_dma_chan_reset(struct xilinx_dma_chan *chan)
 		return err;
 
 	/* Enable interrupts */
-	dma_ctrl_set(chan, XILINX_DMA_REG_DMACR,
-		      XILINX_DMA_DMAXR_ALL_IRQ_MASK);
+	dma_ctrl_set(chan, XILINX_DMA_REG_DMACR, xilinx_dma_irq_mask(chan));
 
 	return 0;
 }
@@ -1828,15 +2122,18 @@ static irqreturn_t xilinx_mcdma_irq_handler(int irq, void *data)
 static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 {
 	struct xilinx_dma_chan *chan = data;
-	u32 status;
+	u32 status, irqs;
 
-	/* Read the status and ack the interrupts. */
+	/*
+	 * Read the status and ack the interrupts. In poll mode the
+	 * completion bits are left for xilinx_dma_poll_complete().
+	 */
 	status = dma_ctrl_read(chan, XILINX_DMA_REG_DMASR);
-	if (!(status & XILINX_DMA_DMAXR_ALL_IRQ_MASK))
+	irqs = status & xilinx_dma_irq_mask(chan);
+	if (!irqs)
 		return IRQ_NONE;
 
-	dma_ctrl_write(chan, XILINX_DMA_REG_DMASR,
-			status & XILINX_DMA_DMAXR_ALL_IRQ_MASK);
+	dma_ctrl_write(chan, XILINX_DMA_REG_DMASR, irqs);
 
 	if (status & XILINX_DMA_DMASR_ERR_IRQ) {
 		/*
@@ -1862,7 +2159,7 @@ static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 		}
 	}
 
-	if (status & XILINX_DMA_DMASR_DLY_CNT_IRQ) {
+	if (irqs & XILINX_DMA_DMASR_DLY_CNT_IRQ) {
 		/*
 		 * Device takes too long to do the transfer when user requires
 		 * responsiveness.
@@ -1870,7 +2167,7 @@ static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 		dev_dbg(chan->dev, "Inter-packet latency too long\n");
 	}
 
-	if (status & XILINX_DMA_DMASR_FRM_CNT_IRQ) {
+	if (irqs & XILINX_DMA_DMASR_FRM_CNT_IRQ) {
 		spin_lock(&chan->lock);
 		xilinx_dma_complete_descriptor(chan);
 		chan->idle = true;
@@ -1878,10 +2175,34 @@ static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 		spin_unlock(&chan->lock);
 	}
 
+	if (chan->compl_mode == XILINX_DMA_COMPL_THREADED)
+		return IRQ_WAKE_THREAD;
+
 	tasklet_schedule(&chan->tasklet);
 	return IRQ_HANDLED;
 }
 
+/**
+ * xilinx_dma_irq_thread - Threaded completion handler
+ * @irq: IRQ number
+ * @data: Pointer to the Xilinx DMA channel structure
+ *
+ * Runs the descriptor callbacks instead of the tasklet for channels in
+ * threaded completion mode.
+ *
+ * Return: IRQ_HANDLED
+ */
+static irqreturn_t xilinx_dma_irq_thread(int irq, void *data)
+{
+	struct xilinx_dma_chan *chan = data;
+
+	trace_xilinx_dma_irq_thread(&chan->common);
+
+	xilinx_dma_chan_desc_cleanup(chan);
+
+	return IRQ_HANDLED;
+}
+
 /**
  * append_desc_queue - Queuing descriptor
  * @chan: Driver specific dma channel
@@ -1958,7 +2279,7 @@ static dma_cookie_t xilinx_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 	int err;
 
 	if (chan->cyclic) {
-		xilinx_dma_free_tx_descriptor(chan, desc);
+		xilinx_dma_discard_tx_descriptor(chan, desc);
 		return -EBUSY;
 	}
 
@@ -1974,8 +2295,15 @@ static dma_cookie_t xilinx_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 
 	spin_lock_irqsave(&chan->lock, flags);
 
+	if (dmaengine_desc_test_reuse(tx))
+		xilinx_dma_desc_reset(chan, desc);
+
 	cookie = dma_cookie_assign(tx);
 
+	if (trace_xilinx_dma_submit_enabled())
+		trace_xilinx_dma_submit(&chan->common, cookie,
+					xilinx_dma_desc_len(chan, desc));
+
 	/* Put this transaction onto the tail of the pending queue */
 	append_desc_queue(chan, desc);
 
@@ -2067,7 +2395,7 @@ xilinx_vdma_dma_prep_interleaved(struct dma_chan *dchan,
 	return &desc->async_tx;
 
 error:
-	xilinx_dma_free_tx_descriptor(chan, desc);
+	xilinx_dma_discard_tx_descriptor(chan, desc);
 	return NULL;
 }
 
@@ -2123,7 +2451,7 @@ xilinx_cdma_prep_memcpy(struct dma_chan *dchan, dma_addr_t dma_dst,
 	return &desc->async_tx;
 
 error:
-	xilinx_dma_free_tx_descriptor(chan, desc);
+	xilinx_dma_discard_tx_descriptor(chan, desc);
 	return NULL;
 }
 
@@ -2162,6 +2490,7 @@ static struct dma_async_tx_descriptor *xilinx_dma_prep_slave_sg(
 
 	dma_async_tx_descriptor_init(&desc->async_tx, &chan->common);
 	desc->async_tx.tx_submit = xilinx_dma_tx_submit;
+	desc->async_tx.desc_free = xilinx_dma_desc_free;
 
 	/* Build transactions using information in the scatter gather list */
 	for_each_sg(sgl, sg, sg_len, i) {
@@ -2222,7 +2551,7 @@ static struct dma_async_tx_descriptor *xilinx_dma_prep_slave_sg(
 	return &desc->async_tx;
 
 error:
-	xilinx_dma_free_tx_descriptor(chan, desc);
+	xilinx_dma_discard_tx_descriptor(chan, desc);
 	return NULL;
 }
 
@@ -2269,6 +2598,7 @@ static struct dma_async_tx_descriptor *xilinx_dma_prep_dma_cyclic(
 	chan->direction = direction;
 	dma_async_tx_descriptor_init(&desc->async_tx, &chan->common);
 	desc->async_tx.tx_submit = xilinx_dma_tx_submit;
+	desc->async_tx.desc_free = xilinx_dma_desc_free;
 
 	for (i = 0; i < num_periods; ++i) {
 		sg_used = 0;
@@ -2329,7 +2659,7 @@ static struct dma_async_tx_descriptor *xilinx_dma_prep_dma_cyclic(
 	return &desc->async_tx;
 
 error:
-	xilinx_dma_free_tx_descriptor(chan, desc);
+	xilinx_dma_discard_tx_descriptor(chan, desc);
 	return NULL;
 }
 
@@ -2369,6 +2699,7 @@ xilinx_mcdma_prep_slave_sg(struct dma_chan *dchan, struct scatterlist *sgl,
 
 	dma_async_tx_descriptor_init(&desc->async_tx, &chan->common);
 	desc->async_tx.tx_submit = xilinx_dma_tx_submit;
+	desc->async_tx.desc_free = xilinx_dma_desc_free;
 
 	/* Build transactions using information in the scatter gather list */
 	for_each_sg(sgl, sg, sg_len, i) {
@@ -2426,7 +2757,7 @@ xilinx_mcdma_prep_slave_sg(struct dma_chan *dchan, struct scatterlist *sgl,
 	return &desc->async_tx;
 
 error:
-	xilinx_dma_free_tx_descriptor(chan, desc);
+	xilinx_dma_discard_tx_descriptor(chan, desc);
 
 	return NULL;
 }
@@ -2477,6 +2808,9 @@ static void xilinx_dma_synchronize(struct dma_chan *dchan)
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
 
+	if (chan->compl_mode == XILINX_DMA_COMPL_THREADED)
+		synchronize_irq(chan->irq);
+
 	tasklet_kill(&chan->tasklet);
 }
 
@@ -2565,8 +2899,11 @@ static void xilinx_dma_chan_remove(struct xilinx_dma_chan *chan)
 	dma_ctrl_clr(chan, XILINX_DMA_REG_DMACR,
 		      XILINX_DMA_DMAXR_ALL_IRQ_MASK);
 
-	if (chan->irq > 0)
+	if (chan->irq > 0) {
+		if (chan->irq_cpu >= 0)
+			irq_update_affinity_hint(chan->irq, NULL);
 		free_irq(chan->irq, chan);
+	}
 
 	tasklet_kill(&chan->tasklet);
 
@@ -2751,6 +3088,49 @@ static void xdma_disable_allclks(struct xilinx_dma_device *xdev)
 	clk_disable_unprepare(xdev->axi_clk);
 }
 
+/**
+ * xilinx_dma_chan_compl_mode - Read the completion mode of a channel
+ * @chan: Driver specific DMA channel
+ * @node: Device node of the channel
+ *
+ * The optional "xlnx,completion-mode" property selects "threaded" or
+ * "poll" completion handling for AXI DMA channels, "xlnx,irq-cpu" pins
+ * the threaded handler to a CPU.
+ */
+static void xilinx_dma_chan_compl_mode(struct xilinx_dma_chan *chan,
+				       struct device_node *node)
+{
+	const char *mode;
+	u32 cpu;
+
+	chan->compl_mode = XILINX_DMA_COMPL_TASKLET;
+	chan->irq_cpu = -1;
+
+	if (of_property_read_string(node, "xlnx,completion-mode", &mode))
+		return;
+
+	if (chan->xdev->dma_config->dmatype != XDMA_TYPE_AXIDMA) {
+		dev_warn(chan->dev, "completion mode %s only supported on AXI DMA\n",
+			 mode);
+		return;
+	}
+
+	if (!strcmp(mode, "threaded")) {
+		chan->compl_mode = XILINX_DMA_COMPL_THREADED;
+		if (!of_property_read_u32(node, "xlnx,irq-cpu", &cpu)) {
+			if (cpu < nr_cpu_ids)
+				chan->irq_cpu = cpu;
+			else
+				dev_warn(chan->dev, "invalid xlnx,irq-cpu %u\n",
+					 cpu);
+		}
+	} else if (!strcmp(mode, "poll")) {
+		chan->compl_mode = XILINX_DMA_COMPL_POLL;
+	} else if (strcmp(mode, "tasklet")) {
+		dev_warn(chan->dev, "invalid completion mode %s\n", mode);
+	}
+}
+
 /**
  * xilinx_dma_chan_probe - Per Channel Probing
  * It get channel features from the device tree entry and
@@ -2863,13 +3243,28 @@ static int xilinx_dma_chan_probe(struct xilinx_dma_device *xdev,
 	chan->irq = of_irq_get(node, chan->tdest);
 	if (chan->irq < 0)
 		return dev_err_probe(xdev->dev, chan->irq, "failed to get irq\n");
-	err = request_irq(chan->irq, xdev->dma_config->irq_handler,
-			  IRQF_SHARED, "xilinx-dma-controller", chan);
+	xilinx_dma_chan_compl_mode(chan, node);
+	if (chan->compl_mode == XILINX_DMA_COMPL_THREADED)
+		err = request_threaded_irq(chan->irq,
+					   xdev->dma_config->irq_handler,
+					   xilinx_dma_irq_thread, IRQF_SHARED,
+					   "xilinx-dma-controller", chan);
+	else
+		err = request_irq(chan->irq, xdev->dma_config->irq_handler,
+				  IRQF_SHARED, "xilinx-dma-controller", chan);
 	if (err) {
 		dev_err(xdev->dev, "unable to request IRQ %d\n", chan->irq);
 		return err;
 	}
 
+	if (chan->irq_cpu >= 0) {
+		err = irq_set_affinity_and_hint(chan->irq,
+						cpumask_of(chan->irq_cpu));
+		if (err)
+			dev_warn(xdev->dev, "unable to pin IRQ %d to CPU %d\n",
+				 chan->irq, chan->irq_cpu);
+	}
+
 	if (xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
 		chan->start_transfer = xilinx_dma_start_transfer;
 		chan->stop_transfer = xilinx_dma_stop_transfer;
@@ -3048,6 +3443,15 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 	xdev->max_buffer_len = GENMASK(XILINX_DMA_MAX_TRANS_LEN_MAX - 1, 0);
 	xdev->s2mm_chan_id = xdev->dma_config->max_channels / 2;
 
+	xdev->num_descs = num_descs;
+	of_property_read_u32(node, "xlnx,num-descs", &xdev->num_descs);
+	if (xdev->num_descs < XILINX_DMA_MIN_DESCS) {
+		dev_warn(xdev->dev,
+			 "invalid number of descriptors %u. Using default\n",
+			 xdev->num_descs);
+		xdev->num_descs = XILINX_DMA_NUM_DESCS;
+	}
+
 	if (xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA ||
 	    xdev->dma_config->dmatype == XDMA_TYPE_AXIMCDMA) {
 		if (!of_property_read_u32(node, "xlnx,sg-length-width",
@@ -3118,6 +3522,7 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 	if (xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
 		dma_cap_set(DMA_CYCLIC, xdev->common.cap_mask);
 		xdev->common.device_prep_slave_sg = xilinx_dma_prep_slave_sg;
+		xdev->common.descriptor_reuse = true;
 		xdev->common.device_prep_dma_cyclic =
 					  xilinx_dma_prep_dma_cyclic;
 		/* Residue calculation is supported by only AXI DMA and CDMA */
@@ -3131,6 +3536,7 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 					  DMA_RESIDUE_GRANULARITY_SEGMENT;
 	} else if (xdev->dma_config->dmatype == XDMA_TYPE_AXIMCDMA) {
 		xdev->common.device_prep_slave_sg = xilinx_mcdma_prep_slave_sg;
+		xdev->common.descriptor_reuse = true;
 	} else {
 		xdev->common.device_prep_interleaved_dma =
 				xilinx_vdma_dma_prep_interleaved;
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for Xilinx DMA Engine driver.
+ *
+ * Copyright (c) 2022 Advanced Micro Devices, Inc.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM xilinx_dma
+
+#if !defined(_XILINX_DMA_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _XILINX_DMA_TRACE_H
+
+#include <linux/dmaengine.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(xilinx_dma_irq_thread,
+
+	TP_PROTO(struct dma_chan *dchan),
+
+	TP_ARGS(dchan),
+
+	TP_STRUCT__entry(
+		__string(name, dma_chan_name(dchan))
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dma_chan_name(dchan));
+	),
+
+	TP_printk("chan=%s", __get_str(name))
+);
+
+TRACE_EVENT(xilinx_dma_poll,
+
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 status,
+		 enum dma_status ret),
+
+	TP_ARGS(dchan, cookie, status, ret),
+
+	TP_STRUCT__entry(
+		__string(name, dma_chan_name(dchan))
+		__field(dma_cookie_t, cookie)
+		__field(u32, status)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dma_chan_name(dchan));
+		__entry->cookie = cookie;
+		__entry->status = status;
+		__entry->ret = ret;
+	),
+
+	TP_printk("chan=%s cookie=%d dmasr=0x%08x %s",
+		  __get_str(name), __entry->cookie, __entry->status,
+		  __entry->ret == DMA_COMPLETE ? "complete" : "pending")
+);
+
+/*
+ * The life of a descriptor: submitted by the client, handed to the hardware,
+ * completed by the hardware and reported to the client by its callback. The
+ * events of a descriptor are paired by the channel name and the cookie.
+ */
+DECLARE_EVENT_CLASS(xilinx_dma_desc,
+
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+
+	TP_ARGS(dchan, cookie, bytes),
+
+	TP_STRUCT__entry(
+		__string(name, dma_chan_name(dchan))
+		__field(dma_cookie_t, cookie)
+		__field(u32, bytes)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dma_chan_name(dchan));
+		__entry->cookie = cookie;
+		__entry->bytes = bytes;
+	),
+
+	TP_printk("chan=%s cookie=%d bytes=%u",
+		  __get_str(name), __entry->cookie, __entry->bytes)
+);
+
+DEFINE_EVENT(xilinx_dma_desc, xilinx_dma_submit,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(xilinx_dma_desc, xilinx_dma_start,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(xilinx_dma_desc, xilinx_dma_done,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(xilinx_dma_desc, xilinx_dma_callback,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+#endif /* _XILINX_DMA_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE xilinx_dma_trace
+
+#include <trace/define_trace.h>
@@ -0,0 +1,787 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Xilinx DMA Engine throughput and latency benchmark
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ *
+ * Every memcpy capable channel (AXI CDMA, ZynqMP GDMA) found at load time
+ * and every AXI DMA or MCDMA loopback pair described in the device tree
+ * gets a benchmark thread. Writing to the debugfs "run" file starts all
+ * threads at once. Each one sweeps the transfer size and the number of
+ * scatter-gather entries, with interrupt driven and with polled
+ * completion, and the aggregated numbers are read back from the debugfs
+ * "results" file as CSV.
+ */
+#include <linux/debugfs.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of_dma.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/sched/task.h>
+
+static unsigned int min_size = 4096;
+module_param(min_size, uint, 0644);
+MODULE_PARM_DESC(min_size, "Smallest transfer size in bytes (default: 4096)");
+
+static unsigned int max_size = SZ_1M;
+module_param(max_size, uint, 0444);
+MODULE_PARM_DESC(max_size, "Largest transfer size in bytes (default: 1048576)");
+
+static unsigned int max_sg = 16;
+module_param(max_sg, uint, 0444);
+MODULE_PARM_DESC(max_sg,
+		 "Largest number of scatter-gather entries per transfer (default: 16)");
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations,
+		 "Transfers per size and entry count (default: 100)");
+
+static unsigned int memcpy_channels = 8;
+module_param(memcpy_channels, uint, 0444);
+MODULE_PARM_DESC(memcpy_channels,
+		 "Number of memcpy channels to benchmark (default: 8)");
+
+static unsigned int compl_mode = 2;
+module_param(compl_mode, uint, 0644);
+MODULE_PARM_DESC(compl_mode,
+		 "Completion modes to run, 0: interrupt, 1: polled, 2: both (default: 2)");
+
+/* Time to wait for a single transfer before aborting it */
+#define XILINX_DMABENCH_TIMEOUT_MS	3000
+
+enum dmabench_percentile {
+	DMABENCH_P50,
+	DMABENCH_P90,
+	DMABENCH_P99,
+	DMABENCH_MAX,
+	DMABENCH_NR_PCT,
+};
+
+static const unsigned int dmabench_pct[DMABENCH_NR_PCT] = { 50, 90, 99, 100 };
+
+/**
+ * struct dmabench_result - Result of one sweep point on one channel
+ * @node: Node in the channel result list
+ * @poll: Polled completion was used
+ * @size: Bytes per transfer
+ * @sg: Scatter-gather entries per transfer
+ * @done: Completed transfers
+ * @errors: Failed transfers
+ * @bytes_per_sec: Throughput over all completed transfers
+ * @lat_ns: Latency percentiles in nanoseconds
+ */
+struct dmabench_result {
+	struct list_head node;
+	bool poll;
+	u32 size;
+	u32 sg;
+	u32 done;
+	u32 errors;
+	u64 bytes_per_sec;
+	u64 lat_ns[DMABENCH_NR_PCT];
+};
+
+/**
+ * struct dmabench_chan - Benchmarked channel or loopback channel pair
+ * @node: Node in the channel list
+ * @chan: Memcpy channel, or transmit channel of a loopback pair
+ * @rx_chan: Receive channel of a loopback pair, NULL for memcpy
+ * @pdev: Platform device that described the loopback pair
+ * @task: Benchmark thread
+ * @running: Benchmark thread has not finished its sweep yet
+ * @src: Source buffer
+ * @dst: Destination buffer
+ * @dma_src: Source buffer address on @chan
+ * @dma_dst: Destination buffer address on @chan or @rx_chan
+ * @src_sg: Source scatter list
+ * @dst_sg: Destination scatter list
+ * @lat: Per transfer latencies of the current sweep point
+ * @cmp: Completion signalled by the transfer callback
+ * @results: Results of the last run
+ */
+struct dmabench_chan {
+	struct list_head node;
+	struct dma_chan *chan;
+	struct dma_chan *rx_chan;
+	struct platform_device *pdev;
+	struct task_struct *task;
+	bool running;
+	void *src;
+	void *dst;
+	dma_addr_t dma_src;
+	dma_addr_t dma_dst;
+	struct scatterlist *src_sg;
+	struct scatterlist *dst_sg;
+	u64 *lat;
+	struct completion cmp;
+	struct list_head results;
+};
+
+/* Protects the channel list and the benchmark threads */
+static DEFINE_MUTEX(bench_lock);
+/* Protects the result lists, taken by the benchmark threads */
+static DEFINE_MUTEX(results_lock);
+static LIST_HEAD(bench_chans);
+static struct dentry *bench_dir;
+
+static struct device *dmabench_rx_dev(struct dmabench_chan *bc)
+{
+	return dmaengine_get_dma_device(bc->rx_chan ? bc->rx_chan : bc->chan);
+}
+
+static void dmabench_callback(void *arg)
+{
+	complete(arg);
+}
+
+static int dmabench_wait(struct dmabench_chan *bc, struct dma_chan *chan,
+			 dma_cookie_t cookie, bool poll)
+{
+	enum dma_status status;
+	ktime_t timeout;
+
+	if (!poll) {
+		if (!wait_for_completion_timeout(&bc->cmp,
+				msecs_to_jiffies(XILINX_DMABENCH_TIMEOUT_MS)))
+			return -ETIMEDOUT;
+		return 0;
+	}
+
+	timeout = ktime_add_ms(ktime_get(), XILINX_DMABENCH_TIMEOUT_MS);
+	do {
+		status = dmaengine_tx_status(chan, cookie, NULL);
+		if (status == DMA_COMPLETE)
+			return 0;
+		if (status == DMA_ERROR)
+			return -EIO;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), timeout));
+
+	return -ETIMEDOUT;
+}
+
+static void dmabench_init_sg(struct scatterlist *sgl, dma_addr_t addr,
+			     u32 size, u32 sg)
+{
+	struct scatterlist *s;
+	u32 seg = size / sg;
+	int i;
+
+	sg_init_table(sgl, sg);
+	for_each_sg(sgl, s, sg, i) {
+		sg_dma_address(s) = addr + i * seg;
+		sg_dma_len(s) = seg;
+	}
+}
+
+/**
+ * dmabench_xfer_memcpy - Run one memcpy transfer
+ * @bc: Benchmarked channel
+ * @size: Bytes to copy
+ * @sg: Number of scatter-gather entries
+ * @poll: Use polled completion
+ *
+ * Scattered copies use device_prep_dma_memcpy_sg when the channel has it
+ * and one memcpy descriptor per entry otherwise, with only the last one
+ * completing the transfer.
+ *
+ * Return: '0' on success and failure value on error
+ */
+static int dmabench_xfer_memcpy(struct dmabench_chan *bc, u32 size, u32 sg,
+				bool poll)
+{
+	struct dma_chan *chan = bc->chan;
+	struct dma_async_tx_descriptor *tx;
+	bool use_sg = sg > 1 &&
+		      dma_has_cap(DMA_MEMCPY_SG, chan->device->cap_mask);
+	u32 nr = use_sg ? 1 : sg, seg = size / sg, i;
+	unsigned long flags;
+	dma_cookie_t cookie;
+	bool last;
+
+	if (use_sg) {
+		dmabench_init_sg(bc->src_sg, bc->dma_src, size, sg);
+		dmabench_init_sg(bc->dst_sg, bc->dma_dst, size, sg);
+	}
+
+	for (i = 0; i < nr; i++) {
+		last = i == nr - 1;
+		flags = DMA_CTRL_ACK;
+		if (last && !poll)
+			flags |= DMA_PREP_INTERRUPT;
+
+		if (use_sg)
+			tx = dmaengine_prep_dma_memcpy_sg(chan, bc->dst_sg, sg,
+							  bc->src_sg, sg,
+							  flags);
+		else
+			tx = dmaengine_prep_dma_memcpy(chan,
+						       bc->dma_dst + i * seg,
+						       bc->dma_src + i * seg,
+						       seg, flags);
+		if (!tx)
+			goto err;
+
+		if (last && !poll) {
+			tx->callback = dmabench_callback;
+			tx->callback_param = &bc->cmp;
+		}
+		cookie = dmaengine_submit(tx);
+		if (dma_submit_error(cookie))
+			goto err;
+	}
+
+	dma_async_issue_pending(chan);
+	return dmabench_wait(bc, chan, cookie, poll);
+
+err:
+	/* Drop whatever part of the transfer was already submitted */
+	dmaengine_terminate_sync(chan);
+	return -ENOMEM;
+}
+
+/**
+ * dmabench_xfer_slave - Run one loopback transfer
+ * @bc: Benchmarked channel pair
+ * @size: Bytes to transfer
+ * @sg: Number of scatter-gather entries
+ * @poll: Use polled completion
+ *
+ * Return: '0' on success and failure value on error
+ */
+static int dmabench_xfer_slave(struct dmabench_chan *bc, u32 size, u32 sg,
+			       bool poll)
+{
+	unsigned long flags = poll ? DMA_CTRL_ACK :
+				     DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+	struct dma_async_tx_descriptor *rxd, *txd;
+	dma_cookie_t rx_cookie, tx_cookie;
+	int ret;
+
+	dmabench_init_sg(bc->src_sg, bc->dma_src, size, sg);
+	dmabench_init_sg(bc->dst_sg, bc->dma_dst, size, sg);
+
+	rxd = dmaengine_prep_slave_sg(bc->rx_chan, bc->dst_sg, sg,
+				      DMA_DEV_TO_MEM, flags);
+	txd = dmaengine_prep_slave_sg(bc->chan, bc->src_sg, sg,
+				      DMA_MEM_TO_DEV, flags);
+	if (!rxd || !txd) {
+		if (rxd)
+			dmaengine_desc_free(rxd);
+		if (txd)
+			dmaengine_desc_free(txd);
+		return -ENOMEM;
+	}
+
+	if (!poll) {
+		rxd->callback = dmabench_callback;
+		rxd->callback_param = &bc->cmp;
+	}
+	rx_cookie = dmaengine_submit(rxd);
+	tx_cookie = dmaengine_submit(txd);
+	if (dma_submit_error(rx_cookie) || dma_submit_error(tx_cookie)) {
+		ret = -EIO;
+		goto err;
+	}
+
+	dma_async_issue_pending(bc->rx_chan);
+	dma_async_issue_pending(bc->chan);
+
+	ret = dmabench_wait(bc, bc->rx_chan, rx_cookie, poll);
+	if (ret)
+		goto err;
+
+	/* The stream is looped back, so transmit is idle once receive is */
+	return dmabench_wait(bc, bc->chan, tx_cookie, true);
+
+err:
+	dmaengine_terminate_sync(bc->chan);
+	dmaengine_terminate_sync(bc->rx_chan);
+	return ret;
+}
+
+static int dmabench_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * dmabench_point - Measure one sweep point
+ * @bc: Benchmarked channel
+ * @size: Bytes per transfer
+ * @sg: Scatter-gather entries per transfer
+ * @poll: Use polled completion
+ *
+ * Return: '0' on success and failure value on error
+ */
+static int dmabench_point(struct dmabench_chan *bc, u32 size, u32 sg,
+			  bool poll)
+{
+	struct dmabench_result *res;
+	u64 start, t0, wall;
+	u32 i, idx;
+	int ret = 0;
+
+	res = kzalloc(sizeof(*res), GFP_KERNEL);
+	if (!res)
+		return -ENOMEM;
+
+	res->poll = poll;
+	res->size = size;
+	res->sg = sg;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations && !kthread_should_stop(); i++) {
+		reinit_completion(&bc->cmp);
+		t0 = ktime_get_ns();
+		if (bc->rx_chan)
+			ret = dmabench_xfer_slave(bc, size, sg, poll);
+		else
+			ret = dmabench_xfer_memcpy(bc, size, sg, poll);
+		if (ret) {
+			res->errors++;
+			break;
+		}
+		bc->lat[res->done++] = ktime_get_ns() - t0;
+	}
+	wall = ktime_get_ns() - start;
+
+	if (res->done) {
+		res->bytes_per_sec = div64_u64((u64)res->done * size *
+					       NSEC_PER_SEC, wall);
+		sort(bc->lat, res->done, sizeof(*bc->lat), dmabench_cmp_u64,
+		     NULL);
+		for (i = 0; i < DMABENCH_NR_PCT; i++) {
+			idx = DIV_ROUND_UP(res->done * dmabench_pct[i], 100);
+			res->lat_ns[i] = bc->lat[max(idx, 1U) - 1];
+		}
+	}
+
+	mutex_lock(&results_lock);
+	list_add_tail(&res->node, &bc->results);
+	mutex_unlock(&results_lock);
+
+	return ret;
+}
+
+static int dmabench_thread(void *data)
+{
+	struct dmabench_chan *bc = data;
+	struct dma_device *dev = bc->chan->device;
+	u32 align_min, size, sg, mode;
+	bool poll;
+
+	/* Every entry has to honour the copy alignment of the engine */
+	align_min = 1 << dev->copy_align;
+	if (bc->rx_chan && (1 << bc->rx_chan->device->copy_align) > align_min)
+		align_min = 1 << bc->rx_chan->device->copy_align;
+
+	for (mode = 0; mode < 2 && !kthread_should_stop(); mode++) {
+		if (compl_mode != 2 && compl_mode != mode)
+			continue;
+		poll = mode;
+
+		for (size = min_size; size && size <= max_size;
+		     size <<= 1) {
+			for (sg = 1; sg <= max_sg; sg <<= 1) {
+				if (kthread_should_stop())
+					goto out;
+				if (size % sg || (size / sg) % align_min)
+					break;
+				if (dmabench_point(bc, size, sg, poll))
+					pr_warn("dmabench: %s failed at %u bytes, %u entries\n",
+						dma_chan_name(bc->chan), size,
+						sg);
+			}
+		}
+	}
+
+out:
+	WRITE_ONCE(bc->running, false);
+	return 0;
+}
+
+static void dmabench_free_results(struct dmabench_chan *bc)
+{
+	struct dmabench_result *res, *next;
+
+	mutex_lock(&results_lock);
+	list_for_each_entry_safe(res, next, &bc->results, node) {
+		list_del(&res->node);
+		kfree(res);
+	}
+	mutex_unlock(&results_lock);
+}
+
+/* Must be called with bench_lock held */
+static void dmabench_stop(struct dmabench_chan *bc)
+{
+	if (!bc->task)
+		return;
+
+	kthread_stop(bc->task);
+	put_task_struct(bc->task);
+	bc->task = NULL;
+	bc->running = false;
+}
+
+/* Must be called with bench_lock held */
+static bool dmabench_running(void)
+{
+	struct dmabench_chan *bc;
+
+	list_for_each_entry(bc, &bench_chans, node) {
+		if (READ_ONCE(bc->running))
+			return true;
+	}
+
+	return false;
+}
+
+static void dmabench_free_chan(struct dmabench_chan *bc)
+{
+	struct device *tx_dev = dmaengine_get_dma_device(bc->chan);
+
+	if (bc->dma_src)
+		dma_unmap_single(tx_dev, bc->dma_src, max_size, DMA_TO_DEVICE);
+	if (bc->dma_dst)
+		dma_unmap_single(dmabench_rx_dev(bc), bc->dma_dst, max_size,
+				 DMA_FROM_DEVICE);
+	dmabench_free_results(bc);
+	kfree(bc->src_sg);
+	kfree(bc->dst_sg);
+	kvfree(bc->lat);
+	kfree(bc->src);
+	kfree(bc->dst);
+	kfree(bc);
+}
+
+static struct dmabench_chan *dmabench_alloc_chan(struct dma_chan *chan,
+						 struct dma_chan *rx_chan)
+{
+	struct device *tx_dev = dmaengine_get_dma_device(chan);
+	struct dmabench_chan *bc;
+	dma_addr_t addr;
+
+	bc = kzalloc(sizeof(*bc), GFP_KERNEL);
+	if (!bc)
+		return NULL;
+
+	bc->chan = chan;
+	bc->rx_chan = rx_chan;
+	init_completion(&bc->cmp);
+	INIT_LIST_HEAD(&bc->results);
+
+	bc->src = kmalloc(max_size, GFP_KERNEL);
+	bc->dst = kmalloc(max_size, GFP_KERNEL);
+	bc->src_sg = kcalloc(max_sg, sizeof(*bc->src_sg), GFP_KERNEL);
+	bc->dst_sg = kcalloc(max_sg, sizeof(*bc->dst_sg), GFP_KERNEL);
+	bc->lat = kvcalloc(iterations, sizeof(*bc->lat), GFP_KERNEL);
+	if (!bc->src || !bc->dst || !bc->src_sg || !bc->dst_sg || !bc->lat)
+		goto err;
+
+	memset(bc->src, 0x5a, max_size);
+
+	/*
+	 * The buffers stay mapped for the life of the channel and the CPU
+	 * never touches them in between, so no cache maintenance ends up in
+	 * the measured time.
+	 */
+	addr = dma_map_single(tx_dev, bc->src, max_size, DMA_TO_DEVICE);
+	if (dma_mapping_error(tx_dev, addr))
+		goto err;
+	bc->dma_src = addr;
+
+	addr = dma_map_single(dmabench_rx_dev(bc), bc->dst, max_size,
+			      DMA_FROM_DEVICE);
+	if (dma_mapping_error(dmabench_rx_dev(bc), addr))
+		goto err;
+	bc->dma_dst = addr;
+
+	return bc;
+
+err:
+	dmabench_free_chan(bc);
+	return NULL;
+}
+
+static int dmabench_run_show(struct seq_file *s, void *data)
+{
+	bool running;
+
+	mutex_lock(&bench_lock);
+	running = dmabench_running();
+	mutex_unlock(&bench_lock);
+
+	seq_printf(s, "%s\n", running ? "running" : "idle");
+	return 0;
+}
+
+static int dmabench_run_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dmabench_run_show, inode->i_private);
+}
+
+static ssize_t dmabench_run_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct dmabench_chan *bc;
+	bool run;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &run);
+	if (ret)
+		return ret;
+
+	mutex_lock(&bench_lock);
+	if (!run) {
+		list_for_each_entry(bc, &bench_chans, node)
+			dmabench_stop(bc);
+		goto out;
+	}
+
+	if (dmabench_running()) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (!min_size || min_size > max_size || !max_sg) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	list_for_each_entry(bc, &bench_chans, node) {
+		dmabench_stop(bc);
+		dmabench_free_results(bc);
+	}
+
+	list_for_each_entry(bc, &bench_chans, node) {
+		bc->task = kthread_create(dmabench_thread, bc, "dmabench-%s",
+					  dma_chan_name(bc->chan));
+		if (IS_ERR(bc->task)) {
+			ret = PTR_ERR(bc->task);
+			bc->task = NULL;
+			/* Threads that were never woken exit on kthread_stop */
+			list_for_each_entry(bc, &bench_chans, node)
+				dmabench_stop(bc);
+			goto out;
+		}
+		get_task_struct(bc->task);
+		bc->running = true;
+	}
+
+	/* Start all threads together so the channels really run concurrently */
+	list_for_each_entry(bc, &bench_chans, node)
+		wake_up_process(bc->task);
+
+out:
+	mutex_unlock(&bench_lock);
+	return ret ? ret : count;
+}
+
+static const struct file_operations dmabench_run_fops = {
+	.owner = THIS_MODULE,
+	.open = dmabench_run_open,
+	.read = seq_read,
+	.write = dmabench_run_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int dmabench_results_show(struct seq_file *s, void *data)
+{
+	struct dmabench_result *res;
+	struct dmabench_chan *bc;
+
+	seq_puts(s, "chan,rx_chan,completion,size,sg,done,errors,bytes_per_sec,p50_ns,p90_ns,p99_ns,max_ns\n");
+
+	mutex_lock(&bench_lock);
+	mutex_lock(&results_lock);
+	list_for_each_entry(bc, &bench_chans, node) {
+		list_for_each_entry(res, &bc->results, node) {
+			seq_printf(s, "%s,%s,%s,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu\n",
+				   dma_chan_name(bc->chan),
+				   bc->rx_chan ? dma_chan_name(bc->rx_chan) : "",
+				   res->poll ? "poll" : "irq",
+				   res->size, res->sg, res->done, res->errors,
+				   res->bytes_per_sec,
+				   res->lat_ns[DMABENCH_P50],
+				   res->lat_ns[DMABENCH_P90],
+				   res->lat_ns[DMABENCH_P99],
+				   res->lat_ns[DMABENCH_MAX]);
+		}
+	}
+	mutex_unlock(&results_lock);
+	mutex_unlock(&bench_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dmabench_results);
+
+static void dmabench_add_chan(struct dmabench_chan *bc)
+{
+	mutex_lock(&bench_lock);
+	list_add_tail(&bc->node, &bench_chans);
+	mutex_unlock(&bench_lock);
+
+	pr_info("dmabench: added %s%s%s\n", dma_chan_name(bc->chan),
+		bc->rx_chan ? " -> " : "",
+		bc->rx_chan ? dma_chan_name(bc->rx_chan) : "");
+}
+
+static void dmabench_del_chan(struct dmabench_chan *bc)
+{
+	struct dma_chan *chan = bc->chan, *rx_chan = bc->rx_chan;
+
+	mutex_lock(&bench_lock);
+	dmabench_stop(bc);
+	list_del(&bc->node);
+	mutex_unlock(&bench_lock);
+
+	dmabench_free_chan(bc);
+	dma_release_channel(chan);
+	if (rx_chan)
+		dma_release_channel(rx_chan);
+}
+
+static int xilinx_dmabench_probe(struct platform_device *pdev)
+{
+	struct dma_chan *chan, *rx_chan;
+	struct dmabench_chan *bc;
+	int err;
+
+	chan = dma_request_chan(&pdev->dev, "tx");
+	if (IS_ERR(chan))
+		return dev_err_probe(&pdev->dev, PTR_ERR(chan),
+				     "No Tx channel\n");
+
+	rx_chan = dma_request_chan(&pdev->dev, "rx");
+	if (IS_ERR(rx_chan)) {
+		err = dev_err_probe(&pdev->dev, PTR_ERR(rx_chan),
+				    "No Rx channel\n");
+		goto free_tx;
+	}
+
+	bc = dmabench_alloc_chan(chan, rx_chan);
+	if (!bc) {
+		err = -ENOMEM;
+		goto free_rx;
+	}
+
+	bc->pdev = pdev;
+	platform_set_drvdata(pdev, bc);
+	dmabench_add_chan(bc);
+
+	return 0;
+
+free_rx:
+	dma_release_channel(rx_chan);
+free_tx:
+	dma_release_channel(chan);
+
+	return err;
+}
+
+static int xilinx_dmabench_remove(struct platform_device *pdev)
+{
+	dmabench_del_chan(platform_get_drvdata(pdev));
+	return 0;
+}
+
+static const struct of_device_id xilinx_dmabench_of_ids[] = {
+	{ .compatible = "xlnx,axi-dma-bench",},
+	{}
+};
+
+static struct platform_driver xilinx_dmabench_driver = {
+	.driver = {
+		.name = "xilinx_dmabench",
+		.of_match_table = xilinx_dmabench_of_ids,
+	},
+	.probe = xilinx_dmabench_probe,
+	.remove = xilinx_dmabench_remove,
+};
+
+static void dmabench_add_memcpy_channels(void)
+{
+	struct dmabench_chan *bc;
+	struct dma_chan *chan;
+	dma_cap_mask_t mask;
+	unsigned int i;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+
+	for (i = 0; i < memcpy_channels; i++) {
+		chan = dma_request_chan_by_mask(&mask);
+		if (IS_ERR(chan))
+			break;
+
+		bc = dmabench_alloc_chan(chan, NULL);
+		if (!bc) {
+			dma_release_channel(chan);
+			break;
+		}
+		dmabench_add_chan(bc);
+	}
+}
+
+static void dmabench_del_memcpy_channels(void)
+{
+	struct dmabench_chan *bc, *next;
+
+	list_for_each_entry_safe(bc, next, &bench_chans, node) {
+		if (!bc->pdev)
+			dmabench_del_chan(bc);
+	}
+}
+
+static int __init dmabench_init(void)
+{
+	int ret;
+
+	if (!min_size || min_size > max_size || !max_sg || !iterations)
+		return -EINVAL;
+
+	bench_dir = debugfs_create_dir("xilinx_dmabench", NULL);
+	debugfs_create_file("run", 0644, bench_dir, NULL, &dmabench_run_fops);
+	debugfs_create_file("results", 0444, bench_dir, NULL,
+			    &dmabench_results_fops);
+
+	dmabench_add_memcpy_channels();
+
+	ret = platform_driver_register(&xilinx_dmabench_driver);
+	if (ret) {
+		dmabench_del_memcpy_channels();
+		debugfs_remove_recursive(bench_dir);
+	}
+
+	return ret;
+}
+late_initcall(dmabench_init);
+
+static void __exit dmabench_exit(void)
+{
+	/* Drop the debugfs files first so no new run can be started */
+	debugfs_remove_recursive(bench_dir);
+	platform_driver_unregister(&xilinx_dmabench_driver);
+	dmabench_del_memcpy_channels();
+}
+module_exit(dmabench_exit)
+
+MODULE_AUTHOR("Advanced Micro Devices, Inc.");
+MODULE_DESCRIPTION("Xilinx DMA Engine Benchmark");
+MODULE_LICENSE("GPL");
@@ -136,6 +136,9 @@
 
 #define XILINX_DPDMA_NUM_CHAN				6
 
+/* Completed single-frame descriptors kept per channel for the next flip */
+#define XILINX_DPDMA_NUM_CACHED_DESCS			2
+
 struct xilinx_dpdma_chan;
 
 /**
@@ -220,6 +223,9 @@ struct xilinx_dpdma_tx_desc {
  * @desc: References to descriptors being processed
  * @desc.pending: Descriptor schedule to the hardware, pending execution
  * @desc.active: Descriptor being executed by the hardware
+ * @cache_lock: lock to access @desc_cache and @num_cached
+ * @desc_cache: completed tx descriptors kept for reuse
+ * @num_cached: number of descriptors in @desc_cache
  * @xdev: DPDMA device
  */
 struct xilinx_dpdma_chan {
@@ -241,6 +247,10 @@ struct xilinx_dpdma_chan {
 		struct xilinx_dpdma_tx_desc *active;
 	} desc;
 
+	spinlock_t cache_lock; /* lock to access the descriptor cache */
+	struct list_head desc_cache;
+	unsigned int num_cached;
+
 	struct xilinx_dpdma_device *xdev;
 };
 
@@ -645,28 +655,96 @@ xilinx_dpdma_chan_alloc_tx_desc(struct xilinx_dpdma_chan *chan)
 	return tx_desc;
 }
 
+/**
+ * xilinx_dpdma_chan_release_tx_desc - Release a transaction descriptor
+ * @desc: tx descriptor
+ *
+ * Free @desc including its software descriptors back to the allocators.
+ */
+static void xilinx_dpdma_chan_release_tx_desc(struct xilinx_dpdma_tx_desc *desc)
+{
+	struct xilinx_dpdma_sw_desc *sw_desc, *next;
+
+	list_for_each_entry_safe(sw_desc, next, &desc->descriptors, node) {
+		list_del(&sw_desc->node);
+		xilinx_dpdma_chan_free_sw_desc(desc->chan, sw_desc);
+	}
+
+	kfree(desc);
+}
+
+/**
+ * xilinx_dpdma_chan_get_cached_tx_desc - Get a cached transaction descriptor
+ * @chan: DPDMA channel
+ *
+ * Return: a tx descriptor with a single, cleared software descriptor, or NULL
+ * if the cache is empty.
+ */
+static struct xilinx_dpdma_tx_desc *
+xilinx_dpdma_chan_get_cached_tx_desc(struct xilinx_dpdma_chan *chan)
+{
+	struct xilinx_dpdma_tx_desc *tx_desc;
+	struct xilinx_dpdma_sw_desc *sw_desc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->cache_lock, flags);
+	tx_desc = list_first_entry_or_null(&chan->desc_cache,
+					   struct xilinx_dpdma_tx_desc,
+					   vdesc.node);
+	if (tx_desc) {
+		list_del(&tx_desc->vdesc.node);
+		chan->num_cached--;
+	}
+	spin_unlock_irqrestore(&chan->cache_lock, flags);
+
+	if (!tx_desc)
+		return NULL;
+
+	/* Give the caller the same state a fresh allocation would have */
+	memset(&tx_desc->vdesc, 0, sizeof(tx_desc->vdesc));
+	tx_desc->error = false;
+	sw_desc = list_first_entry(&tx_desc->descriptors,
+				   struct xilinx_dpdma_sw_desc, node);
+	memset(&sw_desc->hw, 0, sizeof(sw_desc->hw));
+
+	return tx_desc;
+}
+
 /**
  * xilinx_dpdma_chan_free_tx_desc - Free a virtual DMA descriptor
  * @vdesc: virtual DMA descriptor
  *
  * Free the virtual DMA descriptor @vdesc including its software descriptors.
+ * Descriptors made of a single software descriptor, as used for every page
+ * flip, are kept in a small per-channel cache instead. The next interleaved
+ * prep call then only rewrites the hardware descriptor, with no allocation
+ * from the descriptor pool or from the slab in the flip path.
  */
 static void xilinx_dpdma_chan_free_tx_desc(struct virt_dma_desc *vdesc)
 {
-	struct xilinx_dpdma_sw_desc *sw_desc, *next;
 	struct xilinx_dpdma_tx_desc *desc;
+	struct xilinx_dpdma_chan *chan;
+	unsigned long flags;
 
 	if (!vdesc)
 		return;
 
 	desc = to_dpdma_tx_desc(vdesc);
-
-	list_for_each_entry_safe(sw_desc, next, &desc->descriptors, node) {
-		list_del(&sw_desc->node);
-		xilinx_dpdma_chan_free_sw_desc(desc->chan, sw_desc);
+	chan = desc->chan;
+
+	if (list_is_singular(&desc->descriptors)) {
+		spin_lock_irqsave(&chan->cache_lock, flags);
+		if (chan->num_cached < XILINX_DPDMA_NUM_CACHED_DESCS) {
+			list_add_tail(&desc->vdesc.node, &chan->desc_cache);
+			chan->num_cached++;
+			desc = NULL;
+		}
+		spin_unlock_irqrestore(&chan->cache_lock, flags);
+		if (!desc)
+			return;
 	}
 
-	kfree(desc);
+	xilinx_dpdma_chan_release_tx_desc(desc);
 }
 
 /**
@@ -775,6 +853,13 @@ xilinx_dpdma_chan_prep_interleaved_dma(struct xilinx_dpdma_chan *chan,
 		return NULL;
 	}
 
+	tx_desc = xilinx_dpdma_chan_get_cached_tx_desc(chan);
+	if (tx_desc) {
+		sw_desc = list_first_entry(&tx_desc->descriptors,
+					   struct xilinx_dpdma_sw_desc, node);
+		goto config;
+	}
+
 	tx_desc = xilinx_dpdma_chan_alloc_tx_desc(chan);
 	if (!tx_desc)
 		return NULL;
@@ -785,6 +870,9 @@ xilinx_dpdma_chan_prep_interleaved_dma(struct xilinx_dpdma_chan *chan,
 		return NULL;
 	}
 
+	list_add_tail(&sw_desc->node, &tx_desc->descriptors);
+
+config:
 	xilinx_dpdma_sw_desc_set_dma_addrs(chan->xdev, sw_desc, sw_desc,
 					   &xt->src_start, 1);
 
@@ -800,8 +888,6 @@ xilinx_dpdma_chan_prep_interleaved_dma(struct xilinx_dpdma_chan *chan,
 	hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_IGNORE_DONE;
 	hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_LAST_OF_FRAME;
 
-	list_add_tail(&sw_desc->node, &tx_desc->descriptors);
-
 	return tx_desc;
 }
 
@@ -1343,15 +1429,28 @@ static int xilinx_dpdma_alloc_chan_resources(struct dma_chan *dchan)
  * xilinx_dpdma_free_chan_resources - Free all resources for the channel
  * @dchan: DMA channel
  *
- * Free resources associated with the virtual DMA channel, and destroy the
- * descriptor pool.
+ * Free resources associated with the virtual DMA channel, release the cached
+ * descriptors, and destroy the descriptor pool.
  */
 static void xilinx_dpdma_free_chan_resources(struct dma_chan *dchan)
 {
 	struct xilinx_dpdma_chan *chan = to_xilinx_chan(dchan);
+	struct xilinx_dpdma_tx_desc *desc, *next;
+	LIST_HEAD(descriptors);
+	unsigned long flags;
 
 	vchan_free_chan_resources(&chan->vchan);
 
+	spin_lock_irqsave(&chan->cache_lock, flags);
+	list_splice_init(&chan->desc_cache, &descriptors);
+	chan->num_cached = 0;
+	spin_unlock_irqrestore(&chan->cache_lock, flags);
+
+	list_for_each_entry_safe(desc, next, &descriptors, vdesc.node) {
+		list_del(&desc->vdesc.node);
+		xilinx_dpdma_chan_release_tx_desc(desc);
+	}
+
 	dma_pool_destroy(chan->desc_pool);
 	chan->desc_pool = NULL;
 }
@@ -1666,6 +1765,8 @@ static int xilinx_dpdma_chan_init(struct xilinx_dpdma_device *xdev,
 	chan->xdev = xdev;
 
 	spin_lock_init(&chan->lock);
+	spin_lock_init(&chan->cache_lock);
+	INIT_LIST_HEAD(&chan->desc_cache);
 	init_waitqueue_head(&chan->wait_to_stop);
 
 	tasklet_setup(&chan->err_task, xilinx_dpdma_chan_err_task);
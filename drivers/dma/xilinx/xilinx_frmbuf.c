@@ -20,6 +20,7 @@
 #include <linux/clk.h>
 #include <linux/delay.h>
 #include <linux/dma/xilinx_frmbuf.h>
+#include <linux/dma-fence.h>
 #include <linux/dmapool.h>
 #include <linux/gpio/consumer.h>
 #include <linux/init.h>
@@ -38,6 +39,9 @@
 
 #include "../dmaengine.h"
 
+#define CREATE_TRACE_POINTS
+#include "xilinx_frmbuf_trace.h"
+
 /* Register/Descriptor Offsets */
 #define XILINX_FRMBUF_CTRL_OFFSET		0x00
 #define XILINX_FRMBUF_GIE_OFFSET		0x04
@@ -148,6 +152,9 @@ struct xilinx_frmbuf_desc_hw {
  * @node: Node in the channel descriptors list
  * @fid: Field ID of buffer
  * @earlycb: Whether the callback should be called when in staged state
+ * @done_fence: Fence signalled when the frame has been transferred
+ * @wait_fence: Fence the frame waits on before it is programmed
+ * @wait_cb: Callback kicking the channel when @wait_fence signals
  */
 struct xilinx_frmbuf_tx_descriptor {
 	struct dma_async_tx_descriptor async_tx;
@@ -155,6 +162,23 @@ struct xilinx_frmbuf_tx_descriptor {
 	struct list_head node;
 	u32 fid;
 	u32 earlycb;
+	struct dma_fence *done_fence;
+	struct dma_fence *wait_fence;
+	struct dma_fence_cb wait_cb;
+};
+
+/**
+ * struct xilinx_frmbuf_fence - Frame completion fence
+ * @base: DMA fence
+ * @lock: Fence lock
+ *
+ * The lock lives with the fence, as consumers may hold the fence after the
+ * descriptor and even the channel that signalled it are gone.
+ */
+struct xilinx_frmbuf_fence {
+	struct dma_fence base;
+	/* Fence lock */
+	spinlock_t lock;
 };
 
 /**
@@ -1036,6 +1060,36 @@ xilinx_frmbuf_alloc_tx_descriptor(struct xilinx_frmbuf_chan *chan)
 	return desc;
 }
 
+/**
+ * xilinx_frmbuf_free_tx_descriptor - Free transaction descriptor
+ * @desc: Descriptor to free, may be NULL
+ *
+ * Must be called without the channel lock held, as removing the wait fence
+ * callback waits for a running callback, which takes that lock.
+ */
+static void
+xilinx_frmbuf_free_tx_descriptor(struct xilinx_frmbuf_tx_descriptor *desc)
+{
+	if (!desc)
+		return;
+
+	if (desc->wait_fence) {
+		dma_fence_remove_callback(desc->wait_fence, &desc->wait_cb);
+		dma_fence_put(desc->wait_fence);
+	}
+
+	if (desc->done_fence) {
+		/* Release the consumers of a frame that was never handed over */
+		if (!dma_fence_is_signaled(desc->done_fence)) {
+			dma_fence_set_error(desc->done_fence, -ECANCELED);
+			dma_fence_signal(desc->done_fence);
+		}
+		dma_fence_put(desc->done_fence);
+	}
+
+	kfree(desc);
+}
+
 /**
  * xilinx_frmbuf_free_desc_list - Free descriptors list
  * @chan: Driver specific dma channel
@@ -1048,7 +1102,7 @@ static void xilinx_frmbuf_free_desc_list(struct xilinx_frmbuf_chan *chan,
 
 	list_for_each_entry_safe(desc, next, list, node) {
 		list_del(&desc->node);
-		kfree(desc);
+		xilinx_frmbuf_free_tx_descriptor(desc);
 	}
 }
 
@@ -1058,21 +1112,27 @@ static void xilinx_frmbuf_free_desc_list(struct xilinx_frmbuf_chan *chan,
  */
 static void xilinx_frmbuf_free_descriptors(struct xilinx_frmbuf_chan *chan)
 {
+	struct xilinx_frmbuf_tx_descriptor *active, *staged;
 	unsigned long flags;
+	LIST_HEAD(descs);
 
 	spin_lock_irqsave(&chan->lock, flags);
 
-	xilinx_frmbuf_free_desc_list(chan, &chan->pending_list);
-	xilinx_frmbuf_free_desc_list(chan, &chan->done_list);
-	kfree(chan->active_desc);
-	kfree(chan->staged_desc);
+	list_splice_init(&chan->pending_list, &descs);
+	list_splice_init(&chan->done_list, &descs);
+	active = chan->active_desc;
+	staged = chan->staged_desc;
 
 	chan->staged_desc = NULL;
 	chan->active_desc = NULL;
-	INIT_LIST_HEAD(&chan->pending_list);
-	INIT_LIST_HEAD(&chan->done_list);
 
 	spin_unlock_irqrestore(&chan->lock, flags);
+
+	xilinx_frmbuf_free_desc_list(chan, &descs);
+	xilinx_frmbuf_free_tx_descriptor(active);
+	/* An early callback at start of descriptor may stage the active one */
+	if (staged != active)
+		xilinx_frmbuf_free_tx_descriptor(staged);
 }
 
 /**
@@ -1086,35 +1146,69 @@ static void xilinx_frmbuf_free_chan_resources(struct dma_chan *dchan)
 	xilinx_frmbuf_free_descriptors(chan);
 }
 
+/**
+ * xilinx_frmbuf_desc_len - Compute the length of a frame
+ * @desc: Frame descriptor
+ *
+ * Return: The number of bytes of the luma or packed plane of the frame.
+ */
+static u32 xilinx_frmbuf_desc_len(struct xilinx_frmbuf_tx_descriptor *desc)
+{
+	return desc->hw.stride * desc->hw.vsize;
+}
+
+/**
+ * xilinx_frmbuf_trace_callback - Trace the callback of a frame
+ * @desc: Frame descriptor
+ */
+static void
+xilinx_frmbuf_trace_callback(struct xilinx_frmbuf_tx_descriptor *desc)
+{
+	if (trace_xilinx_frmbuf_callback_enabled())
+		trace_xilinx_frmbuf_callback(desc->async_tx.chan,
+					     desc->async_tx.cookie,
+					     xilinx_frmbuf_desc_len(desc));
+}
+
 /**
  * xilinx_frmbuf_chan_desc_cleanup - Clean channel descriptors
  * @chan: Driver specific dma channel
  */
+
 static void xilinx_frmbuf_chan_desc_cleanup(struct xilinx_frmbuf_chan *chan)
 {
-	struct xilinx_frmbuf_tx_descriptor *desc, *next;
+	struct xilinx_frmbuf_tx_descriptor *desc;
 	unsigned long flags;
 
 	spin_lock_irqsave(&chan->lock, flags);
 
-	list_for_each_entry_safe(desc, next, &chan->done_list, node) {
+	while (!list_empty(&chan->done_list)) {
 		dma_async_tx_callback callback;
 		void *callback_param;
 
+		desc = list_first_entry(&chan->done_list,
+					struct xilinx_frmbuf_tx_descriptor,
+					node);
 		list_del(&desc->node);
+		spin_unlock_irqrestore(&chan->lock, flags);
+
+		/* Hand the frame to chained channels before its client */
+		if (desc->done_fence)
+			dma_fence_signal(desc->done_fence);
 
 		/* Run the link descriptor callback function */
 		callback = desc->async_tx.callback;
 		callback_param = desc->async_tx.callback_param;
 		if (callback) {
-			spin_unlock_irqrestore(&chan->lock, flags);
+			xilinx_frmbuf_trace_callback(desc);
 			callback(callback_param);
-			spin_lock_irqsave(&chan->lock, flags);
 		}
 
 		/* Run any dependencies, then free the descriptor */
 		dma_run_dependencies(&desc->async_tx);
-		kfree(desc);
+		xilinx_frmbuf_free_tx_descriptor(desc);
+
+		spin_lock_irqsave(&chan->lock, flags);
 	}
 
 	spin_unlock_irqrestore(&chan->lock, flags);
@@ -1200,6 +1294,10 @@ static void xilinx_frmbuf_complete_descriptor(struct xilinx_frmbuf_chan *chan)
 		desc->fid = frmbuf_read(chan, XILINX_FRMBUF_FID_OFFSET) &
 			    XILINX_FRMBUF_FID_MASK;
 
+	if (trace_xilinx_frmbuf_done_enabled())
+		trace_xilinx_frmbuf_done(&chan->common, desc->async_tx.cookie,
+					 xilinx_frmbuf_desc_len(desc));
+
 	dma_cookie_complete(&desc->async_tx);
 	list_add_tail(&desc->node, &chan->done_list);
 }
@@ -1230,6 +1328,15 @@ static void xilinx_frmbuf_start_transfer(struct xilinx_frmbuf_chan *chan)
 				struct xilinx_frmbuf_tx_descriptor,
 				node);
 
+	/*
+	 * Hold the frame back until its producer is done with it. The flag is
+	 * tested directly as dma_fence_is_signaled() may take the fence lock,
+	 * which nests outside of the channel lock.
+	 */
+	if (desc->wait_fence &&
+	    !test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &desc->wait_fence->flags))
+		return;
+
 	if (desc->earlycb == EARLY_CALLBACK_START_DESC) {
 		dma_async_tx_callback callback;
 		void *callback_param;
@@ -1237,6 +1344,7 @@ static void xilinx_frmbuf_start_transfer(struct xilinx_frmbuf_chan *chan)
 		callback = desc->async_tx.callback;
 		callback_param = desc->async_tx.callback_param;
 		if (callback) {
+			xilinx_frmbuf_trace_callback(desc);
 			callback(callback_param);
 			desc->async_tx.callback = NULL;
 			chan->active_desc = desc;
@@ -1267,6 +1375,10 @@ static void xilinx_frmbuf_start_transfer(struct xilinx_frmbuf_chan *chan)
 	if (chan->direction == DMA_MEM_TO_DEV && chan->hw_fid)
 		frmbuf_write(chan, XILINX_FRMBUF_FID_OFFSET, desc->fid);
 
+	if (trace_xilinx_frmbuf_start_enabled())
+		trace_xilinx_frmbuf_start(&chan->common, desc->async_tx.cookie,
+					  xilinx_frmbuf_desc_len(desc));
+
 	/* Start the hardware */
 	xilinx_frmbuf_start(chan);
 	list_del(&desc->node);
@@ -1292,6 +1404,107 @@ static void xilinx_frmbuf_issue_pending(struct dma_chan *dchan)
 	spin_unlock_irqrestore(&chan->lock, flags);
 }
 
+/* -----------------------------------------------------------------------------
+ * Frame fences
+ */
+
+static const char *xilinx_frmbuf_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "xilinx-frmbuf";
+}
+
+static const char *
+xilinx_frmbuf_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "frame";
+}
+
+static const struct dma_fence_ops xilinx_frmbuf_fence_ops = {
+	.get_driver_name = xilinx_frmbuf_fence_get_driver_name,
+	.get_timeline_name = xilinx_frmbuf_fence_get_timeline_name,
+};
+
+/**
+ * xilinx_frmbuf_wait_fence_cb - Start a frame once its wait fence signals
+ * @fence: Signalled fence
+ * @cb: Fence callback embedded in the waiting descriptor
+ */
+static void xilinx_frmbuf_wait_fence_cb(struct dma_fence *fence,
+					struct dma_fence_cb *cb)
+{
+	struct xilinx_frmbuf_tx_descriptor *desc =
+		container_of(cb, struct xilinx_frmbuf_tx_descriptor, wait_cb);
+	struct xilinx_frmbuf_chan *chan = to_xilinx_chan(desc->async_tx.chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	xilinx_frmbuf_start_transfer(chan);
+	spin_unlock_irqrestore(&chan->lock, flags);
+}
+
+struct dma_fence *xilinx_xdma_get_fence(struct dma_chan *chan,
+					struct dma_async_tx_descriptor *async_tx)
+{
+	struct xilinx_frmbuf_device *xdev;
+	struct xilinx_frmbuf_tx_descriptor *desc;
+	struct xilinx_frmbuf_fence *fence;
+
+	if (!async_tx)
+		return ERR_PTR(-EINVAL);
+
+	xdev = frmbuf_find_dev(chan);
+	if (IS_ERR(xdev))
+		return ERR_CAST(xdev);
+
+	desc = to_dma_tx_descriptor(async_tx);
+	if (!desc->done_fence) {
+		fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+		if (!fence)
+			return ERR_PTR(-ENOMEM);
+
+		/* Each frame completes on its own, give it its own context */
+		spin_lock_init(&fence->lock);
+		dma_fence_init(&fence->base, &xilinx_frmbuf_fence_ops,
+			       &fence->lock, dma_fence_context_alloc(1), 1);
+		desc->done_fence = &fence->base;
+	}
+
+	return dma_fence_get(desc->done_fence);
+}
+EXPORT_SYMBOL(xilinx_xdma_get_fence);
+
+int xilinx_xdma_set_fence(struct dma_chan *chan,
+			  struct dma_async_tx_descriptor *async_tx,
+			  struct dma_fence *fence)
+{
+	struct xilinx_frmbuf_device *xdev;
+	struct xilinx_frmbuf_tx_descriptor *desc;
+	int ret;
+
+	if (!async_tx || !fence)
+		return -EINVAL;
+
+	xdev = frmbuf_find_dev(chan);
+	if (IS_ERR(xdev))
+		return PTR_ERR(xdev);
+
+	desc = to_dma_tx_descriptor(async_tx);
+	if (fence == desc->done_fence)
+		return -EINVAL;
+	if (desc->wait_fence)
+		return -EBUSY;
+
+	desc->wait_fence = dma_fence_get(fence);
+	ret = dma_fence_add_callback(fence, &desc->wait_cb,
+				     xilinx_frmbuf_wait_fence_cb);
+	/* An already signalled fence does not hold the frame back */
+	if (ret == -ENOENT)
+		ret = 0;
+
+	return ret;
+}
+EXPORT_SYMBOL(xilinx_xdma_set_fence);
+
 /**
  * xilinx_frmbuf_reset - Reset frmbuf channel
  * @chan: Driver specific dma channel
@@ -1345,6 +1558,7 @@ static irqreturn_t xilinx_frmbuf_irq_handler(int irq, void *data)
 		callback = desc->async_tx.callback;
 		callback_param = desc->async_tx.callback_param;
 		if (callback) {
+			xilinx_frmbuf_trace_callback(desc);
 			callback(callback_param);
 			desc->async_tx.callback = NULL;
 		}
@@ -1405,6 +1619,9 @@ static dma_cookie_t xilinx_frmbuf_tx_submit(struct dma_async_tx_descriptor *tx)
 
 	spin_lock_irqsave(&chan->lock, flags);
 	cookie = dma_cookie_assign(tx);
+	if (trace_xilinx_frmbuf_submit_enabled())
+		trace_xilinx_frmbuf_submit(&chan->common, cookie,
+					   xilinx_frmbuf_desc_len(desc));
 	list_add_tail(&desc->node, &chan->pending_list);
 	spin_unlock_irqrestore(&chan->lock, flags);
 
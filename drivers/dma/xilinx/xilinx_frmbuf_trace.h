@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for Xilinx Framebuffer driver.
+ *
+ * Copyright (c) 2022 Advanced Micro Devices, Inc.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM xilinx_frmbuf
+
+#if !defined(_XILINX_FRMBUF_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _XILINX_FRMBUF_TRACE_H
+
+#include <linux/dmaengine.h>
+#include <linux/tracepoint.h>
+
+/*
+ * The life of a frame: submitted by the client, handed to the hardware,
+ * completed by the hardware and reported to the client by its callback,
+ * which runs early when the client asked for it. The events of a frame are
+ * paired by the channel name and the cookie, the bytes are the ones of the
+ * luma or packed plane.
+ */
+DECLARE_EVENT_CLASS(xilinx_frmbuf_desc,
+
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+
+	TP_ARGS(dchan, cookie, bytes),
+
+	TP_STRUCT__entry(
+		__string(name, dma_chan_name(dchan))
+		__field(dma_cookie_t, cookie)
+		__field(u32, bytes)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dma_chan_name(dchan));
+		__entry->cookie = cookie;
+		__entry->bytes = bytes;
+	),
+
+	TP_printk("chan=%s cookie=%d bytes=%u",
+		  __get_str(name), __entry->cookie, __entry->bytes)
+);
+
+DEFINE_EVENT(xilinx_frmbuf_desc, xilinx_frmbuf_submit,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(xilinx_frmbuf_desc, xilinx_frmbuf_start,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(xilinx_frmbuf_desc, xilinx_frmbuf_done,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(xilinx_frmbuf_desc, xilinx_frmbuf_callback,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+#endif /* _XILINX_FRMBUF_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE xilinx_frmbuf_trace
+
+#include <trace/define_trace.h>
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Synchronous memcpy offload for Xilinx DMA engines
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ *
+ * ZynqMP GDMA and AXI CDMA register their channels as public DMA_MEMCPY
+ * providers. This helper lets kernel code that copies large buffers in
+ * process context hand copies above a size threshold to one of those
+ * channels, while shorter ones and any failure fall back to the CPU.
+ */
+
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
+#include <linux/dma/xilinx_dma.h>
+#include <linux/dmaengine.h>
+#include <linux/jiffies.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+
+/* Time to wait for an offloaded copy before aborting it */
+#define XILINX_MEMCPY_OFFLOAD_TIMEOUT_MS	3000
+
+static unsigned int threshold_kb = 64;
+module_param(threshold_kb, uint, 0644);
+MODULE_PARM_DESC(threshold_kb,
+		 "Smallest copy in KiB handed to a DMA channel, 0 disables offload (default: 64)");
+
+static DEFINE_MUTEX(offload_lock);
+static bool offload_ready;
+
+/**
+ * xilinx_memcpy_offload_get - Take the dmaengine client reference
+ *
+ * The reference makes dmaengine publish its public channels through
+ * dma_find_channel(). It is taken on the first offloaded copy so that the
+ * channels stay powered down on systems that never use this helper.
+ */
+static void xilinx_memcpy_offload_get(void)
+{
+	if (READ_ONCE(offload_ready))
+		return;
+
+	mutex_lock(&offload_lock);
+	if (!offload_ready) {
+		dmaengine_get();
+		WRITE_ONCE(offload_ready, true);
+	}
+	mutex_unlock(&offload_lock);
+}
+
+static void xilinx_memcpy_offload_done(void *arg)
+{
+	complete(arg);
+}
+
+/**
+ * xilinx_memcpy_offload_dma - Copy a buffer with a DMA channel and wait
+ * @chan: DMA channel
+ * @dst: Destination buffer
+ * @src: Source buffer
+ * @len: Copy length
+ *
+ * Return: '0' on success and failure value on error
+ */
+static int xilinx_memcpy_offload_dma(struct dma_chan *chan, void *dst,
+				     const void *src, size_t len)
+{
+	struct device *dev = dmaengine_get_dma_device(chan);
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct dma_async_tx_descriptor *tx;
+	dma_addr_t dma_src, dma_dst;
+	dma_cookie_t cookie;
+	int ret = 0;
+
+	dma_src = dma_map_single(dev, (void *)src, len, DMA_TO_DEVICE);
+	if (dma_mapping_error(dev, dma_src))
+		return -ENOMEM;
+
+	dma_dst = dma_map_single(dev, dst, len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, dma_dst)) {
+		ret = -ENOMEM;
+		goto unmap_src;
+	}
+
+	tx = dmaengine_prep_dma_memcpy(chan, dma_dst, dma_src, len,
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!tx) {
+		ret = -EBUSY;
+		goto unmap_dst;
+	}
+
+	tx->callback = xilinx_memcpy_offload_done;
+	tx->callback_param = &done;
+	cookie = dmaengine_submit(tx);
+	if (dma_submit_error(cookie)) {
+		ret = -EIO;
+		goto unmap_dst;
+	}
+
+	dma_async_issue_pending(chan);
+	if (!wait_for_completion_timeout(&done,
+			msecs_to_jiffies(XILINX_MEMCPY_OFFLOAD_TIMEOUT_MS))) {
+		dev_err(dev, "memcpy offload on %s timed out\n",
+			dma_chan_name(chan));
+		/* Make sure the callback can no longer touch the stack */
+		dmaengine_terminate_sync(chan);
+		ret = -ETIMEDOUT;
+	}
+
+unmap_dst:
+	dma_unmap_single(dev, dma_dst, len, DMA_FROM_DEVICE);
+unmap_src:
+	dma_unmap_single(dev, dma_src, len, DMA_TO_DEVICE);
+	return ret;
+}
+
+/**
+ * xilinx_memcpy_offload - Copy a buffer, offloading large copies to DMA
+ * @dst: Destination buffer
+ * @src: Source buffer
+ * @len: Copy length
+ *
+ * Copies of at least threshold_kb KiB between linearly mapped kernel
+ * buffers are done by a public DMA_MEMCPY channel of the calling CPU.
+ * Anything else, including copies the channel cannot take because of its
+ * alignment constraints or a lack of descriptors, is done with memcpy().
+ * The buffers must not overlap.
+ *
+ * Context: Process context, may sleep.
+ */
+void xilinx_memcpy_offload(void *dst, const void *src, size_t len)
+{
+	size_t threshold = (size_t)READ_ONCE(threshold_kb) * SZ_1K;
+	struct dma_chan *chan;
+
+	might_sleep();
+
+	if (!threshold || len < threshold ||
+	    !virt_addr_valid(dst) || !virt_addr_valid(src) ||
+	    !virt_addr_valid(dst + len - 1) ||
+	    !virt_addr_valid(src + len - 1))
+		goto cpu_copy;
+
+	xilinx_memcpy_offload_get();
+	chan = dma_find_channel(DMA_MEMCPY);
+	if (!chan ||
+	    !is_dma_copy_aligned(chan->device, offset_in_page(src),
+				 offset_in_page(dst), len))
+		goto cpu_copy;
+
+	if (!xilinx_memcpy_offload_dma(chan, dst, src, len))
+		return;
+
+cpu_copy:
+	memcpy(dst, src, len);
+}
+EXPORT_SYMBOL_GPL(xilinx_memcpy_offload);
@@ -20,6 +20,9 @@
 
 #include "../dmaengine.h"
 
+#define CREATE_TRACE_POINTS
+#include "zynqmp_dma_trace.h"
+
 /* Register Offsets */
 #define ZYNQMP_DMA_ISR			0x100
 #define ZYNQMP_DMA_IMR			0x104
@@ -37,6 +40,10 @@
 #define ZYNQMP_DMA_DST_DSCR_WRD1	0x13C
 #define ZYNQMP_DMA_DST_DSCR_WRD2	0x140
 #define ZYNQMP_DMA_DST_DSCR_WRD3	0x144
+#define ZYNQMP_DMA_WR_ONLY_WORD0	0x148
+#define ZYNQMP_DMA_WR_ONLY_WORD1	0x14C
+#define ZYNQMP_DMA_WR_ONLY_WORD2	0x150
+#define ZYNQMP_DMA_WR_ONLY_WORD3	0x154
 #define ZYNQMP_DMA_SRC_START_LSB	0x158
 #define ZYNQMP_DMA_SRC_START_MSB	0x15C
 #define ZYNQMP_DMA_DST_START_LSB	0x160
@@ -62,6 +69,8 @@
 /* Control 0 register bit field definitions */
 #define ZYNQMP_DMA_OVR_FETCH		BIT(7)
 #define ZYNQMP_DMA_POINT_TYPE_SG	BIT(6)
+#define ZYNQMP_DMA_MODE			GENMASK(5, 4)
+#define ZYNQMP_DMA_MODE_WR_ONLY		BIT(4)
 #define ZYNQMP_DMA_RATE_CTRL_EN		BIT(3)
 
 /* Control 1 register bit field definitions */
@@ -114,9 +123,12 @@
 					ZYNQMP_DMA_INT_OVRFL | \
 					ZYNQMP_DMA_DST_DSCR_DONE)
 
-/* Max number of descriptors per channel */
+/* Default number of descriptors per channel, also the pool growth step */
 #define ZYNQMP_DMA_NUM_DESCS	32
 
+/* Default upper bound the descriptor pool of a channel may grow to */
+#define ZYNQMP_DMA_MAX_DESCS	1024
+
 /* Max transfer size per descriptor */
 #define ZYNQMP_DMA_MAX_TRANS_LEN	0x40000000
 
@@ -144,6 +156,16 @@
 #define tx_to_desc(tx)		container_of(tx, struct zynqmp_dma_desc_sw, \
 					     async_tx)
 
+static unsigned int num_descs = ZYNQMP_DMA_NUM_DESCS;
+module_param(num_descs, uint, 0444);
+MODULE_PARM_DESC(num_descs,
+		 "Initial number of descriptors per channel, overridden by xlnx,num-descs (default: 32)");
+
+static unsigned int max_descs = ZYNQMP_DMA_MAX_DESCS;
+module_param(max_descs, uint, 0444);
+MODULE_PARM_DESC(max_descs,
+		 "Number of descriptors a channel may grow to on demand (default: 1024)");
+
 /**
  * struct zynqmp_dma_desc_ll - Hw linked list descriptor
  * @addr: Buffer address
@@ -172,6 +194,8 @@ struct zynqmp_dma_desc_ll {
  * @src_p: Physical address of the src descriptor
  * @dst_v: Virtual address of the dst descriptor
  * @dst_p: Physical address of the dst descriptor
+ * @memset: Descriptor is part of a memset transaction
+ * @fill: Fill pattern of a memset transaction
  */
 struct zynqmp_dma_desc_sw {
 	u64 src;
@@ -184,6 +208,24 @@ struct zynqmp_dma_desc_sw {
 	dma_addr_t src_p;
 	struct zynqmp_dma_desc_ll *dst_v;
 	dma_addr_t dst_p;
+	bool memset;
+	u32 fill;
+};
+
+/**
+ * struct zynqmp_dma_desc_chunk - Block of descriptors added to a channel pool
+ * @node: Node in the channel chunk list
+ * @count: Number of descriptors in this chunk
+ * @desc_pool_v: Virtual base of the hw descriptors of this chunk
+ * @desc_pool_p: Physical base of the hw descriptors of this chunk
+ * @sw_desc_pool: SW descriptors of this chunk
+ */
+struct zynqmp_dma_desc_chunk {
+	struct list_head node;
+	u32 count;
+	void *desc_pool_v;
+	dma_addr_t desc_pool_p;
+	struct zynqmp_dma_desc_sw sw_desc_pool[];
 };
 
 /**
@@ -194,12 +236,12 @@ struct zynqmp_dma_desc_sw {
  * @pending_list: Descriptors waiting
  * @free_list: Descriptors free
  * @active_list: Descriptors active
- * @sw_desc_pool: SW descriptor pool
+ * @chunk_list: Descriptor chunks making up the pool
  * @done_list: Complete descriptors
  * @common: DMA common channel
- * @desc_pool_v: Statically allocated descriptor base
- * @desc_pool_p: Physical allocated descriptor base
  * @desc_free_cnt: Descriptor available count
+ * @desc_total: Number of descriptors in the pool
+ * @num_descs: Initial pool size and growth step
  * @dev: The dma device
  * @irq: Channel IRQ
  * @is_dmacoherent: Tells whether dma operations are coherent or not
@@ -218,12 +260,12 @@ struct zynqmp_dma_chan {
 	struct list_head pending_list;
 	struct list_head free_list;
 	struct list_head active_list;
-	struct zynqmp_dma_desc_sw *sw_desc_pool;
+	struct list_head chunk_list;
 	struct list_head done_list;
 	struct dma_chan common;
-	void *desc_pool_v;
-	dma_addr_t desc_pool_p;
 	u32 desc_free_cnt;
+	u32 desc_total;
+	u32 num_descs;
 	struct device *dev;
 	int irq;
 	bool is_dmacoherent;
@@ -292,18 +334,19 @@ static void zynqmp_dma_desc_config_eod(struct zynqmp_dma_chan *chan,
 /**
  * zynqmp_dma_config_sg_ll_desc - Configure the linked list descriptor
  * @chan: ZynqMP DMA channel pointer
- * @sdesc: Hw descriptor pointer
+ * @desc: Transaction descriptor pointer
  * @src: Source buffer address
  * @dst: Destination buffer address
  * @len: Transfer length
- * @prev: Previous hw descriptor pointer
+ * @prev: Previous transaction descriptor pointer
  */
 static void zynqmp_dma_config_sg_ll_desc(struct zynqmp_dma_chan *chan,
-				   struct zynqmp_dma_desc_ll *sdesc,
+				   struct zynqmp_dma_desc_sw *desc,
 				   dma_addr_t src, dma_addr_t dst, size_t len,
-				   struct zynqmp_dma_desc_ll *prev)
+				   struct zynqmp_dma_desc_sw *prev)
 {
-	struct zynqmp_dma_desc_ll *ddesc = sdesc + 1;
+	struct zynqmp_dma_desc_ll *sdesc = desc->src_v;
+	struct zynqmp_dma_desc_ll *ddesc = desc->dst_v;
 
 	sdesc->size = ddesc->size = len;
 	sdesc->addr = src;
@@ -315,12 +358,14 @@ static void zynqmp_dma_config_sg_ll_desc(struct zynqmp_dma_chan *chan,
 		ddesc->ctrl |= ZYNQMP_DMA_DESC_CTRL_COHRNT;
 	}
 
+	/*
+	 * The pool is made of several coherent chunks, so chain through the
+	 * bus addresses recorded in the sw descriptors instead of deriving
+	 * them from a single pool base.
+	 */
 	if (prev) {
-		dma_addr_t addr = chan->desc_pool_p +
-			    ((uintptr_t)sdesc - (uintptr_t)chan->desc_pool_v);
-		ddesc = prev + 1;
-		prev->nxtdscraddr = addr;
-		ddesc->nxtdscraddr = addr + ZYNQMP_DMA_DESC_SIZE(chan);
+		prev->src_v->nxtdscraddr = desc->src_p;
+		prev->dst_v->nxtdscraddr = desc->dst_p;
 	}
 }
 
@@ -359,6 +404,23 @@ static void zynqmp_dma_init(struct zynqmp_dma_chan *chan)
 	chan->idle = true;
 }
 
+/**
+ * zynqmp_dma_desc_len - Compute the length of a transaction
+ * @desc: First descriptor of the transaction
+ *
+ * Return: The number of bytes to transfer for the transaction.
+ */
+static u32 zynqmp_dma_desc_len(struct zynqmp_dma_desc_sw *desc)
+{
+	struct zynqmp_dma_desc_sw *child;
+	u32 len = desc->dst_v->size;
+
+	list_for_each_entry(child, &desc->tx_list, node)
+		len += child->dst_v->size;
+
+	return len;
+}
+
 /**
  * zynqmp_dma_tx_submit - Submit DMA transaction
  * @tx: Async transaction descriptor pointer
@@ -376,16 +438,26 @@ static dma_cookie_t zynqmp_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 	spin_lock_irqsave(&chan->lock, irqflags);
 	cookie = dma_cookie_assign(tx);
 
+	if (trace_zynqmp_dma_submit_enabled())
+		trace_zynqmp_dma_submit(&chan->common, cookie,
+					zynqmp_dma_desc_len(new));
+
 	if (!list_empty(&chan->pending_list)) {
 		desc = list_last_entry(&chan->pending_list,
 				     struct zynqmp_dma_desc_sw, node);
 		if (!list_empty(&desc->tx_list))
 			desc = list_last_entry(&desc->tx_list,
 					       struct zynqmp_dma_desc_sw, node);
-		desc->src_v->nxtdscraddr = new->src_p;
-		desc->src_v->ctrl &= ~ZYNQMP_DMA_DESC_CTRL_STOP;
-		desc->dst_v->nxtdscraddr = new->dst_p;
-		desc->dst_v->ctrl &= ~ZYNQMP_DMA_DESC_CTRL_STOP;
+		/*
+		 * Memset runs in write-only mode, which is a channel wide
+		 * setting, so it is never chained with other transactions.
+		 */
+		if (!desc->memset && !new->memset) {
+			desc->src_v->nxtdscraddr = new->src_p;
+			desc->src_v->ctrl &= ~ZYNQMP_DMA_DESC_CTRL_STOP;
+			desc->dst_v->nxtdscraddr = new->dst_p;
+			desc->dst_v->ctrl &= ~ZYNQMP_DMA_DESC_CTRL_STOP;
+		}
 	}
 
 	list_add_tail(&new->node, &chan->pending_list);
@@ -409,10 +481,11 @@ zynqmp_dma_get_descriptor(struct zynqmp_dma_chan *chan)
 	spin_lock_irqsave(&chan->lock, irqflags);
 	desc = list_first_entry(&chan->free_list,
 				struct zynqmp_dma_desc_sw, node);
-	list_del(&desc->node);
+	list_del_init(&desc->node);
 	spin_unlock_irqrestore(&chan->lock, irqflags);
 
 	INIT_LIST_HEAD(&desc->tx_list);
+	desc->memset = false;
 	/* Clear the src and dst descriptor memory */
 	memset((void *)desc->src_v, 0, ZYNQMP_DMA_DESC_SIZE(chan));
 	memset((void *)desc->dst_v, 0, ZYNQMP_DMA_DESC_SIZE(chan));
@@ -452,6 +525,97 @@ static void zynqmp_dma_free_desc_list(struct zynqmp_dma_chan *chan,
 		zynqmp_dma_free_descriptor(chan, desc);
 }
 
+/**
+ * zynqmp_dma_grow_desc_pool - Add a chunk of descriptors to the channel pool
+ * @chan: ZynqMP DMA channel pointer
+ * @count: Number of descriptors to add
+ * @gfp: Allocation flags
+ *
+ * Return: '0' on success and failure value on error
+ */
+static int zynqmp_dma_grow_desc_pool(struct zynqmp_dma_chan *chan, u32 count,
+				     gfp_t gfp)
+{
+	struct zynqmp_dma_desc_chunk *chunk;
+	struct zynqmp_dma_desc_sw *desc;
+	unsigned long irqflags;
+	u32 i;
+
+	chunk = kzalloc(struct_size(chunk, sw_desc_pool, count), gfp);
+	if (!chunk)
+		return -ENOMEM;
+
+	chunk->count = count;
+	chunk->desc_pool_v = dma_alloc_coherent(chan->dev,
+						(2 * ZYNQMP_DMA_DESC_SIZE(chan) *
+						count),
+						&chunk->desc_pool_p, gfp);
+	if (!chunk->desc_pool_v) {
+		kfree(chunk);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		desc = chunk->sw_desc_pool + i;
+		dma_async_tx_descriptor_init(&desc->async_tx, &chan->common);
+		desc->async_tx.tx_submit = zynqmp_dma_tx_submit;
+		desc->src_v = (struct zynqmp_dma_desc_ll *) (chunk->desc_pool_v +
+					(i * ZYNQMP_DMA_DESC_SIZE(chan) * 2));
+		desc->dst_v = (struct zynqmp_dma_desc_ll *) (desc->src_v + 1);
+		desc->src_p = chunk->desc_pool_p +
+				(i * ZYNQMP_DMA_DESC_SIZE(chan) * 2);
+		desc->dst_p = desc->src_p + ZYNQMP_DMA_DESC_SIZE(chan);
+	}
+
+	spin_lock_irqsave(&chan->lock, irqflags);
+	for (i = 0; i < count; i++)
+		list_add_tail(&chunk->sw_desc_pool[i].node, &chan->free_list);
+	list_add_tail(&chunk->node, &chan->chunk_list);
+	chan->desc_free_cnt += count;
+	chan->desc_total += count;
+	spin_unlock_irqrestore(&chan->lock, irqflags);
+
+	return 0;
+}
+
+/**
+ * zynqmp_dma_reserve_descs - Reserve descriptors for a new transaction
+ * @chan: ZynqMP DMA channel pointer
+ * @desc_cnt: Number of descriptors needed
+ *
+ * Grows the pool by at least num_descs descriptors at a time when it runs
+ * dry, up to the max_descs module parameter. This is called from the prep
+ * callbacks, which may run in atomic context, so the growth does not sleep.
+ *
+ * Return: true if @desc_cnt descriptors were reserved, false otherwise
+ */
+static bool zynqmp_dma_reserve_descs(struct zynqmp_dma_chan *chan,
+				     u32 desc_cnt)
+{
+	unsigned long irqflags;
+	u32 grow;
+
+	spin_lock_irqsave(&chan->lock, irqflags);
+	while (desc_cnt > chan->desc_free_cnt) {
+		if (chan->desc_total >= max_descs) {
+			spin_unlock_irqrestore(&chan->lock, irqflags);
+			return false;
+		}
+		grow = max(chan->num_descs, desc_cnt - chan->desc_free_cnt);
+		grow = min(grow, max_descs - chan->desc_total);
+		spin_unlock_irqrestore(&chan->lock, irqflags);
+
+		if (zynqmp_dma_grow_desc_pool(chan, grow, GFP_NOWAIT))
+			return false;
+
+		spin_lock_irqsave(&chan->lock, irqflags);
+	}
+	chan->desc_free_cnt -= desc_cnt;
+	spin_unlock_irqrestore(&chan->lock, irqflags);
+
+	return true;
+}
+
 /**
  * zynqmp_dma_alloc_chan_resources - Allocate channel resources
  * @dchan: DMA channel
@@ -461,48 +625,26 @@ static void zynqmp_dma_free_desc_list(struct zynqmp_dma_chan *chan,
 static int zynqmp_dma_alloc_chan_resources(struct dma_chan *dchan)
 {
 	struct zynqmp_dma_chan *chan = to_chan(dchan);
-	struct zynqmp_dma_desc_sw *desc;
-	int i, ret;
+	int ret;
 
 	ret = pm_runtime_resume_and_get(chan->dev);
 	if (ret < 0)
 		return ret;
 
-	chan->sw_desc_pool = kcalloc(ZYNQMP_DMA_NUM_DESCS, sizeof(*desc),
-				     GFP_KERNEL);
-	if (!chan->sw_desc_pool)
-		return -ENOMEM;
-
 	chan->idle = true;
-	chan->desc_free_cnt = ZYNQMP_DMA_NUM_DESCS;
+	chan->desc_free_cnt = 0;
+	chan->desc_total = 0;
 
 	INIT_LIST_HEAD(&chan->free_list);
+	INIT_LIST_HEAD(&chan->chunk_list);
 
-	for (i = 0; i < ZYNQMP_DMA_NUM_DESCS; i++) {
-		desc = chan->sw_desc_pool + i;
-		dma_async_tx_descriptor_init(&desc->async_tx, &chan->common);
-		desc->async_tx.tx_submit = zynqmp_dma_tx_submit;
-		list_add_tail(&desc->node, &chan->free_list);
-	}
-
-	chan->desc_pool_v = dma_alloc_coherent(chan->dev,
-					       (2 * ZYNQMP_DMA_DESC_SIZE(chan) *
-					       ZYNQMP_DMA_NUM_DESCS),
-					       &chan->desc_pool_p, GFP_KERNEL);
-	if (!chan->desc_pool_v)
-		return -ENOMEM;
-
-	for (i = 0; i < ZYNQMP_DMA_NUM_DESCS; i++) {
-		desc = chan->sw_desc_pool + i;
-		desc->src_v = (struct zynqmp_dma_desc_ll *) (chan->desc_pool_v +
-					(i * ZYNQMP_DMA_DESC_SIZE(chan) * 2));
-		desc->dst_v = (struct zynqmp_dma_desc_ll *) (desc->src_v + 1);
-		desc->src_p = chan->desc_pool_p +
-				(i * ZYNQMP_DMA_DESC_SIZE(chan) * 2);
-		desc->dst_p = desc->src_p + ZYNQMP_DMA_DESC_SIZE(chan);
+	ret = zynqmp_dma_grow_desc_pool(chan, chan->num_descs, GFP_KERNEL);
+	if (ret) {
+		pm_runtime_put(chan->dev);
+		return ret;
 	}
 
-	return ZYNQMP_DMA_NUM_DESCS;
+	return chan->desc_total;
 }
 
 /**
@@ -550,6 +692,31 @@ static void zynqmp_dma_config(struct zynqmp_dma_chan *chan)
 	writel(val, chan->regs + ZYNQMP_DMA_DATA_ATTR);
 }
 
+/**
+ * zynqmp_dma_config_mode - Select the channel mode for a transaction
+ * @chan: ZynqMP DMA channel pointer
+ * @desc: Transaction descriptor about to be started
+ *
+ * Memset uses the write-only mode, in which the channel writes the pattern
+ * held in the WR_ONLY_WORD registers instead of reading the source.
+ */
+static void zynqmp_dma_config_mode(struct zynqmp_dma_chan *chan,
+				   struct zynqmp_dma_desc_sw *desc)
+{
+	u32 val;
+
+	val = readl(chan->regs + ZYNQMP_DMA_CTRL0);
+	val &= ~ZYNQMP_DMA_MODE;
+	if (desc->memset) {
+		val |= ZYNQMP_DMA_MODE_WR_ONLY;
+		writel(desc->fill, chan->regs + ZYNQMP_DMA_WR_ONLY_WORD0);
+		writel(desc->fill, chan->regs + ZYNQMP_DMA_WR_ONLY_WORD1);
+		writel(desc->fill, chan->regs + ZYNQMP_DMA_WR_ONLY_WORD2);
+		writel(desc->fill, chan->regs + ZYNQMP_DMA_WR_ONLY_WORD3);
+	}
+	writel(val, chan->regs + ZYNQMP_DMA_CTRL0);
+}
+
 /**
  * zynqmp_dma_device_config - Zynqmp dma device configuration
  * @dchan: DMA channel
@@ -570,13 +737,39 @@ static int zynqmp_dma_device_config(struct dma_chan *dchan,
 	return 0;
 }
 
+/**
+ * zynqmp_dma_trace_start - Trace a transaction handed to the hardware
+ * @chan: ZynqMP DMA channel pointer
+ * @desc: First descriptor of the transaction
+ */
+static void zynqmp_dma_trace_start(struct zynqmp_dma_chan *chan,
+				   struct zynqmp_dma_desc_sw *desc)
+{
+	if (trace_zynqmp_dma_start_enabled())
+		trace_zynqmp_dma_start(&chan->common, desc->async_tx.cookie,
+				       zynqmp_dma_desc_len(desc));
+}
+
+/**
+ * zynqmp_dma_trace_callback - Trace the callback of a completed transaction
+ * @chan: ZynqMP DMA channel pointer
+ * @desc: First descriptor of the transaction
+ */
+static void zynqmp_dma_trace_callback(struct zynqmp_dma_chan *chan,
+				      struct zynqmp_dma_desc_sw *desc)
+{
+	if (trace_zynqmp_dma_callback_enabled())
+		trace_zynqmp_dma_callback(&chan->common, desc->async_tx.cookie,
+					  zynqmp_dma_desc_len(desc));
+}
+
 /**
  * zynqmp_dma_start_transfer - Initiate the new transfer
  * @chan: ZynqMP DMA channel pointer
  */
 static void zynqmp_dma_start_transfer(struct zynqmp_dma_chan *chan)
 {
-	struct zynqmp_dma_desc_sw *desc;
+	struct zynqmp_dma_desc_sw *desc, *iter, *next;
 
 	if (!chan->idle)
 		return;
@@ -588,7 +781,25 @@ static void zynqmp_dma_start_transfer(struct zynqmp_dma_chan *chan)
 	if (!desc)
 		return;
 
-	list_splice_tail_init(&chan->pending_list, &chan->active_list);
+	zynqmp_dma_config_mode(chan, desc);
+
+	/*
+	 * Only the transactions chained in hardware by tx_submit are started
+	 * together: either a single memset, or the run of copies up to the
+	 * next memset.
+	 */
+	if (desc->memset) {
+		zynqmp_dma_trace_start(chan, desc);
+		list_move_tail(&desc->node, &chan->active_list);
+	} else {
+		list_for_each_entry_safe(iter, next, &chan->pending_list,
+					 node) {
+			if (iter->memset)
+				break;
+			zynqmp_dma_trace_start(chan, iter);
+			list_move_tail(&iter->node, &chan->active_list);
+		}
+	}
 	zynqmp_dma_update_desc_to_ctrlr(chan, desc);
 	zynqmp_dma_start(chan);
 }
@@ -610,6 +821,7 @@ static void zynqmp_dma_chan_desc_cleanup(struct zynqmp_dma_chan *chan)
 
 		dmaengine_desc_get_callback(&desc->async_tx, &cb);
 		if (dmaengine_desc_callback_valid(&cb)) {
+			zynqmp_dma_trace_callback(chan, desc);
 			spin_unlock_irqrestore(&chan->lock, irqflags);
 			dmaengine_desc_callback_invoke(&cb, NULL);
 			spin_lock_irqsave(&chan->lock, irqflags);
@@ -634,6 +846,9 @@ static void zynqmp_dma_complete_descriptor(struct zynqmp_dma_chan *chan)
 					struct zynqmp_dma_desc_sw, node);
 	if (!desc)
 		return;
+	if (trace_zynqmp_dma_done_enabled())
+		trace_zynqmp_dma_done(&chan->common, desc->async_tx.cookie,
+				      zynqmp_dma_desc_len(desc));
 	list_del(&desc->node);
 	dma_cookie_complete(&desc->async_tx);
 	list_add_tail(&desc->node, &chan->done_list);
@@ -675,12 +890,19 @@ static void zynqmp_dma_free_descriptors(struct zynqmp_dma_chan *chan)
 static void zynqmp_dma_free_chan_resources(struct dma_chan *dchan)
 {
 	struct zynqmp_dma_chan *chan = to_chan(dchan);
+	struct zynqmp_dma_desc_chunk *chunk, *next;
 
 	zynqmp_dma_free_descriptors(chan);
-	dma_free_coherent(chan->dev,
-		(2 * ZYNQMP_DMA_DESC_SIZE(chan) * ZYNQMP_DMA_NUM_DESCS),
-		chan->desc_pool_v, chan->desc_pool_p);
-	kfree(chan->sw_desc_pool);
+	list_for_each_entry_safe(chunk, next, &chan->chunk_list, node) {
+		dma_free_coherent(chan->dev,
+			(2 * ZYNQMP_DMA_DESC_SIZE(chan) * chunk->count),
+			chunk->desc_pool_v, chunk->desc_pool_p);
+		list_del(&chunk->node);
+		kfree(chunk);
+	}
+	INIT_LIST_HEAD(&chan->free_list);
+	chan->desc_free_cnt = 0;
+	chan->desc_total = 0;
 	pm_runtime_mark_last_busy(chan->dev);
 	pm_runtime_put_autosuspend(chan->dev);
 }
@@ -821,34 +1043,27 @@ static struct dma_async_tx_descriptor *zynqmp_dma_prep_memcpy(
 				dma_addr_t dma_src, size_t len, ulong flags)
 {
 	struct zynqmp_dma_chan *chan;
-	struct zynqmp_dma_desc_sw *new, *first = NULL;
-	void *desc = NULL, *prev = NULL;
+	struct zynqmp_dma_desc_sw *new, *first = NULL, *prev = NULL;
 	size_t copy;
 	u32 desc_cnt;
-	unsigned long irqflags;
 
 	chan = to_chan(dchan);
 
 	desc_cnt = DIV_ROUND_UP(len, ZYNQMP_DMA_MAX_TRANS_LEN);
 
-	spin_lock_irqsave(&chan->lock, irqflags);
-	if (desc_cnt > chan->desc_free_cnt) {
-		spin_unlock_irqrestore(&chan->lock, irqflags);
+	if (!zynqmp_dma_reserve_descs(chan, desc_cnt)) {
 		dev_dbg(chan->dev, "chan %p descs are not available\n", chan);
 		return NULL;
 	}
-	chan->desc_free_cnt = chan->desc_free_cnt - desc_cnt;
-	spin_unlock_irqrestore(&chan->lock, irqflags);
 
 	do {
 		/* Allocate and populate the descriptor */
 		new = zynqmp_dma_get_descriptor(chan);
 
 		copy = min_t(size_t, len, ZYNQMP_DMA_MAX_TRANS_LEN);
-		desc = (struct zynqmp_dma_desc_ll *)new->src_v;
-		zynqmp_dma_config_sg_ll_desc(chan, desc, dma_src,
+		zynqmp_dma_config_sg_ll_desc(chan, new, dma_src,
 					     dma_dst, copy, prev);
-		prev = desc;
+		prev = new;
 		len -= copy;
 		dma_src += copy;
 		dma_dst += copy;
@@ -858,12 +1073,144 @@ static struct dma_async_tx_descriptor *zynqmp_dma_prep_memcpy(
 			list_add_tail(&new->node, &first->tx_list);
 	} while (len);
 
-	zynqmp_dma_desc_config_eod(chan, desc);
+	zynqmp_dma_desc_config_eod(chan, prev->src_v);
 	async_tx_ack(&first->async_tx);
 	first->async_tx.flags = (enum dma_ctrl_flags)flags;
 	return &first->async_tx;
 }
 
+/**
+ * zynqmp_dma_prep_memset - prepare descriptors for memset transaction
+ * @dchan: DMA channel
+ * @dma_dst: Destination buffer address
+ * @value: Fill value, only the low byte is used
+ * @len: Transfer length
+ * @flags: transfer ack flags
+ *
+ * The descriptors are laid out as for a copy of the destination onto
+ * itself. The channel is switched to write-only mode when the transaction
+ * starts, so the source side is never read.
+ *
+ * Return: Async transaction descriptor on success and NULL on failure
+ */
+static struct dma_async_tx_descriptor *zynqmp_dma_prep_memset(
+				struct dma_chan *dchan, dma_addr_t dma_dst,
+				int value, size_t len, ulong flags)
+{
+	struct dma_async_tx_descriptor *tx;
+	struct zynqmp_dma_desc_sw *first, *child;
+
+	tx = zynqmp_dma_prep_memcpy(dchan, dma_dst, dma_dst, len, flags);
+	if (!tx)
+		return NULL;
+
+	first = tx_to_desc(tx);
+	first->fill = (value & 0xff) * 0x01010101;
+	first->memset = true;
+	list_for_each_entry(child, &first->tx_list, node)
+		child->memset = true;
+
+	return tx;
+}
+
+/**
+ * zynqmp_dma_prep_memcpy_sg - prepare descriptors for a memcpy_sg transaction
+ * @dchan: DMA channel
+ * @dst_sg: Destination scatter list
+ * @dst_nents: Number of entries in destination scatter list
+ * @src_sg: Source scatter list
+ * @src_nents: Number of entries in source scatter list
+ * @flags: transfer ack flags
+ *
+ * The two lists are walked in parallel and every contiguous run common to
+ * both gets its own linked list descriptor, so the whole copy completes as
+ * a single transaction. If the lists differ in total length, only the
+ * shorter length is copied.
+ *
+ * Return: Async transaction descriptor on success and NULL on failure
+ */
+static struct dma_async_tx_descriptor *zynqmp_dma_prep_memcpy_sg(
+			struct dma_chan *dchan,
+			struct scatterlist *dst_sg, unsigned int dst_nents,
+			struct scatterlist *src_sg, unsigned int src_nents,
+			unsigned long flags)
+{
+	struct zynqmp_dma_chan *chan = to_chan(dchan);
+	struct zynqmp_dma_desc_sw *new, *first = NULL, *prev = NULL;
+	size_t dst_avail, src_avail, len;
+	dma_addr_t dma_dst, dma_src;
+	unsigned long irqflags;
+
+	if (!dst_nents || !src_nents || !dst_sg || !src_sg)
+		return NULL;
+
+	dst_avail = sg_dma_len(dst_sg);
+	src_avail = sg_dma_len(src_sg);
+
+	while (true) {
+		len = min_t(size_t, src_avail, dst_avail);
+		len = min_t(size_t, len, ZYNQMP_DMA_MAX_TRANS_LEN);
+		if (len) {
+			if (!zynqmp_dma_reserve_descs(chan, 1))
+				goto err;
+
+			dma_dst = sg_dma_address(dst_sg) + sg_dma_len(dst_sg) -
+				  dst_avail;
+			dma_src = sg_dma_address(src_sg) + sg_dma_len(src_sg) -
+				  src_avail;
+
+			new = zynqmp_dma_get_descriptor(chan);
+			zynqmp_dma_config_sg_ll_desc(chan, new, dma_src,
+						     dma_dst, len, prev);
+			prev = new;
+			if (!first)
+				first = new;
+			else
+				list_add_tail(&new->node, &first->tx_list);
+
+			dst_avail -= len;
+			src_avail -= len;
+		}
+
+		/* Fetch the next dst scatterlist entry */
+		if (!dst_avail) {
+			if (!--dst_nents)
+				break;
+			dst_sg = sg_next(dst_sg);
+			if (!dst_sg)
+				break;
+			dst_avail = sg_dma_len(dst_sg);
+		}
+
+		/* Fetch the next src scatterlist entry */
+		if (!src_avail) {
+			if (!--src_nents)
+				break;
+			src_sg = sg_next(src_sg);
+			if (!src_sg)
+				break;
+			src_avail = sg_dma_len(src_sg);
+		}
+	}
+
+	if (!first)
+		return NULL;
+
+	zynqmp_dma_desc_config_eod(chan, prev->src_v);
+	async_tx_ack(&first->async_tx);
+	first->async_tx.flags = (enum dma_ctrl_flags)flags;
+	return &first->async_tx;
+
+err:
+	dev_dbg(chan->dev, "chan %p descs are not available\n", chan);
+	if (first) {
+		spin_lock_irqsave(&chan->lock, irqflags);
+		zynqmp_dma_free_descriptor(chan, first);
+		spin_unlock_irqrestore(&chan->lock, irqflags);
+	}
+	return NULL;
+}
+
 /**
  * zynqmp_dma_chan_remove - Channel remove function
  * @chan: ZynqMP DMA channel pointer
@@ -920,6 +1267,14 @@ static int zynqmp_dma_chan_probe(struct zynqmp_dma_device *zdev,
 		return -EINVAL;
 	}
 
+	chan->num_descs = num_descs;
+	of_property_read_u32(node, "xlnx,num-descs", &chan->num_descs);
+	if (!chan->num_descs || chan->num_descs > max_descs) {
+		dev_err(zdev->dev, "invalid number of descriptors %u\n",
+			chan->num_descs);
+		return -EINVAL;
+	}
+
 	chan->is_dmacoherent =  of_property_read_bool(node, "dma-coherent");
 	zdev->chan = chan;
 	tasklet_setup(&chan->tasklet, zynqmp_dma_do_tasklet);
@@ -928,6 +1283,7 @@ static int zynqmp_dma_chan_probe(struct zynqmp_dma_device *zdev,
 	INIT_LIST_HEAD(&chan->pending_list);
 	INIT_LIST_HEAD(&chan->done_list);
 	INIT_LIST_HEAD(&chan->free_list);
+	INIT_LIST_HEAD(&chan->chunk_list);
 
 	dma_cookie_init(&chan->common);
 	chan->common.device = &zdev->common;
@@ -1068,9 +1424,13 @@ static int zynqmp_dma_probe(struct platform_device *pdev)
 		return ret;
 	}
 	dma_cap_set(DMA_MEMCPY, zdev->common.cap_mask);
+	dma_cap_set(DMA_MEMCPY_SG, zdev->common.cap_mask);
+	dma_cap_set(DMA_MEMSET, zdev->common.cap_mask);
 
 	p = &zdev->common;
 	p->device_prep_dma_memcpy = zynqmp_dma_prep_memcpy;
+	p->device_prep_dma_memcpy_sg = zynqmp_dma_prep_memcpy_sg;
+	p->device_prep_dma_memset = zynqmp_dma_prep_memset;
 	p->device_terminate_all = zynqmp_dma_device_terminate_all;
 	p->device_synchronize = zynqmp_dma_synchronize;
 	p->device_issue_pending = zynqmp_dma_issue_pending;
@@ -1094,6 +1454,8 @@ static int zynqmp_dma_probe(struct platform_device *pdev)
 	pm_runtime_set_autosuspend_delay(zdev->dev, ZDMA_PM_TIMEOUT);
 	pm_runtime_use_autosuspend(zdev->dev);
 	pm_runtime_enable(zdev->dev);
+	/* The clients are linked to the channels by fw_devlink */
+	device_enable_async_suspend(zdev->dev);
 	ret = pm_runtime_resume_and_get(zdev->dev);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "device wakeup failed.\n");
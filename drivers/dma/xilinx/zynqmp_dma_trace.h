@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for Xilinx ZynqMP DMA Engine driver.
+ *
+ * Copyright (c) 2022 Advanced Micro Devices, Inc.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM zynqmp_dma
+
+#if !defined(_ZYNQMP_DMA_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ZYNQMP_DMA_TRACE_H
+
+#include <linux/dmaengine.h>
+#include <linux/tracepoint.h>
+
+/*
+ * The life of a transaction: submitted by the client, handed to the
+ * hardware, accounted as done by the hardware and reported to the client by
+ * its callback. The events of a transaction are paired by the channel name
+ * and the cookie.
+ */
+DECLARE_EVENT_CLASS(zynqmp_dma_desc,
+
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+
+	TP_ARGS(dchan, cookie, bytes),
+
+	TP_STRUCT__entry(
+		__string(name, dma_chan_name(dchan))
+		__field(dma_cookie_t, cookie)
+		__field(u32, bytes)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dma_chan_name(dchan));
+		__entry->cookie = cookie;
+		__entry->bytes = bytes;
+	),
+
+	TP_printk("chan=%s cookie=%d bytes=%u",
+		  __get_str(name), __entry->cookie, __entry->bytes)
+);
+
+DEFINE_EVENT(zynqmp_dma_desc, zynqmp_dma_submit,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(zynqmp_dma_desc, zynqmp_dma_start,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(zynqmp_dma_desc, zynqmp_dma_done,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+DEFINE_EVENT(zynqmp_dma_desc, zynqmp_dma_callback,
+	TP_PROTO(struct dma_chan *dchan, dma_cookie_t cookie, u32 bytes),
+	TP_ARGS(dchan, cookie, bytes)
+);
+
+#endif /* _ZYNQMP_DMA_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE zynqmp_dma_trace
+
+#include <trace/define_trace.h>
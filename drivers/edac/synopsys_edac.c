@@ -6,18 +6,17 @@
  * Copyright (C) 2012 - 2014 Xilinx, Inc.
  */
 
+#include <linux/bitfield.h>
 #include <linux/edac.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/interrupt.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
+#include <linux/workqueue.h>
 
 #include "edac_module.h"
 
-/* Number of cs_rows needed per memory controller */
-#define SYNPS_EDAC_NR_CSROWS		1
-
 /* Number of channels per memory controller */
 #define SYNPS_EDAC_NR_CHANS		1
 
@@ -29,6 +28,11 @@
 #define SYNPS_EDAC_MOD_STRING		"synps_edac"
 #define SYNPS_EDAC_MOD_VER		"1"
 
+static uint check_msec = 1000;
+module_param(check_msec, uint, 0644);
+MODULE_PARM_DESC(check_msec,
+		 "ECC check interval in ms without interrupt (default: 1000)");
+
 /* Synopsys DDR memory controller registers that are relevant to ECC */
 #define CTRL_OFST			0x0
 #define T_ZQ_OFST			0xA4
@@ -204,6 +208,7 @@
 #define ECC_UEPOISON_MASK		0x1
 
 /* DDRC Device config masks */
+#define DDRC_MSTR_ACTIVE_RANKS_MASK	GENMASK(25, 24)
 #define DDRC_MSTR_CFG_MASK		0xC0000000
 #define DDRC_MSTR_CFG_SHIFT		30
 #define DDRC_MSTR_CFG_X4_MASK		0x0
@@ -272,6 +277,7 @@
  * @data:	Data causing the error.
  * @bankgrpnr:	Bank group number.
  * @blknr:	Block number.
+ * @rank:	Rank number.
  */
 struct ecc_error_info {
 	u32 row;
@@ -281,6 +287,7 @@ struct ecc_error_info {
 	u32 data;
 	u32 bankgrpnr;
 	u32 blknr;
+	u32 rank;
 };
 
 /**
@@ -305,6 +312,9 @@ struct synps_ecc_status {
  * @p_data:		Platform data.
  * @ce_cnt:		Correctable Error count.
  * @ue_cnt:		Uncorrectable Error count.
+ * @mci:		EDAC memory controller instance.
+ * @check_work:		Deferrable ECC status check of the controllers
+ *			without ECC interrupt.
  * @poison_addr:	Data poison address.
  * @row_shift:		Bit shifts for row bit.
  * @col_shift:		Bit shifts for column bit.
@@ -319,6 +329,8 @@ struct synps_edac_priv {
 	const struct synps_platform_data *p_data;
 	u32 ce_cnt;
 	u32 ue_cnt;
+	struct mem_ctl_info *mci;
+	struct delayed_work check_work;
 #ifdef CONFIG_EDAC_DEBUG
 	ulong poison_addr;
 	u32 row_shift[18];
@@ -335,6 +347,7 @@ struct synps_edac_priv {
  * @get_mtype:		Get mtype.
  * @get_dtype:		Get dtype.
  * @get_ecc_state:	Get ECC state.
+ * @get_nr_ranks:	Get the number of active ranks.
  * @quirks:		To differentiate IPs.
  */
 struct synps_platform_data {
@@ -342,6 +355,7 @@ struct synps_platform_data {
 	enum mem_type (*get_mtype)(const void __iomem *base);
 	enum dev_type (*get_dtype)(const void __iomem *base);
 	bool (*get_ecc_state)(void __iomem *base);
+	u32 (*get_nr_ranks)(const void __iomem *base);
 	int quirks;
 };
 
@@ -429,6 +443,7 @@ static int zynqmp_get_error_info(struct synps_edac_priv *priv)
 
 	regval = readl(base + ECC_CEADDR0_OFST);
 	p->ceinfo.row = (regval & ECC_CEADDR0_RW_MASK);
+	p->ceinfo.rank = !!(regval & ECC_CEADDR0_RNK_MASK);
 	regval = readl(base + ECC_CEADDR1_OFST);
 	p->ceinfo.bank = (regval & ECC_CEADDR1_BNKNR_MASK) >>
 					ECC_CEADDR1_BNKNR_SHIFT;
@@ -445,6 +460,7 @@ static int zynqmp_get_error_info(struct synps_edac_priv *priv)
 
 	regval = readl(base + ECC_UEADDR0_OFST);
 	p->ueinfo.row = (regval & ECC_CEADDR0_RW_MASK);
+	p->ueinfo.rank = !!(regval & ECC_CEADDR0_RNK_MASK);
 	regval = readl(base + ECC_UEADDR1_OFST);
 	p->ueinfo.bankgrpnr = (regval & ECC_CEADDR1_BNKGRP_MASK) >>
 					ECC_CEADDR1_BNKGRP_SHIFT;
@@ -466,7 +482,9 @@ static int zynqmp_get_error_info(struct synps_edac_priv *priv)
  * @mci:	EDAC memory controller instance.
  * @p:		Synopsys ECC status structure.
  *
- * Handles ECC correctable and uncorrectable errors.
+ * Handles ECC correctable and uncorrectable errors. The errors are accounted
+ * to the chip select row of their rank, whose ce_count and ue_count give the
+ * error rates of each rank over seconds_since_reset.
  */
 static void handle_error(struct mem_ctl_info *mci, struct synps_ecc_status *p)
 {
@@ -477,8 +495,8 @@ static void handle_error(struct mem_ctl_info *mci, struct synps_ecc_status *p)
 		pinf = &p->ceinfo;
 		if (priv->p_data->quirks & DDR_ECC_INTR_SUPPORT) {
 			snprintf(priv->message, SYNPS_EDAC_MSG_SIZE,
-				 "DDR ECC error type:%s Row %d Bank %d BankGroup Number %d Block Number %d Bit Position: %d Data: 0x%08x",
-				 "CE", pinf->row, pinf->bank,
+				 "DDR ECC error type:%s Rank %d Row %d Bank %d BankGroup Number %d Block Number %d Bit Position: %d Data: 0x%08x",
+				 "CE", pinf->rank, pinf->row, pinf->bank,
 				 pinf->bankgrpnr, pinf->blknr,
 				 pinf->bitpos, pinf->data);
 		} else {
@@ -489,7 +507,7 @@ static void handle_error(struct mem_ctl_info *mci, struct synps_ecc_status *p)
 		}
 
 		edac_mc_handle_error(HW_EVENT_ERR_CORRECTED, mci,
-				     priv->ce_cnt, 0, 0, 0, 0, 0, -1,
+				     p->ce_cnt, 0, 0, 0, pinf->rank, 0, -1,
 				     priv->message, "");
 	}
 
@@ -497,8 +515,8 @@ static void handle_error(struct mem_ctl_info *mci, struct synps_ecc_status *p)
 		pinf = &p->ueinfo;
 		if (priv->p_data->quirks & DDR_ECC_INTR_SUPPORT) {
 			snprintf(priv->message, SYNPS_EDAC_MSG_SIZE,
-				 "DDR ECC error type :%s Row %d Bank %d BankGroup Number %d Block Number %d",
-				 "UE", pinf->row, pinf->bank,
+				 "DDR ECC error type :%s Rank %d Row %d Bank %d BankGroup Number %d Block Number %d",
+				 "UE", pinf->rank, pinf->row, pinf->bank,
 				 pinf->bankgrpnr, pinf->blknr);
 		} else {
 			snprintf(priv->message, SYNPS_EDAC_MSG_SIZE,
@@ -507,7 +525,7 @@ static void handle_error(struct mem_ctl_info *mci, struct synps_ecc_status *p)
 		}
 
 		edac_mc_handle_error(HW_EVENT_ERR_UNCORRECTED, mci,
-				     priv->ue_cnt, 0, 0, 0, 0, 0, -1,
+				     p->ue_cnt, 0, 0, 0, pinf->rank, 0, -1,
 				     priv->message, "");
 	}
 
@@ -587,7 +605,7 @@ static irqreturn_t intr_handler(int irq, void *dev_id)
  * check_errors - Check controller for ECC errors.
  * @mci:	EDAC memory controller instance.
  *
- * Check and post ECC errors. Called by the polling thread.
+ * Check and post ECC errors. Called by the deferrable check work.
  */
 static void check_errors(struct mem_ctl_info *mci)
 {
@@ -610,6 +628,28 @@ static void check_errors(struct mem_ctl_info *mci)
 		 priv->ce_cnt, priv->ue_cnt);
 }
 
+/**
+ * check_work_fn - Check the controller for ECC errors in the background.
+ * @work:	Check work of the controller instance.
+ *
+ * The controllers without ECC interrupt keep counting the errors in their
+ * status register between two checks, only the addresses of all but the
+ * last error of each type are lost. Unlike the polling of the EDAC core, the
+ * check is deferrable: it never wakes an idle CPU by itself but runs with the
+ * next wake up past the interval, batched with the other deferred timers.
+ */
+static void check_work_fn(struct work_struct *work)
+{
+	struct synps_edac_priv *priv = container_of(to_delayed_work(work),
+						    struct synps_edac_priv,
+						    check_work);
+
+	check_errors(priv->mci);
+
+	queue_delayed_work(system_power_efficient_wq, &priv->check_work,
+			   msecs_to_jiffies(READ_ONCE(check_msec)));
+}
+
 /**
  * zynq_get_dtype - Return the controller memory width.
  * @base:	DDR memory controller base address.
@@ -723,6 +763,33 @@ static bool zynqmp_get_ecc_state(void __iomem *base)
 	return false;
 }
 
+/**
+ * zynq_get_nr_ranks - Return the number of active ranks.
+ * @base:	DDR memory controller base address.
+ *
+ * Return: one, the controller supports a single rank.
+ */
+static u32 zynq_get_nr_ranks(const void __iomem *base)
+{
+	return 1;
+}
+
+/**
+ * zynqmp_get_nr_ranks - Return the number of active ranks.
+ * @base:	DDR memory controller base address.
+ *
+ * Return: two if the second rank is active, otherwise one.
+ */
+static u32 zynqmp_get_nr_ranks(const void __iomem *base)
+{
+	u32 ranks;
+
+	ranks = FIELD_GET(DDRC_MSTR_ACTIVE_RANKS_MASK,
+			  readl(base + CTRL_OFST));
+
+	return ranks & BIT(1) ? 2 : 1;
+}
+
 /**
  * get_memsize - Read the size of the attached memory device.
  *
@@ -809,7 +876,8 @@ static void init_csrows(struct mem_ctl_info *mci)
 
 	for (row = 0; row < mci->nr_csrows; row++) {
 		csi = mci->csrows[row];
-		size = get_memsize();
+		/* One row per rank, assume the ranks have the same size */
+		size = get_memsize() / mci->nr_csrows;
 
 		for (j = 0; j < csi->nr_channels; j++) {
 			dimm		= csi->channels[j]->dimm;
@@ -853,8 +921,9 @@ static void mc_init(struct mem_ctl_info *mci, struct platform_device *pdev)
 	if (priv->p_data->quirks & DDR_ECC_INTR_SUPPORT) {
 		edac_op_state = EDAC_OPSTATE_INT;
 	} else {
+		/* Checked by check_work_fn() rather than the EDAC core */
 		edac_op_state = EDAC_OPSTATE_POLL;
-		mci->edac_check = check_errors;
+		INIT_DEFERRABLE_WORK(&priv->check_work, check_work_fn);
 	}
 
 	mci->ctl_page_to_phys = NULL;
@@ -892,6 +961,7 @@ static const struct synps_platform_data zynq_edac_def = {
 	.get_mtype	= zynq_get_mtype,
 	.get_dtype	= zynq_get_dtype,
 	.get_ecc_state	= zynq_get_ecc_state,
+	.get_nr_ranks	= zynq_get_nr_ranks,
 	.quirks		= 0,
 };
 
@@ -900,6 +970,7 @@ static const struct synps_platform_data zynqmp_edac_def = {
 	.get_mtype	= zynqmp_get_mtype,
 	.get_dtype	= zynqmp_get_dtype,
 	.get_ecc_state	= zynqmp_get_ecc_state,
+	.get_nr_ranks	= zynqmp_get_nr_ranks,
 	.quirks         = (DDR_ECC_INTR_SUPPORT
 #ifdef CONFIG_EDAC_DEBUG
 			  | DDR_ECC_DATA_POISON_SUPPORT
@@ -912,6 +983,7 @@ static const struct synps_platform_data synopsys_edac_def = {
 	.get_mtype	= zynqmp_get_mtype,
 	.get_dtype	= zynqmp_get_dtype,
 	.get_ecc_state	= zynqmp_get_ecc_state,
+	.get_nr_ranks	= zynqmp_get_nr_ranks,
 	.quirks         = (DDR_ECC_INTR_SUPPORT | DDR_ECC_INTR_SELF_CLEAR
 #ifdef CONFIG_EDAC_DEBUG
 			  | DDR_ECC_DATA_POISON_SUPPORT
@@ -1343,7 +1415,7 @@ static int mc_probe(struct platform_device *pdev)
 	}
 
 	layers[0].type = EDAC_MC_LAYER_CHIP_SELECT;
-	layers[0].size = SYNPS_EDAC_NR_CSROWS;
+	layers[0].size = p_data->get_nr_ranks(baseaddr);
 	layers[0].is_virt_csrow = true;
 	layers[1].type = EDAC_MC_LAYER_CHANNEL;
 	layers[1].size = SYNPS_EDAC_NR_CHANS;
@@ -1360,6 +1432,7 @@ static int mc_probe(struct platform_device *pdev)
 	priv = mci->pvt_info;
 	priv->baseaddr = baseaddr;
 	priv->p_data = p_data;
+	priv->mci = mci;
 
 	mc_init(mci, pdev);
 
@@ -1394,8 +1467,11 @@ static int mc_probe(struct platform_device *pdev)
 	 * Start capturing the correctable and uncorrectable errors. A write of
 	 * 0 starts the counters.
 	 */
-	if (!(priv->p_data->quirks & DDR_ECC_INTR_SUPPORT))
+	if (!(priv->p_data->quirks & DDR_ECC_INTR_SUPPORT)) {
 		writel(0x0, baseaddr + ECC_CTRL_OFST);
+		queue_delayed_work(system_power_efficient_wq, &priv->check_work,
+				   msecs_to_jiffies(check_msec));
+	}
 
 	return rc;
 
@@ -1418,6 +1494,8 @@ static int mc_remove(struct platform_device *pdev)
 
 	if (priv->p_data->quirks & DDR_ECC_INTR_SUPPORT)
 		disable_intr(priv);
+	else
+		cancel_delayed_work_sync(&priv->check_work);
 
 #ifdef CONFIG_EDAC_DEBUG
 	if (priv->p_data->quirks & DDR_ECC_DATA_POISON_SUPPORT)
@@ -11,9 +11,12 @@
  */
 
 #include <linux/compiler.h>
+#include <linux/hashtable.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/debugfs.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
 
 #include <linux/firmware/xlnx-zynqmp.h>
@@ -71,6 +74,30 @@ static struct pm_api_info pm_api_list[] = {
 
 static struct dentry *firmware_debugfs_root;
 
+/* Upper bounds of the buckets of the firmware call latency histogram */
+static const u32 pm_api_latency_buckets_us[] = { 1, 2, 5, 10, 20, 50, 100 };
+
+/**
+ * struct pm_api_stats - Statistics of the calls of a PM-API
+ * @hentry:	Entry in pm_api_stats_map
+ * @api_id:	PM-API ID
+ * @count:	Number of calls
+ * @total_ns:	Total duration of the calls
+ * @max_ns:	Longest call
+ * @hist:	Number of calls per latency bucket
+ */
+struct pm_api_stats {
+	struct hlist_node hentry;
+	u32 api_id;
+	u64 count;
+	u64 total_ns;
+	u64 max_ns;
+	u64 hist[ARRAY_SIZE(pm_api_latency_buckets_us) + 1];
+};
+
+static DEFINE_HASHTABLE(pm_api_stats_map, 7);
+static DEFINE_SPINLOCK(pm_api_stats_lock);
+
 /**
  * zynqmp_pm_self_suspend - PM call for master to suspend itself
  * @node:	Node ID of the master or subsystem
@@ -493,6 +520,97 @@ static const struct file_operations fops_zynqmp_pm_dbgfs = {
 	.read = zynqmp_pm_debugfs_api_read,
 };
 
+/**
+ * zynqmp_pm_api_account - Account for a firmware call
+ * @pm_api_id:	PM-API ID of the call
+ * @ns:		Duration of the call
+ *
+ * Context: Any context.
+ */
+void zynqmp_pm_api_account(u32 pm_api_id, u64 ns)
+{
+	struct pm_api_stats *stats;
+	unsigned long flags;
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int i;
+
+	spin_lock_irqsave(&pm_api_stats_lock, flags);
+
+	hash_for_each_possible(pm_api_stats_map, stats, hentry, pm_api_id)
+		if (stats->api_id == pm_api_id)
+			goto found;
+
+	/* Firmware calls can be made with spinlocks held */
+	stats = kzalloc(sizeof(*stats), GFP_ATOMIC);
+	if (!stats)
+		goto unlock;
+
+	stats->api_id = pm_api_id;
+	hash_add(pm_api_stats_map, &stats->hentry, pm_api_id);
+
+found:
+	for (i = 0; i < ARRAY_SIZE(pm_api_latency_buckets_us); i++)
+		if (us < pm_api_latency_buckets_us[i])
+			break;
+
+	stats->hist[i]++;
+	stats->count++;
+	stats->total_ns += ns;
+	stats->max_ns = max(stats->max_ns, ns);
+unlock:
+	spin_unlock_irqrestore(&pm_api_stats_lock, flags);
+}
+
+static const char *get_pm_api_name(u32 pm_id)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pm_api_list); i++)
+		if (pm_api_list[i].api_id == pm_id)
+			return pm_api_list[i].api_name;
+
+	return NULL;
+}
+
+/**
+ * zynqmp_pm_stats_show - Show the statistics of the firmware calls
+ * @m:		seq_file to print to
+ * @v:		Unused
+ *
+ * Return:	Returns 0
+ */
+static int zynqmp_pm_stats_show(struct seq_file *m, void *v)
+{
+	struct pm_api_stats *stats;
+	const char *name;
+	int bkt, i;
+
+	seq_printf(m, "%-32s %8s %8s %8s", "api", "count", "avg_ns", "max_ns");
+	for (i = 0; i < ARRAY_SIZE(pm_api_latency_buckets_us); i++)
+		seq_printf(m, "  <%uus", pm_api_latency_buckets_us[i]);
+	seq_puts(m, "  more\n");
+
+	spin_lock_irq(&pm_api_stats_lock);
+	hash_for_each(pm_api_stats_map, bkt, stats, hentry) {
+		name = get_pm_api_name(stats->api_id);
+		if (name)
+			seq_printf(m, "%-32s", name);
+		else
+			seq_printf(m, "%#-32x", stats->api_id);
+
+		seq_printf(m, " %8llu %8llu %8llu", stats->count,
+			   div64_u64(stats->total_ns, stats->count),
+			   stats->max_ns);
+		for (i = 0; i < ARRAY_SIZE(stats->hist); i++)
+			seq_printf(m, " %6llu", stats->hist[i]);
+		seq_putc(m, '\n');
+	}
+	spin_unlock_irq(&pm_api_stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(zynqmp_pm_stats);
+
 /**
  * zynqmp_pm_api_debugfs_init - Initialize debugfs interface
  *
@@ -504,6 +622,8 @@ void zynqmp_pm_api_debugfs_init(void)
 	firmware_debugfs_root = debugfs_create_dir("zynqmp-firmware", NULL);
 	debugfs_create_file("pm", 0660, firmware_debugfs_root, NULL,
 			    &fops_zynqmp_pm_dbgfs);
+	debugfs_create_file("pm_stats", 0400, firmware_debugfs_root, NULL,
+			    &zynqmp_pm_stats_fops);
 }
 
 /**
@@ -513,5 +633,16 @@ void zynqmp_pm_api_debugfs_init(void)
  */
 void zynqmp_pm_api_debugfs_exit(void)
 {
+	struct pm_api_stats *stats;
+	struct hlist_node *tmp;
+	int bkt;
+
 	debugfs_remove_recursive(firmware_debugfs_root);
+
+	spin_lock_irq(&pm_api_stats_lock);
+	hash_for_each_safe(pm_api_stats_map, bkt, tmp, stats, hentry) {
+		hash_del(&stats->hentry);
+		kfree(stats);
+	}
+	spin_unlock_irq(&pm_api_stats_lock);
 }
@@ -16,9 +16,11 @@
 #if IS_REACHABLE(CONFIG_ZYNQMP_FIRMWARE_DEBUG)
 void zynqmp_pm_api_debugfs_init(void);
 void zynqmp_pm_api_debugfs_exit(void);
+void zynqmp_pm_api_account(u32 pm_api_id, u64 ns);
 #else
 static inline void zynqmp_pm_api_debugfs_init(void) { }
 static inline void zynqmp_pm_api_debugfs_exit(void) { }
+static inline void zynqmp_pm_api_account(u32 pm_api_id, u64 ns) { }
 #endif
 
 #endif /* __FIRMWARE_ZYNQMP_DEBUG_H__ */
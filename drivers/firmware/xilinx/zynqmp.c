@@ -17,21 +17,35 @@
 #include <linux/dma-mapping.h>
 #include <linux/firmware.h>
 #include <linux/init.h>
+#include <linux/jhash.h>
+#include <linux/ktime.h>
 #include <linux/mfd/core.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
 #include <linux/hashtable.h>
 
 #include <linux/firmware/xlnx-zynqmp.h>
+#include <linux/firmware/xlnx-zynqmp-batch.h>
 #include <linux/firmware/xlnx-event-manager.h>
 #include "zynqmp-debug.h"
 
 /* Max HashMap Order for PM API feature check (1<<7 = 128) */
 #define PM_API_FEATURE_CHECK_MAX_ORDER  7
 
+/* Max HashMap Order for the query result cache (1<<9 = 512) */
+#define PM_QUERY_CACHE_MAX_ORDER	9
+/* Max number of cached query results */
+#define PM_QUERY_CACHE_MAX_ENTRIES	4096
+
+/* The cached result never changes */
+#define PM_QUERY_CACHE_IMMUTABLE	BIT(0)
+/* The result is cached whatever the status of the call */
+#define PM_QUERY_CACHE_ANY_STATUS	BIT(1)
+
 /* CRL registers and bitfields */
 #define CRL_APB_BASE			0xFF5E0000U
 /* BOOT_PIN_CTRL- Used to control the mode pins after boot */
@@ -54,6 +68,13 @@ static u32 query_features[FEATURE_PAYLOAD_SIZE];
 
 static unsigned long register_address;
 static struct platform_device *em_dev;
+static struct device *zynqmp_fw_dev;
+
+static DEFINE_HASHTABLE(pm_query_cache_map, PM_QUERY_CACHE_MAX_ORDER);
+static DEFINE_SPINLOCK(pm_query_cache_lock);
+static unsigned int pm_query_cache_entries;
+/* Bumped whenever a clock result may have changed */
+static atomic_t pm_query_cache_gen;
 
 static char image_name[NAME_MAX];
 
@@ -67,6 +88,24 @@ struct zynqmp_devinfo {
 	u32 feature_conf_id;
 };
 
+/**
+ * struct pm_query_cache_entry - Cached result of a PM API query
+ * @hentry:		Hashmap entry
+ * @key:		PM API ID followed by the arguments of the query
+ * @gen:		Value of pm_query_cache_gen when the query was made
+ * @flags:		PM_QUERY_CACHE_* flags
+ * @ret:		Status of the query
+ * @ret_payload:	Returned value array of the query
+ */
+struct pm_query_cache_entry {
+	struct hlist_node hentry;
+	u32 key[5];
+	int gen;
+	u32 flags;
+	int ret;
+	u32 ret_payload[PAYLOAD_ARG_CNT];
+};
+
 /**
  * struct pm_api_feature_data - PM API Feature data
  * @pm_api_id:		PM API Id, used as key to index into hashmap
@@ -187,6 +226,36 @@ static noinline int do_fw_call_hvc(u64 arg0, u64 arg1, u64 arg2, u64 arg3,
 	return zynqmp_pm_ret_code((enum pm_ret_status)res.a0);
 }
 
+/**
+ * zynqmp_pm_fw_call() - Call the firmware and account for the call
+ * @pm_api_id:		PM-API ID of the call
+ * @arg0:		Argument 0 to the call
+ * @arg1:		Argument 1 to the call
+ * @arg2:		Argument 2 to the call
+ * @arg3:		Argument 3 to the call
+ * @ret_payload:	Returned value array
+ *
+ * The number and the latency of the calls per PM-API ID are exported
+ * through debugfs when CONFIG_ZYNQMP_FIRMWARE_DEBUG is enabled.
+ *
+ * Return: Returns status, either success or error+reason
+ */
+static int zynqmp_pm_fw_call(u32 pm_api_id, u64 arg0, u64 arg1, u64 arg2,
+			     u64 arg3, u32 *ret_payload)
+{
+	u64 start;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_ZYNQMP_FIRMWARE_DEBUG))
+		return do_fw_call(arg0, arg1, arg2, arg3, ret_payload);
+
+	start = ktime_get_ns();
+	ret = do_fw_call(arg0, arg1, arg2, arg3, ret_payload);
+	zynqmp_pm_api_account(pm_api_id, ktime_get_ns() - start);
+
+	return ret;
+}
+
 static int __do_feature_check_call(const u32 api_id, u32 *ret_payload)
 {
 	int ret;
@@ -195,7 +264,8 @@ static int __do_feature_check_call(const u32 api_id, u32 *ret_payload)
 	smc_arg[0] = PM_SIP_SVC | PM_FEATURE_CHECK;
 	smc_arg[1] = api_id;
 
-	ret = do_fw_call(smc_arg[0], smc_arg[1], 0, 0, ret_payload);
+	ret = zynqmp_pm_fw_call(PM_FEATURE_CHECK, smc_arg[0], smc_arg[1], 0, 0,
+				ret_payload);
 	if (ret)
 		ret = -EOPNOTSUPP;
 	else
@@ -302,6 +372,19 @@ int zynqmp_pm_is_function_supported(const u32 api_id, const u32 id)
 }
 EXPORT_SYMBOL_GPL(zynqmp_pm_is_function_supported);
 
+/**
+ * zynqmp_pm_query_cache_invalidate() - Invalidate the cached clock results
+ *
+ * The results of the immutable queries, such as the clock topology, are
+ * kept. To be called when the firmware notifies that another master may
+ * have changed the clock settings.
+ */
+void zynqmp_pm_query_cache_invalidate(void)
+{
+	atomic_inc(&pm_query_cache_gen);
+}
+EXPORT_SYMBOL_GPL(zynqmp_pm_query_cache_invalidate);
+
 /**
  * zynqmp_pm_invoke_fn() - Invoke the system-level platform management layer
  *			   caller function depending on the configuration
@@ -349,9 +432,311 @@ int zynqmp_pm_invoke_fn(u32 pm_api_id, u32 arg0, u32 arg1,
 	smc_arg[2] = ((u64)arg3 << 32) | arg2;
 	smc_arg[3] = ((u64)arg4);
 
-	return do_fw_call(smc_arg[0], smc_arg[1], smc_arg[2], smc_arg[3],
-			  ret_payload);
+	ret = zynqmp_pm_fw_call(pm_api_id, smc_arg[0], smc_arg[1], smc_arg[2],
+				smc_arg[3], ret_payload);
+
+	/*
+	 * Changing a rate, divider, parent or PLL setting changes the results
+	 * of the clock queries of this clock and of its whole subtree. A batch
+	 * may contain any of these.
+	 */
+	switch (pm_api_id) {
+	case PM_IOCTL:
+		if (arg1 != IOCTL_SET_PLL_FRAC_MODE &&
+		    arg1 != IOCTL_SET_PLL_FRAC_DATA)
+			break;
+		fallthrough;
+	case PM_CLOCK_SETRATE:
+	case PM_CLOCK_SETDIVIDER:
+	case PM_CLOCK_SETPARENT:
+	case PM_BATCH:
+		zynqmp_pm_query_cache_invalidate();
+		break;
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+/**
+ * zynqmp_pm_invoke_cached() - Invoke a PM API query through the cache
+ * @pm_api_id:		Requested PM-API call
+ * @arg0:		Argument 0 to requested PM-API call
+ * @arg1:		Argument 1 to requested PM-API call
+ * @arg2:		Argument 2 to requested PM-API call
+ * @arg3:		Argument 3 to requested PM-API call
+ * @flags:		PM_QUERY_CACHE_* flags
+ * @ret_payload:	Returned value array
+ *
+ * Successful results are cached, along with the failed ones when
+ * PM_QUERY_CACHE_ANY_STATUS is set. Unless PM_QUERY_CACHE_IMMUTABLE is set,
+ * a cached result is only used until the next call of
+ * zynqmp_pm_query_cache_invalidate().
+ *
+ * Return: Returns status, either success or error+reason
+ */
+static int zynqmp_pm_invoke_cached(u32 pm_api_id, u32 arg0, u32 arg1,
+				   u32 arg2, u32 arg3, u32 flags,
+				   u32 *ret_payload)
+{
+	u32 key[5] = { pm_api_id, arg0, arg1, arg2, arg3 };
+	struct pm_query_cache_entry *entry;
+	u32 hash = jhash2(key, ARRAY_SIZE(key), 0);
+	unsigned long irqflags;
+	int gen, ret;
+
+	if (!ret_payload)
+		return zynqmp_pm_invoke_fn(pm_api_id, arg0, arg1, arg2, arg3, 0,
+					   NULL);
+
+	spin_lock_irqsave(&pm_query_cache_lock, irqflags);
+	gen = atomic_read(&pm_query_cache_gen);
+	hash_for_each_possible(pm_query_cache_map, entry, hentry, hash) {
+		if (memcmp(entry->key, key, sizeof(key)))
+			continue;
+
+		if (!(entry->flags & PM_QUERY_CACHE_IMMUTABLE) &&
+		    entry->gen != gen)
+			break;
+
+		memcpy(ret_payload, entry->ret_payload,
+		       sizeof(entry->ret_payload));
+		ret = entry->ret;
+		spin_unlock_irqrestore(&pm_query_cache_lock, irqflags);
+		return ret;
+	}
+	spin_unlock_irqrestore(&pm_query_cache_lock, irqflags);
+
+	/*
+	 * The generation is sampled before the call, so that a result racing
+	 * with an invalidation is stale from the start.
+	 */
+	ret = zynqmp_pm_invoke_fn(pm_api_id, arg0, arg1, arg2, arg3, 0,
+				  ret_payload);
+	if (ret && !(flags & PM_QUERY_CACHE_ANY_STATUS))
+		return ret;
+
+	spin_lock_irqsave(&pm_query_cache_lock, irqflags);
+	hash_for_each_possible(pm_query_cache_map, entry, hentry, hash)
+		if (!memcmp(entry->key, key, sizeof(key)))
+			goto update;
+
+	if (pm_query_cache_entries == PM_QUERY_CACHE_MAX_ENTRIES)
+		goto unlock;
+
+	/* Queries are made from atomic context, e.g. by clk_enable() */
+	entry = kmalloc(sizeof(*entry), GFP_ATOMIC);
+	if (!entry)
+		goto unlock;
+
+	memcpy(entry->key, key, sizeof(key));
+	hash_add(pm_query_cache_map, &entry->hentry, hash);
+	pm_query_cache_entries++;
+update:
+	entry->gen = gen;
+	entry->flags = flags;
+	entry->ret = ret;
+	memcpy(entry->ret_payload, ret_payload, sizeof(entry->ret_payload));
+unlock:
+	spin_unlock_irqrestore(&pm_query_cache_lock, irqflags);
+
+	return ret;
+}
+
+static void zynqmp_pm_query_cache_free(void)
+{
+	struct pm_query_cache_entry *entry;
+	struct hlist_node *tmp;
+	unsigned long irqflags;
+	int i;
+
+	spin_lock_irqsave(&pm_query_cache_lock, irqflags);
+	hash_for_each_safe(pm_query_cache_map, i, tmp, entry, hentry) {
+		hash_del(&entry->hentry);
+		kfree(entry);
+	}
+	pm_query_cache_entries = 0;
+	spin_unlock_irqrestore(&pm_query_cache_lock, irqflags);
+}
+
+/**
+ * struct zynqmp_pm_batch - Batch of EEMI commands
+ * @cmds:	Commands, in memory shared with the firmware
+ * @dma:	DMA address of @cmds
+ * @num_cmds:	Number of queued commands
+ * @max_cmds:	Maximum number of commands
+ */
+struct zynqmp_pm_batch {
+	struct zynqmp_pm_batch_cmd *cmds;
+	dma_addr_t dma;
+	unsigned int num_cmds;
+	unsigned int max_cmds;
+};
+
+/**
+ * zynqmp_pm_batch_alloc() - Allocate a batch of EEMI commands
+ * @max_cmds:	Maximum number of commands in the batch
+ *
+ * Return: Returns the batch or an ERR_PTR() on failure
+ */
+struct zynqmp_pm_batch *zynqmp_pm_batch_alloc(unsigned int max_cmds)
+{
+	struct zynqmp_pm_batch *batch;
+
+	if (!zynqmp_fw_dev)
+		return ERR_PTR(-EPROBE_DEFER);
+
+	if (!max_cmds || max_cmds > ZYNQMP_PM_BATCH_MAX_CMDS)
+		return ERR_PTR(-EINVAL);
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return ERR_PTR(-ENOMEM);
+
+	batch->cmds = dma_alloc_coherent(zynqmp_fw_dev,
+					 max_cmds * sizeof(*batch->cmds),
+					 &batch->dma, GFP_KERNEL);
+	if (!batch->cmds) {
+		kfree(batch);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	batch->max_cmds = max_cmds;
+
+	return batch;
+}
+EXPORT_SYMBOL_GPL(zynqmp_pm_batch_alloc);
+
+/**
+ * zynqmp_pm_batch_free() - Free a batch of EEMI commands
+ * @batch:	Batch allocated by zynqmp_pm_batch_alloc()
+ */
+void zynqmp_pm_batch_free(struct zynqmp_pm_batch *batch)
+{
+	if (IS_ERR_OR_NULL(batch))
+		return;
+
+	dma_free_coherent(zynqmp_fw_dev, batch->max_cmds * sizeof(*batch->cmds),
+			  batch->cmds, batch->dma);
+	kfree(batch);
+}
+EXPORT_SYMBOL_GPL(zynqmp_pm_batch_free);
+
+/**
+ * zynqmp_pm_batch_add() - Queue an EEMI command in a batch
+ * @batch:	Batch of commands
+ * @pm_api_id:	Requested PM-API call
+ * @arg0:	Argument 0 to requested PM-API call
+ * @arg1:	Argument 1 to requested PM-API call
+ * @arg2:	Argument 2 to requested PM-API call
+ * @arg3:	Argument 3 to requested PM-API call
+ * @arg4:	Argument 4 to requested PM-API call
+ *
+ * Return: Returns 0 on success or -ENOSPC if the batch is full
+ */
+int zynqmp_pm_batch_add(struct zynqmp_pm_batch *batch, u32 pm_api_id,
+			u32 arg0, u32 arg1, u32 arg2, u32 arg3, u32 arg4)
+{
+	struct zynqmp_pm_batch_cmd *cmd;
+
+	if (batch->num_cmds == batch->max_cmds)
+		return -ENOSPC;
+
+	cmd = &batch->cmds[batch->num_cmds++];
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->api_id = pm_api_id;
+	cmd->args[0] = arg0;
+	cmd->args[1] = arg1;
+	cmd->args[2] = arg2;
+	cmd->args[3] = arg3;
+	cmd->args[4] = arg4;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(zynqmp_pm_batch_add);
+
+/**
+ * zynqmp_pm_batch_submit() - Execute the commands queued in a batch
+ * @batch:	Batch of commands
+ * @failed:	Index of the first failed command on error, optional
+ *
+ * The commands are executed in order by a single PM_BATCH call when the
+ * firmware supports it, and by one call per command otherwise. Execution
+ * stops at the first failed command. The results of the executed commands
+ * can then be read with zynqmp_pm_batch_result() until the next command is
+ * queued, which starts a new batch.
+ *
+ * Return: Returns 0 if all the commands succeeded, or the error of the
+ * first failed command
+ */
+int zynqmp_pm_batch_submit(struct zynqmp_pm_batch *batch,
+			   unsigned int *failed)
+{
+	u32 ret_payload[PAYLOAD_ARG_CNT];
+	struct zynqmp_pm_batch_cmd *cmd;
+	unsigned int i, num_cmds;
+	int ret = 0;
+
+	num_cmds = batch->num_cmds;
+	batch->num_cmds = 0;
+	if (!num_cmds)
+		return 0;
+
+	if (zynqmp_pm_feature(PM_BATCH) >= 0) {
+		ret = zynqmp_pm_invoke_fn(PM_BATCH, lower_32_bits(batch->dma),
+					  upper_32_bits(batch->dma), num_cmds,
+					  0, 0, ret_payload);
+		/* The firmware returns the index of the failed command */
+		if (ret && failed)
+			*failed = min(ret_payload[1], num_cmds - 1);
+		return ret;
+	}
+
+	for (i = 0; i < num_cmds; i++) {
+		cmd = &batch->cmds[i];
+		ret = zynqmp_pm_invoke_fn(cmd->api_id, cmd->args[0],
+					  cmd->args[1], cmd->args[2],
+					  cmd->args[3], cmd->args[4],
+					  ret_payload);
+		cmd->status = ret_payload[0];
+		memcpy(cmd->ret, &ret_payload[1], sizeof(cmd->ret));
+		if (ret) {
+			if (failed)
+				*failed = i;
+			break;
+		}
+	}
+
+	return ret;
 }
+EXPORT_SYMBOL_GPL(zynqmp_pm_batch_submit);
+
+/**
+ * zynqmp_pm_batch_result() - Get the result of a command of a batch
+ * @batch:		Batch of commands, after zynqmp_pm_batch_submit()
+ * @index:		Index of the command in the batch
+ * @ret_payload:	Returned value array, as for zynqmp_pm_invoke_fn()
+ *
+ * Return: Returns status of the command, either success or error+reason
+ */
+int zynqmp_pm_batch_result(struct zynqmp_pm_batch *batch, unsigned int index,
+			   u32 *ret_payload)
+{
+	struct zynqmp_pm_batch_cmd *cmd;
+
+	if (index >= batch->max_cmds)
+		return -EINVAL;
+
+	cmd = &batch->cmds[index];
+	if (ret_payload) {
+		ret_payload[0] = cmd->status;
+		memcpy(&ret_payload[1], cmd->ret, sizeof(cmd->ret));
+	}
+
+	return zynqmp_pm_ret_code(cmd->status);
+}
+EXPORT_SYMBOL_GPL(zynqmp_pm_batch_result);
 
 static u32 pm_api_version;
 static u32 pm_tz_version;
@@ -567,8 +952,32 @@ int zynqmp_pm_query_data(struct zynqmp_pm_query_data qdata, u32 *out)
 {
 	int ret;
 
-	ret = zynqmp_pm_invoke_fn(PM_QUERY_DATA, qdata.qid, qdata.arg1,
-				  qdata.arg2, qdata.arg3, 0, out);
+	/* The clock and pin topologies are fixed by the firmware */
+	switch (qdata.qid) {
+	case PM_QID_CLOCK_GET_NAME:
+	case PM_QID_CLOCK_GET_TOPOLOGY:
+	case PM_QID_CLOCK_GET_FIXEDFACTOR_PARAMS:
+	case PM_QID_CLOCK_GET_PARENTS:
+	case PM_QID_CLOCK_GET_ATTRIBUTES:
+	case PM_QID_CLOCK_GET_NUM_CLOCKS:
+	case PM_QID_CLOCK_GET_MAX_DIVISOR:
+	case PM_QID_PINCTRL_GET_NUM_PINS:
+	case PM_QID_PINCTRL_GET_NUM_FUNCTIONS:
+	case PM_QID_PINCTRL_GET_NUM_FUNCTION_GROUPS:
+	case PM_QID_PINCTRL_GET_FUNCTION_NAME:
+	case PM_QID_PINCTRL_GET_FUNCTION_GROUPS:
+	case PM_QID_PINCTRL_GET_PIN_GROUPS:
+		ret = zynqmp_pm_invoke_cached(PM_QUERY_DATA, qdata.qid,
+					      qdata.arg1, qdata.arg2,
+					      qdata.arg3,
+					      PM_QUERY_CACHE_IMMUTABLE |
+					      PM_QUERY_CACHE_ANY_STATUS, out);
+		break;
+	default:
+		ret = zynqmp_pm_invoke_fn(PM_QUERY_DATA, qdata.qid, qdata.arg1,
+					  qdata.arg2, qdata.arg3, 0, out);
+		break;
+	}
 
 	/*
 	 * For clock name query, all bytes in SMC response are clock name
@@ -666,8 +1075,8 @@ int zynqmp_pm_clock_getdivider(u32 clock_id, u32 *divider)
 	u32 ret_payload[PAYLOAD_ARG_CNT];
 	int ret;
 
-	ret = zynqmp_pm_invoke_fn(PM_CLOCK_GETDIVIDER, clock_id, 0,
-				  0, 0, 0, ret_payload);
+	ret = zynqmp_pm_invoke_cached(PM_CLOCK_GETDIVIDER, clock_id, 0, 0, 0,
+				      0, ret_payload);
 	*divider = ret_payload[1];
 
 	return ret;
@@ -707,8 +1116,8 @@ int zynqmp_pm_clock_getrate(u32 clock_id, u64 *rate)
 	u32 ret_payload[PAYLOAD_ARG_CNT];
 	int ret;
 
-	ret = zynqmp_pm_invoke_fn(PM_CLOCK_GETRATE, clock_id, 0,
-				  0, 0, 0, ret_payload);
+	ret = zynqmp_pm_invoke_cached(PM_CLOCK_GETRATE, clock_id, 0, 0, 0, 0,
+				      ret_payload);
 	*rate = ((u64)ret_payload[2] << 32) | ret_payload[1];
 
 	return ret;
@@ -746,8 +1155,8 @@ int zynqmp_pm_clock_getparent(u32 clock_id, u32 *parent_id)
 	u32 ret_payload[PAYLOAD_ARG_CNT];
 	int ret;
 
-	ret = zynqmp_pm_invoke_fn(PM_CLOCK_GETPARENT, clock_id, 0,
-				  0, 0, 0, ret_payload);
+	ret = zynqmp_pm_invoke_cached(PM_CLOCK_GETPARENT, clock_id, 0, 0, 0,
+				      0, ret_payload);
 	*parent_id = ret_payload[1];
 
 	return ret;
@@ -3244,6 +3653,8 @@ static int zynqmp_firmware_probe(struct platform_device *pdev)
 
 	zynqmp_pm_api_debugfs_init();
 
+	zynqmp_fw_dev = dev;
+
 	np = of_find_compatible_node(NULL, NULL, "xlnx,versal");
 	if (np) {
 		em_dev = platform_device_register_data(&pdev->dev, "xlnx_event_manager",
@@ -3263,6 +3674,7 @@ static int zynqmp_firmware_remove(struct platform_device *pdev)
 	int i;
 
 	mfd_remove_devices(&pdev->dev);
+	zynqmp_fw_dev = NULL;
 	zynqmp_pm_api_debugfs_exit();
 
 	hash_for_each_safe(pm_api_features_map, i, tmp, feature_data, hentry) {
@@ -3270,6 +3682,8 @@ static int zynqmp_firmware_remove(struct platform_device *pdev)
 		kfree(feature_data);
 	}
 
+	zynqmp_pm_query_cache_free();
+
 	platform_device_unregister(em_dev);
 
 	return 0;
@@ -14,12 +14,18 @@
 #include <linux/firmware.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/idr.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
 #include <linux/highmem.h>
+#include <linux/sizes.h>
+#include <linux/workqueue.h>
+
+/* Size of the chunks an image is streamed from firmware in */
+#define FPGA_MGR_STREAM_CHUNK_SIZE	SZ_1M
 
 static DEFINE_IDA(fpga_mgr_ida);
 static struct class *fpga_mgr_class;
@@ -566,6 +572,193 @@ static int fpga_dmabuf_load(struct fpga_manager *mgr,
 	return ret;
 }
 
+/**
+ * struct fpga_mgr_stream - state of an image streamed from firmware
+ * @mgr: fpga manager
+ * @image_name: name of image file on the firmware search path
+ * @work: reads the next chunk while the current one is written
+ * @buf: chunk buffers, one is written while the other is read
+ * @len: number of bytes in each chunk buffer
+ * @next: index of the buffer @work reads into
+ * @offset: offset in the image of the next chunk to read
+ * @err: error code of the last read
+ */
+struct fpga_mgr_stream {
+	struct fpga_manager *mgr;
+	const char *image_name;
+	struct work_struct work;
+	char *buf[2];
+	size_t len[2];
+	int next;
+	size_t offset;
+	int err;
+};
+
+static void fpga_mgr_stream_read(struct fpga_mgr_stream *stream)
+{
+	size_t size = FPGA_MGR_STREAM_CHUNK_SIZE;
+	const struct firmware *fw;
+	int i = stream->next;
+
+	stream->len[i] = 0;
+	stream->err = request_partial_firmware_into_buf(&fw,
+							stream->image_name,
+							&stream->mgr->dev,
+							stream->buf[i], size,
+							stream->offset);
+	if (!stream->err) {
+		stream->len[i] = fw->size;
+		stream->offset += fw->size;
+		release_firmware(fw);
+	} else if (stream->err == -EINVAL && stream->offset) {
+		/*
+		 * Reading at the end of the file fails when the image size is
+		 * a multiple of the chunk size.
+		 */
+		stream->err = 0;
+	}
+}
+
+static void fpga_mgr_stream_work(struct work_struct *work)
+{
+	fpga_mgr_stream_read(container_of(work, struct fpga_mgr_stream, work));
+}
+
+/*
+ * Only the low level drivers with a write op and without a write_sg op are
+ * fed with the image in chunks: the core already calls their write op once
+ * per scatter list fragment.
+ */
+static bool fpga_mgr_can_stream(struct fpga_manager *mgr)
+{
+	return mgr->mops->write && !mgr->mops->write_sg &&
+	       mgr->mops->initial_header_size <= FPGA_MGR_STREAM_CHUNK_SIZE;
+}
+
+/*
+ * Write the chunks of the image to the FPGA as they are read. While a chunk
+ * is written, the next one is read into the other buffer. Returns -EAGAIN
+ * if nothing has been written and the image needs to be loaded as a whole.
+ */
+static int fpga_mgr_stream_write(struct fpga_manager *mgr,
+				 struct fpga_image_info *info,
+				 struct fpga_mgr_stream *stream)
+{
+	size_t len, written = 0, data_size = info->data_size;
+	bool last;
+	char *buf;
+	int cur, ret;
+
+	stream->next = 0;
+	fpga_mgr_stream_read(stream);
+	if (stream->err || !stream->len[0])
+		return -EAGAIN;
+
+	/* The header does not fit the first chunk */
+	if (stream->len[0] < info->header_size)
+		return -EAGAIN;
+
+	mgr->state = FPGA_MGR_STATE_PARSE_HEADER;
+	ret = fpga_mgr_parse_header(mgr, info, stream->buf[0],
+				    stream->len[0]);
+	if (ret == -EAGAIN)
+		return -EAGAIN;
+	if (ret) {
+		dev_err(&mgr->dev, "Error while parsing FPGA image header\n");
+		mgr->state = FPGA_MGR_STATE_PARSE_HEADER_ERR;
+		return ret;
+	}
+
+	ret = fpga_mgr_write_init_buf(mgr, info, stream->buf[0],
+				      stream->len[0]);
+	if (ret)
+		return ret;
+
+	mgr->err = 0;
+	mgr->state = FPGA_MGR_STATE_WRITE;
+	for (cur = 0; ; cur = !cur) {
+		last = stream->len[cur] < FPGA_MGR_STREAM_CHUNK_SIZE;
+		if (!last) {
+			stream->next = !cur;
+			queue_work(system_unbound_wq, &stream->work);
+		}
+
+		buf = stream->buf[cur];
+		len = stream->len[cur];
+		if (!written && mgr->mops->skip_header) {
+			buf += info->header_size;
+			len -= info->header_size;
+		}
+		if (data_size) {
+			len = min(len, data_size - written);
+			last |= written + len >= data_size;
+		}
+
+		ret = len ? fpga_mgr_write(mgr, buf, len) : 0;
+		written += len;
+		if (ret || last)
+			break;
+
+		flush_work(&stream->work);
+		ret = stream->err;
+		if (ret || !stream->len[!cur])
+			break;
+	}
+	flush_work(&stream->work);
+
+	if (ret) {
+		dev_err(&mgr->dev, "Error while writing image data to FPGA\n");
+		mgr->state = FPGA_MGR_STATE_WRITE_ERR;
+		mgr->err = ret;
+		return ret;
+	}
+
+	mgr->load_bytes = stream->offset;
+
+	return fpga_mgr_write_complete(mgr, info);
+}
+
+/**
+ * fpga_mgr_firmware_stream - load fpga from firmware in chunks
+ * @mgr:	fpga manager
+ * @info:	fpga image specific information
+ * @image_name:	name of image file on the firmware search path
+ *
+ * Stream the image from the firmware search path in chunks, so that the
+ * image is never held as a whole in memory and the read of each chunk
+ * overlaps the write of the previous one.
+ *
+ * Return: 0 on success, -EAGAIN if the image needs to be loaded as a whole,
+ * i.e. it is not on the filesystem or its header does not fit the first
+ * chunk, other negative error code otherwise.
+ */
+static int fpga_mgr_firmware_stream(struct fpga_manager *mgr,
+				    struct fpga_image_info *info,
+				    const char *image_name)
+{
+	struct fpga_mgr_stream *stream;
+	int ret = -ENOMEM;
+
+	stream = kzalloc(sizeof(*stream), GFP_KERNEL);
+	if (!stream)
+		return -ENOMEM;
+
+	stream->mgr = mgr;
+	stream->image_name = image_name;
+	INIT_WORK(&stream->work, fpga_mgr_stream_work);
+
+	stream->buf[0] = kvmalloc(FPGA_MGR_STREAM_CHUNK_SIZE, GFP_KERNEL);
+	stream->buf[1] = kvmalloc(FPGA_MGR_STREAM_CHUNK_SIZE, GFP_KERNEL);
+	if (stream->buf[0] && stream->buf[1])
+		ret = fpga_mgr_stream_write(mgr, info, stream);
+
+	kvfree(stream->buf[1]);
+	kvfree(stream->buf[0]);
+	kfree(stream);
+
+	return ret;
+}
+
 /**
  * fpga_mgr_firmware_load - request firmware and load to fpga
  * @mgr:	fpga manager
@@ -586,17 +779,32 @@ static int fpga_mgr_firmware_load(struct fpga_manager *mgr,
 {
 	struct device *dev = &mgr->dev;
 	const struct firmware *fw;
+	u64 start;
 	int ret;
 
 	dev_info(dev, "writing %s to %s\n", image_name, mgr->name);
 
 	mgr->err = 0;
 	mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ;
+	mgr->load_bytes = 0;
+	mgr->load_ns = 0;
+	mgr->load_streamed = false;
 
 	/* flags indicates whether to do full or partial reconfiguration */
 	info->flags = mgr->flags;
 	memcpy(info->key, mgr->key, ENCRYPTED_KEY_LEN);
 
+	start = ktime_get_ns();
+	if (fpga_mgr_can_stream(mgr)) {
+		ret = fpga_mgr_firmware_stream(mgr, info, image_name);
+		if (ret != -EAGAIN) {
+			mgr->load_streamed = !ret;
+			goto out;
+		}
+		mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ;
+		info->header_size = mgr->mops->initial_header_size;
+	}
+
 	ret = request_firmware(&fw, image_name, dev);
 	if (ret) {
 		mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ_ERR;
@@ -606,9 +814,14 @@ static int fpga_mgr_firmware_load(struct fpga_manager *mgr,
 	}
 
 	ret = fpga_mgr_buf_load(mgr, info, fw->data, fw->size);
+	mgr->load_bytes = fw->size;
 
 	release_firmware(fw);
 
+out:
+	if (!ret)
+		mgr->load_ns = ktime_get_ns() - start;
+
 	return ret;
 }
 
@@ -725,6 +938,22 @@ static ssize_t status_show(struct device *dev,
 	return len;
 }
 
+static ssize_t load_stats_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct fpga_manager *mgr = to_fpga_manager(dev);
+	u64 kbps = 0;
+
+	if (!mgr->load_ns)
+		return sysfs_emit(buf, "no image loaded from firmware\n");
+
+	kbps = div64_u64(mgr->load_bytes * NSEC_PER_SEC, mgr->load_ns * SZ_1K);
+
+	return sysfs_emit(buf, "%llu bytes in %llu us, %llu KiB/s%s\n",
+			  mgr->load_bytes, div_u64(mgr->load_ns, NSEC_PER_USEC),
+			  kbps, mgr->load_streamed ? ", streamed" : "");
+}
+
 static ssize_t firmware_store(struct device *dev,
 			      struct device_attribute *attr,
 			      const char *buf, size_t count)
@@ -794,6 +1023,7 @@ static ssize_t flags_store(struct device *dev,
 static DEVICE_ATTR_RO(name);
 static DEVICE_ATTR_RO(state);
 static DEVICE_ATTR_RO(status);
+static DEVICE_ATTR_RO(load_stats);
 static DEVICE_ATTR_WO(firmware);
 static DEVICE_ATTR_RW(flags);
 static DEVICE_ATTR_RW(key);
@@ -802,6 +1032,7 @@ static struct attribute *fpga_mgr_attrs[] = {
 	&dev_attr_name.attr,
 	&dev_attr_state.attr,
 	&dev_attr_status.attr,
+	&dev_attr_load_stats.attr,
 	&dev_attr_firmware.attr,
 	&dev_attr_flags.attr,
 	&dev_attr_key.attr,
@@ -5,19 +5,43 @@
  *  Copyright (C) 2013-2016 Altera Corporation
  *  Copyright (C) 2017 Intel Corporation
  */
+#include <linux/firmware.h>
 #include <linux/fpga/fpga-bridge.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/fpga/fpga-region.h>
 #include <linux/idr.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 
 static DEFINE_IDA(fpga_region_ida);
 static struct class *fpga_region_class;
 
+static uint image_cache_kb;
+module_param(image_cache_kb, uint, 0444);
+MODULE_PARM_DESC(image_cache_kb,
+		 "Default size limit of the image cache of a region in KiB, 0 disables it (default: 0)");
+
+/**
+ * struct fpga_region_image - image kept in the image cache of a region
+ * @node: entry in the image cache of the region
+ * @name: firmware name of the image
+ * @fw: the image, as requested from firmware
+ * @hits: number of reconfigurations served from the cache
+ * @last_ns: duration of the last reconfiguration with this image
+ */
+struct fpga_region_image {
+	struct list_head node;
+	char *name;
+	const struct firmware *fw;
+	u64 hits;
+	u64 last_ns;
+};
+
 struct fpga_region *
 fpga_region_class_find(struct device *start, const void *data,
 		       int (*match)(struct device *, const void *))
@@ -79,6 +103,138 @@ static void fpga_region_put(struct fpga_region *region)
 	mutex_unlock(&region->mutex);
 }
 
+static void fpga_region_image_free(struct fpga_region_image *img)
+{
+	release_firmware(img->fw);
+	kfree(img->name);
+	kfree(img);
+}
+
+/* Evict the least recently used images until the cache fits @max bytes */
+static void fpga_region_cache_shrink(struct fpga_region *region, size_t max)
+{
+	struct fpga_region_image *img;
+
+	lockdep_assert_held(&region->cache_lock);
+
+	while (region->cache_bytes > max) {
+		img = list_last_entry(&region->cache, struct fpga_region_image,
+				      node);
+		list_del(&img->node);
+		region->cache_bytes -= img->fw->size;
+		fpga_region_image_free(img);
+	}
+}
+
+/*
+ * Take the image out of the cache for the time it is loaded so that it can't
+ * be evicted meanwhile, or request it from firmware on a miss.
+ */
+static struct fpga_region_image *
+fpga_region_cache_get(struct fpga_region *region, const char *name)
+{
+	struct fpga_region_image *img;
+	int ret;
+
+	mutex_lock(&region->cache_lock);
+	list_for_each_entry(img, &region->cache, node) {
+		if (!strcmp(img->name, name)) {
+			list_del(&img->node);
+			region->cache_bytes -= img->fw->size;
+			img->hits++;
+			mutex_unlock(&region->cache_lock);
+			return img;
+		}
+	}
+	mutex_unlock(&region->cache_lock);
+
+	img = kzalloc(sizeof(*img), GFP_KERNEL);
+	if (!img)
+		return ERR_PTR(-ENOMEM);
+
+	img->name = kstrdup(name, GFP_KERNEL);
+	if (!img->name) {
+		kfree(img);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	ret = request_firmware(&img->fw, name, &region->dev);
+	if (ret) {
+		dev_err(&region->dev, "Error requesting firmware %s\n", name);
+		kfree(img->name);
+		kfree(img);
+		return ERR_PTR(ret);
+	}
+
+	return img;
+}
+
+/* Put a successfully loaded image back at the head of the cache */
+static void fpga_region_cache_put(struct fpga_region *region,
+				  struct fpga_region_image *img)
+{
+	mutex_lock(&region->cache_lock);
+	if (img->fw->size > region->cache_max_bytes) {
+		fpga_region_image_free(img);
+	} else {
+		fpga_region_cache_shrink(region, region->cache_max_bytes -
+					 img->fw->size);
+		list_add(&img->node, &region->cache);
+		region->cache_bytes += img->fw->size;
+	}
+	mutex_unlock(&region->cache_lock);
+}
+
+/*
+ * Load the image of the region. An image that is loaded from firmware is
+ * kept in the image cache of the region once the manager has accepted it,
+ * so that loading it again only writes it to the FPGA.
+ */
+static int fpga_region_load(struct fpga_region *region,
+			    struct fpga_image_info *info)
+{
+	struct fpga_manager *mgr = region->mgr;
+	struct fpga_region_image *img;
+	size_t max_bytes;
+	u64 start;
+	int ret;
+
+	max_bytes = READ_ONCE(region->cache_max_bytes);
+	region->timing.cached = false;
+	if (!max_bytes || !info->firmware_name || info->sgt ||
+	    (info->buf && info->count) ||
+	    (mgr->flags & FPGA_MGR_CONFIG_DMA_BUF))
+		return fpga_mgr_load(mgr, info);
+
+	start = ktime_get_ns();
+	img = fpga_region_cache_get(region, info->firmware_name);
+	if (IS_ERR(img))
+		return PTR_ERR(img);
+
+	region->timing.cached = !!img->hits;
+
+	/* As fpga_mgr_firmware_load() does for images loaded from firmware */
+	info->flags = mgr->flags;
+	memcpy(info->key, mgr->key, ENCRYPTED_KEY_LEN);
+	info->buf = img->fw->data;
+	info->count = img->fw->size;
+
+	ret = fpga_mgr_load(mgr, info);
+
+	info->buf = NULL;
+	info->count = 0;
+
+	if (ret) {
+		fpga_region_image_free(img);
+		return ret;
+	}
+
+	img->last_ns = ktime_get_ns() - start;
+	fpga_region_cache_put(region, img);
+
+	return 0;
+}
+
 /**
  * fpga_region_program_fpga - program FPGA
  *
@@ -97,6 +253,7 @@ int fpga_region_program_fpga(struct fpga_region *region)
 {
 	struct device *dev = &region->dev;
 	struct fpga_image_info *info = region->info;
+	u64 start;
 	int ret;
 
 	region = fpga_region_get(region);
@@ -123,23 +280,31 @@ int fpga_region_program_fpga(struct fpga_region *region)
 		}
 	}
 
+	memset(&region->timing, 0, sizeof(region->timing));
+
+	start = ktime_get_ns();
 	ret = fpga_bridges_disable(&region->bridge_list);
 	if (ret) {
 		dev_err(dev, "failed to disable bridges\n");
 		goto err_put_br;
 	}
+	region->timing.decouple_ns = ktime_get_ns() - start;
 
-	ret = fpga_mgr_load(region->mgr, info);
+	start = ktime_get_ns();
+	ret = fpga_region_load(region, info);
 	if (ret) {
 		dev_err(dev, "failed to load FPGA image\n");
 		goto err_put_br;
 	}
+	region->timing.load_ns = ktime_get_ns() - start;
 
+	start = ktime_get_ns();
 	ret = fpga_bridges_enable(&region->bridge_list);
 	if (ret) {
 		dev_err(dev, "failed to enable region bridges\n");
 		goto err_put_br;
 	}
+	region->timing.recouple_ns = ktime_get_ns() - start;
 
 	fpga_mgr_unlock(region->mgr);
 	fpga_region_put(region);
@@ -171,10 +336,78 @@ static ssize_t compat_id_show(struct device *dev,
 		       (unsigned long long)region->compat_id->id_l);
 }
 
+static ssize_t image_cache_max_bytes_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+
+	return sysfs_emit(buf, "%zu\n", READ_ONCE(region->cache_max_bytes));
+}
+
+static ssize_t image_cache_max_bytes_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	unsigned long max_bytes;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &max_bytes);
+	if (ret)
+		return ret;
+
+	/* Writing the current limit again drops the images over it */
+	mutex_lock(&region->cache_lock);
+	WRITE_ONCE(region->cache_max_bytes, max_bytes);
+	fpga_region_cache_shrink(region, max_bytes);
+	mutex_unlock(&region->cache_lock);
+
+	return count;
+}
+
+static ssize_t image_cache_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	struct fpga_region_image *img;
+	ssize_t len = 0;
+
+	mutex_lock(&region->cache_lock);
+	list_for_each_entry(img, &region->cache, node)
+		len += sysfs_emit_at(buf, len,
+				     "%s size %zu hits %llu last_us %llu\n",
+				     img->name, img->fw->size, img->hits,
+				     div_u64(img->last_ns, NSEC_PER_USEC));
+	mutex_unlock(&region->cache_lock);
+
+	return len;
+}
+
+static ssize_t reconfig_stats_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	struct fpga_region_timing *timing = &region->timing;
+
+	return sysfs_emit(buf,
+			  "decouple_us %llu load_us %llu recouple_us %llu%s",
+			  div_u64(timing->decouple_ns, NSEC_PER_USEC),
+			  div_u64(timing->load_ns, NSEC_PER_USEC),
+			  div_u64(timing->recouple_ns, NSEC_PER_USEC),
+			  timing->cached ? " cached\n" : "\n");
+}
+
 static DEVICE_ATTR_RO(compat_id);
+static DEVICE_ATTR_RW(image_cache_max_bytes);
+static DEVICE_ATTR_RO(image_cache);
+static DEVICE_ATTR_RO(reconfig_stats);
 
 static struct attribute *fpga_region_attrs[] = {
 	&dev_attr_compat_id.attr,
+	&dev_attr_image_cache_max_bytes.attr,
+	&dev_attr_image_cache.attr,
+	&dev_attr_reconfig_stats.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(fpga_region);
@@ -215,6 +448,9 @@ fpga_region_register_full(struct device *parent, const struct fpga_region_info *
 
 	mutex_init(&region->mutex);
 	INIT_LIST_HEAD(&region->bridge_list);
+	mutex_init(&region->cache_lock);
+	INIT_LIST_HEAD(&region->cache);
+	region->cache_max_bytes = (size_t)image_cache_kb * SZ_1K;
 
 	region->dev.class = fpga_region_class;
 	region->dev.parent = parent;
@@ -283,6 +519,10 @@ static void fpga_region_dev_release(struct device *dev)
 {
 	struct fpga_region *region = to_fpga_region(dev);
 
+	mutex_lock(&region->cache_lock);
+	fpga_region_cache_shrink(region, 0);
+	mutex_unlock(&region->cache_lock);
+
 	ida_free(&fpga_region_ida, region->dev.id);
 	kfree(region);
 }
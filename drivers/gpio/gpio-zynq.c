@@ -214,21 +214,15 @@ static inline void zynq_gpio_get_bank_pin(unsigned int pin_num,
 }
 
 /**
- * zynq_gpio_get_value - Get the state of the specified pin of GPIO device
- * @chip:	gpio_chip instance to be worked on
- * @pin:	gpio pin number within the device
- *
- * This function reads the state of the specified pin of the GPIO device.
+ * zynq_gpio_read_bank - Read the state of all the pins of a bank
+ * @gpio:	gpio device data structure
+ * @bank_num:	bank to be read
  *
- * Return: 0 if the pin is low, 1 if pin is high.
+ * Return: the state of the pins of the bank, one bit per pin.
  */
-static int zynq_gpio_get_value(struct gpio_chip *chip, unsigned int pin)
+static u32 zynq_gpio_read_bank(struct zynq_gpio *gpio, unsigned int bank_num)
 {
 	u32 data;
-	unsigned int bank_num, bank_pin_num;
-	struct zynq_gpio *gpio = gpiochip_get_data(chip);
-
-	zynq_gpio_get_bank_pin(pin, &bank_num, &bank_pin_num, gpio);
 
 	if (gpio_data_ro_bug(gpio)) {
 		if (zynq_gpio_is_zynq(gpio)) {
@@ -252,7 +246,88 @@ static int zynq_gpio_get_value(struct gpio_chip *chip, unsigned int pin)
 		data = readl_relaxed(gpio->base_addr +
 			ZYNQ_GPIO_DATA_RO_OFFSET(bank_num));
 	}
-	return (data >> bank_pin_num) & 1;
+	return data;
+}
+
+/**
+ * zynq_gpio_get_value - Get the state of the specified pin of GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @pin:	gpio pin number within the device
+ *
+ * This function reads the state of the specified pin of the GPIO device.
+ *
+ * Return: 0 if the pin is low, 1 if pin is high.
+ */
+static int zynq_gpio_get_value(struct gpio_chip *chip, unsigned int pin)
+{
+	unsigned int bank_num, bank_pin_num;
+	struct zynq_gpio *gpio = gpiochip_get_data(chip);
+
+	zynq_gpio_get_bank_pin(pin, &bank_num, &bank_pin_num, gpio);
+
+	return (zynq_gpio_read_bank(gpio, bank_num) >> bank_pin_num) & 1;
+}
+
+/**
+ * zynq_gpio_bank_bits - Extract the bits of a bank from a pin bitmap
+ * @map:	bitmap indexed by gpio pin number within the device
+ * @gpio:	gpio device data structure
+ * @bank_num:	bank of the bits
+ *
+ * Return: the bits of @map that belong to the bank, one bit per bank pin.
+ */
+static u32 zynq_gpio_bank_bits(const unsigned long *map,
+			       struct zynq_gpio *gpio, unsigned int bank_num)
+{
+	unsigned int min = gpio->p_data->bank_min[bank_num];
+	unsigned int max = gpio->p_data->bank_max[bank_num];
+	unsigned int pin;
+	u32 bits = 0;
+
+	/* banks without pins are left zeroed in the platform data */
+	if (!max)
+		return 0;
+
+	for (pin = find_next_bit(map, max + 1, min); pin <= max;
+	     pin = find_next_bit(map, max + 1, pin + 1))
+		bits |= BIT(pin - min);
+
+	return bits;
+}
+
+/**
+ * zynq_gpio_get_multiple - Get the state of several pins of GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @mask:	pins to be read
+ * @bits:	state of the pins
+ *
+ * The data register of each bank that holds a pin of @mask is read once.
+ *
+ * Return: 0 always
+ */
+static int zynq_gpio_get_multiple(struct gpio_chip *chip, unsigned long *mask,
+				  unsigned long *bits)
+{
+	struct zynq_gpio *gpio = gpiochip_get_data(chip);
+	unsigned int bank_num, pin;
+	u32 bank_mask, data;
+	int min;
+
+	for (bank_num = 0; bank_num < gpio->p_data->max_bank; bank_num++) {
+		bank_mask = zynq_gpio_bank_bits(mask, gpio, bank_num);
+		if (bank_mask) {
+			min = gpio->p_data->bank_min[bank_num];
+			data = zynq_gpio_read_bank(gpio, bank_num);
+			for (pin = 0; bank_mask; pin++, bank_mask >>= 1)
+				if (bank_mask & 1)
+					__assign_bit(min + pin, bits,
+						     data & BIT(pin));
+		}
+		if (gpio->p_data->quirks & GPIO_QUIRK_VERSAL)
+			bank_num = bank_num + VERSAL_UNUSED_BANKS;
+	}
+
+	return 0;
 }
 
 /**
@@ -292,6 +367,42 @@ static void zynq_gpio_set_value(struct gpio_chip *chip, unsigned int pin,
 	writel_relaxed(state, gpio->base_addr + reg_offset);
 }
 
+/**
+ * zynq_gpio_set_multiple - Modify the state of several pins of GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @mask:	pins to be modified
+ * @bits:	state of the pins
+ *
+ * The pins of a bank are written at once through the two mask/data
+ * registers of the bank, leaving the pins that are not in @mask untouched.
+ */
+static void zynq_gpio_set_multiple(struct gpio_chip *chip,
+				   unsigned long *mask, unsigned long *bits)
+{
+	struct zynq_gpio *gpio = gpiochip_get_data(chip);
+	unsigned int bank_num;
+	u32 bank_mask, data;
+
+	for (bank_num = 0; bank_num < gpio->p_data->max_bank; bank_num++) {
+		bank_mask = zynq_gpio_bank_bits(mask, gpio, bank_num);
+		data = zynq_gpio_bank_bits(bits, gpio, bank_num);
+
+		/* the upper 16 bits mask the pins that are not modified */
+		if (bank_mask & 0xFFFF)
+			writel_relaxed((~bank_mask << ZYNQ_GPIO_MID_PIN_NUM) |
+				       (data & 0xFFFF), gpio->base_addr +
+				       ZYNQ_GPIO_DATA_LSW_OFFSET(bank_num));
+		if (bank_mask & ZYNQ_GPIO_UPPER_MASK)
+			writel_relaxed((~bank_mask & ZYNQ_GPIO_UPPER_MASK) |
+				       (data >> ZYNQ_GPIO_MID_PIN_NUM),
+				       gpio->base_addr +
+				       ZYNQ_GPIO_DATA_MSW_OFFSET(bank_num));
+
+		if (gpio->p_data->quirks & GPIO_QUIRK_VERSAL)
+			bank_num = bank_num + VERSAL_UNUSED_BANKS;
+	}
+}
+
 /**
  * zynq_gpio_dir_in - Set the direction of the specified GPIO pin as input
  * @chip:	gpio_chip instance to be worked on
@@ -925,6 +1036,8 @@ static int zynq_gpio_probe(struct platform_device *pdev)
 	chip->parent = &pdev->dev;
 	chip->get = zynq_gpio_get_value;
 	chip->set = zynq_gpio_set_value;
+	chip->get_multiple = zynq_gpio_get_multiple;
+	chip->set_multiple = zynq_gpio_set_multiple;
 	chip->request = zynq_gpio_request;
 	chip->free = zynq_gpio_free;
 	chip->direction_input = zynq_gpio_dir_in;
@@ -13,6 +13,11 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 
+#if IS_ENABLED(CONFIG_DRM_FORMAT_HELPER_NEON)
+#include <asm/neon.h>
+#include <asm/simd.h>
+#endif
+
 #include <drm/drm_device.h>
 #include <drm/drm_format_helper.h>
 #include <drm/drm_framebuffer.h>
@@ -20,6 +25,59 @@
 #include <drm/drm_print.h>
 #include <drm/drm_rect.h>
 
+#include "drm_format_helper_internal.h"
+
+static bool drm_fb_simd = true;
+
+/**
+ * drm_fb_simd_enable - Enable or disable the SIMD line converters
+ * @enable: true to convert with SIMD instructions where available
+ *
+ * The converters use SIMD instructions by default. Disabling them lets the
+ * tests compare the SIMD and the scalar code.
+ *
+ * Returns:
+ * The previous setting.
+ */
+bool drm_fb_simd_enable(bool enable)
+{
+	bool enabled = READ_ONCE(drm_fb_simd);
+
+	WRITE_ONCE(drm_fb_simd, enable);
+
+	return enabled;
+}
+EXPORT_SYMBOL_FOR_TESTS_ONLY(drm_fb_simd_enable);
+
+#if IS_ENABLED(CONFIG_DRM_FORMAT_HELPER_NEON)
+static unsigned int __drm_fb_simd_line(unsigned int (*simd_line)(void *dbuf,
+								 const void *sbuf,
+								 unsigned int pixels),
+				       void *dbuf, const void *sbuf, unsigned int pixels)
+{
+	unsigned int x;
+
+	/* Not worth saving the FP/SIMD state for less than a block */
+	if (pixels < 8 || !READ_ONCE(drm_fb_simd) || !may_use_simd())
+		return 0;
+
+	kernel_neon_begin();
+	x = simd_line(dbuf, sbuf, pixels);
+	kernel_neon_end();
+
+	return x;
+}
+
+/*
+ * Convert the leading pixels of a line from XRGB8888 with SIMD instructions.
+ * Returns the number of pixels converted, the caller converts the others.
+ */
+#define drm_fb_simd_line(conv, dbuf, sbuf, pixels) \
+	__drm_fb_simd_line(drm_fb_xrgb8888_to_##conv##_line_neon, dbuf, sbuf, pixels)
+#else
+#define drm_fb_simd_line(conv, dbuf, sbuf, pixels) 0U
+#endif
+
 static unsigned int clip_offset(const struct drm_rect *clip, unsigned int pitch, unsigned int cpp)
 {
 	return clip->y1 * pitch + clip->x1 * cpp;
@@ -279,7 +337,7 @@ static void drm_fb_xrgb8888_to_rgb332_line(void *dbuf, const void *sbuf, unsigne
 	unsigned int x;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	for (x = drm_fb_simd_line(rgb332, dbuf, sbuf, pixels); x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		dbuf8[x] = ((pix & 0x00e00000) >> 16) |
 			   ((pix & 0x0000e000) >> 11) |
@@ -328,7 +386,7 @@ static void drm_fb_xrgb8888_to_rgb565_line(void *dbuf, const void *sbuf, unsigne
 	u16 val16;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	for (x = drm_fb_simd_line(rgb565, dbuf, sbuf, pixels); x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		val16 = ((pix & 0x00F80000) >> 8) |
 			((pix & 0x0000FC00) >> 5) |
@@ -346,7 +404,7 @@ static void drm_fb_xrgb8888_to_rgb565_swab_line(void *dbuf, const void *sbuf,
 	u16 val16;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	for (x = drm_fb_simd_line(rgb565_swab, dbuf, sbuf, pixels); x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		val16 = ((pix & 0x00F80000) >> 8) |
 			((pix & 0x0000FC00) >> 5) |
@@ -402,7 +460,10 @@ static void drm_fb_xrgb8888_to_rgb888_line(void *dbuf, const void *sbuf, unsigne
 	unsigned int x;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_simd_line(rgb888, dbuf, sbuf, pixels);
+	dbuf8 += x * 3;
+
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		*dbuf8++ = (pix & 0x000000FF) >>  0;
 		*dbuf8++ = (pix & 0x0000FF00) >>  8;
@@ -561,14 +622,14 @@ static void drm_fb_xrgb8888_to_gray8_line(void *dbuf, const void *sbuf, unsigned
 	const __le32 *sbuf32 = sbuf;
 	unsigned int x;
 
-	for (x = 0; x < pixels; x++) {
+	for (x = drm_fb_simd_line(gray8, dbuf, sbuf, pixels); x < pixels; x++) {
 		u32 pix = le32_to_cpu(sbuf32[x]);
 		u8 r = (pix & 0x00ff0000) >> 16;
 		u8 g = (pix & 0x0000ff00) >> 8;
 		u8 b =  pix & 0x000000ff;
 
 		/* ITU BT.601: Y = 0.299 R + 0.587 G + 0.114 B */
-		*dbuf8++ = (3 * r + 6 * g + b) / 10;
+		dbuf8[x] = (3 * r + 6 * g + b) / 10;
 	}
 }
 
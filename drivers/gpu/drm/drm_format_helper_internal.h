@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+
+#ifndef __DRM_FORMAT_HELPER_INTERNAL_H__
+#define __DRM_FORMAT_HELPER_INTERNAL_H__
+
+#include <linux/types.h>
+
+/* drm_format_helper.c */
+bool drm_fb_simd_enable(bool enable);
+
+/* drm_format_helper_neon.c */
+unsigned int drm_fb_xrgb8888_to_rgb332_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels);
+unsigned int drm_fb_xrgb8888_to_rgb565_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels);
+unsigned int drm_fb_xrgb8888_to_rgb565_swab_line_neon(void *dbuf,
+						      const void *sbuf,
+						      unsigned int pixels);
+unsigned int drm_fb_xrgb8888_to_rgb888_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels);
+unsigned int drm_fb_xrgb8888_to_gray8_line_neon(void *dbuf, const void *sbuf,
+						unsigned int pixels);
+
+#endif
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * NEON line converters of the format helpers
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ *
+ * Each converter handles the pixels of a line in blocks of 8 and returns the
+ * number of pixels it converted. The caller converts the remaining pixels
+ * with the scalar code and brackets the call with kernel_neon_begin() and
+ * kernel_neon_end().
+ */
+
+#include <asm/neon-intrinsics.h>
+
+#include "drm_format_helper_internal.h"
+
+/* De-interleave 8 XRGB8888 pixels, val[0] is blue and val[2] red */
+static inline uint8x8x4_t load_xrgb8888(const u8 *sbuf8)
+{
+	return vld4_u8(sbuf8);
+}
+
+unsigned int drm_fb_xrgb8888_to_rgb332_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels)
+{
+	const u8 *sbuf8 = sbuf;
+	u8 *dbuf8 = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint8x8x4_t pix = load_xrgb8888(sbuf8 + x * 4);
+		uint8x8_t val;
+
+		val = vand_u8(pix.val[2], vdup_n_u8(0xe0));
+		val = vorr_u8(val, vshr_n_u8(vand_u8(pix.val[1],
+						     vdup_n_u8(0xe0)), 3));
+		val = vorr_u8(val, vshr_n_u8(pix.val[0], 6));
+		vst1_u8(dbuf8 + x, val);
+	}
+
+	return x;
+}
+
+static inline uint16x8_t xrgb8888_to_rgb565(uint8x8x4_t pix)
+{
+	uint16x8_t val;
+
+	val = vshll_n_u8(vand_u8(pix.val[2], vdup_n_u8(0xf8)), 8);
+	val = vorrq_u16(val, vshll_n_u8(vand_u8(pix.val[1],
+						vdup_n_u8(0xfc)), 3));
+	return vorrq_u16(val, vmovl_u8(vshr_n_u8(pix.val[0], 3)));
+}
+
+unsigned int drm_fb_xrgb8888_to_rgb565_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels)
+{
+	const u8 *sbuf8 = sbuf;
+	u16 *dbuf16 = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8)
+		vst1q_u16(dbuf16 + x,
+			  xrgb8888_to_rgb565(load_xrgb8888(sbuf8 + x * 4)));
+
+	return x;
+}
+
+unsigned int drm_fb_xrgb8888_to_rgb565_swab_line_neon(void *dbuf,
+						      const void *sbuf,
+						      unsigned int pixels)
+{
+	const u8 *sbuf8 = sbuf;
+	u16 *dbuf16 = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint16x8_t val;
+
+		val = xrgb8888_to_rgb565(load_xrgb8888(sbuf8 + x * 4));
+		vst1q_u8((u8 *)(dbuf16 + x),
+			 vrev16q_u8(vreinterpretq_u8_u16(val)));
+	}
+
+	return x;
+}
+
+unsigned int drm_fb_xrgb8888_to_rgb888_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels)
+{
+	const u8 *sbuf8 = sbuf;
+	u8 *dbuf8 = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint8x8x4_t pix = load_xrgb8888(sbuf8 + x * 4);
+		uint8x8x3_t val = {{ pix.val[0], pix.val[1], pix.val[2] }};
+
+		vst3_u8(dbuf8 + x * 3, val);
+	}
+
+	return x;
+}
+
+unsigned int drm_fb_xrgb8888_to_gray8_line_neon(void *dbuf, const void *sbuf,
+						unsigned int pixels)
+{
+	const u8 *sbuf8 = sbuf;
+	u8 *dbuf8 = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint8x8x4_t pix = load_xrgb8888(sbuf8 + x * 4);
+		uint16x8_t sum;
+		uint32x4_t lo, hi;
+
+		/* ITU BT.601: Y = 0.299 R + 0.587 G + 0.114 B */
+		sum = vmull_u8(pix.val[2], vdup_n_u8(3));
+		sum = vmlal_u8(sum, pix.val[1], vdup_n_u8(6));
+		sum = vaddw_u8(sum, pix.val[0]);
+
+		/* (sum * 6554) >> 16 is sum / 10 for all sums up to 2550 */
+		lo = vmull_n_u16(vget_low_u16(sum), 6554);
+		hi = vmull_n_u16(vget_high_u16(sum), 6554);
+		sum = vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+		vst1_u8(dbuf8 + x, vmovn_u16(sum));
+	}
+
+	return x;
+}
@@ -2,6 +2,9 @@
 
 #include <kunit/test.h>
 
+#include <linux/ktime.h>
+#include <linux/random.h>
+
 #include <drm/drm_device.h>
 #include <drm/drm_file.h>
 #include <drm/drm_format_helper.h>
@@ -13,6 +16,7 @@
 #include <drm/drm_rect.h>
 
 #include "../drm_crtc_internal.h"
+#include "../drm_format_helper_internal.h"
 
 #define TEST_BUF_SIZE 50
 
@@ -442,12 +446,138 @@ static void drm_test_fb_xrgb8888_to_xrgb2101010(struct kunit *test)
 	KUNIT_EXPECT_EQ(test, memcmp(buf, result->expected, dst_size), 0);
 }
 
+/* A small SPI panel, with a width that is no multiple of the SIMD blocks */
+#define BENCH_WIDTH	317
+#define BENCH_HEIGHT	240
+#define BENCH_LOOPS	100
+
+struct convert_bench_case {
+	const char *name;
+	u32 format;
+	void (*convert)(struct iosys_map *dst, const struct iosys_map *src,
+			const struct drm_framebuffer *fb, const struct drm_rect *clip);
+};
+
+static void bench_to_gray8(struct iosys_map *dst, const struct iosys_map *src,
+			   const struct drm_framebuffer *fb, const struct drm_rect *clip)
+{
+	drm_fb_xrgb8888_to_gray8(dst, NULL, src, fb, clip);
+}
+
+static void bench_to_rgb332(struct iosys_map *dst, const struct iosys_map *src,
+			    const struct drm_framebuffer *fb, const struct drm_rect *clip)
+{
+	drm_fb_xrgb8888_to_rgb332(dst, NULL, src, fb, clip);
+}
+
+static void bench_to_rgb565(struct iosys_map *dst, const struct iosys_map *src,
+			    const struct drm_framebuffer *fb, const struct drm_rect *clip)
+{
+	drm_fb_xrgb8888_to_rgb565(dst, NULL, src, fb, clip, false);
+}
+
+static void bench_to_rgb565_swab(struct iosys_map *dst, const struct iosys_map *src,
+				 const struct drm_framebuffer *fb,
+				 const struct drm_rect *clip)
+{
+	drm_fb_xrgb8888_to_rgb565(dst, NULL, src, fb, clip, true);
+}
+
+static void bench_to_rgb888(struct iosys_map *dst, const struct iosys_map *src,
+			    const struct drm_framebuffer *fb, const struct drm_rect *clip)
+{
+	drm_fb_xrgb8888_to_rgb888(dst, NULL, src, fb, clip);
+}
+
+static struct convert_bench_case convert_bench_cases[] = {
+	{ "gray8", DRM_FORMAT_R8, bench_to_gray8 },
+	{ "rgb332", DRM_FORMAT_RGB332, bench_to_rgb332 },
+	{ "rgb565", DRM_FORMAT_RGB565, bench_to_rgb565 },
+	{ "rgb565_swab", DRM_FORMAT_RGB565, bench_to_rgb565_swab },
+	{ "rgb888", DRM_FORMAT_RGB888, bench_to_rgb888 },
+};
+
+static void convert_bench_case_desc(struct convert_bench_case *t, char *desc)
+{
+	strscpy(desc, t->name, KUNIT_PARAM_DESC_SIZE);
+}
+
+KUNIT_ARRAY_PARAM(convert_bench, convert_bench_cases, convert_bench_case_desc);
+
+static u64 convert_bench_run(const struct convert_bench_case *params,
+			     struct iosys_map *dst, const struct iosys_map *src,
+			     const struct drm_framebuffer *fb,
+			     const struct drm_rect *clip)
+{
+	u64 start = ktime_get_ns();
+	unsigned int i;
+
+	for (i = 0; i < BENCH_LOOPS; i++)
+		params->convert(dst, src, fb, clip);
+
+	return div_u64(ktime_get_ns() - start, BENCH_LOOPS);
+}
+
+/*
+ * Compare the throughput of the SIMD and the scalar line converters, and
+ * check that both produce the same output.
+ */
+static void drm_test_fb_xrgb8888_convert_bench(struct kunit *test)
+{
+	const struct convert_bench_case *params = test->param_value;
+	struct drm_rect clip = DRM_RECT_INIT(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+	struct iosys_map dst, src;
+	u64 scalar_ns, simd_ns;
+	u8 *simd_buf, *scalar_buf;
+	size_t dst_size;
+	bool enabled;
+	u32 *xrgb8888;
+
+	struct drm_framebuffer fb = {
+		.format = drm_format_info(DRM_FORMAT_XRGB8888),
+		.pitches = { BENCH_WIDTH * sizeof(u32), 0, 0 },
+	};
+
+	if (!IS_ENABLED(CONFIG_DRM_FORMAT_HELPER_NEON))
+		kunit_skip(test, "no SIMD line converters on this architecture");
+
+	dst_size = conversion_buf_size(params->format, 0, &clip);
+	KUNIT_ASSERT_GT(test, dst_size, 0);
+
+	xrgb8888 = kunit_kmalloc(test, BENCH_WIDTH * BENCH_HEIGHT * sizeof(u32),
+				 GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, xrgb8888);
+	get_random_bytes(xrgb8888, BENCH_WIDTH * BENCH_HEIGHT * sizeof(u32));
+	iosys_map_set_vaddr(&src, xrgb8888);
+
+	simd_buf = kunit_kzalloc(test, dst_size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, simd_buf);
+	scalar_buf = kunit_kzalloc(test, dst_size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, scalar_buf);
+
+	enabled = drm_fb_simd_enable(true);
+	iosys_map_set_vaddr(&dst, simd_buf);
+	simd_ns = convert_bench_run(params, &dst, &src, &fb, &clip);
+
+	drm_fb_simd_enable(false);
+	iosys_map_set_vaddr(&dst, scalar_buf);
+	scalar_ns = convert_bench_run(params, &dst, &src, &fb, &clip);
+	drm_fb_simd_enable(enabled);
+
+	KUNIT_EXPECT_EQ(test, memcmp(simd_buf, scalar_buf, dst_size), 0);
+
+	kunit_info(test, "%ux%u to %s: scalar %llu us, SIMD %llu us per frame\n",
+		   BENCH_WIDTH, BENCH_HEIGHT, params->name,
+		   div_u64(scalar_ns, NSEC_PER_USEC), div_u64(simd_ns, NSEC_PER_USEC));
+}
+
 static struct kunit_case drm_format_helper_test_cases[] = {
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_gray8, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_rgb332, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_rgb565, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_rgb888, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_xrgb2101010, convert_xrgb8888_gen_params),
+	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_convert_bench, convert_bench_gen_params),
 	{}
 };
 
@@ -33,6 +33,7 @@
 #include <linux/dma-resv.h>
 #include <linux/module.h>
 #include <linux/of_graph.h>
+#include <linux/of_platform.h>
 #include <linux/platform_device.h>
 
 #include "xlnx_bridge.h"
@@ -62,6 +63,7 @@ MODULE_PARM_DESC(fbdev_vres,
  * @master: logical master device for pipeline
  * @suspend_state: atomic state for suspend / resume
  * @master_count: Counter to track number of fake master instances
+ * @pool: pre-reserved scanout buffer pool, NULL if disabled
  */
 struct xlnx_drm {
 	struct drm_device *drm;
@@ -70,6 +72,7 @@ struct xlnx_drm {
 	struct platform_device *master;
 	struct drm_atomic_state *suspend_state;
 	u32 master_count;
+	struct xlnx_gem_pool *pool;
 };
 
 /**
@@ -98,6 +101,19 @@ unsigned int xlnx_get_align(struct drm_device *drm)
 	return xlnx_crtc_helper_get_align(xlnx_drm->crtc);
 }
 
+/**
+ * xlnx_get_gem_pool - Return the scanout buffer pool
+ * @drm: DRM device
+ *
+ * Return: the scanout buffer pool, or NULL if the device has none
+ */
+struct xlnx_gem_pool *xlnx_get_gem_pool(struct drm_device *drm)
+{
+	struct xlnx_drm *xlnx_drm = drm->dev_private;
+
+	return xlnx_drm->pool;
+}
+
 /**
  * xlnx_get_format - Return the current format of CRTC
  * @drm: DRM device
@@ -199,6 +215,7 @@ static struct drm_driver xlnx_drm_driver = {
 	.lastclose			= xlnx_lastclose,
 
 	DRM_GEM_DMA_DRIVER_OPS_VMAP_WITH_DUMB_CREATE(xlnx_gem_cma_dumb_create),
+	.debugfs_init			= xlnx_gem_debugfs_init,
 
 	.fops				= &xlnx_fops,
 
@@ -254,10 +271,19 @@ static int xlnx_bind(struct device *dev)
 	if (ret)
 		goto err_crtc;
 
+	xlnx_link_pipeline(&master->dev);
+
 	xlnx_mode_config_init(drm);
 	drm_mode_config_reset(drm);
 	dma_set_mask(drm->dev, xlnx_crtc_helper_get_dma_mask(xlnx_drm->crtc));
 
+	xlnx_drm->pool = xlnx_gem_pool_init(drm);
+	if (IS_ERR(xlnx_drm->pool)) {
+		ret = PTR_ERR(xlnx_drm->pool);
+		xlnx_drm->pool = NULL;
+		goto err_fb;
+	}
+
 	format = xlnx_crtc_helper_get_format(xlnx_drm->crtc);
 	info = drm_format_info(format);
 	if (info && info->depth && info->cpp[0]) {
@@ -317,19 +343,19 @@ static const struct component_master_ops xlnx_master_ops = {
 	.unbind	= xlnx_unbind,
 };
 
-static int xlnx_of_component_probe(struct device *master_dev,
-				   int (*compare_of)(struct device *, void *),
-				   const struct component_master_ops *m_ops)
+/*
+ * Call @fn on the nodes of the devices making the pipeline of @dev: @dev
+ * itself, the parents of its ports and the remote ends of the endpoints.
+ */
+static void xlnx_of_for_each_pipeline_node(struct device *dev,
+					   void (*fn)(struct device_node *,
+						      void *),
+					   void *data)
 {
-	struct device *dev = master_dev->parent;
 	struct device_node *ep, *port, *remote, *parent;
-	struct component_match *match = NULL;
 	int i;
 
-	if (!dev->of_node)
-		return -EINVAL;
-
-	component_match_add(master_dev, &match, compare_of, dev->of_node);
+	fn(dev->of_node, data);
 
 	for (i = 0; ; i++) {
 		port = of_parse_phandle(dev->of_node, "ports", i);
@@ -347,7 +373,7 @@ static int xlnx_of_component_probe(struct device *master_dev,
 			continue;
 		}
 
-		component_match_add(master_dev, &match, compare_of, parent);
+		fn(parent, data);
 		of_node_put(parent);
 		of_node_put(port);
 	}
@@ -372,8 +398,7 @@ static int xlnx_of_component_probe(struct device *master_dev,
 				of_node_put(remote);
 				continue;
 			}
-			component_match_add(master_dev, &match, compare_of,
-					    remote);
+			fn(remote, data);
 			of_node_put(remote);
 		}
 		of_node_put(parent);
@@ -387,8 +412,67 @@ static int xlnx_of_component_probe(struct device *master_dev,
 			parent = parent->parent;
 		of_node_put(port);
 	}
+}
 
-	return component_master_add_with_match(master_dev, m_ops, match);
+struct xlnx_component_match {
+	struct device *master_dev;
+	struct component_match *match;
+	int (*compare_of)(struct device *dev, void *data);
+};
+
+static void xlnx_component_match_add(struct device_node *np, void *data)
+{
+	struct xlnx_component_match *m = data;
+
+	component_match_add(m->master_dev, &m->match, m->compare_of, np);
+}
+
+static int xlnx_of_component_probe(struct device *master_dev,
+				   int (*compare_of)(struct device *, void *),
+				   const struct component_master_ops *m_ops)
+{
+	struct device *dev = master_dev->parent;
+	struct xlnx_component_match m = {
+		.master_dev	= master_dev,
+		.compare_of	= compare_of,
+	};
+
+	if (!dev->of_node)
+		return -EINVAL;
+
+	xlnx_of_for_each_pipeline_node(dev, xlnx_component_match_add, &m);
+
+	return component_master_add_with_match(master_dev, m_ops, m.match);
+}
+
+static void xlnx_link_pipeline_node(struct device_node *np, void *data)
+{
+	struct device *master_dev = data;
+	struct platform_device *pdev;
+
+	pdev = of_find_device_by_node(np);
+	if (!pdev)
+		return;
+
+	/* The parent is resumed first already */
+	if (&pdev->dev != master_dev->parent &&
+	    !device_link_add(master_dev, &pdev->dev,
+			     DL_FLAG_AUTOREMOVE_CONSUMER))
+		dev_warn(master_dev, "failed to link to %s\n",
+			 dev_name(&pdev->dev));
+
+	put_device(&pdev->dev);
+}
+
+/*
+ * The pipeline devices are components of the logical master, not its
+ * ancestors. Link the master to them so that it suspends before and resumes
+ * after all of them, including when they are suspended asynchronously.
+ */
+static void xlnx_link_pipeline(struct device *master_dev)
+{
+	xlnx_of_for_each_pipeline_node(master_dev->parent,
+				       xlnx_link_pipeline_node, master_dev);
 }
 
 static int xlnx_compare_of(struct device *dev, void *data)
@@ -398,6 +482,8 @@ static int xlnx_compare_of(struct device *dev, void *data)
 
 static int xlnx_platform_probe(struct platform_device *pdev)
 {
+	device_enable_async_suspend(&pdev->dev);
+
 	return xlnx_of_component_probe(&pdev->dev, xlnx_compare_of,
 				       &xlnx_master_ops);
 }
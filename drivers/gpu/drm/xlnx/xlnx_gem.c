@@ -16,12 +16,379 @@
  * GNU General Public License for more details.
  */
 
+#include <drm/drm_debugfs.h>
 #include <drm/drm_drv.h>
+#include <drm/drm_file.h>
 #include <drm/drm_gem_dma_helper.h>
+#include <drm/drm_managed.h>
+#include <drm/drm_print.h>
+
+#include <linux/dma-mapping.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
 
 #include "xlnx_drv.h"
 #include "xlnx_gem.h"
 
+#define XLNX_GEM_POOL_MAX_CLASSES	8
+
+static uint xlnx_gem_pool_sizes[XLNX_GEM_POOL_MAX_CLASSES];
+static int xlnx_gem_pool_num_sizes;
+module_param_array_named(gem_pool_sizes, xlnx_gem_pool_sizes, uint,
+			 &xlnx_gem_pool_num_sizes, 0444);
+MODULE_PARM_DESC(gem_pool_sizes,
+		 "Size classes in KiB of the pre-reserved scanout buffer pool (default: none)");
+
+static uint xlnx_gem_pool_counts[XLNX_GEM_POOL_MAX_CLASSES];
+static int xlnx_gem_pool_num_counts;
+module_param_array_named(gem_pool_counts, xlnx_gem_pool_counts, uint,
+			 &xlnx_gem_pool_num_counts, 0444);
+MODULE_PARM_DESC(gem_pool_counts,
+		 "Number of buffers reserved for each gem_pool_sizes class (default: none)");
+
+/**
+ * struct xlnx_gem_pool_buf - Pre-reserved contiguous buffer
+ * @list: entry in the free list of the size class
+ * @class: size class the buffer belongs to
+ * @vaddr: kernel virtual address
+ * @dma_addr: DMA address
+ */
+struct xlnx_gem_pool_buf {
+	struct list_head list;
+	struct xlnx_gem_pool_class *class;
+	void *vaddr;
+	dma_addr_t dma_addr;
+};
+
+/**
+ * struct xlnx_gem_pool_class - Buffers of one size
+ * @size: size of the buffers in bytes
+ * @count: number of buffers reserved
+ * @free: list of the buffers not in use
+ * @in_use: number of buffers in use
+ * @peak: highest number of buffers in use at once
+ * @allocs: number of allocations served from the class
+ * @misses: number of allocations the class had no buffer left for
+ */
+struct xlnx_gem_pool_class {
+	size_t size;
+	unsigned int count;
+	struct list_head free;
+	unsigned int in_use;
+	unsigned int peak;
+	u64 allocs;
+	u64 misses;
+};
+
+/**
+ * struct xlnx_gem_pool - Scanout buffer pool of a Xilinx DRM device
+ * @drm: DRM device owning the pool
+ * @lock: protects the free lists and the statistics
+ * @classes: size classes, smallest first
+ * @num_classes: number of size classes
+ * @oversize: number of allocations larger than the largest class
+ *
+ * Contiguous allocations from CMA get slow once memory is fragmented. The
+ * pool reserves buffers when the device binds, and dumb buffers are carved
+ * from the smallest class that fits them. When that class has run out, or
+ * if no class fits, the buffer comes from CMA as usual.
+ */
+struct xlnx_gem_pool {
+	struct drm_device *drm;
+	struct mutex lock;
+	struct xlnx_gem_pool_class classes[XLNX_GEM_POOL_MAX_CLASSES];
+	unsigned int num_classes;
+	u64 oversize;
+};
+
+/**
+ * struct xlnx_gem_object - GEM DMA object backed by a pool buffer
+ * @base: GEM DMA object
+ * @pool: pool the buffer comes from
+ * @buf: pool buffer
+ */
+struct xlnx_gem_object {
+	struct drm_gem_dma_object base;
+	struct xlnx_gem_pool *pool;
+	struct xlnx_gem_pool_buf *buf;
+};
+
+#define to_xlnx_gem_obj(obj) \
+	container_of(to_drm_gem_dma_obj(obj), struct xlnx_gem_object, base)
+
+static struct xlnx_gem_pool_buf *
+xlnx_gem_pool_get(struct xlnx_gem_pool *pool, size_t size)
+{
+	struct xlnx_gem_pool_buf *buf = NULL;
+	struct xlnx_gem_pool_class *class;
+	unsigned int i;
+
+	mutex_lock(&pool->lock);
+	for (i = 0; i < pool->num_classes; i++) {
+		class = &pool->classes[i];
+		if (class->size < size)
+			continue;
+
+		/* Larger classes are kept for the sizes they were made for */
+		buf = list_first_entry_or_null(&class->free,
+					       struct xlnx_gem_pool_buf, list);
+		if (!buf) {
+			class->misses++;
+			break;
+		}
+
+		list_del(&buf->list);
+		class->allocs++;
+		class->in_use++;
+		class->peak = max(class->peak, class->in_use);
+		break;
+	}
+	if (i == pool->num_classes)
+		pool->oversize++;
+	mutex_unlock(&pool->lock);
+
+	return buf;
+}
+
+static void xlnx_gem_pool_put(struct xlnx_gem_pool *pool,
+			      struct xlnx_gem_pool_buf *buf)
+{
+	mutex_lock(&pool->lock);
+	list_add(&buf->list, &buf->class->free);
+	buf->class->in_use--;
+	mutex_unlock(&pool->lock);
+}
+
+static void xlnx_gem_pool_object_free(struct drm_gem_object *obj)
+{
+	struct xlnx_gem_object *xobj = to_xlnx_gem_obj(obj);
+
+	drm_gem_object_release(obj);
+	xlnx_gem_pool_put(xobj->pool, xobj->buf);
+	kfree(xobj);
+}
+
+static const struct drm_gem_object_funcs xlnx_gem_pool_object_funcs = {
+	.free = xlnx_gem_pool_object_free,
+	.print_info = drm_gem_dma_object_print_info,
+	.get_sg_table = drm_gem_dma_object_get_sg_table,
+	.vmap = drm_gem_dma_object_vmap,
+	.mmap = drm_gem_dma_object_mmap,
+	.vm_ops = &drm_gem_dma_vm_ops,
+};
+
+/*
+ * xlnx_gem_pool_create - Create a GEM DMA object from a pool buffer
+ * @pool: buffer pool
+ * @size: object size
+ *
+ * Return: the GEM DMA object, NULL if the pool has no buffer for @size, or
+ * an error pointer
+ */
+static struct drm_gem_dma_object *
+xlnx_gem_pool_create(struct xlnx_gem_pool *pool, size_t size)
+{
+	struct xlnx_gem_object *xobj;
+	struct xlnx_gem_pool_buf *buf;
+	struct drm_gem_object *obj;
+	int ret;
+
+	size = round_up(size, PAGE_SIZE);
+	buf = xlnx_gem_pool_get(pool, size);
+	if (!buf)
+		return NULL;
+
+	xobj = kzalloc(sizeof(*xobj), GFP_KERNEL);
+	if (!xobj) {
+		ret = -ENOMEM;
+		goto err_put;
+	}
+
+	obj = &xobj->base.base;
+	obj->funcs = &xlnx_gem_pool_object_funcs;
+	ret = drm_gem_object_init(pool->drm, obj, size);
+	if (ret)
+		goto err_free;
+
+	ret = drm_gem_create_mmap_offset(obj);
+	if (ret) {
+		drm_gem_object_release(obj);
+		goto err_free;
+	}
+
+	xobj->pool = pool;
+	xobj->buf = buf;
+	xobj->base.vaddr = buf->vaddr;
+	xobj->base.dma_addr = buf->dma_addr;
+
+	return &xobj->base;
+
+err_free:
+	kfree(xobj);
+err_put:
+	xlnx_gem_pool_put(pool, buf);
+	return ERR_PTR(ret);
+}
+
+static void xlnx_gem_pool_release(struct drm_device *drm, void *data)
+{
+	struct xlnx_gem_pool *pool = data;
+	struct xlnx_gem_pool_buf *buf, *next;
+	unsigned int i;
+
+	for (i = 0; i < pool->num_classes; i++) {
+		struct xlnx_gem_pool_class *class = &pool->classes[i];
+
+		WARN_ON(class->in_use);
+		list_for_each_entry_safe(buf, next, &class->free, list) {
+			dma_free_wc(drm->dev, class->size, buf->vaddr,
+				    buf->dma_addr);
+			kfree(buf);
+		}
+	}
+
+	mutex_destroy(&pool->lock);
+	kfree(pool);
+}
+
+static int xlnx_gem_pool_cmp_class(const void *a, const void *b)
+{
+	const struct xlnx_gem_pool_class *ca = a, *cb = b;
+
+	if (ca->size == cb->size)
+		return 0;
+	return ca->size < cb->size ? -1 : 1;
+}
+
+/**
+ * xlnx_gem_pool_init - Reserve the scanout buffer pool of a DRM device
+ * @drm: DRM device
+ *
+ * Reserves the buffers requested through the gem_pool_sizes and
+ * gem_pool_counts module parameters. The pool is released along with @drm,
+ * after the last buffer has been given back. Failing to reserve all the
+ * buffers is not fatal, the pool then holds the ones it got.
+ *
+ * Return: the pool, NULL if none was requested, or an error pointer
+ */
+struct xlnx_gem_pool *xlnx_gem_pool_init(struct drm_device *drm)
+{
+	struct xlnx_gem_pool *pool;
+	unsigned int i, j, n;
+	int ret;
+
+	n = min(xlnx_gem_pool_num_sizes, xlnx_gem_pool_num_counts);
+	if (!n)
+		return NULL;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+
+	pool->drm = drm;
+	mutex_init(&pool->lock);
+
+	for (i = 0; i < n; i++) {
+		struct xlnx_gem_pool_class *class;
+
+		if (!xlnx_gem_pool_sizes[i] || !xlnx_gem_pool_counts[i])
+			continue;
+
+		class = &pool->classes[pool->num_classes++];
+		class->size = PAGE_ALIGN((size_t)xlnx_gem_pool_sizes[i] * SZ_1K);
+		class->count = xlnx_gem_pool_counts[i];
+	}
+
+	sort(pool->classes, pool->num_classes, sizeof(pool->classes[0]),
+	     xlnx_gem_pool_cmp_class, NULL);
+
+	for (i = 0; i < pool->num_classes; i++) {
+		struct xlnx_gem_pool_class *class = &pool->classes[i];
+
+		INIT_LIST_HEAD(&class->free);
+
+		for (j = 0; j < class->count; j++) {
+			struct xlnx_gem_pool_buf *buf;
+
+			buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+			if (!buf)
+				break;
+
+			buf->vaddr = dma_alloc_wc(drm->dev, class->size,
+						  &buf->dma_addr,
+						  GFP_KERNEL | __GFP_NOWARN);
+			if (!buf->vaddr) {
+				kfree(buf);
+				break;
+			}
+
+			buf->class = class;
+			list_add_tail(&buf->list, &class->free);
+		}
+
+		if (j < class->count)
+			drm_warn(drm, "reserved %u of %u buffers of %zu bytes\n",
+				 j, class->count, class->size);
+		class->count = j;
+	}
+
+	ret = drmm_add_action_or_reset(drm, xlnx_gem_pool_release, pool);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return pool;
+}
+
+static int xlnx_gem_pool_show(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct xlnx_gem_pool *pool = xlnx_get_gem_pool(node->minor->dev);
+	unsigned int i;
+
+	if (!pool) {
+		seq_puts(m, "disabled\n");
+		return 0;
+	}
+
+	seq_printf(m, "%10s %6s %6s %6s %12s %12s\n", "size", "count",
+		   "in_use", "peak", "allocs", "misses");
+
+	mutex_lock(&pool->lock);
+	for (i = 0; i < pool->num_classes; i++) {
+		struct xlnx_gem_pool_class *class = &pool->classes[i];
+
+		seq_printf(m, "%10zu %6u %6u %6u %12llu %12llu\n",
+			   class->size, class->count, class->in_use,
+			   class->peak, class->allocs, class->misses);
+	}
+	seq_printf(m, "oversize: %llu\n", pool->oversize);
+	mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+static const struct drm_info_list xlnx_gem_debugfs_list[] = {
+	{ "gem_pool", xlnx_gem_pool_show, 0 },
+};
+
+/**
+ * xlnx_gem_debugfs_init - (struct drm_driver)->debugfs_init callback
+ * @minor: DRM minor
+ *
+ * Exposes the usage statistics of the scanout buffer pool.
+ */
+void xlnx_gem_debugfs_init(struct drm_minor *minor)
+{
+	drm_debugfs_create_files(xlnx_gem_debugfs_list,
+				 ARRAY_SIZE(xlnx_gem_debugfs_list),
+				 minor->debugfs_root, minor);
+}
+
 /*
  * xlnx_gem_cma_dumb_create - (struct drm_driver)->dumb_create callback
  * @file_priv: drm_file object
@@ -30,7 +397,8 @@
  *
  * This function is for dumb_create callback of drm_driver struct. Simply
  * it wraps around drm_gem_dma_dumb_create() and sets the pitch value
- * by retrieving the value from the device.
+ * by retrieving the value from the device. The buffer is taken from the
+ * scanout buffer pool when the device has one with a buffer to spare.
  *
  * Return: The return value from drm_gem_dma_dumb_create()
  */
@@ -39,9 +407,28 @@ int xlnx_gem_cma_dumb_create(struct drm_file *file_priv, struct drm_device *drm,
 {
 	int pitch = DIV_ROUND_UP(args->width * args->bpp, 8);
 	unsigned int align = xlnx_get_align(drm);
+	struct xlnx_gem_pool *pool = xlnx_get_gem_pool(drm);
+	struct drm_gem_dma_object *dma_obj;
+	int ret;
 
 	if (!args->pitch || !IS_ALIGNED(args->pitch, align))
 		args->pitch = ALIGN(pitch, align);
 
-	return drm_gem_dma_dumb_create_internal(file_priv, drm, args);
+	if (!pool)
+		return drm_gem_dma_dumb_create_internal(file_priv, drm, args);
+
+	if (args->size < (u64)args->pitch * args->height)
+		args->size = (u64)args->pitch * args->height;
+
+	dma_obj = xlnx_gem_pool_create(pool, args->size);
+	if (!dma_obj)
+		return drm_gem_dma_dumb_create_internal(file_priv, drm, args);
+	if (IS_ERR(dma_obj))
+		return PTR_ERR(dma_obj);
+
+	ret = drm_gem_handle_create(file_priv, &dma_obj->base, &args->handle);
+	/* drop reference from allocate - handle holds it now. */
+	drm_gem_object_put(&dma_obj->base);
+
+	return ret;
 }
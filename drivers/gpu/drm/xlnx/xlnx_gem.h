@@ -19,8 +19,16 @@
 #ifndef _XLNX_GEM_H_
 #define _XLNX_GEM_H_
 
+struct drm_device;
+struct drm_file;
+struct drm_minor;
+struct drm_mode_create_dumb;
+struct xlnx_gem_pool;
+
 int xlnx_gem_cma_dumb_create(struct drm_file *file_priv,
 			     struct drm_device *drm,
 			     struct drm_mode_create_dumb *args);
+struct xlnx_gem_pool *xlnx_gem_pool_init(struct drm_device *drm);
+void xlnx_gem_debugfs_init(struct drm_minor *minor);
 
 #endif /* _XLNX_GEM_H_ */
@@ -139,6 +139,7 @@
 #define XVMIX_CSC_COEFF_SIZE		(12)
 #define XVMIX_CSC_SCALE_FACTOR		(4096)
 #define XVMIX_CSC_DIVISOR		(10000)
+#define XVMIX_SHADOW_MAX_WRITES		320
 
 /*************************** STATIC DATA  ************************************/
 static const s16
@@ -359,6 +360,30 @@ struct xlnx_mix_layer_data {
 	enum xlnx_mix_layer_id id;
 };
 
+/**
+ * struct xlnx_mix_shadow - Register writes waiting for a frame boundary
+ * @lock: protects the shadow state against the interrupt handler
+ * @offset: offsets of the pending register writes
+ * @val: values of the pending register writes
+ * @count: number of pending register writes
+ * @hold: a commit is being programmed, keep its writes until it is complete
+ * @running: the core is generating frames
+ *
+ * The core samples its control registers when it starts a frame, so
+ * registers written while it runs take effect at a frame start that may
+ * fall in the middle of an update. While the core runs, writes are queued
+ * here and flushed together from the frame done interrupt, which makes a
+ * whole update land in the same frame.
+ */
+struct xlnx_mix_shadow {
+	spinlock_t lock;
+	u32 offset[XVMIX_SHADOW_MAX_WRITES];
+	u32 val[XVMIX_SHADOW_MAX_WRITES];
+	unsigned int count;
+	bool hold;
+	bool running;
+};
+
 /**
  * struct xlnx_mix_hw - Describes a mixer IP block instance within the design
  * @base: Base physical address of Mixer IP in memory map
@@ -385,6 +410,8 @@ struct xlnx_mix_layer_data {
  * @reset_gpio: GPIO line used to reset IP between modesetting operations
  * @intrpt_handler_fn: Interrupt handler function called when frame is completed
  * @intrpt_data: Data pointer passed to interrupt handler
+ * @layer_enable: Current value of the layer enable register
+ * @shadow: Register writes waiting for the next frame boundary
  *
  * Used as the primary data structure for many L2 driver functions. Logo layer
  * data, if enabled within the IP, is described in this structure.  All other
@@ -416,6 +443,8 @@ struct xlnx_mix_hw {
 	struct gpio_desc *reset_gpio;
 	void (*intrpt_handler_fn)(void *);
 	void *intrpt_data;
+	u32 layer_enable;
+	struct xlnx_mix_shadow shadow;
 };
 
 /**
@@ -440,6 +469,7 @@ struct xlnx_mix_hw {
  * @pixel_clock_enabled: pixel clock status
  * @dpms: mixer drm state
  * @event: vblank pending event
+ * @latch_event: event of the commit waiting for its registers to be latched
  * @vtc_bridge: vtc_bridge structure
  * @disp_bridge: disp_bridge structure
  *
@@ -470,6 +500,7 @@ struct xlnx_mix {
 	bool pixel_clock_enabled;
 	int dpms;
 	struct drm_pending_vblank_event *event;
+	struct drm_pending_vblank_event *latch_event;
 	struct xlnx_bridge *vtc_bridge;
 	struct xlnx_bridge *disp_bridge;
 };
@@ -515,15 +546,87 @@ static inline void reg_writel(void __iomem *base, int offset, u32 val)
 	writel(val, base + offset);
 }
 
-static inline void reg_writeq(void __iomem *base, int offset, u64 val)
+static inline u32 reg_readl(void __iomem *base, int offset)
 {
-	writel(lower_32_bits(val), base + offset);
-	writel(upper_32_bits(val), base + offset + 4);
+	return readl(base + offset);
 }
 
-static inline u32 reg_readl(void __iomem *base, int offset)
+static void __xlnx_mix_shadow_flush(struct xlnx_mix_hw *mixer)
 {
-	return readl(base + offset);
+	struct xlnx_mix_shadow *shadow = &mixer->shadow;
+	unsigned int i;
+
+	for (i = 0; i < shadow->count; i++)
+		reg_writel(mixer->base, shadow->offset[i], shadow->val[i]);
+	shadow->count = 0;
+}
+
+/**
+ * xlnx_mix_write - Write a mixer control register
+ * @mixer: Mixer instance to program
+ * @offset: Register offset
+ * @val: Register value
+ *
+ * While the core runs, the write is queued and applied at the next frame
+ * boundary, along with all the other writes queued before it. A later write
+ * to the same register replaces the queued value.
+ */
+static void xlnx_mix_write(struct xlnx_mix_hw *mixer, u32 offset, u32 val)
+{
+	struct xlnx_mix_shadow *shadow = &mixer->shadow;
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&shadow->lock, flags);
+	if (!shadow->running) {
+		reg_writel(mixer->base, offset, val);
+		goto unlock;
+	}
+
+	for (i = 0; i < shadow->count; i++) {
+		if (shadow->offset[i] == offset) {
+			shadow->val[i] = val;
+			goto unlock;
+		}
+	}
+
+	/* Out of room, give up on atomicity rather than on ordering */
+	if (shadow->count == XVMIX_SHADOW_MAX_WRITES) {
+		__xlnx_mix_shadow_flush(mixer);
+		reg_writel(mixer->base, offset, val);
+		goto unlock;
+	}
+
+	shadow->offset[shadow->count] = offset;
+	shadow->val[shadow->count] = val;
+	shadow->count++;
+
+unlock:
+	spin_unlock_irqrestore(&shadow->lock, flags);
+}
+
+static void xlnx_mix_writeq(struct xlnx_mix_hw *mixer, u32 offset, u64 val)
+{
+	xlnx_mix_write(mixer, offset, lower_32_bits(val));
+	xlnx_mix_write(mixer, offset + 4, upper_32_bits(val));
+}
+
+/**
+ * xlnx_mix_shadow_hold - Hold the queued register writes
+ * @mixer: Mixer instance being programmed
+ * @hold: Whether to hold the writes or release them to the next frame
+ *
+ * Writes queued while the hold is on are kept until it is released, so
+ * that an update programmed across a frame boundary is still applied as a
+ * whole.
+ */
+static void xlnx_mix_shadow_hold(struct xlnx_mix_hw *mixer, bool hold)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mixer->shadow.lock, flags);
+	mixer->shadow.hold = hold;
+	spin_unlock_irqrestore(&mixer->shadow.lock, flags);
 }
 
 static u32 xlnx_mix_get_bus_fmt(struct xlnx_mix *mixer)
@@ -607,8 +710,13 @@ static void xlnx_mix_intrpt_disable(struct xlnx_mix_hw *mixer)
  */
 static void xlnx_mix_start(struct xlnx_mix_hw *mixer)
 {
+	unsigned long flags;
 	u32 val;
 
+	spin_lock_irqsave(&mixer->shadow.lock, flags);
+	mixer->shadow.running = true;
+	spin_unlock_irqrestore(&mixer->shadow.lock, flags);
+
 	val = XVMIX_AP_RST_MASK | XVMIX_AP_EN_MASK;
 	reg_writel(mixer->base, XVMIX_AP_CTRL, val);
 }
@@ -617,10 +725,17 @@ static void xlnx_mix_start(struct xlnx_mix_hw *mixer)
  * xlnx_mix_stop - Stop the mixer core video generator
  * @mixer: Mixer core instance for which to stop video output
  *
- * Starts the core to generate a video frame.
+ * Stops the core after applying the register writes still queued.
  */
 static void xlnx_mix_stop(struct xlnx_mix_hw *mixer)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&mixer->shadow.lock, flags);
+	__xlnx_mix_shadow_flush(mixer);
+	mixer->shadow.running = false;
+	spin_unlock_irqrestore(&mixer->shadow.lock, flags);
+
 	reg_writel(mixer->base, XVMIX_AP_CTRL, 0);
 }
 
@@ -652,12 +767,12 @@ static void xlnx_mix_set_yuv2_rgb_coeff(struct xlnx_mix_plane *plane,
 	u32 bpc_scale = 1 << (mixer->mixer_hw.bg_layer_bpc - 8);
 
 	for (i = 0; i < XVMIX_CSC_MATRIX_SIZE; i++)
-		reg_writel(mixer->mixer_hw.base, XVMIX_K00_1 + i * 8,
+		xlnx_mix_write(&mixer->mixer_hw, XVMIX_K00_1 + i * 8,
 			   xlnx_mix_yuv2rgb_coeffs[enc][range][i] *
 			   XVMIX_CSC_SCALE_FACTOR / XVMIX_CSC_DIVISOR);
 
 	for (i = XVMIX_CSC_MATRIX_SIZE; i < XVMIX_CSC_COEFF_SIZE; i++)
-		reg_writel(mixer->mixer_hw.base, XVMIX_K00_1 + i * 8,
+		xlnx_mix_write(&mixer->mixer_hw, XVMIX_K00_1 + i * 8,
 			   (xlnx_mix_yuv2rgb_coeffs[enc][range][i] *
 			    bpc_scale));
 }
@@ -679,12 +794,12 @@ static void xlnx_mix_set_rgb2_yuv_coeff(struct xlnx_mix_plane *plane,
 	u32 bpc_scale = 1 << (mixer->mixer_hw.bg_layer_bpc - 8);
 
 	for (i = 0; i < XVMIX_CSC_MATRIX_SIZE; i++)
-		reg_writel(mixer->mixer_hw.base, XVMIX_K00_2 + i * 8,
+		xlnx_mix_write(&mixer->mixer_hw, XVMIX_K00_2 + i * 8,
 			   xlnx_mix_rgb2yuv_coeffs[enc][range][i] *
 			   XVMIX_CSC_SCALE_FACTOR / XVMIX_CSC_DIVISOR);
 
 	for (i = XVMIX_CSC_MATRIX_SIZE; i < XVMIX_CSC_COEFF_SIZE; i++)
-		reg_writel(mixer->mixer_hw.base, XVMIX_K00_2 + i * 8,
+		xlnx_mix_write(&mixer->mixer_hw, XVMIX_K00_2 + i * 8,
 			   (xlnx_mix_rgb2yuv_coeffs[enc][range][i] *
 			    bpc_scale));
 }
@@ -737,8 +852,8 @@ static int xlnx_mix_set_active_area(struct xlnx_mix_hw *mixer,
 		return -EINVAL;
 	}
 	/* set resolution */
-	reg_writel(mixer->base, XVMIX_HEIGHT_DATA, vactive);
-	reg_writel(mixer->base, XVMIX_WIDTH_DATA, hactive);
+	xlnx_mix_write(mixer, XVMIX_HEIGHT_DATA, vactive);
+	xlnx_mix_write(mixer, XVMIX_WIDTH_DATA, hactive);
 	ld->layer_regs.width  = hactive;
 	ld->layer_regs.height = vactive;
 
@@ -820,17 +935,19 @@ static void xlnx_mix_layer_enable(struct xlnx_mix_hw *mixer,
 
 	/* Check if request is to enable all layers or single layer */
 	if (id == mixer->max_layers) {
-		reg_writel(mixer->base, XVMIX_LAYERENABLE_DATA,
-			   mixer->enable_all_mask);
+		mixer->layer_enable = mixer->enable_all_mask;
+		xlnx_mix_write(mixer, XVMIX_LAYERENABLE_DATA,
+			       mixer->layer_enable);
 
 	} else if ((id < mixer->layer_cnt) || ((id == mixer->logo_layer_id) &&
 		   mixer->logo_layer_en)) {
-		curr_state = reg_readl(mixer->base, XVMIX_LAYERENABLE_DATA);
+		curr_state = mixer->layer_enable;
 		if (id == mixer->logo_layer_id)
 			curr_state |= mixer->logo_en_mask;
 		else
 			curr_state |= BIT(id);
-		reg_writel(mixer->base, XVMIX_LAYERENABLE_DATA, curr_state);
+		mixer->layer_enable = curr_state;
+		xlnx_mix_write(mixer, XVMIX_LAYERENABLE_DATA, curr_state);
 	} else {
 		DRM_ERROR("Can't enable requested layer %d\n", id);
 	}
@@ -881,16 +998,18 @@ static void xlnx_mix_layer_disable(struct xlnx_mix_hw *mixer,
 	num_layers = mixer->layer_cnt;
 
 	if (id == mixer->max_layers) {
-		reg_writel(mixer->base, XVMIX_LAYERENABLE_DATA,
-			   XVMIX_MASK_DISABLE_ALL_LAYERS);
+		mixer->layer_enable = XVMIX_MASK_DISABLE_ALL_LAYERS;
+		xlnx_mix_write(mixer, XVMIX_LAYERENABLE_DATA,
+			       mixer->layer_enable);
 	} else if ((id < num_layers) ||
 		   ((id == mixer->logo_layer_id) && (mixer->logo_layer_en))) {
-		curr_state = reg_readl(mixer->base, XVMIX_LAYERENABLE_DATA);
+		curr_state = mixer->layer_enable;
 		if (id == mixer->logo_layer_id)
 			curr_state &= ~(mixer->logo_en_mask);
 		else
 			curr_state &= ~(BIT(id));
-		reg_writel(mixer->base, XVMIX_LAYERENABLE_DATA, curr_state);
+		mixer->layer_enable = curr_state;
+		xlnx_mix_write(mixer, XVMIX_LAYERENABLE_DATA, curr_state);
 	} else {
 		DRM_ERROR("Can't disable requested layer %d\n", id);
 	}
@@ -1099,7 +1218,8 @@ static bool xlnx_mix_isfmt_support(u32 format)
  * @mixer: Mixer instance to program with new background color
  * @id: Plane id
  *
- * Applicable only for overlay layers
+ * Applicable only for overlay layers. The value is the one last programmed,
+ * which the hardware may not have latched yet.
  *
  * Return:
  * scaling factor of the specified layer
@@ -1108,26 +1228,15 @@ static int xlnx_mix_get_layer_scaling(struct xlnx_mix_hw *mixer,
 				      enum xlnx_mix_layer_id id)
 {
 	int scale_factor = 0;
-	u32 reg;
 	struct xlnx_mix_layer_data *l_data = xlnx_mix_get_layer_data(mixer, id);
 
 	if (id == mixer->logo_layer_id) {
-		if (mixer->logo_layer_en) {
-			if (mixer->max_layers > XVMIX_MAX_OVERLAY_LAYERS)
-				reg = XVMIX_LOGOSCALEFACTOR_DATA +
-					XVMIX_LOGO_OFFSET;
-			else
-				reg = XVMIX_LOGOSCALEFACTOR_DATA;
-			scale_factor = reg_readl(mixer->base, reg);
-			l_data->layer_regs.scale_fact = scale_factor;
-		}
+		if (mixer->logo_layer_en)
+			scale_factor = l_data->layer_regs.scale_fact;
 	} else {
 		/*Layer0-Layer15*/
-		if (id < mixer->logo_layer_id && l_data->hw_config.can_scale) {
-			reg = XVMIX_LAYERSCALE_0_DATA + (id * XVMIX_REG_OFFSET);
-			scale_factor = reg_readl(mixer->base, reg);
-			l_data->layer_regs.scale_fact = scale_factor;
-		}
+		if (id < mixer->logo_layer_id && l_data->hw_config.can_scale)
+			scale_factor = l_data->layer_regs.scale_fact;
 	}
 	return scale_factor;
 }
@@ -1186,10 +1295,10 @@ static int xlnx_mix_set_layer_window(struct xlnx_mix_hw *mixer,
 			w_reg = XVMIX_LOGOWIDTH_DATA;
 			h_reg = XVMIX_LOGOHEIGHT_DATA;
 		}
-		reg_writel(mixer->base, x_reg, x_pos);
-		reg_writel(mixer->base, y_reg, y_pos);
-		reg_writel(mixer->base, w_reg, width);
-		reg_writel(mixer->base, h_reg, height);
+		xlnx_mix_write(mixer, x_reg, x_pos);
+		xlnx_mix_write(mixer, y_reg, y_pos);
+		xlnx_mix_write(mixer, w_reg, width);
+		xlnx_mix_write(mixer, h_reg, height);
 		l_data->layer_regs.x_pos = x_pos;
 		l_data->layer_regs.y_pos = y_pos;
 		l_data->layer_regs.width = width;
@@ -1209,17 +1318,17 @@ static int xlnx_mix_set_layer_window(struct xlnx_mix_hw *mixer,
 		s_reg = XVMIX_LAYERSTRIDE_0_DATA;
 
 		off = id * XVMIX_REG_OFFSET;
-		reg_writel(mixer->base, (x_reg + off), x_pos);
-		reg_writel(mixer->base, (y_reg + off), y_pos);
-		reg_writel(mixer->base, (w_reg + off), width);
-		reg_writel(mixer->base, (h_reg + off), height);
+		xlnx_mix_write(mixer, (x_reg + off), x_pos);
+		xlnx_mix_write(mixer, (y_reg + off), y_pos);
+		xlnx_mix_write(mixer, (w_reg + off), width);
+		xlnx_mix_write(mixer, (h_reg + off), height);
 		l_data->layer_regs.x_pos = x_pos;
 		l_data->layer_regs.y_pos = y_pos;
 		l_data->layer_regs.width = width;
 		l_data->layer_regs.height = height;
 
 		if (!l_data->hw_config.is_streaming)
-			reg_writel(mixer->base, (s_reg + off), stride);
+			xlnx_mix_write(mixer, (s_reg + off), stride);
 		status = 0;
 	}
 	return status;
@@ -1252,15 +1361,12 @@ static int xlnx_mix_set_layer_dimensions(struct xlnx_mix_plane *plane,
 	enum xlnx_mix_layer_id layer_id;
 	int ret = 0;
 
+	/*
+	 * The new window is latched along with the rest of the update, there
+	 * is no need to hide the layer while it is resized.
+	 */
 	layer_data = plane->mixer_layer;
 	layer_id = layer_data->id;
-	if (layer_data->layer_regs.height != height ||
-	    layer_data->layer_regs.width != width) {
-		if (mixer->drm_primary_layer == plane)
-			xlnx_mix_layer_disable(mixer_hw, XVMIX_LAYER_MASTER);
-
-		xlnx_mix_layer_disable(mixer_hw, layer_id);
-	}
 	if (mixer->drm_primary_layer == plane) {
 		crtc_x = 0;
 		crtc_y = 0;
@@ -1296,7 +1402,6 @@ static int xlnx_mix_set_layer_dimensions(struct xlnx_mix_plane *plane,
 static int xlnx_mix_set_layer_scaling(struct xlnx_mix_hw *mixer,
 				      enum xlnx_mix_layer_id id, u32 scale)
 {
-	void __iomem *reg = mixer->base;
 	struct xlnx_mix_layer_data *l_data;
 	int status = 0;
 	u32 x_pos, y_pos, width, height, offset;
@@ -1313,11 +1418,11 @@ static int xlnx_mix_set_layer_scaling(struct xlnx_mix_hw *mixer,
 	if (id == mixer->logo_layer_id) {
 		if (mixer->logo_layer_en) {
 			if (mixer->max_layers > XVMIX_MAX_OVERLAY_LAYERS)
-				reg_writel(reg, XVMIX_LOGOSCALEFACTOR_DATA +
-					   XVMIX_LOGO_OFFSET, scale);
+				xlnx_mix_write(mixer, XVMIX_LOGOSCALEFACTOR_DATA +
+					       XVMIX_LOGO_OFFSET, scale);
 			else
-				reg_writel(reg, XVMIX_LOGOSCALEFACTOR_DATA,
-					   scale);
+				xlnx_mix_write(mixer, XVMIX_LOGOSCALEFACTOR_DATA,
+					       scale);
 			l_data->layer_regs.scale_fact = scale;
 			status = 0;
 		}
@@ -1326,8 +1431,8 @@ static int xlnx_mix_set_layer_scaling(struct xlnx_mix_hw *mixer,
 		if (id < mixer->layer_cnt && l_data->hw_config.can_scale) {
 			offset = id * XVMIX_REG_OFFSET;
 
-			reg_writel(reg, (XVMIX_LAYERSCALE_0_DATA + offset),
-				   scale);
+			xlnx_mix_write(mixer, (XVMIX_LAYERSCALE_0_DATA + offset),
+				       scale);
 			l_data->layer_regs.scale_fact = scale;
 			status = 0;
 		}
@@ -1352,7 +1457,6 @@ static int xlnx_mix_set_layer_scale(struct xlnx_mix_plane *plane,
 {
 	struct xlnx_mix_hw *mixer_hw = to_mixer_hw(plane);
 	struct xlnx_mix_layer_data *layer = plane->mixer_layer;
-	int ret;
 
 	if (!layer || !layer->hw_config.can_scale)
 		return -ENODEV;
@@ -1360,12 +1464,8 @@ static int xlnx_mix_set_layer_scale(struct xlnx_mix_plane *plane,
 		DRM_ERROR("Mixer layer scale value illegal.\n");
 		return -EINVAL;
 	}
-	xlnx_mix_disp_layer_disable(plane);
-	msleep(50);
-	ret = xlnx_mix_set_layer_scaling(mixer_hw, layer->id, val);
-	xlnx_mix_disp_layer_enable(plane);
 
-	return ret;
+	return xlnx_mix_set_layer_scaling(mixer_hw, layer->id, val);
 }
 
 /**
@@ -1397,7 +1497,7 @@ static int xlnx_mix_set_layer_alpha(struct xlnx_mix_hw *mixer,
 				reg = XVMIX_LOGOALPHA_DATA + XVMIX_LOGO_OFFSET;
 			else
 				reg = XVMIX_LOGOALPHA_DATA;
-			reg_writel(mixer->base, reg, alpha);
+			xlnx_mix_write(mixer, reg, alpha);
 			layer_data->layer_regs.alpha = alpha;
 			status = 0;
 		}
@@ -1408,7 +1508,7 @@ static int xlnx_mix_set_layer_alpha(struct xlnx_mix_hw *mixer,
 			u32 offset =  layer_id * XVMIX_REG_OFFSET;
 
 			reg = XVMIX_LAYERALPHA_0_DATA;
-			reg_writel(mixer->base, (reg + offset), alpha);
+			xlnx_mix_write(mixer, (reg + offset), alpha);
 			layer_data->layer_regs.alpha = alpha;
 			status = 0;
 		}
@@ -1473,11 +1573,11 @@ static int xlnx_mix_set_layer_buff_addr(struct xlnx_mix_hw *mixer,
 	reg2 = XVMIX_LAYER1_BUF2_V_DATA + offset;
 	layer_data = &mixer->layer_data[id];
 	if (mixer->dma_addr_size == 64 && sizeof(dma_addr_t) == 8) {
-		reg_writeq(mixer->base, reg1, luma_addr);
-		reg_writeq(mixer->base, reg2, chroma_addr);
+		xlnx_mix_writeq(mixer, reg1, luma_addr);
+		xlnx_mix_writeq(mixer, reg2, chroma_addr);
 	} else {
-		reg_writel(mixer->base, reg1, (u32)luma_addr);
-		reg_writel(mixer->base, reg2, (u32)chroma_addr);
+		xlnx_mix_write(mixer, reg1, (u32)luma_addr);
+		xlnx_mix_write(mixer, reg2, (u32)chroma_addr);
 	}
 	layer_data->layer_regs.buff_addr1 = luma_addr;
 	layer_data->layer_regs.buff_addr2 = chroma_addr;
@@ -1899,7 +1999,6 @@ static int xlnx_mix_set_plane(struct xlnx_mix_plane *plane,
 		if (!plane->mixer_layer->hw_config.is_streaming)
 			xlnx_mix_mark_layer_inactive(plane);
 		if (mixer->drm_primary_layer == mixer->hw_master_layer) {
-			xlnx_mix_layer_disable(mixer_hw, layer_id);
 			ret = xlnx_mix_set_active_area(mixer_hw, src_w, src_h);
 			if (ret)
 				return ret;
@@ -2091,9 +2190,30 @@ static void xlnx_mix_plane_atomic_disable(struct drm_plane *plane,
 	xlnx_mix_plane_dpms(plane, DRM_MODE_DPMS_OFF);
 }
 
+/*
+ * Asynchronous updates are programmed right away and latched by the core at
+ * the next frame boundary, without waiting for vblank. They are limited to
+ * flips and moves of an enabled plane that keep the active area, which is
+ * set by the primary plane size.
+ */
 static int xlnx_mix_plane_atomic_async_check(struct drm_plane *plane,
 					     struct drm_atomic_state *state)
 {
+	struct drm_plane_state *new_state =
+		drm_atomic_get_new_plane_state(state, plane);
+	struct xlnx_mix_plane *mix_plane = to_xlnx_plane(plane);
+
+	if (!plane->state->fb || !new_state->fb)
+		return -EINVAL;
+
+	if (plane->state->fb->format != new_state->fb->format)
+		return -EINVAL;
+
+	if (mix_plane == mix_plane->mixer->drm_primary_layer &&
+	    (plane->state->src_w != new_state->src_w ||
+	     plane->state->src_h != new_state->src_h))
+		return -EINVAL;
+
 	return 0;
 }
 
@@ -2529,6 +2649,35 @@ static int xlnx_mix_of_init_layer(struct device *dev, struct device_node *node,
 	return ret;
 }
 
+/**
+ * xlnx_mix_shadow_latch - Apply the queued register writes
+ * @mixer: Mixer instance that completed a frame
+ *
+ * Called at the end of a frame. The queued writes take effect together at
+ * the frame that follows, so the event of the commit they belong to is
+ * armed to be sent when that frame completes.
+ */
+static void xlnx_mix_shadow_latch(struct xlnx_mix *mixer)
+{
+	struct xlnx_mix_hw *mixer_hw = &mixer->mixer_hw;
+	struct drm_pending_vblank_event *event = NULL;
+
+	spin_lock(&mixer_hw->shadow.lock);
+	if (!mixer_hw->shadow.hold) {
+		__xlnx_mix_shadow_flush(mixer_hw);
+		event = mixer->latch_event;
+		mixer->latch_event = NULL;
+	}
+	spin_unlock(&mixer_hw->shadow.lock);
+
+	if (event) {
+		spin_lock(&mixer->drm->event_lock);
+		WARN_ON(mixer->event);
+		mixer->event = event;
+		spin_unlock(&mixer->drm->event_lock);
+	}
+}
+
 static irqreturn_t xlnx_mix_intr_handler(int irq, void *data)
 {
 	struct xlnx_mix_hw *mixer = data;
@@ -2538,6 +2687,7 @@ static irqreturn_t xlnx_mix_intr_handler(int irq, void *data)
 		return IRQ_NONE;
 	if (mixer->intrpt_handler_fn)
 		mixer->intrpt_handler_fn(mixer->intrpt_data);
+	xlnx_mix_shadow_latch(container_of(mixer, struct xlnx_mix, mixer_hw));
 	xlnx_mix_clear_intr_status(mixer, intr);
 
 	return IRQ_HANDLED;
@@ -2674,9 +2824,9 @@ static void xlnx_mix_set_bkg_col(struct xlnx_mix_hw *mixer, u64 rgb_value)
 	u16 r_val = (rgb_value >> 0) &  val_mask;
 
 	/* Set Background Color */
-	reg_writel(mixer->base, XVMIX_BACKGROUND_Y_R_DATA, r_val);
-	reg_writel(mixer->base, XVMIX_BACKGROUND_U_G_DATA, g_val);
-	reg_writel(mixer->base, XVMIX_BACKGROUND_V_B_DATA, b_val);
+	xlnx_mix_write(mixer, XVMIX_BACKGROUND_Y_R_DATA, r_val);
+	xlnx_mix_write(mixer, XVMIX_BACKGROUND_U_G_DATA, g_val);
+	xlnx_mix_write(mixer, XVMIX_BACKGROUND_V_B_DATA, b_val);
 	mixer->bg_color = rgb_value;
 }
 
@@ -2692,6 +2842,7 @@ static void xlnx_mix_reset(struct xlnx_mix *mixer)
 
 	gpiod_set_raw_value(mixer_hw->reset_gpio, 0);
 	gpiod_set_raw_value(mixer_hw->reset_gpio, 1);
+	mixer_hw->layer_enable = XVMIX_MASK_DISABLE_ALL_LAYERS;
 	/* restore layer properties and bg color after reset */
 	xlnx_mix_set_bkg_col(mixer_hw, mixer_hw->bg_color);
 	xlnx_mix_plane_restore(mixer);
@@ -2894,11 +3045,43 @@ static void xlnx_mix_clear_event(struct drm_crtc *crtc)
 	}
 }
 
+/**
+ * xlnx_mix_send_pending_events - Send the events of the flips in flight
+ * @crtc: DRM crtc object
+ *
+ * Once the core is stopped no frame completes anymore, so the flips that
+ * were waiting for one are done.
+ */
+static void xlnx_mix_send_pending_events(struct drm_crtc *crtc)
+{
+	struct xlnx_mix *mixer = to_xlnx_mixer(to_xlnx_crtc(crtc));
+	struct drm_pending_vblank_event *events[2];
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&mixer->mixer_hw.shadow.lock, flags);
+	events[0] = mixer->latch_event;
+	mixer->latch_event = NULL;
+	spin_unlock_irqrestore(&mixer->mixer_hw.shadow.lock, flags);
+
+	spin_lock_irqsave(&crtc->dev->event_lock, flags);
+	events[1] = mixer->event;
+	mixer->event = NULL;
+	for (i = 0; i < ARRAY_SIZE(events); i++) {
+		if (!events[i])
+			continue;
+		drm_crtc_send_vblank_event(crtc, events[i]);
+		drm_crtc_vblank_put(crtc);
+	}
+	spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
+}
+
 static void
 xlnx_mix_crtc_atomic_disable(struct drm_crtc *crtc,
 			     struct drm_atomic_state *state)
 {
 	xlnx_mix_crtc_dpms(crtc, DRM_MODE_DPMS_OFF);
+	xlnx_mix_send_pending_events(crtc);
 	xlnx_mix_clear_event(crtc);
 	drm_crtc_vblank_off(crtc);
 }
@@ -2917,17 +3100,58 @@ static void
 xlnx_mix_crtc_atomic_begin(struct drm_crtc *crtc,
 			   struct drm_atomic_state *state)
 {
+	struct xlnx_mix *mixer = to_xlnx_mixer(to_xlnx_crtc(crtc));
+
 	drm_crtc_vblank_on(crtc);
+
+	/* Keep the plane updates of this commit together */
+	xlnx_mix_shadow_hold(&mixer->mixer_hw, true);
+}
+
+static void
+xlnx_mix_crtc_atomic_flush(struct drm_crtc *crtc,
+			   struct drm_atomic_state *state)
+{
+	struct xlnx_mix *mixer = to_xlnx_mixer(to_xlnx_crtc(crtc));
+	struct xlnx_mix_shadow *shadow = &mixer->mixer_hw.shadow;
+	struct drm_pending_vblank_event *event = crtc->state->event;
+	unsigned long flags;
+
+	if (!event) {
+		xlnx_mix_shadow_hold(&mixer->mixer_hw, false);
+		return;
+	}
+	crtc->state->event = NULL;
+
 	/* Don't rely on vblank when disabling crtc */
-	if (crtc->state->event) {
-		struct xlnx_crtc *xcrtc = to_xlnx_crtc(crtc);
-		struct xlnx_mix *mixer = to_xlnx_mixer(xcrtc);
+	if (!crtc->state->active) {
+		xlnx_mix_shadow_hold(&mixer->mixer_hw, false);
+		spin_lock_irqsave(&crtc->dev->event_lock, flags);
+		drm_crtc_send_vblank_event(crtc, event);
+		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
+		return;
+	}
 
-		/* Consume the flip_done event from atomic helper */
-		crtc->state->event->pipe = drm_crtc_index(crtc);
-		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
-		mixer->event = crtc->state->event;
-		crtc->state->event = NULL;
+	/* Consume the flip_done event from atomic helper */
+	event->pipe = drm_crtc_index(crtc);
+	WARN_ON(drm_crtc_vblank_get(crtc) != 0);
+
+	/*
+	 * With the core running, the flip is done once the frame that latches
+	 * the writes completes. Otherwise the writes are already in place.
+	 */
+	spin_lock_irqsave(&shadow->lock, flags);
+	shadow->hold = false;
+	if (shadow->running) {
+		mixer->latch_event = event;
+		event = NULL;
+	}
+	spin_unlock_irqrestore(&shadow->lock, flags);
+
+	if (event) {
+		spin_lock_irqsave(&crtc->dev->event_lock, flags);
+		mixer->event = event;
+		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
 	}
 }
 
@@ -2937,6 +3161,7 @@ static struct drm_crtc_helper_funcs xlnx_mix_crtc_helper_funcs = {
 	.mode_set_nofb	= xlnx_mix_crtc_mode_set_nofb,
 	.atomic_check	= xlnx_mix_crtc_atomic_check,
 	.atomic_begin	= xlnx_mix_crtc_atomic_begin,
+	.atomic_flush	= xlnx_mix_crtc_atomic_flush,
 };
 
 /**
@@ -3094,6 +3319,7 @@ static int xlnx_mix_probe(struct platform_device *pdev)
 	mixer = devm_kzalloc(&pdev->dev, sizeof(*mixer), GFP_KERNEL);
 	if (!mixer)
 		return -ENOMEM;
+	spin_lock_init(&mixer->mixer_hw.shadow.lock);
 
 	ret = of_reserved_mem_device_init(&pdev->dev);
 	if (ret)
@@ -12,6 +12,7 @@
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_crtc.h>
 #include <drm/drm_crtc_helper.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_fb_dma_helper.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_framebuffer.h>
@@ -22,6 +23,7 @@
 #include <linux/device.h>
 #include <linux/dmaengine.h>
 #include <linux/dma/xilinx_frmbuf.h>
+#include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_dma.h>
 #include <linux/platform_device.h>
@@ -40,8 +42,20 @@
  * driver by initializing DRM crtc and plane objects. The driver makes
  * an assumption that it's single plane pipeline, as multi-plane pipeline
  * would require programing beyond the DMA engine interface.
+ *
+ * The frame buffer read DMA keeps scanning out the last submitted frame, so
+ * a commit that leaves the frame buffer and its geometry untouched, such as
+ * the FB_DAMAGE_CLIPS commits of clients drawing into the displayed buffer,
+ * needs no new descriptor. Such commits are not submitted unless they
+ * request a vblank event. In the "only_on_change" mode they are never
+ * submitted and their event is sent right away.
  */
 
+static bool xlnx_pl_disp_only_on_change;
+module_param_named(only_on_change, xlnx_pl_disp_only_on_change, bool, 0644);
+MODULE_PARM_DESC(only_on_change,
+		 "Submit a frame only when the frame buffer or its geometry changes, also for page flips (default: 0)");
+
 /**
  * struct xlnx_dma_chan - struct for DMA engine
  * @dma_chan: DMA channel
@@ -72,6 +86,7 @@ struct xlnx_dma_chan {
  * @fid_err_val: field id error value
  * @fid_out_prop: field id out property
  * @fid_out_val: field out value
+ * @keep_frame: the commit being applied keeps the current frame
  */
 struct xlnx_pl_disp {
 	struct device *dev;
@@ -90,6 +105,7 @@ struct xlnx_pl_disp {
 	u32 fid_err_val;
 	struct drm_property *fid_out_prop;
 	u32 fid_out_val;
+	bool keep_frame;
 };
 
 /*
@@ -166,6 +182,52 @@ static inline struct xlnx_pl_disp *plane_to_dma(struct drm_plane *plane)
 	return container_of(plane, struct xlnx_pl_disp, plane);
 }
 
+/**
+ * xlnx_pl_disp_frame_unchanged - Check if a commit can keep the current frame
+ * @plane: DRM plane object
+ * @state: atomic state of the commit
+ *
+ * The current frame is kept when the commit changes neither the frame buffer
+ * nor the source and destination rectangles of the plane, and modesets
+ * nothing. Only the damage clips may differ, the damaged pixels already are
+ * in the buffer being scanned out. Unless in the "only_on_change" mode, the
+ * commits requesting a vblank event are still submitted for their pacing.
+ *
+ * Return: true if the commit needs no new DMA descriptor
+ */
+static bool xlnx_pl_disp_frame_unchanged(struct drm_plane *plane,
+					 struct drm_atomic_state *state)
+{
+	const struct drm_plane_state *old_state, *new_state;
+	struct drm_crtc_state *crtc_state;
+
+	old_state = drm_atomic_get_old_plane_state(state, plane);
+	new_state = drm_atomic_get_new_plane_state(state, plane);
+	if (!old_state || !new_state || !new_state->crtc || !new_state->fb)
+		return false;
+
+	crtc_state = drm_atomic_get_new_crtc_state(state, new_state->crtc);
+	if (!crtc_state || drm_atomic_crtc_needs_modeset(crtc_state))
+		return false;
+
+	/* Each field of an interlaced mode is a new frame */
+	if (crtc_state->adjusted_mode.flags & DRM_MODE_FLAG_INTERLACE)
+		return false;
+
+	if (crtc_state->event && !READ_ONCE(xlnx_pl_disp_only_on_change))
+		return false;
+
+	return old_state->fb == new_state->fb &&
+	       old_state->src_x == new_state->src_x &&
+	       old_state->src_y == new_state->src_y &&
+	       old_state->src_w == new_state->src_w &&
+	       old_state->src_h == new_state->src_h &&
+	       old_state->crtc_x == new_state->crtc_x &&
+	       old_state->crtc_y == new_state->crtc_y &&
+	       old_state->crtc_w == new_state->crtc_w &&
+	       old_state->crtc_h == new_state->crtc_h;
+}
+
 /**
  * xlnx_pl_disp_plane_disable - Disables DRM plane
  * @plane: DRM plane object
@@ -302,6 +364,10 @@ static void xlnx_pl_disp_plane_atomic_update(struct drm_plane *plane,
 	int ret;
 	struct xlnx_pl_disp *xlnx_pl_disp = plane_to_dma(plane);
 
+	/* The DMA keeps scanning out the frame buffer, damage included */
+	if (xlnx_pl_disp->keep_frame)
+		return;
+
 	ret = xlnx_pl_disp_plane_mode_set(plane,
 					  plane->state->fb,
 					  plane->state->crtc_x,
@@ -351,6 +417,8 @@ xlnx_pl_disp_plane_atomic_check(struct drm_plane *plane,
 	    old_plane_state->fb->format->format)
 		new_crtc_state->mode_changed = true;
 
+	drm_atomic_helper_check_plane_damage(state, new_plane_state);
+
 	return 0;
 }
 
@@ -398,9 +466,19 @@ static inline struct xlnx_pl_disp *drm_crtc_to_dma(struct drm_crtc *crtc)
 static void xlnx_pl_disp_crtc_atomic_begin(struct drm_crtc *crtc,
 					   struct drm_atomic_state *state)
 {
+	struct xlnx_pl_disp *xlnx_pl_disp = drm_crtc_to_dma(crtc);
+
+	/* Decided once, for the event and the plane update to agree */
+	xlnx_pl_disp->keep_frame =
+		xlnx_pl_disp_frame_unchanged(crtc->primary, state);
+
 	drm_crtc_vblank_on(crtc);
 	spin_lock_irq(&crtc->dev->event_lock);
-	if (crtc->state->event) {
+	if (crtc->state->event && xlnx_pl_disp->keep_frame) {
+		/* No frame is submitted to signal the event */
+		drm_crtc_send_vblank_event(crtc, crtc->state->event);
+		crtc->state->event = NULL;
+	} else if (crtc->state->event) {
 		/* Consume the flip_done event from atomic helper */
 		crtc->state->event->pipe = drm_crtc_index(crtc);
 		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
@@ -533,6 +611,7 @@ static int xlnx_pl_disp_bind(struct device *dev, struct device *master,
 
 	drm_plane_helper_add(&xlnx_pl_disp->plane,
 			     &xlnx_pl_disp_plane_helper_funcs);
+	drm_plane_enable_fb_damage_clips(&xlnx_pl_disp->plane);
 
 	ret = drm_crtc_init_with_planes(drm, &xlnx_pl_disp->xlnx_crtc.crtc,
 					&xlnx_pl_disp->plane, NULL,
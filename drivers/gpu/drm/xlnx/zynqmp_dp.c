@@ -18,6 +18,8 @@
 #include <drm/drm_probe_helper.h>
 #include <drm/drm_edid.h>
 
+#include <linux/crc32.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/module.h>
@@ -26,6 +28,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/phy/phy.h>
 #include <linux/reset.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 
 #include "zynqmp_disp.h"
@@ -43,6 +46,14 @@ static uint zynqmp_dp_power_on_delay_ms = 4;
 module_param_named(power_on_delay_ms, zynqmp_dp_power_on_delay_ms, uint, 0444);
 MODULE_PARM_DESC(power_on_delay_ms, "DP power on delay in msec (default: 4)");
 
+/*
+ * Reuse the last successful training values when the same sink comes back
+ */
+static bool zynqmp_dp_fast_train = true;
+module_param_named(fast_train, zynqmp_dp_fast_train, bool, 0644);
+MODULE_PARM_DESC(fast_train,
+		 "Reuse the training values of the last link with the same sink (default: 1)");
+
 /* Link configuration registers */
 #define ZYNQMP_DP_TX_LINK_BW_SET			0x0
 #define ZYNQMP_DP_TX_LANE_CNT_SET			0x4
@@ -294,6 +305,44 @@ struct zynqmp_dp_config {
 	u8 num_colors;
 };
 
+/**
+ * struct zynqmp_dp_train_cache - Values of the last successful link training
+ * @valid: flag to indicate the values can be reused
+ * @edid_hash: hash of the EDID of the sink the link was trained with
+ * @pclock: pixel clock of the mode the link was trained for
+ * @bw_code: trained link rate code
+ * @lane_cnt: trained number of lanes
+ * @train_set: trained voltage swing and pre-emphasis of each lane
+ */
+struct zynqmp_dp_train_cache {
+	bool valid;
+	u32 edid_hash;
+	int pclock;
+	u8 bw_code;
+	u8 lane_cnt;
+	u8 train_set[ZYNQMP_DP_MAX_LANES];
+};
+
+/**
+ * struct zynqmp_dp_train_stats - Link training statistics
+ * @full: number of full link trainings
+ * @full_fail: number of failed full link trainings
+ * @fast: number of attempts to reuse the cached training values
+ * @fast_fail: number of those attempts that fell back to full training
+ * @full_us: duration of the last successful full link training in usec
+ * @fast_us: duration of the last successful fast link training in usec
+ * @saved_us: total time saved by fast link training in usec
+ */
+struct zynqmp_dp_train_stats {
+	u64 full;
+	u64 full_fail;
+	u64 fast;
+	u64 fast_fail;
+	u64 full_us;
+	u64 fast_us;
+	u64 saved_us;
+};
+
 /**
  * struct zynqmp_dp - Xilinx DisplayPort core
  * @encoder: the drm encoder structure
@@ -318,6 +367,9 @@ struct zynqmp_dp_config {
  * @link_config: common link configuration between IP core and sink device
  * @mode: current mode between IP core and sink device
  * @train_set: set of training data
+ * @edid_hash: hash of the EDID of the connected sink, 0 if unknown
+ * @train_cache: values of the last successful link training
+ * @train_stats: link training statistics
  */
 struct zynqmp_dp {
 	struct drm_encoder encoder;
@@ -344,6 +396,9 @@ struct zynqmp_dp {
 	struct zynqmp_dp_link_config link_config;
 	struct zynqmp_dp_mode mode;
 	u8 train_set[ZYNQMP_DP_MAX_LANES];
+	u32 edid_hash;
+	struct zynqmp_dp_train_cache train_cache;
+	struct zynqmp_dp_train_stats train_stats;
 };
 
 static inline struct zynqmp_dp *encoder_to_dp(struct drm_encoder *encoder)
@@ -921,12 +976,12 @@ static int zynqmp_dp_link_train_ce(struct zynqmp_dp *dp)
 }
 
 /**
- * zynqmp_dp_train - Train the link
+ * zynqmp_dp_link_setup - Program the link rate and lane count for training
  * @dp: DisplayPort IP core structure
  *
- * Return: 0 if all trains are done successfully, or corresponding error code.
+ * Return: 0 if the link is set up successfully, or corresponding error code.
  */
-static int zynqmp_dp_train(struct zynqmp_dp *dp)
+static int zynqmp_dp_link_setup(struct zynqmp_dp *dp)
 {
 	u32 reg;
 	u8 bw_code = dp->mode.bw_code;
@@ -991,14 +1046,20 @@ static int zynqmp_dp_train(struct zynqmp_dp *dp)
 		return ret;
 
 	zynqmp_dp_write(dp->iomem, ZYNQMP_DP_TX_SCRAMBLING_DISABLE, 1);
-	memset(dp->train_set, 0, ARRAY_SIZE(dp->train_set));
-	ret = zynqmp_dp_link_train_cr(dp);
-	if (ret)
-		return ret;
 
-	ret = zynqmp_dp_link_train_ce(dp);
-	if (ret)
-		return ret;
+	return 0;
+}
+
+/**
+ * zynqmp_dp_link_train_done - Leave the training and enable scrambling
+ * @dp: DisplayPort IP core structure
+ *
+ * Return: 0 if the training pattern is disabled successfully, or corresponding
+ * error code.
+ */
+static int zynqmp_dp_link_train_done(struct zynqmp_dp *dp)
+{
+	int ret;
 
 	ret = drm_dp_dpcd_writeb(&dp->aux, DP_TRAINING_PATTERN_SET,
 				 DP_TRAINING_PATTERN_DISABLE);
@@ -1014,26 +1075,181 @@ static int zynqmp_dp_train(struct zynqmp_dp *dp)
 	return 0;
 }
 
+/**
+ * zynqmp_dp_train - Train the link
+ * @dp: DisplayPort IP core structure
+ *
+ * Return: 0 if all trains are done successfully, or corresponding error code.
+ */
+static int zynqmp_dp_train(struct zynqmp_dp *dp)
+{
+	int ret;
+
+	ret = zynqmp_dp_link_setup(dp);
+	if (ret)
+		return ret;
+
+	memset(dp->train_set, 0, ARRAY_SIZE(dp->train_set));
+	ret = zynqmp_dp_link_train_cr(dp);
+	if (ret)
+		return ret;
+
+	ret = zynqmp_dp_link_train_ce(dp);
+	if (ret)
+		return ret;
+
+	return zynqmp_dp_link_train_done(dp);
+}
+
+/**
+ * zynqmp_dp_train_fast - Bring the link up with the cached training values
+ * @dp: DisplayPort IP core structure
+ *
+ * Program the link rate, lane count, voltage swing and pre-emphasis of the
+ * last successful training, send each training pattern once for its
+ * minimum duration and check the link status, without the adjustment
+ * iterations of a full training.
+ *
+ * Return: 0 if the link is up with the cached values, or corresponding error
+ * code.
+ */
+static int zynqmp_dp_train_fast(struct zynqmp_dp *dp)
+{
+	struct zynqmp_dp_train_cache *cache = &dp->train_cache;
+	u8 link_status[DP_LINK_STATUS_SIZE];
+	u8 lane_cnt = cache->lane_cnt;
+	u32 pat;
+	int ret;
+
+	dp->mode.bw_code = cache->bw_code;
+	dp->mode.lane_cnt = lane_cnt;
+	ret = zynqmp_dp_link_setup(dp);
+	if (ret)
+		return ret;
+
+	memcpy(dp->train_set, cache->train_set, sizeof(dp->train_set));
+	ret = zynqmp_dp_update_vs_emph(dp);
+	if (ret)
+		return ret;
+
+	zynqmp_dp_write(dp->iomem, ZYNQMP_DP_TX_TRAINING_PATTERN_SET,
+			DP_TRAINING_PATTERN_1);
+	ret = drm_dp_dpcd_writeb(&dp->aux, DP_TRAINING_PATTERN_SET,
+				 DP_TRAINING_PATTERN_1 |
+				 DP_LINK_SCRAMBLING_DISABLE);
+	if (ret < 0)
+		return ret;
+	drm_dp_link_train_clock_recovery_delay(&dp->aux, dp->dpcd);
+
+	if (dp->dpcd[DP_DPCD_REV] >= DP_V1_2 &&
+	    dp->dpcd[DP_MAX_LANE_COUNT] & DP_TPS3_SUPPORTED)
+		pat = DP_TRAINING_PATTERN_3;
+	else
+		pat = DP_TRAINING_PATTERN_2;
+
+	zynqmp_dp_write(dp->iomem, ZYNQMP_DP_TX_TRAINING_PATTERN_SET, pat);
+	ret = drm_dp_dpcd_writeb(&dp->aux, DP_TRAINING_PATTERN_SET,
+				 pat | DP_LINK_SCRAMBLING_DISABLE);
+	if (ret < 0)
+		return ret;
+	drm_dp_link_train_channel_eq_delay(&dp->aux, dp->dpcd);
+
+	ret = drm_dp_dpcd_read_link_status(&dp->aux, link_status);
+	if (ret < 0)
+		return ret;
+
+	if (!drm_dp_clock_recovery_ok(link_status, lane_cnt) ||
+	    !drm_dp_channel_eq_ok(link_status, lane_cnt))
+		return -EIO;
+
+	return zynqmp_dp_link_train_done(dp);
+}
+
+/**
+ * zynqmp_dp_train_cache_match - Check if the cached training values apply
+ * @dp: DisplayPort IP core structure
+ *
+ * Return: true if the cached values were trained with the connected sink for
+ * the current mode, false otherwise.
+ */
+static bool zynqmp_dp_train_cache_match(struct zynqmp_dp *dp)
+{
+	struct zynqmp_dp_train_cache *cache = &dp->train_cache;
+
+	return zynqmp_dp_fast_train && cache->valid && dp->edid_hash &&
+	       cache->edid_hash == dp->edid_hash &&
+	       cache->pclock == dp->mode.pclock &&
+	       cache->lane_cnt <= dp->link_config.max_lanes &&
+	       drm_dp_bw_code_to_link_rate(cache->bw_code) <=
+	       dp->link_config.max_rate;
+}
+
+static void zynqmp_dp_train_cache_store(struct zynqmp_dp *dp)
+{
+	struct zynqmp_dp_train_cache *cache = &dp->train_cache;
+
+	cache->edid_hash = dp->edid_hash;
+	cache->pclock = dp->mode.pclock;
+	cache->bw_code = dp->mode.bw_code;
+	cache->lane_cnt = dp->mode.lane_cnt;
+	memcpy(cache->train_set, dp->train_set, sizeof(cache->train_set));
+	cache->valid = true;
+}
+
 /**
  * zynqmp_dp_train_loop - Downshift the link rate during training
  * @dp: DisplayPort IP core structure
  *
  * Train the link by downshifting the link rate if training is not successful.
+ * The values of the last successful training with the same sink are tried
+ * first, and a full training only runs if the link doesn't come up with them.
  */
 static void zynqmp_dp_train_loop(struct zynqmp_dp *dp)
 {
+	struct zynqmp_dp_train_stats *stats = &dp->train_stats;
 	struct zynqmp_dp_mode *mode = &dp->mode;
+	u8 bw_code = mode->bw_code, lane_cnt = mode->lane_cnt;
 	u8 bw = mode->bw_code;
+	ktime_t start;
+	u64 elapsed;
 	int ret;
 
+	if (dp->status == connector_status_disconnected || !dp->enabled)
+		return;
+
+	if (zynqmp_dp_train_cache_match(dp)) {
+		stats->fast++;
+		start = ktime_get();
+		ret = zynqmp_dp_train_fast(dp);
+		if (!ret) {
+			elapsed = ktime_us_delta(ktime_get(), start);
+			stats->fast_us = elapsed;
+			if (stats->full_us > elapsed)
+				stats->saved_us += stats->full_us - elapsed;
+			return;
+		}
+
+		stats->fast_fail++;
+		dp->train_cache.valid = false;
+		dev_dbg(dp->dev, "cached link training failed, retraining\n");
+		mode->bw_code = bw_code;
+		mode->lane_cnt = lane_cnt;
+	}
+
+	start = ktime_get();
 	do {
 		if (dp->status == connector_status_disconnected ||
 		    !dp->enabled)
 			return;
 
+		stats->full++;
 		ret = zynqmp_dp_train(dp);
-		if (!ret)
+		if (!ret) {
+			stats->full_us = ktime_us_delta(ktime_get(), start);
+			zynqmp_dp_train_cache_store(dp);
 			return;
+		}
+		stats->full_fail++;
 
 		ret = zynqmp_dp_mode_configure(dp, mode->pclock, bw);
 		if (ret < 0)
@@ -1479,6 +1695,8 @@ zynqmp_dp_connector_detect(struct drm_connector *connector, bool force)
 
 disconnected:
 	dp->status = connector_status_disconnected;
+	dp->edid_hash = 0;
+	dp->train_cache.valid = false;
 	return connector_status_disconnected;
 }
 
@@ -1489,9 +1707,14 @@ static int zynqmp_dp_connector_get_modes(struct drm_connector *connector)
 	int ret;
 
 	edid = drm_get_edid(connector, &dp->aux.ddc);
-	if (!edid)
+	if (!edid) {
+		dp->edid_hash = 0;
 		return 0;
+	}
 
+	/* Identifies the sink for reusing the link training values */
+	dp->edid_hash = crc32_le(~0, (u8 *)edid,
+				 EDID_LENGTH * (edid->extensions + 1));
 	drm_connector_update_edid_property(connector, edid);
 	ret = drm_add_edid_modes(connector, edid);
 	kfree(edid);
@@ -1585,6 +1808,34 @@ zynqmp_dp_connector_atomic_get_property(struct drm_connector *connector,
 	return 0;
 }
 
+static int zynqmp_dp_train_stats_show(struct seq_file *s, void *data)
+{
+	struct zynqmp_dp *dp = s->private;
+	struct zynqmp_dp_train_stats *stats = &dp->train_stats;
+
+	seq_printf(s, "full trainings: %llu (%llu failed)\n",
+		   stats->full, stats->full_fail);
+	seq_printf(s, "fast trainings: %llu (%llu failed)\n",
+		   stats->fast, stats->fast_fail);
+	seq_printf(s, "last full training: %llu us\n", stats->full_us);
+	seq_printf(s, "last fast training: %llu us\n", stats->fast_us);
+	seq_printf(s, "time saved: %llu us\n", stats->saved_us);
+	seq_printf(s, "cache: %s\n", dp->train_cache.valid ?
+		   "valid" : "invalid");
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(zynqmp_dp_train_stats);
+
+static void zynqmp_dp_connector_debugfs_init(struct drm_connector *connector,
+					     struct dentry *root)
+{
+	struct zynqmp_dp *dp = connector_to_dp(connector);
+
+	debugfs_create_file("link_train_stats", 0444, root, dp,
+			    &zynqmp_dp_train_stats_fops);
+}
+
 static const struct drm_connector_funcs zynqmp_dp_connector_funcs = {
 	.detect			= zynqmp_dp_connector_detect,
 	.fill_modes		= drm_helper_probe_single_connector_modes,
@@ -1594,6 +1845,7 @@ static const struct drm_connector_funcs zynqmp_dp_connector_funcs = {
 	.reset			= drm_atomic_helper_connector_reset,
 	.atomic_set_property	= zynqmp_dp_connector_atomic_set_property,
 	.atomic_get_property	= zynqmp_dp_connector_atomic_get_property,
+	.debugfs_init		= zynqmp_dp_connector_debugfs_init,
 };
 
 static struct drm_connector_helper_funcs zynqmp_dp_connector_helper_funcs = {
@@ -72,6 +72,7 @@ static int zynqmp_dpsub_probe(struct platform_device *pdev)
 	/* Sub-driver will access dpsub from drvdata */
 	platform_set_drvdata(pdev, dpsub);
 	pm_runtime_enable(&pdev->dev);
+	device_enable_async_suspend(&pdev->dev);
 
 	/*
 	 * DP should be probed first so that the zynqmp_disp can set the output
@@ -11,6 +11,8 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
@@ -132,6 +134,11 @@
 #define CDNS_I2C_POLL_US	100000
 #define CDNS_I2C_TIMEOUT_US	500000
 
+static unsigned int poll_max_us = 200;
+module_param(poll_max_us, uint, 0644);
+MODULE_PARM_DESC(poll_max_us,
+		 "Poll for the completion of the transfers shorter than this on the wire, 0 to always wait for the interrupt (default: 200)");
+
 #define cdns_i2c_readreg(offset)       readl_relaxed(id->membase + offset)
 #define cdns_i2c_writereg(val, offset) writel_relaxed(val, id->membase + offset)
 
@@ -161,6 +168,24 @@ enum cdns_i2c_slave_state {
 };
 #endif
 
+/**
+ * struct cdns_i2c_stats - Transfer statistics of the adapter
+ * @xfers:		Number of transfers
+ * @polled:		Number of transfers completed by polling
+ * @errors:		Number of transfers that failed
+ * @timeouts:		Number of transfers that timed out
+ * @latency_ns:		Total time spent in the transfers
+ * @max_latency_ns:	Time spent in the longest transfer
+ */
+struct cdns_i2c_stats {
+	u64 xfers;
+	u64 polled;
+	u64 errors;
+	u64 timeouts;
+	u64 latency_ns;
+	u64 max_latency_ns;
+};
+
 /**
  * struct cdns_i2c - I2C device private data structure
  *
@@ -183,6 +208,9 @@ enum cdns_i2c_slave_state {
  * @clk_rate_change_nb:	Notifier block for clock rate changes
  * @quirks:		flag for broken hold bit usage in r1p10
  * @ctrl_reg:		Cached value of the control register.
+ * @polled:		Completion of the messages is polled, interrupts are
+ *			disabled
+ * @stats:		Transfer statistics, protected by the adapter bus lock
  * @ctrl_reg_diva_divb: value of fields DIV_A and DIV_B from CR register
  * @slave:		Registered slave instance.
  * @dev_mode:		I2C operating role(master/slave).
@@ -208,6 +236,8 @@ struct cdns_i2c {
 	struct notifier_block clk_rate_change_nb;
 	u32 quirks;
 	u32 ctrl_reg;
+	bool polled;
+	struct cdns_i2c_stats stats;
 	struct i2c_bus_recovery_info rinfo;
 #if IS_ENABLED(CONFIG_I2C_SLAVE)
 	u16 ctrl_reg_diva_divb;
@@ -652,7 +682,9 @@ static void cdns_i2c_mrecv(struct cdns_i2c *id)
 		cdns_i2c_writereg(addr, CDNS_I2C_ADDR_OFFSET);
 	}
 
-	cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK, CDNS_I2C_IER_OFFSET);
+	if (!id->polled)
+		cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK,
+				  CDNS_I2C_IER_OFFSET);
 }
 
 /**
@@ -715,7 +747,9 @@ static void cdns_i2c_msend(struct cdns_i2c *id)
 	cdns_i2c_writereg(id->p_msg->addr & CDNS_I2C_ADDR_MASK,
 						CDNS_I2C_ADDR_OFFSET);
 
-	cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK, CDNS_I2C_IER_OFFSET);
+	if (!id->polled)
+		cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK,
+				  CDNS_I2C_IER_OFFSET);
 }
 
 /**
@@ -747,6 +781,70 @@ static void cdns_i2c_master_reset(struct i2c_adapter *adap)
 	cdns_i2c_writereg(regval, CDNS_I2C_SR_OFFSET);
 }
 
+/**
+ * cdns_i2c_xfer_is_short - Check if the completion of a transfer is polled
+ * @id:		pointer to the i2c device
+ * @msgs:	pointer to the i2c message structure
+ * @num:	the number of messages to transfer
+ *
+ * Short transfers complete in less time than it takes to take and handle an
+ * interrupt per message, their completion is polled instead.
+ *
+ * Return: true if the transfer is short enough to poll for its completion
+ */
+static bool cdns_i2c_xfer_is_short(struct cdns_i2c *id, struct i2c_msg *msgs,
+				   int num)
+{
+	u64 bits = 0;
+	int i;
+
+	if (!poll_max_us || !id->i2c_clk)
+		return false;
+
+	for (i = 0; i < num; i++) {
+		/* The length of a block read is only known on the wire */
+		if (msgs[i].flags & I2C_M_RECV_LEN)
+			return false;
+
+		/* Address and data bytes, each followed by an ACK bit */
+		bits += (msgs[i].len + 1) * 9;
+	}
+
+	return div_u64(bits * USEC_PER_SEC, id->i2c_clk) <= poll_max_us;
+}
+
+static bool cdns_i2c_poll_completion(struct cdns_i2c *id)
+{
+	/* Leave the slaves some room for clock stretching */
+	ktime_t timeout = ktime_add_us(ktime_get(), 2 * poll_max_us);
+
+	while (!completion_done(&id->xfer_done)) {
+		if (ktime_after(ktime_get(), timeout))
+			return false;
+
+		cdns_i2c_master_isr(id);
+		cpu_relax();
+	}
+
+	return true;
+}
+
+static void cdns_i2c_account_xfer(struct cdns_i2c *id, ktime_t start, int ret)
+{
+	struct cdns_i2c_stats *stats = &id->stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats->xfers++;
+	if (id->polled)
+		stats->polled++;
+	if (ret == -ETIMEDOUT)
+		stats->timeouts++;
+	else if (ret < 0)
+		stats->errors++;
+	stats->latency_ns += ns;
+	stats->max_latency_ns = max(stats->max_latency_ns, ns);
+}
+
 static int cdns_i2c_process_msg(struct cdns_i2c *id, struct i2c_msg *msg,
 		struct i2c_adapter *adap)
 {
@@ -783,6 +881,16 @@ static int cdns_i2c_process_msg(struct cdns_i2c *id, struct i2c_msg *msg,
 	if (msg_timeout < adap->timeout)
 		msg_timeout = adap->timeout;
 
+	/*
+	 * Hand the rest of the transfer over to the interrupt if polling for
+	 * the completion of the message took too long.
+	 */
+	if (id->polled && !cdns_i2c_poll_completion(id)) {
+		id->polled = false;
+		cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK,
+				  CDNS_I2C_IER_OFFSET);
+	}
+
 	/* Wait for the signal of completion */
 	time_left = wait_for_completion_timeout(&id->xfer_done, msg_timeout);
 	if (time_left == 0) {
@@ -822,6 +930,7 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 	u32 reg;
 	struct cdns_i2c *id = adap->algo_data;
 	bool hold_quirk;
+	ktime_t start;
 #if IS_ENABLED(CONFIG_I2C_SLAVE)
 	bool change_role = false;
 #endif
@@ -830,6 +939,9 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 	if (ret < 0)
 		return ret;
 
+	start = ktime_get();
+	id->polled = false;
+
 #if IS_ENABLED(CONFIG_I2C_SLAVE)
 	/* Check i2c operating mode and switch if possible */
 	if (id->dev_mode == CDNS_I2C_MODE_SLAVE) {
@@ -886,6 +998,12 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 		id->bus_hold_flag = 0;
 	}
 
+	/*
+	 * The HOLD bit keeps the bus between the messages, so polling saves
+	 * the interrupt of each message of the transfer.
+	 */
+	id->polled = cdns_i2c_xfer_is_short(id, msgs, num);
+
 	/* Process the msg one by one */
 	for (count = 0; count < num; count++, msgs++) {
 		if (count == (num - 1))
@@ -911,6 +1029,7 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 	ret = num;
 
 out:
+	cdns_i2c_account_xfer(id, start, ret);
 
 #if IS_ENABLED(CONFIG_I2C_SLAVE)
 	/* Switch i2c mode to slave */
@@ -1225,6 +1344,48 @@ static const struct cdns_platform_data r1p10_i2c_def = {
 	.quirks = CDNS_I2C_BROKEN_HOLD_BIT,
 };
 
+#define CDNS_I2C_STATS_ATTR(_name)					\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct cdns_i2c *id = dev_get_drvdata(dev);			\
+	u64 val;							\
+									\
+	i2c_lock_bus(&id->adap, I2C_LOCK_ROOT_ADAPTER);			\
+	val = id->stats._name;						\
+	i2c_unlock_bus(&id->adap, I2C_LOCK_ROOT_ADAPTER);		\
+									\
+	return sysfs_emit(buf, "%llu\n", val);				\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+CDNS_I2C_STATS_ATTR(xfers);
+CDNS_I2C_STATS_ATTR(polled);
+CDNS_I2C_STATS_ATTR(errors);
+CDNS_I2C_STATS_ATTR(timeouts);
+CDNS_I2C_STATS_ATTR(latency_ns);
+CDNS_I2C_STATS_ATTR(max_latency_ns);
+
+static struct attribute *cdns_i2c_stats_attrs[] = {
+	&dev_attr_xfers.attr,
+	&dev_attr_polled.attr,
+	&dev_attr_errors.attr,
+	&dev_attr_timeouts.attr,
+	&dev_attr_latency_ns.attr,
+	&dev_attr_max_latency_ns.attr,
+	NULL,
+};
+
+static const struct attribute_group cdns_i2c_stats_group = {
+	.name = "statistics",
+	.attrs = cdns_i2c_stats_attrs,
+};
+
+static const struct attribute_group *cdns_i2c_groups[] = {
+	&cdns_i2c_stats_group,
+	NULL,
+};
+
 static const struct of_device_id cdns_i2c_of_match[] = {
 	{ .compatible = "cdns,i2c-r1p10", .data = &r1p10_i2c_def },
 	{ .compatible = "cdns,i2c-r1p14",},
@@ -1384,6 +1545,7 @@ static struct platform_driver cdns_i2c_drv = {
 		.name  = DRIVER_NAME,
 		.of_match_table = cdns_i2c_of_match,
 		.pm = &cdns_i2c_dev_pm_ops,
+		.dev_groups = cdns_i2c_groups,
 	},
 	.probe  = cdns_i2c_probe,
 	.remove = cdns_i2c_remove,
@@ -24,6 +24,8 @@
 #include <linux/i2c.h>
 #include <linux/interrupt.h>
 #include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/platform_data/i2c-xiic.h>
 #include <linux/io.h>
 #include <linux/slab.h>
@@ -35,6 +37,11 @@
 #define DYNAMIC_MODE_READ_BROKEN_BIT	BIT(0)
 #define SMBUS_BLOCK_READ_MIN_LEN	3
 
+static unsigned int poll_max_us = 200;
+module_param(poll_max_us, uint, 0644);
+MODULE_PARM_DESC(poll_max_us,
+		 "Poll for the completion of the transfers shorter than this on the wire, 0 to always wait for the interrupt (default: 200)");
+
 enum xilinx_i2c_state {
 	STATE_DONE,
 	STATE_ERROR,
@@ -52,6 +59,24 @@ enum i2c_scl_freq {
 	REG_VALUES_1MHZ = 2
 };
 
+/**
+ * struct xiic_stats - Transfer statistics of the adapter
+ * @xfers: Number of transfers
+ * @polled: Number of transfers completed by polling
+ * @errors: Number of transfers that failed
+ * @timeouts: Number of transfers that timed out
+ * @latency_ns: Total time spent in the transfers
+ * @max_latency_ns: Time spent in the longest transfer
+ */
+struct xiic_stats {
+	u64 xfers;
+	u64 polled;
+	u64 errors;
+	u64 timeouts;
+	u64 latency_ns;
+	u64 max_latency_ns;
+};
+
 /**
  * struct xiic_i2c - Internal representation of the XIIC I2C bus
  * @dev: Pointer to device structure
@@ -74,6 +99,8 @@ enum i2c_scl_freq {
  * @smbus_block_read: Flag to handle block read
  * @input_clk: Input clock to I2C controller
  * @i2c_clk: I2C SCL frequency
+ * @polled: Transfer completion is polled, the interrupt is disabled
+ * @stats: Transfer statistics, protected by the adapter bus lock
  */
 struct xiic_i2c {
 	struct device *dev;
@@ -96,6 +123,8 @@ struct xiic_i2c {
 	bool smbus_block_read;
 	unsigned long input_clk;
 	unsigned int i2c_clk;
+	bool polled;
+	struct xiic_stats stats;
 };
 
 struct xiic_version_data {
@@ -991,7 +1020,8 @@ static void xiic_start_recv(struct xiic_i2c *i2c)
 	i2c->tx_pos = msg->len;
 
 	/* Enable interrupts */
-	xiic_setreg32(i2c, XIIC_DGIER_OFFSET, XIIC_GINTR_ENABLE_MASK);
+	if (!i2c->polled)
+		xiic_setreg32(i2c, XIIC_DGIER_OFFSET, XIIC_GINTR_ENABLE_MASK);
 
 	i2c->prev_msg_tx = false;
 }
@@ -1074,6 +1104,27 @@ static void xiic_start_send(struct xiic_i2c *i2c)
 	i2c->prev_msg_tx = true;
 }
 
+/*
+ * In dynamic mode the start, the address and the stop of each message are
+ * written to the TX FIFO along with the data, so once a message has been
+ * queued completely the next one is queued behind it, instead of waiting
+ * for the TX FIFO half empty interrupt to do it.
+ */
+static bool xiic_queue_next(struct xiic_i2c *i2c)
+{
+	if (!i2c->dynamic || i2c->nmsgs < 2 || xiic_tx_space(i2c) ||
+	    xiic_tx_fifo_space(i2c) < 2)
+		return false;
+
+	dev_dbg(i2c->adap.dev.parent, "%s queueing next, nmsgs: %d\n",
+		__func__, i2c->nmsgs);
+
+	i2c->nmsgs--;
+	i2c->tx_msg++;
+
+	return true;
+}
+
 static void __xiic_start_xfer(struct xiic_i2c *i2c)
 {
 	int fifo_space = xiic_tx_fifo_space(i2c);
@@ -1084,15 +1135,75 @@ static void __xiic_start_xfer(struct xiic_i2c *i2c)
 	if (!i2c->tx_msg)
 		return;
 
-	i2c->rx_pos = 0;
-	i2c->tx_pos = 0;
-	i2c->state = STATE_START;
-	if (i2c->tx_msg->flags & I2C_M_RD) {
-		/* we dont date putting several reads in the FIFO */
-		xiic_start_recv(i2c);
-	} else {
+	do {
+		i2c->rx_pos = 0;
+		i2c->tx_pos = 0;
+		i2c->state = STATE_START;
+		if (i2c->tx_msg->flags & I2C_M_RD) {
+			/* we dont date putting several reads in the FIFO */
+			xiic_start_recv(i2c);
+			break;
+		}
+
 		xiic_start_send(i2c);
+	} while (xiic_queue_next(i2c));
+}
+
+/*
+ * Short transfers complete in less time than it takes to schedule the
+ * interrupt thread, poll for their completion instead.
+ */
+static bool xiic_xfer_is_short(struct xiic_i2c *i2c, struct i2c_msg *msgs,
+			       int num)
+{
+	u64 bits = 0;
+	int i;
+
+	if (!poll_max_us || !i2c->i2c_clk)
+		return false;
+
+	for (i = 0; i < num; i++) {
+		/* The length of a block read is only known on the wire */
+		if (msgs[i].flags & I2C_M_RECV_LEN)
+			return false;
+
+		/* Address and data bytes, each followed by an ACK bit */
+		bits += (msgs[i].len + 1) * 9;
+	}
+
+	return div_u64(bits * USEC_PER_SEC, i2c->i2c_clk) <= poll_max_us;
+}
+
+static bool xiic_poll_completion(struct xiic_i2c *i2c)
+{
+	/* Leave the slaves some room for clock stretching */
+	ktime_t timeout = ktime_add_us(ktime_get(), 2 * poll_max_us);
+
+	while (!completion_done(&i2c->completion)) {
+		if (ktime_after(ktime_get(), timeout))
+			return false;
+
+		xiic_process(0, i2c);
+		cpu_relax();
 	}
+
+	return true;
+}
+
+static void xiic_account_xfer(struct xiic_i2c *i2c, ktime_t start, int ret)
+{
+	struct xiic_stats *stats = &i2c->stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats->xfers++;
+	if (i2c->polled)
+		stats->polled++;
+	if (ret == -ETIMEDOUT)
+		stats->timeouts++;
+	else if (ret < 0)
+		stats->errors++;
+	stats->latency_ns += ns;
+	stats->max_latency_ns = max(stats->max_latency_ns, ns);
 }
 
 static int xiic_start_xfer(struct xiic_i2c *i2c, struct i2c_msg *msgs, int num)
@@ -1109,6 +1220,7 @@ static int xiic_start_xfer(struct xiic_i2c *i2c, struct i2c_msg *msgs, int num)
 	i2c->tx_msg = msgs;
 	i2c->rx_msg = NULL;
 	i2c->nmsgs = num;
+	i2c->polled = xiic_xfer_is_short(i2c, msgs, num);
 	init_completion(&i2c->completion);
 
 	/* Decide standard mode or Dynamic mode */
@@ -1140,8 +1252,11 @@ static int xiic_start_xfer(struct xiic_i2c *i2c, struct i2c_msg *msgs, int num)
 	}
 
 	ret = xiic_reinit(i2c);
-	if (!ret)
+	if (!ret) {
+		if (i2c->polled)
+			xiic_setreg32(i2c, XIIC_DGIER_OFFSET, 0);
 		__xiic_start_xfer(i2c);
+	}
 
 out:
 	mutex_unlock(&i2c->lock);
@@ -1152,6 +1267,7 @@ static int xiic_start_xfer(struct xiic_i2c *i2c, struct i2c_msg *msgs, int num)
 static int xiic_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 {
 	struct xiic_i2c *i2c = i2c_get_adapdata(adap);
+	ktime_t start;
 	int err;
 
 	dev_dbg(adap->dev.parent, "%s entry SR: 0x%x\n", __func__,
@@ -1161,12 +1277,23 @@ static int xiic_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 	if (err < 0)
 		return err;
 
+	start = ktime_get();
 	err = xiic_start_xfer(i2c, msgs, num);
 	if (err < 0) {
 		dev_err(adap->dev.parent, "Error xiic_start_xfer\n");
+		i2c->polled = false;
+		xiic_account_xfer(i2c, start, err);
 		return err;
 	}
 
+	if (i2c->polled && !xiic_poll_completion(i2c)) {
+		/* Hand the rest of the transfer over to the interrupt */
+		mutex_lock(&i2c->lock);
+		i2c->polled = false;
+		xiic_setreg32(i2c, XIIC_DGIER_OFFSET, XIIC_GINTR_ENABLE_MASK);
+		mutex_unlock(&i2c->lock);
+	}
+
 	err = wait_for_completion_timeout(&i2c->completion, XIIC_XFER_TIMEOUT);
 	mutex_lock(&i2c->lock);
 	if (err == 0) {	/* Timeout */
@@ -1181,6 +1308,7 @@ static int xiic_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 	} else {
 		err = (i2c->state == STATE_DONE) ? num : -EIO;
 	}
+	xiic_account_xfer(i2c, start, err);
 	mutex_unlock(&i2c->lock);
 	pm_runtime_mark_last_busy(i2c->dev);
 	pm_runtime_put_autosuspend(i2c->dev);
@@ -1203,6 +1331,48 @@ static const struct i2c_adapter xiic_adapter = {
 	.algo = &xiic_algorithm,
 };
 
+#define XIIC_STATS_ATTR(_name)						\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct xiic_i2c *i2c = dev_get_drvdata(dev);			\
+	u64 val;							\
+									\
+	i2c_lock_bus(&i2c->adap, I2C_LOCK_ROOT_ADAPTER);		\
+	val = i2c->stats._name;						\
+	i2c_unlock_bus(&i2c->adap, I2C_LOCK_ROOT_ADAPTER);		\
+									\
+	return sysfs_emit(buf, "%llu\n", val);				\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+XIIC_STATS_ATTR(xfers);
+XIIC_STATS_ATTR(polled);
+XIIC_STATS_ATTR(errors);
+XIIC_STATS_ATTR(timeouts);
+XIIC_STATS_ATTR(latency_ns);
+XIIC_STATS_ATTR(max_latency_ns);
+
+static struct attribute *xiic_stats_attrs[] = {
+	&dev_attr_xfers.attr,
+	&dev_attr_polled.attr,
+	&dev_attr_errors.attr,
+	&dev_attr_timeouts.attr,
+	&dev_attr_latency_ns.attr,
+	&dev_attr_max_latency_ns.attr,
+	NULL,
+};
+
+static const struct attribute_group xiic_stats_group = {
+	.name = "statistics",
+	.attrs = xiic_stats_attrs,
+};
+
+static const struct attribute_group *xiic_groups[] = {
+	&xiic_stats_group,
+	NULL,
+};
+
 static const struct xiic_version_data xiic_2_00 = {
 	.quirks = DYNAMIC_MODE_READ_BROKEN_BIT,
 };
@@ -1398,6 +1568,7 @@ static struct platform_driver xiic_i2c_driver = {
 		.name = DRIVER_NAME,
 		.of_match_table = of_match_ptr(xiic_of_match),
 		.pm = &xiic_dev_pm_ops,
+		.dev_groups = xiic_groups,
 	},
 };
 
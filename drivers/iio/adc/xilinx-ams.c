@@ -24,8 +24,11 @@
 #include <linux/property.h>
 #include <linux/slab.h>
 
+#include <linux/iio/buffer.h>
 #include <linux/iio/events.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 
 /* AMS registers definitions */
 #define AMS_ISR_0			0x010
@@ -222,6 +225,14 @@ enum ams_ps_pl_seq {
 #define PS_SEQ(x)		(x)
 #define PL_SEQ(x)		(AMS_PS_SEQ_MAX + (x))
 #define AMS_CTRL_SEQ_BASE	(AMS_PS_SEQ_MAX * 3)
+#define AMS_TIMESTAMP_SEQ	(AMS_PS_SEQ_MAX * 4)
+
+#define AMS_SCAN_TYPE { \
+	.sign = 'u', \
+	.realbits = 16, \
+	.storagebits = 16, \
+	.endianness = IIO_CPU, \
+}
 
 #define AMS_CHAN_TEMP(_scan_index, _addr) { \
 	.type = IIO_TEMP, \
@@ -233,6 +244,7 @@ enum ams_ps_pl_seq {
 		BIT(IIO_CHAN_INFO_OFFSET), \
 	.event_spec = ams_temp_events, \
 	.scan_index = _scan_index, \
+	.scan_type = AMS_SCAN_TYPE, \
 	.num_event_specs = ARRAY_SIZE(ams_temp_events), \
 }
 
@@ -244,6 +256,7 @@ enum ams_ps_pl_seq {
 		BIT(IIO_CHAN_INFO_SCALE), \
 	.event_spec = (_alarm) ? ams_voltage_events : NULL, \
 	.scan_index = _scan_index, \
+	.scan_type = AMS_SCAN_TYPE, \
 	.num_event_specs = (_alarm) ? ARRAY_SIZE(ams_voltage_events) : 0, \
 }
 
@@ -274,6 +287,8 @@ enum ams_ps_pl_seq {
  * @current_masked_alarm: currently masked due to alarm
  * @intr_mask: interrupt configuration
  * @ams_unmask_work: re-enables event once the event condition disappears
+ * @scan_regs: result registers of the channels of the active scan mask
+ * @data: buffer for the samples of a scan and its timestamp
  *
  */
 struct ams {
@@ -288,6 +303,8 @@ struct ams {
 	unsigned int current_masked_alarm;
 	u64 intr_mask;
 	struct delayed_work ams_unmask_work;
+	void __iomem **scan_regs;
+	void *data;
 };
 
 static inline void ams_ps_update_reg(struct ams *ams, unsigned int offset,
@@ -698,10 +715,16 @@ static int ams_read_raw(struct iio_dev *indio_dev,
 	case IIO_CHAN_INFO_RAW:
 		mutex_lock(&ams->lock);
 		if (chan->scan_index >= AMS_CTRL_SEQ_BASE) {
+			/* The buffer relies on the sequencer this stops */
+			ret = iio_device_claim_direct_mode(indio_dev);
+			if (ret)
+				goto unlock_mutex;
 			ret = ams_read_vcc_reg(ams, chan->address, val);
+			if (!ret)
+				ams_enable_channel_sequence(indio_dev);
+			iio_device_release_direct_mode(indio_dev);
 			if (ret)
 				goto unlock_mutex;
-			ams_enable_channel_sequence(indio_dev);
 		} else if (chan->scan_index >= AMS_PS_SEQ_MAX)
 			*val = readl(ams->pl_base + chan->address);
 		else
@@ -740,6 +763,111 @@ static int ams_read_raw(struct iio_dev *indio_dev,
 	}
 }
 
+static void __iomem *ams_scan_index_to_reg(struct iio_dev *indio_dev,
+					   unsigned int scan_index)
+{
+	struct ams *ams = iio_priv(indio_dev);
+	const struct iio_chan_spec *chan;
+	int i;
+
+	for (i = 0; i < indio_dev->num_channels; i++) {
+		chan = &indio_dev->channels[i];
+		if (chan->scan_index != scan_index)
+			continue;
+
+		if (scan_index >= AMS_PS_SEQ_MAX)
+			return ams->pl_base + chan->address;
+
+		return ams->ps_base + chan->address;
+	}
+
+	return NULL;
+}
+
+static int ams_update_scan_mode(struct iio_dev *indio_dev,
+				const unsigned long *mask)
+{
+	struct ams *ams = iio_priv(indio_dev);
+	struct device *dev = indio_dev->dev.parent;
+	void __iomem **regs;
+	unsigned int i, n = 0;
+	size_t new_size, count;
+	void *data;
+
+	count = bitmap_weight(mask, indio_dev->masklength);
+	if (check_mul_overflow(count, sizeof(*regs), &new_size))
+		return -ENOMEM;
+
+	/* Resolve the result registers once rather than on every scan */
+	regs = devm_krealloc(dev, ams->scan_regs, new_size, GFP_KERNEL);
+	if (!regs)
+		return -ENOMEM;
+	ams->scan_regs = regs;
+
+	data = devm_krealloc(dev, ams->data, indio_dev->scan_bytes, GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+	memset(data, 0, indio_dev->scan_bytes);
+	ams->data = data;
+
+	for_each_set_bit(i, mask, indio_dev->masklength) {
+		if (i == AMS_TIMESTAMP_SEQ)
+			continue;
+
+		regs[n] = ams_scan_index_to_reg(indio_dev, i);
+		if (!regs[n])
+			return -EINVAL;
+		n++;
+	}
+
+	return 0;
+}
+
+static bool ams_validate_scan_mask(struct iio_dev *indio_dev,
+				   const unsigned long *mask)
+{
+	unsigned int bit;
+
+	/*
+	 * The PS control channels are converted in single channel mode, which
+	 * stops the sequencer, so they cannot be captured in a buffer.
+	 */
+	bit = find_next_bit(mask, indio_dev->masklength, AMS_CTRL_SEQ_BASE);
+
+	return bit >= AMS_TIMESTAMP_SEQ;
+}
+
+static const struct iio_buffer_setup_ops ams_buffer_ops = {
+	.validate_scan_mask = &ams_validate_scan_mask,
+};
+
+static irqreturn_t ams_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct ams *ams = iio_priv(indio_dev);
+	unsigned int i, n;
+	u16 *data = ams->data;
+
+	if (!data)
+		goto out;
+
+	/* The sequencer keeps all the result registers up to date */
+	n = bitmap_weight(indio_dev->active_scan_mask, indio_dev->masklength);
+	if (indio_dev->scan_timestamp)
+		n--;
+
+	for (i = 0; i < n; i++)
+		data[i] = readl(ams->scan_regs[i]);
+
+	iio_push_to_buffers_with_timestamp(indio_dev, data, pf->timestamp);
+
+out:
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static int ams_get_alarm_offset(int scan_index, enum iio_event_direction dir)
 {
 	int offset;
@@ -1283,8 +1411,9 @@ static int ams_parse_firmware(struct iio_dev *indio_dev)
 	int ret, ch_cnt = 0, i, rising_off, falling_off;
 	unsigned int num_channels = 0;
 
+	/* Last channel is the timestamp */
 	ams_size = ARRAY_SIZE(ams_ps_channels) + ARRAY_SIZE(ams_pl_channels) +
-		ARRAY_SIZE(ams_ctrl_channels);
+		ARRAY_SIZE(ams_ctrl_channels) + 1;
 
 	/* Initialize buffer for channel specification */
 	ams_channels = devm_kcalloc(dev, ams_size, sizeof(*ams_channels), GFP_KERNEL);
@@ -1336,6 +1465,9 @@ static int ams_parse_firmware(struct iio_dev *indio_dev)
 		}
 	}
 
+	ams_channels[num_channels++] = (struct iio_chan_spec)
+		IIO_CHAN_SOFT_TIMESTAMP(AMS_TIMESTAMP_SEQ);
+
 	dev_size = array_size(sizeof(*dev_channels), num_channels);
 	if (dev_size == SIZE_MAX)
 		return -ENOMEM;
@@ -1352,6 +1484,7 @@ static int ams_parse_firmware(struct iio_dev *indio_dev)
 
 static const struct iio_info iio_ams_info = {
 	.read_raw = &ams_read_raw,
+	.update_scan_mode = &ams_update_scan_mode,
 	.read_event_config = &ams_read_event_config,
 	.write_event_config = &ams_write_event_config,
 	.read_event_value = &ams_read_event_value,
@@ -1407,6 +1540,17 @@ static int ams_probe(struct platform_device *pdev)
 
 	ams_enable_channel_sequence(indio_dev);
 
+	/*
+	 * Scans are meant to be triggered by an hrtimer trigger, the
+	 * sequencer converts all the channels continuously anyway.
+	 */
+	ret = devm_iio_triggered_buffer_setup(&pdev->dev, indio_dev,
+					      &iio_pollfunc_store_time,
+					      &ams_trigger_handler,
+					      &ams_buffer_ops);
+	if (ret)
+		return ret;
+
 	irq = platform_get_irq(pdev, 0);
 	if (irq < 0)
 		return irq;
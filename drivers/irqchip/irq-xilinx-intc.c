@@ -9,6 +9,7 @@
  * for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/irqdomain.h>
 #include <linux/irq.h>
 #include <linux/irqchip.h>
@@ -17,8 +18,11 @@
 #include <linux/io.h>
 #include <linux/jump_label.h>
 #include <linux/bug.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
 #include <linux/of_irq.h>
 #include <linux/cpuhotplug.h>
+#include <linux/seq_file.h>
 #include <linux/smp.h>
 
 /* No one else should require these constants, so define them locally here. */
@@ -34,6 +38,26 @@
 #define MER_ME (1<<0)
 #define MER_HIE (1<<1)
 
+/* The registers have one bit per interrupt line */
+#define XINTC_MAX_LINES 32
+
+/**
+ * struct xintc_irq_chip - Xilinx interrupt controller
+ * @base: registers
+ * @domain: irq domain of the hardware interrupt lines
+ * @intr_mask: edge triggered lines
+ * @intc_dev: irq chip of the lines
+ * @nr_irq: number of hardware interrupt lines
+ * @sw_irq: number of software interrupt lines, after the hardware ones
+ * @irq: parent interrupt of a cascaded controller
+ * @enabled: copy of IER, so that a single read of ISR gives the pending
+ *	     lines, IPR being optional in the IP
+ * @passes: number of reads of the pending lines
+ * @counts: number of dispatches of each line
+ * @name: name of the debugfs file of the counts
+ * @debugfs: debugfs file of the counts
+ * @list: entry in the list of controllers
+ */
 struct xintc_irq_chip {
 	void		__iomem *base;
 	struct		irq_domain *domain;
@@ -44,12 +68,27 @@ struct xintc_irq_chip {
 #ifdef CONFIG_IRQCHIP_XILINX_INTC_MODULE_SUPPORT_EXPERIMENTAL
 	int				irq;
 #endif
+	unsigned long			enabled;
+	unsigned long			passes;
+	unsigned long			counts[XINTC_MAX_LINES];
+	const char			*name;
+	struct dentry			*debugfs;
+	struct list_head		list;
 };
 
 static DEFINE_STATIC_KEY_FALSE(xintc_is_be);
 
 static DEFINE_PER_CPU(struct xintc_irq_chip, primary_intc);
 
+static LIST_HEAD(xintc_list);
+static DEFINE_MUTEX(xintc_list_lock);
+static struct dentry *xintc_debugfs_root;
+
+static struct xintc_irq_chip *xintc_get(struct xintc_irq_chip *irqc)
+{
+	return irqc ?: per_cpu_ptr(&primary_intc, smp_processor_id());
+}
+
 static void xintc_write(struct xintc_irq_chip *irqc, int reg, u32 data)
 {
 	if (!irqc)
@@ -103,6 +142,7 @@ static void intc_enable_or_unmask(struct irq_data *d)
 	if (irqd_is_level_type(d))
 		xintc_write(local_intc, IAR, mask);
 
+	set_bit(d->hwirq, &xintc_get(local_intc)->enabled);
 	xintc_write(local_intc, SIE, mask);
 }
 
@@ -112,6 +152,7 @@ static void intc_disable_or_mask(struct irq_data *d)
 
 	pr_debug("irq-xilinx: disable: %ld\n", d->hwirq);
 	xintc_write(local_intc, CIE, 1 << d->hwirq);
+	clear_bit(d->hwirq, &xintc_get(local_intc)->enabled);
 }
 
 static void intc_ack(struct irq_data *d)
@@ -129,9 +170,25 @@ static void intc_mask_ack(struct irq_data *d)
 
 	pr_debug("irq-xilinx: disable_and_ack: %ld\n", d->hwirq);
 	xintc_write(local_intc, CIE, mask);
+	clear_bit(d->hwirq, &xintc_get(local_intc)->enabled);
 	xintc_write(local_intc, IAR, mask);
 }
 
+/*
+ * Level lines can only be acknowledged once the handler has cleared the
+ * source. Handling them with handle_fasteoi_irq acknowledges them from here
+ * instead of masking them before the handler and unmasking and acknowledging
+ * them after it, saving two register writes per interrupt.
+ */
+static void intc_eoi(struct irq_data *d)
+{
+	struct xintc_irq_chip *local_intc = irq_data_get_irq_chip_data(d);
+
+	pr_debug("irq-xilinx: eoi: %ld\n", d->hwirq);
+	if (irqd_is_level_type(d))
+		xintc_write(local_intc, IAR, 1 << d->hwirq);
+}
+
 static int xintc_map(struct irq_domain *d, unsigned int irq, irq_hw_number_t hw)
 {
 	struct xintc_irq_chip *local_intc = d->host_data;
@@ -163,7 +220,7 @@ static int xintc_map(struct irq_domain *d, unsigned int irq, irq_hw_number_t hw)
 			handle_percpu_irq, "percpu");
 #else
 		irq_set_chip_and_handler_name(irq, local_intc->intc_dev,
-						handle_level_irq, "level");
+						handle_fasteoi_irq, "level");
 #endif
 		irq_set_status_flags(irq, IRQ_LEVEL);
 	}
@@ -196,6 +253,7 @@ static void xil_intc_initial_setup(struct xintc_irq_chip *irqc)
 	 * explicity requested.
 	 */
 	xintc_write(irqc, IER, 0);
+	irqc->enabled = 0;
 
 	/* Acknowledge any pending interrupts just in case. */
 	xintc_write(irqc, IAR, 0xffffffff);
@@ -211,26 +269,48 @@ static void xil_intc_initial_setup(struct xintc_irq_chip *irqc)
 	for (i = 0; i < irqc->sw_irq; i++) {
 		mask = 1 << (i + irqc->nr_irq);
 		xintc_write(irqc, IAR, mask);
+		irqc->enabled |= mask;
 		xintc_write(irqc, SIE, mask);
 	}
 }
 
+/*
+ * Read all the pending lines at once, instead of reading IVR for each of
+ * them. The lines are then dispatched lowest first, as the IVR would.
+ */
+static unsigned long xintc_pending(struct xintc_irq_chip *irqc)
+{
+	unsigned long pending;
+
+	pending = xintc_read(irqc, ISR) & READ_ONCE(irqc->enabled);
+	if (pending)
+		irqc->passes++;
+
+	return pending;
+}
+
 static void xil_intc_irq_handler(struct irq_desc *desc)
 {
 	struct irq_chip *chip = irq_desc_get_chip(desc);
 	struct xintc_irq_chip *irqc =
 		irq_data_get_irq_handler_data(&desc->irq_data);
+	unsigned long pending;
+	unsigned int hwirq;
 
 	chained_irq_enter(chip, desc);
 
-	do {
-		u32 hwirq = xintc_read(irqc, IVR);
-
-		if (hwirq == -1U)
-			break;
+	while ((pending = xintc_pending(irqc))) {
+		for_each_set_bit(hwirq, &pending, XINTC_MAX_LINES) {
+			if (hwirq >= irqc->nr_irq) {
+				WARN_ONCE(1, "SW interrupt not handled\n");
+				xintc_write(irqc, IAR, 1 << hwirq);
+				continue;
+			}
 
-		generic_handle_domain_irq(irqc->domain, hwirq);
-	} while (true);
+			irqc->counts[hwirq]++;
+			generic_handle_domain_irq(irqc->domain, hwirq);
+		}
+	}
 	chained_irq_exit(chip, desc);
 }
 
@@ -257,10 +337,10 @@ static void xil_intc_handle_irq(struct pt_regs *regs)
 	int ret;
 	unsigned int hwirq, cpu_id = smp_processor_id();
 	struct xintc_irq_chip *irqc = per_cpu_ptr(&primary_intc, cpu_id);
+	unsigned long pending;
 
-	do {
-		hwirq = xintc_read(irqc, IVR);
-		if (hwirq != -1U) {
+	while ((pending = xintc_pending(irqc))) {
+		for_each_set_bit(hwirq, &pending, XINTC_MAX_LINES) {
 			if (hwirq >= irqc->nr_irq) {
 #if defined(CONFIG_SMP) && defined(CONFIG_MICROBLAZE)
 				handle_IPI(hwirq - irqc->nr_irq, regs);
@@ -270,18 +350,63 @@ static void xil_intc_handle_irq(struct pt_regs *regs)
 				/* ACK is necessary */
 				xintc_write(irqc, IAR, 1 << hwirq);
 				continue;
-			} else {
-				ret = generic_handle_domain_irq(irqc->domain,
-								hwirq);
-				WARN_ONCE(ret, "cpu %d: Unhandled HWIRQ %d\n",
-					  cpu_id, hwirq);
-				continue;
 			}
+
+			irqc->counts[hwirq]++;
+			ret = generic_handle_domain_irq(irqc->domain, hwirq);
+			WARN_ONCE(ret, "cpu %d: Unhandled HWIRQ %d\n",
+				  cpu_id, hwirq);
 		}
+	}
+}
+
+static int xintc_counts_show(struct seq_file *m, void *unused)
+{
+	struct xintc_irq_chip *irqc = m->private;
+	unsigned int hwirq;
+
+	seq_printf(m, "passes: %lu\n", READ_ONCE(irqc->passes));
+	for (hwirq = 0; hwirq < irqc->nr_irq; hwirq++)
+		seq_printf(m, "%u: %lu\n", hwirq,
+			   READ_ONCE(irqc->counts[hwirq]));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xintc_counts);
+
+static void xintc_debugfs_add(struct xintc_irq_chip *irqc)
+{
+	irqc->debugfs = debugfs_create_file(irqc->name, 0444,
+					    xintc_debugfs_root, irqc,
+					    &xintc_counts_fops);
+}
+
+/*
+ * The primary controller is set up before debugfs, its file and the ones of
+ * the controllers cascaded until then are created once debugfs is up.
+ */
+static void xintc_register(struct xintc_irq_chip *irqc)
+{
+	mutex_lock(&xintc_list_lock);
+	list_add_tail(&irqc->list, &xintc_list);
+	if (xintc_debugfs_root)
+		xintc_debugfs_add(irqc);
+	mutex_unlock(&xintc_list_lock);
+}
+
+static int __init xintc_debugfs_init(void)
+{
+	struct xintc_irq_chip *irqc;
 
-		break;
-	} while (1);
+	mutex_lock(&xintc_list_lock);
+	xintc_debugfs_root = debugfs_create_dir("xilinx-intc", NULL);
+	list_for_each_entry(irqc, &xintc_list, list)
+		xintc_debugfs_add(irqc);
+	mutex_unlock(&xintc_list_lock);
+
+	return 0;
 }
+late_initcall(xintc_debugfs_init);
 
 #ifndef CONFIG_IRQCHIP_XILINX_INTC_MODULE_SUPPORT_EXPERIMENTAL
 static int __init xilinx_intc_of_init(struct device_node *intc,
@@ -335,12 +460,20 @@ static int xilinx_intc_of_init(struct device_node *intc,
 	/* sw irqs are optinal */
 	of_property_read_u32(intc, "xlnx,num-sw-intr", &irqc->sw_irq);
 
+	if (irqc->nr_irq + irqc->sw_irq > XINTC_MAX_LINES) {
+		pr_err("irq-xilinx: %pOF: too many interrupt inputs\n", intc);
+		ret = -EINVAL;
+		goto error;
+	}
+	irqc->name = intc->full_name;
+
 	pr_info("irq-xilinx: %pOF: num_irq=%d, sw_irq=%d, edge=0x%x\n",
 		intc, irqc->nr_irq, irqc->sw_irq, irqc->intr_mask);
 
 	/* Right now enable only SW IRQs on that IP and wait */
 	if (cpu_id) {
 		xil_intc_initial_setup(irqc);
+		xintc_register(irqc);
 		return 0;
 	}
 
@@ -355,6 +488,7 @@ static int xilinx_intc_of_init(struct device_node *intc,
 	intc_dev->irq_mask = intc_disable_or_mask,
 	intc_dev->irq_ack = intc_ack,
 	intc_dev->irq_mask_ack = intc_mask_ack,
+	intc_dev->irq_eoi = intc_eoi,
 	irqc->intc_dev = intc_dev;
 
 	irqc->domain = irq_domain_add_linear(intc, irqc->nr_irq,
@@ -381,6 +515,7 @@ static int xilinx_intc_of_init(struct device_node *intc,
 			goto err_alloc;
 		}
 		xil_intc_initial_setup(irqc);
+		xintc_register(irqc);
 		return 0;
 	}
 
@@ -390,6 +525,7 @@ static int xilinx_intc_of_init(struct device_node *intc,
 	 */
 	irq_set_default_host(irqc->domain);
 	set_handle_irq(xil_intc_handle_irq);
+	xintc_register(irqc);
 
 	ret = cpuhp_setup_state(CPUHP_AP_IRQ_XILINX_STARTING,
 				"microblaze/arch_intc:starting",
@@ -423,6 +559,11 @@ static int xilinx_intc_of_remove(struct device_node *intc,
 	irqc = intc->data;
 	irq = irqc->irq;
 
+	mutex_lock(&xintc_list_lock);
+	list_del(&irqc->list);
+	debugfs_remove(irqc->debugfs);
+	mutex_unlock(&xintc_list_lock);
+
 	irq_set_chained_handler_and_data(irq, NULL, NULL);
 
 	if (irqc->domain) {
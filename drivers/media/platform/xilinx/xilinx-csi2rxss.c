@@ -112,6 +112,11 @@
 /*
  * Sink pad connected to sensor source pad.
  * Source pad connected to next module like demosaic.
+ *
+ * The virtual channel of the video output is carried by TDEST, a design
+ * demultiplexing the output to one frame buffer per virtual channel has one
+ * source pad per virtual channel, the virtual channel of a source pad being
+ * its index minus one.
  */
 #define XCSI_MEDIA_PADS		2
 #define XCSI_DEFAULT_WIDTH	1920
@@ -120,6 +125,7 @@
 #define XCSI_VCX_START		4
 #define XCSI_MAX_VC		4
 #define XCSI_MAX_VCX		16
+#define XCSI_MAX_PADS		(XCSI_MAX_VCX + 1)
 
 #define XCSI_NEXTREG_OFFSET	4
 
@@ -202,6 +208,8 @@ static const u32 xcsi2dt_mbus_lut[][2] = {
  * struct xcsi2rxss_state - CSI-2 Rx Subsystem device structure
  * @subdev: The v4l2 subdev structure
  * @format: Active V4L2 formats on each pad
+ * @num_pads: Number of media pads, one sink and one source per virtual channel
+ * @routes: Bitmask of the source pads routed from the sink pad
  * @default_format: Default V4L2 format
  * @events: counter for events
  * @vcx_events: counter for vcx_events
@@ -222,7 +230,9 @@ static const u32 xcsi2dt_mbus_lut[][2] = {
  */
 struct xcsi2rxss_state {
 	struct v4l2_subdev subdev;
-	struct v4l2_mbus_framefmt format;
+	struct v4l2_mbus_framefmt format[XCSI_MAX_PADS];
+	unsigned int num_pads;
+	u32 routes;
 	struct v4l2_mbus_framefmt default_format;
 	u32 events[XCSI_NUM_EVENTS];
 	u32 vcx_events[XCSI_VCX_NUM_EVENTS];
@@ -235,7 +245,7 @@ struct xcsi2rxss_state {
 	u32 datatype;
 	/* used to protect access to this struct */
 	struct mutex lock;
-	struct media_pad pads[XCSI_MEDIA_PADS];
+	struct media_pad pads[XCSI_MAX_PADS];
 	bool streaming;
 	bool enable_active_lanes;
 	bool en_vcx;
@@ -407,6 +417,11 @@ static int xcsi2rxss_log_status(struct v4l2_subdev *sd)
 
 	xcsi2rxss_log_counters(xcsi2rxss);
 
+	for (i = XVIP_PAD_SOURCE; i < xcsi2rxss->num_pads; i++)
+		dev_info(dev, "VC %u to source pad %u: %s\n",
+			 i - XVIP_PAD_SOURCE, i,
+			 xcsi2rxss->routes & BIT(i) ? "routed" : "not routed");
+
 	dev_info(dev, "***** Core Status *****\n");
 	data = xcsi2rxss_read(xcsi2rxss, XCSI_CSR_OFFSET);
 	dev_info(dev, "Short Packet FIFO Full = %s\n",
@@ -692,7 +707,7 @@ __xcsi2rxss_get_pad_format(struct xcsi2rxss_state *xcsi2rxss,
 						     sd_state, pad);
 		break;
 	case V4L2_SUBDEV_FORMAT_ACTIVE:
-		get_fmt = &xcsi2rxss->format;
+		get_fmt = &xcsi2rxss->format[pad];
 		break;
 	default:
 		get_fmt = NULL;
@@ -720,7 +735,7 @@ static int xcsi2rxss_init_cfg(struct v4l2_subdev *sd,
 	unsigned int i;
 
 	mutex_lock(&xcsi2rxss->lock);
-	for (i = 0; i < XCSI_MEDIA_PADS; i++) {
+	for (i = 0; i < xcsi2rxss->num_pads; i++) {
 		format = v4l2_subdev_get_try_format(sd, sd_state, i);
 		*format = xcsi2rxss->default_format;
 	}
@@ -775,6 +790,10 @@ static int xcsi2rxss_get_format(struct v4l2_subdev *sd,
  * requested by application, all parameters except the format type is saved
  * for the pad and the original pad format is sent back to the application.
  *
+ * The sink pad format is propagated to the source pads. With one source pad
+ * per virtual channel, the format of each virtual channel can then be set
+ * on its source pad.
+ *
  * Return: 0 on success
  */
 static int xcsi2rxss_set_format(struct v4l2_subdev *sd,
@@ -782,7 +801,8 @@ static int xcsi2rxss_set_format(struct v4l2_subdev *sd,
 				struct v4l2_subdev_format *fmt)
 {
 	struct xcsi2rxss_state *xcsi2rxss = to_xcsi2rxssstate(sd);
-	struct v4l2_mbus_framefmt *__format;
+	struct v4l2_mbus_framefmt *__format, *source_fmt;
+	unsigned int i;
 	u32 dt;
 	int ret = 0;
 
@@ -800,8 +820,9 @@ static int xcsi2rxss_set_format(struct v4l2_subdev *sd,
 		goto unlock_set_format;
 	}
 
-	/* only sink pad format can be updated */
-	if (fmt->pad == XVIP_PAD_SOURCE) {
+	/* only sink pad format can be updated with a single source pad */
+	if (fmt->pad != XVIP_PAD_SINK &&
+	    xcsi2rxss->num_pads == XCSI_MEDIA_PADS) {
 		fmt->format = *__format;
 		goto unlock_set_format;
 	}
@@ -821,6 +842,15 @@ static int xcsi2rxss_set_format(struct v4l2_subdev *sd,
 
 	*__format = fmt->format;
 
+	if (fmt->pad != XVIP_PAD_SINK)
+		goto unlock_set_format;
+
+	for (i = XVIP_PAD_SOURCE; i < xcsi2rxss->num_pads; i++) {
+		source_fmt = __xcsi2rxss_get_pad_format(xcsi2rxss, sd_state, i,
+							fmt->which);
+		*source_fmt = fmt->format;
+	}
+
 unlock_set_format:
 	mutex_unlock(&xcsi2rxss->lock);
 
@@ -861,12 +891,105 @@ static int xcsi2rxss_enum_mbus_code(struct v4l2_subdev *sd,
 	return ret;
 }
 
+/**
+ * xcsi2rxss_get_frame_desc - Get the virtual channel and data type of a pad
+ * @sd: Pointer to V4L2 Sub device structure
+ * @pad: Source pad
+ * @fd: Frame descriptor filled with the stream of the source pad
+ *
+ * Return: 0 on success, -EINVAL for the sink pad
+ */
+static int xcsi2rxss_get_frame_desc(struct v4l2_subdev *sd, unsigned int pad,
+				    struct v4l2_mbus_frame_desc *fd)
+{
+	struct xcsi2rxss_state *xcsi2rxss = to_xcsi2rxssstate(sd);
+	struct v4l2_mbus_frame_desc_entry *entry = &fd->entry[0];
+
+	if (pad == XVIP_PAD_SINK || pad >= xcsi2rxss->num_pads)
+		return -EINVAL;
+
+	memset(fd, 0, sizeof(*fd));
+	fd->type = V4L2_MBUS_FRAME_DESC_TYPE_CSI2;
+	fd->num_entries = 1;
+
+	mutex_lock(&xcsi2rxss->lock);
+	entry->pixelcode = xcsi2rxss->format[pad].code;
+	entry->bus.csi2.vc = pad - XVIP_PAD_SOURCE;
+	entry->bus.csi2.dt = xcsi2rxss_get_dt(entry->pixelcode);
+	mutex_unlock(&xcsi2rxss->lock);
+
+	return 0;
+}
+
+static int xcsi2rxss_get_routing(struct v4l2_subdev *sd,
+				 struct v4l2_subdev_routing *route)
+{
+	struct xcsi2rxss_state *xcsi2rxss = to_xcsi2rxssstate(sd);
+	unsigned int i, n = 0;
+
+	mutex_lock(&sd->entity.graph_obj.mdev->graph_mutex);
+
+	for (i = XVIP_PAD_SOURCE; i < xcsi2rxss->num_pads; i++) {
+		if (!(xcsi2rxss->routes & BIT(i)))
+			continue;
+
+		if (n < route->num_routes) {
+			route->routes[n].sink = XVIP_PAD_SINK;
+			route->routes[n].source = i;
+		}
+		n++;
+	}
+
+	route->num_routes = n;
+
+	mutex_unlock(&sd->entity.graph_obj.mdev->graph_mutex);
+
+	return 0;
+}
+
+static int xcsi2rxss_set_routing(struct v4l2_subdev *sd,
+				 struct v4l2_subdev_routing *route)
+{
+	struct xcsi2rxss_state *xcsi2rxss = to_xcsi2rxssstate(sd);
+	unsigned int i;
+	int ret = 0;
+
+	mutex_lock(&sd->entity.graph_obj.mdev->graph_mutex);
+
+	if (media_entity_pipeline(&sd->entity)) {
+		ret = -EBUSY;
+		goto done;
+	}
+
+	/* The pads are checked by the core, there is a single sink pad */
+	xcsi2rxss->routes = 0;
+	for (i = 0; i < route->num_routes; ++i)
+		xcsi2rxss->routes |= BIT(route->routes[i].source);
+
+done:
+	mutex_unlock(&sd->entity.graph_obj.mdev->graph_mutex);
+	return ret;
+}
+
 /* -----------------------------------------------------------------------------
  * Media Operations
  */
 
+static bool xcsi2rxss_has_route(struct media_entity *entity, unsigned int pad0,
+				unsigned int pad1)
+{
+	struct xcsi2rxss_state *xcsi2rxss =
+		container_of(entity, struct xcsi2rxss_state, subdev.entity);
+	u32 routes = xcsi2rxss->routes | BIT(XVIP_PAD_SINK);
+
+	/* The routed source pads are connected through the sink pad */
+	return (routes & BIT(pad0)) && (routes & BIT(pad1));
+}
+
 static const struct media_entity_operations xcsi2rxss_media_ops = {
-	.link_validate = v4l2_subdev_link_validate
+	.link_validate = v4l2_subdev_link_validate,
+	.has_pad_interdep = xcsi2rxss_has_route,
+	.has_route = xcsi2rxss_has_route,
 };
 
 static const struct v4l2_subdev_core_ops xcsi2rxss_core_ops = {
@@ -883,6 +1006,9 @@ static const struct v4l2_subdev_pad_ops xcsi2rxss_pad_ops = {
 	.set_fmt = xcsi2rxss_set_format,
 	.enum_mbus_code = xcsi2rxss_enum_mbus_code,
 	.link_validate = v4l2_subdev_link_validate_default,
+	.get_frame_desc = xcsi2rxss_get_frame_desc,
+	.get_routing = xcsi2rxss_get_routing,
+	.set_routing = xcsi2rxss_set_routing,
 };
 
 static const struct v4l2_subdev_ops xcsi2rxss_ops = {
@@ -900,6 +1026,7 @@ static int xcsi2rxss_parse_of(struct xcsi2rxss_state *xcsi2rxss)
 	struct v4l2_fwnode_endpoint vep = {
 		.bus_type = V4L2_MBUS_CSI2_DPHY
 	};
+	unsigned int max_vc;
 	bool en_csi_v20, vfb;
 	int ret;
 
@@ -973,21 +1100,30 @@ static int xcsi2rxss_parse_of(struct xcsi2rxss_state *xcsi2rxss)
 
 	xcsi2rxss->max_num_lanes = vep.bus.mipi_csi2.num_data_lanes;
 
-	ep = fwnode_graph_get_endpoint_by_id(dev_fwnode(dev),
-					     XVIP_PAD_SOURCE, 0,
-					     FWNODE_GRAPH_ENDPOINT_NEXT);
-	if (!ep) {
+	/* One source port per virtual channel, from port 1 */
+	max_vc = xcsi2rxss->en_vcx ? XCSI_MAX_VCX : XCSI_MAX_VC;
+	xcsi2rxss->num_pads = XVIP_PAD_SOURCE;
+	while (xcsi2rxss->num_pads <= max_vc) {
+		ep = fwnode_graph_get_endpoint_by_id(dev_fwnode(dev),
+						     xcsi2rxss->num_pads, 0,
+						     FWNODE_GRAPH_ENDPOINT_NEXT);
+		if (!ep)
+			break;
+
+		fwnode_handle_put(ep);
+		xcsi2rxss->num_pads++;
+	}
+
+	if (xcsi2rxss->num_pads == XVIP_PAD_SOURCE) {
 		dev_err(dev, "no source port found");
 		return -EINVAL;
 	}
 
-	fwnode_handle_put(ep);
-
-	dev_dbg(dev, "vcx %s, %u data lanes (%s), data type 0x%02x\n",
+	dev_dbg(dev, "vcx %s, %u data lanes (%s), data type 0x%02x, %u VCs\n",
 		xcsi2rxss->en_vcx ? "enabled" : "disabled",
 		xcsi2rxss->max_num_lanes,
 		xcsi2rxss->enable_active_lanes ? "dynamic" : "static",
-		xcsi2rxss->datatype);
+		xcsi2rxss->datatype, xcsi2rxss->num_pads - XVIP_PAD_SOURCE);
 
 	return 0;
 }
@@ -998,6 +1134,7 @@ static int xcsi2rxss_probe(struct platform_device *pdev)
 	struct xcsi2rxss_state *xcsi2rxss;
 	int num_clks = ARRAY_SIZE(xcsi2rxss_clks);
 	struct device *dev = &pdev->dev;
+	unsigned int i;
 	int irq, ret;
 
 	xcsi2rxss = devm_kzalloc(dev, sizeof(*xcsi2rxss), GFP_KERNEL);
@@ -1056,7 +1193,10 @@ static int xcsi2rxss_probe(struct platform_device *pdev)
 
 	/* Initialize V4L2 subdevice and media entity */
 	xcsi2rxss->pads[XVIP_PAD_SINK].flags = MEDIA_PAD_FL_SINK;
-	xcsi2rxss->pads[XVIP_PAD_SOURCE].flags = MEDIA_PAD_FL_SOURCE;
+	for (i = XVIP_PAD_SOURCE; i < xcsi2rxss->num_pads; i++) {
+		xcsi2rxss->pads[i].flags = MEDIA_PAD_FL_SOURCE;
+		xcsi2rxss->routes |= BIT(i);
+	}
 
 	/* Initialize the default format */
 	xcsi2rxss->default_format.code =
@@ -1065,7 +1205,8 @@ static int xcsi2rxss_probe(struct platform_device *pdev)
 	xcsi2rxss->default_format.colorspace = V4L2_COLORSPACE_SRGB;
 	xcsi2rxss->default_format.width = XCSI_DEFAULT_WIDTH;
 	xcsi2rxss->default_format.height = XCSI_DEFAULT_HEIGHT;
-	xcsi2rxss->format = xcsi2rxss->default_format;
+	for (i = 0; i < xcsi2rxss->num_pads; i++)
+		xcsi2rxss->format[i] = xcsi2rxss->default_format;
 
 	/* Initialize V4L2 subdevice and media entity */
 	subdev = &xcsi2rxss->subdev;
@@ -1076,7 +1217,7 @@ static int xcsi2rxss_probe(struct platform_device *pdev)
 	subdev->entity.ops = &xcsi2rxss_media_ops;
 	v4l2_set_subdevdata(subdev, xcsi2rxss);
 
-	ret = media_entity_pads_init(&subdev->entity, XCSI_MEDIA_PADS,
+	ret = media_entity_pads_init(&subdev->entity, xcsi2rxss->num_pads,
 				     xcsi2rxss->pads);
 	if (ret < 0)
 		goto error;
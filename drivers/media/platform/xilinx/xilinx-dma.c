@@ -9,16 +9,21 @@
  *           Laurent Pinchart <laurent.pinchart@ideasonboard.com>
  */
 
+#include <linux/dma-buf.h>
 #include <linux/dma/xilinx_dma.h>
 #include <linux/dma/xilinx_frmbuf.h>
 #include <linux/lcm.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/slab.h>
 #include <linux/xilinx-v4l2-controls.h>
 
+#include <media/media-request.h>
+#include <media/v4l2-ctrls.h>
 #include <media/v4l2-dev.h>
+#include <media/v4l2-device.h>
 #include <media/v4l2-fh.h>
 #include <media/v4l2-ioctl.h>
 #include <media/videobuf2-v4l2.h>
@@ -246,6 +251,195 @@ static int xvip_pipeline_prepare(struct xvip_pipeline *pipe,
 	return ret;
 }
 
+/* -----------------------------------------------------------------------------
+ * DMABUF attachment cache
+ *
+ * videobuf2 keeps an imported dmabuf attached and mapped only as long as it
+ * is queued again at the same buffer index. Producers that hand out their
+ * buffers in a different order, or through a different number of vb2
+ * buffers, make it attach and map a dmabuf on nearly every QBUF, which
+ * costs an IOMMU mapping or a cache walk per plane and frame. The memory
+ * operations below keep the vb2-dma-contig attachment of a dmabuf mapped
+ * after vb2 lets it go, up to dmabuf_cache idle dmabufs per video node, and
+ * give it back when the dmabuf is queued again.
+ *
+ * The attachments refer to the vb2 buffer that first imported them, so they
+ * are dropped whenever the queue frees its buffers.
+ */
+
+static unsigned int dmabuf_cache = 16;
+module_param(dmabuf_cache, uint, 0644);
+MODULE_PARM_DESC(dmabuf_cache,
+		 "Number of idle dmabufs kept mapped per video node (default: 16)");
+
+/**
+ * struct xvip_dma_dbuf - Cached dmabuf attachment
+ * @list: entry in the cache list, most recently used first
+ * @dma: DMA channel whose queue imported the dmabuf
+ * @dbuf: imported dmabuf, the cache holds a reference to it
+ * @dev: device the dmabuf is attached to
+ * @size: plane size the dmabuf is attached with
+ * @mem_priv: vb2-dma-contig attachment
+ * @users: number of vb2 planes using the attachment
+ * @mapped: whether the attachment is mapped
+ */
+struct xvip_dma_dbuf {
+	struct list_head list;
+	struct xvip_dma *dma;
+	struct dma_buf *dbuf;
+	struct device *dev;
+	unsigned long size;
+	void *mem_priv;
+	unsigned int users;
+	bool mapped;
+};
+
+static LIST_HEAD(xvip_dma_dbufs);
+static DEFINE_MUTEX(xvip_dma_dbuf_lock);
+static struct vb2_mem_ops xvip_dma_memops;
+
+static struct xvip_dma_dbuf *xvip_dma_dbuf_find(void *mem_priv)
+{
+	struct xvip_dma_dbuf *entry;
+
+	lockdep_assert_held(&xvip_dma_dbuf_lock);
+
+	list_for_each_entry(entry, &xvip_dma_dbufs, list) {
+		if (entry->mem_priv == mem_priv)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void xvip_dma_dbuf_release(struct xvip_dma_dbuf *entry)
+{
+	list_del(&entry->list);
+
+	if (entry->mapped)
+		vb2_dma_contig_memops.unmap_dmabuf(entry->mem_priv);
+	vb2_dma_contig_memops.detach_dmabuf(entry->mem_priv);
+	dma_buf_put(entry->dbuf);
+	kfree(entry);
+}
+
+/* Release the least recently used idle attachments beyond @max */
+static void xvip_dma_dbuf_trim(struct xvip_dma *dma, unsigned int max)
+{
+	struct xvip_dma_dbuf *entry, *next;
+	unsigned int idle = 0;
+
+	mutex_lock(&xvip_dma_dbuf_lock);
+	list_for_each_entry_safe(entry, next, &xvip_dma_dbufs, list) {
+		if (entry->dma != dma || entry->users)
+			continue;
+
+		if (++idle > max)
+			xvip_dma_dbuf_release(entry);
+	}
+	mutex_unlock(&xvip_dma_dbuf_lock);
+}
+
+static void *xvip_dma_attach_dmabuf(struct vb2_buffer *vb, struct device *dev,
+				    struct dma_buf *dbuf, unsigned long size)
+{
+	struct xvip_dma *dma = vb2_get_drv_priv(vb->vb2_queue);
+	struct xvip_dma_dbuf *entry;
+	void *mem_priv;
+
+	mutex_lock(&xvip_dma_dbuf_lock);
+
+	list_for_each_entry(entry, &xvip_dma_dbufs, list) {
+		if (entry->dma == dma && entry->dbuf == dbuf &&
+		    entry->dev == dev && entry->size == size) {
+			entry->users++;
+			list_move(&entry->list, &xvip_dma_dbufs);
+			mem_priv = entry->mem_priv;
+			goto done;
+		}
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		mem_priv = ERR_PTR(-ENOMEM);
+		goto done;
+	}
+
+	mem_priv = vb2_dma_contig_memops.attach_dmabuf(vb, dev, dbuf, size);
+	if (IS_ERR(mem_priv)) {
+		kfree(entry);
+		goto done;
+	}
+
+	get_dma_buf(dbuf);
+	entry->dma = dma;
+	entry->dbuf = dbuf;
+	entry->dev = dev;
+	entry->size = size;
+	entry->mem_priv = mem_priv;
+	entry->users = 1;
+	list_add(&entry->list, &xvip_dma_dbufs);
+
+done:
+	mutex_unlock(&xvip_dma_dbuf_lock);
+	return mem_priv;
+}
+
+static void xvip_dma_detach_dmabuf(void *mem_priv)
+{
+	struct xvip_dma_dbuf *entry;
+	struct xvip_dma *dma;
+
+	mutex_lock(&xvip_dma_dbuf_lock);
+	entry = xvip_dma_dbuf_find(mem_priv);
+	if (WARN_ON(!entry) || --entry->users) {
+		mutex_unlock(&xvip_dma_dbuf_lock);
+		return;
+	}
+	dma = entry->dma;
+	mutex_unlock(&xvip_dma_dbuf_lock);
+
+	xvip_dma_dbuf_trim(dma, READ_ONCE(dmabuf_cache));
+}
+
+static int xvip_dma_map_dmabuf(void *mem_priv)
+{
+	struct xvip_dma_dbuf *entry;
+	int ret = 0;
+
+	mutex_lock(&xvip_dma_dbuf_lock);
+	entry = xvip_dma_dbuf_find(mem_priv);
+	if (WARN_ON(!entry)) {
+		ret = -EINVAL;
+	} else if (!entry->mapped) {
+		ret = vb2_dma_contig_memops.map_dmabuf(mem_priv);
+		entry->mapped = !ret;
+	}
+	mutex_unlock(&xvip_dma_dbuf_lock);
+
+	return ret;
+}
+
+static void xvip_dma_unmap_dmabuf(void *mem_priv)
+{
+	/* The mapping is kept until the attachment leaves the cache */
+}
+
+static const struct vb2_mem_ops *xvip_dma_get_memops(void)
+{
+	mutex_lock(&xvip_dma_dbuf_lock);
+	if (!xvip_dma_memops.attach_dmabuf) {
+		xvip_dma_memops = vb2_dma_contig_memops;
+		xvip_dma_memops.attach_dmabuf = xvip_dma_attach_dmabuf;
+		xvip_dma_memops.detach_dmabuf = xvip_dma_detach_dmabuf;
+		xvip_dma_memops.map_dmabuf = xvip_dma_map_dmabuf;
+		xvip_dma_memops.unmap_dmabuf = xvip_dma_unmap_dmabuf;
+	}
+	mutex_unlock(&xvip_dma_dbuf_lock);
+
+	return &xvip_dma_memops;
+}
+
 /* -----------------------------------------------------------------------------
  * videobuf2 queue operations
  */
@@ -256,16 +450,133 @@ static int xvip_pipeline_prepare(struct xvip_pipeline *pipe,
  * @queue: buffer list entry in the DMA engine queued buffers list
  * @dma: DMA channel that uses the buffer
  * @desc: Descriptor associated with this structure
+ * @req_applied: the controls of the buffer request have been applied
  */
 struct xvip_dma_buffer {
 	struct vb2_v4l2_buffer buf;
 	struct list_head queue;
 	struct xvip_dma *dma;
 	struct dma_async_tx_descriptor *desc;
+	bool req_applied;
 };
 
 #define to_xvip_dma_buffer(vb)	container_of(vb, struct xvip_dma_buffer, buf)
 
+/*
+ * Requests
+ *
+ * A request carries a buffer for the video node along with controls for the
+ * video node and for any subdev of the pipeline, such as the demosaic, gamma
+ * or CSC parameters of the frame. The controls of a request are applied
+ * once all the buffers queued ahead of it have completed, that is while the
+ * pipeline processes the frame preceding the one captured to, or read
+ * from, the request buffer. They are reported back to the request when its
+ * buffer completes.
+ *
+ * Both operations take the control handler locks and therefore sleep, so
+ * buffers that belong to a request are completed through @req_work instead
+ * of directly from the DMA completion callback.
+ */
+
+static void xvip_dma_request_setup(struct xvip_dma *dma,
+				   struct media_request *req)
+{
+	struct v4l2_subdev *sd;
+
+	v4l2_device_for_each_subdev(sd, &dma->xdev->v4l2_dev) {
+		if (sd->ctrl_handler)
+			v4l2_ctrl_request_setup(req, sd->ctrl_handler);
+	}
+
+	v4l2_ctrl_request_setup(req, &dma->ctrl_handler);
+}
+
+static void xvip_dma_request_complete(struct xvip_dma *dma,
+				      struct media_request *req)
+{
+	struct v4l2_subdev *sd;
+
+	v4l2_device_for_each_subdev(sd, &dma->xdev->v4l2_dev) {
+		if (sd->ctrl_handler)
+			v4l2_ctrl_request_complete(req, sd->ctrl_handler);
+	}
+
+	v4l2_ctrl_request_complete(req, &dma->ctrl_handler);
+}
+
+static void xvip_dma_buffer_done(struct xvip_dma *dma,
+				 struct xvip_dma_buffer *buf,
+				 enum vb2_buffer_state state)
+{
+	struct media_request *req = buf->buf.vb2_buf.req_obj.req;
+
+	/* Buffers given back as queued stay in their request */
+	if (req && state != VB2_BUF_STATE_QUEUED)
+		xvip_dma_request_complete(dma, req);
+
+	vb2_buffer_done(&buf->buf.vb2_buf, state);
+}
+
+/* Give back all queued and completed buffers, must be called unlocked */
+static void xvip_dma_return_buffers(struct xvip_dma *dma,
+				    enum vb2_buffer_state state)
+{
+	struct xvip_dma_buffer *buf, *nbuf;
+	LIST_HEAD(done);
+	LIST_HEAD(queued);
+
+	flush_work(&dma->req_work);
+
+	spin_lock_irq(&dma->queued_lock);
+	list_splice_init(&dma->done_bufs, &done);
+	list_splice_init(&dma->queued_bufs, &queued);
+	spin_unlock_irq(&dma->queued_lock);
+
+	list_for_each_entry_safe(buf, nbuf, &done, queue) {
+		list_del(&buf->queue);
+		xvip_dma_buffer_done(dma, buf, VB2_BUF_STATE_DONE);
+	}
+
+	list_for_each_entry_safe(buf, nbuf, &queued, queue) {
+		list_del(&buf->queue);
+		xvip_dma_buffer_done(dma, buf, state);
+	}
+}
+
+static void xvip_dma_request_work(struct work_struct *work)
+{
+	struct xvip_dma *dma = container_of(work, struct xvip_dma, req_work);
+	struct xvip_dma_buffer *buf, *nbuf;
+	struct media_request *req = NULL;
+	LIST_HEAD(done);
+
+	spin_lock_irq(&dma->queued_lock);
+	list_splice_init(&dma->done_bufs, &done);
+
+	buf = list_first_entry_or_null(&dma->queued_bufs,
+				       struct xvip_dma_buffer, queue);
+	if (buf && buf->buf.vb2_buf.req_obj.req && !buf->req_applied) {
+		buf->req_applied = true;
+		req = buf->buf.vb2_buf.req_obj.req;
+		media_request_get(req);
+	}
+	spin_unlock_irq(&dma->queued_lock);
+
+	/*
+	 * Report the controls of the completed requests before the next
+	 * request changes them.
+	 */
+	list_for_each_entry_safe(buf, nbuf, &done, queue) {
+		list_del(&buf->queue);
+		xvip_dma_buffer_done(dma, buf, VB2_BUF_STATE_DONE);
+	}
+
+	if (req) {
+		xvip_dma_request_setup(dma, req);
+		media_request_put(req);
+	}
+}
+
 static void xvip_dma_complete(void *param)
 {
 	struct xvip_dma_buffer *buf = param;
@@ -313,6 +624,14 @@ static void xvip_dma_complete(void *param)
 		vb2_set_plane_payload(&buf->buf.vb2_buf, 0, sizeimage);
 	}
 
+	if (buf->buf.vb2_buf.req_obj.req) {
+		spin_lock(&dma->queued_lock);
+		list_add_tail(&buf->queue, &dma->done_bufs);
+		spin_unlock(&dma->queued_lock);
+		schedule_work(&dma->req_work);
+		return;
+	}
+
 	vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_DONE);
 }
 
@@ -325,6 +644,10 @@ xvip_dma_queue_setup(struct vb2_queue *vq,
 	unsigned int i;
 	int sizeimage;
 
+	/* Attachments cached for the previous buffers are stale now */
+	if (!vq->num_buffers)
+		xvip_dma_dbuf_trim(dma, 0);
+
 	/* Multi planar case: Make sure the image size is large enough */
 	if (V4L2_TYPE_IS_MULTIPLANAR(dma->format.type)) {
 		if (*nplanes) {
@@ -365,11 +688,23 @@ static int xvip_dma_buffer_prepare(struct vb2_buffer *vb)
 	struct xvip_dma *dma = vb2_get_drv_priv(vb->vb2_queue);
 	struct xvip_dma_buffer *buf = to_xvip_dma_buffer(vbuf);
 
+	/* Low latency capture starts the DMA by hand, outside of requests */
+	if (vb->req_obj.req && dma->low_latency_cap)
+		return -EINVAL;
+
 	buf->dma = dma;
+	buf->req_applied = false;
 
 	return 0;
 }
 
+static void xvip_dma_buffer_request_complete(struct vb2_buffer *vb)
+{
+	struct xvip_dma *dma = vb2_get_drv_priv(vb->vb2_queue);
+
+	xvip_dma_request_complete(dma, vb->req_obj.req);
+}
+
 static void xvip_dma_buffer_queue(struct vb2_buffer *vb)
 {
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
@@ -515,6 +850,10 @@ static void xvip_dma_buffer_queue(struct vb2_buffer *vb)
 					EARLY_CALLBACK_START_DESC);
 	dmaengine_submit(desc);
 
+	/* Apply the controls if the buffer is next in line */
+	if (vb->req_obj.req)
+		schedule_work(&dma->req_work);
+
 	if (vb2_is_streaming(&dma->queue))
 		dma_async_issue_pending(dma->dma);
 }
@@ -522,13 +861,16 @@ static void xvip_dma_buffer_queue(struct vb2_buffer *vb)
 static int xvip_dma_start_streaming(struct vb2_queue *vq, unsigned int count)
 {
 	struct xvip_dma *dma = vb2_get_drv_priv(vq);
-	struct xvip_dma_buffer *buf, *nbuf;
+	struct xvip_dma_buffer *buf;
 	struct xvip_pipeline *pipe;
 	int ret;
 
 	dma->sequence = 0;
 	dma->prev_fid = ~0;
 
+	/* Make sure the controls of the first request are in place */
+	flush_work(&dma->req_work);
+
 	/*
 	 * Start streaming on the pipeline. No link touching an entity in the
 	 * pipeline can be activated or deactivated once streaming is started.
@@ -585,12 +927,7 @@ static int xvip_dma_start_streaming(struct vb2_queue *vq, unsigned int count)
 error:
 	dmaengine_terminate_all(dma->dma);
 	/* Give back all queued buffers to videobuf2. */
-	spin_lock_irq(&dma->queued_lock);
-	list_for_each_entry_safe(buf, nbuf, &dma->queued_bufs, queue) {
-		vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_QUEUED);
-		list_del(&buf->queue);
-	}
-	spin_unlock_irq(&dma->queued_lock);
+	xvip_dma_return_buffers(dma, VB2_BUF_STATE_QUEUED);
 
 	return ret;
 }
@@ -599,7 +936,6 @@ static void xvip_dma_stop_streaming(struct vb2_queue *vq)
 {
 	struct xvip_dma *dma = vb2_get_drv_priv(vq);
 	struct xvip_pipeline *pipe = to_xvip_pipeline(&dma->video);
-	struct xvip_dma_buffer *buf, *nbuf;
 
 	/* Stop the pipeline. */
 	xvip_pipeline_set_stream(pipe, false);
@@ -612,18 +948,14 @@ static void xvip_dma_stop_streaming(struct vb2_queue *vq)
 	video_device_pipeline_stop(&dma->video);
 
 	/* Give back all queued buffers to videobuf2. */
-	spin_lock_irq(&dma->queued_lock);
-	list_for_each_entry_safe(buf, nbuf, &dma->queued_bufs, queue) {
-		vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_ERROR);
-		list_del(&buf->queue);
-	}
-	spin_unlock_irq(&dma->queued_lock);
+	xvip_dma_return_buffers(dma, VB2_BUF_STATE_ERROR);
 }
 
 static const struct vb2_ops xvip_dma_queue_qops = {
 	.queue_setup = xvip_dma_queue_setup,
 	.buf_prepare = xvip_dma_buffer_prepare,
 	.buf_queue = xvip_dma_buffer_queue,
+	.buf_request_complete = xvip_dma_buffer_request_complete,
 	.wait_prepare = vb2_ops_wait_prepare,
 	.wait_finish = vb2_ops_wait_finish,
 	.start_streaming = xvip_dma_start_streaming,
@@ -1234,6 +1566,19 @@ static int xvip_dma_open(struct file *file)
 	return 0;
 }
 
+static int xvip_dma_release(struct file *file)
+{
+	struct xvip_dma *dma = video_drvdata(file);
+	int ret;
+
+	ret = vb2_fop_release(file);
+
+	/* Don't keep the application dmabufs alive after it let them go */
+	xvip_dma_dbuf_trim(dma, 0);
+
+	return ret;
+}
+
 static const struct v4l2_ctrl_ops xvip_dma_ctrl_ops = {
 	.s_ctrl = xvip_dma_s_ctrl,
 };
@@ -1259,7 +1604,7 @@ static const struct v4l2_file_operations xvip_dma_fops = {
 	.owner		= THIS_MODULE,
 	.unlocked_ioctl	= video_ioctl2,
 	.open		= xvip_dma_open,
-	.release	= vb2_fop_release,
+	.release	= xvip_dma_release,
 	.poll		= vb2_fop_poll,
 	.mmap		= vb2_fop_mmap,
 };
@@ -1281,6 +1626,8 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	mutex_init(&dma->pipe.lock);
 	INIT_LIST_HEAD(&dma->queued_bufs);
 	spin_lock_init(&dma->queued_lock);
+	INIT_LIST_HEAD(&dma->done_bufs);
+	INIT_WORK(&dma->req_work, xvip_dma_request_work);
 
 	dma->fmtinfo = xvip_get_format_by_fourcc(XVIP_DMA_DEF_FORMAT);
 	dma->format.type = type;
@@ -1425,7 +1772,8 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	dma->queue.drv_priv = dma;
 	dma->queue.buf_struct_size = sizeof(struct xvip_dma_buffer);
 	dma->queue.ops = &xvip_dma_queue_qops;
-	dma->queue.mem_ops = &vb2_dma_contig_memops;
+	dma->queue.mem_ops = xvip_dma_get_memops();
+	dma->queue.supports_requests = true;
 	dma->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
 				   | V4L2_BUF_FLAG_TSTAMP_SRC_EOF;
 	dma->queue.dev = dma->xdev->dev;
@@ -1472,6 +1820,9 @@ void xvip_dma_cleanup(struct xvip_dma *dma)
 	if (video_is_registered(&dma->video))
 		video_unregister_device(&dma->video);
 
+	cancel_work_sync(&dma->req_work);
+	xvip_dma_dbuf_trim(dma, 0);
+
 	if (!IS_ERR_OR_NULL(dma->dma))
 		dma_release_channel(dma->dma);
 
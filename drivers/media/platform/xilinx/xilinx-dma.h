@@ -16,6 +16,7 @@
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
 #include <linux/videodev2.h>
+#include <linux/workqueue.h>
 
 #include <media/media-entity.h>
 #include <media/v4l2-ctrls.h>
@@ -75,7 +76,9 @@ static inline struct xvip_pipeline *to_xvip_pipeline(struct video_device *vdev)
  * @queue: vb2 buffers queue
  * @sequence: V4L2 buffers sequence number
  * @queued_bufs: list of queued buffers
- * @queued_lock: protects the buf_queued list
+ * @queued_lock: protects the buf_queued and done_bufs lists
+ * @done_bufs: list of completed request buffers waiting for @req_work
+ * @req_work: completes request buffers and applies request controls
  * @dma: DMA engine channel
  * @align: transfer alignment required by the DMA channel (in bytes)
  * @width_align: width alignment required by the DMA channel (in bytes)
@@ -108,6 +111,8 @@ struct xvip_dma {
 
 	struct list_head queued_bufs;
 	spinlock_t queued_lock;
+	struct list_head done_bufs;
+	struct work_struct req_work;
 
 	struct dma_chan *dma;
 	unsigned int align;
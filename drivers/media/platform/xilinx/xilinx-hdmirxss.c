@@ -8,12 +8,15 @@
 
 #include <linux/clk.h>
 #include <linux/bitfield.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/firmware.h>
+#include <linux/ktime.h>
 #include <linux/math64.h>
 #include <linux/of.h>
 #include <linux/phy/phy.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <media/media-entity.h>
 #include <media/v4l2-dv-timings.h>
 #include <media/v4l2-event.h>
@@ -29,7 +32,12 @@
 #define TIME_16MS		(AXILITE_FREQ * 10 / 625)
 #define TIME_200MS		(AXILITE_FREQ / 5)
 
-#define MAX_VID_PROP_TRIES	7
+/*
+ * The AVI infoframe is polled for every 10 ms, the stream is taken as DVI
+ * when there is none after about 1.4 s
+ */
+#define VID_PROP_POLL		TIME_10MS
+#define MAX_VID_PROP_TRIES	140
 #define MAX_FIELDS		2
 #define COREPIXPERCLK		4
 #define MAX_FRL_RETRY		(256)
@@ -46,6 +54,22 @@ enum xhdmirx_stream_state {
 	XSTREAM_MAX_STATE = 7,
 };
 
+enum xhdmirx_detect_stage {
+	XDETECT_CONNECT = 0,
+	XDETECT_LINK_RDY = 1,
+	XDETECT_LINK_EN = 2,
+	XDETECT_VID_PROP = 3,
+	XDETECT_VID_RDY = 4,
+	XDETECT_VTD_EN = 5,
+	XDETECT_UP = 6,
+	XDETECT_NUM_STAGES = 7,
+};
+
+static const char * const xhdmirx_detect_stages[XDETECT_NUM_STAGES] = {
+	"connect", "link ready", "link enabled", "video properties",
+	"video ready", "timing detection", "stream up",
+};
+
 enum xhdmirx_syncstatus {
 	XSYNCSTAT_SYNC_LOSS = 0,
 	XSYNCSTAT_SYNC_EST = 1,
@@ -319,6 +343,26 @@ struct xhdmi_aux {
 	union xhdmi_auxdata data;
 };
 
+/**
+ * struct xhdmirx_detect_stats - Timing of the stream detection stages
+ * @lock: protects the statistics against the debugfs reads
+ * @ts: time each stage of the ongoing detection was reached at, in ns
+ * @last: time spent in each stage of the last detection, in ns
+ * @total_last: duration of the last detection, in ns
+ * @total_min: shortest detection, in ns
+ * @total_max: longest detection, in ns
+ * @count: number of detections
+ */
+struct xhdmirx_detect_stats {
+	spinlock_t lock; /* statistics */
+	u64 ts[XDETECT_NUM_STAGES];
+	u64 last[XDETECT_NUM_STAGES];
+	u64 total_last;
+	u64 total_min;
+	u64 total_max;
+	u32 count;
+};
+
 /**
  * struct xhdmirx_state - HDMI Rx driver state
  * @dev: Platform structure
@@ -346,6 +390,8 @@ struct xhdmi_aux {
  * @max_frl_rate: Maximum FRL rate supported from IP configuration
  * @hdmi_stream_up: hdmi stream is up or not
  * @isstreamup: flag whether stream is up
+ * @detect: time spent in the stages of the stream detection
+ * @debugfs: debugfs directory of the device
  */
 struct xhdmirx_state {
 	struct device *dev;
@@ -374,6 +420,8 @@ struct xhdmirx_state {
 	u8 max_frl_rate;
 	u8 hdmi_stream_up;
 	bool isstreamup;
+	struct xhdmirx_detect_stats detect;
+	struct dentry *debugfs;
 };
 
 static const char * const xhdmirx_clks[] = {
@@ -824,6 +872,75 @@ static inline void xhdmirx_ddcscdc_clear(struct xhdmirx_state *xhdmi)
  *
  * @xhdmi: pointer to driver state
  */
+/**
+ * xhdmirx_detect_mark - Record that a stage of the stream detection is reached
+ *
+ * @xhdmi: pointer to driver state
+ * @stage: stage reached
+ *
+ * The time spent in each stage is accounted once the stream is up.
+ */
+static void xhdmirx_detect_mark(struct xhdmirx_state *xhdmi,
+				enum xhdmirx_detect_stage stage)
+{
+	struct xhdmirx_detect_stats *detect = &xhdmi->detect;
+	u64 now = ktime_get_ns(), prev = 0, first = 0;
+	int i;
+
+	if (stage == XDETECT_CONNECT)
+		memset(detect->ts, 0, sizeof(detect->ts));
+	detect->ts[stage] = now;
+
+	if (stage != XDETECT_UP)
+		return;
+
+	spin_lock(&detect->lock);
+	for (i = 0; i < XDETECT_NUM_STAGES; i++) {
+		detect->last[i] = 0;
+		if (!detect->ts[i])
+			continue;
+		if (prev)
+			detect->last[i] = detect->ts[i] - prev;
+		else
+			first = detect->ts[i];
+		prev = detect->ts[i];
+	}
+
+	detect->total_last = now - first;
+	if (!detect->count || detect->total_last < detect->total_min)
+		detect->total_min = detect->total_last;
+	if (detect->total_last > detect->total_max)
+		detect->total_max = detect->total_last;
+	detect->count++;
+	spin_unlock(&detect->lock);
+
+	/* A new detection without reconnection starts from the link */
+	memset(detect->ts, 0, sizeof(detect->ts));
+}
+
+static int xhdmirx_detect_show(struct seq_file *s, void *data)
+{
+	struct xhdmirx_state *xhdmi = s->private;
+	struct xhdmirx_detect_stats *detect = &xhdmi->detect;
+	int i;
+
+	spin_lock_irq(&detect->lock);
+	seq_printf(s, "detections: %u\n", detect->count);
+	if (detect->count) {
+		for (i = XDETECT_LINK_RDY; i < XDETECT_NUM_STAGES; i++)
+			seq_printf(s, "%-18s %8llu us\n", xhdmirx_detect_stages[i],
+				   div_u64(detect->last[i], NSEC_PER_USEC));
+		seq_printf(s, "total: last %llu us, min %llu us, max %llu us\n",
+			   div_u64(detect->total_last, NSEC_PER_USEC),
+			   div_u64(detect->total_min, NSEC_PER_USEC),
+			   div_u64(detect->total_max, NSEC_PER_USEC));
+	}
+	spin_unlock_irq(&detect->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xhdmirx_detect);
+
 static void xhdmirx_disable_allintr(struct xhdmirx_state *xhdmi)
 {
 	xhdmirx_piointr_disable(xhdmi);
@@ -2243,6 +2360,7 @@ static void xhdmirx_pioint_handler(struct xhdmirx_state *xhdmi)
 	if (event & HDMIRX_PIO_IN_DET_MASK) {
 		if (data & HDMIRX_PIO_IN_DET_MASK) {
 			/* cable connected */
+			xhdmirx_detect_mark(xhdmi, XDETECT_CONNECT);
 			xhdmi->stream.cable_connected = true;
 			xhdmi_frlreset(xhdmi, false);
 			xhdmi->stream.ishdmi = false;
@@ -2284,6 +2402,7 @@ static void xhdmirx_pioint_handler(struct xhdmirx_state *xhdmi)
 			dev_dbg_ratelimited(xhdmi->dev, "LNK_RDY during FRL Link");
 		} else {
 			dev_dbg_ratelimited(xhdmi->dev, "LNK_RDY TMDS");
+			xhdmirx_detect_mark(xhdmi, XDETECT_LINK_RDY);
 			xhdmi->stream.state = XSTREAM_IDLE;
 			dev_dbg_ratelimited(xhdmi->dev, "pio lnk rdy state = XSTREAM_IDLE");
 			/* start 10 ms timer */
@@ -2331,8 +2450,9 @@ static void xhdmirx_pioint_handler(struct xhdmirx_state *xhdmi)
 					xhdmirx_sysrst_deassert(xhdmi);
 
 					xhdmi->stream.state = XSTREAM_ARM;
-					/* start 200 ms timer */
-					xhdmirx_tmr1_start(xhdmi, TIME_200MS);
+					xhdmirx_detect_mark(xhdmi, XDETECT_VID_RDY);
+					/* let the bridge settle for a frame */
+					xhdmirx_tmr1_start(xhdmi, TIME_16MS);
 				}
 			} else {
 				/* Stream Down */
@@ -2451,16 +2571,18 @@ static void xhdmirx_tmrint_handler(struct xhdmirx_state *xhdmi)
 
 				xhdmi->stream.state = XSTREAM_INIT;
 				xhdmi->stream.getvidproptries = 0;
+				xhdmirx_detect_mark(xhdmi, XDETECT_LINK_EN);
 			}
-			xhdmirx_tmr1_start(xhdmi, TIME_200MS);
+			xhdmirx_tmr1_start(xhdmi, VID_PROP_POLL);
 
 		} else if (xhdmi->stream.state == XSTREAM_INIT) {
 			dev_dbg_ratelimited(xhdmi->dev, "state = XSTREAM_INIT\n");
 			/* get video properties */
 			if (xhdmirx1_get_video_properties(xhdmi)) {
 				/* failed to get video properties */
-				xhdmirx_tmr1_start(xhdmi, TIME_200MS);
+				xhdmirx_tmr1_start(xhdmi, VID_PROP_POLL);
 			} else {
+				xhdmirx_detect_mark(xhdmi, XDETECT_VID_PROP);
 				xhdmirx1_setpixelclk(xhdmi);
 
 				if (xhdmi->stream.isfrl) {
@@ -2478,7 +2600,8 @@ static void xhdmirx_tmrint_handler(struct xhdmirx_state *xhdmi)
 					xhdmirx_sysrst_deassert(xhdmi);
 
 					xhdmi->stream.state = XSTREAM_ARM;
-					xhdmirx_tmr1_start(xhdmi, TIME_200MS);
+					xhdmirx_detect_mark(xhdmi, XDETECT_VID_RDY);
+					xhdmirx_tmr1_start(xhdmi, TIME_16MS);
 				} else {
 					rxstreaminit(xhdmi);
 				}
@@ -2486,11 +2609,16 @@ static void xhdmirx_tmrint_handler(struct xhdmirx_state *xhdmi)
 
 		} else if (xhdmi->stream.state == XSTREAM_ARM) {
 			dev_dbg(xhdmi->dev, "%s - state = XSTREAM_ARM\n", __func__);
+			/*
+			 * Check the timing every frame until it is stable, the
+			 * 200 ms time base is restored once the stream is up
+			 */
+			xhdmirx_vtd_settimebase(xhdmi, TIME_16MS);
 			xhdmirx_vtd_enable(xhdmi);
 			xhdmirx_vtdintr_enable(xhdmi);
 
-			/* 16 ms timer count is already loaded in VTD */
 			xhdmi->stream.state = XSTREAM_LOCK;
+			xhdmirx_detect_mark(xhdmi, XDETECT_VTD_EN);
 		}
 	}
 
@@ -2589,10 +2717,12 @@ static void xhdmirx_vtdint_handler(struct xhdmirx_state *xhdmi)
 
 				xhdmi->stream.state = XSTREAM_UP;
 				xhdmi->stream.syncstatus = XSYNCSTAT_SYNC_EST;
+				xhdmirx_vtd_settimebase(xhdmi, TIME_200MS);
 
 				rxstreamup(xhdmi);
 
 				xhdmi->hdmi_stream_up = 1;
+				xhdmirx_detect_mark(xhdmi, XDETECT_UP);
 			}
 		} else if (xhdmi->stream.state == XSTREAM_UP) {
 			int ret;
@@ -2608,6 +2738,7 @@ static void xhdmirx_vtdint_handler(struct xhdmirx_state *xhdmi)
 				if (!xhdmi->stream.isfrl) {
 					/* in tmds mode just set state to lock */
 					xhdmi->stream.state = XSTREAM_LOCK;
+					xhdmirx_vtd_settimebase(xhdmi, TIME_16MS);
 				} else {
 					/* need to do frl mode */
 					xhdmirx_rxcore_lrst_assert(xhdmi);
@@ -3576,6 +3707,7 @@ static int xhdmirx_probe(struct platform_device *pdev)
 	xhdmi->dev = &pdev->dev;
 
 	platform_set_drvdata(pdev, xhdmi);
+	spin_lock_init(&xhdmi->detect.lock);
 
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	xhdmi->regs = devm_ioremap_resource(xhdmi->dev, res);
@@ -3713,6 +3845,10 @@ static int xhdmirx_probe(struct platform_device *pdev)
 
 	xhdmirx1_start(xhdmi);
 
+	xhdmi->debugfs = debugfs_create_dir(dev_name(xhdmi->dev), NULL);
+	debugfs_create_file("detect", 0444, xhdmi->debugfs, xhdmi,
+			    &xhdmirx_detect_fops);
+
 	dev_info(xhdmi->dev, "driver probe successful\n");
 
 	return 0;
@@ -3739,6 +3875,7 @@ static int xhdmirx_remove(struct platform_device *pdev)
 	struct v4l2_subdev *sd = &xhdmi->sd;
 	int num_clks = ARRAY_SIZE(xhdmirx_clks);
 
+	debugfs_remove_recursive(xhdmi->debugfs);
 	v4l2_async_unregister_subdev(sd);
 	media_entity_cleanup(&sd->entity);
 	xhdmirx_phy_release(xhdmi);
@@ -13,16 +13,19 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
 #include <linux/gpio/consumer.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include <media/v4l2-device.h>
@@ -104,11 +107,6 @@
 #define XM2MSC_CHAN_OUT		0
 #define XM2MSC_CHAN_CAP		1
 
-#define NUM_STREAM(_x)			\
-	({ typeof(_x) (x) = (_x);	\
-	min(ffz(x->out_streamed_chan),	\
-	    ffz(x->cap_streamed_chan)); })
-
 #define XM2MSC_ALIGN_MUL	8
 
 /*
@@ -140,6 +138,12 @@ module_param_array(capture_height_align, uint, NULL, 0644);
 MODULE_PARM_DESC(capture_height_align,
 		 "Per channel height alignment requied at capture.");
 
+static unsigned int chan_weight[XM2MSC_MAX_CHAN] = {
+					1, 1, 1, 1, 1, 1, 1, 1 };
+module_param_array(chan_weight, uint, NULL, 0644);
+MODULE_PARM_DESC(chan_weight,
+		 "Per channel number of frames it may place in one hardware run.");
+
 /* Xilinx Video Specific Color/Pixel Formats */
 enum xm2msc_pix_fmt {
 	XILINX_M2MSC_FMT_RGBX8		= 10,
@@ -322,6 +326,22 @@ struct xm2msc_q_data {
 	const struct xm2msc_fmt *fmt;
 };
 
+/**
+ * struct xm2msc_chan_stats - Per-context scheduling statistics
+ * @jobs: number of jobs run
+ * @queue_ns: total time jobs waited for a hardware run
+ * @queue_max_ns: longest time a job waited for a hardware run
+ * @hw_ns: total duration of the hardware runs jobs were part of
+ * @hw_max_ns: longest duration of such a hardware run
+ */
+struct xm2msc_chan_stats {
+	u64 jobs;
+	u64 queue_ns;
+	u64 queue_max_ns;
+	u64 hw_ns;
+	u64 hw_max_ns;
+};
+
 /**
  * struct xm2msc_chan_ctx - Scaler Channel Info, Per-Channel context
  * @regs: IO mapped base address of the Channel
@@ -334,6 +354,10 @@ struct xm2msc_q_data {
  * @capture_height_align: required align heigh value at capture pad
  * @status: channel status, CHAN_ATTACHED or CHAN_OPENED
  * @frames: number of frames processed
+ * @weight: maximum number of frames of one job in a hardware run
+ * @params_gen: generation of the format, bumped when it is reprogrammed
+ * @ready_time: time the current job was handed to the driver
+ * @stats: scheduling statistics
  * @vfd: V4L2 device
  * @fh: v4l2 file handle
  * @m2m_dev: m2m device
@@ -351,6 +375,10 @@ struct xm2msc_chan_ctx {
 	u32 capture_height_align;
 	u8 status;
 	unsigned long frames;
+	u32 weight;
+	u32 params_gen;
+	ktime_t ready_time;
+	struct xm2msc_chan_stats stats;
 
 	struct video_device vfd;
 	struct v4l2_fh fh;
@@ -360,6 +388,20 @@ struct xm2msc_chan_ctx {
 	struct xm2msc_q_data q_data[2];
 };
 
+/**
+ * struct xm2msc_job - Frame programmed into a hardware channel of a run
+ * @ctx: channel context the frame belongs to
+ * @params_gen: format generation of @ctx when the run was built
+ * @src_vb: source buffer
+ * @dst_vb: destination buffer
+ */
+struct xm2msc_job {
+	struct xm2msc_chan_ctx *ctx;
+	u32 params_gen;
+	struct vb2_v4l2_buffer *src_vb;
+	struct vb2_v4l2_buffer *dst_vb;
+};
+
 /**
  * struct xm2m_msc_dev - Xilinx M2M Multi-scaler Device
  * @dev: pointer to struct device instance used by the driver
@@ -377,10 +419,18 @@ struct xm2msc_chan_ctx {
  * @opened_chan: bitmap for all open channel
  * @out_streamed_chan: bitmap for all out streamed channel
  * @cap_streamed_chan: bitmap for all capture streamed channel
- * @running_chan: currently running channels
+ * @running_chan: number of hardware channels programmed in the IP
  * @device_busy: HW device is busy or not
- * @isr_wait: flag to follow the ISR complete or not
- * @isr_finished: Wait queue used to wait for IP to complete processing
+ * @ready_chan: bitmap of contexts with a job waiting for a run
+ * @batch_chan: bitmap of contexts with a job in the current run
+ * @batch: frames of the current run, one per hardware channel
+ * @hw_ctx: context whose format each hardware channel is programmed with
+ * @hw_gen: format generation each hardware channel is programmed with
+ * @rr_next: context given the first hardware channel of the next run
+ * @run_start: start time of the current run
+ * @runs: number of hardware runs
+ * @run_frames: number of frames processed by those runs
+ * @debugfs: debugfs directory of the device
  * @v4l2_dev: main struct to for V4L2 device drivers
  * @dev_mutex: lock for V4L2 device
  * @mutex: lock for channel ctx
@@ -408,8 +458,16 @@ struct xm2m_msc_dev {
 	u32 cap_streamed_chan;
 	u32 running_chan;
 	bool device_busy;
-	bool isr_wait;
-	wait_queue_head_t isr_finished;
+	u32 ready_chan;
+	u32 batch_chan;
+	struct xm2msc_job batch[XM2MSC_MAX_CHAN];
+	struct xm2msc_chan_ctx *hw_ctx[XM2MSC_MAX_CHAN];
+	u32 hw_gen[XM2MSC_MAX_CHAN];
+	u32 rr_next;
+	ktime_t run_start;
+	u64 runs;
+	u64 run_frames;
+	struct dentry *debugfs;
 
 	struct v4l2_device v4l2_dev;
 
@@ -722,7 +780,8 @@ xm2msc_select_vcoeff(struct xm2msc_chan_ctx *chan_ctx, const short **coeff)
 	return ntaps;
 }
 
-static void xm2mvsc_initialize_coeff_banks(struct xm2msc_chan_ctx *chan_ctx)
+static void xm2mvsc_initialize_coeff_banks(struct xm2msc_chan_ctx *chan_ctx,
+					   u32 hw_chan)
 {
 	const short *coeff = NULL;
 	u32 ntaps;
@@ -730,25 +789,30 @@ static void xm2mvsc_initialize_coeff_banks(struct xm2msc_chan_ctx *chan_ctx)
 
 	ntaps = xm2msc_select_hcoeff(chan_ctx, &coeff);
 	xm2msc_hscaler_load_ext_coeff(xm2msc, coeff, ntaps);
-	xm2msc_hscaler_set_coeff(chan_ctx, XM2MVSC_HFLTCOEFF(chan_ctx->num));
+	xm2msc_hscaler_set_coeff(chan_ctx, XM2MVSC_HFLTCOEFF(hw_chan));
 
 	dev_dbg(xm2msc->dev, "htaps %d selected for chan %d\n",
 		ntaps, chan_ctx->num);
 
 	ntaps = xm2msc_select_vcoeff(chan_ctx, &coeff);
 	xm2msc_vscaler_load_ext_coeff(xm2msc, coeff, ntaps);
-	xm2msc_vscaler_set_coeff(chan_ctx, XM2MVSC_VFLTCOEFF(chan_ctx->num));
+	xm2msc_vscaler_set_coeff(chan_ctx, XM2MVSC_VFLTCOEFF(hw_chan));
 
 	dev_dbg(xm2msc->dev, "vtaps %d selected for chan %d\n",
 		ntaps, chan_ctx->num);
 }
 
+/*
+ * A context is not tied to the hardware channel of the same number: a run
+ * packs the frames it processes into the first hardware channels, so the
+ * format of a context is programmed into whichever channel it is given.
+ */
 static int xm2msc_set_chan_params(struct xm2msc_chan_ctx *chan_ctx,
-				  enum v4l2_buf_type type)
+				  enum v4l2_buf_type type, u32 hw_chan)
 {
 	struct xm2msc_q_data *q_data = get_q_data(chan_ctx, type);
 	const struct xm2msc_fmt *fmt;
-	void __iomem *base = chan_ctx->regs;
+	void __iomem *base = chan_ctx->xm2msc_dev->xm2msc_chan[hw_chan].regs;
 
 	if (!q_data)
 		return -EINVAL;
@@ -770,15 +834,16 @@ static int xm2msc_set_chan_params(struct xm2msc_chan_ctx *chan_ctx,
 	return 0;
 }
 
-static void xm2msc_set_chan_com_params(struct xm2msc_chan_ctx *chan_ctx)
+static void xm2msc_set_chan_com_params(struct xm2msc_chan_ctx *chan_ctx,
+				       u32 hw_chan)
 {
-	void __iomem *base = chan_ctx->regs;
+	void __iomem *base = chan_ctx->xm2msc_dev->xm2msc_chan[hw_chan].regs;
 	struct xm2msc_q_data *out_q_data = &chan_ctx->q_data[XM2MSC_CHAN_OUT];
 	struct xm2msc_q_data *cap_q_data = &chan_ctx->q_data[XM2MSC_CHAN_CAP];
 	u32 pixel_rate;
 	u32 line_rate;
 
-	xm2mvsc_initialize_coeff_banks(chan_ctx);
+	xm2mvsc_initialize_coeff_banks(chan_ctx, hw_chan);
 
 	pixel_rate = (out_q_data->width * XM2MSC_STEP_PRECISION) /
 		cap_q_data->width;
@@ -789,27 +854,22 @@ static void xm2msc_set_chan_com_params(struct xm2msc_chan_ctx *chan_ctx)
 	xm2msc_writereg(base + XM2MSC_LINERATE, line_rate);
 }
 
-static int xm2msc_program_allchan(struct xm2m_msc_dev *xm2msc)
+static int xm2msc_program_chan(struct xm2msc_chan_ctx *chan_ctx, u32 hw_chan)
 {
-	u32 chan;
+	enum v4l2_buf_type type;
+	int ret;
 
-	for (chan = 0; chan < xm2msc->running_chan; chan++) {
-		struct xm2msc_chan_ctx *chan_ctx;
-		enum v4l2_buf_type type;
-		int ret;
+	type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	ret = xm2msc_set_chan_params(chan_ctx, type, hw_chan);
+	if (ret)
+		return ret;
 
-		chan_ctx = &xm2msc->xm2msc_chan[chan];
-		type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
-		ret = xm2msc_set_chan_params(chan_ctx, type);
-		if (ret)
-			return ret;
+	type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	ret = xm2msc_set_chan_params(chan_ctx, type, hw_chan);
+	if (ret)
+		return ret;
+	xm2msc_set_chan_com_params(chan_ctx, hw_chan);
 
-		type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-		ret = xm2msc_set_chan_params(chan_ctx, type);
-		if (ret)
-			return ret;
-		xm2msc_set_chan_com_params(chan_ctx);
-	}
 	return 0;
 }
 
@@ -1047,6 +1107,12 @@ static void xm2msc_reset(struct xm2m_msc_dev *xm2msc)
 
 /*
  * mem2mem callbacks
+ *
+ * Every channel context has its own m2m device, so the jobs of different
+ * contexts are handed in independently. device_run() only queues a job, and
+ * whenever the IP goes idle the jobs waiting at that point are programmed
+ * into the hardware channels of a single run, which is started once and
+ * completes with a single interrupt.
  */
 static int xm2msc_job_ready(void *priv)
 {
@@ -1058,53 +1124,21 @@ static int xm2msc_job_ready(void *priv)
 	return 0;
 }
 
-static bool xm2msc_alljob_ready(struct xm2m_msc_dev *xm2msc)
-{
-	struct xm2msc_chan_ctx *chan_ctx;
-	unsigned int chan;
-
-	for (chan = 0; chan < xm2msc->running_chan; chan++) {
-		chan_ctx = &xm2msc->xm2msc_chan[chan];
-
-		if (!xm2msc_job_ready((void *)chan_ctx)) {
-			dev_dbg(xm2msc->dev, "chan %d not ready\n",
-				chan_ctx->num);
-			return false;
-		}
-	}
-
-	return true;
-}
-
-static void xm2msc_chan_abort_bufs(struct xm2msc_chan_ctx *chan_ctx)
-{
-	struct xm2m_msc_dev *xm2msc = chan_ctx->xm2msc_dev;
-	struct vb2_v4l2_buffer *dst_vb, *src_vb;
-
-	spin_lock(&xm2msc->lock);
-	dev_dbg(xm2msc->dev, "aborting all buffers\n");
-
-	while (v4l2_m2m_num_src_bufs_ready(chan_ctx->m2m_ctx) > 0) {
-		src_vb = v4l2_m2m_src_buf_remove(chan_ctx->m2m_ctx);
-		if (src_vb)
-			v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_ERROR);
-	}
-
-	while (v4l2_m2m_num_dst_bufs_ready(chan_ctx->m2m_ctx) > 0) {
-		dst_vb = v4l2_m2m_dst_buf_remove(chan_ctx->m2m_ctx);
-		if (dst_vb)
-			v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_ERROR);
-	}
-
-	v4l2_m2m_job_finish(chan_ctx->m2m_dev, chan_ctx->m2m_ctx);
-	spin_unlock(&xm2msc->lock);
-}
-
 static void xm2msc_job_abort(void *priv)
 {
 	struct xm2msc_chan_ctx *chan_ctx = priv;
+	struct xm2m_msc_dev *xm2msc = chan_ctx->xm2msc_dev;
+	unsigned long flags;
+	bool queued;
 
-	xm2msc_chan_abort_bufs(chan_ctx);
+	/* A job that is part of a run is finished when the run completes */
+	spin_lock_irqsave(&xm2msc->lock, flags);
+	queued = xm2msc_testbit(chan_ctx->num, &xm2msc->ready_chan);
+	xm2msc_clrbit(chan_ctx->num, &xm2msc->ready_chan);
+	spin_unlock_irqrestore(&xm2msc->lock, flags);
+
+	if (queued)
+		v4l2_m2m_job_finish(chan_ctx->m2m_dev, chan_ctx->m2m_ctx);
 
 	/*
 	 * Stream off the channel as job_abort may not always
@@ -1114,185 +1148,270 @@ static void xm2msc_job_abort(void *priv)
 	xm2msc_set_chan_stream(chan_ctx, false, XM2MSC_CHAN_CAP);
 }
 
-static int xm2msc_set_bufaddr(struct xm2m_msc_dev *xm2msc)
+static void xm2msc_set_bufaddr(struct xm2m_msc_dev *xm2msc,
+			       struct xm2msc_job *job, u32 hw_chan)
 {
-	unsigned int chan;
-	u32 row_align;
-	struct xm2msc_chan_ctx *chan_ctx;
-	struct vb2_v4l2_buffer *src_vb, *dst_vb;
-	void __iomem *base;
+	struct xm2msc_chan_ctx *chan_ctx = job->ctx;
+	void __iomem *base = xm2msc->xm2msc_chan[hw_chan].regs;
 	struct xm2msc_q_data *q_data;
+	u32 row_align;
 	dma_addr_t src_luma, dst_luma;
 	dma_addr_t src_croma, dst_croma;
 
-	if (!xm2msc_alljob_ready(xm2msc))
-		return -EINVAL;
+	src_luma = vb2_dma_contig_plane_dma_addr(&job->src_vb->vb2_buf, 0);
+	dst_luma = vb2_dma_contig_plane_dma_addr(&job->dst_vb->vb2_buf, 0);
+
+	q_data = &chan_ctx->q_data[XM2MSC_CHAN_OUT];
+	row_align = chan_ctx->output_height_align;
+	if (chan_ctx->q_data[XM2MSC_CHAN_OUT].nbuffs == 2)
+		/* fmts having 2 planes 2 buffers */
+		src_croma =
+			vb2_dma_contig_plane_dma_addr(&job->src_vb->vb2_buf, 1);
+	else if (xm2msc_is_yuv_singlebuff(q_data->fmt->fourcc))
+		/* fmts having 2 planes 1 contiguous buffer */
+		src_croma = src_luma +
+			xm2msc_yuv_1stplane_size(q_data, row_align);
+	else /* fmts having 1 planes 1 contiguous buffer */
+		src_croma = 0;
+
+	q_data = &chan_ctx->q_data[XM2MSC_CHAN_CAP];
+	row_align = chan_ctx->capture_height_align;
+	if (chan_ctx->q_data[XM2MSC_CHAN_CAP].nbuffs == 2)
+		dst_croma =
+			vb2_dma_contig_plane_dma_addr(&job->dst_vb->vb2_buf, 1);
+	else if (xm2msc_is_yuv_singlebuff(q_data->fmt->fourcc))
+		dst_croma = dst_luma +
+			xm2msc_yuv_1stplane_size(q_data, row_align);
+	else
+		dst_croma = 0;
+
+	if (xm2msc->dma_addr_size == 64 &&
+	    sizeof(dma_addr_t) == sizeof(u64)) {
+		xm2msc_write64reg(base + XM2MSC_SRCIMGBUF0, src_luma);
+		xm2msc_write64reg(base + XM2MSC_SRCIMGBUF1, src_croma);
+		xm2msc_write64reg(base + XM2MSC_DSTIMGBUF0, dst_luma);
+		if (hw_chan == 4) /* TODO: To be fixed in HW */
+			xm2msc_write64reg(base + XM2MSC_DSTIMGBUF1 +
+					  XM2MSC_RESERVED_AREA,
+					  dst_croma);
+		else
+			xm2msc_write64reg(base + XM2MSC_DSTIMGBUF1,
+					  dst_croma);
+	} else {
+		xm2msc_writereg(base + XM2MSC_SRCIMGBUF0, src_luma);
+		xm2msc_writereg(base + XM2MSC_SRCIMGBUF1, src_croma);
+		xm2msc_writereg(base + XM2MSC_DSTIMGBUF0, dst_luma);
+		if (hw_chan == 4) /* TODO: To be fixed in HW */
+			xm2msc_writereg(base + XM2MSC_DSTIMGBUF1 +
+					XM2MSC_RESERVED_AREA,
+					dst_croma);
+		else
+			xm2msc_writereg(base + XM2MSC_DSTIMGBUF1,
+					dst_croma);
+	}
+}
 
-	for (chan = 0; chan < xm2msc->running_chan; chan++) {
-		chan_ctx = &xm2msc->xm2msc_chan[chan];
-		base = chan_ctx->regs;
+static void xm2msc_batch_add(struct xm2m_msc_dev *xm2msc,
+			     struct xm2msc_chan_ctx *chan_ctx, u32 nr)
+{
+	struct xm2msc_job *job = &xm2msc->batch[nr];
 
-		src_vb = v4l2_m2m_next_src_buf(chan_ctx->m2m_ctx);
-		dst_vb = v4l2_m2m_next_dst_buf(chan_ctx->m2m_ctx);
+	job->ctx = chan_ctx;
+	job->params_gen = chan_ctx->params_gen;
+	job->src_vb = v4l2_m2m_src_buf_remove(chan_ctx->m2m_ctx);
+	job->dst_vb = v4l2_m2m_dst_buf_remove(chan_ctx->m2m_ctx);
+}
 
-		if (!src_vb || !dst_vb) {
-			v4l2_err(&xm2msc->v4l2_dev, "buffer not found chan = %d\n",
-				 chan_ctx->num);
-			return -EINVAL;
-		}
+/**
+ * xm2msc_build_batch - Collect the waiting jobs into the next run
+ * @xm2msc: multi-scaler device
+ *
+ * The first frame of every waiting job is placed in context order, which
+ * keeps a context in the same hardware channel from run to run as long as
+ * the set of waiting contexts does not change. There are never more
+ * contexts than hardware channels, so no job is left behind. Hardware
+ * channels still free then take further queued frames of contexts whose
+ * weight allows it, one per context and round, starting from a context
+ * that rotates with every run.
+ *
+ * Context: Called with the device lock held.
+ *
+ * Return: number of frames in the run
+ */
+static u32 xm2msc_build_batch(struct xm2m_msc_dev *xm2msc)
+{
+	u32 avail[XM2MSC_MAX_CHAN] = { 0 };
+	u32 taken[XM2MSC_MAX_CHAN] = { 0 };
+	ktime_t now = ktime_get();
+	u32 nr = 0, chan, i;
+	bool added;
 
-		src_luma = vb2_dma_contig_plane_dma_addr(&src_vb->vb2_buf, 0);
-		dst_luma = vb2_dma_contig_plane_dma_addr(&dst_vb->vb2_buf, 0);
-
-		q_data = &chan_ctx->q_data[XM2MSC_CHAN_OUT];
-		row_align = chan_ctx->output_height_align;
-		if (chan_ctx->q_data[XM2MSC_CHAN_OUT].nbuffs == 2)
-			/* fmts having 2 planes 2 buffers */
-			src_croma =
-				vb2_dma_contig_plane_dma_addr(&src_vb->vb2_buf,
-							      1);
-		else if (xm2msc_is_yuv_singlebuff(q_data->fmt->fourcc))
-			/* fmts having 2 planes 1 contiguous buffer */
-			src_croma = src_luma +
-				xm2msc_yuv_1stplane_size(q_data, row_align);
-		else /* fmts having 1 planes 1 contiguous buffer */
-			src_croma = 0;
-
-		q_data = &chan_ctx->q_data[XM2MSC_CHAN_CAP];
-		row_align = chan_ctx->capture_height_align;
-		if (chan_ctx->q_data[XM2MSC_CHAN_CAP].nbuffs == 2)
-			dst_croma =
-				vb2_dma_contig_plane_dma_addr(&dst_vb->vb2_buf,
-							      1);
-		else if (xm2msc_is_yuv_singlebuff(q_data->fmt->fourcc))
-			dst_croma = dst_luma +
-				xm2msc_yuv_1stplane_size(q_data, row_align);
-		else
-			dst_croma = 0;
-
-		if (xm2msc->dma_addr_size == 64 &&
-		    sizeof(dma_addr_t) == sizeof(u64)) {
-			xm2msc_write64reg(base + XM2MSC_SRCIMGBUF0, src_luma);
-			xm2msc_write64reg(base + XM2MSC_SRCIMGBUF1, src_croma);
-			xm2msc_write64reg(base + XM2MSC_DSTIMGBUF0, dst_luma);
-			if (chan_ctx->num == 4) /* TODO: To be fixed in HW */
-				xm2msc_write64reg(base + XM2MSC_DSTIMGBUF1 +
-						  XM2MSC_RESERVED_AREA,
-						  dst_croma);
-			else
-				xm2msc_write64reg(base + XM2MSC_DSTIMGBUF1,
-						  dst_croma);
-		} else {
-			xm2msc_writereg(base + XM2MSC_SRCIMGBUF0, src_luma);
-			xm2msc_writereg(base + XM2MSC_SRCIMGBUF1, src_croma);
-			xm2msc_writereg(base + XM2MSC_DSTIMGBUF0, dst_luma);
-			if (chan_ctx->num == 4) /* TODO: To be fixed in HW */
-				xm2msc_writereg(base + XM2MSC_DSTIMGBUF1 +
-						XM2MSC_RESERVED_AREA,
-						dst_croma);
-			else
-				xm2msc_writereg(base + XM2MSC_DSTIMGBUF1,
-						dst_croma);
-		}
+	for (chan = 0; chan < xm2msc->max_chan; chan++) {
+		struct xm2msc_chan_ctx *chan_ctx = &xm2msc->xm2msc_chan[chan];
+
+		if (!xm2msc_testbit(chan, &xm2msc->ready_chan))
+			continue;
+
+		avail[chan] = min3(v4l2_m2m_num_src_bufs_ready(chan_ctx->m2m_ctx),
+				   v4l2_m2m_num_dst_bufs_ready(chan_ctx->m2m_ctx),
+				   chan_ctx->weight);
+		if (!avail[chan])
+			continue;
+
+		xm2msc_batch_add(xm2msc, chan_ctx, nr++);
+		taken[chan]++;
 	}
-	return 0;
-}
 
-static void xm2msc_job_finish(struct xm2m_msc_dev *xm2msc)
-{
-	unsigned int chan;
+	do {
+		added = false;
+		for (i = 0; i < xm2msc->max_chan && nr < xm2msc->max_chan;
+		     i++) {
+			chan = (xm2msc->rr_next + i) % xm2msc->max_chan;
+			if (taken[chan] == avail[chan])
+				continue;
 
-	for (chan = 0; chan < xm2msc->running_chan; chan++) {
-		struct xm2msc_chan_ctx *chan_ctx;
+			xm2msc_batch_add(xm2msc, &xm2msc->xm2msc_chan[chan],
+					 nr++);
+			taken[chan]++;
+			added = true;
+		}
+	} while (added && nr < xm2msc->max_chan);
 
-		chan_ctx = &xm2msc->xm2msc_chan[chan];
-		v4l2_m2m_job_finish(chan_ctx->m2m_dev, chan_ctx->m2m_ctx);
+	for (chan = 0; chan < xm2msc->max_chan; chan++) {
+		struct xm2msc_chan_ctx *chan_ctx = &xm2msc->xm2msc_chan[chan];
+		struct xm2msc_chan_stats *stats = &chan_ctx->stats;
+		u64 delay;
+
+		if (!taken[chan])
+			continue;
+
+		delay = ktime_to_ns(ktime_sub(now, chan_ctx->ready_time));
+		stats->jobs++;
+		stats->queue_ns += delay;
+		stats->queue_max_ns = max(stats->queue_max_ns, delay);
+
+		xm2msc_clrbit(chan, &xm2msc->ready_chan);
+		xm2msc_setbit(chan, &xm2msc->batch_chan);
 	}
+
+	xm2msc->rr_next = (xm2msc->rr_next + 1) % xm2msc->max_chan;
+
+	return nr;
 }
 
-static void xm2msc_job_done(struct xm2m_msc_dev *xm2msc)
+/**
+ * xm2msc_run_done - Complete the current run
+ * @xm2msc: multi-scaler device
+ * @state: state to return the buffers of the run in
+ */
+static void xm2msc_run_done(struct xm2m_msc_dev *xm2msc,
+			    enum vb2_buffer_state state)
 {
-	u32 chan;
+	u64 hw_ns = ktime_to_ns(ktime_sub(ktime_get(), xm2msc->run_start));
+	unsigned long flags;
+	u32 chan, batch_chan;
 
 	for (chan = 0; chan < xm2msc->running_chan; chan++) {
-		struct xm2msc_chan_ctx *chan_ctx;
-		struct vb2_v4l2_buffer *src_vb, *dst_vb;
-		unsigned long flags;
-
-		chan_ctx = &xm2msc->xm2msc_chan[chan];
+		struct xm2msc_job *job = &xm2msc->batch[chan];
+		struct vb2_v4l2_buffer *src_vb = job->src_vb;
+		struct vb2_v4l2_buffer *dst_vb = job->dst_vb;
+
+		dst_vb->vb2_buf.timestamp = src_vb->vb2_buf.timestamp;
+		dst_vb->timecode = src_vb->timecode;
+		dst_vb->flags &= ~V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
+		dst_vb->flags |= src_vb->flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
+
+		spin_lock_irqsave(&xm2msc->lock, flags);
+		v4l2_m2m_buf_done(src_vb, state);
+		v4l2_m2m_buf_done(dst_vb, state);
+		spin_unlock_irqrestore(&xm2msc->lock, flags);
+		job->ctx->frames++;
+	}
 
-		src_vb = v4l2_m2m_src_buf_remove(chan_ctx->m2m_ctx);
-		dst_vb = v4l2_m2m_dst_buf_remove(chan_ctx->m2m_ctx);
+	spin_lock_irqsave(&xm2msc->lock, flags);
+	batch_chan = xm2msc->batch_chan;
+	if (state == VB2_BUF_STATE_DONE) {
+		for (chan = 0; chan < xm2msc->max_chan; chan++) {
+			struct xm2msc_chan_stats *stats;
 
-		if (src_vb && dst_vb) {
-			dst_vb->vb2_buf.timestamp = src_vb->vb2_buf.timestamp;
-			dst_vb->timecode = src_vb->timecode;
-			dst_vb->flags &= ~V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
-			dst_vb->flags |=
-			    src_vb->flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
+			if (!xm2msc_testbit(chan, &batch_chan))
+				continue;
 
-			spin_lock_irqsave(&xm2msc->lock, flags);
-			v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_DONE);
-			v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_DONE);
-			spin_unlock_irqrestore(&xm2msc->lock, flags);
+			stats = &xm2msc->xm2msc_chan[chan].stats;
+			stats->hw_ns += hw_ns;
+			stats->hw_max_ns = max(stats->hw_max_ns, hw_ns);
 		}
-		chan_ctx->frames++;
+		xm2msc->runs++;
+		xm2msc->run_frames += xm2msc->running_chan;
+	}
+	xm2msc->batch_chan = 0;
+	xm2msc->device_busy = false;
+	spin_unlock_irqrestore(&xm2msc->lock, flags);
+
+	for (chan = 0; chan < xm2msc->max_chan; chan++) {
+		struct xm2msc_chan_ctx *chan_ctx = &xm2msc->xm2msc_chan[chan];
+
+		if (xm2msc_testbit(chan, &batch_chan))
+			v4l2_m2m_job_finish(chan_ctx->m2m_dev,
+					    chan_ctx->m2m_ctx);
 	}
 }
 
-static void xm2msc_device_run(void *priv)
+/**
+ * xm2msc_schedule - Start a run of the waiting jobs if the IP is idle
+ * @xm2msc: multi-scaler device
+ *
+ * Context: Process context, may sleep.
+ */
+static void xm2msc_schedule(struct xm2m_msc_dev *xm2msc)
 {
-	struct xm2msc_chan_ctx *chan_ctx = priv;
-	struct xm2m_msc_dev *xm2msc = chan_ctx->xm2msc_dev;
 	void __iomem *base = xm2msc->regs;
 	unsigned long flags;
+	u32 nr, chan;
 	int ret;
 
 	spin_lock_irqsave(&xm2msc->lock, flags);
-	if (xm2msc->device_busy) {
+	if (xm2msc->device_busy || !xm2msc->ready_chan) {
 		spin_unlock_irqrestore(&xm2msc->lock, flags);
 		return;
 	}
-	xm2msc->device_busy = true;
+	nr = xm2msc_build_batch(xm2msc);
+	xm2msc->device_busy = !!nr;
+	spin_unlock_irqrestore(&xm2msc->lock, flags);
+
+	if (!nr)
+		return;
 
-	if (xm2msc->running_chan != NUM_STREAM(xm2msc)) {
+	if (xm2msc->running_chan != nr) {
 		dev_dbg(xm2msc->dev, "Running chan was %d\n",
 			xm2msc->running_chan);
-		xm2msc->running_chan = NUM_STREAM(xm2msc);
+		xm2msc->running_chan = nr;
 
 		/* IP need reset for updating of XM2MSC_NUM_OUT */
 		xm2msc_reset(xm2msc);
 		xm2msc_writereg(base + XM2MSC_NUM_OUTS, xm2msc->running_chan);
-		ret = xm2msc_program_allchan(xm2msc);
-		if (ret) {
-			spin_unlock_irqrestore(&xm2msc->lock, flags);
-			xm2msc->device_busy = false;
-			return;
-		}
+		memset(xm2msc->hw_ctx, 0, sizeof(xm2msc->hw_ctx));
 	}
-	spin_unlock_irqrestore(&xm2msc->lock, flags);
 
-	dev_dbg(xm2msc->dev, "Running chan = %d\n", xm2msc->running_chan);
-	if (!xm2msc->running_chan) {
-		xm2msc->device_busy = false;
-		return;
+	for (chan = 0; chan < nr; chan++) {
+		struct xm2msc_job *job = &xm2msc->batch[chan];
+
+		/* Only hardware channels given to another format are rewritten */
+		if (xm2msc->hw_ctx[chan] != job->ctx ||
+		    xm2msc->hw_gen[chan] != job->params_gen) {
+			ret = xm2msc_program_chan(job->ctx, chan);
+			if (ret) {
+				xm2msc->hw_ctx[chan] = NULL;
+				xm2msc_run_done(xm2msc, VB2_BUF_STATE_ERROR);
+				return;
+			}
+			xm2msc->hw_ctx[chan] = job->ctx;
+			xm2msc->hw_gen[chan] = job->params_gen;
+		}
+		xm2msc_set_bufaddr(xm2msc, job, chan);
 	}
 
-	ret = xm2msc_set_bufaddr(xm2msc);
-	if (ret) {
-		/*
-		 * All channel does not have buffer
-		 * Currently we do not handle the removal of any Intermediate
-		 * channel while streaming is going on
-		 */
-		if (xm2msc->out_streamed_chan || xm2msc->cap_streamed_chan)
-			dev_dbg(xm2msc->dev,
-				"Buffer not available, streaming chan 0x%x\n",
-				xm2msc->cap_streamed_chan);
-
-		xm2msc->device_busy = false;
-		return;
-	}
+	dev_dbg(xm2msc->dev, "Running chan = %d\n", xm2msc->running_chan);
 
 	xm2msc_writereg(base + XM2MSC_GIE, XM2MSC_GIE_EN);
 	xm2msc_writereg(base + XM2MSC_IER, XM2MSC_ISR_DONE);
@@ -1301,19 +1420,22 @@ static void xm2msc_device_run(void *priv)
 	xm2msc_pr_screg(xm2msc->dev, base);
 	xm2msc_pr_allchanreg(xm2msc);
 
+	xm2msc->run_start = ktime_get();
 	xm2msc_start(xm2msc);
+}
 
-	xm2msc->isr_wait = true;
-	wait_event(xm2msc->isr_finished, !xm2msc->isr_wait);
-
-	xm2msc_job_done(xm2msc);
-
-	xm2msc->device_busy = false;
+static void xm2msc_device_run(void *priv)
+{
+	struct xm2msc_chan_ctx *chan_ctx = priv;
+	struct xm2m_msc_dev *xm2msc = chan_ctx->xm2msc_dev;
+	unsigned long flags;
 
-	if (xm2msc_alljob_ready(xm2msc))
-		xm2msc_device_run(xm2msc->xm2msc_chan);
+	spin_lock_irqsave(&xm2msc->lock, flags);
+	chan_ctx->ready_time = ktime_get();
+	xm2msc_setbit(chan_ctx->num, &xm2msc->ready_chan);
+	spin_unlock_irqrestore(&xm2msc->lock, flags);
 
-	xm2msc_job_finish(xm2msc);
+	xm2msc_schedule(xm2msc);
 }
 
 static irqreturn_t xm2msc_isr(int irq, void *data)
@@ -1330,12 +1452,58 @@ static irqreturn_t xm2msc_isr(int irq, void *data)
 
 	xm2msc_stop(xm2msc);
 
-	xm2msc->isr_wait = false;
-	wake_up(&xm2msc->isr_finished);
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t xm2msc_isr_thread(int irq, void *data)
+{
+	struct xm2m_msc_dev *xm2msc = (struct xm2m_msc_dev *)data;
+
+	if (!xm2msc->device_busy)
+		return IRQ_HANDLED;
+
+	xm2msc_run_done(xm2msc, VB2_BUF_STATE_DONE);
+	/* Jobs that came in during the run form the next one */
+	xm2msc_schedule(xm2msc);
 
 	return IRQ_HANDLED;
 }
 
+static int xm2msc_stats_show(struct seq_file *s, void *data)
+{
+	struct xm2m_msc_dev *xm2msc = s->private;
+	unsigned long flags;
+	u32 chan;
+
+	spin_lock_irqsave(&xm2msc->lock, flags);
+
+	seq_printf(s, "runs %llu frames %llu\n",
+		   xm2msc->runs, xm2msc->run_frames);
+	seq_puts(s, "chan weight jobs frames queue_avg_us queue_max_us hw_avg_us hw_max_us\n");
+
+	for (chan = 0; chan < xm2msc->max_chan; chan++) {
+		struct xm2msc_chan_ctx *chan_ctx = &xm2msc->xm2msc_chan[chan];
+		struct xm2msc_chan_stats *stats = &chan_ctx->stats;
+		u64 jobs = stats->jobs ? stats->jobs : 1;
+
+		if (!(chan_ctx->status & CHAN_OPENED))
+			continue;
+
+		seq_printf(s, "%u %u %llu %lu %llu %llu %llu %llu\n",
+			   chan, chan_ctx->weight, stats->jobs,
+			   chan_ctx->frames,
+			   div64_u64(stats->queue_ns, jobs) / NSEC_PER_USEC,
+			   div_u64(stats->queue_max_ns, NSEC_PER_USEC),
+			   div64_u64(stats->hw_ns, jobs) / NSEC_PER_USEC,
+			   div_u64(stats->hw_max_ns, NSEC_PER_USEC));
+	}
+
+	spin_unlock_irqrestore(&xm2msc->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xm2msc_stats);
+
 static int xm2msc_streamon(struct file *file, void *fh,
 			   enum v4l2_buf_type type)
 {
@@ -1348,13 +1516,8 @@ static int xm2msc_streamoff(struct file *file, void *fh,
 			    enum v4l2_buf_type type)
 {
 	struct xm2msc_chan_ctx *chan_ctx = fh_to_chanctx(fh);
-	int ret;
 
-	ret = v4l2_m2m_streamoff(file, chan_ctx->m2m_ctx, type);
-
-	/* Check if any channel is still running */
-	xm2msc_device_run(chan_ctx);
-	return ret;
+	return v4l2_m2m_streamoff(file, chan_ctx->m2m_ctx, type);
 }
 
 static int xm2msc_qbuf(struct file *file, void *fh, struct v4l2_buffer *buf)
@@ -1865,21 +2028,18 @@ static int xm2msc_start_streaming(struct vb2_queue *q, unsigned int count)
 {
 	struct xm2msc_chan_ctx *chan_ctx = vb2_get_drv_priv(q);
 	static struct xm2msc_q_data *q_data;
+	unsigned long flags;
 	int type;
-	int ret;
 
 	if (V4L2_TYPE_IS_OUTPUT(q->type))
 		xm2msc_set_chan_stream(chan_ctx, true, XM2MSC_CHAN_OUT);
 	else
 		xm2msc_set_chan_stream(chan_ctx, true, XM2MSC_CHAN_CAP);
 
-	ret = xm2msc_set_chan_params(chan_ctx, (enum v4l2_buf_type)q->type);
-	if (ret)
-		return ret;
-
-	if (xm2msc_chk_chan_stream(chan_ctx, XM2MSC_CHAN_CAP) &&
-	    xm2msc_chk_chan_stream(chan_ctx, XM2MSC_CHAN_OUT))
-		xm2msc_set_chan_com_params(chan_ctx);
+	/* The format is written to the hardware by the next run of the job */
+	spin_lock_irqsave(&chan_ctx->xm2msc_dev->lock, flags);
+	chan_ctx->params_gen++;
+	spin_unlock_irqrestore(&chan_ctx->xm2msc_dev->lock, flags);
 
 	type = V4L2_TYPE_IS_OUTPUT(q->type) ?
 		V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE :
@@ -2088,6 +2248,8 @@ static int xm2msc_open(struct file *file)
 	chan_ctx->status |= CHAN_OPENED;
 	chan_ctx->xm2msc_dev = xm2msc;
 	chan_ctx->frames = 0;
+	chan_ctx->weight = clamp_t(u32, chan_weight[chan], 1, xm2msc->max_chan);
+	memset(&chan_ctx->stats, 0, sizeof(chan_ctx->stats));
 
 	xm2msc_set_chan(chan_ctx, true);
 
@@ -2435,11 +2597,11 @@ static int xm2m_msc_probe(struct platform_device *pdev)
 
 	mutex_init(&xm2msc->dev_mutex);
 	mutex_init(&xm2msc->mutex);
-	init_waitqueue_head(&xm2msc->isr_finished);
 
-	ret = devm_request_irq(&pdev->dev, xm2msc->irq,
-			       xm2msc_isr, IRQF_SHARED,
-			       XM2MSC_DRIVER_NAME, xm2msc);
+	ret = devm_request_threaded_irq(&pdev->dev, xm2msc->irq,
+					xm2msc_isr, xm2msc_isr_thread,
+					IRQF_SHARED, XM2MSC_DRIVER_NAME,
+					xm2msc);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "Unable to register IRQ\n");
 		goto unreg_dev;
@@ -2447,6 +2609,10 @@ static int xm2m_msc_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, xm2msc);
 
+	xm2msc->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("stats", 0444, xm2msc->debugfs, xm2msc,
+			    &xm2msc_stats_fops);
+
 	return 0;
 
 unreg_dev:
@@ -2461,6 +2627,7 @@ static int xm2m_msc_remove(struct platform_device *pdev)
 {
 	struct xm2m_msc_dev *xm2msc = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(xm2msc->debugfs);
 	xm2msc_unreg_video_n_m2m(xm2msc);
 	v4l2_device_unregister(&xm2msc->v4l2_dev);
 	clk_disable_unprepare(xm2msc->clk);
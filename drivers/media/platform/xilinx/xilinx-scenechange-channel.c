@@ -9,7 +9,9 @@
  */
 
 #include <linux/gpio/consumer.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
+#include <linux/xilinx-scenechange.h>
 #include <linux/xilinx-v4l2-events.h>
 
 #include <media/v4l2-async.h>
@@ -211,8 +213,10 @@ static int xscd_s_stream(struct v4l2_subdev *subdev, int enable)
 	struct xscd_chan *chan = to_xscd_chan(subdev);
 	struct xscd_device *xscd = chan->xscd;
 
-	if (enable)
+	if (enable) {
 		xscd_chan_configure_params(chan);
+		chan->sequence = 0;
+	}
 
 	xscd_dma_enable_channel(&chan->dmachan, enable);
 
@@ -328,11 +332,12 @@ static const struct media_entity_operations xscd_media_ops = {
 
 void xscd_chan_event_notify(struct xscd_chan *chan)
 {
+	struct xscd_ring_entry entry = { 0 };
 	u32 *eventdata;
-	u32 sad;
+	u32 raw, sad;
 
-	sad = xscd_read(chan->iomem, XSCD_SAD_OFFSET);
-	sad = (sad * XSCD_V_SUBSAMPLING * MULTIPLICATION_FACTOR) /
+	raw = xscd_read(chan->iomem, XSCD_SAD_OFFSET);
+	sad = (raw * XSCD_V_SUBSAMPLING * MULTIPLICATION_FACTOR) /
 	       (chan->format.width * chan->format.height);
 	eventdata = (u32 *)&chan->event.u.data;
 
@@ -341,6 +346,14 @@ void xscd_chan_event_notify(struct xscd_chan *chan)
 	else
 		eventdata[0] = XSCD_NO_SCENE_CHANGE;
 
+	entry.timestamp = ktime_get_ns();
+	entry.sequence = chan->sequence++;
+	entry.sad = raw;
+	entry.channel = chan->id;
+	entry.score = min_t(u32, sad, MULTIPLICATION_FACTOR);
+	entry.scene_change = eventdata[0];
+	xscd_ring_push(&chan->xscd->ring, &entry);
+
 	chan->event.type = V4L2_EVENT_XLNXSCD;
 	v4l2_subdev_notify_event(&chan->subdev, &chan->event);
 }
@@ -0,0 +1,266 @@
+//SPDX-License-Identifier: GPL-2.0
+/*
+ * Xilinx Scene Change Detection result ring
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ *
+ * The results of all the channels are written by the interrupt handler to a
+ * ring that the consumer maps through a character device. The consumer is
+ * woken up through poll() or an eventfd once a configurable number of
+ * results is pending, instead of dequeuing one V4L2 event per channel and
+ * per frame.
+ */
+
+#include <linux/eventfd.h>
+#include <linux/fs.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/xilinx-scenechange.h>
+
+#include "xilinx-scenechange.h"
+
+#define XSCD_RING_MIN_ENTRIES		16
+#define XSCD_RING_MAX_ENTRIES		65536
+
+static uint ring_entries = 1024;
+module_param(ring_entries, uint, 0444);
+MODULE_PARM_DESC(ring_entries,
+		 "Number of entries of the result ring, rounded up to a power of two (default: 1024)");
+
+static inline struct xscd_ring *to_xscd_ring(struct file *file)
+{
+	struct miscdevice *misc = file->private_data;
+
+	return container_of(misc, struct xscd_ring, misc);
+}
+
+static u64 xscd_ring_pending(struct xscd_ring *ring)
+{
+	return ring->head - READ_ONCE(ring->header->tail);
+}
+
+/**
+ * xscd_ring_push - Write a result to the ring
+ * @ring: result ring
+ * @entry: result
+ *
+ * The result is dropped when no consumer has the ring open.
+ *
+ * Context: Interrupt context.
+ */
+void xscd_ring_push(struct xscd_ring *ring, const struct xscd_ring_entry *entry)
+{
+	struct xscd_ring_header *header;
+	u64 tail;
+
+	spin_lock(&ring->lock);
+
+	header = ring->header;
+	if (!header)
+		goto unlock;
+
+	ring->entries[ring->head & ring->mask] = *entry;
+	ring->head++;
+	/* Pairs with the consumer's acquire load of the head */
+	smp_store_release(&header->head, ring->head);
+
+	/*
+	 * Wake the consumer up once per batch. It is woken again only after
+	 * it has consumed some entries and enough are pending again.
+	 */
+	tail = READ_ONCE(header->tail);
+	if (ring->head - tail < ring->wakeup ||
+	    (ring->notified && tail == ring->notified_tail))
+		goto unlock;
+
+	ring->notified = true;
+	ring->notified_tail = tail;
+	wake_up_interruptible(&ring->wait);
+	if (ring->eventfd)
+		eventfd_signal(ring->eventfd, 1);
+
+unlock:
+	spin_unlock(&ring->lock);
+}
+
+static int xscd_ring_open(struct inode *inode, struct file *file)
+{
+	struct xscd_ring *ring = to_xscd_ring(file);
+	struct xscd_ring_header *header;
+
+	/* The ring has a single consumer */
+	if (test_and_set_bit(0, &ring->busy))
+		return -EBUSY;
+
+	header = vmalloc_user(ring->size);
+	if (!header) {
+		clear_bit(0, &ring->busy);
+		return -ENOMEM;
+	}
+
+	header->version = XSCD_RING_VERSION;
+	header->num_entries = ring->mask + 1;
+	header->entry_size = sizeof(struct xscd_ring_entry);
+	header->entries_offset = sizeof(*header);
+
+	spin_lock_irq(&ring->lock);
+	ring->header = header;
+	ring->entries = (void *)header + sizeof(*header);
+	ring->head = 0;
+	ring->wakeup = 1;
+	ring->notified = false;
+	spin_unlock_irq(&ring->lock);
+
+	return 0;
+}
+
+static int xscd_ring_release(struct inode *inode, struct file *file)
+{
+	struct xscd_ring *ring = to_xscd_ring(file);
+	struct xscd_ring_header *header;
+	struct eventfd_ctx *eventfd;
+
+	spin_lock_irq(&ring->lock);
+	header = ring->header;
+	eventfd = ring->eventfd;
+	ring->header = NULL;
+	ring->entries = NULL;
+	ring->eventfd = NULL;
+	spin_unlock_irq(&ring->lock);
+
+	if (eventfd)
+		eventfd_ctx_put(eventfd);
+	/* The file outlives any mapping of the ring */
+	vfree(header);
+	clear_bit(0, &ring->busy);
+
+	return 0;
+}
+
+static int xscd_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct xscd_ring *ring = to_xscd_ring(file);
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > ring->size)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->header, 0);
+}
+
+static __poll_t xscd_ring_poll(struct file *file, poll_table *wait)
+{
+	struct xscd_ring *ring = to_xscd_ring(file);
+	__poll_t mask = 0;
+
+	poll_wait(file, &ring->wait, wait);
+
+	spin_lock_irq(&ring->lock);
+	if (xscd_ring_pending(ring) >= ring->wakeup)
+		mask = EPOLLIN | EPOLLRDNORM;
+	spin_unlock_irq(&ring->lock);
+
+	return mask;
+}
+
+static long xscd_ring_ioctl(struct file *file, unsigned int cmd,
+			    unsigned long arg)
+{
+	struct xscd_ring *ring = to_xscd_ring(file);
+	void __user *argp = (void __user *)arg;
+	struct eventfd_ctx *eventfd = NULL;
+	u32 wakeup;
+	s32 fd;
+
+	switch (cmd) {
+	case XSCD_RING_SET_WAKEUP:
+		if (get_user(wakeup, (u32 __user *)argp))
+			return -EFAULT;
+		if (!wakeup || wakeup > ring->mask + 1)
+			return -EINVAL;
+
+		spin_lock_irq(&ring->lock);
+		ring->wakeup = wakeup;
+		ring->notified = false;
+		spin_unlock_irq(&ring->lock);
+		return 0;
+
+	case XSCD_RING_SET_EVENTFD:
+		if (get_user(fd, (s32 __user *)argp))
+			return -EFAULT;
+		if (fd >= 0) {
+			eventfd = eventfd_ctx_fdget(fd);
+			if (IS_ERR(eventfd))
+				return PTR_ERR(eventfd);
+		} else if (fd != -1) {
+			return -EINVAL;
+		}
+
+		spin_lock_irq(&ring->lock);
+		swap(ring->eventfd, eventfd);
+		spin_unlock_irq(&ring->lock);
+
+		if (eventfd)
+			eventfd_ctx_put(eventfd);
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations xscd_ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= xscd_ring_open,
+	.release	= xscd_ring_release,
+	.mmap		= xscd_ring_mmap,
+	.poll		= xscd_ring_poll,
+	.unlocked_ioctl	= xscd_ring_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
+	.llseek		= noop_llseek,
+};
+
+/**
+ * xscd_ring_init - Register the character device of the result ring
+ * @xscd: Pointer to the SCD device structure
+ *
+ * Return: '0' on success and failure value on error
+ */
+int xscd_ring_init(struct xscd_device *xscd)
+{
+	struct xscd_ring *ring = &xscd->ring;
+	unsigned int entries;
+
+	entries = clamp_t(unsigned int, ring_entries, XSCD_RING_MIN_ENTRIES,
+			  XSCD_RING_MAX_ENTRIES);
+	entries = roundup_pow_of_two(entries);
+
+	spin_lock_init(&ring->lock);
+	init_waitqueue_head(&ring->wait);
+	ring->mask = entries - 1;
+	ring->size = PAGE_ALIGN(sizeof(struct xscd_ring_header) +
+				entries * sizeof(struct xscd_ring_entry));
+
+	ring->misc.minor = MISC_DYNAMIC_MINOR;
+	ring->misc.fops = &xscd_ring_fops;
+	ring->misc.parent = xscd->dev;
+	ring->misc.name = devm_kasprintf(xscd->dev, GFP_KERNEL, "xscd-ring-%s",
+					 dev_name(xscd->dev));
+	if (!ring->misc.name)
+		return -ENOMEM;
+
+	return misc_register(&ring->misc);
+}
+
+/**
+ * xscd_ring_cleanup - Unregister the character device of the result ring
+ * @xscd: Pointer to the SCD device structure
+ */
+void xscd_ring_cleanup(struct xscd_device *xscd)
+{
+	misc_deregister(&xscd->ring.misc);
+}
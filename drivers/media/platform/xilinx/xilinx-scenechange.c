@@ -116,6 +116,12 @@ static int xscd_probe(struct platform_device *pdev)
 	gpiod_set_value_cansleep(xscd->rst_gpio, XSCD_RESET_ASSERT);
 	gpiod_set_value_cansleep(xscd->rst_gpio, XSCD_RESET_DEASSERT);
 
+	ret = xscd_ring_init(xscd);
+	if (ret < 0) {
+		dev_err(&pdev->dev, "Failed to register the result ring\n");
+		return ret;
+	}
+
 	/* Initialize the channels. */
 	xscd->chans = devm_kcalloc(xscd->dev, xscd->num_streams,
 				   sizeof(*xscd->chans), GFP_KERNEL);
@@ -168,6 +174,7 @@ static int xscd_remove(struct platform_device *pdev)
 	}
 
 	xscd_dma_cleanup(xscd);
+	xscd_ring_cleanup(xscd);
 	clk_disable_unprepare(xscd->clk);
 
 	return 0;
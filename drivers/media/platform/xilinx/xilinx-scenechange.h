@@ -15,6 +15,7 @@
 #include <linux/dmaengine.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/miscdevice.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
 #include <linux/wait.h>
@@ -26,7 +27,10 @@
 struct clk;
 struct device;
 struct device_node;
+struct eventfd_ctx;
 struct gpio_desc;
+struct xscd_ring_entry;
+struct xscd_ring_header;
 
 /* Register/Descriptor Offsets */
 #define XSCD_CTRL_OFFSET		0x000
@@ -150,6 +154,7 @@ static inline struct xscd_dma_chan *to_xscd_dma_chan(struct dma_chan *chan)
  * @pads: media pads
  * @format: active V4L2 media bus format for the pad
  * @event: scene change event
+ * @sequence: frame count since the channel started streaming
  * @dmachan: dma channel part of the scenechange stream
  * @lock: lock to protect active stream count variable
  */
@@ -163,6 +168,7 @@ struct xscd_chan {
 	struct media_pad pads[2];
 	struct v4l2_mbus_framefmt format;
 	struct v4l2_event event;
+	u32 sequence;
 	struct xscd_dma_chan dmachan;
 
 	/* Lock to protect active stream count */
@@ -174,6 +180,39 @@ static inline struct xscd_chan *to_xscd_chan(struct v4l2_subdev *subdev)
 	return container_of(subdev, struct xscd_chan, subdev);
 }
 
+/**
+ * struct xscd_ring - Result ring shared with the consumer
+ * @misc: character device giving access to the ring
+ * @busy: bit 0 is set while the character device is open
+ * @size: size of the ring mapping in bytes
+ * @mask: number of entries in the ring minus one
+ * @lock: protects all the fields below
+ * @header: ring mapped by the consumer, NULL when it is not open
+ * @entries: first entry of the ring
+ * @head: number of entries written, private copy of @header->head
+ * @wakeup: number of pending entries that wakes the consumer up
+ * @notified: the consumer has been woken up since @wakeup was set
+ * @notified_tail: tail of the ring at the last wake up
+ * @eventfd: eventfd signalled along with the wake ups
+ * @wait: wait queue for poll()
+ */
+struct xscd_ring {
+	struct miscdevice misc;
+	unsigned long busy;
+	size_t size;
+	u32 mask;
+
+	spinlock_t lock;
+	struct xscd_ring_header *header;
+	struct xscd_ring_entry *entries;
+	u64 head;
+	u32 wakeup;
+	bool notified;
+	u64 notified_tail;
+	struct eventfd_ctx *eventfd;
+	wait_queue_head_t wait;
+};
+
 /**
  * struct xscd_device - Xilinx Scene Change Detection device structure
  * @dev: (OF) device
@@ -188,6 +227,7 @@ static inline struct xscd_chan *to_xscd_chan(struct v4l2_subdev *subdev)
  * @channels: DMA channels
  * @lock: Protects the running field
  * @running: True when the SCD core is running
+ * @ring: result ring of all the channels
  */
 struct xscd_device {
 	struct device *dev;
@@ -207,6 +247,8 @@ struct xscd_device {
 	/* This lock is to protect the running field */
 	spinlock_t lock;
 	u8 running;
+
+	struct xscd_ring ring;
 };
 
 /*
@@ -237,6 +279,11 @@ void xscd_dma_irq_handler(struct xscd_device *xscd);
 int xscd_dma_init(struct xscd_device *xscd);
 void xscd_dma_cleanup(struct xscd_device *xscd);
 
+void xscd_ring_push(struct xscd_ring *ring,
+		    const struct xscd_ring_entry *entry);
+int xscd_ring_init(struct xscd_device *xscd);
+void xscd_ring_cleanup(struct xscd_device *xscd);
+
 void xscd_chan_event_notify(struct xscd_chan *chan);
 int xscd_chan_init(struct xscd_device *xscd, unsigned int chan_id,
 		   struct device_node *node);
@@ -9,11 +9,15 @@
  *           Laurent Pinchart <laurent.pinchart@ideasonboard.com>
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_graph.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/of_reserved_mem.h>
 
@@ -21,6 +25,7 @@
 #include <media/v4l2-common.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-fwnode.h>
+#include <media/videobuf2-v4l2.h>
 
 #include "xilinx-dma.h"
 #include "xilinx-vipp.h"
@@ -37,18 +42,38 @@ MODULE_PARM_DESC(is_mplane,
 		 "v4l2 device capability to handle multi planar formats");
 module_param_named(is_mplane, xvip_is_mplane, bool, 0444);
 
+static bool xvip_parallel_streamon = true;
+MODULE_PARM_DESC(parallel_streamon,
+		 "Power up and start the independent subdevs of a pipeline concurrently");
+module_param_named(parallel_streamon, xvip_parallel_streamon, bool, 0644);
+
+static ASYNC_DOMAIN_EXCLUSIVE(xvip_graph_async_domain);
+
 /**
  * struct xvip_graph_entity - Entity in the video graph
  * @asd: subdev asynchronous registration information
  * @entity: media entity, from the corresponding V4L2 subdev
  * @subdev: V4L2 subdev
  * @streaming: status of the V4L2 subdev if streaming or not
+ * @xdev: composite device the entity belongs to
+ * @powered: the subdev has been powered on by the pipeline start in progress
+ * @level: start order of the entity in the pipeline start in progress
+ * @ret: result of the last power or stream operation on the subdev
+ * @power_us: duration of the last s_power on in usec
+ * @stream_us: duration of the last s_stream on in usec
  */
 struct xvip_graph_entity {
 	struct v4l2_async_subdev asd; /* must be first */
 	struct media_entity *entity;
 	struct v4l2_subdev *subdev;
 	bool streaming;
+
+	struct xvip_composite_device *xdev;
+	bool powered;
+	int level;
+	int ret;
+	u64 power_us;
+	u64 stream_us;
 };
 
 static inline struct xvip_graph_entity *
@@ -355,6 +380,206 @@ static bool xvip_graph_entity_start_stop(struct xvip_composite_device *xdev,
 	return true;
 }
 
+/**
+ * xvip_graph_entity_level - Compute the start order of an entity
+ * @xdev: composite device
+ * @entity: entity to start
+ *
+ * An entity is started after all the entities it feeds through its source
+ * pads. Entities that feed nothing but DMA engines and already streaming
+ * entities start first, at level 0, and entities of the same level don't
+ * depend on each other.
+ *
+ * Return: the level of @entity
+ */
+static int xvip_graph_entity_level(struct xvip_composite_device *xdev,
+				   struct xvip_graph_entity *entity)
+{
+	unsigned int i;
+	int level = 0;
+
+	if (entity->level >= 0)
+		return entity->level;
+
+	for (i = 0; i < entity->entity->num_pads; i++) {
+		struct xvip_graph_entity *remote;
+		struct media_pad *pad;
+
+		if (!(entity->entity->pads[i].flags & MEDIA_PAD_FL_SOURCE))
+			continue;
+
+		pad = media_pad_remote_pad_first(&entity->entity->pads[i]);
+		if (!pad || !pad->entity)
+			continue;
+
+		remote = xvip_graph_find_entity_from_media(xdev, pad->entity);
+		if (!remote || remote->streaming)
+			continue;
+
+		level = max(level, xvip_graph_entity_level(xdev, remote) + 1);
+	}
+
+	entity->level = level;
+	return level;
+}
+
+static void xvip_graph_entity_power_on(void *data, async_cookie_t cookie)
+{
+	struct xvip_graph_entity *entity = data;
+	struct v4l2_subdev *subdev;
+	ktime_t start = ktime_get();
+	int ret;
+
+	subdev = media_entity_to_v4l2_subdev(entity->entity);
+	ret = v4l2_subdev_call(subdev, core, s_power, 1);
+	entity->power_us = ktime_us_delta(ktime_get(), start);
+	if (ret < 0 && ret != -ENOIOCTLCMD) {
+		dev_err(entity->xdev->dev, "s_power on failed on subdev %s\n",
+			entity->entity->name);
+		entity->ret = ret;
+		return;
+	}
+
+	entity->powered = true;
+	entity->ret = 0;
+}
+
+static void xvip_graph_entity_stream_on(void *data, async_cookie_t cookie)
+{
+	struct xvip_graph_entity *entity = data;
+	struct v4l2_subdev *subdev;
+	ktime_t start = ktime_get();
+	int ret;
+
+	subdev = media_entity_to_v4l2_subdev(entity->entity);
+	ret = v4l2_subdev_call(subdev, video, s_stream, 1);
+	entity->stream_us = ktime_us_delta(ktime_get(), start);
+	if (ret < 0 && ret != -ENOIOCTLCMD) {
+		dev_err(entity->xdev->dev, "s_stream on failed on subdev %s\n",
+			entity->entity->name);
+		entity->ret = ret;
+		return;
+	}
+
+	entity->streaming = true;
+	entity->ret = 0;
+}
+
+/**
+ * xvip_graph_pipeline_run - Run an operation on the entities of a level
+ * @xdev: composite device
+ * @level: level of the entities, or -1 for all the entities being started
+ * @func: operation
+ *
+ * The operation runs concurrently on the entities unless disabled with the
+ * parallel_streamon module parameter.
+ *
+ * Return: 0 for success, otherwise the error of one of the operations
+ */
+static int xvip_graph_pipeline_run(struct xvip_composite_device *xdev,
+				   int level, async_func_t func)
+{
+	struct v4l2_async_subdev *asd;
+	int ret = 0;
+
+	list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
+		struct xvip_graph_entity *entity = to_xvip_entity(asd);
+
+		if (entity->level < 0 || (level >= 0 && entity->level != level))
+			continue;
+
+		if (xvip_parallel_streamon)
+			async_schedule_domain(func, entity,
+					      &xvip_graph_async_domain);
+		else
+			func(entity, 0);
+	}
+
+	async_synchronize_full_domain(&xvip_graph_async_domain);
+
+	list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
+		struct xvip_graph_entity *entity = to_xvip_entity(asd);
+
+		if (entity->level < 0 || (level >= 0 && entity->level != level))
+			continue;
+
+		if (entity->ret)
+			ret = entity->ret;
+	}
+
+	return ret;
+}
+
+/**
+ * xvip_graph_pipeline_start - start the pipe in the graph
+ * @xdev: composite device
+ * @pipe: pipeline to start
+ *
+ * Power on all the subdevs of the pipe at once, as powering up has no
+ * ordering constraint, then start them level by level so that every
+ * entity starts after the entities it feeds, the entities of one level
+ * starting concurrently. On failure, the entities started here are
+ * stopped and powered off again.
+ *
+ * Return: 0 for success, otherwise error code
+ */
+static int xvip_graph_pipeline_start(struct xvip_composite_device *xdev,
+				     struct xvip_pipeline *pipe)
+{
+	struct v4l2_async_subdev *asd;
+	int max_level = -1;
+	int level, ret;
+
+	list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
+		struct xvip_graph_entity *entity = to_xvip_entity(asd);
+
+		entity->level = -1;
+		entity->powered = false;
+		entity->ret = 0;
+	}
+
+	list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
+		struct xvip_graph_entity *entity = to_xvip_entity(asd);
+
+		/* skip an entity not belongng to the given pipe */
+		if (entity->streaming ||
+		    &pipe->pipe != media_entity_pipeline(entity->entity))
+			continue;
+
+		max_level = max(max_level,
+				xvip_graph_entity_level(xdev, entity));
+	}
+
+	ret = xvip_graph_pipeline_run(xdev, -1, xvip_graph_entity_power_on);
+	for (level = 0; !ret && level <= max_level; level++)
+		ret = xvip_graph_pipeline_run(xdev, level,
+					      xvip_graph_entity_stream_on);
+	if (!ret)
+		return 0;
+
+	/* Undo in the reverse order of the start */
+	for (level = max_level; level >= 0; level--) {
+		list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
+			struct xvip_graph_entity *entity = to_xvip_entity(asd);
+			struct v4l2_subdev *subdev = entity->subdev;
+
+			if (entity->level != level)
+				continue;
+
+			if (entity->streaming) {
+				v4l2_subdev_call(subdev, video, s_stream, 0);
+				entity->streaming = false;
+			}
+			if (entity->powered) {
+				v4l2_subdev_call(subdev, core, s_power, 0);
+				entity->powered = false;
+			}
+		}
+	}
+
+	return -EPIPE;
+}
+
 /**
  * xvip_graph_pipeline_start_stop - start or stop the pipe in the graph
  * @xdev: composite device
@@ -376,6 +601,9 @@ int xvip_graph_pipeline_start_stop(struct xvip_composite_device *xdev,
 {
 	struct v4l2_async_subdev *asd;
 
+	if (on)
+		return xvip_graph_pipeline_start(xdev, pipe);
+
 	list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
 		struct xvip_graph_entity *entity;
 		bool state;
@@ -547,6 +775,7 @@ static int xvip_graph_notify_bound(struct v4l2_async_notifier *notifier,
 		dev_dbg(xdev->dev, "subdev %s bound\n", subdev->name);
 		entity->entity = &subdev->entity;
 		entity->subdev = subdev;
+		entity->xdev = xdev;
 		return 0;
 	}
 
@@ -769,6 +998,26 @@ static int xvip_graph_init(struct xvip_composite_device *xdev)
  * Media Controller and V4L2
  */
 
+static int xvip_composite_startup_show(struct seq_file *s, void *data)
+{
+	struct xvip_composite_device *xdev = s->private;
+	struct v4l2_async_subdev *asd;
+
+	list_for_each_entry(asd, &xdev->notifier.asd_list, asd_list) {
+		struct xvip_graph_entity *entity = to_xvip_entity(asd);
+
+		if (!entity->entity)
+			continue;
+
+		seq_printf(s, "%s: level %d power %llu us stream %llu us\n",
+			   entity->entity->name, entity->level,
+			   entity->power_us, entity->stream_us);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xvip_composite_startup);
+
 static void xvip_composite_v4l2_cleanup(struct xvip_composite_device *xdev)
 {
 	v4l2_device_unregister(&xdev->v4l2_dev);
@@ -776,11 +1025,18 @@ static void xvip_composite_v4l2_cleanup(struct xvip_composite_device *xdev)
 	media_device_cleanup(&xdev->media_dev);
 }
 
+/* Requests hold DMA buffers along with controls of the pipeline subdevs */
+static const struct media_device_ops xvip_composite_media_ops = {
+	.req_validate = vb2_request_validate,
+	.req_queue = vb2_request_queue,
+};
+
 static int xvip_composite_v4l2_init(struct xvip_composite_device *xdev)
 {
 	int ret;
 
 	xdev->media_dev.dev = xdev->dev;
+	xdev->media_dev.ops = &xvip_composite_media_ops;
 	strscpy(xdev->media_dev.model, "Xilinx Video Composite Device",
 		sizeof(xdev->media_dev.model));
 	xdev->media_dev.hw_revision = 0;
@@ -839,6 +1095,10 @@ static int xvip_composite_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, xdev);
 
+	xdev->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("startup", 0444, xdev->debugfs, xdev,
+			    &xvip_composite_startup_fops);
+
 	dev_info(xdev->dev, "device registered\n");
 
 	return 0;
@@ -852,6 +1112,7 @@ static int xvip_composite_remove(struct platform_device *pdev)
 {
 	struct xvip_composite_device *xdev = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(xdev->debugfs);
 	mutex_destroy(&xdev->lock);
 	xvip_graph_cleanup(xdev);
 	xvip_composite_v4l2_cleanup(xdev);
@@ -301,6 +301,48 @@ static char *aie_queue_status_str[] = {
 	"overflow",
 };
 
+static const struct aie_perf_attr aie_pl_perf = {
+	.start = {
+		.mask = GENMASK(6, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(14, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = 0x31000U,
+	.cnt_regoff = 0x31020U,
+	.num_cnts = AIE_NUM_PERF_PL_MOD,
+};
+
+static const struct aie_perf_attr aie_mem_perf = {
+	.start = {
+		.mask = GENMASK(6, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(14, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = 0x11000U,
+	.cnt_regoff = 0x11020U,
+	.num_cnts = AIE_NUM_PERF_MEM_MOD,
+};
+
+static const struct aie_perf_attr aie_core_perf = {
+	.start = {
+		.mask = GENMASK(6, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(14, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = 0x31000U,
+	.cnt_regoff = 0x31020U,
+	.num_cnts = AIE_NUM_PERF_CORE_MOD,
+};
+
 static const struct aie_event_attr aie_pl_event = {
 	.bc_event = {
 		.mask = GENMASK(6, 0),
@@ -892,11 +934,13 @@ static const struct aie_dev_attr aie_tile_dev_attr[] = {
 
 static const struct aie_dev_attr aie_aperture_dev_attr[] = {
 	AIE_APERTURE_ATTR_RO(hardware_info),
+	AIE_APERTURE_ATTR_RO(part_clean_stats),
 };
 
 static const struct aie_dev_attr aie_part_dev_attr[] = {
 	AIE_PART_DEV_ATTR_RO(error_stat),
 	AIE_PART_DEV_ATTR_RO(current_freq),
+	AIE_PART_DEV_ATTR_RO(dmabuf_cache),
 };
 
 static const struct aie_bin_attr aie_part_bin_attr[] = {
@@ -995,6 +1039,13 @@ static int aie_init_part_clk_state(struct aie_partition *apart)
 		return ret;
 	}
 
+	ret = aie_resource_initialize(&apart->tiles_dirty, num_tiles);
+	if (ret) {
+		dev_err(&apart->dev,
+			"failed to initialize tiles dirty resource.\n");
+		return ret;
+	}
+
 	return 0;
 }
 
@@ -1225,6 +1276,9 @@ static u32 aie_get_core_status(struct aie_partition *apart,
  * aie_part_clear_mems() - clear memories of every tile in a partition
  * @apart: AI engine partition
  * @return: return 0 always.
+ *
+ * The memories of the tiles whose clock has never been enabled since the
+ * partition was last cleaned up cannot have been written and are skipped.
  */
 static int aie_part_clear_mems(struct aie_partition *apart)
 {
@@ -1252,6 +1306,9 @@ static int aie_part_clear_mems(struct aie_partition *apart)
 
 				loc.col = c;
 				loc.row = r;
+				if (!aie_part_check_tile_dirty(apart, &loc))
+					continue;
+
 				memoff = aie_cal_regoff(adev, loc, mem->offset);
 				memset_io(apart->aperture->base + memoff, 0,
 					  mem->size);
@@ -1940,6 +1997,9 @@ int aie_device_init(struct aie_device *adev)
 	adev->pl_events = &aie_pl_event;
 	adev->mem_events = &aie_mem_event;
 	adev->core_events = &aie_core_event;
+	adev->pl_perfs = &aie_pl_perf;
+	adev->mem_perfs = &aie_mem_perf;
+	adev->core_perfs = &aie_core_perf;
 	adev->l1_ctrl = &aie_l1_intr_ctrl;
 	adev->l2_ctrl = &aie_l2_intr_ctrl;
 	adev->core_errors = &aie_core_error;
@@ -85,6 +85,8 @@
 #define AIEML_SHIMPL_GROUPERROR_REGOFF			0x0003450cU
 #define AIEML_SHIMPL_L1INTR_MASK_A_REGOFF		0x00035000U
 #define AIEML_SHIMPL_L1INTR_BLOCK_NORTH_B_REGOFF	0x00035050U
+#define AIEML_SHIMPL_PERFCTRL_REGOFF			0x00031000U
+#define AIEML_SHIMPL_PERFCNT0_REGOFF			0x00031020U
 #define AIEML_SHIMPL_TILECTRL_REGOFF			0x00036030U
 #define AIEML_SHIMPL_MODCLOCK_CTRL_0_REGOFF		0x000fff00U
 #define AIEML_SHIMPL_MODCLOCK_CTRL_1_REGOFF		0x000fff04U
@@ -97,6 +99,8 @@
 #define AIEML_MEMORY_EVENT_BC0_REGOFF			0x00094010U
 #define AIEML_MEMORY_EVENT_STATUS0_REGOFF		0x00094200U
 #define AIEML_MEMORY_MEMCTRL_REGOFF			0x00096048U
+#define AIEML_MEMORY_PERFCTRL_REGOFF			0x00091000U
+#define AIEML_MEMORY_PERFCNT0_REGOFF			0x00091020U
 #define AIEML_MEMORY_MODCLOCKCTRL_REGOFF		0x000fff00U
 #define AIEML_MEMORY_MODRESETCTRL_REGOFF		0x000fff10U
 #define AIEML_MEMORY_LOCK_REGOFF			0x000C0000U
@@ -123,11 +127,15 @@
 #define AIEML_TILE_COREMOD_CORE_PC_REGOFF		0x00031100U
 #define AIEML_TILE_COREMOD_CORE_SP_REGOFF		0x00031120U
 #define AIEML_TILE_COREMOD_CORE_LR_REGOFF		0x00031130U
+#define AIEML_TILE_COREMOD_PERFCTRL_REGOFF		0x00031500U
+#define AIEML_TILE_COREMOD_PERFCNT0_REGOFF		0x00031520U
 #define AIEML_TILE_MEMMOD_GROUPERROR_REGOFF		0x00014514U
 #define AIEML_TILE_MEMMOD_GROUP0_REGOFF			0x00014500U
 #define AIEML_TILE_MEMMOD_EVENT_BC0_REGOFF		0x00014010U
 #define AIEML_TILE_MEMMOD_EVENT_STATUS0_REGOFF		0x00014200U
 #define AIEML_TILE_MEMMOD_MEMCTRL_REGOFF		0x00016010U
+#define AIEML_TILE_MEMMOD_PERFCTRL_REGOFF		0x00011000U
+#define AIEML_TILE_MEMMOD_PERFCNT0_REGOFF		0x00011020U
 #define AIEML_TILE_MEMMOD_LOCK_REGOFF			0x0001F000U
 #define AIEML_TILE_MEMMOD_LOCK_OVERFLOW_REGOFF		0x0001F120U
 #define AIEML_TILE_MEMMOD_LOCK_UNDERFLOW_REGOFF		0x0001F128U
@@ -1097,6 +1105,62 @@ static const struct aie_event_attr aieml_core_event = {
 	.num_events = 128U,
 };
 
+static const struct aie_perf_attr aieml_pl_perf = {
+	.start = {
+		.mask = GENMASK(6, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(14, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = AIEML_SHIMPL_PERFCTRL_REGOFF,
+	.cnt_regoff = AIEML_SHIMPL_PERFCNT0_REGOFF,
+	.num_cnts = AIEML_NUM_PERF_PL_MOD,
+};
+
+static const struct aie_perf_attr aieml_memtile_perf = {
+	.start = {
+		.mask = GENMASK(7, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(15, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = AIEML_MEMORY_PERFCTRL_REGOFF,
+	.cnt_regoff = AIEML_MEMORY_PERFCNT0_REGOFF,
+	.num_cnts = AIEML_NUM_PERF_MEM_MOD,
+};
+
+static const struct aie_perf_attr aieml_mem_perf = {
+	.start = {
+		.mask = GENMASK(6, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(14, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = AIEML_TILE_MEMMOD_PERFCTRL_REGOFF,
+	.cnt_regoff = AIEML_TILE_MEMMOD_PERFCNT0_REGOFF,
+	.num_cnts = AIEML_NUM_PERF_TILE_MEM_MOD,
+};
+
+static const struct aie_perf_attr aieml_core_perf = {
+	.start = {
+		.mask = GENMASK(6, 0),
+		.regoff = 0x0U,
+	},
+	.stop = {
+		.mask = GENMASK(14, 8),
+		.regoff = 0x0U,
+	},
+	.ctrl_regoff = AIEML_TILE_COREMOD_PERFCTRL_REGOFF,
+	.cnt_regoff = AIEML_TILE_COREMOD_PERFCNT0_REGOFF,
+	.num_cnts = AIEML_NUM_PERF_TILE_CORE_MOD,
+};
+
 static char *aieml_core_status_str[] = {
 	"enable",
 	"reset",
@@ -1134,6 +1198,7 @@ static char *aieml_dma_qsts_str[] = {
 
 static const struct aie_dev_attr aieml_aperture_dev_attr[] = {
 	AIE_APERTURE_ATTR_RO(hardware_info),
+	AIE_APERTURE_ATTR_RO(part_clean_stats),
 };
 
 static const struct aie_dev_attr aieml_tile_dev_attr[] = {
@@ -1157,6 +1222,7 @@ static const struct aie_dev_attr aieml_tile_dev_attr[] = {
 static const struct aie_dev_attr aieml_part_dev_attr[] = {
 	AIE_PART_DEV_ATTR_RO(current_freq),
 	AIE_PART_DEV_ATTR_RO(error_stat),
+	AIE_PART_DEV_ATTR_RO(dmabuf_cache),
 };
 
 static const struct aie_bin_attr aieml_part_bin_attr[] = {
@@ -1800,9 +1866,16 @@ static int aieml_init_part_clk_state(struct aie_partition *apart)
 	}
 
 	ret = aie_resource_initialize(&apart->tiles_inuse, num_tiles);
-	if (ret)
+	if (ret) {
 		dev_err(&apart->dev,
 			"failed to initialize tiles in use resource.\n");
+		return ret;
+	}
+
+	ret = aie_resource_initialize(&apart->tiles_dirty, num_tiles);
+	if (ret)
+		dev_err(&apart->dev,
+			"failed to initialize tiles dirty resource.\n");
 
 	return ret;
 }
@@ -1872,19 +1945,34 @@ static int aieml_set_part_clocks(struct aie_partition *apart)
 				apart->cores_clk_state.total);
 }
 
+/*
+ * The memories are zeroized by columns, skipping the columns none of whose
+ * tiles has been clocked since the partition was last cleaned up.
+ */
 static int aieml_part_clear_mems(struct aie_partition *apart)
 {
 	struct aie_range *range = &apart->range;
 	u32 node_id = apart->adev->pm_node_id;
+	u32 col, ncols;
+	bool dirty;
 	int ret;
 
-	ret = zynqmp_pm_aie_operation(node_id, range->start.col,
-				      range->size.col,
-				      XILINX_AIE_OPS_ZEROISATION);
-	if (ret < 0)
-		dev_err(&apart->dev, "failed to clear memory for partition\n");
+	for (col = range->start.col; col < range->start.col + range->size.col;
+	     col += ncols) {
+		ncols = aie_part_get_col_run(apart, col, &dirty);
+		if (!dirty)
+			continue;
 
-	return ret;
+		ret = zynqmp_pm_aie_operation(node_id, col, ncols,
+					      XILINX_AIE_OPS_ZEROISATION);
+		if (ret < 0) {
+			dev_err(&apart->dev,
+				"failed to clear memory for partition\n");
+			return ret;
+		}
+	}
+
+	return 0;
 }
 
 /**
@@ -2011,6 +2099,10 @@ int aieml_device_init(struct aie_device *adev)
 	adev->pl_lock = &aieml_pl_lock;
 	adev->memtile_lock = &aieml_memtile_lock;
 	adev->core_events = &aieml_core_event;
+	adev->pl_perfs = &aieml_pl_perf;
+	adev->memtile_perfs = &aieml_memtile_perf;
+	adev->mem_perfs = &aieml_mem_perf;
+	adev->core_perfs = &aieml_core_perf;
 	adev->core_errors = &aieml_core_error;
 	adev->mem_errors = &aieml_mem_error;
 	adev->memtile_errors = &aieml_memtile_error;
@@ -284,6 +284,7 @@ static void aie_aperture_release_device(struct device *dev)
 
 	aie_resource_uninitialize(&aperture->cols_res);
 	aie_resource_uninitialize(&aperture->l2_mask);
+	aie_resource_uninitialize(&aperture->l2_status);
 	zynqmp_pm_release_node(aperture->node_id);
 	kfree(aperture);
 }
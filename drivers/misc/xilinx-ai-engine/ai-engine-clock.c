@@ -42,7 +42,12 @@ static int aie_part_get_clk_state_bit(struct aie_partition *apart,
  */
 int aie_part_scan_clk_state(struct aie_partition *apart)
 {
-	return apart->adev->ops->scan_part_clocks(apart);
+	int ret;
+
+	ret = apart->adev->ops->scan_part_clocks(apart);
+	aie_part_mark_tiles_dirty(apart);
+
+	return ret;
 }
 
 /**
@@ -64,6 +69,74 @@ bool aie_part_check_clk_enable_loc(struct aie_partition *apart,
 	return aie_resource_testbit(&apart->cores_clk_state, bit);
 }
 
+/**
+ * aie_part_mark_tiles_dirty() - record the tiles whose clock is enabled as
+ *				 the tiles to clean up
+ * @apart: AI engine partition
+ *
+ * A tile, once its clock has been enabled, is cleaned up when the partition
+ * is released even if its clock is gated again in the meantime.
+ */
+void aie_part_mark_tiles_dirty(struct aie_partition *apart)
+{
+	bitmap_or(apart->tiles_dirty.bitmap, apart->tiles_dirty.bitmap,
+		  apart->cores_clk_state.bitmap, apart->tiles_dirty.total);
+}
+
+/**
+ * aie_part_check_tile_dirty() - return if a tile needs to be cleaned up
+ * @apart: AI engine partition
+ * @loc: AI engine tile location
+ * @return: true if the tile needs to be cleaned up, false otherwise
+ */
+bool aie_part_check_tile_dirty(struct aie_partition *apart,
+			       struct aie_location *loc)
+{
+	int bit = aie_part_get_clk_state_bit(apart, loc);
+
+	if (bit < 0)
+		return true;
+
+	return aie_resource_testbit(&apart->tiles_dirty, bit);
+}
+
+/**
+ * aie_part_check_col_dirty() - return if a column needs to be cleaned up
+ * @apart: AI engine partition
+ * @col: absolute column
+ * @return: true if any tile of the column needs to be cleaned up
+ */
+static bool aie_part_check_col_dirty(struct aie_partition *apart, u32 col)
+{
+	u32 num_rows = apart->range.size.row - 1;
+	u32 sbit = (col - apart->range.start.col) * num_rows;
+
+	return find_next_bit(apart->tiles_dirty.bitmap, sbit + num_rows,
+			     sbit) < sbit + num_rows;
+}
+
+/**
+ * aie_part_get_col_run() - get the columns from a column which all need or
+ *			    all do not need to be cleaned up
+ * @apart: AI engine partition
+ * @col: absolute start column
+ * @dirty: returns true if the columns need to be cleaned up
+ * @return: number of columns in the run
+ */
+u32 aie_part_get_col_run(struct aie_partition *apart, u32 col, bool *dirty)
+{
+	u32 ecol = apart->range.start.col + apart->range.size.col;
+	u32 c;
+
+	*dirty = aie_part_check_col_dirty(apart, col);
+	for (c = col + 1; c < ecol; c++) {
+		if (aie_part_check_col_dirty(apart, c) != *dirty)
+			break;
+	}
+
+	return c - col;
+}
+
 /**
  * aie_part_request_tiles() - request tiles from an AI engine partition.
  * @apart: AI engine partition
@@ -76,6 +149,8 @@ bool aie_part_check_clk_enable_loc(struct aie_partition *apart,
 int aie_part_request_tiles(struct aie_partition *apart, int num_tiles,
 			   struct aie_location *locs)
 {
+	int ret;
+
 	if (num_tiles == 0) {
 		aie_resource_set(&apart->tiles_inuse, 0,
 				 apart->tiles_inuse.total);
@@ -93,7 +168,10 @@ int aie_part_request_tiles(struct aie_partition *apart, int num_tiles,
 		}
 	}
 
-	return apart->adev->ops->set_part_clocks(apart);
+	ret = apart->adev->ops->set_part_clocks(apart);
+	aie_part_mark_tiles_dirty(apart);
+
+	return ret;
 }
 
 /**
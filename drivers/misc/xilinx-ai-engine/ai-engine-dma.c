@@ -9,11 +9,25 @@
 #include <linux/dma-buf.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/refcount.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/uaccess.h>
 
+#define CREATE_TRACE_POINTS
+#include "ai-engine-trace.h"
+
+/*
+ * Detached dmabufs stay attached and mapped, so that attaching them again
+ * only costs a lookup. The least recently detached ones are unmapped when
+ * a partition has more than dmabuf_cache of them.
+ */
+static unsigned int dmabuf_cache = 8;
+module_param(dmabuf_cache, uint, 0644);
+MODULE_PARM_DESC(dmabuf_cache,
+		 "Number of detached dmabufs kept mapped per partition (default: 8)");
+
 /**
  * struct aie_dmabuf - AI engine dmabuf information
  * @attach: dmabuf attachment pointer
@@ -330,28 +344,69 @@ static void aie_part_dmabuf_attach_get(struct aie_dmabuf *adbuf)
 	refcount_inc(&adbuf->refs);
 }
 
+/**
+ * aie_part_find_idle_dmabuf() - find a detached dmabuf which is still mapped
+ * @apart: AI engine partition
+ * @dmabuf: pointer to dmabuf
+ * @return: pointer to AI engine dmabuf struct of the found dmabuf, if dmabuf
+ *	    is not found, returns NULL.
+ */
+static struct aie_dmabuf *
+aie_part_find_idle_dmabuf(struct aie_partition *apart, struct dma_buf *dmabuf)
+{
+	struct aie_dmabuf *adbuf;
+
+	list_for_each_entry(adbuf, &apart->dbufs_idle, node) {
+		if (dmabuf == adbuf->attach->dmabuf)
+			return adbuf;
+	}
+
+	return NULL;
+}
+
+/**
+ * aie_part_free_dmabuf() - unmap and detach a dmabuf
+ * @apart: AI engine partition
+ * @adbuf: AI engine partition attached dmabuf
+ */
+static void aie_part_free_dmabuf(struct aie_partition *apart,
+				 struct aie_dmabuf *adbuf)
+{
+	struct dma_buf *dbuf = adbuf->attach->dmabuf;
+
+	dma_buf_unmap_attachment(adbuf->attach, adbuf->sgt, adbuf->attach->dir);
+	dma_buf_detach(dbuf, adbuf->attach);
+	dma_buf_put(dbuf);
+	list_del(&adbuf->node);
+	kmem_cache_free(apart->dbufs_cache, adbuf);
+}
+
 /**
  * aie_part_dmabuf_attach_put() - Put reference to an dmabuf attachment
  * @adbuf: AI engine partition attached dmabuf
  *
  * This call will decrease the reference count by 1. If the refcount reaches
- * 0, it will detach the dmabuf.
+ * 0, the dmabuf is moved to the idle dmabufs of the partition with its
+ * mapping, and the least recently used idle dmabuf is detached if there are
+ * more than dmabuf_cache of them.
  */
 static void aie_part_dmabuf_attach_put(struct aie_dmabuf *adbuf)
 {
-	struct dma_buf *dbuf;
 	struct aie_partition *apart;
 
 	if (!refcount_dec_and_test(&adbuf->refs))
 		return;
 
 	apart = dev_to_aiepart(adbuf->attach->dev);
-	dbuf = adbuf->attach->dmabuf;
-	dma_buf_unmap_attachment(adbuf->attach, adbuf->sgt, adbuf->attach->dir);
-	dma_buf_detach(dbuf, adbuf->attach);
-	dma_buf_put(dbuf);
-	list_del(&adbuf->node);
-	kmem_cache_free(apart->dbufs_cache, adbuf);
+	list_move(&adbuf->node, &apart->dbufs_idle);
+	apart->dbufs_idle_cnt++;
+
+	while (apart->dbufs_idle_cnt > READ_ONCE(dmabuf_cache)) {
+		adbuf = list_last_entry(&apart->dbufs_idle, struct aie_dmabuf,
+					node);
+		aie_part_free_dmabuf(apart, adbuf);
+		apart->dbufs_idle_cnt--;
+	}
 }
 
 /**
@@ -362,16 +417,38 @@ void aie_part_release_dmabufs(struct aie_partition *apart)
 {
 	struct aie_dmabuf *adbuf, *tmpadbuf;
 
-	list_for_each_entry_safe(adbuf, tmpadbuf, &apart->dbufs, node) {
-		struct dma_buf *dbuf = adbuf->attach->dmabuf;
+	list_for_each_entry_safe(adbuf, tmpadbuf, &apart->dbufs, node)
+		aie_part_free_dmabuf(apart, adbuf);
 
-		dma_buf_unmap_attachment(adbuf->attach, adbuf->sgt,
-					 adbuf->attach->dir);
-		dma_buf_detach(dbuf, adbuf->attach);
-		dma_buf_put(dbuf);
-		list_del(&adbuf->node);
-		kmem_cache_free(apart->dbufs_cache, adbuf);
-	}
+	list_for_each_entry_safe(adbuf, tmpadbuf, &apart->dbufs_idle, node)
+		aie_part_free_dmabuf(apart, adbuf);
+	apart->dbufs_idle_cnt = 0;
+}
+
+/**
+ * aie_part_show_dmabuf_cache() - exports AI engine partition dmabuf cache
+ *				  statistics
+ * @dev: AI engine partition device.
+ * @attr: sysfs device attribute.
+ * @buffer: export buffer.
+ * @return: length of string copied to buffer.
+ */
+ssize_t aie_part_show_dmabuf_cache(struct device *dev,
+				   struct device_attribute *attr, char *buffer)
+{
+	struct aie_partition *apart = dev_to_aiepart(dev);
+	ssize_t len;
+
+	if (mutex_lock_interruptible(&apart->mlock))
+		return 0;
+
+	len = scnprintf(buffer, PAGE_SIZE,
+			"hits: %llu\nmisses: %llu\nidle: %u\ncapacity: %u\n",
+			apart->dbufs_hits, apart->dbufs_misses,
+			apart->dbufs_idle_cnt, READ_ONCE(dmabuf_cache));
+	mutex_unlock(&apart->mlock);
+
+	return len;
 }
 
 /**
@@ -410,10 +487,27 @@ long aie_part_attach_dmabuf_req(struct aie_partition *apart,
 	}
 
 	adbuf = aie_part_find_dmabuf(apart, dbuf);
-	if (!adbuf)
-		adbuf = aie_part_attach_dmabuf(apart, dbuf);
-	else
+	if (adbuf) {
 		aie_part_dmabuf_attach_get(adbuf);
+		/* The attachment holds a reference already */
+		dma_buf_put(dbuf);
+		mutex_unlock(&apart->mlock);
+		return 0;
+	}
+
+	adbuf = aie_part_find_idle_dmabuf(apart, dbuf);
+	if (adbuf) {
+		apart->dbufs_idle_cnt--;
+		apart->dbufs_hits++;
+		list_move(&adbuf->node, &apart->dbufs);
+		refcount_set(&adbuf->refs, 1);
+		dma_buf_put(dbuf);
+		mutex_unlock(&apart->mlock);
+		return 0;
+	}
+
+	apart->dbufs_misses++;
+	adbuf = aie_part_attach_dmabuf(apart, dbuf);
 
 	mutex_unlock(&apart->mlock);
 
@@ -547,6 +641,9 @@ long aie_part_set_bd(struct aie_partition *apart, void __user *user_args)
 	mutex_unlock(&apart->mlock);
 	if (ret)
 		dev_err(&apart->dev, "failed to set to shim dma bd.\n");
+	else
+		trace_aie_dma_submit(&apart->dev, args.loc, args.bd_id, addr,
+				     buf_len);
 
 	kfree(bd);
 	return ret;
@@ -635,6 +732,9 @@ long aie_part_set_dmabuf_bd(struct aie_partition *apart,
 	mutex_unlock(&apart->mlock);
 	if (ret)
 		dev_err(&apart->dev, "failed to set to shim dma bd.\n");
+	else
+		trace_aie_dma_submit(&apart->dev, args.loc, args.bd_id, addr,
+				     len);
 
 	kfree(bd);
 	return ret;
@@ -18,6 +18,7 @@
 #include <linux/file.h>
 #include <linux/io.h>
 #include <linux/interrupt.h>
+#include <linux/kfifo.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
@@ -70,6 +71,9 @@ enum aie_tile_type {
 /* Macros relevant to interrupts */
 #define AIE_INTR_L2_CTRL_MASK_WIDTH	32U
 
+/* Number of error events a partition keeps for user space */
+#define AIE_PART_ERROR_FIFO_SIZE	256U
+
 /* Max number of modules per tile */
 #define AIE_MAX_MODS_PER_TILE		2U
 
@@ -254,6 +258,7 @@ struct aie_single_reg_field {
 
 struct aie_device;
 struct aie_partition;
+struct aie_pmu;
 
 /**
  * struct aie_part_mem - AI engine partition memory information structure
@@ -439,6 +444,25 @@ struct aie_event_attr {
 	u32 num_events;
 };
 
+/**
+ * struct aie_perf_attr - AI Engine performance counter attributes structure.
+ * @start: start event field of counter 0 from @ctrl_regoff.
+ * @stop: stop event field of counter 0 from @ctrl_regoff.
+ * @ctrl_regoff: base performance counter control register offset.
+ * @cnt_regoff: performance counter 0 register offset.
+ * @num_cnts: total number of performance counters.
+ *
+ * Two consecutive counters share a control register, the odd counter uses
+ * the upper 16 bits of it.
+ */
+struct aie_perf_attr {
+	struct aie_single_reg_field start;
+	struct aie_single_reg_field stop;
+	u32 ctrl_regoff;
+	u32 cnt_regoff;
+	u32 num_cnts;
+};
+
 /**
  * struct aie_l1_intr_ctrl_attr - AI engine level 1 interrupt controller
  *				  attributes structure.
@@ -730,6 +754,10 @@ struct aie_tile {
  * @memtile_events: memory tile event attribute
  * @mem_events: memory module event attribute
  * @core_events: core module event attribute
+ * @pl_perfs: pl module performance counter attribute
+ * @memtile_perfs: memory tile performance counter attribute
+ * @mem_perfs: memory module performance counter attribute
+ * @core_perfs: core module performance counter attribute
  * @mem_lock: mem lock attribute
  * @pl_lock: Shim tile lock attribute
  * @memtile_lock: Mem Tile lock attribute
@@ -778,6 +806,10 @@ struct aie_device {
 	const struct aie_event_attr *memtile_events;
 	const struct aie_event_attr *mem_events;
 	const struct aie_event_attr *core_events;
+	const struct aie_perf_attr *pl_perfs;
+	const struct aie_perf_attr *memtile_perfs;
+	const struct aie_perf_attr *mem_perfs;
+	const struct aie_perf_attr *core_perfs;
 	const struct aie_lock_attr *mem_lock;
 	const struct aie_lock_attr *memtile_lock;
 	const struct aie_lock_attr *pl_lock;
@@ -805,6 +837,32 @@ struct aie_device {
 	const struct aie_single_reg_field *core_sp;
 };
 
+/**
+ * struct aie_part_clean_stats - AI engine partition clean up statistics
+ * @count: number of partitions cleaned up
+ * @total_ns: duration of the last clean up
+ * @scan_ns: time spent scanning the tiles in use by the last clean up
+ * @reset_ns: time spent resetting the columns by the last clean up
+ * @mem_ns: time spent clearing the memories by the last clean up
+ * @regs_ns: time spent clearing the core registers by the last clean up
+ * @cols_reset: number of columns reset by the last clean up
+ * @cols: number of columns of the last partition cleaned up
+ * @tiles_cleared: number of tiles cleared by the last clean up
+ * @tiles: number of tiles of the last partition cleaned up
+ */
+struct aie_part_clean_stats {
+	u64 count;
+	u64 total_ns;
+	u64 scan_ns;
+	u64 reset_ns;
+	u64 mem_ns;
+	u64 regs_ns;
+	u32 cols_reset;
+	u32 cols;
+	u32 tiles_cleared;
+	u32 tiles;
+};
+
 /**
  * struct aie_aperture - AI engine aperture structure
  * @node: list node
@@ -823,6 +881,10 @@ struct aie_device {
  * @range: range of aperture
  * @backtrack: workqueue to backtrack interrupt
  * @l2_mask: level 2 interrupt controller mask bitmap
+ * @l2_status: level 2 interrupt controller status bitmap, the interrupts
+ *	       waiting to be backtracked
+ * @clean_stats: statistics of the partitions clean up, protected by the
+ *		 AI engine device lock
  * @attr_grp: attribute group for sysfs
  */
 struct aie_aperture {
@@ -840,6 +902,8 @@ struct aie_aperture {
 	struct aie_range range;
 	struct work_struct backtrack;
 	struct aie_resource l2_mask;
+	struct aie_resource l2_status;
+	struct aie_part_clean_stats clean_stats;
 	struct attribute_group *attr_grp;
 };
 
@@ -847,27 +911,38 @@ struct aie_aperture {
  * struct aie_partition - AI engine partition structure
  * @node: list node
  * @dbufs: dmabufs list
+ * @dbufs_idle: detached dmabufs which are still mapped, most recent first
  * @aperture: pointer to AI engine aperture
  * @adev: pointer to AI device instance
  * @filep: pointer to file for refcount on the users of the partition
  * @pmems: pointer to partition memories types
  * @dbufs_cache: memory management object for preallocated dmabuf descriptors
+ * @dbufs_hits: number of dmabuf attachments found in @dbufs_idle
+ * @dbufs_misses: number of dmabuf attachments which had to map the dmabuf
  * @trscs: resources bitmaps for each tile
  * @freq_req: required frequency
  * @range: range of partition
  * @mlock: protection for AI engine partition operations
+ * @uring_wq: ordered workqueue executing the io_uring commands
  * @dev: device for the AI engine partition
  * @atiles: pointer to an array of AIE tile structure.
  * @cores_clk_state: bitmap to indicate the power state of core modules
  * @tiles_inuse: bitmap to indicate if a tile is in use
+ * @tiles_dirty: bitmap to indicate if the clock of a tile has been enabled
+ *		 since the partition was last cleaned up
  * @error_cb: error callback
  * @core_event_status: core module event bitmap
  * @mem_event_status: memory module event bitmap
  * @pl_event_status: pl module event bitmap
+ * @error_fifo: error events found by backtracking, read by user space
+ * @error_wq: wait queue of the error events readers
  * @attr_grp: attribute group
+ * @pmu: perf PMU of the tiles performance counters
  * @partition_id: partition id. Partition ID is the identifier
  *		  of the AI engine partition in the system.
  * @status: indicate if the partition is in use
+ * @dbufs_idle_cnt: number of dmabufs in @dbufs_idle
+ * @errors_lost: number of error events dropped as @error_fifo was full
  * @cntrflag: partition control flag. e.g. whether to reset columns when
  *	      the partition is released
  * @error_to_report: indicates if there are errors pending to be reported to
@@ -878,26 +953,36 @@ struct aie_aperture {
 struct aie_partition {
 	struct list_head node;
 	struct list_head dbufs;
+	struct list_head dbufs_idle;
 	struct aie_aperture *aperture;
 	struct aie_device *adev;
 	struct file *filep;
 	struct aie_part_mem *pmems;
 	struct kmem_cache *dbufs_cache;
+	u64 dbufs_hits;
+	u64 dbufs_misses;
 	struct aie_tile_rscs trscs[AIE_TILE_TYPE_MAX];
 	u64 freq_req;
 	struct aie_range range;
 	struct mutex mlock; /* protection for AI engine partition operations */
+	struct workqueue_struct *uring_wq;
 	struct device dev;
 	struct aie_tile *atiles;
 	struct aie_resource cores_clk_state;
 	struct aie_resource tiles_inuse;
+	struct aie_resource tiles_dirty;
 	struct aie_error_cb error_cb;
 	struct aie_resource core_event_status;
 	struct aie_resource mem_event_status;
 	struct aie_resource pl_event_status;
+	DECLARE_KFIFO_PTR(error_fifo, struct aie_error_event);
+	wait_queue_head_t error_wq;
 	struct attribute_group *attr_grp;
+	struct aie_pmu *pmu;
 	u32 partition_id;
 	u32 status;
+	u32 dbufs_idle_cnt;
+	u32 errors_lost;
 	u32 cntrflag;
 	u8 error_to_report;
 };
@@ -1122,6 +1207,10 @@ int aie_part_prealloc_dbufs_cache(struct aie_partition *apart);
 int aie_part_scan_clk_state(struct aie_partition *apart);
 bool aie_part_check_clk_enable_loc(struct aie_partition *apart,
 				   struct aie_location *loc);
+void aie_part_mark_tiles_dirty(struct aie_partition *apart);
+bool aie_part_check_tile_dirty(struct aie_partition *apart,
+			       struct aie_location *loc);
+u32 aie_part_get_col_run(struct aie_partition *apart, u32 col, bool *dirty);
 int aie_part_set_freq(struct aie_partition *apart, u64 freq);
 int aie_part_get_freq(struct aie_partition *apart, u64 *freq);
 
@@ -1153,6 +1242,10 @@ irqreturn_t aie_interrupt(int irq, void *data);
 void aie_interrupt_callback(const u32 *payload, void *data);
 int aie_aperture_create_l2_bitmap(struct aie_aperture *aperture);
 bool aie_part_has_error(struct aie_partition *apart);
+long aie_part_get_error_events(struct aie_partition *apart,
+			       void __user *user_args);
+long aie_part_get_tile_status(struct aie_partition *apart,
+			      void __user *user_args);
 void aie_part_clear_cached_events(struct aie_partition *apart);
 int aie_part_set_intr_rscs(struct aie_partition *apart);
 
@@ -1191,6 +1284,28 @@ int aie_part_rscmgr_set_static(struct aie_partition *apart, void *meta);
 int aie_part_rscmgr_set_tile_broadcast(struct aie_partition *apart,
 				       struct aie_location loc,
 				       enum aie_module_type mod, uint32_t id);
+int aie_part_rscmgr_rsc_get_one(struct aie_partition *apart,
+				struct aie_location loc,
+				enum aie_module_type mod,
+				enum aie_rsc_type rtype);
+void aie_part_rscmgr_rsc_put_one(struct aie_partition *apart,
+				 struct aie_location loc,
+				 enum aie_module_type mod,
+				 enum aie_rsc_type rtype, u32 id);
+
+#if IS_ENABLED(CONFIG_PERF_EVENTS)
+int aie_part_pmu_register(struct aie_partition *apart);
+void aie_part_pmu_unregister(struct aie_partition *apart);
+#else
+static inline int aie_part_pmu_register(struct aie_partition *apart)
+{
+	return 0;
+}
+
+static inline void aie_part_pmu_unregister(struct aie_partition *apart)
+{
+}
+#endif
 
 int aie_aperture_sysfs_create_entries(struct aie_aperture *aperture);
 void aie_aperture_sysfs_remove_entries(struct aie_aperture *aperture);
@@ -1237,10 +1352,15 @@ ssize_t aie_tile_show_error(struct device *dev, struct device_attribute *attr,
 ssize_t aie_aperture_show_hardware_info(struct device *dev,
 					struct device_attribute *attr,
 					char *buffer);
+ssize_t aie_aperture_show_part_clean_stats(struct device *dev,
+					   struct device_attribute *attr,
+					   char *buffer);
 ssize_t aie_part_show_error_stat(struct device *dev,
 				 struct device_attribute *attr, char *buffer);
 ssize_t aie_part_show_current_freq(struct device *dev,
 				   struct device_attribute *attr, char *buffer);
+ssize_t aie_part_show_dmabuf_cache(struct device *dev,
+				   struct device_attribute *attr, char *buffer);
 ssize_t aie_part_read_cb_error(struct kobject *kobj, char *buffer,
 			       ssize_t size);
 ssize_t aie_tile_show_event(struct device *dev, struct device_attribute *attr,
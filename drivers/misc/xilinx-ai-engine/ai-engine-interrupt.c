@@ -9,6 +9,7 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/slab.h>
+#include <linux/uaccess.h>
 #include <linux/workqueue.h>
 
 #include "ai-engine-internal.h"
@@ -375,6 +376,94 @@ static void aie_aperture_disable_l2_ctrl(struct aie_aperture *aperture,
 	iowrite32(bit_map, aperture->base + regoff);
 }
 
+/**
+ * aie_aperture_set_l2_status() - record level 2 interrupt controller status
+ *				  to be backtracked.
+ * @aperture: AIE aperture pointer.
+ * @l2_bitmap_off: index of the level 2 interrupt controller in the aperture.
+ * @status: status value.
+ */
+static void aie_aperture_set_l2_status(struct aie_aperture *aperture,
+				       u32 l2_bitmap_off, unsigned long status)
+{
+	u32 n;
+
+	for_each_set_bit(n, &status, AIE_INTR_L2_CTRL_MASK_WIDTH)
+		aie_resource_set(&aperture->l2_status, l2_bitmap_off *
+				 AIE_INTR_L2_CTRL_MASK_WIDTH + n, 1);
+}
+
+/**
+ * aie_aperture_get_l2_status_pending() - get recorded level 2 interrupt
+ *					  controller status.
+ * @aperture: AIE aperture pointer.
+ * @l2_bitmap_off: index of the level 2 interrupt controller in the aperture.
+ * @return: status value recorded since the last backtracking.
+ */
+static unsigned long
+aie_aperture_get_l2_status_pending(struct aie_aperture *aperture,
+				   u32 l2_bitmap_off)
+{
+	unsigned long status = 0;
+	u32 n;
+
+	for (n = 0; n < AIE_INTR_L2_CTRL_MASK_WIDTH; n++) {
+		if (aie_resource_testbit(&aperture->l2_status, l2_bitmap_off *
+					 AIE_INTR_L2_CTRL_MASK_WIDTH + n))
+			status |= BIT(n);
+	}
+
+	return status;
+}
+
+/**
+ * aie_aperture_has_l2_status_pending() - check if any of a range of level 2
+ *					  interrupt controllers is waiting to
+ *					  be backtracked.
+ * @aperture: AIE aperture pointer.
+ * @l2_bitmap_off: index of the first level 2 interrupt controller.
+ * @num_nocs: number of level 2 interrupt controllers.
+ * @return: true if there are interrupts to backtrack, false otherwise.
+ */
+static bool aie_aperture_has_l2_status_pending(struct aie_aperture *aperture,
+					       u32 l2_bitmap_off, u32 num_nocs)
+{
+	int ret;
+
+	ret = aie_resource_check_region(&aperture->l2_status,
+					l2_bitmap_off *
+					AIE_INTR_L2_CTRL_MASK_WIDTH,
+					num_nocs * AIE_INTR_L2_CTRL_MASK_WIDTH);
+
+	return ret != (int)(l2_bitmap_off * AIE_INTR_L2_CTRL_MASK_WIDTH);
+}
+
+/**
+ * aie_part_push_error_event() - queue an error event for user space.
+ * @apart: AIE partition pointer.
+ * @loc: tile location.
+ * @module: module type.
+ * @event: error event ID.
+ *
+ * The event is dropped and accounted as lost if the ring is full.
+ */
+static void aie_part_push_error_event(struct aie_partition *apart,
+				      struct aie_location loc,
+				      enum aie_module_type module, u8 event)
+{
+	struct aie_error_event eevent = {
+		.loc = {
+			.col = loc.col - apart->range.start.col,
+			.row = loc.row - apart->range.start.row,
+		},
+		.mod = module,
+		.event = event,
+	};
+
+	if (!kfifo_put(&apart->error_fifo, eevent))
+		apart->errors_lost++;
+}
+
 /**
  * aie_part_set_event_bitmap() - set the status of event in local event
  *				 bitmap.
@@ -486,6 +575,7 @@ static bool aie_tile_backtrack(struct aie_partition *apart,
 			continue;
 		grenabled &= ~BIT(n);
 		aie_part_set_event_bitmap(apart, loc, module, eevent);
+		aie_part_push_error_event(apart, loc, module, eevent);
 		ret = true;
 
 		dev_err_ratelimited(&apart->adev->dev,
@@ -660,8 +750,21 @@ static void aie_l2_backtrack(struct aie_partition *apart)
 	struct aie_aperture *aperture = apart->aperture;
 	struct aie_location loc;
 	u32 n, ttype, l2_bitmap_offset = 0, num_nocs;
+	bool found = false;
 	int ret;
 
+	/*
+	 * Only the level 1 interrupt controllers flagged in the recorded
+	 * level 2 status are backtracked, the partitions with nothing
+	 * recorded are skipped without accessing the hardware.
+	 */
+	num_nocs = aie_range_get_num_nocs(&apart->range, aperture,
+					  &l2_bitmap_offset);
+	if (!num_nocs ||
+	    !aie_aperture_has_l2_status_pending(aperture, l2_bitmap_offset,
+						num_nocs))
+		return;
+
 	ret = mutex_lock_interruptible(&apart->mlock);
 	if (ret) {
 		dev_err_ratelimited(&apart->dev,
@@ -669,17 +772,10 @@ static void aie_l2_backtrack(struct aie_partition *apart)
 		return;
 	}
 
-	num_nocs = aie_range_get_num_nocs(&apart->range, aperture,
-					  &l2_bitmap_offset);
-	if (!num_nocs) {
-		mutex_unlock(&apart->mlock);
-		return;
-	}
-
 	for (loc.col = apart->range.start.col, loc.row = 0;
 	     loc.col < apart->range.start.col + apart->range.size.col;
 	     loc.col++) {
-		unsigned long l2_mask;
+		unsigned long l2_mask, l2_status;
 		u32 adjust_l2_bitmap_offset = l2_bitmap_offset * 32;
 
 		ttype = apart->adev->ops->get_tile_type(apart->adev, &loc);
@@ -698,26 +794,39 @@ static void aie_l2_backtrack(struct aie_partition *apart)
 					  (u32 *)&l2_mask, 64);
 		if (l2_bitmap_offset % 2)
 			l2_mask >>= 32;
-		for_each_set_bit(n, &l2_mask,
+		l2_mask &= GENMASK(AIE_INTR_L2_CTRL_MASK_WIDTH - 1, 0);
+		l2_status = aie_aperture_get_l2_status_pending(aperture,
+							       l2_bitmap_offset);
+		l2_status &= l2_mask;
+		for_each_set_bit(n, &l2_status,
 				 apart->adev->l2_ctrl->num_broadcasts) {
-			if (aie_l1_backtrack(apart, loc, n))
+			if (aie_l1_backtrack(apart, loc, n)) {
 				apart->error_to_report = 1;
+				found = true;
+			}
 		}
 
 		/*
-		 * clear the l2 mask, it will be set when there is interrupt
-		 * coming from the NOC.
+		 * clear the l2 mask and status, they will be set when there
+		 * is interrupt coming from the NOC.
 		 */
 		aie_resource_clear(&aperture->l2_mask,
 				   l2_bitmap_offset *
 				   AIE_INTR_L2_CTRL_MASK_WIDTH,
 				   AIE_INTR_L2_CTRL_MASK_WIDTH);
+		aie_resource_clear(&aperture->l2_status,
+				   l2_bitmap_offset *
+				   AIE_INTR_L2_CTRL_MASK_WIDTH,
+				   AIE_INTR_L2_CTRL_MASK_WIDTH);
 		l2_bitmap_offset++;
 		aie_aperture_enable_l2_ctrl(aperture, &loc, l2_mask);
 	}
 
 	mutex_unlock(&apart->mlock);
 
+	if (found)
+		wake_up_interruptible(&apart->error_wq);
+
 	/*
 	 * If error was asserted or there are errors pending to be reported to
 	 * the application, then invoke callback.
@@ -845,10 +954,17 @@ irqreturn_t aie_interrupt(int irq, void *data)
 		if (l2_status) {
 			aie_aperture_clear_l2_intr(aperture, &loc,
 						   l2_status);
+			aie_aperture_set_l2_status(aperture, l2_bitmap_offset,
+						   l2_status);
 			sched_work = true;
-		} else {
+		} else if (l2_mask) {
 			aie_aperture_enable_l2_ctrl(aperture, &loc,
 						    l2_mask);
+			/* Nothing to backtrack for this controller */
+			aie_resource_clear(&aperture->l2_mask,
+					   l2_bitmap_offset *
+					   AIE_INTR_L2_CTRL_MASK_WIDTH,
+					   AIE_INTR_L2_CTRL_MASK_WIDTH);
 		}
 		l2_bitmap_offset++;
 	}
@@ -889,6 +1005,7 @@ void aie_interrupt_callback(const u32 *payload, void *data)
 bool aie_part_has_error(struct aie_partition *apart)
 {
 	struct aie_aperture *aperture = apart->aperture;
+	bool pending;
 	int ret;
 	u32 l2_bitmap_off, num_nocs;
 
@@ -912,18 +1029,12 @@ bool aie_part_has_error(struct aie_partition *apart)
 		return false;
 	}
 
-	ret = aie_resource_check_region(&aperture->l2_mask,
-					l2_bitmap_off *
-					AIE_INTR_L2_CTRL_MASK_WIDTH,
-					num_nocs * AIE_INTR_L2_CTRL_MASK_WIDTH);
+	/* There is error from this partition if it is not backtracked yet */
+	pending = aie_aperture_has_l2_status_pending(aperture, l2_bitmap_off,
+						     num_nocs);
 	mutex_unlock(&aperture->mlock);
 
-	if (ret != ((int)l2_bitmap_off * AIE_INTR_L2_CTRL_MASK_WIDTH)) {
-		/* There is error from this partition */
-		return true;
-	}
-
-	return false;
+	return pending;
 }
 
 /**
@@ -943,6 +1054,13 @@ int aie_aperture_create_l2_bitmap(struct aie_aperture *aperture)
 
 	ret = aie_resource_initialize(&aperture->l2_mask, num_nocs *
 				      AIE_INTR_L2_CTRL_MASK_WIDTH);
+	if (ret)
+		return ret;
+
+	ret = aie_resource_initialize(&aperture->l2_status, num_nocs *
+				      AIE_INTR_L2_CTRL_MASK_WIDTH);
+	if (ret)
+		aie_resource_uninitialize(&aperture->l2_mask);
 
 	return ret;
 }
@@ -1170,6 +1288,56 @@ void aie_part_clear_cached_events(struct aie_partition *apart)
 	aie_resource_clear_all(&apart->core_event_status);
 	aie_resource_clear_all(&apart->mem_event_status);
 	aie_resource_clear_all(&apart->pl_event_status);
+	kfifo_reset(&apart->error_fifo);
+	apart->errors_lost = 0;
+}
+
+/**
+ * aie_part_get_error_events() - read the error events of a partition.
+ * @apart: AIE partition pointer
+ * @user_args: user space pointer to a struct aie_error_event_args
+ * @return: 0 for success, and negative value for failure
+ *
+ * This function consumes up to the requested number of error events from
+ * the partition error events ring.
+ */
+long aie_part_get_error_events(struct aie_partition *apart,
+			       void __user *user_args)
+{
+	struct aie_error_event_args args;
+	struct aie_error_event *events;
+	u32 num_events;
+	long ret;
+
+	if (copy_from_user(&args, user_args, sizeof(args)))
+		return -EFAULT;
+
+	num_events = min(args.num_events, AIE_PART_ERROR_FIFO_SIZE);
+	if (!num_events)
+		return -EINVAL;
+
+	events = kmalloc_array(num_events, sizeof(*events), GFP_KERNEL);
+	if (!events)
+		return -ENOMEM;
+
+	ret = mutex_lock_interruptible(&apart->mlock);
+	if (ret) {
+		kfree(events);
+		return ret;
+	}
+
+	args.num_events = kfifo_out(&apart->error_fifo, events, num_events);
+	args.lost = apart->errors_lost;
+	apart->errors_lost = 0;
+	mutex_unlock(&apart->mlock);
+
+	if (copy_to_user(u64_to_user_ptr(args.events), events,
+			 args.num_events * sizeof(*events)) ||
+	    copy_to_user(user_args, &args, sizeof(args)))
+		ret = -EFAULT;
+
+	kfree(events);
+	return ret;
 }
 
 /**
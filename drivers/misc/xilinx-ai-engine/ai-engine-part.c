@@ -11,7 +11,9 @@
 #include <linux/dma-mapping.h>
 #include <linux/dma-map-ops.h>
 #include <linux/fs.h>
+#include <linux/io_uring.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
 #include <linux/list.h>
 #include <linux/mm.h>
 #include <linux/mman.h>
@@ -19,9 +21,12 @@
 #include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
+#include <linux/poll.h>
+#include <linux/sched/mm.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/uio.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/xlnx-ai-engine.h>
 
 #include "ai-engine-internal.h"
@@ -688,6 +693,10 @@ static long aie_part_ioctl(struct file *fp, unsigned int cmd, unsigned long arg)
 		return aie_part_rscmgr_get_broadcast(apart, argp);
 	case AIE_RSC_GET_STAT_IOCTL:
 		return aie_part_rscmgr_get_statistics(apart, argp);
+	case AIE_GET_ERROR_EVENTS_IOCTL:
+		return aie_part_get_error_events(apart, argp);
+	case AIE_GET_TILE_STATUS_IOCTL:
+		return aie_part_get_tile_status(apart, argp);
 	default:
 		dev_err(&apart->dev, "Invalid/Unsupported ioctl command %u.\n",
 			cmd);
@@ -698,13 +707,146 @@ static long aie_part_ioctl(struct file *fp, unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+/**
+ * struct aie_part_uring_work - AI engine partition queued io_uring command
+ * @work: work to execute the command from the partition command queue
+ * @ioucmd: io_uring command
+ * @apart: AI engine partition
+ * @mm: memory of the submitter, which holds the command arguments
+ * @user_args: arguments of the command, as for the matching ioctl
+ */
+struct aie_part_uring_work {
+	struct work_struct work;
+	struct io_uring_cmd *ioucmd;
+	struct aie_partition *apart;
+	struct mm_struct *mm;
+	void __user *user_args;
+};
+
+static void aie_part_uring_cmd_complete(struct io_uring_cmd *ioucmd)
+{
+	long *ret = (long *)ioucmd->pdu;
+
+	io_uring_cmd_done(ioucmd, *ret, 0);
+}
+
+/**
+ * aie_part_uring_work() - execute a queued io_uring command
+ * @work: queued io_uring command work
+ *
+ * The command runs in the address space of its submitter, so that it uses
+ * the same user arguments as the matching ioctl. Its result is posted as
+ * the completion of the io_uring command.
+ */
+static void aie_part_uring_work(struct work_struct *work)
+{
+	struct aie_part_uring_work *uwork =
+		container_of(work, struct aie_part_uring_work, work);
+	struct io_uring_cmd *ioucmd = uwork->ioucmd;
+	struct aie_partition *apart = uwork->apart;
+	long *ret = (long *)ioucmd->pdu;
+
+	if (!mmget_not_zero(uwork->mm)) {
+		*ret = -ESRCH;
+		goto out;
+	}
+
+	kthread_use_mm(uwork->mm);
+	switch (ioucmd->cmd_op) {
+	case AIE_TRANSACTION_IOCTL:
+		*ret = aie_part_execute_transaction_from_user(apart,
+							      uwork->user_args);
+		break;
+	case AIE_SET_SHIMDMA_BD_IOCTL:
+		*ret = aie_part_set_bd(apart, uwork->user_args);
+		break;
+	case AIE_SET_SHIMDMA_DMABUF_BD_IOCTL:
+		*ret = aie_part_set_dmabuf_bd(apart, uwork->user_args);
+		break;
+	default:
+		/* AIE_SYNC_URING_CMD, all the commands before it are done */
+		*ret = 0;
+		break;
+	}
+	kthread_unuse_mm(uwork->mm);
+	mmput(uwork->mm);
+
+out:
+	mmdrop(uwork->mm);
+	kfree(uwork);
+	io_uring_cmd_complete_in_task(ioucmd, aie_part_uring_cmd_complete);
+}
+
+/**
+ * aie_part_uring_cmd() - queue an AI engine partition io_uring command
+ * @ioucmd: io_uring command
+ * @issue_flags: io_uring issue flags
+ * @return: -EIOCBQUEUED if the command is queued, negative value for failure
+ *
+ * Transactions, SHIM DMA buffer descriptor updates and sync points are
+ * executed in submission order on a queue of the partition, and complete
+ * asynchronously. This lets a single thread keep several partitions busy.
+ */
+static int aie_part_uring_cmd(struct io_uring_cmd *ioucmd,
+			      unsigned int issue_flags)
+{
+	struct aie_partition *apart = ioucmd->file->private_data;
+	const struct aie_uring_cmd *cmd = ioucmd->cmd;
+	struct aie_part_uring_work *uwork;
+
+	if (issue_flags & IO_URING_F_IOPOLL)
+		return -EOPNOTSUPP;
+
+	switch (ioucmd->cmd_op) {
+	case AIE_TRANSACTION_IOCTL:
+	case AIE_SET_SHIMDMA_BD_IOCTL:
+	case AIE_SET_SHIMDMA_DMABUF_BD_IOCTL:
+	case AIE_SYNC_URING_CMD:
+		break;
+	default:
+		return -ENOTTY;
+	}
+
+	if (READ_ONCE(cmd->reserved))
+		return -EINVAL;
+
+	uwork = kzalloc(sizeof(*uwork), GFP_KERNEL);
+	if (!uwork)
+		return -ENOMEM;
+
+	INIT_WORK(&uwork->work, aie_part_uring_work);
+	uwork->ioucmd = ioucmd;
+	uwork->apart = apart;
+	uwork->user_args = u64_to_user_ptr(READ_ONCE(cmd->args));
+	uwork->mm = current->mm;
+	mmgrab(uwork->mm);
+	queue_work(apart->uring_wq, &uwork->work);
+
+	return -EIOCBQUEUED;
+}
+
+static __poll_t aie_part_poll(struct file *filp, poll_table *wait)
+{
+	struct aie_partition *apart = filp->private_data;
+
+	poll_wait(filp, &apart->error_wq, wait);
+
+	/* Error events are pending until read with AIE_GET_ERROR_EVENTS_IOCTL */
+	if (!kfifo_is_empty(&apart->error_fifo))
+		return EPOLLPRI;
+
+	return 0;
+}
+
 const struct file_operations aie_part_fops = {
 	.owner		= THIS_MODULE,
 	.release	= aie_part_release,
 	.read_iter	= aie_part_read_iter,
 	.write_iter	= aie_part_write_iter,
 	.mmap		= aie_part_mmap,
+	.poll		= aie_part_poll,
 	.unlocked_ioctl	= aie_part_ioctl,
+	.uring_cmd	= aie_part_uring_cmd,
 };
 
 /**
@@ -782,13 +924,17 @@ static void aie_part_release_device(struct device *dev)
 	aie_resource_put_region(&aperture->cols_res, apart->range.start.col,
 				apart->range.size.col);
 	aie_part_release_event_bitmap(apart);
+	kfifo_free(&apart->error_fifo);
 	list_del(&apart->node);
 	mutex_unlock(&aperture->mlock);
 	aie_resource_uninitialize(&apart->cores_clk_state);
 	aie_resource_uninitialize(&apart->tiles_inuse);
+	aie_resource_uninitialize(&apart->tiles_dirty);
 	aie_part_rscmgr_finish(apart);
 	/* Check and set frequency requirement for aperture */
 	aie_part_set_freq(apart, 0);
+	if (apart->uring_wq)
+		destroy_workqueue(apart->uring_wq);
 }
 
 /**
@@ -912,7 +1058,9 @@ struct aie_partition *aie_create_partition(struct aie_aperture *aperture,
 	apart->adev = aperture->adev;
 	apart->partition_id = partition_id;
 	INIT_LIST_HEAD(&apart->dbufs);
+	INIT_LIST_HEAD(&apart->dbufs_idle);
 	mutex_init(&apart->mlock);
+	init_waitqueue_head(&apart->error_wq);
 	apart->range.start.col = aie_part_id_get_start_col(partition_id);
 	apart->range.size.col = aie_part_id_get_num_cols(partition_id);
 	apart->range.start.row = aperture->range.start.row;
@@ -934,6 +1082,13 @@ struct aie_partition *aie_create_partition(struct aie_aperture *aperture,
 		return ERR_PTR(ret);
 	}
 
+	/* io_uring commands of the partition are executed in order */
+	apart->uring_wq = alloc_ordered_workqueue("%s", 0, dev_name(dev));
+	if (!apart->uring_wq) {
+		put_device(dev);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	/* Set up the DMA mask */
 	set_dma_ops(dev, get_dma_ops(&aperture->dev));
 	ret = dma_coerce_mask_and_coherent(dev, dma_get_mask(&aperture->dev));
@@ -978,6 +1133,13 @@ struct aie_partition *aie_create_partition(struct aie_aperture *aperture,
 		return ERR_PTR(ret);
 	}
 
+	ret = kfifo_alloc(&apart->error_fifo, AIE_PART_ERROR_FIFO_SIZE,
+			  GFP_KERNEL);
+	if (ret) {
+		put_device(dev);
+		return ERR_PTR(ret);
+	}
+
 	ret = aie_part_rscmgr_init(apart);
 	if (ret < 0) {
 		dev_err(&apart->dev,
@@ -993,6 +1155,11 @@ struct aie_partition *aie_create_partition(struct aie_aperture *aperture,
 		return ERR_PTR(ret);
 	}
 
+	/* The application can still use the counters without the PMU */
+	ret = aie_part_pmu_register(apart);
+	if (ret)
+		dev_warn(&apart->dev, "Failed to register perf PMU: %d.\n", ret);
+
 	dev_dbg(dev, "created AIE partition device.\n");
 
 	return apart;
@@ -1026,6 +1193,7 @@ void aie_part_remove(struct aie_partition *apart)
 	     index++, atile++)
 		aie_tile_remove(atile);
 
+	aie_part_pmu_unregister(apart);
 	aie_part_sysfs_remove_entries(apart);
 
 	device_del(&apart->dev);
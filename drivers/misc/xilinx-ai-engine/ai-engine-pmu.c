@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Xilinx AI Engine driver perf PMU implementation
+ *
+ * Copyright (C) 2022 Xilinx, Inc.
+ *
+ * Each partition registers an uncore style PMU named after the partition
+ * device. An event selects a module of a tile of the partition and the
+ * hardware events starting and stopping one of its performance counters,
+ * e.g.:
+ *
+ *   perf stat -a -e aiepart_0_50/col=2,row=1,mod=1,event=24/ ...
+ *
+ * The counters are allocated from the partition resource manager so that
+ * they are not handed out to the application at the same time.
+ */
+
+#include "ai-engine-internal.h"
+#include <linux/bitfield.h>
+#include <linux/cpumask.h>
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/perf_event.h>
+
+#define AIE_PMU_EVENT_MASK	GENMASK_ULL(7, 0)
+#define AIE_PMU_STOP_MASK	GENMASK_ULL(15, 8)
+#define AIE_PMU_COL_MASK	GENMASK_ULL(7, 0)
+#define AIE_PMU_ROW_MASK	GENMASK_ULL(15, 8)
+#define AIE_PMU_MOD_MASK	GENMASK_ULL(17, 16)
+
+#define AIE_PMU_CNT_MAX		GENMASK_ULL(31, 0)
+/* The 32-bit counters wrap in a few seconds at the AI engine clock rate */
+#define AIE_PMU_POLL_MS		1000U
+
+/**
+ * struct aie_pmu - AI engine partition perf PMU
+ * @pmu: perf PMU
+ * @apart: AI engine partition
+ * @hrtimer: timer folding the counters into the events before they wrap
+ * @active: list of events counting on the hardware
+ * @cpu: CPU the events are bound to
+ */
+struct aie_pmu {
+	struct pmu pmu;
+	struct aie_partition *apart;
+	struct hrtimer hrtimer;
+	struct list_head active;
+	int cpu;
+};
+
+#define to_aie_pmu(p) container_of((p), struct aie_pmu, pmu)
+
+/**
+ * aie_pmu_event_attr() - decode the tile module of a perf event
+ * @apart: AI engine partition
+ * @event: perf event
+ * @loc: returns the absolute tile location
+ * @mod: returns the module type
+ * @return: performance counter attribute of the module for success, NULL if
+ *	    the module has no performance counter.
+ */
+static const struct aie_perf_attr *
+aie_pmu_event_attr(struct aie_partition *apart, struct perf_event *event,
+		   struct aie_location *loc, enum aie_module_type *mod)
+{
+	struct aie_device *adev = apart->adev;
+	u64 config1 = event->attr.config1;
+	struct aie_location rloc;
+	u32 ttype;
+
+	rloc.col = FIELD_GET(AIE_PMU_COL_MASK, config1);
+	rloc.row = FIELD_GET(AIE_PMU_ROW_MASK, config1);
+	if (aie_validate_location(apart, rloc) < 0)
+		return NULL;
+
+	loc->col = rloc.col + apart->range.start.col;
+	loc->row = rloc.row + apart->range.start.row;
+	*mod = FIELD_GET(AIE_PMU_MOD_MASK, config1);
+
+	ttype = adev->ops->get_tile_type(adev, loc);
+	switch (ttype) {
+	case AIE_TILE_TYPE_TILE:
+		if (*mod == AIE_CORE_MOD)
+			return adev->core_perfs;
+		if (*mod == AIE_MEM_MOD)
+			return adev->mem_perfs;
+		return NULL;
+	case AIE_TILE_TYPE_MEMORY:
+		return *mod == AIE_MEM_MOD ? adev->memtile_perfs : NULL;
+	case AIE_TILE_TYPE_SHIMPL:
+	case AIE_TILE_TYPE_SHIMNOC:
+		return *mod == AIE_PL_MOD ? adev->pl_perfs : NULL;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * aie_pmu_event_num_events() - get the number of hardware events of a module
+ * @adev: AI engine device
+ * @perf: performance counter attribute of the module
+ * @return: number of hardware events
+ */
+static u32 aie_pmu_event_num_events(struct aie_device *adev,
+				    const struct aie_perf_attr *perf)
+{
+	if (perf == adev->core_perfs)
+		return adev->core_events->num_events;
+	if (perf == adev->mem_perfs)
+		return adev->mem_events->num_events;
+	if (perf == adev->memtile_perfs)
+		return adev->memtile_events->num_events;
+	return adev->pl_events->num_events;
+}
+
+static void aie_pmu_event_update(struct perf_event *event)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+	struct aie_partition *apart = apmu->apart;
+	struct hw_perf_event *hwc = &event->hw;
+	enum aie_module_type mod;
+	struct aie_location loc;
+	u64 prev, now;
+
+	/* Gated tiles cannot be accessed, their counters do not run either */
+	if (!aie_pmu_event_attr(apart, event, &loc, &mod) ||
+	    !aie_part_check_clk_enable_loc(apart, &loc))
+		return;
+
+	do {
+		prev = local64_read(&hwc->prev_count);
+		now = ioread32(apart->aperture->base + hwc->event_base);
+	} while (local64_cmpxchg(&hwc->prev_count, prev, now) != prev);
+
+	local64_add((now - prev) & AIE_PMU_CNT_MAX, &event->count);
+}
+
+static enum hrtimer_restart aie_pmu_hrtimer(struct hrtimer *hrtimer)
+{
+	struct aie_pmu *apmu = container_of(hrtimer, struct aie_pmu, hrtimer);
+	struct perf_event *event;
+	unsigned long flags;
+
+	if (list_empty(&apmu->active))
+		return HRTIMER_NORESTART;
+
+	local_irq_save(flags);
+	list_for_each_entry(event, &apmu->active, active_entry)
+		aie_pmu_event_update(event);
+	local_irq_restore(flags);
+
+	hrtimer_forward_now(hrtimer, ms_to_ktime(AIE_PMU_POLL_MS));
+	return HRTIMER_RESTART;
+}
+
+static void aie_pmu_event_destroy(struct perf_event *event)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+	struct aie_partition *apart = apmu->apart;
+	enum aie_module_type mod;
+	struct aie_location loc;
+
+	mutex_lock(&apart->mlock);
+	if (aie_pmu_event_attr(apart, event, &loc, &mod))
+		aie_part_rscmgr_rsc_put_one(apart, loc, mod, AIE_RSCTYPE_PERF,
+					    event->hw.idx);
+	mutex_unlock(&apart->mlock);
+
+	put_device(&apart->dev);
+}
+
+static int aie_pmu_event_init(struct perf_event *event)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+	struct aie_partition *apart = apmu->apart;
+	struct hw_perf_event *hwc = &event->hw;
+	const struct aie_perf_attr *perf;
+	u32 start, stop, num_events;
+	enum aie_module_type mod;
+	struct aie_location loc;
+	int ret, id;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* The counters raise no interrupt, they can only be read */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	perf = aie_pmu_event_attr(apart, event, &loc, &mod);
+	if (!perf)
+		return -EINVAL;
+
+	start = FIELD_GET(AIE_PMU_EVENT_MASK, event->attr.config);
+	stop = FIELD_GET(AIE_PMU_STOP_MASK, event->attr.config);
+	/* Counting the occurrences of an event is the common case */
+	if (!stop)
+		stop = start;
+
+	num_events = aie_pmu_event_num_events(apart->adev, perf);
+	if (start >= num_events || stop >= num_events)
+		return -EINVAL;
+
+	ret = mutex_lock_interruptible(&apart->mlock);
+	if (ret)
+		return ret;
+
+	if (!aie_part_check_clk_enable_loc(apart, &loc)) {
+		dev_dbg(&apart->dev, "tile (%u,%u) is clock gated.\n",
+			loc.col, loc.row);
+		mutex_unlock(&apart->mlock);
+		return -ENODEV;
+	}
+
+	id = aie_part_rscmgr_rsc_get_one(apart, loc, mod, AIE_RSCTYPE_PERF);
+	mutex_unlock(&apart->mlock);
+	if (id < 0)
+		return id;
+
+	/* The counter is freed when the last reference to the event is put */
+	get_device(&apart->dev);
+	event->destroy = aie_pmu_event_destroy;
+	event->cpu = apmu->cpu;
+
+	hwc->idx = id;
+	hwc->config = (aie_get_field_val(&perf->start, start) |
+		       aie_get_field_val(&perf->stop, stop)) << (16 * (id % 2));
+	hwc->config_base = aie_aperture_cal_regoff(apart->aperture, loc,
+						   perf->ctrl_regoff +
+						   4 * (id / 2));
+	hwc->event_base = aie_aperture_cal_regoff(apart->aperture, loc,
+						  perf->cnt_regoff + 4 * id);
+
+	return 0;
+}
+
+static void aie_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+	struct aie_partition *apart = apmu->apart;
+	struct hw_perf_event *hwc = &event->hw;
+	void __iomem *ctrl = apart->aperture->base + hwc->config_base;
+	const struct aie_perf_attr *perf;
+	enum aie_module_type mod;
+	struct aie_location loc;
+	u32 mask, val;
+
+	hwc->state = 0;
+
+	perf = aie_pmu_event_attr(apart, event, &loc, &mod);
+	if (!perf || !aie_part_check_clk_enable_loc(apart, &loc))
+		return;
+
+	mask = (perf->start.mask | perf->stop.mask) << (16 * (hwc->idx % 2));
+	val = ioread32(ctrl);
+	iowrite32((val & ~mask) | hwc->config, ctrl);
+
+	local64_set(&hwc->prev_count,
+		    ioread32(apart->aperture->base + hwc->event_base));
+}
+
+static void aie_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+	struct aie_partition *apart = apmu->apart;
+	struct hw_perf_event *hwc = &event->hw;
+	const struct aie_perf_attr *perf;
+	enum aie_module_type mod;
+	struct aie_location loc;
+	u32 mask, val;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	aie_pmu_event_update(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	perf = aie_pmu_event_attr(apart, event, &loc, &mod);
+	if (!perf || !aie_part_check_clk_enable_loc(apart, &loc))
+		return;
+
+	/* Event 0 is the null event, it never starts the counter */
+	mask = (perf->start.mask | perf->stop.mask) << (16 * (hwc->idx % 2));
+	val = ioread32(apart->aperture->base + hwc->config_base);
+	iowrite32(val & ~mask, apart->aperture->base + hwc->config_base);
+}
+
+static int aie_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (list_empty(&apmu->active))
+		hrtimer_start(&apmu->hrtimer, ms_to_ktime(AIE_PMU_POLL_MS),
+			      HRTIMER_MODE_REL_PINNED);
+	list_add_tail(&event->active_entry, &apmu->active);
+
+	if (flags & PERF_EF_START)
+		aie_pmu_event_start(event, flags);
+
+	return 0;
+}
+
+static void aie_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct aie_pmu *apmu = to_aie_pmu(event->pmu);
+
+	aie_pmu_event_stop(event, PERF_EF_UPDATE);
+
+	list_del(&event->active_entry);
+	if (list_empty(&apmu->active))
+		hrtimer_cancel(&apmu->hrtimer);
+}
+
+static void aie_pmu_event_read(struct perf_event *event)
+{
+	aie_pmu_event_update(event);
+}
+
+static ssize_t aie_pmu_cpumask_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct aie_pmu *apmu = to_aie_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(apmu->cpu));
+}
+
+static struct device_attribute aie_pmu_cpumask_attr =
+	__ATTR(cpumask, 0444, aie_pmu_cpumask_show, NULL);
+
+static struct attribute *aie_pmu_cpumask_attrs[] = {
+	&aie_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group aie_pmu_cpumask_group = {
+	.attrs = aie_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-7");
+PMU_FORMAT_ATTR(stop, "config:8-15");
+PMU_FORMAT_ATTR(col, "config1:0-7");
+PMU_FORMAT_ATTR(row, "config1:8-15");
+PMU_FORMAT_ATTR(mod, "config1:16-17");
+
+static struct attribute *aie_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	&format_attr_stop.attr,
+	&format_attr_col.attr,
+	&format_attr_row.attr,
+	&format_attr_mod.attr,
+	NULL,
+};
+
+static const struct attribute_group aie_pmu_format_group = {
+	.name = "format",
+	.attrs = aie_pmu_format_attrs,
+};
+
+static const struct attribute_group *aie_pmu_attr_groups[] = {
+	&aie_pmu_cpumask_group,
+	&aie_pmu_format_group,
+	NULL,
+};
+
+/**
+ * aie_part_pmu_register() - register the perf PMU of an AI engine partition
+ * @apart: AI engine partition
+ * @return: 0 for success, negative value for failure
+ */
+int aie_part_pmu_register(struct aie_partition *apart)
+{
+	struct aie_pmu *apmu;
+	int ret;
+
+	if (!apart->adev->core_perfs)
+		return 0;
+
+	/* Like the partition, it is kept until the aperture goes away */
+	apmu = devm_kzalloc(&apart->aperture->dev, sizeof(*apmu), GFP_KERNEL);
+	if (!apmu)
+		return -ENOMEM;
+
+	apmu->apart = apart;
+	apmu->cpu = cpumask_first(cpu_online_mask);
+	INIT_LIST_HEAD(&apmu->active);
+	hrtimer_init(&apmu->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	apmu->hrtimer.function = aie_pmu_hrtimer;
+
+	apmu->pmu = (struct pmu) {
+		.module		= THIS_MODULE,
+		.task_ctx_nr	= perf_invalid_context,
+		.attr_groups	= aie_pmu_attr_groups,
+		.capabilities	= PERF_PMU_CAP_NO_EXCLUDE,
+		.event_init	= aie_pmu_event_init,
+		.add		= aie_pmu_event_add,
+		.del		= aie_pmu_event_del,
+		.start		= aie_pmu_event_start,
+		.stop		= aie_pmu_event_stop,
+		.read		= aie_pmu_event_read,
+	};
+
+	ret = perf_pmu_register(&apmu->pmu, dev_name(&apart->dev), -1);
+	if (ret)
+		return ret;
+
+	apart->pmu = apmu;
+	return 0;
+}
+
+/**
+ * aie_part_pmu_unregister() - unregister the perf PMU of an AI engine
+ *			       partition
+ * @apart: AI engine partition
+ */
+void aie_part_pmu_unregister(struct aie_partition *apart)
+{
+	if (!apart->pmu)
+		return;
+
+	perf_pmu_unregister(&apart->pmu->pmu);
+	apart->pmu = NULL;
+}
@@ -8,6 +8,7 @@
 #include <linux/bitfield.h>
 #include <linux/firmware/xlnx-zynqmp.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 
 #include "ai-engine-internal.h"
 
@@ -162,59 +163,123 @@ int aie_part_clear_context(struct aie_partition *apart)
 	return ret;
 }
 
+/**
+ * aie_part_reset_used_cols() - reset the columns of a partition in use
+ * @apart: AI engine partition
+ * @return: number of columns reset for success and negative value for failure
+ *
+ * The shims of all the columns are reset, but only the columns with tiles
+ * whose clock has been enabled since the partition was last cleaned up are
+ * reset. Each run of contiguous columns takes one firmware call.
+ */
+static int aie_part_reset_used_cols(struct aie_partition *apart)
+{
+	struct aie_range *range = &apart->range;
+	u32 node_id = apart->adev->pm_node_id;
+	u32 col, ncols, cols_reset = 0;
+	bool dirty;
+	int ret;
+
+	for (col = range->start.col; col < range->start.col + range->size.col;
+	     col += ncols) {
+		u32 ops = XILINX_AIE_OPS_SHIM_RST;
+
+		ncols = aie_part_get_col_run(apart, col, &dirty);
+		if (dirty) {
+			ops |= XILINX_AIE_OPS_COL_RST;
+			cols_reset += ncols;
+		}
+
+		ret = zynqmp_pm_aie_operation(node_id, col, ncols, ops);
+		if (ret < 0)
+			return ret;
+	}
+
+	return cols_reset;
+}
+
 /**
  * aie_part_clean() - reset and clear AI engine partition
  * @apart: AI engine partition
  * @return: 0 for success and negative value for failure
  *
  * This function will:
+ *  * scan the tiles which have been in use
  *  * gate all the columns
- *  * reset AI engine partition columns
+ *  * reset AI engine partition columns in use
  *  * reset AI engine shims
- *  * clear the memories
+ *  * clear the memories of the tiles in use
  *  * clear core registers
  *  * gate all the tiles in a partition
  *  * update clock state bitmap
  *
+ * The time spent in each step is recorded in the aperture statistics.
+ *
  * This function will not validate the partition, the caller will need to
  * provide a valid AI engine partition.
  */
 int aie_part_clean(struct aie_partition *apart)
 {
+	struct aie_part_clean_stats *stats = &apart->aperture->clean_stats;
 	u32 node_id = apart->adev->pm_node_id;
-	int ret;
+	u64 start, t0, t1;
+	int ret, cols_reset;
 
 	if (apart->cntrflag & XAIE_PART_NOT_RST_ON_RELEASE)
 		return 0;
 
-	ret = zynqmp_pm_aie_operation(node_id, apart->range.start.col,
-				      apart->range.size.col,
-				      XILINX_AIE_OPS_DIS_COL_CLK_BUFF);
+	/* The tiles could have been ungated without the driver, e.g. by CDO */
+	start = ktime_get_ns();
+	ret = aie_part_scan_clk_state(apart);
 	if (ret < 0)
 		return ret;
 
+	t0 = ktime_get_ns();
+	stats->scan_ns = t0 - start;
+
 	ret = zynqmp_pm_aie_operation(node_id, apart->range.start.col,
 				      apart->range.size.col,
-				      XILINX_AIE_OPS_COL_RST |
-				      XILINX_AIE_OPS_SHIM_RST);
+				      XILINX_AIE_OPS_DIS_COL_CLK_BUFF);
 	if (ret < 0)
 		return ret;
 
+	cols_reset = aie_part_reset_used_cols(apart);
+	if (cols_reset < 0)
+		return cols_reset;
+
 	ret = zynqmp_pm_aie_operation(node_id, apart->range.start.col,
 				      apart->range.size.col,
 				      XILINX_AIE_OPS_ENB_COL_CLK_BUFF);
 	if (ret < 0)
 		return ret;
 
+	t1 = ktime_get_ns();
+	stats->reset_ns = t1 - t0;
+
 	apart->adev->ops->mem_clear(apart);
+	t0 = ktime_get_ns();
+	stats->mem_ns = t0 - t1;
+
 	aie_part_clear_core_regs(apart);
+	t1 = ktime_get_ns();
+	stats->regs_ns = t1 - t0;
+
 	ret = zynqmp_pm_aie_operation(node_id, apart->range.start.col,
 				      apart->range.size.col,
 				      XILINX_AIE_OPS_DIS_COL_CLK_BUFF);
 	if (ret < 0)
 		return ret;
 
+	stats->count++;
+	stats->total_ns = ktime_get_ns() - start;
+	stats->cols_reset = cols_reset;
+	stats->cols = apart->range.size.col;
+	stats->tiles_cleared = bitmap_weight(apart->tiles_dirty.bitmap,
+					     apart->tiles_dirty.total);
+	stats->tiles = apart->tiles_dirty.total;
+
 	aie_resource_clear_all(&apart->cores_clk_state);
+	aie_resource_clear_all(&apart->tiles_dirty);
 
 	return 0;
 }
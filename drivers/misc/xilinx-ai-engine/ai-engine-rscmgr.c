@@ -820,6 +820,73 @@ long aie_part_rscmgr_rsc_req_specific(struct aie_partition *apart,
 	return 0;
 }
 
+/**
+ * aie_part_rscmgr_rsc_get_one() - allocate one resource of a module of a
+ *				   tile of an AI engine partition for the
+ *				   kernel
+ *
+ * @apart: AI engine partition
+ * @loc: absolute tile location
+ * @mod: module type
+ * @rtype: resource type
+ *
+ * @return: allocated resource id for success, negative value for failure
+ *
+ * The resource is marked in the runtime status bitmap, so that it is not
+ * handed out to the user application. Resources reserved in the static
+ * status bitmap are skipped. The caller must hold the partition lock.
+ */
+int aie_part_rscmgr_rsc_get_one(struct aie_partition *apart,
+				struct aie_location loc,
+				enum aie_module_type mod,
+				enum aie_rsc_type rtype)
+{
+	struct aie_rsc_stat *rstat;
+	int mod_num_rscs, start_bit, ret;
+	struct aie_rsc rsc;
+
+	rstat = aie_part_get_rsc_bitmaps(apart, loc, mod, rtype);
+	start_bit = aie_part_get_rsc_startbit(apart, loc, mod, rtype);
+	mod_num_rscs = aie_part_get_mod_num_rscs(apart, loc, mod, rtype);
+	if (!rstat || start_bit < 0 || !mod_num_rscs)
+		return -EINVAL;
+
+	ret = aie_resource_get_common_avail(&rstat->rbits, &rstat->sbits,
+					    start_bit, 1, mod_num_rscs, &rsc);
+	if (ret < 0)
+		return -EBUSY;
+
+	return rsc.id;
+}
+
+/**
+ * aie_part_rscmgr_rsc_put_one() - free a resource allocated with
+ *				   aie_part_rscmgr_rsc_get_one()
+ *
+ * @apart: AI engine partition
+ * @loc: absolute tile location
+ * @mod: module type
+ * @rtype: resource type
+ * @id: resource id
+ *
+ * The caller must hold the partition lock.
+ */
+void aie_part_rscmgr_rsc_put_one(struct aie_partition *apart,
+				 struct aie_location loc,
+				 enum aie_module_type mod,
+				 enum aie_rsc_type rtype, u32 id)
+{
+	struct aie_rsc_stat *rstat;
+	int start_bit;
+
+	rstat = aie_part_get_rsc_bitmaps(apart, loc, mod, rtype);
+	start_bit = aie_part_get_rsc_startbit(apart, loc, mod, rtype);
+	if (!rstat || start_bit < 0)
+		return;
+
+	aie_resource_clear(&rstat->rbits, start_bit + id, 1);
+}
+
 /**
  * aie_part_rscmgr_rsc_check_avail() - check how many resources vailable for
  *				       the specified resource type
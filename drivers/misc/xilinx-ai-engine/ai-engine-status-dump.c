@@ -4,6 +4,9 @@
  *
  * Copyright (C) 2023 AMD, Inc.
  */
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
 #include "ai-engine-internal.h"
 #include "linux/xlnx-ai-engine.h"
 
@@ -331,6 +334,135 @@ int aie_get_status_dump(struct device *dev, struct aie_col_status *status)
 }
 EXPORT_SYMBOL_GPL(aie_get_status_dump);
 
+/**
+ * aie_tile_read_status() - read the status of a tile to a snapshot entry
+ * @apart: AI engine partition
+ * @loc: location of AI engine tile
+ * @status: snapshot entry of the tile, zeroed
+ *
+ * The DMA and lock status are only read on the devices implementing their
+ * operations. The caller holds the partition lock.
+ */
+static void aie_tile_read_status(struct aie_partition *apart,
+				 struct aie_location *loc,
+				 struct aie_tile_status *status)
+{
+	const struct aie_tile_operations *ops = apart->adev->ops;
+	struct aie_device *adev = apart->adev;
+	const struct aie_dma_attr *dma;
+	u32 ttype, num_locks, i;
+
+	status->loc.col = loc->col - apart->range.start.col;
+	status->loc.row = loc->row - apart->range.start.row;
+
+	if (!aie_part_check_clk_enable_loc(apart, loc)) {
+		status->flags = AIE_TILE_STATUS_FL_GATED;
+		return;
+	}
+
+	ttype = ops->get_tile_type(adev, loc);
+	if (ttype == AIE_TILE_TYPE_TILE) {
+		status->flags = AIE_TILE_STATUS_FL_CORE;
+		status->core_status = ops->get_core_status(apart, loc);
+		status->pc = aie_get_core_pc(apart, loc);
+	}
+
+	if (ttype == AIE_TILE_TYPE_SHIMPL || !ops->get_dma_s2mm_status ||
+	    !ops->get_lock_status)
+		return;
+
+	if (ttype == AIE_TILE_TYPE_TILE) {
+		dma = adev->tile_dma;
+		num_locks = adev->mem_lock->num_locks;
+	} else if (ttype == AIE_TILE_TYPE_MEMORY) {
+		dma = adev->memtile_dma;
+		num_locks = adev->memtile_lock->num_locks;
+	} else {
+		dma = adev->shim_dma;
+		num_locks = adev->pl_lock->num_locks;
+	}
+
+	status->num_s2mm = min(dma->num_s2mm_chan, AIE_TILE_STATUS_MAX_DMA_CHAN);
+	status->num_mm2s = min(dma->num_mm2s_chan, AIE_TILE_STATUS_MAX_DMA_CHAN);
+	status->num_locks = min(num_locks, AIE_TILE_STATUS_MAX_LOCKS);
+
+	for (i = 0; i < status->num_s2mm; i++)
+		status->s2mm_sts[i] = ops->get_chan_status(apart, loc,
+				ops->get_dma_s2mm_status(apart, loc, i));
+	for (i = 0; i < status->num_mm2s; i++)
+		status->mm2s_sts[i] = ops->get_chan_status(apart, loc,
+				ops->get_dma_mm2s_status(apart, loc, i));
+	for (i = 0; i < status->num_locks; i++)
+		status->lock_value[i] = ops->get_lock_status(apart, loc, i);
+}
+
+/**
+ * aie_part_get_tile_status() - read the status of a range of tiles
+ * @apart: AI engine partition
+ * @user_args: user space pointer to a struct aie_tile_status_args
+ * @return: 0 for success, negative value for failure
+ *
+ * The tiles of the range are read in one pass with the partition locked,
+ * and the snapshot is copied to user space once the partition is unlocked.
+ */
+long aie_part_get_tile_status(struct aie_partition *apart,
+			      void __user *user_args)
+{
+	struct aie_tile_status_args args;
+	struct aie_tile_status *status;
+	struct aie_range *range = &args.range;
+	u32 c, r, n = 0, num_tiles;
+	long ret;
+
+	if (copy_from_user(&args, user_args, sizeof(args)))
+		return -EFAULT;
+
+	if (args.reserved || !range->size.col || !range->size.row ||
+	    range->start.col >= apart->range.size.col ||
+	    range->size.col > apart->range.size.col - range->start.col ||
+	    range->start.row >= apart->range.size.row ||
+	    range->size.row > apart->range.size.row - range->start.row)
+		return -EINVAL;
+
+	num_tiles = range->size.col * range->size.row;
+	if (args.num_tiles < num_tiles)
+		return -EINVAL;
+
+	status = kvcalloc(num_tiles, sizeof(*status), GFP_KERNEL);
+	if (!status)
+		return -ENOMEM;
+
+	ret = mutex_lock_interruptible(&apart->mlock);
+	if (ret) {
+		kvfree(status);
+		return ret;
+	}
+
+	for (c = 0; c < range->size.col; c++) {
+		for (r = 0; r < range->size.row; r++) {
+			struct aie_location loc = {
+				.col = apart->range.start.col +
+				       range->start.col + c,
+				.row = apart->range.start.row +
+				       range->start.row + r,
+			};
+
+			aie_tile_read_status(apart, &loc, &status[n++]);
+		}
+	}
+
+	mutex_unlock(&apart->mlock);
+
+	args.num_tiles = n;
+	if (copy_to_user(u64_to_user_ptr(args.status), status,
+			 n * sizeof(*status)) ||
+	    copy_to_user(user_args, &args, sizeof(args)))
+		ret = -EFAULT;
+
+	kvfree(status);
+	return ret;
+}
+
 /**
  * aie_get_tile_info() - exports AI engine tile information
  * @dev: AI engine tile device.
@@ -77,3 +77,45 @@ ssize_t aie_aperture_show_hardware_info(struct device *dev,
 	mutex_unlock(&aperture->mlock);
 	return len;
 }
+
+/**
+ * aie_aperture_show_part_clean_stats() - exports the statistics of the last
+ *					  partition clean up of the aperture
+ *
+ * @dev: AI engine device.
+ * @attr: sysfs device attribute.
+ * @buffer: export buffer.
+ * @return: length of string copied to buffer.
+ */
+ssize_t aie_aperture_show_part_clean_stats(struct device *dev,
+					   struct device_attribute *attr,
+					   char *buffer)
+{
+	struct aie_aperture *aperture = dev_to_aieaperture(dev);
+	struct aie_part_clean_stats *stats = &aperture->clean_stats;
+	ssize_t len = 0, size = PAGE_SIZE;
+
+	if (mutex_lock_interruptible(&aperture->adev->mlock))
+		return 0;
+
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "count: %llu\n", stats->count);
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "total_us: %llu\n", div_u64(stats->total_ns, 1000));
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "scan_us: %llu\n", div_u64(stats->scan_ns, 1000));
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "reset_us: %llu\n", div_u64(stats->reset_ns, 1000));
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "mem_clear_us: %llu\n", div_u64(stats->mem_ns, 1000));
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "core_regs_us: %llu\n", div_u64(stats->regs_ns, 1000));
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "cols_reset: %u/%u\n", stats->cols_reset, stats->cols);
+	len += scnprintf(&buffer[len], max(0L, size - len),
+			 "tiles_cleared: %u/%u\n", stats->tiles_cleared,
+			 stats->tiles);
+
+	mutex_unlock(&aperture->adev->mlock);
+	return len;
+}
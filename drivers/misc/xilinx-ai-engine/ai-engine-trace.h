@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for Xilinx AI engine driver.
+ *
+ * Copyright (c) 2022 Advanced Micro Devices, Inc.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM aie
+
+#if !defined(_AI_ENGINE_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _AI_ENGINE_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+#include <uapi/linux/xlnx-ai-engine.h>
+
+/*
+ * The SHIM DMA runs the buffer descriptors once the application enqueues
+ * them, its completion is only seen by the application through the locks,
+ * so the driver can only trace the buffer descriptors handed to it.
+ */
+TRACE_EVENT(aie_dma_submit,
+
+	TP_PROTO(struct device *dev, struct aie_location loc, u32 bd_id,
+		 dma_addr_t addr, u32 bytes),
+
+	TP_ARGS(dev, loc, bd_id, addr, bytes),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(u32, col)
+		__field(u32, row)
+		__field(u32, bd_id)
+		__field(u64, addr)
+		__field(u32, bytes)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->col = loc.col;
+		__entry->row = loc.row;
+		__entry->bd_id = bd_id;
+		__entry->addr = addr;
+		__entry->bytes = bytes;
+	),
+
+	TP_printk("part=%s col=%u row=%u bd=%u addr=0x%llx bytes=%u",
+		  __get_str(name), __entry->col, __entry->row, __entry->bd_id,
+		  __entry->addr, __entry->bytes)
+);
+
+#endif /* _AI_ENGINE_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ai-engine-trace
+
+#include <trace/define_trace.h>
@@ -20,7 +20,10 @@
 #include <linux/slab.h>
 #include <linux/clk.h>
 #include <linux/compat.h>
+#include <linux/firmware.h>
 #include <linux/highmem.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
 
 #include <uapi/misc/xilinx_sdfec.h>
 
@@ -164,6 +167,96 @@ static DEFINE_IDA(dev_nrs);
 /* The maximum number of pinned pages */
 #define MAX_NUM_PAGES ((XSDFEC_QC_TABLE_DEPTH / PAGE_SIZE) + 1)
 
+/* LDPC code table firmware, "SDFC" */
+#define XSDFEC_CODE_TABLE_MAGIC (0x43464453)
+#define XSDFEC_CODE_TABLE_VERSION (1)
+
+/**
+ * struct xsdfec_code_table_hdr - Header of an LDPC code table firmware
+ * @magic: XSDFEC_CODE_TABLE_MAGIC
+ * @version: XSDFEC_CODE_TABLE_VERSION
+ * @num_codes: Number of codes following the header
+ * @reserved: Must be zero
+ *
+ * All the fields of the firmware are little endian. Each code is a
+ * struct xsdfec_code_table_entry followed by its SC table, nlayers / 4
+ * rounded up words, its LA table, nlayers words, and its QC table, nqc words.
+ */
+struct xsdfec_code_table_hdr {
+	__le32 magic;
+	__le32 version;
+	__le32 num_codes;
+	__le32 reserved;
+};
+
+/**
+ * struct xsdfec_code_table_entry - Parameters of a code in the firmware
+ * @code_id: LDPC code ID
+ * @n: Number of code word bits
+ * @k: Number of information bits
+ * @psize: Size of sub-matrix
+ * @nlayers: Number of layers in code
+ * @nqc: Quasi Cyclic Number
+ * @nmqc: Number of M-sized QC operations in parity check matrix
+ * @nm: Number of M-size vectors in N
+ * @norm_type: Normalization required or not
+ * @no_packing: Determines if multiple QC ops should be performed
+ * @special_qc: Sub-Matrix property for Circulant weight > 0
+ * @no_final_parity: Decide if final parity check needs to be performed
+ * @max_schedule: Experimental code word scheduling limit
+ * @sc_off: SC offset
+ * @la_off: LA offset
+ * @qc_off: QC offset
+ */
+struct xsdfec_code_table_entry {
+	__le32 code_id;
+	__le32 n;
+	__le32 k;
+	__le32 psize;
+	__le32 nlayers;
+	__le32 nqc;
+	__le32 nmqc;
+	__le32 nm;
+	__le32 norm_type;
+	__le32 no_packing;
+	__le32 special_qc;
+	__le32 no_final_parity;
+	__le32 max_schedule;
+	__le32 sc_off;
+	__le32 la_off;
+	__le32 qc_off;
+};
+
+/**
+ * struct xsdfec_load_stats - Statistics of the LDPC code programming
+ * @count: Number of code tables loaded
+ * @codes: Number of codes of the last code table
+ * @bytes: Number of table bytes written by the last code table
+ * @last_ns: Duration of the last code table load
+ * @total_ns: Duration of all the code table loads
+ */
+struct xsdfec_load_stats {
+	u64 count;
+	u32 codes;
+	u32 bytes;
+	u64 last_ns;
+	u64 total_ns;
+};
+
+/**
+ * struct xsdfec_stats_snap - Counters at the start of a statistics interval
+ * @time: Start of the interval
+ * @isr_err_count: Count of ISR errors
+ * @cecc_count: Count of Correctable ECC errors (SBE)
+ * @uecc_count: Count of Uncorrectable ECC errors (MBE)
+ */
+struct xsdfec_stats_snap {
+	ktime_t time;
+	u32 isr_err_count;
+	u32 cecc_count;
+	u32 uecc_count;
+};
+
 /**
  * struct xsdfec_clks - For managing SD-FEC clocks
  * @core_clk: Main processing clock for core
@@ -206,6 +299,10 @@ struct xsdfec_clks {
  * @state_updated: indicates State updated by interrupt handler
  * @stats_updated: indicates Stats updated by interrupt handler
  * @intr_enabled: indicates IRQ enabled
+ * @code_lock: Serializes the LDPC code programming
+ * @load_stats: Statistics of the LDPC code table loads, guarded by @code_lock
+ * @snap: Counters at the start of the statistics interval, guarded by
+ *	  @error_data_lock
  *
  * This structure contains necessary state for SDFEC driver to operate
  */
@@ -229,6 +326,10 @@ struct xsdfec_dev {
 	bool state_updated;
 	bool stats_updated;
 	bool intr_enabled;
+	/* Mutex to serialize the LDPC code programming */
+	struct mutex code_lock;
+	struct xsdfec_load_stats load_stats;
+	struct xsdfec_stats_snap snap;
 };
 
 static inline void xsdfec_regwrite(struct xsdfec_dev *xsdfec, u32 addr,
@@ -597,16 +698,9 @@ static int xsdfec_reg3_write(struct xsdfec_dev *xsdfec, u8 sc_off, u8 la_off,
 	return 0;
 }
 
-static int xsdfec_table_write(struct xsdfec_dev *xsdfec, u32 offset,
-			      u32 *src_ptr, u32 len, const u32 base_addr,
+static int xsdfec_table_check(struct xsdfec_dev *xsdfec, u32 offset, u32 len,
 			      const u32 depth)
 {
-	u32 reg = 0;
-	int res, i, nr_pages;
-	u32 n;
-	u32 *addr = NULL;
-	struct page *pages[MAX_NUM_PAGES];
-
 	/*
 	 * Writes that go beyond the length of
 	 * Shared Scale(SC) table should fail
@@ -618,6 +712,23 @@ static int xsdfec_table_write(struct xsdfec_dev *xsdfec, u32 offset,
 		return -EINVAL;
 	}
 
+	return 0;
+}
+
+static int xsdfec_table_write(struct xsdfec_dev *xsdfec, u32 offset,
+			      u32 *src_ptr, u32 len, const u32 base_addr,
+			      const u32 depth)
+{
+	u32 reg = 0;
+	int res, i, nr_pages;
+	u32 n;
+	u32 *addr = NULL;
+	struct page *pages[MAX_NUM_PAGES];
+
+	res = xsdfec_table_check(xsdfec, offset, len, depth);
+	if (res)
+		return res;
+
 	n = (len * XSDFEC_REG_WIDTH_JUMP) / PAGE_SIZE;
 	if ((len * XSDFEC_REG_WIDTH_JUMP) % PAGE_SIZE)
 		n += 1;
@@ -651,30 +762,38 @@ static int xsdfec_table_write(struct xsdfec_dev *xsdfec, u32 offset,
 	return 0;
 }
 
-static int xsdfec_add_ldpc(struct xsdfec_dev *xsdfec, void __user *arg)
+static void xsdfec_table_write_words(struct xsdfec_dev *xsdfec, u32 offset,
+				     const __le32 *src, u32 len,
+				     const u32 base_addr)
 {
-	struct xsdfec_ldpc_params *ldpc;
-	int ret, n;
+	u32 reg;
 
-	ldpc = memdup_user(arg, sizeof(*ldpc));
-	if (IS_ERR(ldpc))
-		return PTR_ERR(ldpc);
+	for (reg = 0; reg < len; reg++)
+		xsdfec_regwrite(xsdfec,
+				base_addr + ((offset + reg) *
+					     XSDFEC_REG_WIDTH_JUMP),
+				le32_to_cpu(src[reg]));
+}
 
-	if (xsdfec->config.code == XSDFEC_TURBO_CODE) {
-		ret = -EIO;
-		goto err_out;
-	}
+static int xsdfec_ldpc_writable(struct xsdfec_dev *xsdfec)
+{
+	if (xsdfec->config.code == XSDFEC_TURBO_CODE)
+		return -EIO;
 
 	/* Verify Device has not started */
-	if (xsdfec->state == XSDFEC_STARTED) {
-		ret = -EIO;
-		goto err_out;
-	}
+	if (xsdfec->state == XSDFEC_STARTED)
+		return -EIO;
 
-	if (xsdfec->config.code_wr_protect) {
-		ret = -EIO;
-		goto err_out;
-	}
+	if (xsdfec->config.code_wr_protect)
+		return -EIO;
+
+	return 0;
+}
+
+static int xsdfec_ldpc_regs_write(struct xsdfec_dev *xsdfec,
+				  struct xsdfec_ldpc_params *ldpc)
+{
+	int ret;
 
 	/* Write Reg 0 */
 	ret = xsdfec_reg0_write(xsdfec, ldpc->n, ldpc->k, ldpc->psize,
@@ -697,8 +816,25 @@ static int xsdfec_add_ldpc(struct xsdfec_dev *xsdfec, void __user *arg)
 		goto err_out;
 
 	/* Write Reg 3 */
-	ret = xsdfec_reg3_write(xsdfec, ldpc->sc_off, ldpc->la_off,
-				ldpc->qc_off, ldpc->code_id);
+	return xsdfec_reg3_write(xsdfec, ldpc->sc_off, ldpc->la_off,
+				 ldpc->qc_off, ldpc->code_id);
+}
+
+static int xsdfec_add_ldpc(struct xsdfec_dev *xsdfec, void __user *arg)
+{
+	struct xsdfec_ldpc_params *ldpc;
+	int ret, n;
+
+	ldpc = memdup_user(arg, sizeof(*ldpc));
+	if (IS_ERR(ldpc))
+		return PTR_ERR(ldpc);
+
+	mutex_lock(&xsdfec->code_lock);
+	ret = xsdfec_ldpc_writable(xsdfec);
+	if (ret)
+		goto err_out;
+
+	ret = xsdfec_ldpc_regs_write(xsdfec, ldpc);
 	if (ret)
 		goto err_out;
 
@@ -723,10 +859,163 @@ static int xsdfec_add_ldpc(struct xsdfec_dev *xsdfec, void __user *arg)
 				 ldpc->nqc, XSDFEC_LDPC_QC_TABLE_ADDR_BASE,
 				 XSDFEC_QC_TABLE_DEPTH);
 err_out:
+	mutex_unlock(&xsdfec->code_lock);
 	kfree(ldpc);
 	return ret;
 }
 
+static void xsdfec_entry_to_params(const struct xsdfec_code_table_entry *e,
+				   struct xsdfec_ldpc_params *ldpc)
+{
+	memset(ldpc, 0, sizeof(*ldpc));
+	ldpc->code_id = le32_to_cpu(e->code_id);
+	ldpc->n = le32_to_cpu(e->n);
+	ldpc->k = le32_to_cpu(e->k);
+	ldpc->psize = le32_to_cpu(e->psize);
+	ldpc->nlayers = le32_to_cpu(e->nlayers);
+	ldpc->nqc = le32_to_cpu(e->nqc);
+	ldpc->nmqc = le32_to_cpu(e->nmqc);
+	ldpc->nm = le32_to_cpu(e->nm);
+	ldpc->norm_type = le32_to_cpu(e->norm_type);
+	ldpc->no_packing = le32_to_cpu(e->no_packing);
+	ldpc->special_qc = le32_to_cpu(e->special_qc);
+	ldpc->no_final_parity = le32_to_cpu(e->no_final_parity);
+	ldpc->max_schedule = le32_to_cpu(e->max_schedule);
+	ldpc->sc_off = le32_to_cpu(e->sc_off);
+	ldpc->la_off = le32_to_cpu(e->la_off);
+	ldpc->qc_off = le32_to_cpu(e->qc_off);
+}
+
+/*
+ * Walk the codes of a code table firmware. The whole firmware is validated
+ * with program false before any code is programmed with program true.
+ */
+static int xsdfec_code_table_walk(struct xsdfec_dev *xsdfec,
+				  const struct firmware *fw, bool program,
+				  u32 *bytes)
+{
+	const struct xsdfec_code_table_hdr *hdr = (const void *)fw->data;
+	const struct xsdfec_code_table_entry *e;
+	struct xsdfec_ldpc_params ldpc;
+	size_t pos = sizeof(*hdr);
+	const __le32 *sc, *la, *qc;
+	u32 i, num_codes, nsc;
+	int ret;
+
+	num_codes = le32_to_cpu(hdr->num_codes);
+	*bytes = 0;
+	for (i = 0; i < num_codes; i++) {
+		if (fw->size - pos < sizeof(*e))
+			return -EINVAL;
+		e = (const void *)(fw->data + pos);
+		pos += sizeof(*e);
+		xsdfec_entry_to_params(e, &ldpc);
+
+		nsc = DIV_ROUND_UP(ldpc.nlayers, 4);
+		if (ldpc.nlayers > XSDFEC_LA_TABLE_DEPTH ||
+		    ldpc.nqc > XSDFEC_QC_TABLE_DEPTH ||
+		    (fw->size - pos) / XSDFEC_REG_WIDTH_JUMP <
+		    nsc + ldpc.nlayers + ldpc.nqc) {
+			dev_dbg(xsdfec->dev, "Code %u tables are truncated",
+				ldpc.code_id);
+			return -EINVAL;
+		}
+		sc = (const __le32 *)(fw->data + pos);
+		la = sc + nsc;
+		qc = la + ldpc.nlayers;
+		pos += (nsc + ldpc.nlayers + ldpc.nqc) * XSDFEC_REG_WIDTH_JUMP;
+
+		if (!program) {
+			if (xsdfec_table_check(xsdfec, ldpc.sc_off, nsc,
+					       XSDFEC_SC_TABLE_DEPTH) ||
+			    xsdfec_table_check(xsdfec, 4 * ldpc.la_off,
+					       ldpc.nlayers,
+					       XSDFEC_LA_TABLE_DEPTH) ||
+			    xsdfec_table_check(xsdfec, 4 * ldpc.qc_off,
+					       ldpc.nqc, XSDFEC_QC_TABLE_DEPTH))
+				return -EINVAL;
+			continue;
+		}
+
+		ret = xsdfec_ldpc_regs_write(xsdfec, &ldpc);
+		if (ret)
+			return ret;
+
+		xsdfec_table_write_words(xsdfec, ldpc.sc_off, sc, nsc,
+					 XSDFEC_LDPC_SC_TABLE_ADDR_BASE);
+		xsdfec_table_write_words(xsdfec, 4 * ldpc.la_off, la,
+					 ldpc.nlayers,
+					 XSDFEC_LDPC_LA_TABLE_ADDR_BASE);
+		xsdfec_table_write_words(xsdfec, 4 * ldpc.qc_off, qc, ldpc.nqc,
+					 XSDFEC_LDPC_QC_TABLE_ADDR_BASE);
+		*bytes += (nsc + ldpc.nlayers + ldpc.nqc) *
+			  XSDFEC_REG_WIDTH_JUMP;
+	}
+
+	return 0;
+}
+
+/**
+ * xsdfec_load_code_table - Program the LDPC codes of a code table firmware
+ * @xsdfec: SD-FEC device
+ * @name: Firmware name
+ *
+ * The firmware is validated as a whole before its codes are programmed
+ * in a single pass, from one copy in kernel memory.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+static int xsdfec_load_code_table(struct xsdfec_dev *xsdfec, const char *name)
+{
+	const struct xsdfec_code_table_hdr *hdr;
+	const struct firmware *fw;
+	u64 start, elapsed;
+	u32 bytes;
+	int ret;
+
+	ret = request_firmware(&fw, name, xsdfec->dev);
+	if (ret)
+		return ret;
+
+	hdr = (const void *)fw->data;
+	if (fw->size < sizeof(*hdr) ||
+	    le32_to_cpu(hdr->magic) != XSDFEC_CODE_TABLE_MAGIC ||
+	    le32_to_cpu(hdr->version) != XSDFEC_CODE_TABLE_VERSION) {
+		dev_err(xsdfec->dev, "%s is not an LDPC code table", name);
+		ret = -EINVAL;
+		goto out_release;
+	}
+
+	mutex_lock(&xsdfec->code_lock);
+	ret = xsdfec_ldpc_writable(xsdfec);
+	if (ret)
+		goto out_unlock;
+
+	ret = xsdfec_code_table_walk(xsdfec, fw, false, &bytes);
+	if (ret) {
+		dev_err(xsdfec->dev, "%s has an invalid code", name);
+		goto out_unlock;
+	}
+
+	start = ktime_get_ns();
+	ret = xsdfec_code_table_walk(xsdfec, fw, true, &bytes);
+	elapsed = ktime_get_ns() - start;
+	if (ret)
+		goto out_unlock;
+
+	xsdfec->load_stats.count++;
+	xsdfec->load_stats.codes = le32_to_cpu(hdr->num_codes);
+	xsdfec->load_stats.bytes = bytes;
+	xsdfec->load_stats.last_ns = elapsed;
+	xsdfec->load_stats.total_ns += elapsed;
+
+out_unlock:
+	mutex_unlock(&xsdfec->code_lock);
+out_release:
+	release_firmware(fw);
+	return ret;
+}
+
 static int xsdfec_set_order(struct xsdfec_dev *xsdfec, void __user *arg)
 {
 	bool order_invalid;
@@ -907,6 +1196,8 @@ static int xsdfec_clear_stats(struct xsdfec_dev *xsdfec)
 	xsdfec->isr_err_count = 0;
 	xsdfec->uecc_count = 0;
 	xsdfec->cecc_count = 0;
+	memset(&xsdfec->snap, 0, sizeof(xsdfec->snap));
+	xsdfec->snap.time = ktime_get();
 	spin_unlock_irqrestore(&xsdfec->error_data_lock, xsdfec->flags);
 
 	return 0;
@@ -1028,6 +1319,90 @@ static __poll_t xsdfec_poll(struct file *file, poll_table *wait)
 	return mask;
 }
 
+static inline struct xsdfec_dev *dev_to_xsdfec(struct device *dev)
+{
+	struct miscdevice *miscdev = dev_get_drvdata(dev);
+
+	return container_of(miscdev, struct xsdfec_dev, miscdev);
+}
+
+static ssize_t ldpc_code_table_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct xsdfec_dev *xsdfec = dev_to_xsdfec(dev);
+	char *name;
+	int ret;
+
+	name = kstrndup(buf, count, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+
+	ret = xsdfec_load_code_table(xsdfec, strim(name));
+	kfree(name);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_WO(ldpc_code_table);
+
+/*
+ * The error counts are reported for the interval since the previous read,
+ * or since the statistics were cleared.
+ */
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct xsdfec_dev *xsdfec = dev_to_xsdfec(dev);
+	struct xsdfec_load_stats load;
+	struct xsdfec_stats_snap prev, cur;
+	unsigned long flags;
+	u64 kbps = 0;
+
+	spin_lock_irqsave(&xsdfec->error_data_lock, flags);
+	prev = xsdfec->snap;
+	cur.time = ktime_get();
+	cur.isr_err_count = xsdfec->isr_err_count;
+	cur.cecc_count = xsdfec->cecc_count;
+	cur.uecc_count = xsdfec->uecc_count;
+	xsdfec->snap = cur;
+	spin_unlock_irqrestore(&xsdfec->error_data_lock, flags);
+
+	mutex_lock(&xsdfec->code_lock);
+	load = xsdfec->load_stats;
+	mutex_unlock(&xsdfec->code_lock);
+
+	if (load.last_ns)
+		kbps = div64_u64((u64)load.bytes * NSEC_PER_SEC,
+				 load.last_ns * 1024);
+
+	return sysfs_emit(buf,
+			  "interval_ms: %lld\n"
+			  "isr_err_count: %u\n"
+			  "cecc_count: %u\n"
+			  "uecc_count: %u\n"
+			  "code_table_loads: %llu\n"
+			  "last_load_codes: %u\n"
+			  "last_load_bytes: %u\n"
+			  "last_load_us: %llu\n"
+			  "last_load_kBps: %llu\n"
+			  "total_load_us: %llu\n",
+			  ktime_ms_delta(cur.time, prev.time),
+			  cur.isr_err_count - prev.isr_err_count,
+			  cur.cecc_count - prev.cecc_count,
+			  cur.uecc_count - prev.uecc_count,
+			  load.count, load.codes, load.bytes,
+			  div_u64(load.last_ns, NSEC_PER_USEC), kbps,
+			  div_u64(load.total_ns, NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *xsdfec_attrs[] = {
+	&dev_attr_ldpc_code_table.attr,
+	&dev_attr_stats.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(xsdfec);
+
 static const struct file_operations xsdfec_fops = {
 	.owner = THIS_MODULE,
 	.open = xsdfec_dev_open,
@@ -1369,6 +1744,8 @@ static int xsdfec_probe(struct platform_device *pdev)
 
 	xsdfec->dev = &pdev->dev;
 	spin_lock_init(&xsdfec->error_data_lock);
+	mutex_init(&xsdfec->code_lock);
+	xsdfec->snap.time = ktime_get();
 
 	err = xsdfec_clk_init(pdev, &xsdfec->clks);
 	if (err)
@@ -1419,6 +1796,7 @@ static int xsdfec_probe(struct platform_device *pdev)
 	xsdfec->miscdev.name = xsdfec->dev_name;
 	xsdfec->miscdev.fops = &xsdfec_fops;
 	xsdfec->miscdev.parent = dev;
+	xsdfec->miscdev.groups = xsdfec_groups;
 	err = misc_register(&xsdfec->miscdev);
 	if (err) {
 		dev_err(dev, "error:%d. Unable to register device", err);
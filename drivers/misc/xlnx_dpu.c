@@ -17,12 +17,16 @@
 #include <linux/miscdevice.h>
 #include <linux/interrupt.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
-#include <linux/iopoll.h>
 #include <linux/clk.h>
 #include <linux/dma-mapping.h>
 #include <linux/nospec.h>
 #include <linux/slab.h>
 #include <linux/iommu.h>
+#include <linux/dma-buf.h>
+#include <linux/eventfd.h>
+#include <linux/kref.h>
+#include <linux/poll.h>
+#include <linux/workqueue.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
 #endif
@@ -55,13 +59,21 @@ MODULE_PARM_DESC(force_contig, "buffer is forced to be contiguous, default 0");
 
 /**
  * struct cu - Computer Unit (cu) structure
- * @mutex: protects from simultaneous access
- * @done: completion of cu
+ * @xdpu: pointer to dpu device struct
+ * @queue: jobs waiting for the cu
+ * @nr_queued: number of jobs in @queue
+ * @active: job running on the cu
+ * @deadline: jiffies after which @active is timed out
+ * @work: watchdog of @active, also polls the cu in polling mode
  * @irq: indicates cu IRQ number
  */
 struct cu {
-	struct mutex	mutex; /* protects from simultaneous accesses */
-	struct completion	done;
+	struct xdpu_dev	*xdpu;
+	struct list_head	queue;
+	unsigned int	nr_queued;
+	struct dpu_job	*active;
+	unsigned long	deadline;
+	struct delayed_work	work;
 	int	irq;
 };
 
@@ -69,7 +81,9 @@ struct cu {
  * struct xdpu_dev - Driver data for DPU
  * @dev: pointer to device struct
  * @regs: virtual base address for the dpu regmap
+ * @lock: protects the cu queues and the jobs of the clients
  * @cu: indicates computer unit struct
+ * @next_cu: dpu core to try first for the next job without a core
  * @axi_clk: AXI Lite clock
  * @dpu_clk: DPU clock used for DPUCZDX8G general logic
  * @dsp_clk: DSP clock used for DSP blocks
@@ -83,7 +97,9 @@ struct cu {
 struct xdpu_dev {
 	struct device	*dev;
 	void __iomem	*regs;
+	spinlock_t	lock; /* guards jobs */
 	struct cu	cu[MAX_CU_NUM];
+	u8	next_cu;
 	struct clk	*axi_clk;
 	struct clk	*dpu_clk;
 	struct clk	*dsp_clk;
@@ -102,29 +118,81 @@ struct xdpu_dev {
  * @dev: pointer to dpu device struct
  * @head: indicates dma memory pool list head
  * @node: client node
+ * @done_list: completed jobs waiting to be reaped
+ * @wait: wait queue for job completions
+ * @eventfd: eventfd signalled when a job completes
+ * @seqno: sequence number of the last submitted job
+ * @nr_jobs: number of jobs submitted and not yet reaped
+ * @nr_inflight: number of jobs submitted and not yet completed
  */
 struct xdpu_client {
 	struct xdpu_dev	*dev;
 	struct list_head	head;
 	struct list_head	node;
+	struct list_head	done_list;
+	wait_queue_head_t	wait;
+	struct eventfd_ctx	*eventfd;
+	u64	seqno;
+	unsigned int	nr_jobs;
+	unsigned int	nr_inflight;
+};
+
+/**
+ * struct dpu_job - DPU job
+ * @node: node in a cu queue or in the client done list
+ * @client: client which submitted the job
+ * @sync: the submitter waits for @done instead of reaping the job
+ * @done: completion of a synchronous job
+ * @req: job description and result
+ */
+struct dpu_job {
+	struct list_head	node;
+	struct xdpu_client	*client;
+	bool	sync;
+	struct completion	done;
+	struct ioc_job_t	req;
 };
 
 /**
  * struct dpu_buffer_block - DPU buffer block
  * @head: list head
+ * @xdpu: pointer to dpu device struct
+ * @ref: reference count, held by the client and by each exported dma-buf
  * @cpu_addr: cpu virtual address of the blocks memory
  * @dma_addr: dma address of the blocks memory
  * @phy_addr: physical address of the blocks memory
  * @size: total size of the block in bytes
  * @attrs: dma buffer attributes
+ * @contig: the block is contiguous in physical memory
+ * @dmabuf: dma-buf the block is imported from
+ * @attach: attachment of the imported dma-buf to the dpu
+ * @sgt: mapping of the imported dma-buf
+ * @sync_to_dev: number of bytes synced for the device
+ * @sync_to_cpu: number of bytes synced for the cpu
  */
 struct dpu_buffer_block {
 	struct list_head	head;
+	struct xdpu_dev	*xdpu;
+	struct kref	ref;
 	void	*cpu_addr;
 	dma_addr_t	dma_addr;
 	phys_addr_t	phy_addr;
 	size_t	size;
 	unsigned long	attrs;
+	bool	contig;
+	struct dma_buf	*dmabuf;
+	struct dma_buf_attachment	*attach;
+	struct sg_table	*sgt;
+	u64	sync_to_dev;
+	u64	sync_to_cpu;
+};
+
+/**
+ * struct dpu_dmabuf_attachment - attachment of an exported DPU buffer block
+ * @sgt: scatter list of the block
+ */
+struct dpu_dmabuf_attachment {
+	struct sg_table	sgt;
 };
 
 #ifdef CONFIG_DEBUG_FS
@@ -261,17 +329,12 @@ static void xlnx_sfm_int_clear(struct xdpu_dev *xdpu)
 }
 
 /**
- * xlnx_dpu_softmax - softmax calculation acceleration using softmax IP
+ * xlnx_sfm_start - start softmax calculation using softmax IP
  * @xdpu:	dpu structure
  * @p :	softmax pmeter structure
- *
- * Return:	0 if successful; otherwise -errno
  */
-static int xlnx_dpu_softmax(struct xdpu_dev *xdpu, struct ioc_softmax_t *p)
+static void xlnx_sfm_start(struct xdpu_dev *xdpu, struct ioc_softmax_t *p)
 {
-	int ret = -ETIMEDOUT;
-	int val;
-
 	iowrite32(p->width, xdpu->regs + DPU_SFM_CMD_XLEN);
 	iowrite32(p->height, xdpu->regs + DPU_SFM_CMD_YLEN);
 
@@ -288,49 +351,17 @@ static int xlnx_dpu_softmax(struct xdpu_dev *xdpu, struct ioc_softmax_t *p)
 
 	iowrite32(1, xdpu->regs + DPU_SFM_START);
 	iowrite32(0, xdpu->regs + DPU_SFM_START);
-
-	if (!force_poll) {
-		if (!wait_for_completion_timeout(&xdpu->cu[xdpu->dpu_cnt].done,
-						 TIMEOUT))
-			goto err_out;
-	} else {
-		ret = readx_poll_timeout(ioread32,
-					 xdpu->regs + DPU_SFM_INT_DONE,
-					 val,
-					 val & 0x1,
-					 POLL_PERIOD_US,
-					 TIMEOUT_US);
-		if (ret < 0)
-			goto err_out;
-
-		xlnx_sfm_int_clear(xdpu);
-	}
-
-	dev_dbg(xdpu->dev, "%s: PID=%d CPU=%d\n",
-		__func__, current->pid, raw_smp_processor_id());
-
-	return 0;
-
-err_out:
-	dev_warn(xdpu->dev, "timeout waiting for softmax\n");
-	xlnx_dpu_dump_regs(xdpu);
-
-	return ret;
 }
 
 /**
- * xlnx_dpu_run - run dpu
+ * xlnx_dpu_start - start dpu
  * @xdpu:	dpu structure
  * @p:	dpu run struct, contains the necessary address info
  * @id:	indicates which cu is running
- *
- * Return:	0 if successful; otherwise -errno
  */
-static inline int xlnx_dpu_run(struct xdpu_dev *xdpu,
-			       struct ioc_kernel_run_t *p, int id)
+static void xlnx_dpu_start(struct xdpu_dev *xdpu,
+			   struct ioc_kernel_run_t *p, int id)
 {
-	int val, ret;
-
 	iowrite32(p->addr_code >> DPU_INSTR_OFFSET,
 		  xdpu->regs + DPU_INSADDR(id));
 
@@ -356,27 +387,17 @@ static inline int xlnx_dpu_run(struct xdpu_dev *xdpu,
 		lo_hi_writeq(p->addr7, xdpu->regs + DPU_ADDR7_L(id));
 
 	iowrite32(1, xdpu->regs + DPU_IPSTART(id));
+}
 
-	p->time_start = ktime_get();
-
-	if (!force_poll) {
-		if (!wait_for_completion_timeout(&xdpu->cu[id].done,
-						 TIMEOUT))
-			goto err_out;
-	} else {
-		ret = readx_poll_timeout(ioread32,
-					 xdpu->regs + DPU_INT_RAW,
-					 val,
-					 val & BIT(id),
-					 POLL_PERIOD_US,
-					 TIMEOUT_US);
-		if (ret < 0)
-			goto err_out;
-
-		xlnx_dpu_int_clear(xdpu, id);
-	}
-
-	p->time_end = ktime_get();
+/**
+ * xlnx_dpu_read_counters - read the counters of a dpu run
+ * @xdpu:	dpu structure
+ * @p:	dpu run struct to fill
+ * @id:	indicates which cu has run
+ */
+static void xlnx_dpu_read_counters(struct xdpu_dev *xdpu,
+				   struct ioc_kernel_run_t *p, int id)
+{
 	p->core_id = id;
 	p->pend_cnt = ioread32(xdpu->regs + DPU_P_END_C(id));
 	p->cend_cnt = ioread32(xdpu->regs + DPU_C_END_C(id));
@@ -387,19 +408,405 @@ static inline int xlnx_dpu_run(struct xdpu_dev *xdpu,
 	p->sstart_cnt = ioread32(xdpu->regs + DPU_S_STA_C(id));
 	p->lstart_cnt = ioread32(xdpu->regs + DPU_L_STA_C(id));
 	p->counter = lo_hi_readq(xdpu->regs + DPU_CYCLE_L(id));
+}
 
-	dev_dbg(xdpu->dev,
-		"%s: PID=%d DPU=%d CPU=%d TIME=%lldus complete!\n",
-		__func__, current->pid, id, raw_smp_processor_id(),
-		ktime_us_delta(p->time_end, p->time_start));
+/**
+ * xlnx_cu_kick - start the next queued job of a cu if the cu is idle
+ * @xdpu:	dpu structure
+ * @id:	indicates which cu to start, dpu_cnt for softmax
+ *
+ * Context: xdpu->lock held.
+ */
+static void xlnx_cu_kick(struct xdpu_dev *xdpu, int id)
+{
+	struct cu *cu = &xdpu->cu[id];
+	struct dpu_job *job;
+
+	if (cu->active || list_empty(&cu->queue))
+		return;
+
+	job = list_first_entry(&cu->queue, struct dpu_job, node);
+	list_del(&job->node);
+	cu->nr_queued--;
+	cu->active = job;
+
+	if (job->req.type == DPU_JOB_SOFTMAX)
+		xlnx_sfm_start(xdpu, &job->req.softmax);
+	else
+		xlnx_dpu_start(xdpu, &job->req.run, id);
+
+	job->req.time_start = ktime_get();
+	cu->deadline = jiffies + TIMEOUT;
+	mod_delayed_work(system_wq, &cu->work,
+			 force_poll ? usecs_to_jiffies(POLL_PERIOD_US) :
+			 TIMEOUT);
+}
+
+/**
+ * xlnx_cu_is_done - check the interrupt status of a cu
+ * @xdpu:	dpu structure
+ * @id:	indicates which cu to check, dpu_cnt for softmax
+ *
+ * Return:	true if the cu has raised its interrupt
+ */
+static bool xlnx_cu_is_done(struct xdpu_dev *xdpu, int id)
+{
+	if (id == xdpu->dpu_cnt)
+		return ioread32(xdpu->regs + DPU_SFM_INT_DONE) & 0x1;
+
+	return ioread32(xdpu->regs + DPU_INT_RAW) & BIT(id);
+}
+
+/**
+ * xlnx_cu_complete - complete the running job of a cu
+ * @xdpu:	dpu structure
+ * @id:	indicates which cu has completed, dpu_cnt for softmax
+ * @status:	0 if the cu has completed the job; otherwise -errno
+ *
+ * The interrupt of the cu is cleared, the job is handed back to its
+ * submitter and the next queued job of the cu is started.
+ *
+ * Context: xdpu->lock held.
+ */
+static void xlnx_cu_complete(struct xdpu_dev *xdpu, int id, int status)
+{
+	struct cu *cu = &xdpu->cu[id];
+	struct dpu_job *job = cu->active;
+	struct xdpu_client *client = job->client;
+
+	cu->active = NULL;
+	job->req.time_end = ktime_get();
+	job->req.status = status;
+
+	if (id == xdpu->dpu_cnt) {
+		xlnx_sfm_int_clear(xdpu);
+	} else {
+		xlnx_dpu_int_clear(xdpu, id);
+		xlnx_dpu_read_counters(xdpu, &job->req.run, id);
+		job->req.run.time_start = job->req.time_start;
+		job->req.run.time_end = job->req.time_end;
+	}
+
+	dev_dbg(xdpu->dev, "%s: CU=%d seqno=%llu status=%d TIME=%lldus\n",
+		__func__, id, job->req.seqno, status,
+		ktime_us_delta(job->req.time_end, job->req.time_start));
+
+	if (job->sync) {
+		complete(&job->done);
+	} else {
+		list_add_tail(&job->node, &client->done_list);
+		client->nr_inflight--;
+		wake_up(&client->wait);
+		if (client->eventfd)
+			eventfd_signal(client->eventfd, 1);
+	}
+
+	xlnx_cu_kick(xdpu, id);
+}
+
+/**
+ * xlnx_cu_work - watchdog of the running job of a cu
+ * @work:	work struct of the cu
+ *
+ * The job is completed with -ETIMEDOUT once it has run for the timeout. In
+ * polling mode, the work also checks the cu every POLL_PERIOD_US.
+ */
+static void xlnx_cu_work(struct work_struct *work)
+{
+	struct cu *cu = container_of(to_delayed_work(work), struct cu, work);
+	struct xdpu_dev *xdpu = cu->xdpu;
+	int id = cu - xdpu->cu;
+	bool timedout = false;
+	unsigned long flags;
+
+	spin_lock_irqsave(&xdpu->lock, flags);
+	if (!cu->active)
+		goto unlock;
+
+	if (force_poll && xlnx_cu_is_done(xdpu, id)) {
+		xlnx_cu_complete(xdpu, id, 0);
+		goto unlock;
+	}
+
+	if (time_before(jiffies, cu->deadline)) {
+		mod_delayed_work(system_wq, &cu->work,
+				 force_poll ? usecs_to_jiffies(POLL_PERIOD_US) :
+				 cu->deadline - jiffies);
+		goto unlock;
+	}
+
+	timedout = true;
+	xlnx_cu_complete(xdpu, id, -ETIMEDOUT);
+unlock:
+	spin_unlock_irqrestore(&xdpu->lock, flags);
+
+	if (timedout) {
+		if (id == xdpu->dpu_cnt)
+			dev_warn(xdpu->dev, "timeout waiting for softmax\n");
+		else
+			dev_warn(xdpu->dev, "cu[%d] timeout", id);
+		xlnx_dpu_dump_regs(xdpu);
+	}
+}
+
+/**
+ * xlnx_dpu_pick_cu - pick a dpu core for a job without a core
+ * @xdpu:	dpu structure
+ *
+ * The cores are tried round-robin, an idle core is picked first and
+ * otherwise the core with the fewest queued jobs.
+ *
+ * Return:	the dpu core id
+ *
+ * Context: xdpu->lock held.
+ */
+static int xlnx_dpu_pick_cu(struct xdpu_dev *xdpu)
+{
+	unsigned int min = UINT_MAX;
+	int i, id, best = 0;
+
+	for (i = 0; i < xdpu->dpu_cnt; i++) {
+		id = (xdpu->next_cu + i) % xdpu->dpu_cnt;
+		if (!xdpu->cu[id].active) {
+			best = id;
+			break;
+		}
+		if (xdpu->cu[id].nr_queued < min) {
+			min = xdpu->cu[id].nr_queued;
+			best = id;
+		}
+	}
+
+	xdpu->next_cu = (best + 1) % xdpu->dpu_cnt;
+
+	return best;
+}
+
+/**
+ * xlnx_dpu_queue_job - queue a job to a cu
+ * @xdpu:	dpu structure
+ * @job:	job to queue
+ *
+ * A DPU_JOB_KERNEL job runs on @job->req.run.core_id, or on the core picked
+ * by the driver if it is negative. A DPU_JOB_SOFTMAX job runs on the
+ * softmax core.
+ */
+static void xlnx_dpu_queue_job(struct xdpu_dev *xdpu, struct dpu_job *job)
+{
+	unsigned long flags;
+	int id;
+
+	spin_lock_irqsave(&xdpu->lock, flags);
+	if (job->req.type == DPU_JOB_SOFTMAX) {
+		id = xdpu->dpu_cnt;
+	} else {
+		id = job->req.run.core_id;
+		if (id < 0)
+			id = xlnx_dpu_pick_cu(xdpu);
+		job->req.run.core_id = id;
+	}
+
+	job->req.time_submit = ktime_get();
+	list_add_tail(&job->node, &xdpu->cu[id].queue);
+	xdpu->cu[id].nr_queued++;
+	xlnx_cu_kick(xdpu, id);
+	spin_unlock_irqrestore(&xdpu->lock, flags);
+}
+
+/**
+ * xlnx_dpu_run_sync - run a job and wait for its completion
+ * @client:	dpu client
+ * @job:	job to run
+ *
+ * The job is queued behind the jobs already submitted to the same cu.
+ *
+ * Return:	0 if successful; otherwise -errno
+ */
+static int xlnx_dpu_run_sync(struct xdpu_client *client, struct dpu_job *job)
+{
+	job->client = client;
+	job->sync = true;
+	init_completion(&job->done);
+
+	dev_dbg(client->dev->dev, "%s: PID=%d CPU=%d Comm=%.20s waiting",
+		__func__, current->pid, raw_smp_processor_id(),
+		current->comm);
+
+	xlnx_dpu_queue_job(client->dev, job);
+	/* the watchdog of the cu bounds the wait */
+	wait_for_completion(&job->done);
+
+	return job->req.status;
+}
+
+/**
+ * xlnx_dpu_check_job - validate a job from userspace
+ * @xdpu:	dpu structure
+ * @req:	job description
+ * @any_core:	whether the driver may pick the core of DPU_JOB_KERNEL jobs
+ *
+ * Return:	0 if valid; otherwise -errno
+ */
+static int xlnx_dpu_check_job(struct xdpu_dev *xdpu, struct ioc_job_t *req,
+			      bool any_core)
+{
+	int id;
+
+	switch (req->type) {
+	case DPU_JOB_KERNEL:
+		id = req->run.core_id;
+		if (id >= xdpu->dpu_cnt || (id < 0 && (!any_core || id != -1)))
+			return -EINVAL;
+		if (id >= 0)
+			req->run.core_id = array_index_nospec(id,
+							      xdpu->dpu_cnt);
+		return 0;
+	case DPU_JOB_SOFTMAX:
+		return xdpu->sfm_cnt ? 0 : -ENODEV;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * xlnx_dpu_submit - queue a job without waiting for its completion
+ * @client:	dpu client
+ * @req:	ioc_job_t struct, contains the job description
+ *
+ * The completed job is returned by DPUIOC_REAP.
+ *
+ * Return:	0 if successful; otherwise -errno
+ */
+static long xlnx_dpu_submit(struct xdpu_client *client,
+			    struct ioc_job_t __user *req)
+{
+	struct xdpu_dev *xdpu = client->dev;
+	struct dpu_job *job;
+	u64 seqno;
+	int ret;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	if (copy_from_user(&job->req, req, sizeof(job->req))) {
+		ret = -EFAULT;
+		goto err_job;
+	}
+
+	ret = xlnx_dpu_check_job(xdpu, &job->req, true);
+	if (ret)
+		goto err_job;
+
+	job->client = client;
+
+	spin_lock_irq(&xdpu->lock);
+	if (client->nr_jobs >= DPU_MAX_JOBS) {
+		spin_unlock_irq(&xdpu->lock);
+		ret = -EBUSY;
+		goto err_job;
+	}
+	client->nr_jobs++;
+	client->nr_inflight++;
+	seqno = ++client->seqno;
+	job->req.seqno = seqno;
+	spin_unlock_irq(&xdpu->lock);
+
+	xlnx_dpu_queue_job(xdpu, job);
+
+	if (put_user(seqno, &req->seqno))
+		return -EFAULT;
 
 	return 0;
 
-err_out:
-	dev_warn(xdpu->dev, "cu[%d] timeout", id);
-	xlnx_dpu_dump_regs(xdpu);
+err_job:
+	kfree(job);
+	return ret;
+}
+
+/**
+ * xlnx_dpu_reap - return the oldest completed job
+ * @client:	dpu client
+ * @file:	file handle of the DPU device
+ * @req:	ioc_job_t struct to fill with the job result
+ *
+ * Wait for a job completion unless the file is non-blocking.
+ *
+ * Return:	0 if successful; -ENODATA if there is no job to wait for,
+ *		-EAGAIN if no job has completed in non-blocking mode;
+ *		otherwise -errno
+ */
+static long xlnx_dpu_reap(struct xdpu_client *client, struct file *file,
+			  struct ioc_job_t __user *req)
+{
+	struct xdpu_dev *xdpu = client->dev;
+	struct dpu_job *job;
+	unsigned int inflight;
+	long ret;
+
+	for (;;) {
+		spin_lock_irq(&xdpu->lock);
+		job = list_first_entry_or_null(&client->done_list,
+					       struct dpu_job, node);
+		if (job) {
+			list_del(&job->node);
+			client->nr_jobs--;
+		}
+		inflight = client->nr_inflight;
+		spin_unlock_irq(&xdpu->lock);
+
+		if (job)
+			break;
+		if (!inflight)
+			return -ENODATA;
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(client->wait,
+					       !list_empty(&client->done_list));
+		if (ret)
+			return ret;
+	}
+
+	ret = copy_to_user(req, &job->req, sizeof(job->req)) ? -EFAULT : 0;
+	kfree(job);
+
+	return ret;
+}
+
+/**
+ * xlnx_dpu_set_eventfd - set the eventfd signalled on job completions
+ * @client:	dpu client
+ * @req:	eventfd file descriptor, -1 to remove the eventfd
+ *
+ * Return:	0 if successful; otherwise -errno
+ */
+static long xlnx_dpu_set_eventfd(struct xdpu_client *client,
+				 s32 __user *req)
+{
+	struct xdpu_dev *xdpu = client->dev;
+	struct eventfd_ctx *eventfd = NULL;
+	s32 fd;
+
+	if (get_user(fd, req))
+		return -EFAULT;
+
+	if (fd >= 0) {
+		eventfd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(eventfd))
+			return PTR_ERR(eventfd);
+	} else if (fd != -1) {
+		return -EINVAL;
+	}
+
+	spin_lock_irq(&xdpu->lock);
+	swap(client->eventfd, eventfd);
+	spin_unlock_irq(&xdpu->lock);
+
+	if (eventfd)
+		eventfd_ctx_put(eventfd);
 
-	return -ETIMEDOUT;
+	return 0;
 }
 
 static inline phys_addr_t get_pa(void *addr)
@@ -410,6 +817,206 @@ static inline phys_addr_t get_pa(void *addr)
 	return __pa(addr);
 }
 
+/**
+ * xlnx_dpu_bo_release - free a buffer block once it is no longer used
+ * @ref:	reference count of the block
+ */
+static void xlnx_dpu_bo_release(struct kref *ref)
+{
+	struct dpu_buffer_block *h = container_of(ref, struct dpu_buffer_block,
+						  ref);
+
+	if (h->dmabuf) {
+		dma_buf_unmap_attachment(h->attach, h->sgt, DMA_BIDIRECTIONAL);
+		dma_buf_detach(h->dmabuf, h->attach);
+		dma_buf_put(h->dmabuf);
+	} else {
+		dma_free_attrs(h->xdpu->dev, h->size, h->cpu_addr, h->dma_addr,
+			       h->attrs);
+	}
+	kfree(h);
+}
+
+static inline void xlnx_dpu_put_bo(struct dpu_buffer_block *h)
+{
+	kref_put(&h->ref, xlnx_dpu_bo_release);
+}
+
+/**
+ * xlnx_dpu_find_bo - find the buffer block of a client containing an address
+ * @client:	dpu client
+ * @dma_addr:	dma address in the block
+ *
+ * Context: xdpu->mutex held.
+ *
+ * Return:	the buffer block if found; otherwise NULL
+ */
+static struct dpu_buffer_block *xlnx_dpu_find_bo(struct xdpu_client *client,
+						 dma_addr_t dma_addr)
+{
+	struct dpu_buffer_block *h;
+
+	list_for_each_entry(h, &client->head, head) {
+		if (in_range(dma_addr, h->dma_addr, h->size))
+			return h;
+	}
+
+	return NULL;
+}
+
+/**
+ * xlnx_dpu_sync_range - flush/invalidate cache for a range of a block
+ * @h:	buffer block
+ * @offset:	offset of the range in the block
+ * @size:	size of the range
+ * @dir:	DPU_TO_CPU or CPU_TO_DPU
+ *
+ * A block which is not contiguous in physical memory is synced page by
+ * page, as the dma address of each page translates to a different page.
+ */
+static void xlnx_dpu_sync_range(struct dpu_buffer_block *h, size_t offset,
+				size_t size, int dir)
+{
+	struct device *dev = h->xdpu->dev;
+	dma_addr_t addr;
+	size_t len;
+
+	if (dir == DPU_TO_CPU)
+		h->sync_to_cpu += size;
+	else
+		h->sync_to_dev += size;
+
+	while (size) {
+		addr = h->dma_addr + offset;
+		len = size;
+		if (!h->contig)
+			len = min_t(size_t, len,
+				    PAGE_SIZE - offset_in_page(addr));
+
+		if (dir == DPU_TO_CPU)
+			dma_sync_single_for_cpu(dev, addr, len,
+						DMA_FROM_DEVICE);
+		else
+			dma_sync_single_for_device(dev, addr, len,
+						   DMA_TO_DEVICE);
+
+		offset += len;
+		size -= len;
+	}
+}
+
+static int xlnx_dpu_dmabuf_attach(struct dma_buf *dmabuf,
+				  struct dma_buf_attachment *attachment)
+{
+	struct dpu_buffer_block *h = dmabuf->priv;
+	struct dpu_dmabuf_attachment *a;
+	int ret;
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	if (!a)
+		return -ENOMEM;
+
+	ret = dma_get_sgtable_attrs(h->xdpu->dev, &a->sgt, h->cpu_addr,
+				    h->dma_addr, h->size, h->attrs);
+	if (ret < 0) {
+		kfree(a);
+		return ret;
+	}
+
+	attachment->priv = a;
+
+	return 0;
+}
+
+static void xlnx_dpu_dmabuf_detach(struct dma_buf *dmabuf,
+				   struct dma_buf_attachment *attachment)
+{
+	struct dpu_dmabuf_attachment *a = attachment->priv;
+
+	sg_free_table(&a->sgt);
+	kfree(a);
+}
+
+static struct sg_table *
+xlnx_dpu_dmabuf_map(struct dma_buf_attachment *attachment,
+		    enum dma_data_direction dir)
+{
+	struct dpu_dmabuf_attachment *a = attachment->priv;
+	int ret;
+
+	ret = dma_map_sgtable(attachment->dev, &a->sgt, dir, 0);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return &a->sgt;
+}
+
+static void xlnx_dpu_dmabuf_unmap(struct dma_buf_attachment *attachment,
+				  struct sg_table *sgt,
+				  enum dma_data_direction dir)
+{
+	dma_unmap_sgtable(attachment->dev, sgt, dir, 0);
+}
+
+static void xlnx_dpu_dmabuf_release(struct dma_buf *dmabuf)
+{
+	xlnx_dpu_put_bo(dmabuf->priv);
+}
+
+static int xlnx_dpu_dmabuf_begin_cpu_access(struct dma_buf *dmabuf,
+					    enum dma_data_direction dir)
+{
+	struct dpu_buffer_block *h = dmabuf->priv;
+
+	mutex_lock(&h->xdpu->mutex);
+	xlnx_dpu_sync_range(h, 0, h->size, DPU_TO_CPU);
+	mutex_unlock(&h->xdpu->mutex);
+
+	return 0;
+}
+
+static int xlnx_dpu_dmabuf_end_cpu_access(struct dma_buf *dmabuf,
+					  enum dma_data_direction dir)
+{
+	struct dpu_buffer_block *h = dmabuf->priv;
+
+	mutex_lock(&h->xdpu->mutex);
+	xlnx_dpu_sync_range(h, 0, h->size, CPU_TO_DPU);
+	mutex_unlock(&h->xdpu->mutex);
+
+	return 0;
+}
+
+static int xlnx_dpu_dmabuf_mmap(struct dma_buf *dmabuf,
+				struct vm_area_struct *vma)
+{
+	struct dpu_buffer_block *h = dmabuf->priv;
+
+	return dma_mmap_attrs(h->xdpu->dev, vma, h->cpu_addr, h->dma_addr,
+			      h->size, h->attrs);
+}
+
+static int xlnx_dpu_dmabuf_vmap(struct dma_buf *dmabuf, struct iosys_map *map)
+{
+	struct dpu_buffer_block *h = dmabuf->priv;
+
+	iosys_map_set_vaddr(map, h->cpu_addr);
+
+	return 0;
+}
+
+static const struct dma_buf_ops xlnx_dpu_dmabuf_ops = {
+	.attach = xlnx_dpu_dmabuf_attach,
+	.detach = xlnx_dpu_dmabuf_detach,
+	.map_dma_buf = xlnx_dpu_dmabuf_map,
+	.unmap_dma_buf = xlnx_dpu_dmabuf_unmap,
+	.release = xlnx_dpu_dmabuf_release,
+	.begin_cpu_access = xlnx_dpu_dmabuf_begin_cpu_access,
+	.end_cpu_access = xlnx_dpu_dmabuf_end_cpu_access,
+	.mmap = xlnx_dpu_dmabuf_mmap,
+	.vmap = xlnx_dpu_dmabuf_vmap,
+};
+
 /**
  * xlnx_dpu_alloc_bo - alloc contiguous physical memory for dpu
  * @client:	dpu client
@@ -428,6 +1035,9 @@ static long xlnx_dpu_alloc_bo(struct xdpu_client *client,
 	if (!pb)
 		return -ENOMEM;
 
+	pb->xdpu = xdpu;
+	kref_init(&pb->ref);
+
 	if (get_user(size, &req->size))
 		goto err_pb;
 
@@ -441,6 +1051,7 @@ static long xlnx_dpu_alloc_bo(struct xdpu_client *client,
 
 	if (iommu_present(xdpu->dev->bus) && force_contig)
 		pb->attrs = DMA_ATTR_FORCE_CONTIGUOUS;
+	pb->contig = !iommu_present(xdpu->dev->bus) || force_contig;
 
 	pb->cpu_addr = dma_alloc_attrs(xdpu->dev, pb->size, &pb->dma_addr,
 				       GFP_KERNEL | __GFP_ZERO, pb->attrs);
@@ -488,10 +1099,8 @@ static long xlnx_dpu_free_bo(struct xdpu_client *client,
 	mutex_lock(&xdpu->mutex);
 	list_for_each_entry_safe(h, n, &client->head, head) {
 		if (in_range(dma_addr, h->dma_addr, h->size)) {
-			dma_free_attrs(xdpu->dev, h->size, h->cpu_addr,
-				       h->dma_addr, h->attrs);
 			list_del(&h->head);
-			kfree(h);
+			xlnx_dpu_put_bo(h);
 		}
 	}
 	mutex_unlock(&xdpu->mutex);
@@ -504,6 +1113,8 @@ static long xlnx_dpu_free_bo(struct xdpu_client *client,
  * @client:	dpu client
  * @req:	dpcma_req_sync struct, contains the request info
  *
+ * Only the requested range of the buffer object is synced.
+ *
  * Return:	0 if successful; otherwise -errno
  */
 static inline long xlnx_dpu_sync_bo(struct xdpu_client *client,
@@ -511,9 +1122,10 @@ static inline long xlnx_dpu_sync_bo(struct xdpu_client *client,
 {
 	dma_addr_t dma_addr;
 	int dir;
-	size_t size;
-	struct dpu_buffer_block *h = NULL, *n = NULL;
+	size_t size, offset;
+	struct dpu_buffer_block *h;
 	struct xdpu_dev *xdpu = client->dev;
+	long ret = 0;
 
 	if (get_user(dma_addr, &req->dma_addr) ||
 	    get_user(size, &req->size) || get_user(dir, &req->direction))
@@ -525,24 +1137,168 @@ static inline long xlnx_dpu_sync_bo(struct xdpu_client *client,
 	}
 
 	mutex_lock(&xdpu->mutex);
-	list_for_each_entry_safe(h, n, &client->head, head) {
-		if (in_range(dma_addr, h->dma_addr, h->size)) {
-			if (dir == DPU_TO_CPU)
-				dma_sync_single_for_cpu(xdpu->dev,
-							h->phy_addr,
-							size,
-							DMA_FROM_DEVICE);
-			else
-				dma_sync_single_for_device(xdpu->dev,
-							   h->phy_addr,
-							   size,
-							   DMA_TO_DEVICE);
+	h = xlnx_dpu_find_bo(client, dma_addr);
+	if (!h) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	offset = dma_addr - h->dma_addr;
+	if (size > h->size - offset) {
+		dev_err(xdpu->dev, "sync range crosses the end of the BO\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	xlnx_dpu_sync_range(h, offset, size, dir);
+out:
+	mutex_unlock(&xdpu->mutex);
+
+	return ret;
+}
+
+/**
+ * xlnx_dpu_export_bo - export a buffer object as a dma-buf
+ * @client:	dpu client
+ * @req:	dpcma_req_export struct, contains the request info
+ *
+ * The buffer object lives until it is freed and all its dma-bufs are
+ * released.
+ *
+ * Return:	0 if successful; otherwise -errno
+ */
+static long xlnx_dpu_export_bo(struct xdpu_client *client,
+			       struct dpcma_req_export __user *req)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct xdpu_dev *xdpu = client->dev;
+	struct dpu_buffer_block *h;
+	struct dma_buf *dmabuf;
+	dma_addr_t dma_addr;
+	int fd;
+
+	if (get_user(dma_addr, &req->dma_addr))
+		return -EFAULT;
+
+	mutex_lock(&xdpu->mutex);
+	h = xlnx_dpu_find_bo(client, dma_addr);
+	/* imported buffer objects are not exported again */
+	if (h && !h->dmabuf)
+		kref_get(&h->ref);
+	else
+		h = NULL;
+	mutex_unlock(&xdpu->mutex);
+
+	if (!h)
+		return -EINVAL;
+
+	exp_info.ops = &xlnx_dpu_dmabuf_ops;
+	exp_info.size = h->size;
+	exp_info.flags = O_RDWR;
+	exp_info.priv = h;
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		xlnx_dpu_put_bo(h);
+		return PTR_ERR(dmabuf);
+	}
+
+	fd = dma_buf_fd(dmabuf, O_CLOEXEC);
+	if (fd < 0) {
+		dma_buf_put(dmabuf);
+		return fd;
+	}
+
+	if (put_user(fd, &req->fd))
+		return -EFAULT;
+
+	return 0;
+}
+
+/**
+ * xlnx_dpu_import_bo - import a dma-buf as a buffer object
+ * @client:	dpu client
+ * @req:	dpcma_req_import struct, contains the request info
+ *
+ * The dma-buf must be contiguous in the dma address space of the dpu. It
+ * is released with DPUIOC_FREE_BO like an allocated buffer object.
+ *
+ * Return:	0 if successful; otherwise -errno
+ */
+static long xlnx_dpu_import_bo(struct xdpu_client *client,
+			       struct dpcma_req_import __user *req)
+{
+	struct xdpu_dev *xdpu = client->dev;
+	struct dpu_buffer_block *pb;
+	struct scatterlist *sg;
+	dma_addr_t next;
+	long ret;
+	int fd, i;
+
+	if (get_user(fd, &req->fd))
+		return -EFAULT;
+
+	pb = kzalloc(sizeof(*pb), GFP_KERNEL);
+	if (!pb)
+		return -ENOMEM;
+
+	pb->xdpu = xdpu;
+	kref_init(&pb->ref);
+
+	pb->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(pb->dmabuf)) {
+		ret = PTR_ERR(pb->dmabuf);
+		goto err_pb;
+	}
+
+	pb->attach = dma_buf_attach(pb->dmabuf, xdpu->dev);
+	if (IS_ERR(pb->attach)) {
+		ret = PTR_ERR(pb->attach);
+		goto err_put;
+	}
+
+	pb->sgt = dma_buf_map_attachment(pb->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR(pb->sgt)) {
+		ret = PTR_ERR(pb->sgt);
+		goto err_detach;
+	}
+
+	pb->dma_addr = sg_dma_address(pb->sgt->sgl);
+	pb->size = pb->dmabuf->size;
+	next = pb->dma_addr;
+	for_each_sgtable_dma_sg(pb->sgt, sg, i) {
+		if (sg_dma_address(sg) != next)
 			break;
-		}
+		next += sg_dma_len(sg);
 	}
+	if (next - pb->dma_addr < pb->size) {
+		dev_err(xdpu->dev, "dma-buf is not contiguous for the dpu\n");
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+
+	pb->contig = !iommu_present(xdpu->dev->bus);
+
+	if (put_user(pb->dma_addr, &req->dma_addr) ||
+	    put_user(pb->size, &req->capacity)) {
+		ret = -EFAULT;
+		goto err_unmap;
+	}
+
+	mutex_lock(&xdpu->mutex);
+	list_add(&pb->head, &client->head);
 	mutex_unlock(&xdpu->mutex);
 
 	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(pb->attach, pb->sgt, DMA_BIDIRECTIONAL);
+err_detach:
+	dma_buf_detach(pb->dmabuf, pb->attach);
+err_put:
+	dma_buf_put(pb->dmabuf);
+err_pb:
+	kfree(pb);
+	return ret;
 }
 
 /**
@@ -574,32 +1330,21 @@ static long xlnx_dpu_ioctl(struct file *file, unsigned int cmd,
 	switch (cmd) {
 	case DPUIOC_RUN:
 	{
-		struct ioc_kernel_run_t t;
-		int id;
+		struct dpu_job job = { .req.type = DPU_JOB_KERNEL };
 
-		if (copy_from_user(&t, data,
+		if (copy_from_user(&job.req.run, data,
 				   sizeof(struct ioc_kernel_run_t))) {
 			return -EINVAL;
 		}
 
-		id = t.core_id;
-		if (id >= xdpu->dpu_cnt)
-			return -EINVAL;
-
-		dev_dbg(xdpu->dev,
-			"%s: PID=%d DPU=%d CPU=%d Comm=%.20s waiting",
-			__func__, current->pid, id, raw_smp_processor_id(),
-			current->comm);
-
-		id = array_index_nospec(id, xdpu->dpu_cnt);
-		/* Allows one process to run the cu by using a mutex */
-		mutex_lock(&xdpu->cu[id].mutex);
-
-		ret = xlnx_dpu_run(xdpu, &t, id);
+		ret = xlnx_dpu_check_job(xdpu, &job.req, false);
+		if (ret)
+			return ret;
 
-		mutex_unlock(&xdpu->cu[id].mutex);
+		ret = xlnx_dpu_run_sync(client, &job);
 
-		if (copy_to_user(data, &t, sizeof(struct ioc_kernel_run_t)))
+		if (copy_to_user(data, &job.req.run,
+				 sizeof(struct ioc_kernel_run_t)))
 			return -EINVAL;
 
 		break;
@@ -613,6 +1358,12 @@ static long xlnx_dpu_ioctl(struct file *file, unsigned int cmd,
 	case DPUIOC_SYNC_BO:
 		return xlnx_dpu_sync_bo(client,
 					(struct dpcma_req_sync __user *)arg);
+	case DPUIOC_EXPORT_BO:
+		return xlnx_dpu_export_bo(client,
+					  (struct dpcma_req_export __user *)arg);
+	case DPUIOC_IMPORT_BO:
+		return xlnx_dpu_import_bo(client,
+					  (struct dpcma_req_import __user *)arg);
 	case DPUIOC_G_INFO:
 	{
 		u32 dpu_info = ioread32(xdpu->regs + DPU_IPVER_INFO);
@@ -631,21 +1382,29 @@ static long xlnx_dpu_ioctl(struct file *file, unsigned int cmd,
 	}
 	case DPUIOC_RUN_SOFTMAX:
 	{
-		struct ioc_softmax_t t;
+		struct dpu_job job = { .req.type = DPU_JOB_SOFTMAX };
 
-		if (copy_from_user(&t, data, sizeof(struct ioc_softmax_t))) {
+		if (copy_from_user(&job.req.softmax, data,
+				   sizeof(struct ioc_softmax_t))) {
 			dev_err(xdpu->dev, "copy_from_user softmax_t fail\n");
 			return -EINVAL;
 		}
 
-		mutex_lock(&xdpu->cu[xdpu->dpu_cnt].mutex);
-
-		ret = xlnx_dpu_softmax(xdpu, &t);
+		ret = xlnx_dpu_check_job(xdpu, &job.req, false);
+		if (ret)
+			return ret;
 
-		mutex_unlock(&xdpu->cu[xdpu->dpu_cnt].mutex);
+		ret = xlnx_dpu_run_sync(client, &job);
 
 		break;
 	}
+	case DPUIOC_SUBMIT:
+		return xlnx_dpu_submit(client, (struct ioc_job_t __user *)arg);
+	case DPUIOC_REAP:
+		return xlnx_dpu_reap(client, file,
+				     (struct ioc_job_t __user *)arg);
+	case DPUIOC_SET_EVENTFD:
+		return xlnx_dpu_set_eventfd(client, (s32 __user *)arg);
 	case DPUIOC_REG_READ:
 	{
 		u32 val = 0;
@@ -681,20 +1440,26 @@ static irqreturn_t xlnx_dpu_isr(int irq, void *data)
 	struct xdpu_dev *xdpu = data;
 	int i;
 
+	spin_lock(&xdpu->lock);
 	for (i = 0; i < xdpu->dpu_cnt; i++) {
 		if (irq == xdpu->cu[i].irq) {
-			xlnx_dpu_int_clear(xdpu, i);
 			dev_dbg(xdpu->dev, "%s: DPU=%d IRQ=%d",
 				__func__, i, irq);
-			complete(&xdpu->cu[i].done);
+			if (xdpu->cu[i].active)
+				xlnx_cu_complete(xdpu, i, 0);
+			else
+				xlnx_dpu_int_clear(xdpu, i);
 		}
 	}
 
 	if (irq == xdpu->cu[xdpu->dpu_cnt].irq) {
-		xlnx_sfm_int_clear(xdpu);
 		dev_dbg(xdpu->dev, "%s: softmax IRQ=%d", __func__, irq);
-		complete(&xdpu->cu[xdpu->dpu_cnt].done);
+		if (xdpu->cu[xdpu->dpu_cnt].active)
+			xlnx_cu_complete(xdpu, xdpu->dpu_cnt, 0);
+		else
+			xlnx_sfm_int_clear(xdpu);
 	}
+	spin_unlock(&xdpu->lock);
 
 	return IRQ_HANDLED;
 }
@@ -739,6 +1504,9 @@ static int xlnx_dpu_mmap(struct file *file, struct vm_area_struct *vma)
 	/* map the whole buffer */
 	vma->vm_pgoff = 0;
 
+	if (h->dmabuf)
+		return dma_buf_mmap(h->dmabuf, vma, 0);
+
 	return dma_mmap_attrs(xdpu->dev, vma, h->cpu_addr, h->dma_addr,
 			size, 0);
 }
@@ -761,6 +1529,8 @@ static int xlnx_dpu_open(struct inode *inode, struct file *filp)
 	xdpu = container_of(filp->private_data, struct xdpu_dev, miscdev);
 	client->dev = xdpu;
 	INIT_LIST_HEAD(&client->head);
+	INIT_LIST_HEAD(&client->done_list);
+	init_waitqueue_head(&client->wait);
 
 	filp->private_data = client;
 
@@ -784,21 +1554,42 @@ static int xlnx_dpu_release(struct inode *inode, struct file *filp)
 	struct xdpu_client *client = filp->private_data;
 	struct xdpu_dev *xdpu = client->dev;
 	struct dpu_buffer_block *h = NULL, *n = NULL;
+	struct dpu_job *job, *tmp;
+	int i;
 #ifdef CONFIG_DEBUG_FS
 	struct xdpu_client *p = NULL, *t = NULL;
 #endif
 
+	/* Drop the queued jobs and wait for the running ones */
+	spin_lock_irq(&xdpu->lock);
+	for (i = 0; i < xdpu->dpu_cnt + xdpu->sfm_cnt; i++) {
+		list_for_each_entry_safe(job, tmp, &xdpu->cu[i].queue, node) {
+			if (job->client != client)
+				continue;
+			list_del(&job->node);
+			xdpu->cu[i].nr_queued--;
+			client->nr_inflight--;
+			kfree(job);
+		}
+	}
+	spin_unlock_irq(&xdpu->lock);
+
+	wait_event(client->wait, !READ_ONCE(client->nr_inflight));
+
+	list_for_each_entry_safe(job, tmp, &client->done_list, node) {
+		list_del(&job->node);
+		kfree(job);
+	}
+
+	if (client->eventfd)
+		eventfd_ctx_put(client->eventfd);
+
 	mutex_lock(&xdpu->mutex);
 	/* Drain the remaining buffer entries when abnormal close */
 	if (!list_empty(&client->head)) {
 		list_for_each_entry_safe(h, n, &client->head, head) {
-			dma_free_attrs(xdpu->dev,
-				       h->size,
-				       h->cpu_addr,
-				       h->dma_addr,
-				       h->attrs);
 			list_del(&h->head);
-			kfree(h);
+			xlnx_dpu_put_bo(h);
 		};
 	}
 
@@ -816,10 +1607,34 @@ static int xlnx_dpu_release(struct inode *inode, struct file *filp)
 	return 0;
 }
 
+/**
+ * xlnx_dpu_poll - poll for completed jobs
+ * @file:	file handle of the DPU device
+ * @wait:	poll table
+ *
+ * Return:	EPOLLIN if a completed job can be reaped
+ */
+static __poll_t xlnx_dpu_poll(struct file *file, poll_table *wait)
+{
+	struct xdpu_client *client = file->private_data;
+	struct xdpu_dev *xdpu = client->dev;
+	__poll_t mask = 0;
+
+	poll_wait(file, &client->wait, wait);
+
+	spin_lock_irq(&xdpu->lock);
+	if (!list_empty(&client->done_list))
+		mask = EPOLLIN | EPOLLRDNORM;
+	spin_unlock_irq(&xdpu->lock);
+
+	return mask;
+}
+
 static const struct file_operations dev_fops = {
 	.owner = THIS_MODULE,
 	.open = xlnx_dpu_open,
 	.mmap = xlnx_dpu_mmap,
+	.poll = xlnx_dpu_poll,
 	.unlocked_ioctl = xlnx_dpu_ioctl,
 	.release = xlnx_dpu_release,
 };
@@ -965,6 +1780,14 @@ static int xlnx_dpu_probe(struct platform_device *pdev)
 	dev_dbg(dev, "found %d dpu core @%ldMHz and %d softmax core",
 		xdpu->dpu_cnt, DPU_FREQ(val), xdpu->sfm_cnt);
 
+	spin_lock_init(&xdpu->lock);
+
+	for (i = 0; i < xdpu->dpu_cnt + xdpu->sfm_cnt; i++) {
+		xdpu->cu[i].xdpu = xdpu;
+		INIT_LIST_HEAD(&xdpu->cu[i].queue);
+		INIT_DELAYED_WORK(&xdpu->cu[i].work, xlnx_cu_work);
+	}
+
 	if (get_irq(pdev, xdpu))
 		goto err_out;
 
@@ -981,11 +1804,6 @@ static int xlnx_dpu_probe(struct platform_device *pdev)
 
 	mutex_init(&xdpu->mutex);
 
-	for (i = 0; i < xdpu->dpu_cnt + xdpu->sfm_cnt; i++) {
-		init_completion(&xdpu->cu[i].done);
-		mutex_init(&xdpu->cu[i].mutex);
-	}
-
 	xdpu->miscdev.minor = MISC_DYNAMIC_MINOR;
 	xdpu->miscdev.name = DEVICE_NAME;
 	xdpu->miscdev.fops = &dev_fops;
@@ -1037,6 +1855,9 @@ static int xlnx_dpu_remove(struct platform_device *pdev)
 	struct xdpu_dev *xdpu = platform_get_drvdata(pdev);
 	int i;
 
+	for (i = 0; i < xdpu->dpu_cnt + xdpu->sfm_cnt; i++)
+		cancel_delayed_work_sync(&xdpu->cu[i].work);
+
 	/* clean all regs */
 	for (i = 0; i < DPU_REG_END; i += 4)
 		iowrite32(0, xdpu->regs + i);
@@ -1281,7 +2102,8 @@ static int dump_show(struct seq_file *seq, void *v)
 			seq_printf(seq, "Client: %px\n", client);
 			seq_puts(seq, "Virtual Address\t\t\t\t");
 			seq_puts(seq, "Request Mem\t\tPhysical Address\t\t\t");
-			seq_puts(seq, "DMA Address\n");
+			seq_puts(seq, "DMA Address\t\t\t");
+			seq_puts(seq, "Synced To DPU\tSynced To CPU\n");
 			list_for_each_entry(h, &client->head, head) {
 				delta = (h->size) >> 10;
 				while (!(delta & 1023) && unit[1]) {
@@ -1295,9 +2117,12 @@ static int dump_show(struct seq_file *seq, void *v)
 				seq_printf(seq, "   0x%010llx-0x%010llx\t\t",
 					   h->phy_addr,
 					   h->phy_addr + h->size);
-				seq_printf(seq, "0x%010llx-0x%010llx\n",
+				seq_printf(seq, "0x%010llx-0x%010llx\t",
 					   h->dma_addr,
 					   (h->dma_addr + h->size));
+				seq_printf(seq, "%13llu\t%13llu%s\n",
+					   h->sync_to_dev, h->sync_to_cpu,
+					   h->dmabuf ? "\timported" : "");
 				delta = 0;
 				unit = units;
 			};
@@ -1366,3 +2191,4 @@ static int dpu_debugfs_init(struct xdpu_dev *xdpu)
 MODULE_DESCRIPTION(DRIVER_DESC);
 MODULE_AUTHOR("Ye Yang <ye.yang@xilinx.com>");
 MODULE_LICENSE("GPL v2");
+MODULE_IMPORT_NS(DMA_BUF);
@@ -14,8 +14,9 @@
 
 /* up to 4 dpu cores and 1 softmax core */
 #define MAX_CU_NUM		5
+/* jobs submitted and not yet reaped, per client */
+#define DPU_MAX_JOBS		64
 #define TIMEOUT			(timeout * CONFIG_HZ)
-#define TIMEOUT_US		(timeout * 1000000)
 #define POLL_PERIOD_US		(2000)
 
 #define in_range(b, start, len) (		\
@@ -104,6 +105,11 @@ enum DPU_DMA_DIR {
 	DPU_TO_CPU = 1
 };
 
+enum DPU_JOB_TYPE {
+	DPU_JOB_KERNEL = 0,
+	DPU_JOB_SOFTMAX = 1
+};
+
 struct dpcma_req_free {
 	u64 dma_addr;
 	size_t capacity;
@@ -115,12 +121,27 @@ struct dpcma_req_alloc {
 	size_t capacity;
 };
 
+/*
+ * dpcma_req_sync: the range from dma_addr to dma_addr + size is synced,
+ * it may start anywhere in a buffer object but must not cross its end
+ */
 struct dpcma_req_sync {
 	u64 dma_addr;
 	size_t size;
 	int direction;
 };
 
+struct dpcma_req_export {
+	u64 dma_addr;
+	s32 fd;
+};
+
+struct dpcma_req_import {
+	s32 fd;
+	u64 dma_addr;
+	size_t capacity;
+};
+
 /**
  * struct  ioc_kernel_run_t - describe structure for each dpu ioctl
  * @addr_code:	the address for DPU code
@@ -187,6 +208,33 @@ struct ioc_softmax_t {
 	u32 offset;
 };
 
+/**
+ * struct  ioc_job_t - describe structure for each queued job
+ * @user_data:	opaque value returned along with the result
+ * @seqno:	sequence number of the job in the client, set on submission
+ * @time_submit:	the timestamp when the job was queued
+ * @time_start:	the timestamp when the job was started on a cu
+ * @time_end:	the timestamp when the job completed
+ * @type:	DPU_JOB_KERNEL or DPU_JOB_SOFTMAX
+ * @status:	0 if the job completed; otherwise -errno
+ * @run:	dpu run struct for DPU_JOB_KERNEL, @run.core_id is -1 to let
+ *		the driver pick a core and returns the core which ran the job
+ * @softmax:	softmax struct for DPU_JOB_SOFTMAX
+ */
+struct ioc_job_t {
+	u64 user_data;
+	u64 seqno;
+	u64 time_submit;
+	u64 time_start;
+	u64 time_end;
+	u32 type;
+	s32 status;
+	union {
+		struct ioc_kernel_run_t run;
+		struct ioc_softmax_t softmax;
+	};
+};
+
 #define DPU_IOC_MAGIC 'D'
 
 #define DPUIOC_CREATE_BO _IOWR(DPU_IOC_MAGIC, 1, struct dpcma_req_alloc*)
@@ -197,5 +245,10 @@ struct ioc_softmax_t {
 #define DPUIOC_RUN _IOWR(DPU_IOC_MAGIC, 6, struct ioc_kernel_run_t*)
 #define DPUIOC_RUN_SOFTMAX _IOWR(DPU_IOC_MAGIC, 7, struct ioc_softmax_t*)
 #define DPUIOC_REG_READ _IOR(DPU_IOC_MAGIC, 8, u32)
+#define DPUIOC_SUBMIT _IOWR(DPU_IOC_MAGIC, 9, struct ioc_job_t*)
+#define DPUIOC_REAP _IOR(DPU_IOC_MAGIC, 10, struct ioc_job_t*)
+#define DPUIOC_SET_EVENTFD _IOW(DPU_IOC_MAGIC, 11, s32)
+#define DPUIOC_EXPORT_BO _IOWR(DPU_IOC_MAGIC, 12, struct dpcma_req_export*)
+#define DPUIOC_IMPORT_BO _IOWR(DPU_IOC_MAGIC, 13, struct dpcma_req_import*)
 
 #endif /* _DPU_UAPI_H_ */
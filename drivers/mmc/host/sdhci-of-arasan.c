@@ -16,6 +16,7 @@
  */
 
 #include <linux/clk-provider.h>
+#include <linux/debugfs.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
@@ -38,8 +39,16 @@
 #define SDHCI_ARASAN_OTAPDLY_SEL_MASK	0x3F
 
 #define SDHCI_ARASAN_CQE_BASE_ADDR	0x200
+#define SDHCI_ARASAN_CQE_NR_TAGS	32
 #define VENDOR_ENHANCED_STROBE		BIT(0)
 
+/*
+ * Largest request with ADMA2: the descriptor table holds SDHCI_MAX_SEGS
+ * segments of 64 KiB, the auto retuning of tuning mode 3 limits the
+ * transfers to 4 MiB.
+ */
+#define SDHCI_ARASAN_ADMA_MAX_REQ_SIZE	SZ_4M
+
 #define PHY_CLK_TOO_SLOW_HZ		400000
 #define MIN_PHY_CLK_HZ			50000000
 
@@ -165,6 +174,30 @@ struct sdhci_arasan_clk_data {
 	void		*clk_of_data;
 };
 
+/**
+ * struct sdhci_arasan_stats - Request statistics of the host
+ * @lock:		Protects the statistics
+ * @reqs:		Number of completed requests
+ * @bytes:		Data bytes of the completed requests
+ * @lat_total_ns:	Sum of the latencies of the completed requests
+ * @lat_max_ns:		Highest latency of a completed request
+ * @reset_ns:		Time the statistics were last reset
+ * @start_ns:		Issue time of the requests in flight, per CQE tag
+ * @start_bytes:	Data bytes of the requests in flight, per CQE tag
+ *
+ * Without the CQE the host runs one request at a time, in the slot of tag 0.
+ */
+struct sdhci_arasan_stats {
+	spinlock_t	lock;
+	u64		reqs;
+	u64		bytes;
+	u64		lat_total_ns;
+	u64		lat_max_ns;
+	u64		reset_ns;
+	u64		start_ns[SDHCI_ARASAN_CQE_NR_TAGS];
+	unsigned int	start_bytes[SDHCI_ARASAN_CQE_NR_TAGS];
+};
+
 /**
  * struct sdhci_arasan_data - Arasan Controller Data
  *
@@ -174,6 +207,9 @@ struct sdhci_arasan_clk_data {
  * @is_phy_on:		True if the PHY is on; false if not.
  * @internal_phy_reg:	True if the PHY is within the Host controller.
  * @has_cqe:		True if controller has command queuing engine.
+ * @cqe_ops:		CQE operations, accounting the requests issued by cqhci.
+ * @cqhci_cqe_ops:	CQE operations of cqhci.
+ * @stats:		Request statistics of the host.
  * @clk_data:		Struct for the Arasan Controller Clock Data.
  * @clk_ops:		Struct for the Arasan Controller Clock Operations.
  * @soc_ctl_base:	Pointer to regmap for syscon for soc_ctl registers.
@@ -188,6 +224,9 @@ struct sdhci_arasan_data {
 	bool		internal_phy_reg;
 
 	bool		has_cqe;
+	struct mmc_cqe_ops cqe_ops;
+	const struct mmc_cqe_ops *cqhci_cqe_ops;
+	struct sdhci_arasan_stats stats;
 	struct sdhci_arasan_clk_data clk_data;
 	const struct sdhci_arasan_clk_ops *clk_ops;
 
@@ -513,6 +552,77 @@ static int sdhci_arasan_voltage_switch(struct mmc_host *mmc,
 	return -EINVAL;
 }
 
+static void sdhci_arasan_stats_start(struct sdhci_arasan_data *sdhci_arasan,
+				     unsigned int tag,
+				     struct mmc_request *mrq)
+{
+	struct sdhci_arasan_stats *stats = &sdhci_arasan->stats;
+	struct mmc_data *data = mrq->data;
+
+	stats->start_ns[tag] = ktime_get_ns();
+	stats->start_bytes[tag] = data ? data->blksz * data->blocks : 0;
+}
+
+static void sdhci_arasan_stats_done(struct sdhci_arasan_data *sdhci_arasan,
+				    unsigned int tag)
+{
+	struct sdhci_arasan_stats *stats = &sdhci_arasan->stats;
+	unsigned long flags;
+	u64 lat;
+
+	if (!stats->start_ns[tag])
+		return;
+
+	lat = ktime_get_ns() - stats->start_ns[tag];
+	stats->start_ns[tag] = 0;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	stats->reqs++;
+	stats->bytes += stats->start_bytes[tag];
+	stats->lat_total_ns += lat;
+	stats->lat_max_ns = max(stats->lat_max_ns, lat);
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
+static void sdhci_arasan_request(struct mmc_host *mmc,
+				 struct mmc_request *mrq)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_arasan_data *sdhci_arasan = sdhci_pltfm_priv(pltfm_host);
+
+	sdhci_arasan_stats_start(sdhci_arasan, 0, mrq);
+	sdhci_request(mmc, mrq);
+}
+
+static void sdhci_arasan_request_done(struct sdhci_host *host,
+				      struct mmc_request *mrq)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_arasan_data *sdhci_arasan = sdhci_pltfm_priv(pltfm_host);
+
+	sdhci_arasan_stats_done(sdhci_arasan, 0);
+	mmc_request_done(host->mmc, mrq);
+}
+
+static int sdhci_arasan_cqe_request(struct mmc_host *mmc,
+				    struct mmc_request *mrq)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_arasan_data *sdhci_arasan = sdhci_pltfm_priv(pltfm_host);
+	/* cqhci issues the direct commands in the last slot */
+	unsigned int tag = mrq->cmd ? SDHCI_ARASAN_CQE_NR_TAGS - 1 : mrq->tag;
+	int ret;
+
+	sdhci_arasan_stats_start(sdhci_arasan, tag, mrq);
+	ret = sdhci_arasan->cqhci_cqe_ops->cqe_request(mmc, mrq);
+	if (ret)
+		sdhci_arasan->stats.start_ns[tag] = 0;
+
+	return ret;
+}
+
 static const struct sdhci_ops sdhci_arasan_ops = {
 	.set_clock = sdhci_arasan_set_clock,
 	.get_max_clock = sdhci_pltfm_clk_get_max_clock,
@@ -521,18 +631,29 @@ static const struct sdhci_ops sdhci_arasan_ops = {
 	.reset = sdhci_arasan_reset,
 	.set_uhs_signaling = sdhci_set_uhs_signaling,
 	.set_power = sdhci_set_power_and_bus_voltage,
+	.request_done = sdhci_arasan_request_done,
 };
 
 static u32 sdhci_arasan_cqhci_irq(struct sdhci_host *host, u32 intmask)
 {
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_arasan_data *sdhci_arasan = sdhci_pltfm_priv(pltfm_host);
+	unsigned long done;
+	unsigned int tag;
 	int cmd_error = 0;
 	int data_error = 0;
 
 	if (!sdhci_cqe_irq(host, intmask, &cmd_error, &data_error))
 		return intmask;
 
+	/* cqhci_irq() clears the notifications of the completed tasks */
+	done = cqhci_readl(host->mmc->cqe_private, CQHCI_TCN);
+
 	cqhci_irq(host->mmc, intmask, cmd_error, data_error);
 
+	for_each_set_bit(tag, &done, SDHCI_ARASAN_CQE_NR_TAGS)
+		sdhci_arasan_stats_done(sdhci_arasan, tag);
+
 	return 0;
 }
 
@@ -570,6 +691,7 @@ static const struct sdhci_ops sdhci_arasan_cqe_ops = {
 	.set_uhs_signaling = sdhci_set_uhs_signaling,
 	.set_power = sdhci_set_power_and_bus_voltage,
 	.irq = sdhci_arasan_cqhci_irq,
+	.request_done = sdhci_arasan_request_done,
 };
 
 static const struct sdhci_pltfm_data sdhci_arasan_cqe_pdata = {
@@ -1443,7 +1565,7 @@ static const struct sdhci_pltfm_data sdhci_arasan_zynqmp_pdata = {
 };
 
 static const struct sdhci_pltfm_data sdhci_arasan_versal_net_pdata = {
-	.ops = &sdhci_arasan_ops,
+	.ops = &sdhci_arasan_cqe_ops,
 	.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN |
 			SDHCI_QUIRK2_CLOCK_DIV_ZERO_BROKEN |
 			SDHCI_QUIRK2_STOP_WITH_TC |
@@ -1822,6 +1944,88 @@ static int sdhci_zynqmp_set_dynamic_config(struct device *dev,
 	return 0;
 }
 
+static int sdhci_arasan_stats_show(struct seq_file *s, void *unused)
+{
+	struct sdhci_arasan_data *sdhci_arasan = s->private;
+	struct sdhci_arasan_stats *stats = &sdhci_arasan->stats;
+	u64 reqs, bytes, lat_total, lat_max, span;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	reqs = stats->reqs;
+	bytes = stats->bytes;
+	lat_total = stats->lat_total_ns;
+	lat_max = stats->lat_max_ns;
+	span = ktime_get_ns() - stats->reset_ns;
+	spin_unlock_irqrestore(&stats->lock, flags);
+
+	seq_printf(s, "requests: %llu\n", reqs);
+	seq_printf(s, "bytes: %llu\n", bytes);
+	seq_printf(s, "iops: %llu\n",
+		   span ? div64_u64(reqs * NSEC_PER_SEC, span) : 0);
+	seq_printf(s, "kB/s: %llu\n",
+		   span ? div64_u64(bytes * (NSEC_PER_SEC / 1000), span) : 0);
+	seq_printf(s, "latency_avg_us: %llu\n",
+		   reqs ? div64_u64(lat_total, reqs * NSEC_PER_USEC) : 0);
+	seq_printf(s, "latency_max_us: %llu\n",
+		   div_u64(lat_max, NSEC_PER_USEC));
+
+	return 0;
+}
+
+static int sdhci_arasan_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sdhci_arasan_stats_show, inode->i_private);
+}
+
+/* Writing anything resets the statistics */
+static ssize_t sdhci_arasan_stats_write(struct file *file,
+					const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	struct sdhci_arasan_data *sdhci_arasan = file_inode(file)->i_private;
+	struct sdhci_arasan_stats *stats = &sdhci_arasan->stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	stats->reqs = 0;
+	stats->bytes = 0;
+	stats->lat_total_ns = 0;
+	stats->lat_max_ns = 0;
+	stats->reset_ns = ktime_get_ns();
+	spin_unlock_irqrestore(&stats->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations sdhci_arasan_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sdhci_arasan_stats_open,
+	.read		= seq_read,
+	.write		= sdhci_arasan_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/**
+ * sdhci_arasan_probe_cqe - Check if the controller has a CQE
+ * @sdhci_arasan:	Our private data structure.
+ *
+ * The Versal NET eMMC controller is built with or without the command
+ * queuing engine, whose version register reads as zero when it is absent.
+ *
+ * Return: true if the controller has a CQE.
+ */
+static bool sdhci_arasan_probe_cqe(struct sdhci_arasan_data *sdhci_arasan)
+{
+	struct sdhci_host *host = sdhci_arasan->host;
+	u32 ver;
+
+	ver = readl(host->ioaddr + SDHCI_ARASAN_CQE_BASE_ADDR + CQHCI_VER);
+
+	return CQHCI_VER_MAJOR(ver) >= 5;
+}
+
 static int sdhci_arasan_add_host(struct sdhci_arasan_data *sdhci_arasan)
 {
 	struct sdhci_host *host = sdhci_arasan->host;
@@ -1829,13 +2033,31 @@ static int sdhci_arasan_add_host(struct sdhci_arasan_data *sdhci_arasan)
 	bool dma64;
 	int ret;
 
-	if (!sdhci_arasan->has_cqe)
-		return sdhci_add_host(host);
+	spin_lock_init(&sdhci_arasan->stats.lock);
+	sdhci_arasan->stats.reset_ns = ktime_get_ns();
+	host->mmc_host_ops.request = sdhci_arasan_request;
 
 	ret = sdhci_setup_host(host);
 	if (ret)
 		return ret;
 
+	/*
+	 * The 512 KiB limit of sdhci only applies to the SDMA boundary,
+	 * ADMA2 chains the descriptors of up to SDHCI_MAX_SEGS segments.
+	 */
+	if (host->flags & SDHCI_USE_ADMA)
+		host->mmc->max_req_size =
+			min_t(unsigned int, SDHCI_ARASAN_ADMA_MAX_REQ_SIZE,
+			      host->mmc->max_segs * host->mmc->max_seg_size);
+
+	if (!sdhci_arasan->has_cqe) {
+		ret = __sdhci_add_host(host);
+		if (ret)
+			goto cleanup;
+
+		goto add_debugfs;
+	}
+
 	cq_host = devm_kzalloc(host->mmc->parent,
 			       sizeof(*cq_host), GFP_KERNEL);
 	if (!cq_host) {
@@ -1854,10 +2076,19 @@ static int sdhci_arasan_add_host(struct sdhci_arasan_data *sdhci_arasan)
 	if (ret)
 		goto cleanup;
 
+	sdhci_arasan->cqhci_cqe_ops = host->mmc->cqe_ops;
+	sdhci_arasan->cqe_ops = *host->mmc->cqe_ops;
+	sdhci_arasan->cqe_ops.cqe_request = sdhci_arasan_cqe_request;
+	host->mmc->cqe_ops = &sdhci_arasan->cqe_ops;
+
 	ret = __sdhci_add_host(host);
 	if (ret)
 		goto cleanup;
 
+add_debugfs:
+	debugfs_create_file("arasan_stats", 0644, host->mmc->debugfs_root,
+			    sdhci_arasan, &sdhci_arasan_stats_fops);
+
 	return 0;
 
 cleanup:
@@ -2021,9 +2252,18 @@ static int sdhci_arasan_probe(struct platform_device *pdev)
 			host->mmc->caps2 |= MMC_CAP2_CQE_DCMD;
 	}
 
-	if (of_device_is_compatible(np, "xlnx,versal-net-5.1-emmc"))
+	if (of_device_is_compatible(np, "xlnx,versal-net-5.1-emmc")) {
 		sdhci_arasan->internal_phy_reg = true;
 
+		if (sdhci_arasan_probe_cqe(sdhci_arasan)) {
+			sdhci_arasan->has_cqe = true;
+			host->mmc->caps2 |= MMC_CAP2_CQE;
+
+			if (!of_property_read_bool(np, "disable-cqe-dcmd"))
+				host->mmc->caps2 |= MMC_CAP2_CQE_DCMD;
+		}
+	}
+
 	ret = sdhci_arasan_add_host(sdhci_arasan);
 	if (ret)
 		goto err_add_host;
@@ -13,17 +13,20 @@
 #include <linux/bch.h>
 #include <linux/bitfield.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/gpio/consumer.h>
 #include <linux/interrupt.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
 #include <linux/mtd/rawnand.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #define PKT_REG				0x00
@@ -120,6 +123,11 @@
 
 static struct gpio_desc *anfc_default_cs_array[2] = {NULL, NULL};
 
+static bool read_ahead = true;
+module_param(read_ahead, bool, 0644);
+MODULE_PARM_DESC(read_ahead,
+		 "Read the next page of sequential reads while the current one is checked (default: true)");
+
 /**
  * struct anfc_op - Defines how to execute an operation
  * @pkt_reg: Packet register
@@ -167,6 +175,8 @@ struct anfc_op {
  * @cs_idx:		Array of chip-select for this device, values are indexes
  *			of the controller structure @gpio_cs array
  * @ncs_idx:		Size of the @cs_idx array
+ * @ra_buf:		Buffer the next page is read ahead into
+ * @ra_next_page:	Page that continues the current sequential read
  */
 struct anand {
 	struct list_head node;
@@ -187,6 +197,8 @@ struct anand {
 	struct bch_control *bch;
 	int *cs_idx;
 	int ncs_idx;
+	u8 *ra_buf;
+	int ra_next_page;
 };
 
 /**
@@ -205,6 +217,16 @@ struct anand {
  * @native_cs:		Currently selected native CS
  * @spare_cs:		Native CS that is not wired (may be selected when a GPIO
  *			CS is in use)
+ * @ra_chip:		Chip with a page read ahead in flight, if any
+ * @ra_page:		Page read ahead
+ * @ra_cs:		Target of the page read ahead
+ * @ra_dma:		DMA address of the read ahead buffer
+ * @dbg_dir:		debugfs directory of the controller
+ * @pages_read:		Number of pages read with the hardware ECC engine
+ * @ra_hits:		Number of @pages_read that were read ahead
+ * @ra_drops:		Number of pages read ahead and then not used
+ * @read_ns:		Time spent reading @pages_read
+ * @read_bytes:		Number of bytes of @pages_read
  */
 struct arasan_nfc {
 	struct device *dev;
@@ -219,6 +241,16 @@ struct arasan_nfc {
 	int cur_cs;
 	unsigned int native_cs;
 	unsigned int spare_cs;
+	struct anand *ra_chip;
+	int ra_page;
+	int ra_cs;
+	dma_addr_t ra_dma;
+	struct dentry *dbg_dir;
+	u64 pages_read;
+	u64 ra_hits;
+	u64 ra_drops;
+	u64 read_ns;
+	u64 read_bytes;
 };
 
 static struct anand *to_anand(struct nand_chip *nand)
@@ -389,16 +421,11 @@ static int anfc_select_target(struct nand_chip *chip, int target)
  * reports uncorrectable errors. Because of this bug, we have to use the
  * software BCH implementation in the read path.
  */
-static int anfc_read_page_hw_ecc(struct nand_chip *chip, u8 *buf,
-				 int oob_required, int page)
+static void anfc_start_page_read(struct nand_chip *chip, int page,
+				 dma_addr_t dma_addr)
 {
 	struct arasan_nfc *nfc = to_anfc(chip->controller);
-	struct mtd_info *mtd = nand_to_mtd(chip);
 	struct anand *anand = to_anand(chip);
-	unsigned int len = mtd->writesize + (oob_required ? mtd->oobsize : 0);
-	unsigned int max_bitflips = 0;
-	dma_addr_t dma_addr;
-	int step, ret;
 	struct anfc_op nfc_op = {
 		.pkt_reg =
 			PKT_SIZE(chip->ecc.size) |
@@ -420,16 +447,100 @@ static int anfc_read_page_hw_ecc(struct nand_chip *chip, u8 *buf,
 		.prog_reg = PROG_PGRD,
 	};
 
+	writel_relaxed(lower_32_bits(dma_addr), nfc->base + DMA_ADDR0_REG);
+	writel_relaxed(upper_32_bits(dma_addr), nfc->base + DMA_ADDR1_REG);
+
+	anfc_trigger_op(nfc, &nfc_op);
+}
+
+static bool anfc_ra_match(struct nand_chip *chip, int page)
+{
+	struct arasan_nfc *nfc = to_anfc(chip->controller);
+
+	return nfc->ra_chip == to_anand(chip) && nfc->ra_cs == chip->cur_cs &&
+	       nfc->ra_page == page;
+}
+
+/* Wait for the page read ahead, the NAND page register then holds it */
+static int anfc_ra_complete(struct arasan_nfc *nfc)
+{
+	struct mtd_info *mtd = nand_to_mtd(&nfc->ra_chip->chip);
+	int ret;
+
+	ret = anfc_wait_for_event(nfc, XFER_COMPLETE);
+	dma_unmap_single(nfc->dev, nfc->ra_dma, mtd->writesize,
+			 DMA_FROM_DEVICE);
+	nfc->ra_chip = NULL;
+
+	return ret;
+}
+
+/* To be called before any other access to the controller */
+static void anfc_ra_drain(struct arasan_nfc *nfc)
+{
+	if (!nfc->ra_chip)
+		return;
+
+	anfc_ra_complete(nfc);
+	nfc->ra_drops++;
+}
+
+/*
+ * Once a read is sequential, start reading the next page of the same block
+ * while the current one goes through the software BCH decoder.
+ */
+static void anfc_ra_start(struct nand_chip *chip, int page)
+{
+	struct arasan_nfc *nfc = to_anfc(chip->controller);
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	struct anand *anand = to_anand(chip);
+	int pages_per_block = 1 << (chip->phys_erase_shift - chip->page_shift);
+	bool sequential = page == anand->ra_next_page;
+	dma_addr_t dma_addr;
+
+	anand->ra_next_page = page + 1;
+	if (!READ_ONCE(read_ahead) || !anand->ra_buf || !sequential ||
+	    !((page + 1) % pages_per_block))
+		return;
+
+	dma_addr = dma_map_single(nfc->dev, anand->ra_buf, mtd->writesize,
+				  DMA_FROM_DEVICE);
+	if (dma_mapping_error(nfc->dev, dma_addr))
+		return;
+
+	anfc_start_page_read(chip, page + 1, dma_addr);
+
+	nfc->ra_chip = anand;
+	nfc->ra_page = page + 1;
+	nfc->ra_cs = chip->cur_cs;
+	nfc->ra_dma = dma_addr;
+}
+
+static int anfc_read_page_hw_ecc(struct nand_chip *chip, u8 *buf,
+				 int oob_required, int page)
+{
+	struct arasan_nfc *nfc = to_anfc(chip->controller);
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	struct anand *anand = to_anand(chip);
+	unsigned int len = mtd->writesize + (oob_required ? mtd->oobsize : 0);
+	unsigned int max_bitflips = 0;
+	u64 start = ktime_get_ns();
+	dma_addr_t dma_addr;
+	int step, ret;
+
+	if (anfc_ra_match(chip, page) && !anfc_ra_complete(nfc)) {
+		memcpy(buf, anand->ra_buf, mtd->writesize);
+		nfc->ra_hits++;
+		goto read_oob;
+	}
+
 	dma_addr = dma_map_single(nfc->dev, (void *)buf, len, DMA_FROM_DEVICE);
 	if (dma_mapping_error(nfc->dev, dma_addr)) {
 		dev_err(nfc->dev, "Buffer mapping error");
 		return -EIO;
 	}
 
-	writel_relaxed(lower_32_bits(dma_addr), nfc->base + DMA_ADDR0_REG);
-	writel_relaxed(upper_32_bits(dma_addr), nfc->base + DMA_ADDR1_REG);
-
-	anfc_trigger_op(nfc, &nfc_op);
+	anfc_start_page_read(chip, page, dma_addr);
 
 	ret = anfc_wait_for_event(nfc, XFER_COMPLETE);
 	dma_unmap_single(nfc->dev, dma_addr, len, DMA_FROM_DEVICE);
@@ -438,12 +549,15 @@ static int anfc_read_page_hw_ecc(struct nand_chip *chip, u8 *buf,
 		return ret;
 	}
 
+read_oob:
 	/* Store the raw OOB bytes as well */
 	ret = nand_change_read_column_op(chip, mtd->writesize, chip->oob_poi,
 					 mtd->oobsize, 0);
 	if (ret)
 		return ret;
 
+	anfc_ra_start(chip, page);
+
 	/*
 	 * For each step, compute by softare the BCH syndrome over the raw data.
 	 * Compare the theoretical amount of errors and compare with the
@@ -492,14 +606,25 @@ static int anfc_read_page_hw_ecc(struct nand_chip *chip, u8 *buf,
 		}
 	}
 
+	nfc->read_ns += ktime_get_ns() - start;
+	nfc->read_bytes += mtd->writesize;
+	nfc->pages_read++;
+
 	return 0;
 }
 
 static int anfc_sel_read_page_hw_ecc(struct nand_chip *chip, u8 *buf,
 				     int oob_required, int page)
 {
+	struct arasan_nfc *nfc = to_anfc(chip->controller);
 	int ret;
 
+	/* The target is still selected for the page read ahead */
+	if (anfc_ra_match(chip, page))
+		return anfc_read_page_hw_ecc(chip, buf, oob_required, page);
+
+	anfc_ra_drain(nfc);
+
 	ret = anfc_select_target(chip, chip->cur_cs);
 	if (ret)
 		return ret;
@@ -572,6 +697,8 @@ static int anfc_sel_write_page_hw_ecc(struct nand_chip *chip, const u8 *buf,
 {
 	int ret;
 
+	anfc_ra_drain(to_anfc(chip->controller));
+
 	ret = anfc_select_target(chip, chip->cur_cs);
 	if (ret)
 		return ret;
@@ -952,6 +1079,8 @@ static int anfc_exec_op(struct nand_chip *chip,
 	if (check_only)
 		return anfc_check_op(chip, op);
 
+	anfc_ra_drain(to_anfc(chip->controller));
+
 	ret = anfc_select_target(chip, op->cs);
 	if (ret)
 		return ret;
@@ -1185,6 +1314,10 @@ static int anfc_init_hw_ecc_controller(struct arasan_nfc *nfc,
 	if (!anand->hw_ecc)
 		return -ENOMEM;
 
+	/* Reading ahead is only an optimization */
+	anand->ra_buf = devm_kmalloc(nfc->dev, mtd->writesize, GFP_KERNEL);
+	anand->ra_next_page = -1;
+
 	/* Enforce bit swapping to fit the hardware */
 	anand->bch = bch_init(bch_gf_mag, ecc->strength, bch_prim_poly, true);
 	if (!anand->bch)
@@ -1352,6 +1485,8 @@ static void anfc_chips_cleanup(struct arasan_nfc *nfc)
 	struct nand_chip *chip;
 	int ret;
 
+	anfc_ra_drain(nfc);
+
 	list_for_each_entry_safe(anand, tmp, &nfc->chips, node) {
 		chip = &anand->chip;
 		ret = mtd_device_unregister(nand_to_mtd(chip));
@@ -1435,6 +1570,26 @@ static int anfc_parse_cs(struct arasan_nfc *nfc)
 	return 0;
 }
 
+static int anfc_read_stats_show(struct seq_file *s, void *data)
+{
+	struct arasan_nfc *nfc = s->private;
+	u64 kbps = 0;
+
+	if (nfc->read_ns)
+		kbps = div64_u64(nfc->read_bytes * NSEC_PER_SEC,
+				 nfc->read_ns * 1024);
+
+	seq_printf(s, "pages: %llu\n", nfc->pages_read);
+	seq_printf(s, "read ahead: %llu\n", nfc->ra_hits);
+	seq_printf(s, "read ahead dropped: %llu\n", nfc->ra_drops);
+	seq_printf(s, "bytes: %llu\n", nfc->read_bytes);
+	seq_printf(s, "throughput: %llu.%03llu MB/s\n", div_u64(kbps, 1024),
+		   div_u64((kbps % 1024) * 1000, 1024));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(anfc_read_stats);
+
 static int anfc_probe(struct platform_device *pdev)
 {
 	struct arasan_nfc *nfc;
@@ -1485,6 +1640,10 @@ static int anfc_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, nfc);
 
+	nfc->dbg_dir = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("read_stats", 0400, nfc->dbg_dir, nfc,
+			    &anfc_read_stats_fops);
+
 	return 0;
 
 disable_bus_clk:
@@ -1500,6 +1659,7 @@ static int anfc_remove(struct platform_device *pdev)
 {
 	struct arasan_nfc *nfc = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(nfc->dbg_dir);
 	anfc_chips_cleanup(nfc);
 
 	clk_disable_unprepare(nfc->bus_clk);
@@ -74,6 +74,7 @@
 #include <linux/crc32.h>
 #include <linux/math64.h>
 #include <linux/random.h>
+#include <linux/workqueue.h>
 #include "ubi.h"
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
@@ -926,31 +927,79 @@ static bool vol_ignored(int vol_id)
 #endif
 }
 
+/*
+ * Number of PEBs whose headers are read in parallel before they are processed
+ * when scanning with several threads.
+ */
+#define UBI_SCAN_WINDOW 64
+
 /**
- * scan_peb - scan and process UBI headers of a PEB.
+ * struct ubi_scan_peb - UBI headers of a PEB read for scanning.
+ * @bad: return value of 'ubi_io_is_bad()'
+ * @ec_err: return value of 'ubi_io_read_ec_hdr()'
+ * @vid_err: return value of 'ubi_io_read_vid_hdr()'
+ * @ech: EC header
+ * @vidb: VID header
+ */
+struct ubi_scan_peb {
+	int bad;
+	int ec_err;
+	int vid_err;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_io_buf *vidb;
+};
+
+/**
+ * read_peb - read UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @sp: where to store the headers and the results of reading them
+ *
+ * This function only reads the headers of PEB @pnum, it does not look at them
+ * and does not touch the attaching information. So it may be called for
+ * several PEBs in parallel.
+ */
+static void read_peb(struct ubi_device *ubi, int pnum,
+		     struct ubi_scan_peb *sp)
+{
+	sp->ec_err = 0;
+	sp->vid_err = 0;
+
+	sp->bad = ubi_io_is_bad(ubi, pnum);
+	if (sp->bad)
+		return;
+
+	sp->ec_err = ubi_io_read_ec_hdr(ubi, pnum, sp->ech, 0);
+	if (sp->ec_err < 0 || sp->ec_err == UBI_IO_FF ||
+	    sp->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	sp->vid_err = ubi_io_read_vid_hdr(ubi, pnum, sp->vidb, 0);
+}
+
+/**
+ * process_peb - process UBI headers of a PEB.
  * @ubi: UBI device description object
  * @ai: attaching information
  * @pnum: the physical eraseblock number
  * @fast: true if we're scanning for a Fastmap
+ * @sp: UBI headers of the PEB as read by 'read_peb()'
  *
- * This function reads UBI headers of PEB @pnum, checks them, and adds
- * information about this PEB to the corresponding list or RB-tree in the
- * "attaching info" structure. Returns zero if the physical eraseblock was
- * successfully handled and a negative error code in case of failure.
+ * This function checks the UBI headers of PEB @pnum, and adds information
+ * about this PEB to the corresponding list or RB-tree in the "attaching info"
+ * structure. Returns zero if the physical eraseblock was successfully handled
+ * and a negative error code in case of failure.
  */
-static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, bool fast)
+static int process_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		       int pnum, bool fast, struct ubi_scan_peb *sp)
 {
-	struct ubi_ec_hdr *ech = ai->ech;
-	struct ubi_vid_io_buf *vidb = ai->vidb;
-	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
+	struct ubi_ec_hdr *ech = sp->ech;
+	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(sp->vidb);
 	long long ec;
 	int err, bitflips = 0, vol_id = -1, ec_err = 0;
 
-	dbg_bld("scan PEB %d", pnum);
-
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = sp->bad;
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -958,7 +1007,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = sp->ec_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1041,7 +1090,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	err = sp->vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1193,6 +1242,152 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	return 0;
 }
 
+/**
+ * scan_peb - scan and process UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @ai: attaching information
+ * @pnum: the physical eraseblock number
+ * @fast: true if we're scanning for a Fastmap
+ *
+ * This function reads UBI headers of PEB @pnum, checks them, and adds
+ * information about this PEB to the corresponding list or RB-tree in the
+ * "attaching info" structure. Returns zero if the physical eraseblock was
+ * successfully handled and a negative error code in case of failure.
+ */
+static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		    int pnum, bool fast)
+{
+	struct ubi_scan_peb sp = {
+		.ech = ai->ech,
+		.vidb = ai->vidb,
+	};
+
+	dbg_bld("scan PEB %d", pnum);
+
+	read_peb(ubi, pnum, &sp);
+	return process_peb(ubi, ai, pnum, fast, &sp);
+}
+
+struct ubi_scan_ctx;
+
+/**
+ * struct ubi_scan_work - a thread reading UBI headers.
+ * @work: the work running the thread
+ * @ctx: the parallel scanning context
+ */
+struct ubi_scan_work {
+	struct work_struct work;
+	struct ubi_scan_ctx *ctx;
+};
+
+/**
+ * struct ubi_scan_ctx - parallel scanning context.
+ * @ubi: UBI device description object
+ * @pebs: UBI headers of the PEBs of the current window
+ * @start: first PEB of the current window
+ * @count: number of PEBs in the current window
+ * @next: index of the next PEB of the window to read
+ * @nr_works: number of threads reading in addition to the scanning one
+ * @works: the additional threads
+ */
+struct ubi_scan_ctx {
+	struct ubi_device *ubi;
+	struct ubi_scan_peb pebs[UBI_SCAN_WINDOW];
+	int start;
+	int count;
+	atomic_t next;
+	int nr_works;
+	struct ubi_scan_work works[];
+};
+
+static void read_window(struct ubi_scan_ctx *ctx)
+{
+	int i;
+
+	while ((i = atomic_inc_return(&ctx->next) - 1) < ctx->count)
+		read_peb(ctx->ubi, ctx->start + i, &ctx->pebs[i]);
+}
+
+static void read_window_work(struct work_struct *work)
+{
+	struct ubi_scan_work *sw = container_of(work, struct ubi_scan_work,
+						work);
+
+	read_window(sw->ctx);
+}
+
+/**
+ * scan_parallel - scan PEBs with several threads.
+ * @ubi: UBI device description object
+ * @ai: attach info object
+ * @start: start scanning at this PEB
+ * @threads: number of threads reading the UBI headers
+ *
+ * The PEBs are scanned by windows of %UBI_SCAN_WINDOW PEBs. The headers of
+ * all the PEBs of a window are read by @threads threads, this thread being
+ * one of them, and are then processed in order by this thread. So the
+ * attaching information is built exactly as by a serial scan, but the MTD
+ * driver has several reads to handle at once and reads of different chips or
+ * planes may overlap. Returns zero in case of success and a negative error
+ * code in case of failure.
+ */
+static int scan_parallel(struct ubi_device *ubi, struct ubi_attach_info *ai,
+			 int start, int threads)
+{
+	struct ubi_scan_ctx *ctx;
+	int i, pnum, err = -ENOMEM;
+
+	ctx = kzalloc(struct_size(ctx, works, threads - 1), GFP_KERNEL);
+	if (!ctx)
+		return err;
+
+	ctx->ubi = ubi;
+	for (i = 0; i < UBI_SCAN_WINDOW; i++) {
+		ctx->pebs[i].ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+		ctx->pebs[i].vidb = ubi_alloc_vid_buf(ubi, GFP_KERNEL);
+		if (!ctx->pebs[i].ech || !ctx->pebs[i].vidb)
+			goto out_free;
+	}
+
+	ctx->nr_works = threads - 1;
+	for (i = 0; i < ctx->nr_works; i++) {
+		INIT_WORK(&ctx->works[i].work, read_window_work);
+		ctx->works[i].ctx = ctx;
+	}
+
+	for (pnum = start; pnum < ubi->peb_count; pnum += ctx->count) {
+		ctx->start = pnum;
+		ctx->count = min(UBI_SCAN_WINDOW, ubi->peb_count - pnum);
+		atomic_set(&ctx->next, 0);
+
+		for (i = 0; i < ctx->nr_works; i++)
+			queue_work(system_unbound_wq, &ctx->works[i].work);
+		read_window(ctx);
+		for (i = 0; i < ctx->nr_works; i++)
+			flush_work(&ctx->works[i].work);
+
+		for (i = 0; i < ctx->count; i++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum + i);
+			err = process_peb(ubi, ai, pnum + i, false,
+					  &ctx->pebs[i]);
+			if (err < 0)
+				goto out_free;
+		}
+	}
+
+	err = 0;
+
+out_free:
+	for (i = 0; i < UBI_SCAN_WINDOW; i++) {
+		ubi_free_vid_buf(ctx->pebs[i].vidb);
+		kfree(ctx->pebs[i].ech);
+	}
+	kfree(ctx);
+	return err;
+}
+
 /**
  * late_analysis - analyze the overall situation with PEB.
  * @ubi: UBI device description object
@@ -1374,7 +1569,7 @@ static void destroy_ai(struct ubi_attach_info *ai)
 static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int start)
 {
-	int err, pnum;
+	int err, pnum, threads;
 	struct rb_node *rb1, *rb2;
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
@@ -1389,13 +1584,20 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
-
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, false);
-		if (err < 0)
+	threads = clamp(ubi->scan_threads, 1, UBI_SCAN_WINDOW);
+	if (threads > 1) {
+		err = scan_parallel(ubi, ai, start, threads);
+		if (err)
 			goto out_vidh;
+	} else {
+		for (pnum = start; pnum < ubi->peb_count; pnum++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum);
+			err = scan_peb(ubi, ai, pnum, false);
+			if (err < 0)
+				goto out_vidh;
+		}
 	}
 
 	ubi_msg(ubi, "scanning is finished");
@@ -1556,6 +1758,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 {
 	int err;
 	struct ubi_attach_info *ai;
+	ktime_t start = ktime_get();
 
 	ai = alloc_ai();
 	if (!ai)
@@ -1591,6 +1794,8 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	if (err)
 		goto out_ai;
 
+	ubi->dbg.attach_scan_us = ktime_us_delta(ktime_get(), start);
+
 	ubi->bad_peb_count = ai->bad_peb_count;
 	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
 	ubi->corr_peb_count = ai->corr_peb_count;
@@ -1610,7 +1815,14 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	if (err)
 		goto out_wl;
 
+	ubi->dbg.attach_us = ktime_us_delta(ktime_get(), start);
+	dbg_gen("attached by %s in %llu us",
+		ubi->fast_attach ? "fastmap" : "scanning", ubi->dbg.attach_us);
+
 #ifdef CONFIG_MTD_UBI_FASTMAP
+	/* The fastmap we attached from is up to date */
+	ubi->fm_sqnum = ubi->global_sqnum;
+
 	if (ubi->fm && ubi_dbg_chk_fastmap(ubi)) {
 		struct ubi_attach_info *scan_ai;
 
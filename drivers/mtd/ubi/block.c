@@ -25,6 +25,11 @@
  * to allow early creation of block devices on top of UBI volumes. Runtime
  * block creation/removal for UBI volumes is provided through two UBI ioctls:
  * UBI_IOCVOLCRBLK and UBI_IOCVOLRMBLK.
+ *
+ * Each block device has a hardware queue per online CPU and its requests are
+ * read by a pool of 'block_readers' workers, so that several LEBs may be read
+ * at once. Requests may span LEB boundaries, which lets the block layer merge
+ * the readahead of consecutive LEBs into large requests.
  */
 
 #include <linux/module.h>
@@ -55,6 +60,15 @@
 /* Maximum number of comma-separated items in the 'block=' parameter */
 #define UBIBLOCK_PARAM_COUNT 2
 
+/* Default number of requests of a device being read at once */
+#define UBIBLOCK_DEF_READERS 4
+
+/*
+ * Maximum size of a request, so that it fits in the UBI_MAX_SG_COUNT entries
+ * of the scatter list even if none of its pages are contiguous.
+ */
+#define UBIBLOCK_MAX_SECTORS ((UBI_MAX_SG_COUNT * PAGE_SIZE) >> SECTOR_SHIFT)
+
 struct ubiblock_param {
 	int ubi_num;
 	int vol_id;
@@ -72,6 +86,17 @@ static int ubiblock_devs __initdata;
 /* MTD devices specification parameters */
 static struct ubiblock_param ubiblock_param[UBIBLOCK_MAX_DEVICES] __initdata;
 
+/* Number of hardware queues of a device, 0 for one per online CPU */
+static unsigned int ubiblock_hw_queues;
+module_param_named(block_hw_queues, ubiblock_hw_queues, uint, 0444);
+MODULE_PARM_DESC(block_hw_queues, "Number of hardware queues of a UBI block device (default: number of online CPUs)");
+
+/* Number of requests of a device read at once */
+static unsigned int ubiblock_readers = UBIBLOCK_DEF_READERS;
+module_param_named(block_readers, ubiblock_readers, uint, 0444);
+MODULE_PARM_DESC(block_readers, "Number of requests of a UBI block device read in parallel (default: "
+		 __stringify(UBIBLOCK_DEF_READERS) ")");
+
 struct ubiblock {
 	struct ubi_volume_desc *desc;
 	int ubi_num;
@@ -404,7 +429,7 @@ int ubiblock_create(struct ubi_volume_info *vi)
 	dev->tag_set.flags = BLK_MQ_F_SHOULD_MERGE;
 	dev->tag_set.cmd_size = sizeof(struct ubiblock_pdu);
 	dev->tag_set.driver_data = dev;
-	dev->tag_set.nr_hw_queues = 1;
+	dev->tag_set.nr_hw_queues = ubiblock_hw_queues ?: num_online_cpus();
 
 	ret = blk_mq_alloc_tag_set(&dev->tag_set);
 	if (ret) {
@@ -438,12 +463,19 @@ int ubiblock_create(struct ubi_volume_info *vi)
 
 	dev->rq = gd->queue;
 	blk_queue_max_segments(dev->rq, UBI_MAX_SG_COUNT);
+	blk_queue_max_hw_sectors(dev->rq, UBIBLOCK_MAX_SECTORS);
+	/* Make readahead cover whole LEBs, they are read one at a time */
+	blk_queue_io_opt(dev->rq, dev->leb_size);
 
 	/*
 	 * Create one workqueue per volume (per registered block device).
-	 * Remember workqueues are cheap, they're not threads.
+	 * Remember workqueues are cheap, they're not threads. It is unbound so
+	 * that up to 'block_readers' requests are read at once whatever the
+	 * CPUs they were submitted from.
 	 */
-	dev->wq = alloc_workqueue("%s", 0, 0, gd->disk_name);
+	dev->wq = alloc_workqueue("%s", WQ_UNBOUND,
+				  clamp_val(ubiblock_readers, 1, WQ_MAX_ACTIVE),
+				  gd->disk_name);
 	if (!dev->wq) {
 		ret = -ENOMEM;
 		goto out_remove_minor;
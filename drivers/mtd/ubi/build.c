@@ -70,8 +70,20 @@ static struct mtd_dev_param mtd_dev_param[UBI_MAX_DEVICES];
 /* UBI module parameter to enable fastmap automatically on non-fastmap images */
 static bool fm_autoconvert;
 static bool fm_debug;
+/* Interval of the background fastmap refresh in seconds, 0 to disable it */
+static unsigned int fm_refresh = 60;
 #endif
 
+/* Number of threads reading UBI headers when scanning, 0 for automatic */
+static unsigned int scan_threads;
+
+/*
+ * How long foreground I/O has to be idle before the background thread moves
+ * a PEB, and how long it defers a move at most, in ms
+ */
+static unsigned int wl_idle_ms = 20;
+static unsigned int wl_max_defer_ms = 1000;
+
 /* Slab cache for wear-leveling entries */
 struct kmem_cache *ubi_wl_entry_slab;
 
@@ -929,6 +941,7 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	ubi->fm_disabled = (!fm_autoconvert || disable_fm) ? 1 : 0;
 	if (fm_debug)
 		ubi_enable_dbg_chk_fastmap(ubi);
+	ubi->fm_refresh = fm_refresh;
 
 	if (!ubi->fm_disabled && (int)mtd_div_by_eb(ubi->mtd->size, ubi->mtd)
 	    <= UBI_FM_MAX_START) {
@@ -943,6 +956,11 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 #else
 	ubi->fm_disabled = 1;
 #endif
+	ubi->scan_threads = scan_threads ?:
+			    min_t(int, num_online_cpus(), UBI_SCAN_MAX_THREADS);
+	ubi->wl_idle = msecs_to_jiffies(wl_idle_ms);
+	ubi->wl_max_defer = msecs_to_jiffies(wl_max_defer_ms);
+
 	mutex_init(&ubi->buf_mutex);
 	mutex_init(&ubi->ckvol_mutex);
 	mutex_init(&ubi->device_mutex);
@@ -1024,6 +1042,12 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	wake_up_process(ubi->bgt_thread);
 	spin_unlock(&ubi->wl_lock);
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	if (ubi->fm_refresh && !ubi->fm_disabled)
+		schedule_delayed_work(&ubi->fm_refresh_work,
+				      ubi->fm_refresh * HZ);
+#endif
+
 	ubi_devices[ubi_num] = ubi;
 	ubi_notify_all(ubi, UBI_VOLUME_ADDED, NULL);
 	return ubi_num;
@@ -1086,6 +1110,8 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	ubi_notify_all(ubi, UBI_VOLUME_REMOVED, NULL);
 	ubi_msg(ubi, "detaching mtd%d", ubi->mtd->index);
 #ifdef CONFIG_MTD_UBI_FASTMAP
+	cancel_delayed_work_sync(&ubi->fm_refresh_work);
+
 	/* If we don't write a new fastmap at detach time we lose all
 	 * EC updates that have been made since the last written fastmap.
 	 * In case of fastmap debugging we omit the update to simulate an
@@ -1468,7 +1494,16 @@ module_param(fm_autoconvert, bool, 0644);
 MODULE_PARM_DESC(fm_autoconvert, "Set this parameter to enable fastmap automatically on images without a fastmap.");
 module_param(fm_debug, bool, 0);
 MODULE_PARM_DESC(fm_debug, "Set this parameter to enable fastmap debugging by default. Warning, this will make fastmap slow!");
+module_param(fm_refresh, uint, 0644);
+MODULE_PARM_DESC(fm_refresh, "Interval in seconds at which a new fastmap is written in the background if the volumes changed, 0 to disable (default: 60).");
 #endif
+module_param(scan_threads, uint, 0644);
+MODULE_PARM_DESC(scan_threads, "Number of threads reading the UBI headers when attaching by scanning (default: number of online CPUs, at most "
+			       __stringify(UBI_SCAN_MAX_THREADS) ").");
+module_param(wl_idle_ms, uint, 0644);
+MODULE_PARM_DESC(wl_idle_ms, "How long foreground I/O has to be idle before a PEB is moved for wear-leveling or scrubbing, in ms (default: 20).");
+module_param(wl_max_defer_ms, uint, 0644);
+MODULE_PARM_DESC(wl_max_defer_ms, "How long a PEB move is deferred at most waiting for foreground I/O to be idle, in ms, 0 to not throttle the moves (default: 1000).");
 MODULE_VERSION(__stringify(UBI_VERSION));
 MODULE_DESCRIPTION("UBI - Unsorted Block Images");
 MODULE_AUTHOR("Artem Bityutskiy");
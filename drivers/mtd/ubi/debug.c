@@ -10,6 +10,7 @@
 #include <linux/uaccess.h>
 #include <linux/module.h>
 #include <linux/seq_file.h>
+#include <linux/math64.h>
 
 
 /**
@@ -245,6 +246,52 @@ void ubi_debugfs_exit(void)
 }
 
 /* Read an UBI debugfs file */
+/* Report how the device was attached and how long it took */
+static ssize_t dfs_attach_time_read(struct ubi_device *ubi,
+				    char __user *user_buf, size_t count,
+				    loff_t *ppos)
+{
+	struct ubi_debug_info *d = &ubi->dbg;
+	char buf[128];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf),
+			"method: %s\nscan_threads: %d\nscan_us: %llu\ntotal_us: %llu\n",
+			ubi->fast_attach ? "fastmap" : "scan",
+			ubi->scan_threads, d->attach_scan_us, d->attach_us);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+/* Report the PEB moves done by the wear-leveling sub-system */
+static ssize_t dfs_wl_stats_read(struct ubi_device *ubi,
+				 char __user *user_buf, size_t count,
+				 loff_t *ppos)
+{
+	unsigned long moves, scrubs, secs;
+	u64 work_ns;
+	char buf[192];
+	int len;
+
+	spin_lock(&ubi->wl_lock);
+	moves = ubi->wl_moves;
+	scrubs = ubi->wl_scrubs;
+	work_ns = ubi->wl_work_ns;
+	spin_unlock(&ubi->wl_lock);
+
+	secs = max((jiffies - ubi->wl_start) / HZ, 1UL);
+
+	len = scnprintf(buf, sizeof(buf),
+			"wl_moves: %lu\nscrub_moves: %lu\nmoves_per_sec: %lu.%02lu\nmove_time_us: %llu\nthrottle_time_us: %llu\n",
+			moves, scrubs, (moves + scrubs) / secs,
+			(moves + scrubs) * 100 / secs % 100,
+			div_u64(work_ns, NSEC_PER_USEC),
+			div_u64(READ_ONCE(ubi->wl_throttle_ns),
+				NSEC_PER_USEC));
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
 static ssize_t dfs_file_read(struct file *file, char __user *user_buf,
 			     size_t count, loff_t *ppos)
 {
@@ -287,6 +334,12 @@ static ssize_t dfs_file_read(struct file *file, char __user *user_buf,
 		count = simple_read_from_buffer(user_buf, count, ppos,
 						buf, strlen(buf));
 		goto out;
+	} else if (dent == d->dfs_attach_time) {
+		count = dfs_attach_time_read(ubi, user_buf, count, ppos);
+		goto out;
+	} else if (dent == d->dfs_wl_stats) {
+		count = dfs_wl_stats_read(ubi, user_buf, count, ppos);
+		goto out;
 	}
 	else {
 		count = -EINVAL;
@@ -555,6 +608,13 @@ int ubi_debugfs_init_dev(struct ubi_device *ubi)
 						   S_IWUSR, d->dfs_dir,
 						   (void *)ubi_num, &dfs_fops);
 
+	d->dfs_attach_time = debugfs_create_file("attach_time", S_IRUSR,
+						 d->dfs_dir, (void *)ubi_num,
+						 &dfs_fops);
+
+	d->dfs_wl_stats = debugfs_create_file("wl_stats", S_IRUSR, d->dfs_dir,
+					      (void *)ubi_num, &dfs_fops);
+
 	debugfs_create_file("detailed_erase_block_info", S_IRUSR, d->dfs_dir,
 			    (void *)ubi_num, &eraseblk_count_fops);
 
@@ -19,6 +19,36 @@ static void update_fastmap_work_fn(struct work_struct *wrk)
 	spin_unlock(&ubi->wl_lock);
 }
 
+/**
+ * fm_refresh_work_fn - periodically writes a new fastmap
+ * @wrk: the work description object
+ *
+ * A new fastmap is written if there is none or if LEBs were written since the
+ * current one was, so that the next attach, even after an unclean shutdown,
+ * finds a fastmap and has only few pool PEBs to scan.
+ */
+static void fm_refresh_work_fn(struct work_struct *wrk)
+{
+	struct ubi_device *ubi = container_of(to_delayed_work(wrk),
+					      struct ubi_device,
+					      fm_refresh_work);
+	unsigned long long sqnum;
+	bool stale;
+
+	spin_lock(&ubi->ltree_lock);
+	sqnum = ubi->global_sqnum;
+	spin_unlock(&ubi->ltree_lock);
+
+	down_read(&ubi->fm_protect);
+	stale = !ubi->fm || ubi->fm_sqnum != sqnum;
+	up_read(&ubi->fm_protect);
+
+	if (stale && !ubi->ro_mode && !ubi->fm_disabled)
+		ubi_update_fastmap(ubi);
+
+	schedule_delayed_work(&ubi->fm_refresh_work, ubi->fm_refresh * HZ);
+}
+
 /**
  * find_anchor_wl_entry - find wear-leveling entry to used as anchor PEB.
  * @root: the RB-tree where to look for
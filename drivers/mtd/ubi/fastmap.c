@@ -1669,6 +1669,10 @@ int ubi_update_fastmap(struct ubi_device *ubi)
 	if (ret)
 		goto err;
 
+	spin_lock(&ubi->ltree_lock);
+	ubi->fm_sqnum = ubi->global_sqnum;
+	spin_unlock(&ubi->ltree_lock);
+
 out_unlock:
 	up_write(&ubi->fm_eba_sem);
 	up_write(&ubi->work_sem);
@@ -425,6 +425,7 @@ int ubi_leb_read(struct ubi_volume_desc *desc, int lnum, char *buf, int offset,
 	struct ubi_volume *vol = desc->vol;
 	struct ubi_device *ubi = vol->ubi;
 	int err, vol_id = vol->vol_id;
+	bool rt;
 
 	dbg_gen("read %d bytes from LEB %d:%d:%d", len, vol_id, lnum, offset);
 
@@ -435,7 +436,9 @@ int ubi_leb_read(struct ubi_volume_desc *desc, int lnum, char *buf, int offset,
 	if (len == 0)
 		return 0;
 
+	rt = ubi_fg_io_start(ubi);
 	err = ubi_eba_read_leb(ubi, vol, lnum, buf, offset, len, check);
+	ubi_fg_io_end(ubi, rt);
 	if (err && mtd_is_eccerr(err) && vol->vol_type == UBI_STATIC_VOLUME) {
 		ubi_warn(ubi, "mark volume %d as corrupted", vol_id);
 		vol->corrupted = 1;
@@ -465,6 +468,7 @@ int ubi_leb_read_sg(struct ubi_volume_desc *desc, int lnum, struct ubi_sgl *sgl,
 	struct ubi_volume *vol = desc->vol;
 	struct ubi_device *ubi = vol->ubi;
 	int err, vol_id = vol->vol_id;
+	bool rt;
 
 	dbg_gen("read %d bytes from LEB %d:%d:%d", len, vol_id, lnum, offset);
 
@@ -475,7 +479,9 @@ int ubi_leb_read_sg(struct ubi_volume_desc *desc, int lnum, struct ubi_sgl *sgl,
 	if (len == 0)
 		return 0;
 
+	rt = ubi_fg_io_start(ubi);
 	err = ubi_eba_read_leb_sg(ubi, vol, sgl, lnum, offset, len, check);
+	ubi_fg_io_end(ubi, rt);
 	if (err && mtd_is_eccerr(err) && vol->vol_type == UBI_STATIC_VOLUME) {
 		ubi_warn(ubi, "mark volume %d as corrupted", vol_id);
 		vol->corrupted = 1;
@@ -515,7 +521,8 @@ int ubi_leb_write(struct ubi_volume_desc *desc, int lnum, const void *buf,
 {
 	struct ubi_volume *vol = desc->vol;
 	struct ubi_device *ubi = vol->ubi;
-	int vol_id = vol->vol_id;
+	int err, vol_id = vol->vol_id;
+	bool rt;
 
 	dbg_gen("write %d bytes to LEB %d:%d:%d", len, vol_id, lnum, offset);
 
@@ -536,7 +543,11 @@ int ubi_leb_write(struct ubi_volume_desc *desc, int lnum, const void *buf,
 	if (len == 0)
 		return 0;
 
-	return ubi_eba_write_leb(ubi, vol, lnum, buf, offset, len);
+	rt = ubi_fg_io_start(ubi);
+	err = ubi_eba_write_leb(ubi, vol, lnum, buf, offset, len);
+	ubi_fg_io_end(ubi, rt);
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(ubi_leb_write);
 
@@ -560,7 +571,8 @@ int ubi_leb_change(struct ubi_volume_desc *desc, int lnum, const void *buf,
 {
 	struct ubi_volume *vol = desc->vol;
 	struct ubi_device *ubi = vol->ubi;
-	int vol_id = vol->vol_id;
+	int err, vol_id = vol->vol_id;
+	bool rt;
 
 	dbg_gen("atomically write %d bytes to LEB %d:%d", len, vol_id, lnum);
 
@@ -580,7 +592,11 @@ int ubi_leb_change(struct ubi_volume_desc *desc, int lnum, const void *buf,
 	if (len == 0)
 		return 0;
 
-	return ubi_eba_atomic_leb_change(ubi, vol, lnum, buf, len);
+	rt = ubi_fg_io_start(ubi);
+	err = ubi_eba_atomic_leb_change(ubi, vol, lnum, buf, len);
+	ubi_fg_io_end(ubi, rt);
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(ubi_leb_change);
 
@@ -27,6 +27,7 @@
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/ubi.h>
 #include <linux/pgtable.h>
+#include <linux/ioprio.h>
 
 #include "ubi-media.h"
 
@@ -72,6 +73,9 @@ void ubi_err(const struct ubi_device *ubi, const char *fmt, ...);
  */
 #define UBI_PROT_QUEUE_LEN 10
 
+/* Default maximum number of threads reading UBI headers when scanning */
+#define UBI_SCAN_MAX_THREADS 8
+
 /* The volume ID/LEB number/erase counter is unknown */
 #define UBI_UNKNOWN -1
 
@@ -412,6 +416,10 @@ struct ubi_volume_desc {
  * @dfs_emulate_power_cut: debugfs knob to emulate power cuts
  * @dfs_power_cut_min: debugfs knob for minimum writes before power cut
  * @dfs_power_cut_max: debugfs knob for maximum writes until power cut
+ * @dfs_attach_time: debugfs file reporting how long attaching took
+ * @dfs_wl_stats: debugfs file reporting the PEB moves statistics
+ * @attach_scan_us: time spent scanning the device when attaching, in us
+ * @attach_us: total time spent attaching the device, in us
  */
 struct ubi_debug_info {
 	unsigned int chk_gen:1;
@@ -435,6 +443,10 @@ struct ubi_debug_info {
 	struct dentry *dfs_emulate_power_cut;
 	struct dentry *dfs_power_cut_min;
 	struct dentry *dfs_power_cut_max;
+	struct dentry *dfs_attach_time;
+	struct dentry *dfs_wl_stats;
+	unsigned long long attach_scan_us;
+	unsigned long long attach_us;
 };
 
 /**
@@ -470,6 +482,8 @@ struct ubi_debug_info {
  *
  * @max_ec: current highest erase counter value
  * @mean_ec: current mean erase counter value
+ * @scan_threads: number of threads reading the UBI headers when attaching by
+ *		  scanning
  *
  * @global_sqnum: global sequence number
  * @ltree_lock: protects the lock tree and @global_sqnum
@@ -488,6 +502,9 @@ struct ubi_debug_info {
  * @fm_eba_sem: allows ubi_update_fastmap() to block EBA table changes
  * @fm_work: fastmap work queue
  * @fm_work_scheduled: non-zero if fastmap work was scheduled
+ * @fm_refresh_work: work writing a new fastmap every @fm_refresh seconds
+ * @fm_refresh: fastmap refresh interval in seconds, zero if disabled
+ * @fm_sqnum: @global_sqnum when the current fastmap was written
  * @fast_attach: non-zero if UBI was attached by fastmap
  * @fm_anchor: The next anchor PEB to use for fastmap
  * @fm_do_produce_anchor: If true produce an anchor PEB in wl
@@ -503,7 +520,7 @@ struct ubi_debug_info {
  * @wl_lock: protects the @used, @free, @pq, @pq_head, @lookuptbl, @move_from,
  *	     @move_to, @move_to_put @erase_pending, @wl_scheduled, @works,
  *	     @erroneous, @erroneous_peb_count, @fm_work_scheduled, @fm_pool,
- *	     and @fm_wl_pool fields
+ *	     @fm_wl_pool, @wl_moves, @wl_scrubs and @wl_work_ns fields
  * @move_mutex: serializes eraseblock moves
  * @work_sem: used to wait for all the scheduled works to finish and prevent
  * new works from being submitted
@@ -518,6 +535,19 @@ struct ubi_debug_info {
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
+ * @wl_idle: how long foreground I/O has to be idle before a PEB is moved by
+ *	     the background thread, in jiffies
+ * @wl_max_defer: how long the background thread defers a PEB move at most
+ *		  waiting for foreground I/O to be idle, in jiffies, zero if
+ *		  PEB moves are not throttled
+ * @wl_start: when the wear-leveling sub-system was initialized, in jiffies
+ * @wl_moves: count of PEBs moved for wear-leveling
+ * @wl_scrubs: count of PEBs moved for scrubbing
+ * @wl_work_ns: time spent moving PEBs, in ns
+ * @wl_throttle_ns: time the background thread spent deferring PEB moves, in ns
+ * @fg_inflight: count of foreground I/Os in flight
+ * @fg_rt_inflight: count of foreground I/Os of real-time priority in flight
+ * @fg_last_io: when the last foreground I/O completed, in jiffies
  *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
@@ -580,6 +610,7 @@ struct ubi_device {
 	int max_ec;
 	/* Note, mean_ec is not updated run-time - should be fixed */
 	int mean_ec;
+	int scan_threads;
 
 	/* EBA sub-system's stuff */
 	unsigned long long global_sqnum;
@@ -598,6 +629,9 @@ struct ubi_device {
 	size_t fm_size;
 	struct work_struct fm_work;
 	int fm_work_scheduled;
+	struct delayed_work fm_refresh_work;
+	unsigned int fm_refresh;
+	unsigned long long fm_sqnum;
 	int fast_attach;
 	struct ubi_wl_entry *fm_anchor;
 	int fm_do_produce_anchor;
@@ -623,6 +657,16 @@ struct ubi_device {
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
+	unsigned long wl_idle;
+	unsigned long wl_max_defer;
+	unsigned long wl_start;
+	unsigned long wl_moves;
+	unsigned long wl_scrubs;
+	u64 wl_work_ns;
+	u64 wl_throttle_ns;
+	atomic_t fg_inflight;
+	atomic_t fg_rt_inflight;
+	unsigned long fg_last_io;
 
 	/* I/O sub-system's stuff */
 	long long flash_size;
@@ -1161,6 +1205,36 @@ static inline void ubi_ro_mode(struct ubi_device *ubi)
 	}
 }
 
+/**
+ * ubi_fg_io_start - account the start of a foreground I/O.
+ * @ubi: UBI device description object
+ *
+ * This function returns whether the I/O is of real-time priority, to be
+ * passed to 'ubi_fg_io_end()'.
+ */
+static inline bool ubi_fg_io_start(struct ubi_device *ubi)
+{
+	bool rt = IOPRIO_PRIO_CLASS(get_current_ioprio()) == IOPRIO_CLASS_RT;
+
+	atomic_inc(&ubi->fg_inflight);
+	if (rt)
+		atomic_inc(&ubi->fg_rt_inflight);
+	return rt;
+}
+
+/**
+ * ubi_fg_io_end - account the end of a foreground I/O.
+ * @ubi: UBI device description object
+ * @rt: value returned by 'ubi_fg_io_start()'
+ */
+static inline void ubi_fg_io_end(struct ubi_device *ubi, bool rt)
+{
+	WRITE_ONCE(ubi->fg_last_io, jiffies);
+	if (rt)
+		atomic_dec(&ubi->fg_rt_inflight);
+	atomic_dec(&ubi->fg_inflight);
+}
+
 /**
  * vol_id2idx - get table index by volume ID.
  * @ubi: UBI device description object
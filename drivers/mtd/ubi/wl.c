@@ -122,6 +122,14 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * How many times longer than normally PEB moves are deferred while I/O of
+ * real-time priority is in flight.
+ */
+#define WL_RT_DEFER_FACTOR 4
+
+static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
+				int shutdown);
 static int self_check_ec(struct ubi_device *ubi, int pnum, int ec);
 static int self_check_in_wl_tree(const struct ubi_device *ubi,
 				 struct ubi_wl_entry *e, struct rb_root *root);
@@ -189,6 +197,8 @@ static int do_work(struct ubi_device *ubi)
 {
 	int err;
 	struct ubi_work *wrk;
+	bool wl;
+	ktime_t start;
 
 	cond_resched();
 
@@ -212,6 +222,9 @@ static int do_work(struct ubi_device *ubi)
 	ubi_assert(ubi->works_count >= 0);
 	spin_unlock(&ubi->wl_lock);
 
+	wl = wrk->func == wear_leveling_worker;
+	start = ktime_get();
+
 	/*
 	 * Call the worker function. Do not touch the work structure
 	 * after this call as it will have been freed or reused by that
@@ -222,6 +235,12 @@ static int do_work(struct ubi_device *ubi)
 		ubi_err(ubi, "work failed with error code %d", err);
 	up_read(&ubi->work_sem);
 
+	if (wl) {
+		spin_lock(&ubi->wl_lock);
+		ubi->wl_work_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		spin_unlock(&ubi->wl_lock);
+	}
+
 	return err;
 }
 
@@ -880,6 +899,10 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 	ubi_free_vid_buf(vidb);
 
 	spin_lock(&ubi->wl_lock);
+	if (scrubbing)
+		ubi->wl_scrubs += 1;
+	else
+		ubi->wl_moves += 1;
 	if (!ubi->move_to_put) {
 		wl_tree_add(e2, &ubi->used);
 		e2 = NULL;
@@ -1622,6 +1645,49 @@ static void tree_destroy(struct ubi_device *ubi, struct rb_root *root)
 	}
 }
 
+/**
+ * wl_throttle - wait for foreground I/O to calm down before moving a PEB.
+ * @ubi: UBI device description object
+ *
+ * Wear-leveling and scrubbing are not urgent, so before doing one the
+ * background thread waits until there has been no foreground I/O for
+ * @ubi->wl_idle jiffies. It waits at most @ubi->wl_max_defer jiffies, so the
+ * busier the device, the more the PEB moves are spread out. While I/O of
+ * real-time priority is in flight, moves are deferred %WL_RT_DEFER_FACTOR
+ * times longer.
+ */
+static void wl_throttle(struct ubi_device *ubi)
+{
+	unsigned long now = jiffies, deadline, rt_deadline, quiet;
+	ktime_t start;
+
+	if (!ubi->wl_max_defer)
+		return;
+
+	start = ktime_get();
+	deadline = now + ubi->wl_max_defer;
+	rt_deadline = now + ubi->wl_max_defer * WL_RT_DEFER_FACTOR;
+
+	while (!kthread_should_stop()) {
+		now = jiffies;
+		if (atomic_read(&ubi->fg_rt_inflight)) {
+			if (time_after_eq(now, rt_deadline))
+				break;
+		} else if (time_after_eq(now, deadline)) {
+			break;
+		} else {
+			quiet = READ_ONCE(ubi->fg_last_io) + ubi->wl_idle;
+			if (!atomic_read(&ubi->fg_inflight) &&
+			    time_after_eq(now, quiet))
+				break;
+		}
+
+		schedule_timeout_interruptible(1);
+	}
+
+	ubi->wl_throttle_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
 /**
  * ubi_thread - UBI background thread.
  * @u: the UBI device description object pointer
@@ -1636,6 +1702,7 @@ int ubi_thread(void *u)
 
 	set_freezable();
 	for (;;) {
+		struct ubi_work *wrk;
 		int err;
 
 		if (kthread_should_stop())
@@ -1665,8 +1732,17 @@ int ubi_thread(void *u)
 			schedule();
 			continue;
 		}
+		wrk = list_first_entry(&ubi->works, struct ubi_work, list);
 		spin_unlock(&ubi->wl_lock);
 
+		/*
+		 * Only the PEB moves are throttled, erasures are needed to
+		 * produce the free PEBs foreground writes may be waiting for.
+		 * This only peeks at the work, do_work() takes it.
+		 */
+		if (wrk->func == wear_leveling_worker)
+			wl_throttle(ubi);
+
 		err = do_work(ubi);
 		if (err) {
 			ubi_err(ubi, "%s: work failed with error code %d",
@@ -1772,6 +1848,8 @@ int ubi_wl_init(struct ubi_device *ubi, struct ubi_attach_info *ai)
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = ai->max_ec;
 	INIT_LIST_HEAD(&ubi->works);
+	ubi->wl_start = jiffies;
+	ubi->fg_last_io = jiffies;
 
 	sprintf(ubi->bgt_name, UBI_BGT_NAME_PATTERN, ubi->ubi_num);
 
@@ -3,6 +3,7 @@
 #define UBI_WL_H
 #ifdef CONFIG_MTD_UBI_FASTMAP
 static void update_fastmap_work_fn(struct work_struct *wrk);
+static void fm_refresh_work_fn(struct work_struct *wrk);
 static struct ubi_wl_entry *find_anchor_wl_entry(struct rb_root *root);
 static struct ubi_wl_entry *get_peb_for_wl(struct ubi_device *ubi);
 static struct ubi_wl_entry *next_peb_for_wl(struct ubi_device *ubi);
@@ -13,6 +14,7 @@ static inline void ubi_fastmap_init(struct ubi_device *ubi, int *count)
 	/* Reserve enough LEBs to store two fastmaps. */
 	*count += (ubi->fm_size / ubi->leb_size) * 2;
 	INIT_WORK(&ubi->fm_work, update_fastmap_work_fn);
+	INIT_DELAYED_WORK(&ubi->fm_refresh_work, fm_refresh_work_fn);
 }
 static struct ubi_wl_entry *may_reserve_for_fm(struct ubi_device *ubi,
 					       struct ubi_wl_entry *e,
@@ -11,6 +11,7 @@
 
 #include <linux/bitfield.h>
 #include <linux/clk.h>
+#include <linux/clocksource.h>
 #include <linux/errno.h>
 #include <linux/ethtool.h>
 #include <linux/init.h>
@@ -25,7 +26,9 @@
 #include <linux/skbuff.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
+#include <linux/timecounter.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <linux/can/dev.h>
 #include <linux/can/error.h>
 #include <linux/pm_runtime.h>
@@ -51,6 +54,7 @@ enum xcan_reg {
 	XCAN_AFR_OFFSET		= 0x60, /* Acceptance Filter */
 
 	/* only on CAN FD cores */
+	XCAN_TSR_OFFSET		= 0x028, /* Timestamp */
 	XCAN_F_BRPR_OFFSET	= 0x088, /* Data Phase Baud Rate
 					  * Prescaler
 					  */
@@ -79,7 +83,7 @@ enum xcan_reg {
 #define XCAN_RXMSG_2_FRAME_OFFSET(n)	(XCAN_RXMSG_2_BASE_OFFSET + \
 					 XCAN_CANFD_FRAME_SIZE * (n))
 
-/* the single TX mailbox used by this driver on CAN FD HW */
+/* the first TX mailbox used by this driver on CAN FD HW */
 #define XCAN_TX_MAILBOX_IDX		0
 
 /* CAN register bit masks - XCAN_<REG>_<BIT>_MASK */
@@ -135,6 +139,8 @@ enum xcan_reg {
 #define XCAN_2_FSR_RI_MASK		0x0000003F /* RX Read Index */
 #define XCAN_DLCR_EDL_MASK		0x08000000 /* EDL Mask in DLC */
 #define XCAN_DLCR_BRS_MASK		0x04000000 /* BRS Mask in DLC */
+#define XCAN_DLCR_TS_MASK		GENMASK(15, 0) /* RX timestamp */
+#define XCAN_TSR_TS_MASK		GENMASK(31, 16) /* Timestamp counter */
 
 /* CAN register bit shift - XCAN_<REG>_<BIT>_SHIFT */
 #define XCAN_BRPR_TDC_ENABLE		BIT(16) /* Transmitter Delay Compensation (TDC) Enable */
@@ -165,6 +171,13 @@ enum xcan_reg {
  */
 #define XCAN_FLAG_RX_FIFO_MULTI	0x0010
 #define XCAN_FLAG_CANFD_2	0x0020
+/* RX frames timestamped with the nominal bit time counter */
+#define XCAN_FLAG_RX_TIMESTAMP	0x0040
+
+static unsigned int tx_mailboxes = 1;
+module_param(tx_mailboxes, uint, 0444);
+MODULE_PARM_DESC(tx_mailboxes,
+		 "TX mailboxes used on CAN FD cores, frames queued together are sent in CAN ID priority order (default: 1)");
 
 enum xcan_ip_type {
 	XAXI_CAN = 0,
@@ -189,6 +202,7 @@ struct xcan_devtype_data {
  * @tx_head:			Tx CAN packets ready to send on the queue
  * @tx_tail:			Tx CAN packets successfully sended on the queue
  * @tx_max:			Maximum number packets the driver can send
+ * @tx_trr:			TX mailboxes filled but not yet marked ready
  * @napi:			NAPI structure
  * @read_reg:			For reading data from CAN registers
  * @write_reg:			For writing data to CAN registers
@@ -198,6 +212,11 @@ struct xcan_devtype_data {
  * @bus_clk:			Pointer to struct clk
  * @can_clk:			Pointer to struct clk
  * @devtype:			Device type specific constants
+ * @cc:				RX timestamp counter
+ * @tc:				RX timestamp counter conversion to ns
+ * @tc_lock:			Lock protecting @tc
+ * @tc_work:			Work folding the counter in before it wraps
+ * @tc_period:			Period of @tc_work in jiffies
  */
 struct xcan_priv {
 	struct can_priv can;
@@ -205,6 +224,7 @@ struct xcan_priv {
 	unsigned int tx_head;
 	unsigned int tx_tail;
 	unsigned int tx_max;
+	u32 tx_trr;
 	struct napi_struct napi;
 	u32 (*read_reg)(const struct xcan_priv *priv, enum xcan_reg reg);
 	void (*write_reg)(const struct xcan_priv *priv, enum xcan_reg reg,
@@ -215,6 +235,11 @@ struct xcan_priv {
 	struct clk *bus_clk;
 	struct clk *can_clk;
 	struct xcan_devtype_data devtype;
+	struct cyclecounter cc;
+	struct timecounter tc;
+	spinlock_t tc_lock; /* Lock protecting the timecounter */
+	struct delayed_work tc_work;
+	unsigned long tc_period;
 };
 
 /* CAN Bittiming constants as per Xilinx CAN specs */
@@ -401,6 +426,7 @@ static int set_reset_mode(struct net_device *ndev)
 	/* reset clears FIFOs */
 	priv->tx_head = 0;
 	priv->tx_tail = 0;
+	priv->tx_trr = 0;
 
 	return 0;
 }
@@ -479,6 +505,75 @@ static int xcan_set_bittiming(struct net_device *ndev)
 	return 0;
 }
 
+static u64 xcan_timestamp_read(const struct cyclecounter *cc)
+{
+	struct xcan_priv *priv = container_of(cc, struct xcan_priv, cc);
+
+	return FIELD_GET(XCAN_TSR_TS_MASK,
+			 priv->read_reg(priv, XCAN_TSR_OFFSET));
+}
+
+static void xcan_timestamp_work(struct work_struct *work)
+{
+	struct xcan_priv *priv = container_of(to_delayed_work(work),
+					      struct xcan_priv, tc_work);
+
+	spin_lock_bh(&priv->tc_lock);
+	timecounter_read(&priv->tc);
+	spin_unlock_bh(&priv->tc_lock);
+
+	schedule_delayed_work(&priv->tc_work, priv->tc_period);
+}
+
+/**
+ * xcan_timestamp_start - Start converting the RX timestamps
+ * @priv:	Driver private data structure
+ *
+ * The 16-bit counter runs at the nominal bit rate, so it wraps in 65 ms
+ * at 1 Mbit/s. It is folded into the timecounter four times per wrap.
+ */
+static void xcan_timestamp_start(struct xcan_priv *priv)
+{
+	u32 rate = priv->can.bittiming.bitrate;
+	u32 wrap_us;
+
+	if (!(priv->devtype.flags & XCAN_FLAG_RX_TIMESTAMP) || !rate)
+		return;
+
+	wrap_us = div_u64((u64)(XCAN_DLCR_TS_MASK + 1) * USEC_PER_SEC, rate);
+
+	priv->cc.read = xcan_timestamp_read;
+	priv->cc.mask = CYCLECOUNTER_MASK(16);
+	clocks_calc_mult_shift(&priv->cc.mult, &priv->cc.shift, rate,
+			       NSEC_PER_SEC,
+			       DIV_ROUND_UP(wrap_us, USEC_PER_SEC));
+
+	spin_lock_bh(&priv->tc_lock);
+	timecounter_init(&priv->tc, &priv->cc, ktime_get_real_ns());
+	spin_unlock_bh(&priv->tc_lock);
+
+	priv->tc_period = max(usecs_to_jiffies(wrap_us / 4), 1UL);
+	mod_delayed_work(system_wq, &priv->tc_work, priv->tc_period);
+}
+
+static void xcan_timestamp_stop(struct xcan_priv *priv)
+{
+	if (priv->devtype.flags & XCAN_FLAG_RX_TIMESTAMP)
+		cancel_delayed_work_sync(&priv->tc_work);
+}
+
+static void xcan_skb_set_rx_timestamp(struct xcan_priv *priv,
+				      struct sk_buff *skb, u32 ts)
+{
+	u64 ns;
+
+	spin_lock(&priv->tc_lock);
+	ns = timecounter_cyc2time(&priv->tc, ts);
+	spin_unlock(&priv->tc_lock);
+
+	skb_hwtstamps(skb)->hwtstamp = ns_to_ktime(ns);
+}
+
 /**
  * xcan_chip_start - This the drivers start routine
  * @ndev:	Pointer to net_device structure
@@ -540,6 +635,8 @@ static int xcan_chip_start(struct net_device *ndev)
 	netdev_dbg(ndev, "status:#x%08x\n",
 		   priv->read_reg(priv, XCAN_SR_OFFSET));
 
+	xcan_timestamp_start(priv);
+
 	priv->can.state = CAN_STATE_ERROR_ACTIVE;
 	return 0;
 }
@@ -622,11 +719,7 @@ static void xcan_write_frame(struct net_device *ndev, struct sk_buff *skb,
 		dlc |= XCAN_DLCR_EDL_MASK;
 	}
 
-	if (!(priv->devtype.flags & XCAN_FLAG_TX_MAILBOXES) &&
-	    (priv->devtype.flags & XCAN_FLAG_TXFEMP))
-		can_put_echo_skb(skb, ndev, priv->tx_head % priv->tx_max, 0);
-	else
-		can_put_echo_skb(skb, ndev, 0, 0);
+	can_put_echo_skb(skb, ndev, priv->tx_head % priv->tx_max, 0);
 
 	priv->tx_head++;
 
@@ -685,7 +778,7 @@ static int xcan_start_xmit_fifo(struct sk_buff *skb, struct net_device *ndev)
 
 	xcan_write_frame(ndev, skb, XCAN_TXFIFO_OFFSET);
 
-	/* Clear TX-FIFO-empty interrupt for xcan_tx_interrupt() */
+	/* Clear TX-FIFO-empty interrupt for xcan_tx_fifo_done() */
 	if (priv->tx_max > 1)
 		priv->write_reg(priv, XCAN_ICR_OFFSET, XCAN_IXR_TXFEMP_MASK);
 
@@ -703,26 +796,35 @@ static int xcan_start_xmit_fifo(struct sk_buff *skb, struct net_device *ndev)
  * @skb:	sk_buff pointer that contains data to be Txed
  * @ndev:	Pointer to net_device structure
  *
+ * The mailboxes are filled in ascending order, starting over from the
+ * first one only once all of them have been sent. The frames of a batch
+ * are marked ready together, when the stack has no more frame to queue.
+ *
  * Return: 0 on success, -ENOSPC if there is no space
  */
 static int xcan_start_xmit_mailbox(struct sk_buff *skb, struct net_device *ndev)
 {
 	struct xcan_priv *priv = netdev_priv(ndev);
+	unsigned int mb = XCAN_TX_MAILBOX_IDX + priv->tx_head % priv->tx_max;
 	unsigned long flags;
 
-	if (unlikely(priv->read_reg(priv, XCAN_TRR_OFFSET) &
-		     BIT(XCAN_TX_MAILBOX_IDX)))
+	if (unlikely(priv->read_reg(priv, XCAN_TRR_OFFSET) & BIT(mb)))
 		return -ENOSPC;
 
 	spin_lock_irqsave(&priv->tx_lock, flags);
 
-	xcan_write_frame(ndev, skb,
-			 XCAN_TXMSG_FRAME_OFFSET(XCAN_TX_MAILBOX_IDX));
+	xcan_write_frame(ndev, skb, XCAN_TXMSG_FRAME_OFFSET(mb));
+	priv->tx_trr |= BIT(mb);
 
-	/* Mark buffer as ready for transmit */
-	priv->write_reg(priv, XCAN_TRR_OFFSET, BIT(XCAN_TX_MAILBOX_IDX));
+	/* The last mailbox was filled */
+	if (!(priv->tx_head % priv->tx_max))
+		netif_stop_queue(ndev);
 
-	netif_stop_queue(ndev);
+	/* Mark buffers as ready for transmit */
+	if (!netdev_xmit_more() || netif_queue_stopped(ndev)) {
+		priv->write_reg(priv, XCAN_TRR_OFFSET, priv->tx_trr);
+		priv->tx_trr = 0;
+	}
 
 	spin_unlock_irqrestore(&priv->tx_lock, flags);
 
@@ -910,6 +1012,10 @@ static int xcanfd_rx(struct net_device *ndev, int frame_base)
 		stats->rx_bytes += cf->len;
 	stats->rx_packets++;
 
+	if (priv->devtype.flags & XCAN_FLAG_RX_TIMESTAMP)
+		xcan_skb_set_rx_timestamp(priv, skb,
+					  FIELD_GET(XCAN_DLCR_TS_MASK, dlc));
+
 	netif_receive_skb(skb);
 
 	return 1;
@@ -1206,13 +1312,16 @@ static int xcan_rx_fifo_get_next_frame(struct xcan_priv *priv)
 	return offset;
 }
 
+static void xcan_tx_done(struct net_device *ndev);
+
 /**
  * xcan_rx_poll - Poll routine for rx packets (NAPI)
  * @napi:	napi structure pointer
  * @quota:	Max number of rx packets to be processed.
  *
  * This is the poll routine for rx part.
- * It will process the packets maximux quota value.
+ * It will process the packets maximux quota value. The sent frames are
+ * completed first, they do not count against the quota.
  *
  * Return: number of packets received
  */
@@ -1224,6 +1333,8 @@ static int xcan_rx_poll(struct napi_struct *napi, int quota)
 	int work_done = 0;
 	int frame_offset;
 
+	xcan_tx_done(ndev);
+
 	while ((frame_offset = xcan_rx_fifo_get_next_frame(priv)) >= 0 &&
 	       (work_done < quota)) {
 		if (xcan_rx_int_mask(priv) & XCAN_IXR_RXOK_MASK)
@@ -1249,7 +1360,7 @@ static int xcan_rx_poll(struct napi_struct *napi, int quota)
 	if (work_done < quota) {
 		if (napi_complete_done(napi, work_done)) {
 			ier = priv->read_reg(priv, XCAN_IER_OFFSET);
-			ier |= xcan_rx_int_mask(priv);
+			ier |= xcan_rx_int_mask(priv) | XCAN_IXR_TXOK_MASK;
 			priv->write_reg(priv, XCAN_IER_OFFSET, ier);
 		}
 	}
@@ -1257,11 +1368,11 @@ static int xcan_rx_poll(struct napi_struct *napi, int quota)
 }
 
 /**
- * xcan_tx_interrupt - Tx Done Isr
+ * xcan_tx_fifo_done - Complete the frames sent from the TX FIFO
  * @ndev:	net_device pointer
  * @isr:	Interrupt status register value
  */
-static void xcan_tx_interrupt(struct net_device *ndev, u32 isr)
+static void xcan_tx_fifo_done(struct net_device *ndev, u32 isr)
 {
 	struct xcan_priv *priv = netdev_priv(ndev);
 	struct net_device_stats *stats = &ndev->stats;
@@ -1329,6 +1440,66 @@ static void xcan_tx_interrupt(struct net_device *ndev, u32 isr)
 	netif_wake_queue(ndev);
 
 	spin_unlock_irqrestore(&priv->tx_lock, flags);
+}
+
+/**
+ * xcan_tx_mailbox_done - Complete the frames sent from the TX mailboxes
+ * @ndev:	net_device pointer
+ *
+ * The hardware sends the ready mailboxes in CAN ID priority order, a
+ * frame is only completed once the frames queued before it are.
+ */
+static void xcan_tx_mailbox_done(struct net_device *ndev)
+{
+	struct xcan_priv *priv = netdev_priv(ndev);
+	struct net_device_stats *stats = &ndev->stats;
+	unsigned long flags;
+	unsigned int idx;
+	u32 pending;
+
+	spin_lock_irqsave(&priv->tx_lock, flags);
+
+	/* Clear TXOK first so that a frame sent after the read raises it */
+	priv->write_reg(priv, XCAN_ICR_OFFSET, XCAN_IXR_TXOK_MASK);
+	pending = priv->read_reg(priv, XCAN_TRR_OFFSET) | priv->tx_trr;
+
+	while (priv->tx_tail != priv->tx_head) {
+		idx = priv->tx_tail % priv->tx_max;
+		if (pending & BIT(XCAN_TX_MAILBOX_IDX + idx))
+			break;
+
+		stats->tx_bytes += can_get_echo_skb(ndev, idx, NULL);
+		priv->tx_tail++;
+		stats->tx_packets++;
+	}
+
+	/* Start over from the first mailbox once all of them are free */
+	if (priv->tx_tail == priv->tx_head)
+		netif_wake_queue(ndev);
+
+	spin_unlock_irqrestore(&priv->tx_lock, flags);
+}
+
+/**
+ * xcan_tx_done - Complete the sent frames
+ * @ndev:	net_device pointer
+ *
+ * Called from NAPI, the echo skbs of all the frames sent since the last
+ * TXOK interrupt are completed and the queue is woken up once.
+ */
+static void xcan_tx_done(struct net_device *ndev)
+{
+	struct xcan_priv *priv = netdev_priv(ndev);
+	u32 isr;
+
+	isr = priv->read_reg(priv, XCAN_ISR_OFFSET);
+	if (!(isr & XCAN_IXR_TXOK_MASK))
+		return;
+
+	if (priv->devtype.flags & XCAN_FLAG_TX_MAILBOXES)
+		xcan_tx_mailbox_done(ndev);
+	else
+		xcan_tx_fifo_done(ndev, isr);
 
 	xcan_update_error_state_after_rxtx(ndev);
 }
@@ -1350,7 +1521,7 @@ static irqreturn_t xcan_interrupt(int irq, void *dev_id)
 	struct xcan_priv *priv = netdev_priv(ndev);
 	u32 isr, ier;
 	u32 isr_errors;
-	u32 rx_int_mask = xcan_rx_int_mask(priv);
+	u32 napi_mask = xcan_rx_int_mask(priv) | XCAN_IXR_TXOK_MASK;
 
 	/* Get the interrupt status from Xilinx CAN */
 	isr = priv->read_reg(priv, XCAN_ISR_OFFSET);
@@ -1364,10 +1535,6 @@ static irqreturn_t xcan_interrupt(int irq, void *dev_id)
 		xcan_state_interrupt(ndev, isr);
 	}
 
-	/* Check for Tx interrupt and Processing it */
-	if (isr & XCAN_IXR_TXOK_MASK)
-		xcan_tx_interrupt(ndev, isr);
-
 	/* Check for the type of error interrupt and Processing it */
 	isr_errors = isr & (XCAN_IXR_ERROR_MASK | XCAN_IXR_RXOFLW_MASK |
 			    XCAN_IXR_BSOFF_MASK | XCAN_IXR_ARBLST_MASK |
@@ -1377,10 +1544,10 @@ static irqreturn_t xcan_interrupt(int irq, void *dev_id)
 		xcan_err_interrupt(ndev, isr);
 	}
 
-	/* Check for the type of receive interrupt and Processing it */
-	if (isr & rx_int_mask) {
+	/* Receive and sent frames are processed in NAPI */
+	if (isr & napi_mask) {
 		ier = priv->read_reg(priv, XCAN_IER_OFFSET);
-		ier &= ~rx_int_mask;
+		ier &= ~napi_mask;
 		priv->write_reg(priv, XCAN_IER_OFFSET, ier);
 		napi_schedule(&priv->napi);
 	}
@@ -1399,6 +1566,8 @@ static void xcan_chip_stop(struct net_device *ndev)
 	struct xcan_priv *priv = netdev_priv(ndev);
 	int ret;
 
+	xcan_timestamp_stop(priv);
+
 	/* Disable interrupts and leave the can in configuration mode */
 	ret = set_reset_mode(ndev);
 	if (ret < 0)
@@ -1541,8 +1710,29 @@ static const struct net_device_ops xcan_netdev_ops = {
 	.ndo_change_mtu	= can_change_mtu,
 };
 
+static int xcan_get_ts_info(struct net_device *ndev,
+			    struct ethtool_ts_info *info)
+{
+	struct xcan_priv *priv = netdev_priv(ndev);
+
+	if (!(priv->devtype.flags & XCAN_FLAG_RX_TIMESTAMP))
+		return ethtool_op_get_ts_info(ndev, info);
+
+	/* RX hardware timestamps are always enabled */
+	info->so_timestamping = SOF_TIMESTAMPING_TX_SOFTWARE |
+				SOF_TIMESTAMPING_RX_SOFTWARE |
+				SOF_TIMESTAMPING_SOFTWARE |
+				SOF_TIMESTAMPING_RX_HARDWARE |
+				SOF_TIMESTAMPING_RAW_HARDWARE;
+	info->phc_index = -1;
+	info->tx_types = BIT(HWTSTAMP_TX_OFF);
+	info->rx_filters = BIT(HWTSTAMP_FILTER_ALL);
+
+	return 0;
+}
+
 static const struct ethtool_ops xcan_ethtool_ops = {
-	.get_ts_info = ethtool_op_get_ts_info,
+	.get_ts_info = xcan_get_ts_info,
 };
 
 /**
@@ -1670,7 +1860,8 @@ static const struct xcan_devtype_data xcan_canfd_data = {
 	.flags = XCAN_FLAG_EXT_FILTERS |
 		 XCAN_FLAG_RXMNF |
 		 XCAN_FLAG_TX_MAILBOXES |
-		 XCAN_FLAG_RX_FIFO_MULTI,
+		 XCAN_FLAG_RX_FIFO_MULTI |
+		 XCAN_FLAG_RX_TIMESTAMP,
 	.bittiming_const = &xcan_bittiming_const_canfd,
 	.btr_ts2_shift = XCAN_BTR_TS2_SHIFT_CANFD,
 	.btr_sjw_shift = XCAN_BTR_SJW_SHIFT_CANFD,
@@ -1683,7 +1874,8 @@ static const struct xcan_devtype_data xcan_canfd2_data = {
 		 XCAN_FLAG_RXMNF |
 		 XCAN_FLAG_TX_MAILBOXES |
 		 XCAN_FLAG_CANFD_2 |
-		 XCAN_FLAG_RX_FIFO_MULTI,
+		 XCAN_FLAG_RX_FIFO_MULTI |
+		 XCAN_FLAG_RX_TIMESTAMP,
 	.bittiming_const = &xcan_bittiming_const_canfd2,
 	.btr_ts2_shift = XCAN_BTR_TS2_SHIFT_CANFD,
 	.btr_sjw_shift = XCAN_BTR_SJW_SHIFT_CANFD,
@@ -1767,10 +1959,12 @@ static int xcan_probe(struct platform_device *pdev)
 	 * With TX mailboxes:
 	 *
 	 * HW sends frames in CAN ID priority order. To preserve FIFO ordering
-	 * we submit frames one at a time.
+	 * we submit frames one at a time, unless more mailboxes are allowed
+	 * by the tx_mailboxes parameter.
 	 */
-	if (!(devtype->flags & XCAN_FLAG_TX_MAILBOXES) &&
-	    (devtype->flags & XCAN_FLAG_TXFEMP))
+	if (devtype->flags & XCAN_FLAG_TX_MAILBOXES)
+		tx_max = clamp(tx_mailboxes, 1U, max(hw_tx_max, 1U));
+	else if (devtype->flags & XCAN_FLAG_TXFEMP)
 		tx_max = min(hw_tx_max, 2U);
 	else
 		tx_max = 1;
@@ -1813,6 +2007,8 @@ static int xcan_probe(struct platform_device *pdev)
 	priv->tx_max = tx_max;
 	priv->devtype = *devtype;
 	spin_lock_init(&priv->tx_lock);
+	spin_lock_init(&priv->tc_lock);
+	INIT_DELAYED_WORK(&priv->tc_work, xcan_timestamp_work);
 
 	/* Get IRQ for the device */
 	ret = platform_get_irq(pdev, 0);
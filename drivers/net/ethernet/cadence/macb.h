@@ -13,6 +13,7 @@
 #include <linux/net_tstamp.h>
 #include <linux/interrupt.h>
 #include <linux/phy/phy.h>
+#include <net/xdp.h>
 
 #if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) || defined(CONFIG_MACB_USE_HWSTAMP)
 #define MACB_EXT_DESC
@@ -937,16 +938,23 @@ struct gem_tx_ts {
 /* struct macb_tx_skb - data about an skb which is being transmitted
  * @skb: skb currently being transmitted, only set for the last buffer
  *       of the frame
- * @mapping: DMA address of the skb's fragment buffer
+ * @xdpf: XDP frame being transmitted instead of an skb, always a single
+ *        buffer frame
+ * @mapping: DMA address of the skb's fragment buffer, 0 when the buffer
+ *           belongs to the RX page pool and must not be unmapped
  * @size: size of the DMA mapped buffer
  * @mapped_as_page: true when buffer was mapped with skb_frag_dma_map(),
  *                  false when buffer was mapped with dma_map_single()
+ * @xsk: buffer is an AF_XDP Tx descriptor of the queue's XSK pool, always a
+ *       single buffer frame
  */
 struct macb_tx_skb {
 	struct sk_buff		*skb;
+	struct xdp_frame	*xdpf;
 	dma_addr_t		mapping;
 	size_t			size;
 	bool			mapped_as_page;
+	bool			xsk;
 };
 
 /* Hardware-collected statistics. Used when updating the network
@@ -1236,7 +1244,12 @@ struct macb_queue {
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	struct page		**rx_page;
+	struct page_pool	*page_pool;
+	struct xdp_rxq_info	xdp_rxq;
+	/* AF_XDP zero-copy buffers, used instead of rx_page/page_pool */
+	struct xdp_buff		**rx_xsk;
+	struct xsk_buff_pool	*xsk_pool;
 	void			*rx_buffers;
 	struct napi_struct	napi_rx;
 	struct queue_stats stats;
@@ -1268,6 +1281,10 @@ struct macb {
 
 	struct macb_dma_desc	*rx_ring_tieoff;
 	size_t			rx_buffer_size;
+	unsigned int		rx_headroom;
+	unsigned int		rx_page_order;
+
+	struct bpf_prog		*xdp_prog;
 
 	unsigned int		rx_ring_size;
 	unsigned int		tx_ring_size;
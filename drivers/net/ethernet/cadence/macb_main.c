@@ -41,6 +41,10 @@
 #include <linux/firmware/xlnx-zynqmp.h>
 #include <linux/crc32.h>
 #include <linux/inetdevice.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool.h>
+#include <net/xdp_sock_drv.h>
 #include "macb.h"
 
 /* This structure is only used for MACB on SiFive FU540 devices */
@@ -53,6 +57,19 @@ struct sifive_fu540_macb_mgmt {
 #define MACB_RX_BUFFER_SIZE	128
 #define RX_BUFFER_MULTIPLE	64  /* bytes */
 
+/* GEM RX buffers are page pool pages laid out as headroom, frame and
+ * skb_shared_info so that build_skb() can wrap them without a copy.
+ */
+#define GEM_RX_TRUESIZE(headroom, bufsz)				\
+	(SKB_DATA_ALIGN((headroom) + (bufsz)) +				\
+	 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
+/* gem_run_xdp() verdicts */
+#define MACB_XDP_PASS		0
+#define MACB_XDP_CONSUMED	BIT(0)
+#define MACB_XDP_TX		BIT(1)
+#define MACB_XDP_REDIRECT	BIT(2)
+
 #define DEFAULT_RX_RING_SIZE	512 /* must be power of 2 */
 #define MIN_RX_RING_SIZE	64
 #define MAX_RX_RING_SIZE	8192
@@ -1024,6 +1041,11 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb, int budge
 		napi_consume_skb(tx_skb->skb, budget);
 		tx_skb->skb = NULL;
 	}
+
+	if (tx_skb->xdpf) {
+		xdp_return_frame(tx_skb->xdpf);
+		tx_skb->xdpf = NULL;
+	}
 }
 
 static void macb_set_addr(struct macb *bp, struct macb_dma_desc *desc, dma_addr_t addr)
@@ -1067,6 +1089,7 @@ static void macb_tx_error_task(struct work_struct *work)
 	struct macb_tx_skb	*tx_skb;
 	struct macb_dma_desc	*desc;
 	struct sk_buff		*skb;
+	unsigned int		xsk_frames = 0;
 	unsigned int		tail;
 	unsigned long		flags;
 	bool			halt_timeout = false;
@@ -1109,8 +1132,10 @@ static void macb_tx_error_task(struct work_struct *work)
 		skb = tx_skb->skb;
 
 		if (ctrl & MACB_BIT(TX_USED)) {
-			/* skb is set for the last buffer of the frame */
-			while (!skb) {
+			/* skb is set for the last buffer of the frame, XDP
+			 * and AF_XDP frames only use a single buffer
+			 */
+			while (!skb && !tx_skb->xdpf && !tx_skb->xsk) {
 				macb_tx_unmap(bp, tx_skb, 0);
 				tail++;
 				tx_skb = macb_tx_skb(queue, tail);
@@ -1121,13 +1146,20 @@ static void macb_tx_error_task(struct work_struct *work)
 			 * since it's the only one written back by the hardware
 			 */
 			if (!(ctrl & MACB_BIT(TX_BUF_EXHAUSTED))) {
-				netdev_vdbg(bp->dev, "txerr skb %u (data %p) TX complete\n",
-					    macb_tx_ring_wrap(bp, tail),
-					    skb->data);
+				unsigned int len;
+
+				if (skb)
+					len = skb->len;
+				else if (tx_skb->xdpf)
+					len = tx_skb->xdpf->len;
+				else
+					len = tx_skb->size;
+				netdev_vdbg(bp->dev, "txerr buffer %u TX complete\n",
+					    macb_tx_ring_wrap(bp, tail));
 				bp->dev->stats.tx_packets++;
 				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				bp->dev->stats.tx_bytes += len;
+				queue->stats.tx_bytes += len;
 			}
 		} else {
 			/* "Buffers exhausted mid-frame" errors may only happen
@@ -1141,9 +1173,16 @@ static void macb_tx_error_task(struct work_struct *work)
 			desc->ctrl = ctrl | MACB_BIT(TX_USED);
 		}
 
+		if (tx_skb->xsk) {
+			tx_skb->xsk = false;
+			xsk_frames++;
+		}
 		macb_tx_unmap(bp, tx_skb, 0);
 	}
 
+	if (xsk_frames)
+		xsk_tx_completed(queue->xsk_pool, xsk_frames);
+
 	/* Set end of TX queue */
 	desc = macb_tx_desc(queue, 0);
 	macb_set_addr(bp, desc, 0);
@@ -1211,16 +1250,26 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 {
 	struct macb *bp = queue->bp;
 	u16 queue_index = queue - bp->queues;
+	unsigned int xsk_frames = 0;
+	unsigned int bytes = 0;
 	unsigned int tail;
 	unsigned int head;
 	int packets = 0;
 
+	/* Only this NAPI context moves tx_tail and the descriptors between
+	 * tx_tail and tx_head are no longer touched by the xmit paths, so
+	 * the lock is only needed to snapshot tx_head and to publish the
+	 * new tail in one go.
+	 */
 	spin_lock(&queue->tx_ptr_lock);
 	head = queue->tx_head;
+	spin_unlock(&queue->tx_ptr_lock);
+
 	for (tail = queue->tx_tail; tail != head && packets < budget; tail++) {
 		struct macb_tx_skb	*tx_skb;
 		struct sk_buff		*skb;
 		struct macb_dma_desc	*desc;
+		bool			last;
 		u32			ctrl;
 
 		desc = macb_tx_desc(queue, tail);
@@ -1254,25 +1303,40 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 				netdev_vdbg(bp->dev, "skb %u (data %p) TX complete\n",
 					    macb_tx_ring_wrap(bp, tail),
 					    skb->data);
-				bp->dev->stats.tx_packets++;
-				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				bytes += skb->len;
 				packets++;
+			} else if (tx_skb->xdpf) {
+				bytes += tx_skb->xdpf->len;
+				packets++;
+			} else if (tx_skb->xsk) {
+				bytes += tx_skb->size;
+				packets++;
+				xsk_frames++;
 			}
 
+			/* skb is set only for the last buffer of the frame,
+			 * XDP and AF_XDP frames only use a single buffer.
+			 */
+			last = skb || tx_skb->xdpf || tx_skb->xsk;
+			tx_skb->xsk = false;
+
 			/* Now we can safely release resources */
 			macb_tx_unmap(bp, tx_skb, budget);
 
-			/* skb is set only for the last buffer of the frame.
-			 * WARNING: at this point skb has been freed by
-			 * macb_tx_unmap().
-			 */
-			if (skb)
+			if (last)
 				break;
 		}
 	}
 
+	bp->dev->stats.tx_packets += packets;
+	queue->stats.tx_packets += packets;
+	bp->dev->stats.tx_bytes += bytes;
+	queue->stats.tx_bytes += bytes;
+
+	if (xsk_frames)
+		xsk_tx_completed(queue->xsk_pool, xsk_frames);
+
+	spin_lock(&queue->tx_ptr_lock);
 	queue->tx_tail = tail;
 	if (__netif_subqueue_stopped(bp->dev, queue_index) &&
 	    CIRC_CNT(queue->tx_head, queue->tx_tail,
@@ -1283,14 +1347,70 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 	return packets;
 }
 
+/* Fill the RX ring of an AF_XDP zero-copy queue from its XSK pool.
+ * Returns false when the pool ran out of buffers.
+ */
+static bool gem_rx_refill_zc(struct macb_queue *queue)
+{
+	struct macb *bp = queue->bp;
+	struct macb_dma_desc *desc;
+	struct xdp_buff *xdp;
+	unsigned int entry;
+	dma_addr_t paddr;
+	bool ok = true;
+
+	while (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
+			  bp->rx_ring_size) > 0) {
+		entry = macb_rx_ring_wrap(bp, queue->rx_prepared_head);
+
+		/* Make hw descriptor updates visible to CPU */
+		rmb();
+
+		desc = macb_rx_desc(queue, entry);
+
+		if (!queue->rx_xsk[entry]) {
+			xdp = xsk_buff_alloc(queue->xsk_pool);
+			if (!xdp) {
+				ok = false;
+				break;
+			}
+
+			/* The hardware adds NET_IP_ALIGN (RBOF) itself */
+			paddr = xsk_buff_xdp_get_dma(xdp);
+			queue->rx_xsk[entry] = xdp;
+
+			if (entry == bp->rx_ring_size - 1)
+				paddr |= MACB_BIT(RX_WRAP);
+			desc->ctrl = 0;
+			dma_wmb();
+			macb_set_addr(bp, desc, paddr);
+		} else {
+			desc->ctrl = 0;
+			dma_wmb();
+			desc->addr &= ~MACB_BIT(RX_USED);
+		}
+		queue->rx_prepared_head++;
+	}
+
+	/* Make descriptor updates visible to hardware */
+	wmb();
+
+	return ok;
+}
+
 static void gem_rx_refill(struct macb_queue *queue)
 {
 	unsigned int		entry;
-	struct sk_buff		*skb;
+	struct page		*page;
 	dma_addr_t		paddr;
 	struct macb *bp = queue->bp;
 	struct macb_dma_desc *desc;
 
+	if (queue->xsk_pool) {
+		gem_rx_refill_zc(queue);
+		return;
+	}
+
 	while (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
 			bp->rx_ring_size) > 0) {
 		entry = macb_rx_ring_wrap(bp, queue->rx_prepared_head);
@@ -1300,25 +1420,21 @@ static void gem_rx_refill(struct macb_queue *queue)
 
 		desc = macb_rx_desc(queue, entry);
 
-		if (!queue->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		if (!queue->rx_page[entry]) {
+			/* allocate RX page for this free entry in ring */
+			page = page_pool_dev_alloc_pages(queue->page_pool);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
+					   "Unable to allocate RX page\n");
 				break;
 			}
 
-			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
-			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
-				break;
-			}
+			/* The page pool keeps its pages mapped and synced for
+			 * the device, so just fill the descriptor entry.
+			 */
+			paddr = page_pool_get_dma_addr(page) + bp->rx_headroom;
 
-			queue->rx_skbuff[entry] = skb;
+			queue->rx_page[entry] = page;
 
 			if (entry == bp->rx_ring_size - 1)
 				paddr |= MACB_BIT(RX_WRAP);
@@ -1328,9 +1444,6 @@ static void gem_rx_refill(struct macb_queue *queue)
 			 */
 			dma_wmb();
 			macb_set_addr(bp, desc, paddr);
-
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
 		} else {
 			desc->ctrl = 0;
 			dma_wmb();
@@ -1367,29 +1480,392 @@ static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 	 */
 }
 
-static int macb_validate_hw_csum(struct sk_buff *skb)
+static int macb_validate_fcs(const u8 *data, unsigned int len)
 {
-	u32 pkt_csum = *((u32 *)&skb->data[skb->len - ETH_FCS_LEN]);
-	u32 csum  = ~crc32_le(~0, skb_mac_header(skb),
-			skb->len + ETH_HLEN - ETH_FCS_LEN);
+	u32 pkt_csum = *((u32 *)&data[len - ETH_FCS_LEN]);
+	u32 csum  = ~crc32_le(~0, data, len - ETH_FCS_LEN);
 
 	return (pkt_csum != csum);
 }
 
+static int macb_validate_hw_csum(struct sk_buff *skb)
+{
+	return macb_validate_fcs(skb_mac_header(skb), skb->len + ETH_HLEN);
+}
+
+/* Post the single buffer frame described by tx_skb at tx_head. The caller
+ * holds tx_ptr_lock and has checked there is room in the ring.
+ */
+static void gem_tx_post_single(struct macb_queue *queue, dma_addr_t addr,
+			       unsigned int len)
+{
+	struct macb *bp = queue->bp;
+	struct macb_dma_desc *desc;
+	unsigned int entry;
+	u32 ctrl;
+
+	entry = macb_tx_ring_wrap(bp, queue->tx_head);
+
+	/* Set 'TX_USED' bit in the next buffer descriptor to set the end
+	 * of TX queue
+	 */
+	desc = macb_tx_desc(queue, queue->tx_head + 1);
+	desc->ctrl = MACB_BIT(TX_USED);
+
+	ctrl = len | MACB_BIT(TX_LAST);
+	if (unlikely(entry == (bp->tx_ring_size - 1)))
+		ctrl |= MACB_BIT(TX_WRAP);
+
+	desc = macb_tx_desc(queue, entry);
+	macb_set_addr(bp, desc, addr);
+	/* desc->addr must be visible to hardware before clearing
+	 * 'TX_USED' bit in desc->ctrl.
+	 */
+	wmb();
+	desc->ctrl = ctrl;
+
+	queue->tx_head++;
+}
+
+/* Queue a single buffer XDP frame on the TX ring of a queue. The caller
+ * holds tx_ptr_lock and sets TSTART once all frames of a batch are queued.
+ * Frames coming from our own RX page pool are already mapped, redirected
+ * frames from other devices are mapped here.
+ */
+static int gem_xdp_xmit_frame(struct macb_queue *queue,
+			      struct xdp_frame *xdpf, bool dma_map)
+{
+	struct macb *bp = queue->bp;
+	struct macb_tx_skb *tx_skb;
+	dma_addr_t mapping, addr;
+
+	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1 ||
+	    xdpf->len > bp->max_tx_length)
+		return -ENOSPC;
+
+	if (dma_map) {
+		mapping = dma_map_single(&bp->pdev->dev, xdpf->data,
+					 xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(&bp->pdev->dev, mapping))
+			return -ENOMEM;
+		addr = mapping;
+	} else {
+		/* XDP runs on order-0 page pool pages only */
+		mapping = 0;
+		addr = page_pool_get_dma_addr(virt_to_page(xdpf->data)) +
+		       offset_in_page(xdpf->data);
+		dma_sync_single_for_device(&bp->pdev->dev, addr, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	tx_skb = macb_tx_skb(queue, queue->tx_head);
+	tx_skb->skb = NULL;
+	tx_skb->xdpf = xdpf;
+	tx_skb->mapping = mapping;
+	tx_skb->size = xdpf->len;
+	tx_skb->mapped_as_page = false;
+	tx_skb->xsk = false;
+
+	gem_tx_post_single(queue, addr, xdpf->len);
+
+	return 0;
+}
+
+/* Ring the TX doorbell once for everything queued so far. NCR is shared by
+ * all queues and only ever updated with a read-modify-write under bp->lock,
+ * so callers batch as many frames as they can per TSTART.
+ */
+static void macb_tx_start(struct macb *bp)
+{
+	unsigned long flags;
+
+	/* Make newly initialized descriptors visible to hardware */
+	wmb();
+
+	spin_lock_irqsave(&bp->lock, flags);
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
+static int gem_xdp_xmit_back(struct macb_queue *queue, struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	int ret;
+
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	spin_lock(&queue->tx_ptr_lock);
+	ret = gem_xdp_xmit_frame(queue, xdpf, false);
+	spin_unlock(&queue->tx_ptr_lock);
+
+	return ret;
+}
+
+static int gem_run_xdp(struct macb_queue *queue, struct bpf_prog *prog,
+		       struct xdp_buff *xdp)
+{
+	struct net_device *dev = queue->bp->dev;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return MACB_XDP_PASS;
+	case XDP_TX:
+		if (gem_xdp_xmit_back(queue, xdp))
+			goto out_failure;
+		return MACB_XDP_TX;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(dev, xdp, prog))
+			goto out_failure;
+		return MACB_XDP_REDIRECT;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	return MACB_XDP_CONSUMED;
+}
+
+static void gem_rx_deliver(struct macb_queue *queue, struct napi_struct *napi,
+			   struct sk_buff *skb, struct macb_dma_desc *desc,
+			   u32 ctrl)
+{
+	struct macb *bp = queue->bp;
+
+	skb->protocol = eth_type_trans(skb, bp->dev);
+
+	skb_checksum_none_assert(skb);
+	if (bp->dev->features & NETIF_F_RXCSUM &&
+	    !(bp->dev->flags & IFF_PROMISC) &&
+	    GEM_BFEXT(RX_CSUM, ctrl) & GEM_RX_CSUM_CHECKED_MASK)
+		skb->ip_summed = CHECKSUM_UNNECESSARY;
+
+	bp->dev->stats.rx_packets++;
+	queue->stats.rx_packets++;
+	bp->dev->stats.rx_bytes += skb->len;
+	queue->stats.rx_bytes += skb->len;
+
+	gem_ptp_do_rxstamp(bp, skb, desc);
+
+#if defined(DEBUG) && defined(VERBOSE_DEBUG)
+	netdev_vdbg(bp->dev, "received skb of length %u, csum: %08x\n",
+		    skb->len, skb->csum);
+	print_hex_dump(KERN_DEBUG, " mac: ", DUMP_PREFIX_ADDRESS, 16, 1,
+		       skb_mac_header(skb), 16, true);
+	print_hex_dump(KERN_DEBUG, "data: ", DUMP_PREFIX_ADDRESS, 16, 1,
+		       skb->data, 32, true);
+#endif
+
+	napi_gro_receive(napi, skb);
+}
+
+static int gem_run_xdp_zc(struct macb_queue *queue, struct bpf_prog *prog,
+			  struct xdp_buff *xdp)
+{
+	struct net_device *dev = queue->bp->dev;
+	struct xdp_frame *xdpf;
+	int ret;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return MACB_XDP_PASS;
+	case XDP_TX:
+		/* The frame is copied out of the XSK buffer */
+		xdpf = xdp_convert_zc_to_xdp_frame(xdp);
+		if (unlikely(!xdpf))
+			goto out_failure;
+		spin_lock(&queue->tx_ptr_lock);
+		ret = gem_xdp_xmit_frame(queue, xdpf, true);
+		spin_unlock(&queue->tx_ptr_lock);
+		if (ret) {
+			xdp_return_frame(xdpf);
+			goto out_failure;
+		}
+		return MACB_XDP_TX;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(dev, xdp, prog))
+			goto out_failure;
+		return MACB_XDP_REDIRECT;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	return MACB_XDP_CONSUMED;
+}
+
+/* RX poll of a queue bound to an AF_XDP socket in zero-copy mode. Frames
+ * are received straight into the XSK pool buffers; XDP_PASS copies them
+ * into a regular skb, every verdict except XDP_REDIRECT gives the buffer
+ * back to the pool.
+ */
+static int gem_rx_zc(struct macb_queue *queue, struct napi_struct *napi,
+		     int budget)
+{
+	struct macb *bp = queue->bp;
+	struct bpf_prog		*xdp_prog = READ_ONCE(bp->xdp_prog);
+	struct xsk_buff_pool	*pool = queue->xsk_pool;
+	unsigned int		entry;
+	unsigned int		len;
+	struct macb_dma_desc	*desc;
+	struct sk_buff		*skb;
+	struct xdp_buff		*xdp;
+	int			xdp_status = 0;
+	int			count = 0;
+	bool			failure;
+
+	while (count < budget) {
+		u32 ctrl;
+		bool rxused;
+		int xdp_res;
+
+		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
+		desc = macb_rx_desc(queue, entry);
+
+		/* Make hw descriptor updates visible to CPU */
+		rmb();
+
+		rxused = (desc->addr & MACB_BIT(RX_USED)) ? true : false;
+		if (!rxused)
+			break;
+
+		/* Ensure ctrl is at least as up-to-date as rxused */
+		dma_rmb();
+
+		ctrl = desc->ctrl;
+
+		queue->rx_tail++;
+		count++;
+
+		if (!(ctrl & MACB_BIT(RX_SOF) && ctrl & MACB_BIT(RX_EOF))) {
+			netdev_err(bp->dev,
+				   "not whole frame pointed by descriptor\n");
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			break;
+		}
+		xdp = queue->rx_xsk[entry];
+		if (unlikely(!xdp)) {
+			netdev_err(bp->dev,
+				   "inconsistent Rx descriptor chain\n");
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			break;
+		}
+		queue->rx_xsk[entry] = NULL;
+		len = ctrl & bp->rx_frm_len_mask;
+
+		netdev_vdbg(bp->dev, "gem_rx_zc %u (len %u)\n", entry, len);
+
+		xdp->data += NET_IP_ALIGN;
+		xdp->data_meta = xdp->data;
+		xdp->data_end = xdp->data + len;
+		xsk_buff_dma_sync_for_cpu(xdp, pool);
+
+		/* Validate MAC fcs if RX checsum offload disabled */
+		if (!(bp->dev->features & NETIF_F_RXCSUM)) {
+			if (macb_validate_fcs(xdp->data, len)) {
+				netdev_err(bp->dev, "incorrect FCS\n");
+				bp->dev->stats.rx_dropped++;
+				xsk_buff_free(xdp);
+				break;
+			}
+			xdp->data_end -= ETH_FCS_LEN;
+		}
+
+		xdp_res = MACB_XDP_PASS;
+		if (xdp_prog)
+			xdp_res = gem_run_xdp_zc(queue, xdp_prog, xdp);
+
+		if (xdp_res == MACB_XDP_REDIRECT) {
+			xdp_status |= xdp_res;
+		} else if (xdp_res == MACB_XDP_PASS) {
+			len = xdp->data_end - xdp->data;
+			skb = napi_alloc_skb(napi, len);
+			if (unlikely(!skb)) {
+				xsk_buff_free(xdp);
+				bp->dev->stats.rx_dropped++;
+				queue->stats.rx_dropped++;
+				continue;
+			}
+			skb_put_data(skb, xdp->data, len);
+			xsk_buff_free(xdp);
+
+			gem_rx_deliver(queue, napi, skb, desc, ctrl);
+			continue;
+		} else {
+			xdp_status |= xdp_res;
+			xsk_buff_free(xdp);
+		}
+
+		bp->dev->stats.rx_packets++;
+		queue->stats.rx_packets++;
+		bp->dev->stats.rx_bytes += len;
+		queue->stats.rx_bytes += len;
+	}
+
+	if (xdp_status & MACB_XDP_REDIRECT)
+		xdp_do_flush();
+	if (xdp_status & MACB_XDP_TX)
+		macb_tx_start(bp);
+
+	failure = !gem_rx_refill_zc(queue);
+
+	/* With need_wakeup user space kicks us once it has refilled the
+	 * pool, otherwise keep polling until buffers show up again.
+	 */
+	if (xsk_uses_need_wakeup(pool)) {
+		if (failure || queue->rx_tail == queue->rx_prepared_head)
+			xsk_set_rx_need_wakeup(pool);
+		else
+			xsk_clear_rx_need_wakeup(pool);
+		return count;
+	}
+
+	return failure ? budget : count;
+}
+
 static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		  int budget)
 {
 	struct macb *bp = queue->bp;
+	struct bpf_prog		*xdp_prog = READ_ONCE(bp->xdp_prog);
+	struct page_pool	*pool = queue->page_pool;
 	unsigned int		len;
 	unsigned int		entry;
 	struct sk_buff		*skb;
 	struct macb_dma_desc	*desc;
+	struct xdp_buff		xdp;
+	struct page		*page;
+	int			xdp_status = 0;
 	int			count = 0;
 
+	if (queue->xsk_pool)
+		return gem_rx_zc(queue, napi, budget);
+
+	xdp_init_buff(&xdp, PAGE_SIZE << bp->rx_page_order, &queue->xdp_rxq);
+
 	while (count < budget) {
 		u32 ctrl;
 		dma_addr_t addr;
 		bool rxused;
+		int xdp_res;
 
 		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
 		desc = macb_rx_desc(queue, entry);
@@ -1418,8 +1894,8 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			queue->stats.rx_dropped++;
 			break;
 		}
-		skb = queue->rx_skbuff[entry];
-		if (unlikely(!skb)) {
+		page = queue->rx_page[entry];
+		if (unlikely(!page)) {
 			netdev_err(bp->dev,
 				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
@@ -1427,51 +1903,65 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			break;
 		}
 		/* now everything is ready for receiving packet */
-		queue->rx_skbuff[entry] = NULL;
+		queue->rx_page[entry] = NULL;
 		len = ctrl & bp->rx_frm_len_mask;
 
 		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
 
-		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
-
-		skb->protocol = eth_type_trans(skb, bp->dev);
+		dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+					len + NET_IP_ALIGN,
+					page_pool_get_dma_dir(pool));
+		xdp_prepare_buff(&xdp, page_address(page),
+				 bp->rx_headroom + NET_IP_ALIGN, len, false);
 
 		/* Validate MAC fcs if RX checsum offload disabled */
 		if (!(bp->dev->features & NETIF_F_RXCSUM)) {
-			if (macb_validate_hw_csum(skb)) {
+			if (macb_validate_fcs(xdp.data, len)) {
 				netdev_err(bp->dev, "incorrect FCS\n");
 				bp->dev->stats.rx_dropped++;
+				page_pool_recycle_direct(pool, page);
 				break;
 			}
+			/* XDP programs see the frame without its FCS */
+			if (xdp_prog)
+				xdp.data_end -= ETH_FCS_LEN;
 		}
 
-		skb_checksum_none_assert(skb);
-		if (bp->dev->features & NETIF_F_RXCSUM &&
-		    !(bp->dev->flags & IFF_PROMISC) &&
-		    GEM_BFEXT(RX_CSUM, ctrl) & GEM_RX_CSUM_CHECKED_MASK)
-			skb->ip_summed = CHECKSUM_UNNECESSARY;
-
-		bp->dev->stats.rx_packets++;
-		queue->stats.rx_packets++;
-		bp->dev->stats.rx_bytes += skb->len;
-		queue->stats.rx_bytes += skb->len;
-
-		gem_ptp_do_rxstamp(bp, skb, desc);
+		if (xdp_prog) {
+			xdp_res = gem_run_xdp(queue, xdp_prog, &xdp);
+			if (xdp_res != MACB_XDP_PASS) {
+				if (xdp_res == MACB_XDP_CONSUMED)
+					page_pool_recycle_direct(pool, page);
+				else
+					xdp_status |= xdp_res;
+
+				bp->dev->stats.rx_packets++;
+				queue->stats.rx_packets++;
+				bp->dev->stats.rx_bytes += len;
+				queue->stats.rx_bytes += len;
+				continue;
+			}
+		}
 
-#if defined(DEBUG) && defined(VERBOSE_DEBUG)
-		netdev_vdbg(bp->dev, "received skb of length %u, csum: %08x\n",
-			    skb->len, skb->csum);
-		print_hex_dump(KERN_DEBUG, " mac: ", DUMP_PREFIX_ADDRESS, 16, 1,
-			       skb_mac_header(skb), 16, true);
-		print_hex_dump(KERN_DEBUG, "data: ", DUMP_PREFIX_ADDRESS, 16, 1,
-			       skb->data, 32, true);
-#endif
+		skb = build_skb(xdp.data_hard_start, xdp.frame_sz);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(pool, page);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			continue;
+		}
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		skb_put(skb, xdp.data_end - xdp.data);
 
-		napi_gro_receive(napi, skb);
+		gem_rx_deliver(queue, napi, skb, desc, ctrl);
 	}
 
+	if (xdp_status & MACB_XDP_REDIRECT)
+		xdp_do_flush();
+	if (xdp_status & MACB_XDP_TX)
+		macb_tx_start(bp);
+
 	gem_rx_refill(queue);
 
 	return count;
@@ -1763,6 +2253,52 @@ static bool macb_tx_complete_pending(struct macb_queue *queue)
 	return retval;
 }
 
+/* Send up to budget frames from the AF_XDP Tx ring of a zero-copy queue.
+ * Returns true when the Tx ring of the socket was drained.
+ */
+static bool gem_xsk_xmit(struct macb_queue *queue, unsigned int budget)
+{
+	struct xsk_buff_pool *pool = queue->xsk_pool;
+	struct macb *bp = queue->bp;
+	struct macb_tx_skb *tx_skb;
+	struct xdp_desc xdp_desc;
+	unsigned int sent = 0;
+	dma_addr_t addr;
+
+	spin_lock(&queue->tx_ptr_lock);
+	while (sent < budget &&
+	       CIRC_SPACE(queue->tx_head, queue->tx_tail,
+			  bp->tx_ring_size) >= 1) {
+		if (!xsk_tx_peek_desc(pool, &xdp_desc))
+			break;
+
+		addr = xsk_buff_raw_get_dma(pool, xdp_desc.addr);
+		xsk_buff_raw_dma_sync_for_device(pool, addr, xdp_desc.len);
+
+		tx_skb = macb_tx_skb(queue, queue->tx_head);
+		tx_skb->skb = NULL;
+		tx_skb->xdpf = NULL;
+		tx_skb->mapping = 0;
+		tx_skb->size = xdp_desc.len;
+		tx_skb->mapped_as_page = false;
+		tx_skb->xsk = true;
+
+		gem_tx_post_single(queue, addr, xdp_desc.len);
+		sent++;
+	}
+	spin_unlock(&queue->tx_ptr_lock);
+
+	if (sent) {
+		xsk_tx_release(pool);
+		macb_tx_start(bp);
+	}
+
+	if (xsk_uses_need_wakeup(pool))
+		xsk_set_tx_need_wakeup(pool);
+
+	return sent < budget;
+}
+
 static int macb_tx_poll(struct napi_struct *napi, int budget)
 {
 	struct macb_queue *queue = container_of(napi, struct macb_queue, napi_tx);
@@ -1771,6 +2307,10 @@ static int macb_tx_poll(struct napi_struct *napi, int budget)
 
 	work_done = macb_tx_complete(queue, budget);
 
+	/* Keep polling while the AF_XDP socket has more to send */
+	if (queue->xsk_pool && !gem_xsk_xmit(queue, budget))
+		work_done = budget;
+
 	rmb(); // ensure txubr_pending is up to date
 	if (queue->txubr_pending) {
 		queue->txubr_pending = false;
@@ -2031,9 +2571,11 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 		/* Save info to properly release resources */
 		tx_skb->skb = NULL;
+		tx_skb->xdpf = NULL;
 		tx_skb->mapping = mapping;
 		tx_skb->size = size;
 		tx_skb->mapped_as_page = false;
+		tx_skb->xsk = false;
 
 		len -= size;
 		offset += size;
@@ -2061,9 +2603,11 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 			/* Save info to properly release resources */
 			tx_skb->skb = NULL;
+			tx_skb->xdpf = NULL;
 			tx_skb->mapping = mapping;
 			tx_skb->size = size;
 			tx_skb->mapped_as_page = true;
+			tx_skb->xsk = false;
 
 			len -= size;
 			offset += size;
@@ -2286,15 +2830,11 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	bool is_lso;
 	netdev_tx_t ret = NETDEV_TX_OK;
 
-	if (macb_clear_csum(skb)) {
-		dev_kfree_skb_any(skb);
-		return ret;
-	}
+	if (macb_clear_csum(skb))
+		goto drop;
 
-	if (macb_pad_and_fcs(&skb, dev)) {
-		dev_kfree_skb_any(skb);
-		return ret;
-	}
+	if (macb_pad_and_fcs(&skb, dev))
+		goto drop;
 
 	is_lso = (skb_shinfo(skb)->gso_size != 0);
 
@@ -2346,30 +2886,40 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		netdev_dbg(bp->dev, "tx_head = %u, tx_tail = %u\n",
 			   queue->tx_head, queue->tx_tail);
 		ret = NETDEV_TX_BUSY;
-		goto unlock;
+		goto kick;
 	}
 
 	/* Map socket buffer for DMA transfer */
 	if (!macb_tx_map(bp, queue, skb, hdrlen)) {
 		dev_kfree_skb_any(skb);
-		goto unlock;
+		goto kick;
 	}
 
-	/* Make newly initialized descriptor visible to hardware */
-	wmb();
 	skb_tx_timestamp(skb);
 
-	spin_lock_irq(&bp->lock);
-	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
-	spin_unlock_irq(&bp->lock);
-
 	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
 		netif_stop_subqueue(dev, queue_index);
 
+kick:
+	/* Frames queued with xmit_more set are started together with the
+	 * last one of the burst, or as soon as the queue had to be stopped.
+	 */
+	if (!netdev_xmit_more() || __netif_subqueue_stopped(dev, queue_index))
+		macb_tx_start(bp);
+
 unlock:
 	spin_unlock_bh(&queue->tx_ptr_lock);
 
 	return ret;
+
+drop:
+	dev_kfree_skb_any(skb);
+
+	/* Don't leave the rest of the burst waiting for its doorbell */
+	if (!netdev_xmit_more())
+		macb_tx_start(bp);
+
+	return ret;
 }
 
 static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
@@ -2386,6 +2936,12 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 			bp->rx_buffer_size =
 				roundup(bp->rx_buffer_size, RX_BUFFER_MULTIPLE);
 		}
+
+		bp->rx_headroom = bp->xdp_prog ? XDP_PACKET_HEADROOM :
+						 NET_SKB_PAD;
+		bp->rx_page_order =
+			get_order(GEM_RX_TRUESIZE(bp->rx_headroom,
+						  bp->rx_buffer_size));
 	}
 
 	netdev_dbg(bp->dev, "mtu [%u] rx_buffer_size [%zu]\n",
@@ -2394,34 +2950,41 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
 	struct macb_queue *queue;
-	dma_addr_t		addr;
+	struct page *page;
 	unsigned int q;
 	int i;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		if (!queue->rx_skbuff)
-			continue;
+		if (queue->rx_xsk) {
+			for (i = 0; i < bp->rx_ring_size; i++) {
+				if (queue->rx_xsk[i])
+					xsk_buff_free(queue->rx_xsk[i]);
+			}
 
-		for (i = 0; i < bp->rx_ring_size; i++) {
-			skb = queue->rx_skbuff[i];
+			kfree(queue->rx_xsk);
+			queue->rx_xsk = NULL;
+		}
 
-			if (!skb)
-				continue;
+		if (queue->rx_page) {
+			for (i = 0; i < bp->rx_ring_size; i++) {
+				page = queue->rx_page[i];
 
-			desc = macb_rx_desc(queue, i);
-			addr = macb_get_addr(bp, desc);
+				if (!page)
+					continue;
 
-			dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-					DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			skb = NULL;
+				page_pool_put_full_page(queue->page_pool, page,
+							false);
+			}
+
+			kfree(queue->rx_page);
+			queue->rx_page = NULL;
 		}
 
-		kfree(queue->rx_skbuff);
-		queue->rx_skbuff = NULL;
+		if (xdp_rxq_info_is_reg(&queue->xdp_rxq))
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+		page_pool_destroy(queue->page_pool);
+		queue->page_pool = NULL;
 	}
 }
 
@@ -2469,21 +3032,106 @@ static void macb_free_consistent(struct macb *bp)
 	}
 }
 
+/* Each GEM queue takes its RX buffers from its own page pool, which maps
+ * the pages once and only syncs the frame area back to the device when a
+ * page is recycled. With an XDP program attached the pages are mapped
+ * bidirectionally so that XDP_TX can send them without remapping.
+ */
+static int gem_create_page_pool(struct macb *bp, struct macb_queue *queue,
+				unsigned int q)
+{
+	struct page_pool_params pp_params = { 0 };
+	int err;
+
+	pp_params.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
+	pp_params.order = bp->rx_page_order;
+	pp_params.pool_size = bp->rx_ring_size;
+	pp_params.nid = dev_to_node(&bp->pdev->dev);
+	pp_params.dev = &bp->pdev->dev;
+	pp_params.dma_dir = bp->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
+	pp_params.offset = bp->rx_headroom;
+	pp_params.max_len = bp->rx_buffer_size;
+
+	queue->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(queue->page_pool)) {
+		err = PTR_ERR(queue->page_pool);
+		queue->page_pool = NULL;
+		return err;
+	}
+
+	err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q,
+			       queue->napi_rx.napi_id);
+	if (err)
+		return err;
+
+	err = xdp_rxq_info_reg_mem_model(&queue->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 queue->page_pool);
+	if (err)
+		xdp_rxq_info_unreg(&queue->xdp_rxq);
+
+	return err;
+}
+
+/* Queues bound to an AF_XDP socket receive into the XSK pool buffers */
+static int gem_alloc_rx_xsk(struct macb *bp, struct macb_queue *queue,
+			    unsigned int q)
+{
+	int size;
+	int err;
+
+	size = bp->rx_ring_size * sizeof(struct xdp_buff *);
+	queue->rx_xsk = kzalloc(size, GFP_KERNEL);
+	if (!queue->rx_xsk)
+		return -ENOMEM;
+
+	err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q,
+			       queue->napi_rx.napi_id);
+	if (err)
+		return err;
+
+	err = xdp_rxq_info_reg_mem_model(&queue->xdp_rxq,
+					 MEM_TYPE_XSK_BUFF_POOL, NULL);
+	if (err) {
+		xdp_rxq_info_unreg(&queue->xdp_rxq);
+		return err;
+	}
+
+	xsk_pool_set_rxq_info(queue->xsk_pool, &queue->xdp_rxq);
+
+	return 0;
+}
+
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
 	struct macb_queue *queue;
 	unsigned int q;
 	int size;
+	int err;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		size = bp->rx_ring_size * sizeof(struct sk_buff *);
-		queue->rx_skbuff = kzalloc(size, GFP_KERNEL);
-		if (!queue->rx_skbuff)
+		if (queue->xsk_pool) {
+			err = gem_alloc_rx_xsk(bp, queue, q);
+			if (err)
+				return err;
+			continue;
+		}
+
+		size = bp->rx_ring_size * sizeof(struct page *);
+		queue->rx_page = kzalloc(size, GFP_KERNEL);
+		if (!queue->rx_page)
 			return -ENOMEM;
 		else
 			netdev_dbg(bp->dev,
-				   "Allocated %d RX struct sk_buff entries at %p\n",
-				   bp->rx_ring_size, queue->rx_skbuff);
+				   "Allocated %d RX page entries at %p\n",
+				   bp->rx_ring_size, queue->rx_page);
+
+		err = gem_create_page_pool(bp, queue, q);
+		if (err) {
+			netdev_err(bp->dev,
+				   "Unable to create page pool for queue %u (error %d)\n",
+				   q, err);
+			return err;
+		}
 	}
 	return 0;
 }
@@ -3023,16 +3671,216 @@ static int macb_close(struct net_device *dev)
 	return 0;
 }
 
+static size_t gem_rx_buffer_size(unsigned int mtu)
+{
+	return roundup(mtu + ETH_HLEN + ETH_FCS_LEN + NET_IP_ALIGN,
+		       RX_BUFFER_MULTIPLE);
+}
+
+static bool gem_xdp_mtu_ok(unsigned int mtu)
+{
+	size_t bufsz = gem_rx_buffer_size(mtu);
+
+	/* XDP needs the whole frame in a single order-0 page */
+	return GEM_RX_TRUESIZE(XDP_PACKET_HEADROOM, bufsz) <= PAGE_SIZE;
+}
+
+/* Every frame must fit in a single XSK buffer, the hardware does not
+ * split frames over several descriptors for us.
+ */
+static bool gem_xsk_mtu_ok(struct xsk_buff_pool *pool, unsigned int mtu)
+{
+	return xsk_pool_get_rx_frame_size(pool) >= gem_rx_buffer_size(mtu);
+}
+
 static int macb_change_mtu(struct net_device *dev, int new_mtu)
 {
+	struct macb *bp = netdev_priv(dev);
+	struct xsk_buff_pool *pool;
+	unsigned int q;
+
 	if (netif_running(dev))
 		return -EBUSY;
 
+	if (bp->xdp_prog && !gem_xdp_mtu_ok(new_mtu)) {
+		netdev_err(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
+	for (q = 0; q < bp->num_queues; q++) {
+		pool = bp->queues[q].xsk_pool;
+		if (pool && !gem_xsk_mtu_ok(pool, new_mtu)) {
+			netdev_err(dev, "MTU %d too large for AF_XDP queue %u\n",
+				   new_mtu, q);
+			return -EINVAL;
+		}
+	}
+
 	dev->mtu = new_mtu;
 
 	return 0;
 }
 
+static int gem_xdp_xmit(struct net_device *dev, int num_frames,
+			struct xdp_frame **frames, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !READ_ONCE(bp->xdp_prog)))
+		return -ENETDOWN;
+
+	queue = &bp->queues[smp_processor_id() % bp->num_queues];
+
+	spin_lock(&queue->tx_ptr_lock);
+	for (i = 0; i < num_frames; i++) {
+		if (gem_xdp_xmit_frame(queue, frames[i], true))
+			break;
+		nxmit++;
+	}
+	spin_unlock(&queue->tx_ptr_lock);
+
+	if (nxmit && (flags & XDP_XMIT_FLUSH))
+		macb_tx_start(bp);
+
+	return nxmit;
+}
+
+/* The RX page pools are laid out and mapped differently when XDP is in
+ * use, so the interface is restarted when XDP is turned on or off.
+ * Replacing one program with another is done in place.
+ */
+static int gem_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			 struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct bpf_prog *old_prog;
+	bool need_reset;
+
+	if (!macb_is_gem(bp)) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP is only supported on GEM");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && !gem_xdp_mtu_ok(dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	need_reset = !!bp->xdp_prog != !!prog;
+	if (running && need_reset)
+		macb_close(dev);
+
+	old_prog = xchg(&bp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (running && need_reset)
+		return macb_open(dev);
+
+	return 0;
+}
+
+/* Bind or unbind an AF_XDP zero-copy socket to one queue. The RX ring of
+ * the queue is refilled from the XSK pool instead of the page pool, so
+ * the interface is restarted to rebuild the rings.
+ */
+static int gem_xsk_pool_setup(struct net_device *dev,
+			      struct xsk_buff_pool *pool, u16 qid)
+{
+	struct macb *bp = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct macb_queue *queue;
+	int err;
+
+	if (!macb_is_gem(bp))
+		return -EOPNOTSUPP;
+
+	if (qid >= bp->num_queues)
+		return -EINVAL;
+
+	queue = &bp->queues[qid];
+
+	if (pool) {
+		if (queue->xsk_pool)
+			return -EBUSY;
+
+		if (!gem_xsk_mtu_ok(pool, dev->mtu))
+			return -EINVAL;
+
+		/* The hardware ignores the low bits of RX buffer addresses
+		 * up to the width of the data bus.
+		 */
+		if (!IS_ALIGNED(xsk_pool_get_headroom(pool), 16))
+			return -EINVAL;
+
+		err = xsk_pool_dma_map(pool, &bp->pdev->dev, 0);
+		if (err)
+			return err;
+	} else {
+		pool = queue->xsk_pool;
+		if (!pool)
+			return -EINVAL;
+	}
+
+	if (running)
+		macb_close(dev);
+
+	if (queue->xsk_pool) {
+		WRITE_ONCE(queue->xsk_pool, NULL);
+		xsk_pool_dma_unmap(pool, 0);
+	} else {
+		WRITE_ONCE(queue->xsk_pool, pool);
+	}
+
+	if (running)
+		return macb_open(dev);
+
+	return 0;
+}
+
+static int gem_xsk_wakeup(struct net_device *dev, u32 qid, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+
+	if (!netif_running(dev))
+		return -ENETDOWN;
+
+	if (qid >= bp->num_queues || !READ_ONCE(bp->queues[qid].xsk_pool))
+		return -ENXIO;
+
+	queue = &bp->queues[qid];
+
+	if ((flags & XDP_WAKEUP_RX) &&
+	    !napi_if_scheduled_mark_missed(&queue->napi_rx))
+		napi_schedule(&queue->napi_rx);
+
+	if ((flags & XDP_WAKEUP_TX) &&
+	    !napi_if_scheduled_mark_missed(&queue->napi_tx))
+		napi_schedule(&queue->napi_tx);
+
+	return 0;
+}
+
+static int macb_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return gem_xdp_setup(dev, bpf->prog, bpf->extack);
+	case XDP_SETUP_XSK_POOL:
+		return gem_xsk_pool_setup(dev, bpf->xsk.pool,
+					  bpf->xsk.queue_id);
+	default:
+		return -EINVAL;
+	}
+}
+
 static void gem_update_stats(struct macb *bp)
 {
 	struct macb_queue *queue;
@@ -3868,6 +4716,9 @@ static const struct net_device_ops macb_netdev_ops = {
 #endif
 	.ndo_set_features	= macb_set_features,
 	.ndo_features_check	= macb_features_check,
+	.ndo_bpf		= macb_bpf,
+	.ndo_xdp_xmit		= gem_xdp_xmit,
+	.ndo_xsk_wakeup		= gem_xsk_wakeup,
 };
 
 /* Configure peripheral capabilities according to device tree
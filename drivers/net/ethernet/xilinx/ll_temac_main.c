@@ -321,6 +321,22 @@ static void temac_dma_bd_release(struct net_device *ndev)
 				  lp->tx_bd_v, lp->tx_bd_p);
 }
 
+/*
+ * temac_rx_irq_enable - Enable or mask the RX packet interrupts.  The
+ * coalesce count and delay are always programmed, so the ethtool
+ * settings stay in effect whenever NAPI returns to interrupt mode.
+ */
+static void temac_rx_irq_enable(struct temac_local *lp, bool enable)
+{
+	u32 ctrl;
+
+	ctrl = lp->coalesce_delay_rx << 24 | lp->coalesce_count_rx << 16 |
+	       CHNL_CTRL_IRQ_IOE | CHNL_CTRL_IRQ_EN | CHNL_CTRL_IRQ_ERR_EN;
+	if (enable)
+		ctrl |= CHNL_CTRL_IRQ_DLY_EN | CHNL_CTRL_IRQ_COAL_EN;
+	lp->dma_out(lp, RX_CHNL_CTRL, ctrl);
+}
+
 /*
  * temac_dma_bd_init - Setup buffer descriptor rings
  */
@@ -383,11 +399,7 @@ static int temac_dma_bd_init(struct net_device *ndev)
 		    0x00000400 | // Use 1 Bit Wide Counters. Currently Not Used!
 		    CHNL_CTRL_IRQ_EN | CHNL_CTRL_IRQ_ERR_EN |
 		    CHNL_CTRL_IRQ_DLY_EN | CHNL_CTRL_IRQ_COAL_EN);
-	lp->dma_out(lp, RX_CHNL_CTRL,
-		    lp->coalesce_delay_rx << 24 | lp->coalesce_count_rx << 16 |
-		    CHNL_CTRL_IRQ_IOE |
-		    CHNL_CTRL_IRQ_EN | CHNL_CTRL_IRQ_ERR_EN |
-		    CHNL_CTRL_IRQ_DLY_EN | CHNL_CTRL_IRQ_COAL_EN);
+	temac_rx_irq_enable(lp, true);
 
 	/* Init descriptor indexes */
 	lp->tx_bd_ci = 0;
@@ -967,21 +979,19 @@ static int ll_temac_recv_buffers_available(struct temac_local *lp)
 	return available;
 }
 
-static void ll_temac_recv(struct net_device *ndev)
+static int ll_temac_recv(struct net_device *ndev, int budget)
 {
 	struct temac_local *lp = netdev_priv(ndev);
-	unsigned long flags;
 	int rx_bd;
 	bool update_tail = false;
+	int work_done = 0;
 
-	spin_lock_irqsave(&lp->rx_lock, flags);
-
-	/* Process all received buffers, passing them on network
-	 * stack.  After this, the buffer descriptors will be in an
-	 * un-allocated stage, where no skb is allocated for it, and
-	 * they are therefore not available for TEMAC/DMA.
+	/* Process received buffers up to the NAPI budget, passing them
+	 * on network stack.  After this, the buffer descriptors will be
+	 * in an un-allocated stage, where no skb is allocated for it,
+	 * and they are therefore not available for TEMAC/DMA.
 	 */
-	do {
+	while (work_done < budget) {
 		struct cdmac_bd *bd = &lp->rx_bd_v[lp->rx_bd_ci];
 		struct sk_buff *skb = lp->rx_skb[lp->rx_bd_ci];
 		unsigned int bdstat = be32_to_cpu(bd->app0);
@@ -1023,17 +1033,20 @@ static void ll_temac_recv(struct net_device *ndev)
 		}
 
 		if (!skb_defer_rx_timestamp(skb))
-			netif_rx(skb);
+			napi_gro_receive(&lp->napi, skb);
 		/* The skb buffer is now owned by network stack above */
 		lp->rx_skb[lp->rx_bd_ci] = NULL;
 
 		ndev->stats.rx_packets++;
 		ndev->stats.rx_bytes += length;
+		work_done++;
 
 		rx_bd = lp->rx_bd_ci;
 		if (++lp->rx_bd_ci >= lp->rx_bd_num)
 			lp->rx_bd_ci = 0;
-	} while (rx_bd != lp->rx_bd_tail);
+		if (rx_bd == lp->rx_bd_tail)
+			break;
+	}
 
 	/* DMA operations will halt when the last buffer descriptor is
 	 * processed (ie. the one pointed to by RX_TAILDESC_PTR).
@@ -1041,8 +1054,8 @@ static void ll_temac_recv(struct net_device *ndev)
 	 * generated.  No IRQ_COAL or IRQ_DLY, and not even an
 	 * IRQ_ERR.  To avoid stalling, we schedule a delayed work
 	 * when there is a potential risk of that happening.  The work
-	 * will call this function, and thus re-schedule itself until
-	 * enough buffers are available again.
+	 * will schedule NAPI, and thus re-schedule itself until enough
+	 * buffers are available again.
 	 */
 	if (ll_temac_recv_buffers_available(lp) < lp->coalesce_count_rx)
 		schedule_delayed_work(&lp->restart_work, HZ / 1000);
@@ -1069,7 +1082,7 @@ static void ll_temac_recv(struct net_device *ndev)
 		if (bd->phys)
 			break;	/* All skb's allocated */
 
-		skb = netdev_alloc_skb_ip_align(ndev, XTE_MAX_JUMBO_FRAME_SIZE);
+		skb = napi_alloc_skb(&lp->napi, XTE_MAX_JUMBO_FRAME_SIZE);
 		if (!skb) {
 			dev_warn(&ndev->dev, "skb alloc failed\n");
 			break;
@@ -1099,7 +1112,36 @@ static void ll_temac_recv(struct net_device *ndev)
 			lp->rx_bd_p + sizeof(*lp->rx_bd_v) * lp->rx_bd_tail);
 	}
 
-	spin_unlock_irqrestore(&lp->rx_lock, flags);
+	return work_done;
+}
+
+/* Mask the RX packet interrupts and hand the ring over to NAPI */
+static void ll_temac_rx_napi_schedule(struct temac_local *lp)
+{
+	if (napi_schedule_prep(&lp->napi)) {
+		temac_rx_irq_enable(lp, false);
+		__napi_schedule(&lp->napi);
+	}
+}
+
+static int ll_temac_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct temac_local *lp = container_of(napi, struct temac_local, napi);
+	int work_done;
+
+	work_done = ll_temac_recv(lp->ndev, budget);
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		temac_rx_irq_enable(lp, true);
+		/* A frame completed while the interrupts were masked
+		 * does not raise one on unmask, so pick it up here.
+		 */
+		if (lp->rx_skb[lp->rx_bd_ci] &&
+		    (be32_to_cpu(lp->rx_bd_v[lp->rx_bd_ci].app0) &
+		     STS_CTRL_APP0_CMPLT))
+			ll_temac_rx_napi_schedule(lp);
+	}
+
+	return work_done;
 }
 
 /* Function scheduled to ensure a restart in case of DMA halt
@@ -1109,9 +1151,10 @@ static void ll_temac_restart_work_func(struct work_struct *work)
 {
 	struct temac_local *lp = container_of(work, struct temac_local,
 					      restart_work.work);
-	struct net_device *ndev = lp->ndev;
 
-	ll_temac_recv(ndev);
+	local_bh_disable();
+	ll_temac_rx_napi_schedule(lp);
+	local_bh_enable();
 }
 
 static irqreturn_t ll_temac_tx_irq(int irq, void *_ndev)
@@ -1144,7 +1187,7 @@ static irqreturn_t ll_temac_rx_irq(int irq, void *_ndev)
 	lp->dma_out(lp, RX_IRQ_REG, status);
 
 	if (status & (IRQ_COAL | IRQ_DLY))
-		ll_temac_recv(lp->ndev);
+		ll_temac_rx_napi_schedule(lp);
 	if (status & (IRQ_ERR | IRQ_DMAERR))
 		dev_err_ratelimited(&ndev->dev,
 				    "RX error 0x%x RX_CHNL_STS=0x%08x\n",
@@ -1181,6 +1224,8 @@ static int temac_open(struct net_device *ndev)
 
 	temac_device_reset(ndev);
 
+	napi_enable(&lp->napi);
+
 	rc = request_irq(lp->tx_irq, ll_temac_tx_irq, 0, ndev->name, ndev);
 	if (rc)
 		goto err_tx_irq;
@@ -1193,6 +1238,7 @@ static int temac_open(struct net_device *ndev)
  err_rx_irq:
 	free_irq(lp->tx_irq, ndev);
  err_tx_irq:
+	napi_disable(&lp->napi);
 	if (phydev)
 		phy_disconnect(phydev);
 	dev_err(lp->dev, "request_irq() failed\n");
@@ -1206,6 +1252,7 @@ static int temac_stop(struct net_device *ndev)
 
 	dev_dbg(&ndev->dev, "temac_close()\n");
 
+	napi_disable(&lp->napi);
 	cancel_delayed_work_sync(&lp->restart_work);
 
 	free_irq(lp->tx_irq, ndev);
@@ -1424,7 +1471,7 @@ static int temac_probe(struct platform_device *pdev)
 	lp->options = XTE_OPTION_DEFAULTS;
 	lp->rx_bd_num = RX_BD_NUM_DEFAULT;
 	lp->tx_bd_num = TX_BD_NUM_DEFAULT;
-	spin_lock_init(&lp->rx_lock);
+	netif_napi_add(ndev, &lp->napi, ll_temac_napi_poll);
 	INIT_DELAYED_WORK(&lp->restart_work, ll_temac_restart_work_func);
 
 	/* Setup mutex for synchronization of indirect register access */
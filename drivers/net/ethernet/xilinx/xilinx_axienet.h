@@ -11,6 +11,8 @@
 #define XILINX_AXIENET_H
 
 #include <linux/clk.h>
+#include <linux/completion.h>
+#include <linux/dim.h>
 #include <linux/netdevice.h>
 #include <linux/spinlock.h>
 #include <linux/interrupt.h>
@@ -18,6 +20,8 @@
 #include <linux/phylink.h>
 #include <linux/net_tstamp.h>
 #include <linux/of_platform.h>
+#include <net/page_pool.h>
+#include <net/xdp.h>
 
 /* Packet size info */
 #define XAE_HDR_SIZE			14 /* Size of Ethernet header */
@@ -492,8 +496,36 @@
 #define XAE_TX_PTP_LEN		16
 #define XXV_TX_PTP_LEN		12
 
+/* Rx buffers are page_pool pages laid out as headroom, frame data and
+ * skb_shared_info so that build_skb() can wrap them without a copy. The
+ * headroom is sized for XDP so that programs can push headers and the
+ * xdp_frame can be stored in front of the packet for XDP_TX.
+ */
+#define XAE_RX_HEADROOM		XDP_PACKET_HEADROOM
+#define XAE_RX_BUF_SIZE(lp)	(SKB_DATA_ALIGN(XAE_RX_HEADROOM + \
+						(lp)->max_frm_size) + \
+				 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
+/* Frames up to rx_copybreak bytes are copied into a right sized skb and
+ * their buffer stays on the ring. When the Rx buffers span several pages
+ * (jumbo MTU) larger frames get the first XAE_RX_HDR_LEN bytes copied to
+ * a small linear area and the rest of the buffer attached as a fragment.
+ */
+#define XAE_RX_COPYBREAK_DEFAULT	256
+#define XAE_RX_COPYBREAK_MAX		1024
+#define XAE_RX_HDR_LEN			256
+
+/* XDP requires the whole frame to fit in a single order-0 page */
+#define XAE_XDP_MAX_FRAME_SIZE	(PAGE_SIZE - XAE_RX_HEADROOM - \
+				 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
 /* Macros used when AXI DMA h/w is configured without DRE */
 #define XAE_TX_BUFFERS		64
+
+/* Buckets of the Tx reap histogram, indexed by fls() of the BDs reaped by
+ * one NAPI poll: 0, 1, 2-3, 4-7, 8-15, 16-31, 32-63 and 64 or more.
+ */
+#define XAE_TX_REAP_HIST_LEN	8
 #define XAE_MAX_PKT_LEN		8192
 
 /* MRMAC Register Definitions */
@@ -596,6 +628,7 @@
  *		   Otherwise reserved.
  * @tx_skb:	  Transmit skb address
  * @tx_desc_mapping: Tx Descriptor DMA mapping type.
+ * @xdpf:	  Transmit XDP frame, if the BD carries one instead of an skb
  */
 struct axidma_bd {
 	phys_addr_t next;	/* Physical address of next buffer descriptor */
@@ -620,6 +653,7 @@ struct axidma_bd {
 	u32 ptp_tx_ts_tag;
 	phys_addr_t tx_skb;
 	u32 tx_desc_mapping;
+	struct xdp_frame *xdpf;
 } __aligned(XAXIDMA_BD_MINIMUM_ALIGNMENT);
 /**
  * struct aximcdma_bd - Axi MCDMA buffer descriptor layout
@@ -644,6 +678,7 @@ struct axidma_bd {
  *		   Otherwise reserved.
  * @tx_skb:	  Transmit skb address
  * @tx_desc_mapping: Tx Descriptor DMA mapping type.
+ * @xdpf:	  Transmit XDP frame, if the BD carries one instead of an skb
  */
 struct aximcdma_bd {
 	phys_addr_t next;	/* Physical address of next buffer descriptor */
@@ -668,11 +703,14 @@ struct aximcdma_bd {
 	u32 ptp_tx_ts_tag;
 	phys_addr_t tx_skb;
 	u32 tx_desc_mapping;
+	struct xdp_frame *xdpf;
 } __aligned(XAXIDMA_BD_MINIMUM_ALIGNMENT);
 
 #define XAE_NUM_MISC_CLOCKS 3
 #define DESC_DMA_MAP_SINGLE 0
 #define DESC_DMA_MAP_PAGE 1
+#define DESC_DMA_MAP_NONE 2	/* page_pool or bounce buffer, not unmapped */
+#define DESC_DMA_MAP_XSK 3	/* AF_XDP Tx descriptor, mapped by the pool */
 
 #if defined(CONFIG_AXIENET_HAS_MCDMA)
 #define XAE_MAX_QUEUES		16
@@ -688,11 +726,15 @@ struct aximcdma_bd {
  * @phylink_config: phylink configuration settings
  * @pcs_phy:	Reference to PCS/PMA PHY if used
  * @pcs:	phylink pcs structure for PCS PHY
+ * @pcs_irq:	Whether the PCS autonegotiation interrupt reports the link
+ *		changes instead of polling the PCS
  * @switch_x_sgmii: Whether switchable 1000BaseX/SGMII mode is enabled in the core
  * @axi_clk:	AXI4-Lite bus clock
  * @misc_clks:	Misc ethernet clocks (AXI4-Stream, Ref, MGT clocks)
  * @mii_bus:	Pointer to MII bus structure
  * @mii_clk_div: MII bus clock divider value
+ * @mdio_done:	Completion of the MDIO transaction in progress
+ * @mdio_irq:	Whether the MDIO transactions complete on interrupt
  * @regs_start: Resource start for axienet device addresses
  * @regs:	Base address for the axienet_local device address space
  * @mcdma_regs:	Base address for the aximcdma device address space
@@ -712,6 +754,10 @@ struct aximcdma_bd {
  *		  supported, the maximum frame size would be 9k. Else it is
  *		  1522 bytes (assuming support for basic VLAN)
  * @rxmem:	Stores rx memory size for jumbo frame handling.
+ * @rx_page_order: Page order of each page_pool backed Rx buffer.
+ * @rx_copybreak: Rx frames up to this size are copied and their buffer is
+ *		  reused, zero to disable.
+ * @xdp_prog:	XDP program run on every received frame, NULL if none.
  * @csum_offload_on_tx_path:	Stores the checksum selection on TX side.
  * @csum_offload_on_rx_path:	Stores the checksum selection on RX side.
  * @coalesce_count_rx:	Store the irq coalesce on RX side.
@@ -755,6 +801,7 @@ struct axienet_local {
 
 	struct mdio_device *pcs_phy;
 	struct phylink_pcs pcs;
+	bool pcs_irq;
 
 	bool switch_x_sgmii;
 
@@ -763,6 +810,8 @@ struct axienet_local {
 
 	struct mii_bus *mii_bus;
 	u8 mii_clk_div;
+	struct completion mdio_done;
+	bool mdio_irq;
 
 	resource_size_t regs_start;
 	void __iomem *regs;
@@ -787,6 +836,9 @@ struct axienet_local {
 
 	u32 max_frm_size;
 	u32 rxmem;
+	u32 rx_page_order;
+	u32 rx_copybreak;
+	struct bpf_prog *xdp_prog;
 
 	int csum_offload_on_tx_path;
 	int csum_offload_on_rx_path;
@@ -835,6 +887,8 @@ struct axienet_local {
 /**
  * struct axienet_dma_q - axienet private per dma queue data
  * @lp:		Parent pointer
+ * @txq:	Stack Tx queue fed by this DMA queue, used for flow control
+ *		and byte queue limits.
  * @dma_regs:	Base address for the axidma device address space
  * @tx_irq:	Axidma TX IRQ number
  * @rx_irq:	Axidma RX IRQ number
@@ -844,6 +898,8 @@ struct axienet_local {
  * @tx_bd_p:	Physical address(start address) of the TX buffer descr. ring
  * @rx_bd_v:	Virtual address of the RX buffer descriptor ring
  * @rx_bd_p:	Physical address(start address) of the RX buffer descr. ring
+ * @page_pool:	Page pool providing the DMA mapped Rx buffers of this queue
+ * @xdp_rxq:	XDP Rx queue info registered against the page pool
  * @tx_buf:	Virtual address of the Tx buffer pool used by the driver when
  *		DMA h/w is configured without DRE.
  * @tx_bufs:	Virutal address of the Tx buffer address.
@@ -855,19 +911,43 @@ struct axienet_local {
  * @tx_bd_tail:	Stores the index of the Tx buffer descriptor in the ring being
  *		accessed currently. Used while processing BDs after the TX
  *		completed.
+ * @tx_db_pending: Tx BDs were queued without writing the tail descriptor
+ *		   register, because the stack had more frames coming.
  * @rx_bd_ci:	Stores the index of the Rx buffer descriptor in the ring being
  *		accessed currently.
  * @chan_id:    MCDMA channel to operate on.
  * @rx_offset:	MCDMA S2MM channel starting offset.
  * @txq_bd_v:	Virtual address of the MCDMA TX buffer descriptor ring
  * @rxq_bd_v:	Virtual address of the MCDMA RX buffer descriptor ring
+ * @xsk_pool:	AF_XDP buffer pool bound to this MCDMA channel, if any
+ * @rx_bd_tail:	Next Rx BD to be given a buffer in zero-copy mode
+ * @rx_bd_unused: Number of Rx BDs without a buffer in zero-copy mode
  * @tx_packets: Number of transmit packets processed by the dma queue.
  * @tx_bytes:   Number of transmit bytes processed by the dma queue.
  * @rx_packets: Number of receive packets processed by the dma queue.
  * @rx_bytes:	Number of receive bytes processed by the dma queue.
+ * @tx_doorbells_saved: Tail descriptor writes skipped thanks to xmit_more.
+ * @tx_ring_full: Frames that found no free Tx BD.
+ * @tx_dma_map_err: Tx buffers that could not be DMA mapped.
+ * @tx_bounce:	Tx frames copied to @tx_buf because the DMA lacks DRE.
+ * @tx_reap_hist: Histogram of the Tx BDs reaped per NAPI poll.
+ * @rx_page_alloc_fail: Rx BDs left unrefilled for lack of a page.
+ * @rx_skb_alloc_fail: Received frames dropped for lack of an skb.
+ * @rx_budget_exhausted: NAPI polls that used up their whole budget.
+ * @coalesce_count_rx:	Rx IRQ threshold configured for the queue.
+ * @coalesce_usec_rx:	Rx IRQ delay configured for the queue.
+ * @coalesce_count_tx:	Tx IRQ threshold configured for the queue.
+ * @coalesce_usec_tx:	Tx IRQ delay configured for the queue.
+ * @rx_coalesce: Rx channel control threshold and delay fields in use.
+ *		 Applied by NAPI when it re-enables the Rx interrupts.
+ * @tx_coalesce: Tx channel control threshold and delay fields in use.
+ * @rx_dim:	DIM state used to retune @rx_coalesce from NAPI samples.
+ * @rx_dim_enabled: Adaptive Rx coalescing is enabled on the queue.
+ * @rx_dim_events: NAPI completions, used as DIM event counter.
  */
 struct axienet_dma_q {
 	struct axienet_local	*lp; /* parent */
+	struct netdev_queue	*txq;
 	void __iomem *dma_regs;
 
 	int tx_irq;
@@ -882,6 +962,9 @@ struct axienet_dma_q {
 	dma_addr_t rx_bd_p;
 	dma_addr_t tx_bd_p;
 
+	struct page_pool *page_pool;
+	struct xdp_rxq_info xdp_rxq;
+
 	unsigned char *tx_buf[XAE_TX_BUFFERS];
 	unsigned char *tx_bufs;
 	dma_addr_t tx_bufs_dma;
@@ -890,17 +973,39 @@ struct axienet_dma_q {
 	u32 tx_bd_ci;
 	u32 rx_bd_ci;
 	u32 tx_bd_tail;
+	bool tx_db_pending;
 
 	/* MCDMA fields */
 	u16 chan_id;
 	u32 rx_offset;
 	struct aximcdma_bd *txq_bd_v;
 	struct aximcdma_bd *rxq_bd_v;
+	struct xsk_buff_pool *xsk_pool;
+	u32 rx_bd_tail;
+	u32 rx_bd_unused;
 
 	unsigned long tx_packets;
 	unsigned long tx_bytes;
 	unsigned long rx_packets;
 	unsigned long rx_bytes;
+	unsigned long tx_doorbells_saved;
+	unsigned long tx_ring_full;
+	unsigned long tx_dma_map_err;
+	unsigned long tx_bounce;
+	unsigned long tx_reap_hist[XAE_TX_REAP_HIST_LEN];
+	unsigned long rx_page_alloc_fail;
+	unsigned long rx_skb_alloc_fail;
+	unsigned long rx_budget_exhausted;
+
+	u32 coalesce_count_rx;
+	u32 coalesce_usec_rx;
+	u32 coalesce_count_tx;
+	u32 coalesce_usec_tx;
+	u32 rx_coalesce;
+	u32 tx_coalesce;
+	struct dim rx_dim;
+	bool rx_dim_enabled;
+	u16 rx_dim_events;
 };
 
 #define AXIENET_ETHTOOLS_SSTATS_LEN 6
@@ -989,6 +1094,13 @@ static inline void axienet_unlock_mii(struct axienet_local *lp)
 		mutex_unlock(&lp->mii_bus->mdio_lock);
 }
 
+/* Core interrupts used for the MDIO and the PCS, whether the netdev is up */
+static inline u32 axienet_mdio_pcs_ie(struct axienet_local *lp)
+{
+	return (lp->mdio_irq ? XAE_INT_HARDACSCMPLT_MASK : 0) |
+	       (lp->pcs_irq ? XAE_INT_AUTONEG_MASK : 0);
+}
+
 /**
  * axienet_iow - Memory mapped Axi Ethernet register write
  * @lp:         Pointer to axienet local structure
@@ -1136,6 +1248,50 @@ static inline void axienet_dma_bdout(struct axienet_dma_q *q,
 #endif
 }
 
+/**
+ * axienet_rx_page_alloc - Get an Rx buffer from the queue page pool
+ * @q:		Pointer to DMA queue structure
+ * @phys:	Returns the DMA address the S2MM channel should write to
+ *
+ * Return: The page backing the buffer, NULL if the pool is exhausted.
+ *
+ * The page is already DMA mapped by the page pool, so it can be handed
+ * to the hardware without any further mapping.
+ */
+static inline struct page *axienet_rx_page_alloc(struct axienet_dma_q *q,
+						 dma_addr_t *phys)
+{
+	struct page *page;
+
+	page = page_pool_dev_alloc_pages(q->page_pool);
+	if (likely(page))
+		*phys = page_pool_get_dma_addr(page) + XAE_RX_HEADROOM;
+
+	return page;
+}
+
+/**
+ * axienet_xdp_enabled - Check whether an XDP program is attached
+ * @lp:		Pointer to axienet local structure
+ *
+ * Return: true if received frames are handed to an XDP program.
+ */
+static inline bool axienet_xdp_enabled(struct axienet_local *lp)
+{
+	return !!READ_ONCE(lp->xdp_prog);
+}
+
+/**
+ * axienet_dma_q_index - Get the index of a DMA queue
+ * @q:		Pointer to DMA queue structure
+ *
+ * Return: Index of @q in axienet_local.dq, which is also its stack queue.
+ */
+static inline unsigned int axienet_dma_q_index(struct axienet_dma_q *q)
+{
+	return get_netdev_queue_index(q->txq);
+}
+
 /* Function prototypes visible in xilinx_axienet_mdio.c for other files */
 int axienet_mdio_enable(struct axienet_local *lp);
 void axienet_mdio_disable(struct axienet_local *lp);
@@ -1148,7 +1304,8 @@ int __maybe_unused axienet_dma_q_init(struct net_device *ndev,
 void axienet_dma_err_handler(unsigned long data);
 irqreturn_t __maybe_unused axienet_tx_irq(int irq, void *_ndev);
 irqreturn_t __maybe_unused axienet_rx_irq(int irq, void *_ndev);
-void axienet_start_xmit_done(struct net_device *ndev, struct axienet_dma_q *q);
+int axienet_start_xmit_done(struct net_device *ndev, struct axienet_dma_q *q,
+			    int budget);
 void axienet_dma_bd_release(struct net_device *ndev);
 void __axienet_device_reset(struct axienet_dma_q *q);
 void axienet_set_mac_address(struct net_device *ndev, const void *address);
@@ -1180,6 +1337,7 @@ int __maybe_unused axienet_mcdma_tx_probe(struct platform_device *pdev,
 int __maybe_unused axienet_mcdma_rx_probe(struct platform_device *pdev,
 					  struct axienet_local *lp,
 					  struct net_device *ndev);
+int axienet_xsk_rx_refill(struct axienet_dma_q *q);
 #endif
 
 #ifdef CONFIG_AXIENET_HAS_MCDMA
@@ -1190,5 +1348,8 @@ void axienet_tx_hwtstamp(struct axienet_local *lp,
 			 struct axidma_bd *cur_p);
 #endif
 u32 axienet_usec_to_timer(struct axienet_local *lp, u32 coalesce_usec);
+u32 axienet_coalesce_bits(struct axienet_local *lp, u32 count, u32 usec);
+int axienet_rx_pool_create(struct net_device *ndev, struct axienet_dma_q *q);
+void axienet_rx_pool_destroy(struct axienet_dma_q *q);
 
 #endif /* XILINX_AXI_ENET_H */
@@ -29,15 +29,33 @@ void __maybe_unused axienet_bd_free(struct net_device *ndev,
 {
 	int i;
 	struct axienet_local *lp = netdev_priv(ndev);
+	struct axidma_bd *cur_p;
 
-	for (i = 0; i < lp->rx_bd_num; i++) {
-		if (q->rx_bd_v[i].phys)
-			dma_unmap_single(ndev->dev.parent, q->rx_bd_v[i].phys,
-					 lp->max_frm_size, DMA_FROM_DEVICE);
-		dev_kfree_skb((struct sk_buff *)
-			      (q->rx_bd_v[i].sw_id_offset));
+	for (i = 0; q->tx_bd_v && i < lp->tx_bd_num; i++) {
+		cur_p = &q->tx_bd_v[i];
+		if (!cur_p->xdpf)
+			continue;
+
+		/* Give XDP frames still in flight back to their owner */
+		if (cur_p->tx_desc_mapping == DESC_DMA_MAP_SINGLE)
+			dma_unmap_single(ndev->dev.parent, cur_p->phys,
+					 cur_p->cntrl &
+					 XAXIDMA_BD_CTRL_LENGTH_MASK,
+					 DMA_TO_DEVICE);
+		xdp_return_frame(cur_p->xdpf);
+		cur_p->xdpf = NULL;
 	}
 
+	for (i = 0; q->rx_bd_v && i < lp->rx_bd_num; i++) {
+		struct page *page = (struct page *)q->rx_bd_v[i].sw_id_offset;
+
+		/* The page pool owns the DMA mapping of Rx buffers */
+		if (page)
+			page_pool_put_full_page(q->page_pool, page, false);
+		q->rx_bd_v[i].sw_id_offset = 0;
+	}
+	axienet_rx_pool_destroy(q);
+
 	if (q->rx_bd_v) {
 		dma_free_coherent(ndev->dev.parent,
 				  sizeof(*q->rx_bd_v) * lp->rx_bd_num,
@@ -75,6 +93,7 @@ static int __dma_txq_init(struct net_device *ndev, struct axienet_dma_q *q)
 
 	q->tx_bd_ci = 0;
 	q->tx_bd_tail = 0;
+	netdev_tx_reset_queue(q->txq);
 
 	q->tx_bd_v = dma_alloc_coherent(ndev->dev.parent,
 					sizeof(*q->tx_bd_v) * lp->tx_bd_num,
@@ -100,17 +119,14 @@ static int __dma_txq_init(struct net_device *ndev, struct axienet_dma_q *q)
 			q->tx_buf[i] = &q->tx_bufs[i * XAE_MAX_PKT_LEN];
 	}
 
+	q->tx_coalesce = axienet_coalesce_bits(lp, q->coalesce_count_tx,
+					       q->coalesce_usec_tx);
+
 	/* Start updating the Tx channel control register */
 	cr = axienet_dma_in32(q, XAXIDMA_TX_CR_OFFSET);
-	/* Update the interrupt coalesce count */
-	cr = (((cr & ~XAXIDMA_COALESCE_MASK)) |
-	      ((lp->coalesce_count_tx) << XAXIDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first TX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_tx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_tx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XAXIDMA_COALESCE_MASK | XAXIDMA_DELAY_MASK)) |
+	     q->tx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XAXIDMA_IRQ_ALL_MASK;
 	/* Write to the Tx channel control register */
@@ -143,7 +159,8 @@ static int __dma_rxq_init(struct net_device *ndev,
 {
 	int i;
 	u32 cr;
-	struct sk_buff *skb;
+	struct page *page;
+	dma_addr_t phys;
 	struct axienet_local *lp = netdev_priv(ndev);
 	/* Reset the indexes which are used for accessing the BDs */
 	q->rx_bd_ci = 0;
@@ -155,44 +172,31 @@ static int __dma_rxq_init(struct net_device *ndev,
 	if (!q->rx_bd_v)
 		goto out;
 
+	if (axienet_rx_pool_create(ndev, q))
+		goto out;
+
 	for (i = 0; i < lp->rx_bd_num; i++) {
 		q->rx_bd_v[i].next = q->rx_bd_p +
 				     sizeof(*q->rx_bd_v) *
 				     ((i + 1) % lp->rx_bd_num);
 
-		skb = netdev_alloc_skb(ndev, lp->max_frm_size);
-		if (!skb)
+		page = axienet_rx_page_alloc(q, &phys);
+		if (!page)
 			goto out;
 
-		/* Ensure that the skb is completely updated
-		 * prio to mapping the DMA
-		 */
-		wmb();
-
-		q->rx_bd_v[i].sw_id_offset = (phys_addr_t)skb;
-		q->rx_bd_v[i].phys = dma_map_single(ndev->dev.parent,
-						    skb->data,
-						    lp->max_frm_size,
-						    DMA_FROM_DEVICE);
-		if (unlikely(dma_mapping_error(ndev->dev.parent, q->rx_bd_v[i].phys))) {
-			q->rx_bd_v[i].phys = 0;
-			dev_err(&ndev->dev, "axidma map error\n");
-			goto out;
-		}
+		q->rx_bd_v[i].sw_id_offset = (phys_addr_t)page;
+		q->rx_bd_v[i].phys = phys;
 		q->rx_bd_v[i].cntrl = lp->max_frm_size;
 	}
 
+	q->rx_coalesce = axienet_coalesce_bits(lp, q->coalesce_count_rx,
+					       q->coalesce_usec_rx);
+
 	/* Start updating the Rx channel control register */
 	cr = axienet_dma_in32(q, XAXIDMA_RX_CR_OFFSET);
-	/* Update the interrupt coalesce count */
-	cr = ((cr & ~XAXIDMA_COALESCE_MASK) |
-	      ((lp->coalesce_count_rx) << XAXIDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first RX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_rx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_rx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XAXIDMA_COALESCE_MASK | XAXIDMA_DELAY_MASK)) |
+	     q->rx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XAXIDMA_IRQ_ALL_MASK;
 	/* Write to the Rx channel control register */
@@ -265,8 +269,8 @@ static int map_dma_q_irq(int irq, struct axienet_local *lp)
  *
  * Return: IRQ_HANDLED if device generated a TX interrupt, IRQ_NONE otherwise.
  *
- * This is the Axi DMA Tx done Isr. It invokes "axienet_start_xmit_done"
- * to complete the BD processing.
+ * This is the Axi DMA Tx done Isr. It masks the Tx completion interrupts
+ * and schedules the queue NAPI, which reaps the completed BDs.
  */
 irqreturn_t __maybe_unused axienet_tx_irq(int irq, void *_ndev)
 {
@@ -285,7 +289,13 @@ irqreturn_t __maybe_unused axienet_tx_irq(int irq, void *_ndev)
 	status = axienet_dma_in32(q, XAXIDMA_TX_SR_OFFSET);
 	if (status & (XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK)) {
 		axienet_dma_out32(q, XAXIDMA_TX_SR_OFFSET, status);
-		axienet_start_xmit_done(lp->ndev, q);
+		/* Tx BDs are reaped by the queue NAPI */
+		spin_lock(&q->tx_lock);
+		cr = axienet_dma_in32(q, XAXIDMA_TX_CR_OFFSET);
+		cr &= ~(XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK);
+		axienet_dma_out32(q, XAXIDMA_TX_CR_OFFSET, cr);
+		spin_unlock(&q->tx_lock);
+		napi_schedule(&lp->napi[i]);
 		goto out;
 	}
 
@@ -403,13 +413,16 @@ void __maybe_unused axienet_dma_err_handler(unsigned long data)
 
 	for (i = 0; i < lp->tx_bd_num; i++) {
 		cur_p = &q->tx_bd_v[i];
-		if (cur_p->phys)
+		if (cur_p->phys &&
+		    cur_p->tx_desc_mapping != DESC_DMA_MAP_NONE)
 			dma_unmap_single(ndev->dev.parent, cur_p->phys,
 					 (cur_p->cntrl &
 					  XAXIDMA_BD_CTRL_LENGTH_MASK),
 					 DMA_TO_DEVICE);
 		if (cur_p->tx_skb)
 			dev_kfree_skb_irq((struct sk_buff *)cur_p->tx_skb);
+		if (cur_p->xdpf)
+			xdp_return_frame(cur_p->xdpf);
 		cur_p->phys = 0;
 		cur_p->cntrl = 0;
 		cur_p->status = 0;
@@ -420,6 +433,7 @@ void __maybe_unused axienet_dma_err_handler(unsigned long data)
 		cur_p->app4 = 0;
 		cur_p->sw_id_offset = 0;
 		cur_p->tx_skb = 0;
+		cur_p->xdpf = NULL;
 	}
 
 	for (i = 0; i < lp->rx_bd_num; i++) {
@@ -434,19 +448,14 @@ void __maybe_unused axienet_dma_err_handler(unsigned long data)
 
 	q->tx_bd_ci = 0;
 	q->tx_bd_tail = 0;
+	netdev_tx_reset_queue(q->txq);
 	q->rx_bd_ci = 0;
 
 	/* Start updating the Rx channel control register */
 	cr = axienet_dma_in32(q, XAXIDMA_RX_CR_OFFSET);
-	/* Update the interrupt coalesce count */
-	cr = ((cr & ~XAXIDMA_COALESCE_MASK) |
-	      (XAXIDMA_DFT_RX_THRESHOLD << XAXIDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first RX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_rx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_rx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XAXIDMA_COALESCE_MASK | XAXIDMA_DELAY_MASK)) |
+	     q->rx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XAXIDMA_IRQ_ALL_MASK;
 	/* Finally write to the Rx channel control register */
@@ -454,15 +463,9 @@ void __maybe_unused axienet_dma_err_handler(unsigned long data)
 
 	/* Start updating the Tx channel control register */
 	cr = axienet_dma_in32(q, XAXIDMA_TX_CR_OFFSET);
-	/* Update the interrupt coalesce count */
-	cr = (((cr & ~XAXIDMA_COALESCE_MASK)) |
-	      (XAXIDMA_DFT_TX_THRESHOLD << XAXIDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first TX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_tx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_tx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XAXIDMA_COALESCE_MASK | XAXIDMA_DELAY_MASK)) |
+	     q->tx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XAXIDMA_IRQ_ALL_MASK;
 	/* Finally write to the Tx channel control register */
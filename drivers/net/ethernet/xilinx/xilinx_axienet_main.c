@@ -43,12 +43,22 @@
 #include <linux/ptp_classify.h>
 #include <linux/net_tstamp.h>
 #include <linux/random.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <linux/interrupt.h>
+#include <linux/cpumask.h>
+#include <linux/sched/cpufreq.h>
 #include <net/sock.h>
+#include <net/xdp_sock_drv.h>
 #include <linux/xilinx_phy.h>
 #include <linux/clk.h>
 
 #include "xilinx_axienet.h"
 
+#define CREATE_TRACE_POINTS
+#include "xilinx_axienet_trace.h"
+
 /* Descriptors defines for Tx and Rx DMA */
 #define TX_BD_NUM_DEFAULT		128
 #define RX_BD_NUM_DEFAULT		128
@@ -56,6 +66,12 @@
 #define TX_BD_NUM_MAX			4096
 #define RX_BD_NUM_MAX			4096
 
+/* Maximum number of Tx BDs reaped by one NAPI poll */
+#define TX_NAPI_BUDGET			64
+
+/* Time the CPU runs at full speed after a poll exhausted its budget */
+#define NAPI_UTIL_HINT_US		2000
+
 /* Must be shorter than length of ethtool_drvinfo.driver field to fit */
 #define DRIVER_NAME		"xaxienet"
 #define DRIVER_DESCRIPTION	"Xilinx Axi Ethernet driver"
@@ -205,6 +221,42 @@ static struct axienet_ethtools_stat axienet_get_ethtools_strings_stats[] = {
 	{ "rx_errors" },
 };
 
+struct axienet_queue_stat {
+	const char *name;
+	size_t offset;
+};
+
+#define AXIENET_QUEUE_STAT(_name, _field) \
+	{ _name, offsetof(struct axienet_dma_q, _field) }
+
+/* Per Tx queue counters, reported as "txq<n>_<name>" */
+static const struct axienet_queue_stat axienet_tx_queue_stats[] = {
+	AXIENET_QUEUE_STAT("doorbells_saved", tx_doorbells_saved),
+	AXIENET_QUEUE_STAT("ring_full", tx_ring_full),
+	AXIENET_QUEUE_STAT("dma_map_err", tx_dma_map_err),
+	AXIENET_QUEUE_STAT("bounce", tx_bounce),
+	AXIENET_QUEUE_STAT("reap_0", tx_reap_hist[0]),
+	AXIENET_QUEUE_STAT("reap_1", tx_reap_hist[1]),
+	AXIENET_QUEUE_STAT("reap_2_3", tx_reap_hist[2]),
+	AXIENET_QUEUE_STAT("reap_4_7", tx_reap_hist[3]),
+	AXIENET_QUEUE_STAT("reap_8_15", tx_reap_hist[4]),
+	AXIENET_QUEUE_STAT("reap_16_31", tx_reap_hist[5]),
+	AXIENET_QUEUE_STAT("reap_32_63", tx_reap_hist[6]),
+	AXIENET_QUEUE_STAT("reap_64", tx_reap_hist[7]),
+};
+
+/* Per Rx queue counters, reported as "rxq<n>_<name>" */
+static const struct axienet_queue_stat axienet_rx_queue_stats[] = {
+	AXIENET_QUEUE_STAT("page_alloc_fail", rx_page_alloc_fail),
+	AXIENET_QUEUE_STAT("skb_alloc_fail", rx_skb_alloc_fail),
+	AXIENET_QUEUE_STAT("budget_exhausted", rx_budget_exhausted),
+};
+
+#define AXIENET_TX_QSTATS_LEN(lp) \
+	((lp)->num_tx_queues * ARRAY_SIZE(axienet_tx_queue_stats))
+#define AXIENET_RX_QSTATS_LEN(lp) \
+	((lp)->num_rx_queues * ARRAY_SIZE(axienet_rx_queue_stats))
+
 /**
  * axienet_dma_bd_release - Release buffer descriptor rings
  * @ndev:	Pointer to the net_device structure
@@ -254,6 +306,233 @@ u32 axienet_usec_to_timer(struct axienet_local *lp, u32 coalesce_usec)
 	return result;
 }
 
+/**
+ * axienet_coalesce_bits - Calculate the IRQ threshold and delay fields
+ * @lp:		Pointer to the axienet_local structure
+ * @count:	Number of frames to coalesce into one interrupt
+ * @usec:	IRQ delay timeout in microseconds
+ *
+ * Return: The IRQ threshold and delay timer fields of a channel control
+ * register. AXI DMA and MCDMA channels share the same layout.
+ */
+u32 axienet_coalesce_bits(struct axienet_local *lp, u32 count, u32 usec)
+{
+	u32 cr;
+
+	cr = (clamp_t(u32, count, 1, 255) << XAXIDMA_COALESCE_SHIFT) &
+	     XAXIDMA_COALESCE_MASK;
+	/* Only set interrupt delay timer if not generating an interrupt on
+	 * the first packet. Otherwise leave at 0 to disable delay interrupt.
+	 */
+	if (count > 1)
+		cr |= axienet_usec_to_timer(lp, usec) << XAXIDMA_DELAY_SHIFT;
+
+	return cr;
+}
+
+/**
+ * axienet_update_rx_coalesce - Change the Rx coalescing of a queue
+ * @q:		Pointer to DMA queue structure
+ * @count:	Number of frames to coalesce into one interrupt
+ * @usec:	IRQ delay timeout in microseconds
+ *
+ * The Rx control register is also written by the Rx isr and by NAPI, so
+ * the new fields are only latched here and written by xaxienet_rx_poll()
+ * when it re-enables the Rx interrupts.
+ */
+static void axienet_update_rx_coalesce(struct axienet_dma_q *q, u32 count,
+				       u32 usec)
+{
+	WRITE_ONCE(q->rx_coalesce, axienet_coalesce_bits(q->lp, count, usec));
+}
+
+/**
+ * axienet_update_tx_coalesce - Change the Tx coalescing of a queue
+ * @q:		Pointer to DMA queue structure
+ *
+ * Programs the configured Tx threshold and delay into the Tx channel if
+ * the interface is up, otherwise they are applied when the ring is set up.
+ */
+static void axienet_update_tx_coalesce(struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = q->lp;
+	unsigned long flags;
+	u32 cr;
+
+	q->tx_coalesce = axienet_coalesce_bits(lp, q->coalesce_count_tx,
+					       q->coalesce_usec_tx);
+	if (!netif_running(lp->ndev))
+		return;
+
+	spin_lock_irqsave(&q->tx_lock, flags);
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id));
+	cr = (cr & ~(XMCDMA_COALESCE_MASK | XMCDMA_DELAY_MASK)) |
+	     q->tx_coalesce;
+	axienet_dma_out32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id), cr);
+#else
+	cr = axienet_dma_in32(q, XAXIDMA_TX_CR_OFFSET);
+	cr = (cr & ~(XAXIDMA_COALESCE_MASK | XAXIDMA_DELAY_MASK)) |
+	     q->tx_coalesce;
+	axienet_dma_out32(q, XAXIDMA_TX_CR_OFFSET, cr);
+#endif
+	spin_unlock_irqrestore(&q->tx_lock, flags);
+}
+
+/**
+ * axienet_rx_dim_work - Apply the Rx moderation chosen by DIM
+ * @work:	Work struct embedded in the queue DIM state
+ */
+static void axienet_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct axienet_dma_q *q = container_of(dim, struct axienet_dma_q,
+					       rx_dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	axienet_update_rx_coalesce(q, moder.pkts, moder.usec);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * axienet_rx_dim_update - Feed a NAPI sample to DIM
+ * @q:		Pointer to DMA queue structure
+ */
+static void axienet_rx_dim_update(struct axienet_dma_q *q)
+{
+	struct dim_sample sample = {};
+
+	dim_update_sample(++q->rx_dim_events, q->rx_packets, q->rx_bytes,
+			  &sample);
+	net_dim(&q->rx_dim, sample);
+}
+
+/**
+ * axienet_dma_q_coalesce_init - Set up per queue interrupt coalescing
+ * @lp:		Pointer to the axienet_local structure
+ *
+ * Every queue starts with the device wide defaults and static coalescing.
+ */
+static void axienet_dma_q_coalesce_init(struct axienet_local *lp)
+{
+	struct axienet_dma_q *q;
+	int i;
+
+	for_each_rx_dma_queue(lp, i) {
+		q = lp->dq[i];
+		q->coalesce_count_rx = lp->coalesce_count_rx;
+		q->coalesce_usec_rx = lp->coalesce_usec_rx;
+		INIT_WORK(&q->rx_dim.work, axienet_rx_dim_work);
+		q->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+	}
+
+	for_each_tx_dma_queue(lp, i) {
+		q = lp->dq[i];
+		q->coalesce_count_tx = lp->coalesce_count_tx;
+		q->coalesce_usec_tx = lp->coalesce_usec_tx;
+	}
+}
+
+/**
+ * axienet_rx_pool_create - Create the page pool backing an Rx BD ring
+ * @ndev:	Pointer to the net_device structure
+ * @q:		Pointer to DMA queue structure
+ *
+ * Return: 0, on success. Negative error value on failure.
+ *
+ * The pool maps its pages once for DMA_FROM_DEVICE and only syncs the
+ * frame area back to the device when a page is recycled, which removes
+ * the per packet allocation and IOMMU mapping from the Rx hot path. With
+ * an XDP program attached the pages are mapped bidirectionally so that
+ * XDP_TX can send them without remapping. The pool is also registered as
+ * the memory model of the queue XDP Rx info. Queues bound to an AF_XDP
+ * buffer pool take their Rx buffers from it and get no page pool.
+ */
+int axienet_rx_pool_create(struct net_device *ndev, struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct page_pool_params pp_params = { 0 };
+	int ret, i;
+
+	lp->rx_page_order = get_order(XAE_RX_BUF_SIZE(lp));
+
+	for_each_rx_dma_queue(lp, i) {
+		if (lp->dq[i] == q)
+			break;
+	}
+
+	if (q->xsk_pool) {
+		ret = xdp_rxq_info_reg(&q->xdp_rxq, ndev, i,
+				       lp->napi[i].napi_id);
+		if (ret)
+			return ret;
+
+		ret = xdp_rxq_info_reg_mem_model(&q->xdp_rxq,
+						 MEM_TYPE_XSK_BUFF_POOL, NULL);
+		if (ret) {
+			xdp_rxq_info_unreg(&q->xdp_rxq);
+			return ret;
+		}
+
+		xsk_pool_set_rxq_info(q->xsk_pool, &q->xdp_rxq);
+		return 0;
+	}
+
+	pp_params.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
+	pp_params.order = lp->rx_page_order;
+	pp_params.pool_size = lp->rx_bd_num;
+	pp_params.nid = dev_to_node(ndev->dev.parent);
+	pp_params.dev = ndev->dev.parent;
+	pp_params.dma_dir = lp->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
+	pp_params.offset = XAE_RX_HEADROOM;
+	pp_params.max_len = lp->max_frm_size;
+
+	q->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(q->page_pool)) {
+		ret = PTR_ERR(q->page_pool);
+		q->page_pool = NULL;
+		netdev_err(ndev, "page pool creation failed %d\n", ret);
+		return ret;
+	}
+
+	ret = xdp_rxq_info_reg(&q->xdp_rxq, ndev, i, lp->napi[i].napi_id);
+	if (ret)
+		goto err_pool;
+
+	ret = xdp_rxq_info_reg_mem_model(&q->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 q->page_pool);
+	if (ret)
+		goto err_rxq;
+
+	return 0;
+
+err_rxq:
+	xdp_rxq_info_unreg(&q->xdp_rxq);
+err_pool:
+	netdev_err(ndev, "xdp rxq registration failed %d\n", ret);
+	page_pool_destroy(q->page_pool);
+	q->page_pool = NULL;
+	return ret;
+}
+
+/**
+ * axienet_rx_pool_destroy - Release the page pool of an Rx BD ring
+ * @q:		Pointer to DMA queue structure
+ *
+ * All buffers still attached to the ring must have been returned to the
+ * pool before calling this. Pages held by the stack are released when
+ * their skbs are freed.
+ */
+void axienet_rx_pool_destroy(struct axienet_dma_q *q)
+{
+	if (xdp_rxq_info_is_reg(&q->xdp_rxq))
+		xdp_rxq_info_unreg(&q->xdp_rxq);
+	page_pool_destroy(q->page_pool);
+	q->page_pool = NULL;
+}
+
 /**
  * axienet_dma_bd_init - Setup buffer descriptor rings for Axi DMA
  * @ndev:	Pointer to the net_device structure
@@ -711,8 +990,9 @@ static int axienet_device_reset(struct net_device *ndev)
 		if (axienet_status & XAE_INT_RXRJECT_MASK)
 			axienet_iow(lp, XAE_IS_OFFSET, XAE_INT_RXRJECT_MASK);
 		/* Enable receive erros */
-		axienet_iow(lp, XAE_IE_OFFSET, lp->eth_irq > 0 ?
-			    XAE_INT_RECV_ERROR_MASK : 0);
+		axienet_iow(lp, XAE_IE_OFFSET, (lp->eth_irq > 0 ?
+			    XAE_INT_RECV_ERROR_MASK : 0) |
+			    axienet_mdio_pcs_ie(lp));
 	}
 
 	if (lp->axienet_config->mactype == XAXIENET_10G_25G ||
@@ -899,17 +1179,25 @@ static void axienet_rx_hwtstamp(struct axienet_local *lp,
  * Axi DMA Tx channel.
  * @ndev:	Pointer to the net_device structure
  * @q:		Pointer to DMA queue structure
+ * @budget:	NAPI budget, zero when called from netpoll
  *
- * This function is invoked from the Axi DMA Tx isr to notify the completion
- * of transmit operation. It clears fields in the corresponding Tx BDs and
- * unmaps the corresponding buffer so that CPU can regain ownership of the
- * buffer. It finally invokes "netif_wake_queue" to restart transmission if
- * required.
+ * This function is invoked from the queue NAPI poll to reap the Tx BDs
+ * completed by the Tx channel, at most TX_NAPI_BUDGET of them per call.
+ * It clears fields in the corresponding Tx BDs and unmaps the
+ * corresponding buffer so that CPU can regain ownership of the buffer.
+ * XDP frames sent from the same ring are returned to their memory model.
+ * Completed skbs are reported to BQL, and the stack Tx queue is woken if
+ * it was stopped.
+ *
+ * Return: Number of Tx BDs reaped.
  */
-void axienet_start_xmit_done(struct net_device *ndev,
-			     struct axienet_dma_q *q)
+int axienet_start_xmit_done(struct net_device *ndev,
+			    struct axienet_dma_q *q, int budget)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
+	unsigned int bql_packets = 0;
+	unsigned int bql_bytes = 0;
+	u32 xsk_frames = 0;
 	u32 packets = 0;
 	u32 size = 0;
 
@@ -927,7 +1215,13 @@ void axienet_start_xmit_done(struct net_device *ndev,
 	cur_p = &q->tx_bd_v[q->tx_bd_ci];
 	status = cur_p->status;
 #endif
-	while (status & XAXIDMA_BD_STS_COMPLETE_MASK) {
+	while ((status & XAXIDMA_BD_STS_COMPLETE_MASK) &&
+	       packets < TX_NAPI_BUDGET) {
+		/* Account before the timestamp header is pulled off */
+		if (cur_p->tx_skb) {
+			bql_packets++;
+			bql_bytes += ((struct sk_buff *)cur_p->tx_skb)->len;
+		}
 #ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
 		if (cur_p->ptp_tx_skb)
 			axienet_tx_hwtstamp(lp, cur_p);
@@ -937,13 +1231,20 @@ void axienet_start_xmit_done(struct net_device *ndev,
 				       cur_p->cntrl &
 				       XAXIDMA_BD_CTRL_LENGTH_MASK,
 				       DMA_TO_DEVICE);
-		else
+		else if (cur_p->tx_desc_mapping == DESC_DMA_MAP_SINGLE)
 			dma_unmap_single(ndev->dev.parent, cur_p->phys,
 					 cur_p->cntrl &
 					 XAXIDMA_BD_CTRL_LENGTH_MASK,
 					 DMA_TO_DEVICE);
 		if (cur_p->tx_skb)
-			dev_kfree_skb_irq((struct sk_buff *)cur_p->tx_skb);
+			napi_consume_skb((struct sk_buff *)cur_p->tx_skb,
+					 budget);
+		if (cur_p->xdpf) {
+			xdp_return_frame(cur_p->xdpf);
+			cur_p->xdpf = NULL;
+		}
+		if (cur_p->tx_desc_mapping == DESC_DMA_MAP_XSK)
+			xsk_frames++;
 		/*cur_p->phys = 0;*/
 		cur_p->app0 = 0;
 		cur_p->app1 = 0;
@@ -969,20 +1270,30 @@ void axienet_start_xmit_done(struct net_device *ndev,
 #endif
 	}
 
+	q->tx_reap_hist[min(fls(packets), XAE_TX_REAP_HIST_LEN - 1)]++;
+	if (!packets)
+		return 0;
+
+	trace_axienet_tx_reap(ndev, axienet_dma_q_index(q), packets,
+			      bql_bytes);
+
+	if (xsk_frames)
+		xsk_tx_completed(q->xsk_pool, xsk_frames);
+
 	ndev->stats.tx_packets += packets;
 	ndev->stats.tx_bytes += size;
 	q->tx_packets += packets;
 	q->tx_bytes += size;
 
-	/* Matches barrier in axienet_start_xmit */
+	netdev_tx_completed_queue(q->txq, bql_packets, bql_bytes);
+
+	/* Matches barrier in axienet_queue_xmit */
 	smp_mb();
 
-	/* Fixme: With the existing multiqueue implementation
-	 * in the driver it is difficult to get the exact queue info.
-	 * We should wake only the particular queue
-	 * instead of waking all ndev queues.
-	 */
-	netif_tx_wake_all_queues(ndev);
+	if (netif_tx_queue_stopped(q->txq))
+		netif_tx_wake_queue(q->txq);
+
+	return packets;
 }
 
 /**
@@ -1024,6 +1335,57 @@ static inline int axienet_check_tx_bd_space(struct axienet_dma_q *q,
 	return 0;
 }
 
+/**
+ * axienet_tx_doorbell - Hand the queued Tx BDs over to the DMA channel
+ * @q:		Pointer to DMA queue structure
+ *
+ * Writes the Tx tail descriptor register with the BD just before
+ * tx_bd_tail, which also starts any BDs queued before it without a
+ * doorbell. The caller must hold the queue Tx lock.
+ */
+static void axienet_tx_doorbell(struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = q->lp;
+	dma_addr_t tail_p;
+	u32 last;
+
+	last = (q->tx_bd_tail ? q->tx_bd_tail : lp->tx_bd_num) - 1;
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	tail_p = q->tx_bd_p + sizeof(*q->txq_bd_v) * last;
+#else
+	tail_p = q->tx_bd_p + sizeof(*q->tx_bd_v) * last;
+#endif
+
+	/* Ensure BD write before starting transfer */
+	wmb();
+
+	/* Start the transfer */
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id),
+			  tail_p);
+#else
+	axienet_dma_bdout(q, XAXIDMA_TX_TDESC_OFFSET, tail_p);
+#endif
+	q->tx_db_pending = false;
+
+	trace_axienet_tx_start(lp->ndev, axienet_dma_q_index(q), q->tx_bd_ci,
+			       q->tx_bd_tail);
+}
+
+/**
+ * axienet_tx_flush - Ring the Tx doorbell if BDs are still waiting for it
+ * @q:		Pointer to DMA queue structure
+ *
+ * Used on the xmit paths that drop or requeue a frame, since the stack
+ * will not call back for a frame that followed one sent with xmit_more.
+ * The caller must hold the queue Tx lock.
+ */
+static void axienet_tx_flush(struct axienet_dma_q *q)
+{
+	if (q->tx_db_pending)
+		axienet_tx_doorbell(q);
+}
+
 #ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
 /**
  * axienet_create_tsheader - Create timestamp header for tx
@@ -1253,7 +1615,6 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 	u32 num_frag;
 	u32 csum_start_off;
 	u32 csum_index_off;
-	dma_addr_t tail_p;
 	struct axienet_local *lp = netdev_priv(ndev);
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	struct aximcdma_bd *cur_p;
@@ -1261,7 +1622,8 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 	struct axidma_bd *cur_p;
 #endif
 	unsigned long flags;
-	struct axienet_dma_q *q;
+	struct axienet_dma_q *q = lp->dq[map];
+	u32 first;
 
 	if (lp->axienet_config->mactype == XAXIENET_10G_25G ||
 	    lp->axienet_config->mactype == XAXIENET_MRMAC) {
@@ -1274,13 +1636,14 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 		if (eth_skb_pad(skb)) {
 			ndev->stats.tx_dropped++;
 			ndev->stats.tx_errors++;
+			spin_lock_irqsave(&q->tx_lock, flags);
+			axienet_tx_flush(q);
+			spin_unlock_irqrestore(&q->tx_lock, flags);
 			return NETDEV_TX_OK;
 		}
 	}
 	num_frag = skb_shinfo(skb)->nr_frags;
 
-	q = lp->dq[map];
-
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	cur_p = &q->txq_bd_v[q->tx_bd_tail];
 #else
@@ -1289,12 +1652,16 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 
 	spin_lock_irqsave(&q->tx_lock, flags);
 	if (axienet_check_tx_bd_space(q, num_frag)) {
-		if (netif_queue_stopped(ndev)) {
+		q->tx_ring_full++;
+		trace_axienet_tx_ring_full(ndev, map, q->tx_bd_ci,
+					   q->tx_bd_tail);
+		axienet_tx_flush(q);
+		if (netif_tx_queue_stopped(q->txq)) {
 			spin_unlock_irqrestore(&q->tx_lock, flags);
 			return NETDEV_TX_BUSY;
 		}
 
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(q->txq);
 
 		/* Matches barrier in axienet_start_xmit_done */
 		smp_mb();
@@ -1305,11 +1672,13 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 			return NETDEV_TX_BUSY;
 		}
 
-		netif_wake_queue(ndev);
+		netif_tx_wake_queue(q->txq);
 	}
+	first = q->tx_bd_tail;
 
 #ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
 	if (axienet_skb_tstsmp(&skb, q, ndev)) {
+		axienet_tx_flush(q);
 		spin_unlock_irqrestore(&q->tx_lock, flags);
 		return NETDEV_TX_BUSY;
 	}
@@ -1342,6 +1711,7 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 	if (!q->eth_hasdre &&
 	    (((phys_addr_t)skb->data & 0x3) || num_frag > 0)) {
 		skb_copy_and_csum_dev(skb, q->tx_buf[q->tx_bd_tail]);
+		q->tx_bounce++;
 
 		cur_p->phys = q->tx_bufs_dma +
 			      (q->tx_buf[q->tx_bd_tail] - q->tx_bufs);
@@ -1351,12 +1721,15 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 #else
 		cur_p->cntrl = skb_pagelen(skb) | XAXIDMA_BD_CTRL_TXSOF_MASK;
 #endif
+		cur_p->tx_desc_mapping = DESC_DMA_MAP_NONE;
 		goto out;
 	} else {
 		cur_p->phys = dma_map_single(ndev->dev.parent, skb->data,
 					     skb_headlen(skb), DMA_TO_DEVICE);
 		if (unlikely(dma_mapping_error(ndev->dev.parent, cur_p->phys))) {
 			cur_p->phys = 0;
+			q->tx_dma_map_err++;
+			axienet_tx_flush(q);
 			spin_unlock_irqrestore(&q->tx_lock, flags);
 			dev_err(&ndev->dev, "TX buffer map failed\n");
 			return NETDEV_TX_BUSY;
@@ -1387,28 +1760,29 @@ static int axienet_queue_xmit(struct sk_buff *skb,
 out:
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	cur_p->cntrl |= XMCDMA_BD_CTRL_TXEOF_MASK;
-	tail_p = q->tx_bd_p + sizeof(*q->txq_bd_v) * q->tx_bd_tail;
 #else
 	cur_p->cntrl |= XAXIDMA_BD_CTRL_TXEOF_MASK;
-	tail_p = q->tx_bd_p + sizeof(*q->tx_bd_v) * q->tx_bd_tail;
 #endif
 	cur_p->tx_skb = (phys_addr_t)skb;
-	cur_p->tx_skb = (phys_addr_t)skb;
-
-	tail_p = q->tx_bd_p + sizeof(*q->tx_bd_v) * q->tx_bd_tail;
-	/* Ensure BD write before starting transfer */
-	wmb();
 
-	/* Start the transfer */
-#ifdef CONFIG_AXIENET_HAS_MCDMA
-	axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id),
-			  tail_p);
-#else
-	axienet_dma_bdout(q, XAXIDMA_TX_TDESC_OFFSET, tail_p);
-#endif
 	if (++q->tx_bd_tail >= lp->tx_bd_num)
 		q->tx_bd_tail = 0;
 
+	if (trace_axienet_tx_submit_enabled())
+		trace_axienet_tx_submit(ndev, map,
+					(q->tx_bd_tail + lp->tx_bd_num - first) %
+					lp->tx_bd_num, skb->len);
+
+	/* Defer the doorbell while the stack has more frames for us, unless
+	 * BQL has just stopped the queue.
+	 */
+	if (__netdev_tx_sent_queue(q->txq, skb->len, netdev_xmit_more())) {
+		axienet_tx_doorbell(q);
+	} else {
+		q->tx_db_pending = true;
+		q->tx_doorbells_saved++;
+	}
+
 	spin_unlock_irqrestore(&q->tx_lock, flags);
 
 	return NETDEV_TX_OK;
@@ -1435,94 +1809,677 @@ static int axienet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 }
 
 /**
- * axienet_recv - Is called from Axi DMA Rx Isr to complete the received
- *		  BD processing.
- * @ndev:	Pointer to net_device structure.
- * @budget:	NAPI budget
- * @q:		Pointer to axienet DMA queue structure
+ * axienet_xdp_xmit_frame - Queue an XDP frame on the Tx BD ring of a queue
+ * @q:		Pointer to DMA queue structure
+ * @xdpf:	XDP frame to be transmitted
+ * @dma_map:	Map the frame for DMA. False for XDP_TX, where the frame still
+ *		lives in a page of the queue page pool.
  *
- * This function is invoked from the Axi DMA Rx isr(poll) to process the Rx BDs
- * It does minimal processing and invokes "netif_receive_skb" to complete
- * further processing.
- * Return: Number of BD's processed.
+ * Return: 0, on success
+ *	    -EBUSY, if no BD is free
+ *	    -EINVAL, if the frame cannot be sent by the MAC
+ *	    -ENOMEM, if the frame could not be mapped
+ *
+ * Each queue has a single MM2S channel, so XDP frames share the Tx BD ring
+ * with the stack and are told apart by @xdpf in the BD. The caller must
+ * hold the queue Tx lock.
  */
-static int axienet_recv(struct net_device *ndev, int budget,
-			struct axienet_dma_q *q)
+static int axienet_xdp_xmit_frame(struct axienet_dma_q *q,
+				  struct xdp_frame *xdpf, bool dma_map)
 {
-	u32 length;
-	u32 csumstatus;
-	u32 size = 0;
-	u32 packets = 0;
-	dma_addr_t tail_p = 0;
-	struct axienet_local *lp = netdev_priv(ndev);
-	struct sk_buff *skb, *new_skb;
+	struct axienet_local *lp = q->lp;
+	struct device *dev = lp->ndev->dev.parent;
+	dma_addr_t phys;
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	struct aximcdma_bd *cur_p;
 #else
 	struct axidma_bd *cur_p;
 #endif
-	unsigned int numbdfree = 0;
 
-	/* Get relevat BD status value */
-	rmb();
+	/* XXV MAC and MRMAC do not pad short frames, see axienet_queue_xmit */
+	if ((lp->axienet_config->mactype == XAXIENET_10G_25G ||
+	     lp->axienet_config->mactype == XAXIENET_MRMAC) &&
+	    xdpf->len < ETH_ZLEN)
+		return -EINVAL;
+
+	if (axienet_check_tx_bd_space(q, 0)) {
+		q->tx_ring_full++;
+		return -EBUSY;
+	}
+
 #ifdef CONFIG_AXIENET_HAS_MCDMA
-	cur_p = &q->rxq_bd_v[q->rx_bd_ci];
+	cur_p = &q->txq_bd_v[q->tx_bd_tail];
 #else
-	cur_p = &q->rx_bd_v[q->rx_bd_ci];
+	cur_p = &q->tx_bd_v[q->tx_bd_tail];
 #endif
 
-	while ((numbdfree < budget) &&
-	       (cur_p->status & XAXIDMA_BD_STS_COMPLETE_MASK)) {
-		new_skb = netdev_alloc_skb(ndev, lp->max_frm_size);
-		if (!new_skb)
-			break;
+	if (!q->eth_hasdre && ((phys_addr_t)xdpf->data & 0x3)) {
+		memcpy(q->tx_buf[q->tx_bd_tail], xdpf->data, xdpf->len);
+		q->tx_bounce++;
+		phys = q->tx_bufs_dma +
+		       (q->tx_buf[q->tx_bd_tail] - q->tx_bufs);
+		cur_p->tx_desc_mapping = DESC_DMA_MAP_NONE;
+	} else if (dma_map) {
+		phys = dma_map_single(dev, xdpf->data, xdpf->len,
+				      DMA_TO_DEVICE);
+		if (unlikely(dma_mapping_error(dev, phys))) {
+			q->tx_dma_map_err++;
+			return -ENOMEM;
+		}
+		cur_p->tx_desc_mapping = DESC_DMA_MAP_SINGLE;
+	} else {
+		/* The xdp_frame sits at the start of the page pool buffer */
+		phys = page_pool_get_dma_addr(virt_to_page(xdpf->data)) +
+		       sizeof(*xdpf) + xdpf->headroom;
+		dma_sync_single_for_device(dev, phys, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+		cur_p->tx_desc_mapping = DESC_DMA_MAP_NONE;
+	}
 
+	cur_p->phys = phys;
+	cur_p->tx_skb = 0;
+	cur_p->xdpf = xdpf;
 #ifdef CONFIG_AXIENET_HAS_MCDMA
-		tail_p = q->rx_bd_p + sizeof(*q->rxq_bd_v) * q->rx_bd_ci;
+	cur_p->cntrl = xdpf->len | XMCDMA_BD_CTRL_TXSOF_MASK |
+		       XMCDMA_BD_CTRL_TXEOF_MASK;
 #else
-		tail_p = q->rx_bd_p + sizeof(*q->rx_bd_v) * q->rx_bd_ci;
+	cur_p->cntrl = xdpf->len | XAXIDMA_BD_CTRL_TXSOF_MASK |
+		       XAXIDMA_BD_CTRL_TXEOF_MASK;
 #endif
+	if (++q->tx_bd_tail >= lp->tx_bd_num)
+		q->tx_bd_tail = 0;
 
-		dma_unmap_single(ndev->dev.parent, cur_p->phys,
-				 lp->max_frm_size,
-				 DMA_FROM_DEVICE);
+	axienet_tx_doorbell(q);
 
-		skb = (struct sk_buff *)(cur_p->sw_id_offset);
+	return 0;
+}
 
-		/* skb could be NULL if a previous pass already received the
-		 * packet for this slot in the ring, but failed to refill it
-		 * with a newly allocated buffer. In this case, don't try to
-		 * receive it again.
-		 */
-		if (likely(skb)) {
-			if (lp->eth_hasnobuf ||
-			    lp->axienet_config->mactype != XAXIENET_1G)
-				length = cur_p->status & XAXIDMA_BD_STS_ACTUAL_LEN_MASK;
-			else
-				length = cur_p->app4 & 0x0000FFFF;
+/**
+ * axienet_xdp_xmit_back - Transmit a received frame for XDP_TX
+ * @q:		Pointer to DMA queue structure the frame was received on
+ * @xdp:	XDP buffer holding the frame
+ *
+ * Return: 0, on success. Negative error value on failure, in which case the
+ * caller still owns the buffer.
+ */
+static int axienet_xdp_xmit_back(struct axienet_dma_q *q,
+				 struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	unsigned long flags;
+	int ret;
 
-			skb_put(skb, length);
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
 
-#ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
-			if ((lp->tstamp_config.rx_filter == HWTSTAMP_FILTER_ALL ||
-			     lp->eth_hasptp) &&
-			    lp->axienet_config->mactype != XAXIENET_10G_25G &&
-			    lp->axienet_config->mactype != XAXIENET_MRMAC) {
-				u32 sec, nsec;
-				u64 time64;
-				struct skb_shared_hwtstamps *shhwtstamps;
+	spin_lock_irqsave(&q->tx_lock, flags);
+	ret = axienet_xdp_xmit_frame(q, xdpf, false);
+	spin_unlock_irqrestore(&q->tx_lock, flags);
 
-				if (lp->axienet_config->mactype == XAXIENET_1G ||
-				    lp->axienet_config->mactype == XAXIENET_2_5G) {
-					/* The first 8 bytes will be the timestamp */
-					memcpy(&sec, &skb->data[0], 4);
-					memcpy(&nsec, &skb->data[4], 4);
+	return ret;
+}
 
-					sec = cpu_to_be32(sec);
-					nsec = cpu_to_be32(nsec);
-				} else {
-					/* The first 8 bytes will be the timestamp */
-					memcpy(&nsec, &skb->data[0], 4);
+/**
+ * axienet_xdp_xmit - ndo_xdp_xmit handler for XDP_REDIRECT targets
+ * @ndev:	Pointer to net_device structure
+ * @num_frames:	Number of frames in @frames
+ * @frames:	XDP frames to be transmitted
+ * @flags:	XDP_XMIT_* flags
+ *
+ * Return: Number of frames queued for transmission, negative error value
+ * if none could be queued.
+ *
+ * The BD tail pointer is written for every frame, so XDP_XMIT_FLUSH does
+ * not need any extra handling.
+ */
+static int axienet_xdp_xmit(struct net_device *ndev, int num_frames,
+			    struct xdp_frame **frames, u32 flags)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	unsigned long irq_flags;
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	/* Tx completions only run from NAPI while a program is attached */
+	if (unlikely(!netif_running(ndev) || !axienet_xdp_enabled(lp)))
+		return -ENETDOWN;
+
+	q = lp->dq[smp_processor_id() % lp->num_tx_queues];
+
+	spin_lock_irqsave(&q->tx_lock, irq_flags);
+	for (i = 0; i < num_frames; i++) {
+		if (axienet_xdp_xmit_frame(q, frames[i], true))
+			break;
+		nxmit++;
+	}
+	spin_unlock_irqrestore(&q->tx_lock, irq_flags);
+
+	return nxmit;
+}
+
+#define AXIENET_XDP_PASS	0
+#define AXIENET_XDP_CONSUMED	BIT(0)
+#define AXIENET_XDP_TX		BIT(1)
+#define AXIENET_XDP_REDIRECT	BIT(2)
+
+/**
+ * axienet_run_xdp - Run the attached XDP program on a received frame
+ * @q:		Pointer to axienet DMA queue structure
+ * @prog:	XDP program to run
+ * @xdp:	XDP buffer describing the received frame
+ *
+ * Return: AXIENET_XDP_PASS if the frame must be handed to the stack,
+ * AXIENET_XDP_TX or AXIENET_XDP_REDIRECT if the buffer was passed on and
+ * AXIENET_XDP_CONSUMED if the caller has to recycle it.
+ */
+static int axienet_run_xdp(struct axienet_dma_q *q, struct bpf_prog *prog,
+			   struct xdp_buff *xdp)
+{
+	struct net_device *ndev = q->lp->ndev;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return AXIENET_XDP_PASS;
+	case XDP_TX:
+		if (axienet_xdp_xmit_back(q, xdp))
+			goto out_failure;
+		return AXIENET_XDP_TX;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(ndev, xdp, prog))
+			goto out_failure;
+		return AXIENET_XDP_REDIRECT;
+	default:
+		bpf_warn_invalid_xdp_action(ndev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(ndev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	return AXIENET_XDP_CONSUMED;
+}
+
+/**
+ * axienet_rx_alloc_failed - Account an Rx buffer allocation failure
+ * @q:		Pointer to axienet DMA queue structure
+ * @skb:	An skb rather than a page pool page could not be allocated
+ */
+static void axienet_rx_alloc_failed(struct axienet_dma_q *q, bool skb)
+{
+	if (skb)
+		q->rx_skb_alloc_fail++;
+	else
+		q->rx_page_alloc_fail++;
+	trace_axienet_rx_alloc_fail(q->lp->ndev, axienet_dma_q_index(q), skb);
+}
+
+/**
+ * axienet_rx_copybreak - Copy a small received frame into a new skb
+ * @q:		Pointer to axienet DMA queue structure
+ * @page:	Page pool buffer holding the frame, synced for the CPU
+ * @length:	Length of the frame
+ *
+ * The buffer is handed back to the device afterwards, so that the BD can
+ * be reused without a refill.
+ *
+ * Return: The skb, or NULL if it could not be allocated.
+ */
+static struct sk_buff *axienet_rx_copybreak(struct axienet_dma_q *q,
+					    struct page *page, u32 length)
+{
+	struct net_device *ndev = q->lp->ndev;
+	struct sk_buff *skb;
+
+	skb = netdev_alloc_skb_ip_align(ndev, length);
+	if (likely(skb)) {
+		skb_put_data(skb, page_address(page) + XAE_RX_HEADROOM,
+			     length);
+	} else {
+		ndev->stats.rx_dropped++;
+		axienet_rx_alloc_failed(q, true);
+	}
+
+	dma_sync_single_for_device(q->lp->dev, page_pool_get_dma_addr(page) +
+				   XAE_RX_HEADROOM, length,
+				   page_pool_get_dma_dir(q->page_pool));
+
+	return skb;
+}
+
+/**
+ * axienet_rx_split_skb - Build an skb with the frame headers copied out
+ * @q:		Pointer to axienet DMA queue structure
+ * @page:	Page pool buffer holding the frame, synced for the CPU
+ * @length:	Length of the frame
+ *
+ * Used for multi-page jumbo buffers. The first XAE_RX_HDR_LEN bytes, which
+ * hold the in-band timestamp if any and the protocol headers, are copied
+ * into a small linear area and the rest of the buffer becomes a page
+ * fragment, instead of making the whole buffer the skb head.
+ *
+ * Return: The skb, or NULL if it could not be allocated, in which case the
+ * page has been recycled.
+ */
+static struct sk_buff *axienet_rx_split_skb(struct axienet_dma_q *q,
+					    struct page *page, u32 length)
+{
+	struct axienet_local *lp = q->lp;
+	u32 hlen = min_t(u32, length, XAE_RX_HDR_LEN);
+	u8 *data = page_address(page) + XAE_RX_HEADROOM;
+	struct sk_buff *skb;
+
+	skb = netdev_alloc_skb_ip_align(lp->ndev, XAE_RX_HDR_LEN);
+	if (unlikely(!skb)) {
+		page_pool_recycle_direct(q->page_pool, page);
+		lp->ndev->stats.rx_dropped++;
+		axienet_rx_alloc_failed(q, true);
+		return NULL;
+	}
+
+	skb_put_data(skb, data, hlen);
+	if (length > hlen)
+		skb_add_rx_frag(skb, 0, page, XAE_RX_HEADROOM + hlen,
+				length - hlen, PAGE_SIZE << lp->rx_page_order);
+	else
+		page_pool_recycle_direct(q->page_pool, page);
+	skb_mark_for_recycle(skb);
+
+	return skb;
+}
+
+/**
+ * axienet_rx_build_skb - Wrap a completed Rx page_pool buffer into an skb
+ * @q:		Pointer to axienet DMA queue structure
+ * @page:	Page holding the received frame
+ * @xdp:	XDP buffer describing the frame, possibly adjusted by XDP
+ *
+ * Return: The skb on success, NULL if no skb head could be allocated. In
+ * that case the page is handed back to the pool.
+ */
+static struct sk_buff *axienet_rx_build_skb(struct axienet_dma_q *q,
+					    struct page *page,
+					    struct xdp_buff *xdp)
+{
+	struct sk_buff *skb;
+
+	skb = build_skb(xdp->data_hard_start, xdp->frame_sz);
+	if (unlikely(!skb)) {
+		page_pool_recycle_direct(q->page_pool, page);
+		q->lp->ndev->stats.rx_dropped++;
+		axienet_rx_alloc_failed(q, true);
+		return NULL;
+	}
+
+	skb_mark_for_recycle(skb);
+	skb_reserve(skb, xdp->data - xdp->data_hard_start);
+	skb_put(skb, xdp->data_end - xdp->data);
+
+	return skb;
+}
+
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+/**
+ * axienet_run_xdp_zc - Run the XDP program on an AF_XDP zero-copy buffer
+ * @q:		Pointer to axienet DMA queue structure
+ * @prog:	XDP program to run
+ * @xdp:	XDP buffer from the queue AF_XDP buffer pool
+ *
+ * Return: AXIENET_XDP_* result. Unless the frame was redirected, the caller
+ * still owns @xdp and must free it.
+ */
+static int axienet_run_xdp_zc(struct axienet_dma_q *q, struct bpf_prog *prog,
+			      struct xdp_buff *xdp)
+{
+	struct net_device *ndev = q->lp->ndev;
+	struct xdp_frame *xdpf;
+	unsigned long flags;
+	int ret;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return AXIENET_XDP_PASS;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(ndev, xdp, prog))
+			goto out_failure;
+		return AXIENET_XDP_REDIRECT;
+	case XDP_TX:
+		xdpf = xdp_convert_zc_to_xdp_frame(xdp);
+		if (unlikely(!xdpf))
+			goto out_failure;
+
+		spin_lock_irqsave(&q->tx_lock, flags);
+		ret = axienet_xdp_xmit_frame(q, xdpf, true);
+		spin_unlock_irqrestore(&q->tx_lock, flags);
+		if (ret) {
+			xdp_return_frame(xdpf);
+			goto out_failure;
+		}
+		return AXIENET_XDP_TX;
+	default:
+		bpf_warn_invalid_xdp_action(ndev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(ndev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	return AXIENET_XDP_CONSUMED;
+}
+
+/**
+ * axienet_xsk_recv - Rx BD processing for a queue bound to an AF_XDP pool
+ * @ndev:	Pointer to net_device structure.
+ * @budget:	NAPI budget
+ * @q:		Pointer to axienet DMA queue structure
+ *
+ * Frames are received straight into the AF_XDP UMEM. Frames passed to the
+ * stack are copied into a freshly allocated skb. Buffers of processed BDs
+ * are replaced from the fill ring by axienet_xsk_rx_refill().
+ *
+ * Return: Number of BD's processed.
+ */
+static int axienet_xsk_recv(struct net_device *ndev, int budget,
+			    struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct bpf_prog *xdp_prog = READ_ONCE(lp->xdp_prog);
+	struct aximcdma_bd *cur_p;
+	unsigned int numbdfree = 0;
+	int xdp_res, xdp_status = 0;
+	struct xdp_buff *xdp;
+	struct sk_buff *skb;
+	u32 packets = 0;
+	u32 size = 0;
+	u32 length;
+
+	/* Get relevat BD status value */
+	rmb();
+	cur_p = &q->rxq_bd_v[q->rx_bd_ci];
+
+	while ((numbdfree < budget) &&
+	       (cur_p->status & XAXIDMA_BD_STS_COMPLETE_MASK)) {
+		if (lp->eth_hasnobuf ||
+		    lp->axienet_config->mactype != XAXIENET_1G)
+			length = cur_p->status & XAXIDMA_BD_STS_ACTUAL_LEN_MASK;
+		else
+			length = cur_p->app4 & 0x0000FFFF;
+
+		xdp = (struct xdp_buff *)(cur_p->sw_id_offset);
+		xdp->data_end = xdp->data + length;
+		xsk_buff_dma_sync_for_cpu(xdp, q->xsk_pool);
+
+		xdp_res = AXIENET_XDP_PASS;
+		if (xdp_prog)
+			xdp_res = axienet_run_xdp_zc(q, xdp_prog, xdp);
+
+		if (xdp_res == AXIENET_XDP_PASS) {
+			skb = netdev_alloc_skb_ip_align(ndev, length);
+			if (likely(skb)) {
+				skb_put_data(skb, xdp->data, length);
+				skb->protocol = eth_type_trans(skb, ndev);
+				skb->ip_summed = CHECKSUM_NONE;
+				netif_receive_skb(skb);
+			} else {
+				ndev->stats.rx_dropped++;
+				axienet_rx_alloc_failed(q, true);
+			}
+		} else if (xdp_res != AXIENET_XDP_CONSUMED) {
+			xdp_status |= xdp_res;
+		}
+
+		if (xdp_res != AXIENET_XDP_REDIRECT)
+			xsk_buff_free(xdp);
+
+		if (xdp_res != AXIENET_XDP_CONSUMED) {
+			size += length;
+			packets++;
+		}
+
+		cur_p->status = 0;
+		cur_p->sw_id_offset = 0;
+		q->rx_bd_unused++;
+
+		if (++q->rx_bd_ci >= lp->rx_bd_num)
+			q->rx_bd_ci = 0;
+
+		/* Get relevat BD status value */
+		rmb();
+		cur_p = &q->rxq_bd_v[q->rx_bd_ci];
+		numbdfree++;
+	}
+
+	if (xdp_status & AXIENET_XDP_REDIRECT)
+		xdp_do_flush();
+
+	ndev->stats.rx_packets += packets;
+	ndev->stats.rx_bytes += size;
+	q->rx_packets += packets;
+	q->rx_bytes += size;
+
+	axienet_xsk_rx_refill(q);
+
+	return numbdfree;
+}
+
+/**
+ * axienet_xsk_xmit - Queue AF_XDP Tx descriptors on the MCDMA Tx channel
+ * @q:		Pointer to axienet DMA queue structure
+ * @budget:	Maximum number of descriptors to queue
+ *
+ * The UMEM is already DMA mapped by the buffer pool, so descriptors are
+ * handed to the channel as is and the tail pointer is written once for
+ * the whole batch.
+ *
+ * Return: true if the Tx ring of the socket was drained within @budget.
+ */
+static bool axienet_xsk_xmit(struct axienet_dma_q *q, unsigned int budget)
+{
+	struct axienet_local *lp = q->lp;
+	struct xsk_buff_pool *pool = q->xsk_pool;
+	struct aximcdma_bd *cur_p;
+	unsigned int sent = 0;
+	struct xdp_desc desc;
+	unsigned long flags;
+	dma_addr_t phys;
+
+	spin_lock_irqsave(&q->tx_lock, flags);
+	while (sent < budget && !axienet_check_tx_bd_space(q, 0) &&
+	       xsk_tx_peek_desc(pool, &desc)) {
+		cur_p = &q->txq_bd_v[q->tx_bd_tail];
+
+		phys = xsk_buff_raw_get_dma(pool, desc.addr);
+		if (!q->eth_hasdre && (phys & 0x3)) {
+			memcpy(q->tx_buf[q->tx_bd_tail],
+			       xsk_buff_raw_get_data(pool, desc.addr),
+			       desc.len);
+			q->tx_bounce++;
+			phys = q->tx_bufs_dma +
+			       (q->tx_buf[q->tx_bd_tail] - q->tx_bufs);
+		} else {
+			xsk_buff_raw_dma_sync_for_device(pool, phys, desc.len);
+		}
+
+		cur_p->phys = phys;
+		cur_p->cntrl = desc.len | XMCDMA_BD_CTRL_TXSOF_MASK |
+			       XMCDMA_BD_CTRL_TXEOF_MASK;
+		cur_p->tx_skb = 0;
+		cur_p->xdpf = NULL;
+		cur_p->tx_desc_mapping = DESC_DMA_MAP_XSK;
+
+		if (++q->tx_bd_tail >= lp->tx_bd_num)
+			q->tx_bd_tail = 0;
+		sent++;
+	}
+
+	if (sent) {
+		xsk_tx_release(pool);
+		axienet_tx_doorbell(q);
+	}
+	spin_unlock_irqrestore(&q->tx_lock, flags);
+
+	if (xsk_uses_need_wakeup(pool))
+		xsk_set_tx_need_wakeup(pool);
+
+	return sent < budget;
+}
+#endif
+
+/**
+ * axienet_recv - Is called from Axi DMA Rx Isr to complete the received
+ *		  BD processing.
+ * @ndev:	Pointer to net_device structure.
+ * @budget:	NAPI budget
+ * @q:		Pointer to axienet DMA queue structure
+ *
+ * This function is invoked from the Axi DMA Rx isr(poll) to process the Rx BDs
+ * It does minimal processing and invokes "netif_receive_skb" to complete
+ * further processing. If an XDP program is attached it runs on each frame
+ * before any skb is built.
+ * Return: Number of BD's processed.
+ */
+static int axienet_recv(struct net_device *ndev, int budget,
+			struct axienet_dma_q *q)
+{
+	u32 length;
+	u32 csumstatus;
+	u32 size = 0;
+	u32 packets = 0;
+	dma_addr_t tail_p = 0;
+	dma_addr_t new_phys;
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct bpf_prog *xdp_prog = READ_ONCE(lp->xdp_prog);
+	struct page *page, *new_page;
+	struct sk_buff *skb;
+	struct xdp_buff xdp;
+	int xdp_res, xdp_status = 0;
+	u32 copybreak = 0;
+	bool copy, split;
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	struct aximcdma_bd *cur_p;
+#else
+	struct axidma_bd *cur_p;
+#endif
+	unsigned int numbdfree = 0;
+
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	if (q->xsk_pool)
+		return axienet_xsk_recv(ndev, budget, q);
+#endif
+
+	xdp_init_buff(&xdp, PAGE_SIZE << lp->rx_page_order, &q->xdp_rxq);
+
+	/* XDP programs see every frame in its page pool buffer */
+	if (!xdp_prog)
+		copybreak = READ_ONCE(lp->rx_copybreak);
+	split = !xdp_prog && lp->rx_page_order;
+
+	/* Get relevat BD status value */
+	rmb();
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	cur_p = &q->rxq_bd_v[q->rx_bd_ci];
+#else
+	cur_p = &q->rx_bd_v[q->rx_bd_ci];
+#endif
+
+	while ((numbdfree < budget) &&
+	       (cur_p->status & XAXIDMA_BD_STS_COMPLETE_MASK)) {
+		if (lp->eth_hasnobuf ||
+		    lp->axienet_config->mactype != XAXIENET_1G)
+			length = cur_p->status & XAXIDMA_BD_STS_ACTUAL_LEN_MASK;
+		else
+			length = cur_p->app4 & 0x0000FFFF;
+
+		page = (struct page *)(cur_p->sw_id_offset);
+
+		/* Small frames are copied and their buffer stays on the ring */
+		copy = page && length <= copybreak;
+		if (copy) {
+			new_page = page;
+			new_phys = page_pool_get_dma_addr(page) +
+				   XAE_RX_HEADROOM;
+		} else {
+			new_page = axienet_rx_page_alloc(q, &new_phys);
+			if (!new_page) {
+				axienet_rx_alloc_failed(q, false);
+				break;
+			}
+		}
+
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+		tail_p = q->rx_bd_p + sizeof(*q->rxq_bd_v) * q->rx_bd_ci;
+#else
+		tail_p = q->rx_bd_p + sizeof(*q->rx_bd_v) * q->rx_bd_ci;
+#endif
+
+		skb = NULL;
+		xdp_res = AXIENET_XDP_CONSUMED;
+		if (likely(page)) {
+			dma_sync_single_for_cpu(lp->dev,
+						page_pool_get_dma_addr(page) +
+						XAE_RX_HEADROOM, length,
+						page_pool_get_dma_dir(q->page_pool));
+
+			xdp_res = AXIENET_XDP_PASS;
+			if (copy) {
+				skb = axienet_rx_copybreak(q, page, length);
+			} else if (split) {
+				skb = axienet_rx_split_skb(q, page, length);
+			} else {
+				xdp_prepare_buff(&xdp, page_address(page),
+						 XAE_RX_HEADROOM, length,
+						 false);
+				if (xdp_prog)
+					xdp_res = axienet_run_xdp(q, xdp_prog,
+								  &xdp);
+
+				if (xdp_res == AXIENET_XDP_PASS)
+					skb = axienet_rx_build_skb(q, page,
+								   &xdp);
+				else if (xdp_res == AXIENET_XDP_CONSUMED)
+					page_pool_recycle_direct(q->page_pool,
+								 page);
+				else
+					xdp_status |= xdp_res;
+			}
+		}
+
+		if (xdp_res & (AXIENET_XDP_TX | AXIENET_XDP_REDIRECT)) {
+			size += length;
+			packets++;
+		} else if (likely(skb)) {
+#ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
+			if ((lp->tstamp_config.rx_filter == HWTSTAMP_FILTER_ALL ||
+			     lp->eth_hasptp) &&
+			    lp->axienet_config->mactype != XAXIENET_10G_25G &&
+			    lp->axienet_config->mactype != XAXIENET_MRMAC) {
+				u32 sec, nsec;
+				u64 time64;
+				struct skb_shared_hwtstamps *shhwtstamps;
+
+				if (lp->axienet_config->mactype == XAXIENET_1G ||
+				    lp->axienet_config->mactype == XAXIENET_2_5G) {
+					/* The first 8 bytes will be the timestamp */
+					memcpy(&sec, &skb->data[0], 4);
+					memcpy(&nsec, &skb->data[4], 4);
+
+					sec = cpu_to_be32(sec);
+					nsec = cpu_to_be32(nsec);
+				} else {
+					/* The first 8 bytes will be the timestamp */
+					memcpy(&nsec, &skb->data[0], 4);
 					memcpy(&sec, &skb->data[4], 4);
 				}
 
@@ -1564,23 +2521,14 @@ static int axienet_recv(struct net_device *ndev, int budget,
 			packets++;
 		}
 
-		/* Ensure that the skb is completely updated
-		 * prio to mapping the DMA
+		/* The page pool, or axienet_rx_copybreak() for a reused
+		 * buffer, has already synced the new buffer for the device,
+		 * only the BD itself needs to be updated.
 		 */
-		wmb();
-
-		cur_p->phys = dma_map_single(ndev->dev.parent, new_skb->data,
-					     lp->max_frm_size,
-					     DMA_FROM_DEVICE);
-		if (unlikely(dma_mapping_error(ndev->dev.parent, cur_p->phys))) {
-			cur_p->phys = 0;
-			dev_kfree_skb(new_skb);
-			dev_err(lp->dev, "RX buffer map failed\n");
-			break;
-		}
+		cur_p->phys = new_phys;
 		cur_p->cntrl = lp->max_frm_size;
 		cur_p->status = 0;
-		cur_p->sw_id_offset = (phys_addr_t)new_skb;
+		cur_p->sw_id_offset = (phys_addr_t)new_page;
 
 		if (++q->rx_bd_ci >= lp->rx_bd_num)
 			q->rx_bd_ci = 0;
@@ -1595,11 +2543,18 @@ static int axienet_recv(struct net_device *ndev, int budget,
 		numbdfree++;
 	}
 
+	if (xdp_status & AXIENET_XDP_REDIRECT)
+		xdp_do_flush();
+
 	ndev->stats.rx_packets += packets;
 	ndev->stats.rx_bytes += size;
 	q->rx_packets += packets;
 	q->rx_bytes += size;
 
+	if (numbdfree)
+		trace_axienet_rx_done(ndev, axienet_dma_q_index(q), numbdfree,
+				      size);
+
 	if (tail_p) {
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 		axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id) +
@@ -1617,8 +2572,9 @@ static int axienet_recv(struct net_device *ndev, int budget,
  * @napi:	napi structure pointer
  * @quota:	Max number of rx packets to be processed.
  *
- * This is the poll routine for rx part.
- * It will process the packets maximux quota value.
+ * This is the poll routine of a DMA queue. It first reaps the completed
+ * Tx BDs and then processes at most quota Rx packets. The Tx and Rx
+ * interrupts masked by the isrs are enabled again once both are done.
  *
  * Return: number of packets received
  */
@@ -1629,9 +2585,18 @@ int xaxienet_rx_poll(struct napi_struct *napi, int quota)
 	int work_done = 0;
 	unsigned int status, cr;
 	int map = napi - lp->napi;
+	unsigned long flags;
+	bool tx_done;
 
 	struct axienet_dma_q *q = lp->dq[map];
 
+	tx_done = axienet_start_xmit_done(ndev, q, quota) < TX_NAPI_BUDGET;
+
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	if (q->xsk_pool && !axienet_xsk_xmit(q, quota))
+		tx_done = false;
+#endif
+
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	spin_lock(&q->rx_lock);
 	status = axienet_dma_in32(q, XMCDMA_CHAN_SR_OFFSET(q->chan_id) +
@@ -1666,20 +2631,51 @@ int xaxienet_rx_poll(struct napi_struct *napi, int quota)
 	spin_unlock(&q->rx_lock);
 #endif
 
-	if (work_done < quota) {
-		napi_complete(napi);
+	/* Keep polling until the Tx BD ring has been reaped and the AF_XDP
+	 * Tx ring drained.
+	 */
+	if (!tx_done)
+		work_done = quota;
+
+	if (work_done == quota) {
+		q->rx_budget_exhausted++;
+		/* Serve the rest of the burst at full speed, before PELT
+		 * notices the softirq load.
+		 */
+		cpufreq_util_hint(SCHED_CAPACITY_SCALE, NAPI_UTIL_HINT_US);
+	}
+
+	if (work_done < quota && napi_complete_done(napi, work_done)) {
+		if (q->rx_dim_enabled)
+			axienet_rx_dim_update(q);
 #ifdef CONFIG_AXIENET_HAS_MCDMA
-		/* Enable the interrupts again */
+		/* Enable the interrupts again, with the current coalescing */
 		cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id) +
 				      XMCDMA_RX_OFFSET);
+		cr &= ~(XMCDMA_COALESCE_MASK | XMCDMA_DELAY_MASK);
+		cr |= READ_ONCE(q->rx_coalesce);
 		cr |= (XMCDMA_IRQ_IOC_MASK | XMCDMA_IRQ_DELAY_MASK);
 		axienet_dma_out32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id) +
 				  XMCDMA_RX_OFFSET, cr);
+
+		spin_lock_irqsave(&q->tx_lock, flags);
+		cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id));
+		cr |= (XMCDMA_IRQ_IOC_MASK | XMCDMA_IRQ_DELAY_MASK);
+		axienet_dma_out32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id), cr);
+		spin_unlock_irqrestore(&q->tx_lock, flags);
 #else
-		/* Enable the interrupts again */
+		/* Enable the interrupts again, with the current coalescing */
 		cr = axienet_dma_in32(q, XAXIDMA_RX_CR_OFFSET);
+		cr &= ~(XAXIDMA_COALESCE_MASK | XAXIDMA_DELAY_MASK);
+		cr |= READ_ONCE(q->rx_coalesce);
 		cr |= (XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK);
 		axienet_dma_out32(q, XAXIDMA_RX_CR_OFFSET, cr);
+
+		spin_lock_irqsave(&q->tx_lock, flags);
+		cr = axienet_dma_in32(q, XAXIDMA_TX_CR_OFFSET);
+		cr |= (XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK);
+		axienet_dma_out32(q, XAXIDMA_TX_CR_OFFSET, cr);
+		spin_unlock_irqrestore(&q->tx_lock, flags);
 #endif
 	}
 
@@ -1693,26 +2689,71 @@ int xaxienet_rx_poll(struct napi_struct *napi, int quota)
  *
  * Return: IRQ_HANDLED if device generated a core interrupt, IRQ_NONE otherwise.
  *
- * Handle miscellaneous conditions indicated by Ethernet core IRQ.
+ * Handle miscellaneous conditions indicated by Ethernet core IRQ.
+ */
+static irqreturn_t axienet_eth_irq(int irq, void *_ndev)
+{
+	struct net_device *ndev = _ndev;
+	struct axienet_local *lp = netdev_priv(ndev);
+	unsigned int pending;
+
+	pending = axienet_ior(lp, XAE_IP_OFFSET);
+	if (!pending)
+		return IRQ_NONE;
+
+	if (pending & XAE_INT_RXFIFOOVR_MASK)
+		ndev->stats.rx_missed_errors++;
+
+	if (pending & XAE_INT_RXRJECT_MASK)
+		ndev->stats.rx_frame_errors++;
+
+	/*
+	 * The PCS restarted autonegotiation, the link went down. Latch the
+	 * drop so that it is reported even when the link is already back.
+	 */
+	if (pending & XAE_INT_AUTONEG_MASK && lp->pcs_irq)
+		phylink_mac_change(lp->phylink, false);
+
+	/* The MDIO completions are handled by axienet_mdio_irq() */
+	axienet_iow(lp, XAE_IS_OFFSET, pending & ~XAE_INT_HARDACSCMPLT_MASK);
+	return IRQ_HANDLED;
+}
+
+/**
+ * axienet_set_irq_affinity - Spread the DMA queue interrupts over the CPUs
+ * @lp:		Pointer to the axienet_local structure
+ *
+ * Tx and Rx of a DMA queue share one NAPI context, so both interrupts of a
+ * queue are steered to the same CPU, and the queues are spread over the
+ * CPUs closest to the device.
+ */
+static void axienet_set_irq_affinity(struct axienet_local *lp)
+{
+	int node = dev_to_node(lp->dev);
+	const struct cpumask *mask;
+	int i;
+
+	for_each_rx_dma_queue(lp, i) {
+		mask = cpumask_of(cpumask_local_spread(i, node));
+		irq_set_affinity_and_hint(lp->dq[i]->tx_irq, mask);
+		irq_set_affinity_and_hint(lp->dq[i]->rx_irq, mask);
+	}
+}
+
+/**
+ * axienet_clear_irq_affinity - Drop the affinity hints of the DMA queues
+ * @lp:		Pointer to the axienet_local structure
+ *
+ * Must be called before the queue interrupts are freed.
  */
-static irqreturn_t axienet_eth_irq(int irq, void *_ndev)
+static void axienet_clear_irq_affinity(struct axienet_local *lp)
 {
-	struct net_device *ndev = _ndev;
-	struct axienet_local *lp = netdev_priv(ndev);
-	unsigned int pending;
-
-	pending = axienet_ior(lp, XAE_IP_OFFSET);
-	if (!pending)
-		return IRQ_NONE;
-
-	if (pending & XAE_INT_RXFIFOOVR_MASK)
-		ndev->stats.rx_missed_errors++;
-
-	if (pending & XAE_INT_RXRJECT_MASK)
-		ndev->stats.rx_frame_errors++;
+	int i;
 
-	axienet_iow(lp, XAE_IS_OFFSET, pending);
-	return IRQ_HANDLED;
+	for_each_rx_dma_queue(lp, i) {
+		irq_update_affinity_hint(lp->dq[i]->tx_irq, NULL);
+		irq_update_affinity_hint(lp->dq[i]->rx_irq, NULL);
+	}
 }
 
 /**
@@ -1932,6 +2973,8 @@ static int axienet_open(struct net_device *ndev)
 			goto err_eth_irq;
 	}
 
+	axienet_set_irq_affinity(lp);
+
 	netif_tx_start_all_queues(ndev);
 	return 0;
 
@@ -1987,6 +3030,8 @@ static int axienet_stop(struct net_device *ndev)
 	lp->axienet_config->setoptions(ndev, lp->options &
 			   ~(XAE_OPTION_TXEN | XAE_OPTION_RXEN));
 
+	axienet_clear_irq_affinity(lp);
+
 	for_each_tx_dma_queue(lp, i) {
 		q = lp->dq[i];
 		cr = axienet_dma_in32(q, XAXIDMA_RX_CR_OFFSET);
@@ -1997,7 +3042,8 @@ static int axienet_stop(struct net_device *ndev)
 		cr &= ~(XAXIDMA_CR_RUNSTOP_MASK | XAXIDMA_IRQ_ALL_MASK);
 		axienet_dma_out32(q, XAXIDMA_TX_CR_OFFSET, cr);
 
-		axienet_iow(lp, XAE_IE_OFFSET, 0);
+		axienet_iow(lp, XAE_IE_OFFSET, lp->mdio_irq ?
+			    XAE_INT_HARDACSCMPLT_MASK : 0);
 
 		/* Give DMAs a chance to halt gracefully */
 		sr = axienet_dma_in32(q, XAXIDMA_RX_SR_OFFSET);
@@ -2023,6 +3069,7 @@ static int axienet_stop(struct net_device *ndev)
 		q = lp->dq[i];
 		netif_stop_queue(ndev);
 		napi_disable(&lp->napi[i]);
+		cancel_work_sync(&q->rx_dim.work);
 		tasklet_kill(&lp->dma_err_tasklet[i]);
 		free_irq(q->rx_irq, ndev);
 	}
@@ -2056,11 +3103,174 @@ static int axienet_change_mtu(struct net_device *ndev, int new_mtu)
 		XAE_TRL_SIZE) > lp->rxmem)
 		return -EINVAL;
 
+	if (lp->xdp_prog &&
+	    new_mtu + VLAN_ETH_HLEN + XAE_TRL_SIZE > XAE_XDP_MAX_FRAME_SIZE) {
+		netdev_err(ndev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	ndev->mtu = new_mtu;
 
 	return 0;
 }
 
+/**
+ * axienet_xdp_setup - Attach or detach an XDP program
+ * @ndev:	Pointer to net_device structure
+ * @prog:	XDP program to attach, NULL to detach
+ * @extack:	Netlink extended ack for error reporting
+ *
+ * Return: 0 on success, negative error value on failure.
+ *
+ * The Rx page pools are mapped differently and Tx completions move to NAPI
+ * when XDP is in use, so the interface is restarted when XDP is turned on
+ * or off. Replacing one program with another is done in place.
+ */
+static int axienet_xdp_setup(struct net_device *ndev, struct bpf_prog *prog,
+			     struct netlink_ext_ack *extack)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	bool running = netif_running(ndev);
+	struct bpf_prog *old_prog;
+	bool need_reset;
+
+	if (prog && ndev->mtu + VLAN_ETH_HLEN + XAE_TRL_SIZE >
+		    XAE_XDP_MAX_FRAME_SIZE) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+#ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
+	if (prog && (lp->eth_hasptp ||
+		     lp->tstamp_config.rx_filter == HWTSTAMP_FILTER_ALL) &&
+	    lp->axienet_config->mactype != XAXIENET_10G_25G &&
+	    lp->axienet_config->mactype != XAXIENET_MRMAC) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "XDP is not supported with in-band Rx timestamps");
+		return -EOPNOTSUPP;
+	}
+#endif
+
+	need_reset = !!lp->xdp_prog != !!prog;
+	if (running && need_reset)
+		axienet_stop(ndev);
+
+	old_prog = xchg(&lp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (running && need_reset)
+		return axienet_open(ndev);
+
+	return 0;
+}
+
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+/**
+ * axienet_xsk_pool_setup - Bind or unbind an AF_XDP pool to a queue
+ * @ndev:	Pointer to net_device structure
+ * @pool:	AF_XDP buffer pool to bind, NULL to unbind
+ * @qid:	Queue, and thereby MCDMA channel pair, the pool is bound to
+ *
+ * Return: 0 on success, negative error value on failure.
+ *
+ * The Rx and Tx BD rings of the queue are rebuilt around the pool, which
+ * requires restarting the interface if it is up.
+ */
+static int axienet_xsk_pool_setup(struct net_device *ndev,
+				  struct xsk_buff_pool *pool, u16 qid)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	bool running = netif_running(ndev);
+	bool enable = !!pool;
+	struct axienet_dma_q *q;
+	int ret;
+
+	if (qid >= lp->num_rx_queues || qid >= lp->num_tx_queues)
+		return -EINVAL;
+
+	q = lp->dq[qid];
+
+	if (enable) {
+		if (q->xsk_pool)
+			return -EBUSY;
+
+		if (xsk_pool_get_rx_frame_size(pool) <
+		    ndev->mtu + VLAN_ETH_HLEN + XAE_TRL_SIZE)
+			return -EINVAL;
+
+		ret = xsk_pool_dma_map(pool, ndev->dev.parent, 0);
+		if (ret)
+			return ret;
+	} else {
+		pool = q->xsk_pool;
+		if (!pool)
+			return -EINVAL;
+	}
+
+	if (running)
+		axienet_stop(ndev);
+
+	WRITE_ONCE(q->xsk_pool, enable ? pool : NULL);
+	if (!enable)
+		xsk_pool_dma_unmap(pool, 0);
+
+	if (running)
+		return axienet_open(ndev);
+
+	return 0;
+}
+
+/**
+ * axienet_xsk_wakeup - ndo_xsk_wakeup handler
+ * @ndev:	Pointer to net_device structure
+ * @qid:	Queue the AF_XDP socket is bound to
+ * @flags:	XDP_WAKEUP_RX and/or XDP_WAKEUP_TX
+ *
+ * Return: 0 on success, negative error value on failure.
+ *
+ * Rx refill and Tx submission both happen from the queue NAPI, so either
+ * kind of wakeup just schedules it.
+ */
+static int axienet_xsk_wakeup(struct net_device *ndev, u32 qid, u32 flags)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (!netif_running(ndev))
+		return -ENETDOWN;
+
+	if (qid >= lp->num_rx_queues || !READ_ONCE(lp->dq[qid]->xsk_pool))
+		return -ENXIO;
+
+	if (!napi_if_scheduled_mark_missed(&lp->napi[qid]))
+		napi_schedule(&lp->napi[qid]);
+
+	return 0;
+}
+#endif
+
+/**
+ * axienet_bpf - ndo_bpf handler
+ * @ndev:	Pointer to net_device structure
+ * @bpf:	BPF command
+ *
+ * Return: 0 on success, negative error value on failure.
+ */
+static int axienet_bpf(struct net_device *ndev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return axienet_xdp_setup(ndev, bpf->prog, bpf->extack);
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	case XDP_SETUP_XSK_POOL:
+		return axienet_xsk_pool_setup(ndev, bpf->xsk.pool,
+					      bpf->xsk.queue_id);
+#endif
+	default:
+		return -EINVAL;
+	}
+}
+
 #ifdef CONFIG_NET_POLL_CONTROLLER
 /**
  * axienet_poll_controller - Axi Ethernet poll mechanism.
@@ -2115,6 +3325,13 @@ static int axienet_set_timestamp_mode(struct axienet_local *lp,
 	if (config->flags)
 		return -EINVAL;
 
+	/* In-band Rx timestamps would be seen as packet data by XDP */
+	if (config->rx_filter != HWTSTAMP_FILTER_NONE &&
+	    axienet_xdp_enabled(lp) &&
+	    lp->axienet_config->mactype != XAXIENET_10G_25G &&
+	    lp->axienet_config->mactype != XAXIENET_MRMAC)
+		return -EBUSY;
+
 	/* Read the current value in the MAC TX CTRL register */
 	if (lp->axienet_config->mactype != XAXIENET_10G_25G &&
 	    lp->axienet_config->mactype != XAXIENET_MRMAC)
@@ -2256,6 +3473,11 @@ static const struct net_device_ops axienet_netdev_ops = {
 	.ndo_eth_ioctl = axienet_ioctl,
 	.ndo_set_rx_mode = axienet_set_multicast_list,
 	.ndo_do_ioctl = axienet_ioctl,
+	.ndo_bpf = axienet_bpf,
+	.ndo_xdp_xmit = axienet_xdp_xmit,
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	.ndo_xsk_wakeup = axienet_xsk_wakeup,
+#endif
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller = axienet_poll_controller,
 #endif
@@ -2458,29 +3680,57 @@ axienet_ethtools_get_coalesce(struct net_device *ndev,
 			      struct kernel_ethtool_coalesce *kernel_coal,
 			      struct netlink_ext_ack *extack)
 {
-	u32 regval = 0;
 	struct axienet_local *lp = netdev_priv(ndev);
-	struct axienet_dma_q *q;
-	int i;
 
-	for_each_rx_dma_queue(lp, i) {
-		q = lp->dq[i];
+	ecoalesce->rx_max_coalesced_frames = lp->coalesce_count_rx;
+	ecoalesce->rx_coalesce_usecs = lp->coalesce_usec_rx;
+	ecoalesce->tx_max_coalesced_frames = lp->coalesce_count_tx;
+	ecoalesce->tx_coalesce_usecs = lp->coalesce_usec_tx;
+	ecoalesce->use_adaptive_rx_coalesce = lp->dq[0]->rx_dim_enabled;
 
-		regval = axienet_dma_in32(q, XAXIDMA_RX_CR_OFFSET);
-		ecoalesce->rx_max_coalesced_frames +=
-						(regval & XAXIDMA_COALESCE_MASK)
-						     >> XAXIDMA_COALESCE_SHIFT;
-		ecoalesce->rx_coalesce_usecs = lp->coalesce_usec_rx;
+	return 0;
+}
+
+/**
+ * axienet_set_queue_coalesce - Apply ethtool coalescing to one DMA queue
+ * @lp:		Pointer to the axienet_local structure
+ * @i:		Index of the DMA queue
+ * @ecoalesce:	Pointer to ethtool_coalesce structure
+ *
+ * Zero frame and usec values leave the current setting alone. While
+ * adaptive Rx moderation is enabled the Rx fields are chosen by DIM and
+ * the static ones only take effect once it is turned off again.
+ */
+static void axienet_set_queue_coalesce(struct axienet_local *lp, int i,
+				       struct ethtool_coalesce *ecoalesce)
+{
+	struct axienet_dma_q *q = lp->dq[i];
+
+	if (i < lp->num_rx_queues) {
+		if (ecoalesce->rx_max_coalesced_frames)
+			q->coalesce_count_rx =
+				ecoalesce->rx_max_coalesced_frames;
+		if (ecoalesce->rx_coalesce_usecs)
+			q->coalesce_usec_rx = ecoalesce->rx_coalesce_usecs;
+
+		if (ecoalesce->use_adaptive_rx_coalesce && !q->rx_dim_enabled) {
+			q->rx_dim_enabled = true;
+		} else if (!ecoalesce->use_adaptive_rx_coalesce) {
+			q->rx_dim_enabled = false;
+			cancel_work_sync(&q->rx_dim.work);
+			axienet_update_rx_coalesce(q, q->coalesce_count_rx,
+						   q->coalesce_usec_rx);
+		}
 	}
-	for_each_tx_dma_queue(lp, i) {
-		q = lp->dq[i];
-		regval = axienet_dma_in32(q, XAXIDMA_TX_CR_OFFSET);
-		ecoalesce->tx_max_coalesced_frames +=
-						(regval & XAXIDMA_COALESCE_MASK)
-						     >> XAXIDMA_COALESCE_SHIFT;
-		ecoalesce->tx_coalesce_usecs = lp->coalesce_usec_tx;
+
+	if (i < lp->num_tx_queues) {
+		if (ecoalesce->tx_max_coalesced_frames)
+			q->coalesce_count_tx =
+				ecoalesce->tx_max_coalesced_frames;
+		if (ecoalesce->tx_coalesce_usecs)
+			q->coalesce_usec_tx = ecoalesce->tx_coalesce_usecs;
+		axienet_update_tx_coalesce(q);
 	}
-	return 0;
 }
 
 /**
@@ -2491,10 +3741,11 @@ axienet_ethtools_get_coalesce(struct net_device *ndev,
  * @extack:	extack for reporting error messages
  *
  * This implements ethtool command for setting the DMA interrupt coalescing
- * count on Tx and Rx paths. Issue "ethtool -C ethX rx-frames 5" under linux
- * prompt to execute this function.
+ * count on Tx and Rx paths of every queue. Issue "ethtool -C ethX rx-frames 5"
+ * or "ethtool -C ethX adaptive-rx on" under linux prompt to execute this
+ * function. The new values are applied to a running interface.
  *
- * Return: 0, on success, Non-zero error value on failure.
+ * Return: 0 always
  */
 static int
 axienet_ethtools_set_coalesce(struct net_device *ndev,
@@ -2503,12 +3754,7 @@ axienet_ethtools_set_coalesce(struct net_device *ndev,
 			      struct netlink_ext_ack *extack)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
-
-	if (netif_running(ndev)) {
-		netdev_err(ndev,
-			   "Please stop netif before applying configuration\n");
-		return -EFAULT;
-	}
+	int i;
 
 	if (ecoalesce->rx_max_coalesced_frames)
 		lp->coalesce_count_rx = ecoalesce->rx_max_coalesced_frames;
@@ -2519,6 +3765,69 @@ axienet_ethtools_set_coalesce(struct net_device *ndev,
 	if (ecoalesce->tx_coalesce_usecs)
 		lp->coalesce_usec_tx = ecoalesce->tx_coalesce_usecs;
 
+	for (i = 0; i < max(lp->num_tx_queues, lp->num_rx_queues); i++)
+		axienet_set_queue_coalesce(lp, i, ecoalesce);
+
+	return 0;
+}
+
+/**
+ * axienet_ethtools_get_per_queue_coalesce - Get coalescing of one queue
+ * @ndev:	Pointer to net_device structure
+ * @queue:	Index of the DMA queue
+ * @ecoalesce:	Pointer to ethtool_coalesce structure
+ *
+ * Issue "ethtool --per-queue ethX queue_mask 0x1 --show-coalesce" under
+ * linux prompt to execute this function.
+ *
+ * Return: 0, on success. -EINVAL for an invalid queue index.
+ */
+static int
+axienet_ethtools_get_per_queue_coalesce(struct net_device *ndev, u32 queue,
+					struct ethtool_coalesce *ecoalesce)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+
+	if (queue >= max(lp->num_tx_queues, lp->num_rx_queues))
+		return -EINVAL;
+
+	q = lp->dq[queue];
+	if (queue < lp->num_rx_queues) {
+		ecoalesce->rx_max_coalesced_frames = q->coalesce_count_rx;
+		ecoalesce->rx_coalesce_usecs = q->coalesce_usec_rx;
+		ecoalesce->use_adaptive_rx_coalesce = q->rx_dim_enabled;
+	}
+	if (queue < lp->num_tx_queues) {
+		ecoalesce->tx_max_coalesced_frames = q->coalesce_count_tx;
+		ecoalesce->tx_coalesce_usecs = q->coalesce_usec_tx;
+	}
+
+	return 0;
+}
+
+/**
+ * axienet_ethtools_set_per_queue_coalesce - Set coalescing of one queue
+ * @ndev:	Pointer to net_device structure
+ * @queue:	Index of the DMA queue
+ * @ecoalesce:	Pointer to ethtool_coalesce structure
+ *
+ * Issue "ethtool --per-queue ethX queue_mask 0x1 --coalesce rx-frames 5"
+ * under linux prompt to execute this function.
+ *
+ * Return: 0, on success. -EINVAL for an invalid queue index.
+ */
+static int
+axienet_ethtools_set_per_queue_coalesce(struct net_device *ndev, u32 queue,
+					struct ethtool_coalesce *ecoalesce)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (queue >= max(lp->num_tx_queues, lp->num_rx_queues))
+		return -EINVAL;
+
+	axienet_set_queue_coalesce(lp, queue, ecoalesce);
+
 	return 0;
 }
 
@@ -2580,6 +3889,37 @@ static int axienet_ethtools_get_ts_info(struct net_device *ndev,
 }
 #endif
 
+/**
+ * axienet_qstats_offset - Index of the first per queue counter in ethtool -S
+ * @ndev:	Pointer to net_device structure
+ *
+ * Return: Number of device wide (and MCDMA channel) statistics before it.
+ */
+static int axienet_qstats_offset(struct net_device *ndev)
+{
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	return axienet_sset_count(ndev, ETH_SS_STATS);
+#else
+	return AXIENET_ETHTOOLS_SSTATS_LEN;
+#endif
+}
+
+/**
+ * axienet_queue_stat_id - Queue number used in per queue statistic names
+ * @lp:		Pointer to the axienet_local structure
+ * @i:		Index of the DMA queue
+ *
+ * Return: The MCDMA channel number counted from zero, or @i for AXI DMA.
+ */
+static int axienet_queue_stat_id(struct axienet_local *lp, int i)
+{
+#ifdef CONFIG_AXIENET_HAS_MCDMA
+	return lp->dq[i]->chan_id - 1;
+#else
+	return i;
+#endif
+}
+
 /**
  * axienet_ethtools_sset_count - Get number of strings that
  *				 get_strings will write.
@@ -2591,13 +3931,12 @@ static int axienet_ethtools_get_ts_info(struct net_device *ndev,
  */
 int axienet_ethtools_sset_count(struct net_device *ndev, int sset)
 {
+	struct axienet_local *lp = netdev_priv(ndev);
+
 	switch (sset) {
 	case ETH_SS_STATS:
-#ifdef CONFIG_AXIENET_HAS_MCDMA
-		return axienet_sset_count(ndev, sset);
-#else
-		return AXIENET_ETHTOOLS_SSTATS_LEN;
-#endif
+		return axienet_qstats_offset(ndev) + AXIENET_TX_QSTATS_LEN(lp) +
+		       AXIENET_RX_QSTATS_LEN(lp);
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -2616,7 +3955,10 @@ void axienet_ethtools_get_stats(struct net_device *ndev,
 				struct ethtool_stats *stats,
 				u64 *data)
 {
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
 	unsigned int i = 0;
+	int j, k;
 
 	data[i++] = ndev->stats.tx_packets;
 	data[i++] = ndev->stats.rx_packets;
@@ -2628,6 +3970,20 @@ void axienet_ethtools_get_stats(struct net_device *ndev,
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	axienet_get_stats(ndev, stats, data);
 #endif
+
+	i = axienet_qstats_offset(ndev);
+	for_each_tx_dma_queue(lp, j) {
+		q = lp->dq[j];
+		for (k = 0; k < ARRAY_SIZE(axienet_tx_queue_stats); k++)
+			data[i++] = *(unsigned long *)((u8 *)q +
+				axienet_tx_queue_stats[k].offset);
+	}
+	for_each_rx_dma_queue(lp, j) {
+		q = lp->dq[j];
+		for (k = 0; k < ARRAY_SIZE(axienet_rx_queue_stats); k++)
+			data[i++] = *(unsigned long *)((u8 *)q +
+				axienet_rx_queue_stats[k].offset);
+	}
 }
 
 /**
@@ -2641,7 +3997,8 @@ void axienet_ethtools_get_stats(struct net_device *ndev,
  */
 void axienet_ethtools_strings(struct net_device *ndev, u32 sset, u8 *data)
 {
-	int i;
+	struct axienet_local *lp = netdev_priv(ndev);
+	int i, j;
 
 	for (i = 0; i < AXIENET_ETHTOOLS_SSTATS_LEN; i++) {
 		if (sset == ETH_SS_STATS)
@@ -2652,21 +4009,147 @@ void axienet_ethtools_strings(struct net_device *ndev, u32 sset, u8 *data)
 #ifdef CONFIG_AXIENET_HAS_MCDMA
 	axienet_strings(ndev, sset, data);
 #endif
+	if (sset != ETH_SS_STATS)
+		return;
+
+	data += axienet_qstats_offset(ndev) * ETH_GSTRING_LEN;
+	for_each_tx_dma_queue(lp, i) {
+		for (j = 0; j < ARRAY_SIZE(axienet_tx_queue_stats); j++) {
+			snprintf(data, ETH_GSTRING_LEN, "txq%d_%s",
+				 axienet_queue_stat_id(lp, i),
+				 axienet_tx_queue_stats[j].name);
+			data += ETH_GSTRING_LEN;
+		}
+	}
+	for_each_rx_dma_queue(lp, i) {
+		for (j = 0; j < ARRAY_SIZE(axienet_rx_queue_stats); j++) {
+			snprintf(data, ETH_GSTRING_LEN, "rxq%d_%s",
+				 axienet_queue_stat_id(lp, i),
+				 axienet_rx_queue_stats[j].name);
+			data += ETH_GSTRING_LEN;
+		}
+	}
+}
+
+/**
+ * axienet_ethtools_get_channels - Get the number of DMA queues
+ * @ndev:	Pointer to net_device structure
+ * @ch:		Pointer to ethtool_channels structure
+ *
+ * Each DMA queue pairs a Tx and an Rx channel behind one NAPI context, so
+ * they are reported as combined channels. Issue "ethtool -l ethX" under
+ * linux prompt to execute this function.
+ */
+static void axienet_ethtools_get_channels(struct net_device *ndev,
+					  struct ethtool_channels *ch)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	ch->max_combined = lp->num_rx_queues;
+	ch->combined_count = lp->num_rx_queues;
+}
+
+/**
+ * axienet_ethtools_get_rxnfc - Get Rx flow classification information
+ * @ndev:	Pointer to net_device structure
+ * @cmd:	Pointer to ethtool_rxnfc structure
+ * @rule_locs:	Rule locations, unused
+ *
+ * Only the number of Rx rings is reported. Frames are steered to the
+ * MCDMA S2MM channels by the TDEST assigned in the FPGA design, which
+ * offers no classifier or indirection table to program.
+ *
+ * Return: 0, on success. -EOPNOTSUPP for any other command.
+ */
+static int axienet_ethtools_get_rxnfc(struct net_device *ndev,
+				      struct ethtool_rxnfc *cmd,
+				      u32 *rule_locs)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	switch (cmd->cmd) {
+	case ETHTOOL_GRXRINGS:
+		cmd->data = lp->num_rx_queues;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * axienet_ethtools_get_tunable - Get a driver tunable
+ * @ndev:	Pointer to net_device structure
+ * @tuna:	Tunable to get
+ * @data:	Value of the tunable
+ *
+ * Return: 0, on success. -EOPNOTSUPP for an unknown tunable.
+ */
+static int axienet_ethtools_get_tunable(struct net_device *ndev,
+					const struct ethtool_tunable *tuna,
+					void *data)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		*(u32 *)data = lp->rx_copybreak;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * axienet_ethtools_set_tunable - Set a driver tunable
+ * @ndev:	Pointer to net_device structure
+ * @tuna:	Tunable to set
+ * @data:	New value of the tunable
+ *
+ * Issue "ethtool --set-tunable ethX rx-copybreak 128" under linux prompt to
+ * execute this function. The new threshold applies from the next NAPI poll.
+ *
+ * Return: 0, on success. -EINVAL for an out of range value, -EOPNOTSUPP
+ * for an unknown tunable.
+ */
+static int axienet_ethtools_set_tunable(struct net_device *ndev,
+					const struct ethtool_tunable *tuna,
+					const void *data)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	u32 val;
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		val = *(const u32 *)data;
+		if (val > XAE_RX_COPYBREAK_MAX)
+			return -EINVAL;
+		WRITE_ONCE(lp->rx_copybreak, val);
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
 static const struct ethtool_ops axienet_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_MAX_FRAMES |
-				     ETHTOOL_COALESCE_USECS,
+				     ETHTOOL_COALESCE_USECS |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.get_drvinfo    = axienet_ethtools_get_drvinfo,
 	.get_regs_len   = axienet_ethtools_get_regs_len,
 	.get_regs       = axienet_ethtools_get_regs,
 	.get_link       = ethtool_op_get_link,
 	.get_ringparam	= axienet_ethtools_get_ringparam,
 	.set_ringparam	= axienet_ethtools_set_ringparam,
+	.get_channels	= axienet_ethtools_get_channels,
+	.get_rxnfc	= axienet_ethtools_get_rxnfc,
+	.get_tunable	= axienet_ethtools_get_tunable,
+	.set_tunable	= axienet_ethtools_set_tunable,
 	.get_pauseparam = axienet_ethtools_get_pauseparam,
 	.set_pauseparam = axienet_ethtools_set_pauseparam,
 	.get_coalesce   = axienet_ethtools_get_coalesce,
 	.set_coalesce   = axienet_ethtools_set_coalesce,
+	.get_per_queue_coalesce = axienet_ethtools_get_per_queue_coalesce,
+	.set_per_queue_coalesce = axienet_ethtools_set_per_queue_coalesce,
 #ifdef CONFIG_XILINX_AXI_EMAC_HWTSTAMP
 	.get_ts_info    = axienet_ethtools_get_ts_info,
 #endif
@@ -2698,6 +4181,7 @@ static int __maybe_unused axienet_mcdma_probe(struct platform_device *pdev,
 
 		/* parent */
 		q->lp = lp;
+		q->txq = netdev_get_tx_queue(ndev, i);
 		lp->dq[i] = q;
 		ret = of_property_read_string_index(pdev->dev.of_node,
 						    "xlnx,channel-ids", i,
@@ -2757,6 +4241,7 @@ static int __maybe_unused axienet_dma_probe(struct platform_device *pdev,
 
 		/* parent */
 		q->lp = lp;
+		q->txq = netdev_get_tx_queue(ndev, i);
 
 		lp->dq[i] = q;
 	}
@@ -3667,6 +5152,8 @@ static int axienet_probe(struct platform_device *pdev)
 	lp->coalesce_usec_rx = XAXIDMA_DFT_RX_USEC;
 	lp->coalesce_count_tx = XAXIDMA_DFT_TX_THRESHOLD;
 	lp->coalesce_usec_tx = XAXIDMA_DFT_TX_USEC;
+	lp->rx_copybreak = XAE_RX_COPYBREAK_DEFAULT;
+	axienet_dma_q_coalesce_init(lp);
 
 	if (lp->phy_mode == PHY_INTERFACE_MODE_SGMII ||
 	    lp->phy_mode == PHY_INTERFACE_MODE_1000BASEX) {
@@ -3698,7 +5185,9 @@ static int axienet_probe(struct platform_device *pdev)
 		}
 		of_node_put(np);
 		lp->pcs.ops = &axienet_pcs_ops;
-		lp->pcs.poll = true;
+		/* The link changes of the PCS raise the core interrupt */
+		lp->pcs_irq = lp->mdio_irq;
+		lp->pcs.poll = !lp->pcs_irq;
 	}
 
 	lp->phylink_config.dev = &ndev->dev;
@@ -20,6 +20,7 @@
 #include <linux/of_irq.h>
 #include <linux/of_address.h>
 #include <linux/of_net.h>
+#include <net/xdp_sock_drv.h>
 
 #include "xilinx_axienet.h"
 
@@ -97,6 +98,107 @@ static struct axienet_stat axienet_get_rx_strings_stats[] = {
 	{ "rxq15_bytes"   },
 };
 
+/**
+ * axienet_mcdma_xsk_tx_release - Complete AF_XDP descriptors still queued
+ * @q:		Pointer to DMA queue structure
+ *
+ * Used when the Tx channel is torn down with AF_XDP descriptors between
+ * tx_bd_ci and tx_bd_tail, so that user space gets its UMEM frames back.
+ */
+static void axienet_mcdma_xsk_tx_release(struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = q->lp;
+	u32 i, frames = 0;
+
+	if (!q->xsk_pool || !q->txq_bd_v)
+		return;
+
+	for (i = q->tx_bd_ci; i != q->tx_bd_tail; i = (i + 1) % lp->tx_bd_num) {
+		if (q->txq_bd_v[i].tx_desc_mapping == DESC_DMA_MAP_XSK)
+			frames++;
+	}
+
+	if (frames)
+		xsk_tx_completed(q->xsk_pool, frames);
+}
+
+/**
+ * axienet_mcdma_xsk_rx_release - Return AF_XDP buffers held by the Rx ring
+ * @q:		Pointer to DMA queue structure
+ */
+static void axienet_mcdma_xsk_rx_release(struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = q->lp;
+	int i;
+
+	for (i = 0; i < lp->rx_bd_num; i++) {
+		struct xdp_buff *xdp;
+
+		xdp = (struct xdp_buff *)q->rxq_bd_v[i].sw_id_offset;
+		if (xdp)
+			xsk_buff_free(xdp);
+		q->rxq_bd_v[i].sw_id_offset = 0;
+	}
+
+	q->rx_bd_tail = 0;
+	q->rx_bd_unused = lp->rx_bd_num;
+}
+
+/**
+ * axienet_xsk_rx_refill - Give AF_XDP fill ring buffers to empty Rx BDs
+ * @q:		Pointer to DMA queue structure
+ *
+ * Return: 0, if all Rx BDs have a buffer. -ENOMEM, if the fill ring ran
+ * dry, in which case user space is asked for a wakeup.
+ *
+ * In zero-copy mode Rx BDs are only handed to the S2MM channel once they
+ * have a UMEM buffer. The BDs from rx_bd_ci up to rx_bd_tail are owned by
+ * the hardware and the tail pointer always points at the last of them.
+ */
+int axienet_xsk_rx_refill(struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = q->lp;
+	struct aximcdma_bd *cur_p;
+	dma_addr_t tail_p = 0;
+	struct xdp_buff *xdp;
+	int ret = 0;
+
+	while (q->rx_bd_unused) {
+		xdp = xsk_buff_alloc(q->xsk_pool);
+		if (!xdp) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		cur_p = &q->rxq_bd_v[q->rx_bd_tail];
+		cur_p->phys = xsk_buff_xdp_get_dma(xdp);
+		cur_p->cntrl = lp->max_frm_size;
+		cur_p->status = 0;
+		cur_p->sw_id_offset = (phys_addr_t)xdp;
+
+		tail_p = q->rx_bd_p + sizeof(*q->rxq_bd_v) * q->rx_bd_tail;
+		if (++q->rx_bd_tail >= lp->rx_bd_num)
+			q->rx_bd_tail = 0;
+		q->rx_bd_unused--;
+	}
+
+	if (tail_p) {
+		/* Ensure BD writes before handing them to the channel */
+		wmb();
+		axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id) +
+				  q->rx_offset, tail_p);
+	}
+
+	if (xsk_uses_need_wakeup(q->xsk_pool)) {
+		if (ret)
+			xsk_set_rx_need_wakeup(q->xsk_pool);
+		else
+			xsk_clear_rx_need_wakeup(q->xsk_pool);
+	}
+
+	return ret;
+}
+
 /**
  * axienet_mcdma_tx_bd_free - Release MCDMA Tx buffer descriptor rings
  * @ndev:	Pointer to the net_device structure
@@ -109,6 +211,25 @@ void __maybe_unused axienet_mcdma_tx_bd_free(struct net_device *ndev,
 					     struct axienet_dma_q *q)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
+	struct aximcdma_bd *cur_p;
+	int i;
+
+	axienet_mcdma_xsk_tx_release(q);
+
+	for (i = 0; q->txq_bd_v && i < lp->tx_bd_num; i++) {
+		cur_p = &q->txq_bd_v[i];
+		if (!cur_p->xdpf)
+			continue;
+
+		/* Give XDP frames still in flight back to their owner */
+		if (cur_p->tx_desc_mapping == DESC_DMA_MAP_SINGLE)
+			dma_unmap_single(ndev->dev.parent, cur_p->phys,
+					 cur_p->cntrl &
+					 XAXIDMA_BD_CTRL_LENGTH_MASK,
+					 DMA_TO_DEVICE);
+		xdp_return_frame(cur_p->xdpf);
+		cur_p->xdpf = NULL;
+	}
 
 	if (q->txq_bd_v) {
 		dma_free_coherent(ndev->dev.parent,
@@ -141,13 +262,18 @@ void __maybe_unused axienet_mcdma_rx_bd_free(struct net_device *ndev,
 	if (!q->rxq_bd_v)
 		return;
 
+	if (q->xsk_pool)
+		axienet_mcdma_xsk_rx_release(q);
+
 	for (i = 0; i < lp->rx_bd_num; i++) {
-		if (q->rxq_bd_v[i].phys)
-			dma_unmap_single(ndev->dev.parent, q->rxq_bd_v[i].phys,
-					 lp->max_frm_size, DMA_FROM_DEVICE);
-		dev_kfree_skb((struct sk_buff *)
-			      (q->rxq_bd_v[i].sw_id_offset));
+		struct page *page = (struct page *)q->rxq_bd_v[i].sw_id_offset;
+
+		/* The page pool owns the DMA mapping of Rx buffers */
+		if (page)
+			page_pool_put_full_page(q->page_pool, page, false);
+		q->rxq_bd_v[i].sw_id_offset = 0;
 	}
+	axienet_rx_pool_destroy(q);
 
 	dma_free_coherent(ndev->dev.parent,
 			  sizeof(*q->rxq_bd_v) * lp->rx_bd_num,
@@ -175,6 +301,7 @@ int __maybe_unused axienet_mcdma_tx_q_init(struct net_device *ndev,
 
 	q->tx_bd_ci = 0;
 	q->tx_bd_tail = 0;
+	netdev_tx_reset_queue(q->txq);
 
 	q->txq_bd_v = dma_alloc_coherent(ndev->dev.parent,
 					 sizeof(*q->txq_bd_v) * lp->tx_bd_num,
@@ -200,17 +327,14 @@ int __maybe_unused axienet_mcdma_tx_q_init(struct net_device *ndev,
 				      ((i + 1) % lp->tx_bd_num);
 	}
 
+	q->tx_coalesce = axienet_coalesce_bits(lp, q->coalesce_count_tx,
+					       q->coalesce_usec_tx);
+
 	/* Start updating the Tx channel control register */
 	cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id));
-	/* Update the interrupt coalesce count */
-	cr = (((cr & ~XMCDMA_COALESCE_MASK)) |
-	      ((lp->coalesce_count_tx) << XMCDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first TX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_tx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_tx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XMCDMA_COALESCE_MASK | XMCDMA_DELAY_MASK)) |
+	     q->tx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XMCDMA_IRQ_ALL_MASK;
 	/* Write to the Tx channel control register */
@@ -255,7 +379,7 @@ int __maybe_unused axienet_mcdma_rx_q_init(struct net_device *ndev,
 {
 	u32 cr, chan_en;
 	int i;
-	struct sk_buff *skb;
+	struct page *page;
 	struct axienet_local *lp = netdev_priv(ndev);
 	dma_addr_t mapping;
 
@@ -268,46 +392,36 @@ int __maybe_unused axienet_mcdma_rx_q_init(struct net_device *ndev,
 	if (!q->rxq_bd_v)
 		goto out;
 
+	if (axienet_rx_pool_create(ndev, q))
+		goto out;
+
 	for (i = 0; i < lp->rx_bd_num; i++) {
 		q->rxq_bd_v[i].next = q->rx_bd_p +
 				      sizeof(*q->rxq_bd_v) *
 				      ((i + 1) % lp->rx_bd_num);
 
-		skb = netdev_alloc_skb(ndev, lp->max_frm_size);
-		if (!skb)
-			goto out;
+		/* Zero-copy buffers are attached by axienet_xsk_rx_refill */
+		if (q->xsk_pool)
+			continue;
 
-		/* Ensure that the skb is completely updated
-		 * prio to mapping the DMA
-		 */
-		wmb();
-
-		q->rxq_bd_v[i].sw_id_offset = (phys_addr_t)skb;
-		mapping = dma_map_single(ndev->dev.parent,
-					 skb->data,
-					 lp->max_frm_size,
-					 DMA_FROM_DEVICE);
-		if (unlikely(dma_mapping_error(ndev->dev.parent, mapping))) {
-			dev_err(&ndev->dev, "mcdma map error\n");
+		page = axienet_rx_page_alloc(q, &mapping);
+		if (!page)
 			goto out;
-		}
 
+		q->rxq_bd_v[i].sw_id_offset = (phys_addr_t)page;
 		q->rxq_bd_v[i].phys = mapping;
 		q->rxq_bd_v[i].cntrl = lp->max_frm_size;
 	}
 
+	q->rx_coalesce = axienet_coalesce_bits(lp, q->coalesce_count_rx,
+					       q->coalesce_usec_rx);
+
 	/* Start updating the Rx channel control register */
 	cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id) +
 			      q->rx_offset);
-	/* Update the interrupt coalesce count */
-	cr = ((cr & ~XMCDMA_COALESCE_MASK) |
-	      ((lp->coalesce_count_rx) << XMCDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first RX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_rx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_rx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XMCDMA_COALESCE_MASK | XMCDMA_DELAY_MASK)) |
+	     q->rx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XMCDMA_IRQ_ALL_MASK;
 	/* Write to the Rx channel control register */
@@ -326,9 +440,15 @@ int __maybe_unused axienet_mcdma_rx_q_init(struct net_device *ndev,
 				q->rx_offset);
 	axienet_dma_out32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id) + q->rx_offset,
 			  cr | XMCDMA_CR_RUNSTOP_MASK);
-	axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id) +
-			    q->rx_offset, q->rx_bd_p + (sizeof(*q->rxq_bd_v) *
-			    (lp->rx_bd_num - 1)));
+	if (q->xsk_pool) {
+		q->rx_bd_tail = 0;
+		q->rx_bd_unused = lp->rx_bd_num;
+		axienet_xsk_rx_refill(q);
+	} else {
+		axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id) +
+				  q->rx_offset, q->rx_bd_p +
+				  (sizeof(*q->rxq_bd_v) * (lp->rx_bd_num - 1)));
+	}
 	chan_en = axienet_dma_in32(q, XMCDMA_CHEN_OFFSET + q->rx_offset);
 	chan_en |= (1 << (q->chan_id - 1));
 	axienet_dma_out32(q, XMCDMA_CHEN_OFFSET + q->rx_offset, chan_en);
@@ -366,6 +486,31 @@ static inline int get_mcdma_rx_q(struct axienet_local *lp, u32 chan_id)
 	return -ENODEV;
 }
 
+/**
+ * axienet_mcdma_irq_to_q - Find the queue owning a dedicated channel IRQ
+ * @lp:		Pointer to the axienet_local structure
+ * @irq:	IRQ number
+ * @tx:		Look @irq up among the Tx (MM2S) instead of the Rx IRQs
+ *
+ * Return: Index of the queue, or -ENODEV if @irq is not dedicated to one
+ * channel, in which case the interrupt serviced register has to be read.
+ */
+static inline int axienet_mcdma_irq_to_q(struct axienet_local *lp, int irq,
+					 bool tx)
+{
+	int i, qnum = -ENODEV;
+
+	for_each_rx_dma_queue(lp, i) {
+		if ((tx ? lp->dq[i]->tx_irq : lp->dq[i]->rx_irq) != irq)
+			continue;
+		if (qnum >= 0)
+			return -ENODEV;
+		qnum = i;
+	}
+
+	return qnum;
+}
+
 static inline int map_dma_q_txirq(int irq, struct axienet_local *lp)
 {
 	int i, chan_sermask;
@@ -389,19 +534,28 @@ irqreturn_t __maybe_unused axienet_mcdma_tx_irq(int irq, void *_ndev)
 	unsigned int status;
 	struct net_device *ndev = _ndev;
 	struct axienet_local *lp = netdev_priv(ndev);
-	int i, j = map_dma_q_txirq(irq, lp);
+	int i = axienet_mcdma_irq_to_q(lp, irq, true), j;
 	struct axienet_dma_q *q;
 
-	if (j < 0)
-		return IRQ_NONE;
+	if (i < 0) {
+		j = map_dma_q_txirq(irq, lp);
+		if (j < 0)
+			return IRQ_NONE;
 
-	i = get_mcdma_tx_q(lp, j);
+		i = get_mcdma_tx_q(lp, j);
+	}
 	q = lp->dq[i];
 
 	status = axienet_dma_in32(q, XMCDMA_CHAN_SR_OFFSET(q->chan_id));
 	if (status & (XMCDMA_IRQ_IOC_MASK | XMCDMA_IRQ_DELAY_MASK)) {
 		axienet_dma_out32(q, XMCDMA_CHAN_SR_OFFSET(q->chan_id), status);
-		axienet_start_xmit_done(lp->ndev, q);
+		/* Tx BDs are reaped by the queue NAPI */
+		spin_lock(&q->tx_lock);
+		cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id));
+		cr &= ~(XMCDMA_IRQ_IOC_MASK | XMCDMA_IRQ_DELAY_MASK);
+		axienet_dma_out32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id), cr);
+		spin_unlock(&q->tx_lock);
+		napi_schedule(&lp->napi[i]);
 		goto out;
 	}
 	if (!(status & XMCDMA_IRQ_ALL_MASK))
@@ -457,13 +611,16 @@ irqreturn_t __maybe_unused axienet_mcdma_rx_irq(int irq, void *_ndev)
 	unsigned int status;
 	struct net_device *ndev = _ndev;
 	struct axienet_local *lp = netdev_priv(ndev);
-	int i, j = map_dma_q_rxirq(irq, lp);
+	int i = axienet_mcdma_irq_to_q(lp, irq, false), j;
 	struct axienet_dma_q *q;
 
-	if (j < 0)
-		return IRQ_NONE;
+	if (i < 0) {
+		j = map_dma_q_rxirq(irq, lp);
+		if (j < 0)
+			return IRQ_NONE;
 
-	i = get_mcdma_rx_q(lp, j);
+		i = get_mcdma_rx_q(lp, j);
+	}
 	q = lp->dq[i];
 
 	status = axienet_dma_in32(q, XMCDMA_CHAN_SR_OFFSET(q->chan_id) +
@@ -615,15 +772,21 @@ void __maybe_unused axienet_mcdma_err_handler(unsigned long data)
 	__axienet_device_reset(q);
 	axienet_unlock_mii(lp);
 
+	axienet_mcdma_xsk_tx_release(q);
+
 	for (i = 0; i < lp->tx_bd_num; i++) {
 		cur_p = &q->txq_bd_v[i];
-		if (cur_p->phys)
+		if (cur_p->phys &&
+		    cur_p->tx_desc_mapping != DESC_DMA_MAP_NONE &&
+		    cur_p->tx_desc_mapping != DESC_DMA_MAP_XSK)
 			dma_unmap_single(ndev->dev.parent, cur_p->phys,
 					 (cur_p->cntrl &
 					  XAXIDMA_BD_CTRL_LENGTH_MASK),
 					 DMA_TO_DEVICE);
 		if (cur_p->tx_skb)
 			dev_kfree_skb_irq((struct sk_buff *)cur_p->tx_skb);
+		if (cur_p->xdpf)
+			xdp_return_frame(cur_p->xdpf);
 		cur_p->phys = 0;
 		cur_p->cntrl = 0;
 		cur_p->status = 0;
@@ -634,6 +797,7 @@ void __maybe_unused axienet_mcdma_err_handler(unsigned long data)
 		cur_p->app4 = 0;
 		cur_p->sw_id_offset = 0;
 		cur_p->tx_skb = 0;
+		cur_p->xdpf = NULL;
 	}
 
 	for (i = 0; i < lp->rx_bd_num; i++) {
@@ -646,22 +810,21 @@ void __maybe_unused axienet_mcdma_err_handler(unsigned long data)
 		cur_p->app4 = 0;
 	}
 
+	/* Zero-copy Rx BDs are refilled from the fill ring below */
+	if (q->xsk_pool)
+		axienet_mcdma_xsk_rx_release(q);
+
 	q->tx_bd_ci = 0;
 	q->tx_bd_tail = 0;
+	netdev_tx_reset_queue(q->txq);
 	q->rx_bd_ci = 0;
 
 	/* Start updating the Rx channel control register */
 	cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id) +
 			      q->rx_offset);
-	/* Update the interrupt coalesce count */
-	cr = ((cr & ~XMCDMA_COALESCE_MASK) |
-	      ((lp->coalesce_count_rx) << XMCDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first RX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_rx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_rx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XMCDMA_COALESCE_MASK | XMCDMA_DELAY_MASK)) |
+	     q->rx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XMCDMA_IRQ_ALL_MASK;
 	/* Write to the Rx channel control register */
@@ -670,15 +833,9 @@ void __maybe_unused axienet_mcdma_err_handler(unsigned long data)
 
 	/* Start updating the Tx channel control register */
 	cr = axienet_dma_in32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id));
-	/* Update the interrupt coalesce count */
-	cr = (((cr & ~XMCDMA_COALESCE_MASK)) |
-	      ((lp->coalesce_count_tx) << XMCDMA_COALESCE_SHIFT));
-	/* Only set interrupt delay timer if not generating an interrupt on
-	 * the first TX packet. Otherwise leave at 0 to disable delay interrupt.
-	 */
-	if (lp->coalesce_count_tx > 1)
-		cr |= (axienet_usec_to_timer(lp, lp->coalesce_usec_tx)
-		       << XAXIDMA_DELAY_SHIFT) | XAXIDMA_IRQ_DELAY_MASK;
+	/* Update the interrupt coalesce count and delay timer */
+	cr = (cr & ~(XMCDMA_COALESCE_MASK | XMCDMA_DELAY_MASK)) |
+	     q->tx_coalesce;
 	/* Enable coalesce, delay timer and error interrupts */
 	cr |= XMCDMA_IRQ_ALL_MASK;
 	/* Write to the Tx channel control register */
@@ -696,9 +853,12 @@ void __maybe_unused axienet_mcdma_err_handler(unsigned long data)
 				q->rx_offset);
 	axienet_dma_out32(q, XMCDMA_CHAN_CR_OFFSET(q->chan_id) + q->rx_offset,
 			  cr | XMCDMA_CR_RUNSTOP_MASK);
-	axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id) +
-			    q->rx_offset, q->rx_bd_p + (sizeof(*q->rxq_bd_v) *
-			    (lp->rx_bd_num - 1)));
+	if (q->xsk_pool)
+		axienet_xsk_rx_refill(q);
+	else
+		axienet_dma_bdout(q, XMCDMA_CHAN_TAILDESC_OFFSET(q->chan_id) +
+				  q->rx_offset, q->rx_bd_p +
+				  (sizeof(*q->rxq_bd_v) * (lp->rx_bd_num - 1)));
 	chan_en = axienet_dma_in32(q, XMCDMA_CHEN_OFFSET + q->rx_offset);
 	chan_en |= (1 << (q->chan_id - 1));
 	axienet_dma_out32(q, XMCDMA_CHEN_OFFSET + q->rx_offset, chan_en);
@@ -30,6 +30,46 @@ static int axienet_mdio_wait_until_ready(struct axienet_local *lp)
 				  1, 20000);
 }
 
+/* Start a transaction, the MCR value holds the operation and the addresses */
+static void axienet_mdio_initiate(struct axienet_local *lp, u32 mcr)
+{
+	if (lp->mdio_irq) {
+		reinit_completion(&lp->mdio_done);
+		axienet_iow(lp, XAE_IS_OFFSET, XAE_INT_HARDACSCMPLT_MASK);
+	}
+
+	axienet_iow(lp, XAE_MDIO_MCR_OFFSET, mcr | XAE_MDIO_MCR_INITIATE_MASK);
+}
+
+/*
+ * Wait till the transaction started is complete, sleeping until the hard
+ * register access complete interrupt rather than spinning for the 30 us or
+ * so that a transaction takes at 2.5 MHz. The interrupt is disabled by the
+ * core resets, the ready bit is checked in any case.
+ */
+static int axienet_mdio_wait_done(struct axienet_local *lp)
+{
+	if (lp->mdio_irq &&
+	    axienet_ior(lp, XAE_IE_OFFSET) & XAE_INT_HARDACSCMPLT_MASK)
+		wait_for_completion_timeout(&lp->mdio_done,
+					    usecs_to_jiffies(20000));
+
+	return axienet_mdio_wait_until_ready(lp);
+}
+
+static irqreturn_t axienet_mdio_irq(int irq, void *data)
+{
+	struct axienet_local *lp = data;
+
+	if (!(axienet_ior(lp, XAE_IP_OFFSET) & XAE_INT_HARDACSCMPLT_MASK))
+		return IRQ_NONE;
+
+	axienet_iow(lp, XAE_IS_OFFSET, XAE_INT_HARDACSCMPLT_MASK);
+	complete(&lp->mdio_done);
+
+	return IRQ_HANDLED;
+}
+
 /* Enable the MDIO MDC. Called prior to a read/write operation */
 static void axienet_mdio_mdc_enable(struct axienet_local *lp)
 {
@@ -73,15 +113,13 @@ static int axienet_mdio_read(struct mii_bus *bus, int phy_id, int reg)
 		return ret;
 	}
 
-	axienet_iow(lp, XAE_MDIO_MCR_OFFSET,
-		    (((phy_id << XAE_MDIO_MCR_PHYAD_SHIFT) &
-		      XAE_MDIO_MCR_PHYAD_MASK) |
-		     ((reg << XAE_MDIO_MCR_REGAD_SHIFT) &
-		      XAE_MDIO_MCR_REGAD_MASK) |
-		     XAE_MDIO_MCR_INITIATE_MASK |
-		     XAE_MDIO_MCR_OP_READ_MASK));
+	axienet_mdio_initiate(lp, ((phy_id << XAE_MDIO_MCR_PHYAD_SHIFT) &
+				   XAE_MDIO_MCR_PHYAD_MASK) |
+			      ((reg << XAE_MDIO_MCR_REGAD_SHIFT) &
+			       XAE_MDIO_MCR_REGAD_MASK) |
+			      XAE_MDIO_MCR_OP_READ_MASK);
 
-	ret = axienet_mdio_wait_until_ready(lp);
+	ret = axienet_mdio_wait_done(lp);
 	if (ret < 0) {
 		axienet_mdio_mdc_disable(lp);
 		return ret;
@@ -127,15 +165,13 @@ static int axienet_mdio_write(struct mii_bus *bus, int phy_id, int reg,
 	}
 
 	axienet_iow(lp, XAE_MDIO_MWD_OFFSET, (u32)val);
-	axienet_iow(lp, XAE_MDIO_MCR_OFFSET,
-		    (((phy_id << XAE_MDIO_MCR_PHYAD_SHIFT) &
-		      XAE_MDIO_MCR_PHYAD_MASK) |
-		     ((reg << XAE_MDIO_MCR_REGAD_SHIFT) &
-		      XAE_MDIO_MCR_REGAD_MASK) |
-		     XAE_MDIO_MCR_INITIATE_MASK |
-		     XAE_MDIO_MCR_OP_WRITE_MASK));
+	axienet_mdio_initiate(lp, ((phy_id << XAE_MDIO_MCR_PHYAD_SHIFT) &
+				   XAE_MDIO_MCR_PHYAD_MASK) |
+			      ((reg << XAE_MDIO_MCR_REGAD_SHIFT) &
+			       XAE_MDIO_MCR_REGAD_MASK) |
+			      XAE_MDIO_MCR_OP_WRITE_MASK);
 
-	ret = axienet_mdio_wait_until_ready(lp);
+	ret = axienet_mdio_wait_done(lp);
 	if (ret < 0) {
 		axienet_mdio_mdc_disable(lp);
 		return ret;
@@ -237,6 +273,41 @@ void axienet_mdio_disable(struct axienet_local *lp)
 	axienet_iow(lp, XAE_MDIO_MC_OFFSET, 0);
 }
 
+/* Complete the transactions on the core interrupt, when there is one */
+static void axienet_mdio_irq_setup(struct axienet_local *lp)
+{
+	int ret;
+
+	init_completion(&lp->mdio_done);
+
+	if (lp->eth_irq <= 0 || lp->eth_hasnobuf ||
+	    lp->axienet_config->mactype != XAXIENET_1G)
+		return;
+
+	/* Shared with the core interrupt handler of the open netdev */
+	ret = request_irq(lp->eth_irq, axienet_mdio_irq, IRQF_SHARED,
+			  dev_name(lp->dev), lp);
+	if (ret) {
+		dev_warn(lp->dev, "MDIO interrupt not available: %d\n", ret);
+		return;
+	}
+
+	lp->mdio_irq = true;
+	axienet_iow(lp, XAE_IE_OFFSET, axienet_ior(lp, XAE_IE_OFFSET) |
+		    XAE_INT_HARDACSCMPLT_MASK);
+}
+
+static void axienet_mdio_irq_teardown(struct axienet_local *lp)
+{
+	if (!lp->mdio_irq)
+		return;
+
+	axienet_iow(lp, XAE_IE_OFFSET, axienet_ior(lp, XAE_IE_OFFSET) &
+		    ~XAE_INT_HARDACSCMPLT_MASK);
+	lp->mdio_irq = false;
+	free_irq(lp->eth_irq, lp);
+}
+
 /**
  * axienet_mdio_setup - MDIO setup function
  * @lp:		Pointer to axienet local data structure.
@@ -261,6 +332,8 @@ int axienet_mdio_setup(struct axienet_local *lp)
 	if (!bus)
 		return -ENOMEM;
 
+	axienet_mdio_irq_setup(lp);
+
 	snprintf(bus->id, MII_BUS_ID_SIZE, "axienet-%.8llx",
 		 (unsigned long long)lp->regs_start);
 
@@ -275,6 +348,7 @@ int axienet_mdio_setup(struct axienet_local *lp)
 	ret = of_mdiobus_register(bus, mdio_node);
 	of_node_put(mdio_node);
 	if (ret) {
+		axienet_mdio_irq_teardown(lp);
 		mdiobus_free(bus);
 		lp->mii_bus = NULL;
 		return ret;
@@ -292,6 +366,7 @@ int axienet_mdio_setup(struct axienet_local *lp)
 void axienet_mdio_teardown(struct axienet_local *lp)
 {
 	mdiobus_unregister(lp->mii_bus);
+	axienet_mdio_irq_teardown(lp);
 	mdiobus_free(lp->mii_bus);
 	lp->mii_bus = NULL;
 }
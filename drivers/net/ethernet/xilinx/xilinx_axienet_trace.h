@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for Xilinx Axi Ethernet device driver.
+ *
+ * Copyright (c) 2022 Advanced Micro Devices, Inc.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM axienet
+
+#if !defined(_XILINX_AXIENET_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _XILINX_AXIENET_TRACE_H
+
+#include <linux/netdevice.h>
+#include <linux/tracepoint.h>
+
+/*
+ * The life of the frames of a queue: queued on the Tx ring by the stack,
+ * handed to the DMA by the doorbell, reaped once sent, and processed from
+ * the Rx ring once received. The Tx events of a queue follow the ring order.
+ */
+DECLARE_EVENT_CLASS(axienet_queue,
+
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int bds, unsigned int bytes),
+
+	TP_ARGS(ndev, qid, bds, bytes),
+
+	TP_STRUCT__entry(
+		__string(name, ndev->name)
+		__field(unsigned int, qid)
+		__field(unsigned int, bds)
+		__field(unsigned int, bytes)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, ndev->name);
+		__entry->qid = qid;
+		__entry->bds = bds;
+		__entry->bytes = bytes;
+	),
+
+	TP_printk("dev=%s qid=%u bds=%u bytes=%u",
+		  __get_str(name), __entry->qid, __entry->bds, __entry->bytes)
+);
+
+DEFINE_EVENT(axienet_queue, axienet_tx_submit,
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int bds, unsigned int bytes),
+	TP_ARGS(ndev, qid, bds, bytes)
+);
+
+DEFINE_EVENT(axienet_queue, axienet_tx_reap,
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int bds, unsigned int bytes),
+	TP_ARGS(ndev, qid, bds, bytes)
+);
+
+DEFINE_EVENT(axienet_queue, axienet_rx_done,
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int bds, unsigned int bytes),
+	TP_ARGS(ndev, qid, bds, bytes)
+);
+
+DECLARE_EVENT_CLASS(axienet_ring,
+
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int ci, unsigned int tail),
+
+	TP_ARGS(ndev, qid, ci, tail),
+
+	TP_STRUCT__entry(
+		__string(name, ndev->name)
+		__field(unsigned int, qid)
+		__field(unsigned int, ci)
+		__field(unsigned int, tail)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, ndev->name);
+		__entry->qid = qid;
+		__entry->ci = ci;
+		__entry->tail = tail;
+	),
+
+	TP_printk("dev=%s qid=%u ci=%u tail=%u",
+		  __get_str(name), __entry->qid, __entry->ci, __entry->tail)
+);
+
+DEFINE_EVENT(axienet_ring, axienet_tx_ring_full,
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int ci, unsigned int tail),
+	TP_ARGS(ndev, qid, ci, tail)
+);
+
+DEFINE_EVENT(axienet_ring, axienet_tx_start,
+	TP_PROTO(struct net_device *ndev, unsigned int qid,
+		 unsigned int ci, unsigned int tail),
+	TP_ARGS(ndev, qid, ci, tail)
+);
+
+TRACE_EVENT(axienet_rx_alloc_fail,
+
+	TP_PROTO(struct net_device *ndev, unsigned int qid, bool skb),
+
+	TP_ARGS(ndev, qid, skb),
+
+	TP_STRUCT__entry(
+		__string(name, ndev->name)
+		__field(unsigned int, qid)
+		__field(bool, skb)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, ndev->name);
+		__entry->qid = qid;
+		__entry->skb = skb;
+	),
+
+	TP_printk("dev=%s qid=%u type=%s",
+		  __get_str(name), __entry->qid,
+		  __entry->skb ? "skb" : "page")
+);
+
+#endif /* _XILINX_AXIENET_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE xilinx_axienet_trace
+
+#include <trace/define_trace.h>
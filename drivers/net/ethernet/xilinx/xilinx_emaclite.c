@@ -115,6 +115,7 @@
  * @phy_node:		pointer to the PHY device node
  * @mii_bus:		pointer to the MII bus
  * @last_link:		last link status
+ * @napi:		NAPI context for Rx and Tx completion processing
  */
 struct net_local {
 	struct net_device *ndev;
@@ -134,6 +135,8 @@ struct net_local {
 	struct mii_bus *mii_bus;
 
 	int last_link;
+
+	struct napi_struct napi;
 };
 
 /*************************/
@@ -364,7 +367,7 @@ static int xemaclite_send_data(struct net_local *drvdata, u8 *data,
  * @data:	Address where the data is to be received
  * @maxlen:    Maximum supported ethernet packet length
  *
- * This function is intended to be called from the interrupt context or
+ * This function is intended to be called from the NAPI context or
  * with a wrapper which waits for the receive frame to be available.
  *
  * Return:	Total number of bytes received
@@ -574,14 +577,14 @@ static void xemaclite_tx_handler(struct net_device *dev)
 		return;
 
 	dev->stats.tx_bytes += lp->deferred_skb->len;
-	dev_consume_skb_irq(lp->deferred_skb);
+	dev_consume_skb_any(lp->deferred_skb);
 	lp->deferred_skb = NULL;
 	netif_trans_update(dev); /* prevent tx timeout */
 	netif_wake_queue(dev);
 }
 
 /**
- * xemaclite_rx_handler- Interrupt handler for frames received
+ * xemaclite_rx_handler - Handler for frames received
  * @dev:	Pointer to the network device
  *
  * This function allocates memory for a socket buffer, fills it with data
@@ -594,7 +597,7 @@ static void xemaclite_rx_handler(struct net_device *dev)
 	u32 len;
 
 	len = ETH_FRAME_LEN + ETH_FCS_LEN;
-	skb = netdev_alloc_skb(dev, len + NET_IP_ALIGN);
+	skb = napi_alloc_skb(&lp->napi, len);
 	if (!skb) {
 		/* Couldn't get memory. */
 		dev->stats.rx_dropped++;
@@ -602,13 +605,11 @@ static void xemaclite_rx_handler(struct net_device *dev)
 		return;
 	}
 
-	skb_reserve(skb, NET_IP_ALIGN);
-
 	len = xemaclite_recv_data(lp, (u8 *)skb->data, len);
 
 	if (!len) {
 		dev->stats.rx_errors++;
-		dev_kfree_skb_irq(skb);
+		dev_kfree_skb(skb);
 		return;
 	}
 
@@ -621,7 +622,74 @@ static void xemaclite_rx_handler(struct net_device *dev)
 	dev->stats.rx_bytes += len;
 
 	if (!skb_defer_rx_timestamp(skb))
-		netif_rx(skb);	/* Send the packet upstream */
+		napi_gro_receive(&lp->napi, skb); /* Send the packet upstream */
+}
+
+/**
+ * xemaclite_rx_pending - Check for a received frame in either Rx buffer
+ * @lp:		Pointer to the Emaclite device private data
+ *
+ * Return:	true if a frame is waiting to be read, false otherwise.
+ */
+static bool xemaclite_rx_pending(struct net_local *lp)
+{
+	void __iomem *base_addr = lp->base_addr;
+	u32 ping, pong;
+
+	ping = xemaclite_readl(base_addr + XEL_RSR_OFFSET);
+	pong = xemaclite_readl(base_addr + XEL_BUFFER_OFFSET + XEL_RSR_OFFSET);
+
+	return (ping | pong) & XEL_RSR_RECV_DONE_MASK;
+}
+
+/**
+ * xemaclite_tx_buf_done - Check whether a Tx buffer has completed
+ * @addr:	Address of the Tx buffer
+ *
+ * Return:	true if the transmission from this buffer is complete and has
+ *		not been acknowledged yet, false otherwise.
+ */
+static bool xemaclite_tx_buf_done(void __iomem *addr)
+{
+	u32 tx_status = xemaclite_readl(addr + XEL_TSR_OFFSET);
+
+	return ((tx_status & XEL_TSR_XMIT_BUSY_MASK) == 0) &&
+	       (tx_status & XEL_TSR_XMIT_ACTIVE_MASK) != 0;
+}
+
+/**
+ * xemaclite_tx_buf_ack - Acknowledge a completed Tx buffer
+ * @addr:	Address of the Tx buffer
+ *
+ * Return:	true if the buffer had completed, false otherwise.
+ */
+static bool xemaclite_tx_buf_ack(void __iomem *addr)
+{
+	u32 tx_status;
+
+	if (!xemaclite_tx_buf_done(addr))
+		return false;
+
+	tx_status = xemaclite_readl(addr + XEL_TSR_OFFSET);
+	tx_status &= ~XEL_TSR_XMIT_ACTIVE_MASK;
+	xemaclite_writel(tx_status, addr + XEL_TSR_OFFSET);
+
+	return true;
+}
+
+/**
+ * xemaclite_napi_schedule - Mask the device interrupts and schedule NAPI
+ * @lp:		Pointer to the Emaclite device private data
+ *
+ * The EmacLite has a single interrupt line for Rx and Tx, so it is masked
+ * with the Global Interrupt Enable while the NAPI poll owns the device.
+ */
+static void xemaclite_napi_schedule(struct net_local *lp)
+{
+	if (napi_schedule_prep(&lp->napi)) {
+		xemaclite_writel(0, lp->base_addr + XEL_GIER_OFFSET);
+		__napi_schedule(&lp->napi);
+	}
 }
 
 /**
@@ -632,50 +700,66 @@ static void xemaclite_rx_handler(struct net_device *dev)
  *
  * Return:	IRQ_HANDLED
  *
- * This function handles the Tx and Rx interrupts of the EmacLite device.
+ * This function hands the Tx and Rx events of the EmacLite device over to
+ * NAPI.
  */
 static irqreturn_t xemaclite_interrupt(int irq, void *dev_id)
 {
-	bool tx_complete = false;
 	struct net_device *dev = dev_id;
 	struct net_local *lp = netdev_priv(dev);
-	void __iomem *base_addr = lp->base_addr;
-	u32 tx_status;
 
-	/* Check if there is Rx Data available */
-	if ((xemaclite_readl(base_addr + XEL_RSR_OFFSET) &
-			 XEL_RSR_RECV_DONE_MASK) ||
-	    (xemaclite_readl(base_addr + XEL_BUFFER_OFFSET + XEL_RSR_OFFSET)
-			 & XEL_RSR_RECV_DONE_MASK))
+	xemaclite_napi_schedule(lp);
 
-		xemaclite_rx_handler(dev);
+	return IRQ_HANDLED;
+}
 
-	/* Check if the Transmission for the first buffer is completed */
-	tx_status = xemaclite_readl(base_addr + XEL_TSR_OFFSET);
-	if (((tx_status & XEL_TSR_XMIT_BUSY_MASK) == 0) &&
-	    (tx_status & XEL_TSR_XMIT_ACTIVE_MASK) != 0) {
-		tx_status &= ~XEL_TSR_XMIT_ACTIVE_MASK;
-		xemaclite_writel(tx_status, base_addr + XEL_TSR_OFFSET);
+/**
+ * xemaclite_poll - NAPI poll handler for this driver
+ * @napi:	Pointer to the NAPI context
+ * @budget:	Maximum number of frames to receive
+ *
+ * Return:	Number of frames received.
+ *
+ * This function handles the Tx completions and receives up to @budget
+ * frames, then re-enables the device interrupts once the work is done.
+ */
+static int xemaclite_poll(struct napi_struct *napi, int budget)
+{
+	struct net_local *lp = container_of(napi, struct net_local, napi);
+	void __iomem *base_addr = lp->base_addr;
+	struct net_device *dev = lp->ndev;
+	bool tx_complete = false;
+	int work_done = 0;
 
+	/* Check if the Transmission for either buffer is completed */
+	if (xemaclite_tx_buf_ack(base_addr))
+		tx_complete = true;
+	if (xemaclite_tx_buf_ack(base_addr + XEL_BUFFER_OFFSET))
 		tx_complete = true;
-	}
 
-	/* Check if the Transmission for the second buffer is completed */
-	tx_status = xemaclite_readl(base_addr + XEL_BUFFER_OFFSET + XEL_TSR_OFFSET);
-	if (((tx_status & XEL_TSR_XMIT_BUSY_MASK) == 0) &&
-	    (tx_status & XEL_TSR_XMIT_ACTIVE_MASK) != 0) {
-		tx_status &= ~XEL_TSR_XMIT_ACTIVE_MASK;
-		xemaclite_writel(tx_status, base_addr + XEL_BUFFER_OFFSET +
-				 XEL_TSR_OFFSET);
+	/* If there was a Tx completion, call the Tx Handler */
+	if (tx_complete)
+		xemaclite_tx_handler(dev);
 
-		tx_complete = true;
+	while (work_done < budget && xemaclite_rx_pending(lp)) {
+		xemaclite_rx_handler(dev);
+		work_done++;
 	}
 
-	/* If there was a Tx interrupt, call the Tx Handler */
-	if (tx_complete != 0)
-		xemaclite_tx_handler(dev);
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		xemaclite_writel(XEL_GIER_GIE_MASK,
+				 base_addr + XEL_GIER_OFFSET);
 
-	return IRQ_HANDLED;
+		/* Events raised while the interrupts were masked are not
+		 * guaranteed to be signalled on unmask, so check again.
+		 */
+		if (xemaclite_rx_pending(lp) ||
+		    xemaclite_tx_buf_done(base_addr) ||
+		    xemaclite_tx_buf_done(base_addr + XEL_BUFFER_OFFSET))
+			xemaclite_napi_schedule(lp);
+	}
+
+	return work_done;
 }
 
 /**********************/
@@ -932,11 +1016,14 @@ static int xemaclite_open(struct net_device *dev)
 	/* Set the MAC address each time opened */
 	xemaclite_update_address(lp, dev->dev_addr);
 
+	napi_enable(&lp->napi);
+
 	/* Grab the IRQ */
 	retval = request_irq(dev->irq, xemaclite_interrupt, 0, dev->name, dev);
 	if (retval) {
 		dev_err(&lp->ndev->dev, "Could not allocate interrupt %d\n",
 			dev->irq);
+		napi_disable(&lp->napi);
 		if (lp->phy_dev)
 			phy_disconnect(lp->phy_dev);
 		lp->phy_dev = NULL;
@@ -957,8 +1044,8 @@ static int xemaclite_open(struct net_device *dev)
  * xemaclite_close - Close the network device
  * @dev:	Pointer to the network device
  *
- * This function stops the Tx queue, disables interrupts and frees the IRQ for
- * the Emaclite device.
+ * This function stops the Tx queue, disables interrupts and NAPI and frees
+ * the IRQ for the Emaclite device.
  * It also disconnects the phy device associated with the Emaclite device.
  *
  * Return:	0, always.
@@ -970,6 +1057,7 @@ static int xemaclite_close(struct net_device *dev)
 	netif_stop_queue(dev);
 	xemaclite_disable_interrupts(lp);
 	free_irq(dev->irq, dev);
+	napi_disable(&lp->napi);
 
 	if (lp->phy_dev)
 		phy_disconnect(lp->phy_dev);
@@ -1152,6 +1240,7 @@ static int xemaclite_of_probe(struct platform_device *ofdev)
 	ndev->ethtool_ops = &xemaclite_ethtool_ops;
 	ndev->flags &= ~IFF_MULTICAST;
 	ndev->watchdog_timeo = TX_TIMEOUT;
+	netif_napi_add(ndev, &lp->napi, xemaclite_poll);
 
 	/* Finally, register the device */
 	rc = register_netdev(ndev);
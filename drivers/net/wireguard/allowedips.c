@@ -8,6 +8,13 @@
 
 enum { MAX_ALLOWEDIPS_BITS = 128 };
 
+/* Large tables get a direct pointing table for their top DIRECT_BITS bits,
+ * like the first level of a poptrie, so lookups skip the top of the trie
+ * where most of the cache misses are. It takes 1 MiB on 64-bit, so it is only
+ * built above DIRECT_MIN prefixes and dropped again below half of that.
+ */
+enum { DIRECT_BITS = 16, DIRECT_SLOTS = 1U << DIRECT_BITS, DIRECT_MIN = 1024 };
+
 static struct kmem_cache *node_cache;
 
 static void swap_endian(u8 *dst, const u8 *src, u8 bits)
@@ -123,6 +130,28 @@ static struct allowedips_node *find_node(struct allowedips_node *trie, u8 bits,
 	return found;
 }
 
+static u32 direct_slot(const u8 *key, u8 bits)
+{
+	if (bits == 32)
+		return *(const u32 *)key >> (32 - DIRECT_BITS);
+	return *(const u64 *)key >> (64 - DIRECT_BITS);
+}
+
+static struct allowedips_node *find_node_direct(struct allowedips_direct *direct,
+						u8 bits, const u8 *key)
+{
+	u32 slot = direct_slot(key, bits);
+	struct allowedips_node *found, *best;
+
+	found = find_node(rcu_dereference_bh(direct->slots[slot].start), bits, key);
+	if (found)
+		return found;
+	best = rcu_dereference_bh(direct->slots[slot].best);
+	if (best && rcu_access_pointer(best->peer))
+		return best;
+	return NULL;
+}
+
 /* Returns a strong reference to a peer */
 static struct wg_peer *lookup(struct allowedips_node __rcu *root, u8 bits,
 			      const void *be_ip)
@@ -146,6 +175,113 @@ static struct wg_peer *lookup(struct allowedips_node __rcu *root, u8 bits,
 	return peer;
 }
 
+/* Returns a strong reference to a peer */
+static struct wg_peer *lookup_table(struct allowedips_node __rcu *root,
+				    struct allowedips_direct __rcu *direct,
+				    u8 bits, const void *be_ip)
+{
+	/* Aligned so it can be passed to fls/fls64 */
+	u8 ip[16] __aligned(__alignof(u64));
+	struct allowedips_direct *dt;
+	struct allowedips_node *node;
+	struct wg_peer *peer = NULL;
+
+	if (!rcu_access_pointer(direct))
+		return lookup(root, bits, be_ip);
+
+	swap_endian(ip, be_ip, bits);
+
+	rcu_read_lock_bh();
+retry:
+	dt = rcu_dereference_bh(direct);
+	if (likely(dt))
+		node = find_node_direct(dt, bits, ip);
+	else
+		node = find_node(rcu_dereference_bh(root), bits, ip);
+	if (node) {
+		peer = wg_peer_get_maybe_zero(rcu_dereference_bh(node->peer));
+		if (!peer)
+			goto retry;
+	}
+	rcu_read_unlock_bh();
+	return peer;
+}
+
+/* Recomputes the slots of the direct table from the trie. Each start node is
+ * the first one of the walk of the slot that has at least DIRECT_BITS bits of
+ * prefix, and each best node the last one above it that matches and has a
+ * peer. Readers may see a slot half updated, which only gives them a result of
+ * either side of the update, like the trie walk does.
+ */
+static void direct_fill(struct allowedips_direct *direct,
+			struct allowedips_node __rcu *root, u8 bits, u32 first,
+			u32 nr, struct mutex *lock)
+{
+	u8 key[16] __aligned(__alignof(u64)) = { 0 };
+	struct allowedips_node *node, *best;
+	u32 slot;
+
+	for (slot = first; slot < first + nr; ++slot) {
+		if (bits == 32)
+			*(u32 *)key = slot << (32 - DIRECT_BITS);
+		else
+			*(u64 *)key = (u64)slot << (64 - DIRECT_BITS);
+		node = rcu_dereference_protected(root, lockdep_is_held(lock));
+		best = NULL;
+		while (node && node->cidr < DIRECT_BITS) {
+			if (!prefix_matches(node, key, bits)) {
+				node = NULL;
+				break;
+			}
+			if (rcu_access_pointer(node->peer))
+				best = node;
+			node = rcu_dereference_protected(node->bit[choose(node, key)],
+							 lockdep_is_held(lock));
+		}
+		rcu_assign_pointer(direct->slots[slot].start, node);
+		rcu_assign_pointer(direct->slots[slot].best, best);
+	}
+}
+
+/* Refreshes the slots under key/cidr after the trie changed below that prefix.
+ * This must happen before any node the slots may point to is freed.
+ */
+static void direct_update(struct allowedips *table, u8 bits, const u8 *key,
+			  u8 cidr, struct mutex *lock)
+{
+	struct allowedips_direct *direct;
+	u32 nr;
+
+	direct = rcu_dereference_protected(bits == 32 ? table->direct4 : table->direct6,
+					   lockdep_is_held(lock));
+	if (!direct)
+		return;
+	nr = 1U << (DIRECT_BITS - min_t(u8, cidr, DIRECT_BITS));
+	direct_fill(direct, bits == 32 ? table->root4 : table->root6, bits,
+		    direct_slot(key, bits) & ~(nr - 1), nr, lock);
+}
+
+static void direct_resize(struct allowedips *table, u8 bits, struct mutex *lock)
+{
+	struct allowedips_direct __rcu **pdirect = bits == 32 ? &table->direct4 : &table->direct6;
+	unsigned int count = bits == 32 ? table->count4 : table->count6;
+	struct allowedips_direct *direct;
+
+	direct = rcu_dereference_protected(*pdirect, lockdep_is_held(lock));
+	if (!direct && count >= DIRECT_MIN) {
+		direct = kvzalloc(struct_size(direct, slots, DIRECT_SLOTS), GFP_KERNEL);
+		/* Lookups just keep walking the whole trie without it. */
+		if (!direct)
+			return;
+		direct_fill(direct, bits == 32 ? table->root4 : table->root6, bits,
+			    0, DIRECT_SLOTS, lock);
+		rcu_assign_pointer(*pdirect, direct);
+	} else if (direct && count < DIRECT_MIN / 2) {
+		RCU_INIT_POINTER(*pdirect, NULL);
+		kvfree_rcu(direct, rcu);
+	}
+}
+
 static bool node_placement(struct allowedips_node __rcu *trie, const u8 *key,
 			   u8 cidr, u8 bits, struct allowedips_node **rnode,
 			   struct mutex *lock)
@@ -178,8 +314,11 @@ static inline void choose_and_connect_node(struct allowedips_node *parent, struc
 	connect_node(&parent->bit[bit], bit, node);
 }
 
+/* Returns 1 when a new prefix was added, and in changed the length of the prefix
+ * under which the walks of the trie changed.
+ */
 static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
-	       u8 cidr, struct wg_peer *peer, struct mutex *lock)
+	       u8 cidr, struct wg_peer *peer, u8 *changed, struct mutex *lock)
 {
 	struct allowedips_node *node, *parent, *down, *newnode;
 
@@ -194,12 +333,17 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 		list_add_tail(&node->peer_list, &peer->allowedips_list);
 		copy_and_assign_cidr(node, key, cidr, bits);
 		connect_node(trie, 2, node);
-		return 0;
+		*changed = 0;
+		return 1;
 	}
 	if (node_placement(*trie, key, cidr, bits, &node, lock)) {
+		/* Intermediate nodes have no peer yet. */
+		int ret = !rcu_access_pointer(node->peer);
+
 		rcu_assign_pointer(node->peer, peer);
 		list_move_tail(&node->peer_list, &peer->allowedips_list);
-		return 0;
+		*changed = cidr;
+		return ret;
 	}
 
 	newnode = kmem_cache_zalloc(node_cache, GFP_KERNEL);
@@ -216,11 +360,13 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 		down = rcu_dereference_protected(node->bit[bit], lockdep_is_held(lock));
 		if (!down) {
 			connect_node(&node->bit[bit], bit, newnode);
-			return 0;
+			*changed = node->cidr + 1;
+			return 1;
 		}
 	}
 	cidr = min(cidr, common_bits(down, key, bits));
 	parent = node;
+	*changed = parent ? parent->cidr + 1 : 0;
 
 	if (newnode->cidr == cidr) {
 		choose_and_connect_node(newnode, down);
@@ -228,7 +374,7 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 			connect_node(trie, 2, newnode);
 		else
 			choose_and_connect_node(parent, newnode);
-		return 0;
+		return 1;
 	}
 
 	node = kmem_cache_zalloc(node_cache, GFP_KERNEL);
@@ -246,12 +392,44 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 		connect_node(trie, 2, node);
 	else
 		choose_and_connect_node(parent, node);
+	return 1;
+}
+
+static int insert(struct allowedips *table, u8 bits, const u8 *key, u8 cidr,
+		  struct wg_peer *peer, struct mutex *lock)
+{
+	u8 changed;
+	int ret;
+
+	ret = add(bits == 32 ? &table->root4 : &table->root6, bits, key, cidr,
+		  peer, &changed, lock);
+	if (ret < 0)
+		return ret;
+	direct_update(table, bits, key, changed, lock);
+	if (ret) {
+		++*(bits == 32 ? &table->count4 : &table->count6);
+		direct_resize(table, bits, lock);
+	}
 	return 0;
 }
 
+/* The length of the prefix of the parent link of node, plus its bit. */
+static u8 parent_link_cidr(const struct allowedips_node *node)
+{
+	const struct allowedips_node *parent;
+
+	if ((node->parent_bit_packed & 3) > 1)
+		return 0;
+	parent = (void *)(node->parent_bit_packed & ~3UL) -
+		 offsetof(struct allowedips_node, bit[node->parent_bit_packed & 1]);
+	return parent->cidr + 1;
+}
+
 void wg_allowedips_init(struct allowedips *table)
 {
 	table->root4 = table->root6 = NULL;
+	table->direct4 = table->direct6 = NULL;
+	table->count4 = table->count6 = 0;
 	table->seq = 1;
 }
 
@@ -260,6 +438,9 @@ void wg_allowedips_free(struct allowedips *table, struct mutex *lock)
 	struct allowedips_node __rcu *old4 = table->root4, *old6 = table->root6;
 
 	++table->seq;
+	table->count4 = table->count6 = 0;
+	direct_resize(table, 32, lock);
+	direct_resize(table, 128, lock);
 	RCU_INIT_POINTER(table->root4, NULL);
 	RCU_INIT_POINTER(table->root6, NULL);
 	if (rcu_access_pointer(old4)) {
@@ -286,7 +467,7 @@ int wg_allowedips_insert_v4(struct allowedips *table, const struct in_addr *ip,
 
 	++table->seq;
 	swap_endian(key, (const u8 *)ip, 32);
-	return add(&table->root4, 32, key, cidr, peer, lock);
+	return insert(table, 32, key, cidr, peer, lock);
 }
 
 int wg_allowedips_insert_v6(struct allowedips *table, const struct in6_addr *ip,
@@ -297,7 +478,7 @@ int wg_allowedips_insert_v6(struct allowedips *table, const struct in6_addr *ip,
 
 	++table->seq;
 	swap_endian(key, (const u8 *)ip, 128);
-	return add(&table->root6, 128, key, cidr, peer, lock);
+	return insert(table, 128, key, cidr, peer, lock);
 }
 
 void wg_allowedips_remove_by_peer(struct allowedips *table,
@@ -305,6 +486,7 @@ void wg_allowedips_remove_by_peer(struct allowedips *table,
 {
 	struct allowedips_node *node, *child, **parent_bit, *parent, *tmp;
 	bool free_parent;
+	u8 changed;
 
 	if (list_empty(&peer->allowedips_list))
 		return;
@@ -312,8 +494,12 @@ void wg_allowedips_remove_by_peer(struct allowedips *table,
 	list_for_each_entry_safe(node, tmp, &peer->allowedips_list, peer_list) {
 		list_del_init(&node->peer_list);
 		RCU_INIT_POINTER(node->peer, NULL);
-		if (node->bit[0] && node->bit[1])
+		--*(node->bitlen == 32 ? &table->count4 : &table->count6);
+		if (node->bit[0] && node->bit[1]) {
+			direct_update(table, node->bitlen, node->bits, node->cidr, lock);
 			continue;
+		}
+		changed = parent_link_cidr(node);
 		child = rcu_dereference_protected(node->bit[!rcu_access_pointer(node->bit[0])],
 						  lockdep_is_held(lock));
 		if (child)
@@ -326,18 +512,24 @@ void wg_allowedips_remove_by_peer(struct allowedips *table,
 			      !rcu_access_pointer(node->bit[1]) &&
 			      (node->parent_bit_packed & 3) <= 1 &&
 			      !rcu_access_pointer(parent->peer);
-		if (free_parent)
-			child = rcu_dereference_protected(
-					parent->bit[!(node->parent_bit_packed & 1)],
-					lockdep_is_held(lock));
-		call_rcu(&node->rcu, node_free_rcu);
-		if (!free_parent)
+		if (!free_parent) {
+			direct_update(table, node->bitlen, node->bits, changed, lock);
+			call_rcu(&node->rcu, node_free_rcu);
 			continue;
+		}
+		changed = parent_link_cidr(parent);
+		child = rcu_dereference_protected(
+				parent->bit[!(node->parent_bit_packed & 1)],
+				lockdep_is_held(lock));
 		if (child)
 			child->parent_bit_packed = parent->parent_bit_packed;
 		*(struct allowedips_node **)(parent->parent_bit_packed & ~3UL) = child;
+		direct_update(table, node->bitlen, node->bits, changed, lock);
+		call_rcu(&node->rcu, node_free_rcu);
 		call_rcu(&parent->rcu, node_free_rcu);
 	}
+	direct_resize(table, 32, lock);
+	direct_resize(table, 128, lock);
 }
 
 int wg_allowedips_read_node(struct allowedips_node *node, u8 ip[16], u8 *cidr)
@@ -357,9 +549,11 @@ struct wg_peer *wg_allowedips_lookup_dst(struct allowedips *table,
 					 struct sk_buff *skb)
 {
 	if (skb->protocol == htons(ETH_P_IP))
-		return lookup(table->root4, 32, &ip_hdr(skb)->daddr);
+		return lookup_table(table->root4, table->direct4, 32,
+				    &ip_hdr(skb)->daddr);
 	else if (skb->protocol == htons(ETH_P_IPV6))
-		return lookup(table->root6, 128, &ipv6_hdr(skb)->daddr);
+		return lookup_table(table->root6, table->direct6, 128,
+				    &ipv6_hdr(skb)->daddr);
 	return NULL;
 }
 
@@ -368,9 +562,11 @@ struct wg_peer *wg_allowedips_lookup_src(struct allowedips *table,
 					 struct sk_buff *skb)
 {
 	if (skb->protocol == htons(ETH_P_IP))
-		return lookup(table->root4, 32, &ip_hdr(skb)->saddr);
+		return lookup_table(table->root4, table->direct4, 32,
+				    &ip_hdr(skb)->saddr);
 	else if (skb->protocol == htons(ETH_P_IPV6))
-		return lookup(table->root6, 128, &ipv6_hdr(skb)->saddr);
+		return lookup_table(table->root6, table->direct6, 128,
+				    &ipv6_hdr(skb)->saddr);
 	return NULL;
 }
 
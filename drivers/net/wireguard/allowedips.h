@@ -26,9 +26,23 @@ struct allowedips_node {
 	};
 };
 
+/* Direct pointing table indexed by the top bits of the address. */
+struct allowedips_direct {
+	struct rcu_head rcu;
+	struct {
+		/* First node of the trie walk, its prefix is not yet checked. */
+		struct allowedips_node __rcu *start;
+		/* Longest matching prefix with a peer above the start node. */
+		struct allowedips_node __rcu *best;
+	} slots[];
+};
+
 struct allowedips {
 	struct allowedips_node __rcu *root4;
 	struct allowedips_node __rcu *root6;
+	struct allowedips_direct __rcu *direct4;
+	struct allowedips_direct __rcu *direct6;
+	unsigned int count4, count6;
 	u64 seq;
 } __aligned(4); /* We pack the lower 2 bits of &root, but m68k only gives 16-bit alignment. */
 
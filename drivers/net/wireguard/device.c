@@ -258,6 +258,7 @@ static void wg_destruct(struct net_device *dev)
 	wg_packet_queue_free(&wg->handshake_queue, true);
 	wg_packet_queue_free(&wg->decrypt_queue, false);
 	wg_packet_queue_free(&wg->encrypt_queue, false);
+	free_cpumask_var(wg->crypt_cpumask);
 	rcu_barrier(); /* Wait for all the peers to be actually freed. */
 	wg_ratelimiter_uninit();
 	memzero_explicit(&wg->static_identity, sizeof(wg->static_identity));
@@ -349,10 +350,14 @@ static int wg_newlink(struct net *src_net, struct net_device *dev,
 	if (!wg->packet_crypt_wq)
 		goto err_destroy_handshake_send;
 
+	if (!alloc_cpumask_var(&wg->crypt_cpumask, GFP_KERNEL))
+		goto err_destroy_packet_crypt;
+	cpumask_setall(wg->crypt_cpumask);
+
 	ret = wg_packet_queue_init(&wg->encrypt_queue, wg_packet_encrypt_worker,
 				   MAX_QUEUED_PACKETS);
 	if (ret < 0)
-		goto err_destroy_packet_crypt;
+		goto err_free_crypt_cpumask;
 
 	ret = wg_packet_queue_init(&wg->decrypt_queue, wg_packet_decrypt_worker,
 				   MAX_QUEUED_PACKETS);
@@ -390,6 +395,8 @@ static int wg_newlink(struct net *src_net, struct net_device *dev,
 	wg_packet_queue_free(&wg->decrypt_queue, false);
 err_free_encrypt_queue:
 	wg_packet_queue_free(&wg->encrypt_queue, false);
+err_free_crypt_cpumask:
+	free_cpumask_var(wg->crypt_cpumask);
 err_destroy_packet_crypt:
 	destroy_workqueue(wg->packet_crypt_wq);
 err_destroy_handshake_send:
@@ -52,8 +52,10 @@ struct wg_device {
 	struct list_head device_list, peer_list;
 	atomic_t handshake_queue_len;
 	unsigned int num_peers, device_update_gen;
+	cpumask_var_t crypt_cpumask;
 	u32 fwmark;
 	u16 incoming_port;
+	u8 crypt_affinity;
 };
 
 int wg_device_init(void);
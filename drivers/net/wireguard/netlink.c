@@ -27,7 +27,10 @@ static const struct nla_policy device_policy[WGDEVICE_A_MAX + 1] = {
 	[WGDEVICE_A_FLAGS]		= { .type = NLA_U32 },
 	[WGDEVICE_A_LISTEN_PORT]	= { .type = NLA_U16 },
 	[WGDEVICE_A_FWMARK]		= { .type = NLA_U32 },
-	[WGDEVICE_A_PEERS]		= { .type = NLA_NESTED }
+	[WGDEVICE_A_PEERS]		= { .type = NLA_NESTED },
+	[WGDEVICE_A_CRYPT_CPUMASK]	= { .type = NLA_BINARY },
+	[WGDEVICE_A_CRYPT_AFFINITY]	= NLA_POLICY_MAX(NLA_U32,
+							 __WGDEVICE_CRYPT_AFFINITY_LAST - 1)
 };
 
 static const struct nla_policy peer_policy[WGPEER_A_MAX + 1] = {
@@ -40,7 +43,8 @@ static const struct nla_policy peer_policy[WGPEER_A_MAX + 1] = {
 	[WGPEER_A_RX_BYTES]				= { .type = NLA_U64 },
 	[WGPEER_A_TX_BYTES]				= { .type = NLA_U64 },
 	[WGPEER_A_ALLOWEDIPS]				= { .type = NLA_NESTED },
-	[WGPEER_A_PROTOCOL_VERSION]			= { .type = NLA_U32 }
+	[WGPEER_A_PROTOCOL_VERSION]			= { .type = NLA_U32 },
+	[WGPEER_A_STATS]				= { .type = NLA_NESTED }
 };
 
 static const struct nla_policy allowedip_policy[WGALLOWEDIP_A_MAX + 1] = {
@@ -72,6 +76,39 @@ static struct wg_device *lookup_interface(struct nlattr **attrs,
 	return netdev_priv(dev);
 }
 
+static int get_crypt_cpumask(struct sk_buff *skb, struct wg_device *wg)
+{
+	struct nlattr *attr;
+
+	attr = nla_reserve(skb, WGDEVICE_A_CRYPT_CPUMASK,
+			   BITS_TO_U32(nr_cpu_ids) * sizeof(u32));
+	if (!attr)
+		return -EMSGSIZE;
+	bitmap_to_arr32(nla_data(attr), cpumask_bits(wg->crypt_cpumask),
+			nr_cpu_ids);
+	return 0;
+}
+
+static int set_crypt_cpumask(struct wg_device *wg, const struct nlattr *attr)
+{
+	unsigned int nbits = nla_len(attr) / sizeof(u32) * 32;
+	cpumask_var_t mask;
+
+	if (nla_len(attr) % sizeof(u32))
+		return -EINVAL;
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	/* Build the mask aside, the data path reads it without locking. */
+	bitmap_from_arr32(cpumask_bits(mask), nla_data(attr),
+			  min_t(unsigned int, nbits, nr_cpu_ids));
+	if (cpumask_empty(mask))
+		cpumask_setall(mask);
+	cpumask_copy(wg->crypt_cpumask, mask);
+	free_cpumask_var(mask);
+	return 0;
+}
+
 static int get_allowedips(struct sk_buff *skb, const u8 *ip, u8 cidr,
 			  int family)
 {
@@ -102,6 +139,43 @@ struct dump_ctx {
 
 #define DUMP_CTX(cb) ((struct dump_ctx *)(cb)->args)
 
+static int get_peer_stats(struct wg_peer *peer, struct sk_buff *skb)
+{
+	struct wg_peer_stats stats = { 0 };
+	u64 *sum = (u64 *)&stats;
+	struct nlattr *nest;
+	unsigned int i;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const u64 *pcpu = (const u64 *)per_cpu_ptr(peer->stats, cpu);
+
+		for (i = 0; i < sizeof(stats) / sizeof(u64); ++i)
+			sum[i] += READ_ONCE(pcpu[i]);
+	}
+
+	nest = nla_nest_start(skb, WGPEER_A_STATS);
+	if (!nest)
+		return -EMSGSIZE;
+	if (nla_put_u32(skb, WGPEER_STATS_A_STAGED_PACKETS,
+			skb_queue_len_lockless(&peer->staged_packet_queue)) ||
+	    nla_put_u64_64bit(skb, WGPEER_STATS_A_HANDSHAKE_WAITS,
+			      stats.handshake_waits, WGPEER_STATS_A_PAD) ||
+	    nla_put(skb, WGPEER_STATS_A_TX_QUEUE_WAIT,
+		    sizeof(stats.tx_queue_wait), stats.tx_queue_wait) ||
+	    nla_put(skb, WGPEER_STATS_A_TX_CRYPT_TIME,
+		    sizeof(stats.tx_crypt_time), stats.tx_crypt_time) ||
+	    nla_put(skb, WGPEER_STATS_A_RX_QUEUE_WAIT,
+		    sizeof(stats.rx_queue_wait), stats.rx_queue_wait) ||
+	    nla_put(skb, WGPEER_STATS_A_RX_CRYPT_TIME,
+		    sizeof(stats.rx_crypt_time), stats.rx_crypt_time)) {
+		nla_nest_cancel(skb, nest);
+		return -EMSGSIZE;
+	}
+	nla_nest_end(skb, nest);
+	return 0;
+}
+
 static int
 get_peer(struct wg_peer *peer, struct sk_buff *skb, struct dump_ctx *ctx)
 {
@@ -142,7 +216,8 @@ get_peer(struct wg_peer *peer, struct sk_buff *skb, struct dump_ctx *ctx)
 				      WGPEER_A_UNSPEC) ||
 		    nla_put_u64_64bit(skb, WGPEER_A_RX_BYTES, peer->rx_bytes,
 				      WGPEER_A_UNSPEC) ||
-		    nla_put_u32(skb, WGPEER_A_PROTOCOL_VERSION, 1))
+		    nla_put_u32(skb, WGPEER_A_PROTOCOL_VERSION, 1) ||
+		    get_peer_stats(peer, skb))
 			goto err;
 
 		read_lock_bh(&peer->endpoint_lock);
@@ -233,7 +308,9 @@ static int wg_get_device_dump(struct sk_buff *skb, struct netlink_callback *cb)
 				wg->incoming_port) ||
 		    nla_put_u32(skb, WGDEVICE_A_FWMARK, wg->fwmark) ||
 		    nla_put_u32(skb, WGDEVICE_A_IFINDEX, wg->dev->ifindex) ||
-		    nla_put_string(skb, WGDEVICE_A_IFNAME, wg->dev->name))
+		    nla_put_string(skb, WGDEVICE_A_IFNAME, wg->dev->name) ||
+		    nla_put_u32(skb, WGDEVICE_A_CRYPT_AFFINITY, wg->crypt_affinity) ||
+		    get_crypt_cpumask(skb, wg))
 			goto out;
 
 		down_read(&wg->static_identity.lock);
@@ -537,6 +614,16 @@ static int wg_set_device(struct sk_buff *skb, struct genl_info *info)
 			goto out;
 	}
 
+	if (info->attrs[WGDEVICE_A_CRYPT_CPUMASK]) {
+		ret = set_crypt_cpumask(wg, info->attrs[WGDEVICE_A_CRYPT_CPUMASK]);
+		if (ret)
+			goto out;
+	}
+
+	if (info->attrs[WGDEVICE_A_CRYPT_AFFINITY])
+		WRITE_ONCE(wg->crypt_affinity,
+			   nla_get_u32(info->attrs[WGDEVICE_A_CRYPT_AFFINITY]));
+
 	if (flags & WGDEVICE_F_REPLACE_PEERS)
 		wg_peer_remove_all(wg);
 
@@ -35,6 +35,9 @@ struct wg_peer *wg_peer_create(struct wg_device *wg,
 		return ERR_PTR(ret);
 	if (unlikely(dst_cache_init(&peer->endpoint_cache, GFP_KERNEL)))
 		goto err;
+	peer->stats = alloc_percpu(struct wg_peer_stats);
+	if (unlikely(!peer->stats))
+		goto err_dst_cache;
 
 	peer->device = wg;
 	wg_noise_handshake_init(&peer->handshake, &wg->static_identity,
@@ -63,6 +66,8 @@ struct wg_peer *wg_peer_create(struct wg_device *wg,
 	pr_debug("%s: Peer %llu created\n", wg->dev->name, peer->internal_id);
 	return peer;
 
+err_dst_cache:
+	dst_cache_destroy(&peer->endpoint_cache);
 err:
 	kmem_cache_free(peer_cache, peer);
 	return ERR_PTR(ret);
@@ -188,6 +193,7 @@ static void rcu_release(struct rcu_head *rcu)
 	struct wg_peer *peer = container_of(rcu, struct wg_peer, rcu);
 
 	dst_cache_destroy(&peer->endpoint_cache);
+	free_percpu(peer->stats);
 	WARN_ON(wg_prev_queue_peek(&peer->tx_queue) || wg_prev_queue_peek(&peer->rx_queue));
 
 	/* The final zeroing takes care of clearing any remaining handshake key
@@ -14,7 +14,9 @@
 #include <linux/netfilter.h>
 #include <linux/spinlock.h>
 #include <linux/kref.h>
+#include <linux/percpu.h>
 #include <net/dst_cache.h>
+#include <uapi/linux/wireguard.h>
 
 struct wg_device;
 
@@ -34,6 +36,20 @@ struct endpoint {
 	};
 };
 
+/* Per CPU, summed when dumped, histograms as described in the uapi header. */
+struct wg_peer_stats {
+	u64 handshake_waits;
+	u64 tx_queue_wait[WG_STATS_HIST_BUCKETS];
+	u64 tx_crypt_time[WG_STATS_HIST_BUCKETS];
+	u64 rx_queue_wait[WG_STATS_HIST_BUCKETS];
+	u64 rx_crypt_time[WG_STATS_HIST_BUCKETS];
+};
+
+static inline unsigned int wg_peer_stats_bucket(u64 ns)
+{
+	return min_t(unsigned int, fls64(ns >> 10), WG_STATS_HIST_BUCKETS - 1);
+}
+
 struct wg_peer {
 	struct wg_device *device;
 	struct prev_queue tx_queue, rx_queue;
@@ -50,6 +66,7 @@ struct wg_peer {
 	struct cookie latest_cookie;
 	struct hlist_node pubkey_hash;
 	u64 rx_bytes, tx_bytes;
+	struct wg_peer_stats __percpu *stats;
 	struct timer_list timer_retransmit_handshake, timer_send_keepalive;
 	struct timer_list timer_new_handshake, timer_zero_key_material;
 	struct timer_list timer_persistent_keepalive;
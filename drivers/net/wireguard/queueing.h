@@ -7,10 +7,12 @@
 #define _WG_QUEUEING_H
 
 #include "peer.h"
+#include <uapi/linux/wireguard.h>
 #include <linux/types.h>
 #include <linux/skbuff.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
+#include <linux/sched/topology.h>
 #include <net/ip_tunnels.h>
 
 struct wg_device;
@@ -62,6 +64,8 @@ struct packet_cb {
 	atomic_t state;
 	u32 mtu;
 	u8 ds;
+	/* When the packet was put on the device crypt queue */
+	u64 queued_ns;
 };
 
 #define PACKET_CB(skb) ((struct packet_cb *)((skb)->cb))
@@ -134,6 +138,53 @@ static inline int wg_cpumask_next_online(int *next)
 	return cpu;
 }
 
+/* Picks the CPU to encrypt or decrypt a packet on, following the crypt
+ * affinity of the device. Like wg_cpumask_next_online(), *next is updated
+ * without locking. Falls back to all the online CPUs if none of the mask is
+ * online, which the racy updates of the mask may also briefly show.
+ */
+static inline int wg_cpumask_next_crypt(struct wg_device *wg, int *next)
+{
+	const struct cpumask *mask = wg->crypt_cpumask;
+	int this_cpu = raw_smp_processor_id();
+	int cpu = *next, start = *next;
+	bool wrapped = false;
+
+	switch (READ_ONCE(wg->crypt_affinity)) {
+	case WGDEVICE_CRYPT_AFFINITY_LOCAL:
+		if (cpumask_test_cpu(this_cpu, mask))
+			return this_cpu;
+		break;
+	case WGDEVICE_CRYPT_AFFINITY_LLC:
+		for (;;) {
+			cpu = cpumask_next_and(cpu, mask, cpu_online_mask);
+			if (cpu >= nr_cpu_ids) {
+				if (wrapped)
+					break;
+				wrapped = true;
+				cpu = -1;
+				continue;
+			}
+			if (wrapped && cpu > start)
+				break;
+			if (cpus_share_cache(cpu, this_cpu)) {
+				*next = cpu;
+				return cpu;
+			}
+		}
+		cpu = start;
+		break;
+	}
+
+	cpu = cpumask_next_and(cpu, mask, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first_and(mask, cpu_online_mask);
+	if (unlikely(cpu >= nr_cpu_ids))
+		return wg_cpumask_next_online(next);
+	*next = cpu;
+	return cpu;
+}
+
 void wg_prev_queue_init(struct prev_queue *queue);
 
 /* Multi producer */
@@ -159,7 +210,7 @@ static inline void wg_prev_queue_drop_peeked(struct prev_queue *queue)
 
 static inline int wg_queue_enqueue_per_device_and_peer(
 	struct crypt_queue *device_queue, struct prev_queue *peer_queue,
-	struct sk_buff *skb, struct workqueue_struct *wq, int *next_cpu)
+	struct sk_buff *skb, struct wg_device *wg)
 {
 	int cpu;
 
@@ -173,10 +224,12 @@ static inline int wg_queue_enqueue_per_device_and_peer(
 	/* Then we queue it up in the device queue, which consumes the
 	 * packet as soon as it can.
 	 */
-	cpu = wg_cpumask_next_online(next_cpu);
+	cpu = wg_cpumask_next_crypt(wg, &device_queue->last_cpu);
+	PACKET_CB(skb)->queued_ns = ktime_get_ns();
 	if (unlikely(ptr_ring_produce_bh(&device_queue->ring, skb)))
 		return -EPIPE;
-	queue_work_on(cpu, wq, &per_cpu_ptr(device_queue->worker, cpu)->work);
+	queue_work_on(cpu, wg->packet_crypt_wq,
+		      &per_cpu_ptr(device_queue->worker, cpu)->work);
 	return 0;
 }
 
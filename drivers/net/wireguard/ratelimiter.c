@@ -11,11 +11,10 @@
 
 static struct kmem_cache *entry_cache;
 static hsiphash_key_t key;
-static spinlock_t table_lock = __SPIN_LOCK_UNLOCKED("ratelimiter_table_lock");
 static DEFINE_MUTEX(init_lock);
 static u64 init_refcnt; /* Protected by init_lock, hence not atomic. */
 static atomic_t total_entries = ATOMIC_INIT(0);
-static unsigned int max_entries, table_size;
+static unsigned int max_entries, table_size, lock_mask;
 static void wg_ratelimiter_gc_entries(struct work_struct *);
 static DECLARE_DEFERRABLE_WORK(gc_work, wg_ratelimiter_gc_entries);
 static struct hlist_head *table_v4;
@@ -23,10 +22,19 @@ static struct hlist_head *table_v4;
 static struct hlist_head *table_v6;
 #endif
 
+/* Inserts and removals take the lock of the shard of their bucket, bucket i of
+ * both tables using shard i & lock_mask. Lookups take no lock at all.
+ */
+struct ratelimiter_shard {
+	spinlock_t lock;
+} ____cacheline_aligned_in_smp;
+static struct ratelimiter_shard *table_locks;
+
 struct ratelimiter_entry {
-	u64 last_time_ns, tokens, ip;
+	/* Theoretical arrival time of the next packet, see below. */
+	atomic64_t next_ns;
+	u64 ip;
 	void *net;
-	spinlock_t lock;
 	struct hlist_node hash;
 	struct rcu_head rcu;
 };
@@ -51,29 +59,46 @@ static void entry_uninit(struct ratelimiter_entry *entry)
 	call_rcu(&entry->rcu, entry_free);
 }
 
+/* An entry whose bucket has been full for a second is no different from a new
+ * one, so it can go.
+ */
+static bool entry_expired(struct ratelimiter_entry *entry, u64 now)
+{
+	return (s64)(now - atomic64_read(&entry->next_ns)) > (s64)NSEC_PER_SEC;
+}
+
+static spinlock_t *bucket_lock(struct hlist_head *table,
+			       struct hlist_head *bucket)
+{
+	return &table_locks[(bucket - table) & lock_mask].lock;
+}
+
+static void bucket_gc(struct hlist_head *bucket, u64 now, bool all)
+{
+	struct ratelimiter_entry *entry;
+	struct hlist_node *temp;
+
+	hlist_for_each_entry_safe(entry, temp, bucket, hash) {
+		if (unlikely(all) || entry_expired(entry, now))
+			entry_uninit(entry);
+	}
+}
+
 /* Calling this function with a NULL work uninits all entries. */
 static void wg_ratelimiter_gc_entries(struct work_struct *work)
 {
 	const u64 now = ktime_get_coarse_boottime_ns();
-	struct ratelimiter_entry *entry;
-	struct hlist_node *temp;
+	spinlock_t *lock;
 	unsigned int i;
 
 	for (i = 0; i < table_size; ++i) {
-		spin_lock(&table_lock);
-		hlist_for_each_entry_safe(entry, temp, &table_v4[i], hash) {
-			if (unlikely(!work) ||
-			    now - entry->last_time_ns > NSEC_PER_SEC)
-				entry_uninit(entry);
-		}
+		lock = &table_locks[i & lock_mask].lock;
+		spin_lock(lock);
+		bucket_gc(&table_v4[i], now, !work);
 #if IS_ENABLED(CONFIG_IPV6)
-		hlist_for_each_entry_safe(entry, temp, &table_v6[i], hash) {
-			if (unlikely(!work) ||
-			    now - entry->last_time_ns > NSEC_PER_SEC)
-				entry_uninit(entry);
-		}
+		bucket_gc(&table_v6[i], now, !work);
 #endif
-		spin_unlock(&table_lock);
+		spin_unlock(lock);
 		if (likely(work))
 			cond_resched();
 	}
@@ -90,12 +115,15 @@ bool wg_ratelimiter_allow(struct sk_buff *skb, struct net *net)
 	const u32 net_word = (unsigned long)net;
 	struct ratelimiter_entry *entry;
 	struct hlist_head *bucket;
-	u64 ip;
+	bool stale = false;
+	spinlock_t *lock;
+	u64 ip, now;
 
 	if (skb->protocol == htons(ETH_P_IP)) {
 		ip = (u64 __force)ip_hdr(skb)->saddr;
 		bucket = &table_v4[hsiphash_2u32(net_word, ip, &key) &
 				   (table_size - 1)];
+		lock = bucket_lock(table_v4, bucket);
 	}
 #if IS_ENABLED(CONFIG_IPV6)
 	else if (skb->protocol == htons(ETH_P_IPV6)) {
@@ -103,35 +131,50 @@ bool wg_ratelimiter_allow(struct sk_buff *skb, struct net *net)
 		memcpy(&ip, &ipv6_hdr(skb)->saddr, sizeof(ip));
 		bucket = &table_v6[hsiphash_3u32(net_word, ip >> 32, ip, &key) &
 				   (table_size - 1)];
+		lock = bucket_lock(table_v6, bucket);
 	}
 #endif
 	else
 		return false;
+	now = ktime_get_coarse_boottime_ns();
 	rcu_read_lock();
 	hlist_for_each_entry_rcu(entry, bucket, hash) {
 		if (entry->net == net && entry->ip == ip) {
-			u64 now, tokens;
-			bool ret;
+			s64 next, prev;
 			/* Quasi-inspired by nft_limit.c, but this is actually a
 			 * slightly different algorithm. Namely, we incorporate
 			 * the burst as part of the maximum tokens, rather than
-			 * as part of the rate.
+			 * as part of the rate. The bucket is kept as the time at
+			 * which it is full again, which is now + TOKEN_MAX -
+			 * tokens, so that a single cmpxchg updates it without
+			 * any lock.
 			 */
-			spin_lock(&entry->lock);
-			now = ktime_get_coarse_boottime_ns();
-			tokens = min_t(u64, TOKEN_MAX,
-				       entry->tokens + now -
-					       entry->last_time_ns);
-			entry->last_time_ns = now;
-			ret = tokens >= PACKET_COST;
-			entry->tokens = ret ? tokens - PACKET_COST : tokens;
-			spin_unlock(&entry->lock);
+			prev = atomic64_read(&entry->next_ns);
+			do {
+				next = max_t(s64, prev, now) + PACKET_COST;
+				if (next - (s64)now > TOKEN_MAX) {
+					rcu_read_unlock();
+					return false;
+				}
+			} while (!atomic64_try_cmpxchg(&entry->next_ns, &prev,
+						       next));
 			rcu_read_unlock();
-			return ret;
+			return true;
 		}
+		stale |= entry_expired(entry, now);
 	}
 	rcu_read_unlock();
 
+	/* Rather than leaving them all to the gc work, drop the stale entries
+	 * of the buckets that are looked up, which are the ones that grow
+	 * during floods.
+	 */
+	if (stale) {
+		spin_lock(lock);
+		bucket_gc(bucket, now, false);
+		spin_unlock(lock);
+	}
+
 	if (atomic_inc_return(&total_entries) > max_entries)
 		goto err_oom;
 
@@ -142,12 +185,10 @@ bool wg_ratelimiter_allow(struct sk_buff *skb, struct net *net)
 	entry->net = net;
 	entry->ip = ip;
 	INIT_HLIST_NODE(&entry->hash);
-	spin_lock_init(&entry->lock);
-	entry->last_time_ns = ktime_get_coarse_boottime_ns();
-	entry->tokens = TOKEN_MAX - PACKET_COST;
-	spin_lock(&table_lock);
+	atomic64_set(&entry->next_ns, now + PACKET_COST);
+	spin_lock(lock);
 	hlist_add_head_rcu(&entry->hash, bucket);
-	spin_unlock(&table_lock);
+	spin_unlock(lock);
 	return true;
 
 err_oom:
@@ -157,6 +198,8 @@ bool wg_ratelimiter_allow(struct sk_buff *skb, struct net *net)
 
 int wg_ratelimiter_init(void)
 {
+	unsigned int i;
+
 	mutex_lock(&init_lock);
 	if (++init_refcnt != 1)
 		goto out;
@@ -175,16 +218,25 @@ int wg_ratelimiter_init(void)
 			(totalram_pages() << PAGE_SHIFT) /
 			(1U << 14) / sizeof(struct hlist_head)));
 	max_entries = table_size * 8;
+	/* A few shards per CPU are enough to keep inserts from contending. */
+	lock_mask = min_t(unsigned int, table_size,
+			  roundup_pow_of_two(num_possible_cpus() * 4)) - 1;
+
+	table_locks = kvcalloc(lock_mask + 1, sizeof(*table_locks), GFP_KERNEL);
+	if (unlikely(!table_locks))
+		goto err_kmemcache;
+	for (i = 0; i <= lock_mask; ++i)
+		spin_lock_init(&table_locks[i].lock);
 
 	table_v4 = kvcalloc(table_size, sizeof(*table_v4), GFP_KERNEL);
 	if (unlikely(!table_v4))
-		goto err_kmemcache;
+		goto err_locks;
 
 #if IS_ENABLED(CONFIG_IPV6)
 	table_v6 = kvcalloc(table_size, sizeof(*table_v6), GFP_KERNEL);
 	if (unlikely(!table_v6)) {
 		kvfree(table_v4);
-		goto err_kmemcache;
+		goto err_locks;
 	}
 #endif
 
@@ -194,6 +246,8 @@ int wg_ratelimiter_init(void)
 	mutex_unlock(&init_lock);
 	return 0;
 
+err_locks:
+	kvfree(table_locks);
 err_kmemcache:
 	kmem_cache_destroy(entry_cache);
 err:
@@ -215,6 +269,7 @@ void wg_ratelimiter_uninit(void)
 #if IS_ENABLED(CONFIG_IPV6)
 	kvfree(table_v6);
 #endif
+	kvfree(table_locks);
 	kmem_cache_destroy(entry_cache);
 out:
 	mutex_unlock(&init_lock);
@@ -159,10 +159,25 @@ static unsigned int calculate_skb_padding(struct sk_buff *skb)
 	return padded_size - last_unit;
 }
 
-static bool encrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair)
+/* Most packets are linear once their trailer is added and take a single entry. */
+#define ENCRYPT_BATCH_SG 2
+
+/* Packets of a bundle waiting to be encrypted together. */
+struct encrypt_batch {
+	struct chacha20poly1305_sg_req reqs[CHACHA20POLY1305_BATCH_MAX];
+	struct scatterlist sg[CHACHA20POLY1305_BATCH_MAX][ENCRYPT_BATCH_SG];
+	struct sk_buff *skbs[CHACHA20POLY1305_BATCH_MAX];
+	unsigned int nr;
+};
+
+/* Pads the packet and adds its header and room for the auth tag. Returns the
+ * number of scatterlist entries it spans, or a negative value on failure.
+ */
+static int encrypt_packet_prepare(struct sk_buff *skb,
+				  struct noise_keypair *keypair,
+				  unsigned int *plaintext_len)
 {
-	unsigned int padding_len, plaintext_len, trailer_len;
-	struct scatterlist sg[MAX_SKB_FRAGS + 8];
+	unsigned int padding_len, trailer_len;
 	struct message_data *header;
 	struct sk_buff *trailer;
 	int num_frags;
@@ -175,12 +190,12 @@ static bool encrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair)
 	/* Calculate lengths. */
 	padding_len = calculate_skb_padding(skb);
 	trailer_len = padding_len + noise_encrypted_len(0);
-	plaintext_len = skb->len + padding_len;
+	*plaintext_len = skb->len + padding_len;
 
 	/* Expand data section to have room for padding and auth tag. */
 	num_frags = skb_cow_data(skb, trailer_len, &trailer);
-	if (unlikely(num_frags < 0 || num_frags > ARRAY_SIZE(sg)))
-		return false;
+	if (unlikely(num_frags < 0))
+		return -1;
 
 	/* Set the padding to zeros, and make sure it and the auth tag are part
 	 * of the skb.
@@ -191,12 +206,12 @@ static bool encrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair)
 	 * stack's headers.
 	 */
 	if (unlikely(skb_cow_head(skb, DATA_PACKET_HEAD_ROOM) < 0))
-		return false;
+		return -1;
 
 	/* Finalize checksum calculation for the inner packet, if required. */
 	if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL &&
 		     skb_checksum_help(skb)))
-		return false;
+		return -1;
 
 	/* Only after checksumming can we safely add on the padding at the end
 	 * and the header.
@@ -207,17 +222,81 @@ static bool encrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair)
 	header->key_idx = keypair->remote_index;
 	header->counter = cpu_to_le64(PACKET_CB(skb)->nonce);
 	pskb_put(skb, trailer, trailer_len);
+	return num_frags;
+}
 
-	/* Now we can encrypt the scattergather segments */
+static bool encrypt_packet_sg(struct sk_buff *skb, struct scatterlist *sg,
+			      int num_frags, unsigned int plaintext_len)
+{
 	sg_init_table(sg, num_frags);
-	if (skb_to_sgvec(skb, sg, sizeof(struct message_data),
-			 noise_encrypted_len(plaintext_len)) <= 0)
+	return skb_to_sgvec(skb, sg, sizeof(struct message_data),
+			    noise_encrypted_len(plaintext_len)) > 0;
+}
+
+/* Out of line to keep its scatterlist off the stack of the common case. */
+static noinline bool encrypt_packet_large(struct sk_buff *skb, int num_frags,
+					  unsigned int plaintext_len,
+					  struct noise_keypair *keypair)
+{
+	struct scatterlist sg[MAX_SKB_FRAGS + 8];
+
+	if (unlikely(num_frags > ARRAY_SIZE(sg)) ||
+	    !encrypt_packet_sg(skb, sg, num_frags, plaintext_len))
 		return false;
 	return chacha20poly1305_encrypt_sg_inplace(sg, plaintext_len, NULL, 0,
 						   PACKET_CB(skb)->nonce,
 						   keypair->sending.key);
 }
 
+static bool encrypt_batch_flush(struct encrypt_batch *batch,
+				struct noise_keypair *keypair)
+{
+	unsigned int i, nr = batch->nr;
+
+	batch->nr = 0;
+	if (unlikely(!chacha20poly1305_encrypt_sg_inplace_batch(batch->reqs, nr,
+								keypair->sending.key)))
+		return false;
+	for (i = 0; i < nr; ++i)
+		wg_reset_packet(batch->skbs[i], true);
+	return true;
+}
+
+/* Queues the packet on the batch, which is encrypted once full, unless it spans
+ * too many fragments, in which case it is encrypted right away.
+ */
+static bool encrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair,
+			   struct encrypt_batch *batch)
+{
+	unsigned int plaintext_len;
+	struct scatterlist *sg;
+	int num_frags;
+
+	num_frags = encrypt_packet_prepare(skb, keypair, &plaintext_len);
+	if (unlikely(num_frags < 0))
+		return false;
+
+	if (unlikely(num_frags > ENCRYPT_BATCH_SG)) {
+		if (!encrypt_packet_large(skb, num_frags, plaintext_len, keypair))
+			return false;
+		wg_reset_packet(skb, true);
+		return true;
+	}
+
+	sg = batch->sg[batch->nr];
+	if (unlikely(!encrypt_packet_sg(skb, sg, num_frags, plaintext_len)))
+		return false;
+	batch->reqs[batch->nr] = (struct chacha20poly1305_sg_req){
+		.src = sg,
+		.src_len = plaintext_len,
+		.nonce = PACKET_CB(skb)->nonce,
+	};
+	batch->skbs[batch->nr] = skb;
+	if (++batch->nr == CHACHA20POLY1305_BATCH_MAX)
+		return encrypt_batch_flush(batch, keypair);
+	return true;
+}
+
 void wg_packet_send_keepalive(struct wg_peer *peer)
 {
 	struct sk_buff *skb;
@@ -239,6 +318,62 @@ void wg_packet_send_keepalive(struct wg_peer *peer)
 	wg_packet_send_staged_packets(peer);
 }
 
+/* Largest UDP GSO super-packet, leaving room for the IP and UDP headers. */
+#define WG_GSO_MAX_SIZE (U16_MAX - sizeof(struct ipv6hdr) - sizeof(struct udphdr))
+
+/* Merges skb and the datagrams following it of the same size and DS field
+ * into one UDP GSO super-packet, the last one of which may be shorter, so
+ * that the underlay routes and queues them once. *next is moved past the
+ * merged datagrams. Returns skb as is if there is nothing to merge with.
+ */
+static struct sk_buff *wg_packet_coalesce(struct sk_buff *skb, struct sk_buff **next)
+{
+	unsigned int mss = skb->len, len = skb->len, segs = 1;
+	struct sk_buff *seg, *tail, *gso;
+	u8 ds = PACKET_CB(skb)->ds;
+
+	for (tail = *next; tail && segs < UDP_MAX_SEGMENTS; tail = tail->next) {
+		if (tail->len > mss || PACKET_CB(tail)->ds != ds ||
+		    len + tail->len > WG_GSO_MAX_SIZE)
+			break;
+		len += tail->len;
+		++segs;
+		if (tail->len < mss) {
+			tail = tail->next;
+			break;
+		}
+	}
+	if (segs == 1)
+		return skb;
+
+	gso = alloc_skb(SKB_HEADER_LEN + len, GFP_ATOMIC);
+	if (unlikely(!gso))
+		return skb;
+	skb_reserve(gso, SKB_HEADER_LEN);
+	for (seg = skb; seg != tail; seg = seg->next) {
+		if (unlikely(skb_copy_bits(seg, 0, skb_put(gso, seg->len),
+					   seg->len))) {
+			kfree_skb(gso);
+			return skb;
+		}
+	}
+
+	for (seg = skb; seg != tail; seg = *next) {
+		*next = seg->next;
+		consume_skb(seg);
+	}
+
+	PACKET_CB(gso)->ds = ds;
+	skb_shinfo(gso)->gso_size = mss;
+	skb_shinfo(gso)->gso_segs = segs;
+	skb_shinfo(gso)->gso_type = SKB_GSO_UDP_L4;
+	/* The UDP header is pushed right in front of the data on transmit. */
+	gso->ip_summed = CHECKSUM_PARTIAL;
+	gso->csum_start = skb_headroom(gso) - sizeof(struct udphdr);
+	gso->csum_offset = offsetof(struct udphdr, check);
+	return gso;
+}
+
 static void wg_packet_create_data_done(struct wg_peer *peer, struct sk_buff *first)
 {
 	struct sk_buff *skb, *next;
@@ -248,6 +383,8 @@ static void wg_packet_create_data_done(struct wg_peer *peer, struct sk_buff *fir
 	wg_timers_any_authenticated_packet_sent(peer);
 	skb_list_walk_safe(first, skb, next) {
 		is_keepalive = skb->len == message_data_len(0);
+		if (!is_keepalive)
+			skb = wg_packet_coalesce(skb, &next);
 		if (likely(!wg_socket_send_skb_to_peer(peer, skb,
 				PACKET_CB(skb)->ds) && !is_keepalive))
 			data_sent = true;
@@ -289,19 +426,33 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
 	struct sk_buff *first, *skb, *next;
+	struct encrypt_batch batch;
 
 	while ((first = ptr_ring_consume_bh(&queue->ring)) != NULL) {
+		struct noise_keypair *keypair = PACKET_CB(first)->keypair;
 		enum packet_state state = PACKET_STATE_CRYPTED;
+		struct wg_peer *peer = keypair->entry.peer;
+		u64 start = ktime_get_ns();
 
+		this_cpu_inc(peer->stats->tx_queue_wait[
+			wg_peer_stats_bucket(start - PACKET_CB(first)->queued_ns)]);
+
+		/* The packets of a bundle all belong to the same peer and
+		 * keypair, so they are encrypted in batches.
+		 */
+		batch.nr = 0;
 		skb_list_walk_safe(first, skb, next) {
-			if (likely(encrypt_packet(skb,
-					PACKET_CB(first)->keypair))) {
-				wg_reset_packet(skb, true);
-			} else {
+			if (unlikely(!encrypt_packet(skb, keypair, &batch))) {
 				state = PACKET_STATE_DEAD;
 				break;
 			}
 		}
+		if (likely(state == PACKET_STATE_CRYPTED) && batch.nr &&
+		    unlikely(!encrypt_batch_flush(&batch, keypair)))
+			state = PACKET_STATE_DEAD;
+		/* The peer may go away once the bundle is handed back. */
+		this_cpu_inc(peer->stats->tx_crypt_time[
+			wg_peer_stats_bucket(ktime_get_ns() - start)]);
 		wg_queue_enqueue_per_peer_tx(first, state);
 		if (need_resched())
 			cond_resched();
@@ -318,7 +469,7 @@ static void wg_packet_create_data(struct wg_peer *peer, struct sk_buff *first)
 		goto err;
 
 	ret = wg_queue_enqueue_per_device_and_peer(&wg->encrypt_queue, &peer->tx_queue, first,
-						   wg->packet_crypt_wq, &wg->encrypt_queue.last_cpu);
+						   wg);
 	if (unlikely(ret == -EPIPE))
 		wg_queue_enqueue_per_peer_tx(first, PACKET_STATE_DEAD);
 err:
@@ -391,6 +542,7 @@ void wg_packet_send_staged_packets(struct wg_peer *peer)
 	WRITE_ONCE(keypair->sending.is_valid, false);
 out_nokey:
 	wg_noise_keypair_put(keypair, false);
+	this_cpu_inc(peer->stats->handshake_waits);
 
 	/* We orphan the packets if we're waiting on a handshake, so that they
 	 * don't block a socket's pool.
@@ -344,6 +344,11 @@ static void set_sock_opts(struct socket *sock)
 	sock->sk->sk_allocation = GFP_ATOMIC;
 	sock->sk->sk_sndbuf = INT_MAX;
 	sk_set_memalloc(sock->sk);
+	/* Let the underlay aggregate incoming datagrams. They are segmented
+	 * again before wg_receive(), as the socket does not accept UDP GSO
+	 * packets, but only after going up the stack once.
+	 */
+	udp_sk(sock->sk)->gro_enabled = 1;
 }
 
 int wg_socket_init(struct wg_device *wg, u16 port)
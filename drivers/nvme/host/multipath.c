@@ -17,6 +17,8 @@ MODULE_PARM_DESC(multipath,
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_QD]	= "queue-depth",
+	[NVME_IOPOLICY_LAT]	= "latency",
 };
 
 static int iopolicy = NVME_IOPOLICY_NUMA;
@@ -29,6 +31,10 @@ static int nvme_set_iopolicy(const char *val, const struct kernel_param *kp)
 		iopolicy = NVME_IOPOLICY_NUMA;
 	else if (!strncmp(val, "round-robin", 11))
 		iopolicy = NVME_IOPOLICY_RR;
+	else if (!strncmp(val, "queue-depth", 11))
+		iopolicy = NVME_IOPOLICY_QD;
+	else if (!strncmp(val, "latency", 7))
+		iopolicy = NVME_IOPOLICY_LAT;
 	else
 		return -EINVAL;
 
@@ -43,13 +49,63 @@ static int nvme_get_iopolicy(char *buf, const struct kernel_param *kp)
 module_param_call(iopolicy, nvme_set_iopolicy, nvme_get_iopolicy,
 	&iopolicy, 0644);
 MODULE_PARM_DESC(iopolicy,
-	"Default multipath I/O policy; 'numa' (default) or 'round-robin'");
+	"Default multipath I/O policy; 'numa' (default), 'round-robin', 'queue-depth' or 'latency'");
 
 void nvme_mpath_default_iopolicy(struct nvme_subsystem *subsys)
 {
 	subsys->iopolicy = iopolicy;
 }
 
+/*
+ * The queue-depth and latency I/O policies account the I/O in flight on each
+ * controller, and the latter an average of the latency of its I/O. The
+ * requests are flagged so that the accounting stays balanced when the
+ * policy is changed while they are in flight.
+ */
+void nvme_mpath_start_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	int policy = READ_ONCE(ns->head->subsys->iopolicy);
+
+	if (policy != NVME_IOPOLICY_QD && policy != NVME_IOPOLICY_LAT)
+		return;
+
+	atomic_inc(&ns->ctrl->nr_active);
+	nvme_req(rq)->flags |= NVME_MPATH_CNT_ACTIVE;
+	if (policy == NVME_IOPOLICY_LAT) {
+		nvme_req(rq)->start_time = ktime_get_ns();
+		nvme_req(rq)->flags |= NVME_MPATH_CNT_LATENCY;
+	}
+}
+EXPORT_SYMBOL_GPL(nvme_mpath_start_request);
+
+/* weight of a new sample in the average latency, as a power of two */
+#define NVME_MPATH_LATENCY_SHIFT	3
+
+void nvme_mpath_end_request(struct request *rq)
+{
+	struct nvme_ctrl *ctrl = nvme_req(rq)->ctrl;
+	u8 flags = nvme_req(rq)->flags;
+	s64 latency, avg;
+
+	if (!(flags & NVME_MPATH_CNT_ACTIVE))
+		return;
+
+	atomic_dec(&ctrl->nr_active);
+	if (flags & NVME_MPATH_CNT_LATENCY) {
+		/* racing updates lose a sample, which doesn't matter here */
+		latency = ktime_get_ns() - nvme_req(rq)->start_time;
+		avg = READ_ONCE(ctrl->latency_ewma);
+		if (avg)
+			avg += (latency - avg) >> NVME_MPATH_LATENCY_SHIFT;
+		else
+			avg = latency;
+		WRITE_ONCE(ctrl->latency_ewma, max_t(s64, avg, 1));
+	}
+	nvme_req(rq)->flags &= ~(NVME_MPATH_CNT_ACTIVE |
+				 NVME_MPATH_CNT_LATENCY);
+}
+
 void nvme_mpath_unfreeze(struct nvme_subsystem *subsys)
 {
 	struct nvme_ns_head *h;
@@ -296,6 +352,60 @@ static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
 	return found;
 }
 
+/*
+ * Cost of sending an I/O down a path: its I/O in flight for the queue-depth
+ * policy, and the time they take to complete for the latency policy. A path
+ * with no latency measured yet only gets a single I/O at a time until it has.
+ */
+static u64 nvme_path_cost(struct nvme_ns *ns, int policy)
+{
+	unsigned int depth = atomic_read(&ns->ctrl->nr_active);
+	u64 latency;
+
+	if (policy == NVME_IOPOLICY_QD)
+		return depth;
+
+	latency = READ_ONCE(ns->ctrl->latency_ewma);
+	if (!latency)
+		return depth ? U64_MAX - 1 : 0;
+	return latency * (depth + 1);
+}
+
+static struct nvme_ns *nvme_least_loaded_path(struct nvme_ns_head *head,
+		int policy)
+{
+	struct nvme_ns *best_opt = NULL, *best_nonopt = NULL, *ns;
+	u64 min_opt = U64_MAX, min_nonopt = U64_MAX, cost;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		cost = nvme_path_cost(ns, policy);
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (cost < min_opt) {
+				min_opt = cost;
+				best_opt = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (cost < min_nonopt) {
+				min_nonopt = cost;
+				best_nonopt = ns;
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (!min_opt)
+			break;
+	}
+
+	return best_opt ? best_opt : best_nonopt;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -304,14 +414,18 @@ static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 
 inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 {
+	int policy = READ_ONCE(head->subsys->iopolicy);
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	if (policy == NVME_IOPOLICY_QD || policy == NVME_IOPOLICY_LAT)
+		return nvme_least_loaded_path(head, policy);
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (unlikely(!ns))
 		return __nvme_find_path(head, node);
 
-	if (READ_ONCE(head->subsys->iopolicy) == NVME_IOPOLICY_RR)
+	if (policy == NVME_IOPOLICY_RR)
 		return nvme_round_robin_path(head, node, ns);
 	if (unlikely(!nvme_path_is_optimized(ns)))
 		return __nvme_find_path(head, node);
@@ -795,6 +909,26 @@ static ssize_t ana_state_show(struct device *dev, struct device_attribute *attr,
 }
 DEVICE_ATTR_RO(ana_state);
 
+static ssize_t queue_depth_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&ns->ctrl->nr_active));
+}
+DEVICE_ATTR_RO(queue_depth);
+
+static ssize_t latency_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%llu\n",
+			  div_u64(READ_ONCE(ns->ctrl->latency_ewma),
+				  NSEC_PER_USEC));
+}
+DEVICE_ATTR_RO(latency_us);
+
 static int nvme_lookup_ana_group_desc(struct nvme_ctrl *ctrl,
 		struct nvme_ana_group_desc *desc, void *data)
 {
@@ -11,7 +11,9 @@
 #include <linux/blk-mq.h>
 #include <linux/blk-mq-pci.h>
 #include <linux/blk-integrity.h>
+#include <linux/debugfs.h>
 #include <linux/dmi.h>
+#include <linux/hrtimer.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
@@ -100,6 +102,17 @@ static unsigned int poll_queues;
 module_param_cb(poll_queues, &io_queue_count_ops, &poll_queues, 0644);
 MODULE_PARM_DESC(poll_queues, "Number of queues to use for polled IO.");
 
+static bool hybrid_poll;
+module_param(hybrid_poll, bool, 0644);
+MODULE_PARM_DESC(hybrid_poll,
+	"Sleep for half the expected completion time of a lone polled IO "
+	"before polling for it.");
+
+/* Polled IO latency buckets: read/write for 512B to 64KB+ */
+#define NVME_POLL_BKTS		16
+
+static struct dentry *nvme_pci_debugfs_root;
+
 static bool noacpi;
 module_param(noacpi, bool, 0444);
 MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
@@ -160,6 +173,7 @@ struct nvme_dev {
 	unsigned int nr_poll_queues;
 
 	bool attrs_added;
+	struct dentry *debugfs;
 };
 
 static int io_queue_depth_set(const char *val, const struct kernel_param *kp)
@@ -210,11 +224,18 @@ struct nvme_queue {
 #define NVMEQ_SQ_CMB		1
 #define NVMEQ_DELETE_ERROR	2
 #define NVMEQ_POLLED		3
+#define NVMEQ_POLL_SLEEP	4
 	u32 *dbbuf_sq_db;
 	u32 *dbbuf_cq_db;
 	u32 *dbbuf_sq_ei;
 	u32 *dbbuf_cq_ei;
 	struct completion delete_done;
+	/* hybrid polling, only used for poll queues: */
+	atomic_t poll_inflight;
+	u64 poll_submit_time;
+	u8 poll_submit_bkt;
+	unsigned long poll_sleeps;
+	u64 poll_lat[NVME_POLL_BKTS];
 };
 
 /*
@@ -234,6 +255,8 @@ struct nvme_iod {
 	dma_addr_t first_dma;
 	dma_addr_t meta_dma;
 	struct sg_table sgt;
+	u64 poll_start;		/* submission time, for hybrid polling */
+	u8 poll_bkt;
 };
 
 static inline unsigned int nvme_dbbuf_size(struct nvme_dev *dev)
@@ -889,6 +912,70 @@ static blk_status_t nvme_map_metadata(struct nvme_dev *dev, struct request *req,
 	return BLK_STS_OK;
 }
 
+/*
+ * Hybrid polling keeps an average of the completion time of the polled IO of
+ * each queue, by direction and size. A poller waiting for a lone IO sleeps
+ * for half of that time before it starts spinning.
+ */
+static inline int nvme_poll_bkt(struct request *req)
+{
+	int bkt = ilog2(max(blk_rq_sectors(req), 1U));
+
+	return rq_data_dir(req) + 2 * min(bkt, NVME_POLL_BKTS / 2 - 1);
+}
+
+static void nvme_poll_start(struct nvme_queue *nvmeq, struct request *req)
+{
+	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
+
+	iod->poll_start = 0;
+	if (!READ_ONCE(hybrid_poll) || !test_bit(NVMEQ_POLLED, &nvmeq->flags))
+		return;
+
+	iod->poll_start = ktime_get_ns();
+	iod->poll_bkt = nvme_poll_bkt(req);
+	atomic_inc(&nvmeq->poll_inflight);
+	WRITE_ONCE(nvmeq->poll_submit_time, iod->poll_start);
+	WRITE_ONCE(nvmeq->poll_submit_bkt, iod->poll_bkt);
+	set_bit(NVMEQ_POLL_SLEEP, &nvmeq->flags);
+}
+
+static void nvme_poll_end(struct nvme_queue *nvmeq, struct nvme_iod *iod)
+{
+	u64 lat = ktime_get_ns() - iod->poll_start;
+	u64 avg = READ_ONCE(nvmeq->poll_lat[iod->poll_bkt]);
+
+	/* concurrent pollers may lose a sample, which doesn't matter */
+	avg = avg ? avg - (avg >> 3) + (lat >> 3) : lat;
+	WRITE_ONCE(nvmeq->poll_lat[iod->poll_bkt], avg);
+	iod->poll_start = 0;
+	atomic_dec(&nvmeq->poll_inflight);
+}
+
+static void nvme_poll_hybrid_sleep(struct nvme_queue *nvmeq)
+{
+	u64 expected, elapsed;
+	ktime_t kt;
+
+	/* sleep once per submission, and only when a single IO is pending */
+	if (!test_bit(NVMEQ_POLL_SLEEP, &nvmeq->flags) ||
+	    !test_and_clear_bit(NVMEQ_POLL_SLEEP, &nvmeq->flags))
+		return;
+	if (atomic_read(&nvmeq->poll_inflight) != 1)
+		return;
+
+	expected = READ_ONCE(nvmeq->poll_lat[READ_ONCE(nvmeq->poll_submit_bkt)]);
+	expected /= 2;
+	elapsed = ktime_get_ns() - READ_ONCE(nvmeq->poll_submit_time);
+	if (elapsed >= expected)
+		return;
+
+	kt = ns_to_ktime(expected - elapsed);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&kt, HRTIMER_MODE_REL);
+	nvmeq->poll_sleeps++;
+}
+
 static blk_status_t nvme_prep_rq(struct nvme_dev *dev, struct request *req)
 {
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
@@ -914,7 +1001,8 @@ static blk_status_t nvme_prep_rq(struct nvme_dev *dev, struct request *req)
 			goto out_unmap_data;
 	}
 
-	blk_mq_start_request(req);
+	nvme_start_request(req);
+	nvme_poll_start(req->mq_hctx->driver_data, req);
 	return BLK_STS_OK;
 out_unmap_data:
 	nvme_unmap_data(dev, req);
@@ -1017,10 +1105,12 @@ static __always_inline void nvme_pci_unmap_rq(struct request *req)
 {
 	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_dev *dev = nvmeq->dev;
+	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 
-	if (blk_integrity_rq(req)) {
-	        struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
+	if (unlikely(iod->poll_start))
+		nvme_poll_end(nvmeq, iod);
 
+	if (blk_integrity_rq(req)) {
 		dma_unmap_page(dev->dev, iod->meta_dma,
 			       rq_integrity_vec(req)->bv_len, rq_data_dir(req));
 	}
@@ -1168,9 +1258,8 @@ static void nvme_poll_irqdisable(struct nvme_queue *nvmeq)
 	enable_irq(pci_irq_vector(pdev, nvmeq->cq_vector));
 }
 
-static int nvme_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
+static int __nvme_poll(struct nvme_queue *nvmeq, struct io_comp_batch *iob)
 {
-	struct nvme_queue *nvmeq = hctx->driver_data;
 	bool found;
 
 	if (!nvme_cqe_pending(nvmeq))
@@ -1183,6 +1272,16 @@ static int nvme_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 	return found;
 }
 
+static int nvme_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
+{
+	struct nvme_queue *nvmeq = hctx->driver_data;
+
+	if (READ_ONCE(hybrid_poll) && !nvme_cqe_pending(nvmeq))
+		nvme_poll_hybrid_sleep(nvmeq);
+
+	return __nvme_poll(nvmeq, iob);
+}
+
 static void nvme_pci_submit_async_event(struct nvme_ctrl *ctrl)
 {
 	struct nvme_dev *dev = to_nvme_dev(ctrl);
@@ -1362,7 +1461,7 @@ static enum blk_eh_timer_return nvme_timeout(struct request *req)
 	 * Did we miss an interrupt?
 	 */
 	if (test_bit(NVMEQ_POLLED, &nvmeq->flags))
-		nvme_poll(req->mq_hctx, NULL);
+		__nvme_poll(nvmeq, NULL);
 	else
 		nvme_poll_irqdisable(nvmeq);
 
@@ -3088,6 +3187,28 @@ static void nvme_async_probe(void *data, async_cookie_t cookie)
 	nvme_put_ctrl(&dev->ctrl);
 }
 
+static int nvme_hybrid_poll_show(struct seq_file *m, void *unused)
+{
+	struct nvme_dev *dev = m->private;
+	unsigned int i, bkt;
+
+	for (i = 1; i < dev->nr_allocated_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+
+		if (!test_bit(NVMEQ_POLLED, &nvmeq->flags))
+			continue;
+
+		seq_printf(m, "queue %u: inflight %d sleeps %lu latency_ns", i,
+			   atomic_read(&nvmeq->poll_inflight),
+			   READ_ONCE(nvmeq->poll_sleeps));
+		for (bkt = 0; bkt < NVME_POLL_BKTS; bkt++)
+			seq_printf(m, " %llu", READ_ONCE(nvmeq->poll_lat[bkt]));
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvme_hybrid_poll);
+
 static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 {
 	int node, result = -ENOMEM;
@@ -3161,6 +3282,11 @@ static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 
 	dev_info(dev->ctrl.device, "pci function %s\n", dev_name(&pdev->dev));
 
+	dev->debugfs = debugfs_create_dir(dev_name(&pdev->dev),
+					  nvme_pci_debugfs_root);
+	debugfs_create_file("hybrid_poll", 0400, dev->debugfs, dev,
+			    &nvme_hybrid_poll_fops);
+
 	nvme_reset_ctrl(&dev->ctrl);
 	async_schedule(nvme_async_probe, dev);
 
@@ -3237,6 +3363,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	nvme_remove_namespaces(&dev->ctrl);
 	nvme_dev_disable(dev, true);
 	nvme_remove_attrs(dev);
+	debugfs_remove_recursive(dev->debugfs);
 	nvme_free_host_mem(dev);
 	nvme_dev_remove_admin(dev);
 	nvme_free_queues(dev, 0);
@@ -3587,6 +3714,8 @@ static struct pci_driver nvme_driver = {
 
 static int __init nvme_init(void)
 {
+	int ret;
+
 	BUILD_BUG_ON(sizeof(struct nvme_create_cq) != 64);
 	BUILD_BUG_ON(sizeof(struct nvme_create_sq) != 64);
 	BUILD_BUG_ON(sizeof(struct nvme_delete_queue) != 64);
@@ -3594,12 +3723,17 @@ static int __init nvme_init(void)
 	BUILD_BUG_ON(DIV_ROUND_UP(nvme_pci_npages_prp(), NVME_CTRL_PAGE_SIZE) >
 		     S8_MAX);
 
-	return pci_register_driver(&nvme_driver);
+	nvme_pci_debugfs_root = debugfs_create_dir("nvme-pci", NULL);
+	ret = pci_register_driver(&nvme_driver);
+	if (ret)
+		debugfs_remove_recursive(nvme_pci_debugfs_root);
+	return ret;
 }
 
 static void __exit nvme_exit(void)
 {
 	pci_unregister_driver(&nvme_driver);
+	debugfs_remove_recursive(nvme_pci_debugfs_root);
 	flush_workqueue(nvme_wq);
 }
 
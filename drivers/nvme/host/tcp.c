@@ -8,6 +8,7 @@
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/err.h>
+#include <linux/debugfs.h>
 #include <linux/nvme-tcp.h>
 #include <net/sock.h>
 #include <net/tcp.h>
@@ -30,6 +31,9 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/* number of sends io_work makes before it looks at the receive side */
+#define NVME_TCP_SEND_BUDGET	16
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 /* lockdep can detect a circular dependency of the form
  *   sk_lock -> mmap_lock (page fault) -> fs locks -> sk_lock
@@ -132,6 +136,9 @@ struct nvme_tcp_queue {
 
 	/* send state */
 	struct nvme_tcp_request *request;
+	unsigned long		nr_send_batches;
+	unsigned long		nr_send_reqs;
+	unsigned int		max_send_batch;
 
 	u32			maxh2cdata;
 	size_t			cmnd_capsule_len;
@@ -169,11 +176,13 @@ struct nvme_tcp_ctrl {
 	struct delayed_work	connect_work;
 	struct nvme_tcp_request async_req;
 	u32			io_queues[HCTX_MAX_TYPES];
+	struct dentry		*debugfs;
 };
 
 static LIST_HEAD(nvme_tcp_ctrl_list);
 static DEFINE_MUTEX(nvme_tcp_ctrl_mutex);
 static struct workqueue_struct *nvme_tcp_wq;
+static struct dentry *nvme_tcp_debugfs_root;
 static const struct blk_mq_ops nvme_tcp_mq_ops;
 static const struct blk_mq_ops nvme_tcp_admin_mq_ops;
 static int nvme_tcp_try_send(struct nvme_tcp_queue *queue);
@@ -305,14 +314,49 @@ static inline void nvme_tcp_advance_req(struct nvme_tcp_request *req,
 	}
 }
 
+static inline void nvme_tcp_account_batch(struct nvme_tcp_queue *queue,
+		unsigned long sent)
+{
+	if (!sent)
+		return;
+	queue->nr_send_batches++;
+	queue->max_send_batch = max_t(unsigned int, queue->max_send_batch,
+				      sent);
+}
+
 static inline void nvme_tcp_send_all(struct nvme_tcp_queue *queue)
 {
+	unsigned long sent = queue->nr_send_reqs;
 	int ret;
 
 	/* drain the send queue as much as we can... */
 	do {
 		ret = nvme_tcp_try_send(queue);
 	} while (ret > 0);
+	nvme_tcp_account_batch(queue, queue->nr_send_reqs - sent);
+}
+
+/*
+ * Send several PDUs in a row, the ones of the requests queued behind are
+ * sent with MSG_MORE and coalesced into the same segments.
+ */
+static int nvme_tcp_send_batch(struct nvme_tcp_queue *queue)
+{
+	unsigned long sent = queue->nr_send_reqs;
+	int budget = NVME_TCP_SEND_BUDGET;
+	bool progress = false;
+	int ret;
+
+	do {
+		ret = nvme_tcp_try_send(queue);
+		if (ret > 0)
+			progress = true;
+	} while (ret > 0 && --budget);
+	nvme_tcp_account_batch(queue, queue->nr_send_reqs - sent);
+
+	if (ret < 0)
+		return ret;
+	return progress;
 }
 
 static inline bool nvme_tcp_queue_more(struct nvme_tcp_queue *queue)
@@ -333,10 +377,12 @@ static inline void nvme_tcp_queue_request(struct nvme_tcp_request *req,
 	/*
 	 * if we're the first on the send_list and we can try to send
 	 * directly, otherwise queue io_work. Also, only do that if we
-	 * are on the same cpu, so we don't introduce contention.
+	 * are on the same cpu, so we don't introduce contention. When
+	 * more requests follow, leave them all to io_work to send them
+	 * in one go.
 	 */
 	if (queue->io_cpu == raw_smp_processor_id() &&
-	    sync && empty && mutex_trylock(&queue->send_mutex)) {
+	    sync && last && empty && mutex_trylock(&queue->send_mutex)) {
 		nvme_tcp_send_all(queue);
 		mutex_unlock(&queue->send_mutex);
 	}
@@ -957,6 +1003,7 @@ static void nvme_tcp_state_change(struct sock *sk)
 static inline void nvme_tcp_done_send_req(struct nvme_tcp_queue *queue)
 {
 	queue->request = NULL;
+	queue->nr_send_reqs++;
 }
 
 static void nvme_tcp_fail_request(struct nvme_tcp_request *req)
@@ -1215,7 +1262,7 @@ static void nvme_tcp_io_work(struct work_struct *w)
 		int result;
 
 		if (mutex_trylock(&queue->send_mutex)) {
-			result = nvme_tcp_try_send(queue);
+			result = nvme_tcp_send_batch(queue);
 			mutex_unlock(&queue->send_mutex);
 			if (result > 0)
 				pending = true;
@@ -2207,10 +2254,29 @@ static void nvme_tcp_free_ctrl(struct nvme_ctrl *nctrl)
 
 	nvmf_free_options(nctrl->opts);
 free_ctrl:
+	debugfs_remove_recursive(ctrl->debugfs);
 	kfree(ctrl->queues);
 	kfree(ctrl);
 }
 
+static int nvme_tcp_queues_show(struct seq_file *m, void *unused)
+{
+	struct nvme_tcp_ctrl *ctrl = m->private;
+	int i;
+
+	for (i = 0; i < ctrl->ctrl.queue_count; i++) {
+		struct nvme_tcp_queue *queue = &ctrl->queues[i];
+
+		seq_printf(m, "queue %d: io_cpu %d reqs %lu batches %lu max_batch %u\n",
+			   i, READ_ONCE(queue->io_cpu),
+			   READ_ONCE(queue->nr_send_reqs),
+			   READ_ONCE(queue->nr_send_batches),
+			   READ_ONCE(queue->max_send_batch));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvme_tcp_queues);
+
 static void nvme_tcp_set_sg_null(struct nvme_command *c)
 {
 	struct nvme_sgl_desc *sg = &c->common.dptr.sgl;
@@ -2414,7 +2480,7 @@ static blk_status_t nvme_tcp_queue_rq(struct blk_mq_hw_ctx *hctx,
 	if (unlikely(ret))
 		return ret;
 
-	blk_mq_start_request(rq);
+	nvme_start_request(rq);
 
 	nvme_tcp_queue_request(req, true, bd->last);
 
@@ -2643,6 +2709,11 @@ static struct nvme_ctrl *nvme_tcp_create_ctrl(struct device *dev,
 	list_add_tail(&ctrl->list, &nvme_tcp_ctrl_list);
 	mutex_unlock(&nvme_tcp_ctrl_mutex);
 
+	ctrl->debugfs = debugfs_create_dir(dev_name(ctrl->ctrl.device),
+					   nvme_tcp_debugfs_root);
+	debugfs_create_file("queues", 0400, ctrl->debugfs, ctrl,
+			    &nvme_tcp_queues_fops);
+
 	return &ctrl->ctrl;
 
 out_uninit_ctrl:
@@ -2677,6 +2748,7 @@ static int __init nvme_tcp_init_module(void)
 	if (!nvme_tcp_wq)
 		return -ENOMEM;
 
+	nvme_tcp_debugfs_root = debugfs_create_dir("nvme_tcp", NULL);
 	nvmf_register_transport(&nvme_tcp_transport);
 	return 0;
 }
@@ -2693,6 +2765,7 @@ static void __exit nvme_tcp_cleanup_module(void)
 	mutex_unlock(&nvme_tcp_ctrl_mutex);
 	flush_workqueue(nvme_delete_wq);
 
+	debugfs_remove_recursive(nvme_tcp_debugfs_root);
 	destroy_workqueue(nvme_tcp_wq);
 }
 
@@ -3,15 +3,274 @@
  * Copyright (C) 2020 Western Digital Corporation or its affiliates.
  */
 
+#include <linux/bitmap.h>
 #include <linux/blkdev.h>
+#include <linux/moduleparam.h>
 #include <linux/vmalloc.h>
 #include "nvme.h"
 
+static bool zone_cache = true;
+module_param(zone_cache, bool, 0644);
+MODULE_PARM_DESC(zone_cache,
+	"report the zone state tracked from the command completions");
+
+/**
+ * struct nvme_zone_cache - zone state tracked from the command completions
+ * @lock: protects @valid and @zones
+ * @zone_shift: ilog2 of the zone size, in sectors
+ * @nr_zones: number of entries of @zones
+ * @valid: zones whose state is known
+ * @zones: state of the zones
+ *
+ * The state of a zone is known once reported by the device and is then
+ * kept up to date by the writes and the zone management commands going
+ * through the namespace, so that zone reports can be served without
+ * querying the device. A zone is reported by the device again after a
+ * failed command or a passthrough command that may have changed it. The
+ * cache is shared by the paths of the namespace.
+ */
+struct nvme_zone_cache {
+	spinlock_t lock;
+	unsigned int zone_shift;
+	unsigned int nr_zones;
+	unsigned long *valid;
+	struct blk_zone zones[];
+};
+
+static void nvme_zone_cache_invalidate(struct nvme_zone_cache *cache)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	bitmap_zero(cache->valid, cache->nr_zones);
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+static void nvme_zone_cache_init(struct nvme_ns *ns)
+{
+	struct nvme_ns_head *head = ns->head;
+	struct nvme_zone_cache *cache = READ_ONCE(head->zone_cache);
+	unsigned int nr_zones;
+
+	/* The zones are reported by the device on revalidation */
+	if (cache) {
+		nvme_zone_cache_invalidate(cache);
+		return;
+	}
+
+	nr_zones = get_capacity(ns->disk) >> ilog2(ns->zsze);
+	if (!nr_zones)
+		return;
+
+	/* Without the cache all the zone reports query the device */
+	cache = kvzalloc(struct_size(cache, zones, nr_zones), GFP_KERNEL);
+	if (!cache)
+		return;
+
+	cache->valid = bitmap_zalloc(nr_zones, GFP_KERNEL);
+	if (!cache->valid) {
+		kvfree(cache);
+		return;
+	}
+
+	spin_lock_init(&cache->lock);
+	cache->zone_shift = ilog2(ns->zsze);
+	cache->nr_zones = nr_zones;
+
+	/* Another path of the namespace may have set up the cache meanwhile */
+	if (cmpxchg_release(&head->zone_cache, NULL, cache)) {
+		bitmap_free(cache->valid);
+		kvfree(cache);
+	}
+}
+
+void nvme_zns_free_head(struct nvme_ns_head *head)
+{
+	struct nvme_zone_cache *cache = head->zone_cache;
+
+	if (!cache)
+		return;
+
+	bitmap_free(cache->valid);
+	kvfree(cache);
+}
+
+static void nvme_zone_cache_set(struct nvme_ns *ns, const struct blk_zone *zone)
+{
+	struct nvme_zone_cache *cache = READ_ONCE(ns->head->zone_cache);
+	unsigned long flags;
+	sector_t idx;
+
+	if (!cache)
+		return;
+
+	idx = zone->start >> cache->zone_shift;
+	if (idx >= cache->nr_zones)
+		return;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	cache->zones[idx] = *zone;
+	__set_bit(idx, cache->valid);
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+/* Report the zones from @sector on as long as their state is known */
+static int nvme_zone_cache_report(struct nvme_ns *ns, sector_t *sector,
+				  unsigned int nr_zones, report_zones_cb cb,
+				  void *data)
+{
+	struct nvme_zone_cache *cache = READ_ONCE(ns->head->zone_cache);
+	unsigned int zone_idx = 0;
+	struct blk_zone zone;
+	unsigned long flags;
+	sector_t idx;
+	bool valid;
+	int ret;
+
+	if (!zone_cache || !cache)
+		return 0;
+
+	while (zone_idx < nr_zones && *sector < get_capacity(ns->disk)) {
+		idx = *sector >> cache->zone_shift;
+		if (idx >= cache->nr_zones)
+			break;
+
+		spin_lock_irqsave(&cache->lock, flags);
+		valid = test_bit(idx, cache->valid);
+		if (valid)
+			zone = cache->zones[idx];
+		spin_unlock_irqrestore(&cache->lock, flags);
+		if (!valid)
+			break;
+
+		ret = cb(&zone, zone_idx, data);
+		if (ret)
+			return ret;
+
+		zone_idx++;
+		*sector += ns->zsze;
+	}
+
+	return zone_idx;
+}
+
+static void nvme_zone_cache_advance(struct blk_zone *zone, sector_t end)
+{
+	if (end > zone->wp)
+		zone->wp = end;
+
+	if (zone->wp >= zone->start + zone->capacity) {
+		zone->cond = BLK_ZONE_COND_FULL;
+		zone->wp = zone->start + zone->len;
+	} else if (zone->cond == BLK_ZONE_COND_EMPTY ||
+		   zone->cond == BLK_ZONE_COND_CLOSED) {
+		zone->cond = BLK_ZONE_COND_IMP_OPEN;
+	}
+}
+
+static bool nvme_zns_cmd_changes_zones(struct request *req)
+{
+	switch (nvme_req(req)->cmd->common.opcode) {
+	case nvme_cmd_write:
+	case nvme_cmd_write_zeroes:
+	case nvme_cmd_zone_append:
+	case nvme_cmd_zone_mgmt_send:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * nvme_zns_end_req - update the zone state on the completion of a request
+ * @req: completed request, the location of a zone append is already set
+ */
+void nvme_zns_end_req(struct request *req)
+{
+	struct nvme_ns *ns = req->q->queuedata;
+	struct nvme_zone_cache *cache;
+	struct blk_zone *zone;
+	unsigned long flags;
+	sector_t idx;
+
+	if (!blk_queue_is_zoned(req->q))
+		return;
+
+	cache = READ_ONCE(ns->head->zone_cache);
+	if (!cache)
+		return;
+
+	if (blk_rq_is_passthrough(req)) {
+		if (nvme_zns_cmd_changes_zones(req))
+			nvme_zone_cache_invalidate(cache);
+		return;
+	}
+
+	switch (req_op(req)) {
+	case REQ_OP_WRITE:
+	case REQ_OP_WRITE_ZEROES:
+	case REQ_OP_ZONE_APPEND:
+	case REQ_OP_ZONE_RESET:
+	case REQ_OP_ZONE_OPEN:
+	case REQ_OP_ZONE_CLOSE:
+	case REQ_OP_ZONE_FINISH:
+		break;
+	case REQ_OP_ZONE_RESET_ALL:
+		/* Offline and read only zones are left as they are */
+		nvme_zone_cache_invalidate(cache);
+		return;
+	default:
+		return;
+	}
+
+	idx = blk_rq_pos(req) >> cache->zone_shift;
+	if (idx >= cache->nr_zones)
+		return;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	if (!test_bit(idx, cache->valid))
+		goto unlock;
+
+	if (nvme_req(req)->status) {
+		__clear_bit(idx, cache->valid);
+		goto unlock;
+	}
+
+	zone = &cache->zones[idx];
+	switch (req_op(req)) {
+	case REQ_OP_ZONE_RESET:
+		zone->cond = BLK_ZONE_COND_EMPTY;
+		zone->wp = zone->start;
+		break;
+	case REQ_OP_ZONE_OPEN:
+		zone->cond = BLK_ZONE_COND_EXP_OPEN;
+		break;
+	case REQ_OP_ZONE_CLOSE:
+		if (zone->cond == BLK_ZONE_COND_EXP_OPEN ||
+		    zone->cond == BLK_ZONE_COND_IMP_OPEN)
+			zone->cond = zone->wp == zone->start ?
+				BLK_ZONE_COND_EMPTY : BLK_ZONE_COND_CLOSED;
+		break;
+	case REQ_OP_ZONE_FINISH:
+		zone->cond = BLK_ZONE_COND_FULL;
+		zone->wp = zone->start + zone->len;
+		break;
+	default:
+		nvme_zone_cache_advance(zone, blk_rq_pos(req) +
+					blk_rq_sectors(req));
+		break;
+	}
+unlock:
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
 int nvme_revalidate_zones(struct nvme_ns *ns)
 {
 	struct request_queue *q = ns->queue;
 	int ret;
 
+	nvme_zone_cache_init(ns);
+
 	ret = blk_revalidate_disk_zones(ns->disk, NULL);
 	if (!ret)
 		blk_queue_max_zone_append_sectors(q, ns->ctrl->max_zone_append);
@@ -171,6 +430,8 @@ static int nvme_zone_parse_entry(struct nvme_ns *ns,
 	else
 		zone.wp = nvme_lba_to_sect(ns, le64_to_cpu(entry->wp));
 
+	nvme_zone_cache_set(ns, &zone);
+
 	return cb(&zone, idx, data);
 }
 
@@ -186,7 +447,14 @@ int nvme_ns_report_zones(struct nvme_ns *ns, sector_t sector,
 	if (ns->head->ids.csi != NVME_CSI_ZNS)
 		return -EINVAL;
 
-	report = nvme_zns_alloc_report_buffer(ns, nr_zones, &buflen);
+	sector &= ~(ns->zsze - 1);
+	zone_idx = nvme_zone_cache_report(ns, &sector, nr_zones, cb, data);
+	if (zone_idx < 0)
+		return zone_idx;
+	if (zone_idx == nr_zones || sector >= get_capacity(ns->disk))
+		return zone_idx ? zone_idx : -EINVAL;
+
+	report = nvme_zns_alloc_report_buffer(ns, nr_zones - zone_idx, &buflen);
 	if (!report)
 		return -ENOMEM;
 
@@ -197,7 +465,6 @@ int nvme_ns_report_zones(struct nvme_ns *ns, sector_t sector,
 	c.zmr.zrasf = NVME_ZRASF_ZONE_REPORT_ALL;
 	c.zmr.pr = NVME_REPORT_ZONE_PARTIAL;
 
-	sector &= ~(ns->zsze - 1);
 	while (zone_idx < nr_zones && sector < get_capacity(ns->disk)) {
 		memset(report, 0, buflen);
 
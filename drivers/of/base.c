@@ -19,15 +19,22 @@
 #include <linux/console.h>
 #include <linux/ctype.h>
 #include <linux/cpu.h>
+#include <linux/hashtable.h>
+#include <linux/memblock.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/of_graph.h>
+#include <linux/sched/clock.h>
+#include <linux/sort.h>
 #include <linux/spinlock.h>
 #include <linux/slab.h>
 #include <linux/string.h>
+#include <linux/stringhash.h>
 #include <linux/proc_fs.h>
 
+#include <asm/sections.h>
+
 #include "of_private.h"
 
 LIST_HEAD(aliases_lookup);
@@ -188,6 +195,258 @@ void __init of_core_init(void)
 		proc_symlink("device-tree", NULL, "/sys/firmware/devicetree/base");
 }
 
+#ifdef CONFIG_OF_LOOKUP_INDEX
+/*
+ * The nodes of the tree unflattened at boot are indexed by the hashes of
+ * their full paths, and the properties of the nodes with many of them by
+ * name. The nodes attached later are found by walking the tree, and a
+ * node whose properties change loses its property index.
+ */
+#define OF_PROP_INDEX_MIN	16
+
+struct of_prop_index {
+	unsigned int count;
+	struct property *props[];
+};
+
+struct of_path_index_entry {
+	u32 hash;
+	struct device_node *np;
+};
+
+static struct of_path_index_entry *of_path_index;
+static unsigned int of_path_index_count;
+
+static unsigned long of_path_hash_node(const struct device_node *np)
+{
+	unsigned long hash;
+	const char *name;
+
+	if (!np->parent)
+		return init_name_hash(NULL);
+
+	hash = partial_name_hash('/', of_path_hash_node(np->parent));
+	for (name = kbasename(np->full_name); *name; name++)
+		hash = partial_name_hash(*name, hash);
+
+	return hash;
+}
+
+static int of_path_index_cmp(const void *a, const void *b)
+{
+	const struct of_path_index_entry *ea = a, *eb = b;
+
+	if (ea->hash != eb->hash)
+		return ea->hash < eb->hash ? -1 : 1;
+
+	return 0;
+}
+
+static int of_prop_index_cmp(const void *a, const void *b)
+{
+	const struct property * const *pa = a, * const *pb = b;
+
+	return of_prop_cmp((*pa)->name, (*pb)->name);
+}
+
+static unsigned int __init of_prop_index_count(const struct device_node *np)
+{
+	const struct property *pp;
+	unsigned int count = 0;
+
+	for (pp = np->properties; pp; pp = pp->next)
+		count++;
+
+	return count >= OF_PROP_INDEX_MIN ? count : 0;
+}
+
+static void __init of_prop_index_init(struct device_node *np,
+				      struct of_prop_index *idx,
+				      unsigned int count)
+{
+	struct property *pp;
+	unsigned int i = 0;
+
+	for (pp = np->properties; pp; pp = pp->next)
+		idx->props[i++] = pp;
+	idx->count = count;
+	sort(idx->props, count, sizeof(*idx->props), of_prop_index_cmp, NULL);
+
+	/* The list walk finds the first of duplicate names, keep to it */
+	for (i = 1; i < count; i++)
+		if (!of_prop_cmp(idx->props[i - 1]->name, idx->props[i]->name))
+			return;
+
+	np->prop_index = idx;
+}
+
+/**
+ * of_lookup_index_init - Index the nodes and properties of the live tree
+ *
+ * Called once the tree unflattened at boot is in place and before it is
+ * searched. Nothing is indexed if the memory cannot be allocated.
+ */
+void __init of_lookup_index_init(void)
+{
+	unsigned int nodes = 0, indexed = 0, props = 0, count, i = 0;
+	struct device_node *np;
+	void *mem;
+
+	for_each_of_allnodes(np) {
+		count = of_prop_index_count(np);
+		if (count) {
+			indexed++;
+			props += count;
+		}
+		nodes++;
+	}
+	if (!nodes)
+		return;
+
+	mem = memblock_alloc(nodes * sizeof(*of_path_index) +
+			     indexed * sizeof(struct of_prop_index) +
+			     props * sizeof(struct property *),
+			     __alignof__(struct of_path_index_entry));
+	if (!mem) {
+		pr_warn("no memory to index the device tree\n");
+		return;
+	}
+
+	of_path_index = mem;
+	mem += nodes * sizeof(*of_path_index);
+
+	for_each_of_allnodes(np) {
+		of_path_index[i].hash = end_name_hash(of_path_hash_node(np));
+		of_path_index[i].np = np;
+		i++;
+
+		count = of_prop_index_count(np);
+		if (count) {
+			of_prop_index_init(np, mem, count);
+			mem += struct_size((struct of_prop_index *)mem, props,
+					   count);
+		}
+	}
+	sort(of_path_index, nodes, sizeof(*of_path_index), of_path_index_cmp,
+	     NULL);
+	of_path_index_count = nodes;
+
+	pr_debug("indexed %u nodes, and %u properties of %u nodes\n",
+		 nodes, props, indexed);
+}
+
+/* Whether @np is still attached at @path, of @len characters */
+static bool of_path_index_match(const struct device_node *np,
+				const char *path, size_t len)
+{
+	const char *name;
+	size_t n;
+
+	for (; np->parent; np = np->parent) {
+		if (of_node_check_flag(np, OF_DETACHED))
+			return false;
+
+		name = kbasename(np->full_name);
+		n = strlen(name);
+		if (len < n + 1 || path[len - n - 1] != '/' ||
+		    strncmp(path + len - n, name, n))
+			return false;
+		len -= n + 1;
+	}
+
+	return np == of_root && !len;
+}
+
+/*
+ * Look a full path, up to its options, up in the index. Returns the node
+ * with its refcount incremented, or NULL when the tree must be walked.
+ * Called with devtree_lock held.
+ */
+static struct device_node *of_path_index_lookup(const char *path)
+{
+	const struct of_path_index_entry *e, *end;
+	unsigned long hash = init_name_hash(NULL);
+	unsigned int lo = 0, hi = of_path_index_count;
+	size_t len, i;
+	u32 h;
+
+	if (!of_path_index_count || *path != '/')
+		return NULL;
+
+	len = strchrnul(path, ':') - path;
+	for (i = 0; i < len; i++)
+		hash = partial_name_hash(path[i], hash);
+	h = end_name_hash(hash);
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (of_path_index[mid].hash < h)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	end = of_path_index + of_path_index_count;
+	for (e = of_path_index + lo; e < end && e->hash == h; e++)
+		if (of_path_index_match(e->np, path, len))
+			return of_node_get(e->np);
+
+	return NULL;
+}
+
+/* Returns false when @np has no index to look @name up in */
+static bool of_prop_index_find(const struct device_node *np,
+			       const char *name, struct property **ppp)
+{
+	const struct of_prop_index *idx = np->prop_index;
+	unsigned int lo = 0, hi;
+	int cmp;
+
+	if (!idx)
+		return false;
+
+	*ppp = NULL;
+	hi = idx->count;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		cmp = of_prop_cmp(idx->props[mid]->name, name);
+		if (!cmp) {
+			*ppp = idx->props[mid];
+			break;
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return true;
+}
+
+/* Called with devtree_lock held, when the properties of @np change */
+static void of_prop_index_drop(struct device_node *np)
+{
+	np->prop_index = NULL;
+}
+#else
+static inline struct device_node *of_path_index_lookup(const char *path)
+{
+	return NULL;
+}
+
+static inline bool of_prop_index_find(const struct device_node *np,
+				      const char *name, struct property **ppp)
+{
+	return false;
+}
+
+static inline void of_prop_index_drop(struct device_node *np)
+{
+}
+#endif /* CONFIG_OF_LOOKUP_INDEX */
+
 static struct property *__of_find_property(const struct device_node *np,
 					   const char *name, int *lenp)
 {
@@ -196,6 +455,12 @@ static struct property *__of_find_property(const struct device_node *np,
 	if (!np)
 		return NULL;
 
+	if (of_prop_index_find(np, name, &pp)) {
+		if (pp && lenp)
+			*lenp = pp->length;
+		return pp;
+	}
+
 	for (pp = np->properties; pp; pp = pp->next) {
 		if (of_prop_cmp(pp->name, name) == 0) {
 			if (lenp)
@@ -997,9 +1262,14 @@ struct device_node *of_find_node_opts_by_path(const char *path, const char **opt
 
 	/* Step down the tree matching path components */
 	raw_spin_lock_irqsave(&devtree_lock, flags);
-	if (!np)
+	if (!np) {
+		np = of_path_index_lookup(path);
+		if (np)
+			goto out;
 		np = of_node_get(of_root);
+	}
 	np = __of_find_node_by_full_path(np, path);
+out:
 	raw_spin_unlock_irqrestore(&devtree_lock, flags);
 	return np;
 }
@@ -1126,6 +1396,202 @@ struct device_node *of_find_node_with_property(struct device_node *from,
 }
 EXPORT_SYMBOL(of_find_node_with_property);
 
+#ifdef CONFIG_OF_MATCH_INDEX
+/*
+ * Matching a node against a table scores every entry of the table. The
+ * tables built into the kernel, which never go away, are indexed instead by
+ * the hashes of their compatible strings the first time they are matched.
+ * Matching then looks the compatible strings of the node up in the index.
+ * The tables matching on node names or device types are not indexed.
+ */
+struct of_match_index_entry {
+	u32 hash;
+	u32 index;
+};
+
+struct of_match_index {
+	struct hlist_node link;
+	const struct of_device_id *matches;
+	bool linear;
+	unsigned int count;
+	struct of_match_index_entry entries[];
+};
+
+static DEFINE_HASHTABLE(of_match_indexes, 8);
+static DEFINE_SPINLOCK(of_match_index_lock);
+
+static atomic_long_t of_match_calls;
+static atomic_long_t of_match_indexed;
+static atomic64_t of_match_ns;
+
+/* Compatible strings compare case insensitively */
+static u32 of_compat_hash(const char *compat)
+{
+	unsigned long hash = init_name_hash(NULL);
+
+	while (*compat)
+		hash = partial_name_hash(tolower(*compat++), hash);
+
+	return end_name_hash(hash);
+}
+
+static int of_match_index_cmp(const void *a, const void *b)
+{
+	const struct of_match_index_entry *ea = a, *eb = b;
+
+	if (ea->hash != eb->hash)
+		return ea->hash < eb->hash ? -1 : 1;
+
+	return ea->index < eb->index ? -1 : ea->index > eb->index;
+}
+
+static struct of_match_index *
+of_match_index_find(const struct of_device_id *matches)
+{
+	struct of_match_index *idx;
+
+	hash_for_each_possible_rcu(of_match_indexes, idx, link,
+				   (unsigned long)matches)
+		if (idx->matches == matches)
+			return idx;
+
+	return NULL;
+}
+
+/* Called without devtree_lock held, as it allocates */
+static void of_match_index_build(const struct of_device_id *matches)
+{
+	const struct of_device_id *m;
+	struct of_match_index *idx;
+	unsigned int i, count = 0;
+	bool linear = false;
+
+	if (!matches || !slab_is_available() ||
+	    !is_kernel_rodata((unsigned long)matches))
+		return;
+
+	rcu_read_lock();
+	idx = of_match_index_find(matches);
+	rcu_read_unlock();
+	if (idx)
+		return;
+
+	for (m = matches; m->name[0] || m->type[0] || m->compatible[0]; m++) {
+		if (m->name[0] || m->type[0] || !m->compatible[0])
+			linear = true;
+		count++;
+	}
+
+	/* Unindexable tables get an entry too, so as to be checked only once */
+	idx = kmalloc(struct_size(idx, entries, linear ? 0 : count),
+		      GFP_NOWAIT | __GFP_NOWARN);
+	if (!idx)
+		return;
+
+	idx->matches = matches;
+	idx->linear = linear;
+	idx->count = linear ? 0 : count;
+	for (i = 0; i < idx->count; i++) {
+		idx->entries[i].hash = of_compat_hash(matches[i].compatible);
+		idx->entries[i].index = i;
+	}
+	sort(idx->entries, idx->count, sizeof(*idx->entries),
+	     of_match_index_cmp, NULL);
+
+	spin_lock(&of_match_index_lock);
+	if (of_match_index_find(matches)) {
+		spin_unlock(&of_match_index_lock);
+		kfree(idx);
+		return;
+	}
+	hash_add_rcu(of_match_indexes, &idx->link, (unsigned long)matches);
+	spin_unlock(&of_match_index_lock);
+}
+
+/*
+ * Same result as scoring the entries: the first compatible string of the
+ * node with a match wins, and then the first matching entry of the table.
+ */
+static const struct of_device_id *
+of_match_index_lookup(const struct of_match_index *idx,
+		      const struct device_node *node)
+{
+	const struct of_match_index_entry *e, *end = idx->entries + idx->count;
+	struct property *prop;
+	const char *cp, *compat;
+	unsigned int lo, hi;
+	u32 hash;
+
+	atomic_long_inc(&of_match_indexed);
+
+	prop = __of_find_property(node, "compatible", NULL);
+	for (cp = of_prop_next_string(prop, NULL); cp;
+	     cp = of_prop_next_string(prop, cp)) {
+		hash = of_compat_hash(cp);
+
+		/* First entry with the hash */
+		lo = 0;
+		hi = idx->count;
+		while (lo < hi) {
+			unsigned int mid = lo + (hi - lo) / 2;
+
+			if (idx->entries[mid].hash < hash)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		for (e = idx->entries + lo; e < end && e->hash == hash; e++) {
+			compat = idx->matches[e->index].compatible;
+			if (of_compat_cmp(cp, compat, strlen(compat)) == 0)
+				return &idx->matches[e->index];
+		}
+	}
+
+	return NULL;
+}
+
+/* Returns false when @matches has no index to look @node up in */
+static bool of_match_index_match(const struct of_device_id *matches,
+				 const struct device_node *node,
+				 const struct of_device_id **match)
+{
+	struct of_match_index *idx;
+	bool indexed;
+
+	rcu_read_lock();
+	idx = of_match_index_find(matches);
+	indexed = idx && !idx->linear;
+	if (indexed)
+		*match = of_match_index_lookup(idx, node);
+	rcu_read_unlock();
+
+	return indexed;
+}
+
+static int __init of_match_index_stats(void)
+{
+	pr_debug("%ld match table lookups, %ld indexed, in %llu us\n",
+		atomic_long_read(&of_match_calls),
+		atomic_long_read(&of_match_indexed),
+		div_u64(atomic64_read(&of_match_ns), NSEC_PER_USEC));
+
+	return 0;
+}
+late_initcall_sync(of_match_index_stats);
+#else
+static inline void of_match_index_build(const struct of_device_id *matches)
+{
+}
+
+static inline bool of_match_index_match(const struct of_device_id *matches,
+					const struct device_node *node,
+					const struct of_device_id **match)
+{
+	return false;
+}
+#endif /* CONFIG_OF_MATCH_INDEX */
+
 static
 const struct of_device_id *__of_match_node(const struct of_device_id *matches,
 					   const struct device_node *node)
@@ -1136,6 +1602,9 @@ const struct of_device_id *__of_match_node(const struct of_device_id *matches,
 	if (!matches)
 		return NULL;
 
+	if (of_match_index_match(matches, node, &best_match))
+		return best_match;
+
 	for (; matches->name[0] || matches->type[0] || matches->compatible[0]; matches++) {
 		score = __of_device_is_compatible(node, matches->compatible,
 						  matches->type, matches->name);
@@ -1160,10 +1629,20 @@ const struct of_device_id *of_match_node(const struct of_device_id *matches,
 {
 	const struct of_device_id *match;
 	unsigned long flags;
+#ifdef CONFIG_OF_MATCH_INDEX
+	u64 start = local_clock();
+#endif
+
+	of_match_index_build(matches);
 
 	raw_spin_lock_irqsave(&devtree_lock, flags);
 	match = __of_match_node(matches, node);
 	raw_spin_unlock_irqrestore(&devtree_lock, flags);
+
+#ifdef CONFIG_OF_MATCH_INDEX
+	atomic_long_inc(&of_match_calls);
+	atomic64_add(local_clock() - start, &of_match_ns);
+#endif
 	return match;
 }
 EXPORT_SYMBOL(of_match_node);
@@ -1723,6 +2202,7 @@ int __of_add_property(struct device_node *np, struct property *prop)
 
 	prop->next = NULL;
 	next = &np->properties;
+	of_prop_index_drop(np);
 	while (*next) {
 		if (strcmp(prop->name, (*next)->name) == 0)
 			/* duplicate ! don't insert it */
@@ -1775,6 +2255,7 @@ int __of_remove_property(struct device_node *np, struct property *prop)
 		return -ENODEV;
 
 	/* found the node */
+	of_prop_index_drop(np);
 	*next = prop->next;
 	prop->next = np->deadprops;
 	np->deadprops = prop;
@@ -1828,6 +2309,7 @@ int __of_update_property(struct device_node *np, struct property *newprop,
 			break;
 	}
 	*oldpropp = oldprop = *next;
+	of_prop_index_drop(np);
 
 	if (oldprop) {
 		/* replace the node */
@@ -532,8 +532,7 @@ static void __of_changeset_entry_invert(struct of_changeset_entry *ce,
 	}
 }
 
-static int __of_changeset_entry_notify(struct of_changeset_entry *ce,
-		bool revert)
+int __of_changeset_entry_notify(struct of_changeset_entry *ce, bool revert)
 {
 	struct of_reconfig_data rd;
 	struct of_changeset_entry ce_inverted;
@@ -136,8 +136,12 @@ static void populate_properties(const void *blob,
 			continue;
 		}
 
-		if (!strcmp(pname, "name"))
+		if (!strcmp(pname, "name")) {
+			/* of_get_property() would find the first one */
+			if (!dryrun && !has_name)
+				np->name = (const char *)val;
 			has_name = true;
+		}
 
 		pp = unflatten_dt_alloc(mem, sizeof(struct property),
 					__alignof__(struct property));
@@ -197,6 +201,7 @@ static void populate_properties(const void *blob,
 			*pprev     = pp;
 			memcpy(pp->value, ps, len - 1);
 			((char *)pp->value)[len - 1] = 0;
+			np->name   = pp->value;
 			pr_debug("fixed up name for %s -> %s\n",
 				 nodename, (char *)pp->value);
 		}
@@ -238,12 +243,10 @@ static int populate_node(const void *blob,
 		}
 	}
 
+	/* Sets np->name, without looking the property up again */
 	populate_properties(blob, offset, mem, np, pathp, dryrun);
-	if (!dryrun) {
-		np->name = of_get_property(np, "name", NULL);
-		if (!np->name)
-			np->name = "<NULL>";
-	}
+	if (!dryrun && !np->name)
+		np->name = "<NULL>";
 
 	*pnp = np;
 	return 0;
@@ -1329,6 +1332,9 @@ void __init unflatten_device_tree(void)
 	__unflatten_device_tree(initial_boot_params, NULL, &of_root,
 				early_init_dt_alloc_memory_arch, false);
 
+	/* Before the alias scan, which looks all the aliases up by path */
+	of_lookup_index_init();
+
 	/* Get pointer to "/chosen" and "/aliases" nodes for use everywhere */
 	of_alias_scan(early_init_dt_alloc_memory_arch);
 
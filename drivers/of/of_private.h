@@ -48,6 +48,8 @@ extern void of_node_release(struct kobject *kobj);
 extern int __of_changeset_apply_entries(struct of_changeset *ocs,
 					int *ret_revert);
 extern int __of_changeset_apply_notify(struct of_changeset *ocs);
+extern int __of_changeset_entry_notify(struct of_changeset_entry *ce,
+				       bool revert);
 extern int __of_changeset_revert_entries(struct of_changeset *ocs,
 					 int *ret_apply);
 extern int __of_changeset_revert_notify(struct of_changeset *ocs);
@@ -59,6 +61,14 @@ static inline int of_property_notify(int action, struct device_node *np,
 }
 #endif /* CONFIG_OF_DYNAMIC */
 
+#if defined(CONFIG_OF_LOOKUP_INDEX)
+void of_lookup_index_init(void);
+#else
+static inline void of_lookup_index_init(void)
+{
+}
+#endif
+
 #if defined(CONFIG_OF_KOBJ)
 int of_node_is_attached(const struct device_node *node);
 int __of_add_property_sysfs(struct device_node *np, struct property *pp);
@@ -8,7 +8,9 @@
 
 #define pr_fmt(fmt)	"OF: overlay: " fmt
 
+#include <linux/async.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
@@ -53,6 +55,18 @@ struct fragment {
 	struct device_node *target;
 };
 
+/* Phases of applying an overlay, timed for debugging */
+enum overlay_phase {
+	OVERLAY_PHASE_RESOLVE,
+	OVERLAY_PHASE_INIT,
+	OVERLAY_PHASE_PRE_APPLY,
+	OVERLAY_PHASE_BUILD,
+	OVERLAY_PHASE_APPLY,
+	OVERLAY_PHASE_NOTIFY,
+	OVERLAY_PHASE_POST_APPLY,
+	OVERLAY_PHASE_MAX,
+};
+
 /**
  * struct overlay_changeset
  * @id:			changeset identifier
@@ -65,6 +79,7 @@ struct fragment {
  * @fragments:		fragment nodes in the overlay expanded device tree
  * @symbols_fragment:	last element of @fragments[] is the  __symbols__ node
  * @cset:		changeset to apply fragments to live device tree
+ * @phase_ns:		time spent in each phase of applying the overlay
  */
 struct overlay_changeset {
 	int id;
@@ -77,6 +92,7 @@ struct overlay_changeset {
 	struct fragment *fragments;
 	bool symbols_fragment;
 	struct of_changeset cset;
+	s64 phase_ns[OVERLAY_PHASE_MAX];
 };
 
 /* flags are sticky - once set, do not reset */
@@ -84,6 +100,13 @@ static int devicetree_state_flags;
 #define DTSF_APPLY_FAIL		0x01
 #define DTSF_REVERT_FAIL	0x02
 
+static bool parallel_notify;
+module_param(parallel_notify, bool, 0644);
+MODULE_PARM_DESC(parallel_notify,
+		 "Notify the attach of the independent subtrees of an overlay, creating their devices, in parallel (default: 0)");
+
+static ASYNC_DOMAIN_EXCLUSIVE(overlay_notify_domain);
+
 /*
  * If a changeset apply or revert encounters an error, an attempt will
  * be made to undo partial changes, but may fail.  If the undo fails
@@ -871,6 +894,156 @@ static void free_overlay_changeset(struct overlay_changeset *ovcs)
 	kfree(ovcs);
 }
 
+/**
+ * struct overlay_notify_group - changeset entries of a subtree added by an
+ *				 overlay
+ * @node:	entry in the list of groups of the overlay being notified
+ * @first:	entry attaching the root node of the subtree
+ * @count:	number of consecutive changeset entries from @first
+ * @ret:	last error of the notifiers
+ */
+struct overlay_notify_group {
+	struct list_head node;
+	struct of_changeset_entry *first;
+	unsigned int count;
+	int ret;
+};
+
+static void overlay_notify_group(void *data, async_cookie_t cookie)
+{
+	struct overlay_notify_group *group = data;
+	struct of_changeset_entry *ce = group->first;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < group->count; i++, ce = list_next_entry(ce, node)) {
+		/*
+		 * The attach of a node announces it with all its properties,
+		 * the properties need no notification of their own.
+		 */
+		if (ce->action == OF_RECONFIG_ADD_PROPERTY)
+			continue;
+
+		ret = __of_changeset_entry_notify(ce, false);
+		if (ret)
+			group->ret = ret;
+	}
+}
+
+static void overlay_notify_groups(struct list_head *groups, int *ret)
+{
+	struct overlay_notify_group *group, *tmp;
+
+	if (list_empty(groups))
+		return;
+
+	list_for_each_entry(group, groups, node) {
+		if (READ_ONCE(parallel_notify))
+			async_schedule_domain(overlay_notify_group, group,
+					      &overlay_notify_domain);
+		else
+			overlay_notify_group(group, 0);
+	}
+	async_synchronize_full_domain(&overlay_notify_domain);
+
+	list_for_each_entry_safe(group, tmp, groups, node) {
+		if (group->ret)
+			*ret = group->ret;
+		list_del(&group->node);
+		kfree(group);
+	}
+}
+
+/*
+ * Emit the notifications of the applied changeset entries, like
+ * __of_changeset_apply_notify() does.
+ *
+ * The entries of an overlay attach each new subtree after its parent, and
+ * the properties of its nodes after these. The entries of a subtree added
+ * to a node of the live tree form a group, whose devices are created
+ * independently of the other groups, in parallel if requested. The other
+ * entries, changing the nodes of the live tree, are notified in order,
+ * after the groups preceding them.
+ */
+static int overlay_apply_notify(struct overlay_changeset *ovcs)
+{
+	struct overlay_notify_group *group = NULL;
+	struct of_changeset_entry *ce;
+	LIST_HEAD(groups);
+	int ret = 0, ret_tmp;
+
+	pr_debug("changeset: emitting notifiers.\n");
+
+	/* drop the global lock while emitting notifiers */
+	mutex_unlock(&of_mutex);
+
+	list_for_each_entry(ce, &ovcs->cset.entries, node) {
+		if (ce->action == OF_RECONFIG_ATTACH_NODE) {
+			of_node_set_flag(ce->np, OF_CSET_ATTACHED);
+
+			if (!of_node_check_flag(ce->np->parent,
+						OF_CSET_ATTACHED)) {
+				group = kzalloc(sizeof(*group), GFP_KERNEL);
+				if (group) {
+					group->first = ce;
+					list_add_tail(&group->node, &groups);
+				}
+			}
+		}
+
+		if (group && of_node_check_flag(ce->np, OF_CSET_ATTACHED)) {
+			group->count++;
+			continue;
+		}
+		group = NULL;
+
+		overlay_notify_groups(&groups, &ret);
+		ret_tmp = __of_changeset_entry_notify(ce, false);
+		if (ret_tmp)
+			ret = ret_tmp;
+	}
+	overlay_notify_groups(&groups, &ret);
+
+	list_for_each_entry(ce, &ovcs->cset.entries, node)
+		if (ce->action == OF_RECONFIG_ATTACH_NODE)
+			of_node_clear_flag(ce->np, OF_CSET_ATTACHED);
+
+	mutex_lock(&of_mutex);
+	pr_debug("changeset: notifiers sent.\n");
+
+	return ret;
+}
+
+static const char * const overlay_phase_names[OVERLAY_PHASE_MAX] = {
+	[OVERLAY_PHASE_RESOLVE]		= "resolve",
+	[OVERLAY_PHASE_INIT]		= "init",
+	[OVERLAY_PHASE_PRE_APPLY]	= "pre-apply",
+	[OVERLAY_PHASE_BUILD]		= "build",
+	[OVERLAY_PHASE_APPLY]		= "apply",
+	[OVERLAY_PHASE_NOTIFY]		= "notify",
+	[OVERLAY_PHASE_POST_APPLY]	= "post-apply",
+};
+
+/* Account the time since *@start to @phase and restart the clock */
+static void overlay_phase_end(struct overlay_changeset *ovcs,
+			      enum overlay_phase phase, ktime_t *start)
+{
+	ktime_t now = ktime_get();
+
+	ovcs->phase_ns[phase] = ktime_to_ns(ktime_sub(now, *start));
+	*start = now;
+}
+
+static void overlay_phases_dump(struct overlay_changeset *ovcs)
+{
+	enum overlay_phase phase;
+
+	for (phase = 0; phase < OVERLAY_PHASE_MAX; phase++)
+		pr_debug("overlay %d: %s %lld us\n", ovcs->id,
+			 overlay_phase_names[phase],
+			 div_s64(ovcs->phase_ns[phase], NSEC_PER_USEC));
+}
+
 /*
  * internal documentation
  *
@@ -902,25 +1075,31 @@ static void free_overlay_changeset(struct overlay_changeset *ovcs)
 static int of_overlay_apply(struct overlay_changeset *ovcs)
 {
 	int ret = 0, ret_revert, ret_tmp;
+	ktime_t start = ktime_get();
 
 	ret = of_resolve_phandles(ovcs->overlay_root);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_RESOLVE, &start);
 	if (ret)
 		goto out;
 
 	ret = init_overlay_changeset(ovcs);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_INIT, &start);
 	if (ret)
 		goto out;
 
 	ret = overlay_notify(ovcs, OF_OVERLAY_PRE_APPLY);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_PRE_APPLY, &start);
 	if (ret)
 		goto out;
 
 	ret = build_changeset(ovcs);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_BUILD, &start);
 	if (ret)
 		goto out;
 
 	ret_revert = 0;
 	ret = __of_changeset_apply_entries(&ovcs->cset, &ret_revert);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_APPLY, &start);
 	if (ret) {
 		if (ret_revert) {
 			pr_debug("overlay changeset revert error %d\n",
@@ -930,17 +1109,20 @@ static int of_overlay_apply(struct overlay_changeset *ovcs)
 		goto out;
 	}
 
-	ret = __of_changeset_apply_notify(&ovcs->cset);
+	ret = overlay_apply_notify(ovcs);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_NOTIFY, &start);
 	if (ret)
 		pr_err("overlay apply changeset entry notify error %d\n", ret);
 	/* notify failure is not fatal, continue */
 
 	ret_tmp = overlay_notify(ovcs, OF_OVERLAY_POST_APPLY);
+	overlay_phase_end(ovcs, OVERLAY_PHASE_POST_APPLY, &start);
 	if (ret_tmp)
 		if (!ret)
 			ret = ret_tmp;
 
 out:
+	overlay_phases_dump(ovcs);
 	pr_debug("%s() err=%d\n", __func__, ret);
 
 	return ret;
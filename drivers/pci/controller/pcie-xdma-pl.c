@@ -96,6 +96,8 @@
 
 /* Number of MSI IRQs */
 #define XILINX_NUM_MSI_IRQS		64
+/* MSI IRQs demultiplexed from each of the msi0 and msi1 lines */
+#define XILINX_NUM_MSI_PER_LINE		32
 #define INTX_NUM                        4
 
 #define DMA_BRIDGE_BASE_OFF		0xCD8
@@ -447,6 +449,50 @@ static struct msi_domain_info xilinx_msi_domain_info = {
 	.chip = &xilinx_msi_irq_chip,
 };
 
+static int xilinx_msi_parent_irq(struct xilinx_msi *msi, irq_hw_number_t hwirq)
+{
+	return hwirq < XILINX_NUM_MSI_PER_LINE ? msi->irq_msi0 : msi->irq_msi1;
+}
+
+/*
+ * Each half of the vectors is demultiplexed from its own parent interrupt.
+ * A single vector goes to the half served by a CPU of its affinity when
+ * only one of them is, else to the least used half.
+ */
+static int xilinx_msi_alloc_single(struct xilinx_msi *msi, unsigned int virq)
+{
+	const struct cpumask *aff = irq_get_affinity_mask(virq);
+	unsigned int used_lo, used, start, end, half, i;
+	bool served[2] = {};
+	int bit, parent;
+
+	used_lo = bitmap_weight(msi->bitmap, XILINX_NUM_MSI_PER_LINE);
+	used = bitmap_weight(msi->bitmap, XILINX_NUM_MSI_IRQS);
+	half = used - used_lo < used_lo;
+
+	if (aff) {
+		for (i = 0; i < 2; i++) {
+			parent = i ? msi->irq_msi1 : msi->irq_msi0;
+			served[i] = cpumask_intersects(aff,
+					irq_get_effective_affinity_mask(parent));
+		}
+		if (served[0] != served[1])
+			half = served[1];
+	}
+
+	for (i = 0; i < 2; i++, half ^= 1) {
+		start = half * XILINX_NUM_MSI_PER_LINE;
+		end = start + XILINX_NUM_MSI_PER_LINE;
+		bit = find_next_zero_bit(msi->bitmap, end, start);
+		if (bit < end) {
+			__set_bit(bit, msi->bitmap);
+			return bit;
+		}
+	}
+
+	return -ENOSPC;
+}
+
 static void xilinx_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 {
 	struct xilinx_pcie_port *pcie = irq_data_get_irq_chip_data(data);
@@ -459,10 +505,28 @@ static void xilinx_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 	msg->data = data->hwirq;
 }
 
+/*
+ * A vector follows the CPU of its parent interrupt and cannot be moved on
+ * its own: accept the masks that include that CPU.
+ */
 static int xilinx_msi_set_affinity(struct irq_data *irq_data,
 				   const struct cpumask *mask, bool force)
 {
-	return -EINVAL;
+	struct xilinx_pcie_port *pcie = irq_data_get_irq_chip_data(irq_data);
+	const struct cpumask *effective;
+	int parent;
+
+	parent = xilinx_msi_parent_irq(&pcie->msi, irq_data->hwirq);
+	if (parent <= 0)
+		return -EINVAL;
+
+	effective = irq_get_effective_affinity_mask(parent);
+	if (!cpumask_intersects(mask, effective))
+		return -EINVAL;
+
+	irq_data_update_effective_affinity(irq_data, effective);
+
+	return IRQ_SET_MASK_OK_DONE;
 }
 
 static struct irq_chip xilinx_irq_chip = {
@@ -480,8 +544,11 @@ static int xilinx_irq_domain_alloc(struct irq_domain *domain, unsigned int virq,
 	int i;
 
 	mutex_lock(&msi->lock);
-	bit = bitmap_find_free_region(msi->bitmap, XILINX_NUM_MSI_IRQS,
-				      get_count_order(nr_irqs));
+	if (nr_irqs == 1 && msi->irq_msi1 > 0)
+		bit = xilinx_msi_alloc_single(msi, virq);
+	else
+		bit = bitmap_find_free_region(msi->bitmap, XILINX_NUM_MSI_IRQS,
+					      get_count_order(nr_irqs));
 	if (bit < 0) {
 		mutex_unlock(&msi->lock);
 		return -ENOSPC;
@@ -662,6 +729,12 @@ static int xilinx_request_msi_irq(struct xilinx_pcie_port *port)
 					 xilinx_pcie_msi_handler_high,
 					 port);
 
+	/* Serve the two halves of the vectors from different CPUs */
+	irq_set_affinity(port->msi.irq_msi0,
+			 cpumask_of(cpumask_local_spread(0, dev_to_node(dev))));
+	irq_set_affinity(port->msi.irq_msi1,
+			 cpumask_of(cpumask_local_spread(1, dev_to_node(dev))));
+
 	return 0;
 }
 
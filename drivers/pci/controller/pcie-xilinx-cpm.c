@@ -22,6 +22,7 @@
 #include <linux/pci-ecam.h>
 
 #include "../pci.h"
+#include "pcie-xilinx-pmu.h"
 
 /* Register definitions */
 #define XILINX_CPM_PCIE_REG_IDR		0x00000E10
@@ -127,6 +128,7 @@ struct xilinx_cpm_variant {
  * @irq: Error interrupt number
  * @lock: lock protecting shared register access
  * @variant: CPM version check pointer
+ * @pmu: event counting PMU
  */
 struct xilinx_cpm_pcie {
 	struct device			*dev;
@@ -139,6 +141,7 @@ struct xilinx_cpm_pcie {
 	int				irq;
 	raw_spinlock_t			lock;
 	const struct xilinx_cpm_variant   *variant;
+	struct xilinx_pcie_pmu		*pmu;
 };
 
 static u32 pcie_read(struct xilinx_cpm_pcie *port, u32 reg)
@@ -300,6 +303,7 @@ static void xilinx_cpm_pcie_event_flow(struct irq_desc *desc)
 	chained_irq_enter(chip, desc);
 	val =  pcie_read(port, XILINX_CPM_PCIE_REG_IDR);
 	val &= pcie_read(port, XILINX_CPM_PCIE_REG_IMR);
+	xilinx_pcie_pmu_add_mask(port->pmu, val);
 	for_each_set_bit(i, &val, 32)
 		generic_handle_domain_irq(port->cpm_domain, i);
 	pcie_write(port, val, XILINX_CPM_PCIE_REG_IDR);
@@ -351,6 +355,33 @@ static const struct {
 	_IC(SLV_PCIE_TIMEOUT,	"PCIe completion timeout received"),
 };
 
+#define _PE(x, s)				\
+	[XILINX_CPM_PCIE_INTR_ ## x] = s
+
+/* PMU events, numbered after their XILINX_CPM_PCIE_REG_IDR bit */
+static const char * const xilinx_cpm_pmu_events[] = {
+	_PE(LINK_DOWN,		"link_down"),
+	_PE(HOT_RESET,		"hot_reset"),
+	_PE(CFG_PCIE_TIMEOUT,	"cfg_pcie_timeout"),
+	_PE(CFG_TIMEOUT,	"cfg_timeout"),
+	_PE(CORRECTABLE,	"err_corr"),
+	_PE(NONFATAL,		"err_nonfatal"),
+	_PE(FATAL,		"err_fatal"),
+	_PE(CFG_ERR_POISON,	"cfg_err_poison"),
+	_PE(PME_TO_ACK_RCVD,	"pme_to_ack"),
+	_PE(INTX,		"intx"),
+	_PE(PM_PME_RCVD,	"pm_pme"),
+	_PE(SLV_UNSUPP,		"slv_unsupp"),
+	_PE(SLV_UNEXP,		"slv_unexp_compl"),
+	_PE(SLV_COMPL,		"slv_compl_timeout"),
+	_PE(SLV_ERRP,		"slv_err_poison"),
+	_PE(SLV_CMPABT,		"slv_compl_abort"),
+	_PE(SLV_ILLBUR,		"slv_illegal_burst"),
+	_PE(MST_DECERR,		"mst_decode_err"),
+	_PE(MST_SLVERR,		"mst_slave_err"),
+	_PE(SLV_PCIE_TIMEOUT,	"slv_pcie_timeout"),
+};
+
 static irqreturn_t xilinx_cpm_pcie_intr_handler(int irq, void *dev_id)
 {
 	struct xilinx_cpm_pcie *port = dev_id;
@@ -608,6 +639,16 @@ static int xilinx_cpm_pcie_probe(struct platform_device *pdev)
 
 	xilinx_cpm_pcie_init_port(port);
 
+	port->pmu = devm_xilinx_pcie_pmu_register(dev,
+			port->variant->version == CPM5 ? "cpm5" : "cpm",
+			xilinx_cpm_pmu_events,
+			ARRAY_SIZE(xilinx_cpm_pmu_events));
+	if (IS_ERR(port->pmu)) {
+		dev_warn(dev, "failed to register the PMU: %ld\n",
+			 PTR_ERR(port->pmu));
+		port->pmu = NULL;
+	}
+
 	err = xilinx_cpm_setup_irq(port);
 	if (err) {
 		dev_err(dev, "Failed to set up interrupts\n");
@@ -24,6 +24,7 @@
 #include <linux/irqchip/chained_irq.h>
 
 #include "../pci.h"
+#include "pcie-xilinx-pmu.h"
 
 /* Bridge core config registers */
 #define BRCFG_PCIE_RX0			0x00000000
@@ -134,6 +135,12 @@
 
 #define INT_PCI_MSI_NR			(2 * 32)
 
+/* PMU events past the MSGF_MISC_STATUS bits */
+#define NWL_PMU_EV_MSI			32
+#define NWL_PMU_EV_INTX			33
+/* MSI IRQs demultiplexed from each of the msi0 and msi1 lines */
+#define INT_PCI_MSI_PER_LINE		32
+
 /* Readin the PS_LINKUP */
 #define PS_LINKUP_OFFSET		0x00000238
 #define PCIE_PHY_LINKUP_BIT		BIT(0)
@@ -172,6 +179,28 @@ struct nwl_pcie {
 	struct irq_domain *legacy_irq_domain;
 	struct clk *clk;
 	raw_spinlock_t leg_mask_lock;
+	struct xilinx_pcie_pmu *pmu;
+};
+
+/* PMU events, numbered after their MSGF_MISC_STATUS bit */
+static const char * const nwl_pcie_pmu_events[] = {
+	[0]			= "rxmsg_avail",
+	[1]			= "rxmsg_over",
+	[4]			= "slave_err",
+	[5]			= "master_err",
+	[6]			= "ingress_addr_err",
+	[7]			= "egress_addr_err",
+	[16]			= "aer_fatal",
+	[17]			= "aer_nonfatal",
+	[18]			= "aer_corr",
+	[20]			= "ur_detect",
+	[22]			= "dev_nonfatal",
+	[23]			= "dev_fatal",
+	[24]			= "link_down",
+	[25]			= "link_auto_bw_change",
+	[26]			= "link_bw_change",
+	[NWL_PMU_EV_MSI]	= "msi",
+	[NWL_PMU_EV_INTX]	= "intx",
 };
 
 static inline u32 nwl_bridge_readl(struct nwl_pcie *pcie, u32 off)
@@ -269,6 +298,8 @@ static irqreturn_t nwl_pcie_misc_handler(int irq, void *data)
 	if (!misc_stat)
 		return IRQ_NONE;
 
+	xilinx_pcie_pmu_add_mask(pcie->pmu, misc_stat);
+
 	if (misc_stat & MSGF_MISC_SR_RXMSG_OVER)
 		dev_err(dev, "Received Message FIFO Overflow\n");
 
@@ -326,6 +357,8 @@ static void nwl_pcie_leg_handler(struct irq_desc *desc)
 
 	while ((status = nwl_bridge_readl(pcie, MSGF_LEG_STATUS) &
 				MSGF_LEG_SR_MASKALL) != 0) {
+		xilinx_pcie_pmu_add(pcie->pmu, NWL_PMU_EV_INTX,
+				    hweight_long(status));
 		for_each_set_bit(bit, &status, PCI_NUM_INTX)
 			generic_handle_domain_irq(pcie->legacy_irq_domain, bit);
 	}
@@ -340,6 +373,8 @@ static void nwl_pcie_handle_msi_irq(struct nwl_pcie *pcie, u32 status_reg)
 	u32 bit;
 
 	while ((status = nwl_bridge_readl(pcie, status_reg)) != 0) {
+		xilinx_pcie_pmu_add(pcie->pmu, NWL_PMU_EV_MSI,
+				    hweight_long(status));
 		for_each_set_bit(bit, &status, 32) {
 			nwl_bridge_writel(pcie, 1 << bit, status_reg);
 			generic_handle_domain_irq(msi->dev_domain, bit);
@@ -434,6 +469,50 @@ static struct msi_domain_info nwl_msi_domain_info = {
 };
 #endif
 
+static int nwl_msi_parent_irq(struct nwl_msi *msi, irq_hw_number_t hwirq)
+{
+	return hwirq < INT_PCI_MSI_PER_LINE ? msi->irq_msi0 : msi->irq_msi1;
+}
+
+/*
+ * Each half of the vectors is demultiplexed from its own parent interrupt.
+ * A single vector goes to the half served by a CPU of its affinity when
+ * only one of them is, else to the least used half.
+ */
+static int nwl_msi_alloc_single(struct nwl_msi *msi, unsigned int virq)
+{
+	const struct cpumask *aff = irq_get_affinity_mask(virq);
+	unsigned int used_lo, used, start, end, half, i;
+	bool served[2] = {};
+	int bit, parent;
+
+	used_lo = bitmap_weight(msi->bitmap, INT_PCI_MSI_PER_LINE);
+	used = bitmap_weight(msi->bitmap, INT_PCI_MSI_NR);
+	half = used - used_lo < used_lo;
+
+	if (aff) {
+		for (i = 0; i < 2; i++) {
+			parent = i ? msi->irq_msi1 : msi->irq_msi0;
+			served[i] = cpumask_intersects(aff,
+					irq_get_effective_affinity_mask(parent));
+		}
+		if (served[0] != served[1])
+			half = served[1];
+	}
+
+	for (i = 0; i < 2; i++, half ^= 1) {
+		start = half * INT_PCI_MSI_PER_LINE;
+		end = start + INT_PCI_MSI_PER_LINE;
+		bit = find_next_zero_bit(msi->bitmap, end, start);
+		if (bit < end) {
+			__set_bit(bit, msi->bitmap);
+			return bit;
+		}
+	}
+
+	return -ENOSPC;
+}
+
 static void nwl_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 {
 	struct nwl_pcie *pcie = irq_data_get_irq_chip_data(data);
@@ -444,10 +523,25 @@ static void nwl_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 	msg->data = data->hwirq;
 }
 
+/*
+ * A vector follows the CPU of its parent interrupt and cannot be moved on
+ * its own: accept the masks that include that CPU.
+ */
 static int nwl_msi_set_affinity(struct irq_data *irq_data,
 				const struct cpumask *mask, bool force)
 {
-	return -EINVAL;
+	struct nwl_pcie *pcie = irq_data_get_irq_chip_data(irq_data);
+	const struct cpumask *effective;
+	int parent;
+
+	parent = nwl_msi_parent_irq(&pcie->msi, irq_data->hwirq);
+	effective = irq_get_effective_affinity_mask(parent);
+	if (!cpumask_intersects(mask, effective))
+		return -EINVAL;
+
+	irq_data_update_effective_affinity(irq_data, effective);
+
+	return IRQ_SET_MASK_OK_DONE;
 }
 
 static struct irq_chip nwl_irq_chip = {
@@ -465,8 +559,11 @@ static int nwl_irq_domain_alloc(struct irq_domain *domain, unsigned int virq,
 	int i;
 
 	mutex_lock(&msi->lock);
-	bit = bitmap_find_free_region(msi->bitmap, INT_PCI_MSI_NR,
-				      get_count_order(nr_irqs));
+	if (nr_irqs == 1)
+		bit = nwl_msi_alloc_single(msi, virq);
+	else
+		bit = bitmap_find_free_region(msi->bitmap, INT_PCI_MSI_NR,
+					      get_count_order(nr_irqs));
 	if (bit < 0) {
 		mutex_unlock(&msi->lock);
 		return -ENOSPC;
@@ -577,6 +674,12 @@ static int nwl_pcie_enable_msi(struct nwl_pcie *pcie)
 	irq_set_chained_handler_and_data(msi->irq_msi0,
 					 nwl_pcie_msi_handler_low, pcie);
 
+	/* Serve the two halves of the vectors from different CPUs */
+	irq_set_affinity(msi->irq_msi0,
+			 cpumask_of(cpumask_local_spread(0, dev_to_node(dev))));
+	irq_set_affinity(msi->irq_msi1,
+			 cpumask_of(cpumask_local_spread(1, dev_to_node(dev))));
+
 	/* Check for msii_present bit */
 	ret = nwl_bridge_readl(pcie, I_MSII_CAPABILITIES) & MSII_PRESENT;
 	if (!ret) {
@@ -811,6 +914,15 @@ static int nwl_pcie_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	/* Counting starts with the interrupts the bridge init requests */
+	pcie->pmu = devm_xilinx_pcie_pmu_register(dev, "nwl",
+			nwl_pcie_pmu_events, ARRAY_SIZE(nwl_pcie_pmu_events));
+	if (IS_ERR(pcie->pmu)) {
+		dev_warn(dev, "failed to register the PMU: %ld\n",
+			 PTR_ERR(pcie->pmu));
+		pcie->pmu = NULL;
+	}
+
 	err = nwl_pcie_bridge_init(pcie);
 	if (err) {
 		dev_err(dev, "HW Initialization failed\n");
@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Perf PMU counting the events of the Xilinx PCIe bridges
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ *
+ * The NWL and CPM bridges have no traffic or credit counters, only the
+ * status bits of their error, link and interrupt events. The bridge
+ * drivers count those events as they handle them and each bridge registers
+ * an uncore style PMU reading the counts, e.g.:
+ *
+ *   perf stat -a -e xlnx_pcie_fd0e0000_pcie/aer_corr/ ...
+ */
+
+#include <linux/cpumask.h>
+#include <linux/device.h>
+#include <linux/kernel.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
+#include <linux/string.h>
+
+#include "pcie-xilinx-pmu.h"
+
+/**
+ * struct xilinx_pcie_pmu - PCIe bridge perf PMU
+ * @pmu: perf PMU
+ * @identifier: bridge type reported to the perf tool
+ * @counts: per CPU counts of the events
+ * @nr_events: number of events
+ * @cpu: CPU the events are bound to
+ * @events_group: named events of the bridge
+ * @attr_groups: attribute groups of the PMU
+ */
+struct xilinx_pcie_pmu {
+	struct pmu pmu;
+	const char *identifier;
+	u64 __percpu *counts;
+	unsigned int nr_events;
+	int cpu;
+	struct attribute_group events_group;
+	const struct attribute_group *attr_groups[4];
+};
+
+#define to_xilinx_pcie_pmu(p) container_of((p), struct xilinx_pcie_pmu, pmu)
+
+/**
+ * xilinx_pcie_pmu_add - Count occurrences of a bridge event
+ * @pmu: PCIe bridge PMU, may be NULL
+ * @event: event index
+ * @n: number of occurrences
+ *
+ * Context: Any context.
+ */
+void xilinx_pcie_pmu_add(struct xilinx_pcie_pmu *pmu, unsigned int event,
+			 unsigned int n)
+{
+	if (pmu && event < pmu->nr_events)
+		this_cpu_add(pmu->counts[event], n);
+}
+
+/**
+ * xilinx_pcie_pmu_add_mask - Count one occurrence of several bridge events
+ * @pmu: PCIe bridge PMU, may be NULL
+ * @mask: bitmask of the indexes of the events, as read from a status
+ *	  register
+ *
+ * Context: Any context.
+ */
+void xilinx_pcie_pmu_add_mask(struct xilinx_pcie_pmu *pmu, unsigned long mask)
+{
+	unsigned int bit;
+
+	if (!pmu)
+		return;
+
+	for_each_set_bit(bit, &mask, min_t(unsigned int, pmu->nr_events,
+					   BITS_PER_LONG))
+		this_cpu_inc(pmu->counts[bit]);
+}
+
+static u64 xilinx_pcie_pmu_read_count(struct xilinx_pcie_pmu *pmu,
+				      unsigned int event)
+{
+	u64 count = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pmu->counts, cpu)[event]);
+
+	return count;
+}
+
+static void xilinx_pcie_pmu_event_update(struct perf_event *event)
+{
+	struct xilinx_pcie_pmu *pmu = to_xilinx_pcie_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev, now;
+
+	do {
+		prev = local64_read(&hwc->prev_count);
+		now = xilinx_pcie_pmu_read_count(pmu, hwc->idx);
+	} while (local64_cmpxchg(&hwc->prev_count, prev, now) != prev);
+
+	local64_add(now - prev, &event->count);
+}
+
+static int xilinx_pcie_pmu_event_init(struct perf_event *event)
+{
+	struct xilinx_pcie_pmu *pmu = to_xilinx_pcie_pmu(event->pmu);
+	u64 config = event->attr.config;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* The events raise no overflow interrupt, they can only be read */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	if (config >= pmu->nr_events)
+		return -EINVAL;
+
+	event->cpu = pmu->cpu;
+	event->hw.idx = config;
+
+	return 0;
+}
+
+static void xilinx_pcie_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct xilinx_pcie_pmu *pmu = to_xilinx_pcie_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+
+	hwc->state = 0;
+	local64_set(&hwc->prev_count,
+		    xilinx_pcie_pmu_read_count(pmu, hwc->idx));
+}
+
+static void xilinx_pcie_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	xilinx_pcie_pmu_event_update(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int xilinx_pcie_pmu_event_add(struct perf_event *event, int flags)
+{
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		xilinx_pcie_pmu_event_start(event, flags);
+
+	return 0;
+}
+
+static void xilinx_pcie_pmu_event_del(struct perf_event *event, int flags)
+{
+	xilinx_pcie_pmu_event_stop(event, PERF_EF_UPDATE);
+}
+
+static void xilinx_pcie_pmu_event_read(struct perf_event *event)
+{
+	xilinx_pcie_pmu_event_update(event);
+}
+
+static ssize_t xilinx_pcie_pmu_cpumask_show(struct device *dev,
+					    struct device_attribute *attr,
+					    char *buf)
+{
+	struct xilinx_pcie_pmu *pmu = to_xilinx_pcie_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(pmu->cpu));
+}
+
+static struct device_attribute xilinx_pcie_pmu_cpumask_attr =
+	__ATTR(cpumask, 0444, xilinx_pcie_pmu_cpumask_show, NULL);
+
+static ssize_t xilinx_pcie_pmu_identifier_show(struct device *dev,
+					       struct device_attribute *attr,
+					       char *buf)
+{
+	struct xilinx_pcie_pmu *pmu = to_xilinx_pcie_pmu(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%s\n", pmu->identifier);
+}
+
+static struct device_attribute xilinx_pcie_pmu_identifier_attr =
+	__ATTR(identifier, 0444, xilinx_pcie_pmu_identifier_show, NULL);
+
+static struct attribute *xilinx_pcie_pmu_common_attrs[] = {
+	&xilinx_pcie_pmu_cpumask_attr.attr,
+	&xilinx_pcie_pmu_identifier_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group xilinx_pcie_pmu_common_group = {
+	.attrs = xilinx_pcie_pmu_common_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-7");
+
+static struct attribute *xilinx_pcie_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	NULL,
+};
+
+static const struct attribute_group xilinx_pcie_pmu_format_group = {
+	.name = "format",
+	.attrs = xilinx_pcie_pmu_format_attrs,
+};
+
+static int xilinx_pcie_pmu_init_events(struct device *dev,
+				       struct xilinx_pcie_pmu *pmu,
+				       const char * const *events)
+{
+	struct perf_pmu_events_attr *ev_attrs;
+	struct attribute **attrs;
+	unsigned int i, n = 0;
+
+	ev_attrs = devm_kcalloc(dev, pmu->nr_events, sizeof(*ev_attrs),
+				GFP_KERNEL);
+	attrs = devm_kcalloc(dev, pmu->nr_events + 1, sizeof(*attrs),
+			     GFP_KERNEL);
+	if (!ev_attrs || !attrs)
+		return -ENOMEM;
+
+	/* The event indexes follow the status bits, some are unused */
+	for (i = 0; i < pmu->nr_events; i++) {
+		struct perf_pmu_events_attr *ev_attr = &ev_attrs[i];
+
+		if (!events[i])
+			continue;
+
+		ev_attr->event_str = devm_kasprintf(dev, GFP_KERNEL,
+						    "event=0x%02x", i);
+		if (!ev_attr->event_str)
+			return -ENOMEM;
+
+		sysfs_attr_init(&ev_attr->attr.attr);
+		ev_attr->id = i;
+		ev_attr->attr.attr.name = events[i];
+		ev_attr->attr.attr.mode = 0444;
+		ev_attr->attr.show = perf_event_sysfs_show;
+		attrs[n++] = &ev_attr->attr.attr;
+	}
+
+	pmu->events_group.name = "events";
+	pmu->events_group.attrs = attrs;
+
+	return 0;
+}
+
+static void xilinx_pcie_pmu_unregister(void *data)
+{
+	struct xilinx_pcie_pmu *pmu = data;
+
+	perf_pmu_unregister(&pmu->pmu);
+}
+
+/**
+ * devm_xilinx_pcie_pmu_register - Register the perf PMU of a PCIe bridge
+ * @dev: PCIe bridge device
+ * @identifier: bridge type reported to the perf tool
+ * @events: names of the events, indexed by event number, NULL for the
+ *	    unused numbers
+ * @nr_events: number of entries of @events, at most 256
+ *
+ * Return: the PMU to count the events with on success, an error pointer
+ *	   otherwise.
+ */
+struct xilinx_pcie_pmu *
+devm_xilinx_pcie_pmu_register(struct device *dev, const char *identifier,
+			      const char * const *events,
+			      unsigned int nr_events)
+{
+	struct xilinx_pcie_pmu *pmu;
+	char *name;
+	int ret;
+
+	if (!nr_events || nr_events > 256)
+		return ERR_PTR(-EINVAL);
+
+	pmu = devm_kzalloc(dev, sizeof(*pmu), GFP_KERNEL);
+	if (!pmu)
+		return ERR_PTR(-ENOMEM);
+
+	pmu->counts = __devm_alloc_percpu(dev, nr_events * sizeof(u64),
+					  __alignof__(u64));
+	if (!pmu->counts)
+		return ERR_PTR(-ENOMEM);
+
+	pmu->identifier = identifier;
+	pmu->nr_events = nr_events;
+	pmu->cpu = cpumask_first(cpu_online_mask);
+
+	ret = xilinx_pcie_pmu_init_events(dev, pmu, events);
+	if (ret)
+		return ERR_PTR(ret);
+
+	pmu->attr_groups[0] = &xilinx_pcie_pmu_common_group;
+	pmu->attr_groups[1] = &xilinx_pcie_pmu_format_group;
+	pmu->attr_groups[2] = &pmu->events_group;
+
+	/* Keep to the [a-z0-9_] names of the other uncore PMUs */
+	name = devm_kasprintf(dev, GFP_KERNEL, "xlnx_pcie_%s", dev_name(dev));
+	if (!name)
+		return ERR_PTR(-ENOMEM);
+	strreplace(name, '.', '_');
+
+	pmu->pmu = (struct pmu) {
+		.module		= THIS_MODULE,
+		.task_ctx_nr	= perf_invalid_context,
+		.attr_groups	= pmu->attr_groups,
+		.capabilities	= PERF_PMU_CAP_NO_EXCLUDE,
+		.event_init	= xilinx_pcie_pmu_event_init,
+		.add		= xilinx_pcie_pmu_event_add,
+		.del		= xilinx_pcie_pmu_event_del,
+		.start		= xilinx_pcie_pmu_event_start,
+		.stop		= xilinx_pcie_pmu_event_stop,
+		.read		= xilinx_pcie_pmu_event_read,
+	};
+
+	ret = perf_pmu_register(&pmu->pmu, name, -1);
+	if (ret)
+		return ERR_PTR(ret);
+
+	ret = devm_add_action_or_reset(dev, xilinx_pcie_pmu_unregister, pmu);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return pmu;
+}
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Perf PMU counting the events of the Xilinx PCIe bridges
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ */
+
+#ifndef _PCIE_XILINX_PMU_H
+#define _PCIE_XILINX_PMU_H
+
+#include <linux/types.h>
+
+struct device;
+struct xilinx_pcie_pmu;
+
+#ifdef CONFIG_PCIE_XILINX_PMU
+struct xilinx_pcie_pmu *
+devm_xilinx_pcie_pmu_register(struct device *dev, const char *identifier,
+			      const char * const *events,
+			      unsigned int nr_events);
+void xilinx_pcie_pmu_add(struct xilinx_pcie_pmu *pmu, unsigned int event,
+			 unsigned int n);
+void xilinx_pcie_pmu_add_mask(struct xilinx_pcie_pmu *pmu, unsigned long mask);
+#else
+static inline struct xilinx_pcie_pmu *
+devm_xilinx_pcie_pmu_register(struct device *dev, const char *identifier,
+			      const char * const *events,
+			      unsigned int nr_events)
+{
+	return NULL;
+}
+
+static inline void xilinx_pcie_pmu_add(struct xilinx_pcie_pmu *pmu,
+				       unsigned int event, unsigned int n)
+{
+}
+
+static inline void xilinx_pcie_pmu_add_mask(struct xilinx_pcie_pmu *pmu,
+					    unsigned long mask)
+{
+}
+#endif
+
+#endif /* _PCIE_XILINX_PMU_H */
@@ -805,6 +805,7 @@ static int xhdmiphy_probe(struct platform_device *pdev)
 		return PTR_ERR(priv->phy_base);
 
 	mutex_init(&priv->hdmiphy_mutex);
+	spin_lock_init(&priv->cache.lock);
 
 	for_each_child_of_node(np, child) {
 		if (index >= XHDMIPHY_MAX_LANES) {
@@ -858,6 +859,9 @@ static int xhdmiphy_probe(struct platform_device *pdev)
 		ret = PTR_ERR(provider);
 		goto err_clk;
 	}
+
+	xhdmiphy_cache_init(priv);
+
 	return 0;
 
 err_clk:
@@ -872,6 +876,7 @@ static int xhdmiphy_remove(struct platform_device *pdev)
 {
 	struct xhdmiphy_dev *priv = platform_get_drvdata(pdev);
 
+	xhdmiphy_cache_exit(priv);
 	clk_disable_unprepare(priv->dru_clk);
 	clk_disable_unprepare(priv->tmds_clk);
 	clk_disable_unprepare(priv->axi_lite_clk);
@@ -7,6 +7,7 @@
 #include <linux/phy/phy.h>
 #include <linux/phy/phy-hdmi.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 
 /* HDMIPHY core registers: general registers. */
 #define XHDMIPHY_REFCLKSEL_REG			0x010
@@ -1019,6 +1020,70 @@ struct xhdmiphy_conf {
 	u8 tx_maxrate;
 };
 
+#define XHDMIPHY_CFG_CACHE_SIZE		16
+
+/* PLL dividers found for a line rate and a PLL input frequency */
+struct xhdmiphy_pll_cfg {
+	u64 linerate;
+	u64 refclk;
+	u8 chid;
+	u8 m;
+	u8 n1;
+	u8 n2;
+	u8 d;
+};
+
+/* MMCM settings found for a line rate and a video format */
+struct xhdmiphy_mmcm_cfg {
+	u64 linerate;
+	u32 refclk;
+	u8 dir;
+	u8 ppc;
+	u8 bpc;
+	u8 samplerate;
+	u8 tmdsclock_ratio;
+	struct xhdmiphy_mmcm mmcm;
+};
+
+/* Settings the last GT reconfiguration over DRP was derived from */
+struct xhdmiphy_drp_cfg {
+	struct quad quad;
+	u32 tx_refclk_hz;
+	u32 rx_refclk_hz;
+	u8 tx_samplerate;
+	u8 rx_dru_enabled;
+	u8 valid;
+};
+
+/* Time from a reference clock change to the GT being ready */
+struct xhdmiphy_switch_stats {
+	u64 start_ns;
+	u64 count;
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+	u64 last_ns;
+};
+
+struct xhdmiphy_cfg_cache {
+	spinlock_t lock;	/* protecting the PLL and MMCM entries */
+	struct xhdmiphy_pll_cfg pll[XHDMIPHY_CFG_CACHE_SIZE];
+	struct xhdmiphy_mmcm_cfg mmcm[XHDMIPHY_CFG_CACHE_SIZE];
+	u8 nr_pll;
+	u8 next_pll;
+	u8 nr_mmcm;
+	u8 next_mmcm;
+	u32 pll_hits;
+	u32 pll_misses;
+	u32 mmcm_hits;
+	u32 mmcm_misses;
+	/* indexed by direction, used with hdmiphy_mutex held */
+	struct xhdmiphy_drp_cfg drp[2];
+	struct xhdmiphy_drp_cfg drp_tmp;
+	u32 drp_skips;
+	struct xhdmiphy_switch_stats sw[2];
+};
+
 struct xhdmiphy_dev {
 	struct device *dev;
 	void __iomem *phy_base;
@@ -1044,6 +1109,8 @@ struct xhdmiphy_dev {
 	u8 tx_samplerate;
 	u8 rx_dru_enabled;
 	u8 qpll_present;
+	struct xhdmiphy_cfg_cache cache;
+	struct dentry *debugfs;
 };
 
 void xhdmiphy_set_clr(struct xhdmiphy_dev *inst, u32 addr, u32 reg_val,
@@ -1124,6 +1191,20 @@ void xhdmiphy_hdmi20_conf(struct xhdmiphy_dev *inst, enum dir dir);
 u32 xhdmiphy_hdmi21_conf(struct xhdmiphy_dev *inst, enum dir dir, u64 linerate, u8 nchannels);
 void xhdmiphy_clkdet_freq_reset(struct xhdmiphy_dev *inst, enum dir dir);
 u32 xhdmiphy_read(struct xhdmiphy_dev *inst, u32 addr);
+bool xhdmiphy_cache_get_pll(struct xhdmiphy_dev *inst,
+			    struct xhdmiphy_pll_cfg *cfg);
+void xhdmiphy_cache_put_pll(struct xhdmiphy_dev *inst,
+			    const struct xhdmiphy_pll_cfg *cfg);
+bool xhdmiphy_cache_get_mmcm(struct xhdmiphy_dev *inst,
+			     struct xhdmiphy_mmcm_cfg *cfg);
+void xhdmiphy_cache_put_mmcm(struct xhdmiphy_dev *inst,
+			     const struct xhdmiphy_mmcm_cfg *cfg);
+bool xhdmiphy_drp_cfg_changed(struct xhdmiphy_dev *inst, enum dir dir);
+void xhdmiphy_drp_cfg_invalidate(struct xhdmiphy_dev *inst);
+void xhdmiphy_switch_start(struct xhdmiphy_dev *inst, enum dir dir);
+void xhdmiphy_switch_done(struct xhdmiphy_dev *inst, enum dir dir);
+void xhdmiphy_cache_init(struct xhdmiphy_dev *inst);
+void xhdmiphy_cache_exit(struct xhdmiphy_dev *inst);
 void xhdmiphy_write(struct xhdmiphy_dev *inst, u32 addr, u32 val);
 
 struct gtpll_divs {
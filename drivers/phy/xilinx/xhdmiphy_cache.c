@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Xilinx HDMI PHY configuration cache
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ *
+ * The PLL dividers and the MMCM settings of a line rate only depend on the
+ * reference clock and the video format, a multiviewer switching between a
+ * few sources keeps computing the same ones. Keep the last settings found
+ * so that the known modes skip the searches, and remember what was last
+ * written to the GT over DRP so that an unchanged configuration is not
+ * written again before the PLL reset.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include "xhdmiphy.h"
+
+/**
+ * xhdmiphy_cache_get_pll - look up the PLL dividers of a line rate
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @cfg:	cfg holds the channel, the PLL input frequency and the line rate
+ *		to look up, the dividers are filled in when found
+ *
+ * @return:	true if the dividers were found
+ */
+bool xhdmiphy_cache_get_pll(struct xhdmiphy_dev *inst,
+			    struct xhdmiphy_pll_cfg *cfg)
+{
+	struct xhdmiphy_cfg_cache *cache = &inst->cache;
+	struct xhdmiphy_pll_cfg *ent;
+	bool found = false;
+	unsigned int i;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < cache->nr_pll; i++) {
+		ent = &cache->pll[i];
+		if (ent->chid == cfg->chid && ent->refclk == cfg->refclk &&
+		    ent->linerate == cfg->linerate) {
+			*cfg = *ent;
+			found = true;
+			break;
+		}
+	}
+
+	if (found)
+		cache->pll_hits++;
+	else
+		cache->pll_misses++;
+	spin_unlock(&cache->lock);
+
+	return found;
+}
+
+/**
+ * xhdmiphy_cache_put_pll - store the PLL dividers found for a line rate
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @cfg:	cfg holds the dividers found by the search, the oldest entry is
+ *		replaced once the cache is full
+ */
+void xhdmiphy_cache_put_pll(struct xhdmiphy_dev *inst,
+			    const struct xhdmiphy_pll_cfg *cfg)
+{
+	struct xhdmiphy_cfg_cache *cache = &inst->cache;
+
+	spin_lock(&cache->lock);
+	cache->pll[cache->next_pll] = *cfg;
+	cache->next_pll = (cache->next_pll + 1) % XHDMIPHY_CFG_CACHE_SIZE;
+	if (cache->nr_pll < XHDMIPHY_CFG_CACHE_SIZE)
+		cache->nr_pll++;
+	spin_unlock(&cache->lock);
+}
+
+/**
+ * xhdmiphy_cache_get_mmcm - look up the MMCM settings of a video format
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @cfg:	cfg holds the direction, the reference clock, the line rate and
+ *		the video format to look up, the MMCM settings are filled in
+ *		when found
+ *
+ * @return:	true if the settings were found
+ */
+bool xhdmiphy_cache_get_mmcm(struct xhdmiphy_dev *inst,
+			     struct xhdmiphy_mmcm_cfg *cfg)
+{
+	struct xhdmiphy_cfg_cache *cache = &inst->cache;
+	struct xhdmiphy_mmcm_cfg *ent;
+	bool found = false;
+	unsigned int i;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < cache->nr_mmcm; i++) {
+		ent = &cache->mmcm[i];
+		if (ent->dir == cfg->dir && ent->refclk == cfg->refclk &&
+		    ent->linerate == cfg->linerate && ent->ppc == cfg->ppc &&
+		    ent->bpc == cfg->bpc &&
+		    ent->samplerate == cfg->samplerate &&
+		    ent->tmdsclock_ratio == cfg->tmdsclock_ratio) {
+			*cfg = *ent;
+			found = true;
+			break;
+		}
+	}
+
+	if (found)
+		cache->mmcm_hits++;
+	else
+		cache->mmcm_misses++;
+	spin_unlock(&cache->lock);
+
+	return found;
+}
+
+/**
+ * xhdmiphy_cache_put_mmcm - store the MMCM settings found for a video format
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @cfg:	cfg holds the settings found by the search, the oldest entry is
+ *		replaced once the cache is full
+ */
+void xhdmiphy_cache_put_mmcm(struct xhdmiphy_dev *inst,
+			     const struct xhdmiphy_mmcm_cfg *cfg)
+{
+	struct xhdmiphy_cfg_cache *cache = &inst->cache;
+
+	spin_lock(&cache->lock);
+	cache->mmcm[cache->next_mmcm] = *cfg;
+	cache->next_mmcm = (cache->next_mmcm + 1) % XHDMIPHY_CFG_CACHE_SIZE;
+	if (cache->nr_mmcm < XHDMIPHY_CFG_CACHE_SIZE)
+		cache->nr_mmcm++;
+	spin_unlock(&cache->lock);
+}
+
+static void xhdmiphy_drp_snapshot(struct xhdmiphy_dev *inst,
+				  struct xhdmiphy_drp_cfg *cfg)
+{
+	unsigned int i;
+
+	memset(cfg, 0, sizeof(*cfg));
+	memcpy(&cfg->quad, &inst->quad, sizeof(cfg->quad));
+	/* the GT states change along the reset sequence, not the settings */
+	for (i = 0; i < ARRAY_SIZE(cfg->quad.plls); i++) {
+		cfg->quad.plls[i].rx_state = XHDMIPHY_GT_STATE_IDLE;
+		cfg->quad.plls[i].tx_state = XHDMIPHY_GT_STATE_IDLE;
+	}
+	cfg->tx_refclk_hz = inst->tx_refclk_hz;
+	cfg->rx_refclk_hz = inst->rx_refclk_hz;
+	cfg->tx_samplerate = inst->tx_samplerate;
+	cfg->rx_dru_enabled = inst->rx_dru_enabled;
+	cfg->valid = 1;
+}
+
+/**
+ * xhdmiphy_drp_cfg_changed - check if the GT needs to be reconfigured
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @dir:	dir is an indicator for RX or TX
+ *
+ * The DRP attributes of the GT are kept over the PLL and the GT resets, the
+ * clock, output divider and channel settings written by the last
+ * reconfiguration of @dir are still in place if the settings they were
+ * derived from are the same. The settings are recorded as the written ones
+ * when they changed.
+ *
+ * @return:	true if the settings changed since the last reconfiguration
+ */
+bool xhdmiphy_drp_cfg_changed(struct xhdmiphy_dev *inst, enum dir dir)
+{
+	struct xhdmiphy_cfg_cache *cache = &inst->cache;
+	struct xhdmiphy_drp_cfg *cfg = &cache->drp_tmp;
+
+	xhdmiphy_drp_snapshot(inst, cfg);
+	if (!memcmp(cfg, &cache->drp[dir], sizeof(*cfg))) {
+		cache->drp_skips++;
+		return false;
+	}
+
+	memcpy(&cache->drp[dir], cfg, sizeof(*cfg));
+
+	return true;
+}
+
+/**
+ * xhdmiphy_drp_cfg_invalidate - forget the settings written over DRP
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ *
+ * To be called when the GT is initialized, its DRP attributes are then
+ * unknown.
+ */
+void xhdmiphy_drp_cfg_invalidate(struct xhdmiphy_dev *inst)
+{
+	memset(inst->cache.drp, 0, sizeof(inst->cache.drp));
+}
+
+/**
+ * xhdmiphy_switch_start - record the start of a line rate switch
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @dir:	dir is an indicator for RX or TX
+ */
+void xhdmiphy_switch_start(struct xhdmiphy_dev *inst, enum dir dir)
+{
+	inst->cache.sw[dir].start_ns = ktime_get_ns();
+}
+
+/**
+ * xhdmiphy_switch_done - account a line rate switch once the GT is ready
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ * @dir:	dir is an indicator for RX or TX
+ */
+void xhdmiphy_switch_done(struct xhdmiphy_dev *inst, enum dir dir)
+{
+	struct xhdmiphy_switch_stats *sw = &inst->cache.sw[dir];
+	u64 lat;
+
+	if (!sw->start_ns)
+		return;
+
+	lat = ktime_get_ns() - sw->start_ns;
+	sw->start_ns = 0;
+
+	if (!sw->count || lat < sw->min_ns)
+		sw->min_ns = lat;
+	if (lat > sw->max_ns)
+		sw->max_ns = lat;
+	sw->last_ns = lat;
+	sw->total_ns += lat;
+	sw->count++;
+}
+
+static void xhdmiphy_switch_show(struct seq_file *s, const char *name,
+				 const struct xhdmiphy_switch_stats *sw)
+{
+	seq_printf(s, "%s switches: %llu", name, sw->count);
+	if (sw->count)
+		seq_printf(s, ", last %llu us, min %llu us, avg %llu us, max %llu us",
+			   div_u64(sw->last_ns, NSEC_PER_USEC),
+			   div_u64(sw->min_ns, NSEC_PER_USEC),
+			   div64_u64(sw->total_ns, sw->count * NSEC_PER_USEC),
+			   div_u64(sw->max_ns, NSEC_PER_USEC));
+	seq_putc(s, '\n');
+}
+
+static int xhdmiphy_stats_show(struct seq_file *s, void *data)
+{
+	struct xhdmiphy_dev *inst = s->private;
+	struct xhdmiphy_cfg_cache *cache = &inst->cache;
+
+	mutex_lock(&inst->hdmiphy_mutex);
+	xhdmiphy_switch_show(s, "tx", &cache->sw[XHDMIPHY_DIR_TX]);
+	xhdmiphy_switch_show(s, "rx", &cache->sw[XHDMIPHY_DIR_RX]);
+
+	spin_lock(&cache->lock);
+	seq_printf(s, "pll cache: %u entries, %u hits, %u misses\n",
+		   cache->nr_pll, cache->pll_hits, cache->pll_misses);
+	seq_printf(s, "mmcm cache: %u entries, %u hits, %u misses\n",
+		   cache->nr_mmcm, cache->mmcm_hits, cache->mmcm_misses);
+	spin_unlock(&cache->lock);
+
+	seq_printf(s, "gt reconfigurations skipped: %u\n", cache->drp_skips);
+	mutex_unlock(&inst->hdmiphy_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xhdmiphy_stats);
+
+/**
+ * xhdmiphy_cache_init - report the statistics of the configuration cache
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ *
+ * The switch latencies and the cache statistics are reported in the
+ * "stats" file of the debugfs directory of the PHY.
+ */
+void xhdmiphy_cache_init(struct xhdmiphy_dev *inst)
+{
+	inst->debugfs = debugfs_create_dir(dev_name(inst->dev), NULL);
+	debugfs_create_file("stats", 0444, inst->debugfs, inst,
+			    &xhdmiphy_stats_fops);
+}
+
+/**
+ * xhdmiphy_cache_exit - release the configuration cache
+ *
+ * @inst:	inst is a pointer to the xhdmiphy core instance
+ */
+void xhdmiphy_cache_exit(struct xhdmiphy_dev *inst)
+{
+	debugfs_remove_recursive(inst->debugfs);
+}
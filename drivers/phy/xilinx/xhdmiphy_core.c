@@ -1051,6 +1051,7 @@ u32 xhdmiphy_pll_cal(struct xhdmiphy_dev *inst, enum chid chid, enum dir dir,
 	struct channel *pll_ptr = &inst->quad.plls[XHDMIPHY_CH2IDX(chid)];
 	u64 pllclk_out_freq, linerate_freq;
 	u64 pll_clkin_freqin = pll_clkin_freq;
+	struct xhdmiphy_pll_cfg cfg;
 	u32 status;
 	const u8 *m, *n1, *n2, *d;
 	u8 id, id0, id1;
@@ -1059,6 +1060,12 @@ u32 xhdmiphy_pll_cal(struct xhdmiphy_dev *inst, enum chid chid, enum dir dir,
 		pll_clkin_freqin =
 			xhdmiphy_get_quad_refclk(inst, pll_ptr->pll_refclk);
 
+	cfg.chid = chid;
+	cfg.refclk = pll_clkin_freqin;
+	cfg.linerate = pll_ptr->linerate;
+	if (xhdmiphy_cache_get_pll(inst, &cfg))
+		goto calc_done;
+
 	/* select PLL value table offsets */
 	if (xhdmiphy_is_ch(chid))
 		gtpll_divs = &inst->gt_adp->cpll_divs;
@@ -1082,7 +1089,7 @@ u32 xhdmiphy_pll_cal(struct xhdmiphy_dev *inst, enum chid chid, enum dir dir,
 				for (d = gtpll_divs->d; *d != 0; d++) {
 					linerate_freq = pllclk_out_freq / *d;
 					if (linerate_freq == pll_ptr->linerate)
-						goto calc_done;
+						goto calc_found;
 				}
 			}
 		}
@@ -1090,11 +1097,18 @@ u32 xhdmiphy_pll_cal(struct xhdmiphy_dev *inst, enum chid chid, enum dir dir,
 	/* Calculation failed, don't change divisor settings */
 	return 1;
 
+calc_found:
+	cfg.m = *m;
+	cfg.n1 = *n1;
+	cfg.n2 = *n2;
+	cfg.d = *d;
+	xhdmiphy_cache_put_pll(inst, &cfg);
+
 calc_done:
 	/* Found the multiplier and divisor values for requested line rate */
-	pll_ptr->pll_param.m_refclk_div = *m;
-	pll_ptr->pll_param.nfb_div = *n1;
-	pll_ptr->pll_param.n2fb_div = *n2;
+	pll_ptr->pll_param.m_refclk_div = cfg.m;
+	pll_ptr->pll_param.nfb_div = cfg.n1;
+	pll_ptr->pll_param.n2fb_div = cfg.n2;
 	pll_ptr->pll_param.is_lowerband = 1;
 
 	if (xhdmiphy_is_cmn(chid)) {
@@ -1104,7 +1118,7 @@ u32 xhdmiphy_pll_cal(struct xhdmiphy_dev *inst, enum chid chid, enum dir dir,
 
 	xhdmiphy_ch2ids(inst, chid, &id0, &id1);
 	for (id = id0; id <= id1; id++) {
-		inst->quad.plls[XHDMIPHY_CH2IDX(id)].outdiv[dir] = *d;
+		inst->quad.plls[XHDMIPHY_CH2IDX(id)].outdiv[dir] = cfg.d;
 		if (dir == XHDMIPHY_DIR_RX)
 			xhdmiphy_cfg_set_cdr(inst, (enum chid)id);
 	}
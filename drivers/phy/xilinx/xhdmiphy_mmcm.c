@@ -1152,6 +1152,7 @@ u32 xhdmiphy_cal_mmcm_param(struct xhdmiphy_dev *inst, enum chid chid,
 			    enum dir dir, enum ppc ppc, enum color_depth bpc)
 {
 	struct xhdmiphy_mmcm *mmcm_ptr;
+	struct xhdmiphy_mmcm_cfg cfg;
 	enum pll_type pll_type;
 	u64 linerate = 0;
 	u32 refclk, div, mult;
@@ -1180,6 +1181,27 @@ u32 xhdmiphy_cal_mmcm_param(struct xhdmiphy_dev *inst, enum chid chid,
 		return 1;
 	}
 
+	if (dir == XHDMIPHY_DIR_RX) {
+		cfg.refclk = inst->rx_refclk_hz;
+		cfg.samplerate = 1;
+		mmcm_ptr = &inst->quad.rx_mmcm;
+	} else {
+		cfg.refclk = inst->tx_refclk_hz;
+		cfg.samplerate = inst->tx_samplerate;
+		mmcm_ptr = &inst->quad.tx_mmcm;
+	}
+	cfg.dir = dir;
+	cfg.linerate = linerate;
+	cfg.ppc = ppc;
+	cfg.bpc = bpc;
+	cfg.tmdsclock_ratio = inst->rx_tmdsclock_ratio;
+	if (xhdmiphy_cache_get_mmcm(inst, &cfg)) {
+		cfg.mmcm.index = mmcm_ptr->index;
+		*mmcm_ptr = cfg.mmcm;
+
+		return 0;
+	}
+
 	div = 1;
 	do {
 		if (dir == XHDMIPHY_DIR_RX) {
@@ -1405,8 +1427,12 @@ u32 xhdmiphy_cal_mmcm_param(struct xhdmiphy_dev *inst, enum chid chid,
 		div++;
 	} while (!valid && (div > 0) && (div < 107));
 
-	if (valid)
+	if (valid) {
+		cfg.mmcm = *mmcm_ptr;
+		xhdmiphy_cache_put_mmcm(inst, &cfg);
+
 		return 0;
+	}
 
 	dev_err(inst->dev, "failed to caliculate mmmcm params\n");
 
@@ -493,6 +493,7 @@ u32 xhdmiphy_init_phy(struct xhdmiphy_dev *inst)
 	u8 id, id0, id1;
 
 	xhdmiphy_cfg_init(inst);
+	xhdmiphy_drp_cfg_invalidate(inst);
 
 	xhdmiphy_ch2ids(inst, XHDMIPHY_CHID_CHA, &id0, &id1);
 	for (id = id0; id <= id1; id++) {
@@ -1156,6 +1157,7 @@ static void xhdmiphy_tx_timertimeout_handler(struct xhdmiphy_dev *inst)
 {
 	enum chid chid;
 	enum pll_type pll_type;
+	bool reconf;
 	u8 val_cmp, id, id0, id1;
 
 	if (inst->conf.gt_type != XHDMIPHY_GTYE5 &&
@@ -1173,9 +1175,13 @@ static void xhdmiphy_tx_timertimeout_handler(struct xhdmiphy_dev *inst)
 		if (pll_type != XHDMIPHY_PLL_CPLL)
 			xhdmiphy_write_refclksel(inst);
 
-		xhdmiphy_clk_reconf(inst, chid);
-		xhdmiphy_outdiv_reconf(inst, XHDMIPHY_CHID_CHA,
-				       XHDMIPHY_DIR_TX);
+		/* a known mode finds its settings in place */
+		reconf = xhdmiphy_drp_cfg_changed(inst, XHDMIPHY_DIR_TX);
+		if (reconf) {
+			xhdmiphy_clk_reconf(inst, chid);
+			xhdmiphy_outdiv_reconf(inst, XHDMIPHY_CHID_CHA,
+					       XHDMIPHY_DIR_TX);
+		}
 		if (inst->conf.gt_type == XHDMIPHY_GTTYPE_GTHE4 ||
 		    inst->conf.gt_type == XHDMIPHY_GTTYPE_GTYE4) {
 			xhdmiphy_set_bufgtdiv(inst, XHDMIPHY_DIR_TX,
@@ -1186,8 +1192,9 @@ static void xhdmiphy_tx_timertimeout_handler(struct xhdmiphy_dev *inst)
 					      inst->quad.plls->tx_outdiv / 2);
 		}
 
-		xhdmiphy_dir_reconf(inst, XHDMIPHY_CHID_CHA,
-				    XHDMIPHY_DIR_TX);
+		if (reconf)
+			xhdmiphy_dir_reconf(inst, XHDMIPHY_CHID_CHA,
+					    XHDMIPHY_DIR_TX);
 		/* assert PLL reset */
 		xhdmiphy_reset_gtpll(inst, XHDMIPHY_CHID_CHA,
 				     XHDMIPHY_DIR_TX, true);
@@ -1311,11 +1318,14 @@ static void xhdmiphy_rx_timertimeout_handler(struct xhdmiphy_dev *inst)
 						 XHDMIPHY_CHID_CH1);
 		/* determine which channel(s) to operate on */
 		chid = xhdmiphy_get_rcfg_chid(pll_type);
-		xhdmiphy_clk_reconf(inst, chid);
-		xhdmiphy_outdiv_reconf(inst, XHDMIPHY_CHID_CHA,
-				       XHDMIPHY_DIR_RX);
-		xhdmiphy_dir_reconf(inst, XHDMIPHY_CHID_CHA,
-				    XHDMIPHY_DIR_RX);
+		/* a known mode finds its settings in place */
+		if (xhdmiphy_drp_cfg_changed(inst, XHDMIPHY_DIR_RX)) {
+			xhdmiphy_clk_reconf(inst, chid);
+			xhdmiphy_outdiv_reconf(inst, XHDMIPHY_CHID_CHA,
+					       XHDMIPHY_DIR_RX);
+			xhdmiphy_dir_reconf(inst, XHDMIPHY_CHID_CHA,
+					    XHDMIPHY_DIR_RX);
+		}
 		/* assert RX PLL reset */
 		xhdmiphy_reset_gtpll(inst, XHDMIPHY_CHID_CHA,
 				     XHDMIPHY_DIR_RX, true);
@@ -1741,6 +1751,8 @@ static void xhdmiphy_txgt_aligndone_handler(struct xhdmiphy_dev *inst)
 	for (id = id0; id <= id1; id++)
 		inst->quad.plls[XHDMIPHY_CH2IDX(id)].tx_state =
 						XHDMIPHY_GT_STATE_READY;
+
+	xhdmiphy_switch_done(inst, XHDMIPHY_DIR_TX);
 }
 
 static void xhdmiphy_txgt_rstdone_handler(struct xhdmiphy_dev *inst)
@@ -1793,6 +1805,8 @@ static void xhdmiphy_txgt_rstdone_handler(struct xhdmiphy_dev *inst)
 		for (id = id0; id <= id1; id++)
 			inst->quad.plls[XHDMIPHY_CH2IDX(id)].tx_state =
 							XHDMIPHY_GT_STATE_READY;
+
+		xhdmiphy_switch_done(inst, XHDMIPHY_DIR_TX);
 	}
 }
 
@@ -1811,6 +1825,8 @@ static void xhdmiphy_rxgt_rstdone_handler(struct xhdmiphy_dev *inst)
 	if (inst->rx_dru_enabled)
 		xhdmiphy_dru_reset(inst, XHDMIPHY_CHID_CHA, false);
 
+	xhdmiphy_switch_done(inst, XHDMIPHY_DIR_RX);
+
 	if (inst->phycb[RX_READY_CB].cb)
 		inst->phycb[RX_READY_CB].cb(inst->phycb[RX_READY_CB].data);
 }
@@ -1833,6 +1849,8 @@ static void xhdmiphy_tx_freqchnage_handler(struct xhdmiphy_dev *inst)
 		xhdmiphy_clr(inst, XHDMIPHY_PATGEN_CTRL_REG,
 			     XHDMIPHY_PATGEN_CTRL_ENABLE_MASK);
 
+	xhdmiphy_switch_start(inst, XHDMIPHY_DIR_TX);
+
 	pll_type = xhdmiphy_get_pll_type(inst, XHDMIPHY_DIR_TX,
 					 XHDMIPHY_CHID_CH1);
 
@@ -1882,6 +1900,8 @@ static void xhdmiphy_rx_freqchange_handler(struct xhdmiphy_dev *inst)
 		if (inst->conf.rx_refclk_sel != inst->conf.rx_frl_refclk_sel)
 			return;
 
+	xhdmiphy_switch_start(inst, XHDMIPHY_DIR_RX);
+
 	xhdmiphy_ch2ids(inst, XHDMIPHY_CHID_CHA, &id0, &id1);
 	for (id = id0; id <= id1; id++)
 		inst->quad.plls[XHDMIPHY_CH2IDX(id)].rx_state =
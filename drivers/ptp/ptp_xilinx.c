@@ -97,16 +97,25 @@ static inline void xlnx_ptp_iow(struct xlnx_ptp_timer *timer, off_t reg,
 /*
  * Inline timer helpers
  */
+
+/*
+ * The time is latched by the snapshot write. The first read cannot
+ * complete before the write has reached the timer, so the system time
+ * taken after it brackets the latch.
+ */
 static inline void xlnx_tod_read(struct xlnx_ptp_timer *timer,
-				 struct timespec64 *ts)
+				 struct timespec64 *ts,
+				 struct ptp_system_timestamp *sts)
 {
 	u32 sech, secl, nsec;
 
+	ptp_read_system_prets(sts);
 	xlnx_ptp_iow(timer, XPTPTIMER_TOD_SNAPSHOT_OFFSET,
 		     XPTPTIMER_SNAPSHOT_MASK);
 
 	/* use TX port here */
 	nsec = xlnx_ptp_ior(timer, XPTPTIMER_PORT_TX_NS_SNAP_OFFSET);
+	ptp_read_system_postts(sts);
 	secl = xlnx_ptp_ior(timer, XPTPTIMER_PORT_TX_SEC_0_SNAP_OFFSET);
 	sech = xlnx_ptp_ior(timer, XPTPTIMER_PORT_TX_SEC_1_SNAP_OFFSET);
 
@@ -262,22 +271,29 @@ static int xlnx_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 }
 
 /**
- * xlnx_ptp_gettime - Get the current time on the hardware clock
+ * xlnx_ptp_gettimex - Get the current time on the hardware clock
  * @ptp: ptp clock structure
  * @ts: timespec64 containing the current TX port timer time.
+ * @sts: system timestamps taken around the latch of the time, may be NULL
  * Return: 0 on success
  * Since TX and RX ports are initialized and adjusted simultaneously,
  * they should be the same.
  *
+ * The timer cannot latch the system counter, so there is no
+ * getcrosststamp.
  */
-static int xlnx_ptp_gettime(struct ptp_clock_info *ptp, struct timespec64 *ts)
+static int xlnx_ptp_gettimex(struct ptp_clock_info *ptp,
+			     struct timespec64 *ts,
+			     struct ptp_system_timestamp *sts)
 {
 	struct xlnx_ptp_timer *timer = container_of(ptp, struct xlnx_ptp_timer,
 						    ptp_clock_info);
+	unsigned long flags;
 
-	spin_lock(&timer->reg_lock);
-	xlnx_tod_read(timer, ts);
-	spin_unlock(&timer->reg_lock);
+	/* Keep interrupts out of the system timestamps window */
+	spin_lock_irqsave(&timer->reg_lock, flags);
+	xlnx_tod_read(timer, ts, sts);
+	spin_unlock_irqrestore(&timer->reg_lock, flags);
 
 	return 0;
 }
@@ -316,7 +332,7 @@ static struct ptp_clock_info xlnx_ptp_clock_info = {
 	.n_ext_ts	= 0,
 	.adjfine	= xlnx_ptp_adjfine,
 	.adjtime	= xlnx_ptp_adjtime,
-	.gettime64	= xlnx_ptp_gettime,
+	.gettimex64	= xlnx_ptp_gettimex,
 	.settime64	= xlnx_ptp_settime,
 	.enable		= xlnx_ptp_enable,
 };
@@ -1261,14 +1261,18 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 {
 	struct resource_table *loaded_table;
 	struct device *dev = &rproc->dev;
+	u64 start;
 	int ret;
 
 	/* load the ELF segments to memory */
+	start = ktime_get_ns();
 	ret = rproc_load_segments(rproc, fw);
 	if (ret) {
 		dev_err(dev, "Failed to load program segments: %d\n", ret);
 		return ret;
 	}
+	rproc->boot_timing.load_ns = ktime_get_ns() - start;
+	start = ktime_get_ns();
 
 	/*
 	 * The starting device has been given the rproc->cached_table as the
@@ -1307,6 +1311,7 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 	}
 
 	rproc->state = RPROC_RUNNING;
+	rproc->boot_timing.start_ns = ktime_get_ns() - start;
 
 	dev_info(dev, "remote processor %s is now up\n", rproc->name);
 
@@ -1371,6 +1376,7 @@ static int rproc_fw_boot(struct rproc *rproc, const struct firmware *fw)
 {
 	struct device *dev = &rproc->dev;
 	const char *name = rproc->firmware;
+	u64 start = ktime_get_ns();
 	int ret;
 
 	ret = rproc_fw_sanity_check(rproc, fw);
@@ -1423,6 +1429,7 @@ static int rproc_fw_boot(struct rproc *rproc, const struct firmware *fw)
 			ret);
 		goto clean_up_resources;
 	}
+	rproc->boot_timing.prepare_ns = ktime_get_ns() - start;
 
 	ret = rproc_start(rproc, fw);
 	if (ret)
@@ -1896,6 +1903,7 @@ int rproc_boot(struct rproc *rproc)
 {
 	const struct firmware *firmware_p;
 	struct device *dev;
+	u64 start;
 	int ret;
 
 	if (!rproc) {
@@ -1930,12 +1938,16 @@ int rproc_boot(struct rproc *rproc)
 	} else {
 		dev_info(dev, "powering up %s\n", rproc->name);
 
+		memset(&rproc->boot_timing, 0, sizeof(rproc->boot_timing));
+		start = ktime_get_ns();
+
 		/* load firmware */
 		ret = request_firmware(&firmware_p, rproc->firmware, dev);
 		if (ret < 0) {
 			dev_err(dev, "request_firmware failed: %d\n", ret);
 			goto downref_rproc;
 		}
+		rproc->boot_timing.request_ns = ktime_get_ns() - start;
 
 		ret = rproc_fw_boot(rproc, firmware_p);
 
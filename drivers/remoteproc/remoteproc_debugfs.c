@@ -378,6 +378,27 @@ static int rproc_carveouts_show(struct seq_file *seq, void *p)
 
 DEFINE_SHOW_ATTRIBUTE(rproc_carveouts);
 
+/* Expose the durations of the phases of the last boot via debugfs */
+static int rproc_boot_timing_show(struct seq_file *seq, void *p)
+{
+	struct rproc *rproc = seq->private;
+	struct rproc_boot_timing *timing = &rproc->boot_timing;
+
+	seq_printf(seq, "request: %llu us\n",
+		   div_u64(timing->request_ns, NSEC_PER_USEC));
+	seq_printf(seq, "prepare: %llu us\n",
+		   div_u64(timing->prepare_ns, NSEC_PER_USEC));
+	seq_printf(seq, "load: %llu us, %llu bytes, %llu bytes by DMA\n",
+		   div_u64(timing->load_ns, NSEC_PER_USEC), timing->load_bytes,
+		   timing->load_dma_bytes);
+	seq_printf(seq, "start: %llu us\n",
+		   div_u64(timing->start_ns, NSEC_PER_USEC));
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(rproc_boot_timing);
+
 void rproc_remove_trace_file(struct dentry *tfile)
 {
 	debugfs_remove(tfile);
@@ -416,6 +437,8 @@ void rproc_create_debug_dir(struct rproc *rproc)
 			    rproc, &rproc_carveouts_fops);
 	debugfs_create_file("coredump", 0600, rproc->dbg_dir,
 			    rproc, &rproc_coredump_fops);
+	debugfs_create_file("boot_timing", 0400, rproc->dbg_dir,
+			    rproc, &rproc_boot_timing_fops);
 }
 
 void __init rproc_init_debugfs(void)
@@ -18,13 +18,22 @@
 #define pr_fmt(fmt)    "%s: " fmt, __func__
 
 #include <linux/module.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
 #include <linux/firmware.h>
 #include <linux/remoteproc.h>
 #include <linux/elf.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
+#include <linux/vmalloc.h>
 
 #include "remoteproc_internal.h"
 #include "remoteproc_elf_helpers.h"
 
+/* Segments smaller than this are copied by the CPU even with a load_chan */
+#define RPROC_DMA_LOAD_MIN_SIZE		SZ_16K
+#define RPROC_DMA_LOAD_TIMEOUT_MS	5000
+
 /**
  * rproc_elf_sanity_check() - Sanity Check for ELF32/ELF64 firmware image
  * @rproc: the remote processor handle
@@ -131,6 +140,145 @@ u64 rproc_elf_get_boot_addr(struct rproc *rproc, const struct firmware *fw)
 }
 EXPORT_SYMBOL(rproc_elf_get_boot_addr);
 
+static void rproc_elf_dma_done(void *param)
+{
+	complete(param);
+}
+
+/* Describe the pages of the (possibly vmalloc'ed) firmware data */
+static int rproc_elf_sg_from_buf(struct sg_table *sgt, const void *buf,
+				 size_t len)
+{
+	const void *p = buf - offset_in_page(buf);
+	struct page **pages;
+	int i, nr_pages, ret;
+
+	nr_pages = DIV_ROUND_UP(offset_in_page(buf) + len, PAGE_SIZE);
+	pages = kmalloc_array(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_pages; i++, p += PAGE_SIZE) {
+		if (is_vmalloc_addr(p)) {
+			pages[i] = vmalloc_to_page(p);
+		} else if (virt_addr_valid(p)) {
+			pages[i] = virt_to_page(p);
+		} else {
+			ret = -EFAULT;
+			goto out;
+		}
+	}
+
+	ret = sg_alloc_table_from_pages(sgt, pages, nr_pages,
+					offset_in_page(buf), len, GFP_KERNEL);
+out:
+	kfree(pages);
+	return ret;
+}
+
+/**
+ * rproc_elf_dma_copy() - copy a segment with the load_chan of the rproc
+ * @rproc: remote processor which will be booted using this fw segment
+ * @da: device address of the segment
+ * @src: segment data in the firmware image
+ * @len: length of the segment data
+ *
+ * Return: 0 on success and an appropriate error code otherwise, in which
+ * case the segment has to be copied by the CPU
+ */
+static int rproc_elf_dma_copy(struct rproc *rproc, u64 da, const void *src,
+			      size_t len)
+{
+	struct dma_chan *chan = rproc->load_chan;
+	struct device *dma_dev = chan->device->dev;
+	struct dma_async_tx_descriptor *tx;
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct rproc_mem_entry *carveout;
+	dma_addr_t dst;
+	unsigned long flags = 0;
+	struct scatterlist *sg;
+	dma_cookie_t cookie = -EINVAL;
+	struct sg_table sgt;
+	phys_addr_t pa = 0;
+	size_t offset = 0;
+	int i, ret;
+
+	ret = -EINVAL;
+	list_for_each_entry(carveout, &rproc->carveouts, node) {
+		if (!carveout->va || da < carveout->da ||
+		    da - carveout->da + len > carveout->len)
+			continue;
+
+		pa = carveout->dma + (da - carveout->da);
+		ret = 0;
+		break;
+	}
+	if (ret)
+		return ret;
+
+	ret = rproc_elf_sg_from_buf(&sgt, src, len);
+	if (ret)
+		return ret;
+
+	ret = dma_map_sgtable(dma_dev, &sgt, DMA_TO_DEVICE, 0);
+	if (ret)
+		goto free_table;
+
+	dst = dma_map_resource(dma_dev, pa, len, DMA_FROM_DEVICE, 0);
+	if (dma_mapping_error(dma_dev, dst)) {
+		ret = -ENOMEM;
+		goto unmap_sg;
+	}
+
+	for_each_sgtable_dma_sg(&sgt, sg, i) {
+		/* Only the last descriptor signals the completion */
+		if (i == sgt.nents - 1)
+			flags = DMA_PREP_INTERRUPT;
+
+		tx = dmaengine_prep_dma_memcpy(chan, dst + offset,
+					       sg_dma_address(sg),
+					       sg_dma_len(sg), flags);
+		if (!tx) {
+			ret = -EIO;
+			goto terminate;
+		}
+
+		if (flags) {
+			tx->callback = rproc_elf_dma_done;
+			tx->callback_param = &done;
+		}
+
+		cookie = dmaengine_submit(tx);
+		ret = dma_submit_error(cookie);
+		if (ret)
+			goto terminate;
+
+		offset += sg_dma_len(sg);
+	}
+
+	dma_async_issue_pending(chan);
+
+	if (!wait_for_completion_timeout(&done,
+			msecs_to_jiffies(RPROC_DMA_LOAD_TIMEOUT_MS))) {
+		ret = -ETIMEDOUT;
+		goto terminate;
+	}
+
+	if (dma_async_is_tx_complete(chan, cookie, NULL, NULL) != DMA_COMPLETE)
+		ret = -EIO;
+	goto unmap_dst;
+
+terminate:
+	dmaengine_terminate_sync(chan);
+unmap_dst:
+	dma_unmap_resource(dma_dev, dst, len, DMA_FROM_DEVICE, 0);
+unmap_sg:
+	dma_unmap_sgtable(dma_dev, &sgt, DMA_TO_DEVICE, 0);
+free_table:
+	sg_free_table(&sgt);
+	return ret;
+}
+
 /**
  * rproc_elf_load_segments() - load firmware segments to memory
  * @rproc: remote processor which will be booted using these fw segments
@@ -155,6 +303,9 @@ EXPORT_SYMBOL(rproc_elf_get_boot_addr);
  * directly allocate memory for every segment/resource. This is not yet
  * supported, though.
  *
+ * If the rproc has a load_chan, the large segments are copied by this DMA
+ * channel rather than by the CPU.
+ *
  * Return: 0 on success and an appropriate error code otherwise
  */
 int rproc_elf_load_segments(struct rproc *rproc, const struct firmware *fw)
@@ -179,6 +330,7 @@ int rproc_elf_load_segments(struct rproc *rproc, const struct firmware *fw)
 		u64 offset = elf_phdr_get_p_offset(class, phdr);
 		u32 type = elf_phdr_get_p_type(class, phdr);
 		bool is_iomem = false;
+		bool copied;
 		void *ptr;
 
 		if (type != PT_LOAD || !memsz)
@@ -218,7 +370,21 @@ int rproc_elf_load_segments(struct rproc *rproc, const struct firmware *fw)
 		}
 
 		/* put the segment where the remote processor expects it */
-		if (filesz) {
+		rproc->boot_timing.load_bytes += filesz;
+		copied = false;
+		if (rproc->load_chan && filesz >= RPROC_DMA_LOAD_MIN_SIZE) {
+			ret = rproc_elf_dma_copy(rproc, da, elf_data + offset,
+						 filesz);
+			if (ret)
+				dev_dbg(dev, "DMA copy of da 0x%llx failed: %d\n",
+					da, ret);
+			copied = !ret;
+			ret = 0;
+		}
+
+		if (copied) {
+			rproc->boot_timing.load_dma_bytes += filesz;
+		} else if (filesz) {
 			if (is_iomem)
 				memcpy_toio((void __iomem *)ptr, elf_data + offset, filesz);
 			else
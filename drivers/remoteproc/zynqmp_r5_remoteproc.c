@@ -6,9 +6,13 @@
  *
  */
 
+#include <linux/debugfs.h>
+#include <linux/dmaengine.h>
 #include <linux/firmware/xlnx-zynqmp.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/mailbox_client.h>
 #include <linux/mailbox/zynqmp-ipi-message.h>
@@ -18,6 +22,8 @@
 #include <linux/of_reserved_mem.h>
 #include <linux/platform_device.h>
 #include <linux/remoteproc.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/skbuff.h>
 #include <linux/sysfs.h>
 
@@ -44,6 +50,63 @@
  */
 #define RSC_TBL_SIZE	0x400
 
+/* Upper bounds in us of the buckets of the notification latency histogram */
+static const unsigned int rx_latency_buckets_us[] = { 5, 10, 20, 50, 100 };
+#define RX_LATENCY_BUCKETS	(ARRAY_SIZE(rx_latency_buckets_us) + 1)
+
+/**
+ * enum xlnx_rpu_rx_mode - how the notifications from the RPU are handled
+ * @RX_MODE_WORK: from the system workqueue, scheduled by the IPI
+ * @RX_MODE_THREAD: from a real-time thread of the core, woken by the IPI
+ * @RX_MODE_POLL: from a thread of the core that polls the vrings without
+ *		  waiting for the IPI
+ */
+enum xlnx_rpu_rx_mode {
+	RX_MODE_WORK	= 0,
+	RX_MODE_THREAD	= 1,
+	RX_MODE_POLL	= 2,
+};
+
+static uint rx_mode = RX_MODE_WORK;
+module_param(rx_mode, uint, 0444);
+MODULE_PARM_DESC(rx_mode,
+		 "Notification handling: 0 workqueue, 1 real-time thread, 2 vring polling (default: 0)");
+
+static int poll_cpu = -1;
+module_param(poll_cpu, int, 0444);
+MODULE_PARM_DESC(poll_cpu,
+		 "CPU the vring polling threads are bound to, -1 for any (default: -1)");
+
+static bool dma_load;
+module_param(dma_load, bool, 0444);
+MODULE_PARM_DESC(dma_load,
+		 "Load the firmware segments with a DMA memcpy channel (default: false)");
+
+static bool auto_boot;
+module_param(auto_boot, bool, 0444);
+MODULE_PARM_DESC(auto_boot,
+		 "Boot the cores at probe, in parallel in split mode (default: false)");
+
+/**
+ * struct xlnx_rpu_rx_stats - statistics of the notifications from the RPU
+ * @ipis: number of IPIs received
+ * @handled: number of IPIs handled, several IPIs may be handled at once
+ * @polled: number of vring polls that found used buffers before the IPI
+ * @min_ns: shortest time from an IPI to its handling
+ * @max_ns: longest time from an IPI to its handling
+ * @total_ns: sum of the times from the IPIs to their handling
+ * @hist: histogram of the times from the IPIs to their handling
+ */
+struct xlnx_rpu_rx_stats {
+	u64 ipis;
+	u64 handled;
+	u64 polled;
+	u64 min_ns;
+	u64 max_ns;
+	u64 total_ns;
+	u64 hist[RX_LATENCY_BUCKETS];
+};
+
 enum soc_type_t {
 	SOC_ZYNQMP	= 0,
 	SOC_VERSAL	= 1,
@@ -79,6 +142,10 @@ struct sram_addr_data {
  * @tx_mc: tx mailbox client
  * @rx_mc: rx mailbox client
  * @mbox_work: mbox_work for the RPU remoteproc
+ * @rx_task: thread handling the notifications, unless in RX_MODE_WORK
+ * @rx_pending: an IPI has been received and not handled yet
+ * @rx_stamp: time the last IPI was received at
+ * @rx_stats: statistics of the notifications from the RPU
  * @tx_mc_skbs: socket buffers for tx mailbox client
  * @dev: device of RPU instance
  * @rproc: rproc handle
@@ -96,6 +163,10 @@ struct xlnx_rpu_rproc {
 	struct mbox_client tx_mc;
 	struct mbox_client rx_mc;
 	struct work_struct mbox_work;
+	struct task_struct *rx_task;
+	atomic_t rx_pending;
+	u64 rx_stamp;
+	struct xlnx_rpu_rx_stats rx_stats;
 	struct sk_buff_head tx_mc_skbs;
 	struct device *dev;
 	struct rproc *rproc;
@@ -819,20 +890,61 @@ static int event_notified_idr_cb(int id, void *ptr, void *data)
 }
 
 /**
- * handle_event_notified() - remoteproc notification work function
- * @work: pointer to the work structure
+ * event_polled_idr_cb() - event polled idr callback
+ * @id: idr id
+ * @ptr: pointer to idr private data
+ * @data: data passed to idr_for_each callback
  *
- * It checks each registered remoteproc notify IDs.
+ * Pass notification to remoteproc virtio if the vring has used buffers
+ *
+ * Return: 0. the remaining vrings are polled whether this one had used
+ *          buffers or not.
+ **/
+static int event_polled_idr_cb(int id, void *ptr, void *data)
+{
+	struct rproc *rproc = data;
+
+	if (rproc_vq_interrupt(rproc, id) == IRQ_HANDLED)
+		((struct xlnx_rpu_rproc *)rproc->priv)->rx_stats.polled++;
+	return 0;
+}
+
+/**
+ * xlnx_rpu_rx_account() - account the latency of the last IPI
+ * @z_rproc: pointer to the Xilinx RPU processor platform data
+ *
+ * Called by the single context that handles the notifications.
  */
-static void handle_event_notified(struct work_struct *work)
+static void xlnx_rpu_rx_account(struct xlnx_rpu_rproc *z_rproc)
 {
-	struct rproc *rproc;
-	struct xlnx_rpu_rproc *z_rproc;
+	struct xlnx_rpu_rx_stats *stats = &z_rproc->rx_stats;
+	u64 ns = ktime_get_ns() - READ_ONCE(z_rproc->rx_stamp);
+	unsigned int i;
 
-	z_rproc = container_of(work, struct xlnx_rpu_rproc, mbox_work);
+	for (i = 0; i < ARRAY_SIZE(rx_latency_buckets_us); i++)
+		if (ns < rx_latency_buckets_us[i] * NSEC_PER_USEC)
+			break;
+	stats->hist[i]++;
+
+	if (!stats->handled || ns < stats->min_ns)
+		stats->min_ns = ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+	stats->total_ns += ns;
+	stats->handled++;
+}
+
+/**
+ * xlnx_rpu_handle_ipi() - acknowledge the IPI and pass it to the vrings
+ * @z_rproc: pointer to the Xilinx RPU processor platform data
+ */
+static void xlnx_rpu_handle_ipi(struct xlnx_rpu_rproc *z_rproc)
+{
+	struct rproc *rproc = z_rproc->rproc;
+
+	xlnx_rpu_rx_account(z_rproc);
 
 	(void)mbox_send_message(z_rproc->rx_chan, NULL);
-	rproc = z_rproc->rproc;
 	/*
 	 * We only use IPI for interrupt. The firmware side may or may
 	 * not write the notifyid when it trigger IPI.
@@ -841,18 +953,153 @@ static void handle_event_notified(struct work_struct *work)
 	idr_for_each(&rproc->notifyids, event_notified_idr_cb, rproc);
 }
 
+/**
+ * handle_event_notified() - remoteproc notification work function
+ * @work: pointer to the work structure
+ *
+ * It checks each registered remoteproc notify IDs.
+ */
+static void handle_event_notified(struct work_struct *work)
+{
+	struct xlnx_rpu_rproc *z_rproc;
+
+	z_rproc = container_of(work, struct xlnx_rpu_rproc, mbox_work);
+	xlnx_rpu_handle_ipi(z_rproc);
+}
+
+/**
+ * xlnx_rpu_rx_thread() - notification thread function
+ * @data: pointer to the Xilinx RPU processor platform data
+ *
+ * In RX_MODE_THREAD, it sleeps until the IPI is received. In RX_MODE_POLL,
+ * it polls the used index of each vring in the shared memory while the RPU
+ * runs, so that the messages are received without waiting for the IPI, and
+ * still handles the IPI to acknowledge it.
+ *
+ * Return: 0
+ */
+static int xlnx_rpu_rx_thread(void *data)
+{
+	struct xlnx_rpu_rproc *z_rproc = data;
+	struct rproc *rproc = z_rproc->rproc;
+	bool running;
+
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (atomic_xchg(&z_rproc->rx_pending, 0)) {
+			__set_current_state(TASK_RUNNING);
+			xlnx_rpu_handle_ipi(z_rproc);
+			continue;
+		}
+
+		running = rproc->state == RPROC_RUNNING ||
+			  rproc->state == RPROC_ATTACHED;
+		if (rx_mode != RX_MODE_POLL || !running) {
+			/* Poll again once the RPU is up */
+			if (rx_mode == RX_MODE_POLL)
+				schedule_timeout(msecs_to_jiffies(10));
+			else
+				schedule();
+			continue;
+		}
+
+		__set_current_state(TASK_RUNNING);
+		idr_for_each(&rproc->notifyids, event_polled_idr_cb, rproc);
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static int xlnx_rpu_rx_stats_show(struct seq_file *s, void *data)
+{
+	struct xlnx_rpu_rproc *z_rproc = s->private;
+	struct xlnx_rpu_rx_stats *stats = &z_rproc->rx_stats;
+	unsigned int i;
+
+	seq_printf(s, "mode: %u\n", rx_mode);
+	seq_printf(s, "ipis: %llu\n", stats->ipis);
+	seq_printf(s, "handled: %llu\n", stats->handled);
+	seq_printf(s, "polled: %llu\n", stats->polled);
+	if (stats->handled)
+		seq_printf(s, "latency_ns: min %llu avg %llu max %llu\n",
+			   stats->min_ns,
+			   div64_u64(stats->total_ns, stats->handled),
+			   stats->max_ns);
+
+	for (i = 0; i < ARRAY_SIZE(rx_latency_buckets_us); i++)
+		seq_printf(s, "< %u us: %llu\n", rx_latency_buckets_us[i],
+			   stats->hist[i]);
+	seq_printf(s, ">= %u us: %llu\n", rx_latency_buckets_us[i - 1],
+		   stats->hist[i]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xlnx_rpu_rx_stats);
+
+/**
+ * xlnx_rpu_start_rx() - Start the notification thread of the core
+ * @z_rproc: pointer to the Xilinx RPU processor platform data
+ *
+ * Return: 0 for success, negative value for failure.
+ */
+static int xlnx_rpu_start_rx(struct xlnx_rpu_rproc *z_rproc)
+{
+	struct task_struct *task;
+
+	debugfs_create_file("rx_latency", 0400, z_rproc->rproc->dbg_dir,
+			    z_rproc, &xlnx_rpu_rx_stats_fops);
+
+	if (rx_mode != RX_MODE_THREAD && rx_mode != RX_MODE_POLL)
+		return 0;
+
+	task = kthread_create(xlnx_rpu_rx_thread, z_rproc, "%s-rx",
+			      dev_name(z_rproc->dev));
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+
+	if (rx_mode == RX_MODE_THREAD)
+		sched_set_fifo(task);
+	else if (poll_cpu >= 0 && cpu_online(poll_cpu))
+		kthread_bind(task, poll_cpu);
+
+	WRITE_ONCE(z_rproc->rx_task, task);
+	wake_up_process(task);
+
+	return 0;
+}
+
+/**
+ * xlnx_rpu_stop_rx() - Stop handling the notifications of the core
+ * @z_rproc: pointer to the Xilinx RPU processor platform data
+ */
+static void xlnx_rpu_stop_rx(struct xlnx_rpu_rproc *z_rproc)
+{
+	struct task_struct *task = z_rproc->rx_task;
+
+	if (task) {
+		WRITE_ONCE(z_rproc->rx_task, NULL);
+		kthread_stop(task);
+	}
+	cancel_work_sync(&z_rproc->mbox_work);
+}
+
 /**
  * xlnx_rpu_mb_rx_cb() - Receive channel mailbox callback
  * @cl: mailbox client
  * @msg: message pointer
  *
- * It will schedule the RPU notification work.
+ * It will schedule the RPU notification work, or wake the notification
+ * thread up.
  */
 static void xlnx_rpu_mb_rx_cb(struct mbox_client *cl, void *msg)
 {
 	struct xlnx_rpu_rproc *z_rproc;
+	struct task_struct *task;
 
 	z_rproc = container_of(cl, struct xlnx_rpu_rproc, rx_mc);
+	WRITE_ONCE(z_rproc->rx_stamp, ktime_get_ns());
+	z_rproc->rx_stats.ipis++;
 	if (msg) {
 		struct zynqmp_ipi_message *ipi_msg, *buf_msg;
 		size_t len;
@@ -864,7 +1111,14 @@ static void xlnx_rpu_mb_rx_cb(struct mbox_client *cl, void *msg)
 		buf_msg->len = len;
 		memcpy(buf_msg->data, ipi_msg->data, len);
 	}
-	schedule_work(&z_rproc->mbox_work);
+
+	task = READ_ONCE(z_rproc->rx_task);
+	if (task) {
+		atomic_set(&z_rproc->rx_pending, 1);
+		wake_up_process(task);
+	} else {
+		schedule_work(&z_rproc->mbox_work);
+	}
 }
 
 /**
@@ -939,6 +1193,45 @@ static int xlnx_rpu_setup_mbox(struct xlnx_rpu_rproc *z_rproc,
 	return 0;
 }
 
+static void xlnx_rpu_release_load_chan(void *data)
+{
+	dma_release_channel(data);
+}
+
+/**
+ * xlnx_rpu_setup_load_chan() - Get a DMA channel to load the firmware with
+ * @z_rproc: pointer to the Xilinx RPU processor platform data
+ *
+ * The carveouts of the RPU are registered with their physical address as
+ * DMA address, so a memcpy channel can write them directly. Each core gets
+ * its own channel so that both cores of a split cluster load at once. The
+ * segments are copied by the CPU when no channel is available.
+ *
+ * Return: 0 for success, negative value for failure.
+ */
+static int xlnx_rpu_setup_load_chan(struct xlnx_rpu_rproc *z_rproc)
+{
+	struct dma_chan *chan;
+	dma_cap_mask_t mask;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+
+	chan = dma_request_chan_by_mask(&mask);
+	if (IS_ERR(chan)) {
+		if (PTR_ERR(chan) == -EPROBE_DEFER)
+			return -EPROBE_DEFER;
+
+		dev_info(z_rproc->dev, "no DMA channel, loading with the CPU\n");
+		return 0;
+	}
+
+	z_rproc->rproc->load_chan = chan;
+
+	return devm_add_action_or_reset(z_rproc->dev,
+					xlnx_rpu_release_load_chan, chan);
+}
+
 /**
  * xlnx_rpu_probe() - Probes Xilinx RPU processor device node
  *		       this is called for each individual RPU core to
@@ -976,7 +1269,7 @@ static int xlnx_rpu_probe(struct platform_device *pdev,
 		goto error;
 	}
 
-	rproc->auto_boot = false;
+	rproc->auto_boot = auto_boot;
 	*z_rproc = rproc->priv;
 	(*z_rproc)->rproc = rproc;
 	(*z_rproc)->dev = dev;
@@ -1022,7 +1315,16 @@ static int xlnx_rpu_probe(struct platform_device *pdev,
 			goto error;
 	}
 
-	/* Add RPU remoteproc */
+	if (dma_load) {
+		ret = xlnx_rpu_setup_load_chan(*z_rproc);
+		if (ret)
+			goto error;
+	}
+
+	/*
+	 * Add RPU remoteproc. With auto_boot, the firmware is requested
+	 * asynchronously, so the cores of a split cluster boot in parallel.
+	 */
 	ret = devm_rproc_add(dev, rproc);
 	if (ret)
 		goto error;
@@ -1081,6 +1383,12 @@ static int xlnx_rpu_probe(struct platform_device *pdev,
 		(*z_rproc)->rsc_pa = 0;
 	}
 
+	if (of_property_read_bool(node, "mboxes")) {
+		ret = xlnx_rpu_start_rx(*z_rproc);
+		if (ret)
+			goto error;
+	}
+
 	return 0;
 error:
 	*z_rproc = NULL;
@@ -1190,6 +1498,7 @@ static int xlnx_rpu_remoteproc_probe(struct platform_device *pdev)
 		list_for_each(pos, cluster) {
 			z_rproc = list_entry(pos, struct xlnx_rpu_rproc, elem);
 			if (of_property_read_bool(z_rproc->dev->of_node, "mboxes")) {
+				xlnx_rpu_stop_rx(z_rproc);
 				mbox_free_channel(z_rproc->tx_chan);
 				mbox_free_channel(z_rproc->rx_chan);
 			}
@@ -1226,6 +1535,7 @@ static int xlnx_rpu_remoteproc_remove(struct platform_device *pdev)
 			zynqmp_pm_release_node(z_rproc->pnode_id);
 
 		if (of_property_read_bool(z_rproc->dev->of_node, "mboxes")) {
+			xlnx_rpu_stop_rx(z_rproc);
 			mbox_free_channel(z_rproc->tx_chan);
 			mbox_free_channel(z_rproc->rx_chan);
 		}
@@ -15,6 +15,7 @@
 
 #include <linux/cdev.h>
 #include <linux/device.h>
+#include <linux/dma-buf.h>
 #include <linux/fs.h>
 #include <linux/idr.h>
 #include <linux/kernel.h>
@@ -52,6 +53,8 @@ static DEFINE_IDA(rpmsg_minor_ida);
  * @readq:	wait object for incoming queue
  * @default_ept: set to channel default endpoint if the default endpoint should be re-used
  *              on device open to prevent endpoint address update.
+ * @ref_lock:	synchronization of @refs operations
+ * @refs:	dma-bufs sent by reference and not reaped yet
  */
 struct rpmsg_eptdev {
 	struct device dev;
@@ -68,6 +71,26 @@ struct rpmsg_eptdev {
 	struct sk_buff_head queue;
 	wait_queue_head_t readq;
 
+	spinlock_t ref_lock;
+	struct list_head refs;
+};
+
+/**
+ * struct rpmsg_eptdev_ref - dma-buf sent by reference by an endpoint device
+ * @node:	entry in the refs list of the endpoint device
+ * @cookie:	value identifying the buffer, given by user space
+ * @done:	the remote returned the buffer
+ * @dmabuf:	the dma-buf
+ * @attach:	attachment of @dmabuf to the DMA device of the endpoint
+ * @sgt:	mapping of @attach
+ */
+struct rpmsg_eptdev_ref {
+	struct list_head node;
+	u32 cookie;
+	bool done;
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
 };
 
 int rpmsg_chrdev_eptdev_destroy(struct device *dev, void *data)
@@ -115,6 +138,57 @@ static int rpmsg_ept_cb(struct rpmsg_device *rpdev, void *buf, int len,
 	return 0;
 }
 
+static int rpmsg_ept_ref_cb(struct rpmsg_device *rpdev,
+			    const struct rpmsg_buf_ref *buf, bool done,
+			    void *priv, u32 addr)
+{
+	struct rpmsg_eptdev *eptdev = priv;
+	struct rpmsg_eptdev_ref *ref;
+	bool found = false;
+
+	/* Buffers sent by the remote can't be passed to user space */
+	if (!done)
+		return -EOPNOTSUPP;
+
+	spin_lock(&eptdev->ref_lock);
+	list_for_each_entry(ref, &eptdev->refs, node) {
+		if (!ref->done && ref->cookie == buf->cookie) {
+			ref->done = true;
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&eptdev->ref_lock);
+
+	if (!found) {
+		dev_warn_ratelimited(&eptdev->dev,
+				     "unknown buffer returned: %u\n",
+				     buf->cookie);
+		return -EINVAL;
+	}
+
+	/* wake up any polling processes, waiting for returned buffers */
+	wake_up_interruptible(&eptdev->readq);
+
+	return 0;
+}
+
+static void rpmsg_eptdev_ref_free(struct rpmsg_eptdev_ref *ref)
+{
+	dma_buf_unmap_attachment(ref->attach, ref->sgt, DMA_BIDIRECTIONAL);
+	dma_buf_detach(ref->dmabuf, ref->attach);
+	dma_buf_put(ref->dmabuf);
+	kfree(ref);
+}
+
+static void rpmsg_eptdev_set_ref_cb(struct rpmsg_endpoint *ept,
+				    rpmsg_ref_cb_t ref_cb)
+{
+	mutex_lock(&ept->cb_lock);
+	ept->ref_cb = ref_cb;
+	mutex_unlock(&ept->cb_lock);
+}
+
 static int rpmsg_eptdev_open(struct inode *inode, struct file *filp)
 {
 	struct rpmsg_eptdev *eptdev = cdev_to_eptdev(inode->i_cdev);
@@ -146,6 +220,8 @@ static int rpmsg_eptdev_open(struct inode *inode, struct file *filp)
 		return -EINVAL;
 	}
 
+	rpmsg_eptdev_set_ref_cb(ept, rpmsg_ept_ref_cb);
+
 	eptdev->ept = ept;
 	filp->private_data = eptdev;
 	mutex_unlock(&eptdev->ept_lock);
@@ -157,12 +233,15 @@ static int rpmsg_eptdev_release(struct inode *inode, struct file *filp)
 {
 	struct rpmsg_eptdev *eptdev = cdev_to_eptdev(inode->i_cdev);
 	struct device *dev = &eptdev->dev;
+	struct rpmsg_eptdev_ref *ref, *tmp;
 
 	/* Close the endpoint, if it's not already destroyed by the parent */
 	mutex_lock(&eptdev->ept_lock);
 	if (eptdev->ept) {
 		if (!eptdev->default_ept)
 			rpmsg_destroy_ept(eptdev->ept);
+		else
+			rpmsg_eptdev_set_ref_cb(eptdev->ept, NULL);
 		eptdev->ept = NULL;
 	}
 	mutex_unlock(&eptdev->ept_lock);
@@ -170,6 +249,15 @@ static int rpmsg_eptdev_release(struct inode *inode, struct file *filp)
 	/* Discard all SKBs */
 	skb_queue_purge(&eptdev->queue);
 
+	/* Release the dma-bufs, the remote may still own some of them */
+	list_for_each_entry_safe(ref, tmp, &eptdev->refs, node) {
+		if (!ref->done)
+			dev_warn(dev, "releasing buffer %u owned by the remote\n",
+				 ref->cookie);
+		list_del(&ref->node);
+		rpmsg_eptdev_ref_free(ref);
+	}
+
 	put_device(dev);
 
 	return 0;
@@ -266,6 +354,142 @@ static ssize_t rpmsg_eptdev_write_iter(struct kiocb *iocb,
 	return ret < 0 ? ret : len;
 }
 
+static struct rpmsg_eptdev_ref *
+rpmsg_eptdev_first_done(struct rpmsg_eptdev *eptdev)
+{
+	struct rpmsg_eptdev_ref *ref;
+
+	lockdep_assert_held(&eptdev->ref_lock);
+
+	list_for_each_entry(ref, &eptdev->refs, node)
+		if (ref->done)
+			return ref;
+
+	return NULL;
+}
+
+static int rpmsg_eptdev_send_dmabuf(struct rpmsg_eptdev *eptdev,
+				    void __user *argp)
+{
+	struct rpmsg_eptdev_ref *ref;
+	struct rpmsg_dmabuf_ref arg;
+	struct rpmsg_buf_ref buf;
+	struct device *dma_dev;
+	int ret;
+
+	if (copy_from_user(&arg, argp, sizeof(arg)))
+		return -EFAULT;
+
+	if (!arg.len || arg.len > U32_MAX)
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&eptdev->ept_lock))
+		return -ERESTARTSYS;
+
+	if (!eptdev->ept) {
+		ret = -EPIPE;
+		goto unlock_eptdev;
+	}
+
+	dma_dev = rpmsg_get_dma_device(eptdev->ept);
+	if (!dma_dev) {
+		ret = -EOPNOTSUPP;
+		goto unlock_eptdev;
+	}
+
+	ref = kzalloc(sizeof(*ref), GFP_KERNEL);
+	if (!ref) {
+		ret = -ENOMEM;
+		goto unlock_eptdev;
+	}
+	ref->cookie = arg.cookie;
+
+	ref->dmabuf = dma_buf_get(arg.fd);
+	if (IS_ERR(ref->dmabuf)) {
+		ret = PTR_ERR(ref->dmabuf);
+		goto free_ref;
+	}
+
+	if (arg.offset >= ref->dmabuf->size ||
+	    arg.len > ref->dmabuf->size - arg.offset) {
+		ret = -EINVAL;
+		goto put_dmabuf;
+	}
+
+	ref->attach = dma_buf_attach(ref->dmabuf, dma_dev);
+	if (IS_ERR(ref->attach)) {
+		ret = PTR_ERR(ref->attach);
+		goto put_dmabuf;
+	}
+
+	ref->sgt = dma_buf_map_attachment(ref->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR(ref->sgt)) {
+		ret = PTR_ERR(ref->sgt);
+		goto detach_dmabuf;
+	}
+
+	/* The remote is given a single device address */
+	if (sg_dma_len(ref->sgt->sgl) < arg.offset + arg.len) {
+		ret = -EINVAL;
+		goto unmap_dmabuf;
+	}
+
+	buf.addr = sg_dma_address(ref->sgt->sgl) + arg.offset;
+	buf.len = arg.len;
+	buf.cookie = arg.cookie;
+
+	/* The buffer may be returned before rpmsg_send_ref() returns */
+	spin_lock(&eptdev->ref_lock);
+	list_add_tail(&ref->node, &eptdev->refs);
+	spin_unlock(&eptdev->ref_lock);
+
+	ret = rpmsg_send_ref(eptdev->ept, &buf, eptdev->chinfo.dst);
+	if (ret) {
+		spin_lock(&eptdev->ref_lock);
+		list_del(&ref->node);
+		spin_unlock(&eptdev->ref_lock);
+		goto unmap_dmabuf;
+	}
+
+	mutex_unlock(&eptdev->ept_lock);
+
+	return 0;
+
+unmap_dmabuf:
+	dma_buf_unmap_attachment(ref->attach, ref->sgt, DMA_BIDIRECTIONAL);
+detach_dmabuf:
+	dma_buf_detach(ref->dmabuf, ref->attach);
+put_dmabuf:
+	dma_buf_put(ref->dmabuf);
+free_ref:
+	kfree(ref);
+unlock_eptdev:
+	mutex_unlock(&eptdev->ept_lock);
+
+	return ret;
+}
+
+static int rpmsg_eptdev_reap_dmabuf(struct rpmsg_eptdev *eptdev,
+				    u32 __user *argp)
+{
+	struct rpmsg_eptdev_ref *ref;
+	u32 cookie;
+
+	spin_lock(&eptdev->ref_lock);
+	ref = rpmsg_eptdev_first_done(eptdev);
+	if (ref)
+		list_del(&ref->node);
+	spin_unlock(&eptdev->ref_lock);
+
+	if (!ref)
+		return -EAGAIN;
+
+	cookie = ref->cookie;
+	rpmsg_eptdev_ref_free(ref);
+
+	return put_user(cookie, argp);
+}
+
 static __poll_t rpmsg_eptdev_poll(struct file *filp, poll_table *wait)
 {
 	struct rpmsg_eptdev *eptdev = filp->private_data;
@@ -279,6 +503,11 @@ static __poll_t rpmsg_eptdev_poll(struct file *filp, poll_table *wait)
 	if (!skb_queue_empty(&eptdev->queue))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
+	spin_lock(&eptdev->ref_lock);
+	if (rpmsg_eptdev_first_done(eptdev))
+		mask |= EPOLLPRI;
+	spin_unlock(&eptdev->ref_lock);
+
 	mask |= rpmsg_poll(eptdev->ept, filp, wait);
 
 	return mask;
@@ -289,8 +518,16 @@ static long rpmsg_eptdev_ioctl(struct file *fp, unsigned int cmd,
 {
 	struct rpmsg_eptdev *eptdev = fp->private_data;
 
-	if (cmd != RPMSG_DESTROY_EPT_IOCTL)
+	switch (cmd) {
+	case RPMSG_SEND_DMABUF_IOCTL:
+		return rpmsg_eptdev_send_dmabuf(eptdev, (void __user *)arg);
+	case RPMSG_REAP_DMABUF_IOCTL:
+		return rpmsg_eptdev_reap_dmabuf(eptdev, (u32 __user *)arg);
+	case RPMSG_DESTROY_EPT_IOCTL:
+		break;
+	default:
 		return -EINVAL;
+	}
 
 	/* Don't allow to destroy a default endpoint. */
 	if (eptdev->default_ept)
@@ -371,6 +608,8 @@ static struct rpmsg_eptdev *rpmsg_chrdev_eptdev_alloc(struct rpmsg_device *rpdev
 	spin_lock_init(&eptdev->queue_lock);
 	skb_queue_head_init(&eptdev->queue);
 	init_waitqueue_head(&eptdev->readq);
+	spin_lock_init(&eptdev->ref_lock);
+	INIT_LIST_HEAD(&eptdev->refs);
 
 	device_initialize(dev);
 	dev->class = rpmsg_class;
@@ -516,4 +755,5 @@ static void rpmsg_chrdev_exit(void)
 module_exit(rpmsg_chrdev_exit);
 
 MODULE_ALIAS("rpmsg:rpmsg_chrdev");
+MODULE_IMPORT_NS(DMA_BUF);
 MODULE_LICENSE("GPL v2");
@@ -351,6 +351,75 @@ ssize_t rpmsg_get_mtu(struct rpmsg_endpoint *ept)
 }
 EXPORT_SYMBOL(rpmsg_get_mtu);
 
+/**
+ * rpmsg_send_ref() - send a buffer by reference
+ * @ept: the rpmsg endpoint
+ * @ref: the buffer
+ * @dst: destination address
+ *
+ * This function passes the ownership of the buffer described by @ref to the
+ * remote @dst address without copying it. The buffer must stay valid until
+ * the remote returns it, which is reported to the @ref_cb of @ept with the
+ * same cookie.
+ *
+ * Can only be called from process context (for now).
+ *
+ * Return: 0 on success and an appropriate error value on failure.
+ */
+int rpmsg_send_ref(struct rpmsg_endpoint *ept,
+		   const struct rpmsg_buf_ref *ref, u32 dst)
+{
+	if (WARN_ON(!ept))
+		return -EINVAL;
+	if (!ept->ops->send_ref)
+		return -ENXIO;
+
+	return ept->ops->send_ref(ept, ref, dst, false);
+}
+EXPORT_SYMBOL(rpmsg_send_ref);
+
+/**
+ * rpmsg_return_ref() - return a buffer received by reference
+ * @ept: the rpmsg endpoint
+ * @ref: the buffer, as received by the @ref_cb of @ept
+ * @dst: address of the remote that sent the buffer
+ *
+ * This function passes the ownership of the buffer back to the remote.
+ *
+ * Can only be called from process context (for now).
+ *
+ * Return: 0 on success and an appropriate error value on failure.
+ */
+int rpmsg_return_ref(struct rpmsg_endpoint *ept,
+		     const struct rpmsg_buf_ref *ref, u32 dst)
+{
+	if (WARN_ON(!ept))
+		return -EINVAL;
+	if (!ept->ops->send_ref)
+		return -ENXIO;
+
+	return ept->ops->send_ref(ept, ref, dst, true);
+}
+EXPORT_SYMBOL(rpmsg_return_ref);
+
+/**
+ * rpmsg_get_dma_device() - get the device buffers sent by reference are
+ *			    mapped for
+ * @ept: the rpmsg endpoint
+ *
+ * Return: the device, or NULL if the endpoint can't send buffers by reference
+ */
+struct device *rpmsg_get_dma_device(struct rpmsg_endpoint *ept)
+{
+	if (WARN_ON(!ept))
+		return NULL;
+	if (!ept->ops->get_dma_device)
+		return NULL;
+
+	return ept->ops->get_dma_device(ept);
+}
+EXPORT_SYMBOL(rpmsg_get_dma_device);
+
 /*
  * match a rpmsg channel with a channel info struct.
  * this is used to make sure we're not creating rpmsg devices for channels
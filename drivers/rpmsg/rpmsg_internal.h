@@ -56,6 +56,8 @@ struct rpmsg_device_ops {
  * @trysend_offchannel:	see @rpmsg_trysend_offchannel(), optional
  * @poll:		see @rpmsg_poll(), optional
  * @get_mtu:		see @rpmsg_get_mtu(), optional
+ * @send_ref:		see @rpmsg_send_ref() and @rpmsg_return_ref(), optional
+ * @get_dma_device:	see @rpmsg_get_dma_device(), optional
  *
  * Indirection table for the operations that a rpmsg backend should implement.
  * In addition to @destroy_ept, the backend must at least implement @send and
@@ -76,6 +78,9 @@ struct rpmsg_endpoint_ops {
 	__poll_t (*poll)(struct rpmsg_endpoint *ept, struct file *filp,
 			     poll_table *wait);
 	ssize_t (*get_mtu)(struct rpmsg_endpoint *ept);
+	int (*send_ref)(struct rpmsg_endpoint *ept,
+			const struct rpmsg_buf_ref *ref, u32 dst, bool done);
+	struct device *(*get_dma_device)(struct rpmsg_endpoint *ept);
 };
 
 struct device *rpmsg_find_device(struct device *parent,
@@ -38,7 +38,9 @@
  * @rbufs:	kernel address of rx buffers
  * @sbufs:	kernel address of tx buffers
  * @num_bufs:	total number of buffers for rx and tx
- * @buf_size:   size of one rx or tx buffer
+ * @rbuf_size:	size of one rx buffer
+ * @sbuf_size:	size of one tx buffer
+ * @bufs_size:	size of all the rx and tx buffers
  * @last_sbuf:	index of last tx buffer used
  * @bufs_dma:	dma base addr of the buffers
  * @tx_lock:	protects svq, sbufs and sleepers, to allow concurrent senders.
@@ -58,7 +60,9 @@ struct virtproc_info {
 	struct virtqueue *rvq, *svq;
 	void *rbufs, *sbufs;
 	unsigned int num_bufs;
-	unsigned int buf_size;
+	unsigned int rbuf_size;
+	unsigned int sbuf_size;
+	size_t bufs_size;
 	int last_sbuf;
 	dma_addr_t bufs_dma;
 	struct mutex tx_lock;
@@ -70,6 +74,25 @@ struct virtproc_info {
 
 /* The feature bitmap for virtio rpmsg */
 #define VIRTIO_RPMSG_F_NS	0 /* RP supports name service notifications */
+#define VIRTIO_RPMSG_F_BUFSZ	1 /* RP sets the buffer sizes in the config */
+#define VIRTIO_RPMSG_F_BUFREF	2 /* RP supports buffers sent by reference */
+
+/**
+ * struct virtio_rpmsg_config - config space of a virtio rpmsg device
+ * @rxbuf_size: size of the buffers the remote processor sends messages in
+ * @txbuf_size: size of the buffers the remote processor receives messages in
+ *
+ * Only valid when VIRTIO_RPMSG_F_BUFSZ is negotiated, both sizes include the
+ * message header.
+ */
+struct virtio_rpmsg_config {
+	__virtio32 rxbuf_size;
+	__virtio32 txbuf_size;
+} __packed;
+
+/* Message flags */
+#define RPMSG_F_REF		BIT(0) /* payload is a struct rpmsg_ref_msg */
+#define RPMSG_F_REF_DONE	BIT(1) /* returns a buffer sent by reference */
 
 /**
  * struct rpmsg_hdr - common header for all rpmsg messages
@@ -91,6 +114,18 @@ struct rpmsg_hdr {
 	u8 data[];
 } __packed;
 
+/**
+ * struct rpmsg_ref_msg - payload of a message with RPMSG_F_REF(_DONE)
+ * @addr: device address of the buffer
+ * @len: length of the buffer
+ * @cookie: value identifying the buffer when its ownership is returned
+ */
+struct rpmsg_ref_msg {
+	__rpmsg64 addr;
+	__rpmsg32 len;
+	__rpmsg32 cookie;
+} __packed;
+
 
 /**
  * struct virtio_rpmsg_channel - rpmsg channel descriptor
@@ -126,9 +161,14 @@ struct virtio_rpmsg_channel {
  * Note that these numbers are purely a decision of this driver - we
  * can change this without changing anything in the firmware of the remote
  * processor.
+ *
+ * A remote processor that negotiates VIRTIO_RPMSG_F_BUFSZ sets the buffer
+ * sizes instead, up to a payload of 64KB - 1, the largest that the 16-bit
+ * length of the header can describe.
  */
 #define MAX_RPMSG_NUM_BUFS	(512)
 #define MAX_RPMSG_BUF_SIZE	(512)
+#define MAX_RPMSG_BUFSZ_SIZE	(sizeof(struct rpmsg_hdr) + U16_MAX)
 
 /*
  * Local addresses are dynamically allocated on-demand.
@@ -149,6 +189,10 @@ static int virtio_rpmsg_trysendto(struct rpmsg_endpoint *ept, void *data,
 static int virtio_rpmsg_trysend_offchannel(struct rpmsg_endpoint *ept, u32 src,
 					   u32 dst, void *data, int len);
 static ssize_t virtio_rpmsg_get_mtu(struct rpmsg_endpoint *ept);
+static int virtio_rpmsg_send_ref(struct rpmsg_endpoint *ept,
+				 const struct rpmsg_buf_ref *ref, u32 dst,
+				 bool done);
+static struct device *virtio_rpmsg_get_dma_device(struct rpmsg_endpoint *ept);
 static struct rpmsg_device *__rpmsg_create_channel(struct virtproc_info *vrp,
 						   struct rpmsg_channel_info *chinfo);
 
@@ -161,6 +205,8 @@ static const struct rpmsg_endpoint_ops virtio_endpoint_ops = {
 	.trysendto = virtio_rpmsg_trysendto,
 	.trysend_offchannel = virtio_rpmsg_trysend_offchannel,
 	.get_mtu = virtio_rpmsg_get_mtu,
+	.send_ref = virtio_rpmsg_send_ref,
+	.get_dma_device = virtio_rpmsg_get_dma_device,
 };
 
 /**
@@ -449,7 +495,7 @@ static void *get_a_tx_buf(struct virtproc_info *vrp)
 	 * (half of our buffers are used for sending messages)
 	 */
 	if (vrp->last_sbuf < vrp->num_bufs / 2)
-		ret = vrp->sbufs + vrp->buf_size * vrp->last_sbuf++;
+		ret = vrp->sbufs + vrp->sbuf_size * vrp->last_sbuf++;
 	/* or recycle a used one */
 	else
 		ret = virtqueue_get_buf(vrp->svq, &len);
@@ -522,6 +568,7 @@ static void rpmsg_downref_sleepers(struct virtproc_info *vrp)
  * @dst: destination address
  * @data: payload of message
  * @len: length of payload
+ * @flags: message flags
  * @wait: indicates whether caller should block in case no TX buffers available
  *
  * This function is the base implementation for all of the rpmsg sending API.
@@ -550,8 +597,8 @@ static void rpmsg_downref_sleepers(struct virtproc_info *vrp)
  * Return: 0 on success and an appropriate error value on failure.
  */
 static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
-				     u32 src, u32 dst,
-				     void *data, int len, bool wait)
+				     u32 src, u32 dst, void *data, int len,
+				     u16 flags, bool wait)
 {
 	struct virtio_rpmsg_channel *vch = to_virtio_rpmsg_channel(rpdev);
 	struct virtproc_info *vrp = vch->vrp;
@@ -575,7 +622,7 @@ static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
 	 * messaging), or to improve the buffer allocator, to support
 	 * variable-length buffer sizes.
 	 */
-	if (len > vrp->buf_size - sizeof(struct rpmsg_hdr)) {
+	if (len > vrp->sbuf_size - sizeof(struct rpmsg_hdr)) {
 		dev_err(dev, "message is too big (%d)\n", len);
 		return -EMSGSIZE;
 	}
@@ -611,7 +658,7 @@ static int rpmsg_send_offchannel_raw(struct rpmsg_device *rpdev,
 	}
 
 	msg->len = cpu_to_rpmsg16(rpdev, len);
-	msg->flags = 0;
+	msg->flags = cpu_to_rpmsg16(rpdev, flags);
 	msg->src = cpu_to_rpmsg32(rpdev, src);
 	msg->dst = cpu_to_rpmsg32(rpdev, dst);
 	msg->reserved = 0;
@@ -652,7 +699,7 @@ static int virtio_rpmsg_send(struct rpmsg_endpoint *ept, void *data, int len)
 	struct rpmsg_device *rpdev = ept->rpdev;
 	u32 src = ept->addr, dst = rpdev->dst;
 
-	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, true);
+	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, 0, true);
 }
 
 static int virtio_rpmsg_sendto(struct rpmsg_endpoint *ept, void *data, int len,
@@ -661,7 +708,7 @@ static int virtio_rpmsg_sendto(struct rpmsg_endpoint *ept, void *data, int len,
 	struct rpmsg_device *rpdev = ept->rpdev;
 	u32 src = ept->addr;
 
-	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, true);
+	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, 0, true);
 }
 
 static int virtio_rpmsg_send_offchannel(struct rpmsg_endpoint *ept, u32 src,
@@ -669,7 +716,7 @@ static int virtio_rpmsg_send_offchannel(struct rpmsg_endpoint *ept, u32 src,
 {
 	struct rpmsg_device *rpdev = ept->rpdev;
 
-	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, true);
+	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, 0, true);
 }
 
 static int virtio_rpmsg_trysend(struct rpmsg_endpoint *ept, void *data, int len)
@@ -677,7 +724,7 @@ static int virtio_rpmsg_trysend(struct rpmsg_endpoint *ept, void *data, int len)
 	struct rpmsg_device *rpdev = ept->rpdev;
 	u32 src = ept->addr, dst = rpdev->dst;
 
-	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, false);
+	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, 0, false);
 }
 
 static int virtio_rpmsg_trysendto(struct rpmsg_endpoint *ept, void *data,
@@ -686,7 +733,7 @@ static int virtio_rpmsg_trysendto(struct rpmsg_endpoint *ept, void *data,
 	struct rpmsg_device *rpdev = ept->rpdev;
 	u32 src = ept->addr;
 
-	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, false);
+	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, 0, false);
 }
 
 static int virtio_rpmsg_trysend_offchannel(struct rpmsg_endpoint *ept, u32 src,
@@ -694,7 +741,7 @@ static int virtio_rpmsg_trysend_offchannel(struct rpmsg_endpoint *ept, u32 src,
 {
 	struct rpmsg_device *rpdev = ept->rpdev;
 
-	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, false);
+	return rpmsg_send_offchannel_raw(rpdev, src, dst, data, len, 0, false);
 }
 
 static ssize_t virtio_rpmsg_get_mtu(struct rpmsg_endpoint *ept)
@@ -702,7 +749,71 @@ static ssize_t virtio_rpmsg_get_mtu(struct rpmsg_endpoint *ept)
 	struct rpmsg_device *rpdev = ept->rpdev;
 	struct virtio_rpmsg_channel *vch = to_virtio_rpmsg_channel(rpdev);
 
-	return vch->vrp->buf_size - sizeof(struct rpmsg_hdr);
+	return vch->vrp->sbuf_size - sizeof(struct rpmsg_hdr);
+}
+
+static int virtio_rpmsg_send_ref(struct rpmsg_endpoint *ept,
+				 const struct rpmsg_buf_ref *ref, u32 dst,
+				 bool done)
+{
+	struct rpmsg_device *rpdev = ept->rpdev;
+	struct virtio_rpmsg_channel *vch = to_virtio_rpmsg_channel(rpdev);
+	struct rpmsg_ref_msg msg;
+
+	if (!virtio_has_feature(vch->vrp->vdev, VIRTIO_RPMSG_F_BUFREF))
+		return -EOPNOTSUPP;
+
+	msg.addr = cpu_to_rpmsg64(rpdev, ref->addr);
+	msg.len = cpu_to_rpmsg32(rpdev, ref->len);
+	msg.cookie = cpu_to_rpmsg32(rpdev, ref->cookie);
+
+	return rpmsg_send_offchannel_raw(rpdev, ept->addr, dst, &msg,
+					 sizeof(msg), done ? RPMSG_F_REF_DONE :
+					 RPMSG_F_REF, true);
+}
+
+static struct device *virtio_rpmsg_get_dma_device(struct rpmsg_endpoint *ept)
+{
+	struct virtio_rpmsg_channel *vch = to_virtio_rpmsg_channel(ept->rpdev);
+
+	if (!virtio_has_feature(vch->vrp->vdev, VIRTIO_RPMSG_F_BUFREF))
+		return NULL;
+
+	/* The device the vring buffers are allocated for */
+	return vch->vrp->vdev->dev.parent;
+}
+
+/*
+ * Pass a buffer reference to the endpoint. The endpoint cb_lock is held by
+ * the caller.
+ */
+static void rpmsg_recv_ref(struct virtproc_info *vrp,
+			   struct rpmsg_endpoint *ept, struct rpmsg_hdr *msg,
+			   unsigned int msg_len, u16 flags, u32 src)
+{
+	bool little_endian = virtio_is_little_endian(vrp->vdev);
+	struct rpmsg_ref_msg *ref_msg = (struct rpmsg_ref_msg *)msg->data;
+	bool done = flags & RPMSG_F_REF_DONE;
+	struct rpmsg_buf_ref ref;
+
+	if (!virtio_has_feature(vrp->vdev, VIRTIO_RPMSG_F_BUFREF) ||
+	    msg_len < sizeof(*ref_msg)) {
+		dev_warn_ratelimited(&vrp->vdev->dev,
+				     "invalid buffer reference\n");
+		return;
+	}
+
+	ref.addr = __rpmsg64_to_cpu(little_endian, ref_msg->addr);
+	ref.len = __rpmsg32_to_cpu(little_endian, ref_msg->len);
+	ref.cookie = __rpmsg32_to_cpu(little_endian, ref_msg->cookie);
+	if (ept->ref_cb && !ept->ref_cb(ept->rpdev, &ref, done, ept->priv, src))
+		return;
+
+	/* No one takes the buffer, give it back to the remote right away */
+	if (!done && ept->rpdev)
+		rpmsg_send_offchannel_raw(ept->rpdev, ept->addr, src, ref_msg,
+					  sizeof(*ref_msg), RPMSG_F_REF_DONE,
+					  false);
 }
 
 static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
@@ -712,6 +823,8 @@ static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 	struct scatterlist sg;
 	bool little_endian = virtio_is_little_endian(vrp->vdev);
 	unsigned int msg_len = __rpmsg16_to_cpu(little_endian, msg->len);
+	u16 flags = __rpmsg16_to_cpu(little_endian, msg->flags);
+	u32 src = __rpmsg32_to_cpu(little_endian, msg->src);
 	int err;
 
 	dev_dbg(dev, "From: 0x%x, To: 0x%x, Len: %d, Flags: %d, Reserved: %d\n",
@@ -728,7 +841,7 @@ static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 	 * We currently use fixed-sized buffers, so trivially sanitize
 	 * the reported payload length.
 	 */
-	if (len > vrp->buf_size ||
+	if (len > vrp->rbuf_size ||
 	    msg_len > (len - sizeof(struct rpmsg_hdr))) {
 		dev_warn(dev, "inbound msg too big: (%d, %d)\n", len, msg_len);
 		return -EINVAL;
@@ -749,9 +862,11 @@ static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 		/* make sure ept->cb doesn't go away while we use it */
 		mutex_lock(&ept->cb_lock);
 
-		if (ept->cb)
+		if (flags & (RPMSG_F_REF | RPMSG_F_REF_DONE))
+			rpmsg_recv_ref(vrp, ept, msg, msg_len, flags, src);
+		else if (ept->cb)
 			ept->cb(ept->rpdev, msg->data, msg_len, ept->priv,
-				__rpmsg32_to_cpu(little_endian, msg->src));
+				src);
 
 		mutex_unlock(&ept->cb_lock);
 
@@ -761,7 +876,7 @@ static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 		dev_warn_ratelimited(dev, "msg received with no recipient\n");
 
 	/* publish the real size of the buffer */
-	rpmsg_sg_init(&sg, msg, vrp->buf_size);
+	rpmsg_sg_init(&sg, msg, vrp->rbuf_size);
 
 	/* add the buffer back to the remote processor's virtqueue */
 	err = virtqueue_add_inbuf(vrp->rvq, &sg, 1, msg, GFP_KERNEL);
@@ -865,6 +980,36 @@ static void rpmsg_virtio_del_ctrl_dev(struct rpmsg_device *rpdev_ctrl)
 	device_unregister(&rpdev_ctrl->dev);
 }
 
+/*
+ * With VIRTIO_RPMSG_F_BUFSZ, the remote processor sets the size of the
+ * buffers of each direction in the config space, e.g. to receive large
+ * frames in a single message.
+ */
+static int rpmsg_read_buf_sizes(struct virtproc_info *vrp)
+{
+	struct virtio_device *vdev = vrp->vdev;
+	u32 rbuf_size, sbuf_size;
+
+	virtio_cread(vdev, struct virtio_rpmsg_config, rxbuf_size, &rbuf_size);
+	virtio_cread(vdev, struct virtio_rpmsg_config, txbuf_size, &sbuf_size);
+
+	if (rbuf_size <= sizeof(struct rpmsg_hdr) ||
+	    rbuf_size > MAX_RPMSG_BUFSZ_SIZE ||
+	    sbuf_size <= sizeof(struct rpmsg_hdr) ||
+	    sbuf_size > MAX_RPMSG_BUFSZ_SIZE) {
+		dev_err(&vdev->dev, "invalid buffer sizes: rx %u tx %u\n",
+			rbuf_size, sbuf_size);
+		return -EINVAL;
+	}
+
+	vrp->rbuf_size = rbuf_size;
+	vrp->sbuf_size = sbuf_size;
+	dev_dbg(&vdev->dev, "buffer sizes: rx %u tx %u\n", rbuf_size,
+		sbuf_size);
+
+	return 0;
+}
+
 static int rpmsg_probe(struct virtio_device *vdev)
 {
 	vq_callback_t *vq_cbs[] = { rpmsg_recv_done, rpmsg_xmit_done };
@@ -907,9 +1052,17 @@ static int rpmsg_probe(struct virtio_device *vdev)
 	else
 		vrp->num_bufs = MAX_RPMSG_NUM_BUFS;
 
-	vrp->buf_size = MAX_RPMSG_BUF_SIZE;
+	vrp->rbuf_size = MAX_RPMSG_BUF_SIZE;
+	vrp->sbuf_size = MAX_RPMSG_BUF_SIZE;
+	if (virtio_has_feature(vdev, VIRTIO_RPMSG_F_BUFSZ)) {
+		err = rpmsg_read_buf_sizes(vrp);
+		if (err)
+			goto vqs_del;
+	}
 
-	total_buf_space = vrp->num_bufs * vrp->buf_size;
+	total_buf_space = vrp->num_bufs / 2 * (vrp->rbuf_size +
+					       vrp->sbuf_size);
+	vrp->bufs_size = total_buf_space;
 
 	/* allocate coherent memory for the buffers */
 	bufs_va = dma_alloc_coherent(vdev->dev.parent,
@@ -927,14 +1080,14 @@ static int rpmsg_probe(struct virtio_device *vdev)
 	vrp->rbufs = bufs_va;
 
 	/* and half is dedicated for TX */
-	vrp->sbufs = bufs_va + total_buf_space / 2;
+	vrp->sbufs = bufs_va + vrp->num_bufs / 2 * vrp->rbuf_size;
 
 	/* set up the receive buffers */
 	for (i = 0; i < vrp->num_bufs / 2; i++) {
 		struct scatterlist sg;
-		void *cpu_addr = vrp->rbufs + i * vrp->buf_size;
+		void *cpu_addr = vrp->rbufs + i * vrp->rbuf_size;
 
-		rpmsg_sg_init(&sg, cpu_addr, vrp->buf_size);
+		rpmsg_sg_init(&sg, cpu_addr, vrp->rbuf_size);
 
 		err = virtqueue_add_inbuf(vrp->rvq, &sg, 1, cpu_addr,
 					  GFP_KERNEL);
@@ -1020,7 +1173,7 @@ static int rpmsg_remove_device(struct device *dev, void *data)
 static void rpmsg_remove(struct virtio_device *vdev)
 {
 	struct virtproc_info *vrp = vdev->priv;
-	size_t total_buf_space = vrp->num_bufs * vrp->buf_size;
+	size_t total_buf_space = vrp->bufs_size;
 	int ret;
 
 	virtio_reset_device(vdev);
@@ -1046,6 +1199,8 @@ static struct virtio_device_id id_table[] = {
 
 static unsigned int features[] = {
 	VIRTIO_RPMSG_F_NS,
+	VIRTIO_RPMSG_F_BUFSZ,
+	VIRTIO_RPMSG_F_BUFREF,
 };
 
 static struct virtio_driver virtio_ipc_driver = {
@@ -13,12 +13,14 @@
 #include <linux/firmware/xlnx-zynqmp.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of_irq.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/sizes.h>
 #include <linux/spi/spi.h>
 #include <linux/spinlock.h>
 #include <linux/workqueue.h>
@@ -167,6 +169,9 @@
 #define IOU_TAPDLY_BYPASS_MASK	0x7
 
 #define SPI_AUTOSUSPEND_TIMEOUT		3000
+
+/* dirmap reads into buffers the DMA cannot target go through this buffer */
+#define GQSPI_DIRMAP_BOUNCE_SIZE	SZ_256K
 enum mode_type {GQSPI_MODE_IO, GQSPI_MODE_DMA};
 
 /**
@@ -202,6 +207,12 @@ struct qspi_platform_data {
  * @op_lock:		Operational lock
  * @speed_hz:          Current SPI bus clock speed in hz
  * @has_tapdelay:	Used for tapdelay register available in qspi
+ * @dirmap_lock:	Lock for the dirmap bounce buffer and statistics
+ * @dirmap_buf:		DMA capable bounce buffer of the dirmap reads
+ * @dirmap_reads:	Number of dirmap reads
+ * @dirmap_bytes:	Number of bytes read through dirmap
+ * @dirmap_bounce_bytes:	Number of @dirmap_bytes read through @dirmap_buf
+ * @dirmap_ns:		Time spent in dirmap reads
  */
 struct zynqmp_qspi {
 	struct spi_controller *ctlr;
@@ -227,6 +238,12 @@ struct zynqmp_qspi {
 	u32 speed_hz;
 	bool io_mode;
 	bool has_tapdelay;
+	struct mutex dirmap_lock;
+	void *dirmap_buf;
+	u64 dirmap_reads;
+	u64 dirmap_bytes;
+	u64 dirmap_bounce_bytes;
+	u64 dirmap_ns;
 };
 
 /**
@@ -1298,6 +1315,121 @@ static int zynqmp_qspi_exec_op(struct spi_mem *mem,
 	return err;
 }
 
+/**
+ * zynqmp_qspi_dirmap_create - Prepare a direct mapping of the flash
+ * @desc:	Direct mapping descriptor
+ *
+ * Only reads are directly mapped, the template of the read operation is
+ * kept in @desc and reused for every read.
+ *
+ * Return: 0 in case of success, a negative error code otherwise.
+ */
+static int zynqmp_qspi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	struct zynqmp_qspi *xqspi = spi_controller_get_devdata
+				    (desc->mem->spi->master);
+
+	if (desc->info.op_tmpl.data.dir != SPI_MEM_DATA_IN)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&xqspi->dirmap_lock);
+	if (!xqspi->dirmap_buf)
+		xqspi->dirmap_buf = devm_kmalloc(xqspi->dev,
+						 GQSPI_DIRMAP_BOUNCE_SIZE,
+						 GFP_KERNEL);
+	mutex_unlock(&xqspi->dirmap_lock);
+
+	return xqspi->dirmap_buf ? 0 : -ENOMEM;
+}
+
+/**
+ * zynqmp_qspi_dirmap_read - Read from a direct mapping of the flash
+ * @desc:	Direct mapping descriptor
+ * @offs:	Offset in the direct mapping
+ * @len:	Number of bytes to read
+ * @buf:	Destination buffer
+ *
+ * The read is issued as a single operation when @buf can be the target of
+ * the DMA. Otherwise, e.g. for the vmalloc'ed buffers of UBI, it is split
+ * in back to back DMA reads into the bounce buffer, rather than falling
+ * back to the RX FIFO.
+ *
+ * Return: the number of bytes read, a negative error code otherwise.
+ */
+static ssize_t zynqmp_qspi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				       u64 offs, size_t len, void *buf)
+{
+	struct zynqmp_qspi *xqspi = spi_controller_get_devdata
+				    (desc->mem->spi->master);
+	struct spi_mem_op op = desc->info.op_tmpl;
+	bool bounce = !xqspi->io_mode &&
+		      (is_vmalloc_addr(buf) ||
+		       ((uintptr_t)buf & GQSPI_DMA_UNALIGN));
+	size_t done = 0, chunk;
+	u64 start;
+	int err = 0;
+
+	mutex_lock(&xqspi->dirmap_lock);
+	start = ktime_get_ns();
+
+	while (done < len) {
+		chunk = len - done;
+		if (bounce)
+			chunk = min_t(size_t, chunk, GQSPI_DIRMAP_BOUNCE_SIZE);
+
+		op.addr.val = desc->info.offset + offs + done;
+		op.data.nbytes = chunk;
+		op.data.buf.in = bounce ? xqspi->dirmap_buf : buf + done;
+
+		err = zynqmp_qspi_exec_op(desc->mem, &op);
+		if (err)
+			break;
+
+		if (bounce) {
+			memcpy(buf + done, xqspi->dirmap_buf, chunk);
+			xqspi->dirmap_bounce_bytes += chunk;
+		}
+		done += chunk;
+	}
+
+	xqspi->dirmap_ns += ktime_get_ns() - start;
+	xqspi->dirmap_bytes += done;
+	xqspi->dirmap_reads++;
+	mutex_unlock(&xqspi->dirmap_lock);
+
+	return done ? done : err;
+}
+
+static ssize_t dirmap_stats_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct zynqmp_qspi *xqspi = dev_get_drvdata(dev);
+	u64 kbps = 0;
+	ssize_t len;
+
+	mutex_lock(&xqspi->dirmap_lock);
+	if (xqspi->dirmap_ns)
+		kbps = div64_u64(xqspi->dirmap_bytes * NSEC_PER_SEC,
+				 xqspi->dirmap_ns * 1024);
+	len = sysfs_emit(buf, "reads: %llu\n", xqspi->dirmap_reads);
+	len += sysfs_emit_at(buf, len, "bytes: %llu\n", xqspi->dirmap_bytes);
+	len += sysfs_emit_at(buf, len, "bounced: %llu\n",
+			     xqspi->dirmap_bounce_bytes);
+	len += sysfs_emit_at(buf, len, "time: %llu us\n",
+			     div_u64(xqspi->dirmap_ns, NSEC_PER_USEC));
+	len += sysfs_emit_at(buf, len, "throughput: %llu KiB/s\n", kbps);
+	mutex_unlock(&xqspi->dirmap_lock);
+
+	return len;
+}
+static DEVICE_ATTR_RO(dirmap_stats);
+
+static struct attribute *zynqmp_qspi_attrs[] = {
+	&dev_attr_dirmap_stats.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(zynqmp_qspi);
+
 static int __maybe_unused zynqmp_runtime_idle(struct device *dev)
 {
 	struct zynqmp_qspi *xqspi = dev_get_drvdata(dev);
@@ -1327,6 +1459,8 @@ static const struct of_device_id zynqmp_qspi_of_match[] = {
 
 static const struct spi_controller_mem_ops zynqmp_qspi_mem_ops = {
 	.exec_op = zynqmp_qspi_exec_op,
+	.dirmap_create = zynqmp_qspi_dirmap_create,
+	.dirmap_read = zynqmp_qspi_dirmap_read,
 };
 
 /**
@@ -1398,11 +1532,14 @@ static int zynqmp_qspi_probe(struct platform_device *pdev)
 	init_completion(&xqspi->data_completion);
 
 	mutex_init(&xqspi->op_lock);
+	mutex_init(&xqspi->dirmap_lock);
 
 	pm_runtime_use_autosuspend(&pdev->dev);
 	pm_runtime_set_autosuspend_delay(&pdev->dev, SPI_AUTOSUSPEND_TIMEOUT);
 	pm_runtime_set_active(&pdev->dev);
 	pm_runtime_enable(&pdev->dev);
+	/* The flash devices are children of the controller */
+	device_enable_async_suspend(&pdev->dev);
 
 	if (of_property_read_bool(pdev->dev.of_node, "has-io-mode"))
 		xqspi->io_mode = true;
@@ -1536,6 +1673,7 @@ static struct platform_driver zynqmp_qspi_driver = {
 		.name = "zynqmp-qspi",
 		.of_match_table = zynqmp_qspi_of_match,
 		.pm = &zynqmp_qspi_dev_pm_ops,
+		.dev_groups = zynqmp_qspi_groups,
 	},
 };
 
@@ -1183,6 +1183,25 @@ static int axienet_ioctl_siocdevprivate(struct net_device *dev,
 	}
 }
 
+#if defined(CONFIG_XILINX_TSN_QBV) || IS_ENABLED(CONFIG_XILINX_TSN_QCI)
+static int axienet_setup_tc(struct net_device *ndev, enum tc_setup_type type,
+			    void *type_data)
+{
+	switch (type) {
+#ifdef CONFIG_XILINX_TSN_QBV
+	case TC_SETUP_QDISC_TAPRIO:
+		return axienet_setup_tc_taprio(ndev, type_data);
+#endif
+#if IS_ENABLED(CONFIG_XILINX_TSN_QCI)
+	case TC_SETUP_BLOCK:
+		return xlnx_switchdev_setup_tc_block(ndev, type_data);
+#endif
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+#endif
+
 static const struct net_device_ops axienet_netdev_ops = {
 	.ndo_open = axienet_tsn_open,
 	.ndo_stop = axienet_tsn_stop,
@@ -1193,6 +1212,9 @@ static const struct net_device_ops axienet_netdev_ops = {
 	.ndo_eth_ioctl = axienet_ioctl,
 	.ndo_siocdevprivate = axienet_ioctl_siocdevprivate,
 	.ndo_set_rx_mode = axienet_set_multicast_list_tsn,
+#if defined(CONFIG_XILINX_TSN_QBV) || IS_ENABLED(CONFIG_XILINX_TSN_QCI)
+	.ndo_setup_tc = axienet_setup_tc,
+#endif
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller = axienet_poll_controller,
 #endif
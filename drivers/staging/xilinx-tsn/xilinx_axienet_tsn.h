@@ -12,6 +12,7 @@
 #include <linux/netdevice.h>
 #include <linux/spinlock.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
 #include <linux/if_vlan.h>
 #include <linux/net_tstamp.h>
 #include <linux/phy.h>
@@ -779,6 +780,11 @@ enum axienet_tsn_ioctl {
  * @tx_bd_tail: transmit BD tail indices
  * @tx_bd_rd: TADMA read pointer offset
  * @tadma_tx_lock: TADMA tx lock
+ * @tadma_etf: launch time of the ST frames is honoured
+ * @tadma_etf_queue: ST frames waiting for their launch time, by time
+ * @tadma_etf_len: number of frames in @tadma_etf_queue
+ * @tadma_etf_timer: releases the frames of @tadma_etf_queue to TADMA
+ * @tadma_etf_lock: protects @tadma_etf_queue and @tadma_etf_len
  * @ptp_tx_lock: PTP tx lock
  * @dma_err_tasklet: Tasklet structure to process Axi DMA errors
  * @eth_irq:	Axi Ethernet IRQ number
@@ -888,6 +894,11 @@ struct axienet_local {
 	u32 tx_bd_tail[TADMA_MAX_NO_STREAM];
 	u32 tx_bd_rd[TADMA_MAX_NO_STREAM];
 	spinlock_t tadma_tx_lock;               /* TSN TADMA tx lock*/
+	bool tadma_etf;
+	struct rb_root_cached tadma_etf_queue;
+	u32 tadma_etf_len;
+	struct hrtimer tadma_etf_timer;
+	spinlock_t tadma_etf_lock;		/* TADMA launch time lock */
 #endif
 	spinlock_t ptp_tx_lock;		/* PTP tx lock*/
 	int eth_irq;
@@ -1249,6 +1260,7 @@ int axienet_qbv_init(struct net_device *ndev);
 void axienet_qbv_remove(struct net_device *ndev);
 int axienet_set_schedule(struct net_device *ndev, void __user *useraddr);
 int axienet_get_schedule(struct net_device *ndev, void __user *useraddr);
+int axienet_setup_tc_taprio(struct net_device *ndev, void *type_data);
 #endif
 
 #ifdef CONFIG_XILINX_TSN_QBR
@@ -1276,6 +1288,7 @@ int axienet_tadma_probe(struct platform_device *pdev, struct net_device *ndev);
 int axienet_tadma_xmit(struct sk_buff *skb, struct net_device *ndev, u16 queue_type);
 int axienet_tadma_open(struct net_device *ndev);
 int axienet_tadma_stop(struct net_device *ndev);
+int axienet_tadma_setup_etf(struct net_device *ndev, void *type_data);
 #endif
 
 int __maybe_unused axienet_dma_q_init(struct net_device *ndev,
@@ -1328,6 +1341,9 @@ int axienet_ethtools_set_coalesce(struct net_device *ndev,
 #if defined(CONFIG_XILINX_TSN_SWITCH)
 int tsn_switch_get_port_parent_id(struct net_device *dev,
 				  struct netdev_phys_item_id *ppid);
+#if IS_ENABLED(CONFIG_XILINX_TSN_QCI)
+int xlnx_switchdev_setup_tc_block(struct net_device *ndev, void *type_data);
+#endif
 #endif
 
 #endif /* XILINX_AXI_ENET_TSN_H */
@@ -276,6 +276,19 @@ static int tsn_ep_xmit(struct sk_buff *skb, struct net_device *ndev)
 	return axienet_queue_xmit_tsn(skb, ndev, map);
 }
 
+#ifdef CONFIG_AXIENET_HAS_TADMA
+static int tsn_ep_setup_tc(struct net_device *ndev, enum tc_setup_type type,
+			   void *type_data)
+{
+	switch (type) {
+	case TC_SETUP_QDISC_ETF:
+		return axienet_tadma_setup_etf(ndev, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+#endif
+
 static void tsn_ep_set_mac_address(struct net_device *ndev, const void *address)
 {
 	if (address)
@@ -338,6 +351,9 @@ static const struct net_device_ops ep_netdev_ops = {
 	.ndo_start_xmit = tsn_ep_xmit,
 	.ndo_set_mac_address = netdev_set_mac_address,
 	.ndo_select_queue = axienet_tsn_ep_select_queue,
+#ifdef CONFIG_AXIENET_HAS_TADMA
+	.ndo_setup_tc = tsn_ep_setup_tc,
+#endif
 #if defined(CONFIG_XILINX_TSN_SWITCH)
 	.ndo_get_port_parent_id = tsn_switch_get_port_parent_id,
 #endif
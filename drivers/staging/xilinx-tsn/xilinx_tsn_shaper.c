@@ -16,6 +16,8 @@
  * GNU General Public License for more details.
  */
 
+#include <net/pkt_sched.h>
+
 #include "xilinx_axienet_tsn.h"
 #include "xilinx_tsn_shaper.h"
 
@@ -199,6 +201,152 @@ int axienet_get_schedule(struct net_device *ndev, void __user *useraddr)
 	return ret;
 }
 
+/* Traffic class n of a taprio gate mask is the n-th hardware queue,
+ * from best effort up to scheduled traffic.
+ */
+static u32 axienet_taprio_mask_to_gs(struct axienet_local *lp, u32 gate_mask)
+{
+	u32 gs = 0;
+
+	if (gate_mask & BIT(0))
+		gs |= GS_BE_OPEN;
+	if (lp->num_tc == 3 && (gate_mask & BIT(1)))
+		gs |= GS_RE_OPEN;
+	if (gate_mask & BIT(lp->num_tc - 1))
+		gs |= GS_ST_OPEN;
+
+	return gs;
+}
+
+/* The core switches to the admin schedule at its base time. When that
+ * would leave a last operational cycle shorter than the cycle time
+ * extension, switch at the start of that cycle instead so that no runt
+ * cycle is run.
+ */
+static u64 axienet_taprio_switch_time(struct axienet_local *lp, u64 base,
+				      u64 extension)
+{
+	u64 oper_base, oper_cycle, rem;
+
+	if (!extension || !(axienet_qbv_ior(lp, CONFIG_CHANGE) &
+			    CC_ADMIN_GATE_ENABLE_BIT))
+		return base;
+
+	oper_cycle = axienet_qbv_ior(lp, OPER_CYCLE_TIME_DENOMINATOR) &
+		     CYCLE_TIME_DENOMINATOR_MASK;
+	oper_base = (((u64)(axienet_qbv_ior(lp, OPER_BASE_TIME_SECS) &
+			    BASE_TIME_SECS_MASK) << 32) |
+		     axienet_qbv_ior(lp, OPER_BASE_TIME_SEC)) * NSEC_PER_SEC +
+		    (axienet_qbv_ior(lp, OPER_BASE_TIME_NS) &
+		     OPER_BASE_TIME_NS_MASK);
+	if (!oper_cycle || base <= oper_base)
+		return base;
+
+	div64_u64_rem(base - oper_base, oper_cycle, &rem);
+	if (rem && rem < extension)
+		base -= rem;
+
+	return base;
+}
+
+/**
+ * axienet_taprio_replace - Offload a taprio schedule to the Qbv core
+ * @ndev: Pointer to the net_device structure
+ * @qopt: taprio offload parameters
+ *
+ * The schedule is written as the admin schedule, which the core makes
+ * operational at its base time. A pending admin schedule is replaced and
+ * disabling the offload opens all the gates.
+ *
+ * Return: 0 on success, negative errno otherwise.
+ */
+static int axienet_taprio_replace(struct net_device *ndev,
+				  struct tc_taprio_qopt_offload *qopt)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	u32 tick, max_entries, gs;
+	struct qbv_info *qbv;
+	u64 base, time;
+	int ret;
+	size_t i;
+
+	qbv = kzalloc(sizeof(*qbv), GFP_KERNEL);
+	if (!qbv)
+		return -ENOMEM;
+
+	if (!qopt->enable)
+		goto program;
+
+	gs = axienet_qbv_ior(lp, GATE_STATE);
+	tick = (gs >> GS_TICK_GRANULARITY_SHIFT) & GS_TICK_GRANULARITY_MASK;
+	tick = max(tick, 1U);
+	max_entries = (gs >> GS_SUP_MAX_LIST_LENGTH_SHIFT) &
+		      GS_SUP_MAX_LIST_LENGTH_MASK;
+	if (!max_entries)
+		max_entries = QBV_MAX_ENTRIES;
+
+	ret = -ERANGE;
+	if (!qopt->num_entries || qopt->num_entries > max_entries) {
+		netdev_err(ndev, "taprio: %zu entries, hardware supports %u\n",
+			   qopt->num_entries, max_entries);
+		goto out;
+	}
+	if (!qopt->cycle_time ||
+	    qopt->cycle_time > CYCLE_TIME_DENOMINATOR_MASK) {
+		netdev_err(ndev, "taprio: unsupported cycle time %llu\n",
+			   qopt->cycle_time);
+		goto out;
+	}
+
+	for (i = 0; i < qopt->num_entries; i++) {
+		struct tc_taprio_sched_entry *entry = &qopt->entries[i];
+
+		time = DIV_ROUND_UP(entry->interval, tick);
+		if (entry->command != TC_TAPRIO_CMD_SET_GATES ||
+		    entry->gate_mask & ~GENMASK(lp->num_tc - 1, 0) ||
+		    !time || time > CTRL_LIST_TIME_INTERVAL_MASK) {
+			netdev_err(ndev, "taprio: unsupported entry %zu\n", i);
+			ret = -EOPNOTSUPP;
+			goto out;
+		}
+
+		qbv->acl_gate_state[i] =
+			axienet_taprio_mask_to_gs(lp, entry->gate_mask);
+		qbv->acl_gate_time[i] = time;
+	}
+
+	base = axienet_taprio_switch_time(lp, ktime_to_ns(qopt->base_time),
+					  qopt->cycle_time_extension);
+
+	qbv->cycle_time = qopt->cycle_time;
+	qbv->list_length = qopt->num_entries;
+	qbv->ptp_time_sec = div_u64_rem(base, NSEC_PER_SEC, &qbv->ptp_time_ns);
+	qbv->force = 1;
+
+program:
+	ret = __axienet_set_schedule(ndev, qbv);
+out:
+	kfree(qbv);
+	return ret;
+}
+
+/**
+ * axienet_setup_tc_taprio - ndo_setup_tc handler for TC_SETUP_QDISC_TAPRIO
+ * @ndev: Pointer to the net_device structure
+ * @type_data: taprio offload parameters
+ *
+ * Return: 0 on success, negative errno otherwise.
+ */
+int axienet_setup_tc_taprio(struct net_device *ndev, void *type_data)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (!lp->qbv_regs)
+		return -EOPNOTSUPP;
+
+	return axienet_taprio_replace(ndev, type_data);
+}
+
 static irqreturn_t axienet_qbv_irq(int irq, void *_ndev)
 {
 	struct net_device *ndev = _ndev;
@@ -27,6 +27,8 @@ static struct device_node *ep_node;
 struct axienet_local lp;
 static struct axienet_local *ep_lp;
 static u8 en_hw_addr_learning;
+/* serialises the CAM command sequences */
+static DEFINE_MUTEX(cam_lock);
 static u8 sw_mac_addr[ETH_ALEN];
 
 #define DELAY_OF_FIVE_MILLISEC			(5 * DELAY_OF_ONE_MILLISEC)
@@ -67,6 +69,7 @@ static u8 sw_mac_addr[ETH_ALEN];
 #define PORT_STATUS_MASK                       (0x7)
 #define MAC2_PORT_STATUS_SHIFT                 (17)
 #define MAC2_PORT_STATUS_CHG_BIT               BIT(16)
+#define PORT_STATE_FLUSH			(5)
 #define MAC1_PORT_MAC_ADDR_LSB_SHIFT		(12)
 #define MAC1_PORT_STATUS_SHIFT                 (9)
 #define MAC1_PORT_STATUS_CHG_BIT               BIT(8)
@@ -517,7 +520,7 @@ static void get_memory_static_counter(struct switch_data *data)
 							     XAS_MEM_STCNTR_ERR_BE_MAC1_MAC2 + 0x4);
 }
 
-int tsn_switch_cam_set(struct cam_struct data, u8 add)
+static int __tsn_switch_cam_set(const struct cam_struct *data, u8 add)
 {
 	u32 port_action = 0;
 	u32 tv2 = 0;
@@ -531,12 +534,12 @@ int tsn_switch_cam_set(struct cam_struct data, u8 add)
 		pr_err("CAM init timed out\n");
 		return -ETIMEDOUT;
 	}
-	if (add && ((data.fwd_port & PORT_EX_ONLY) || (data.fwd_port & PORT_EX_EP))) {
+	if (add && (data->fwd_port & (PORT_EX_ONLY | PORT_EX_EP))) {
 		if (!(ep_lp->ex_ep)) {
 			pr_err("Endpoint extension support is not present in this design\n");
 			return -EINVAL;
-		} else if ((data.fwd_port & PORT_EX_ONLY) &&
-			    (data.fwd_port & PORT_EX_EP)) {
+		} else if ((data->fwd_port & PORT_EX_ONLY) &&
+			    (data->fwd_port & PORT_EX_EP)) {
 			if (!(ep_lp->packet_switch)) {
 				pr_err("Support for forwarding packets from endpoint to extended endpoint or vice versa is not present in this design\n");
 				return -EINVAL;
@@ -545,11 +548,11 @@ int tsn_switch_cam_set(struct cam_struct data, u8 add)
 	}
 	/* mac and vlan */
 	axienet_iow(&lp, XAS_SDL_CAM_KEY1_OFFSET,
-		    (data.dest_addr[0] << 24) | (data.dest_addr[1] << 16) |
-		    (data.dest_addr[2] << 8)  | (data.dest_addr[3]));
+		    (data->dest_addr[0] << 24) | (data->dest_addr[1] << 16) |
+		    (data->dest_addr[2] << 8)  | (data->dest_addr[3]));
 	axienet_iow(&lp, XAS_SDL_CAM_KEY2_OFFSET,
-		    ((data.dest_addr[4] << 8) | data.dest_addr[5]) |
-		    ((data.vlanid & SDL_CAM_VLAN_MASK) << SDL_CAM_VLAN_SHIFT));
+		    ((data->dest_addr[4] << 8) | data->dest_addr[5]) |
+		    ((data->vlanid & SDL_CAM_VLAN_MASK) << SDL_CAM_VLAN_SHIFT));
 
 	/* Introduce wmb to preserve KEY2 and TV1 write order fix possible
 	 * HW hang when KEY2 and TV1 registers are accessed sequentially.
@@ -558,16 +561,16 @@ int tsn_switch_cam_set(struct cam_struct data, u8 add)
 	wmb();
 	/* TV 1 and TV 2 */
 	axienet_iow(&lp, XAS_SDL_CAM_TV1_OFFSET,
-		    (data.src_addr[0] << 24) | (data.src_addr[1] << 16) |
-		    (data.src_addr[2] << 8)  | (data.src_addr[3]));
+		    (data->src_addr[0] << 24) | (data->src_addr[1] << 16) |
+		    (data->src_addr[2] << 8)  | (data->src_addr[3]));
 
-	tv2 = ((data.src_addr[4] << 8) | data.src_addr[5]) |
-	       ((data.tv_vlanid & SDL_CAM_VLAN_MASK) << SDL_CAM_VLAN_SHIFT);
+	tv2 = ((data->src_addr[4] << 8) | data->src_addr[5]) |
+	       ((data->tv_vlanid & SDL_CAM_VLAN_MASK) << SDL_CAM_VLAN_SHIFT);
 
-	if (data.flags & XAS_CAM_IPV_EN)
+	if (data->flags & XAS_CAM_IPV_EN)
 		en_ipv = 1;
 
-	tv2 = tv2 | ((data.ipv & SDL_CAM_IPV_MASK) << SDL_CAM_IPV_SHIFT)
+	tv2 = tv2 | ((data->ipv & SDL_CAM_IPV_MASK) << SDL_CAM_IPV_SHIFT)
 				| (en_ipv << SDL_EN_CAM_IPV_SHIFT);
 
 	axienet_iow(&lp, XAS_SDL_CAM_TV2_OFFSET, tv2);
@@ -577,19 +580,19 @@ int tsn_switch_cam_set(struct cam_struct data, u8 add)
 	 */
 	wmb();
 
-	if (data.fwd_port & PORT_EP)
-		port_action = data.ep_port_act << SDL_CAM_EP_ACTION_LIST_SHIFT;
-	if (data.fwd_port & PORT_MAC1 || data.fwd_port & PORT_MAC2)
-		port_action |= data.mac_port_act <<
+	if (data->fwd_port & PORT_EP)
+		port_action = data->ep_port_act << SDL_CAM_EP_ACTION_LIST_SHIFT;
+	if (data->fwd_port & PORT_MAC1 || data->fwd_port & PORT_MAC2)
+		port_action |= data->mac_port_act <<
 				SDL_CAM_MAC_ACTION_LIST_SHIFT;
 
-	if (data.flags & XAS_CAM_EP_MGMTQ_EN)
+	if (data->flags & XAS_CAM_EP_MGMTQ_EN)
 		port_action |= SDL_CAM_EP_MGMTQ_EN;
 
-	port_action = port_action | (data.fwd_port << SDL_CAM_PORT_LIST_SHIFT);
+	port_action = port_action | (data->fwd_port << SDL_CAM_PORT_LIST_SHIFT);
 
 #if IS_ENABLED(CONFIG_XILINX_TSN_QCI) || IS_ENABLED(CONFIG_XILINX_TSN_CB)
-	port_action = port_action | (data.gate_id << SDL_GATEID_SHIFT);
+	port_action = port_action | (data->gate_id << SDL_GATEID_SHIFT);
 #endif
 
 	/* port action */
@@ -618,6 +621,42 @@ int tsn_switch_cam_set(struct cam_struct data, u8 add)
 	return 0;
 }
 
+int tsn_switch_cam_set(struct cam_struct data, u8 add)
+{
+	int ret;
+
+	mutex_lock(&cam_lock);
+	ret = __tsn_switch_cam_set(&data, add);
+	mutex_unlock(&cam_lock);
+
+	return ret;
+}
+
+/**
+ * tsn_switch_cam_set_batch - Add or delete several CAM entries
+ * @data:	entries to write
+ * @num:	number of entries in @data
+ * @add:	ADD to add the entries, DELETE to delete them
+ *
+ * The CAM is held for the whole batch and the entries are written back to
+ * back, the writes stop at the first failure.
+ *
+ * Return: number of entries written
+ */
+int tsn_switch_cam_set_batch(const struct cam_struct *data, int num, u8 add)
+{
+	int i;
+
+	mutex_lock(&cam_lock);
+	for (i = 0; i < num; i++) {
+		if (__tsn_switch_cam_set(&data[i], add))
+			break;
+	}
+	mutex_unlock(&cam_lock);
+
+	return i;
+}
+
 static void port_vlan_mem_ctrl(u32 port_vlan_mem)
 {
 		axienet_iow(&lp, XAS_VLAN_MEMB_CTRL_REG, port_vlan_mem);
@@ -627,11 +666,13 @@ static int read_cam_entry(struct cam_struct data, void __user *arg)
 {
 	u32 u_value, reg, err;
 
+	mutex_lock(&cam_lock);
 	/* wait for cam init done */
 	err = readl_poll_timeout(lp.regs + XAS_SDL_CAM_STATUS_OFFSET, reg,
 				 (reg & SDL_CAM_WR_ENABLE), 10,
 				 DELAY_OF_FIVE_MILLISEC);
 	if (err) {
+		mutex_unlock(&cam_lock);
 		pr_err("CAM init timed out\n");
 		return -ETIMEDOUT;
 	}
@@ -653,6 +694,7 @@ static int read_cam_entry(struct cam_struct data, void __user *arg)
 				 (!(reg & SDL_CAM_WR_ENABLE)), 10,
 				 DELAY_OF_FIVE_MILLISEC);
 	if (err) {
+		mutex_unlock(&cam_lock);
 		pr_err("CAM write timed out\n");
 		return -ETIMEDOUT;
 	}
@@ -686,6 +728,8 @@ static int read_cam_entry(struct cam_struct data, void __user *arg)
 	} else {
 		data.flags &= ~XAS_CAM_VALID;
 	}
+	mutex_unlock(&cam_lock);
+
 	if (copy_to_user(arg, &data, sizeof(struct cam_struct)))
 		return -EFAULT;
 
@@ -749,24 +793,25 @@ static int get_mac_addr_learn(void __user *arg)
 	return 0;
 }
 
-static int get_mac_addr_learnt_list(void __user *arg)
+/**
+ * tsn_switch_learnt_for_each - Walk the addresses learnt on a MAC port
+ * @port_num:	PORT_MAC1 or PORT_MAC2
+ * @fn:		called with the CAM held for each learnt address and its
+ *		index in the learnt table of the port
+ * @priv:	passed to @fn
+ *
+ * Return: number of addresses learnt on the port or a negative error code
+ */
+int tsn_switch_learnt_for_each(u8 port_num, tsn_switch_learnt_fn fn,
+			       void *priv)
 {
-	struct mac_addr_list *mac_list;
-	u32 i = 0;
+	struct mac_learnt entry;
+	u32 i, found = 0, num;
 	u32 u_value, reg, err;
 	u16 read_key_addr = 0;
-	int ret = 0;
-
-	mac_list = kzalloc(sizeof(*mac_list), GFP_KERNEL);
-	if (!mac_list) {
-		ret = -ENOMEM;
-		goto ret_status;
-	}
+	int ret;
 
-	if (copy_from_user(mac_list, arg, sizeof(u8))) {
-		ret = -EFAULT;
-		goto free_mac_list;
-	}
+	mutex_lock(&cam_lock);
 	/* wait for cam init done */
 	err = readl_poll_timeout(lp.regs + XAS_SDL_CAM_STATUS_OFFSET, reg,
 				 (reg & SDL_CAM_WR_ENABLE), 10,
@@ -774,27 +819,29 @@ static int get_mac_addr_learnt_list(void __user *arg)
 	if (err) {
 		pr_err("CAM init timed out\n");
 		ret = -ETIMEDOUT;
-		goto free_mac_list;
+		goto unlock;
 	}
 	u_value = axienet_ior(&lp, XAS_SDL_CAM_STATUS_OFFSET);
 
-	if (mac_list->port_num == PORT_MAC1) {
-		mac_list->num_list = (u_value >> SDL_CAM_LEARNT_ENT_MAC1_SHIFT)
+	if (port_num == PORT_MAC1) {
+		num = (u_value >> SDL_CAM_LEARNT_ENT_MAC1_SHIFT)
 					& SDL_CAM_LEARNT_ENT_MASK;
 	} else {
-		mac_list->num_list = (u_value >> SDL_CAM_LEARNT_ENT_MAC2_SHIFT)
+		num = (u_value >> SDL_CAM_LEARNT_ENT_MAC2_SHIFT)
 					& SDL_CAM_LEARNT_ENT_MASK;
 		read_key_addr = 0x800;
 	}
+	ret = num;
 
-	for (i = 0; i < MAX_NUM_MAC_ENTRIES ; i++) {
+	/* Stop once all the learnt addresses of the port have been seen */
+	for (i = 0; i < MAX_NUM_MAC_ENTRIES && found < num; i++) {
 		err = readl_poll_timeout(lp.regs + XAS_SDL_CAM_STATUS_OFFSET, reg,
 					 (reg & SDL_CAM_WR_ENABLE), 10,
 					 DELAY_OF_FIVE_MILLISEC);
 		if (err) {
 			pr_err("CAM init timed out\n");
 			ret = -ETIMEDOUT;
-			goto free_mac_list;
+			goto unlock;
 		}
 
 		u_value = ((read_key_addr + i) << SDL_CAM_READ_KEY_ADDR_SHIFT)
@@ -807,22 +854,63 @@ static int get_mac_addr_learnt_list(void __user *arg)
 		if (err) {
 			pr_err("CAM write timed out\n");
 			ret = -ETIMEDOUT;
-			goto free_mac_list;
+			goto unlock;
 		}
 		u_value = axienet_ior(&lp, XAS_SDL_CAM_CTRL_OFFSET);
 
-		if (u_value & SDL_CAM_FOUND_BIT) {
-			u_value = axienet_ior(&lp, XAS_SDL_CAM_KEY1_OFFSET);
-			mac_list->list[i].mac_addr[0] = (u_value >> 24) & 0xFF;
-			mac_list->list[i].mac_addr[1] = (u_value >> 16) & 0xFF;
-			mac_list->list[i].mac_addr[2] = (u_value >> 8) & 0xFF;
-			mac_list->list[i].mac_addr[3] = (u_value) & 0xFF;
-			u_value = axienet_ior(&lp, XAS_SDL_CAM_KEY2_OFFSET);
-			mac_list->list[i].mac_addr[4] = (u_value >> 8) & 0xFF;
-			mac_list->list[i].mac_addr[5] = (u_value) & 0xFF;
-			mac_list->list[i].vlan_id     = (u_value >> 16) & 0xFFF;
-		}
+		if (!(u_value & SDL_CAM_FOUND_BIT))
+			continue;
+
+		u_value = axienet_ior(&lp, XAS_SDL_CAM_KEY1_OFFSET);
+		entry.mac_addr[0] = (u_value >> 24) & 0xFF;
+		entry.mac_addr[1] = (u_value >> 16) & 0xFF;
+		entry.mac_addr[2] = (u_value >> 8) & 0xFF;
+		entry.mac_addr[3] = (u_value) & 0xFF;
+		u_value = axienet_ior(&lp, XAS_SDL_CAM_KEY2_OFFSET);
+		entry.mac_addr[4] = (u_value >> 8) & 0xFF;
+		entry.mac_addr[5] = (u_value) & 0xFF;
+		entry.vlan_id     = (u_value >> 16) & 0xFFF;
+		found++;
+		fn(i, &entry, priv);
+	}
+
+unlock:
+	mutex_unlock(&cam_lock);
+	return ret;
+}
+
+static void mac_addr_learnt_list_fill(u16 index,
+				      const struct mac_learnt *entry,
+				      void *priv)
+{
+	struct mac_addr_list *mac_list = priv;
+
+	mac_list->list[index] = *entry;
+}
+
+static int get_mac_addr_learnt_list(void __user *arg)
+{
+	struct mac_addr_list *mac_list;
+	int ret = 0;
+
+	mac_list = kzalloc(sizeof(*mac_list), GFP_KERNEL);
+	if (!mac_list) {
+		ret = -ENOMEM;
+		goto ret_status;
+	}
+
+	if (copy_from_user(mac_list, arg, sizeof(u8))) {
+		ret = -EFAULT;
+		goto free_mac_list;
 	}
+
+	ret = tsn_switch_learnt_for_each(mac_list->port_num,
+					 mac_addr_learnt_list_fill, mac_list);
+	if (ret < 0)
+		goto free_mac_list;
+	mac_list->num_list = ret;
+	ret = 0;
+
 	if (copy_to_user(arg, mac_list, sizeof(struct mac_addr_list))) {
 		ret = -EFAULT;
 		goto free_mac_list;
@@ -834,6 +922,93 @@ static int get_mac_addr_learnt_list(void __user *arg)
 	return ret;
 }
 
+struct fdb_flush_vlan {
+	struct cam_struct *cam;
+	int num;
+	u16 vid;
+};
+
+static void fdb_flush_vlan_match(u16 index, const struct mac_learnt *entry,
+				 void *priv)
+{
+	struct fdb_flush_vlan *flush = priv;
+	struct cam_struct *cam;
+
+	if (entry->vlan_id != flush->vid)
+		return;
+
+	cam = &flush->cam[flush->num++];
+	ether_addr_copy(cam->dest_addr, entry->mac_addr);
+	cam->vlanid = entry->vlan_id;
+}
+
+/**
+ * tsn_switch_fdb_flush_vlan - Delete the addresses of a VLAN learnt on a port
+ * @port_num:	PORT_MAC1 or PORT_MAC2
+ * @vid:	VLAN ID
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int tsn_switch_fdb_flush_vlan(u8 port_num, u16 vid)
+{
+	struct fdb_flush_vlan flush = { .vid = vid };
+	int ret;
+
+	flush.cam = kcalloc(MAX_NUM_MAC_ENTRIES, sizeof(*flush.cam),
+			    GFP_KERNEL);
+	if (!flush.cam)
+		return -ENOMEM;
+
+	ret = tsn_switch_learnt_for_each(port_num, fdb_flush_vlan_match,
+					 &flush);
+	if (ret >= 0 && tsn_switch_cam_set_batch(flush.cam, flush.num,
+						 DELETE) != flush.num)
+		ret = -ETIMEDOUT;
+
+	kfree(flush.cam);
+
+	return ret < 0 ? ret : 0;
+}
+
+/**
+ * tsn_switch_fdb_flush_port - Delete all the addresses learnt on a port
+ * @port_num:	PORT_MAC1 or PORT_MAC2
+ *
+ * The port is flushed by the hardware through its flush state, then put back
+ * in its current state.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int tsn_switch_fdb_flush_port(u8 port_num)
+{
+	struct port_status port = { .port_num = port_num };
+	u32 u_value, shift;
+	int ret;
+
+	shift = port_num == PORT_MAC1 ? MAC1_PORT_STATUS_SHIFT :
+					MAC2_PORT_STATUS_SHIFT;
+	u_value = axienet_ior(&lp, XAS_PORT_STATE_CTRL_OFFSET);
+
+	port.port_status = PORT_STATE_FLUSH;
+	ret = tsn_switch_set_stp_state(&port);
+	if (ret)
+		return ret;
+
+	port.port_status = (u_value >> shift) & PORT_STATUS_MASK;
+
+	return tsn_switch_set_stp_state(&port);
+}
+
+/**
+ * tsn_switch_hw_learning - Tell if the switch learns addresses in hardware
+ *
+ * Return: true if hardware address learning is present in the design
+ */
+bool tsn_switch_hw_learning(void)
+{
+	return en_hw_addr_learning;
+}
+
 int tsn_switch_set_stp_state(struct port_status *port)
 {
 	u32 u_value, reg, err;
@@ -466,7 +466,17 @@ void config_ingress_filter(struct cb data);
 void get_member_reg(struct frer_memb_config *data);
 void program_member_reg(struct cb data);
 void get_frer_static_counter(struct frer_static_counter *data);
+typedef void (*tsn_switch_learnt_fn)(u16 index,
+				     const struct mac_learnt *entry,
+				     void *priv);
+
 int tsn_switch_cam_set(struct cam_struct data, u8 add);
+int tsn_switch_cam_set_batch(const struct cam_struct *data, int num, u8 add);
+int tsn_switch_learnt_for_each(u8 port_num, tsn_switch_learnt_fn fn,
+			       void *priv);
+int tsn_switch_fdb_flush_vlan(u8 port_num, u16 vid);
+int tsn_switch_fdb_flush_port(u8 port_num);
+bool tsn_switch_hw_learning(void);
 u8 *tsn_switch_get_id(void);
 int tsn_switch_set_stp_state(struct port_status *port);
 int tsn_switch_vlan_add(struct port_vlan *port, int add);
@@ -7,7 +7,11 @@
 #ifdef CONFIG_XILINX_TSN_SWITCH
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/etherdevice.h>
+#include <linux/hashtable.h>
 #include <linux/if_bridge.h>
+#include <linux/jhash.h>
+#include <net/flow_offload.h>
 #include <net/switchdev.h>
 #include "xilinx_axienet_tsn.h"
 #include "xilinx_tsn_switch.h"
@@ -40,34 +44,83 @@ static int
 xlnx_switchdev_port_attr_set_event(struct net_device *netdev,
 				   struct switchdev_notifier_port_attr_info *port_attr_info);
 
-static int xlnx_switch_fdb_set(struct axienet_local *lp,
-			       struct switchdev_notifier_fdb_info *fdb_info,
-			       bool adding)
+static void xlnx_sw_fdb_to_cam(struct axienet_local *lp, const u8 *addr,
+			       u16 vid, struct cam_struct *data)
 {
-	struct cam_struct data;
-
-	memset(&data, 0, sizeof(struct cam_struct));
-	data.fwd_port = lp->switch_prt;
-	ether_addr_copy((u8 *)&data.dest_addr, fdb_info->addr);
-	data.vlanid = fdb_info->vid;
-
-	return tsn_switch_cam_set(data, adding);
+	memset(data, 0, sizeof(struct cam_struct));
+	data->fwd_port = lp->switch_prt;
+	ether_addr_copy(data->dest_addr, addr);
+	data->vlanid = vid;
 }
 
-struct xlnx_switchdev_event_work {
-	struct work_struct work;
-	struct switchdev_notifier_fdb_info fdb_info;
+/**
+ * struct xlnx_sw_fdb_event - FDB update waiting to be written to the CAM
+ * @list: entry in xlnx_sw_fdb_events
+ * @hash_link: entry in xlnx_sw_fdb_seen while the events are coalesced
+ * @lp: switch port of the FDB entry
+ * @addr: MAC address of the FDB entry
+ * @vid: VLAN ID of the FDB entry
+ * @add: the entry is added, deleted otherwise
+ */
+struct xlnx_sw_fdb_event {
+	struct list_head list;
+	struct hlist_node hash_link;
 	struct axienet_local *lp;
-	unsigned long event;
+	u8 addr[ETH_ALEN];
+	u16 vid;
+	bool add;
+};
+
+/**
+ * struct xlnx_sw_learnt - Hardware learnt address reported to the bridge
+ * @hash_link: entry in xlnx_sw_learnt
+ * @ndev: bridge port the address was learnt on
+ * @addr: learnt MAC address
+ * @vid: VLAN ID of the learnt address
+ * @gen: last learnt table scan that found the address
+ */
+struct xlnx_sw_learnt {
+	struct hlist_node hash_link;
+	struct net_device *ndev;
+	u8 addr[ETH_ALEN];
+	u16 vid;
+	u32 gen;
 };
 
+/* Indexed by the bit number of switch_prt: EP, MAC1 and MAC2 */
+#define XLNX_SW_NUM_PORTS		3
+
+static uint learn_sync_ms = 1000;
+module_param(learn_sync_ms, uint, 0644);
+MODULE_PARM_DESC(learn_sync_ms,
+		 "Interval of the push of the hardware learnt addresses to the bridge in ms, 0 to disable (default: 1000)");
+
+static LIST_HEAD(xlnx_sw_fdb_events);
+static DEFINE_SPINLOCK(xlnx_sw_fdb_events_lock);
+static DEFINE_HASHTABLE(xlnx_sw_fdb_seen, 8);
+static DEFINE_HASHTABLE(xlnx_sw_learnt, 8);
+static u32 xlnx_sw_learnt_gen;
+/* Bridged MAC ports and their STP state, protected by the RTNL */
+static struct net_device *xlnx_sw_ports[XLNX_SW_NUM_PORTS];
+static u8 xlnx_sw_port_state[XLNX_SW_NUM_PORTS];
+
+static void xlnx_sw_fdb_work_fn(struct work_struct *work);
+static void xlnx_sw_learn_work_fn(struct work_struct *work);
+static DECLARE_WORK(xlnx_sw_fdb_work, xlnx_sw_fdb_work_fn);
+static DECLARE_DELAYED_WORK(xlnx_sw_learn_work, xlnx_sw_learn_work_fn);
+
+static u32 xlnx_sw_fdb_hash(const u8 *addr, u16 vid, const void *port)
+{
+	return jhash(addr, ETH_ALEN, vid) ^ hash_ptr(port, 32);
+}
+
 static void xlnx_sw_fdb_offload_notify(struct axienet_local *lp,
-				       struct switchdev_notifier_fdb_info *recv_info)
+				       const u8 *addr, u16 vid)
 {
-	struct switchdev_notifier_fdb_info info;
+	struct switchdev_notifier_fdb_info info = {};
 
-	info.addr = recv_info->addr;
-	info.vid = recv_info->vid;
+	info.addr = addr;
+	info.vid = vid;
 	call_switchdev_notifiers(SWITCHDEV_FDB_OFFLOADED,
 				 lp->ndev, &info.info, NULL);
 }
@@ -129,6 +182,12 @@ static int xlnx_sw_port_obj_vlan_del(struct axienet_local *lp,
 	if (err)
 		return err;
 
+	if (tsn_switch_hw_learning() && lp->switch_prt != PORT_EP) {
+		err = tsn_switch_fdb_flush_vlan(lp->switch_prt, vid);
+		if (err)
+			return err;
+	}
+
 	return 0;
 }
 
@@ -170,39 +229,186 @@ static int xlnx_sw_obj_del(struct net_device *ndev,
 	return err;
 }
 
-static void xlnx_switchdev_event_work(struct work_struct *work)
+static void xlnx_sw_fdb_coalesce(struct list_head *events)
 {
-	struct xlnx_switchdev_event_work *switchdev_work =
-		container_of(work, struct xlnx_switchdev_event_work, work);
-	struct axienet_local *lp = switchdev_work->lp;
-	struct switchdev_notifier_fdb_info *fdb_info;
-	int err;
+	struct xlnx_sw_fdb_event *ev, *tmp, *seen;
+	u32 key;
 
-	rtnl_lock();
-	switch (switchdev_work->event) {
-	case SWITCHDEV_FDB_ADD_TO_DEVICE:
-		fdb_info = &switchdev_work->fdb_info;
-		err = xlnx_switch_fdb_set(lp, fdb_info, true);
-		if (err) {
-			netdev_dbg(lp->ndev, "fdb add failed err=%d\n", err);
-			break;
+	/* Only the last update of an entry is written to the CAM */
+	list_for_each_entry_safe_reverse(ev, tmp, events, list) {
+		key = xlnx_sw_fdb_hash(ev->addr, ev->vid, ev->lp);
+		hash_for_each_possible(xlnx_sw_fdb_seen, seen, hash_link, key) {
+			if (seen->lp == ev->lp && seen->vid == ev->vid &&
+			    ether_addr_equal(seen->addr, ev->addr))
+				break;
 		}
-		xlnx_sw_fdb_offload_notify(lp, fdb_info);
-		break;
-	case SWITCHDEV_FDB_DEL_TO_DEVICE:
-		fdb_info = &switchdev_work->fdb_info;
-		err = xlnx_switch_fdb_set(lp, fdb_info, false);
-		if (err) {
-			netdev_dbg(lp->ndev, "fdb add failed err=%d\n", err);
+		if (seen) {
+			list_del(&ev->list);
+			dev_put(ev->lp->ndev);
+			kfree(ev);
+			continue;
+		}
+		hash_add(xlnx_sw_fdb_seen, &ev->hash_link, key);
+	}
+
+	list_for_each_entry(ev, events, list)
+		hash_del(&ev->hash_link);
+}
+
+static void xlnx_sw_fdb_write(struct list_head *events, bool add)
+{
+	struct xlnx_sw_fdb_event *ev;
+	struct cam_struct *data;
+	int num = 0, done, i;
+
+	list_for_each_entry(ev, events, list)
+		num += ev->add == add;
+	if (!num)
+		return;
+
+	data = kcalloc(num, sizeof(*data), GFP_KERNEL);
+	if (!data) {
+		pr_err("%s: no memory for %d FDB updates\n", __func__, num);
+		return;
+	}
+
+	i = 0;
+	list_for_each_entry(ev, events, list) {
+		if (ev->add == add)
+			xlnx_sw_fdb_to_cam(ev->lp, ev->addr, ev->vid,
+					   &data[i++]);
+	}
+
+	done = tsn_switch_cam_set_batch(data, num, add);
+	if (done != num)
+		pr_err("%s: %d of %d FDB updates failed\n", __func__,
+		       num - done, num);
+
+	i = 0;
+	list_for_each_entry(ev, events, list) {
+		if (!add || i >= done)
 			break;
+		if (!ev->add)
+			continue;
+		xlnx_sw_fdb_offload_notify(ev->lp, ev->addr, ev->vid);
+		i++;
+	}
+
+	kfree(data);
+}
+
+/*
+ * The FDB updates queued by the notifier are written to the CAM in batches,
+ * deletions first to make room for the additions.
+ */
+static void xlnx_sw_fdb_work_fn(struct work_struct *work)
+{
+	struct xlnx_sw_fdb_event *ev, *tmp;
+	LIST_HEAD(events);
+
+	spin_lock_bh(&xlnx_sw_fdb_events_lock);
+	list_splice_init(&xlnx_sw_fdb_events, &events);
+	spin_unlock_bh(&xlnx_sw_fdb_events_lock);
+
+	rtnl_lock();
+	xlnx_sw_fdb_coalesce(&events);
+	xlnx_sw_fdb_write(&events, false);
+	xlnx_sw_fdb_write(&events, true);
+	rtnl_unlock();
+
+	list_for_each_entry_safe(ev, tmp, &events, list) {
+		dev_put(ev->lp->ndev);
+		kfree(ev);
+	}
+}
+
+static void xlnx_sw_learnt_seen(u16 index, const struct mac_learnt *entry,
+				void *priv)
+{
+	struct switchdev_notifier_fdb_info info = {};
+	struct net_device *ndev = priv;
+	struct xlnx_sw_learnt *l;
+	u32 key;
+
+	key = xlnx_sw_fdb_hash(entry->mac_addr, entry->vlan_id, ndev);
+	hash_for_each_possible(xlnx_sw_learnt, l, hash_link, key) {
+		if (l->ndev == ndev && l->vid == entry->vlan_id &&
+		    ether_addr_equal(l->addr, entry->mac_addr)) {
+			l->gen = xlnx_sw_learnt_gen;
+			return;
 		}
-		break;
+	}
+
+	l = kzalloc(sizeof(*l), GFP_KERNEL);
+	if (!l)
+		return;
+
+	l->ndev = ndev;
+	ether_addr_copy(l->addr, entry->mac_addr);
+	l->vid = entry->vlan_id;
+	l->gen = xlnx_sw_learnt_gen;
+	hash_add(xlnx_sw_learnt, &l->hash_link, key);
+
+	info.addr = l->addr;
+	info.vid = l->vid;
+	info.offloaded = true;
+	call_switchdev_notifiers(SWITCHDEV_FDB_ADD_TO_BRIDGE, ndev, &info.info,
+				 NULL);
+}
+
+/* Called with the RTNL held */
+static void xlnx_sw_learnt_forget(struct net_device *ndev)
+{
+	struct xlnx_sw_learnt *l;
+	struct hlist_node *tmp;
+	int bkt;
+
+	hash_for_each_safe(xlnx_sw_learnt, bkt, tmp, l, hash_link) {
+		if (l->ndev != ndev)
+			continue;
+		hash_del(&l->hash_link);
+		kfree(l);
+	}
+}
+
+/*
+ * The switch has no learning interrupt: the learnt tables of the bridged
+ * ports are scanned and the changes are pushed to the bridge, which then
+ * does not have to be polled from user space.
+ */
+static void xlnx_sw_learn_work_fn(struct work_struct *work)
+{
+	struct switchdev_notifier_fdb_info info = {};
+	struct xlnx_sw_learnt *l;
+	struct hlist_node *tmp;
+	int i, bkt;
+
+	rtnl_lock();
+	xlnx_sw_learnt_gen++;
+	for (i = 0; i < XLNX_SW_NUM_PORTS; i++) {
+		if (!xlnx_sw_ports[i] || BIT(i) == PORT_EP)
+			continue;
+		tsn_switch_learnt_for_each(BIT(i), xlnx_sw_learnt_seen,
+					   xlnx_sw_ports[i]);
+	}
+
+	/* The addresses that have not been found have aged out */
+	hash_for_each_safe(xlnx_sw_learnt, bkt, tmp, l, hash_link) {
+		if (l->gen == xlnx_sw_learnt_gen)
+			continue;
+		info.addr = l->addr;
+		info.vid = l->vid;
+		info.offloaded = true;
+		call_switchdev_notifiers(SWITCHDEV_FDB_DEL_TO_BRIDGE, l->ndev,
+					 &info.info, NULL);
+		hash_del(&l->hash_link);
+		kfree(l);
 	}
 	rtnl_unlock();
 
-	kfree(switchdev_work->fdb_info.addr);
-	kfree(switchdev_work);
-	dev_put(lp->ndev);
+	if (learn_sync_ms)
+		queue_delayed_work(xlnx_sw_owq, &xlnx_sw_learn_work,
+				   msecs_to_jiffies(learn_sync_ms));
 }
 
 static int xlnx_switchdev_event(struct notifier_block *unused,
@@ -210,38 +416,36 @@ static int xlnx_switchdev_event(struct notifier_block *unused,
 {
 	struct net_device *dev = switchdev_notifier_info_to_dev(ptr);
 	struct switchdev_notifier_fdb_info *fdb_info = ptr;
-	struct xlnx_switchdev_event_work *switchdev_work;
-	struct axienet_local *lp;
-
-	lp = netdev_priv(dev);
-	switchdev_work = kzalloc(sizeof(*switchdev_work), GFP_ATOMIC);
-	if (!switchdev_work)
-		return NOTIFY_BAD;
+	struct xlnx_sw_fdb_event *ev;
 
 	if (event == SWITCHDEV_PORT_ATTR_SET)
 		return xlnx_switchdev_port_attr_set_event(dev, ptr);
 
-	INIT_WORK(&switchdev_work->work, xlnx_switchdev_event_work);
-	switchdev_work->lp = lp;
-	switchdev_work->event = event;
+	if (event != SWITCHDEV_FDB_ADD_TO_DEVICE &&
+	    event != SWITCHDEV_FDB_DEL_TO_DEVICE)
+		return NOTIFY_DONE;
 
-	switch (event) {
-	case SWITCHDEV_FDB_ADD_TO_DEVICE:
-	case SWITCHDEV_FDB_DEL_TO_DEVICE:
-		memcpy(&switchdev_work->fdb_info, ptr,
-		       sizeof(switchdev_work->fdb_info));
-		switchdev_work->fdb_info.addr = kzalloc(ETH_ALEN, GFP_ATOMIC);
-		ether_addr_copy((u8 *)switchdev_work->fdb_info.addr,
-				fdb_info->addr);
-		/* take a reference on the switch port dev */
-		dev_hold(dev);
-		break;
-	default:
-		kfree(switchdev_work);
+	/* Dynamic entries are already in the CAM when the switch learns */
+	if (!fdb_info->added_by_user && tsn_switch_hw_learning())
 		return NOTIFY_DONE;
-	}
 
-	queue_work(xlnx_sw_owq, &switchdev_work->work);
+	ev = kzalloc(sizeof(*ev), GFP_ATOMIC);
+	if (!ev)
+		return NOTIFY_BAD;
+
+	ev->lp = netdev_priv(dev);
+	ether_addr_copy(ev->addr, fdb_info->addr);
+	ev->vid = fdb_info->vid;
+	ev->add = event == SWITCHDEV_FDB_ADD_TO_DEVICE;
+	/* take a reference on the switch port dev */
+	dev_hold(dev);
+
+	spin_lock_bh(&xlnx_sw_fdb_events_lock);
+	list_add_tail(&ev->list, &xlnx_sw_fdb_events);
+	spin_unlock_bh(&xlnx_sw_fdb_events_lock);
+
+	/* Updates queued while the work is pending are written with it */
+	queue_work(xlnx_sw_owq, &xlnx_sw_fdb_work);
 
 	return NOTIFY_DONE;
 }
@@ -292,12 +496,32 @@ static struct notifier_block xlnx_switchdev_blocking_notifier = {
 
 static int xlnx_sw_port_attr_stp_state_set(struct axienet_local *lp, u8 state)
 {
+	int port = ilog2(lp->switch_prt);
 	struct port_status ps;
+	int err;
+	u8 old;
 
 	ps.port_num = lp->switch_prt;
 	ps.port_status = tsn_to_linux_sw_state(state);
 
-	return tsn_switch_set_stp_state(&ps);
+	err = tsn_switch_set_stp_state(&ps);
+	if (err || port >= XLNX_SW_NUM_PORTS)
+		return err;
+
+	old = xlnx_sw_port_state[port];
+	xlnx_sw_port_state[port] = state;
+	xlnx_sw_ports[port] = state == BR_STATE_DISABLED ? NULL : lp->ndev;
+	if (!tsn_switch_hw_learning() || lp->switch_prt == PORT_EP)
+		return 0;
+
+	/* Flush the learnt addresses when the port stops learning */
+	if ((old == BR_STATE_LEARNING || old == BR_STATE_FORWARDING) &&
+	    state != BR_STATE_LEARNING && state != BR_STATE_FORWARDING) {
+		xlnx_sw_learnt_forget(lp->ndev);
+		err = tsn_switch_fdb_flush_port(lp->switch_prt);
+	}
+
+	return err;
 }
 
 static int xlnx_sw_port_attr_pre_bridge_flags_set(struct axienet_local *lp,
@@ -353,6 +577,453 @@ xlnx_switchdev_port_attr_set_event(struct net_device *netdev,
 	return notifier_from_errno(err);
 }
 
+#if IS_ENABLED(CONFIG_XILINX_TSN_QCI)
+/* The gate and meter ids of the PSFP tables are 8 bit wide */
+#define XLNX_SW_MAX_STREAMS		256
+#define XLNX_SW_MAX_FR_SIZE		0xfff
+#define XLNX_SW_MAX_BURST		0xffffff
+
+/* PSFP and FRER control register write operations */
+#define XLNX_SW_PSFP_WR_FILTER		0
+#define XLNX_SW_PSFP_WR_METER		1
+#define XLNX_SW_FRER_WR_MEMBER		1
+#define XLNX_SW_CTRL_OP_WRITE		1
+
+/**
+ * struct xlnx_sw_stream - Stream offloaded from a tc flower rule
+ * @list: entry in xlnx_sw_streams
+ * @cookie: tc flower rule cookie
+ * @lp: ingress port of the stream
+ * @cam: CAM entry identifying the stream, @cam.gate_id is the stream handle
+ * @max_fr_size: largest SDU accepted by the stream filter
+ * @meter: meter of the stream, valid if @en_meter is set
+ * @en_meter: stream is policed by @meter
+ * @allow: frames of the stream are forwarded
+ * @frer: frames of the stream are replicated to both MAC ports
+ * @frames: PSFP frame count reported by the last FLOW_CLS_STATS
+ * @drops: PSFP error count reported by the last FLOW_CLS_STATS
+ */
+struct xlnx_sw_stream {
+	struct list_head list;
+	unsigned long cookie;
+	struct axienet_local *lp;
+	struct cam_struct cam;
+	u16 max_fr_size;
+	struct meter_config meter;
+	bool en_meter;
+	bool allow;
+	bool frer;
+	u64 frames;
+	u64 drops;
+};
+
+static LIST_HEAD(xlnx_sw_block_cb_list);
+static LIST_HEAD(xlnx_sw_streams);
+static DEFINE_MUTEX(xlnx_sw_streams_lock);
+static DECLARE_BITMAP(xlnx_sw_stream_ids, XLNX_SW_MAX_STREAMS);
+
+static struct xlnx_sw_stream *xlnx_sw_stream_find(struct axienet_local *lp,
+						  unsigned long cookie)
+{
+	struct xlnx_sw_stream *s;
+
+	list_for_each_entry(s, &xlnx_sw_streams, list)
+		if (s->lp == lp && s->cookie == cookie)
+			return s;
+
+	return NULL;
+}
+
+static int xlnx_sw_flower_parse_key(struct flow_rule *rule,
+				    struct xlnx_sw_stream *s,
+				    struct netlink_ext_ack *extack)
+{
+	struct flow_dissector *dissector = rule->match.dissector;
+	struct flow_match_eth_addrs eth;
+	struct flow_match_vlan vlan;
+
+	if (dissector->used_keys &
+	    ~(BIT(FLOW_DISSECTOR_KEY_CONTROL) |
+	      BIT(FLOW_DISSECTOR_KEY_BASIC) |
+	      BIT(FLOW_DISSECTOR_KEY_ETH_ADDRS) |
+	      BIT(FLOW_DISSECTOR_KEY_VLAN))) {
+		NL_SET_ERR_MSG_MOD(extack, "Unsupported keys used");
+		return -EOPNOTSUPP;
+	}
+
+	if (!flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_ETH_ADDRS) ||
+	    !flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_VLAN)) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Streams are identified by destination MAC and VLAN ID");
+		return -EOPNOTSUPP;
+	}
+
+	/* The CAM is keyed on the destination MAC and the VLAN ID only */
+	flow_rule_match_eth_addrs(rule, &eth);
+	if (!is_broadcast_ether_addr(eth.mask->dst) ||
+	    !is_zero_ether_addr(eth.mask->src)) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Only exact destination MAC matches are supported");
+		return -EOPNOTSUPP;
+	}
+
+	flow_rule_match_vlan(rule, &vlan);
+	if (vlan.mask->vlan_id != VLAN_VID_MASK || vlan.mask->vlan_priority) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Only exact VLAN ID matches are supported");
+		return -EOPNOTSUPP;
+	}
+
+	ether_addr_copy(s->cam.dest_addr, eth.key->dst);
+	s->cam.vlanid = vlan.key->vlan_id;
+	s->cam.tv_vlanid = vlan.key->vlan_id;
+
+	return 0;
+}
+
+static int xlnx_sw_flower_parse_gate(const struct flow_action_entry *act,
+				     struct xlnx_sw_stream *s,
+				     struct netlink_ext_ack *extack)
+{
+	const struct action_gate_entry *entry = act->gate.entries;
+	s32 ipv;
+
+	/* Stream gates follow the Qbv schedule of the egress port */
+	if (act->gate.num_entries != 1) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Only a single always-open or closed gate entry is supported");
+		return -EOPNOTSUPP;
+	}
+
+	s->allow = entry->gate_state;
+
+	ipv = entry->ipv >= 0 ? entry->ipv : act->gate.prio;
+	if (ipv >= 0) {
+		s->cam.ipv = ipv;
+		s->cam.flags |= XAS_CAM_IPV_EN;
+	}
+
+	if (entry->maxoctets >= 0) {
+		if (entry->maxoctets > XLNX_SW_MAX_FR_SIZE) {
+			NL_SET_ERR_MSG_MOD(extack, "Maximum SDU size too large");
+			return -EINVAL;
+		}
+		s->max_fr_size = entry->maxoctets;
+	}
+
+	return 0;
+}
+
+static int xlnx_sw_flower_parse_police(const struct flow_action_entry *act,
+				       struct xlnx_sw_stream *s,
+				       struct netlink_ext_ack *extack)
+{
+	if (act->police.exceed.act_id != FLOW_ACTION_DROP ||
+	    (act->police.notexceed.act_id != FLOW_ACTION_PIPE &&
+	     act->police.notexceed.act_id != FLOW_ACTION_ACCEPT)) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Police actions must be conform-exceed drop/pipe");
+		return -EOPNOTSUPP;
+	}
+
+	if (act->police.rate_pkt_ps || act->police.avrate ||
+	    act->police.overhead) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Only byte rate and burst policing is supported");
+		return -EOPNOTSUPP;
+	}
+
+	/* Metering rates are in bytes per second, bursts in bytes */
+	s->meter.cir = min_t(u64, act->police.rate_bytes_ps, U32_MAX);
+	s->meter.cbr = min_t(u32, act->police.burst, XLNX_SW_MAX_BURST);
+	s->meter.eir = min_t(u64, act->police.peakrate_bytes_ps, U32_MAX);
+	s->meter.ebr = s->meter.eir ? s->meter.cbr : 0;
+	s->en_meter = true;
+
+	return 0;
+}
+
+static int xlnx_sw_flower_parse_actions(struct axienet_local *lp,
+					struct flow_rule *rule,
+					struct xlnx_sw_stream *s,
+					struct netlink_ext_ack *extack)
+{
+	const struct flow_action_entry *act;
+	struct axienet_local *egress;
+	int i, err;
+
+	if (!flow_action_basic_hw_stats_check(&rule->action, extack))
+		return -EOPNOTSUPP;
+
+	flow_action_for_each(i, act, &rule->action) {
+		switch (act->id) {
+		case FLOW_ACTION_GATE:
+			err = xlnx_sw_flower_parse_gate(act, s, extack);
+			if (err)
+				return err;
+			break;
+		case FLOW_ACTION_POLICE:
+			err = xlnx_sw_flower_parse_police(act, s, extack);
+			if (err)
+				return err;
+			break;
+		case FLOW_ACTION_DROP:
+			s->allow = false;
+			break;
+		case FLOW_ACTION_REDIRECT:
+		case FLOW_ACTION_MIRRED:
+			if (!netdev_port_same_parent_id(lp->ndev, act->dev)) {
+				NL_SET_ERR_MSG_MOD(extack,
+						   "Can only forward to ports of the same switch");
+				return -EOPNOTSUPP;
+			}
+			egress = netdev_priv(act->dev);
+			s->cam.fwd_port |= egress->switch_prt;
+			break;
+		default:
+			NL_SET_ERR_MSG_MOD(extack, "Unsupported action");
+			return -EOPNOTSUPP;
+		}
+	}
+
+	if (s->allow && !s->cam.fwd_port) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Forwarded streams need a redirect or mirred action");
+		return -EOPNOTSUPP;
+	}
+
+	/* Forwarding a stream to both MAC ports splits it for FRER */
+	if ((s->cam.fwd_port & (PORT_MAC1 | PORT_MAC2)) ==
+	    (PORT_MAC1 | PORT_MAC2)) {
+		if (!IS_ENABLED(CONFIG_XILINX_TSN_CB)) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "Stream replication needs FRER support");
+			return -EOPNOTSUPP;
+		}
+		s->frer = true;
+	}
+
+	return 0;
+}
+
+static void xlnx_sw_stream_program(struct xlnx_sw_stream *s, bool enable)
+{
+	struct stream_filter filter = {
+		/* The port ids of the filter are the switch_prt bit numbers */
+		.in_pid = ilog2(s->lp->switch_prt),
+		.max_fr_size = s->max_fr_size,
+	};
+	struct psfp_config psfp = {
+		.gate_id = s->cam.gate_id,
+		.meter_id = s->cam.gate_id,
+		.en_meter = enable && s->en_meter,
+		.allow_stream = enable && s->allow,
+		.en_psfp = enable,
+		.op_type = XLNX_SW_CTRL_OP_WRITE,
+	};
+
+	if (s->en_meter) {
+		program_meter_reg(s->meter);
+		psfp.wr_op_type = XLNX_SW_PSFP_WR_METER;
+		psfp_control(psfp);
+	}
+
+	config_stream_filter(filter);
+	psfp.wr_op_type = XLNX_SW_PSFP_WR_FILTER;
+	psfp_control(psfp);
+
+#if IS_ENABLED(CONFIG_XILINX_TSN_CB)
+	if (s->frer) {
+		struct cb cb;
+
+		memset(&cb, 0, sizeof(cb));
+		cb.frer_memb_config_data.split_strm_egport_id =
+			ilog2(PORT_MAC2);
+		cb.frer_memb_config_data.split_strm_vlan_id = s->cam.vlanid;
+		cb.in_fltr_data.max_seq_id = U16_MAX;
+		program_member_reg(cb);
+
+		cb.frer_ctrl_data.gate_id = s->cam.gate_id;
+		cb.frer_ctrl_data.memb_id = s->cam.gate_id;
+		cb.frer_ctrl_data.gate_state = enable;
+		cb.frer_ctrl_data.frer_valid = enable;
+		cb.frer_ctrl_data.wr_op_type = XLNX_SW_FRER_WR_MEMBER;
+		cb.frer_ctrl_data.op_type = XLNX_SW_CTRL_OP_WRITE;
+		frer_control(cb.frer_ctrl_data);
+	}
+#endif
+}
+
+static int xlnx_sw_flower_replace(struct axienet_local *lp,
+				  struct flow_cls_offload *f)
+{
+	struct flow_rule *rule = flow_cls_offload_flow_rule(f);
+	struct netlink_ext_ack *extack = f->common.extack;
+	struct xlnx_sw_stream *s;
+	int id, err;
+
+	if (f->common.chain_index) {
+		NL_SET_ERR_MSG_MOD(extack, "Only chain 0 is supported");
+		return -EOPNOTSUPP;
+	}
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return -ENOMEM;
+
+	s->cookie = f->cookie;
+	s->lp = lp;
+	s->allow = true;
+	s->max_fr_size = XLNX_SW_MAX_FR_SIZE;
+
+	err = xlnx_sw_flower_parse_key(rule, s, extack);
+	if (err)
+		goto err_free;
+
+	err = xlnx_sw_flower_parse_actions(lp, rule, s, extack);
+	if (err)
+		goto err_free;
+
+	mutex_lock(&xlnx_sw_streams_lock);
+	if (xlnx_sw_stream_find(lp, f->cookie)) {
+		err = -EEXIST;
+		goto err_unlock;
+	}
+
+	id = find_first_zero_bit(xlnx_sw_stream_ids, XLNX_SW_MAX_STREAMS);
+	if (id >= XLNX_SW_MAX_STREAMS) {
+		NL_SET_ERR_MSG_MOD(extack, "No free stream handle");
+		err = -ENOSPC;
+		goto err_unlock;
+	}
+	s->cam.gate_id = id;
+
+	/* Program the stream before steering the frames to it */
+	xlnx_sw_stream_program(s, true);
+	err = tsn_switch_cam_set(s->cam, true);
+	if (err) {
+		xlnx_sw_stream_program(s, false);
+		goto err_unlock;
+	}
+
+	set_bit(id, xlnx_sw_stream_ids);
+	list_add_tail(&s->list, &xlnx_sw_streams);
+	mutex_unlock(&xlnx_sw_streams_lock);
+
+	return 0;
+
+err_unlock:
+	mutex_unlock(&xlnx_sw_streams_lock);
+err_free:
+	kfree(s);
+	return err;
+}
+
+static int xlnx_sw_flower_destroy(struct axienet_local *lp,
+				  struct flow_cls_offload *f)
+{
+	struct xlnx_sw_stream *s;
+
+	mutex_lock(&xlnx_sw_streams_lock);
+	s = xlnx_sw_stream_find(lp, f->cookie);
+	if (!s) {
+		mutex_unlock(&xlnx_sw_streams_lock);
+		return -ENOENT;
+	}
+
+	tsn_switch_cam_set(s->cam, false);
+	xlnx_sw_stream_program(s, false);
+	clear_bit(s->cam.gate_id, xlnx_sw_stream_ids);
+	list_del(&s->list);
+	mutex_unlock(&xlnx_sw_streams_lock);
+
+	kfree(s);
+
+	return 0;
+}
+
+static u64 xlnx_sw_static_cntr(const struct static_cntr *cntr)
+{
+	return ((u64)cntr->msb << 32) | cntr->lsb;
+}
+
+static int xlnx_sw_flower_stats(struct axienet_local *lp,
+				struct flow_cls_offload *f)
+{
+	struct psfp_static_counter cnt;
+	struct xlnx_sw_stream *s;
+	u64 frames, drops;
+
+	mutex_lock(&xlnx_sw_streams_lock);
+	s = xlnx_sw_stream_find(lp, f->cookie);
+	if (!s) {
+		mutex_unlock(&xlnx_sw_streams_lock);
+		return -ENOENT;
+	}
+
+	memset(&cnt, 0, sizeof(cnt));
+	cnt.num = s->cam.gate_id;
+	get_psfp_static_counter(&cnt);
+
+	frames = xlnx_sw_static_cntr(&cnt.psfp_fr_count);
+	drops = xlnx_sw_static_cntr(&cnt.err_filter_ins_port) +
+		xlnx_sw_static_cntr(&cnt.err_filtr_sdu) +
+		xlnx_sw_static_cntr(&cnt.err_meter);
+
+	flow_stats_update(&f->stats, 0, frames - s->frames, drops - s->drops,
+			  jiffies, FLOW_ACTION_HW_STATS_IMMEDIATE);
+	s->frames = frames;
+	s->drops = drops;
+	mutex_unlock(&xlnx_sw_streams_lock);
+
+	return 0;
+}
+
+static int xlnx_sw_setup_tc_block_cb(enum tc_setup_type type, void *type_data,
+				     void *cb_priv)
+{
+	struct flow_cls_offload *f = type_data;
+	struct axienet_local *lp = cb_priv;
+
+	if (type != TC_SETUP_CLSFLOWER)
+		return -EOPNOTSUPP;
+
+	switch (f->command) {
+	case FLOW_CLS_REPLACE:
+		return xlnx_sw_flower_replace(lp, f);
+	case FLOW_CLS_DESTROY:
+		return xlnx_sw_flower_destroy(lp, f);
+	case FLOW_CLS_STATS:
+		return xlnx_sw_flower_stats(lp, f);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * xlnx_switchdev_setup_tc_block - ndo_setup_tc handler for TC_SETUP_BLOCK
+ * @ndev: switch port the block is bound to
+ * @type_data: struct flow_block_offload of the block
+ *
+ * Each ingress flower rule identifies a stream by its destination MAC and
+ * VLAN ID and is offloaded to a CAM entry pointing to a PSFP stream filter.
+ * The gate, police and drop actions configure the filter and its meter,
+ * redirect and mirred actions select the egress ports, forwarding to both
+ * MAC ports splits the stream for FRER.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int xlnx_switchdev_setup_tc_block(struct net_device *ndev, void *type_data)
+{
+	struct flow_block_offload *f = type_data;
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	return flow_block_cb_setup_simple(f, &xlnx_sw_block_cb_list,
+					  xlnx_sw_setup_tc_block_cb, lp, lp,
+					  true);
+}
+#endif
+
 int xlnx_switchdev_init(void)
 {
 	xlnx_sw_owq = alloc_ordered_workqueue("%s_ordered", WQ_MEM_RECLAIM,
@@ -362,13 +1033,28 @@ int xlnx_switchdev_init(void)
 	register_switchdev_notifier(&xlnx_switchdev_notifier);
 	register_switchdev_blocking_notifier(&xlnx_switchdev_blocking_notifier);
 
+	if (tsn_switch_hw_learning() && learn_sync_ms)
+		queue_delayed_work(xlnx_sw_owq, &xlnx_sw_learn_work,
+				   msecs_to_jiffies(learn_sync_ms));
+
 	return 0;
 }
 
 void xlnx_switchdev_remove(void)
 {
-	destroy_workqueue(xlnx_sw_owq);
+	struct xlnx_sw_learnt *l;
+	struct hlist_node *tmp;
+	int bkt;
+
 	unregister_switchdev_notifier(&xlnx_switchdev_notifier);
 	unregister_switchdev_blocking_notifier(&xlnx_switchdev_blocking_notifier);
+	cancel_delayed_work_sync(&xlnx_sw_learn_work);
+	/* Destroying the workqueue flushes the pending FDB updates */
+	destroy_workqueue(xlnx_sw_owq);
+
+	hash_for_each_safe(xlnx_sw_learnt, bkt, tmp, l, hash_link) {
+		hash_del(&l->hash_link);
+		kfree(l);
+	}
 }
 #endif
@@ -21,6 +21,8 @@
 #include <linux/of_irq.h>
 #include <linux/list.h>
 #include <linux/hash.h>
+#include <linux/module.h>
+#include <net/pkt_sched.h>
 #include "xilinx_axienet_tsn.h"
 #include "xilinx_tsn_tadma.h"
 
@@ -29,6 +31,11 @@
 
 /* This driver assumes the num_streams configured in HW is always 2^n */
 
+static uint launch_lead_us = 200;
+module_param(launch_lead_us, uint, 0644);
+MODULE_PARM_DESC(launch_lead_us,
+		 "Time before its launch time an ST frame is queued to TADMA, at least one schedule cycle (default: 200)");
+
 typedef u32 pm_entry_t;
 
 struct tadma_stream {
@@ -183,6 +190,10 @@ static irqreturn_t tadma_irq(int irq, void *_ndev)
 	}
 	netif_tx_wake_all_queues(_ndev);
 
+	/* Retry launch time frames that found their stream ring full */
+	if (READ_ONCE(lp->tadma_etf_len))
+		hrtimer_start(&lp->tadma_etf_timer, 0, HRTIMER_MODE_ABS_SOFT);
+
 	return IRQ_HANDLED;
 }
 
@@ -257,11 +268,16 @@ static int tadma_sfm_init(struct net_device *ndev)
 	return 0;
 }
 
+static void tadma_etf_purge(struct net_device *ndev);
+static enum hrtimer_restart tadma_etf_timer(struct hrtimer *timer);
+
 int axienet_tadma_stop(struct net_device *ndev)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
 	u8 i = 0;
 
+	tadma_etf_purge(ndev);
+
 	for (i = 0; i < lp->num_streams ; i++)
 		kfree(lp->tx_bd[i]);
 
@@ -366,6 +382,10 @@ int __maybe_unused axienet_tadma_probe(struct platform_device *pdev,
 		 tadma_hash_bits);
 	pr_info("TADMA probe done\n");
 	spin_lock_init(&lp->tadma_tx_lock);
+	spin_lock_init(&lp->tadma_etf_lock);
+	lp->tadma_etf_queue = RB_ROOT_CACHED;
+	hrtimer_init(&lp->tadma_etf_timer, CLOCK_TAI, HRTIMER_MODE_ABS_SOFT);
+	lp->tadma_etf_timer.function = tadma_etf_timer;
 	of_node_put(np);
 
 	return 0;
@@ -444,8 +464,8 @@ static u32 tadma_stream_alm_offset(int sid, u32 wr, struct net_device *ndev)
 	return alm_offset + (wr * sizeof(struct alm_entry));
 }
 
-int axienet_tadma_xmit(struct sk_buff *skb, struct net_device *ndev,
-		       u16 queue_type)
+static int tadma_xmit_frame(struct sk_buff *skb, struct net_device *ndev,
+			    u16 queue_type)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
 	struct alm_entry alm, alm_fframe = {0};
@@ -590,6 +610,182 @@ int axienet_tadma_xmit(struct sk_buff *skb, struct net_device *ndev,
 	return NETDEV_TX_OK;
 }
 
+/* Called with tadma_etf_lock held */
+static void tadma_etf_insert(struct axienet_local *lp, struct sk_buff *skb)
+{
+	struct rb_node **p = &lp->tadma_etf_queue.rb_root.rb_node;
+	struct rb_node *parent = NULL;
+	bool leftmost = true;
+
+	while (*p) {
+		parent = *p;
+		if (ktime_compare(skb->tstamp, rb_to_skb(parent)->tstamp) >= 0) {
+			p = &parent->rb_right;
+			leftmost = false;
+		} else {
+			p = &parent->rb_left;
+		}
+	}
+
+	rb_link_node(&skb->rbnode, parent, p);
+	rb_insert_color_cached(&skb->rbnode, &lp->tadma_etf_queue, leftmost);
+	lp->tadma_etf_len++;
+}
+
+/* Called with tadma_etf_lock held */
+static struct sk_buff *tadma_etf_remove_first(struct axienet_local *lp)
+{
+	struct rb_node *p = rb_first_cached(&lp->tadma_etf_queue);
+	struct sk_buff *skb;
+
+	if (!p)
+		return NULL;
+
+	skb = rb_to_skb(p);
+	rb_erase_cached(p, &lp->tadma_etf_queue);
+	/* The rbnode overlaps the device pointer of the skb */
+	skb->dev = lp->ndev;
+	lp->tadma_etf_len--;
+
+	return skb;
+}
+
+/* Called with tadma_etf_lock held */
+static void tadma_etf_arm(struct axienet_local *lp)
+{
+	struct rb_node *p = rb_first_cached(&lp->tadma_etf_queue);
+	ktime_t expires;
+
+	if (!p)
+		return;
+
+	expires = ktime_sub_us(rb_to_skb(p)->tstamp, launch_lead_us);
+	hrtimer_start(&lp->tadma_etf_timer, expires, HRTIMER_MODE_ABS_SOFT);
+}
+
+/*
+ * TADMA fetches the frames of a stream in order at the trigger times of its
+ * fetch entries. A frame handed to TADMA less than a schedule cycle before
+ * its launch time is therefore sent in the first slot of its stream that
+ * follows, and the frames are held here until then.
+ */
+static enum hrtimer_restart tadma_etf_timer(struct hrtimer *timer)
+{
+	struct axienet_local *lp = container_of(timer, struct axienet_local,
+						tadma_etf_timer);
+	struct net_device *ndev = lp->ndev;
+	struct sk_buff *skb;
+	unsigned long flags;
+	ktime_t release;
+	bool busy = false;
+
+	release = ktime_add_us(ktime_get_clocktai(), launch_lead_us);
+
+	spin_lock_irqsave(&lp->tadma_etf_lock, flags);
+	while ((skb = tadma_etf_remove_first(lp))) {
+		if (ktime_after(skb->tstamp, release)) {
+			tadma_etf_insert(lp, skb);
+			break;
+		}
+
+		if (tadma_xmit_frame(skb, ndev, ST_QUEUE_NUMBER) ==
+		    NETDEV_TX_BUSY) {
+			/* The TADMA interrupt retries once the ring drains */
+			tadma_etf_insert(lp, skb);
+			busy = true;
+			break;
+		}
+	}
+
+	if (!busy)
+		tadma_etf_arm(lp);
+	if (lp->tadma_etf_len < lp->num_tadma_buffers &&
+	    __netif_subqueue_stopped(ndev, ST_QUEUE_NUMBER))
+		netif_wake_subqueue(ndev, ST_QUEUE_NUMBER);
+	spin_unlock_irqrestore(&lp->tadma_etf_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+static int tadma_etf_enqueue(struct sk_buff *skb, struct net_device *ndev,
+			     u16 queue_type)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	unsigned long flags;
+
+	/* Drop the frames that missed their launch time, as etf does */
+	if (ktime_before(skb->tstamp, ktime_get_clocktai())) {
+		ndev->stats.tx_dropped++;
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+
+	spin_lock_irqsave(&lp->tadma_etf_lock, flags);
+	tadma_etf_insert(lp, skb);
+	if (rb_first_cached(&lp->tadma_etf_queue) == &skb->rbnode)
+		tadma_etf_arm(lp);
+	/* Bound the frames held back to what a stream ring can take */
+	if (lp->tadma_etf_len >= lp->num_tadma_buffers)
+		netif_stop_subqueue(ndev, queue_type);
+	spin_unlock_irqrestore(&lp->tadma_etf_lock, flags);
+
+	return NETDEV_TX_OK;
+}
+
+static void tadma_etf_purge(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	hrtimer_cancel(&lp->tadma_etf_timer);
+
+	spin_lock_irqsave(&lp->tadma_etf_lock, flags);
+	while ((skb = tadma_etf_remove_first(lp))) {
+		ndev->stats.tx_dropped++;
+		dev_kfree_skb_any(skb);
+	}
+	spin_unlock_irqrestore(&lp->tadma_etf_lock, flags);
+}
+
+int axienet_tadma_xmit(struct sk_buff *skb, struct net_device *ndev,
+		       u16 queue_type)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (READ_ONCE(lp->tadma_etf) && skb->tstamp)
+		return tadma_etf_enqueue(skb, ndev, queue_type);
+
+	return tadma_xmit_frame(skb, ndev, queue_type);
+}
+
+/**
+ * axienet_tadma_setup_etf - ndo_setup_tc handler for TC_SETUP_QDISC_ETF
+ * @ndev: Pointer to the net_device structure
+ * @type_data: struct tc_etf_qopt_offload of the etf qdisc
+ *
+ * With the offload enabled, the ST frames carrying a launch time are held
+ * in the driver and given to TADMA in the schedule cycle of their launch
+ * time. The launch time is in CLOCK_TAI, which must be synchronised to the
+ * PTP clock of the TSN IP.
+ *
+ * Return: 0 on success, -EOPNOTSUPP for queues not served by TADMA
+ */
+int axienet_tadma_setup_etf(struct net_device *ndev, void *type_data)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct tc_etf_qopt_offload *qopt = type_data;
+
+	if (qopt->queue != ST_QUEUE_NUMBER)
+		return -EOPNOTSUPP;
+
+	WRITE_ONCE(lp->tadma_etf, qopt->enable);
+	if (!qopt->enable)
+		tadma_etf_purge(ndev);
+
+	return 0;
+}
+
 int axienet_tadma_program(struct net_device *ndev, void __user *useraddr)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
@@ -15,10 +15,13 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
 #include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 #include <uapi/linux/xlnx_mpg2tsmux_interface.h>
 
 #define DRIVER_NAME "mpegtsmux-1.0"
@@ -178,6 +181,7 @@ enum mux_op_errs {
  * @error_code: error status of mux node updated by IP
  * @mux_phy_addr: physical address of muxer
  * @node: struct of linked list head
+ * @dmabuf_id: 0 for buf allocated by driver, nonzero for external buf
  */
 struct muxer_context {
 	enum node_status_info node_status;
@@ -189,6 +193,7 @@ struct muxer_context {
 	enum mux_op_errs error_code;
 	u64 mux_phy_addr;
 	struct list_head node;
+	u16 dmabuf_id;
 };
 
 /**
@@ -199,6 +204,12 @@ struct muxer_context {
  * @dmabuf_addr: buffer physical address
  * @dmabuf_fd: dma buffer fd
  * @buf_id: dma buffer reference id
+ * @users: number of queued descriptors using the buffer, protected by the
+ *	   device lock
+ *
+ * Imported buffers stay mapped until they are released explicitly, the
+ * table runs out of free entries or the device is closed, so that the
+ * encoder output buffers cycling through the muxer are mapped only once.
  */
 struct xlnx_tsmux_dmabufintl {
 	struct dma_buf *dbuf;
@@ -207,6 +218,7 @@ struct xlnx_tsmux_dmabufintl {
 	dma_addr_t dmabuf_addr;
 	s32 dmabuf_fd;
 	u16 buf_id;
+	u32 users;
 };
 
 /**
@@ -240,6 +252,7 @@ struct xlnx_tsmux_dmabufintl {
  * @intn_strmtbl_addrs: physical address of streamid table for internal
  * @intn_strmtbl_kaddrs: kernel VA for streamid table for internal
  * @ap_clk: interface clock
+ * @dmabuf_lock: serializes import and release of the DMA bufs
  * @src_dmabufintl: array of src DMA buf allocated by user
  * @dst_dmabufintl: array of src DMA buf allocated by user
  * @outbuf_written: size in bytes written in output buffer
@@ -276,6 +289,8 @@ struct xlnx_tsmux {
 	dma_addr_t intn_strmtbl_addrs;
 	void *intn_strmtbl_kaddrs;
 	struct clk *ap_clk;
+	/* dmabuf_lock serializes import and release of the DMA bufs */
+	struct mutex dmabuf_lock;
 	struct xlnx_tsmux_dmabufintl src_dmabufintl[XTSMUX_MAXIN_STRM];
 	struct xlnx_tsmux_dmabufintl dst_dmabufintl[XTSMUX_MAXOUT_STRM];
 	s32 outbuf_written;
@@ -369,6 +384,128 @@ static struct class *xlnx_tsmux_class;
 static dev_t xlnx_tsmux_devt;
 static atomic_t xlnx_tsmux_ndevs = ATOMIC_INIT(0);
 
+static struct xlnx_tsmux_dmabufintl *
+xlnx_tsmux_dmabuf_table(struct xlnx_tsmux *mpgmuxts,
+			enum xlnx_tsmux_dma_dir dir, unsigned int *num)
+{
+	if (dir == DMA_TO_MPG2MUX) {
+		*num = XTSMUX_MAXIN_STRM;
+		return mpgmuxts->src_dmabufintl;
+	}
+
+	*num = XTSMUX_MAXOUT_STRM;
+	return mpgmuxts->dst_dmabufintl;
+}
+
+/* Must be called with dmabuf_lock held */
+static struct xlnx_tsmux_dmabufintl *
+xlnx_tsmux_find_dmabuf(struct xlnx_tsmux_dmabufintl *intl_dmabuf,
+		       unsigned int num, struct dma_buf *dbuf)
+{
+	unsigned int i;
+
+	for (i = 0; i < num; i++)
+		if (intl_dmabuf[i].buf_id && intl_dmabuf[i].dbuf == dbuf)
+			return &intl_dmabuf[i];
+
+	return NULL;
+}
+
+/* Must be called with dmabuf_lock held, on a buffer without users */
+static void xlnx_tsmux_free_dmabufintl(struct xlnx_tsmux_dmabufintl
+				       *intl_dmabuf,
+				       enum xlnx_tsmux_dma_dir dir)
+{
+	if (!intl_dmabuf->buf_id)
+		return;
+
+	dma_buf_unmap_attachment(intl_dmabuf->attach, intl_dmabuf->sgt,
+				 (enum dma_data_direction)dir);
+	dma_buf_detach(intl_dmabuf->dbuf, intl_dmabuf->attach);
+	dma_buf_put(intl_dmabuf->dbuf);
+	intl_dmabuf->dmabuf_fd = 0;
+	intl_dmabuf->buf_id = 0;
+}
+
+static bool xlnx_tsmux_dmabuf_busy(struct xlnx_tsmux *mpgmuxts,
+				   struct xlnx_tsmux_dmabufintl *intl_dmabuf)
+{
+	unsigned long flags;
+	bool busy;
+
+	spin_lock_irqsave(&mpgmuxts->lock, flags);
+	busy = intl_dmabuf->users;
+	spin_unlock_irqrestore(&mpgmuxts->lock, flags);
+
+	return busy;
+}
+
+/**
+ * xlnx_tsmux_get_dmabuf - Look up an imported DMA buf for a descriptor
+ * @mpgmuxts: pointer to the device structure
+ * @dir: direction of the DMA buf
+ * @fd: DMA buf file descriptor
+ *
+ * The buffer is looked up by the dma_buf the fd refers to, and counted as
+ * used until xlnx_tsmux_put_dmabuf() or the completion of the descriptor.
+ *
+ * Return: the imported buffer, or NULL if @fd was not imported
+ */
+static struct xlnx_tsmux_dmabufintl *
+xlnx_tsmux_get_dmabuf(struct xlnx_tsmux *mpgmuxts,
+		      enum xlnx_tsmux_dma_dir dir, s32 fd)
+{
+	struct xlnx_tsmux_dmabufintl *intl_dmabuf, *table;
+	struct dma_buf *dbuf;
+	unsigned long flags;
+	unsigned int num;
+
+	dbuf = dma_buf_get(fd);
+	if (IS_ERR(dbuf))
+		return NULL;
+
+	table = xlnx_tsmux_dmabuf_table(mpgmuxts, dir, &num);
+	mutex_lock(&mpgmuxts->dmabuf_lock);
+	intl_dmabuf = xlnx_tsmux_find_dmabuf(table, num, dbuf);
+	if (intl_dmabuf) {
+		spin_lock_irqsave(&mpgmuxts->lock, flags);
+		intl_dmabuf->users++;
+		spin_unlock_irqrestore(&mpgmuxts->lock, flags);
+	}
+	mutex_unlock(&mpgmuxts->dmabuf_lock);
+	dma_buf_put(dbuf);
+
+	return intl_dmabuf;
+}
+
+static void xlnx_tsmux_put_dmabuf(struct xlnx_tsmux *mpgmuxts,
+				  struct xlnx_tsmux_dmabufintl *intl_dmabuf)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mpgmuxts->lock, flags);
+	intl_dmabuf->users--;
+	spin_unlock_irqrestore(&mpgmuxts->lock, flags);
+}
+
+static void xlnx_tsmux_release_dmabufs(struct xlnx_tsmux *mpgmuxts)
+{
+	unsigned int i;
+
+	mutex_lock(&mpgmuxts->dmabuf_lock);
+	for (i = 0; i < XTSMUX_MAXIN_STRM; i++)
+		if (!xlnx_tsmux_dmabuf_busy(mpgmuxts,
+					    &mpgmuxts->src_dmabufintl[i]))
+			xlnx_tsmux_free_dmabufintl(&mpgmuxts->src_dmabufintl[i],
+						   DMA_TO_MPG2MUX);
+	for (i = 0; i < XTSMUX_MAXOUT_STRM; i++)
+		if (!xlnx_tsmux_dmabuf_busy(mpgmuxts,
+					    &mpgmuxts->dst_dmabufintl[i]))
+			xlnx_tsmux_free_dmabufintl(&mpgmuxts->dst_dmabufintl[i],
+						   DMA_FROM_MPG2MUX);
+	mutex_unlock(&mpgmuxts->dmabuf_lock);
+}
+
 static int xlnx_tsmux_open(struct inode *pin, struct file *fptr)
 {
 	struct xlnx_tsmux *mpgtsmux;
@@ -390,6 +527,9 @@ static int xlnx_tsmux_release(struct inode *pin, struct file *fptr)
 	if (!mpgtsmux)
 		return -EIO;
 
+	if (atomic_dec_and_test(&mpgtsmux->user_count))
+		xlnx_tsmux_release_dmabufs(mpgtsmux);
+
 	return 0;
 }
 
@@ -675,15 +815,33 @@ static int xlnx_tsmux_ioctl_update_strmtbl(struct xlnx_tsmux *mpgmuxts,
 	return xlnx_tsmux_update_strminfo_table(mpgmuxts, new_strm_info);
 }
 
-static int xlnx_tsmux_enqueue_stream_context(struct xlnx_tsmux *mpgmuxts,
-					     struct
-					     stream_context_in * stream_data)
+static void xlnx_tsmux_free_stream_node(struct xlnx_tsmux *mpgmuxts,
+					struct stream_context_node *strm_node)
+{
+	u16 dmabuf_id = strm_node->element.dmabuf_id;
+
+	if (dmabuf_id)
+		xlnx_tsmux_put_dmabuf(mpgmuxts,
+				      &mpgmuxts->src_dmabufintl[dmabuf_id - 1]);
+	dma_pool_free(mpgmuxts->strm_ctx_pool, strm_node,
+		      strm_node->strm_phy_addr);
+}
+
+static struct stream_context_node *
+xlnx_tsmux_alloc_stream_node(struct xlnx_tsmux *mpgmuxts,
+			     const struct stream_context_in *stream_data)
 {
-	struct stream_context_node *new_strm_node, *prev_strm_node;
+	struct stream_context_node *new_strm_node;
+	struct xlnx_tsmux_dmabufintl *intl_dmabuf;
 	void *kaddr_strm_node;
 	dma_addr_t strm_phy_addr;
-	unsigned long flags;
-	u32 i;
+
+	if (!stream_data->is_dmabuf &&
+	    stream_data->srcbuf_id >= mpgmuxts->num_inbuf) {
+		dev_err(mpgmuxts->dev, "No source buffer with %d",
+			stream_data->srcbuf_id);
+		return ERR_PTR(-EINVAL);
+	}
 
 	kaddr_strm_node = dma_pool_alloc(mpgmuxts->strm_ctx_pool,
 					 GFP_KERNEL | GFP_DMA32,
@@ -691,7 +849,7 @@ static int xlnx_tsmux_enqueue_stream_context(struct xlnx_tsmux *mpgmuxts,
 
 	new_strm_node = (struct stream_context_node *)kaddr_strm_node;
 	if (!new_strm_node)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	/* update the stream context node */
 	wmb();
@@ -714,33 +872,54 @@ static int xlnx_tsmux_enqueue_stream_context(struct xlnx_tsmux *mpgmuxts,
 			mpgmuxts->srcbuf_addrs[stream_data->srcbuf_id];
 		new_strm_node->element.dmabuf_id = 0;
 	} else {
-		for (i = 0; i < XTSMUX_MAXIN_STRM; i++) {
-			/* Serching dma buf info based on srcbuf_id */
-			if (stream_data->srcbuf_id ==
-					mpgmuxts->src_dmabufintl[i].dmabuf_fd) {
-				new_strm_node->element.in_buf_pointer =
-					mpgmuxts->src_dmabufintl[i].dmabuf_addr;
-				new_strm_node->element.dmabuf_id =
-					mpgmuxts->src_dmabufintl[i].buf_id;
-				break;
-			}
-		}
-
+		/* Serching dma buf info based on srcbuf_id */
+		intl_dmabuf = xlnx_tsmux_get_dmabuf(mpgmuxts, DMA_TO_MPG2MUX,
+						    stream_data->srcbuf_id);
 		/* No dma buf found with srcbuf_id*/
-		if (i == XTSMUX_MAXIN_STRM) {
+		if (!intl_dmabuf) {
 			dev_err(mpgmuxts->dev, "No DMA buffer with %d",
 				stream_data->srcbuf_id);
-			return -ENOMEM;
+			dma_pool_free(mpgmuxts->strm_ctx_pool, new_strm_node,
+				      strm_phy_addr);
+			return ERR_PTR(-ENOMEM);
 		}
+
+		new_strm_node->element.in_buf_pointer =
+			intl_dmabuf->dmabuf_addr;
+		new_strm_node->element.dmabuf_id = intl_dmabuf->buf_id;
 	}
 
 	new_strm_node->strm_phy_addr = (u64)strm_phy_addr;
-	new_strm_node->node_number = mpgmuxts->stcxt_node_cnt + 1;
-	mpgmuxts->stcxt_node_cnt++;
 	new_strm_node->node_status = UPDATED_BY_DRIVER;
 	new_strm_node->error_code = NO_ERROR;
 	new_strm_node->tail_pointer = 0;
 
+	return new_strm_node;
+}
+
+/**
+ * xlnx_tsmux_queue_stream_nodes - append stream nodes to the stream list
+ * @mpgmuxts: pointer to the device structure
+ * @nodes: list of stream nodes to append, emptied on return
+ * @count: number of nodes in @nodes
+ *
+ * The nodes are chained to each other before the whole batch is linked
+ * to the last node of the stream list under a single lock acquisition.
+ */
+static void xlnx_tsmux_queue_stream_nodes(struct xlnx_tsmux *mpgmuxts,
+					  struct list_head *nodes,
+					  unsigned int count)
+{
+	struct stream_context_node *strm_node, *prev_strm_node;
+	unsigned long flags;
+
+	list_for_each_entry(strm_node, nodes, node) {
+		strm_node->node_number = ++mpgmuxts->stcxt_node_cnt;
+		if (!list_is_last(&strm_node->node, nodes))
+			strm_node->tail_pointer =
+				list_next_entry(strm_node, node)->strm_phy_addr;
+	}
+
 	spin_lock_irqsave(&mpgmuxts->lock, flags);
 	/* If it is not first stream in stream node linked list find
 	 * physical address of current node and add to last node in list
@@ -749,13 +928,30 @@ static int xlnx_tsmux_enqueue_stream_context(struct xlnx_tsmux *mpgmuxts,
 		prev_strm_node = list_last_entry(&mpgmuxts->strm_node,
 						 struct stream_context_node,
 						 node);
-		prev_strm_node->tail_pointer = new_strm_node->strm_phy_addr;
+		prev_strm_node->tail_pointer =
+			list_first_entry(nodes, struct stream_context_node,
+					 node)->strm_phy_addr;
 	}
 	/* update the list and stream count */
 	wmb();
-	list_add_tail(&new_strm_node->node, &mpgmuxts->strm_node);
-	atomic_inc(&mpgmuxts->stream_count);
+	list_splice_tail_init(nodes, &mpgmuxts->strm_node);
+	atomic_add(count, &mpgmuxts->stream_count);
 	spin_unlock_irqrestore(&mpgmuxts->lock, flags);
+}
+
+static int xlnx_tsmux_enqueue_stream_context(struct xlnx_tsmux *mpgmuxts,
+					     struct
+					     stream_context_in * stream_data)
+{
+	struct stream_context_node *new_strm_node;
+	LIST_HEAD(nodes);
+
+	new_strm_node = xlnx_tsmux_alloc_stream_node(mpgmuxts, stream_data);
+	if (IS_ERR(new_strm_node))
+		return PTR_ERR(new_strm_node);
+
+	list_add_tail(&new_strm_node->node, &nodes);
+	xlnx_tsmux_queue_stream_nodes(mpgmuxts, &nodes, 1);
 
 	return 0;
 }
@@ -785,6 +981,68 @@ static int xlnx_tsmux_set_stream_desc(struct xlnx_tsmux *mpgmuxts,
 	return ret;
 }
 
+/**
+ * xlnx_tsmux_ioctl_set_stream_batch - enqueue several stream descriptors
+ * @mpgmuxts: pointer to the device structure
+ * @arg: user pointer to a struct stream_context_batch
+ *
+ * Either all the descriptors of the batch are queued or none is.
+ *
+ * Return: 0 on success and error value on failure.
+ */
+static int xlnx_tsmux_ioctl_set_stream_batch(struct xlnx_tsmux *mpgmuxts,
+					     void __user *arg)
+{
+	struct stream_context_node *strm_node, *tmp;
+	struct stream_context_in *stream_data;
+	struct stream_context_batch batch;
+	LIST_HEAD(nodes);
+	unsigned int i;
+	int ret = 0;
+
+	if (copy_from_user(&batch, arg, sizeof(batch))) {
+		dev_err(mpgmuxts->dev, "Failed to copy stream batch from user");
+		return -EFAULT;
+	}
+
+	if (batch.reserved || !batch.num_streams ||
+	    batch.num_streams > XTSMUX_MAXIN_TLSTRM) {
+		dev_err(mpgmuxts->dev, "Invalid stream batch size %u",
+			batch.num_streams);
+		return -EINVAL;
+	}
+
+	stream_data = memdup_user(u64_to_user_ptr(batch.streams),
+				  array_size(batch.num_streams,
+					     sizeof(*stream_data)));
+	if (IS_ERR(stream_data))
+		return PTR_ERR(stream_data);
+
+	for (i = 0; i < batch.num_streams; i++) {
+		strm_node = xlnx_tsmux_alloc_stream_node(mpgmuxts,
+							 &stream_data[i]);
+		if (IS_ERR(strm_node)) {
+			ret = PTR_ERR(strm_node);
+			goto err_free_nodes;
+		}
+		list_add_tail(&strm_node->node, &nodes);
+	}
+
+	xlnx_tsmux_queue_stream_nodes(mpgmuxts, &nodes, batch.num_streams);
+	kfree(stream_data);
+
+	return 0;
+
+err_free_nodes:
+	list_for_each_entry_safe(strm_node, tmp, &nodes, node) {
+		list_del(&strm_node->node);
+		xlnx_tsmux_free_stream_node(mpgmuxts, strm_node);
+	}
+	kfree(stream_data);
+
+	return ret;
+}
+
 static int xlnx_tsmux_ioctl_set_stream_context(struct xlnx_tsmux *mpgmuxts,
 					       void __user *arg)
 {
@@ -924,12 +1182,12 @@ static int xlnx_tsmux_ioctl_get_outbufinfo(struct xlnx_tsmux *mpgmuxts,
 static int xlnx_tsmux_enqueue_mux_context(struct xlnx_tsmux *mpgmuxts,
 					  struct muxer_context_in *mux_data)
 {
+	struct xlnx_tsmux_dmabufintl *intl_dmabuf;
 	struct muxer_context *new_mux_node;
 	u32 out_index;
 	void *kaddr_mux_node;
 	dma_addr_t mux_phy_addr;
 	unsigned long flags;
-	s32 i;
 
 	kaddr_mux_node = dma_pool_alloc(mpgmuxts->mux_ctx_pool,
 					GFP_KERNEL | GFP_DMA32,
@@ -941,6 +1199,7 @@ static int xlnx_tsmux_enqueue_mux_context(struct xlnx_tsmux *mpgmuxts,
 
 	new_mux_node->node_status = UPDATED_BY_DRIVER;
 	new_mux_node->mux_phy_addr = (u64)mux_phy_addr;
+	new_mux_node->dmabuf_id = 0;
 
 	/* Check for external dma buffer */
 	if (!mux_data->is_dmabuf) {
@@ -953,20 +1212,18 @@ static int xlnx_tsmux_enqueue_mux_context(struct xlnx_tsmux *mpgmuxts,
 		else
 			atomic_set(&mpgmuxts->outbuf_idx, 1);
 	} else {
-		for (i = 0; i < XTSMUX_MAXOUT_STRM; i++) {
-			if (mux_data->dstbuf_id ==
-			   mpgmuxts->dst_dmabufintl[i].dmabuf_fd) {
-				new_mux_node->dst_buf_start_addr =
-					mpgmuxts->dst_dmabufintl[i].dmabuf_addr;
-				break;
-			}
-		}
-		if (i == XTSMUX_MAXOUT_STRM) {
+		intl_dmabuf = xlnx_tsmux_get_dmabuf(mpgmuxts, DMA_FROM_MPG2MUX,
+						    mux_data->dstbuf_id);
+		if (!intl_dmabuf) {
 			dev_err(mpgmuxts->dev, "No DMA buffer with %d",
 				mux_data->dstbuf_id);
+			dma_pool_free(mpgmuxts->mux_ctx_pool, new_mux_node,
+				      mux_phy_addr);
 			return -ENOMEM;
 		}
+		new_mux_node->dst_buf_start_addr = intl_dmabuf->dmabuf_addr;
 		new_mux_node->dst_buf_size = mux_data->dmabuf_size;
+		new_mux_node->dmabuf_id = intl_dmabuf->buf_id;
 	}
 	new_mux_node->error_code = MUXER_NO_ERROR;
 
@@ -994,7 +1251,7 @@ static int xlnx_tsmux_set_mux_desc(struct xlnx_tsmux *mpgmuxts,
 		goto kmem_free;
 	}
 
-	return xlnx_tsmux_enqueue_mux_context(mpgmuxts, mux_data);
+	ret = xlnx_tsmux_enqueue_mux_context(mpgmuxts, mux_data);
 
 kmem_free:
 	kfree(mux_data);
@@ -1017,10 +1274,12 @@ static int xlnx_tsmux_ioctl_set_mux_context(struct xlnx_tsmux *mpgmuxts,
 static int xlnx_tsmux_ioctl_verify_dmabuf(struct xlnx_tsmux *mpgmuxts,
 					  void __user *arg)
 {
+	struct xlnx_tsmux_dmabufintl *intl_dmabuf, *table;
 	struct dma_buf *dbuf;
 	struct dma_buf_attachment *attach;
 	struct sg_table *sgt;
 	struct xlnx_tsmux_dmabuf_info *dbuf_info;
+	unsigned int num;
 	s32 i;
 	int ret = 0;
 
@@ -1048,12 +1307,46 @@ static int xlnx_tsmux_ioctl_verify_dmabuf(struct xlnx_tsmux *mpgmuxts,
 		ret = PTR_ERR(dbuf);
 		goto dmak_free;
 	}
+
+	table = xlnx_tsmux_dmabuf_table(mpgmuxts, dbuf_info->dir, &num);
+	mutex_lock(&mpgmuxts->dmabuf_lock);
+
+	/* Buffers imported already are reused as they are */
+	intl_dmabuf = xlnx_tsmux_find_dmabuf(table, num, dbuf);
+	if (intl_dmabuf) {
+		intl_dmabuf->dmabuf_fd = dbuf_info->buf_fd;
+		mutex_unlock(&mpgmuxts->dmabuf_lock);
+		dma_buf_put(dbuf);
+		goto copy_flags;
+	}
+
+	/* Take a free entry, or else reclaim one no descriptor uses */
+	for (i = 0; i < num; i++)
+		if (!table[i].buf_id)
+			break;
+	if (i == num) {
+		for (i = 0; i < num; i++) {
+			if (!xlnx_tsmux_dmabuf_busy(mpgmuxts, &table[i])) {
+				xlnx_tsmux_free_dmabufintl(&table[i],
+							   dbuf_info->dir);
+				break;
+			}
+		}
+	}
+	/* External streams more than the table size can not be handled */
+	if (i == num) {
+		ret = -EIO;
+		dev_dbg(mpgmuxts->dev, "%s DMA bufs more than %d",
+			dbuf_info->dir == DMA_TO_MPG2MUX ? "src" : "dst", num);
+		goto err_unlock;
+	}
+
 	attach = dma_buf_attach(dbuf, mpgmuxts->dev);
 	if (IS_ERR(attach)) {
 		dev_err(mpgmuxts->dev, "dma_buf_attach fail fd %d dir %d",
 			dbuf_info->buf_fd, dbuf_info->dir);
 		ret = PTR_ERR(attach);
-		goto err_dmabuf_put;
+		goto err_unlock;
 	}
 	sgt = dma_buf_map_attachment(attach,
 				     (enum dma_data_direction)(dbuf_info->dir));
@@ -1066,6 +1359,7 @@ static int xlnx_tsmux_ioctl_verify_dmabuf(struct xlnx_tsmux *mpgmuxts,
 
 	if (sgt->nents > 1) {
 		ret = -EIO;
+		dbuf_info->flags = DMABUF_NON_CONTIG;
 		dev_dbg(mpgmuxts->dev, "Not contig nents %d fd %d direction %d",
 			sgt->nents, dbuf_info->buf_fd, dbuf_info->dir);
 		goto err_dmabuf_unmap_attachment;
@@ -1074,71 +1368,34 @@ static int xlnx_tsmux_ioctl_verify_dmabuf(struct xlnx_tsmux *mpgmuxts,
 		(dbuf_info->dir ==
 		 DMA_TO_MPG2MUX ? "Source" : "Destination"));
 
-	if (dbuf_info->dir == DMA_TO_MPG2MUX) {
-		for (i = 0; i < XTSMUX_MAXIN_STRM; i++) {
-			if (!mpgmuxts->src_dmabufintl[i].buf_id) {
-				mpgmuxts->src_dmabufintl[i].dbuf = dbuf;
-				mpgmuxts->src_dmabufintl[i].attach = attach;
-				mpgmuxts->src_dmabufintl[i].sgt = sgt;
-				mpgmuxts->src_dmabufintl[i].dmabuf_addr =
-						sg_dma_address(sgt->sgl);
-				mpgmuxts->src_dmabufintl[i].dmabuf_fd =
-							dbuf_info->buf_fd;
-				mpgmuxts->src_dmabufintl[i].buf_id = i + 1;
-				dev_dbg(mpgmuxts->dev,
-					"%s: phy-addr=0x%llx for src dmabuf=%d",
-					__func__,
-					mpgmuxts->src_dmabufintl[i].dmabuf_addr,
-					mpgmuxts->src_dmabufintl[i].dmabuf_fd);
-				break;
-			}
-		}
-		/* External src streams more than XTSMUX_MAXIN_STRM
-		 * can not be handled
-		 */
-		if (i == XTSMUX_MAXIN_STRM) {
-			ret = -EIO;
-			dev_dbg(mpgmuxts->dev, "src DMA bufs more than %d",
-				XTSMUX_MAXIN_STRM);
-			goto err_dmabuf_unmap_attachment;
-		}
-	} else {
-		for (i = 0; i < XTSMUX_MAXOUT_STRM; i++) {
-			if (!mpgmuxts->dst_dmabufintl[i].buf_id) {
-				mpgmuxts->dst_dmabufintl[i].dbuf = dbuf;
-				mpgmuxts->dst_dmabufintl[i].attach = attach;
-				mpgmuxts->dst_dmabufintl[i].sgt = sgt;
-				mpgmuxts->dst_dmabufintl[i].dmabuf_addr =
-						sg_dma_address(sgt->sgl);
-				mpgmuxts->dst_dmabufintl[i].dmabuf_fd =
-						dbuf_info->buf_fd;
-				mpgmuxts->dst_dmabufintl[i].buf_id = i + 1;
-				dev_dbg(mpgmuxts->dev,
-					"phy-addr=0x%llx for src dmabuf=%d",
-					mpgmuxts->dst_dmabufintl[i].dmabuf_addr,
-					mpgmuxts->dst_dmabufintl[i].dmabuf_fd);
-				break;
-			}
-		}
-		/* External dst streams more than XTSMUX_MAXOUT_STRM
-		 * can not be handled
-		 */
-		if (i == XTSMUX_MAXOUT_STRM) {
-			ret = -EIO;
-			dev_dbg(mpgmuxts->dev, "dst DMA bufs more than %d",
-				XTSMUX_MAXOUT_STRM);
-			goto err_dmabuf_unmap_attachment;
-		}
-	}
+	table[i].dbuf = dbuf;
+	table[i].attach = attach;
+	table[i].sgt = sgt;
+	table[i].dmabuf_addr = sg_dma_address(sgt->sgl);
+	table[i].dmabuf_fd = dbuf_info->buf_fd;
+	table[i].users = 0;
+	table[i].buf_id = i + 1;
+	dev_dbg(mpgmuxts->dev, "%s: phy-addr=0x%llx for %s dmabuf=%d",
+		__func__, table[i].dmabuf_addr,
+		dbuf_info->dir == DMA_TO_MPG2MUX ? "src" : "dst",
+		table[i].dmabuf_fd);
+	mutex_unlock(&mpgmuxts->dmabuf_lock);
+
+copy_flags:
+	dbuf_info->flags = DMABUF_CONTIG | DMABUF_ATTACHED;
+	if (copy_to_user(arg, dbuf_info, sizeof(*dbuf_info)))
+		ret = -EFAULT;
+	kfree(dbuf_info);
 
-	return 0;
+	return ret;
 
 err_dmabuf_unmap_attachment:
 	dma_buf_unmap_attachment(attach, sgt,
 				 (enum dma_data_direction)dbuf_info->dir);
 err_dmabuf_detach:
 	dma_buf_detach(dbuf, attach);
-err_dmabuf_put:
+err_unlock:
+	mutex_unlock(&mpgmuxts->dmabuf_lock);
 	dma_buf_put(dbuf);
 dmak_free:
 	kfree(dbuf_info);
@@ -1146,6 +1403,42 @@ static int xlnx_tsmux_ioctl_verify_dmabuf(struct xlnx_tsmux *mpgmuxts,
 	return ret;
 }
 
+static int xlnx_tsmux_ioctl_release_dmabuf(struct xlnx_tsmux *mpgmuxts,
+					   void __user *arg)
+{
+	struct xlnx_tsmux_dmabufintl *intl_dmabuf, *table;
+	struct xlnx_tsmux_dmabuf_info dbuf_info;
+	struct dma_buf *dbuf;
+	unsigned int num;
+	int ret = 0;
+
+	if (copy_from_user(&dbuf_info, arg, sizeof(dbuf_info))) {
+		dev_err(mpgmuxts->dev, "Failed to copy from user");
+		return -EFAULT;
+	}
+	if (dbuf_info.dir != DMA_TO_MPG2MUX &&
+	    dbuf_info.dir != DMA_FROM_MPG2MUX)
+		return -EINVAL;
+
+	dbuf = dma_buf_get(dbuf_info.buf_fd);
+	if (IS_ERR(dbuf))
+		return PTR_ERR(dbuf);
+
+	table = xlnx_tsmux_dmabuf_table(mpgmuxts, dbuf_info.dir, &num);
+	mutex_lock(&mpgmuxts->dmabuf_lock);
+	intl_dmabuf = xlnx_tsmux_find_dmabuf(table, num, dbuf);
+	if (!intl_dmabuf)
+		ret = -ENOENT;
+	else if (xlnx_tsmux_dmabuf_busy(mpgmuxts, intl_dmabuf))
+		ret = -EBUSY;
+	else
+		xlnx_tsmux_free_dmabufintl(intl_dmabuf, dbuf_info.dir);
+	mutex_unlock(&mpgmuxts->dmabuf_lock);
+	dma_buf_put(dbuf);
+
+	return ret;
+}
+
 static long xlnx_tsmux_ioctl(struct file *fptr,
 			     unsigned int cmd, unsigned long data)
 {
@@ -1201,6 +1494,12 @@ static long xlnx_tsmux_ioctl(struct file *fptr,
 	case MPG2MUX_VDBUF:
 		ret = xlnx_tsmux_ioctl_verify_dmabuf(mpgmuxts, arg);
 		break;
+	case MPG2MUX_RDBUF:
+		ret = xlnx_tsmux_ioctl_release_dmabuf(mpgmuxts, arg);
+		break;
+	case MPG2MUX_SETSTRMS:
+		ret = xlnx_tsmux_ioctl_set_stream_batch(mpgmuxts, arg);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -1279,23 +1578,6 @@ static const struct file_operations mpg2mux_fops = {
 	.poll = xlnx_tsmux_poll,
 };
 
-static void xlnx_tsmux_free_dmabufintl(struct xlnx_tsmux_dmabufintl
-				       *intl_dmabuf, u16 dmabuf_id,
-				       enum xlnx_tsmux_dma_dir dir)
-{
-	unsigned int i = dmabuf_id - 1;
-
-	if (intl_dmabuf[i].dmabuf_fd) {
-		dma_buf_unmap_attachment(intl_dmabuf[i].attach,
-					 intl_dmabuf[i].sgt,
-					 (enum dma_data_direction)dir);
-		dma_buf_detach(intl_dmabuf[i].dbuf, intl_dmabuf[i].attach);
-		dma_buf_put(intl_dmabuf[i].dbuf);
-		intl_dmabuf[i].dmabuf_fd = 0;
-		intl_dmabuf[i].buf_id = 0;
-	}
-}
-
 static int xlnx_tsmux_update_complete(struct xlnx_tsmux *mpgmuxts)
 {
 	struct stream_context_node *tstrm_node;
@@ -1317,11 +1599,10 @@ static int xlnx_tsmux_update_complete(struct xlnx_tsmux *mpgmuxts)
 					 struct stream_context_node, node);
 		list_del(&tstrm_node->node);
 		atomic_dec(&mpgmuxts->stream_count);
+		/* The buffer stays mapped for the next descriptors */
 		if (tstrm_node->element.dmabuf_id)
-			xlnx_tsmux_free_dmabufintl
-				(mpgmuxts->src_dmabufintl,
-				 tstrm_node->element.dmabuf_id,
-				 DMA_TO_MPG2MUX);
+			mpgmuxts->src_dmabufintl[tstrm_node->element.dmabuf_id -
+						 1].users--;
 		if (tstrm_node->node_number == num_strm_node) {
 			dma_pool_free(mpgmuxts->strm_ctx_pool, tstrm_node,
 				      tstrm_node->strm_phy_addr);
@@ -1333,6 +1614,8 @@ static int xlnx_tsmux_update_complete(struct xlnx_tsmux *mpgmuxts)
 	temp_mux = list_first_entry(&mpgmuxts->mux_node, struct muxer_context,
 				    node);
 	mpgmuxts->outbuf_written = temp_mux->dst_buf_written;
+	if (temp_mux->dmabuf_id)
+		mpgmuxts->dst_dmabufintl[temp_mux->dmabuf_id - 1].users--;
 
 	list_del(&temp_mux->node);
 	spin_unlock_irqrestore(&mpgmuxts->lock, flags);
@@ -1407,6 +1690,8 @@ static int xlnx_tsmux_probe(struct platform_device *pdev)
 	}
 
 	/* Initializing variables used in Muxer */
+	spin_lock_init(&mpgmuxts->lock);
+	mutex_init(&mpgmuxts->dmabuf_lock);
 	spin_lock_irqsave(&mpgmuxts->lock, flags);
 	INIT_LIST_HEAD(&mpgmuxts->strm_node);
 	INIT_LIST_HEAD(&mpgmuxts->mux_node);
@@ -1492,6 +1777,7 @@ static int xlnx_tsmux_remove(struct platform_device *pdev)
 	mpgmuxts = platform_get_drvdata(pdev);
 	if (!mpgmuxts || !xlnx_tsmux_class)
 		return -EIO;
+	xlnx_tsmux_release_dmabufs(mpgmuxts);
 	dma_pool_destroy(mpgmuxts->mux_ctx_pool);
 	dma_pool_destroy(mpgmuxts->strm_ctx_pool);
 
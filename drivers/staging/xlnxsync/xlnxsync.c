@@ -13,17 +13,25 @@
 
 #include <linux/cdev.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/file.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/ioctl.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
 #include <linux/poll.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sync_file.h>
 #include <linux/uaccess.h>
 #include <linux/xlnxsync.h>
 
@@ -128,12 +136,32 @@
 
 #define XLNXSYNC_DEV_MAX		256
 
+/* Latency histograms, indexed by XLNXSYNC_PROD, XLNXSYNC_CONS and below */
+#define XLNXSYNC_LAT_PROD_CONS		2
+#define XLNXSYNC_LAT_NUM		3
+#define XLNXSYNC_LAT_BUCKETS		16
+
 /* Module Parameters */
 static struct class *xlnxsync_class;
 static dev_t xlnxsync_devt;
 /* Used to keep track of sync devices */
 static DEFINE_IDA(xs_ida);
 
+/**
+ * struct xlnxsync_latency - Latency histogram
+ * @buckets: bucket 0 counts latencies below 1us, bucket n those from
+ * 2^(n - 1)us to 2^n us, and the last bucket all the longer ones
+ * @count: number of latencies recorded
+ * @total_us: sum of the latencies in us
+ * @max_us: longest latency in us
+ */
+struct xlnxsync_latency {
+	u32 buckets[XLNXSYNC_LAT_BUCKETS];
+	u64 count;
+	u64 total_us;
+	u64 max_us;
+};
+
 /**
  * struct xlnxsync_device - Xilinx Synchronizer struct
  * @chdev: Character device driver struct
@@ -151,6 +179,8 @@ static DEFINE_IDA(xs_ida);
  * @channels: List head for syncip channel linked list
  * @chan_count : Active channel number count
  * @reserved : Bitmap to track reserved channels
+ * @latency: Per channel latency histograms, protected by irq_lock
+ * @debugfs: debugfs directory of the device
  *
  * This structure contains the device driver related parameters
  */
@@ -172,6 +202,42 @@ struct xlnxsync_device {
 	struct list_head channels;
 	u8 chan_count;
 	unsigned long reserved;
+	struct xlnxsync_latency
+		latency[XLNXSYNC_MAX_ENC_CHAN][XLNXSYNC_LAT_NUM];
+	struct dentry *debugfs;
+};
+
+/**
+ * struct xlnxsync_dma_fence - Framebuffer done fence
+ * @base: DMA fence
+ * @lock: Fence lock, which has to live as long as the fence
+ */
+struct xlnxsync_dma_fence {
+	struct dma_fence base;
+	/* Protects the fence, see struct dma_fence */
+	spinlock_t lock;
+};
+
+/**
+ * struct xlnxsync_slot - Framebuffer slot tracking for fences and latency
+ * @fence: Fence requested for the slot, NULL if none or already signalled
+ * @start: Time the slot was programmed in ns
+ * @end: Time the slot got done in ns
+ * @armed: The slot is programmed and not done yet
+ * @done: The slot got done since it was programmed
+ * @luma_done: Luma got done since the slot was programmed
+ * @chroma_done: Chroma got done since the slot was programmed
+ * @mono: The framebuffer has no chroma
+ */
+struct xlnxsync_slot {
+	struct dma_fence *fence;
+	u64 start;
+	u64 end;
+	u8 armed : 1;
+	u8 done : 1;
+	u8 luma_done : 1;
+	u8 chroma_done : 1;
+	u8 mono : 1;
 };
 
 /**
@@ -193,6 +259,9 @@ struct xlnxsync_device {
  * @cdiff_err: Chroma buffer diff > 1
  * @err_event: Error event per channel
  * @framedone_event: Framebuffer done event per channel
+ * @slots: Fence and latency tracking of the framebuffers, protected by the
+ * device irq_lock
+ * @last_slot: Framebuffer configured last for producer/consumer, -1 if none
  *
  * This structure contains the syncip channel specific parameters
  */
@@ -215,6 +284,8 @@ struct xlnxsync_channel {
 	u8 cdiff_err : 1;
 	u8 err_event : 1;
 	u8 framedone_event : 1;
+	struct xlnxsync_slot slots[XLNXSYNC_BUF_PER_CHAN][XLNXSYNC_IO];
+	int last_slot[XLNXSYNC_IO];
 };
 
 static inline u32 xlnxsync_read(struct xlnxsync_device *dev, u32 chan, u32 reg)
@@ -240,6 +311,162 @@ static inline void xlnxsync_set(struct xlnxsync_device *dev, u32 chan, u32 reg,
 	xlnxsync_write(dev, chan, reg, xlnxsync_read(dev, chan, reg) | set);
 }
 
+static const char *xlnxsync_fence_get_driver_name(struct dma_fence *fence)
+{
+	return XLNXSYNC_DRIVER_NAME;
+}
+
+static const char *xlnxsync_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "fbdone";
+}
+
+static const struct dma_fence_ops xlnxsync_fence_ops = {
+	.get_driver_name = xlnxsync_fence_get_driver_name,
+	.get_timeline_name = xlnxsync_fence_get_timeline_name,
+};
+
+static void xlnxsync_latency_add(struct xlnxsync_latency *lat, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int bucket = 0;
+
+	if (us)
+		bucket = min_t(unsigned int, ilog2(us) + 1,
+			       XLNXSYNC_LAT_BUCKETS - 1);
+
+	lat->buckets[bucket]++;
+	lat->count++;
+	lat->total_us += us;
+	lat->max_us = max(lat->max_us, us);
+}
+
+/* Must be called with the device irq_lock held */
+static void xlnxsync_slot_signal(struct xlnxsync_slot *slot, int error)
+{
+	slot->armed = false;
+
+	if (!slot->fence)
+		return;
+
+	if (error)
+		dma_fence_set_error(slot->fence, error);
+	dma_fence_signal(slot->fence);
+	dma_fence_put(slot->fence);
+	slot->fence = NULL;
+}
+
+/* Must be called with the device irq_lock held */
+static void xlnxsync_slot_arm(struct xlnxsync_channel *channel, u32 buf,
+			      u32 io, bool mono)
+{
+	struct xlnxsync_slot *slot = &channel->slots[buf][io];
+
+	/*
+	 * The slot is only reprogrammed once the hardware is done with it, so
+	 * a fence still pending here missed its interrupt, which happens when
+	 * the framebuffer done interrupts are masked.
+	 */
+	if (slot->armed)
+		xlnxsync_slot_signal(slot, 0);
+
+	slot->armed = true;
+	slot->done = false;
+	slot->luma_done = false;
+	slot->chroma_done = false;
+	slot->mono = mono;
+	slot->start = ktime_get_ns();
+	channel->last_slot[io] = buf;
+}
+
+/* Must be called with the device irq_lock held */
+static void xlnxsync_slot_plane_done(struct xlnxsync_channel *channel,
+				     u32 buf, u32 io, bool chroma)
+{
+	struct xlnxsync_latency *lat = channel->dev->latency[channel->id];
+	struct xlnxsync_slot *slot, *prod;
+
+	if (buf >= XLNXSYNC_BUF_PER_CHAN)
+		return;
+
+	slot = &channel->slots[buf][io];
+	if (!slot->armed)
+		return;
+
+	if (chroma)
+		slot->chroma_done = true;
+	else
+		slot->luma_done = true;
+	if (!slot->luma_done || (!slot->chroma_done && !slot->mono))
+		return;
+
+	slot->done = true;
+	slot->end = ktime_get_ns();
+	xlnxsync_latency_add(&lat[io], slot->end - slot->start);
+
+	prod = &channel->slots[buf][XLNXSYNC_PROD];
+	if (io == XLNXSYNC_CONS && prod->done && prod->end <= slot->end)
+		xlnxsync_latency_add(&lat[XLNXSYNC_LAT_PROD_CONS],
+				     slot->end - prod->end);
+
+	xlnxsync_slot_signal(slot, 0);
+}
+
+/* Must be called with the device irq_lock held */
+static void xlnxsync_chan_cancel_fences(struct xlnxsync_channel *channel)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < XLNXSYNC_BUF_PER_CHAN; i++)
+		for (j = 0; j < XLNXSYNC_IO; j++)
+			if (channel->slots[i][j].armed)
+				xlnxsync_slot_signal(&channel->slots[i][j],
+						     -ECANCELED);
+}
+
+static struct dma_fence *
+xlnxsync_slot_get_fence(struct xlnxsync_channel *channel, u32 buf, u32 io)
+{
+	struct xlnxsync_device *dev = channel->dev;
+	struct xlnxsync_dma_fence *xfence;
+	struct xlnxsync_slot *slot;
+	struct dma_fence *fence;
+	unsigned long flags;
+
+	xfence = kzalloc(sizeof(*xfence), GFP_KERNEL);
+	if (!xfence)
+		return ERR_PTR(-ENOMEM);
+
+	spin_lock_init(&xfence->lock);
+
+	spin_lock_irqsave(&dev->irq_lock, flags);
+	slot = &channel->slots[buf][io];
+	if (slot->fence) {
+		fence = dma_fence_get(slot->fence);
+		spin_unlock_irqrestore(&dev->irq_lock, flags);
+		kfree(xfence);
+		return fence;
+	}
+
+	if (!slot->armed && !slot->done) {
+		spin_unlock_irqrestore(&dev->irq_lock, flags);
+		kfree(xfence);
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* Slots complete in any order, give each fence its own timeline */
+	fence = &xfence->base;
+	dma_fence_init(fence, &xlnxsync_fence_ops, &xfence->lock,
+		       dma_fence_context_alloc(1), 1);
+	if (slot->armed)
+		slot->fence = dma_fence_get(fence);
+	else
+		dma_fence_signal(fence);
+	spin_unlock_irqrestore(&dev->irq_lock, flags);
+
+	return fence;
+}
+
 static bool xlnxsync_is_buf_done(struct xlnxsync_device *dev,
 				 u32 channel, u32 buf, u32 io,
 				 u8 force_clr_valid)
@@ -341,6 +568,7 @@ static int xlnxsync_chan_config(struct xlnxsync_channel *channel,
 {
 	struct xlnxsync_chan_config cfg;
 	int ret, i = 0, j;
+	unsigned long flags;
 	dma_addr_t phy_start_address;
 	u64 luma_start_address[XLNXSYNC_IO];
 	u64 chroma_start_address[XLNXSYNC_IO];
@@ -485,6 +713,10 @@ static int xlnxsync_chan_config(struct xlnxsync_channel *channel,
 			c_end_reg = XLNXSYNC_CC_END_LO_REG;
 		}
 
+		spin_lock_irqsave(&dev->irq_lock, flags);
+		xlnxsync_slot_arm(channel, i, j, cfg.ismono[j]);
+		spin_unlock_irqrestore(&dev->irq_lock, flags);
+
 		/* Start Address */
 		xlnxsync_write(dev, channel->id, l_start_reg + (i << 3),
 			       lower_32_bits(luma_start_address[j]));
@@ -612,6 +844,7 @@ static int xlnxsync_chan_get_status(struct xlnxsync_channel *channel,
 static int xlnxsync_reset_slot(struct xlnxsync_channel *channel)
 {
 	struct xlnxsync_device *dev = channel->dev;
+	unsigned long flags;
 	int slot;
 
 	if (dev->config.hdr_ver != XLNXSYNC_IOCTL_HDR_VER) {
@@ -630,6 +863,11 @@ static int xlnxsync_reset_slot(struct xlnxsync_channel *channel)
 	if (slot == XLNXSYNC_BUF_PER_CHAN)
 		slot = 0;
 
+	spin_lock_irqsave(&dev->irq_lock, flags);
+	xlnxsync_slot_signal(&channel->slots[slot][XLNXSYNC_PROD], -ECANCELED);
+	xlnxsync_slot_signal(&channel->slots[slot][XLNXSYNC_CONS], -ECANCELED);
+	spin_unlock_irqrestore(&dev->irq_lock, flags);
+
 	xlnxsync_write(dev, channel->id,
 		       XLNXSYNC_CL_START_LO_REG + 4 + (slot << 3), 0);
 	xlnxsync_write(dev, channel->id,
@@ -645,6 +883,7 @@ static int xlnxsync_reset_slot(struct xlnxsync_channel *channel)
 static int xlnxsync_chan_enable(struct xlnxsync_channel *channel, bool enable)
 {
 	struct xlnxsync_device *dev = channel->dev;
+	unsigned long flags;
 	unsigned int i, j;
 
 	if (dev->config.hdr_ver != XLNXSYNC_IOCTL_HDR_VER) {
@@ -677,6 +916,10 @@ static int xlnxsync_chan_enable(struct xlnxsync_channel *channel, bool enable)
 		channel->ldiff_err = false;
 		channel->cdiff_err = false;
 
+		spin_lock_irqsave(&dev->irq_lock, flags);
+		xlnxsync_chan_cancel_fences(channel);
+		spin_unlock_irqrestore(&dev->irq_lock, flags);
+
 		for (i = 0; i < XLNXSYNC_BUF_PER_CHAN; i++) {
 			for (j = 0; j < XLNXSYNC_IO; j++) {
 				channel->l_done[i][j] = false;
@@ -893,6 +1136,90 @@ static int xlnxsync_chan_set_int_mask(struct xlnxsync_channel *channel,
 	return ret;
 }
 
+static int xlnxsync_chan_get_fence(struct xlnxsync_channel *channel,
+				   void __user *arg)
+{
+	struct sync_file *sync_file[XLNXSYNC_IO] = { NULL };
+	struct xlnxsync_device *dev = channel->dev;
+	struct xlnxsync_fence fcfg;
+	struct dma_fence *fence;
+	int ret, buf, j;
+
+	ret = copy_from_user(&fcfg, arg, sizeof(fcfg));
+	if (ret) {
+		dev_err(dev->dev, "%s : Failed to copy from user\n", __func__);
+		return -EFAULT;
+	}
+
+	if (fcfg.hdr_ver != XLNXSYNC_IOCTL_HDR_VER) {
+		dev_err(dev->dev, "%s : ioctl version mismatch\n", __func__);
+		dev_err(dev->dev,
+			"ioctl ver = 0x%llx expected ver = 0x%llx\n",
+			fcfg.hdr_ver, (u64)XLNXSYNC_IOCTL_HDR_VER);
+		return -EINVAL;
+	}
+
+	if (!fcfg.flags ||
+	    fcfg.flags & ~(XLNXSYNC_FENCE_PROD | XLNXSYNC_FENCE_CONS))
+		return -EINVAL;
+
+	for (j = 0; j < XLNXSYNC_IO; j++)
+		fcfg.fd[j] = -1;
+
+	for (j = 0; j < XLNXSYNC_IO; j++) {
+		if (!(fcfg.flags & BIT(j)))
+			continue;
+
+		buf = fcfg.fb_id[j];
+		if (buf == XLNXSYNC_AUTO_SEARCH)
+			buf = channel->last_slot[j];
+		if (buf < 0 || buf >= XLNXSYNC_BUF_PER_CHAN) {
+			ret = -EINVAL;
+			goto err;
+		}
+
+		fence = xlnxsync_slot_get_fence(channel, buf, j);
+		if (IS_ERR(fence)) {
+			ret = PTR_ERR(fence);
+			goto err;
+		}
+
+		sync_file[j] = sync_file_create(fence);
+		dma_fence_put(fence);
+		if (!sync_file[j]) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		fcfg.fd[j] = get_unused_fd_flags(O_CLOEXEC);
+		if (fcfg.fd[j] < 0) {
+			ret = fcfg.fd[j];
+			goto err;
+		}
+	}
+
+	if (copy_to_user(arg, &fcfg, sizeof(fcfg))) {
+		ret = -EFAULT;
+		goto err;
+	}
+
+	for (j = 0; j < XLNXSYNC_IO; j++)
+		if (sync_file[j])
+			fd_install(fcfg.fd[j], sync_file[j]->file);
+
+	return 0;
+
+err:
+	for (j = 0; j < XLNXSYNC_IO; j++) {
+		if (fcfg.fd[j] >= 0)
+			put_unused_fd(fcfg.fd[j]);
+		if (sync_file[j])
+			fput(sync_file[j]->file);
+	}
+
+	return ret;
+}
+
 static long xlnxsync_ioctl(struct file *fptr, unsigned int cmd,
 			   unsigned long data)
 {
@@ -970,6 +1297,12 @@ static long xlnxsync_ioctl(struct file *fptr, unsigned int cmd,
 		ret = xlnxsync_reset_slot(channel);
 		mutex_unlock(&channel->mutex);
 		break;
+	case XLNXSYNC_CHAN_GET_FENCE:
+		if (mutex_lock_interruptible(&channel->mutex))
+			return -ERESTARTSYS;
+		ret = xlnxsync_chan_get_fence(channel, arg);
+		mutex_unlock(&channel->mutex);
+		break;
 	}
 
 	return ret;
@@ -1027,6 +1360,7 @@ static int xlnxsync_open(struct inode *iptr, struct file *fptr)
 {
 	struct xlnxsync_device *dev;
 	struct xlnxsync_channel *chan;
+	unsigned long flags;
 	unsigned int i;
 
 	dev = container_of(iptr->i_cdev, struct xlnxsync_device, chdev);
@@ -1051,6 +1385,11 @@ static int xlnxsync_open(struct inode *iptr, struct file *fptr)
 	set_bit(i, &dev->reserved);
 	chan->id = i;
 	chan->last_buf_used = -1;
+	chan->last_slot[XLNXSYNC_PROD] = -1;
+	chan->last_slot[XLNXSYNC_CONS] = -1;
+	spin_lock_irqsave(&dev->irq_lock, flags);
+	memset(dev->latency[i], 0, sizeof(dev->latency[i]));
+	spin_unlock_irqrestore(&dev->irq_lock, flags);
 	list_add_tail(&chan->channel, &dev->channels);
 	chan->dev = dev;
 	fptr->private_data = chan;
@@ -1070,6 +1409,7 @@ static int xlnxsync_release(struct inode *iptr, struct file *fptr)
 {
 	struct xlnxsync_device *dev;
 	struct xlnxsync_channel *channel = fptr->private_data;
+	unsigned long flags;
 
 	dev = container_of(iptr->i_cdev, struct xlnxsync_device, chdev);
 	if (!dev) {
@@ -1090,6 +1430,10 @@ static int xlnxsync_release(struct inode *iptr, struct file *fptr)
 			     XLNXSYNC_CTRL_INTR_EN_MASK);
 	}
 
+	spin_lock_irqsave(&dev->irq_lock, flags);
+	xlnxsync_chan_cancel_fences(channel);
+	spin_unlock_irqrestore(&dev->irq_lock, flags);
+
 	if (mutex_lock_interruptible(&dev->sync_mutex))
 		return -ERESTARTSYS;
 	clear_bit(channel->id, &dev->reserved);
@@ -1166,6 +1510,7 @@ static irqreturn_t xlnxsync_irq_handler(int irq, void *data)
 				XLNXSYNC_ISR_PLDONE_SHIFT;
 
 			chan->l_done[i][XLNXSYNC_PROD] = true;
+			xlnxsync_slot_plane_done(chan, i, XLNXSYNC_PROD, false);
 		}
 
 		if (val & XLNXSYNC_ISR_PCVALID_MASK) {
@@ -1173,6 +1518,7 @@ static irqreturn_t xlnxsync_irq_handler(int irq, void *data)
 				XLNXSYNC_ISR_PCDONE_SHIFT;
 
 			chan->c_done[i][XLNXSYNC_PROD] = true;
+			xlnxsync_slot_plane_done(chan, i, XLNXSYNC_PROD, true);
 		}
 
 		if (val & XLNXSYNC_ISR_CLVALID_MASK) {
@@ -1180,6 +1526,7 @@ static irqreturn_t xlnxsync_irq_handler(int irq, void *data)
 				XLNXSYNC_ISR_CLDONE_SHIFT;
 
 			chan->l_done[i][XLNXSYNC_CONS] = true;
+			xlnxsync_slot_plane_done(chan, i, XLNXSYNC_CONS, false);
 		}
 
 		if (val & XLNXSYNC_ISR_CCVALID_MASK) {
@@ -1187,6 +1534,7 @@ static irqreturn_t xlnxsync_irq_handler(int irq, void *data)
 				XLNXSYNC_ISR_CCDONE_SHIFT;
 
 			chan->c_done[i][XLNXSYNC_CONS] = true;
+			xlnxsync_slot_plane_done(chan, i, XLNXSYNC_CONS, true);
 		}
 
 		for (i = 0; i < XLNXSYNC_BUF_PER_CHAN; i++) {
@@ -1221,6 +1569,43 @@ static irqreturn_t xlnxsync_irq_handler(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+static int xlnxsync_latency_show(struct seq_file *s, void *data)
+{
+	static const char * const names[XLNXSYNC_LAT_NUM] = {
+		[XLNXSYNC_PROD] = "producer",
+		[XLNXSYNC_CONS] = "consumer",
+		[XLNXSYNC_LAT_PROD_CONS] = "producer to consumer",
+	};
+	struct xlnxsync_device *xlnxsync = s->private;
+	struct xlnxsync_latency lat;
+	unsigned long flags;
+	unsigned int i, j, n;
+	u64 avg;
+
+	for (i = 0; i < xlnxsync->config.max_channels; i++) {
+		for (j = 0; j < XLNXSYNC_LAT_NUM; j++) {
+			spin_lock_irqsave(&xlnxsync->irq_lock, flags);
+			lat = xlnxsync->latency[i][j];
+			spin_unlock_irqrestore(&xlnxsync->irq_lock, flags);
+
+			avg = lat.count ? div64_u64(lat.total_us, lat.count) : 0;
+			seq_printf(s, "channel %u %s: count %llu avg %llu us max %llu us\n",
+				   i, names[j], lat.count, avg, lat.max_us);
+
+			for (n = 0; n < XLNXSYNC_LAT_BUCKETS; n++) {
+				if (!lat.buckets[n])
+					continue;
+				seq_printf(s, "  >= %6u us: %u\n",
+					   n ? 1U << (n - 1) : 0,
+					   lat.buckets[n]);
+			}
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xlnxsync_latency);
+
 static int xlnxsync_parse_dt_prop(struct xlnxsync_device *xlnxsync)
 {
 	struct device_node *node = xlnxsync->dev->of_node;
@@ -1403,6 +1788,12 @@ static int xlnxsync_probe(struct platform_device *pdev)
 	}
 
 	platform_set_drvdata(pdev, xlnxsync);
+
+	/* Latencies of the framebuffers from programming to done */
+	xlnxsync->debugfs = debugfs_create_dir(dev_name(dc), NULL);
+	debugfs_create_file("latency", 0444, xlnxsync->debugfs, xlnxsync,
+			    &xlnxsync_latency_fops);
+
 	dev_info(xlnxsync->dev, "Xilinx Synchronizer probe successful!\n");
 
 	return 0;
@@ -1425,6 +1816,7 @@ static int xlnxsync_remove(struct platform_device *pdev)
 	if (!xlnxsync || !xlnxsync_class)
 		return -EIO;
 
+	debugfs_remove_recursive(xlnxsync->debugfs);
 	cdev_del(&xlnxsync->chdev);
 	clk_disable_unprepare(xlnxsync->c_clk);
 	clk_disable_unprepare(xlnxsync->p_clk);
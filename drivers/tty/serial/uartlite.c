@@ -15,6 +15,9 @@
 #include <linux/tty.h>
 #include <linux/tty_flip.h>
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/init.h>
 #include <linux/io.h>
@@ -24,7 +27,9 @@
 #include <linux/of_device.h>
 #include <linux/of_platform.h>
 #include <linux/clk.h>
+#include <linux/ktime.h>
 #include <linux/pm_runtime.h>
+#include <linux/sizes.h>
 
 #define ULITE_NAME		"ttyUL"
 #define ULITE_MAJOR		204
@@ -59,23 +64,72 @@
 #define ULITE_CONTROL_IE	0x10
 #define UART_AUTOSUSPEND_TIMEOUT	3000	/* ms */
 
+#define ULITE_DMA_RX_SIZE	SZ_4K	/* Cyclic receive buffer size */
+#define ULITE_DMA_RX_IDLE_MIN_US	50
+
+static uint rx_idle_us = 200;
+module_param(rx_idle_us, uint, 0644);
+MODULE_PARM_DESC(rx_idle_us,
+		 "Interval at which bytes received by DMA are flushed, in us (default: 200)");
+
 /* Static pointer to console port */
 #ifdef CONFIG_SERIAL_UARTLITE_CONSOLE
 static struct uart_port *console_port;
 #endif
 
+/**
+ * struct uartlite_stats: Per port statistics
+ * irqs: Interrupts taken
+ * rx_dma_bytes: Bytes received through the DMA channel
+ * tx_dma_bytes: Bytes transmitted through the DMA channel
+ * rx_flushes: Flushes of the bytes received by DMA
+ * rx_latency_max_ns: Longest time from a flush of the DMA buffer to the
+ *		      received bytes being handed to the tty layer
+ */
+struct uartlite_stats {
+	u64 irqs;
+	u64 rx_dma_bytes;
+	u64 tx_dma_bytes;
+	u64 rx_flushes;
+	u64 rx_latency_max_ns;
+};
+
 /**
  * struct uartlite_data: Driver private data
  * reg_ops: Functions to read/write registers
  * clk: Our parent clock, if present
  * baud: The baud rate configured when this device was synthesized
  * cflags: The cflags for parity and data bits
+ * port: The port of this device
+ * rx_chan: DMA channel draining the RX FIFO, if any
+ * tx_chan: DMA channel feeding the TX FIFO, if any
+ * rx_buf: Cyclic receive DMA buffer
+ * rx_dma: DMA address of rx_buf
+ * rx_cookie: Cookie of the cyclic receive transfer
+ * rx_pos: Offset in rx_buf of the next byte to push
+ * rx_timer: Flushes the bytes received by DMA, the core has no RX timeout
+ * tx_dma: DMA address of the mapped transmit buffer
+ * tx_len: Length of the transmit transfer in flight, 0 if none
+ * dma_running: Transfers go through the DMA channels
+ * stats: Interrupt and transfer statistics
  */
 struct uartlite_data {
 	const struct uartlite_reg_ops *reg_ops;
 	struct clk *clk;
 	unsigned int baud;
 	tcflag_t cflags;
+	struct uart_port *port;
+	struct dma_chan *rx_chan;
+	struct dma_chan *tx_chan;
+	u8 *rx_buf;
+	dma_addr_t rx_dma;
+	dma_cookie_t rx_cookie;
+	unsigned int rx_pos;
+	struct hrtimer rx_timer;
+	dma_addr_t tx_dma;
+	unsigned int tx_len;
+	bool dma_running;
+	struct uartlite_stats stats;
 };
 
 struct uartlite_reg_ops {
@@ -216,11 +270,14 @@ static int ulite_transmit(struct uart_port *port, int stat)
 static irqreturn_t ulite_isr(int irq, void *dev_id)
 {
 	struct uart_port *port = dev_id;
+	struct uartlite_data *pdata = port->private_data;
 	int stat, busy, n = 0;
 	unsigned long flags;
 
 	do {
 		spin_lock_irqsave(&port->lock, flags);
+		if (!n)
+			pdata->stats.irqs++;
 		stat = uart_in32(ULITE_STATUS, port);
 		busy  = ulite_receive(port, stat);
 		busy |= ulite_transmit(port, stat);
@@ -237,6 +294,229 @@ static irqreturn_t ulite_isr(int irq, void *dev_id)
 	}
 }
 
+/**
+ * ulite_dma_rx_push - Push the bytes received by DMA to the tty layer
+ * @port: Handle to the uart port structure
+ *
+ * Must be called with the port lock held.
+ */
+static void ulite_dma_rx_push(struct uart_port *port)
+{
+	struct uartlite_data *pdata = port->private_data;
+	struct tty_port *tport = &port->state->port;
+	struct dma_tx_state state;
+	unsigned int pos, len, copied;
+
+	dmaengine_tx_status(pdata->rx_chan, pdata->rx_cookie, &state);
+	/* A residue of 0 is the end of the buffer, i.e. a wrap to 0 */
+	pos = (ULITE_DMA_RX_SIZE - state.residue) % ULITE_DMA_RX_SIZE;
+	if (pos == pdata->rx_pos)
+		return;
+
+	while (pdata->rx_pos != pos) {
+		/* Up to the end of the buffer first when the DMA wrapped */
+		if (pos < pdata->rx_pos)
+			len = ULITE_DMA_RX_SIZE - pdata->rx_pos;
+		else
+			len = pos - pdata->rx_pos;
+
+		/* ignore all characters if CREAD is not set */
+		if (port->ignore_status_mask & ULITE_STATUS_RXVALID)
+			copied = len;
+		else
+			copied = tty_insert_flip_string(tport, pdata->rx_buf +
+							pdata->rx_pos, len);
+		port->icount.rx += len;
+		port->icount.buf_overrun += len - copied;
+		pdata->stats.rx_dma_bytes += len;
+		pdata->rx_pos = (pdata->rx_pos + len) % ULITE_DMA_RX_SIZE;
+	}
+
+	pdata->stats.rx_flushes++;
+	tty_flip_buffer_push(tport);
+}
+
+static void ulite_dma_rx_period(void *param)
+{
+	struct uart_port *port = param;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+	ulite_dma_rx_push(port);
+	spin_unlock_irqrestore(&port->lock, flags);
+}
+
+static enum hrtimer_restart ulite_dma_rx_timer(struct hrtimer *timer)
+{
+	struct uartlite_data *pdata = container_of(timer, struct uartlite_data,
+						   rx_timer);
+	struct uart_port *port = pdata->port;
+	unsigned long flags;
+	u64 start = ktime_get_ns();
+	u32 stat;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	/* Errors can not be attributed to a byte and are only counted */
+	stat = uart_in32(ULITE_STATUS, port);
+	if (stat & ULITE_STATUS_OVERRUN)
+		port->icount.overrun++;
+	if (stat & ULITE_STATUS_FRAME)
+		port->icount.frame++;
+	if (stat & ULITE_STATUS_PARITY)
+		port->icount.parity++;
+
+	ulite_dma_rx_push(port);
+	pdata->stats.rx_latency_max_ns = max(pdata->stats.rx_latency_max_ns,
+					     ktime_get_ns() - start);
+
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	hrtimer_forward_now(timer,
+			    us_to_ktime(max_t(uint, READ_ONCE(rx_idle_us),
+					      ULITE_DMA_RX_IDLE_MIN_US)));
+	return HRTIMER_RESTART;
+}
+
+static void ulite_dma_tx(struct uart_port *port);
+
+static void ulite_dma_tx_done(void *param)
+{
+	struct uart_port *port = param;
+	struct uartlite_data *pdata = port->private_data;
+	struct circ_buf *xmit = &port->state->xmit;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	xmit->tail = (xmit->tail + pdata->tx_len) & (UART_XMIT_SIZE - 1);
+	port->icount.tx += pdata->tx_len;
+	pdata->stats.tx_dma_bytes += pdata->tx_len;
+	pdata->tx_len = 0;
+
+	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+		uart_write_wakeup(port);
+
+	ulite_dma_tx(port);
+
+	spin_unlock_irqrestore(&port->lock, flags);
+}
+
+/**
+ * ulite_dma_tx - Queue the pending transmit bytes to the DMA channel
+ * @port: Handle to the uart port structure
+ *
+ * Only the contiguous part of the circular buffer is queued, the rest
+ * follows from the completion callback. Must be called with the port lock
+ * held.
+ */
+static void ulite_dma_tx(struct uart_port *port)
+{
+	struct uartlite_data *pdata = port->private_data;
+	struct circ_buf *xmit = &port->state->xmit;
+	struct dma_async_tx_descriptor *desc;
+	unsigned int len;
+
+	if (pdata->tx_len || uart_tx_stopped(port) || uart_circ_empty(xmit))
+		return;
+
+	len = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+	dma_sync_single_for_device(pdata->tx_chan->device->dev,
+				   pdata->tx_dma + xmit->tail, len,
+				   DMA_TO_DEVICE);
+
+	desc = dmaengine_prep_slave_single(pdata->tx_chan,
+					   pdata->tx_dma + xmit->tail, len,
+					   DMA_MEM_TO_DEV, DMA_PREP_INTERRUPT);
+	if (!desc)
+		return;
+
+	desc->callback = ulite_dma_tx_done;
+	desc->callback_param = port;
+	pdata->tx_len = len;
+	dmaengine_submit(desc);
+	dma_async_issue_pending(pdata->tx_chan);
+}
+
+/**
+ * ulite_dma_startup - Start moving the FIFOs with the DMA channels
+ * @port: Handle to the uart port structure
+ *
+ * The endianness of the registers is only known once the port is
+ * requested, so the channels are configured here. The bytes are moved
+ * from and to the byte lane of the data registers.
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+static int ulite_dma_startup(struct uart_port *port)
+{
+	struct uartlite_data *pdata = port->private_data;
+	struct device *dma_dev = pdata->tx_chan->device->dev;
+	unsigned int lane = pdata->reg_ops == &uartlite_be ? 3 : 0;
+	struct dma_slave_config config = {
+		.src_addr = port->mapbase + ULITE_RX + lane,
+		.dst_addr = port->mapbase + ULITE_TX + lane,
+		.src_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE,
+		.dst_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE,
+		.src_maxburst = 1,
+		.dst_maxburst = 1,
+	};
+	struct dma_async_tx_descriptor *desc;
+	int ret;
+
+	config.direction = DMA_DEV_TO_MEM;
+	ret = dmaengine_slave_config(pdata->rx_chan, &config);
+	if (ret)
+		return ret;
+	config.direction = DMA_MEM_TO_DEV;
+	ret = dmaengine_slave_config(pdata->tx_chan, &config);
+	if (ret)
+		return ret;
+
+	pdata->tx_dma = dma_map_single(dma_dev, port->state->xmit.buf,
+				       UART_XMIT_SIZE, DMA_TO_DEVICE);
+	if (dma_mapping_error(dma_dev, pdata->tx_dma))
+		return -ENOMEM;
+
+	desc = dmaengine_prep_dma_cyclic(pdata->rx_chan, pdata->rx_dma,
+					 ULITE_DMA_RX_SIZE,
+					 ULITE_DMA_RX_SIZE / 2,
+					 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	if (!desc) {
+		dma_unmap_single(dma_dev, pdata->tx_dma, UART_XMIT_SIZE,
+				 DMA_TO_DEVICE);
+		return -EBUSY;
+	}
+
+	desc->callback = ulite_dma_rx_period;
+	desc->callback_param = port;
+	pdata->rx_pos = 0;
+	pdata->tx_len = 0;
+	pdata->rx_cookie = dmaengine_submit(desc);
+	dma_async_issue_pending(pdata->rx_chan);
+	pdata->dma_running = true;
+
+	hrtimer_start(&pdata->rx_timer,
+		      us_to_ktime(max_t(uint, READ_ONCE(rx_idle_us),
+					ULITE_DMA_RX_IDLE_MIN_US)),
+		      HRTIMER_MODE_REL);
+
+	return 0;
+}
+
+static void ulite_dma_shutdown(struct uart_port *port)
+{
+	struct uartlite_data *pdata = port->private_data;
+
+	hrtimer_cancel(&pdata->rx_timer);
+	dmaengine_terminate_sync(pdata->rx_chan);
+	dmaengine_terminate_sync(pdata->tx_chan);
+	dma_unmap_single(pdata->tx_chan->device->dev, pdata->tx_dma,
+			 UART_XMIT_SIZE, DMA_TO_DEVICE);
+	pdata->tx_len = 0;
+	pdata->dma_running = false;
+}
+
 static unsigned int ulite_tx_empty(struct uart_port *port)
 {
 	unsigned long flags;
@@ -266,9 +546,29 @@ static void ulite_stop_tx(struct uart_port *port)
 
 static void ulite_start_tx(struct uart_port *port)
 {
+	struct uartlite_data *pdata = port->private_data;
+
+	if (pdata->dma_running) {
+		if (port->x_char)
+			ulite_transmit(port, uart_in32(ULITE_STATUS, port));
+		ulite_dma_tx(port);
+		return;
+	}
+
 	ulite_transmit(port, uart_in32(ULITE_STATUS, port));
 }
 
+static void ulite_flush_buffer(struct uart_port *port)
+{
+	struct uartlite_data *pdata = port->private_data;
+
+	/* drop the transmit DMA transfer in flight */
+	if (pdata->dma_running && pdata->tx_len) {
+		dmaengine_terminate_async(pdata->tx_chan);
+		pdata->tx_len = 0;
+	}
+}
+
 static void ulite_stop_rx(struct uart_port *port)
 {
 	/* don't forward any more data (like !CREAD) */
@@ -299,6 +599,16 @@ static int ulite_startup(struct uart_port *port)
 
 	uart_out32(ULITE_CONTROL_RST_RX | ULITE_CONTROL_RST_TX,
 		ULITE_CONTROL, port);
+
+	/* The FIFOs are moved by DMA without interrupts */
+	if (pdata->tx_chan) {
+		ret = ulite_dma_startup(port);
+		if (!ret)
+			return 0;
+		dev_warn(port->dev, "DMA startup failed (%d), using interrupts\n",
+			 ret);
+	}
+
 	uart_out32(ULITE_CONTROL_IE, ULITE_CONTROL, port);
 
 	return 0;
@@ -311,6 +621,8 @@ static void ulite_shutdown(struct uart_port *port)
 	uart_out32(0, ULITE_CONTROL, port);
 	uart_in32(ULITE_CONTROL, port); /* dummy */
 	free_irq(port->irq, port);
+	if (pdata->dma_running)
+		ulite_dma_shutdown(port);
 	clk_disable(pdata->clk);
 }
 
@@ -452,6 +764,7 @@ static const struct uart_ops ulite_ops = {
 	.break_ctl	= ulite_break_ctl,
 	.startup	= ulite_startup,
 	.shutdown	= ulite_shutdown,
+	.flush_buffer	= ulite_flush_buffer,
 	.set_termios	= ulite_set_termios,
 	.type		= ulite_type,
 	.release_port	= ulite_release_port,
@@ -618,6 +931,41 @@ static struct uart_driver ulite_uart_driver = {
  * Port assignment functions (mapping devices to uart_port structures)
  */
 
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+	struct uart_port *port = state->uart_port;
+	struct uartlite_data *pdata = port->private_data;
+	struct uartlite_stats stats;
+	struct uart_icount icount;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+	stats = pdata->stats;
+	icount = port->icount;
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return sysfs_emit(buf,
+			  "irqs: %llu\nrx_dma_bytes: %llu\ntx_dma_bytes: %llu\n"
+			  "rx_flushes: %llu\noverrun: %u\nbuf_overrun: %u\n"
+			  "rx_latency_max_ns: %llu\n",
+			  stats.irqs, stats.rx_dma_bytes, stats.tx_dma_bytes,
+			  stats.rx_flushes, icount.overrun, icount.buf_overrun,
+			  stats.rx_latency_max_ns);
+}
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *ulite_attrs[] = {
+	&dev_attr_stats.attr,
+	NULL,
+};
+
+static const struct attribute_group ulite_attr_group = {
+	.attrs = ulite_attrs,
+};
+
 /** ulite_assign: register a uartlite device with the driver
  *
  * @dev: pointer to device structure
@@ -667,6 +1015,8 @@ static int ulite_assign(struct device *dev, int id, phys_addr_t base, int irq,
 	port->type = PORT_UNKNOWN;
 	port->line = id;
 	port->private_data = pdata;
+	port->attr_group = &ulite_attr_group;
+	pdata->port = port;
 
 	dev_set_drvdata(dev, port);
 
@@ -775,6 +1125,76 @@ static const struct of_device_id ulite_of_match[] = {
 MODULE_DEVICE_TABLE(of, ulite_of_match);
 #endif /* CONFIG_OF */
 
+static void ulite_dma_release(struct uartlite_data *pdata)
+{
+	if (pdata->rx_buf)
+		dma_free_coherent(pdata->rx_chan->device->dev,
+				  ULITE_DMA_RX_SIZE, pdata->rx_buf,
+				  pdata->rx_dma);
+	if (pdata->rx_chan)
+		dma_release_channel(pdata->rx_chan);
+	if (pdata->tx_chan)
+		dma_release_channel(pdata->tx_chan);
+	pdata->rx_buf = NULL;
+	pdata->rx_chan = NULL;
+	pdata->tx_chan = NULL;
+}
+
+/**
+ * ulite_dma_probe - Request the optional DMA channels
+ * @pdata: private data for uartlite
+ * @dev: pointer to device structure
+ *
+ * The FIFOs are only moved by DMA when both the "rx" and "tx" channels are
+ * described, and the receive channel reports its progress finer than per
+ * descriptor. The port falls back to interrupt driven transfers otherwise.
+ *
+ * Returns: 0 on success or fallback, -EPROBE_DEFER if a channel is not ready
+ */
+static int ulite_dma_probe(struct uartlite_data *pdata, struct device *dev)
+{
+	struct dma_slave_caps caps;
+	struct dma_chan *chan;
+	int ret;
+
+	hrtimer_init(&pdata->rx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pdata->rx_timer.function = ulite_dma_rx_timer;
+
+	chan = dma_request_chan(dev, "rx");
+	if (IS_ERR(chan))
+		return PTR_ERR(chan) == -EPROBE_DEFER ? -EPROBE_DEFER : 0;
+	pdata->rx_chan = chan;
+
+	chan = dma_request_chan(dev, "tx");
+	if (IS_ERR(chan)) {
+		ret = PTR_ERR(chan) == -EPROBE_DEFER ? -EPROBE_DEFER : 0;
+		goto release;
+	}
+	pdata->tx_chan = chan;
+
+	ret = dma_get_slave_caps(pdata->rx_chan, &caps);
+	if (ret || caps.residue_granularity ==
+		   DMA_RESIDUE_GRANULARITY_DESCRIPTOR)
+		goto fallback;
+
+	pdata->rx_buf = dma_alloc_coherent(pdata->rx_chan->device->dev,
+					   ULITE_DMA_RX_SIZE, &pdata->rx_dma,
+					   GFP_KERNEL);
+	if (!pdata->rx_buf)
+		goto fallback;
+
+	dev_info(dev, "using DMA\n");
+
+	return 0;
+
+fallback:
+	ret = 0;
+	dev_warn(dev, "DMA channels not usable, using interrupts\n");
+release:
+	ulite_dma_release(pdata);
+	return ret;
+}
+
 static int ulite_probe(struct platform_device *pdev)
 {
 	struct resource *res;
@@ -868,9 +1288,14 @@ static int ulite_probe(struct platform_device *pdev)
 		pdata->clk = NULL;
 	}
 
+	ret = ulite_dma_probe(pdata, &pdev->dev);
+	if (ret)
+		return ret;
+
 	ret = clk_prepare_enable(pdata->clk);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to prepare clock\n");
+		ulite_dma_release(pdata);
 		return ret;
 	}
 
@@ -885,11 +1310,14 @@ static int ulite_probe(struct platform_device *pdev)
 		if (ret < 0) {
 			dev_err(&pdev->dev, "Failed to register driver\n");
 			clk_disable_unprepare(pdata->clk);
+			ulite_dma_release(pdata);
 			return ret;
 		}
 	}
 
 	ret = ulite_assign(&pdev->dev, id, res->start, irq, pdata);
+	if (ret)
+		ulite_dma_release(pdata);
 
 	pm_runtime_mark_last_busy(&pdev->dev);
 	pm_runtime_put_autosuspend(&pdev->dev);
@@ -905,6 +1333,7 @@ static int ulite_remove(struct platform_device *pdev)
 
 	clk_disable_unprepare(pdata->clk);
 	rc = ulite_release(&pdev->dev);
+	ulite_dma_release(pdata);
 	pm_runtime_disable(&pdev->dev);
 	pm_runtime_set_suspended(&pdev->dev);
 	pm_runtime_dont_use_autosuspend(&pdev->dev);
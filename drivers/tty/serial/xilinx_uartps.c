@@ -13,12 +13,16 @@
 #include <linux/serial.h>
 #include <linux/console.h>
 #include <linux/serial_core.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/tty.h>
 #include <linux/tty_flip.h>
 #include <linux/clk.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/irq.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
 #include <linux/module.h>
 #include <linux/pm_runtime.h>
@@ -32,6 +36,7 @@
 #define CDNS_UART_FIFO_SIZE	64	/* FIFO size */
 #define CDNS_UART_REGISTER_SPACE	0x1000
 #define TX_TIMEOUT		500000
+#define CDNS_UART_DMA_RX_SIZE	SZ_4K	/* Cyclic receive buffer size */
 
 /* Rx Trigger level */
 static uint rx_trigger_level = 56;
@@ -142,6 +147,14 @@ MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
 				 CDNS_UART_IXR_RXTRIG |	 \
 				 CDNS_UART_IXR_TOUT)
 
+/*
+ * With a receive DMA channel the FIFO is drained by the DMA, the RX timeout
+ * interrupt flushes the received bytes once the line goes idle.
+ */
+#define CDNS_UART_DMA_RX_IRQS	(CDNS_UART_IXR_FRAMING | \
+				 CDNS_UART_IXR_OVERRUN | \
+				 CDNS_UART_IXR_TOUT)
+
 /* Goes in read_status_mask for break detection as the HW doesn't do it*/
 #define CDNS_UART_IXR_BRK	0x00002000
 
@@ -183,6 +196,25 @@ MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
 #define CDNS_UART_CD_MAX	65535
 #define UART_AUTOSUSPEND_TIMEOUT	3000
 
+/**
+ * struct cdns_uart_stats - Per port statistics
+ * @rx_irqs:		Interrupts with receive events
+ * @tx_irqs:		TX FIFO empty interrupts
+ * @rx_dma_bytes:	Bytes received through the DMA channel
+ * @tx_dma_bytes:	Bytes transmitted through the DMA channel
+ * @rx_idle_flushes:	Receive DMA flushes on RX timeout
+ * @rx_latency_max_ns:	Longest time from a receive interrupt to the
+ *			bytes being handed to the tty layer
+ */
+struct cdns_uart_stats {
+	u64 rx_irqs;
+	u64 tx_irqs;
+	u64 rx_dma_bytes;
+	u64 tx_dma_bytes;
+	u64 rx_idle_flushes;
+	u64 rx_latency_max_ns;
+};
+
 /**
  * struct cdns_uart - device data
  * @port:		Pointer to the UART port
@@ -193,6 +225,16 @@ MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
  * @clk_rate_change_nb:	Notifier block for clock changes
  * @quirks:		Flags for RXBS support.
  * @cts_override:	Modem control state override
+ * @rx_chan:		DMA channel draining the RX FIFO, if any
+ * @tx_chan:		DMA channel feeding the TX FIFO, if any
+ * @rx_buf:		Cyclic receive DMA buffer
+ * @rx_dma:		DMA address of @rx_buf
+ * @rx_cookie:		Cookie of the cyclic receive transfer
+ * @rx_pos:		Offset in @rx_buf of the next byte to push
+ * @rx_dma_running:	Cyclic receive transfer is running
+ * @tx_dma:		DMA address of the mapped transmit buffer
+ * @tx_len:		Length of the transmit transfer in flight, 0 if none
+ * @stats:		Interrupt and transfer statistics
  */
 struct cdns_uart {
 	struct uart_port	*port;
@@ -203,6 +245,16 @@ struct cdns_uart {
 	struct notifier_block	clk_rate_change_nb;
 	u32			quirks;
 	bool cts_override;
+	struct dma_chan		*rx_chan;
+	struct dma_chan		*tx_chan;
+	u8			*rx_buf;
+	dma_addr_t		rx_dma;
+	dma_cookie_t		rx_cookie;
+	unsigned int		rx_pos;
+	bool			rx_dma_running;
+	dma_addr_t		tx_dma;
+	unsigned int		tx_len;
+	struct cdns_uart_stats	stats;
 };
 struct cdns_platform_data {
 	u32 quirks;
@@ -343,6 +395,177 @@ static void cdns_uart_handle_tx(void *dev_id)
 		uart_write_wakeup(port);
 }
 
+/**
+ * cdns_uart_dma_rx_push - Push the bytes received by DMA to the tty layer
+ * @port: Handle to the uart port structure
+ *
+ * Must be called with the port lock held.
+ */
+static void cdns_uart_dma_rx_push(struct uart_port *port)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+	struct tty_port *tport = &port->state->port;
+	struct dma_tx_state state;
+	unsigned int pos, len, copied;
+
+	dmaengine_tx_status(cdns_uart->rx_chan, cdns_uart->rx_cookie, &state);
+	/* A residue of 0 is the end of the buffer, i.e. a wrap to 0 */
+	pos = (CDNS_UART_DMA_RX_SIZE - state.residue) % CDNS_UART_DMA_RX_SIZE;
+
+	while (cdns_uart->rx_pos != pos) {
+		/* Up to the end of the buffer first when the DMA wrapped */
+		if (pos < cdns_uart->rx_pos)
+			len = CDNS_UART_DMA_RX_SIZE - cdns_uart->rx_pos;
+		else
+			len = pos - cdns_uart->rx_pos;
+
+		/* ignore all characters if CREAD is not set */
+		if (port->ignore_status_mask & CDNS_UART_IXR_TOUT)
+			copied = len;
+		else
+			copied = tty_insert_flip_string(tport,
+							cdns_uart->rx_buf +
+							cdns_uart->rx_pos,
+							len);
+		port->icount.rx += len;
+		port->icount.buf_overrun += len - copied;
+		cdns_uart->stats.rx_dma_bytes += len;
+		cdns_uart->rx_pos = (cdns_uart->rx_pos + len) %
+				    CDNS_UART_DMA_RX_SIZE;
+	}
+
+	tty_flip_buffer_push(tport);
+}
+
+/**
+ * cdns_uart_dma_rx_period - Receive DMA period completion callback
+ * @param: Handle to the uart port structure
+ */
+static void cdns_uart_dma_rx_period(void *param)
+{
+	struct uart_port *port = param;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+	cdns_uart_dma_rx_push(port);
+	spin_unlock_irqrestore(&port->lock, flags);
+}
+
+/**
+ * cdns_uart_handle_rx_dma - Handle the receive events when the FIFO is
+ *			     drained by DMA
+ * @port: Handle to the uart port structure
+ * @isrstatus: The interrupt status register value as read
+ *
+ * Errors can not be attributed to a byte and are only counted.
+ */
+static void cdns_uart_handle_rx_dma(struct uart_port *port,
+				    unsigned int isrstatus)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+
+	if (isrstatus & CDNS_UART_IXR_OVERRUN)
+		port->icount.overrun++;
+	if (isrstatus & CDNS_UART_IXR_FRAMING)
+		port->icount.frame++;
+	if (isrstatus & CDNS_UART_IXR_TOUT)
+		cdns_uart->stats.rx_idle_flushes++;
+
+	cdns_uart_dma_rx_push(port);
+}
+
+/**
+ * cdns_uart_dma_rx_start - Start the cyclic receive DMA transfer
+ * @port: Handle to the uart port structure
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+static int cdns_uart_dma_rx_start(struct uart_port *port)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+	struct dma_async_tx_descriptor *desc;
+
+	desc = dmaengine_prep_dma_cyclic(cdns_uart->rx_chan, cdns_uart->rx_dma,
+					 CDNS_UART_DMA_RX_SIZE,
+					 CDNS_UART_DMA_RX_SIZE / 2,
+					 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	if (!desc)
+		return -EBUSY;
+
+	desc->callback = cdns_uart_dma_rx_period;
+	desc->callback_param = port;
+	cdns_uart->rx_pos = 0;
+	cdns_uart->rx_cookie = dmaengine_submit(desc);
+	dma_async_issue_pending(cdns_uart->rx_chan);
+	cdns_uart->rx_dma_running = true;
+
+	return 0;
+}
+
+static void cdns_uart_dma_tx(struct uart_port *port);
+
+/**
+ * cdns_uart_dma_tx_done - Transmit DMA completion callback
+ * @param: Handle to the uart port structure
+ */
+static void cdns_uart_dma_tx_done(void *param)
+{
+	struct uart_port *port = param;
+	struct cdns_uart *cdns_uart = port->private_data;
+	struct circ_buf *xmit = &port->state->xmit;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	xmit->tail = (xmit->tail + cdns_uart->tx_len) & (UART_XMIT_SIZE - 1);
+	port->icount.tx += cdns_uart->tx_len;
+	cdns_uart->stats.tx_dma_bytes += cdns_uart->tx_len;
+	cdns_uart->tx_len = 0;
+
+	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+		uart_write_wakeup(port);
+
+	cdns_uart_dma_tx(port);
+
+	spin_unlock_irqrestore(&port->lock, flags);
+}
+
+/**
+ * cdns_uart_dma_tx - Queue the pending transmit bytes to the DMA channel
+ * @port: Handle to the uart port structure
+ *
+ * Only the contiguous part of the circular buffer is queued, the rest
+ * follows from the completion callback. Must be called with the port lock
+ * held.
+ */
+static void cdns_uart_dma_tx(struct uart_port *port)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+	struct circ_buf *xmit = &port->state->xmit;
+	struct device *dma_dev = cdns_uart->tx_chan->device->dev;
+	struct dma_async_tx_descriptor *desc;
+	unsigned int len;
+
+	if (cdns_uart->tx_len || uart_tx_stopped(port) || uart_circ_empty(xmit))
+		return;
+
+	len = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+	dma_sync_single_for_device(dma_dev, cdns_uart->tx_dma + xmit->tail,
+				   len, DMA_TO_DEVICE);
+
+	desc = dmaengine_prep_slave_single(cdns_uart->tx_chan,
+					   cdns_uart->tx_dma + xmit->tail, len,
+					   DMA_MEM_TO_DEV, DMA_PREP_INTERRUPT);
+	if (!desc)
+		return;
+
+	desc->callback = cdns_uart_dma_tx_done;
+	desc->callback_param = port;
+	cdns_uart->tx_len = len;
+	dmaengine_submit(desc);
+	dma_async_issue_pending(cdns_uart->tx_chan);
+}
+
 /**
  * cdns_uart_isr - Interrupt handler
  * @irq: Irq number
@@ -353,7 +576,9 @@ static void cdns_uart_handle_tx(void *dev_id)
 static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 {
 	struct uart_port *port = (struct uart_port *)dev_id;
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned int isrstatus;
+	u64 start;
 
 	spin_lock(&port->lock);
 
@@ -364,6 +589,7 @@ static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 	writel(isrstatus, port->membase + CDNS_UART_ISR);
 
 	if (isrstatus & CDNS_UART_IXR_TXEMPTY) {
+		cdns_uart->stats.tx_irqs++;
 		cdns_uart_handle_tx(dev_id);
 		isrstatus &= ~CDNS_UART_IXR_TXEMPTY;
 	}
@@ -375,8 +601,17 @@ static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 	 * as read bytes will not be removed from the FIFO.
 	 */
 	if (isrstatus & CDNS_UART_IXR_RXMASK &&
-	    !(readl(port->membase + CDNS_UART_CR) & CDNS_UART_CR_RX_DIS))
-		cdns_uart_handle_rx(dev_id, isrstatus);
+	    !(readl(port->membase + CDNS_UART_CR) & CDNS_UART_CR_RX_DIS)) {
+		start = ktime_get_ns();
+		cdns_uart->stats.rx_irqs++;
+		if (cdns_uart->rx_dma_running)
+			cdns_uart_handle_rx_dma(port, isrstatus);
+		else
+			cdns_uart_handle_rx(dev_id, isrstatus);
+		cdns_uart->stats.rx_latency_max_ns =
+			max(cdns_uart->stats.rx_latency_max_ns,
+			    ktime_get_ns() - start);
+	}
 
 	spin_unlock(&port->lock);
 	return IRQ_HANDLED;
@@ -579,6 +814,7 @@ static int cdns_uart_clk_notifier_cb(struct notifier_block *nb,
  */
 static void cdns_uart_start_tx(struct uart_port *port)
 {
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned int status;
 
 	if (uart_tx_stopped(port))
@@ -593,6 +829,11 @@ static void cdns_uart_start_tx(struct uart_port *port)
 	status |= CDNS_UART_CR_TX_EN;
 	writel(status, port->membase + CDNS_UART_CR);
 
+	if (cdns_uart->tx_chan) {
+		cdns_uart_dma_tx(port);
+		return;
+	}
+
 	if (uart_circ_empty(&port->state->xmit))
 		return;
 
@@ -618,6 +859,20 @@ static void cdns_uart_stop_tx(struct uart_port *port)
 	writel(regval, port->membase + CDNS_UART_CR);
 }
 
+/**
+ * cdns_uart_flush_buffer - Drop the transmit DMA transfer in flight
+ * @port: Handle to the uart port structure
+ */
+static void cdns_uart_flush_buffer(struct uart_port *port)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+
+	if (cdns_uart->tx_chan && cdns_uart->tx_len) {
+		dmaengine_terminate_async(cdns_uart->tx_chan);
+		cdns_uart->tx_len = 0;
+	}
+}
+
 /**
  * cdns_uart_stop_rx - Stop RX
  * @port: Handle to the uart port structure
@@ -819,6 +1074,8 @@ static int cdns_uart_startup(struct uart_port *port)
 	int ret;
 	unsigned long flags;
 	unsigned int status = 0;
+	struct device *dma_dev;
+	u32 rx_irqs;
 
 	is_brk_support = cdns_uart->quirks & CDNS_UART_RXBS_SUPPORT;
 
@@ -879,12 +1136,32 @@ static int cdns_uart_startup(struct uart_port *port)
 		return ret;
 	}
 
+	rx_irqs = CDNS_UART_RX_IRQS;
+	if (cdns_uart->tx_chan) {
+		dma_dev = cdns_uart->tx_chan->device->dev;
+		cdns_uart->tx_dma = dma_map_single(dma_dev,
+						   port->state->xmit.buf,
+						   UART_XMIT_SIZE,
+						   DMA_TO_DEVICE);
+		if (dma_mapping_error(dma_dev, cdns_uart->tx_dma)) {
+			free_irq(port->irq, port);
+			return -ENOMEM;
+		}
+
+		spin_lock_irqsave(&port->lock, flags);
+		if (!cdns_uart_dma_rx_start(port))
+			rx_irqs = CDNS_UART_DMA_RX_IRQS;
+		else
+			dev_warn(port->dev, "receiving without DMA\n");
+		spin_unlock_irqrestore(&port->lock, flags);
+	}
+
 	/* Set the Interrupt Registers with desired interrupts */
 	if (is_brk_support)
-		writel(CDNS_UART_RX_IRQS | CDNS_UART_IXR_BRK,
+		writel(rx_irqs | CDNS_UART_IXR_BRK,
 					port->membase + CDNS_UART_IER);
 	else
-		writel(CDNS_UART_RX_IRQS, port->membase + CDNS_UART_IER);
+		writel(rx_irqs, port->membase + CDNS_UART_IER);
 
 	return 0;
 }
@@ -895,6 +1172,7 @@ static int cdns_uart_startup(struct uart_port *port)
  */
 static void cdns_uart_shutdown(struct uart_port *port)
 {
+	struct cdns_uart *cdns_uart = port->private_data;
 	int status;
 	unsigned long flags;
 
@@ -912,6 +1190,16 @@ static void cdns_uart_shutdown(struct uart_port *port)
 	spin_unlock_irqrestore(&port->lock, flags);
 
 	free_irq(port->irq, port);
+
+	if (cdns_uart->tx_chan) {
+		dmaengine_terminate_sync(cdns_uart->rx_chan);
+		dmaengine_terminate_sync(cdns_uart->tx_chan);
+		cdns_uart->rx_dma_running = false;
+		cdns_uart->tx_len = 0;
+		dma_unmap_single(cdns_uart->tx_chan->device->dev,
+				 cdns_uart->tx_dma, UART_XMIT_SIZE,
+				 DMA_TO_DEVICE);
+	}
 }
 
 /**
@@ -1122,6 +1410,7 @@ static const struct uart_ops cdns_uart_ops = {
 	.set_termios	= cdns_uart_set_termios,
 	.startup	= cdns_uart_startup,
 	.shutdown	= cdns_uart_shutdown,
+	.flush_buffer	= cdns_uart_flush_buffer,
 	.pm		= cdns_uart_pm,
 	.type		= cdns_uart_type,
 	.verify_port	= cdns_uart_verify_port,
@@ -1468,6 +1757,131 @@ MODULE_DEVICE_TABLE(of, cdns_uart_of_match);
 /* Temporary variable for storing number of instances */
 static int instances;
 
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+	struct uart_port *port = state->uart_port;
+	struct cdns_uart *cdns_uart = port->private_data;
+	struct cdns_uart_stats stats;
+	struct uart_icount icount;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+	stats = cdns_uart->stats;
+	icount = port->icount;
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return sysfs_emit(buf,
+			  "rx_irqs: %llu\ntx_irqs: %llu\nrx_dma_bytes: %llu\n"
+			  "tx_dma_bytes: %llu\nrx_idle_flushes: %llu\n"
+			  "overrun: %u\nbuf_overrun: %u\n"
+			  "rx_latency_max_ns: %llu\n",
+			  stats.rx_irqs, stats.tx_irqs, stats.rx_dma_bytes,
+			  stats.tx_dma_bytes, stats.rx_idle_flushes,
+			  icount.overrun, icount.buf_overrun,
+			  stats.rx_latency_max_ns);
+}
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *cdns_uart_attrs[] = {
+	&dev_attr_stats.attr,
+	NULL,
+};
+
+static const struct attribute_group cdns_uart_attr_group = {
+	.attrs = cdns_uart_attrs,
+};
+
+/**
+ * cdns_uart_dma_release - Release the DMA channels
+ * @cdns_uart: Handle to the driver data
+ */
+static void cdns_uart_dma_release(struct cdns_uart *cdns_uart)
+{
+	if (cdns_uart->rx_buf)
+		dma_free_coherent(cdns_uart->rx_chan->device->dev,
+				  CDNS_UART_DMA_RX_SIZE, cdns_uart->rx_buf,
+				  cdns_uart->rx_dma);
+	if (cdns_uart->rx_chan)
+		dma_release_channel(cdns_uart->rx_chan);
+	if (cdns_uart->tx_chan)
+		dma_release_channel(cdns_uart->tx_chan);
+	cdns_uart->rx_buf = NULL;
+	cdns_uart->rx_chan = NULL;
+	cdns_uart->tx_chan = NULL;
+}
+
+/**
+ * cdns_uart_dma_probe - Request the optional DMA channels
+ * @cdns_uart: Handle to the driver data
+ * @dev: Pointer to the device structure
+ * @fifo: Physical address of the FIFO register
+ *
+ * The FIFO is only moved by DMA when both the "rx" and "tx" channels are
+ * described, and the receive channel reports its progress finer than per
+ * descriptor. The port falls back to interrupt driven transfers otherwise.
+ *
+ * Return: 0 on success or fallback, -EPROBE_DEFER if a channel is not ready
+ */
+static int cdns_uart_dma_probe(struct cdns_uart *cdns_uart,
+			       struct device *dev, phys_addr_t fifo)
+{
+	struct dma_slave_config config = {
+		.src_addr = fifo,
+		.dst_addr = fifo,
+		.src_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE,
+		.dst_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE,
+		.src_maxburst = 1,
+		.dst_maxburst = 1,
+	};
+	struct dma_slave_caps caps;
+	struct dma_chan *chan;
+	int ret;
+
+	chan = dma_request_chan(dev, "rx");
+	if (IS_ERR(chan))
+		return PTR_ERR(chan) == -EPROBE_DEFER ? -EPROBE_DEFER : 0;
+	cdns_uart->rx_chan = chan;
+
+	chan = dma_request_chan(dev, "tx");
+	if (IS_ERR(chan)) {
+		ret = PTR_ERR(chan) == -EPROBE_DEFER ? -EPROBE_DEFER : 0;
+		goto release;
+	}
+	cdns_uart->tx_chan = chan;
+
+	ret = dma_get_slave_caps(cdns_uart->rx_chan, &caps);
+	if (ret || caps.residue_granularity ==
+		   DMA_RESIDUE_GRANULARITY_DESCRIPTOR)
+		goto fallback;
+
+	config.direction = DMA_DEV_TO_MEM;
+	if (dmaengine_slave_config(cdns_uart->rx_chan, &config))
+		goto fallback;
+	config.direction = DMA_MEM_TO_DEV;
+	if (dmaengine_slave_config(cdns_uart->tx_chan, &config))
+		goto fallback;
+
+	cdns_uart->rx_buf = dma_alloc_coherent(cdns_uart->rx_chan->device->dev,
+					       CDNS_UART_DMA_RX_SIZE,
+					       &cdns_uart->rx_dma, GFP_KERNEL);
+	if (!cdns_uart->rx_buf)
+		goto fallback;
+
+	dev_info(dev, "using DMA\n");
+
+	return 0;
+
+fallback:
+	ret = 0;
+	dev_warn(dev, "DMA channels not usable, using interrupts\n");
+release:
+	cdns_uart_dma_release(cdns_uart);
+	return ret;
+}
+
 /**
  * cdns_uart_probe - Platform driver probe
  * @pdev: Pointer to the platform device structure
@@ -1610,9 +2024,15 @@ static int cdns_uart_probe(struct platform_device *pdev)
 	port->private_data = cdns_uart_data;
 	port->read_status_mask = CDNS_UART_IXR_TXEMPTY | CDNS_UART_IXR_RXTRIG |
 			CDNS_UART_IXR_OVERRUN | CDNS_UART_IXR_TOUT;
+	port->attr_group = &cdns_uart_attr_group;
 	cdns_uart_data->port = port;
 	platform_set_drvdata(pdev, port);
 
+	rc = cdns_uart_dma_probe(cdns_uart_data, &pdev->dev,
+				 res->start + CDNS_UART_FIFO);
+	if (rc)
+		goto err_out_clk_notifier;
+
 	pm_runtime_use_autosuspend(&pdev->dev);
 	pm_runtime_set_autosuspend_delay(&pdev->dev, UART_AUTOSUSPEND_TIMEOUT);
 	pm_runtime_set_active(&pdev->dev);
@@ -1659,6 +2079,8 @@ static int cdns_uart_probe(struct platform_device *pdev)
 	pm_runtime_disable(&pdev->dev);
 	pm_runtime_set_suspended(&pdev->dev);
 	pm_runtime_dont_use_autosuspend(&pdev->dev);
+	cdns_uart_dma_release(cdns_uart_data);
+err_out_clk_notifier:
 #ifdef CONFIG_COMMON_CLK
 	clk_notifier_unregister(cdns_uart_data->uartclk,
 			&cdns_uart_data->clk_rate_change_nb);
@@ -1692,6 +2114,7 @@ static int cdns_uart_remove(struct platform_device *pdev)
 #endif
 	rc = uart_remove_one_port(cdns_uart_data->cdns_uart_driver, port);
 	port->mapbase = 0;
+	cdns_uart_dma_release(cdns_uart_data);
 	clk_disable_unprepare(cdns_uart_data->uartclk);
 	clk_disable_unprepare(cdns_uart_data->pclk);
 	pm_runtime_disable(&pdev->dev);
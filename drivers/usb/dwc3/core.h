@@ -701,6 +701,29 @@ struct dwc3_event_buffer {
 
 #define DWC3_TRB_NUM		256
 
+/**
+ * struct dwc3_ep_stats - endpoint command and throughput statistics
+ * @start_cmds: number of Start Transfer commands
+ * @update_cmds: number of Update Transfer commands
+ * @end_cmds: number of End Transfer commands
+ * @deferred_kicks: number of queued requests left for the next completion
+ *		to prepare
+ * @reqs: number of requests completed successfully
+ * @bytes: number of bytes transferred by @reqs
+ * @first_ns: time of the first completion since the endpoint was enabled
+ * @last_ns: time of the last completion
+ */
+struct dwc3_ep_stats {
+	u64			start_cmds;
+	u64			update_cmds;
+	u64			end_cmds;
+	u64			deferred_kicks;
+	u64			reqs;
+	u64			bytes;
+	u64			first_ns;
+	u64			last_ns;
+};
+
 /**
  * struct dwc3_ep - device side endpoint representation
  * @endpoint: usb endpoint
@@ -727,6 +750,7 @@ struct dwc3_event_buffer {
  *		isochronous START TRANSFER command failure workaround
  * @start_cmd_status: the status of testing START TRANSFER command with
  *		combo_num = 'b00
+ * @stats: command and throughput statistics, reset when enabled
  */
 struct dwc3_ep {
 	struct usb_ep		endpoint;
@@ -786,6 +810,8 @@ struct dwc3_ep {
 	/* For isochronous START TRANSFER workaround only */
 	u8			combo_num;
 	int			start_cmd_status;
+
+	struct dwc3_ep_stats	stats;
 };
 
 enum dwc3_phy {
@@ -17,6 +17,7 @@
 #include <linux/seq_file.h>
 #include <linux/delay.h>
 #include <linux/uaccess.h>
+#include <linux/math64.h>
 
 #include <linux/usb/ch9.h>
 
@@ -896,6 +897,36 @@ static int dwc3_ep_info_register_show(struct seq_file *s, void *unused)
 	return 0;
 }
 
+static int dwc3_ep_stats_show(struct seq_file *s, void *unused)
+{
+	struct dwc3_ep		*dep = s->private;
+	struct dwc3		*dwc = dep->dwc;
+	struct dwc3_ep_stats	stats;
+	unsigned long		flags;
+	u64			kicks;
+	u64			elapsed;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	stats = dep->stats;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	kicks = stats.start_cmds + stats.update_cmds;
+	elapsed = stats.last_ns - stats.first_ns;
+
+	seq_printf(s, "start_transfer: %llu\n", stats.start_cmds);
+	seq_printf(s, "update_transfer: %llu\n", stats.update_cmds);
+	seq_printf(s, "end_transfer: %llu\n", stats.end_cmds);
+	seq_printf(s, "deferred_kicks: %llu\n", stats.deferred_kicks);
+	seq_printf(s, "requests: %llu\n", stats.reqs);
+	seq_printf(s, "requests_per_kick: %llu\n",
+		   kicks ? div64_u64(stats.reqs, kicks) : 0);
+	seq_printf(s, "bytes: %llu\n", stats.bytes);
+	seq_printf(s, "throughput_kBps: %llu\n",
+		   elapsed ? div64_u64(stats.bytes * USEC_PER_SEC, elapsed) : 0);
+
+	return 0;
+}
+
 DEFINE_SHOW_ATTRIBUTE(dwc3_tx_fifo_size);
 DEFINE_SHOW_ATTRIBUTE(dwc3_rx_fifo_size);
 DEFINE_SHOW_ATTRIBUTE(dwc3_tx_request_queue);
@@ -906,6 +937,7 @@ DEFINE_SHOW_ATTRIBUTE(dwc3_event_queue);
 DEFINE_SHOW_ATTRIBUTE(dwc3_transfer_type);
 DEFINE_SHOW_ATTRIBUTE(dwc3_trb_ring);
 DEFINE_SHOW_ATTRIBUTE(dwc3_ep_info_register);
+DEFINE_SHOW_ATTRIBUTE(dwc3_ep_stats);
 
 static const struct dwc3_ep_file_map dwc3_ep_file_map[] = {
 	{ "tx_fifo_size", &dwc3_tx_fifo_size_fops, },
@@ -918,6 +950,7 @@ static const struct dwc3_ep_file_map dwc3_ep_file_map[] = {
 	{ "transfer_type", &dwc3_transfer_type_fops, },
 	{ "trb_ring", &dwc3_trb_ring_fops, },
 	{ "GDBGEPINFO", &dwc3_ep_info_register_fops, },
+	{ "stats", &dwc3_ep_stats_fops, },
 };
 
 static void dwc3_debugfs_create_endpoint_files(struct dwc3_ep *dep,
@@ -18,6 +18,7 @@
 #include <linux/io.h>
 #include <linux/list.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
@@ -30,6 +31,9 @@
 #define DWC3_ALIGN_FRAME(d, n)	(((d)->frame_number + ((d)->interval * (n))) \
 					& ~((d)->interval - 1))
 
+/* TRBs left to the controller above which new requests wait to be batched */
+#define DWC3_KICK_BATCH_TRBS	(DWC3_TRB_NUM / 8)
+
 /**
  * dwc3_gadget_set_test_mode - enables usb2 test modes
  * @dwc: pointer to our context structure
@@ -216,6 +220,14 @@ void dwc3_gadget_giveback(struct dwc3_ep *dep, struct dwc3_request *req,
 	dwc3_gadget_del_and_unmap_request(dep, req, status);
 	req->status = DWC3_REQUEST_STATUS_COMPLETED;
 
+	if (!status && dep->number > 1) {
+		dep->stats.last_ns = ktime_get_ns();
+		if (!dep->stats.first_ns)
+			dep->stats.first_ns = dep->stats.last_ns;
+		dep->stats.reqs++;
+		dep->stats.bytes += req->request.actual;
+	}
+
 	spin_unlock(&dwc->lock);
 	usb_gadget_giveback_request(&dep->endpoint, &req->request);
 	spin_lock(&dwc->lock);
@@ -368,6 +380,18 @@ int dwc3_send_gadget_ep_cmd(struct dwc3_ep *dep, unsigned int cmd,
 	else
 		cmd |= DWC3_DEPCMD_CMDACT;
 
+	switch (DWC3_DEPCMD_CMD(cmd)) {
+	case DWC3_DEPCMD_STARTTRANSFER:
+		dep->stats.start_cmds++;
+		break;
+	case DWC3_DEPCMD_UPDATETRANSFER:
+		dep->stats.update_cmds++;
+		break;
+	case DWC3_DEPCMD_ENDTRANSFER:
+		dep->stats.end_cmds++;
+		break;
+	}
+
 	dwc3_writel(dep->regs, DWC3_DEPCMD, cmd);
 
 	if (!(cmd & DWC3_DEPCMD_CMDACT) ||
@@ -898,6 +922,7 @@ int __dwc3_gadget_ep_enable(struct dwc3_ep *dep, unsigned int action)
 
 		dep->type = usb_endpoint_type(desc);
 		dep->flags |= DWC3_EP_ENABLED;
+		memset(&dep->stats, 0, sizeof(dep->stats));
 
 		reg = dwc3_readl(dwc->regs, DWC3_DALEPENA);
 		reg |= DWC3_DALEPENA_EP(dep->number);
@@ -1939,6 +1964,35 @@ static int __dwc3_gadget_start_isoc(struct dwc3_ep *dep)
 	return ret;
 }
 
+/*
+ * While the controller still has plenty of TRBs to process, a new request can
+ * stay on the pending list: the next completion prepares it along with the
+ * other requests queued in the meantime and issues a single Update Transfer.
+ * That completion is only reported if the last started request interrupts.
+ */
+static bool dwc3_gadget_ep_defer_kick(struct dwc3_ep *dep)
+{
+	const struct usb_endpoint_descriptor *desc = dep->endpoint.desc;
+	struct dwc3_request	*req;
+
+	if (!usb_endpoint_xfer_bulk(desc) && !usb_endpoint_xfer_isoc(desc))
+		return false;
+
+	if (dep->stream_capable || !(dep->flags & DWC3_EP_TRANSFER_STARTED) ||
+	    (dep->flags & DWC3_EP_PENDING_REQUEST))
+		return false;
+
+	if (list_empty(&dep->started_list))
+		return false;
+
+	req = list_last_entry(&dep->started_list, struct dwc3_request, list);
+	if (req->request.no_interrupt || req->num_pending_sgs)
+		return false;
+
+	return DWC3_TRB_NUM - 1 - dwc3_calc_trbs_left(dep) >=
+		DWC3_KICK_BATCH_TRBS;
+}
+
 static void dwc3_gadget_wakeup_interrupt(struct dwc3 *dwc);
 static int __dwc3_gadget_ep_queue(struct dwc3_ep *dep, struct dwc3_request *req)
 {
@@ -2025,6 +2079,11 @@ static int __dwc3_gadget_ep_queue(struct dwc3_ep *dep, struct dwc3_request *req)
 		}
 	}
 
+	if (dwc3_gadget_ep_defer_kick(dep)) {
+		dep->stats.deferred_kicks++;
+		return 0;
+	}
+
 	__dwc3_gadget_kick_transfer(dep);
 
 	return 0;
@@ -3524,7 +3583,8 @@ static bool dwc3_gadget_endpoint_trbs_complete(struct dwc3_ep *dep,
 		return no_started_trb;
 
 	if (usb_endpoint_xfer_isoc(dep->endpoint.desc) &&
-	    list_empty(&dep->started_list)) {
+	    list_empty(&dep->started_list) &&
+	    (list_empty(&dep->pending_list) || status == -EXDEV)) {
 		if (list_empty(&dep->pending_list))
 			/*
 			 * If there is no entry in request list then do
@@ -3533,7 +3593,7 @@ static bool dwc3_gadget_endpoint_trbs_complete(struct dwc3_ep *dep,
 			 * entry is added into request list.
 			 */
 			dep->flags |= DWC3_EP_PENDING_REQUEST;
-		else if (status == -EXDEV)
+		else
 			dwc3_stop_active_transfer(dep, true, true);
 	} else if (dwc3_gadget_ep_should_continue(dep))
 		if (__dwc3_gadget_kick_transfer(dep) == 0)
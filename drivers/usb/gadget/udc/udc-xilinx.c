@@ -12,6 +12,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
@@ -23,6 +24,9 @@
 #include <linux/of_platform.h>
 #include <linux/of_irq.h>
 #include <linux/prefetch.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/usb.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 
@@ -112,11 +116,34 @@
  * @usb_req: Linux usb request structure
  * @queue: usb device request queue
  * @ep: pointer to xusb_endpoint structure
+ * @sg: segment of a scatter-gather request being transferred
+ * @sg_pos: offset of @sg in the request
  */
 struct xusb_req {
 	struct usb_request usb_req;
 	struct list_head queue;
 	struct xusb_ep *ep;
+	struct scatterlist *sg;
+	u32 sg_pos;
+};
+
+/**
+ * struct xusb_ep_stats - Endpoint transfer statistics
+ * @reqs: number of requests completed successfully
+ * @bytes: number of bytes of the successful requests
+ * @errors: number of requests completed with an error
+ * @chained: number of requests started in the interrupt completing the
+ *	     previous one
+ * @first_ns: completion time of the first request
+ * @last_ns: completion time of the last request
+ */
+struct xusb_ep_stats {
+	u64 reqs;
+	u64 bytes;
+	u64 errors;
+	u64 chained;
+	u64 first_ns;
+	u64 last_ns;
 };
 
 /**
@@ -137,6 +164,7 @@ struct xusb_req {
  * @buffer1ready: the busy state of second buffer
  * @is_in: endpoint direction (IN or OUT)
  * @is_iso: endpoint type(isochronous or non isochronous)
+ * @stats: transfer statistics
  */
 struct xusb_ep {
 	struct usb_ep ep_usb;
@@ -155,6 +183,7 @@ struct xusb_ep {
 	bool buffer1ready;
 	bool is_in;
 	bool is_iso;
+	struct xusb_ep_stats stats;
 };
 
 /**
@@ -173,6 +202,7 @@ struct xusb_ep {
  * @lock: instance of spinlock
  * @dma_enabled: flag indicating whether the dma is included in the system
  * @clk: pointer to struct clk
+ * @debugfs: debugfs directory of the controller
  * @read_fn: function pointer to read device registers
  * @write_fn: function pointer to write to device registers
  */
@@ -191,6 +221,7 @@ struct xusb_udc {
 	spinlock_t lock;
 	bool dma_enabled;
 	struct clk *clk;
+	struct dentry *debugfs;
 
 	unsigned int (*read_fn)(void __iomem *reg);
 	void (*write_fn)(void __iomem *, u32, u32);
@@ -363,6 +394,80 @@ static int xudc_start_dma(struct xusb_ep *ep, dma_addr_t src,
 	return rc;
 }
 
+/**
+ * xudc_req_dma - Returns the bus address of the data of a request.
+ * @req: pointer to the usb request structure.
+ * @offset: offset of the data in the request.
+ * @length: number of bytes wanted, clamped to the contiguous bytes at @offset.
+ *
+ * Return: the bus address of the data at @offset.
+ *
+ * The scatterlist of the request is walked from the segment of the previous
+ * call, since the data is transferred in order.
+ */
+static dma_addr_t xudc_req_dma(struct xusb_req *req, u32 offset, u32 *length)
+{
+	/* A zero length packet accesses no memory */
+	if (!req->usb_req.num_mapped_sgs || !*length)
+		return req->usb_req.dma + offset;
+
+	while (offset >= req->sg_pos + sg_dma_len(req->sg)) {
+		req->sg_pos += sg_dma_len(req->sg);
+		req->sg = sg_next(req->sg);
+	}
+
+	offset -= req->sg_pos;
+	*length = min(*length, sg_dma_len(req->sg) - offset);
+
+	return sg_dma_address(req->sg) + offset;
+}
+
+/**
+ * xudc_dma_xfer - Copies a packet between a request and an endpoint buffer.
+ * @ep: pointer to the usb device endpoint structure.
+ * @req: pointer to the usb request structure.
+ * @dpram: bus address of the endpoint buffer.
+ * @length: number of bytes of the packet.
+ * @bufbit: buffer ready bit of the endpoint buffer.
+ *
+ * Return: 0 on success, error code on failure
+ *
+ * The packet at @req->actual may span several segments of a scatter-gather
+ * request, each one is copied by a DMA transfer. Only the last transfer hands
+ * the buffer over to the core.
+ */
+static int xudc_dma_xfer(struct xusb_ep *ep, struct xusb_req *req,
+			 dma_addr_t dpram, u32 length, u32 bufbit)
+{
+	struct xusb_udc *udc = ep->udc;
+	u32 dir = ep->is_in ? 0 : XUSB_DMA_READ_FROM_DPRAM;
+	u32 done = 0, chunk;
+	dma_addr_t mem;
+	int rc;
+
+	do {
+		chunk = length - done;
+		mem = xudc_req_dma(req, req->usb_req.actual + done, &chunk);
+
+		if (done + chunk == length)
+			udc->write_fn(udc->addr, XUSB_DMA_CONTROL_OFFSET,
+				      XUSB_DMA_BRR_CTRL | dir | bufbit);
+		else
+			udc->write_fn(udc->addr, XUSB_DMA_CONTROL_OFFSET, dir);
+
+		if (ep->is_in)
+			rc = xudc_start_dma(ep, mem, dpram + done, chunk);
+		else
+			rc = xudc_start_dma(ep, dpram + done, mem, chunk);
+		if (rc)
+			return rc;
+
+		done += chunk;
+	} while (done < length);
+
+	return 0;
+}
+
 /**
  * xudc_dma_send - Sends IN data using DMA.
  * @ep: pointer to the usb device endpoint structure.
@@ -381,20 +486,21 @@ static int xudc_dma_send(struct xusb_ep *ep, struct xusb_req *req,
 	u32 *eprambase;
 	dma_addr_t src;
 	dma_addr_t dst;
+	u32 bufbit;
 	struct xusb_udc *udc = ep->udc;
 
-	src = req->usb_req.dma + req->usb_req.actual;
-	if (req->usb_req.length)
+	if (req->usb_req.length && !req->usb_req.num_mapped_sgs) {
+		src = req->usb_req.dma + req->usb_req.actual;
 		dma_sync_single_for_device(udc->dev, src,
 					   length, DMA_TO_DEVICE);
+	}
 	if (!ep->curbufnum && !ep->buffer0ready) {
 		/* Get the Buffer address and copy the transmit data.*/
 		eprambase = (u32 __force *)(udc->addr + ep->rambase);
 		dst = virt_to_phys(eprambase);
 		udc->write_fn(udc->addr, ep->offset +
 			      XUSB_EP_BUF0COUNT_OFFSET, length);
-		udc->write_fn(udc->addr, XUSB_DMA_CONTROL_OFFSET,
-			      XUSB_DMA_BRR_CTRL | (1 << ep->epnumber));
+		bufbit = 1 << ep->epnumber;
 		ep->buffer0ready = 1;
 		ep->curbufnum = 1;
 	} else if (ep->curbufnum && !ep->buffer1ready) {
@@ -404,9 +510,7 @@ static int xudc_dma_send(struct xusb_ep *ep, struct xusb_req *req,
 		dst = virt_to_phys(eprambase);
 		udc->write_fn(udc->addr, ep->offset +
 			      XUSB_EP_BUF1COUNT_OFFSET, length);
-		udc->write_fn(udc->addr, XUSB_DMA_CONTROL_OFFSET,
-			      XUSB_DMA_BRR_CTRL | (1 << (ep->epnumber +
-			      XUSB_STATUS_EP_BUFF2_SHIFT)));
+		bufbit = 1 << (ep->epnumber + XUSB_STATUS_EP_BUFF2_SHIFT);
 		ep->buffer1ready = 1;
 		ep->curbufnum = 0;
 	} else {
@@ -414,7 +518,7 @@ static int xudc_dma_send(struct xusb_ep *ep, struct xusb_req *req,
 		return -EAGAIN;
 	}
 
-	return xudc_start_dma(ep, src, dst, length);
+	return xudc_dma_xfer(ep, req, dst, length, bufbit);
 }
 
 /**
@@ -434,17 +538,14 @@ static int xudc_dma_receive(struct xusb_ep *ep, struct xusb_req *req,
 {
 	u32 *eprambase;
 	dma_addr_t src;
-	dma_addr_t dst;
+	u32 bufbit;
 	struct xusb_udc *udc = ep->udc;
 
-	dst = req->usb_req.dma + req->usb_req.actual;
 	if (!ep->curbufnum && !ep->buffer0ready) {
 		/* Get the Buffer address and copy the transmit data */
 		eprambase = (u32 __force *)(udc->addr + ep->rambase);
 		src = virt_to_phys(eprambase);
-		udc->write_fn(udc->addr, XUSB_DMA_CONTROL_OFFSET,
-			      XUSB_DMA_BRR_CTRL | XUSB_DMA_READ_FROM_DPRAM |
-			      (1 << ep->epnumber));
+		bufbit = 1 << ep->epnumber;
 		ep->buffer0ready = 1;
 		ep->curbufnum = 1;
 	} else if (ep->curbufnum && !ep->buffer1ready) {
@@ -452,10 +553,7 @@ static int xudc_dma_receive(struct xusb_ep *ep, struct xusb_req *req,
 		eprambase = (u32 __force *)(udc->addr +
 			     ep->rambase + ep->ep_usb.maxpacket);
 		src = virt_to_phys(eprambase);
-		udc->write_fn(udc->addr, XUSB_DMA_CONTROL_OFFSET,
-			      XUSB_DMA_BRR_CTRL | XUSB_DMA_READ_FROM_DPRAM |
-			      (1 << (ep->epnumber +
-			      XUSB_STATUS_EP_BUFF2_SHIFT)));
+		bufbit = 1 << (ep->epnumber + XUSB_STATUS_EP_BUFF2_SHIFT);
 		ep->buffer1ready = 1;
 		ep->curbufnum = 0;
 	} else {
@@ -463,7 +561,7 @@ static int xudc_dma_receive(struct xusb_ep *ep, struct xusb_req *req,
 		return -EAGAIN;
 	}
 
-	return xudc_start_dma(ep, src, dst, length);
+	return xudc_dma_xfer(ep, req, src, length, bufbit);
 }
 
 /**
@@ -560,6 +658,16 @@ static void xudc_done(struct xusb_ep *ep, struct xusb_req *req, int status)
 	if (status && status != -ESHUTDOWN)
 		dev_dbg(udc->dev, "%s done %p, status %d\n",
 			ep->ep_usb.name, req, status);
+
+	if (!status) {
+		ep->stats.last_ns = ktime_get_ns();
+		if (!ep->stats.reqs++)
+			ep->stats.first_ns = ep->stats.last_ns;
+		ep->stats.bytes += req->usb_req.actual;
+	} else if (status != -ESHUTDOWN) {
+		ep->stats.errors++;
+	}
+
 	/* unmap request if DMA is present*/
 	if (udc->dma_enabled && ep->epnumber && req->usb_req.length)
 		usb_gadget_unmap_request(&udc->gadget, &req->usb_req,
@@ -635,7 +743,8 @@ static int xudc_read_fifo(struct xusb_ep *ep, struct xusb_req *req)
 
 		/* Completion */
 		if ((req->usb_req.actual == req->usb_req.length) || is_short) {
-			if (udc->dma_enabled && req->usb_req.length)
+			if (udc->dma_enabled && req->usb_req.length &&
+			    !req->usb_req.num_mapped_sgs)
 				dma_sync_single_for_cpu(udc->dev,
 							req->usb_req.dma,
 							req->usb_req.actual,
@@ -724,6 +833,50 @@ static int xudc_write_fifo(struct xusb_ep *ep, struct xusb_req *req)
 	return retval;
 }
 
+/**
+ * xudc_ep_buf_available - Checks the next ping-pong buffer of an endpoint.
+ * @ep: pointer to the usb device endpoint structure.
+ *
+ * Return: true if the buffer to process next is free for an IN endpoint or
+ *	   holds a packet for an OUT endpoint.
+ */
+static bool xudc_ep_buf_available(struct xusb_ep *ep)
+{
+	return ep->curbufnum ? !ep->buffer1ready : !ep->buffer0ready;
+}
+
+/**
+ * xudc_ep_kick - Processes the queued requests of an endpoint.
+ * @ep: pointer to the usb device endpoint structure.
+ *
+ * Keeps filling or draining the ping-pong buffers as long as one is
+ * available, moving on to the next queued request as soon as one completes.
+ * The requests chain without waiting for another buffer completion
+ * interrupt between them.
+ */
+static void xudc_ep_kick(struct xusb_ep *ep)
+{
+	struct xusb_req *req;
+	bool completed = false;
+	int ret;
+
+	while (!list_empty(&ep->queue) && xudc_ep_buf_available(ep)) {
+		if (completed)
+			ep->stats.chained++;
+
+		req = list_first_entry(&ep->queue, struct xusb_req, queue);
+		if (ep->is_in)
+			ret = xudc_write_fifo(ep, req);
+		else
+			ret = xudc_read_fifo(ep, req);
+
+		/* An OUT request waits for the next packet */
+		if (ret && !ep->is_in)
+			break;
+		completed = !ret;
+	}
+}
+
 /**
  * xudc_nuke - Cleans up the data transfer message list.
  * @ep: pointer to the usb device endpoint structure.
@@ -1095,6 +1248,8 @@ static int xudc_ep_queue(struct usb_ep *_ep, struct usb_request *_req,
 
 	_req->status = -EINPROGRESS;
 	_req->actual = 0;
+	req->sg = _req->sg;
+	req->sg_pos = 0;
 
 	if (udc->dma_enabled) {
 		ret = usb_gadget_map_request(&udc->gadget, &req->usb_req,
@@ -1107,20 +1262,9 @@ static int xudc_ep_queue(struct usb_ep *_ep, struct usb_request *_req,
 		}
 	}
 
-	if (list_empty(&ep->queue)) {
-		if (ep->is_in) {
-			dev_dbg(udc->dev, "xudc_write_fifo from ep_queue\n");
-			if (!xudc_write_fifo(ep, req))
-				req = NULL;
-		} else {
-			dev_dbg(udc->dev, "xudc_read_fifo from ep_queue\n");
-			if (!xudc_read_fifo(ep, req))
-				req = NULL;
-		}
-	}
-
-	if (req != NULL)
-		list_add_tail(&req->queue, &ep->queue);
+	list_add_tail(&req->queue, &ep->queue);
+	if (list_is_singular(&ep->queue))
+		xudc_ep_kick(ep);
 
 	spin_unlock_irqrestore(&udc->lock, flags);
 	return 0;
@@ -1958,7 +2102,6 @@ static void xudc_nonctrl_ep_handler(struct xusb_udc *udc, u8 epnum,
 				    u32 intrstatus)
 {
 
-	struct xusb_req *req;
 	struct xusb_ep *ep;
 
 	ep = &udc->ep[epnum];
@@ -1968,15 +2111,7 @@ static void xudc_nonctrl_ep_handler(struct xusb_udc *udc, u8 epnum,
 	if (intrstatus & (XUSB_STATUS_EP0_BUFF2_COMP_MASK << epnum))
 		ep->buffer1ready = false;
 
-	if (list_empty(&ep->queue))
-		return;
-
-	req = list_first_entry(&ep->queue, struct xusb_req, queue);
-
-	if (ep->is_in)
-		xudc_write_fifo(ep, req);
-	else
-		xudc_read_fifo(ep, req);
+	xudc_ep_kick(ep);
 }
 
 /**
@@ -2047,6 +2182,63 @@ static irqreturn_t xudc_irq(int irq, void *_udc)
 	return IRQ_HANDLED;
 }
 
+static int xudc_ep_stats_show(struct seq_file *s, void *unused)
+{
+	struct xusb_udc *udc = s->private;
+	struct xusb_ep_stats stats;
+	unsigned long flags;
+	u64 span, kbps;
+	int i;
+
+	seq_puts(s, "ep    reqs        bytes       errors  chained     kB/s\n");
+	for (i = 1; i < XUSB_MAX_ENDPOINTS; i++) {
+		spin_lock_irqsave(&udc->lock, flags);
+		stats = udc->ep[i].stats;
+		spin_unlock_irqrestore(&udc->lock, flags);
+
+		/* Throughput between the first and the last completion */
+		span = stats.last_ns - stats.first_ns;
+		kbps = span ? div64_u64(stats.bytes * (NSEC_PER_SEC / 1000),
+					span) : 0;
+
+		seq_printf(s, "%-4s  %-10llu  %-10llu  %-6llu  %-10llu  %llu\n",
+			   udc->ep[i].name, stats.reqs, stats.bytes,
+			   stats.errors, stats.chained, kbps);
+	}
+
+	return 0;
+}
+
+static int xudc_ep_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, xudc_ep_stats_show, inode->i_private);
+}
+
+/* Writing anything resets the statistics */
+static ssize_t xudc_ep_stats_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct xusb_udc *udc = file_inode(file)->i_private;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&udc->lock, flags);
+	for (i = 0; i < XUSB_MAX_ENDPOINTS; i++)
+		memset(&udc->ep[i].stats, 0, sizeof(udc->ep[i].stats));
+	spin_unlock_irqrestore(&udc->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations xudc_ep_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= xudc_ep_stats_open,
+	.read		= seq_read,
+	.write		= xudc_ep_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /**
  * xudc_probe - The device probe function for driver initialization.
  * @pdev: pointer to the platform device structure.
@@ -2096,6 +2288,8 @@ static int xudc_probe(struct platform_device *pdev)
 	}
 
 	udc->dma_enabled = of_property_read_bool(np, "xlnx,has-builtin-dma");
+	/* The DMA copies the requests segment by segment */
+	udc->gadget.sg_supported = udc->dma_enabled;
 
 	/* Setup gadget structure */
 	udc->gadget.ops = &xusb_udc_ops;
@@ -2159,6 +2353,10 @@ static int xudc_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, udc);
 
+	udc->debugfs = debugfs_create_dir(dev_name(&pdev->dev), usb_debug_root);
+	debugfs_create_file("ep_stats", 0644, udc->debugfs, udc,
+			    &xudc_ep_stats_fops);
+
 	dev_vdbg(&pdev->dev, "%s at 0x%08X mapped to %p %s\n",
 		 driver_name, (u32)res->start, udc->addr,
 		 udc->dma_enabled ? "with DMA" : "without DMA");
@@ -2182,6 +2380,7 @@ static int xudc_remove(struct platform_device *pdev)
 {
 	struct xusb_udc *udc = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(udc->debugfs);
 	usb_del_gadget_udc(&udc->gadget);
 	clk_disable_unprepare(udc->clk);
 
@@ -32,6 +32,7 @@ void vhost_iotlb_map_free(struct vhost_iotlb *iotlb,
 	list_del(&map->link);
 	kfree(map);
 	iotlb->nmaps--;
+	iotlb->gen++;
 }
 EXPORT_SYMBOL_GPL(vhost_iotlb_map_free);
 
@@ -91,6 +92,7 @@ int vhost_iotlb_add_range_ctx(struct vhost_iotlb *iotlb,
 	map->opaque = opaque;
 
 	iotlb->nmaps++;
+	iotlb->gen++;
 	vhost_iotlb_itree_insert(map, &iotlb->root);
 
 	INIT_LIST_HEAD(&map->link);
@@ -138,6 +140,7 @@ void vhost_iotlb_init(struct vhost_iotlb *iotlb, unsigned int limit,
 	iotlb->limit = limit;
 	iotlb->nmaps = 0;
 	iotlb->flags = flags;
+	iotlb->gen = 0;
 	INIT_LIST_HEAD(&iotlb->list);
 }
 EXPORT_SYMBOL_GPL(vhost_iotlb_init);
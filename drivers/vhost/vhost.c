@@ -187,12 +187,14 @@ EXPORT_SYMBOL_GPL(vhost_work_init);
 
 /* Init poll structure */
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
-		     __poll_t mask, struct vhost_dev *dev)
+		     __poll_t mask, struct vhost_dev *dev,
+		     struct vhost_virtqueue *vq)
 {
 	init_waitqueue_func_entry(&poll->wait, vhost_poll_wakeup);
 	init_poll_funcptr(&poll->table, vhost_poll_func);
 	poll->mask = mask;
 	poll->dev = dev;
+	poll->vq = vq;
 	poll->wqh = NULL;
 
 	vhost_work_init(&poll->work, fn);
@@ -231,55 +233,107 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_dev_flush(struct vhost_dev *dev)
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
+{
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		wake_up_process(worker->task);
+	}
+}
+
+static void vhost_worker_flush(struct vhost_worker *worker)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
 
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
-	}
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+void vhost_dev_flush(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	unsigned long i;
+
+	xa_for_each(&dev->worker_xa, i, worker)
+		vhost_worker_flush(worker);
 }
 EXPORT_SYMBOL_GPL(vhost_dev_flush);
 
+/* Queue a device wide work on the default worker */
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 {
 	if (!dev->worker)
 		return;
 
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
-	}
+	vhost_worker_queue(dev->worker, work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
+/* Queue a work on the worker of the virtqueue it services */
+void vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
+{
+	struct vhost_worker *worker;
+
+	rcu_read_lock();
+	worker = rcu_dereference(vq->worker);
+	if (worker)
+		vhost_worker_queue(worker, work);
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL_GPL(vhost_vq_work_queue);
+
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->work_list);
+	return dev->worker && !llist_empty(&dev->worker->work_list);
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* Same as vhost_has_work(), for the worker of a virtqueue */
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
+{
+	struct vhost_worker *worker;
+	bool has_work = false;
+
+	rcu_read_lock();
+	worker = rcu_dereference(vq->worker);
+	if (worker && !llist_empty(&worker->work_list))
+		has_work = true;
+	rcu_read_unlock();
+
+	return has_work;
+}
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	if (poll->vq)
+		vhost_vq_work_queue(poll->vq, &poll->work);
+	else
+		vhost_work_queue(poll->dev, &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
+/*
+ * The cached maps may be freed once the IOTLB or memory table changes.
+ * Caller should have vq mutex.
+ */
 static void __vhost_vq_meta_reset(struct vhost_virtqueue *vq)
 {
 	int j;
 
 	for (j = 0; j < VHOST_NUM_ADDRS; j++)
 		vq->meta_iotlb[j] = NULL;
+	for (j = 0; j < VHOST_IOTLB_CACHE_SIZE; j++)
+		vq->iotlb_cache[j] = NULL;
 }
 
 static void vhost_vq_meta_reset(struct vhost_dev *d)
@@ -331,13 +385,17 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 	vq->iotlb = NULL;
 	vhost_vring_call_reset(&vq->call_ctx);
 	__vhost_vq_meta_reset(vq);
+	vq->iotlb_cache_hits = 0;
+	vq->iotlb_cache_misses = 0;
 }
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
+	struct vhost_dev *dev = worker->dev;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
+	u64 start;
 
 	kthread_use_mm(dev->mm);
 
@@ -350,7 +408,7 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
+		node = llist_del_all(&worker->work_list);
 		if (!node)
 			schedule();
 
@@ -361,7 +419,11 @@ static int vhost_worker(void *data)
 			clear_bit(VHOST_WORK_QUEUED, &work->flags);
 			__set_current_state(TASK_RUNNING);
 			kcov_remote_start_common(dev->kcov_handle);
+			start = ktime_get_ns();
 			work->fn(work);
+			WRITE_ONCE(worker->busy_ns, worker->busy_ns +
+				   ktime_get_ns() - start);
+			WRITE_ONCE(worker->works, worker->works + 1);
 			kcov_remote_stop();
 			if (need_resched())
 				schedule();
@@ -474,12 +536,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->iotlb = NULL;
 	dev->mm = NULL;
 	dev->worker = NULL;
+	xa_init_flags(&dev->worker_xa, XA_FLAGS_ALLOC);
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
 	dev->use_worker = use_worker;
 	dev->msg_handler = msg_handler;
-	init_llist_head(&dev->work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -492,11 +554,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vq->indirect = NULL;
 		vq->heads = NULL;
 		vq->dev = dev;
+		RCU_INIT_POINTER(vq->worker, NULL);
 		mutex_init(&vq->mutex);
 		vhost_vq_reset(dev, vq);
 		if (vq->handle_kick)
 			vhost_poll_init(&vq->poll, vq->handle_kick,
-					EPOLLIN, dev);
+					EPOLLIN, dev, vq);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -523,17 +586,219 @@ static void vhost_attach_cgroups_work(struct vhost_work *work)
 	s->ret = cgroup_attach_task_all(s->owner, current);
 }
 
-static int vhost_attach_cgroups(struct vhost_dev *dev)
+static int vhost_attach_cgroups(struct vhost_worker *worker)
 {
 	struct vhost_attach_cgroups_struct attach;
 
 	attach.owner = current;
 	vhost_work_init(&attach.work, vhost_attach_cgroups_work);
-	vhost_work_queue(dev, &attach.work);
-	vhost_dev_flush(dev);
+	vhost_worker_queue(worker, &attach.work);
+	vhost_worker_flush(worker);
 	return attach.ret;
 }
 
+static void vhost_worker_destroy(struct vhost_dev *dev,
+				 struct vhost_worker *worker)
+{
+	WARN_ON(!llist_empty(&worker->work_list));
+	xa_erase(&dev->worker_xa, worker->id);
+	kthread_stop(worker->task);
+	kfree(worker);
+}
+
+static void vhost_workers_free(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	unsigned long i;
+
+	if (!dev->use_worker)
+		return;
+
+	for (i = 0; i < dev->nvqs; i++)
+		RCU_INIT_POINTER(dev->vqs[i]->worker, NULL);
+	/*
+	 * Free the default worker and all the workers created with
+	 * VHOST_NEW_WORKER.
+	 */
+	xa_for_each(&dev->worker_xa, i, worker)
+		vhost_worker_destroy(dev, worker);
+	xa_destroy(&dev->worker_xa);
+	dev->worker = NULL;
+}
+
+static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	struct task_struct *task;
+	u32 id;
+	int ret;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return ERR_PTR(-ENOMEM);
+
+	worker->dev = dev;
+	init_llist_head(&worker->work_list);
+
+	ret = xa_alloc(&dev->worker_xa, &id, worker, xa_limit_32b,
+		       GFP_KERNEL);
+	if (ret < 0)
+		goto free_worker;
+	worker->id = id;
+
+	task = kthread_create(vhost_worker, worker, "vhost-%d", current->pid);
+	if (IS_ERR(task)) {
+		ret = PTR_ERR(task);
+		goto erase_worker;
+	}
+
+	worker->task = task;
+	wake_up_process(task); /* avoid contributing to loadavg */
+
+	ret = vhost_attach_cgroups(worker);
+	if (ret)
+		goto stop_worker;
+
+	return worker;
+
+stop_worker:
+	kthread_stop(task);
+erase_worker:
+	xa_erase(&dev->worker_xa, id);
+free_worker:
+	kfree(worker);
+	return ERR_PTR(ret);
+}
+
+/* Caller must have device mutex */
+static void vhost_vq_attach_worker(struct vhost_virtqueue *vq,
+				   struct vhost_worker *worker)
+{
+	struct vhost_worker *old_worker;
+
+	mutex_lock(&vq->mutex);
+	old_worker = rcu_dereference_protected(vq->worker,
+					       lockdep_is_held(&vq->mutex));
+	rcu_assign_pointer(vq->worker, worker);
+	mutex_unlock(&vq->mutex);
+
+	worker->attachment_cnt++;
+	if (!old_worker)
+		return;
+
+	old_worker->attachment_cnt--;
+	/* Make sure new works are queued on the new worker */
+	synchronize_rcu();
+	/* Make sure the works queued on the old worker are done */
+	vhost_worker_flush(old_worker);
+}
+
+/* Caller must have device mutex */
+static long vhost_worker_ioctl(struct vhost_dev *dev, unsigned int ioctl,
+			       void __user *argp)
+{
+	struct vhost_vring_worker ring_worker;
+	struct vhost_worker_state state;
+	struct vhost_worker_stats stats;
+	struct vhost_worker_cpu cpu;
+	struct vhost_worker *worker;
+	struct vhost_virtqueue *vq;
+	u32 idx;
+
+	if (!dev->use_worker)
+		return -EINVAL;
+
+	switch (ioctl) {
+	case VHOST_NEW_WORKER:
+		worker = vhost_worker_create(dev);
+		if (IS_ERR(worker))
+			return PTR_ERR(worker);
+
+		state.worker_id = worker->id;
+		if (copy_to_user(argp, &state, sizeof(state))) {
+			vhost_worker_destroy(dev, worker);
+			return -EFAULT;
+		}
+		return 0;
+	case VHOST_FREE_WORKER:
+		if (copy_from_user(&state, argp, sizeof(state)))
+			return -EFAULT;
+
+		worker = xa_load(&dev->worker_xa, state.worker_id);
+		if (!worker)
+			return -ENODEV;
+		if (worker == dev->worker || worker->attachment_cnt)
+			return -EBUSY;
+
+		vhost_worker_destroy(dev, worker);
+		return 0;
+	case VHOST_ATTACH_VRING_WORKER:
+	case VHOST_GET_VRING_WORKER:
+		if (copy_from_user(&ring_worker, argp, sizeof(ring_worker)))
+			return -EFAULT;
+		if (ring_worker.index >= dev->nvqs)
+			return -ENOBUFS;
+
+		idx = array_index_nospec(ring_worker.index, dev->nvqs);
+		vq = dev->vqs[idx];
+
+		if (ioctl == VHOST_ATTACH_VRING_WORKER) {
+			worker = xa_load(&dev->worker_xa,
+					 ring_worker.worker_id);
+			if (!worker)
+				return -ENODEV;
+
+			vhost_vq_attach_worker(vq, worker);
+			return 0;
+		}
+
+		mutex_lock(&vq->mutex);
+		worker = rcu_dereference_protected(vq->worker,
+						   lockdep_is_held(&vq->mutex));
+		ring_worker.worker_id = worker->id;
+		mutex_unlock(&vq->mutex);
+
+		if (copy_to_user(argp, &ring_worker, sizeof(ring_worker)))
+			return -EFAULT;
+		return 0;
+	case VHOST_SET_WORKER_CPU:
+		if (copy_from_user(&cpu, argp, sizeof(cpu)))
+			return -EFAULT;
+
+		worker = xa_load(&dev->worker_xa, cpu.worker_id);
+		if (!worker)
+			return -ENODEV;
+
+		/* The worker can't escape the CPUs its owner is allowed */
+		if (cpu.cpu == -1)
+			return set_cpus_allowed_ptr(worker->task,
+						    current->cpus_ptr);
+		if (cpu.cpu < 0 || cpu.cpu >= nr_cpu_ids ||
+		    !cpumask_test_cpu(cpu.cpu, current->cpus_ptr))
+			return -EINVAL;
+
+		return set_cpus_allowed_ptr(worker->task,
+					    cpumask_of(cpu.cpu));
+	case VHOST_GET_WORKER_STATS:
+		if (copy_from_user(&stats, argp, sizeof(stats)))
+			return -EFAULT;
+
+		worker = xa_load(&dev->worker_xa, stats.worker_id);
+		if (!worker)
+			return -ENODEV;
+
+		stats.pid = task_pid_nr(worker->task);
+		stats.busy_ns = READ_ONCE(worker->busy_ns);
+		stats.works = READ_ONCE(worker->works);
+
+		if (copy_to_user(argp, &stats, sizeof(stats)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
 /* Caller should have device mutex */
 bool vhost_dev_has_owner(struct vhost_dev *dev)
 {
@@ -574,8 +839,8 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	struct task_struct *worker;
-	int err;
+	struct vhost_worker *worker;
+	int err, i;
 
 	/* Is there an owner already? */
 	if (vhost_dev_has_owner(dev)) {
@@ -587,31 +852,28 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	dev->kcov_handle = kcov_common_handle();
 	if (dev->use_worker) {
-		worker = kthread_create(vhost_worker, dev,
-					"vhost-%d", current->pid);
+		worker = vhost_worker_create(dev);
 		if (IS_ERR(worker)) {
 			err = PTR_ERR(worker);
 			goto err_worker;
 		}
 
+		/*
+		 * All the virtqueues share the default worker until the owner
+		 * attaches them to the workers it creates.
+		 */
 		dev->worker = worker;
-		wake_up_process(worker); /* avoid contributing to loadavg */
-
-		err = vhost_attach_cgroups(dev);
-		if (err)
-			goto err_cgroup;
+		for (i = 0; i < dev->nvqs; i++)
+			vhost_vq_attach_worker(dev->vqs[i], worker);
 	}
 
 	err = vhost_dev_alloc_iovecs(dev);
 	if (err)
-		goto err_cgroup;
+		goto err_iovecs;
 
 	return 0;
-err_cgroup:
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
-	}
+err_iovecs:
+	vhost_workers_free(dev);
 err_worker:
 	vhost_detach_mm(dev);
 	dev->kcov_handle = 0;
@@ -704,12 +966,8 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
-		dev->kcov_handle = 0;
-	}
+	vhost_workers_free(dev);
+	dev->kcov_handle = 0;
 	vhost_detach_mm(dev);
 }
 EXPORT_SYMBOL_GPL(vhost_dev_cleanup);
@@ -1482,6 +1740,7 @@ static long vhost_set_memory(struct vhost_dev *d, struct vhost_memory __user *m)
 	for (i = 0; i < d->nvqs; ++i) {
 		mutex_lock(&d->vqs[i]->mutex);
 		d->vqs[i]->umem = newumem;
+		__vhost_vq_meta_reset(d->vqs[i]);
 		mutex_unlock(&d->vqs[i]->mutex);
 	}
 
@@ -1598,6 +1857,7 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 	bool pollstart = false, pollstop = false;
 	struct eventfd_ctx *ctx = NULL;
 	u32 __user *idxp = argp;
+	struct vhost_vring_iotlb_stats stats;
 	struct vhost_virtqueue *vq;
 	struct vhost_vring_state s;
 	struct vhost_vring_file f;
@@ -1706,6 +1966,14 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 		if (copy_to_user(argp, &s, sizeof(s)))
 			r = -EFAULT;
 		break;
+	case VHOST_GET_VRING_IOTLB_STATS:
+		stats.index = idx;
+		stats.reserved = 0;
+		stats.hits = vq->iotlb_cache_hits;
+		stats.misses = vq->iotlb_cache_misses;
+		if (copy_to_user(argp, &stats, sizeof(stats)))
+			r = -EFAULT;
+		break;
 	default:
 		r = -ENOIOCTLCMD;
 	}
@@ -1819,6 +2087,14 @@ long vhost_dev_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 		if (ctx)
 			eventfd_ctx_put(ctx);
 		break;
+	case VHOST_NEW_WORKER:
+	case VHOST_FREE_WORKER:
+	case VHOST_ATTACH_VRING_WORKER:
+	case VHOST_GET_VRING_WORKER:
+	case VHOST_SET_WORKER_CPU:
+	case VHOST_GET_WORKER_STATS:
+		r = vhost_worker_ioctl(d, ioctl, argp);
+		break;
 	default:
 		r = -ENOIOCTLCMD;
 		break;
@@ -2046,6 +2322,36 @@ int vhost_vq_init_access(struct vhost_virtqueue *vq)
 }
 EXPORT_SYMBOL_GPL(vhost_vq_init_access);
 
+/*
+ * Look the map of an address up in the maps last used by the virtqueue
+ * before walking the interval tree of the whole device.
+ */
+static const struct vhost_iotlb_map *
+vhost_vq_iotlb_lookup(struct vhost_virtqueue *vq, struct vhost_iotlb *umem,
+		      u64 addr, u64 last)
+{
+	const struct vhost_iotlb_map *map;
+	int i;
+
+	for (i = 0; i < VHOST_IOTLB_CACHE_SIZE; i++) {
+		map = vq->iotlb_cache[i];
+		if (map && map->start <= addr && addr <= map->last) {
+			vq->iotlb_cache_hits++;
+			return map;
+		}
+	}
+
+	vq->iotlb_cache_misses++;
+	map = vhost_iotlb_itree_first(umem, addr, last);
+	if (map && map->start <= addr) {
+		vq->iotlb_cache[vq->iotlb_cache_next] = map;
+		vq->iotlb_cache_next = (vq->iotlb_cache_next + 1) %
+				       VHOST_IOTLB_CACHE_SIZE;
+	}
+
+	return map;
+}
+
 static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			  struct iovec iov[], int iov_size, int access)
 {
@@ -2063,7 +2369,7 @@ static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			break;
 		}
 
-		map = vhost_iotlb_itree_first(umem, addr, addr + len - 1);
+		map = vhost_vq_iotlb_lookup(vq, umem, addr, addr + len - 1);
 		if (map == NULL || map->start > addr) {
 			if (umem != dev->iotlb) {
 				ret = -EFAULT;
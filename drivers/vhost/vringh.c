@@ -34,8 +34,14 @@ static __printf(1,2) __cold void vringh_bad(const char *fmt, ...)
 	}
 }
 
-/* Returns vring->num if empty, -ve on error. */
-static inline int __vringh_get_head(const struct vringh *vrh,
+/*
+ * Returns vring->num if empty, -ve on error.
+ *
+ * The avail index is only read again once the heads it exposed have all
+ * been fetched. The users may move last_avail_idx themselves, which only
+ * keeps the shadow index when it stays within the heads already exposed.
+ */
+static inline int __vringh_get_head(struct vringh *vrh,
 				    int (*getu16)(const struct vringh *vrh,
 						  u16 *val, const __virtio16 *p),
 				    u16 *last_avail_idx)
@@ -43,6 +49,10 @@ static inline int __vringh_get_head(const struct vringh *vrh,
 	u16 avail_idx, i, head;
 	int err;
 
+	if ((u16)(*last_avail_idx - vrh->avail_idx_base) <
+	    (u16)(vrh->avail_idx_shadow - vrh->avail_idx_base))
+		goto available;
+
 	err = getu16(vrh, &avail_idx, &vrh->vring.avail->idx);
 	if (err) {
 		vringh_bad("Failed to access avail idx at %p",
@@ -56,6 +66,10 @@ static inline int __vringh_get_head(const struct vringh *vrh,
 	/* Only get avail ring entries after they have been exposed by guest. */
 	virtio_rmb(vrh->weak_barriers);
 
+	vrh->avail_idx_shadow = avail_idx;
+	vrh->avail_idx_base = *last_avail_idx;
+
+available:
 	i = *last_avail_idx & (vrh->vring.num - 1);
 
 	err = getu16(vrh, &head, &vrh->vring.avail->ring[i]);
@@ -661,6 +675,8 @@ int vringh_init_user(struct vringh *vrh, u64 features,
 	vrh->completed = 0;
 	vrh->last_avail_idx = 0;
 	vrh->last_used_idx = 0;
+	vrh->avail_idx_shadow = 0;
+	vrh->avail_idx_base = 0;
 	vrh->vring.num = num;
 	/* vring expects kernel addresses, but only used via accessors. */
 	vrh->vring.desc = (__force struct vring_desc *)desc;
@@ -935,6 +951,8 @@ int vringh_init_kern(struct vringh *vrh, u64 features,
 	vrh->completed = 0;
 	vrh->last_avail_idx = 0;
 	vrh->last_used_idx = 0;
+	vrh->avail_idx_shadow = 0;
+	vrh->avail_idx_base = 0;
 	vrh->vring.num = num;
 	vrh->vring.desc = desc;
 	vrh->vring.avail = avail;
@@ -1094,13 +1112,54 @@ EXPORT_SYMBOL(vringh_need_notify_kern);
 
 #if IS_REACHABLE(CONFIG_VHOST_IOTLB)
 
+/*
+ * Look the map of @addr up, first in the translations cached by the vringh.
+ * Called with the iotlb_lock held.
+ */
+static const struct vringh_iotlb_cache_entry *
+iotlb_lookup(const struct vringh *cvrh, u64 addr, u64 last)
+{
+	/*
+	 * The accessors take a const vringh, the cache is not part of the
+	 * state they promise not to modify.
+	 */
+	struct vringh *vrh = (struct vringh *)cvrh;
+	struct vringh_iotlb_cache_entry *entry;
+	struct vhost_iotlb_map *map;
+	int i;
+
+	if (vrh->iotlb_cache_gen != vrh->iotlb->gen) {
+		memset(vrh->iotlb_cache, 0, sizeof(vrh->iotlb_cache));
+		vrh->iotlb_cache_gen = vrh->iotlb->gen;
+	}
+
+	for (i = 0; i < VRINGH_IOTLB_CACHE_SIZE; i++) {
+		entry = &vrh->iotlb_cache[i];
+		if (entry->perm && entry->start <= addr && addr <= entry->last)
+			return entry;
+	}
+
+	map = vhost_iotlb_itree_first(vrh->iotlb, addr, last);
+	if (!map || map->start > addr)
+		return NULL;
+
+	entry = &vrh->iotlb_cache[vrh->iotlb_cache_next];
+	vrh->iotlb_cache_next = (vrh->iotlb_cache_next + 1) %
+				VRINGH_IOTLB_CACHE_SIZE;
+	entry->start = map->start;
+	entry->last = map->last;
+	entry->addr = map->addr;
+	entry->perm = map->perm;
+
+	return entry;
+}
+
 static int iotlb_translate(const struct vringh *vrh,
 			   u64 addr, u64 len, u64 *translated,
 			   struct bio_vec iov[],
 			   int iov_size, u32 perm)
 {
-	struct vhost_iotlb_map *map;
-	struct vhost_iotlb *iotlb = vrh->iotlb;
+	const struct vringh_iotlb_cache_entry *map;
 	int ret = 0;
 	u64 s = 0;
 
@@ -1114,9 +1173,8 @@ static int iotlb_translate(const struct vringh *vrh,
 			break;
 		}
 
-		map = vhost_iotlb_itree_first(iotlb, addr,
-					      addr + len - 1);
-		if (!map || map->start > addr) {
+		map = iotlb_lookup(vrh, addr, addr + len - 1);
+		if (!map) {
 			ret = -EINVAL;
 			break;
 		} else if (!(map->perm & perm)) {
@@ -1124,7 +1182,7 @@ static int iotlb_translate(const struct vringh *vrh,
 			break;
 		}
 
-		size = map->size - addr + map->start;
+		size = map->last - addr + 1;
 		pa = map->addr + addr - map->start;
 		pfn = pa >> PAGE_SHIFT;
 		iov[ret].bv_page = pfn_to_page(pfn);
@@ -1336,6 +1394,9 @@ void vringh_set_iotlb(struct vringh *vrh, struct vhost_iotlb *iotlb,
 {
 	vrh->iotlb = iotlb;
 	vrh->iotlb_lock = iotlb_lock;
+	memset(vrh->iotlb_cache, 0, sizeof(vrh->iotlb_cache));
+	vrh->iotlb_cache_next = 0;
+	vrh->iotlb_cache_gen = iotlb ? iotlb->gen : 0;
 }
 EXPORT_SYMBOL(vringh_set_iotlb);
 
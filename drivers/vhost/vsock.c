@@ -58,6 +58,9 @@ struct vhost_vsock {
 
 	u32 guest_cid;
 	bool seqpacket_allow;
+
+	/* Under the mutex of the virtqueue the packets go through */
+	struct vhost_vsock_stats stats;
 };
 
 static u32 vhost_transport_get_local_cid(void)
@@ -206,14 +209,22 @@ vhost_transport_do_send_pkt(struct vhost_vsock *vsock,
 			break;
 		}
 
-		nbytes = copy_to_iter(pkt->buf + pkt->off, payload_len,
-				      &iov_iter);
+		nbytes = virtio_transport_pkt_copy(pkt, pkt->off, payload_len,
+						   &iov_iter);
 		if (nbytes != payload_len) {
 			virtio_transport_free_pkt(pkt);
 			vq_err(vq, "Faulted on copying pkt buf\n");
 			break;
 		}
 
+		if (pkt->pages) {
+			vsock->stats.send_zerocopy_pkts++;
+			vsock->stats.send_zerocopy_bytes += payload_len;
+		} else if (payload_len) {
+			vsock->stats.send_copy_pkts++;
+			vsock->stats.send_copy_bytes += payload_len;
+		}
+
 		/* Deliver to monitoring devices all packets that we
 		 * will transmit.
 		 */
@@ -300,7 +311,7 @@ vhost_transport_send_pkt(struct virtio_vsock_pkt *pkt)
 	list_add_tail(&pkt->list, &vsock->send_pkt_list);
 	spin_unlock_bh(&vsock->send_pkt_list_lock);
 
-	vhost_work_queue(&vsock->dev, &vsock->send_pkt_work);
+	vhost_vq_work_queue(&vsock->vqs[VSOCK_VQ_RX], &vsock->send_pkt_work);
 
 	rcu_read_unlock();
 	return len;
@@ -472,6 +483,7 @@ static struct virtio_transport vhost_transport = {
 	},
 
 	.send_pkt = vhost_transport_send_pkt,
+	.msgzerocopy = true,
 };
 
 static bool vhost_transport_seqpacket_allow(u32 remote_cid)
@@ -539,6 +551,10 @@ static void vhost_vsock_handle_tx_kick(struct vhost_work *work)
 		}
 
 		total_len += sizeof(pkt->hdr) + pkt->len;
+		if (pkt->len) {
+			vsock->stats.recv_copy_pkts++;
+			vsock->stats.recv_copy_bytes += pkt->len;
+		}
 
 		/* Deliver to monitoring devices all received packets */
 		virtio_transport_deliver_tap_pkt(pkt);
@@ -608,7 +624,7 @@ static int vhost_vsock_start(struct vhost_vsock *vsock)
 	/* Some packets may have been queued before the device was started,
 	 * let's kick the send worker to send them.
 	 */
-	vhost_work_queue(&vsock->dev, &vsock->send_pkt_work);
+	vhost_vq_work_queue(&vsock->vqs[VSOCK_VQ_RX], &vsock->send_pkt_work);
 
 	mutex_unlock(&vsock->dev.mutex);
 	return 0;
@@ -850,11 +866,32 @@ static int vhost_vsock_set_features(struct vhost_vsock *vsock, u64 features)
 	return -EFAULT;
 }
 
+static void vhost_vsock_get_stats(struct vhost_vsock *vsock,
+				  struct vhost_vsock_stats *stats)
+{
+	struct vhost_virtqueue *vq;
+
+	vq = &vsock->vqs[VSOCK_VQ_RX];
+	mutex_lock(&vq->mutex);
+	stats->send_zerocopy_pkts = vsock->stats.send_zerocopy_pkts;
+	stats->send_zerocopy_bytes = vsock->stats.send_zerocopy_bytes;
+	stats->send_copy_pkts = vsock->stats.send_copy_pkts;
+	stats->send_copy_bytes = vsock->stats.send_copy_bytes;
+	mutex_unlock(&vq->mutex);
+
+	vq = &vsock->vqs[VSOCK_VQ_TX];
+	mutex_lock(&vq->mutex);
+	stats->recv_copy_pkts = vsock->stats.recv_copy_pkts;
+	stats->recv_copy_bytes = vsock->stats.recv_copy_bytes;
+	mutex_unlock(&vq->mutex);
+}
+
 static long vhost_vsock_dev_ioctl(struct file *f, unsigned int ioctl,
 				  unsigned long arg)
 {
 	struct vhost_vsock *vsock = f->private_data;
 	void __user *argp = (void __user *)arg;
+	struct vhost_vsock_stats stats;
 	u64 guest_cid;
 	u64 features;
 	int start;
@@ -872,6 +909,11 @@ static long vhost_vsock_dev_ioctl(struct file *f, unsigned int ioctl,
 			return vhost_vsock_start(vsock);
 		else
 			return vhost_vsock_stop(vsock, true);
+	case VHOST_VSOCK_GET_STATS:
+		vhost_vsock_get_stats(vsock, &stats);
+		if (copy_to_user(argp, &stats, sizeof(stats)))
+			return -EFAULT;
+		return 0;
 	case VHOST_GET_FEATURES:
 		features = VHOST_VSOCK_FEATURES;
 		if (copy_to_user(argp, &features, sizeof(features)))
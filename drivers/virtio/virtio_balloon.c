@@ -18,6 +18,7 @@
 #include <linux/wait.h>
 #include <linux/mm.h>
 #include <linux/page_reporting.h>
+#include <linux/sizes.h>
 
 /*
  * Balloon device works in 4K page units.  So each page is pointed to by
@@ -26,6 +27,23 @@
  */
 #define VIRTIO_BALLOON_PAGES_PER_PAGE (unsigned int)(PAGE_SIZE >> VIRTIO_BALLOON_PFN_SHIFT)
 #define VIRTIO_BALLOON_ARRAY_PFNS_MAX 256
+
+/*
+ * In huge page mode the balloon is inflated with 2M pages where possible, so
+ * that the host can give back its huge pages whole, and with base pages under
+ * fragmentation. A huge page is reported to the device as the 4K pfns it
+ * spans, in a single request, which the devices merge into one range.
+ */
+#define VIRTIO_BALLOON_HUGE_ORDER get_order(SZ_2M)
+#define VIRTIO_BALLOON_HUGE_PFNS (SZ_2M >> VIRTIO_BALLOON_PFN_SHIFT)
+#define VIRTIO_BALLOON_HUGE_ALLOC_FLAG (GFP_HIGHUSER | __GFP_NORETRY | \
+					__GFP_NOWARN | __GFP_NOMEMALLOC)
+/* Time to fall back to base pages after a failed huge page allocation */
+#define VIRTIO_BALLOON_HUGE_RETRY_DELAY HZ
+
+static bool huge_pages;
+module_param(huge_pages, bool, 0444);
+MODULE_PARM_DESC(huge_pages, "Inflate the balloon with 2M pages when possible (default: false)");
 /* Maximum number of (4k) pages to deflate on OOM notifications. */
 #define VIRTIO_BALLOON_OOM_NR_PAGES 256
 #define VIRTIO_BALLOON_OOM_NOTIFY_PRIORITY 80
@@ -103,9 +121,21 @@ struct virtio_balloon {
 	/* Synchronize access/update to this struct virtio_balloon elements */
 	struct mutex balloon_lock;
 
-	/* The array of pfns we tell the Host about. */
+	/*
+	 * Huge page mode: the huge pages in the balloon, not movable by
+	 * balloon compaction, and when to try allocating them again.
+	 */
+	bool huge_pages;
+	struct list_head huge_page_list;
+	unsigned long huge_retry;
+
+	/*
+	 * The array of pfns we tell the Host about, large enough for a huge
+	 * page. Base pages are told about VIRTIO_BALLOON_ARRAY_PFNS_MAX pfns
+	 * at a time.
+	 */
 	unsigned int num_pfns;
-	__virtio32 pfns[VIRTIO_BALLOON_ARRAY_PFNS_MAX];
+	__virtio32 pfns[VIRTIO_BALLOON_HUGE_PFNS];
 
 	/* Memory statistics */
 	struct virtio_balloon_stat stats[VIRTIO_BALLOON_S_NR];
@@ -201,6 +231,72 @@ static void set_page_pfns(struct virtio_balloon *vb,
 					  page_to_balloon_pfn(page) + i);
 }
 
+static void set_huge_page_pfns(struct virtio_balloon *vb, struct page *page)
+{
+	u32 pfn = page_to_balloon_pfn(page);
+	unsigned int i;
+
+	BUILD_BUG_ON(VIRTIO_BALLOON_HUGE_PFNS < VIRTIO_BALLOON_ARRAY_PFNS_MAX);
+
+	for (i = 0; i < VIRTIO_BALLOON_HUGE_PFNS; i++)
+		vb->pfns[i] = cpu_to_virtio32(vb->vdev, pfn + i);
+	vb->num_pfns = VIRTIO_BALLOON_HUGE_PFNS;
+}
+
+/* Inflate the balloon with one huge page, returns the pages inflated */
+static unsigned int fill_balloon_huge(struct virtio_balloon *vb)
+{
+	struct page *page;
+
+	if (time_before(jiffies, vb->huge_retry))
+		return 0;
+
+	page = alloc_pages(VIRTIO_BALLOON_HUGE_ALLOC_FLAG,
+			   VIRTIO_BALLOON_HUGE_ORDER);
+	if (!page) {
+		/* Fragmented, use base pages for a while */
+		vb->huge_retry = jiffies + VIRTIO_BALLOON_HUGE_RETRY_DELAY;
+		return 0;
+	}
+
+	mutex_lock(&vb->balloon_lock);
+	list_add(&page->lru, &vb->huge_page_list);
+	set_huge_page_pfns(vb, page);
+	vb->num_pages += VIRTIO_BALLOON_HUGE_PFNS;
+	if (!virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_DEFLATE_ON_OOM))
+		adjust_managed_page_count(page,
+					  -(1L << VIRTIO_BALLOON_HUGE_ORDER));
+	tell_host(vb, vb->inflate_vq);
+	mutex_unlock(&vb->balloon_lock);
+
+	return VIRTIO_BALLOON_HUGE_PFNS;
+}
+
+/*
+ * Deflate the balloon by one huge page, returns the pages deflated.
+ * Called with the balloon_lock held.
+ */
+static unsigned int leak_balloon_huge(struct virtio_balloon *vb)
+{
+	struct page *page;
+
+	page = list_first_entry_or_null(&vb->huge_page_list, struct page, lru);
+	if (!page)
+		return 0;
+
+	list_del(&page->lru);
+	set_huge_page_pfns(vb, page);
+	vb->num_pages -= VIRTIO_BALLOON_HUGE_PFNS;
+	/* Tell the host first, see leak_balloon() */
+	tell_host(vb, vb->deflate_vq);
+
+	if (!virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_DEFLATE_ON_OOM))
+		adjust_managed_page_count(page, 1L << VIRTIO_BALLOON_HUGE_ORDER);
+	__free_pages(page, VIRTIO_BALLOON_HUGE_ORDER);
+
+	return VIRTIO_BALLOON_HUGE_PFNS;
+}
+
 static unsigned int fill_balloon(struct virtio_balloon *vb, size_t num)
 {
 	unsigned int num_allocated_pages;
@@ -208,8 +304,14 @@ static unsigned int fill_balloon(struct virtio_balloon *vb, size_t num)
 	struct page *page;
 	LIST_HEAD(pages);
 
+	if (vb->huge_pages && num >= VIRTIO_BALLOON_HUGE_PFNS) {
+		num_allocated_pages = fill_balloon_huge(vb);
+		if (num_allocated_pages)
+			return num_allocated_pages;
+	}
+
 	/* We can only do one array worth at a time. */
-	num = min(num, ARRAY_SIZE(vb->pfns));
+	num = min_t(size_t, num, VIRTIO_BALLOON_ARRAY_PFNS_MAX);
 
 	for (num_pfns = 0; num_pfns < num;
 	     num_pfns += VIRTIO_BALLOON_PAGES_PER_PAGE) {
@@ -273,7 +375,7 @@ static unsigned int leak_balloon(struct virtio_balloon *vb, size_t num)
 	LIST_HEAD(pages);
 
 	/* We can only do one array worth at a time. */
-	num = min(num, ARRAY_SIZE(vb->pfns));
+	num = min_t(size_t, num, VIRTIO_BALLOON_ARRAY_PFNS_MAX);
 
 	mutex_lock(&vb->balloon_lock);
 	/* We can't release more pages than taken */
@@ -288,6 +390,16 @@ static unsigned int leak_balloon(struct virtio_balloon *vb, size_t num)
 		vb->num_pages -= VIRTIO_BALLOON_PAGES_PER_PAGE;
 	}
 
+	/*
+	 * Huge pages go last, whole: the balloon may end up deflated by less
+	 * than a huge page too much, which base pages make up for.
+	 */
+	if (!vb->num_pfns && num) {
+		num_freed_pages = leak_balloon_huge(vb);
+		mutex_unlock(&vb->balloon_lock);
+		return num_freed_pages;
+	}
+
 	num_freed_pages = vb->num_pfns;
 	/*
 	 * Note that if
@@ -884,6 +996,9 @@ static int virtballoon_probe(struct virtio_device *vdev)
 	vb->vdev = vdev;
 
 	balloon_devinfo_init(&vb->vb_dev_info);
+	INIT_LIST_HEAD(&vb->huge_page_list);
+	vb->huge_pages = huge_pages;
+	vb->huge_retry = jiffies;
 
 	err = init_vqs(vb);
 	if (err)
@@ -978,6 +1093,9 @@ static int virtballoon_probe(struct virtio_device *vdev)
 #if defined(CONFIG_ARM64) && defined(CONFIG_ARM64_64K_PAGES)
 		vb->pr_dev_info.order = 5;
 #endif
+		/* Report the free pages at the balloon granularity */
+		if (vb->huge_pages)
+			vb->pr_dev_info.order = VIRTIO_BALLOON_HUGE_ORDER;
 
 		err = page_reporting_register(&vb->pr_dev_info);
 		if (err)
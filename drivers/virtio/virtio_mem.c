@@ -43,6 +43,16 @@ module_param(bbm_safe_unplug, bool, 0444);
 MODULE_PARM_DESC(bbm_safe_unplug,
 	     "Use a safe unplug mechanism in BBM, avoiding long/endless loops");
 
+static unsigned long bbm_min_region_size;
+module_param(bbm_min_region_size, ulong, 0444);
+MODULE_PARM_DESC(bbm_min_region_size,
+		 "Use Big Block Mode for devices with a region of at least that many bytes. Default is 0 (auto-selection).");
+
+static unsigned int plug_batch_blocks = 32;
+module_param(plug_batch_blocks, uint, 0644);
+MODULE_PARM_DESC(plug_batch_blocks,
+		 "Maximum number of new blocks to plug with a single request. Default is 32.");
+
 /*
  * virtio-mem currently supports the following modes of operation:
  *
@@ -257,6 +267,14 @@ struct virtio_mem {
 	bool last_block_plugged;
 #endif /* CONFIG_PROC_VMCORE */
 
+	/* Statistics, exported through sysfs. */
+	atomic64_t plug_requests;
+	atomic64_t plug_ns;
+	atomic64_t unplug_requests;
+	atomic64_t unplug_ns;
+	atomic64_t add_memory_calls;
+	atomic64_t add_memory_ns;
+
 	/* Next device in the list of virtio-mem devices. */
 	struct list_head next;
 };
@@ -627,6 +645,7 @@ static bool virtio_mem_could_add_memory(struct virtio_mem *vm, uint64_t size)
 static int virtio_mem_add_memory(struct virtio_mem *vm, uint64_t addr,
 				 uint64_t size)
 {
+	ktime_t start;
 	int rc;
 
 	/*
@@ -644,8 +663,12 @@ static int virtio_mem_add_memory(struct virtio_mem *vm, uint64_t addr,
 		addr + size - 1);
 	/* Memory might get onlined immediately. */
 	atomic64_add(size, &vm->offline_size);
+	start = ktime_get();
 	rc = add_memory_driver_managed(vm->mgid, addr, size, vm->resource_name,
 				       MHP_MERGE_RESOURCE | MHP_NID_IS_MGID);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &vm->add_memory_ns);
+	atomic64_inc(&vm->add_memory_calls);
 	if (rc) {
 		atomic64_sub(size, &vm->offline_size);
 		dev_warn(&vm->vdev->dev, "adding memory failed: %d\n", rc);
@@ -1358,6 +1381,8 @@ static int virtio_mem_send_plug_request(struct virtio_mem *vm, uint64_t addr,
 		.u.plug.nb_blocks = cpu_to_virtio16(vm->vdev, nb_vm_blocks),
 	};
 	int rc = -ENOMEM;
+	uint64_t resp;
+	ktime_t start;
 
 	if (atomic_read(&vm->config_changed))
 		return -EAGAIN;
@@ -1365,7 +1390,12 @@ static int virtio_mem_send_plug_request(struct virtio_mem *vm, uint64_t addr,
 	dev_dbg(&vm->vdev->dev, "plugging memory: 0x%llx - 0x%llx\n", addr,
 		addr + size - 1);
 
-	switch (virtio_mem_send_request(vm, &req)) {
+	start = ktime_get();
+	resp = virtio_mem_send_request(vm, &req);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)), &vm->plug_ns);
+	atomic64_inc(&vm->plug_requests);
+
+	switch (resp) {
 	case VIRTIO_MEM_RESP_ACK:
 		vm->plugged_size += size;
 		return 0;
@@ -1396,6 +1426,8 @@ static int virtio_mem_send_unplug_request(struct virtio_mem *vm, uint64_t addr,
 		.u.unplug.nb_blocks = cpu_to_virtio16(vm->vdev, nb_vm_blocks),
 	};
 	int rc = -ENOMEM;
+	uint64_t resp;
+	ktime_t start;
 
 	if (atomic_read(&vm->config_changed))
 		return -EAGAIN;
@@ -1403,7 +1435,13 @@ static int virtio_mem_send_unplug_request(struct virtio_mem *vm, uint64_t addr,
 	dev_dbg(&vm->vdev->dev, "unplugging memory: 0x%llx - 0x%llx\n", addr,
 		addr + size - 1);
 
-	switch (virtio_mem_send_request(vm, &req)) {
+	start = ktime_get();
+	resp = virtio_mem_send_request(vm, &req);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &vm->unplug_ns);
+	atomic64_inc(&vm->unplug_requests);
+
+	switch (resp) {
 	case VIRTIO_MEM_RESP_ACK:
 		vm->plugged_size -= size;
 		return 0;
@@ -1689,6 +1727,101 @@ static int virtio_mem_sbm_plug_any_sb(struct virtio_mem *vm,
 	return 0;
 }
 
+/*
+ * Number of new blocks of the given size to plug with a single request:
+ * limited by the batch size, the size of a request and the offline memory
+ * we allow.
+ */
+static unsigned long virtio_mem_plug_batch_size(struct virtio_mem *vm,
+						uint64_t block_size,
+						uint64_t nb_blocks)
+{
+	unsigned long count, max_count;
+
+	max_count = min_t(uint64_t, nb_blocks, READ_ONCE(plug_batch_blocks));
+	max_count = min_t(uint64_t, max_count,
+			  max_t(uint64_t, 1,
+				div64_u64(vm->device_block_size * U16_MAX,
+					  block_size)));
+
+	for (count = 0; count < max_count; count++) {
+		if ((count + 1) * block_size > vm->offline_threshold ||
+		    !virtio_mem_could_add_memory(vm, (count + 1) * block_size))
+			break;
+	}
+	return count;
+}
+
+/*
+ * Prepare new memory blocks, plug them completely with a single request and
+ * add them to Linux one by one.
+ *
+ * The memory blocks that cannot get added are unplugged again, or left
+ * plugged for virtio_mem_unplug_pending_mb().
+ */
+static int virtio_mem_sbm_plug_and_add_new_mbs(struct virtio_mem *vm,
+					       uint64_t *nb_sb)
+{
+	unsigned long count, first_mb_id, mb_id, i;
+	int rc = 0;
+
+	count = virtio_mem_plug_batch_size(vm, memory_block_size_bytes(),
+					   div_u64(*nb_sb, vm->sbm.sbs_per_mb));
+	if (!count)
+		return -ENOSPC;
+
+	for (i = 0; i < count; i++) {
+		rc = virtio_mem_sbm_prepare_next_mb(vm, &mb_id);
+		if (rc)
+			break;
+	}
+	if (!i)
+		return rc;
+	count = i;
+	first_mb_id = mb_id - count + 1;
+
+	rc = virtio_mem_send_plug_request(vm,
+					  virtio_mem_mb_id_to_phys(first_mb_id),
+					  count * memory_block_size_bytes());
+	if (rc)
+		return rc;
+
+	/* Same states as in virtio_mem_sbm_plug_and_add_mb() */
+	for (mb_id = first_mb_id; mb_id < first_mb_id + count; mb_id++) {
+		virtio_mem_sbm_set_sb_plugged(vm, mb_id, 0, vm->sbm.sbs_per_mb);
+		virtio_mem_sbm_set_mb_state(vm, mb_id,
+					    VIRTIO_MEM_SBM_MB_PLUGGED);
+	}
+
+	for (mb_id = first_mb_id; mb_id < first_mb_id + count; mb_id++) {
+		virtio_mem_sbm_set_mb_state(vm, mb_id,
+					    VIRTIO_MEM_SBM_MB_OFFLINE);
+		rc = virtio_mem_sbm_add_mb(vm, mb_id);
+		if (rc) {
+			virtio_mem_sbm_set_mb_state(vm, mb_id,
+						    VIRTIO_MEM_SBM_MB_PLUGGED);
+			break;
+		}
+		*nb_sb -= vm->sbm.sbs_per_mb;
+		cond_resched();
+	}
+	if (!rc)
+		return 0;
+
+	/* Try to unplug the remaining memory blocks at once */
+	count = first_mb_id + count - mb_id;
+	if (!virtio_mem_send_unplug_request(vm, virtio_mem_mb_id_to_phys(mb_id),
+					    count * memory_block_size_bytes())) {
+		for (i = 0; i < count; i++, mb_id++) {
+			virtio_mem_sbm_set_sb_unplugged(vm, mb_id, 0,
+							vm->sbm.sbs_per_mb);
+			virtio_mem_sbm_set_mb_state(vm, mb_id,
+						    VIRTIO_MEM_SBM_MB_UNUSED);
+		}
+	}
+	return rc;
+}
+
 static int virtio_mem_sbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 {
 	const int mb_states[] = {
@@ -1732,8 +1865,13 @@ static int virtio_mem_sbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		cond_resched();
 	}
 
-	/* Try to prepare, plug and add new blocks */
-	while (nb_sb) {
+	/* Try to prepare, plug and add new blocks, the full ones in batches */
+	while (nb_sb >= vm->sbm.sbs_per_mb) {
+		rc = virtio_mem_sbm_plug_and_add_new_mbs(vm, &nb_sb);
+		if (rc)
+			return rc;
+	}
+	if (nb_sb) {
 		if (!virtio_mem_could_add_memory(vm, memory_block_size_bytes()))
 			return -ENOSPC;
 
@@ -1743,7 +1881,6 @@ static int virtio_mem_sbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		rc = virtio_mem_sbm_plug_and_add_mb(vm, mb_id, &nb_sb);
 		if (rc)
 			return rc;
-		cond_resched();
 	}
 
 	return 0;
@@ -1807,6 +1944,69 @@ static int virtio_mem_bbm_prepare_next_bb(struct virtio_mem *vm,
 	return 0;
 }
 
+/*
+ * Prepare new big blocks, plug them with a single request and add them to
+ * Linux one by one.
+ *
+ * The big blocks that cannot get added are unplugged again, or left plugged
+ * for virtio_mem_unplug_pending_mb().
+ */
+static int virtio_mem_bbm_plug_and_add_new_bbs(struct virtio_mem *vm,
+					       uint64_t *nb_bb)
+{
+	unsigned long count, first_bb_id, bb_id, i;
+	uint64_t addr;
+	int rc = 0;
+
+	count = virtio_mem_plug_batch_size(vm, vm->bbm.bb_size, *nb_bb);
+	if (!count)
+		return -ENOSPC;
+
+	for (i = 0; i < count; i++) {
+		rc = virtio_mem_bbm_prepare_next_bb(vm, &bb_id);
+		if (rc)
+			break;
+	}
+	if (!i)
+		return rc;
+	count = i;
+	first_bb_id = bb_id - count + 1;
+
+	addr = virtio_mem_bb_id_to_phys(vm, first_bb_id);
+	rc = virtio_mem_send_plug_request(vm, addr, count * vm->bbm.bb_size);
+	if (rc)
+		return rc;
+
+	for (bb_id = first_bb_id; bb_id < first_bb_id + count; bb_id++)
+		virtio_mem_bbm_set_bb_state(vm, bb_id,
+					    VIRTIO_MEM_BBM_BB_PLUGGED);
+
+	for (bb_id = first_bb_id; bb_id < first_bb_id + count; bb_id++) {
+		virtio_mem_bbm_set_bb_state(vm, bb_id, VIRTIO_MEM_BBM_BB_ADDED);
+		rc = virtio_mem_bbm_add_bb(vm, bb_id);
+		if (rc) {
+			virtio_mem_bbm_set_bb_state(vm, bb_id,
+						    VIRTIO_MEM_BBM_BB_PLUGGED);
+			break;
+		}
+		(*nb_bb)--;
+		cond_resched();
+	}
+	if (!rc)
+		return 0;
+
+	/* Try to unplug the remaining big blocks at once */
+	count = first_bb_id + count - bb_id;
+	if (!virtio_mem_send_unplug_request(vm,
+					    virtio_mem_bb_id_to_phys(vm, bb_id),
+					    count * vm->bbm.bb_size)) {
+		for (i = 0; i < count; i++, bb_id++)
+			virtio_mem_bbm_set_bb_state(vm, bb_id,
+						    VIRTIO_MEM_BBM_BB_UNUSED);
+	}
+	return rc;
+}
+
 static int virtio_mem_bbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 {
 	uint64_t nb_bb = diff / vm->bbm.bb_size;
@@ -1829,20 +2029,11 @@ static int virtio_mem_bbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		cond_resched();
 	}
 
-	/* Try to prepare, plug and add new big blocks */
+	/* Try to prepare, plug and add new big blocks in batches */
 	while (nb_bb) {
-		if (!virtio_mem_could_add_memory(vm, vm->bbm.bb_size))
-			return -ENOSPC;
-
-		rc = virtio_mem_bbm_prepare_next_bb(vm, &bb_id);
+		rc = virtio_mem_bbm_plug_and_add_new_bbs(vm, &nb_bb);
 		if (rc)
 			return rc;
-		rc = virtio_mem_bbm_plug_and_add_bb(vm, bb_id);
-		if (!rc)
-			nb_bb--;
-		if (rc)
-			return rc;
-		cond_resched();
 	}
 
 	return 0;
@@ -2480,7 +2671,8 @@ static int virtio_mem_init_hotplug(struct virtio_mem *vm)
 	sb_size = PAGE_SIZE * pageblock_nr_pages;
 	sb_size = max_t(uint64_t, vm->device_block_size, sb_size);
 
-	if (sb_size < memory_block_size_bytes() && !force_bbm) {
+	if (sb_size < memory_block_size_bytes() && !force_bbm &&
+	    (!bbm_min_region_size || vm->region_size < bbm_min_region_size)) {
 		/* SBM: At least two subblocks per Linux memory block. */
 		vm->in_sbm = true;
 		vm->sbm.sb_size = sb_size;
@@ -2918,6 +3110,43 @@ static int virtio_mem_restore(struct virtio_device *vdev)
 }
 #endif
 
+#define VIRTIO_MEM_STAT_ATTR(_name)					\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct virtio_mem *vm = dev_to_virtio(dev)->priv;		\
+									\
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&vm->_name));	\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+VIRTIO_MEM_STAT_ATTR(plug_requests);
+VIRTIO_MEM_STAT_ATTR(plug_ns);
+VIRTIO_MEM_STAT_ATTR(unplug_requests);
+VIRTIO_MEM_STAT_ATTR(unplug_ns);
+VIRTIO_MEM_STAT_ATTR(add_memory_calls);
+VIRTIO_MEM_STAT_ATTR(add_memory_ns);
+
+static struct attribute *virtio_mem_stats_attrs[] = {
+	&dev_attr_plug_requests.attr,
+	&dev_attr_plug_ns.attr,
+	&dev_attr_unplug_requests.attr,
+	&dev_attr_unplug_ns.attr,
+	&dev_attr_add_memory_calls.attr,
+	&dev_attr_add_memory_ns.attr,
+	NULL,
+};
+
+static const struct attribute_group virtio_mem_stats_group = {
+	.name = "stats",
+	.attrs = virtio_mem_stats_attrs,
+};
+
+static const struct attribute_group *virtio_mem_groups[] = {
+	&virtio_mem_stats_group,
+	NULL,
+};
+
 static unsigned int virtio_mem_features[] = {
 #if defined(CONFIG_NUMA) && defined(CONFIG_ACPI_NUMA)
 	VIRTIO_MEM_F_ACPI_PXM,
@@ -2935,6 +3164,7 @@ static struct virtio_driver virtio_mem_driver = {
 	.feature_table_size = ARRAY_SIZE(virtio_mem_features),
 	.driver.name = KBUILD_MODNAME,
 	.driver.owner = THIS_MODULE,
+	.driver.dev_groups = virtio_mem_groups,
 	.id_table = virtio_mem_id_table,
 	.probe = virtio_mem_probe,
 	.remove = virtio_mem_remove,
@@ -57,6 +57,7 @@
 #include <linux/acpi.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/list.h>
@@ -76,7 +77,21 @@
  * Currently hardcoded to the page size. */
 #define VIRTIO_MMIO_VRING_ALIGN		PAGE_SIZE
 
+/*
+ * Each kick is an uncached write to the device, slow when the device sits
+ * behind a bus bridge, e.g. on AXI. The kicks of a queue can be coalesced:
+ * the device is then notified once for every kick_coalesce_count kicks, or
+ * kick_coalesce_usecs after the first kick left pending. The kicks the
+ * device asks to be skipped through the rings, because it is polling them
+ * or with the event index, are already never issued.
+ */
+static unsigned int kick_coalesce_count;
+module_param(kick_coalesce_count, uint, 0644);
+MODULE_PARM_DESC(kick_coalesce_count, "Number of kicks of a queue coalesced into one device notification, 0 or 1 to disable (default: 0)");
 
+static unsigned int kick_coalesce_usecs = 50;
+module_param(kick_coalesce_usecs, uint, 0644);
+MODULE_PARM_DESC(kick_coalesce_usecs, "Maximum delay of a coalesced kick in microseconds, 0 to disable the coalescing (default: 50)");
 
 #define to_virtio_mmio_device(_plat_dev) \
 	container_of(_plat_dev, struct virtio_mmio_device, vdev)
@@ -91,6 +106,12 @@ struct virtio_mmio_device {
 	/* a list of queues so we can dispatch IRQs */
 	spinlock_t lock;
 	struct list_head virtqueues;
+
+	/* transport statistics, exposed through sysfs */
+	atomic64_t kicks;
+	atomic64_t kicks_coalesced;
+	atomic64_t vring_interrupts;
+	atomic64_t config_interrupts;
 };
 
 struct virtio_mmio_vq_info {
@@ -99,6 +120,13 @@ struct virtio_mmio_vq_info {
 
 	/* the list node for the virtqueues list */
 	struct list_head node;
+
+	/* kick coalescing, see kick_coalesce_count */
+	unsigned int coalesce_count;
+	ktime_t coalesce_delay;
+	spinlock_t kick_lock;
+	unsigned int kicks_pending;
+	struct hrtimer kick_timer;
 };
 
 
@@ -274,14 +302,66 @@ static void vm_reset(struct virtio_device *vdev)
 
 /* Transport interface */
 
-/* the notify function used when creating a virt queue */
-static bool vm_notify(struct virtqueue *vq)
+static void vm_kick(struct virtqueue *vq)
 {
 	struct virtio_mmio_device *vm_dev = to_virtio_mmio_device(vq->vdev);
 
 	/* We write the queue's selector into the notification register to
 	 * signal the other end */
 	writel(vq->index, vm_dev->base + VIRTIO_MMIO_QUEUE_NOTIFY);
+	atomic64_inc(&vm_dev->kicks);
+}
+
+/* Issue the kicks left pending for too long */
+static enum hrtimer_restart vm_kick_timer(struct hrtimer *timer)
+{
+	struct virtio_mmio_vq_info *info =
+		container_of(timer, struct virtio_mmio_vq_info, kick_timer);
+	unsigned long flags;
+	bool kick;
+
+	spin_lock_irqsave(&info->kick_lock, flags);
+	kick = info->kicks_pending;
+	info->kicks_pending = 0;
+	spin_unlock_irqrestore(&info->kick_lock, flags);
+
+	if (kick)
+		vm_kick(info->vq);
+
+	return HRTIMER_NORESTART;
+}
+
+/* the notify function used when creating a virt queue */
+static bool vm_notify(struct virtqueue *vq)
+{
+	struct virtio_mmio_device *vm_dev = to_virtio_mmio_device(vq->vdev);
+	struct virtio_mmio_vq_info *info = vq->priv;
+	unsigned long flags;
+	bool kick = true;
+
+	if (!info->coalesce_count) {
+		vm_kick(vq);
+		return true;
+	}
+
+	spin_lock_irqsave(&info->kick_lock, flags);
+	if (++info->kicks_pending < info->coalesce_count) {
+		/* The first pending kick arms the timer */
+		if (info->kicks_pending == 1)
+			hrtimer_start(&info->kick_timer, info->coalesce_delay,
+				      HRTIMER_MODE_REL);
+		kick = false;
+	} else {
+		info->kicks_pending = 0;
+		hrtimer_try_to_cancel(&info->kick_timer);
+	}
+	spin_unlock_irqrestore(&info->kick_lock, flags);
+
+	if (kick)
+		vm_kick(vq);
+	else
+		atomic64_inc(&vm_dev->kicks_coalesced);
+
 	return true;
 }
 
@@ -299,11 +379,13 @@ static irqreturn_t vm_interrupt(int irq, void *opaque)
 	writel(status, vm_dev->base + VIRTIO_MMIO_INTERRUPT_ACK);
 
 	if (unlikely(status & VIRTIO_MMIO_INT_CONFIG)) {
+		atomic64_inc(&vm_dev->config_interrupts);
 		virtio_config_changed(&vm_dev->vdev);
 		ret = IRQ_HANDLED;
 	}
 
 	if (likely(status & VIRTIO_MMIO_INT_VRING)) {
+		atomic64_inc(&vm_dev->vring_interrupts);
 		spin_lock_irqsave(&vm_dev->lock, flags);
 		list_for_each_entry(info, &vm_dev->virtqueues, node)
 			ret |= vring_interrupt(irq, info->vq);
@@ -326,6 +408,8 @@ static void vm_del_vq(struct virtqueue *vq)
 	list_del(&info->node);
 	spin_unlock_irqrestore(&vm_dev->lock, flags);
 
+	hrtimer_cancel(&info->kick_timer);
+
 	/* Select and deactivate the queue */
 	writel(index, vm_dev->base + VIRTIO_MMIO_QUEUE_SEL);
 	if (vm_dev->version == 1) {
@@ -449,6 +533,15 @@ static struct virtqueue *vm_setup_vq(struct virtio_device *vdev, unsigned int in
 	vq->priv = info;
 	info->vq = vq;
 
+	info->coalesce_count = READ_ONCE(kick_coalesce_count);
+	info->coalesce_delay = us_to_ktime(READ_ONCE(kick_coalesce_usecs));
+	if (info->coalesce_count < 2 || !info->coalesce_delay)
+		info->coalesce_count = 0;
+	spin_lock_init(&info->kick_lock);
+	info->kicks_pending = 0;
+	hrtimer_init(&info->kick_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	info->kick_timer.function = vm_kick_timer;
+
 	spin_lock_irqsave(&vm_dev->lock, flags);
 	list_add(&info->node, &vm_dev->virtqueues);
 	spin_unlock_irqrestore(&vm_dev->lock, flags);
@@ -585,6 +678,34 @@ static const struct dev_pm_ops virtio_mmio_pm_ops = {
 };
 #endif
 
+#define VM_STAT_ATTR(_name)						\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct virtio_mmio_device *vm_dev = dev_get_drvdata(dev);	\
+									\
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&vm_dev->_name));	\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+VM_STAT_ATTR(kicks);
+VM_STAT_ATTR(kicks_coalesced);
+VM_STAT_ATTR(vring_interrupts);
+VM_STAT_ATTR(config_interrupts);
+
+static struct attribute *virtio_mmio_stats_attrs[] = {
+	&dev_attr_kicks.attr,
+	&dev_attr_kicks_coalesced.attr,
+	&dev_attr_vring_interrupts.attr,
+	&dev_attr_config_interrupts.attr,
+	NULL,
+};
+
+static const struct attribute_group virtio_mmio_stats_group = {
+	.name = "stats",
+	.attrs = virtio_mmio_stats_attrs,
+};
+
 static void virtio_mmio_release_dev(struct device *_d)
 {
 	struct virtio_device *vdev =
@@ -664,6 +785,10 @@ static int virtio_mmio_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, vm_dev);
 
+	rc = devm_device_add_group(&pdev->dev, &virtio_mmio_stats_group);
+	if (rc)
+		return rc;
+
 	rc = register_virtio_device(&vm_dev->vdev);
 	if (rc)
 		put_device(&vm_dev->vdev.dev);
@@ -70,6 +70,7 @@
 struct vring_desc_state_split {
 	void *data;			/* Data for callback. */
 	struct vring_desc *indir_desc;	/* Indirect descriptor, if any. */
+	u32 total_in_len;		/* Device writable length. */
 };
 
 struct vring_desc_state_packed {
@@ -77,6 +78,7 @@ struct vring_desc_state_packed {
 	struct vring_packed_desc *indir_desc; /* Indirect descriptor, if any. */
 	u16 num;			/* Descriptor list length. */
 	u16 last;			/* The last desc state in a list. */
+	u32 total_in_len;		/* Device writable length. */
 };
 
 struct vring_desc_extra {
@@ -160,6 +162,9 @@ struct vring_virtqueue {
 	/* Is DMA API used? */
 	bool use_dma_api;
 
+	/* Are the buffers DMA mapped by the driver? */
+	bool premapped;
+
 	/* Can we use weak barriers? */
 	bool weak_barriers;
 
@@ -172,6 +177,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Host uses the buffers in the order they were made available */
+	bool in_order;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -188,6 +196,21 @@ struct vring_virtqueue {
 	/* Hint for event idx: already triggered no need to disable. */
 	bool event_triggered;
 
+	/*
+	 * For in order rings, the descriptors are used in ring order so the
+	 * free list is never relinked and the buffers are returned in the
+	 * order they were added:
+	 * in_order_next is the head (split ring) or the ID (packed ring) of
+	 * the oldest buffer not returned yet.
+	 * batch_last_id and batch_last_len are the used element the device
+	 * wrote for the last buffer of the batch being returned, UINT_MAX if
+	 * there is none. The device writes no used element for the other
+	 * buffers of a batch, they were used entirely.
+	 */
+	u16 in_order_next;
+	unsigned int batch_last_id;
+	u32 batch_last_len;
+
 	union {
 		/* Available for split ring */
 		struct vring_virtqueue_split split;
@@ -363,6 +386,10 @@ static dma_addr_t vring_map_one_sg(const struct vring_virtqueue *vq,
 		return (dma_addr_t)sg_phys(sg);
 	}
 
+	/* The driver keeps the buffer mapped, see virtqueue_set_premapped() */
+	if (vq->premapped)
+		return sg_dma_address(sg);
+
 	/*
 	 * We can't use dma_map_sg, because we don't use scatterlists in
 	 * the way it expects (we don't guarantee that the scatterlist
@@ -404,6 +431,8 @@ static void virtqueue_init(struct vring_virtqueue *vq, u32 num)
 
 	vq->event_triggered = false;
 	vq->num_added = 0;
+	vq->in_order_next = 0;
+	vq->batch_last_id = UINT_MAX;
 
 #ifdef DEBUG
 	vq->in_use = false;
@@ -421,7 +450,7 @@ static void vring_unmap_one_split_indirect(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = virtio16_to_cpu(vq->vq.vdev, desc->flags);
@@ -450,7 +479,7 @@ static unsigned int vring_unmap_one_split(const struct vring_virtqueue *vq,
 				 extra[i].len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra[i].addr,
 			       extra[i].len,
@@ -527,6 +556,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	struct scatterlist *sg;
 	struct vring_desc *desc;
 	unsigned int i, n, avail, descs_used, prev, err_idx;
+	u32 total_in_len = 0;
 	int head;
 	bool indirect;
 
@@ -601,6 +631,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 			if (vring_mapping_error(vq, addr))
 				goto unmap_release;
 
+			total_in_len += sg->length;
 			prev = i;
 			/* Note that we trust indirect descriptor
 			 * table since it use stream DMA mapping.
@@ -644,6 +675,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* Store token and indirect buffer state. */
 	vq->split.desc_state[head].data = data;
+	vq->split.desc_state[head].total_in_len = total_in_len;
 	if (indirect)
 		vq->split.desc_state[head].indir_desc = desc;
 	else
@@ -747,8 +779,13 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	}
 
 	vring_unmap_one_split(vq, i);
-	vq->split.desc_extra[i].next = vq->free_head;
-	vq->free_head = head;
+	if (vq->in_order) {
+		/* The next buffer starts at the next descriptor */
+		vq->in_order_next = vq->split.desc_extra[i].next;
+	} else {
+		vq->split.desc_extra[i].next = vq->free_head;
+		vq->free_head = head;
+	}
 
 	/* Plus final descriptor */
 	vq->vq.num_free++;
@@ -810,10 +847,37 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	virtio_rmb(vq->weak_barriers);
 
 	last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
-	i = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].id);
-	*len = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].len);
+	if (vq->in_order) {
+		/*
+		 * The used element of a batch is at the offset of its first
+		 * buffer and has the ID of its last one.
+		 */
+		if (vq->batch_last_id == UINT_MAX) {
+			i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+			if (unlikely(i >= vq->split.vring.num ||
+				     !vq->split.desc_state[i].data)) {
+				BAD_RING(vq, "id %u is not a head!\n", i);
+				return NULL;
+			}
+			vq->batch_last_id = i;
+			vq->batch_last_len = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+		}
+
+		i = vq->in_order_next;
+		if (i == vq->batch_last_id) {
+			*len = vq->batch_last_len;
+			vq->batch_last_id = UINT_MAX;
+		} else {
+			*len = vq->split.desc_state[i].total_in_len;
+		}
+	} else {
+		i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		*len = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+	}
 
 	if (unlikely(i >= vq->split.vring.num)) {
 		BAD_RING(vq, "id %u out of range\n", i);
@@ -930,17 +994,20 @@ static bool virtqueue_enable_cb_delayed_split(struct virtqueue *_vq)
 static void *virtqueue_detach_unused_buf_split(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
-	unsigned int i;
+	unsigned int i, j;
 	void *buf;
 
 	START_USE(vq);
 
 	for (i = 0; i < vq->split.vring.num; i++) {
-		if (!vq->split.desc_state[i].data)
+		/* In order rings are emptied from the oldest buffer */
+		j = vq->in_order ? (vq->in_order_next + i) &
+				   (vq->split.vring.num - 1) : i;
+		if (!vq->split.desc_state[j].data)
 			continue;
 		/* detach_buf_split clears data, so grab it now. */
-		buf = vq->split.desc_state[i].data;
-		detach_buf_split(vq, i, NULL);
+		buf = vq->split.desc_state[j].data;
+		detach_buf_split(vq, j, NULL);
 		vq->split.avail_idx_shadow--;
 		vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
 				vq->split.avail_idx_shadow);
@@ -991,6 +1058,10 @@ static void virtqueue_reinit_split(struct vring_virtqueue *vq)
 	/* reset used event */
 	*(__virtio16 *)&(vq->split.vring.used->ring[num]) = 0;
 
+	/* In order descriptors are used from the start of the table again */
+	if (vq->in_order)
+		vq->free_head = 0;
+
 	virtqueue_init(vq, num);
 
 	virtqueue_vring_init_split(&vq->split, vq);
@@ -1185,7 +1256,7 @@ static void vring_unmap_extra_packed(const struct vring_virtqueue *vq,
 				 extra->addr, extra->len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra->addr, extra->len,
 			       (flags & VRING_DESC_F_WRITE) ?
@@ -1198,7 +1269,7 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = le16_to_cpu(desc->flags);
@@ -1238,6 +1309,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	struct vring_packed_desc *desc;
 	struct scatterlist *sg;
 	unsigned int i, n, err_idx;
+	u32 total_in_len = 0;
 	u16 head, id;
 	dma_addr_t addr;
 
@@ -1268,6 +1340,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						0 : VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
+			if (n >= out_sgs)
+				total_in_len += sg->length;
 			i++;
 		}
 	}
@@ -1321,6 +1395,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = desc;
 	vq->packed.desc_state[id].last = id;
+	vq->packed.desc_state[id].total_in_len = total_in_len;
 
 	vq->num_added += 1;
 
@@ -1356,6 +1431,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	unsigned int i, n, c, descs_used, err_idx;
 	__le16 head_flags, flags;
 	u16 head, id, prev, curr, avail_used_flags;
+	u32 total_in_len = 0;
 	int err;
 
 	START_USE(vq);
@@ -1422,6 +1498,8 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
 			desc[i].id = cpu_to_le16(id);
+			if (n >= out_sgs)
+				total_in_len += sg->length;
 
 			if (unlikely(vq->use_dma_api)) {
 				vq->packed.desc_extra[curr].addr = addr;
@@ -1456,6 +1534,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
+	vq->packed.desc_state[id].total_in_len = total_in_len;
 
 	/*
 	 * A driver MUST NOT make the first descriptor in the list
@@ -1553,8 +1632,13 @@ static void detach_buf_packed(struct vring_virtqueue *vq,
 	/* Clear data ptr. */
 	state->data = NULL;
 
-	vq->packed.desc_extra[state->last].next = vq->free_head;
-	vq->free_head = id;
+	if (vq->in_order) {
+		/* The next buffer has the next ID */
+		vq->in_order_next = vq->packed.desc_extra[state->last].next;
+	} else {
+		vq->packed.desc_extra[state->last].next = vq->free_head;
+		vq->free_head = id;
+	}
 	vq->vq.num_free += state->num;
 
 	if (unlikely(vq->use_dma_api)) {
@@ -1606,6 +1690,10 @@ static inline bool more_used_packed(const struct vring_virtqueue *vq)
 	u16 last_used_idx;
 	bool used_wrap_counter;
 
+	/* The device writes nothing for the rest of a batch */
+	if (vq->batch_last_id != UINT_MAX)
+		return true;
+
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	last_used = packed_last_used(last_used_idx);
 	used_wrap_counter = packed_used_wrap_counter(last_used_idx);
@@ -1640,8 +1728,34 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	used_wrap_counter = packed_used_wrap_counter(last_used_idx);
 	last_used = packed_last_used(last_used_idx);
-	id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
-	*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+	if (vq->in_order) {
+		/*
+		 * The used element of a batch is at the position of its first
+		 * buffer and has the ID of its last one.
+		 */
+		if (vq->batch_last_id == UINT_MAX) {
+			id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+			if (unlikely(id >= vq->packed.vring.num ||
+				     !vq->packed.desc_state[id].data)) {
+				BAD_RING(vq, "id %u is not a head!\n", id);
+				return NULL;
+			}
+			vq->batch_last_id = id;
+			*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+			vq->batch_last_len = *len;
+		}
+
+		id = vq->in_order_next;
+		if (id == vq->batch_last_id) {
+			*len = vq->batch_last_len;
+			vq->batch_last_id = UINT_MAX;
+		} else {
+			*len = vq->packed.desc_state[id].total_in_len;
+		}
+	} else {
+		id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+		*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+	}
 
 	if (unlikely(id >= vq->packed.vring.num)) {
 		BAD_RING(vq, "id %u out of range\n", id);
@@ -1731,6 +1845,9 @@ static bool virtqueue_poll_packed(struct virtqueue *_vq, u16 off_wrap)
 	bool wrap_counter;
 	u16 used_idx;
 
+	if (vq->batch_last_id != UINT_MAX)
+		return true;
+
 	wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR;
 	used_idx = off_wrap & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
 
@@ -1789,7 +1906,8 @@ static bool virtqueue_enable_cb_delayed_packed(struct virtqueue *_vq)
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	wrap_counter = packed_used_wrap_counter(last_used_idx);
 	used_idx = packed_last_used(last_used_idx);
-	if (is_used_desc_packed(vq, used_idx, wrap_counter)) {
+	if (vq->batch_last_id != UINT_MAX ||
+	    is_used_desc_packed(vq, used_idx, wrap_counter)) {
 		END_USE(vq);
 		return false;
 	}
@@ -1801,17 +1919,21 @@ static bool virtqueue_enable_cb_delayed_packed(struct virtqueue *_vq)
 static void *virtqueue_detach_unused_buf_packed(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
-	unsigned int i;
+	unsigned int i, j;
 	void *buf;
 
 	START_USE(vq);
 
 	for (i = 0; i < vq->packed.vring.num; i++) {
-		if (!vq->packed.desc_state[i].data)
+		/* In order rings are emptied from the oldest buffer */
+		j = vq->in_order ? vq->in_order_next + i : i;
+		if (j >= vq->packed.vring.num)
+			j -= vq->packed.vring.num;
+		if (!vq->packed.desc_state[j].data)
 			continue;
 		/* detach_buf clears data, so grab it now. */
-		buf = vq->packed.desc_state[i].data;
-		detach_buf_packed(vq, i, NULL);
+		buf = vq->packed.desc_state[j].data;
+		detach_buf_packed(vq, j, NULL);
 		END_USE(vq);
 		return buf;
 	}
@@ -1973,6 +2095,10 @@ static void virtqueue_reinit_packed(struct vring_virtqueue *vq)
 	/* we need to reset the desc.flags. For more, see is_used_desc_packed() */
 	memset(vq->packed.vring.desc, 0, vq->packed.ring_size_in_bytes);
 
+	/* In order IDs follow the ring positions, from the start again */
+	if (vq->in_order)
+		vq->free_head = 0;
+
 	virtqueue_init(vq, vq->packed.vring.num);
 	virtqueue_vring_init_packed(&vq->packed, !!vq->vq.callback);
 }
@@ -2019,6 +2145,7 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2512,6 +2639,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2626,6 +2754,204 @@ int virtqueue_resize(struct virtqueue *_vq, u32 num,
 }
 EXPORT_SYMBOL_GPL(virtqueue_resize);
 
+/**
+ * virtqueue_set_premapped - let the driver DMA map the buffers
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Once set, the virtqueue no longer maps the buffers added to it nor
+ * unmaps them when they are used or detached. The driver maps them,
+ * e.g. once for a pool of buffers it recycles, through
+ * virtqueue_dma_map_single_attrs() or the DMA API on virtqueue_dma_dev(),
+ * and passes the DMA address of each sg entry in sg_dma_address() along
+ * with its length in sg->length. The driver also syncs the buffers, see
+ * virtqueue_dma_need_sync().
+ *
+ * The indirect descriptor tables are still mapped by the virtqueue.
+ *
+ * Caller must ensure we don't call this with other virtqueue operations
+ * at the same time, and before any buffer is added to the virtqueue.
+ *
+ * Returns zero or a negative error.
+ * 0: success.
+ * -EINVAL: the virtqueue doesn't use the DMA API.
+ * -EBUSY: buffers were added to the virtqueue already.
+ */
+int virtqueue_set_premapped(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	u32 num;
+
+	START_USE(vq);
+
+	num = vq->packed_ring ? vq->packed.vring.num : vq->split.vring.num;
+
+	if (!vq->use_dma_api) {
+		END_USE(vq);
+		return -EINVAL;
+	}
+
+	if (num != vq->vq.num_free) {
+		END_USE(vq);
+		return -EBUSY;
+	}
+
+	vq->premapped = true;
+
+	END_USE(vq);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(virtqueue_set_premapped);
+
+/**
+ * virtqueue_dma_dev - get the device to DMA map the buffers for
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Returns the device or NULL if the virtqueue doesn't use the DMA API,
+ * the buffers are then passed by physical address.
+ */
+struct device *virtqueue_dma_dev(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return NULL;
+
+	return vring_dma_dev(vq);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_dev);
+
+/**
+ * virtqueue_dma_map_single_attrs - map a buffer for the device
+ * @_vq: the struct virtqueue we're talking about.
+ * @ptr: the buffer.
+ * @size: the size of the buffer.
+ * @dir: DMA direction.
+ * @attrs: DMA attributes.
+ *
+ * Returns the DMA address of the buffer, its physical address if the
+ * virtqueue doesn't use the DMA API. Check the address with
+ * virtqueue_dma_mapping_error().
+ */
+dma_addr_t virtqueue_dma_map_single_attrs(struct virtqueue *_vq, void *ptr,
+					  size_t size,
+					  enum dma_data_direction dir,
+					  unsigned long attrs)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return (dma_addr_t)virt_to_phys(ptr);
+
+	return dma_map_single_attrs(vring_dma_dev(vq), ptr, size, dir, attrs);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_map_single_attrs);
+
+/**
+ * virtqueue_dma_unmap_single_attrs - unmap a buffer mapped for the device
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the DMA address of the buffer.
+ * @size: the size of the buffer.
+ * @dir: DMA direction.
+ * @attrs: DMA attributes.
+ */
+void virtqueue_dma_unmap_single_attrs(struct virtqueue *_vq, dma_addr_t addr,
+				      size_t size, enum dma_data_direction dir,
+				      unsigned long attrs)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return;
+
+	dma_unmap_single_attrs(vring_dma_dev(vq), addr, size, dir, attrs);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_unmap_single_attrs);
+
+/**
+ * virtqueue_dma_mapping_error - check a DMA address
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the DMA address.
+ *
+ * Returns 0 if the address is valid, a negative error otherwise.
+ */
+int virtqueue_dma_mapping_error(struct virtqueue *_vq, dma_addr_t addr)
+{
+	return vring_mapping_error(to_vvq(_vq), addr);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_mapping_error);
+
+/**
+ * virtqueue_dma_need_sync - check if a mapped buffer needs to be synced
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the DMA address of the buffer.
+ *
+ * The drivers can skip the virtqueue_dma_sync_*() calls on their hot path
+ * when this returns false, e.g. with coherent DMA and no bounce buffering.
+ */
+bool virtqueue_dma_need_sync(struct virtqueue *_vq, dma_addr_t addr)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return false;
+
+	return dma_need_sync(vring_dma_dev(vq), addr);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_need_sync);
+
+/**
+ * virtqueue_dma_sync_single_range_for_cpu - sync a mapped buffer for the CPU
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the DMA address of the buffer.
+ * @offset: the offset of the range to sync in the buffer.
+ * @size: the size of the range to sync.
+ * @dir: DMA direction.
+ *
+ * Call this before the CPU reads what the device wrote to a buffer.
+ */
+void virtqueue_dma_sync_single_range_for_cpu(struct virtqueue *_vq,
+					     dma_addr_t addr,
+					     unsigned long offset, size_t size,
+					     enum dma_data_direction dir)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return;
+
+	dma_sync_single_range_for_cpu(vring_dma_dev(vq), addr, offset, size,
+				      dir);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_sync_single_range_for_cpu);
+
+/**
+ * virtqueue_dma_sync_single_range_for_device - sync a mapped buffer for
+ * the device
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the DMA address of the buffer.
+ * @offset: the offset of the range to sync in the buffer.
+ * @size: the size of the range to sync.
+ * @dir: DMA direction.
+ *
+ * Call this after the CPU wrote to a buffer and before adding it to the
+ * virtqueue again.
+ */
+void virtqueue_dma_sync_single_range_for_device(struct virtqueue *_vq,
+						dma_addr_t addr,
+						unsigned long offset,
+						size_t size,
+						enum dma_data_direction dir)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return;
+
+	dma_sync_single_range_for_device(vring_dma_dev(vq), addr, offset, size,
+					 dir);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_sync_single_range_for_device);
+
 /* Only available for split ring */
 struct virtqueue *vring_new_virtqueue(unsigned int index,
 				      unsigned int num,
@@ -2718,6 +3044,8 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
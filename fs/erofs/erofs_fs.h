@@ -412,6 +412,26 @@ struct erofs_dirent {
 	__u8 reserved;  /* reserved */
 } __packed;
 
+/*
+ * The prefetch list is a regular file of the image recording the ranges of
+ * the blobs accessed on startup, in the order of their first access, which
+ * are fetched ahead in the fscache mode once mounted.
+ */
+#define EROFS_PREFETCH_MAGIC	0xE0F5FE7C
+
+struct erofs_prefetch_header {
+	__le32 magic;		/* EROFS_PREFETCH_MAGIC */
+	__le32 nr_entries;	/* following entries */
+	__u8 reserved[8];
+};
+
+struct erofs_prefetch_entry {
+	__le16 deviceid;	/* 0 - flat blob addresses, else device id */
+	__le16 reserved;
+	__le32 length;		/* in bytes */
+	__le64 offset;		/* in bytes */
+};
+
 /*
  * EROFS file types should match generic FT_* types and
  * it seems no need to add BUILD_BUG_ONs since potential
@@ -441,6 +461,10 @@ static inline void erofs_check_ondisk_layout_definitions(void)
 	BUILD_BUG_ON(sizeof(struct erofs_inode_chunk_index) !=
 		     sizeof(struct z_erofs_vle_decompressed_index));
 	BUILD_BUG_ON(sizeof(struct erofs_deviceslot) != 128);
+	BUILD_BUG_ON(sizeof(struct erofs_prefetch_header) != 16);
+	BUILD_BUG_ON(sizeof(struct erofs_prefetch_entry) != 16);
+	/* entries never cross blocks */
+	BUILD_BUG_ON(EROFS_BLKSIZ % sizeof(struct erofs_prefetch_entry));
 
 	BUILD_BUG_ON(BIT(Z_EROFS_VLE_DI_CLUSTER_TYPE_BITS) <
 		     Z_EROFS_VLE_CLUSTER_TYPE_MAX - 1);
@@ -4,6 +4,8 @@
  * Copyright (C) 2022, Bytedance Inc. All rights reserved.
  */
 #include <linux/fscache.h>
+#include <linux/bsearch.h>
+#include <linux/sort.h>
 #include "internal.h"
 
 static DEFINE_MUTEX(erofs_domain_list_lock);
@@ -11,6 +13,34 @@ static DEFINE_MUTEX(erofs_domain_cookies_lock);
 static LIST_HEAD(erofs_domain_list);
 static struct vfsmount *erofs_pseudo_mnt;
 
+#define EROFS_PREFETCH_MAX_ENTRIES	65536
+/* merge the ranges of a blob closer than that into a single request */
+#define EROFS_PREFETCH_MERGE_GAP	(64 * 1024)
+#define EROFS_PREFETCH_MAX_LEN		(4 * 1024 * 1024)
+/* parallel prefetch requests to the daemon */
+#define EROFS_PREFETCH_WORKERS		4
+
+struct erofs_prefetch_range {
+	struct erofs_fscache *ctx;
+	u64 pa, len;
+	unsigned long read;		/* bit 0: read since prefetched */
+};
+
+struct erofs_prefetch {
+	struct super_block *sb;
+	/* in the order of the trace */
+	struct erofs_prefetch_range *ranges;
+	/* by blob and address, to account the reads */
+	struct erofs_prefetch_range **sorted;
+	unsigned int nr;
+	atomic_t next;
+	bool stop;
+	struct erofs_prefetch_work {
+		struct work_struct work;
+		struct erofs_prefetch *pf;
+	} works[EROFS_PREFETCH_WORKERS];
+};
+
 static struct netfs_io_request *erofs_fscache_alloc_request(struct address_space *mapping,
 					     loff_t start, size_t len)
 {
@@ -216,6 +246,316 @@ static int erofs_fscache_read_folios_async(struct fscache_cookie *cookie,
 	return ret;
 }
 
+static int erofs_prefetch_range_cmp(const void *key, const void *elt)
+{
+	const struct erofs_prefetch_range *a = key;
+	const struct erofs_prefetch_range *b =
+		*(const struct erofs_prefetch_range **)elt;
+
+	if (a->ctx != b->ctx)
+		return a->ctx < b->ctx ? -1 : 1;
+	if (a->pa < b->pa)
+		return -1;
+	return a->pa >= b->pa + b->len;
+}
+
+static int erofs_prefetch_range_sort_cmp(const void *a, const void *b)
+{
+	const struct erofs_prefetch_range *ra =
+		*(const struct erofs_prefetch_range **)a;
+	const struct erofs_prefetch_range *rb =
+		*(const struct erofs_prefetch_range **)b;
+
+	if (ra->ctx != rb->ctx)
+		return ra->ctx < rb->ctx ? -1 : 1;
+	if (ra->pa != rb->pa)
+		return ra->pa < rb->pa ? -1 : 1;
+	return 0;
+}
+
+/* account a read of the blob to the prefetched ranges */
+static void erofs_fscache_prefetch_account(struct super_block *sb,
+					   struct erofs_fscache *ctx, u64 pa)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+	struct erofs_prefetch *pf = sbi->prefetch;
+	struct erofs_prefetch_range key = { .ctx = ctx, .pa = pa };
+	struct erofs_prefetch_range **r;
+
+	if (!pf)
+		return;
+
+	r = bsearch(&key, pf->sorted, pf->nr, sizeof(*pf->sorted),
+		    erofs_prefetch_range_cmp);
+	if (!r)
+		atomic64_inc(&sbi->prefetch_misses);
+	else if (!test_and_set_bit(0, &(*r)->read))
+		atomic64_inc(&sbi->prefetch_hits);
+}
+
+/*
+ * Have cachefiles fetch a range of a blob from the daemon, without reading
+ * it: preparing an on-demand read of data missing from the cache file waits
+ * for the daemon to write it there.
+ */
+static int erofs_fscache_prefetch_range(struct erofs_prefetch *pf,
+					struct erofs_prefetch_range *r)
+{
+	struct erofs_fscache *fscache = EROFS_SB(pf->sb)->s_fscache;
+	struct netfs_io_subrequest *subreq;
+	struct netfs_io_request *rreq;
+	enum netfs_io_source source;
+	u64 done = 0;
+	int ret;
+
+	rreq = erofs_fscache_alloc_request(fscache->inode->i_mapping, 0, 0);
+	if (IS_ERR(rreq))
+		return PTR_ERR(rreq);
+
+	subreq = kzalloc(sizeof(*subreq), GFP_KERNEL);
+	if (!subreq) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	INIT_LIST_HEAD(&subreq->rreq_link);
+	subreq->rreq = rreq;
+
+	ret = fscache_begin_read_operation(&rreq->cache_resources,
+					   r->ctx->cookie);
+	while (!ret && done < r->len && !READ_ONCE(pf->stop)) {
+		subreq->start = r->pa + done;
+		subreq->len = r->len - done;
+		subreq->flags = 1 << NETFS_SREQ_ONDEMAND;
+
+		source = rreq->cache_resources.ops->prepare_read(subreq,
+								 LLONG_MAX);
+		if (source != NETFS_READ_FROM_CACHE || !subreq->len)
+			ret = -EIO;
+		else
+			done += subreq->len;
+	}
+	kfree(subreq);
+out:
+	erofs_fscache_put_request(rreq);
+	return ret;
+}
+
+static void erofs_fscache_prefetch_work(struct work_struct *work)
+{
+	struct erofs_prefetch *pf =
+		container_of(work, struct erofs_prefetch_work, work)->pf;
+	struct erofs_sb_info *sbi = EROFS_SB(pf->sb);
+	struct erofs_prefetch_range *r;
+	unsigned int i;
+	int ret;
+
+	/* the works take the ranges in turn, in the order of the trace */
+	while (!READ_ONCE(pf->stop)) {
+		i = atomic_inc_return(&pf->next) - 1;
+		if (i >= pf->nr)
+			break;
+		r = &pf->ranges[i];
+		ret = erofs_fscache_prefetch_range(pf, r);
+		if (ret) {
+			erofs_dbg("failed to prefetch %llu bytes @ %llu: %d",
+				  r->len, r->pa, ret);
+			continue;
+		}
+		atomic64_inc(&sbi->prefetch_ranges);
+		atomic64_add(r->len, &sbi->prefetch_bytes);
+	}
+}
+
+static struct inode *erofs_fscache_prefetch_iget(struct super_block *sb,
+						 const char *path)
+{
+	struct inode *dir = igrab(d_inode(sb->s_root)), *inode;
+	const char *name;
+	unsigned int len, d_type;
+	erofs_nid_t nid;
+	int err;
+
+	for (name = path; *name; name += len) {
+		while (*name == '/')
+			++name;
+		len = strchrnul(name, '/') - name;
+		if (!len)
+			break;
+		if (!S_ISDIR(dir->i_mode)) {
+			iput(dir);
+			return ERR_PTR(-ENOTDIR);
+		}
+		err = erofs_namei(dir, &(struct qstr)QSTR_INIT(name, len),
+				  &nid, &d_type);
+		iput(dir);
+		if (err)
+			return ERR_PTR(err);
+		inode = erofs_iget(sb, nid);
+		if (IS_ERR(inode))
+			return inode;
+		dir = inode;
+	}
+	if (!S_ISREG(dir->i_mode)) {
+		iput(dir);
+		return ERR_PTR(-EINVAL);
+	}
+	return dir;
+}
+
+/* read the prefetch list, merging the close ranges which follow each other */
+static int erofs_fscache_prefetch_load(struct erofs_prefetch *pf,
+				       struct inode *inode)
+{
+	struct super_block *sb = pf->sb;
+	struct erofs_buf buf = __EROFS_BUF_INITIALIZER;
+	struct erofs_prefetch_header *hdr;
+	struct erofs_prefetch_entry *e;
+	struct erofs_prefetch_range *r = NULL;
+	struct erofs_map_dev mdev;
+	unsigned int i, nr;
+	erofs_off_t pos;
+	u32 len;
+	int err = 0;
+
+	if (i_size_read(inode) < sizeof(*hdr))
+		return -EFSCORRUPTED;
+
+	hdr = erofs_bread(&buf, inode, 0, EROFS_KMAP);
+	if (IS_ERR(hdr))
+		return PTR_ERR(hdr);
+	nr = le32_to_cpu(hdr->nr_entries);
+	if (le32_to_cpu(hdr->magic) != EROFS_PREFETCH_MAGIC ||
+	    nr > EROFS_PREFETCH_MAX_ENTRIES ||
+	    sizeof(*hdr) + (u64)nr * sizeof(*e) > i_size_read(inode)) {
+		err = -EFSCORRUPTED;
+		goto out;
+	}
+
+	pf->ranges = kvcalloc(nr, sizeof(*pf->ranges), GFP_KERNEL);
+	if (!pf->ranges) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0, pos = sizeof(*hdr); i < nr; ++i, pos += sizeof(*e)) {
+		e = erofs_bread(&buf, inode, erofs_blknr(pos), EROFS_KMAP);
+		if (IS_ERR(e)) {
+			err = PTR_ERR(e);
+			goto out;
+		}
+		e = (void *)e + erofs_blkoff(pos);
+		len = le32_to_cpu(e->length);
+		if (!len)
+			continue;
+
+		mdev = (struct erofs_map_dev) {
+			.m_deviceid = le16_to_cpu(e->deviceid),
+			.m_pa = le64_to_cpu(e->offset),
+		};
+		err = erofs_map_dev(sb, &mdev);
+		if (err)
+			goto out;
+
+		if (r && r->ctx == mdev.m_fscache && mdev.m_pa >= r->pa &&
+		    mdev.m_pa <= r->pa + r->len + EROFS_PREFETCH_MERGE_GAP &&
+		    mdev.m_pa + len - r->pa <= EROFS_PREFETCH_MAX_LEN) {
+			r->len = max(r->len, mdev.m_pa + len - r->pa);
+			continue;
+		}
+		r = &pf->ranges[pf->nr++];
+		r->ctx = mdev.m_fscache;
+		r->pa = mdev.m_pa;
+		r->len = len;
+	}
+
+	pf->sorted = kvcalloc(pf->nr, sizeof(*pf->sorted), GFP_KERNEL);
+	if (!pf->sorted) {
+		err = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < pf->nr; ++i)
+		pf->sorted[i] = &pf->ranges[i];
+	sort(pf->sorted, pf->nr, sizeof(*pf->sorted),
+	     erofs_prefetch_range_sort_cmp, NULL);
+out:
+	erofs_put_metabuf(&buf);
+	return err;
+}
+
+static void erofs_fscache_prefetch_free(struct erofs_prefetch *pf)
+{
+	kvfree(pf->sorted);
+	kvfree(pf->ranges);
+	kfree(pf);
+}
+
+/**
+ * erofs_fscache_prefetch_start - Fetch the startup ranges of the blobs ahead
+ * @sb: superblock mounted with the prefetch_list option
+ *
+ * Read the prefetch list file and have the daemon fetch the ranges it lists
+ * in the background, with a few large requests in parallel. The mount goes
+ * on without prefetching if the list cannot be read.
+ */
+void erofs_fscache_prefetch_start(struct super_block *sb)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+	struct erofs_prefetch *pf;
+	struct inode *inode;
+	unsigned int i;
+	int err;
+
+	pf = kzalloc(sizeof(*pf), GFP_KERNEL);
+	if (!pf)
+		return;
+	pf->sb = sb;
+
+	inode = erofs_fscache_prefetch_iget(sb, sbi->prefetch_list);
+	if (IS_ERR(inode)) {
+		err = PTR_ERR(inode);
+		goto err_out;
+	}
+	err = erofs_fscache_prefetch_load(pf, inode);
+	iput(inode);
+	if (err)
+		goto err_out;
+
+	sbi->prefetch = pf;
+	for (i = 0; i < EROFS_PREFETCH_WORKERS; ++i) {
+		pf->works[i].pf = pf;
+		INIT_WORK(&pf->works[i].work, erofs_fscache_prefetch_work);
+		queue_work(system_unbound_wq, &pf->works[i].work);
+	}
+	return;
+
+err_out:
+	erofs_fscache_prefetch_free(pf);
+	erofs_err(sb, "failed to read prefetch list %s: %d",
+		  sbi->prefetch_list, err);
+}
+
+/**
+ * erofs_fscache_prefetch_stop - Stop fetching the startup ranges ahead
+ * @sb: superblock being unmounted
+ *
+ * Wait for the requests to the daemon in progress.
+ */
+void erofs_fscache_prefetch_stop(struct super_block *sb)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+	struct erofs_prefetch *pf = sbi->prefetch;
+	unsigned int i;
+
+	if (!pf)
+		return;
+
+	WRITE_ONCE(pf->stop, true);
+	for (i = 0; i < EROFS_PREFETCH_WORKERS; ++i)
+		flush_work(&pf->works[i].work);
+	sbi->prefetch = NULL;
+	erofs_fscache_prefetch_free(pf);
+}
+
 static int erofs_fscache_meta_read_folio(struct file *data, struct folio *folio)
 {
 	int ret;
@@ -229,6 +569,7 @@ static int erofs_fscache_meta_read_folio(struct file *data, struct folio *folio)
 	ret = erofs_map_dev(sb, &mdev);
 	if (ret)
 		goto out;
+	erofs_fscache_prefetch_account(sb, mdev.m_fscache, mdev.m_pa);
 
 	rreq = erofs_fscache_alloc_request(folio_mapping(folio),
 				folio_pos(folio), folio_size(folio));
@@ -317,6 +658,8 @@ static int erofs_fscache_data_read(struct address_space *mapping,
 	ret = erofs_map_dev(sb, &mdev);
 	if (ret)
 		return ret;
+	erofs_fscache_prefetch_account(sb, mdev.m_fscache,
+				       mdev.m_pa + (pos - map.m_la));
 
 	rreq = erofs_fscache_alloc_request(mapping, pos, count);
 	if (IS_ERR(rreq))
@@ -73,10 +73,28 @@ struct erofs_mount_opts {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* threshold for decompression on the per-CPU kthread workers */
+	unsigned int max_pcpu_decompress_pages;
 #endif
 	unsigned int mount_opt;
 };
 
+/* contexts the compressed data is decompressed in once read */
+enum {
+	EROFS_DECOMPRESS_SYNC,		/* the waiting reader */
+	EROFS_DECOMPRESS_INLINE,	/* the bio completion, in task context */
+	EROFS_DECOMPRESS_KTHREAD,	/* the per-CPU kthread workers */
+	EROFS_DECOMPRESS_WORKQUEUE,	/* the unbound workqueue */
+	EROFS_DECOMPRESS_NR_PATHS
+};
+
+struct erofs_decompress_stats {
+	atomic64_t count;		/* decompressed queues */
+	atomic64_t wait_ns;		/* from the I/O completion on */
+	atomic64_t run_ns;		/* spent decompressing */
+};
+
 struct erofs_dev_context {
 	struct idr tree;
 	struct rw_semaphore rwsem;
@@ -89,6 +107,7 @@ struct erofs_fs_context {
 	struct erofs_dev_context *devs;
 	char *fsid;
 	char *domain_id;
+	char *prefetch_list;
 };
 
 /* all filesystem-wide lz4 configurations */
@@ -129,9 +148,15 @@ struct erofs_sb_info {
 
 	/* pseudo inode to manage cached pages */
 	struct inode *managed_cache;
+	/* pseudo inode to cache the decompressed data of shared pclusters */
+	struct inode *dedupe_cache;
 
 	struct erofs_sb_lz4_info lz4;
 	struct inode *packed_inode;
+
+	/* per decompression path statistics */
+	struct erofs_decompress_stats
+		decompress_stats[EROFS_DECOMPRESS_NR_PATHS];
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct erofs_dev_context *devs;
 	struct dax_device *dax_dev;
@@ -172,6 +197,14 @@ struct erofs_sb_info {
 	struct erofs_domain *domain;
 	char *fsid;
 	char *domain_id;
+
+	/* prefetching of the startup ranges in fscache mode */
+	char *prefetch_list;
+	struct erofs_prefetch *prefetch;
+	atomic64_t prefetch_ranges;	/* ranges fetched ahead */
+	atomic64_t prefetch_bytes;	/* bytes fetched ahead */
+	atomic64_t prefetch_hits;	/* fetched ranges read afterwards */
+	atomic64_t prefetch_misses;	/* reads out of the fetched ranges */
 };
 
 #define EROFS_SB(sb) ((struct erofs_sb_info *)(sb)->s_fs_info)
@@ -613,6 +646,9 @@ struct erofs_fscache *erofs_fscache_register_cookie(struct super_block *sb,
 						     char *name, bool need_inode);
 void erofs_fscache_unregister_cookie(struct erofs_fscache *fscache);
 
+void erofs_fscache_prefetch_start(struct super_block *sb);
+void erofs_fscache_prefetch_stop(struct super_block *sb);
+
 extern const struct address_space_operations erofs_fscache_access_aops;
 #else
 static inline int erofs_fscache_register_fs(struct super_block *sb)
@@ -631,6 +667,9 @@ struct erofs_fscache *erofs_fscache_register_cookie(struct super_block *sb,
 static inline void erofs_fscache_unregister_cookie(struct erofs_fscache *fscache)
 {
 }
+
+static inline void erofs_fscache_prefetch_start(struct super_block *sb) {}
+static inline void erofs_fscache_prefetch_stop(struct super_block *sb) {}
 #endif
 
 #define EFSCORRUPTED    EUCLEAN         /* Filesystem is corrupted */
@@ -437,6 +437,7 @@ static void erofs_default_options(struct erofs_fs_context *ctx)
 #ifdef CONFIG_EROFS_FS_ZIP
 	ctx->opt.cache_strategy = EROFS_ZIP_CACHE_READAROUND;
 	ctx->opt.max_sync_decompress_pages = 3;
+	ctx->opt.max_pcpu_decompress_pages = 16;
 	ctx->opt.sync_decompress = EROFS_SYNC_DECOMPRESS_AUTO;
 #endif
 #ifdef CONFIG_EROFS_FS_XATTR
@@ -456,6 +457,7 @@ enum {
 	Opt_device,
 	Opt_fsid,
 	Opt_domain_id,
+	Opt_prefetch_list,
 	Opt_err
 };
 
@@ -482,6 +484,7 @@ static const struct fs_parameter_spec erofs_fs_parameters[] = {
 	fsparam_string("device",	Opt_device),
 	fsparam_string("fsid",		Opt_fsid),
 	fsparam_string("domain_id",	Opt_domain_id),
+	fsparam_string("prefetch_list",	Opt_prefetch_list),
 	{}
 };
 
@@ -595,6 +598,16 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 			return -ENOMEM;
 #else
 		errorfc(fc, "domain_id option not supported");
+#endif
+		break;
+	case Opt_prefetch_list:
+#ifdef CONFIG_EROFS_FS_ONDEMAND
+		kfree(ctx->prefetch_list);
+		ctx->prefetch_list = kstrdup(param->string, GFP_KERNEL);
+		if (!ctx->prefetch_list)
+			return -ENOMEM;
+#else
+		errorfc(fc, "prefetch_list option not supported");
 #endif
 		break;
 	default:
@@ -661,8 +674,33 @@ static int erofs_init_managed_cache(struct super_block *sb)
 	sbi->managed_cache = inode;
 	return 0;
 }
+
+/*
+ * Deduplicated images point the extents of several files at the same
+ * pclusters, keep the decompressed data of those in a device-level mapping
+ * for the other files to copy from rather than to read and decompress again.
+ */
+static int erofs_init_dedupe_cache(struct super_block *sb)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(sb);
+	struct inode *inode;
+
+	if (!erofs_sb_has_dedupe(sbi))
+		return 0;
+
+	inode = new_inode(sb);
+	if (!inode)
+		return -ENOMEM;
+
+	set_nlink(inode, 1);
+	inode->i_size = OFFSET_MAX;
+	mapping_set_gfp_mask(inode->i_mapping, GFP_NOFS);
+	sbi->dedupe_cache = inode;
+	return 0;
+}
 #else
 static int erofs_init_managed_cache(struct super_block *sb) { return 0; }
+static int erofs_init_dedupe_cache(struct super_block *sb) { return 0; }
 #endif
 
 static struct inode *erofs_nfs_get_inode(struct super_block *sb,
@@ -734,6 +772,8 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 	ctx->fsid = NULL;
 	sbi->domain_id = ctx->domain_id;
 	ctx->domain_id = NULL;
+	sbi->prefetch_list = ctx->prefetch_list;
+	ctx->prefetch_list = NULL;
 
 	if (erofs_is_fscache_mode(sb)) {
 		sb->s_blocksize = EROFS_BLKSIZ;
@@ -805,10 +845,21 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 	if (err)
 		return err;
 
+	err = erofs_init_dedupe_cache(sb);
+	if (err)
+		return err;
+
 	err = erofs_register_sysfs(sb);
 	if (err)
 		return err;
 
+	if (sbi->prefetch_list) {
+		if (erofs_is_fscache_mode(sb))
+			erofs_fscache_prefetch_start(sb);
+		else
+			erofs_info(sb, "prefetch_list is ignored out of fscache mode");
+	}
+
 	erofs_info(sb, "mounted with root inode @ nid %llu.", ROOT_NID(sbi));
 	return 0;
 }
@@ -836,8 +887,8 @@ static int erofs_fc_reconfigure(struct fs_context *fc)
 
 	DBG_BUGON(!sb_rdonly(sb));
 
-	if (ctx->fsid || ctx->domain_id)
-		erofs_info(sb, "ignoring reconfiguration for fsid|domain_id.");
+	if (ctx->fsid || ctx->domain_id || ctx->prefetch_list)
+		erofs_info(sb, "ignoring reconfiguration for fsid|domain_id|prefetch_list.");
 
 	if (test_opt(&ctx->opt, POSIX_ACL))
 		fc->sb_flags |= SB_POSIXACL;
@@ -880,6 +931,7 @@ static void erofs_fc_free(struct fs_context *fc)
 	erofs_free_dev_context(ctx->devs);
 	kfree(ctx->fsid);
 	kfree(ctx->domain_id);
+	kfree(ctx->prefetch_list);
 	kfree(ctx);
 }
 
@@ -951,6 +1003,7 @@ static void erofs_kill_sb(struct super_block *sb)
 	erofs_fscache_unregister_fs(sb);
 	kfree(sbi->fsid);
 	kfree(sbi->domain_id);
+	kfree(sbi->prefetch_list);
 	kfree(sbi);
 	sb->s_fs_info = NULL;
 }
@@ -962,11 +1015,14 @@ static void erofs_put_super(struct super_block *sb)
 
 	DBG_BUGON(!sbi);
 
+	erofs_fscache_prefetch_stop(sb);
 	erofs_unregister_sysfs(sb);
 	erofs_shrinker_unregister(sb);
 #ifdef CONFIG_EROFS_FS_ZIP
 	iput(sbi->managed_cache);
 	sbi->managed_cache = NULL;
+	iput(sbi->dedupe_cache);
+	sbi->dedupe_cache = NULL;
 	iput(sbi->packed_inode);
 	sbi->packed_inode = NULL;
 #endif
@@ -1107,6 +1163,8 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_printf(seq, ",fsid=%s", sbi->fsid);
 	if (sbi->domain_id)
 		seq_printf(seq, ",domain_id=%s", sbi->domain_id);
+	if (sbi->prefetch_list)
+		seq_printf(seq, ",prefetch_list=%s", sbi->prefetch_list);
 #endif
 	return 0;
 }
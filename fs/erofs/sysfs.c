@@ -12,6 +12,8 @@ enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_pointer_atomic64,
+	attr_decompress_stats,
 };
 
 enum {
@@ -53,15 +55,48 @@ static struct erofs_attr erofs_attr_##_name = {			\
 #define EROFS_ATTR_RW_BOOL(_name, _struct)	\
 	EROFS_ATTR_RW(_name, pointer_bool, _struct)
 
+#define EROFS_RO_ATTR_ATOMIC64(_name, _struct)	\
+	EROFS_RO_ATTR(_name, pointer_atomic64, _struct)
+
+/* the offset is the index of the decompression path in the statistics */
+#define EROFS_ATTR_DECOMPRESS_STATS(_name, _path)			\
+static struct erofs_attr erofs_attr_decompress_##_name = {		\
+	.attr = {.name = "decompress_" __stringify(_name), .mode = 0444 },\
+	.attr_id = attr_decompress_stats,				\
+	.offset = EROFS_DECOMPRESS_##_path,				\
+}
+
 #define ATTR_LIST(name) (&erofs_attr_##name.attr)
 
 #ifdef CONFIG_EROFS_FS_ZIP
 EROFS_ATTR_RW_UI(sync_decompress, erofs_mount_opts);
+EROFS_ATTR_RW_UI(max_pcpu_decompress_pages, erofs_mount_opts);
+EROFS_ATTR_DECOMPRESS_STATS(sync, SYNC);
+EROFS_ATTR_DECOMPRESS_STATS(inline, INLINE);
+EROFS_ATTR_DECOMPRESS_STATS(kthread, KTHREAD);
+EROFS_ATTR_DECOMPRESS_STATS(workqueue, WORKQUEUE);
+#endif
+#ifdef CONFIG_EROFS_FS_ONDEMAND
+EROFS_RO_ATTR_ATOMIC64(prefetch_ranges, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC64(prefetch_bytes, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC64(prefetch_hits, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC64(prefetch_misses, erofs_sb_info);
 #endif
 
 static struct attribute *erofs_attrs[] = {
 #ifdef CONFIG_EROFS_FS_ZIP
 	ATTR_LIST(sync_decompress),
+	ATTR_LIST(max_pcpu_decompress_pages),
+	ATTR_LIST(decompress_sync),
+	ATTR_LIST(decompress_inline),
+	ATTR_LIST(decompress_kthread),
+	ATTR_LIST(decompress_workqueue),
+#endif
+#ifdef CONFIG_EROFS_FS_ONDEMAND
+	ATTR_LIST(prefetch_ranges),
+	ATTR_LIST(prefetch_bytes),
+	ATTR_LIST(prefetch_hits),
+	ATTR_LIST(prefetch_misses),
 #endif
 	NULL,
 };
@@ -123,6 +158,23 @@ static ssize_t erofs_attr_show(struct kobject *kobj,
 		if (!ptr)
 			return 0;
 		return sysfs_emit(buf, "%d\n", *(bool *)ptr);
+	case attr_pointer_atomic64:
+		if (!ptr)
+			return 0;
+		return sysfs_emit(buf, "%lld\n",
+				  atomic64_read((atomic64_t *)ptr));
+#ifdef CONFIG_EROFS_FS_ZIP
+	case attr_decompress_stats: {
+		struct erofs_decompress_stats *stats =
+			&sbi->decompress_stats[a->offset];
+
+		/* decompressed queues, total wait and run time in ns */
+		return sysfs_emit(buf, "%lld %lld %lld\n",
+				  atomic64_read(&stats->count),
+				  atomic64_read(&stats->wait_ns),
+				  atomic64_read(&stats->run_ns));
+	}
+#endif
 	}
 	return 0;
 }
@@ -8,6 +8,7 @@
 #include "compress.h"
 #include <linux/prefetch.h>
 #include <linux/psi.h>
+#include <linux/cpuhotplug.h>
 
 #include <trace/events/erofs.h>
 
@@ -196,8 +197,129 @@ typedef tagptr1_t compressed_page_t;
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static struct kthread_worker __rcu **z_erofs_pcpu_workers;
+
+static void erofs_destroy_percpu_workers(void)
+{
+	struct kthread_worker *worker;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		worker = rcu_dereference_protected(
+					z_erofs_pcpu_workers[cpu], 1);
+		rcu_assign_pointer(z_erofs_pcpu_workers[cpu], NULL);
+		if (worker)
+			kthread_destroy_worker(worker);
+	}
+	kfree(z_erofs_pcpu_workers);
+}
+
+static struct kthread_worker *erofs_init_percpu_worker(int cpu)
+{
+	struct kthread_worker *worker =
+		kthread_create_worker_on_cpu(cpu, 0, "erofs_worker/%u", cpu);
+
+	if (IS_ERR(worker))
+		return worker;
+	if (IS_ENABLED(CONFIG_EROFS_FS_PCPU_KTHREAD_HIPRI))
+		sched_set_fifo_low(worker->task);
+	else
+		sched_set_normal(worker->task, 0);
+	return worker;
+}
+
+static int erofs_init_percpu_workers(void)
+{
+	struct kthread_worker *worker;
+	unsigned int cpu;
+
+	z_erofs_pcpu_workers = kcalloc(num_possible_cpus(),
+			sizeof(struct kthread_worker *), GFP_ATOMIC);
+	if (!z_erofs_pcpu_workers)
+		return -ENOMEM;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		worker = erofs_init_percpu_worker(cpu);
+		if (!IS_ERR(worker))
+			rcu_assign_pointer(z_erofs_pcpu_workers[cpu], worker);
+	}
+	cpus_read_unlock();
+	return 0;
+}
+#else
+static inline void erofs_destroy_percpu_workers(void) {}
+static inline int erofs_init_percpu_workers(void) { return 0; }
+#endif
+
+#if defined(CONFIG_HOTPLUG_CPU) && defined(CONFIG_EROFS_FS_PCPU_KTHREAD)
+static DEFINE_SPINLOCK(z_erofs_pcpu_worker_lock);
+static enum cpuhp_state erofs_cpuhp_state;
+
+static int erofs_cpu_online(unsigned int cpu)
+{
+	struct kthread_worker *worker, *old;
+
+	worker = erofs_init_percpu_worker(cpu);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	old = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	if (!old)
+		rcu_assign_pointer(z_erofs_pcpu_workers[cpu], worker);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+	if (old)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int erofs_cpu_offline(unsigned int cpu)
+{
+	struct kthread_worker *worker;
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	worker = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	rcu_assign_pointer(z_erofs_pcpu_workers[cpu], NULL);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+
+	/* the queued decompression is flushed before the worker stops */
+	synchronize_rcu();
+	if (worker)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int erofs_cpu_hotplug_init(void)
+{
+	int state;
+
+	state = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN,
+			"fs/erofs:online", erofs_cpu_online, erofs_cpu_offline);
+	if (state < 0)
+		return state;
+
+	erofs_cpuhp_state = state;
+	return 0;
+}
+
+static void erofs_cpu_hotplug_destroy(void)
+{
+	if (erofs_cpuhp_state)
+		cpuhp_remove_state_nocalls(erofs_cpuhp_state);
+}
+#else /* !CONFIG_HOTPLUG_CPU || !CONFIG_EROFS_FS_PCPU_KTHREAD */
+static inline int erofs_cpu_hotplug_init(void) { return 0; }
+static inline void erofs_cpu_hotplug_destroy(void) {}
+#endif
+
 void z_erofs_exit_zip_subsystem(void)
 {
+	erofs_cpu_hotplug_destroy();
+	erofs_destroy_percpu_workers();
 	destroy_workqueue(z_erofs_workqueue);
 	z_erofs_destroy_pcluster_pool();
 }
@@ -224,7 +346,23 @@ int __init z_erofs_init_zip_subsystem(void)
 		return err;
 	err = z_erofs_init_workqueue();
 	if (err)
-		z_erofs_destroy_pcluster_pool();
+		goto out_error_workqueue_init;
+
+	err = erofs_init_percpu_workers();
+	if (err)
+		goto out_error_pcpu_worker;
+
+	err = erofs_cpu_hotplug_init();
+	if (err < 0)
+		goto out_error_cpuhp_init;
+	return err;
+
+out_error_cpuhp_init:
+	erofs_destroy_percpu_workers();
+out_error_pcpu_worker:
+	destroy_workqueue(z_erofs_workqueue);
+out_error_workqueue_init:
+	z_erofs_destroy_pcluster_pool();
 	return err;
 }
 
@@ -282,6 +420,8 @@ struct z_erofs_decompress_frontend {
 	bool readahead;
 	/* used for applying cache strategy on the fly */
 	bool backmost;
+	/* the current extent is copied from the deduplication cache */
+	bool dedupe_hit;
 	erofs_off_t headoffset;
 
 	/* a pointer used to pick up inplace I/O pages */
@@ -503,6 +643,7 @@ static int z_erofs_register_pcluster(struct z_erofs_decompress_frontend *fe)
 	pcl->algorithmformat = map->m_algorithmformat;
 	pcl->length = 0;
 	pcl->partial = true;
+	pcl->nid = EROFS_I(fe->inode)->nid;
 
 	/* new pclusters should be claimed as type 1, primary and followed */
 	pcl->next = fe->owned_head;
@@ -578,6 +719,8 @@ static int z_erofs_collector_begin(struct z_erofs_decompress_frontend *fe)
 
 	if (ret == -EEXIST) {
 		mutex_lock(&fe->pcl->lock);
+		if (fe->pcl->nid != EROFS_I(fe->inode)->nid)
+			fe->pcl->shared = true;
 		/* used to check tail merging loop due to corrupted images */
 		if (fe->owned_head == Z_EROFS_PCLUSTER_TAIL)
 			fe->tailpcl = fe->pcl;
@@ -683,6 +826,65 @@ static int z_erofs_read_fragment(struct inode *inode, erofs_off_t pos,
 	return 0;
 }
 
+/*
+ * The decompressed data of a pcluster is kept in the deduplication cache at
+ * Z_EROFS_PCLUSTER_MAX_PAGES pages per pcluster, starting from its first byte
+ * whatever the offset of the extents referencing it.
+ */
+static bool z_erofs_dedupe_index(pgoff_t pclindex, pgoff_t *index)
+{
+	if (pclindex >= ULONG_MAX / Z_EROFS_PCLUSTER_MAX_PAGES)
+		return false;
+	*index = pclindex * Z_EROFS_PCLUSTER_MAX_PAGES;
+	return true;
+}
+
+static bool z_erofs_dedupe_cached(struct erofs_sb_info *sbi,
+				  struct erofs_map_blocks *map)
+{
+	pgoff_t index;
+	loff_t start;
+
+	if (!sbi->dedupe_cache || map->m_flags & EROFS_MAP_META ||
+	    !z_erofs_dedupe_index(map->m_pa >> PAGE_SHIFT, &index))
+		return false;
+	start = (loff_t)index << PAGE_SHIFT;
+	return filemap_range_has_page(sbi->dedupe_cache->i_mapping, start,
+				      start + PAGE_SIZE - 1);
+}
+
+/* copy the decompressed data at @pos of the current pcluster from the cache */
+static int z_erofs_read_dedupe(struct erofs_sb_info *sbi,
+			       struct erofs_map_blocks *map, erofs_off_t pos,
+			       struct page *page, unsigned int pageofs,
+			       unsigned int len)
+{
+	struct address_space *mapping = sbi->dedupe_cache->i_mapping;
+	struct page *src;
+	unsigned int i, cnt;
+	pgoff_t index;
+
+	if (!z_erofs_dedupe_index(map->m_pa >> PAGE_SHIFT, &index) ||
+	    pos + len > Z_EROFS_PCLUSTER_MAX_SIZE)
+		return -ENODATA;
+
+	for (i = 0; i < len; i += cnt) {
+		cnt = min_t(unsigned int, len - i,
+			    PAGE_SIZE - (pos & ~PAGE_MASK));
+		src = find_get_page(mapping, index + (pos >> PAGE_SHIFT));
+		if (!src)
+			return -ENODATA;
+		if (!PageUptodate(src)) {
+			put_page(src);
+			return -ENODATA;
+		}
+		memcpy_page(page, pageofs + i, src, pos & ~PAGE_MASK, cnt);
+		put_page(src);
+		pos += cnt;
+	}
+	return 0;
+}
+
 static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 				struct page *page, struct page **pagepool)
 {
@@ -710,13 +912,14 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 
 		if (z_erofs_collector_end(fe))
 			fe->backmost = false;
+		fe->dedupe_hit = false;
 		map->m_la = offset + cur;
 		map->m_llen = 0;
 		err = z_erofs_map_blocks_iter(inode, map, 0);
 		if (err)
 			goto out;
 	} else {
-		if (fe->pcl)
+		if (fe->pcl || fe->dedupe_hit)
 			goto hitted;
 		/* didn't get a valid pcluster previously (very rare) */
 	}
@@ -725,6 +928,10 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 	    map->m_flags & EROFS_MAP_FRAGMENT)
 		goto hitted;
 
+	fe->dedupe_hit = z_erofs_dedupe_cached(sbi, map);
+	if (fe->dedupe_hit)
+		goto hitted;
+nodedupe:
 	err = z_erofs_collector_begin(fe);
 	if (err)
 		goto out;
@@ -787,6 +994,28 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 		tight = false;
 		goto next_part;
 	}
+	if (fe->dedupe_hit) {
+		unsigned int pageofs, skip, len;
+
+		if (offset > map->m_la) {
+			pageofs = 0;
+			skip = offset - map->m_la;
+		} else {
+			pageofs = map->m_la & ~PAGE_MASK;
+			skip = 0;
+		}
+		len = min_t(unsigned int, map->m_llen - skip, end - cur);
+		err = z_erofs_read_dedupe(sbi, map, skip, page, pageofs, len);
+		if (err == -ENODATA) {
+			/* reclaimed in the meantime, decompress it again */
+			fe->dedupe_hit = false;
+			err = 0;
+			goto nodedupe;
+		}
+		++spiltted;
+		tight = false;
+		goto next_part;
+	}
 
 	exclusive = (!cur && (!spiltted || tight));
 	if (cur)
@@ -1016,6 +1245,52 @@ static int z_erofs_parse_in_bvecs(struct z_erofs_decompress_backend *be,
 	return 0;
 }
 
+/* keep the decompressed data of a shared pcluster for the other inodes */
+static void z_erofs_fill_dedupe_cache(struct z_erofs_decompress_backend *be)
+{
+	struct z_erofs_pcluster *pcl = be->pcl;
+	struct address_space *mapping =
+		EROFS_SB(be->sb)->dedupe_cache->i_mapping;
+	unsigned int i, j, pos, cur, cnt;
+	struct page *page;
+	pgoff_t index;
+
+	if (z_erofs_is_inline_pcluster(pcl) || pcl->partial || pcl->multibases ||
+	    pcl->length > Z_EROFS_PCLUSTER_MAX_SIZE ||
+	    !z_erofs_dedupe_index(pcl->obj.index, &index))
+		return;
+
+	for (i = 0; i < be->nr_pages; ++i)
+		if (!be->decompressed_pages[i])
+			return;
+
+	for (i = 0; i * PAGE_SIZE < pcl->length; ++i) {
+		page = find_or_create_page(mapping, index + i,
+				mapping_gfp_mask(mapping) | __GFP_NOWARN);
+		if (!page)
+			return;
+		if (PageUptodate(page))
+			goto next;
+
+		/* the decompressed data starts at pageofs_out of the output */
+		for (cur = 0; cur < PAGE_SIZE; cur += cnt) {
+			pos = pcl->pageofs_out + i * PAGE_SIZE + cur;
+			j = pos >> PAGE_SHIFT;
+			cnt = PAGE_SIZE - max(cur, pos & ~PAGE_MASK);
+			if (j >= be->nr_pages) {
+				memzero_page(page, cur, PAGE_SIZE - cur);
+				break;
+			}
+			memcpy_page(page, cur, be->decompressed_pages[j],
+				    pos & ~PAGE_MASK, cnt);
+		}
+		SetPageUptodate(page);
+next:
+		unlock_page(page);
+		put_page(page);
+	}
+}
+
 static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 				       int err)
 {
@@ -1101,6 +1376,8 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	    be->compressed_pages >= be->onstack_pages + Z_EROFS_ONSTACK_PAGES)
 		kvfree(be->compressed_pages);
 	z_erofs_fill_other_copies(be, err);
+	if (!err && pcl->shared && sbi->dedupe_cache)
+		z_erofs_fill_dedupe_cache(be);
 
 	for (i = 0; i < be->nr_pages; ++i) {
 		page = be->decompressed_pages[i];
@@ -1157,19 +1434,78 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
-static void z_erofs_decompressqueue_work(struct work_struct *work)
+/* decompress a queue and account it to the context it is decompressed in */
+static void z_erofs_decompress_queue_stat(struct z_erofs_decompressqueue *io,
+					  struct page **pagepool, int path)
+{
+	struct erofs_decompress_stats *stats =
+		&EROFS_SB(io->sb)->decompress_stats[path];
+	u64 start = ktime_get_ns(), kicked = io->kicked_ns;
+
+	z_erofs_decompress_queue(io, pagepool);
+
+	atomic64_inc(&stats->count);
+	atomic64_add(start - kicked, &stats->wait_ns);
+	atomic64_add(ktime_get_ns() - start, &stats->run_ns);
+}
+
+static void z_erofs_decompressqueue_bg(struct z_erofs_decompressqueue *bgq,
+				       int path)
 {
-	struct z_erofs_decompressqueue *bgq =
-		container_of(work, struct z_erofs_decompressqueue, u.work);
 	struct page *pagepool = NULL;
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
-	z_erofs_decompress_queue(bgq, &pagepool);
+	z_erofs_decompress_queue_stat(bgq, &pagepool, path);
 
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work)
+{
+	z_erofs_decompressqueue_bg(container_of(work,
+			struct z_erofs_decompressqueue, u.work),
+			EROFS_DECOMPRESS_WORKQUEUE);
+}
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
+{
+	z_erofs_decompressqueue_bg(container_of(work,
+			struct z_erofs_decompressqueue, u.kthread_work),
+			EROFS_DECOMPRESS_KTHREAD);
+}
+
+/*
+ * Small queues are decompressed by the worker of the CPU which completed
+ * their I/O, which is woken up right away and finds the data cache hot.
+ * Large ones are left to the unbound workqueue so that they neither delay
+ * the small ones nor hog a CPU when the workers run at a high priority.
+ */
+static bool z_erofs_decompressqueue_kthread(struct z_erofs_decompressqueue *io)
+{
+	struct kthread_worker *worker;
+
+	if (io->nr_pages > EROFS_SB(io->sb)->opt.max_pcpu_decompress_pages)
+		return false;
+
+	rcu_read_lock();
+	worker = rcu_dereference(z_erofs_pcpu_workers[raw_smp_processor_id()]);
+	if (worker) {
+		kthread_init_work(&io->u.kthread_work,
+				  z_erofs_decompressqueue_kthread_work);
+		kthread_queue_work(worker, &io->u.kthread_work);
+	}
+	rcu_read_unlock();
+	return worker;
+}
+#else
+static bool z_erofs_decompressqueue_kthread(struct z_erofs_decompressqueue *io)
+{
+	return false;
+}
+#endif
+
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       bool sync, int bios)
 {
@@ -1177,22 +1513,28 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 
 	/* wake up the caller thread for sync decompression */
 	if (sync) {
-		if (!atomic_add_return(bios, &io->pending_bios))
+		if (!atomic_add_return(bios, &io->pending_bios)) {
+			io->kicked_ns = ktime_get_ns();
 			complete(&io->u.done);
+		}
 		return;
 	}
 
 	if (atomic_add_return(bios, &io->pending_bios))
 		return;
-	/* Use workqueue and sync decompression for atomic contexts only */
+	io->kicked_ns = ktime_get_ns();
+	/* Use (kthread_)work and sync decompression for atomic contexts only */
 	if (in_atomic() || irqs_disabled()) {
-		queue_work(z_erofs_workqueue, &io->u.work);
+		if (!z_erofs_decompressqueue_kthread(io)) {
+			INIT_WORK(&io->u.work, z_erofs_decompressqueue_work);
+			queue_work(z_erofs_workqueue, &io->u.work);
+		}
 		/* enable sync decompression for readahead */
 		if (sbi->opt.sync_decompress == EROFS_SYNC_DECOMPRESS_AUTO)
 			sbi->opt.sync_decompress = EROFS_SYNC_DECOMPRESS_FORCE_ON;
 		return;
 	}
-	z_erofs_decompressqueue_work(&io->u.work);
+	z_erofs_decompressqueue_bg(io, EROFS_DECOMPRESS_INLINE);
 }
 
 static struct page *pickup_page_for_submission(struct z_erofs_pcluster *pcl,
@@ -1320,12 +1662,12 @@ jobqueue_init(struct super_block *sb,
 			*fg = true;
 			goto fg_out;
 		}
-		INIT_WORK(&q->u.work, z_erofs_decompressqueue_work);
 	} else {
 fg_out:
 		q = fgq;
 		init_completion(&fgq->u.done);
 		atomic_set(&fgq->pending_bios, 0);
+		q->nr_pages = 0;
 		q->eio = false;
 	}
 	q->sb = sb;
@@ -1500,10 +1842,12 @@ static void z_erofs_submit_queue(struct z_erofs_decompress_frontend *f,
 			bypass = false;
 		} while (++cur < end);
 
-		if (!bypass)
+		if (!bypass) {
 			qtail[JQ_SUBMIT] = &pcl->next;
-		else
+			q[JQ_SUBMIT]->nr_pages += z_erofs_pclusterpages(pcl);
+		} else {
 			move_to_bypass_jobqueue(pcl, qtail, owned_head);
+		}
 	} while (owned_head != Z_EROFS_PCLUSTER_TAIL);
 
 	if (bio) {
@@ -1542,7 +1886,8 @@ static void z_erofs_runqueue(struct z_erofs_decompress_frontend *f,
 	wait_for_completion_io(&io[JQ_SUBMIT].u.done);
 
 	/* handle synchronous decompress queue in the caller context */
-	z_erofs_decompress_queue(&io[JQ_SUBMIT], pagepool);
+	z_erofs_decompress_queue_stat(&io[JQ_SUBMIT], pagepool,
+				      EROFS_DECOMPRESS_SYNC);
 }
 
 /*
@@ -8,6 +8,7 @@
 
 #include "internal.h"
 #include "tagptr.h"
+#include <linux/kthread.h>
 
 #define Z_EROFS_PCLUSTER_MAX_PAGES	(Z_EROFS_PCLUSTER_MAX_SIZE / PAGE_SIZE)
 #define Z_EROFS_INLINE_BVECS		2
@@ -87,6 +88,12 @@ struct z_erofs_pcluster {
 	/* L: indicate several pageofs_outs or not */
 	bool multibases;
 
+	/* L: whether the pcluster has been read by more than one inode */
+	bool shared;
+
+	/* L: the first inode which read the pcluster */
+	erofs_nid_t nid;
+
 	/* A: compressed bvecs (can be cached or inplaced pages) */
 	struct z_erofs_bvec compressed_bvecs[];
 };
@@ -104,10 +111,17 @@ struct z_erofs_decompressqueue {
 	struct super_block *sb;
 	atomic_t pending_bios;
 	z_erofs_next_pcluster_t head;
+	/* number of compressed pages read for the queue */
+	unsigned int nr_pages;
+	/* time the last bio of the queue completed */
+	u64 kicked_ns;
 
 	union {
 		struct completion done;
 		struct work_struct work;
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+		struct kthread_work kthread_work;
+#endif
 	} u;
 
 	bool eio;
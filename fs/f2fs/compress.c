@@ -18,6 +18,7 @@
 #include "f2fs.h"
 #include "node.h"
 #include "segment.h"
+#include "iostat.h"
 #include <trace/events/f2fs.h>
 
 static struct kmem_cache *cic_entry_slab;
@@ -1495,16 +1496,25 @@ static int f2fs_write_raw_pages(struct compress_ctx *cc,
 	return 0;
 }
 
-int f2fs_write_multi_pages(struct compress_ctx *cc,
+static int f2fs_compress_cluster(struct compress_ctx *cc)
+{
+	u64 start = ktime_get_ns();
+	int err;
+
+	err = f2fs_compress_pages(cc);
+	f2fs_update_compress_iostat(F2FS_I_SB(cc->inode),
+					ktime_get_ns() - start);
+	return err;
+}
+
+static int f2fs_commit_multi_pages(struct compress_ctx *cc,
+					bool compressed, int err,
 					int *submitted,
 					struct writeback_control *wbc,
 					enum iostat_type io_type)
 {
-	int err;
-
 	*submitted = 0;
-	if (cluster_may_compress(cc)) {
-		err = f2fs_compress_pages(cc);
+	if (compressed) {
 		if (err == -EAGAIN) {
 			add_compr_block_stat(cc->inode, cc->cluster_size);
 			goto write;
@@ -1529,6 +1539,173 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 	return err;
 }
 
+int f2fs_write_multi_pages(struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	bool compressed = cluster_may_compress(cc);
+
+	return f2fs_commit_multi_pages(cc, compressed,
+				compressed ? f2fs_compress_cluster(cc) : 0,
+				submitted, wbc, io_type);
+}
+
+static struct workqueue_struct *f2fs_compress_wq;
+
+/* a cluster compressed by a worker, committed back in writeback context */
+struct f2fs_compress_job {
+	struct compress_ctx cc;		/* owns the locked cluster pages */
+	struct work_struct work;
+	struct completion done;
+	int err;			/* result of f2fs_compress_pages() */
+};
+
+/* ring of the clusters in flight during one writeback of a file */
+struct f2fs_compress_batch {
+	unsigned int head;		/* oldest cluster in flight */
+	unsigned int nr;		/* number of clusters in flight */
+	unsigned int max;		/* number of jobs */
+	struct f2fs_compress_job jobs[];
+};
+
+static void f2fs_compress_work(struct work_struct *work)
+{
+	struct f2fs_compress_job *job = container_of(work,
+					struct f2fs_compress_job, work);
+
+	job->err = f2fs_compress_cluster(&job->cc);
+	complete(&job->done);
+}
+
+struct f2fs_compress_batch *f2fs_alloc_compress_batch(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int max = READ_ONCE(sbi->compress_workers);
+	struct f2fs_compress_batch *batch;
+
+	/*
+	 * quota files are written back under the quota locks, keep their
+	 * clusters compressed inline.
+	 */
+	if (max <= 1 || IS_NOQUOTA(inode))
+		return NULL;
+	max = min_t(unsigned int, max, MAX_COMPRESS_WORKERS);
+
+	batch = kmalloc(struct_size(batch, jobs, max), GFP_NOFS);
+	if (!batch)
+		return NULL;
+	batch->head = 0;
+	batch->nr = 0;
+	batch->max = max;
+	return batch;
+}
+
+void f2fs_free_compress_batch(struct f2fs_compress_batch *batch)
+{
+	WARN_ON_ONCE(batch && batch->nr);
+	kfree(batch);
+}
+
+/* wait for the oldest cluster in flight and write it */
+static int f2fs_commit_compress_job(struct f2fs_compress_batch *batch,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct f2fs_compress_job *job = &batch->jobs[batch->head];
+
+	wait_for_completion(&job->done);
+	batch->head = (batch->head + 1) % batch->max;
+	batch->nr--;
+
+	return f2fs_commit_multi_pages(&job->cc, true, job->err,
+					submitted, wbc, io_type);
+}
+
+/**
+ * f2fs_flush_compress_batch() - write all the clusters in flight
+ * @batch: clusters in flight, may be NULL
+ * @submitted: number of pages submitted
+ * @wbc: writeback control
+ * @io_type: iostat type of the writes
+ *
+ * The clusters are written in the order they were queued.
+ *
+ * Return: 0, or the first error met while writing the clusters.
+ */
+int f2fs_flush_compress_batch(struct f2fs_compress_batch *batch,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	int err = 0;
+
+	*submitted = 0;
+	while (batch && batch->nr) {
+		int _submitted, ret;
+
+		ret = f2fs_commit_compress_job(batch, &_submitted,
+						wbc, io_type);
+		*submitted += _submitted;
+		if (ret && !err)
+			err = ret;
+	}
+	return err;
+}
+
+/**
+ * f2fs_queue_multi_pages() - write a cluster, compressing it on a worker
+ * @batch: clusters in flight, NULL to write the cluster synchronously
+ * @cc: compress context of the cluster, reset for the next cluster
+ * @submitted: number of pages submitted
+ * @wbc: writeback control
+ * @io_type: iostat type of the writes
+ *
+ * Writeback goes on gathering the next clusters while the workers compress
+ * the queued ones. Once the ring is full the oldest cluster is waited for
+ * and written, so clusters reach the disk in file order.
+ *
+ * Return: 0, or an error met while writing this or an earlier cluster.
+ */
+int f2fs_queue_multi_pages(struct f2fs_compress_batch *batch,
+					struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct f2fs_compress_job *job;
+	int err = 0;
+
+	if (!batch || !cluster_may_compress(cc)) {
+		int _submitted, ret;
+
+		err = f2fs_flush_compress_batch(batch, &_submitted,
+						wbc, io_type);
+		ret = f2fs_write_multi_pages(cc, submitted, wbc, io_type);
+		*submitted += _submitted;
+		return err ? err : ret;
+	}
+
+	*submitted = 0;
+	if (batch->nr == batch->max)
+		err = f2fs_commit_compress_job(batch, submitted, wbc, io_type);
+
+	job = &batch->jobs[(batch->head + batch->nr) % batch->max];
+	job->cc = *cc;
+	INIT_WORK(&job->work, f2fs_compress_work);
+	init_completion(&job->done);
+	batch->nr++;
+
+	/* the job owns the pages now */
+	cc->rpages = NULL;
+	cc->nr_rpages = 0;
+	cc->cluster_idx = NULL_CLUSTER;
+
+	queue_work(f2fs_compress_wq, &job->work);
+	return err;
+}
+
 static inline bool allow_memalloc_for_decomp(struct f2fs_sb_info *sbi,
 		bool pre_alloc)
 {
@@ -2031,7 +2208,13 @@ int __init f2fs_init_compress_cache(void)
 	err = f2fs_init_dic_cache();
 	if (err)
 		goto free_cic;
+	f2fs_compress_wq = alloc_workqueue("f2fs_compress",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!f2fs_compress_wq)
+		goto free_dic;
 	return 0;
+free_dic:
+	f2fs_destroy_dic_cache();
 free_cic:
 	f2fs_destroy_cic_cache();
 out:
@@ -2040,6 +2223,7 @@ int __init f2fs_init_compress_cache(void)
 
 void f2fs_destroy_compress_cache(void)
 {
+	destroy_workqueue(f2fs_compress_wq);
 	f2fs_destroy_dic_cache();
 	f2fs_destroy_cic_cache();
 }
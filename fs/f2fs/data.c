@@ -2944,6 +2944,7 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 	sector_t last_block;
 #ifdef CONFIG_F2FS_FS_COMPRESSION
 	struct inode *inode = mapping->host;
+	struct f2fs_compress_batch *batch = NULL;
 	struct compress_ctx cc = {
 		.inode = inode,
 		.log_cluster_size = F2FS_I(inode)->i_log_cluster_size,
@@ -2988,6 +2989,10 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		tag = PAGECACHE_TAG_TOWRITE;
 	else
 		tag = PAGECACHE_TAG_DIRTY;
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (f2fs_compressed_file(inode))
+		batch = f2fs_alloc_compress_batch(inode);
+#endif
 retry:
 	retry = 0;
 	if (wbc->sync_mode == WB_SYNC_ALL || wbc->tagged_writepages)
@@ -3018,8 +3023,8 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 
 				if (!f2fs_cluster_can_merge_page(&cc,
 								page->index)) {
-					ret = f2fs_write_multi_pages(&cc,
-						&submitted, wbc, io_type);
+					ret = f2fs_queue_multi_pages(batch,
+						&cc, &submitted, wbc, io_type);
 					if (!ret)
 						need_readd = true;
 					goto result;
@@ -3142,7 +3147,8 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 #ifdef CONFIG_F2FS_FS_COMPRESSION
 	/* flush remained pages in compress cluster */
 	if (f2fs_compressed_file(inode) && !f2fs_cluster_is_empty(&cc)) {
-		ret = f2fs_write_multi_pages(&cc, &submitted, wbc, io_type);
+		ret = f2fs_queue_multi_pages(batch, &cc, &submitted,
+						wbc, io_type);
 		nwritten += submitted;
 		wbc->nr_to_write -= submitted;
 		if (ret) {
@@ -3150,6 +3156,20 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 			retry = 0;
 		}
 	}
+	/* write the clusters still compressed by the workers */
+	if (batch) {
+		int ret2 = f2fs_flush_compress_batch(batch, &submitted,
+							wbc, io_type);
+
+		nwritten += submitted;
+		wbc->nr_to_write -= submitted;
+		if (ret2) {
+			if (!ret)
+				ret = ret2;
+			done = 1;
+			retry = 0;
+		}
+	}
 	if (f2fs_compressed_file(inode))
 		f2fs_destroy_compress_ctx(&cc, false);
 #endif
@@ -3158,6 +3178,9 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		end = -1;
 		goto retry;
 	}
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	f2fs_free_compress_batch(batch);
+#endif
 	if (wbc->range_cyclic && !done)
 		done_index = 0;
 	if (wbc->range_cyclic || (range_whole && wbc->nr_to_write > 0))
@@ -10,6 +10,7 @@
 
 #include <linux/fs.h>
 #include <linux/f2fs_fs.h>
+#include <linux/workqueue.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -451,6 +452,11 @@ static bool f2fs_lookup_extent_tree(struct inode *inode, pgoff_t pgofs,
 	stat_inc_total_hit(sbi);
 	read_unlock(&et->lock);
 
+	if (ret)
+		atomic64_inc(&sbi->extent_hit);
+	else
+		atomic64_inc(&sbi->extent_miss);
+
 	trace_f2fs_lookup_extent_tree_end(inode, pgofs, ei);
 	return ret;
 }
@@ -806,6 +812,7 @@ void f2fs_drop_extent_tree(struct inode *inode)
 
 	write_lock(&et->lock);
 	set_inode_flag(inode, FI_NO_EXTENT);
+	clear_inode_flag(inode, FI_EXTENT_PREFETCHED);
 	__free_extent_tree(sbi, et);
 	if (et->largest.len) {
 		et->largest.len = 0;
@@ -887,6 +894,102 @@ void f2fs_update_extent_cache_range(struct dnode_of_data *dn,
 	f2fs_update_extent_tree_range(dn->inode, fofs, blkaddr, len);
 }
 
+static struct workqueue_struct *extent_prefetch_wq;
+
+struct extent_prefetch_work {
+	struct work_struct work;
+	struct inode *inode;
+};
+
+static void f2fs_extent_prefetch_work(struct work_struct *work)
+{
+	struct extent_prefetch_work *epw = container_of(work,
+					struct extent_prefetch_work, work);
+	struct inode *inode = epw->inode;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+
+	if (!is_sbi_flag_set(sbi, SBI_IS_CLOSE) && !f2fs_cp_error(sbi) &&
+			f2fs_precache_extents(inode))
+		clear_inode_flag(inode, FI_EXTENT_PREFETCHED);
+
+	iput(inode);
+	kfree(epw);
+}
+
+/**
+ * f2fs_prefetch_extent_tree() - load the extents of a large file
+ * @inode: inode of the opened file
+ *
+ * Random reads of large fragmented files otherwise miss the extent cache
+ * and look the blocks up in the node pages one by one. The extents of
+ * files of at least extent_prefetch_blocks are loaded once per inode
+ * instance, in the background so the open does not wait for the node
+ * page reads.
+ */
+void f2fs_prefetch_extent_tree(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int threshold = READ_ONCE(sbi->extent_prefetch_blocks);
+	struct extent_prefetch_work *epw;
+
+	if (!threshold || !S_ISREG(inode->i_mode) ||
+			!f2fs_may_extent_tree(inode))
+		return;
+	if (F2FS_BYTES_TO_BLK(i_size_read(inode)) < threshold)
+		return;
+	if (test_and_set_bit(FI_EXTENT_PREFETCHED, F2FS_I(inode)->flags))
+		return;
+
+	epw = kmalloc(sizeof(*epw), GFP_NOFS);
+	if (!epw)
+		goto fail;
+	epw->inode = igrab(inode);
+	if (!epw->inode) {
+		kfree(epw);
+		goto fail;
+	}
+	INIT_WORK(&epw->work, f2fs_extent_prefetch_work);
+	queue_work(extent_prefetch_wq, &epw->work);
+	return;
+fail:
+	clear_inode_flag(inode, FI_EXTENT_PREFETCHED);
+}
+
+/* called at umount, the prefetches hold references of the inodes */
+void f2fs_flush_extent_prefetch(void)
+{
+	flush_workqueue(extent_prefetch_wq);
+}
+
+/**
+ * f2fs_update_extent_budget() - size the extent cache from its hit ratio
+ * @sbi: f2fs superblock
+ *
+ * The extent cache may use a share of the memory proportional to the hit
+ * ratio of its last EXTENT_BUDGET_WINDOW lookups, and at least
+ * MIN_EXTENT_BUDGET percent of it: a cache which lookups mostly miss keeps
+ * extents that are not read back and gives the memory back sooner.
+ *
+ * Racy callers only skew the heuristic, no locking is needed.
+ */
+void f2fs_update_extent_budget(struct f2fs_sb_info *sbi)
+{
+	u64 hit = atomic64_read(&sbi->extent_hit);
+	u64 miss = atomic64_read(&sbi->extent_miss);
+	u64 d_hit = hit - sbi->extent_prev_hit;
+	u64 d_miss = miss - sbi->extent_prev_miss;
+	unsigned int ratio;
+
+	if (d_hit + d_miss < EXTENT_BUDGET_WINDOW)
+		return;
+
+	ratio = div64_u64(d_hit * 100, d_hit + d_miss);
+	WRITE_ONCE(sbi->extent_budget, max_t(unsigned int, ratio,
+						MIN_EXTENT_BUDGET));
+	sbi->extent_prev_hit = hit;
+	sbi->extent_prev_miss = miss;
+}
+
 void f2fs_init_extent_cache_info(struct f2fs_sb_info *sbi)
 {
 	INIT_RADIX_TREE(&sbi->extent_tree_root, GFP_NOIO);
@@ -897,6 +1000,12 @@ void f2fs_init_extent_cache_info(struct f2fs_sb_info *sbi)
 	INIT_LIST_HEAD(&sbi->zombie_list);
 	atomic_set(&sbi->total_zombie_tree, 0);
 	atomic_set(&sbi->total_ext_node, 0);
+	atomic64_set(&sbi->extent_hit, 0);
+	atomic64_set(&sbi->extent_miss, 0);
+	sbi->extent_prev_hit = 0;
+	sbi->extent_prev_miss = 0;
+	sbi->extent_budget = 100;
+	sbi->extent_prefetch_blocks = DEF_EXTENT_PREFETCH_BLOCKS;
 }
 
 int __init f2fs_create_extent_cache(void)
@@ -907,15 +1016,23 @@ int __init f2fs_create_extent_cache(void)
 		return -ENOMEM;
 	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
 			sizeof(struct extent_node));
-	if (!extent_node_slab) {
-		kmem_cache_destroy(extent_tree_slab);
-		return -ENOMEM;
-	}
+	if (!extent_node_slab)
+		goto free_tree;
+	extent_prefetch_wq = alloc_workqueue("f2fs_extent_prefetch",
+						WQ_UNBOUND, 0);
+	if (!extent_prefetch_wq)
+		goto free_node;
 	return 0;
+free_node:
+	kmem_cache_destroy(extent_node_slab);
+free_tree:
+	kmem_cache_destroy(extent_tree_slab);
+	return -ENOMEM;
 }
 
 void f2fs_destroy_extent_cache(void)
 {
+	destroy_workqueue(extent_prefetch_wq);
 	kmem_cache_destroy(extent_node_slab);
 	kmem_cache_destroy(extent_tree_slab);
 }
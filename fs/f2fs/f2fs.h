@@ -599,6 +599,14 @@ enum {
 /* number of extent info in extent cache we try to shrink */
 #define EXTENT_CACHE_SHRINK_NUMBER	128
 
+/* prefetch the extents of files of at least this many blocks at open */
+#define DEF_EXTENT_PREFETCH_BLOCKS	(1 << 15)
+
+/* share of the extent cache memory kept by a cache missing all lookups */
+#define MIN_EXTENT_BUDGET		25
+/* # of lookups the hit ratio of the extent cache is computed over */
+#define EXTENT_BUDGET_WINDOW		1024
+
 #define RECOVERY_MAX_RA_BLOCKS		BIO_MAX_VECS
 #define RECOVERY_MIN_RA_BLOCKS		1
 
@@ -764,6 +772,7 @@ enum {
 	FI_COMPRESS_RELEASED,	/* compressed blocks were released */
 	FI_ALIGNED_WRITE,	/* enable aligned write */
 	FI_COW_FILE,		/* indicate COW file */
+	FI_EXTENT_PREFETCHED,	/* extents were prefetched at open */
 	FI_MAX,			/* max flag, never be used */
 };
 
@@ -1511,6 +1520,7 @@ enum compress_flag {
 
 #define	COMPRESS_WATERMARK			20
 #define	COMPRESS_PERCENT			20
+#define	MAX_COMPRESS_WORKERS			8
 
 #define COMPRESS_DATA_RESERVED_SIZE		4
 struct compress_data {
@@ -1676,6 +1686,12 @@ struct f2fs_sb_info {
 	struct list_head zombie_list;		/* extent zombie tree list */
 	atomic_t total_zombie_tree;		/* extent zombie tree count */
 	atomic_t total_ext_node;		/* extent info count */
+	atomic64_t extent_hit;			/* # of extent cache hits */
+	atomic64_t extent_miss;			/* # of extent cache misses */
+	u64 extent_prev_hit;			/* hits at last budget update */
+	u64 extent_prev_miss;			/* misses at last budget update */
+	unsigned int extent_budget;		/* % of extent memory allowed */
+	unsigned int extent_prefetch_blocks;	/* prefetch threshold */
 
 	/* basic filesystem units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
@@ -1851,6 +1867,9 @@ struct f2fs_sb_info {
 	unsigned int compress_percent;		/* cache page percentage */
 	unsigned int compress_watermark;	/* cache page watermark */
 	atomic_t compress_page_hit;		/* cache hit count */
+
+	/* clusters of a file compressed in parallel during writeback */
+	unsigned int compress_workers;
 #endif
 
 #ifdef CONFIG_F2FS_IOSTAT
@@ -1858,6 +1877,9 @@ struct f2fs_sb_info {
 	spinlock_t iostat_lock;
 	unsigned long long rw_iostat[NR_IO_TYPE];
 	unsigned long long prev_rw_iostat[NR_IO_TYPE];
+	unsigned long long compr_clusters;	/* compressed clusters */
+	unsigned long long compr_time_ns;	/* time compressing them */
+	unsigned long long compr_peak_ns;	/* longest cluster compression */
 	bool iostat_enable;
 	unsigned long iostat_next_period;
 	unsigned int iostat_period_ms;
@@ -4162,6 +4184,9 @@ bool f2fs_lookup_extent_cache(struct inode *inode, pgoff_t pgofs,
 void f2fs_update_extent_cache(struct dnode_of_data *dn);
 void f2fs_update_extent_cache_range(struct dnode_of_data *dn,
 			pgoff_t fofs, block_t blkaddr, unsigned int len);
+void f2fs_prefetch_extent_tree(struct inode *inode);
+void f2fs_flush_extent_prefetch(void);
+void f2fs_update_extent_budget(struct f2fs_sb_info *sbi);
 void f2fs_init_extent_cache_info(struct f2fs_sb_info *sbi);
 int __init f2fs_create_extent_cache(void);
 void f2fs_destroy_extent_cache(void);
@@ -4234,6 +4259,17 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 						int *submitted,
 						struct writeback_control *wbc,
 						enum iostat_type io_type);
+struct f2fs_compress_batch *f2fs_alloc_compress_batch(struct inode *inode);
+void f2fs_free_compress_batch(struct f2fs_compress_batch *batch);
+int f2fs_queue_multi_pages(struct f2fs_compress_batch *batch,
+						struct compress_ctx *cc,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
+int f2fs_flush_compress_batch(struct f2fs_compress_batch *batch,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
 int f2fs_is_compressed_cluster(struct inode *inode, pgoff_t index);
 void f2fs_update_extent_tree_range_compressed(struct inode *inode,
 				pgoff_t fofs, block_t blkaddr, unsigned int llen,
@@ -92,6 +92,15 @@ int __maybe_unused iostat_info_seq_show(struct seq_file *seq, void *offset)
 	seq_printf(seq, "fs discard:		%-16llu\n",
 				sbi->rw_iostat[FS_DISCARD]);
 
+	/* print cluster compression time */
+	seq_puts(seq, "[COMPRESS]\n");
+	seq_printf(seq, "clusters:		%-16llu\n",
+				sbi->compr_clusters);
+	seq_printf(seq, "total time(ns):		%-16llu\n",
+				sbi->compr_time_ns);
+	seq_printf(seq, "peak time(ns):		%-16llu\n",
+				sbi->compr_peak_ns);
+
 	return 0;
 }
 
@@ -162,6 +171,9 @@ void f2fs_reset_iostat(struct f2fs_sb_info *sbi)
 		sbi->rw_iostat[i] = 0;
 		sbi->prev_rw_iostat[i] = 0;
 	}
+	sbi->compr_clusters = 0;
+	sbi->compr_time_ns = 0;
+	sbi->compr_peak_ns = 0;
 	spin_unlock_irq(&sbi->iostat_lock);
 
 	spin_lock_irq(&sbi->iostat_lat_lock);
@@ -169,6 +181,21 @@ void f2fs_reset_iostat(struct f2fs_sb_info *sbi)
 	spin_unlock_irq(&sbi->iostat_lat_lock);
 }
 
+void f2fs_update_compress_iostat(struct f2fs_sb_info *sbi, u64 time_ns)
+{
+	unsigned long flags;
+
+	if (!sbi->iostat_enable)
+		return;
+
+	spin_lock_irqsave(&sbi->iostat_lock, flags);
+	sbi->compr_clusters++;
+	sbi->compr_time_ns += time_ns;
+	if (time_ns > sbi->compr_peak_ns)
+		sbi->compr_peak_ns = time_ns;
+	spin_unlock_irqrestore(&sbi->iostat_lock, flags);
+}
+
 void f2fs_update_iostat(struct f2fs_sb_info *sbi, struct inode *inode,
 			enum iostat_type type, unsigned long long io_bytes)
 {
@@ -3614,6 +3614,10 @@ static void init_sb_info(struct f2fs_sb_info *sbi)
 	sbi->max_victim_search = DEF_MAX_VICTIM_SEARCH;
 	sbi->migration_granularity = sbi->segs_per_sec;
 	sbi->seq_file_ra_mul = MIN_RA_MUL;
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	sbi->compress_workers = min_t(unsigned int, num_online_cpus(),
+					MAX_COMPRESS_WORKERS);
+#endif
 	sbi->max_fragment_chunk = DEF_FRAGMENT_SIZE;
 	sbi->max_fragment_hole = DEF_FRAGMENT_SIZE;
 	spin_lock_init(&sbi->gc_urgent_high_lock);
@@ -4588,6 +4592,7 @@ static void kill_f2fs_super(struct super_block *sb)
 		set_sbi_flag(sbi, SBI_IS_CLOSE);
 		f2fs_stop_gc_thread(sbi);
 		f2fs_stop_discard_thread(sbi);
+		f2fs_flush_extent_prefetch();
 
 #ifdef CONFIG_F2FS_FS_COMPRESSION
 		/*
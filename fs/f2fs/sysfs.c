@@ -122,6 +122,18 @@ static ssize_t lifetime_write_kbytes_show(struct f2fs_attr *a,
 				sbi->sectors_written_start) >> 1)));
 }
 
+static ssize_t extent_cache_hit_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return sprintf(buf, "%lld\n", atomic64_read(&sbi->extent_hit));
+}
+
+static ssize_t extent_cache_miss_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return sprintf(buf, "%lld\n", atomic64_read(&sbi->extent_miss));
+}
+
 static ssize_t sb_status_show(struct f2fs_attr *a,
 		struct f2fs_sb_info *sbi, char *buf)
 {
@@ -604,6 +616,15 @@ static ssize_t __sbi_store(struct f2fs_attr *a,
 		return count;
 	}
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (!strcmp(a->attr.name, "compress_workers")) {
+		if (t > MAX_COMPRESS_WORKERS)
+			return -EINVAL;
+		WRITE_ONCE(sbi->compress_workers, t);
+		return count;
+	}
+#endif
+
 	if (!strcmp(a->attr.name, "seq_file_ra_mul")) {
 		if (t >= MIN_RA_MUL && t <= MAX_RA_MUL)
 			sbi->seq_file_ra_mul = t;
@@ -838,6 +859,11 @@ F2FS_GENERAL_RO_ATTR(encoding);
 F2FS_GENERAL_RO_ATTR(mounted_time_sec);
 F2FS_GENERAL_RO_ATTR(main_blkaddr);
 F2FS_GENERAL_RO_ATTR(pending_discard);
+F2FS_GENERAL_RO_ATTR(extent_cache_hit);
+F2FS_GENERAL_RO_ATTR(extent_cache_miss);
+F2FS_RO_ATTR(F2FS_SBI, f2fs_sb_info, extent_cache_budget, extent_budget);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, extent_prefetch_blocks,
+					extent_prefetch_blocks);
 #ifdef CONFIG_F2FS_STAT_FS
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_foreground_calls, cp_count);
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_background_calls, bg_cp_count);
@@ -881,6 +907,7 @@ F2FS_FEATURE_RO_ATTR(compression);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, compr_written_block, compr_written_block);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, compr_saved_block, compr_saved_block);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, compr_new_inode, compr_new_inode);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, compress_workers, compress_workers);
 #endif
 F2FS_FEATURE_RO_ATTR(pin_file);
 
@@ -946,6 +973,10 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(max_io_bytes),
 	ATTR_LIST(gc_pin_file_thresh),
 	ATTR_LIST(extension_list),
+	ATTR_LIST(extent_cache_hit),
+	ATTR_LIST(extent_cache_miss),
+	ATTR_LIST(extent_cache_budget),
+	ATTR_LIST(extent_prefetch_blocks),
 #ifdef CONFIG_F2FS_FAULT_INJECTION
 	ATTR_LIST(inject_rate),
 	ATTR_LIST(inject_type),
@@ -980,6 +1011,7 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(compr_written_block),
 	ATTR_LIST(compr_saved_block),
 	ATTR_LIST(compr_new_inode),
+	ATTR_LIST(compress_workers),
 #endif
 	/* For ATGC */
 	ATTR_LIST(atgc_candidate_ratio),
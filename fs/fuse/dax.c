@@ -32,12 +32,18 @@
  */
 #define FUSE_DAX_RECLAIM_THRESHOLD	(20)
 
+/* Maximum number of free ranges a CPU takes from the free list at once */
+#define FUSE_DAX_PCP_BATCH		(8)
+
 /** Translation information for file offsets to DAX window offsets */
 struct fuse_dax_mapping {
 	/* Pointer to inode where this memory range is mapped */
 	struct inode *inode;
 
-	/* Will connect in fcd->free_ranges to keep track of free memory */
+	/*
+	 * Will connect in fcd->free_ranges, or in the ranges of a per CPU
+	 * cache, to keep track of free memory
+	 */
 	struct list_head list;
 
 	/* For interval tree in file/inode */
@@ -69,6 +75,13 @@ struct fuse_inode_dax {
 	unsigned long nr;
 };
 
+/* Per CPU cache of free ranges, refilled from fcd->free_ranges in batches */
+struct fuse_dax_pcp {
+	spinlock_t lock;
+	struct list_head ranges;
+	unsigned int nr;
+};
+
 struct fuse_conn_dax {
 	/* DAX device */
 	struct dax_device *dev;
@@ -86,10 +99,14 @@ struct fuse_conn_dax {
 	/* Wait queue for a dax range to become free */
 	wait_queue_head_t range_waitq;
 
-	/* DAX Window Free Ranges */
-	long nr_free_ranges;
+	/* DAX Window Free Ranges, including the ones cached by CPUs */
+	atomic_long_t nr_free_ranges;
 	struct list_head free_ranges;
 
+	/* Free ranges cached by each CPU */
+	struct fuse_dax_pcp __percpu *pcp;
+	unsigned int pcp_batch;
+
 	unsigned long nr_ranges;
 };
 
@@ -105,41 +122,89 @@ node_to_dmap(struct interval_tree_node *node)
 static struct fuse_dax_mapping *
 alloc_dax_mapping_reclaim(struct fuse_conn_dax *fcd, struct inode *inode);
 
-static void
-__kick_dmap_free_worker(struct fuse_conn_dax *fcd, unsigned long delay_ms)
+/* The number of free ranges is atomic, fcd->lock need not be held */
+static void kick_dmap_free_worker(struct fuse_conn_dax *fcd,
+				  unsigned long delay_ms)
 {
 	unsigned long free_threshold;
 
 	/* If number of free ranges are below threshold, start reclaim */
 	free_threshold = max_t(unsigned long, fcd->nr_ranges * FUSE_DAX_RECLAIM_THRESHOLD / 100,
 			     1);
-	if (fcd->nr_free_ranges < free_threshold)
+	if (atomic_long_read(&fcd->nr_free_ranges) < free_threshold)
 		queue_delayed_work(system_long_wq, &fcd->free_work,
 				   msecs_to_jiffies(delay_ms));
 }
 
-static void kick_dmap_free_worker(struct fuse_conn_dax *fcd,
-				  unsigned long delay_ms)
+/* Move the ranges cached by all the CPUs back to fcd->free_ranges */
+static void __dmap_drain_pcp(struct fuse_conn_dax *fcd)
+{
+	struct fuse_dax_pcp *pcp;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(fcd->pcp, cpu);
+		spin_lock(&pcp->lock);
+		list_splice_tail_init(&pcp->ranges, &fcd->free_ranges);
+		pcp->nr = 0;
+		spin_unlock(&pcp->lock);
+	}
+}
+
+/*
+ * Take a free range from fcd->free_ranges and refill the cache of the CPU
+ * with up to one batch more. Once the list is empty the remaining free
+ * ranges may all be cached by other CPUs, take them back first.
+ */
+static struct fuse_dax_mapping *
+alloc_dax_mapping_refill(struct fuse_conn_dax *fcd, struct fuse_dax_pcp *pcp)
 {
+	struct fuse_dax_mapping *dmap, *next, *tmp;
+	unsigned int n = 1;
+
 	spin_lock(&fcd->lock);
-	__kick_dmap_free_worker(fcd, delay_ms);
+	if (list_empty(&fcd->free_ranges))
+		__dmap_drain_pcp(fcd);
+
+	dmap = list_first_entry_or_null(&fcd->free_ranges,
+					struct fuse_dax_mapping, list);
+	if (!dmap)
+		goto out;
+	list_del_init(&dmap->list);
+
+	spin_lock(&pcp->lock);
+	list_for_each_entry_safe(next, tmp, &fcd->free_ranges, list) {
+		if (n++ >= fcd->pcp_batch)
+			break;
+		list_move_tail(&next->list, &pcp->ranges);
+		pcp->nr++;
+	}
+	spin_unlock(&pcp->lock);
+out:
 	spin_unlock(&fcd->lock);
+	return dmap;
 }
 
 static struct fuse_dax_mapping *alloc_dax_mapping(struct fuse_conn_dax *fcd)
 {
+	struct fuse_dax_pcp *pcp = raw_cpu_ptr(fcd->pcp);
 	struct fuse_dax_mapping *dmap;
 
-	spin_lock(&fcd->lock);
-	dmap = list_first_entry_or_null(&fcd->free_ranges,
-					struct fuse_dax_mapping, list);
+	/* Being migrated meanwhile only costs the locality of the cache */
+	spin_lock(&pcp->lock);
+	dmap = list_first_entry_or_null(&pcp->ranges, struct fuse_dax_mapping,
+					list);
 	if (dmap) {
 		list_del_init(&dmap->list);
-		WARN_ON(fcd->nr_free_ranges <= 0);
-		fcd->nr_free_ranges--;
+		pcp->nr--;
 	}
-	__kick_dmap_free_worker(fcd, 0);
-	spin_unlock(&fcd->lock);
+	spin_unlock(&pcp->lock);
+
+	if (!dmap)
+		dmap = alloc_dax_mapping_refill(fcd, pcp);
+	if (dmap)
+		WARN_ON(atomic_long_dec_return(&fcd->nr_free_ranges) < 0);
+	kick_dmap_free_worker(fcd, 0);
 
 	return dmap;
 }
@@ -166,7 +231,7 @@ static void __dmap_add_to_free_pool(struct fuse_conn_dax *fcd,
 				struct fuse_dax_mapping *dmap)
 {
 	list_add_tail(&dmap->list, &fcd->free_ranges);
-	fcd->nr_free_ranges++;
+	atomic_long_inc(&fcd->nr_free_ranges);
 	wake_up(&fcd->range_waitq);
 }
 
@@ -191,7 +256,7 @@ static int fuse_setup_one_mapping(struct inode *inode, unsigned long start_idx,
 	FUSE_ARGS(args);
 	ssize_t err;
 
-	WARN_ON(fcd->nr_free_ranges < 0);
+	WARN_ON(atomic_long_read(&fcd->nr_free_ranges) < 0);
 
 	/* Ask fuse daemon to setup mapping */
 	memset(&inarg, 0, sizeof(inarg));
@@ -799,8 +864,9 @@ static vm_fault_t __fuse_dax_fault(struct vm_fault *vmf,
 	if (write)
 		sb_start_pagefault(sb);
 retry:
-	if (retry && !(fcd->nr_free_ranges > 0))
-		wait_event(fcd->range_waitq, (fcd->nr_free_ranges > 0));
+	if (retry && !(atomic_long_read(&fcd->nr_free_ranges) > 0))
+		wait_event(fcd->range_waitq,
+			   (atomic_long_read(&fcd->nr_free_ranges) > 0));
 
 	/*
 	 * We need to serialize against not only truncate but also against
@@ -1059,9 +1125,10 @@ alloc_dax_mapping_reclaim(struct fuse_conn_dax *fcd, struct inode *inode)
 		 * mapping->invalidate_lock, worker should still be able to
 		 * free up a range and wake us up.
 		 */
-		if (!fi->dax->nr && !(fcd->nr_free_ranges > 0)) {
+		if (!fi->dax->nr &&
+		    !(atomic_long_read(&fcd->nr_free_ranges) > 0)) {
 			if (wait_event_killable_exclusive(fcd->range_waitq,
-					(fcd->nr_free_ranges > 0))) {
+				(atomic_long_read(&fcd->nr_free_ranges) > 0))) {
 				return ERR_PTR(-EINTR);
 			}
 		}
@@ -1222,6 +1289,8 @@ static void fuse_free_dax_mem_ranges(struct list_head *mem_list)
 void fuse_dax_conn_free(struct fuse_conn *fc)
 {
 	if (fc->dax) {
+		__dmap_drain_pcp(fc->dax);
+		free_percpu(fc->dax->pcp);
 		fuse_free_dax_mem_ranges(&fc->dax->free_ranges);
 		kfree(fc->dax);
 	}
@@ -1234,6 +1303,17 @@ static int fuse_dax_mem_range_init(struct fuse_conn_dax *fcd)
 	int ret, id;
 	size_t dax_size = -1;
 	unsigned long i;
+	int cpu;
+
+	fcd->pcp = alloc_percpu(struct fuse_dax_pcp);
+	if (!fcd->pcp)
+		return -ENOMEM;
+	for_each_possible_cpu(cpu) {
+		struct fuse_dax_pcp *pcp = per_cpu_ptr(fcd->pcp, cpu);
+
+		spin_lock_init(&pcp->lock);
+		INIT_LIST_HEAD(&pcp->ranges);
+	}
 
 	init_waitqueue_head(&fcd->range_waitq);
 	INIT_LIST_HEAD(&fcd->free_ranges);
@@ -1246,6 +1326,7 @@ static int fuse_dax_mem_range_init(struct fuse_conn_dax *fcd)
 	dax_read_unlock(id);
 	if (nr_pages < 0) {
 		pr_debug("dax_direct_access() returned %ld\n", nr_pages);
+		free_percpu(fcd->pcp);
 		return nr_pages;
 	}
 
@@ -1270,12 +1351,17 @@ static int fuse_dax_mem_range_init(struct fuse_conn_dax *fcd)
 		list_add_tail(&range->list, &fcd->free_ranges);
 	}
 
-	fcd->nr_free_ranges = nr_ranges;
+	atomic_long_set(&fcd->nr_free_ranges, nr_ranges);
 	fcd->nr_ranges = nr_ranges;
+	/* Leave most of the free ranges to the list on small windows */
+	fcd->pcp_batch = clamp_t(unsigned long,
+				 nr_ranges / (4 * num_possible_cpus()), 1,
+				 FUSE_DAX_PCP_BATCH);
 	return 0;
 out_err:
 	/* Free All allocated elements */
 	fuse_free_dax_mem_ranges(&fcd->free_ranges);
+	free_percpu(fcd->pcp);
 	return ret;
 }
 
@@ -21,6 +21,7 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/io_uring.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -31,6 +32,14 @@ MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
+#ifdef CONFIG_FUSE_IO_URING
+static void fuse_uring_kick(struct fuse_conn *fc);
+static void fuse_uring_abort(struct fuse_conn *fc);
+#else
+static inline void fuse_uring_kick(struct fuse_conn *fc) { }
+static inline void fuse_uring_abort(struct fuse_conn *fc) { }
+#endif
+
 static struct fuse_dev *fuse_get_dev(struct file *file)
 {
 	/*
@@ -213,6 +222,7 @@ __releases(fiq->lock)
 	wake_up(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 	spin_unlock(&fiq->lock);
+	fuse_uring_kick(container_of(fiq, struct fuse_conn, iq));
 }
 
 const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
@@ -1198,7 +1208,7 @@ __releases(fiq->lock)
  * fuse_request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
+static ssize_t fuse_dev_do_read(struct fuse_dev *fud, bool nonblock,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
 	ssize_t err;
@@ -1235,7 +1245,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 			break;
 		spin_unlock(&fiq->lock);
 
-		if (file->f_flags & O_NONBLOCK)
+		if (nonblock)
 			return -EAGAIN;
 		err = wait_event_interruptible_exclusive(fiq->waitq,
 				!fiq->connected || request_pending(fiq));
@@ -1361,7 +1371,8 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, struct iov_iter *to)
 
 	fuse_copy_init(&cs, 1, to);
 
-	return fuse_dev_do_read(fud, file, &cs, iov_iter_count(to));
+	return fuse_dev_do_read(fud, file->f_flags & O_NONBLOCK, &cs,
+				iov_iter_count(to));
 }
 
 static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
@@ -1385,7 +1396,7 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, 1, NULL);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fud, in, &cs, len);
+	ret = fuse_dev_do_read(fud, in->f_flags & O_NONBLOCK, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -2178,6 +2189,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		spin_unlock(&fc->lock);
 
 		end_requests(&to_end);
+		fuse_uring_abort(fc);
 	} else {
 		spin_unlock(&fc->lock);
 	}
@@ -2280,6 +2292,32 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case FUSE_DEV_IOC_BACKING_OPEN: {
+		struct fuse_backing_map map;
+
+		fud = fuse_get_dev(file);
+		res = -EPERM;
+		if (!fud)
+			break;
+		res = -EFAULT;
+		if (copy_from_user(&map, (void __user *)arg, sizeof(map)))
+			break;
+		res = fuse_backing_open(fud->fc, &map);
+		break;
+	}
+	case FUSE_DEV_IOC_BACKING_CLOSE: {
+		__u32 backing_id;
+
+		fud = fuse_get_dev(file);
+		res = -EPERM;
+		if (!fud)
+			break;
+		res = -EFAULT;
+		if (get_user(backing_id, (__u32 __user *)arg))
+			break;
+		res = fuse_backing_close(fud->fc, backing_id);
+		break;
+	}
 	default:
 		res = -ENOTTY;
 		break;
@@ -2287,6 +2325,366 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 	return res;
 }
 
+#ifdef CONFIG_FUSE_IO_URING
+/*
+ * io_uring transport
+ *
+ * The daemon threads post FUSE_URING_CMD_FETCH commands, each with a buffer
+ * as large as a read of the device needs.  A command waits on the queue of
+ * its CPU until a request is queued on the connection, and is then completed
+ * from the task of the daemon thread, after fuse_dev_do_read() copied the
+ * request to its buffer.  FUSE_URING_CMD_COMMIT_AND_FETCH hands the reply to
+ * fuse_dev_do_write() and fetches the next request right away when one is
+ * pending, so a busy daemon thread serves a request per command without any
+ * read or write system call, nor a wakeup.
+ *
+ * The requests stay on the input queue of the connection, which keeps the
+ * ordering of interrupts and forgets and lets /dev/fuse readers coexist.
+ * The CPU queueing a request completes a command of its own queue first.
+ */
+
+/* delay between the checks of the daemon threads exiting */
+#define FUSE_URING_MONITOR_DELAY	HZ
+
+/* pdu of a command that waited for a request */
+struct fuse_uring_pdu {
+	struct list_head list;
+	u64 buf;
+	u32 buf_len;
+	u16 qid;
+};
+
+struct fuse_uring_queue {
+	spinlock_t lock;
+	/* FUSE_URING_CMD_FETCH commands waiting for a request */
+	struct list_head idle;
+	/* daemon thread issuing the commands of the queue */
+	struct task_struct *task;
+} ____cacheline_aligned_in_smp;
+
+struct fuse_ring {
+	struct fuse_conn *fc;
+	/* completes the commands of the exiting daemon threads */
+	struct delayed_work monitor;
+	/* one queue per possible CPU */
+	struct fuse_uring_queue queues[];
+};
+
+static struct fuse_uring_pdu *fuse_uring_pdu(struct io_uring_cmd *cmd)
+{
+	BUILD_BUG_ON(sizeof(struct fuse_uring_pdu) > sizeof(cmd->pdu));
+
+	return (struct fuse_uring_pdu *)cmd->pdu;
+}
+
+static struct io_uring_cmd *fuse_uring_pdu_cmd(struct fuse_uring_pdu *pdu)
+{
+	return container_of((void *)pdu, struct io_uring_cmd, pdu);
+}
+
+static bool fuse_uring_pending(struct fuse_conn *fc)
+{
+	struct fuse_iqueue *fiq = &fc->iq;
+
+	return !READ_ONCE(fiq->connected) || request_pending(fiq);
+}
+
+static void fuse_uring_cancel_queue(struct fuse_uring_queue *queue, int err)
+{
+	struct fuse_uring_pdu *pdu, *next;
+	LIST_HEAD(cancel);
+
+	spin_lock(&queue->lock);
+	list_splice_init(&queue->idle, &cancel);
+	spin_unlock(&queue->lock);
+
+	list_for_each_entry_safe(pdu, next, &cancel, list) {
+		list_del_init(&pdu->list);
+		io_uring_cmd_done(fuse_uring_pdu_cmd(pdu), err, 0);
+	}
+}
+
+/*
+ * io_uring waits for the commands of an exiting task to complete, which
+ * the release of /dev/fuse cannot do while they hold references of it.
+ */
+static void fuse_uring_monitor(struct work_struct *work)
+{
+	struct fuse_ring *ring = container_of(to_delayed_work(work),
+					      struct fuse_ring, monitor);
+	bool active = false;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct fuse_uring_queue *queue = &ring->queues[cpu];
+		struct task_struct *task;
+
+		spin_lock(&queue->lock);
+		task = queue->task;
+		if (task && (task->flags & PF_EXITING))
+			queue->task = NULL;
+		else
+			task = NULL;
+		active |= queue->task != NULL;
+		spin_unlock(&queue->lock);
+
+		if (task) {
+			fuse_uring_cancel_queue(queue, -ECANCELED);
+			put_task_struct(task);
+		}
+	}
+
+	if (active)
+		schedule_delayed_work(&ring->monitor, FUSE_URING_MONITOR_DELAY);
+}
+
+static struct fuse_ring *fuse_uring_get(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	struct fuse_ring *old;
+	int cpu;
+
+	if (ring)
+		return ring;
+
+	ring = kzalloc(struct_size(ring, queues, nr_cpu_ids),
+		       GFP_KERNEL_ACCOUNT);
+	if (!ring)
+		return NULL;
+
+	ring->fc = fc;
+	INIT_DELAYED_WORK(&ring->monitor, fuse_uring_monitor);
+	for_each_possible_cpu(cpu) {
+		spin_lock_init(&ring->queues[cpu].lock);
+		INIT_LIST_HEAD(&ring->queues[cpu].idle);
+	}
+
+	old = cmpxchg(&fc->ring, NULL, ring);
+	if (old) {
+		kfree(ring);
+		return old;
+	}
+	return ring;
+}
+
+/* Bind the queue to the daemon thread issuing its first command */
+static int fuse_uring_bind(struct fuse_ring *ring,
+			   struct fuse_uring_queue *queue)
+{
+	int err = 0;
+
+	spin_lock(&queue->lock);
+	if (!queue->task)
+		queue->task = get_task_struct(current);
+	else if (queue->task != current)
+		err = -EINVAL;
+	spin_unlock(&queue->lock);
+
+	if (!err)
+		schedule_delayed_work(&ring->monitor, FUSE_URING_MONITOR_DELAY);
+	return err;
+}
+
+static ssize_t fuse_uring_read(struct fuse_dev *fud,
+			       struct fuse_uring_pdu *pdu)
+{
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	struct iovec iov;
+	int err;
+
+	err = import_single_range(READ, u64_to_user_ptr(pdu->buf),
+				  pdu->buf_len, &iov, &iter);
+	if (err)
+		return err;
+
+	fuse_copy_init(&cs, 1, &iter);
+	return fuse_dev_do_read(fud, true, &cs, pdu->buf_len);
+}
+
+static ssize_t fuse_uring_commit(struct fuse_dev *fud,
+				 struct fuse_uring_pdu *pdu)
+{
+	struct fuse_out_header __user *oh = u64_to_user_ptr(pdu->buf);
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	struct iovec iov;
+	u32 len;
+	int err;
+
+	if (get_user(len, &oh->len))
+		return -EFAULT;
+	if (len > pdu->buf_len)
+		return -EINVAL;
+
+	err = import_single_range(WRITE, oh, len, &iov, &iter);
+	if (err)
+		return err;
+
+	fuse_copy_init(&cs, 0, &iter);
+	return fuse_dev_do_write(fud, &cs, len);
+}
+
+/* Park the command until a request is queued */
+static void fuse_uring_idle(struct fuse_ring *ring, struct io_uring_cmd *cmd)
+{
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	struct fuse_uring_queue *queue = &ring->queues[pdu->qid];
+
+	spin_lock(&queue->lock);
+	list_add(&pdu->list, &queue->idle);
+	spin_unlock(&queue->lock);
+
+	/* A request queued before the command was parked did not see it */
+	if (fuse_uring_pending(ring->fc))
+		fuse_uring_kick(ring->fc);
+}
+
+static void fuse_uring_fetch_tw(struct io_uring_cmd *cmd)
+{
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+	struct fuse_conn *fc = fud->fc;
+	ssize_t ret;
+
+	/* Run from a kworker once the task exits, its memory is gone */
+	if (current->flags & (PF_EXITING | PF_KTHREAD)) {
+		io_uring_cmd_done(cmd, -ECANCELED, 0);
+		/* Hand the request over to another command */
+		fuse_uring_kick(fc);
+		return;
+	}
+
+	ret = fuse_uring_read(fud, fuse_uring_pdu(cmd));
+	if (ret == -EAGAIN) {
+		/* A /dev/fuse reader or another command took the request */
+		fuse_uring_idle(fc->ring, cmd);
+		return;
+	}
+	io_uring_cmd_done(cmd, ret, 0);
+}
+
+static void fuse_uring_kick(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	struct fuse_uring_pdu *pdu = NULL;
+	int this_cpu, cpu;
+
+	if (!ring)
+		return;
+
+	this_cpu = raw_smp_processor_id();
+	cpu = this_cpu;
+	for (;;) {
+		struct fuse_uring_queue *queue = &ring->queues[cpu];
+
+		if (!list_empty(&queue->idle)) {
+			spin_lock(&queue->lock);
+			pdu = list_first_entry_or_null(&queue->idle,
+						       struct fuse_uring_pdu,
+						       list);
+			if (pdu)
+				list_del_init(&pdu->list);
+			spin_unlock(&queue->lock);
+			if (pdu)
+				break;
+		}
+
+		cpu = cpumask_next(cpu, cpu_possible_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_possible_mask);
+		if (cpu == this_cpu)
+			return;
+	}
+
+	io_uring_cmd_complete_in_task(fuse_uring_pdu_cmd(pdu),
+				      fuse_uring_fetch_tw);
+}
+
+static void fuse_uring_abort(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	int cpu;
+
+	if (!ring)
+		return;
+
+	for_each_possible_cpu(cpu)
+		fuse_uring_cancel_queue(&ring->queues[cpu], -ECONNABORTED);
+}
+
+void fuse_uring_destroy(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = fc->ring;
+	int cpu;
+
+	if (!ring)
+		return;
+
+	cancel_delayed_work_sync(&ring->monitor);
+	for_each_possible_cpu(cpu) {
+		struct fuse_uring_queue *queue = &ring->queues[cpu];
+
+		WARN_ON(!list_empty(&queue->idle));
+		if (queue->task)
+			put_task_struct(queue->task);
+	}
+	kfree(ring);
+	fc->ring = NULL;
+}
+
+static int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
+{
+	const struct fuse_uring_cmd_req *req = cmd->cmd;
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+	struct fuse_ring *ring;
+	ssize_t ret;
+	int err;
+
+	if (!fud)
+		return -EPERM;
+
+	if (cmd->cmd_op != FUSE_URING_CMD_FETCH &&
+	    cmd->cmd_op != FUSE_URING_CMD_COMMIT_AND_FETCH)
+		return -EOPNOTSUPP;
+
+	pdu->buf = READ_ONCE(req->buf);
+	pdu->buf_len = READ_ONCE(req->buf_len);
+	pdu->qid = READ_ONCE(req->qid);
+	if (READ_ONCE(req->padding))
+		return -EINVAL;
+	if (pdu->qid >= nr_cpu_ids || !cpu_possible(pdu->qid))
+		return -EINVAL;
+
+	ring = fuse_uring_get(fud->fc);
+	if (!ring)
+		return -ENOMEM;
+
+	err = fuse_uring_bind(ring, &ring->queues[pdu->qid]);
+	if (err)
+		return err;
+
+	if (cmd->cmd_op == FUSE_URING_CMD_COMMIT_AND_FETCH) {
+		ret = fuse_uring_commit(fud, pdu);
+		/*
+		 * The request may have been interrupted or aborted, which a
+		 * daemon writing to the device ignores too.
+		 */
+		if (ret < 0 && ret != -ENOENT)
+			return ret;
+	}
+
+	if (fuse_uring_pending(fud->fc)) {
+		ret = fuse_uring_read(fud, pdu);
+		if (ret != -EAGAIN)
+			return ret;
+	}
+
+	fuse_uring_idle(ring, cmd);
+	return -EIOCBQUEUED;
+}
+#endif /* CONFIG_FUSE_IO_URING */
+
 const struct file_operations fuse_dev_operations = {
 	.owner		= THIS_MODULE,
 	.open		= fuse_dev_open,
@@ -2300,6 +2698,9 @@ const struct file_operations fuse_dev_operations = {
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
 	.compat_ioctl   = compat_ptr_ioctl,
+#ifdef CONFIG_FUSE_IO_URING
+	.uring_cmd	= fuse_uring_cmd,
+#endif
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
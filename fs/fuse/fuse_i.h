@@ -226,6 +226,11 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** Backing file the I/O is passed through to */
+	struct fuse_backing *passthrough;
+#endif
 };
 
 /** One input argument of a request */
@@ -787,6 +792,12 @@ struct fuse_conn {
 	/* Is tmpfile not implemented by fs? */
 	unsigned int no_tmpfile:1;
 
+	/* Can the I/O be passed through to backing files? */
+	unsigned int passthrough:1;
+
+	/** Maximum stacking depth of the backing files, plus one */
+	int max_stack_depth;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -836,6 +847,16 @@ struct fuse_conn {
 
 	/* New writepages go into this bucket */
 	struct fuse_sync_bucket __rcu *curr_bucket;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/* Backing files registered by the daemon */
+	struct idr backing_files_map;
+#endif
+
+#ifdef CONFIG_FUSE_IO_URING
+	/* io_uring transport, set by the first command of the daemon */
+	struct fuse_ring *ring;
+#endif
 };
 
 /*
@@ -1089,6 +1110,12 @@ void fuse_request_end(struct fuse_req *req);
 void fuse_abort_conn(struct fuse_conn *fc);
 void fuse_wait_aborted(struct fuse_conn *fc);
 
+#ifdef CONFIG_FUSE_IO_URING
+void fuse_uring_destroy(struct fuse_conn *fc);
+#else
+static inline void fuse_uring_destroy(struct fuse_conn *fc) { }
+#endif
+
 /**
  * Invalidate inode attributes
  */
@@ -1304,6 +1331,60 @@ void fuse_dax_dontcache(struct inode *inode, unsigned int flags);
 bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment);
 void fuse_dax_cancel_work(struct fuse_conn *fc);
 
+/* passthrough.c */
+#ifdef CONFIG_FUSE_PASSTHROUGH
+void fuse_backing_files_init(struct fuse_conn *fc);
+void fuse_backing_files_free(struct fuse_conn *fc);
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+void fuse_passthrough_open(struct fuse_file *ff, int backing_id);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
+static inline struct fuse_backing *fuse_file_passthrough(struct fuse_file *ff)
+{
+	return ff->passthrough;
+}
+#else
+static inline void fuse_backing_files_init(struct fuse_conn *fc) { }
+static inline void fuse_backing_files_free(struct fuse_conn *fc) { }
+static inline int fuse_backing_open(struct fuse_conn *fc,
+				    struct fuse_backing_map *map)
+{
+	return -EOPNOTSUPP;
+}
+static inline int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	return -EOPNOTSUPP;
+}
+static inline void fuse_passthrough_open(struct fuse_file *ff, int backing_id)
+{
+	ff->open_flags &= ~FOPEN_PASSTHROUGH;
+}
+static inline void fuse_passthrough_release(struct fuse_file *ff) { }
+static inline ssize_t fuse_passthrough_read_iter(struct kiocb *iocb,
+						 struct iov_iter *to)
+{
+	return -EINVAL;
+}
+static inline ssize_t fuse_passthrough_write_iter(struct kiocb *iocb,
+						  struct iov_iter *from)
+{
+	return -EINVAL;
+}
+static inline int fuse_passthrough_mmap(struct file *file,
+					struct vm_area_struct *vma)
+{
+	return -EINVAL;
+}
+static inline struct fuse_backing *fuse_file_passthrough(struct fuse_file *ff)
+{
+	return NULL;
+}
+#endif
+
 /* ioctl.c */
 long fuse_file_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 long fuse_file_compat_ioctl(struct file *file, unsigned int cmd,
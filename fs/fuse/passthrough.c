@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough to backing files
+ *
+ * The daemon registers an open file as backing file with the
+ * FUSE_DEV_IOC_BACKING_OPEN ioctl and names it in the reply to an open.
+ * The reads, writes and mmaps of the opened file then go directly to the
+ * backing file, with the credentials of the daemon, while the other
+ * operations are still sent to the daemon.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/idr.h>
+#include <linux/uio.h>
+
+struct fuse_backing {
+	struct file *file;
+	const struct cred *cred;
+	refcount_t count;
+	struct rcu_head rcu;
+};
+
+static void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (refcount_dec_and_test(&fb->count)) {
+		fput(fb->file);
+		put_cred(fb->cred);
+		kfree_rcu(fb, rcu);
+	}
+}
+
+static struct fuse_backing *fuse_backing_lookup(struct fuse_conn *fc,
+						int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (backing_id <= 0)
+		return NULL;
+
+	rcu_read_lock();
+	fb = idr_find(&fc->backing_files_map, backing_id);
+	if (fb && !refcount_inc_not_zero(&fb->count))
+		fb = NULL;
+	rcu_read_unlock();
+
+	return fb;
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc)
+{
+	idr_init(&fc->backing_files_map);
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	struct fuse_backing *fb;
+	int id;
+
+	idr_for_each_entry(&fc->backing_files_map, fb, id)
+		fuse_backing_put(fb);
+	idr_destroy(&fc->backing_files_map);
+}
+
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct super_block *backing_sb;
+	struct fuse_backing *fb;
+	struct file *file;
+	int res;
+
+	/* The backing file is accessed with the credentials of the daemon */
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (map->flags || map->padding)
+		return -EINVAL;
+
+	file = fget(map->fd);
+	if (!file)
+		return -EBADF;
+
+	res = -EOPNOTSUPP;
+	if (!file->f_op->read_iter || !file->f_op->write_iter)
+		goto out_fput;
+
+	backing_sb = file_inode(file)->i_sb;
+	res = -ELOOP;
+	if (backing_sb->s_stack_depth >= fc->max_stack_depth)
+		goto out_fput;
+
+	res = -ENOMEM;
+	fb = kmalloc(sizeof(*fb), GFP_KERNEL);
+	if (!fb)
+		goto out_fput;
+
+	fb->cred = prepare_creds();
+	if (!fb->cred) {
+		kfree(fb);
+		goto out_fput;
+	}
+	fb->file = file;
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+
+	if (res < 0)
+		fuse_backing_put(fb);
+	return res;
+
+out_fput:
+	fput(file);
+	return res;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	/* The files opened with it keep the backing file */
+	fuse_backing_put(fb);
+	return 0;
+}
+
+/*
+ * An open reply naming an unknown backing file falls back to sending the
+ * I/O to the daemon.
+ */
+void fuse_passthrough_open(struct fuse_file *ff, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	fb = fuse_backing_lookup(ff->fm->fc, backing_id);
+	if (!fb) {
+		pr_warn_ratelimited("fuse: no backing file %d for passthrough\n",
+				    backing_id);
+		ff->open_flags &= ~FOPEN_PASSTHROUGH;
+		return;
+	}
+	ff->passthrough = fb;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough)
+		fuse_backing_put(ff->passthrough);
+	ff->passthrough = NULL;
+}
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	old_cred = override_creds(fb->cred);
+	ret = vfs_iter_read(fb->file, to, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	struct inode *inode = file_inode(file);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(from))
+		return 0;
+
+	inode_lock(inode);
+	if (iocb->ki_flags & IOCB_APPEND)
+		iocb->ki_pos = i_size_read(file_inode(fb->file));
+
+	old_cred = override_creds(fb->cred);
+	file_start_write(fb->file);
+	ret = vfs_iter_write(fb->file, from, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb->ki_flags));
+	file_end_write(fb->file);
+	revert_creds(old_cred);
+
+	/* The size and times are still fetched from the daemon */
+	if (ret > 0)
+		fuse_write_update_attr(inode, iocb->ki_pos, ret);
+	inode_unlock(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!fb->file->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma_set_file(vma, fb->file);
+
+	old_cred = override_creds(fb->cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+
+	return ret;
+}
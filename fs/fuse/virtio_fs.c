@@ -17,6 +17,7 @@
 #include <linux/fs_parser.h>
 #include <linux/highmem.h>
 #include <linux/uio.h>
+#include <linux/interrupt.h>
 #include "fuse_i.h"
 
 /* Used to help calculate the FUSE connection's max_pages limit for a request's
@@ -61,6 +62,7 @@ struct virtio_fs {
 	struct virtio_fs_vq *vqs;
 	unsigned int nvqs;               /* number of virtqueues */
 	unsigned int num_request_queues; /* number of request queues */
+	unsigned int *mq_map;            /* request queue of each CPU */
 	struct dax_device *dax_dev;
 
 	/* DAX memory window where file contents are mapped */
@@ -165,6 +167,7 @@ static void release_virtio_fs_obj(struct kref *ref)
 {
 	struct virtio_fs *vfs = container_of(ref, struct virtio_fs, refcount);
 
+	kfree(vfs->mq_map);
 	kfree(vfs->vqs);
 	kfree(vfs);
 }
@@ -679,10 +682,46 @@ static void virtio_fs_init_vq(struct virtio_fs_vq *fsvq, char *name,
 	}
 }
 
+/*
+ * Map each CPU to a request queue. The queues whose interrupt is affine to
+ * a CPU are preferred, so that the requests of a CPU complete on it too.
+ */
+static void virtio_fs_map_queues(struct virtio_device *vdev,
+				 struct virtio_fs *fs)
+{
+	const struct cpumask *mask;
+	unsigned int q, cpu;
+
+	for_each_possible_cpu(cpu)
+		fs->mq_map[cpu] = fs->nvqs;
+
+	for (q = VQ_REQUEST; q < fs->nvqs; q++) {
+		if (!vdev->config->get_vq_affinity)
+			break;
+		mask = vdev->config->get_vq_affinity(vdev, q);
+		if (!mask)
+			break;
+
+		for_each_cpu(cpu, mask)
+			if (fs->mq_map[cpu] == fs->nvqs)
+				fs->mq_map[cpu] = q;
+	}
+
+	/* Spread the CPUs without an affine queue round-robin */
+	q = 0;
+	for_each_possible_cpu(cpu) {
+		if (fs->mq_map[cpu] != fs->nvqs)
+			continue;
+		fs->mq_map[cpu] = VQ_REQUEST + q;
+		q = (q + 1) % fs->num_request_queues;
+	}
+}
+
 /* Initialize virtqueues */
 static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 			       struct virtio_fs *fs)
 {
+	struct irq_affinity desc = { .pre_vectors = VQ_REQUEST };
 	struct virtqueue **vqs;
 	vq_callback_t **callbacks;
 	const char **names;
@@ -694,11 +733,21 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 	if (fs->num_request_queues == 0)
 		return -EINVAL;
 
+	/* No point in more request queues than CPUs to send requests from */
+	fs->num_request_queues = min_t(unsigned int, fs->num_request_queues,
+				       nr_cpu_ids);
 	fs->nvqs = VQ_REQUEST + fs->num_request_queues;
 	fs->vqs = kcalloc(fs->nvqs, sizeof(fs->vqs[VQ_HIPRIO]), GFP_KERNEL);
 	if (!fs->vqs)
 		return -ENOMEM;
 
+	fs->mq_map = kcalloc_node(nr_cpu_ids, sizeof(*fs->mq_map), GFP_KERNEL,
+				  dev_to_node(&vdev->dev));
+	if (!fs->mq_map) {
+		kfree(fs->vqs);
+		return -ENOMEM;
+	}
+
 	vqs = kmalloc_array(fs->nvqs, sizeof(vqs[VQ_HIPRIO]), GFP_KERNEL);
 	callbacks = kmalloc_array(fs->nvqs, sizeof(callbacks[VQ_HIPRIO]),
 					GFP_KERNEL);
@@ -723,20 +772,24 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 		names[i] = fs->vqs[i].name;
 	}
 
-	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, NULL);
+	/* Spread the interrupts of the request queues over the CPUs */
+	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, &desc);
 	if (ret < 0)
 		goto out;
 
 	for (i = 0; i < fs->nvqs; i++)
 		fs->vqs[i].vq = vqs[i];
 
+	virtio_fs_map_queues(vdev, fs);
 	virtio_fs_start_all_queues(fs);
 out:
 	kfree(names);
 	kfree(callbacks);
 	kfree(vqs);
-	if (ret)
+	if (ret) {
 		kfree(fs->vqs);
+		kfree(fs->mq_map);
+	}
 	return ret;
 }
 
@@ -875,8 +928,6 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	if (ret < 0)
 		goto out;
 
-	/* TODO vq affinity */
-
 	ret = virtio_fs_setup_dax(vdev, fs);
 	if (ret < 0)
 		goto out_vqs;
@@ -896,6 +947,7 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	virtio_reset_device(vdev);
 	virtio_fs_cleanup_vqs(vdev);
 	kfree(fs->vqs);
+	kfree(fs->mq_map);
 
 out:
 	vdev->priv = NULL;
@@ -1223,7 +1275,7 @@ static int virtio_fs_enqueue_req(struct virtio_fs_vq *fsvq,
 static void virtio_fs_wake_pending_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
-	unsigned int queue_id = VQ_REQUEST; /* TODO multiqueue */
+	unsigned int queue_id;
 	struct virtio_fs *fs;
 	struct fuse_req *req;
 	struct virtio_fs_vq *fsvq;
@@ -1237,6 +1289,7 @@ __releases(fiq->lock)
 	spin_unlock(&fiq->lock);
 
 	fs = fiq->priv;
+	queue_id = fs->mq_map[raw_smp_processor_id()];
 
 	pr_debug("%s: opcode %u unique %#llx nodeid %#llx in.len %u out.len %u\n",
 		  __func__, req->in.h.opcode, req->in.h.unique,
@@ -485,6 +485,21 @@ static int proc_pid_schedstat(struct seq_file *m, struct pid_namespace *ns,
 
 	return 0;
 }
+
+/*
+ * Provides /proc/PID/wakeup_latency
+ */
+static int proc_pid_wakeup_latency(struct seq_file *m, struct pid_namespace *ns,
+				   struct pid *pid, struct task_struct *task)
+{
+	unsigned int i;
+
+	for (i = 0; i < SCHED_WAKEUP_HIST_BUCKETS; i++)
+		seq_printf(m, "%llu %lu\n", sched_wakeup_hist_lower(i),
+			   task->sched_info.wakeup_hist[i]);
+
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_LATENCYTOP
@@ -3293,6 +3308,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 #endif
 #ifdef CONFIG_SCHED_INFO
 	ONE("schedstat",  S_IRUGO, proc_pid_schedstat),
+	ONE("wakeup_latency", S_IRUGO, proc_pid_wakeup_latency),
 #endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
@@ -3641,6 +3657,7 @@ static const struct pid_entry tid_base_stuff[] = {
 #endif
 #ifdef CONFIG_SCHED_INFO
 	ONE("schedstat", S_IRUGO, proc_pid_schedstat),
+	ONE("wakeup_latency", S_IRUGO, proc_pid_wakeup_latency),
 #endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
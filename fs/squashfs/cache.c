@@ -39,12 +39,147 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/percpu_counter.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs.h"
 #include "page_actor.h"
 
+/*
+ * Take a reference on the entry caching block, if any, without taking the
+ * cache lock.  Entries being evicted have a negative refcount and are skipped,
+ * and the block is checked again once the entry can no longer be evicted.
+ */
+static struct squashfs_cache_entry *squashfs_cache_lookup(
+	struct squashfs_cache *cache, u64 block)
+{
+	int entries = smp_load_acquire(&cache->entries);
+	int i = READ_ONCE(cache->curr_blk), n, ref;
+	struct squashfs_cache_entry *entry;
+
+	if (i >= entries)
+		i = 0;
+
+	for (n = 0; n < entries; n++, i = (i + 1) % entries) {
+		entry = &cache->entry[i];
+		if (READ_ONCE(entry->block) != block)
+			continue;
+
+		ref = atomic_read(&entry->refcount);
+		do {
+			if (ref < 0)
+				break;
+		} while (!atomic_try_cmpxchg_acquire(&entry->refcount, &ref,
+						     ref + 1));
+		if (ref < 0)
+			continue;
+
+		/* Previously unused, one less cache entry available for reuse */
+		if (ref == 0)
+			atomic_dec(&cache->unused);
+
+		if (READ_ONCE(entry->block) != block) {
+			squashfs_cache_put(entry);
+			continue;
+		}
+
+		WRITE_ONCE(cache->curr_blk, i);
+		return entry;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Allocate the buffers of a cache entry.
+ */
+static int squashfs_cache_entry_init(struct squashfs_cache *cache,
+	struct squashfs_cache_entry *entry)
+{
+	int j;
+
+	init_waitqueue_head(&entry->wait_queue);
+	entry->cache = cache;
+	entry->block = SQUASHFS_INVALID_BLK;
+	atomic_set(&entry->refcount, 0);
+	entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
+	if (entry->data == NULL) {
+		ERROR("Failed to allocate %s cache entry\n", cache->name);
+		return -ENOMEM;
+	}
+
+	for (j = 0; j < cache->pages; j++) {
+		entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (entry->data[j] == NULL) {
+			ERROR("Failed to allocate %s buffer\n", cache->name);
+			return -ENOMEM;
+		}
+	}
+
+	entry->actor = squashfs_page_actor_init(entry->data, cache->pages, 0);
+	if (entry->actor == NULL) {
+		ERROR("Failed to allocate %s cache entry\n", cache->name);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+
+static void squashfs_cache_entry_free(struct squashfs_cache *cache,
+	struct squashfs_cache_entry *entry)
+{
+	int j;
+
+	if (entry->data) {
+		for (j = 0; j < cache->pages; j++)
+			kfree(entry->data[j]);
+		kfree(entry->data);
+	}
+	kfree(entry->actor);
+}
+
+
+/*
+ * Add an entry to the cache, called and returning with the cache lock held.
+ * The cache grows when all its entries are in use, or when it has been
+ * entirely refilled since it last grew, which means its working set does not
+ * fit.
+ */
+static void squashfs_cache_grow(struct squashfs_cache *cache)
+{
+	struct squashfs_cache_entry *entry;
+	int n = cache->entries;
+
+	if (n == cache->max_entries || cache->growing ||
+	    (atomic_read(&cache->unused) && cache->evictions < n))
+		return;
+
+	cache->growing = true;
+	spin_unlock(&cache->lock);
+
+	entry = &cache->entry[n];
+	if (squashfs_cache_entry_init(cache, entry)) {
+		squashfs_cache_entry_free(cache, entry);
+		memset(entry, 0, sizeof(*entry));
+		spin_lock(&cache->lock);
+		/* Don't retry */
+		cache->max_entries = n;
+		cache->growing = false;
+		return;
+	}
+
+	spin_lock(&cache->lock);
+	cache->growing = false;
+	cache->evictions = 0;
+	atomic_inc(&cache->unused);
+	/* Pairs with the lockless lookup reading the number of entries */
+	smp_store_release(&cache->entries, n + 1);
+}
+
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -55,110 +190,107 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	int i, n;
 	struct squashfs_cache_entry *entry;
 
+	entry = squashfs_cache_lookup(cache, block);
+	if (entry) {
+		percpu_counter_inc(&cache->hits);
+		goto wait;
+	}
+
 	spin_lock(&cache->lock);
 
 	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
-				break;
-			}
-			i = (i + 1) % cache->entries;
+		/* Filled in while the lock was released */
+		entry = squashfs_cache_lookup(cache, block);
+		if (entry) {
+			spin_unlock(&cache->lock);
+			percpu_counter_inc(&cache->hits);
+			goto wait;
 		}
 
-		if (n == cache->entries) {
-			/*
-			 * Block not in cache, if all cache entries are used
-			 * go to sleep waiting for one to become available.
-			 */
-			if (cache->unused == 0) {
-				cache->num_waiters++;
-				spin_unlock(&cache->lock);
-				wait_event(cache->wait_queue, cache->unused);
-				spin_lock(&cache->lock);
-				cache->num_waiters--;
-				continue;
-			}
-
-			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
-			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
-			}
-
-			cache->next_blk = (i + 1) % cache->entries;
-			entry = &cache->entry[i];
+		squashfs_cache_grow(cache);
 
-			/*
-			 * Initialise chosen cache entry, and fill it in from
-			 * disk.
-			 */
-			cache->unused--;
-			entry->block = block;
-			entry->refcount = 1;
-			entry->pending = 1;
-			entry->num_waiters = 0;
-			entry->error = 0;
+		/*
+		 * Block not in cache, if all cache entries are used
+		 * go to sleep waiting for one to become available.
+		 */
+		if (atomic_read(&cache->unused) == 0) {
 			spin_unlock(&cache->lock);
+			wait_event(cache->wait_queue,
+				   atomic_read(&cache->unused));
+			spin_lock(&cache->lock);
+			continue;
+		}
 
-			entry->length = squashfs_read_data(sb, block, length,
-				&entry->next_index, entry->actor);
+		/*
+		 * At least one unused cache entry.  A simple
+		 * round-robin strategy is used to choose the entry to
+		 * be evicted from the cache.  It is claimed by setting its
+		 * refcount to -1, so that lockless lookups leave it alone.
+		 */
+		i = cache->next_blk;
+		for (n = 0; n < cache->entries; n++) {
+			entry = &cache->entry[i];
+			if (atomic_cmpxchg(&entry->refcount, 0, -1) == 0)
+				break;
+			i = (i + 1) % cache->entries;
+		}
 
+		/* The last unused entry was just taken by a lookup */
+		if (n == cache->entries) {
+			spin_unlock(&cache->lock);
+			cond_resched();
 			spin_lock(&cache->lock);
+			continue;
+		}
 
-			if (entry->length < 0)
-				entry->error = entry->length;
+		cache->next_blk = (i + 1) % cache->entries;
+		cache->evictions++;
+		entry = &cache->entry[i];
 
-			entry->pending = 0;
+		/*
+		 * Initialise chosen cache entry, and fill it in from
+		 * disk.
+		 */
+		atomic_dec(&cache->unused);
+		WRITE_ONCE(entry->block, block);
+		entry->pending = 1;
+		entry->error = 0;
+		atomic_set_release(&entry->refcount, 1);
+		spin_unlock(&cache->lock);
 
-			/*
-			 * While filling this entry one or more other processes
-			 * have looked it up in the cache, and have slept
-			 * waiting for it to become available.
-			 */
-			if (entry->num_waiters) {
-				spin_unlock(&cache->lock);
-				wake_up_all(&entry->wait_queue);
-			} else
-				spin_unlock(&cache->lock);
+		percpu_counter_inc(&cache->misses);
 
-			goto out;
-		}
+		entry->length = squashfs_read_data(sb, block, length,
+			&entry->next_index, entry->actor);
 
-		/*
-		 * Block already in cache.  Increment refcount so it doesn't
-		 * get reused until we're finished with it, if it was
-		 * previously unused there's one less cache entry available
-		 * for reuse.
-		 */
-		entry = &cache->entry[i];
-		if (entry->refcount == 0)
-			cache->unused--;
-		entry->refcount++;
+		if (entry->length < 0)
+			entry->error = entry->length;
 
 		/*
-		 * If the entry is currently being filled in by another process
-		 * go to sleep waiting for it to become available.
+		 * Wake up the processes that have looked it up in the cache
+		 * while it was being filled, and have slept waiting for it
+		 * to become available.
 		 */
-		if (entry->pending) {
-			entry->num_waiters++;
-			spin_unlock(&cache->lock);
-			wait_event(entry->wait_queue, !entry->pending);
-		} else
-			spin_unlock(&cache->lock);
+		smp_store_release(&entry->pending, 0);
+		if (wq_has_sleeper(&entry->wait_queue))
+			wake_up_all(&entry->wait_queue);
 
 		goto out;
 	}
 
+wait:
+	/*
+	 * If the entry is currently being filled in by another process
+	 * go to sleep waiting for it to become available.
+	 */
+	if (smp_load_acquire(&entry->pending))
+		wait_event(entry->wait_queue,
+			   !smp_load_acquire(&entry->pending));
+
 out:
-	TRACE("Got %s %d, start block %lld, refcount %d, error %d\n",
-		cache->name, i, entry->block, entry->refcount, entry->error);
+	TRACE("Got %s, start block %lld, refcount %d, error %d\n",
+		cache->name, entry->block, atomic_read(&entry->refcount),
+		entry->error);
 
 	if (entry->error)
 		ERROR("Unable to read %s cache entry [%llx]\n", cache->name,
@@ -174,21 +306,15 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 {
 	struct squashfs_cache *cache = entry->cache;
 
-	spin_lock(&cache->lock);
-	entry->refcount--;
-	if (entry->refcount == 0) {
-		cache->unused++;
+	if (atomic_dec_and_test(&entry->refcount)) {
+		atomic_inc(&cache->unused);
 		/*
 		 * If there's any processes waiting for a block to become
 		 * available, wake one up.
 		 */
-		if (cache->num_waiters) {
-			spin_unlock(&cache->lock);
+		if (wq_has_sleeper(&cache->wait_queue))
 			wake_up(&cache->wait_queue);
-			return;
-		}
 	}
-	spin_unlock(&cache->lock);
 }
 
 /*
@@ -196,20 +322,17 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
  */
 void squashfs_cache_delete(struct squashfs_cache *cache)
 {
-	int i, j;
+	int i;
 
 	if (cache == NULL)
 		return;
 
-	for (i = 0; i < cache->entries; i++) {
-		if (cache->entry[i].data) {
-			for (j = 0; j < cache->pages; j++)
-				kfree(cache->entry[i].data[j]);
-			kfree(cache->entry[i].data);
-		}
-		kfree(cache->entry[i].actor);
-	}
+	if (cache->entry)
+		for (i = 0; i < cache->max_entries; i++)
+			squashfs_cache_entry_free(cache, &cache->entry[i]);
 
+	percpu_counter_destroy(&cache->hits);
+	percpu_counter_destroy(&cache->misses);
 	kfree(cache->entry);
 	kfree(cache);
 }
@@ -217,13 +340,14 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 
 /*
  * Initialise cache allocating the specified number of entries, each of
- * size block_size.  To avoid vmalloc fragmentation issues each entry
- * is allocated as a sequence of kmalloced PAGE_SIZE buffers.
+ * size block_size, and room for the cache to grow to max_entries.  To avoid
+ * vmalloc fragmentation issues each entry is allocated as a sequence of
+ * kmalloced PAGE_SIZE buffers.
  */
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
-	int block_size)
+	int max_entries, int block_size)
 {
-	int i, j;
+	int i;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -231,51 +355,31 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		return NULL;
 	}
 
-	cache->entry = kcalloc(entries, sizeof(*(cache->entry)), GFP_KERNEL);
-	if (cache->entry == NULL) {
+	max_entries = max(entries, max_entries);
+	cache->entry = kcalloc(max_entries, sizeof(*(cache->entry)),
+		GFP_KERNEL);
+	if (cache->entry == NULL ||
+	    percpu_counter_init(&cache->hits, 0, GFP_KERNEL) ||
+	    percpu_counter_init(&cache->misses, 0, GFP_KERNEL)) {
 		ERROR("Failed to allocate %s cache\n", name);
 		goto cleanup;
 	}
 
 	cache->curr_blk = 0;
 	cache->next_blk = 0;
-	cache->unused = entries;
+	atomic_set(&cache->unused, entries);
 	cache->entries = entries;
+	cache->max_entries = max_entries;
 	cache->block_size = block_size;
 	cache->pages = block_size >> PAGE_SHIFT;
 	cache->pages = cache->pages ? cache->pages : 1;
 	cache->name = name;
-	cache->num_waiters = 0;
 	spin_lock_init(&cache->lock);
 	init_waitqueue_head(&cache->wait_queue);
 
-	for (i = 0; i < entries; i++) {
-		struct squashfs_cache_entry *entry = &cache->entry[i];
-
-		init_waitqueue_head(&cache->entry[i].wait_queue);
-		entry->cache = cache;
-		entry->block = SQUASHFS_INVALID_BLK;
-		entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
-		if (entry->data == NULL) {
-			ERROR("Failed to allocate %s cache entry\n", name);
-			goto cleanup;
-		}
-
-		for (j = 0; j < cache->pages; j++) {
-			entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
-			if (entry->data[j] == NULL) {
-				ERROR("Failed to allocate %s buffer\n", name);
-				goto cleanup;
-			}
-		}
-
-		entry->actor = squashfs_page_actor_init(entry->data,
-						cache->pages, 0);
-		if (entry->actor == NULL) {
-			ERROR("Failed to allocate %s cache entry\n", name);
+	for (i = 0; i < entries; i++)
+		if (squashfs_cache_entry_init(cache, &cache->entry[i]))
 			goto cleanup;
-		}
-	}
 
 	return cache;
 
@@ -34,6 +34,8 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +535,112 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/*
+ * A datablock of the readahead window, decompressed by a worker in parallel
+ * with the other blocks of the window
+ */
+struct squashfs_readahead_block {
+	struct work_struct work;
+	struct list_head list;
+	struct inode *inode;
+	atomic_t *pending;
+	struct completion *done;
+	u64 block;
+	int bsize;
+	unsigned int expected;
+	bool last;
+	unsigned int nr_pages;
+	struct page *pages[];
+};
+
+static void squashfs_readahead_block(struct inode *inode, struct page **pages,
+	unsigned int nr_pages, u64 block, int bsize, unsigned int expected,
+	bool last)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page = NULL;
+	int i, res = -ENOMEM;
+
+	actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
+						 expected);
+	if (actor) {
+		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+
+		last_page = squashfs_page_actor_free(actor);
+	}
+
+	if (res == expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (last && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < nr_pages; i++) {
+			flush_dcache_page(pages[i]);
+			SetPageUptodate(pages[i]);
+		}
+	}
+
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_readahead_block *rab = container_of(work,
+		struct squashfs_readahead_block, work);
+	atomic_t *pending = rab->pending;
+	struct completion *done = rab->done;
+
+	squashfs_readahead_block(rab->inode, rab->pages, rab->nr_pages,
+				 rab->block, rab->bsize, rab->expected,
+				 rab->last);
+	kfree(rab);
+
+	if (atomic_dec_and_test(pending))
+		complete(done);
+}
+
+/*
+ * Decompress the datablocks gathered from the readahead window.  All but the
+ * first are handed to workers, so that their I/O is issued at once and they
+ * are decompressed on several CPUs, while the caller takes care of the first.
+ */
+static void squashfs_readahead_blocks(struct list_head *blocks)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct squashfs_readahead_block *rab, *tmp, *first;
+	atomic_t pending = ATOMIC_INIT(1);
+
+	first = list_first_entry_or_null(blocks,
+		struct squashfs_readahead_block, list);
+	if (!first)
+		return;
+	list_del(&first->list);
+
+	list_for_each_entry_safe(rab, tmp, blocks, list) {
+		list_del(&rab->list);
+		rab->pending = &pending;
+		rab->done = &done;
+		atomic_inc(&pending);
+		INIT_WORK(&rab->work, squashfs_readahead_work);
+		queue_work(system_unbound_wq, &rab->work);
+	}
+
+	squashfs_readahead_block(first->inode, first->pages, first->nr_pages,
+				 first->block, first->bsize, first->expected,
+				 first->last);
+	kfree(first);
+
+	if (!atomic_dec_and_test(&pending))
+		wait_for_completion(&done);
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,16 +649,25 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
+	struct squashfs_readahead_block *rab = NULL;
 	unsigned int nr_pages = 0;
-	struct page **pages;
+	struct page **pages, **buf;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
-	unsigned int max_pages = 1UL << shift;
+	unsigned int max_pages = 1UL << shift, block_pages = max_pages;
+	LIST_HEAD(blocks);
+	bool parallel;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
+	/*
+	 * Files of a single block, and decompressors that cannot run on
+	 * several CPUs at once, gain nothing from workers.
+	 */
+	parallel = squashfs_max_decompressors() > 1 &&
+		   i_size_read(inode) > msblk->block_size;
+
+	buf = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
+	if (!buf)
 		return;
 
 	for (;;) {
@@ -558,7 +675,6 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -566,6 +682,10 @@ static void squashfs_readahead(struct readahead_control *ractl)
 
 		max_pages = (expected + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
+		rab = parallel ? kmalloc(struct_size(rab, pages, block_pages),
+					 GFP_KERNEL) : NULL;
+		pages = rab ? rab->pages : buf;
+
 		nr_pages = __readahead_batch(ractl, pages, max_pages);
 		if (!nr_pages)
 			break;
@@ -584,6 +704,7 @@ static void squashfs_readahead(struct readahead_control *ractl)
 							  expected);
 			if (res)
 				goto skip_pages;
+			kfree(rab);
 			continue;
 		}
 
@@ -591,37 +712,25 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
+		if (!rab) {
+			squashfs_readahead_block(inode, pages, nr_pages, block,
+						 bsize, expected,
+						 index == file_end);
+			continue;
 		}
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
-		}
+		rab->inode = inode;
+		rab->block = block;
+		rab->bsize = bsize;
+		rab->expected = expected;
+		rab->last = index == file_end;
+		rab->nr_pages = nr_pages;
+		list_add_tail(&rab->list, &blocks);
 	}
 
-	kfree(pages);
+	kfree(rab);
+	squashfs_readahead_blocks(&blocks);
+	kfree(buf);
 	return;
 
 skip_pages:
@@ -629,7 +738,9 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		unlock_page(pages[i]);
 		put_page(pages[i]);
 	}
-	kfree(pages);
+	kfree(rab);
+	squashfs_readahead_blocks(&blocks);
+	kfree(buf);
 }
 
 const struct address_space_operations squashfs_aops = {
@@ -19,7 +19,7 @@ extern int squashfs_read_data(struct super_block *, u64, int, u64 *,
 				struct squashfs_page_actor *);
 
 /* cache.c */
-extern struct squashfs_cache *squashfs_cache_init(char *, int, int);
+extern struct squashfs_cache *squashfs_cache_init(char *, int, int, int);
 extern void squashfs_cache_delete(struct squashfs_cache *);
 extern struct squashfs_cache_entry *squashfs_cache_get(struct super_block *,
 				struct squashfs_cache *, u64, int);
@@ -71,6 +71,12 @@ extern struct inode *squashfs_iget(struct super_block *, long long,
 				unsigned int);
 extern int squashfs_read_inode(struct inode *, long long);
 
+/* sysfs.c */
+extern int squashfs_sysfs_init(void);
+extern void squashfs_sysfs_exit(void);
+extern void squashfs_sysfs_register(struct super_block *);
+extern void squashfs_sysfs_unregister(struct super_block *);
+
 /* xattr.c */
 extern ssize_t squashfs_listxattr(struct dentry *, char *, size_t);
 
@@ -10,30 +10,37 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/completion.h>
+#include <linux/kobject.h>
+#include <linux/percpu_counter.h>
+
 #include "squashfs_fs.h"
 
 struct squashfs_cache {
 	char			*name;
 	int			entries;
+	int			max_entries;
 	int			curr_blk;
 	int			next_blk;
-	int			num_waiters;
-	int			unused;
+	int			evictions;
+	bool			growing;
+	atomic_t		unused;
 	int			block_size;
 	int			pages;
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
+	struct percpu_counter	hits;
+	struct percpu_counter	misses;
 };
 
 struct squashfs_cache_entry {
 	u64			block;
 	int			length;
-	int			refcount;
+	atomic_t		refcount;
 	u64			next_index;
 	int			pending;
 	int			error;
-	int			num_waiters;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache	*cache;
 	void			**data;
@@ -66,5 +73,8 @@ struct squashfs_sb_info {
 	int					xattr_ids;
 	unsigned int				ids;
 	bool					panic_on_errors;
+	bool					sysfs_registered;
+	struct kobject				kobj;
+	struct completion			kobj_unregister;
 };
 #endif
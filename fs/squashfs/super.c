@@ -29,6 +29,7 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/mm.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -113,6 +114,22 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(
 }
 
 
+/*
+ * The metadata and fragment caches grow on demand from their default size to
+ * up to 1/1024 of the memory, within SQUASHFS_CACHE_MAX_ENTRIES entries.
+ */
+#define SQUASHFS_CACHE_MAX_ENTRIES	64
+
+static int squashfs_cache_max_entries(int entries, int block_size)
+{
+	unsigned long max = (totalram_pages() << (PAGE_SHIFT - 10)) /
+		block_size;
+
+	return clamp_t(unsigned long, max, entries,
+		max(entries, SQUASHFS_CACHE_MAX_ENTRIES));
+}
+
+
 static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 {
 	struct squashfs_mount_opts *opts = fc->fs_private;
@@ -246,13 +263,17 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			SQUASHFS_CACHED_BLKS,
+			squashfs_cache_max_entries(SQUASHFS_CACHED_BLKS,
+				SQUASHFS_METADATA_SIZE),
+			SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
 	/* Allocate read_page block */
 	msblk->read_page = squashfs_cache_init("data",
-		squashfs_max_decompressors(), msblk->block_size);
+		squashfs_max_decompressors(), squashfs_max_decompressors(),
+		msblk->block_size);
 	if (msblk->read_page == NULL) {
 		errorf(fc, "Failed to allocate read_page block");
 		goto failed_mount;
@@ -321,7 +342,10 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		SQUASHFS_CACHED_FRAGMENTS,
+		squashfs_cache_max_entries(SQUASHFS_CACHED_FRAGMENTS,
+			msblk->block_size),
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -373,6 +397,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto failed_mount;
 	}
 
+	squashfs_sysfs_register(sb);
+
 	TRACE("Leaving squashfs_fill_super\n");
 	kfree(sblk);
 	return 0;
@@ -475,6 +501,7 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_sysfs_unregister(sb);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -529,8 +556,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_sysfs_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_sysfs_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -544,6 +578,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_sysfs_exit();
 	destroy_inodecache();
 }
 
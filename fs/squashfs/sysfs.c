@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * sysfs.c
+ */
+
+/*
+ * This file exports the state of the metadata and fragment caches of each
+ * mounted filesystem in /sys/fs/squashfs/<device>/.
+ */
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/slab.h>
+#include <linux/sysfs.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+enum {
+	attr_entries,
+	attr_hits,
+	attr_misses,
+};
+
+struct squashfs_attr {
+	struct attribute attr;
+	int cache;
+	int stat;
+};
+
+#define SQUASHFS_CACHE_ATTR(_cache, _stat)				\
+static struct squashfs_attr squashfs_attr_##_cache##_cache_##_stat = {	\
+	.attr = { .name = __stringify(_cache) "_cache_" #_stat,		\
+		  .mode = 0444 },					\
+	.cache = offsetof(struct squashfs_sb_info, _cache##_cache),	\
+	.stat = attr_##_stat,						\
+}
+
+#define ATTR_LIST(_cache, _stat) (&squashfs_attr_##_cache##_cache_##_stat.attr)
+
+/* The metadata cache is the block_cache of the superblock */
+#define metadata_cache block_cache
+
+SQUASHFS_CACHE_ATTR(metadata, entries);
+SQUASHFS_CACHE_ATTR(metadata, hits);
+SQUASHFS_CACHE_ATTR(metadata, misses);
+SQUASHFS_CACHE_ATTR(fragment, entries);
+SQUASHFS_CACHE_ATTR(fragment, hits);
+SQUASHFS_CACHE_ATTR(fragment, misses);
+
+static struct attribute *squashfs_attrs[] = {
+	ATTR_LIST(metadata, entries),
+	ATTR_LIST(metadata, hits),
+	ATTR_LIST(metadata, misses),
+	ATTR_LIST(fragment, entries),
+	ATTR_LIST(fragment, hits),
+	ATTR_LIST(fragment, misses),
+	NULL,
+};
+ATTRIBUTE_GROUPS(squashfs);
+
+static struct kset *squashfs_kset;
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+	struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+		attr);
+	struct squashfs_cache *cache = *(struct squashfs_cache **)
+		((char *)msblk + a->cache);
+
+	/* Filesystems without fragments have no fragment cache */
+	if (cache == NULL)
+		return sysfs_emit(buf, "0\n");
+
+	switch (a->stat) {
+	case attr_entries:
+		return sysfs_emit(buf, "%d\n", READ_ONCE(cache->entries));
+	case attr_hits:
+		return sysfs_emit(buf, "%lld\n",
+			percpu_counter_sum_positive(&cache->hits));
+	case attr_misses:
+		return sysfs_emit(buf, "%lld\n",
+			percpu_counter_sum_positive(&cache->misses));
+	}
+
+	return 0;
+}
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+
+	complete(&msblk->kobj_unregister);
+}
+
+static const struct sysfs_ops squashfs_attr_ops = {
+	.show	= squashfs_attr_show,
+};
+
+static struct kobj_type squashfs_sb_ktype = {
+	.default_groups = squashfs_groups,
+	.sysfs_ops	= &squashfs_attr_ops,
+	.release	= squashfs_sb_release,
+};
+
+/*
+ * The statistics are not worth failing the mount for, the filesystem is
+ * just left out of sysfs if registering it fails.
+ */
+void squashfs_sysfs_register(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	msblk->kobj.kset = squashfs_kset;
+	init_completion(&msblk->kobj_unregister);
+	err = kobject_init_and_add(&msblk->kobj, &squashfs_sb_ktype, NULL,
+		"%s", sb->s_id);
+	if (err) {
+		WARNING("Unable to register %s in sysfs\n", sb->s_id);
+		kobject_put(&msblk->kobj);
+		wait_for_completion(&msblk->kobj_unregister);
+		return;
+	}
+
+	msblk->sysfs_registered = true;
+}
+
+void squashfs_sysfs_unregister(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	if (!msblk->sysfs_registered)
+		return;
+
+	kobject_del(&msblk->kobj);
+	kobject_put(&msblk->kobj);
+	wait_for_completion(&msblk->kobj_unregister);
+	msblk->sysfs_registered = false;
+}
+
+int __init squashfs_sysfs_init(void)
+{
+	squashfs_kset = kset_create_and_add("squashfs", NULL, fs_kobj);
+
+	return squashfs_kset ? 0 : -ENOMEM;
+}
+
+void squashfs_sysfs_exit(void)
+{
+	kset_unregister(squashfs_kset);
+}
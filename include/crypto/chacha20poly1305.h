@@ -45,6 +45,19 @@ bool chacha20poly1305_decrypt_sg_inplace(struct scatterlist *src, size_t src_len
 					 const u64 nonce,
 					 const u8 key[CHACHA20POLY1305_KEY_SIZE]);
 
+/* One message of a batch encrypted or decrypted in place under the same key */
+struct chacha20poly1305_sg_req {
+	struct scatterlist *src;
+	size_t src_len;
+	u64 nonce;
+};
+
+#define CHACHA20POLY1305_BATCH_MAX	8
+
+bool chacha20poly1305_encrypt_sg_inplace_batch(struct chacha20poly1305_sg_req *reqs,
+					       unsigned int nr,
+					       const u8 key[CHACHA20POLY1305_KEY_SIZE]);
+
 bool chacha20poly1305_selftest(void);
 
 #endif /* __CHACHA20POLY1305_H */
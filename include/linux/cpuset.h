@@ -74,6 +74,7 @@ extern void cpuset_wait_for_hotplug(void);
 extern void cpuset_read_lock(void);
 extern void cpuset_read_unlock(void);
 extern void cpuset_cpus_allowed(struct task_struct *p, struct cpumask *mask);
+extern int cpuset_cgroup_fd_cpus(int fd, struct cpumask *mask);
 extern bool cpuset_cpus_allowed_fallback(struct task_struct *p);
 extern nodemask_t cpuset_mems_allowed(struct task_struct *p);
 #define cpuset_current_mems_allowed (current->mems_allowed)
@@ -205,6 +206,11 @@ static inline void cpuset_cpus_allowed(struct task_struct *p,
 	cpumask_copy(mask, task_cpu_possible_mask(p));
 }
 
+static inline int cpuset_cgroup_fd_cpus(int fd, struct cpumask *mask)
+{
+	return -EINVAL;
+}
+
 static inline bool cpuset_cpus_allowed_fallback(struct task_struct *p)
 {
 	return false;
@@ -42,4 +42,14 @@ struct xilinx_vdma_config {
 int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 					struct xilinx_vdma_config *cfg);
 
+#ifdef CONFIG_XILINX_MEMCPY_OFFLOAD
+void xilinx_memcpy_offload(void *dst, const void *src, size_t len);
+#else
+static inline void xilinx_memcpy_offload(void *dst, const void *src,
+					 size_t len)
+{
+	memcpy(dst, src, len);
+}
+#endif
+
 #endif
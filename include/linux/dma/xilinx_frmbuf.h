@@ -13,6 +13,9 @@
 #define __XILINX_FRMBUF_DMA_H
 
 #include <linux/dmaengine.h>
+#include <linux/err.h>
+
+struct dma_fence;
 
 /* Modes to enable early callback */
 /* To avoid first frame delay */
@@ -187,6 +190,41 @@ int xilinx_xdma_get_earlycb(struct dma_chan *chan,
 int xilinx_xdma_set_earlycb(struct dma_chan *chan,
 			    struct dma_async_tx_descriptor *async_tx,
 			    u32 earlycb);
+
+/**
+ * xilinx_xdma_get_fence - Get the completion fence of a frame
+ * @chan: dma channel instance
+ * @async_tx: dma async tx descriptor for the buffer
+ *
+ * The fence signals once the frame has been transferred and before the
+ * descriptor callback runs, or with -ECANCELED when the descriptor is
+ * terminated first. Passing it to xilinx_xdma_set_fence() for a descriptor
+ * of another framebuffer channel chains the two in the kernel, and it may
+ * be exported to user space with sync_file_create(). This call must be made
+ * prior to dmaengine_submit(). The caller owns the returned reference.
+ *
+ * Return: the fence on success, an ERR_PTR() in case of error
+ */
+struct dma_fence *xilinx_xdma_get_fence(struct dma_chan *chan,
+					struct dma_async_tx_descriptor *async_tx);
+
+/**
+ * xilinx_xdma_set_fence - Hold a frame back until a fence signals
+ * @chan: dma channel instance
+ * @async_tx: dma async tx descriptor for the buffer
+ * @fence: fence to wait on, e.g. from xilinx_xdma_get_fence()
+ *
+ * The descriptor is not programmed into the hardware until @fence has
+ * signalled, and the channel is kicked as soon as it does, without a round
+ * trip through the client. Any error status of @fence is ignored. This call
+ * must be made prior to dmaengine_submit().
+ *
+ * Return: 0 on success, -EINVAL for an invalid fence, -EBUSY if the
+ * descriptor already waits on a fence
+ */
+int xilinx_xdma_set_fence(struct dma_chan *chan,
+			  struct dma_async_tx_descriptor *async_tx,
+			  struct dma_fence *fence);
 /**
  * xilinx_xdma_get_width_align - Get width alignment value
  *
@@ -253,6 +291,20 @@ static inline int xilinx_xdma_get_width_align(struct dma_chan *chan, u32 *width_
 {
 	return -ENODEV;
 }
+
+static inline struct dma_fence *
+xilinx_xdma_get_fence(struct dma_chan *chan,
+		      struct dma_async_tx_descriptor *async_tx)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline int xilinx_xdma_set_fence(struct dma_chan *chan,
+					struct dma_async_tx_descriptor *async_tx,
+					struct dma_fence *fence)
+{
+	return -ENODEV;
+}
 #endif
 
 #endif /*__XILINX_FRMBUF_DMA_H*/
@@ -41,6 +41,8 @@ struct em_perf_state {
  * @table:		List of performance states, in ascending order
  * @nr_perf_states:	Number of performance states
  * @flags:		See "em_perf_domain flags"
+ * @wake_energy:	Energy spent bringing an accelerator domain out of its
+ *			powered off state, see em_dev_work_energy()
  * @cpus:		Cpumask covering the CPUs of the domain. It's here
  *			for performance reasons to avoid potential cache
  *			misses during energy calculations in the scheduler
@@ -51,11 +53,17 @@ struct em_perf_state {
  * must have the same micro-architecture. Performance domains often have
  * a 1-to-1 mapping with CPUFreq policies. In case of other devices the @cpus
  * field is unused.
+ *
+ * An accelerator performance domain represents a device work can be offloaded
+ * to instead of running it on the CPUs, e.g. a remote processor or a
+ * programmable logic engine. Its @wake_energy is the one-off cost of powering
+ * it up for the work, which can outweigh the energy saved by the offload.
  */
 struct em_perf_domain {
 	struct em_perf_state *table;
 	int nr_perf_states;
 	unsigned long flags;
+	unsigned long wake_energy;
 	unsigned long cpus[];
 };
 
@@ -70,13 +78,18 @@ struct em_perf_domain {
  *
  *  EM_PERF_DOMAIN_ARTIFICIAL: The power values are artificial and might be
  *  created by platform missing real power information
+ *
+ *  EM_PERF_DOMAIN_ACCEL: The domain is an accelerator work can be offloaded
+ *  to, registered with em_dev_register_accel_perf_domain()
  */
 #define EM_PERF_DOMAIN_MICROWATTS BIT(0)
 #define EM_PERF_DOMAIN_SKIP_INEFFICIENCIES BIT(1)
 #define EM_PERF_DOMAIN_ARTIFICIAL BIT(2)
+#define EM_PERF_DOMAIN_ACCEL BIT(3)
 
 #define em_span_cpus(em) (to_cpumask((em)->cpus))
 #define em_is_artificial(em) ((em)->flags & EM_PERF_DOMAIN_ARTIFICIAL)
+#define em_is_accel(em) ((em)->flags & EM_PERF_DOMAIN_ACCEL)
 
 #ifdef CONFIG_ENERGY_MODEL
 /*
@@ -171,7 +184,14 @@ struct em_perf_domain *em_pd_get(struct device *dev);
 int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 				struct em_data_callback *cb, cpumask_t *span,
 				bool microwatts);
+int em_dev_register_accel_perf_domain(struct device *dev,
+				      unsigned int nr_states,
+				      struct em_data_callback *cb,
+				      unsigned long wake_energy,
+				      bool microwatts);
 void em_dev_unregister_perf_domain(struct device *dev);
+u64 em_dev_work_energy(struct device *dev, unsigned long freq, u64 cycles,
+		       bool powered);
 
 /**
  * em_pd_get_efficient_state() - Get an efficient performance state from the EM
@@ -298,6 +318,30 @@ static inline unsigned long em_cpu_energy(struct em_perf_domain *pd,
 	return em_estimate_energy(ps->cost, sum_util, scale_cpu);
 }
 
+/**
+ * em_pd_work_energy() - Estimates the energy of running a piece of work in a
+ *		performance domain
+ * @pd		: performance domain running the work
+ * @freq	: lowest frequency in kHz meeting the deadline of the work
+ * @cycles	: length of the work, in cycles of the device of @pd
+ *
+ * The work runs at the efficient performance state satisfying @freq, for
+ * @cycles / ps->frequency. For a CPU domain this is the energy of one CPU.
+ *
+ * Return: the energy of the work, in nano-Joules if the power values of @pd
+ * are in micro-Watts, in the matching abstract scale otherwise.
+ */
+static inline u64 em_pd_work_energy(struct em_perf_domain *pd,
+				    unsigned long freq, u64 cycles)
+{
+	struct em_perf_state *ps;
+
+	ps = em_pd_get_efficient_state(pd, freq);
+
+	/* uW * cycles / kHz = nJ */
+	return div64_u64((u64)ps->power * cycles, ps->frequency);
+}
+
 /**
  * em_pd_nr_perf_states() - Get the number of performance states of a perf.
  *				domain
@@ -323,9 +367,23 @@ int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 {
 	return -EINVAL;
 }
+static inline
+int em_dev_register_accel_perf_domain(struct device *dev,
+				      unsigned int nr_states,
+				      struct em_data_callback *cb,
+				      unsigned long wake_energy,
+				      bool microwatts)
+{
+	return -EINVAL;
+}
 static inline void em_dev_unregister_perf_domain(struct device *dev)
 {
 }
+static inline u64 em_dev_work_energy(struct device *dev, unsigned long freq,
+				     u64 cycles, bool powered)
+{
+	return U64_MAX;
+}
 static inline struct em_perf_domain *em_cpu_get(int cpu)
 {
 	return NULL;
@@ -340,6 +398,11 @@ static inline unsigned long em_cpu_energy(struct em_perf_domain *pd,
 {
 	return 0;
 }
+static inline u64 em_pd_work_energy(struct em_perf_domain *pd,
+				    unsigned long freq, u64 cycles)
+{
+	return 0;
+}
 static inline int em_pd_nr_perf_states(struct em_perf_domain *pd)
 {
 	return 0;
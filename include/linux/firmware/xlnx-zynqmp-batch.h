@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Xilinx Zynq MPSoC Firmware layer: batched EEMI calls
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ */
+
+#ifndef __FIRMWARE_ZYNQMP_BATCH_H__
+#define __FIRMWARE_ZYNQMP_BATCH_H__
+
+#include <linux/err.h>
+#include <linux/types.h>
+
+/*
+ * EEMI API executing a list of commands from shared memory, advertised by
+ * the firmware through PM_FEATURE_CHECK
+ */
+#define PM_BATCH			0x7f
+
+#define ZYNQMP_PM_BATCH_MAX_ARGS	5
+#define ZYNQMP_PM_BATCH_MAX_CMDS	256
+
+/**
+ * struct zynqmp_pm_batch_cmd - Command of a batch in shared memory
+ * @api_id:	EEMI API ID of the command
+ * @args:	Arguments of the command
+ * @status:	Status of the command, written by the firmware
+ * @ret:	Returned values of the command, written by the firmware
+ */
+struct zynqmp_pm_batch_cmd {
+	u32 api_id;
+	u32 args[ZYNQMP_PM_BATCH_MAX_ARGS];
+	u32 status;
+	u32 ret[3];
+};
+
+struct zynqmp_pm_batch;
+
+#if IS_REACHABLE(CONFIG_ZYNQMP_FIRMWARE)
+struct zynqmp_pm_batch *zynqmp_pm_batch_alloc(unsigned int max_cmds);
+void zynqmp_pm_batch_free(struct zynqmp_pm_batch *batch);
+int zynqmp_pm_batch_add(struct zynqmp_pm_batch *batch, u32 pm_api_id,
+			u32 arg0, u32 arg1, u32 arg2, u32 arg3, u32 arg4);
+int zynqmp_pm_batch_submit(struct zynqmp_pm_batch *batch,
+			   unsigned int *failed);
+int zynqmp_pm_batch_result(struct zynqmp_pm_batch *batch, unsigned int index,
+			   u32 *ret_payload);
+#else
+static inline struct zynqmp_pm_batch *zynqmp_pm_batch_alloc(unsigned int max)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void zynqmp_pm_batch_free(struct zynqmp_pm_batch *batch)
+{
+}
+
+static inline int zynqmp_pm_batch_add(struct zynqmp_pm_batch *batch,
+				      u32 pm_api_id, u32 arg0, u32 arg1,
+				      u32 arg2, u32 arg3, u32 arg4)
+{
+	return -ENODEV;
+}
+
+static inline int zynqmp_pm_batch_submit(struct zynqmp_pm_batch *batch,
+					 unsigned int *failed)
+{
+	return -ENODEV;
+}
+
+static inline int zynqmp_pm_batch_result(struct zynqmp_pm_batch *batch,
+					 unsigned int index, u32 *ret_payload)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* __FIRMWARE_ZYNQMP_BATCH_H__ */
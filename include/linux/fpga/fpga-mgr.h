@@ -232,6 +232,9 @@ struct fpga_manager_ops {
  * @mops: pointer to struct of fpga manager ops
  * @priv: low level driver private date
  * @err: low level driver error code
+ * @load_bytes: size of the last image loaded from firmware
+ * @load_ns: duration of the last load from firmware, including the read
+ * @load_streamed: the last image was streamed from firmware in chunks
  * @dir: debugfs image directory
  */
 struct fpga_manager {
@@ -247,6 +250,9 @@ struct fpga_manager {
 	const struct fpga_manager_ops *mops;
 	void *priv;
 	int err;
+	u64 load_bytes;
+	u64 load_ns;
+	bool load_streamed;
 #ifdef CONFIG_FPGA_MGR_DEBUG_FS
 	struct dentry *dir;
 #endif
@@ -28,6 +28,20 @@ struct fpga_region_info {
 	int (*get_bridges)(struct fpga_region *region);
 };
 
+/**
+ * struct fpga_region_timing - durations of the steps of a reconfiguration
+ * @decouple_ns: time taken to disable the bridges
+ * @load_ns: time taken to load the image, including the firmware request
+ * @recouple_ns: time taken to enable the bridges
+ * @cached: the image was loaded from the region image cache
+ */
+struct fpga_region_timing {
+	u64 decouple_ns;
+	u64 load_ns;
+	u64 recouple_ns;
+	bool cached;
+};
+
 /**
  * struct fpga_region - FPGA Region structure
  * @dev: FPGA Region device
@@ -38,6 +52,11 @@ struct fpga_region_info {
  * @compat_id: FPGA region id for compatibility check.
  * @priv: private data
  * @get_bridges: optional function to get bridges to a list
+ * @cache_lock: protects the image cache
+ * @cache: images loaded successfully, most recently used first
+ * @cache_bytes: size of the images in @cache
+ * @cache_max_bytes: size limit of @cache, 0 disables the image cache
+ * @timing: durations of the steps of the last reconfiguration
  */
 struct fpga_region {
 	struct device dev;
@@ -48,6 +67,11 @@ struct fpga_region {
 	struct fpga_compat_id *compat_id;
 	void *priv;
 	int (*get_bridges)(struct fpga_region *region);
+	struct mutex cache_lock; /* protects the image cache */
+	struct list_head cache;
+	size_t cache_bytes;
+	size_t cache_max_bytes;
+	struct fpga_region_timing timing;
 };
 
 #define to_fpga_region(d) container_of(d, struct fpga_region, dev)
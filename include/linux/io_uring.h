@@ -6,6 +6,8 @@
 #include <linux/xarray.h>
 #include <uapi/linux/io_uring.h>
 
+struct request;
+
 enum io_uring_cmd_flags {
 	IO_URING_F_COMPLETE_DEFER	= 1,
 	IO_URING_F_UNLOCKED		= 2,
@@ -41,6 +43,11 @@ int io_uring_cmd_import_fixed(u64 ubuf, unsigned long len, int rw,
 void io_uring_cmd_done(struct io_uring_cmd *cmd, ssize_t ret, ssize_t res2);
 void io_uring_cmd_complete_in_task(struct io_uring_cmd *ioucmd,
 			void (*task_work_cb)(struct io_uring_cmd *));
+int io_buffer_register_bvec(struct io_uring_cmd *cmd, struct request *rq,
+			    void (*release)(void *), void *priv,
+			    unsigned int index, unsigned int issue_flags);
+int io_buffer_unregister_bvec(struct io_uring_cmd *cmd, unsigned int index,
+			      unsigned int issue_flags);
 struct sock *io_uring_get_socket(struct file *file);
 void __io_uring_cancel(bool cancel_all);
 void __io_uring_free(struct task_struct *tsk);
@@ -78,6 +85,17 @@ static inline void io_uring_cmd_complete_in_task(struct io_uring_cmd *ioucmd,
 			void (*task_work_cb)(struct io_uring_cmd *))
 {
 }
+static inline int io_buffer_register_bvec(struct io_uring_cmd *cmd,
+			struct request *rq, void (*release)(void *), void *priv,
+			unsigned int index, unsigned int issue_flags)
+{
+	return -EOPNOTSUPP;
+}
+static inline int io_buffer_unregister_bvec(struct io_uring_cmd *cmd,
+			unsigned int index, unsigned int issue_flags)
+{
+	return -EOPNOTSUPP;
+}
 static inline struct sock *io_uring_get_socket(struct file *file)
 {
 	return NULL;
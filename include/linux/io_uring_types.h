@@ -188,6 +188,18 @@ struct io_ev_fd {
 struct io_alloc_cache {
 	struct hlist_head	list;
 	unsigned int		nr_cached;
+	/* allocations served from the cache and missing it */
+	unsigned long		hits;
+	unsigned long		misses;
+};
+
+/* caches of the async data of the opcodes, see io_op_def->async_cache */
+enum {
+	IO_ASYNC_CACHE_NONE,
+	IO_ASYNC_CACHE_RW,
+	IO_ASYNC_CACHE_TIMEOUT,
+	IO_ASYNC_CACHE_URING_CMD,
+	IO_ASYNC_CACHE_NR,
 };
 
 struct io_ring_ctx {
@@ -250,6 +262,7 @@ struct io_ring_ctx {
 		struct list_head	cq_overflow_list;
 		struct io_alloc_cache	apoll_cache;
 		struct io_alloc_cache	netmsg_cache;
+		struct io_alloc_cache	async_cache[IO_ASYNC_CACHE_NR];
 	} ____cacheline_aligned_in_smp;
 
 	/* IRQ completion list, under ->completion_lock */
@@ -353,8 +366,19 @@ struct io_ring_ctx {
 
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
+	/* SQPOLL thread scheduling and statistics, under ->sq_data->lock */
+	unsigned			sq_weight;
+	u64				sq_idle_ns;
+	u64				sq_gap_ns;
+	u64				sq_last_ns;
+	u64				sq_polls;
+	u64				sq_submitted;
 	/* protected by ->completion_lock */
 	unsigned			evfd_last_cq_tail;
+
+	/* latency accounting, see IORING_REGISTER_LAT_STATS */
+	bool				lat_on;
+	struct io_lat_stats		*lat_stats;
 };
 
 enum {
@@ -570,6 +594,9 @@ struct io_kiocb {
 	/* custom credentials, valid IFF REQ_F_CREDS is set */
 	const struct cred		*creds;
 	struct io_wq_work		work;
+	/* submission and task_work queueing times, 0 if not accounted */
+	u64				lat_submit_ns;
+	u64				lat_tw_ns;
 };
 
 struct io_overflow_cqe {
@@ -48,6 +48,8 @@ struct property {
 struct of_irq_controller;
 #endif
 
+struct of_prop_index;
+
 struct device_node {
 	const char *name;
 	phandle phandle;
@@ -68,6 +70,9 @@ struct device_node {
 	unsigned int unique_id;
 	struct of_irq_controller *irq_trans;
 #endif
+#if defined(CONFIG_OF_LOOKUP_INDEX)
+	struct of_prop_index *prop_index;	/* properties sorted by name */
+#endif
 };
 
 #define MAX_PHANDLE_ARGS 16
@@ -146,6 +151,7 @@ extern raw_spinlock_t devtree_lock;
 #define OF_POPULATED_BUS	4 /* platform bus created for children */
 #define OF_OVERLAY		5 /* allocated for an overlay */
 #define OF_OVERLAY_FREE_CSET	6 /* in overlay cset being freed */
+#define OF_CSET_ATTACHED	7 /* attached by the overlay being notified */
 
 #define OF_BAD_ADDR	((u64)-1)
 
@@ -655,6 +655,10 @@ struct dev_pm_info {
 	bool			no_pm_callbacks:1;	/* Owned by the PM core */
 	unsigned int		must_resume:1;	/* Owned by the PM core */
 	unsigned int		may_skip_resume:1;	/* Set by subsystems */
+#ifdef CONFIG_PM_RESUME_PROFILE
+	u64			resume_start;
+	const char		*resume_ops;
+#endif
 #else
 	unsigned int		should_wakeup:1;
 #endif
@@ -507,6 +507,25 @@ enum rproc_features {
 	RPROC_MAX_FEATURES,
 };
 
+/**
+ * struct rproc_boot_timing - durations of the phases of the last boot
+ * @request_ns: firmware request
+ * @prepare_ns: firmware sanity check and parsing, device preparation,
+ *		resource handling and carveout allocation
+ * @load_ns: loading of the firmware segments
+ * @start_ns: start of the remote processor and of its subdevices
+ * @load_bytes: number of bytes of segment data loaded
+ * @load_dma_bytes: number of bytes of @load_bytes copied by @load_chan
+ */
+struct rproc_boot_timing {
+	u64 request_ns;
+	u64 prepare_ns;
+	u64 load_ns;
+	u64 start_ns;
+	u64 load_bytes;
+	u64 load_dma_bytes;
+};
+
 /**
  * struct rproc - represents a physical remote processor device
  * @node: list node of this rproc object
@@ -550,6 +569,10 @@ enum rproc_features {
  * @cdev: character device of the rproc
  * @cdev_put_on_release: flag to indicate if remoteproc should be shutdown on @char_dev release
  * @features: indicate remoteproc features
+ * @load_chan: optional dmaengine memcpy channel to load the firmware segments
+ *	       with, the DMA address of the carveouts must then be their
+ *	       physical address
+ * @boot_timing: durations of the phases of the last boot
  */
 struct rproc {
 	struct list_head node;
@@ -592,6 +615,8 @@ struct rproc {
 	struct cdev cdev;
 	bool cdev_put_on_release;
 	DECLARE_BITMAP(features, RPROC_MAX_FEATURES);
+	struct dma_chan *load_chan;
+	struct rproc_boot_timing boot_timing;
 };
 
 /**
@@ -65,12 +65,38 @@ struct rpmsg_device {
 
 typedef int (*rpmsg_rx_cb_t)(struct rpmsg_device *, void *, int, void *, u32);
 
+/**
+ * struct rpmsg_buf_ref - reference to a buffer shared with the remote
+ * @addr: device address of the buffer
+ * @len: length of the buffer
+ * @cookie: value identifying the buffer when its ownership is returned
+ *
+ * A buffer sent by reference is owned by the receiver until it returns the
+ * reference with the same @cookie, the payload is never copied.
+ */
+struct rpmsg_buf_ref {
+	u64 addr;
+	u32 len;
+	u32 cookie;
+};
+
+/*
+ * rpmsg_ref_cb_t - buffer reference callback, @done is false for a buffer
+ * sent by the remote and true for the return of a buffer sent to it. A
+ * buffer sent by the remote is returned to it right away if the callback
+ * fails.
+ */
+typedef int (*rpmsg_ref_cb_t)(struct rpmsg_device *,
+			      const struct rpmsg_buf_ref *, bool done, void *,
+			      u32);
+
 /**
  * struct rpmsg_endpoint - binds a local rpmsg address to its user
  * @rpdev: rpmsg channel device
  * @refcount: when this drops to zero, the ept is deallocated
  * @cb: rx callback handler
- * @cb_lock: must be taken before accessing/changing @cb
+ * @ref_cb: optional buffer reference callback handler
+ * @cb_lock: must be taken before accessing/changing @cb and @ref_cb
  * @addr: local rpmsg address
  * @priv: private data for the driver's use
  *
@@ -92,6 +118,7 @@ struct rpmsg_endpoint {
 	struct rpmsg_device *rpdev;
 	struct kref refcount;
 	rpmsg_rx_cb_t cb;
+	rpmsg_ref_cb_t ref_cb;
 	struct mutex cb_lock;
 	u32 addr;
 	void *priv;
@@ -192,6 +219,12 @@ __poll_t rpmsg_poll(struct rpmsg_endpoint *ept, struct file *filp,
 
 ssize_t rpmsg_get_mtu(struct rpmsg_endpoint *ept);
 
+int rpmsg_send_ref(struct rpmsg_endpoint *ept,
+		   const struct rpmsg_buf_ref *ref, u32 dst);
+int rpmsg_return_ref(struct rpmsg_endpoint *ept,
+		     const struct rpmsg_buf_ref *ref, u32 dst);
+struct device *rpmsg_get_dma_device(struct rpmsg_endpoint *ept);
+
 #else
 
 static inline int rpmsg_register_device_override(struct rpmsg_device *rpdev,
@@ -316,6 +349,32 @@ static inline ssize_t rpmsg_get_mtu(struct rpmsg_endpoint *ept)
 	return -ENXIO;
 }
 
+static inline int rpmsg_send_ref(struct rpmsg_endpoint *ept,
+				 const struct rpmsg_buf_ref *ref, u32 dst)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
+static inline int rpmsg_return_ref(struct rpmsg_endpoint *ept,
+				   const struct rpmsg_buf_ref *ref, u32 dst)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return -ENXIO;
+}
+
+static inline struct device *rpmsg_get_dma_device(struct rpmsg_endpoint *ept)
+{
+	/* This shouldn't be possible */
+	WARN_ON(1);
+
+	return NULL;
+}
+
 #endif /* IS_ENABLED(CONFIG_RPMSG) */
 
 /* use a macro to avoid include chaining to get THIS_MODULE */
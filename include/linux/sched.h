@@ -369,6 +369,15 @@ extern struct root_domain def_root_domain;
 extern struct mutex sched_domains_mutex;
 #endif
 
+/*
+ * Log2 histograms of the time from a wakeup to running: bucket 0 counts
+ * the latencies below 2^SCHED_WAKEUP_HIST_SHIFT ns, the last bucket all
+ * those of at least 2^(SCHED_WAKEUP_HIST_SHIFT + SCHED_WAKEUP_HIST_BUCKETS
+ * - 2) ns, i.e. about 268ms.
+ */
+#define SCHED_WAKEUP_HIST_SHIFT		10
+#define SCHED_WAKEUP_HIST_BUCKETS	20
+
 struct sched_info {
 #ifdef CONFIG_SCHED_INFO
 	/* Cumulative counters: */
@@ -387,6 +396,17 @@ struct sched_info {
 	/* When were we last queued to run? */
 	unsigned long long		last_queued;
 
+	/* Wakeup latency: */
+
+	/* Time queued since the last wakeup, across migrations: */
+	unsigned long long		wakeup_delay;
+
+	/* # of wakeups per latency bucket, see sched_wakeup_hist_lower(): */
+	unsigned long			wakeup_hist[SCHED_WAKEUP_HIST_BUCKETS];
+
+	/* Woken up and not run yet? */
+	unsigned int			wakeup_pending;
+
 #endif /* CONFIG_SCHED_INFO */
 };
 
@@ -558,6 +578,9 @@ struct sched_entity {
 
 	u64				nr_migrations;
 
+	/* Wakeup preemption and slice bias, MIN..MAX_LATENCY_NICE: */
+	int				latency_nice;
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	int				depth;
 	struct sched_entity		*parent;
@@ -598,6 +621,9 @@ struct sched_rt_entity {
 #endif
 } __randomize_layout;
 
+typedef bool (*dl_server_has_tasks_f)(struct sched_dl_entity *);
+typedef struct task_struct *(*dl_server_pick_f)(struct sched_dl_entity *);
+
 struct sched_dl_entity {
 	struct rb_node			rb_node;
 
@@ -640,11 +666,24 @@ struct sched_dl_entity {
 	 *
 	 * @dl_overrun tells if the task asked to be informed about runtime
 	 * overruns.
+	 *
+	 * @dl_server tells if this is a server entity, running the tasks of
+	 * another class rather than a task.
+	 *
+	 * @dl_server_active tells if the server has been started, i.e. if
+	 * the class it serves has runnable tasks.
+	 *
+	 * @dl_defer_armed tells if the server is not enqueued but waits for
+	 * its zero-laxity instant, so that it only runs when the tasks it
+	 * serves did not get @runtime by themselves.
 	 */
 	unsigned int			dl_throttled      : 1;
 	unsigned int			dl_yielded        : 1;
 	unsigned int			dl_non_contending : 1;
 	unsigned int			dl_overrun	  : 1;
+	unsigned int			dl_server         : 1;
+	unsigned int			dl_server_active  : 1;
+	unsigned int			dl_defer_armed    : 1;
 
 	/*
 	 * Bandwidth enforcement timer. Each -deadline task has its
@@ -661,6 +700,15 @@ struct sched_dl_entity {
 	 */
 	struct hrtimer inactive_timer;
 
+	/*
+	 * Server entities only: @rq is the runqueue the server belongs to,
+	 * @server_has_tasks() tells if the served class has runnable tasks
+	 * and @server_pick() picks the next of them to run.
+	 */
+	struct rq			*rq;
+	dl_server_has_tasks_f		server_has_tasks;
+	dl_server_pick_f		server_pick;
+
 #ifdef CONFIG_RT_MUTEXES
 	/*
 	 * Priority Inheritance. When a DEADLINE scheduling entity is boosted
@@ -6,6 +6,17 @@
 #define MIN_NICE	-20
 #define NICE_WIDTH	(MAX_NICE - MIN_NICE + 1)
 
+/*
+ * Latency nice is a hint of how quickly a CFS task wants to get the CPU
+ * once it is runnable, relative to the other tasks. A task with latency
+ * nice -20 preempts at wakeup most eagerly and runs in the shortest slices,
+ * a task with latency nice 19 is the last to preempt and runs in the
+ * longest slices. It does not change the CPU share of the task.
+ */
+#define MAX_LATENCY_NICE	19
+#define MIN_LATENCY_NICE	-20
+#define LATENCY_NICE_WIDTH	(MAX_LATENCY_NICE - MIN_LATENCY_NICE + 1)
+
 /*
  * Priority of a process goes from 0..MAX_PRIO-1, valid RT
  * priority is 0..MAX_RT_PRIO-1, and SCHED_NORMAL/SCHED_BATCH
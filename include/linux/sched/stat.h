@@ -27,6 +27,12 @@ static inline int sched_info_on(void)
 	return IS_ENABLED(CONFIG_SCHED_INFO);
 }
 
+/* Lowest wakeup latency in ns counted by a bucket of the histograms */
+static inline unsigned long long sched_wakeup_hist_lower(unsigned int bucket)
+{
+	return bucket ? 1ULL << (SCHED_WAKEUP_HIST_SHIFT + bucket - 1) : 0;
+}
+
 #ifdef CONFIG_SCHEDSTATS
 void force_schedstat_enabled(void);
 #endif
@@ -28,6 +28,8 @@ struct vhost_iotlb {
 	unsigned int limit;
 	unsigned int nmaps;
 	unsigned int flags;
+	/* Bumped on every change of the maps, to invalidate cached lookups */
+	u64 gen;
 };
 
 int vhost_iotlb_add_range_ctx(struct vhost_iotlb *iotlb, u64 start, u64 last,
@@ -45,6 +45,11 @@ struct virtio_vsock_pkt {
 	/* socket refcnt not held, only use for cancellation */
 	struct vsock_sock *vsk;
 	void *buf;
+	/* MSG_ZEROCOPY payload, in the pinned pages of the sender */
+	struct page **pages;
+	unsigned int nr_pages;
+	unsigned int page_off;
+	struct ubuf_info *uarg;
 	u32 buf_len;
 	u32 len;
 	u32 off;
@@ -69,6 +74,11 @@ struct virtio_transport {
 
 	/* Takes ownership of the packet */
 	int (*send_pkt)(struct virtio_vsock_pkt *pkt);
+
+	/* send_pkt() copies the payload with virtio_transport_pkt_copy(),
+	 * MSG_ZEROCOPY payloads are then left in the pages of the sender.
+	 */
+	bool msgzerocopy;
 };
 
 ssize_t
@@ -155,5 +165,7 @@ void virtio_transport_inc_tx_pkt(struct virtio_vsock_sock *vvs, struct virtio_vs
 u32 virtio_transport_get_credit(struct virtio_vsock_sock *vvs, u32 wanted);
 void virtio_transport_put_credit(struct virtio_vsock_sock *vvs, u32 credit);
 void virtio_transport_deliver_tap_pkt(struct virtio_vsock_pkt *pkt);
+size_t virtio_transport_pkt_copy(struct virtio_vsock_pkt *pkt, size_t off,
+				 size_t len, struct iov_iter *to);
 
 #endif /* _LINUX_VIRTIO_VSOCK_H */
@@ -21,6 +21,17 @@
 #endif
 #include <asm/barrier.h>
 
+/* Number of IOTLB translations cached by a vringh. */
+#define VRINGH_IOTLB_CACHE_SIZE 4
+
+/* A cached IOTLB translation, unused if perm is 0. */
+struct vringh_iotlb_cache_entry {
+	u64 start;
+	u64 last;
+	u64 addr;
+	u32 perm;
+};
+
 /* virtio_ring with information needed for host access. */
 struct vringh {
 	/* Everything is little endian */
@@ -38,6 +49,13 @@ struct vringh {
 	/* Last index we used. */
 	u16 last_used_idx;
 
+	/*
+	 * Avail index last read from the ring, and last_avail_idx at that
+	 * time: the heads in between are read without reading it again.
+	 */
+	u16 avail_idx_shadow;
+	u16 avail_idx_base;
+
 	/* How many descriptors we've completed since last need_notify(). */
 	u32 completed;
 
@@ -50,6 +68,14 @@ struct vringh {
 	/* spinlock to synchronize IOTLB accesses */
 	spinlock_t *iotlb_lock;
 
+	/*
+	 * Last IOTLB translations, protected by iotlb_lock and valid for
+	 * the iotlb->gen they were cached at.
+	 */
+	struct vringh_iotlb_cache_entry iotlb_cache[VRINGH_IOTLB_CACHE_SIZE];
+	unsigned int iotlb_cache_next;
+	u64 iotlb_cache_gen;
+
 	/* The function to call to notify the guest about added buffers */
 	void (*notify)(struct vringh *);
 };
@@ -204,6 +204,63 @@ DEFINE_EVENT(cgroup_event, cgroup_notify_frozen,
 	TP_ARGS(cgrp, path, val)
 );
 
+TRACE_EVENT(cgroup_rstat_flush,
+
+	TP_PROTO(struct cgroup *cgrp, unsigned int nr_flushed, u64 duration,
+		 bool ongoing),
+
+	TP_ARGS(cgrp, nr_flushed, duration, ongoing),
+
+	TP_STRUCT__entry(
+		__field(	int,		root			)
+		__field(	int,		level			)
+		__field(	u64,		id			)
+		__field(	unsigned int,	nr_flushed		)
+		__field(	u64,		duration		)
+		__field(	bool,		ongoing			)
+	),
+
+	TP_fast_assign(
+		__entry->root = cgrp->root->hierarchy_id;
+		__entry->id = cgroup_id(cgrp);
+		__entry->level = cgrp->level;
+		__entry->nr_flushed = nr_flushed;
+		__entry->duration = duration;
+		__entry->ongoing = ongoing;
+	),
+
+	TP_printk("root=%d id=%llu level=%d nr_flushed=%u duration=%llu ongoing=%d",
+		  __entry->root, __entry->id, __entry->level,
+		  __entry->nr_flushed, __entry->duration, __entry->ongoing)
+);
+
+TRACE_EVENT(cgroup_rstat_flush_wait,
+
+	TP_PROTO(struct cgroup *cgrp, struct cgroup *ongoing, u64 duration),
+
+	TP_ARGS(cgrp, ongoing, duration),
+
+	TP_STRUCT__entry(
+		__field(	int,		root			)
+		__field(	int,		level			)
+		__field(	u64,		id			)
+		__field(	u64,		ongoing_id		)
+		__field(	u64,		duration		)
+	),
+
+	TP_fast_assign(
+		__entry->root = cgrp->root->hierarchy_id;
+		__entry->id = cgroup_id(cgrp);
+		__entry->level = cgrp->level;
+		__entry->ongoing_id = cgroup_id(ongoing);
+		__entry->duration = duration;
+	),
+
+	TP_printk("root=%d id=%llu level=%d ongoing_id=%llu duration=%llu",
+		  __entry->root, __entry->id, __entry->level,
+		  __entry->ongoing_id, __entry->duration)
+);
+
 #endif /* _TRACE_CGROUP_H */
 
 /* This part must be outside protection */
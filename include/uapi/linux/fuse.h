@@ -197,6 +197,9 @@
  *
  *  7.37
  *  - add FUSE_TMPFILE
+ *  - add FUSE_PASSTHROUGH, FOPEN_PASSTHROUGH, backing_id to fuse_open_out
+ *    and max_stack_depth to fuse_init_out
+ *  - add FUSE_DEV_IOC_BACKING_OPEN and FUSE_DEV_IOC_BACKING_CLOSE
  */
 
 #ifndef _LINUX_FUSE_H
@@ -304,6 +307,7 @@ struct fuse_file_lock {
  * FOPEN_CACHE_DIR: allow caching this directory
  * FOPEN_STREAM: the file is stream-like (no file position at all)
  * FOPEN_NOFLUSH: don't flush data cache on close (unless FUSE_WRITEBACK_CACHE)
+ * FOPEN_PASSTHROUGH: read, write and mmap the backing file named by backing_id
  */
 #define FOPEN_DIRECT_IO		(1 << 0)
 #define FOPEN_KEEP_CACHE	(1 << 1)
@@ -311,6 +315,7 @@ struct fuse_file_lock {
 #define FOPEN_CACHE_DIR		(1 << 3)
 #define FOPEN_STREAM		(1 << 4)
 #define FOPEN_NOFLUSH		(1 << 5)
+#define FOPEN_PASSTHROUGH	(1 << 6)
 
 /**
  * INIT request/reply flags
@@ -356,6 +361,8 @@ struct fuse_file_lock {
  * FUSE_SECURITY_CTX:	add security context to create, mkdir, symlink, and
  *			mknod
  * FUSE_HAS_INODE_DAX:  use per inode DAX
+ * FUSE_PASSTHROUGH: passthrough of the I/O to backing files, backing files
+ *		     stack at most init_out.max_stack_depth - 1 filesystems
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -392,6 +399,7 @@ struct fuse_file_lock {
 /* bits 32..63 get shifted down 32 bits into the flags2 field */
 #define FUSE_SECURITY_CTX	(1ULL << 32)
 #define FUSE_HAS_INODE_DAX	(1ULL << 33)
+#define FUSE_PASSTHROUGH	(1ULL << 34)
 
 /**
  * CUSE INIT request/reply flags
@@ -667,7 +675,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	int32_t		backing_id;
 };
 
 struct fuse_release_in {
@@ -783,7 +791,8 @@ struct fuse_init_out {
 	uint16_t	max_pages;
 	uint16_t	map_alignment;
 	uint32_t	flags2;
-	uint32_t	unused[7];
+	uint32_t	max_stack_depth;
+	uint32_t	unused[6];
 };
 
 #define CUSE_INIT_INFO_MAX 4096
@@ -957,6 +966,44 @@ struct fuse_notify_retrieve_in {
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_BACKING_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_backing_map)
+#define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
+
+/* Backing file registered by FUSE_DEV_IOC_BACKING_OPEN, returns its id */
+struct fuse_backing_map {
+	int32_t		fd;
+	uint32_t	flags;
+	uint64_t	padding;
+};
+
+/*
+ * io_uring transport: IORING_OP_URING_CMD commands of /dev/fuse
+ *
+ * FUSE_URING_CMD_FETCH completes once a request was copied to the buffer,
+ * with the length of the request, as a read of the device would.
+ * FUSE_URING_CMD_COMMIT_AND_FETCH takes the reply to that request from the
+ * same buffer, as a write of the device would, then fetches the next
+ * request.  The commands of a queue must be issued by a single thread.
+ */
+enum fuse_uring_cmd {
+	FUSE_URING_CMD_FETCH = 1,
+	FUSE_URING_CMD_COMMIT_AND_FETCH = 2,
+};
+
+/**
+ * struct fuse_uring_cmd_req - payload of the io_uring commands
+ * @buf: address of the request and reply buffer
+ * @buf_len: size of the buffer
+ * @qid: queue of the command, the CPU the daemon thread is serving
+ * @padding: must be zero
+ */
+struct fuse_uring_cmd_req {
+	uint64_t	buf;
+	uint32_t	buf_len;
+	uint16_t	qid;
+	uint16_t	padding;
+};
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -25,6 +25,12 @@
  * application.
  */
 #define XDP_USE_NEED_WAKEUP (1 << 3)
+/* By setting this option, the socket can carry packets larger than a
+ * chunk as several descriptors, the descriptors of all but the last
+ * chunk of a packet having the XDP_PKT_CONTD option set. Only supported
+ * in copy mode.
+ */
+#define XDP_USE_SG	(1 << 4)
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG (1 << 0)
@@ -106,6 +112,11 @@ struct xdp_desc {
 	__u32 options;
 };
 
+/* Flags for the options field of struct xdp_desc */
+
+/* The packet continues in the next descriptor, see XDP_USE_SG */
+#define XDP_PKT_CONTD (1 << 0)
+
 /* UMEM descriptor is __u64 */
 
 #endif /* _LINUX_IF_XDP_H */
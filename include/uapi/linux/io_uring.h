@@ -57,6 +57,7 @@ struct io_uring_sqe {
 		__u32		xattr_flags;
 		__u32		msg_ring_flags;
 		__u32		uring_cmd_flags;
+		__u32		futex_flags;
 	};
 	__u64	user_data;	/* data to be passed back at completion time */
 	/* pack this to avoid bogus arm OABI complaints */
@@ -215,6 +216,9 @@ enum io_uring_op {
 	IORING_OP_URING_CMD,
 	IORING_OP_SEND_ZC,
 	IORING_OP_SENDMSG_ZC,
+	IORING_OP_FUTEX_WAIT,
+	IORING_OP_FUTEX_WAKE,
+	IORING_OP_READ_MULTISHOT,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -295,11 +299,22 @@ enum io_uring_op {
  *				CQEs on behalf of the same SQE.
  *
  * IORING_RECVSEND_FIXED_BUF	Use registered buffers, the index is stored in
- *				the buf_index field.
+ *				the buf_index field. Supported by send_zc,
+ *				sendmsg_zc and recv, for recv the data is
+ *				received into the pinned pages of the buffer
+ *				and sqe->addr is an address inside it.
+ *
+ * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT for recv. The
+ *				receive may fill several consecutive buffers
+ *				of the group and posts a single CQE for them,
+ *				with the ID of the first buffer. The buffers
+ *				are used in ring order, the result gives how
+ *				many of them hold data.
  */
 #define IORING_RECVSEND_POLL_FIRST	(1U << 0)
 #define IORING_RECV_MULTISHOT		(1U << 1)
 #define IORING_RECVSEND_FIXED_BUF	(1U << 2)
+#define IORING_RECVSEND_BUNDLE		(1U << 4)
 
 /*
  * accept flags stored in sqe->ioprio
@@ -312,8 +327,20 @@ enum io_uring_op {
 enum {
 	IORING_MSG_DATA,	/* pass sqe->len as 'res' and off as user_data */
 	IORING_MSG_SEND_FD,	/* send a registered fd to another ring */
+	IORING_MSG_DATA_BATCH,	/* post the sqe->len entries of the array of
+				 * struct io_uring_msg_data at sqe->off, the
+				 * result is the number of CQEs posted */
+};
+
+/* an entry of IORING_MSG_DATA_BATCH, one CQE on the target ring */
+struct io_uring_msg_data {
+	__u64	user_data;
+	__s32	res;
+	__u32	flags;		/* passed as the CQE flags */
 };
 
+#define IORING_MSG_DATA_BATCH_MAX	256
+
 /*
  * IORING_OP_MSG_RING flags (sqe->msg_ring_flags)
  *
@@ -490,6 +517,12 @@ enum {
 	/* register a range of fixed file slots for automatic slot allocation */
 	IORING_REGISTER_FILE_ALLOC_RANGE	= 25,
 
+	/* set the weight, 1 to 32 in nr_args, of a ring on its SQPOLL thread */
+	IORING_REGISTER_SQPOLL_WEIGHT		= 26,
+
+	/* enable (1 in nr_args) or disable (0) the latency stats in fdinfo */
+	IORING_REGISTER_LAT_STATS		= 27,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -158,8 +158,23 @@ enum membarrier_cmd {
 	MEMBARRIER_CMD_SHARED			= MEMBARRIER_CMD_GLOBAL,
 };
 
+/**
+ * enum membarrier_cmd_flag - membarrier system call command flags
+ * @MEMBARRIER_CMD_FLAG_CPU:
+ *                          Interrupt the RSEQ critical section on the CPU
+ *                          indicated by @cpu_id only. Only valid with
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ.
+ * @MEMBARRIER_CMD_FLAG_CPUSET:
+ *                          @cpu_id is a file descriptor of a cgroup
+ *                          directory. Only the threads running on the
+ *                          effective CPUs of the cpuset of that cgroup
+ *                          are targeted. Valid with the
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED commands,
+ *                          and exclusive with MEMBARRIER_CMD_FLAG_CPU.
+ */
 enum membarrier_cmd_flag {
 	MEMBARRIER_CMD_FLAG_CPU		= (1 << 0),
+	MEMBARRIER_CMD_FLAG_CPUSET	= (1 << 1),
 };
 
 #endif /* _UAPI_LINUX_MEMBARRIER_H */
@@ -43,4 +43,31 @@ struct rpmsg_endpoint_info {
  */
 #define RPMSG_RELEASE_DEV_IOCTL	_IOW(0xb5, 0x4, struct rpmsg_endpoint_info)
 
+/**
+ * struct rpmsg_dmabuf_ref - dma-buf sent by reference
+ * @fd: dma-buf file descriptor
+ * @cookie: value reaped by RPMSG_REAP_DMABUF_IOCTL once the remote returned
+ *	    the buffer
+ * @offset: offset of the payload in the dma-buf
+ * @len: length of the payload
+ */
+struct rpmsg_dmabuf_ref {
+	__s32 fd;
+	__u32 cookie;
+	__u64 offset;
+	__u64 len;
+};
+
+/**
+ * Send a dma-buf to the remote by reference, without copying the payload.
+ * The dma-buf is held until the remote returns it.
+ */
+#define RPMSG_SEND_DMABUF_IOCTL	_IOW(0xb5, 0x10, struct rpmsg_dmabuf_ref)
+
+/**
+ * Reap the cookie of a dma-buf returned by the remote. Fails with EAGAIN if
+ * there is none, POLLPRI is signalled while there are some.
+ */
+#define RPMSG_REAP_DMABUF_IOCTL	_IOR(0xb5, 0x11, __u32)
+
 #endif
@@ -10,6 +10,7 @@ struct sched_param {
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
 #define SCHED_ATTR_SIZE_VER1	56	/* add: util_{min,max} */
+#define SCHED_ATTR_SIZE_VER2	60	/* add: latency_nice */
 
 /*
  * Extended scheduling parameters data structure.
@@ -98,6 +99,20 @@ struct sched_param {
  * scheduled on a CPU with no more capacity than the specified value.
  *
  * A task utilization boundary can be reset by setting the attribute to -1.
+ *
+ * Latency Attributes
+ * ==================
+ *
+ * A subset of sched_attr attributes allows to specify the relative latency
+ * requirements of a SCHED_NORMAL or SCHED_BATCH task:
+ *
+ *  @sched_latency_nice	task's latency nice value, in the range [-20..19]
+ *
+ * A task with a latency nice value below 0 preempts the running task at
+ * wakeup more eagerly and runs in shorter slices, a task with a value
+ * above 0 tolerates more scheduling delay and runs in longer slices. The
+ * value does not change the CPU share of the task. Lowering it requires
+ * CAP_SYS_NICE.
  */
 struct sched_attr {
 	__u32 size;
@@ -120,6 +135,8 @@ struct sched_attr {
 	__u32 sched_util_min;
 	__u32 sched_util_max;
 
+	/* Latency hint */
+	__s32 sched_latency_nice;
 };
 
 #endif /* _UAPI_LINUX_SCHED_TYPES_H */
@@ -38,10 +38,34 @@
  *
  *      It is only used if ublksrv set UBLK_F_NEED_GET_DATA flag
  *      while starting a ublk device.
+ *
+ * REGISTER_IO_BUF: registers the pages of the request of the tag as fixed
+ *      buffer of the io_uring the command is issued on, at the index given
+ *      by ublksrv_io_cmd.addr. The buffer starts at address 0, it can be
+ *      written for a READ request and read for a WRITE request.
+ *
+ * UNREGISTER_IO_BUF: unregisters the buffer at the index given by
+ *      ublksrv_io_cmd.addr. The request is completed after it has been
+ *      committed and its buffer is no longer used by any io_uring request.
+ *
+ *      They are only used if ublksrv set UBLK_F_SUPPORT_ZERO_COPY flag
+ *      while adding a ublk device.
+ *
+ * COMMIT_AND_FETCH_BATCH: issued via sqe(URING_CMD) with struct
+ *      ublksrv_batch_io_cmd, once per queue in place of the commands of
+ *      each tag. The results of the nr_commit requests in commit_addr are
+ *      committed, then the command is completed once requests are pending,
+ *      with the number of tags written to fetch_addr, at most nr_fetch.
+ *
+ *      It is only used if ublksrv set UBLK_F_BATCH_IO flag while adding
+ *      a ublk device.
  */
 #define	UBLK_IO_FETCH_REQ		0x20
 #define	UBLK_IO_COMMIT_AND_FETCH_REQ	0x21
 #define	UBLK_IO_NEED_GET_DATA	0x22
+#define	UBLK_IO_REGISTER_IO_BUF		0x23
+#define	UBLK_IO_UNREGISTER_IO_BUF	0x24
+#define	UBLK_IO_COMMIT_AND_FETCH_BATCH	0x25
 
 /* only ABORT means that no re-fetch */
 #define UBLK_IO_RES_OK			0
@@ -55,8 +79,9 @@
 #define UBLK_MAX_QUEUE_DEPTH	4096
 
 /*
- * zero copy requires 4k block size, and can remap ublk driver's io
- * request into ublksrv's vm space
+ * zero copy: the data of the requests is not copied to the io buffers,
+ * ublksrv registers the pages of the requests as io_uring fixed buffers
+ * with UBLK_IO_REGISTER_IO_BUF and does its I/O on them directly
  */
 #define UBLK_F_SUPPORT_ZERO_COPY	(1ULL << 0)
 
@@ -79,6 +104,15 @@
 
 #define UBLK_F_USER_RECOVERY_REISSUE	(1UL << 4)
 
+/*
+ * The requests of a queue are fetched and committed in batches with
+ * UBLK_IO_COMMIT_AND_FETCH_BATCH, the io buffer of a tag is at
+ * ublksrv_batch_io_cmd.buf_addr + tag * max_io_buf_bytes.
+ *
+ * UBLK_F_NEED_GET_DATA is not supported in this mode.
+ */
+#define UBLK_F_BATCH_IO		(1ULL << 5)
+
 /* device state */
 #define UBLK_S_DEV_DEAD	0
 #define UBLK_S_DEV_LIVE	1
@@ -185,6 +219,31 @@ struct ublksrv_io_cmd {
 	__u64	addr;
 };
 
+/* result of one request for UBLK_IO_COMMIT_AND_FETCH_BATCH */
+struct ublk_batch_commit_elem {
+	__u16	tag;
+	__u16	pad;
+	__s32	result;
+};
+
+/* issued to ublk driver via /dev/ublkcN for UBLK_F_BATCH_IO devices */
+struct ublksrv_batch_io_cmd {
+	__u16	q_id;
+
+	/* number of struct ublk_batch_commit_elem at commit_addr */
+	__u16	nr_commit;
+
+	/* number of __u16 tags fetch_addr has room for, not zero */
+	__u16	nr_fetch;
+	__u16	pad;
+
+	__u64	commit_addr;
+	__u64	fetch_addr;
+
+	/* base of the io buffers of the tags, may be 0 for zero copy */
+	__u64	buf_addr;
+};
+
 struct ublk_param_basic {
 #define UBLK_ATTR_READ_ONLY            (1 << 0)
 #define UBLK_ATTR_ROTATIONAL           (1 << 1)
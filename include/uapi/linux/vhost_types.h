@@ -47,6 +47,47 @@ struct vhost_vring_addr {
 	__u64 log_guest_addr;
 };
 
+struct vhost_vring_iotlb_stats {
+	unsigned int index;
+	unsigned int reserved;
+	/* Translations found in the virtqueue's cache */
+	__u64 hits;
+	/* Translations looked up in the device IOTLB or memory table */
+	__u64 misses;
+};
+
+struct vhost_worker_state {
+	/*
+	 * For VHOST_NEW_WORKER the kernel will return the new vhost_worker id.
+	 * For VHOST_FREE_WORKER this must be set to the id of the vhost_worker
+	 * to free.
+	 */
+	unsigned int worker_id;
+};
+
+struct vhost_vring_worker {
+	/* vring index */
+	unsigned int index;
+	/* The id of the vhost_worker returned from VHOST_NEW_WORKER */
+	unsigned int worker_id;
+};
+
+struct vhost_worker_cpu {
+	unsigned int worker_id;
+	/* CPU to run the worker on, -1 for any CPU the owner can run on */
+	int cpu;
+};
+
+struct vhost_worker_stats {
+	unsigned int worker_id;
+	/* PID of the worker thread */
+	unsigned int pid;
+	/* Time spent running works, in ns */
+	__u64 busy_ns;
+	/* Number of works run */
+	__u64 works;
+};
+
 /* no alignment requirement */
 struct vhost_iotlb_msg {
 	__u64 iova;
@@ -130,6 +171,22 @@ struct vhost_scsi_target {
 	unsigned short reserved;
 };
 
+/* VHOST_VSOCK specific definitions */
+
+struct vhost_vsock_stats {
+	/* Host to guest payload copied from the pages pinned by MSG_ZEROCOPY
+	 * senders, without an intermediate kernel buffer.
+	 */
+	__u64 send_zerocopy_pkts;
+	__u64 send_zerocopy_bytes;
+	/* Host to guest payload copied from kernel buffers */
+	__u64 send_copy_pkts;
+	__u64 send_copy_bytes;
+	/* Guest to host payload copied to kernel buffers */
+	__u64 recv_copy_pkts;
+	__u64 recv_copy_bytes;
+};
+
 /* VHOST_VDPA specific definitions */
 
 struct vhost_vdpa_config {
@@ -191,4 +191,12 @@ struct sockaddr_vm {
 
 #define IOCTL_VM_SOCKETS_GET_LOCAL_CID		_IO(7, 0xb9)
 
+/* MSG_ZEROCOPY notifications are encoded in the standard error format,
+ * sock_extended_err, and read with MSG_ERRQUEUE. These are the 'cmsg_level'
+ * and 'cmsg_type' of their control message.
+ */
+
+#define SOL_VSOCK	287
+#define VSOCK_RECVERR	1
+
 #endif /* _UAPI_VM_SOCKETS_H */
@@ -29,6 +29,8 @@
  *    WGDEVICE_A_PUBLIC_KEY: NLA_EXACT_LEN, len WG_KEY_LEN
  *    WGDEVICE_A_LISTEN_PORT: NLA_U16
  *    WGDEVICE_A_FWMARK: NLA_U32
+ *    WGDEVICE_A_CRYPT_CPUMASK: NLA_BINARY, array of u32 bitmap words
+ *    WGDEVICE_A_CRYPT_AFFINITY: NLA_U32
  *    WGDEVICE_A_PEERS: NLA_NESTED
  *        0: NLA_NESTED
  *            WGPEER_A_PUBLIC_KEY: NLA_EXACT_LEN, len WG_KEY_LEN
@@ -49,10 +51,26 @@
  *                    ...
  *                ...
  *            WGPEER_A_PROTOCOL_VERSION: NLA_U32
+ *            WGPEER_A_STATS: NLA_NESTED
+ *                WGPEER_STATS_A_STAGED_PACKETS: NLA_U32
+ *                WGPEER_STATS_A_HANDSHAKE_WAITS: NLA_U64
+ *                WGPEER_STATS_A_TX_QUEUE_WAIT: NLA_BINARY, u64[WG_STATS_HIST_BUCKETS]
+ *                WGPEER_STATS_A_TX_CRYPT_TIME: NLA_BINARY, u64[WG_STATS_HIST_BUCKETS]
+ *                WGPEER_STATS_A_RX_QUEUE_WAIT: NLA_BINARY, u64[WG_STATS_HIST_BUCKETS]
+ *                WGPEER_STATS_A_RX_CRYPT_TIME: NLA_BINARY, u64[WG_STATS_HIST_BUCKETS]
  *        0: NLA_NESTED
  *            ...
  *        ...
  *
+ * WGPEER_A_STATS holds the number of packets staged while the peer has no
+ * usable session, the number of times sending had to wait for a handshake to
+ * complete, and histograms of the time packets, or bundles of packets on
+ * transmit, wait in the encryption or decryption queue before a worker of
+ * the crypt workqueue takes them, and of the time the worker then spends
+ * encrypting or decrypting them. Bucket 0 counts durations shorter than 1024
+ * nanoseconds and bucket n the ones in [2^(n + 9), 2^(n + 10)) nanoseconds,
+ * except the last bucket, which counts all the longer ones too.
+ *
  * It is possible that all of the allowed IPs of a single peer will not
  * fit within a single netlink message. In that case, the same peer will
  * be written in the following message, except it will only contain
@@ -83,6 +101,11 @@
  *    WGDEVICE_A_PRIVATE_KEY: len WG_KEY_LEN, all zeros to remove
  *    WGDEVICE_A_LISTEN_PORT: NLA_U16, 0 to choose randomly
  *    WGDEVICE_A_FWMARK: NLA_U32, 0 to disable
+ *    WGDEVICE_A_CRYPT_CPUMASK: NLA_BINARY, array of u32 bitmap words, bit n
+ *                              for CPU n, of the CPUs encrypting and
+ *                              decrypting packets, all zeros for all CPUs
+ *    WGDEVICE_A_CRYPT_AFFINITY: NLA_U32, one of wgdevice_crypt_affinity,
+ *                               how a CPU of the mask is picked per packet
  *    WGDEVICE_A_PEERS: NLA_NESTED
  *        0: NLA_NESTED
  *            WGPEER_A_PUBLIC_KEY: len WG_KEY_LEN
@@ -147,6 +170,15 @@ enum wgdevice_flag {
 	WGDEVICE_F_REPLACE_PEERS = 1U << 0,
 	__WGDEVICE_F_ALL = WGDEVICE_F_REPLACE_PEERS
 };
+enum wgdevice_crypt_affinity {
+	/* Round robin over the CPUs of the mask */
+	WGDEVICE_CRYPT_AFFINITY_SPREAD,
+	/* The CPU that has the packet, if it is in the mask */
+	WGDEVICE_CRYPT_AFFINITY_LOCAL,
+	/* Round robin over the CPUs of the mask sharing a cache with it */
+	WGDEVICE_CRYPT_AFFINITY_LLC,
+	__WGDEVICE_CRYPT_AFFINITY_LAST
+};
 enum wgdevice_attribute {
 	WGDEVICE_A_UNSPEC,
 	WGDEVICE_A_IFINDEX,
@@ -157,6 +189,8 @@ enum wgdevice_attribute {
 	WGDEVICE_A_LISTEN_PORT,
 	WGDEVICE_A_FWMARK,
 	WGDEVICE_A_PEERS,
+	WGDEVICE_A_CRYPT_CPUMASK,
+	WGDEVICE_A_CRYPT_AFFINITY,
 	__WGDEVICE_A_LAST
 };
 #define WGDEVICE_A_MAX (__WGDEVICE_A_LAST - 1)
@@ -180,10 +214,26 @@ enum wgpeer_attribute {
 	WGPEER_A_TX_BYTES,
 	WGPEER_A_ALLOWEDIPS,
 	WGPEER_A_PROTOCOL_VERSION,
+	WGPEER_A_STATS,
 	__WGPEER_A_LAST
 };
 #define WGPEER_A_MAX (__WGPEER_A_LAST - 1)
 
+#define WG_STATS_HIST_BUCKETS 16
+
+enum wgpeer_stats_attribute {
+	WGPEER_STATS_A_UNSPEC,
+	WGPEER_STATS_A_STAGED_PACKETS,
+	WGPEER_STATS_A_HANDSHAKE_WAITS,
+	WGPEER_STATS_A_TX_QUEUE_WAIT,
+	WGPEER_STATS_A_TX_CRYPT_TIME,
+	WGPEER_STATS_A_RX_QUEUE_WAIT,
+	WGPEER_STATS_A_RX_CRYPT_TIME,
+	WGPEER_STATS_A_PAD,
+	__WGPEER_STATS_A_LAST
+};
+#define WGPEER_STATS_A_MAX (__WGPEER_STATS_A_LAST - 1)
+
 enum wgallowedip_attribute {
 	WGALLOWEDIP_A_UNSPEC,
 	WGALLOWEDIP_A_FAMILY,
@@ -31,6 +31,7 @@ struct xdp_diag_msg {
 #define XDP_SHOW_UMEM		(1 << 2)
 #define XDP_SHOW_MEMINFO	(1 << 3)
 #define XDP_SHOW_STATS		(1 << 4)
+#define XDP_SHOW_RING_STATS	(1 << 5)
 
 enum {
 	XDP_DIAG_NONE,
@@ -43,6 +44,10 @@ enum {
 	XDP_DIAG_UMEM_COMPLETION_RING,
 	XDP_DIAG_MEMINFO,
 	XDP_DIAG_STATS,
+	XDP_DIAG_RX_RING_STATS,
+	XDP_DIAG_TX_RING_STATS,
+	XDP_DIAG_UMEM_FILL_RING_STATS,
+	XDP_DIAG_UMEM_COMPLETION_RING_STATS,
 	__XDP_DIAG_MAX,
 };
 
@@ -80,4 +85,20 @@ struct xdp_diag_stats {
 	__u64	n_tx_ring_empty;
 };
 
+#define XDP_DIAG_RING_HIST_BUCKETS 8
+
+/* Occupancy of a ring is sampled, in eighths of the ring, every few times
+ * the kernel refreshes the pointer of the other end. The ring is stalled
+ * from the time the kernel finds it empty (fill and tx rings) or full (rx
+ * and completion rings) until it finds otherwise. Wakeups are counted for
+ * the fill and tx rings of zero-copy sockets: required is how often the
+ * driver set need_wakeup, issued how often user space asked for one.
+ */
+struct xdp_diag_ring_stats {
+	__u64	occupancy[XDP_DIAG_RING_HIST_BUCKETS];
+	__u64	stalled_ns;
+	__u64	n_wakeups_required;
+	__u64	n_wakeups_issued;
+};
+
 #endif /* _LINUX_XDP_DIAG_H */
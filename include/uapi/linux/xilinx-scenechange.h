@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Xilinx Scene Change Detection result ring
+ *
+ * Copyright (C) 2022 Advanced Micro Devices, Inc.
+ */
+
+#ifndef __UAPI_XILINX_SCENECHANGE_H__
+#define __UAPI_XILINX_SCENECHANGE_H__
+
+#include <linux/types.h>
+
+#define XSCD_RING_VERSION		1
+
+/**
+ * struct xscd_ring_entry - Result of one frame
+ * @timestamp: CLOCK_MONOTONIC time of the end of frame interrupt, in ns
+ * @sequence: frame count of the channel since it started streaming
+ * @sad: sum of absolute differences reported by the core
+ * @channel: scene change channel ID
+ * @score: @sad normalised to the frame size, from 0 to 100
+ * @scene_change: 1 if @score is above the channel threshold, 0 otherwise
+ * @reserved: must be ignored
+ */
+struct xscd_ring_entry {
+	__u64 timestamp;
+	__u32 sequence;
+	__u32 sad;
+	__u16 channel;
+	__u8 score;
+	__u8 scene_change;
+	__u32 reserved;
+};
+
+/**
+ * struct xscd_ring_header - Header at the start of the mapped ring
+ * @version: XSCD_RING_VERSION
+ * @num_entries: number of entries in the ring, a power of two
+ * @entry_size: size of an entry in bytes
+ * @entries_offset: offset of the first entry from the start of the mapping
+ * @head: count of entries written by the driver
+ * @tail: count of entries consumed, written by the consumer
+ * @reserved: must be ignored
+ *
+ * Entry n lives at index n & (num_entries - 1). The driver stores @head
+ * with release semantics after writing an entry and never waits for the
+ * consumer: when head - tail exceeds @num_entries, the oldest entries have
+ * been overwritten.
+ */
+struct xscd_ring_header {
+	__u32 version;
+	__u32 num_entries;
+	__u32 entry_size;
+	__u32 entries_offset;
+	__u64 head;
+	__u64 tail;
+	__u64 reserved[4];
+};
+
+#define XSCD_RING_IOCTL_BASE		'S'
+
+/*
+ * XSCD_RING_SET_WAKEUP: number of unconsumed entries that makes the ring
+ * readable for poll() and signals the eventfd, 1 by default
+ */
+#define XSCD_RING_SET_WAKEUP		_IOW(XSCD_RING_IOCTL_BASE, 0xe0, __u32)
+
+/*
+ * XSCD_RING_SET_EVENTFD: eventfd signalled along with poll() wake-ups,
+ * -1 to remove it
+ */
+#define XSCD_RING_SET_EVENTFD		_IOW(XSCD_RING_IOCTL_BASE, 0xe1, __s32)
+
+#endif /* __UAPI_XILINX_SCENECHANGE_H__ */
@@ -315,6 +315,23 @@ struct aie_txn_inst {
 	__u64 cmdsptr;
 };
 
+/**
+ * struct aie_uring_cmd - AIE partition io_uring command
+ * @args: pointer to the arguments of the command, which must stay valid
+ *	  until the command completes
+ * @reserved: reserved, must be 0
+ *
+ * This is the command payload of an IORING_OP_URING_CMD submission queue
+ * entry on an AI engine partition file. The cmd_op of the entry is one of
+ * AIE_TRANSACTION_IOCTL, AIE_SET_SHIMDMA_BD_IOCTL and
+ * AIE_SET_SHIMDMA_DMABUF_BD_IOCTL, the command taking the same arguments as
+ * the ioctl, or AIE_SYNC_URING_CMD.
+ */
+struct aie_uring_cmd {
+	__u64 args;
+	__u64 reserved;
+};
+
 /**
  * struct aie_rsc_req - AIE resource request
  * @loc: tile location
@@ -405,6 +422,82 @@ struct aie_rsc_user_stat_array {
 	__u32 stats_type;
 };
 
+/**
+ * struct aie_error_event - AIE error event
+ * @loc: tile location relative to the partition
+ * @mod: module type
+ * @event: hardware error event ID
+ */
+struct aie_error_event {
+	struct aie_location loc;
+	__u32 mod;
+	__u32 event;
+};
+
+/**
+ * struct aie_error_event_args - AIE error events read arguments
+ * @events: user space address of the array of `struct aie_error_event`
+ * @num_events: size of the @events array, returns the number of events
+ *		read
+ * @lost: returns the number of events dropped since the previous read
+ *	  because the error event ring of the partition was full
+ */
+struct aie_error_event_args {
+	__u64 events;
+	__u32 num_events;
+	__u32 lost;
+};
+
+/* AI engine tile status flags */
+#define AIE_TILE_STATUS_FL_GATED	(1U << 0)
+#define AIE_TILE_STATUS_FL_CORE		(1U << 1)
+
+#define AIE_TILE_STATUS_MAX_DMA_CHAN	6U
+#define AIE_TILE_STATUS_MAX_LOCKS	64U
+
+/**
+ * struct aie_tile_status - AIE tile status snapshot
+ * @loc: tile location relative to the partition
+ * @flags: AIE_TILE_STATUS_FL_GATED if the tile is clock gated, nothing else
+ *	   is read then, AIE_TILE_STATUS_FL_CORE if it has a core
+ * @num_s2mm: number of valid entries of @s2mm_sts
+ * @num_mm2s: number of valid entries of @mm2s_sts
+ * @num_locks: number of valid entries of @lock_value
+ * @reserved: reserved, returned as 0
+ * @core_status: core status register, valid with AIE_TILE_STATUS_FL_CORE
+ * @pc: core program counter, valid with AIE_TILE_STATUS_FL_CORE
+ * @s2mm_sts: status of the stream to memory map DMA channels
+ * @mm2s_sts: status of the memory map to stream DMA channels
+ * @lock_value: value of the locks
+ */
+struct aie_tile_status {
+	struct aie_location_byte loc;
+	__u8 flags;
+	__u8 num_s2mm;
+	__u8 num_mm2s;
+	__u8 num_locks;
+	__u16 reserved;
+	__u32 core_status;
+	__u32 pc;
+	__u8 s2mm_sts[AIE_TILE_STATUS_MAX_DMA_CHAN];
+	__u8 mm2s_sts[AIE_TILE_STATUS_MAX_DMA_CHAN];
+	__u8 lock_value[AIE_TILE_STATUS_MAX_LOCKS];
+};
+
+/**
+ * struct aie_tile_status_args - AIE tile status snapshot arguments
+ * @range: range of tiles to read, relative to the partition
+ * @status: user space address of the array of `struct aie_tile_status`
+ * @num_tiles: size of the @status array, returns the number of tiles read
+ * @reserved: reserved, must be 0
+ */
+struct aie_tile_status_args {
+	struct aie_range range;
+	__u64 status;
+	__u32 num_tiles;
+	__u32 reserved;
+};
+
 #define AIE_IOCTL_BASE 'A'
 
 /* AI engine device IOCTL operations */
@@ -639,4 +732,37 @@ struct aie_rsc_user_stat_array {
 #define AIE_RSC_GET_STAT_IOCTL		_IOW(AIE_IOCTL_BASE, 0x1a, \
 					struct aie_rsc_user_stat_array)
 
+/**
+ * DOC: AIE_SYNC_URING_CMD - io_uring sync point of an AIE partition
+ *
+ * The io_uring commands of a partition are executed in submission order.
+ * This command does nothing and completes once all the commands submitted
+ * before it to the partition have completed.
+ */
+#define AIE_SYNC_URING_CMD		_IO(AIE_IOCTL_BASE, 0x1b)
+
+/**
+ * DOC: AIE_GET_ERROR_EVENTS_IOCTL - read the error events of a partition
+ *
+ * The error events found by the driver when it backtracks the error
+ * interrupts are queued to a ring of the partition, oldest first, and the
+ * partition file is reported with EPOLLPRI by poll() while the ring is not
+ * empty. This ioctl consumes the events from the ring, so that user space
+ * does not have to read the error status of all the tiles.
+ */
+#define AIE_GET_ERROR_EVENTS_IOCTL	_IOWR(AIE_IOCTL_BASE, 0x1c, \
+					struct aie_error_event_args)
+
+/**
+ * DOC: AIE_GET_TILE_STATUS_IOCTL - read the status of a range of tiles
+ *
+ * The core, DMA channels and locks status of every tile of the range are
+ * read in one pass, the partition being locked once, and returned as an
+ * array with one entry per tile, column by column from the bottom row. It
+ * is meant for the monitors reading the status periodically, rather than
+ * formatting and parsing the text of the status sysfs attributes.
+ */
+#define AIE_GET_TILE_STATUS_IOCTL	_IOWR(AIE_IOCTL_BASE, 0x1d, \
+					struct aie_tile_status_args)
+
 #endif
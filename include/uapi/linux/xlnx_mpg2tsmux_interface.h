@@ -72,6 +72,18 @@ struct stream_context_in {
 	__u64 pcr_base;
 };
 
+/**
+ * struct stream_context_batch - struct to enqueue several stream contexts
+ * @num_streams: number of entries in @streams
+ * @reserved: must be zero
+ * @streams: user pointer to an array of struct stream_context_in
+ */
+struct stream_context_batch {
+	__u32 num_streams;
+	__u32 reserved;
+	__u64 streams;
+};
+
 /**
  * struct mux_context_in - struct to enqueue a mux context descriptor
  * @is_dmabuf: flag to set if external src buffer is DMA allocated
@@ -250,4 +262,14 @@ struct xlnx_tsmux_dmabuf_info {
  */
 #define MPG2MUX_VDBUF _IOWR(MPG2MUX_MAGIC, 14, struct xlnx_tsmux_dmabuf_info *)
 
+/**
+ * MPG2MUX_SETSTRMS - enqueue a batch of stream context descriptors
+ */
+#define MPG2MUX_SETSTRMS _IOW(MPG2MUX_MAGIC, 15, struct stream_context_batch *)
+
+/**
+ * MPG2MUX_RDBUF - release a dma buffer imported with MPG2MUX_VDBUF
+ */
+#define MPG2MUX_RDBUF _IOW(MPG2MUX_MAGIC, 16, struct xlnx_tsmux_dmabuf_info *)
+
 #endif
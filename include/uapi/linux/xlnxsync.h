@@ -145,6 +145,28 @@ struct xlnxsync_stat {
 	struct xlnxsync_err_intr err;
 };
 
+/**
+ * struct xlnxsync_fence - Framebuffer done fences
+ * @hdr_ver: IOCTL header version
+ * @fb_id: Framebuffer index for producer/consumer. XLNXSYNC_AUTO_SEARCH
+ * selects the framebuffer configured last.
+ * @fd: sync_file fd returned for producer/consumer, -1 if not requested
+ * @flags: XLNXSYNC_FENCE_PROD and/or XLNXSYNC_FENCE_CONS
+ *
+ * The producer (consumer) fence signals once the producer (consumer) is done
+ * with the luma and chroma of the framebuffer. It signals with an error if
+ * the channel is disabled, the slot is reset or the device is closed first.
+ */
+struct xlnxsync_fence {
+	__u64 hdr_ver;
+	__u8 fb_id[XLNXSYNC_IO];
+	__s32 fd[XLNXSYNC_IO];
+	__u32 flags;
+};
+
+#define XLNXSYNC_FENCE_PROD		(1 << XLNXSYNC_PROD)
+#define XLNXSYNC_FENCE_CONS		(1 << XLNXSYNC_CONS)
+
 #define XLNXSYNC_MAGIC			'X'
 
 /*
@@ -176,4 +198,7 @@ struct xlnxsync_stat {
 					     struct xlnxsync_intr *)
 /* This is used to reset the last programmed slot */
 #define XLNXSYNC_RESET_SLOT		_IO(XLNXSYNC_MAGIC, 10)
+/* This is used to get sync_file fences for the framebuffer done events */
+#define XLNXSYNC_CHAN_GET_FENCE		_IOWR(XLNXSYNC_MAGIC, 11,\
+					      struct xlnxsync_fence *)
 #endif
@@ -27,9 +27,12 @@ static inline struct io_cache_entry *io_alloc_cache_get(struct io_alloc_cache *c
 		struct hlist_node *node = cache->list.first;
 
 		hlist_del(node);
+		cache->nr_cached--;
+		cache->hits++;
 		return container_of(node, struct io_cache_entry, node);
 	}
 
+	cache->misses++;
 	return NULL;
 }
 
@@ -37,6 +40,8 @@ static inline void io_alloc_cache_init(struct io_alloc_cache *cache)
 {
 	INIT_HLIST_HEAD(&cache->list);
 	cache->nr_cached = 0;
+	cache->hits = 0;
+	cache->misses = 0;
 }
 
 static inline void io_alloc_cache_free(struct io_alloc_cache *cache,
@@ -14,8 +14,16 @@
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
+#include "tctx.h"
 
 #ifdef CONFIG_PROC_FS
+static __cold void io_uring_show_cache(struct seq_file *m, const char *name,
+				       struct io_alloc_cache *cache)
+{
+	seq_printf(m, "%10s: cached=%u hits=%lu misses=%lu\n", name,
+		   cache->nr_cached, cache->hits, cache->misses);
+}
+
 static __cold int io_uring_show_cred(struct seq_file *m, unsigned int id,
 		const struct cred *cred)
 {
@@ -146,6 +154,13 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (sq) {
+		seq_printf(m, "SqThreadIdleNs:\t%llu\n", sq->idle_ns);
+		seq_printf(m, "SqWeight:\t%u\n", ctx->sq_weight);
+		seq_printf(m, "SqIdleNs:\t%llu\n", ctx->sq_idle_ns);
+		seq_printf(m, "SqPolls:\t%llu\n", ctx->sq_polls);
+		seq_printf(m, "SqSubmitted:\t%llu\n", ctx->sq_submitted);
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -162,6 +177,35 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 		seq_printf(m, "%5u: 0x%llx/%u\n", i, buf->ubuf, len);
 	}
+	if (has_lock) {
+		static const char * const names[IO_ASYNC_CACHE_NR] = {
+			[IO_ASYNC_CACHE_RW]		= "rw",
+			[IO_ASYNC_CACHE_TIMEOUT]	= "timeout",
+			[IO_ASYNC_CACHE_URING_CMD]	= "uring_cmd",
+		};
+
+		seq_puts(m, "AllocCaches:\n");
+		io_uring_show_cache(m, "apoll", &ctx->apoll_cache);
+		io_uring_show_cache(m, "netmsg", &ctx->netmsg_cache);
+		for (i = IO_ASYNC_CACHE_NONE + 1; i < IO_ASYNC_CACHE_NR; i++)
+			io_uring_show_cache(m, names[i], &ctx->async_cache[i]);
+	}
+	if (has_lock)
+		io_lat_show_fdinfo(ctx, m);
+	seq_printf(m, "IoWqSteal:\t%s\n", io_wq_steal_enabled() ? "on" : "off");
+	if (has_lock) {
+		struct io_tctx_node *node;
+
+		/* the io-wq of a task goes away only after its nodes are gone */
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_uring_task *tctx = node->task->io_uring;
+
+			if (!tctx || !tctx->io_wq)
+				continue;
+			seq_printf(m, "IoWq:\t%d\n", task_pid_nr(node->task));
+			io_wq_show_fdinfo(tctx->io_wq, m);
+		}
+	}
 	if (has_lock && !xa_empty(&ctx->personalities)) {
 		unsigned long index;
 		const struct cred *cred;
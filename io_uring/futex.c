@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/futex.h>
+#include <linux/uaccess.h>
+#include <linux/io_uring.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "io_uring.h"
+#include "futex.h"
+
+/* the flags of futex_waitv(), a 32-bit futex is all there is for now */
+#define IO_FUTEX_FLAGS		(FUTEX_32 | FUTEX_PRIVATE_FLAG)
+
+struct io_futex {
+	struct file			*file;
+	u32 __user			*uaddr;
+	/* value to wait on, or number of waiters to wake */
+	u32				futex_val;
+	u32				futex_mask;
+	u32				futex_flags;
+};
+
+static int io_futex_op(struct io_futex *iof, int cmd)
+{
+	if (iof->futex_flags & FUTEX_PRIVATE_FLAG)
+		cmd |= FUTEX_PRIVATE_FLAG;
+	return cmd;
+}
+
+int io_futex_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req, struct io_futex);
+	u64 val, mask;
+
+	if (unlikely(sqe->len || sqe->futex_flags || sqe->buf_index ||
+		     sqe->file_index))
+		return -EINVAL;
+
+	iof->uaddr = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	val = READ_ONCE(sqe->addr2);
+	mask = READ_ONCE(sqe->addr3);
+	iof->futex_flags = READ_ONCE(sqe->fd);
+	if (iof->futex_flags & ~IO_FUTEX_FLAGS)
+		return -EINVAL;
+	if ((iof->futex_flags & FUTEX_32) != FUTEX_32)
+		return -EINVAL;
+	if (val > U32_MAX || !mask || mask > U32_MAX)
+		return -EINVAL;
+	if (!IS_ALIGNED((unsigned long)iof->uaddr, sizeof(u32)))
+		return -EINVAL;
+
+	iof->futex_val = val;
+	iof->futex_mask = mask;
+	return 0;
+}
+
+int io_futex_wait(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req, struct io_futex);
+	u32 uval;
+	int ret;
+
+	/*
+	 * The futex internals have no way to queue a waiter that doesn't
+	 * sleep, the wait is done by an io-wq worker. Don't punt it if the
+	 * value already differs, the wait would fail right away.
+	 */
+	if (issue_flags & IO_URING_F_NONBLOCK) {
+		if (get_user(uval, iof->uaddr)) {
+			ret = -EFAULT;
+			goto done;
+		}
+		if (uval != iof->futex_val) {
+			ret = -EAGAIN;
+			goto done;
+		}
+		return -EAGAIN;
+	}
+
+	ret = do_futex(iof->uaddr, io_futex_op(iof, FUTEX_WAIT_BITSET),
+		       iof->futex_val, NULL, NULL, 0, iof->futex_mask);
+	/* a cancelation interrupts the wait */
+	if (ret == -ERESTARTSYS)
+		ret = -EINTR;
+done:
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret, 0);
+	return IOU_OK;
+}
+
+int io_futex_wake(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req, struct io_futex);
+	int ret;
+
+	ret = do_futex(iof->uaddr, io_futex_op(iof, FUTEX_WAKE_BITSET),
+		       iof->futex_val, NULL, NULL, 0, iof->futex_mask);
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret, 0);
+	return IOU_OK;
+}
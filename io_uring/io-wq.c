@@ -15,6 +15,8 @@
 #include <linux/cpu.h>
 #include <linux/task_work.h>
 #include <linux/audit.h>
+#include <linux/moduleparam.h>
+#include <linux/seq_file.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -23,6 +25,11 @@
 
 #define WORKER_IDLE_TIMEOUT	(5 * HZ)
 
+static bool steal_work = true;
+module_param(steal_work, bool, 0644);
+MODULE_PARM_DESC(steal_work,
+		 "Let idle workers take unhashed work queued on other nodes (default: on)");
+
 enum {
 	IO_WORKER_F_UP		= 1,	/* up and active */
 	IO_WORKER_F_RUNNING	= 2,	/* account as running */
@@ -106,6 +113,9 @@ struct io_wqe {
 	struct io_wq *wq;
 	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
 
+	/* work taken from other nodes by the workers of this one */
+	atomic_long_t nr_stolen;
+
 	cpumask_var_t cpu_mask;
 };
 
@@ -534,9 +544,74 @@ static void io_assign_current_work(struct io_worker *worker,
 	raw_spin_unlock(&worker->lock);
 }
 
+static struct io_wq_work *io_acct_steal_work(struct io_wqe *victim,
+					     struct io_wqe_acct *acct)
+	__must_hold(acct->lock)
+{
+	struct io_wq_work_node *node, *prev;
+	struct io_wq_work *work, *tail;
+
+	wq_list_for_each(node, prev, &acct->work_list) {
+		work = container_of(node, struct io_wq_work, list);
+
+		if (!io_wq_is_hashed(work)) {
+			wq_list_del(&acct->work_list, node, prev);
+			return work;
+		}
+
+		/* skip the whole chain of this hash */
+		tail = victim->hash_tail[io_get_work_hash(work)];
+		node = &tail->list;
+	}
+
+	return NULL;
+}
+
+/*
+ * Called by an idle worker before going to sleep. Take unhashed work of
+ * the same kind queued on another node, the workers of that node are all
+ * busy or blocked. Hashed work stays on its node, as the hash tails and
+ * the stall handling are per node. The lock of the other node is only
+ * tried, if it is contended that node has a worker looking at it anyway.
+ */
+static struct io_wq_work *io_wqe_steal_work(struct io_worker *worker)
+{
+	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq *wq = wqe->wq;
+	int node;
+
+	if (!READ_ONCE(steal_work) || nr_node_ids == 1)
+		return NULL;
+
+	for_each_node(node) {
+		struct io_wqe *victim = wq->wqes[node];
+		struct io_wqe_acct *victim_acct = &victim->acct[acct->index];
+		struct io_wq_work *work;
+
+		if (victim == wqe || wq_list_empty(&victim_acct->work_list))
+			continue;
+		if (!raw_spin_trylock(&victim_acct->lock))
+			continue;
+		work = io_acct_steal_work(victim, victim_acct);
+		raw_spin_unlock(&victim_acct->lock);
+		if (work) {
+			atomic_long_inc(&wqe->nr_stolen);
+			return work;
+		}
+	}
+
+	return NULL;
+}
+
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work);
 
-static void io_worker_handle_work(struct io_worker *worker)
+/*
+ * Run the work queued on the node of @worker, starting with @work if it
+ * is not NULL.
+ */
+static void io_worker_handle_work(struct io_worker *worker,
+				  struct io_wq_work *work)
 {
 	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
 	struct io_wqe *wqe = worker->wqe;
@@ -544,8 +619,6 @@ static void io_worker_handle_work(struct io_worker *worker)
 	bool do_kill = test_bit(IO_WQ_BIT_EXIT, &wq->state);
 
 	do {
-		struct io_wq_work *work;
-
 		/*
 		 * If we got some work, mark us as busy. If we didn't, but
 		 * the list isn't empty, it means we stalled on hashed work.
@@ -553,9 +626,11 @@ static void io_worker_handle_work(struct io_worker *worker)
 		 * can't make progress, any work completion or insertion will
 		 * clear the stalled flag.
 		 */
-		raw_spin_lock(&acct->lock);
-		work = io_get_next_work(acct, worker);
-		raw_spin_unlock(&acct->lock);
+		if (!work) {
+			raw_spin_lock(&acct->lock);
+			work = io_get_next_work(acct, worker);
+			raw_spin_unlock(&acct->lock);
+		}
 		if (work) {
 			__io_worker_busy(wqe, worker);
 
@@ -625,11 +700,18 @@ static int io_wqe_worker(void *data)
 	set_task_comm(current, buf);
 
 	while (!test_bit(IO_WQ_BIT_EXIT, &wq->state)) {
+		struct io_wq_work *work;
 		long ret;
 
 		set_current_state(TASK_INTERRUPTIBLE);
 		while (io_acct_run_queue(acct))
-			io_worker_handle_work(worker);
+			io_worker_handle_work(worker, NULL);
+
+		work = io_wqe_steal_work(worker);
+		if (work) {
+			io_worker_handle_work(worker, work);
+			continue;
+		}
 
 		raw_spin_lock(&wqe->lock);
 		/* timed out, exit unless we're the last worker */
@@ -656,7 +738,7 @@ static int io_wqe_worker(void *data)
 	}
 
 	if (test_bit(IO_WQ_BIT_EXIT, &wq->state))
-		io_worker_handle_work(worker);
+		io_worker_handle_work(worker, NULL);
 
 	io_worker_exit(worker);
 	return 0;
@@ -1397,6 +1479,44 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+/**
+ * io_wq_show_fdinfo - Show the workers and the stealing of each node
+ * @wq: worker pool
+ * @m: fdinfo file
+ */
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	int node;
+
+	for_each_node(node) {
+		struct io_wqe *wqe = wq->wqes[node];
+		unsigned int nr[IO_WQ_ACCT_NR], max[IO_WQ_ACCT_NR];
+		int i;
+
+		raw_spin_lock(&wqe->lock);
+		for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+			nr[i] = wqe->acct[i].nr_workers;
+			max[i] = wqe->acct[i].max_workers;
+		}
+		raw_spin_unlock(&wqe->lock);
+
+		seq_printf(m, "  node %d: bound=%u/%u unbound=%u/%u stolen=%ld\n",
+			   node, nr[IO_WQ_ACCT_BOUND], max[IO_WQ_ACCT_BOUND],
+			   nr[IO_WQ_ACCT_UNBOUND], max[IO_WQ_ACCT_UNBOUND],
+			   atomic_long_read(&wqe->nr_stolen));
+	}
+}
+
+/**
+ * io_wq_steal_enabled - Tell whether idle workers take work from other nodes
+ *
+ * Return: true if they do.
+ */
+bool io_wq_steal_enabled(void)
+{
+	return READ_ONCE(steal_work) && nr_node_ids > 1;
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
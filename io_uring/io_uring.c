@@ -145,7 +145,7 @@ static bool io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 					 bool cancel_all);
 
 static void io_dismantle_req(struct io_kiocb *req);
-static void io_clean_op(struct io_kiocb *req);
+static void io_clean_op(struct io_kiocb *req, bool locked);
 static void io_queue_sqe(struct io_kiocb *req);
 static void io_move_task_work_from_local(struct io_ring_ctx *ctx);
 static void __io_submit_flush_completions(struct io_ring_ctx *ctx);
@@ -246,8 +246,10 @@ static __cold void io_fallback_req_func(struct work_struct *work)
 	bool locked = false;
 
 	percpu_ref_get(&ctx->refs);
-	llist_for_each_entry_safe(req, tmp, node, io_task_work.node)
+	llist_for_each_entry_safe(req, tmp, node, io_task_work.node) {
+		io_lat_tw_run(req);
 		req->io_task_work.func(req, &locked);
+	}
 
 	if (locked) {
 		io_submit_flush_completions(ctx);
@@ -273,7 +275,7 @@ static int io_alloc_hash_table(struct io_hash_table *table, unsigned bits)
 static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 {
 	struct io_ring_ctx *ctx;
-	int hash_bits;
+	int hash_bits, i;
 
 	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
 	if (!ctx)
@@ -310,6 +312,8 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->io_buffers_cache);
 	io_alloc_cache_init(&ctx->apoll_cache);
 	io_alloc_cache_init(&ctx->netmsg_cache);
+	for (i = 0; i < IO_ASYNC_CACHE_NR; i++)
+		io_alloc_cache_init(&ctx->async_cache[i]);
 	init_completion(&ctx->ref_comp);
 	xa_init_flags(&ctx->personalities, XA_FLAGS_ALLOC1);
 	mutex_init(&ctx->uring_lock);
@@ -469,6 +473,7 @@ void io_queue_iowq(struct io_kiocb *req, bool *dont_use)
 		req->work.flags |= IO_WQ_WORK_CANCEL;
 
 	trace_io_uring_queue_async_work(req, io_wq_is_hashed(&req->work));
+	io_lat_issued(req, IO_LAT_IOWQ);
 	io_wq_enqueue(tctx->io_wq, &req->work);
 	if (link)
 		io_queue_linked_timeout(link);
@@ -960,7 +965,7 @@ static inline void io_dismantle_req(struct io_kiocb *req)
 	unsigned int flags = req->flags;
 
 	if (unlikely(flags & IO_REQ_CLEAN_FLAGS))
-		io_clean_op(req);
+		io_clean_op(req, false);
 	if (!(flags & REQ_F_FIXED_FILE))
 		io_put_file(req->file);
 }
@@ -1039,6 +1044,7 @@ static unsigned int handle_tw_list(struct llist_node *node,
 			*locked = mutex_trylock(&(*ctx)->uring_lock);
 			percpu_ref_get(&(*ctx)->refs);
 		}
+		io_lat_tw_run(req);
 		req->io_task_work.func(req, locked);
 		node = next;
 		count++;
@@ -1133,6 +1139,8 @@ static inline void __io_req_task_work_add(struct io_kiocb *req, bool allow_local
 	struct io_ring_ctx *ctx = req->ctx;
 	struct llist_node *node;
 
+	io_lat_tw_queue(req);
+
 	if (allow_local && ctx->flags & IORING_SETUP_DEFER_TASKRUN) {
 		io_req_local_work_add(req);
 		return;
@@ -1197,6 +1205,7 @@ int __io_run_local_work(struct io_ring_ctx *ctx, bool *locked)
 		struct io_kiocb *req = container_of(node, struct io_kiocb,
 						    io_task_work.node);
 		prefetch(container_of(next, struct io_kiocb, io_task_work.node));
+		io_lat_tw_run(req);
 		req->io_task_work.func(req, locked);
 		ret++;
 		node = next;
@@ -1315,7 +1324,7 @@ void io_free_batch_list(struct io_ring_ctx *ctx, struct io_wq_work_node *node)
 			if (req->flags & IO_REQ_LINK_FLAGS)
 				io_queue_next(req);
 			if (unlikely(req->flags & IO_REQ_CLEAN_FLAGS))
-				io_clean_op(req);
+				io_clean_op(req, true);
 		}
 		if (!(req->flags & REQ_F_FIXED_FILE))
 			io_put_file(req->file);
@@ -1605,6 +1614,49 @@ bool io_alloc_async_data(struct io_kiocb *req)
 	return true;
 }
 
+/**
+ * io_alloc_cached_async_data - Allocate the async data of a request
+ * @req: request
+ * @issue_flags: issue flags, IO_URING_F_UNLOCKED if ->uring_lock isn't held
+ *
+ * Like io_alloc_async_data(), but takes the data from the cache of the
+ * opcode when the ring lock is held. The data isn't zeroed in either case.
+ *
+ * Return: false on success, true on allocation failure.
+ */
+bool io_alloc_cached_async_data(struct io_kiocb *req, unsigned int issue_flags)
+{
+	unsigned int slot = io_op_defs[req->opcode].async_cache;
+	struct io_cache_entry *entry;
+
+	if (slot && !(issue_flags & IO_URING_F_UNLOCKED)) {
+		entry = io_alloc_cache_get(&req->ctx->async_cache[slot]);
+		if (entry) {
+			req->async_data = entry;
+			req->flags |= REQ_F_ASYNC_DATA;
+			return false;
+		}
+	}
+	return io_alloc_async_data(req);
+}
+
+static void io_free_async_data(struct io_kiocb *req, bool locked)
+{
+	unsigned int slot = io_op_defs[req->opcode].async_cache;
+
+	/* the entry overlays the head of the data, which is dead by now */
+	if (!locked || !slot ||
+	    !io_alloc_cache_put(&req->ctx->async_cache[slot],
+				req->async_data))
+		kfree(req->async_data);
+	req->async_data = NULL;
+}
+
+static void io_async_cache_free(struct io_cache_entry *entry)
+{
+	kfree(entry);
+}
+
 int io_req_prep_async(struct io_kiocb *req)
 {
 	const struct io_op_def *def = &io_op_defs[req->opcode];
@@ -1679,7 +1731,7 @@ static __cold void io_drain_req(struct io_kiocb *req)
 	spin_unlock(&ctx->completion_lock);
 }
 
-static void io_clean_op(struct io_kiocb *req)
+static void io_clean_op(struct io_kiocb *req, bool locked)
 {
 	if (req->flags & REQ_F_BUFFER_SELECTED) {
 		spin_lock(&req->ctx->completion_lock);
@@ -1705,10 +1757,8 @@ static void io_clean_op(struct io_kiocb *req)
 	}
 	if (req->flags & REQ_F_CREDS)
 		put_cred(req->creds);
-	if (req->flags & REQ_F_ASYNC_DATA) {
-		kfree(req->async_data);
-		req->async_data = NULL;
-	}
+	if (req->flags & REQ_F_ASYNC_DATA)
+		io_free_async_data(req, locked);
 	req->flags &= ~IO_REQ_CLEAN_FLAGS;
 }
 
@@ -1901,6 +1951,7 @@ static void io_queue_async(struct io_kiocb *req, int ret)
 		io_queue_iowq(req, NULL);
 		break;
 	case IO_APOLL_OK:
+		io_lat_issued(req, IO_LAT_POLL);
 		break;
 	}
 
@@ -1919,10 +1970,12 @@ static inline void io_queue_sqe(struct io_kiocb *req)
 	 * We async punt it if the file wasn't marked NOWAIT, or if the file
 	 * doesn't support non-blocking read/write attempts
 	 */
-	if (likely(!ret))
+	if (likely(!ret)) {
+		io_lat_issued(req, IO_LAT_INLINE);
 		io_arm_ltimeout(req);
-	else
+	} else {
 		io_queue_async(req, ret);
+	}
 }
 
 static void io_queue_sqe_fallback(struct io_kiocb *req)
@@ -2007,6 +2060,7 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	req->file = NULL;
 	req->rsrc_node = NULL;
 	req->task = current;
+	io_lat_init_req(ctx, req);
 
 	if (unlikely(opcode >= IORING_OP_LAST)) {
 		req->opcode = 0;
@@ -2583,6 +2637,8 @@ static void io_req_caches_free(struct io_ring_ctx *ctx)
 
 static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 {
+	int i;
+
 	io_sq_thread_finish(ctx);
 	io_rsrc_refs_drop(ctx);
 	/* __io_rsrc_put_work() may need uring_lock to progress, wait w/o it */
@@ -2599,6 +2655,9 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	io_eventfd_unregister(ctx);
 	io_alloc_cache_free(&ctx->apoll_cache, io_apoll_cache_free);
 	io_alloc_cache_free(&ctx->netmsg_cache, io_netmsg_cache_free);
+	for (i = 0; i < IO_ASYNC_CACHE_NR; i++)
+		io_alloc_cache_free(&ctx->async_cache[i], io_async_cache_free);
+	io_lat_free(ctx);
 	mutex_unlock(&ctx->uring_lock);
 	io_destroy_buffers(ctx);
 	if (ctx->sq_creds)
@@ -4039,6 +4098,18 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_file_alloc_range(ctx, arg);
 		break;
+	case IORING_REGISTER_SQPOLL_WEIGHT:
+		ret = -EINVAL;
+		if (arg)
+			break;
+		ret = io_sqpoll_set_weight(ctx, nr_args);
+		break;
+	case IORING_REGISTER_LAT_STATS:
+		ret = -EINVAL;
+		if (arg)
+			break;
+		ret = io_lat_register(ctx, nr_args);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -4118,6 +4189,7 @@ static int __init io_uring_init(void)
 	BUILD_BUG_SQE_ELEM(28, __u32,  hardlink_flags);
 	BUILD_BUG_SQE_ELEM(28, __u32,  xattr_flags);
 	BUILD_BUG_SQE_ELEM(28, __u32,  msg_ring_flags);
+	BUILD_BUG_SQE_ELEM(28, __u32,  futex_flags);
 	BUILD_BUG_SQE_ELEM(32, __u64,  user_data);
 	BUILD_BUG_SQE_ELEM(40, __u16,  buf_index);
 	BUILD_BUG_SQE_ELEM(40, __u16,  buf_group);
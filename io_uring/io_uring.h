@@ -7,6 +7,7 @@
 #include "io-wq.h"
 #include "slist.h"
 #include "filetable.h"
+#include "lat.h"
 
 #ifndef CREATE_TRACE_POINTS
 #include <trace/events/io_uring.h>
@@ -52,6 +53,7 @@ static inline bool io_req_ffs_set(struct io_kiocb *req)
 
 bool io_is_uring_fops(struct file *file);
 bool io_alloc_async_data(struct io_kiocb *req);
+bool io_alloc_cached_async_data(struct io_kiocb *req, unsigned int issue_flags);
 void io_req_task_work_add(struct io_kiocb *req);
 void io_req_tw_post_queue(struct io_kiocb *req, s32 res, u32 cflags);
 void io_req_task_queue(struct io_kiocb *req);
@@ -119,6 +121,8 @@ static inline bool __io_fill_cqe_req(struct io_ring_ctx *ctx,
 {
 	struct io_uring_cqe *cqe;
 
+	io_lat_complete(ctx, req);
+
 	/*
 	 * If we can't get a cq entry, userspace overflowed the
 	 * submission (by quite a lot). Increment the overflow count in
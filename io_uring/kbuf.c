@@ -125,26 +125,35 @@ static void __user *io_provided_buffer_select(struct io_kiocb *req, size_t *len,
 	return NULL;
 }
 
-static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
-					  struct io_buffer_list *bl,
-					  unsigned int issue_flags)
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						__u16 head)
 {
-	struct io_uring_buf_ring *br = bl->buf_ring;
 	struct io_uring_buf *buf;
-	__u16 head = bl->head;
-
-	if (unlikely(smp_load_acquire(&br->tail) == head))
-		return NULL;
 
 	head &= bl->mask;
 	if (head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
+		buf = &bl->buf_ring->bufs[head];
 	} else {
 		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
 		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
 		buf = page_address(bl->buf_pages[index]);
 		buf += off;
 	}
+	return buf;
+}
+
+static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
+					  struct io_buffer_list *bl,
+					  unsigned int issue_flags)
+{
+	struct io_uring_buf_ring *br = bl->buf_ring;
+	struct io_uring_buf *buf;
+	__u16 head = bl->head;
+
+	if (unlikely(smp_load_acquire(&br->tail) == head))
+		return NULL;
+
+	buf = io_ring_head_to_buf(bl, head);
 	if (*len == 0 || *len > buf->len)
 		*len = buf->len;
 	req->flags |= REQ_F_BUFFER_RING;
@@ -188,6 +197,99 @@ void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 	return ret;
 }
 
+static int io_ring_buffers_select(struct io_kiocb *req, struct iovec *iovs,
+				  int nr_iovs, size_t max_len,
+				  struct io_buffer_list *bl,
+				  unsigned int issue_flags)
+{
+	struct io_uring_buf_ring *br = bl->buf_ring;
+	__u16 tail, head = bl->head;
+	bool consume = false;
+	int nr = 0;
+
+	tail = smp_load_acquire(&br->tail);
+	if (unlikely(tail == head))
+		return -ENOBUFS;
+
+	/*
+	 * See io_ring_buffer_select(), buffers consumed here can't be handed
+	 * back to the ring if the IO ends up not using them, stick to one.
+	 */
+	if (issue_flags & IO_URING_F_UNLOCKED || !file_can_poll(req->file)) {
+		consume = true;
+		nr_iovs = 1;
+	}
+	nr_iovs = min_t(int, nr_iovs, (__u16)(tail - head));
+
+	do {
+		struct io_uring_buf *buf = io_ring_head_to_buf(bl, head + nr);
+		size_t len = buf->len;
+
+		if (!nr)
+			req->buf_index = buf->bid;
+		if (max_len) {
+			len = min(len, max_len);
+			max_len -= len;
+			if (!max_len)
+				nr_iovs = nr + 1;
+		}
+		iovs[nr].iov_base = u64_to_user_ptr(buf->addr);
+		iovs[nr].iov_len = len;
+	} while (++nr < nr_iovs);
+
+	req->flags |= REQ_F_BUFFER_RING;
+	req->buf_list = bl;
+	if (consume) {
+		req->buf_list = NULL;
+		bl->head += nr;
+	}
+	return nr;
+}
+
+/**
+ * io_buffers_select - Select several buffers of the group of a request
+ * @req: request
+ * @iovs: vectors to fill with the buffers
+ * @nr_iovs: maximum number of buffers to select
+ * @max_len: maximum total length of the buffers, 0 for no limit
+ * @issue_flags: issue flags of the request
+ *
+ * Consecutive buffers of a ring mapped group are selected, only one buffer
+ * is selected from a classic provided buffer group. The buffers are put with
+ * io_put_kbufs().
+ *
+ * Return: the number of buffers selected or -ENOBUFS if the group is empty.
+ */
+int io_buffers_select(struct io_kiocb *req, struct iovec *iovs, int nr_iovs,
+		      size_t max_len, unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_list *bl;
+	int ret = -ENOBUFS;
+
+	io_ring_submit_lock(req->ctx, issue_flags);
+
+	bl = io_buffer_get_list(ctx, req->buf_index);
+	if (likely(bl)) {
+		if (bl->buf_nr_pages) {
+			ret = io_ring_buffers_select(req, iovs, nr_iovs,
+						     max_len, bl, issue_flags);
+		} else {
+			size_t len = max_len;
+			void __user *buf;
+
+			buf = io_provided_buffer_select(req, &len, bl);
+			if (buf) {
+				iovs[0].iov_base = buf;
+				iovs[0].iov_len = len;
+				ret = 1;
+			}
+		}
+	}
+	io_ring_submit_unlock(req->ctx, issue_flags);
+	return ret;
+}
+
 static __cold int io_init_bl_list(struct io_ring_ctx *ctx)
 {
 	int i;
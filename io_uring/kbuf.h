@@ -2,6 +2,7 @@
 #ifndef IOU_KBUF_H
 #define IOU_KBUF_H
 
+#include <linux/uio.h>
 #include <uapi/linux/io_uring.h>
 
 struct io_buffer_list {
@@ -35,6 +36,8 @@ struct io_buffer {
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags);
+int io_buffers_select(struct io_kiocb *req, struct iovec *iovs, int nr_iovs,
+		      size_t max_len, unsigned int issue_flags);
 void io_destroy_buffers(struct io_ring_ctx *ctx);
 
 int io_remove_buffers_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
@@ -92,22 +95,30 @@ static inline void io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 		io_kbuf_recycle_ring(req);
 }
 
-static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
-					      struct list_head *list)
+static inline unsigned int __io_put_kbuf_ring(struct io_kiocb *req, int nr)
 {
 	unsigned int ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
 
-	if (req->flags & REQ_F_BUFFER_RING) {
-		if (req->buf_list) {
-			req->buf_index = req->buf_list->bgid;
-			req->buf_list->head++;
-		}
-		req->flags &= ~REQ_F_BUFFER_RING;
-	} else {
-		req->buf_index = req->kbuf->bgid;
-		list_add(&req->kbuf->list, list);
-		req->flags &= ~REQ_F_BUFFER_SELECTED;
+	if (req->buf_list) {
+		req->buf_index = req->buf_list->bgid;
+		req->buf_list->head += nr;
 	}
+	req->flags &= ~REQ_F_BUFFER_RING;
+	return ret;
+}
+
+static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
+					      struct list_head *list)
+{
+	unsigned int ret;
+
+	if (req->flags & REQ_F_BUFFER_RING)
+		return __io_put_kbuf_ring(req, 1);
+
+	ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
+	req->buf_index = req->kbuf->bgid;
+	list_add(&req->kbuf->list, list);
+	req->flags &= ~REQ_F_BUFFER_SELECTED;
 
 	return ret;
 }
@@ -129,4 +140,16 @@ static inline unsigned int io_put_kbuf(struct io_kiocb *req,
 		return 0;
 	return __io_put_kbuf(req, issue_flags);
 }
+
+/*
+ * Puts the buffers selected by io_buffers_select(), committing the first @nr
+ * of them to the ring.
+ */
+static inline unsigned int io_put_kbufs(struct io_kiocb *req, int nr,
+					unsigned issue_flags)
+{
+	if (!(req->flags & REQ_F_BUFFER_RING))
+		return io_put_kbuf(req, issue_flags);
+	return __io_put_kbuf_ring(req, nr);
+}
 #endif
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Optional latency accounting of the requests of a ring, enabled with
+ * IORING_REGISTER_LAT_STATS and shown in fdinfo.
+ */
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/io_uring.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "io_uring.h"
+#include "lat.h"
+
+static unsigned int io_lat_bucket(u64 delta_ns)
+{
+	unsigned int bucket;
+
+	if (delta_ns < (1ULL << IO_LAT_MIN_SHIFT))
+		return 0;
+	bucket = ilog2(delta_ns) - IO_LAT_MIN_SHIFT + 1;
+	return min_t(unsigned int, bucket, IO_LAT_BUCKETS - 1);
+}
+
+/* only requests submitted while the stats were enabled get here */
+void __io_lat_complete(struct io_ring_ctx *ctx, struct io_kiocb *req)
+{
+	u64 delta_ns = ktime_get_ns() - req->lat_submit_ns;
+	atomic_long_t *hist = ctx->lat_stats->lat[req->opcode];
+
+	atomic_long_inc(&hist[io_lat_bucket(delta_ns)]);
+	req->lat_submit_ns = 0;
+}
+
+void __io_lat_tw_run(struct io_kiocb *req)
+{
+	u64 delta_ns = ktime_get_ns() - req->lat_tw_ns;
+
+	atomic_long_inc(&req->ctx->lat_stats->tw_lat[io_lat_bucket(delta_ns)]);
+	req->lat_tw_ns = 0;
+}
+
+/**
+ * io_lat_register - Enable or disable the latency accounting of a ring
+ * @ctx: ring
+ * @nr_args: 1 to enable and reset the stats, 0 to disable
+ *
+ * The stats are kept once allocated, disabling only stops the accounting
+ * of new requests.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int io_lat_register(struct io_ring_ctx *ctx, unsigned int nr_args)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_lat_stats *stats = ctx->lat_stats;
+
+	if (nr_args > 1)
+		return -EINVAL;
+	if (!nr_args) {
+		WRITE_ONCE(ctx->lat_on, false);
+		return 0;
+	}
+
+	if (!stats) {
+		stats = kvzalloc(sizeof(*stats), GFP_KERNEL_ACCOUNT);
+		if (!stats)
+			return -ENOMEM;
+		ctx->lat_stats = stats;
+	} else {
+		/* racing with in flight accounting, it's only a reset */
+		memset(stats, 0, sizeof(*stats));
+	}
+	/* pairs with the submission side checking ->lat_on */
+	smp_store_release(&ctx->lat_on, true);
+	return 0;
+}
+
+void io_lat_free(struct io_ring_ctx *ctx)
+{
+	kvfree(ctx->lat_stats);
+	ctx->lat_stats = NULL;
+}
+
+static void io_lat_show_hist(struct seq_file *m, atomic_long_t *hist)
+{
+	int i;
+
+	for (i = 0; i < IO_LAT_BUCKETS; i++) {
+		long nr = atomic_long_read(&hist[i]);
+
+		if (!nr)
+			continue;
+		if (i == IO_LAT_BUCKETS - 1)
+			seq_printf(m, " inf:%ld", nr);
+		else
+			seq_printf(m, " %llu:%ld",
+				   1ULL << (IO_LAT_MIN_SHIFT + i), nr);
+	}
+	seq_putc(m, '\n');
+}
+
+/**
+ * io_lat_show_fdinfo - Show the latency stats of a ring
+ * @ctx: ring
+ * @m: fdinfo file
+ *
+ * Each histogram line lists the counts of its non-empty buckets, keyed by
+ * the upper bound of the bucket in nanoseconds.
+ */
+void io_lat_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_lat_stats *stats = ctx->lat_stats;
+	int op;
+
+	seq_printf(m, "LatStats:\t%s\n", ctx->lat_on ? "on" : "off");
+	if (!stats)
+		return;
+
+	for (op = 0; op < IORING_OP_LAST; op++) {
+		long nr_inline = atomic_long_read(&stats->nr_inline[op]);
+		long nr_poll = atomic_long_read(&stats->nr_poll[op]);
+		long nr_iowq = atomic_long_read(&stats->nr_iowq[op]);
+		bool empty = true;
+		int i;
+
+		for (i = 0; i < IO_LAT_BUCKETS; i++)
+			if (atomic_long_read(&stats->lat[op][i]))
+				empty = false;
+		if (empty && !nr_inline && !nr_poll && !nr_iowq)
+			continue;
+
+		seq_printf(m, "  %s: inline=%ld poll=%ld iowq=%ld lat_ns:",
+			   io_uring_get_opcode(op), nr_inline, nr_poll,
+			   nr_iowq);
+		io_lat_show_hist(m, stats->lat[op]);
+	}
+	seq_puts(m, "  task_work lat_ns:");
+	io_lat_show_hist(m, stats->tw_lat);
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef IOU_LAT_H
+#define IOU_LAT_H
+
+#include <linux/ktime.h>
+
+/* power of two buckets, from below 1us up to 4s and more */
+#define IO_LAT_BUCKETS		24
+#define IO_LAT_MIN_SHIFT	10
+
+struct io_lat_stats {
+	/* how the requests of each opcode got issued */
+	atomic_long_t	nr_inline[IORING_OP_LAST];
+	atomic_long_t	nr_poll[IORING_OP_LAST];
+	atomic_long_t	nr_iowq[IORING_OP_LAST];
+	/* submission to completion latencies of each opcode */
+	atomic_long_t	lat[IORING_OP_LAST][IO_LAT_BUCKETS];
+	/* latencies from queueing task_work to running it */
+	atomic_long_t	tw_lat[IO_LAT_BUCKETS];
+};
+
+int io_lat_register(struct io_ring_ctx *ctx, unsigned int nr_args);
+void io_lat_free(struct io_ring_ctx *ctx);
+void io_lat_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m);
+void __io_lat_complete(struct io_ring_ctx *ctx, struct io_kiocb *req);
+void __io_lat_tw_run(struct io_kiocb *req);
+
+enum {
+	IO_LAT_INLINE,
+	IO_LAT_POLL,
+	IO_LAT_IOWQ,
+};
+
+static inline void io_lat_init_req(struct io_ring_ctx *ctx,
+				   struct io_kiocb *req)
+{
+	req->lat_submit_ns = unlikely(READ_ONCE(ctx->lat_on)) ?
+			     ktime_get_ns() : 0;
+	req->lat_tw_ns = 0;
+}
+
+static inline void io_lat_issued(struct io_kiocb *req, int how)
+{
+	struct io_lat_stats *stats = req->ctx->lat_stats;
+
+	if (likely(!req->lat_submit_ns))
+		return;
+	if (how == IO_LAT_INLINE)
+		atomic_long_inc(&stats->nr_inline[req->opcode]);
+	else if (how == IO_LAT_POLL)
+		atomic_long_inc(&stats->nr_poll[req->opcode]);
+	else
+		atomic_long_inc(&stats->nr_iowq[req->opcode]);
+}
+
+static inline void io_lat_complete(struct io_ring_ctx *ctx,
+				   struct io_kiocb *req)
+{
+	if (unlikely(req->lat_submit_ns))
+		__io_lat_complete(ctx, req);
+}
+
+static inline void io_lat_tw_queue(struct io_kiocb *req)
+{
+	if (unlikely(req->lat_submit_ns) && !req->lat_tw_ns)
+		req->lat_tw_ns = ktime_get_ns();
+}
+
+static inline void io_lat_tw_run(struct io_kiocb *req)
+{
+	if (unlikely(req->lat_tw_ns))
+		__io_lat_tw_run(req);
+}
+#endif
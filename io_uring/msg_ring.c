@@ -15,7 +15,11 @@
 
 struct io_msg {
 	struct file			*file;
-	u64 user_data;
+	union {
+		u64 user_data;
+		/* array of IORING_MSG_DATA_BATCH */
+		u64 entries;
+	};
 	u32 len;
 	u32 cmd;
 	u32 src_fd;
@@ -37,6 +41,40 @@ static int io_msg_ring_data(struct io_kiocb *req)
 	return -EOVERFLOW;
 }
 
+/*
+ * Post all the entries under a single lock of the target CQ, with a single
+ * wakeup of its waiters.
+ */
+static int io_msg_ring_data_batch(struct io_kiocb *req)
+{
+	struct io_ring_ctx *target_ctx = req->file->private_data;
+	struct io_msg *msg = io_kiocb_to_cmd(req, struct io_msg);
+	struct io_uring_msg_data *entries;
+	unsigned int i;
+	size_t size;
+
+	if (msg->src_fd || msg->dst_fd || msg->flags)
+		return -EINVAL;
+	if (!msg->len || msg->len > IORING_MSG_DATA_BATCH_MAX)
+		return -EINVAL;
+
+	size = array_size(msg->len, sizeof(*entries));
+	entries = memdup_user(u64_to_user_ptr(msg->entries), size);
+	if (IS_ERR(entries))
+		return PTR_ERR(entries);
+
+	io_cq_lock(target_ctx);
+	for (i = 0; i < msg->len; i++) {
+		if (!io_fill_cqe_aux(target_ctx, entries[i].user_data,
+				     entries[i].res, entries[i].flags, true))
+			break;
+	}
+	io_cq_unlock_post(target_ctx);
+
+	kfree(entries);
+	return i ? i : -EOVERFLOW;
+}
+
 static void io_double_unlock_ctx(struct io_ring_ctx *ctx,
 				 struct io_ring_ctx *octx,
 				 unsigned int issue_flags)
@@ -158,6 +196,9 @@ int io_msg_ring(struct io_kiocb *req, unsigned int issue_flags)
 	case IORING_MSG_SEND_FD:
 		ret = io_msg_send_fd(req, issue_flags);
 		break;
+	case IORING_MSG_DATA_BATCH:
+		ret = io_msg_ring_data_batch(req);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
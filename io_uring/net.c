@@ -537,7 +537,8 @@ int io_recvmsg_prep_async(struct io_kiocb *req)
 	return ret;
 }
 
-#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT)
+#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT | \
+		       IORING_RECVSEND_BUNDLE | IORING_RECVSEND_FIXED_BUF)
 
 int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -565,6 +566,30 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 			return -EINVAL;
 		req->flags |= REQ_F_APOLL_MULTISHOT;
 	}
+	if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		if (req->opcode != IORING_OP_RECV)
+			return -EINVAL;
+		if (!(req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		/* a partial receive would have to keep all the buffers */
+		if (sr->msg_flags & MSG_WAITALL)
+			return -EINVAL;
+	}
+	if (sr->flags & IORING_RECVSEND_FIXED_BUF) {
+		struct io_ring_ctx *ctx = req->ctx;
+		unsigned idx;
+
+		/* req->imu shares its storage with the selected buffer */
+		if (req->opcode != IORING_OP_RECV ||
+		    (req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		idx = READ_ONCE(sqe->buf_index);
+		if (unlikely(idx >= ctx->nr_user_bufs))
+			return -EFAULT;
+		idx = array_index_nospec(idx, ctx->nr_user_bufs);
+		req->imu = READ_ONCE(ctx->user_bufs[idx]);
+		io_req_set_rsrc_node(req, ctx, 0);
+	}
 
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
@@ -815,9 +840,20 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	return ret;
 }
 
+/* Number of the buffers of a bundle that the received data went to */
+static int io_bundle_nbufs(const struct iovec *iovs, int nr_iovs, int ret)
+{
+	int nbufs = 0;
+
+	while (ret > 0 && nbufs < nr_iovs)
+		ret -= iovs[nbufs++].iov_len;
+	return nbufs;
+}
+
 int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
+	struct iovec iovs[UIO_FASTIOV];
 	struct msghdr msg;
 	struct socket *sock;
 	struct iovec iov;
@@ -826,6 +862,7 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	int ret, min_ret = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 	size_t len = sr->len;
+	int nr_iovs = 0;
 
 	if (!(req->flags & REQ_F_POLLED) &&
 	    (sr->flags & IORING_RECVSEND_POLL_FIRST))
@@ -836,18 +873,35 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		return -ENOTSOCK;
 
 retry_multishot:
-	if (io_do_buffer_select(req)) {
-		void __user *buf;
+	if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		/* io_do_buffer_select() is true, partial IO is ruled out */
+		nr_iovs = io_buffers_select(req, iovs, ARRAY_SIZE(iovs),
+					    sr->len, issue_flags);
+		if (nr_iovs < 0)
+			return nr_iovs;
+		iov_iter_init(&msg.msg_iter, READ, iovs, nr_iovs,
+			      iov_length(iovs, nr_iovs));
+	} else if (sr->flags & IORING_RECVSEND_FIXED_BUF) {
+		/* the pages are pinned, the socket copies into a bvec */
+		ret = io_import_fixed(READ, &msg.msg_iter, req->imu,
+				      (u64)(uintptr_t)sr->buf, len);
+		if (unlikely(ret))
+			goto out_free;
+	} else {
+		if (io_do_buffer_select(req)) {
+			void __user *buf;
 
-		buf = io_buffer_select(req, &len, issue_flags);
-		if (!buf)
-			return -ENOBUFS;
-		sr->buf = buf;
-	}
+			buf = io_buffer_select(req, &len, issue_flags);
+			if (!buf)
+				return -ENOBUFS;
+			sr->buf = buf;
+		}
 
-	ret = import_single_range(READ, sr->buf, len, &iov, &msg.msg_iter);
-	if (unlikely(ret))
-		goto out_free;
+		ret = import_single_range(READ, sr->buf, len, &iov,
+					  &msg.msg_iter);
+		if (unlikely(ret))
+			goto out_free;
+	}
 
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
@@ -896,7 +950,11 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	if (sr->flags & IORING_RECVSEND_BUNDLE)
+		cflags = io_put_kbufs(req, io_bundle_nbufs(iovs, nr_iovs, ret),
+				      issue_flags);
+	else
+		cflags = io_put_kbuf(req, issue_flags);
 	if (msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
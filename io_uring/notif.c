@@ -47,6 +47,9 @@ struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx)
 	notif->flags = 0;
 	notif->file = NULL;
 	notif->task = current;
+	/* not a request of its own for the latency stats */
+	notif->lat_submit_ns = 0;
+	notif->lat_tw_ns = 0;
 	io_get_task_refs(1);
 	notif->rsrc_node = NULL;
 	io_req_set_rsrc_node(notif, ctx, 0);
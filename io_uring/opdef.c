@@ -33,6 +33,7 @@
 #include "poll.h"
 #include "cancel.h"
 #include "rw.h"
+#include "futex.h"
 
 static int io_no_issue(struct io_kiocb *req, unsigned int issue_flags)
 {
@@ -64,6 +65,7 @@ const struct io_op_def io_op_defs[] = {
 		.ioprio			= 1,
 		.iopoll			= 1,
 		.async_size		= sizeof(struct io_async_rw),
+		.async_cache		= IO_ASYNC_CACHE_RW,
 		.name			= "READV",
 		.prep			= io_prep_rw,
 		.issue			= io_read,
@@ -81,6 +83,7 @@ const struct io_op_def io_op_defs[] = {
 		.ioprio			= 1,
 		.iopoll			= 1,
 		.async_size		= sizeof(struct io_async_rw),
+		.async_cache		= IO_ASYNC_CACHE_RW,
 		.name			= "WRITEV",
 		.prep			= io_prep_rw,
 		.issue			= io_write,
@@ -104,6 +107,7 @@ const struct io_op_def io_op_defs[] = {
 		.ioprio			= 1,
 		.iopoll			= 1,
 		.async_size		= sizeof(struct io_async_rw),
+		.async_cache		= IO_ASYNC_CACHE_RW,
 		.name			= "READ_FIXED",
 		.prep			= io_prep_rw,
 		.issue			= io_read,
@@ -119,6 +123,7 @@ const struct io_op_def io_op_defs[] = {
 		.ioprio			= 1,
 		.iopoll			= 1,
 		.async_size		= sizeof(struct io_async_rw),
+		.async_cache		= IO_ASYNC_CACHE_RW,
 		.name			= "WRITE_FIXED",
 		.prep			= io_prep_rw,
 		.issue			= io_write,
@@ -185,6 +190,7 @@ const struct io_op_def io_op_defs[] = {
 	[IORING_OP_TIMEOUT] = {
 		.audit_skip		= 1,
 		.async_size		= sizeof(struct io_timeout_data),
+		.async_cache		= IO_ASYNC_CACHE_TIMEOUT,
 		.name			= "TIMEOUT",
 		.prep			= io_timeout_prep,
 		.issue			= io_timeout,
@@ -219,6 +225,7 @@ const struct io_op_def io_op_defs[] = {
 	[IORING_OP_LINK_TIMEOUT] = {
 		.audit_skip		= 1,
 		.async_size		= sizeof(struct io_timeout_data),
+		.async_cache		= IO_ASYNC_CACHE_TIMEOUT,
 		.name			= "LINK_TIMEOUT",
 		.prep			= io_link_timeout_prep,
 		.issue			= io_no_issue,
@@ -278,6 +285,7 @@ const struct io_op_def io_op_defs[] = {
 		.ioprio			= 1,
 		.iopoll			= 1,
 		.async_size		= sizeof(struct io_async_rw),
+		.async_cache		= IO_ASYNC_CACHE_RW,
 		.name			= "READ",
 		.prep			= io_prep_rw,
 		.issue			= io_read,
@@ -293,6 +301,7 @@ const struct io_op_def io_op_defs[] = {
 		.ioprio			= 1,
 		.iopoll			= 1,
 		.async_size		= sizeof(struct io_async_rw),
+		.async_cache		= IO_ASYNC_CACHE_RW,
 		.name			= "WRITE",
 		.prep			= io_prep_rw,
 		.issue			= io_write,
@@ -482,6 +491,7 @@ const struct io_op_def io_op_defs[] = {
 		.name			= "URING_CMD",
 		.iopoll			= 1,
 		.async_size		= uring_cmd_pdu_size(1),
+		.async_cache		= IO_ASYNC_CACHE_URING_CMD,
 		.prep			= io_uring_cmd_prep,
 		.issue			= io_uring_cmd,
 		.prep_async		= io_uring_cmd_prep_async,
@@ -521,6 +531,39 @@ const struct io_op_def io_op_defs[] = {
 		.fail			= io_sendrecv_fail,
 #else
 		.prep			= io_eopnotsupp_prep,
+#endif
+	},
+	[IORING_OP_FUTEX_WAIT] = {
+		/* the wait may last forever, don't hold a bound worker */
+		.unbound_nonreg_file	= 1,
+		.audit_skip		= 1,
+		.name			= "FUTEX_WAIT",
+#if defined(CONFIG_FUTEX)
+		.prep			= io_futex_prep,
+		.issue			= io_futex_wait,
+#else
+		.prep			= io_eopnotsupp_prep,
+#endif
+	},
+	[IORING_OP_READ_MULTISHOT] = {
+		.needs_file		= 1,
+		.unbound_nonreg_file	= 1,
+		.pollin			= 1,
+		.buffer_select		= 1,
+		.audit_skip		= 1,
+		.ioprio			= 1,
+		.name			= "READ_MULTISHOT",
+		.prep			= io_read_mshot_prep,
+		.issue			= io_read_mshot,
+	},
+	[IORING_OP_FUTEX_WAKE] = {
+		.audit_skip		= 1,
+		.name			= "FUTEX_WAKE",
+#if defined(CONFIG_FUTEX)
+		.prep			= io_futex_prep,
+		.issue			= io_futex_wake,
+#else
+		.prep			= io_eopnotsupp_prep,
 #endif
 	},
 };
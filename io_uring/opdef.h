@@ -29,6 +29,8 @@ struct io_op_def {
 	unsigned		manual_alloc : 1;
 	/* size of async data needed, if any */
 	unsigned short		async_size;
+	/* ctx->async_cache[] slot recycling the async data, if any */
+	unsigned char		async_cache;
 
 	const char		*name;
 
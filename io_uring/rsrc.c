@@ -9,6 +9,7 @@
 #include <linux/hugetlb.h>
 #include <linux/compat.h>
 #include <linux/io_uring.h>
+#include <linux/blk-mq.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -141,7 +142,11 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	struct io_mapped_ubuf *imu = *slot;
 	unsigned int i;
 
-	if (imu != ctx->dummy_ubuf) {
+	if (imu != ctx->dummy_ubuf && imu->release) {
+		/* the pages were lent by a driver, they are not pinned */
+		imu->release(imu->priv);
+		kvfree(imu);
+	} else if (imu != ctx->dummy_ubuf) {
 		for (i = 0; i < imu->nr_bvecs; i++)
 			unpin_user_page(imu->bvec[i].bv_page);
 		if (imu->acct_pages)
@@ -1183,13 +1188,120 @@ struct page **io_pin_pages(unsigned long ubuf, unsigned long len, int *npages)
 	return pages;
 }
 
+struct io_imu_folio_data {
+	/* pages of the first folio, which may start in the middle */
+	unsigned int	nr_pages_head;
+	/* pages of the other folios */
+	unsigned int	nr_pages_mid;
+	unsigned int	folio_shift;
+	/* offset of the buffer in the first folio */
+	unsigned long	head_off;
+};
+
+static bool io_do_coalesce_buffer(struct page ***pages, int *nr_pages,
+				  struct io_imu_folio_data *data,
+				  int nr_folios)
+{
+	struct page **page_array = *pages, **new_array;
+	int nr_pages_left = *nr_pages, i, j;
+
+	new_array = kvmalloc_array(nr_folios, sizeof(struct page *),
+				   GFP_KERNEL);
+	if (!new_array)
+		return false;
+
+	/*
+	 * Keep a single pin per folio, it holds the whole folio. The bvec
+	 * of a folio then starts at its head page.
+	 */
+	new_array[0] = compound_head(page_array[0]);
+	if (data->nr_pages_head > 1)
+		unpin_user_pages(&page_array[1], data->nr_pages_head - 1);
+
+	j = data->nr_pages_head;
+	nr_pages_left -= data->nr_pages_head;
+	for (i = 1; i < nr_folios; i++) {
+		unsigned int nr_unpin;
+
+		new_array[i] = page_array[j];
+		nr_unpin = min_t(unsigned int, nr_pages_left - 1,
+				 data->nr_pages_mid - 1);
+		if (nr_unpin)
+			unpin_user_pages(&page_array[j + 1], nr_unpin);
+		j += data->nr_pages_mid;
+		nr_pages_left -= data->nr_pages_mid;
+	}
+
+	kvfree(page_array);
+	*pages = new_array;
+	*nr_pages = nr_folios;
+	return true;
+}
+
+/*
+ * Replace the pages of a buffer backed by large folios, e.g. huge pages,
+ * by their folios. The pages must be contiguous within each folio, and
+ * all folios but the first and last must be fully covered and of the
+ * same size.
+ */
+static bool io_try_coalesce_buffer(struct page ***pages, int *nr_pages,
+				   struct io_imu_folio_data *data)
+{
+	struct page **page_array = *pages;
+	struct folio *folio = page_folio(page_array[0]);
+	unsigned int count = 1, nr_folios = 1;
+	int i;
+
+	if (*nr_pages <= 1)
+		return false;
+
+	data->nr_pages_mid = folio_nr_pages(folio);
+	if (data->nr_pages_mid == 1)
+		return false;
+
+	data->folio_shift = PAGE_SHIFT + folio_order(folio);
+	data->head_off = folio_page_idx(folio, page_array[0]) << PAGE_SHIFT;
+
+	for (i = 1; i < *nr_pages; i++) {
+		if (page_folio(page_array[i]) == folio &&
+		    page_array[i] == page_array[i - 1] + 1) {
+			count++;
+			continue;
+		}
+
+		if (nr_folios == 1) {
+			/* the first folio must be used up to its end */
+			if (folio_page_idx(folio, page_array[i - 1]) !=
+			    data->nr_pages_mid - 1)
+				return false;
+			data->nr_pages_head = count;
+		} else if (count != data->nr_pages_mid) {
+			return false;
+		}
+
+		folio = page_folio(page_array[i]);
+		if (folio_size(folio) != (1UL << data->folio_shift) ||
+		    folio_page_idx(folio, page_array[i]) != 0)
+			return false;
+
+		count = 1;
+		nr_folios++;
+	}
+	if (nr_folios == 1)
+		data->nr_pages_head = count;
+
+	return io_do_coalesce_buffer(pages, nr_pages, data, nr_folios);
+}
+
 static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 				  struct io_mapped_ubuf **pimu,
 				  struct page **last_hpage)
 {
 	struct io_mapped_ubuf *imu = NULL;
 	struct page **pages = NULL;
-	unsigned long off;
+	struct io_imu_folio_data data;
+	unsigned long off, vec_size;
+	bool coalesced;
 	size_t size;
 	int ret, nr_pages, i;
 
@@ -1206,9 +1318,13 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 		goto done;
 	}
 
+	coalesced = io_try_coalesce_buffer(&pages, &nr_pages, &data);
+
 	imu = kvmalloc(struct_size(imu, bvec, nr_pages), GFP_KERNEL);
-	if (!imu)
+	if (!imu) {
+		unpin_user_pages(pages, nr_pages);
 		goto done;
+	}
 
 	ret = io_buffer_account_pin(ctx, pages, nr_pages, imu, last_hpage);
 	if (ret) {
@@ -1217,11 +1333,17 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	}
 
 	off = (unsigned long) iov->iov_base & ~PAGE_MASK;
+	imu->folio_shift = PAGE_SHIFT;
+	if (coalesced) {
+		off += data.head_off;
+		imu->folio_shift = data.folio_shift;
+	}
+	vec_size = 1UL << imu->folio_shift;
 	size = iov->iov_len;
 	for (i = 0; i < nr_pages; i++) {
 		size_t vec_len;
 
-		vec_len = min_t(size_t, size, PAGE_SIZE - off);
+		vec_len = min_t(size_t, size, vec_size - off);
 		imu->bvec[i].bv_page = pages[i];
 		imu->bvec[i].bv_len = vec_len;
 		imu->bvec[i].bv_offset = off;
@@ -1232,6 +1354,8 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->release = NULL;
+	imu->dir = (1 << READ) | (1 << WRITE);
 	*pimu = imu;
 	ret = 0;
 done:
@@ -1320,6 +1444,8 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 	/* not inside the mapped region */
 	if (unlikely(buf_addr < imu->ubuf || buf_end > imu->ubuf_end))
 		return -EFAULT;
+	if (unlikely(!(imu->dir & (1 << ddir))))
+		return -EFAULT;
 
 	/*
 	 * May not be a start of buffer, set size appropriately
@@ -1328,7 +1454,10 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 	offset = buf_addr - imu->ubuf;
 	iov_iter_bvec(iter, ddir, imu->bvec, imu->nr_bvecs, offset + len);
 
-	if (offset) {
+	/* the bvecs of a request have no fixed size */
+	if (offset && imu->release) {
+		iov_iter_advance(iter, offset);
+	} else if (offset) {
 		/*
 		 * Don't use iov_iter_advance() here, as it's really slow for
 		 * using the latter parts of a big fixed buffer - it iterates
@@ -1336,8 +1465,8 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 		 * we know that:
 		 *
 		 * 1) it's a BVEC iter, we set it up
-		 * 2) all bvecs are PAGE_SIZE in size, except potentially the
-		 *    first and last bvec
+		 * 2) all bvecs are 1 << folio_shift in size, except
+		 *    potentially the first and last bvec
 		 *
 		 * So just find our index, and adjust the iterator afterwards.
 		 * If the offset is within the first bvec (or the whole first
@@ -1350,18 +1479,131 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 		if (offset <= bvec->bv_len) {
 			iov_iter_advance(iter, offset);
 		} else {
+			unsigned long seg_mask = (1UL << imu->folio_shift) - 1;
 			unsigned long seg_skip;
 
 			/* skip first vec */
 			offset -= bvec->bv_len;
-			seg_skip = 1 + (offset >> PAGE_SHIFT);
+			seg_skip = 1 + (offset >> imu->folio_shift);
 
 			iter->bvec = bvec + seg_skip;
 			iter->nr_segs -= seg_skip;
 			iter->count -= bvec->bv_len + offset;
-			iter->iov_offset = offset & ~PAGE_MASK;
+			iter->iov_offset = offset & seg_mask;
 		}
 	}
 
 	return 0;
 }
+
+/**
+ * io_buffer_register_bvec - Lend the pages of a block request as fixed buffer
+ * @cmd: uring_cmd of the driver of the request
+ * @rq: block request whose pages the buffer covers
+ * @release: called once the buffer is unregistered and no longer in use
+ * @priv: argument of @release
+ * @index: empty slot of the registered buffers of the ring of @cmd
+ * @issue_flags: issue flags of @cmd
+ *
+ * The buffer starts at address 0 and is readable by the requests of the
+ * ring for a write request, writable for a read request.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int io_buffer_register_bvec(struct io_uring_cmd *cmd, struct request *rq,
+			    void (*release)(void *), void *priv,
+			    unsigned int index, unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = cmd_to_io_kiocb(cmd)->ctx;
+	struct io_mapped_ubuf *imu;
+	struct req_iterator rq_iter;
+	unsigned int nr_bvecs = 0;
+	struct bio_vec bv;
+	int ret = 0;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	if (!ctx->buf_data) {
+		ret = -ENXIO;
+		goto unlock;
+	}
+	if (index >= ctx->nr_user_bufs) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+	index = array_index_nospec(index, ctx->nr_user_bufs);
+	if (ctx->user_bufs[index] != ctx->dummy_ubuf) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	rq_for_each_bvec(bv, rq, rq_iter)
+		nr_bvecs++;
+	imu = kvmalloc(struct_size(imu, bvec, nr_bvecs), GFP_KERNEL);
+	if (!imu) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	nr_bvecs = 0;
+	rq_for_each_bvec(bv, rq, rq_iter)
+		imu->bvec[nr_bvecs++] = bv;
+	imu->ubuf = 0;
+	imu->ubuf_end = blk_rq_bytes(rq);
+	imu->nr_bvecs = nr_bvecs;
+	imu->folio_shift = PAGE_SHIFT;
+	imu->acct_pages = 0;
+	imu->release = release;
+	imu->priv = priv;
+	imu->dir = 1 << rq_data_dir(rq);
+
+	ctx->user_bufs[index] = imu;
+	*io_get_tag_slot(ctx->buf_data, index) = 0;
+unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(io_buffer_register_bvec);
+
+/**
+ * io_buffer_unregister_bvec - Unregister a buffer lent by a driver
+ * @cmd: uring_cmd of the driver of the buffer
+ * @index: slot of the buffer
+ * @issue_flags: issue flags of @cmd
+ *
+ * The release callback of the buffer runs once the requests of the ring
+ * using it have completed, which may be after this returns.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int io_buffer_unregister_bvec(struct io_uring_cmd *cmd, unsigned int index,
+			      unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = cmd_to_io_kiocb(cmd)->ctx;
+	struct io_mapped_ubuf *imu;
+	int ret;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	ret = -ENXIO;
+	if (!ctx->buf_data)
+		goto unlock;
+	ret = -EINVAL;
+	if (index >= ctx->nr_user_bufs)
+		goto unlock;
+	index = array_index_nospec(index, ctx->nr_user_bufs);
+	imu = ctx->user_bufs[index];
+	if (imu == ctx->dummy_ubuf || !imu->release)
+		goto unlock;
+
+	ret = io_rsrc_node_switch_start(ctx);
+	if (ret)
+		goto unlock;
+	ret = io_queue_rsrc_removal(ctx->buf_data, index, ctx->rsrc_node, imu);
+	if (ret)
+		goto unlock;
+	ctx->user_bufs[index] = ctx->dummy_ubuf;
+	io_rsrc_node_switch(ctx, ctx->buf_data);
+unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(io_buffer_unregister_bvec);
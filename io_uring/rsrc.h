@@ -49,7 +49,14 @@ struct io_mapped_ubuf {
 	u64		ubuf;
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
+	/* all bvecs but the first and last are 1 << folio_shift long */
+	unsigned int	folio_shift;
 	unsigned long	acct_pages;
+	/* pages lent by a driver, given back through release */
+	void		(*release)(void *);
+	void		*priv;
+	/* mask of the allowed directions, 1 << READ / WRITE */
+	u8		dir;
 	struct bio_vec	bvec[];
 };
 
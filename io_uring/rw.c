@@ -508,14 +508,15 @@ static void io_req_map_rw(struct io_kiocb *req, const struct iovec *iovec,
 }
 
 static int io_setup_async_rw(struct io_kiocb *req, const struct iovec *iovec,
-			     struct io_rw_state *s, bool force)
+			     struct io_rw_state *s, bool force,
+			     unsigned int issue_flags)
 {
 	if (!force && !io_op_defs[req->opcode].prep_async)
 		return 0;
 	if (!req_has_async_data(req)) {
 		struct io_async_rw *iorw;
 
-		if (io_alloc_async_data(req)) {
+		if (io_alloc_cached_async_data(req, issue_flags)) {
 			kfree(iovec);
 			return -ENOMEM;
 		}
@@ -739,7 +740,8 @@ int io_read(struct io_kiocb *req, unsigned int issue_flags)
 	if (force_nonblock) {
 		/* If the file doesn't support async, just async punt */
 		if (unlikely(!io_file_supports_nowait(req))) {
-			ret = io_setup_async_rw(req, iovec, s, true);
+			ret = io_setup_async_rw(req, iovec, s, true,
+						issue_flags);
 			return ret ?: -EAGAIN;
 		}
 		kiocb->ki_flags |= IOCB_NOWAIT;
@@ -787,7 +789,7 @@ int io_read(struct io_kiocb *req, unsigned int issue_flags)
 	 */
 	iov_iter_restore(&s->iter, &s->iter_state);
 
-	ret2 = io_setup_async_rw(req, iovec, s, true);
+	ret2 = io_setup_async_rw(req, iovec, s, true, issue_flags);
 	iovec = NULL;
 	if (ret2) {
 		ret = ret > 0 ? ret : ret2;
@@ -840,6 +842,113 @@ int io_read(struct io_kiocb *req, unsigned int issue_flags)
 	return kiocb_done(req, ret, issue_flags);
 }
 
+int io_read_mshot_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	int ret;
+
+	/* must be used with provided buffers, sqe->len may cap their size */
+	if (!(req->flags & REQ_F_BUFFER_SELECT))
+		return -EINVAL;
+
+	ret = io_prep_rw(req, sqe);
+	if (unlikely(ret))
+		return ret;
+	if (rw->addr)
+		return -EINVAL;
+
+	req->flags |= REQ_F_APOLL_MULTISHOT;
+	return 0;
+}
+
+/*
+ * Read into a provided buffer and post a CQE with IORING_CQE_F_MORE for
+ * each read, until the file has no more data. The request then stays
+ * armed through poll and reads again on the next wakeup. It terminates on
+ * EOF, on an error, e.g. -ENOBUFS once the buffers run out, or if a CQE
+ * can't be posted.
+ */
+int io_read_mshot(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	struct kiocb *kiocb = &rw->kiocb;
+	unsigned int cflags;
+	struct iov_iter iter;
+	struct iovec iov;
+	void __user *buf;
+	loff_t *ppos;
+	size_t len;
+	ssize_t ret;
+
+	/* poll tells when to read again, and the reads must not block */
+	if (!file_can_poll(req->file))
+		return -EBADFD;
+	ret = io_rw_init_file(req, FMODE_READ);
+	if (unlikely(ret))
+		return ret;
+	if (!io_file_supports_nowait(req))
+		return -EBADFD;
+	/* the reads are done inline, don't let the file queue them */
+	kiocb->ki_complete = NULL;
+	kiocb->ki_flags |= IOCB_NOWAIT;
+
+retry:
+	cflags = 0;
+	len = rw->len;
+	buf = io_buffer_select(req, &len, issue_flags);
+	if (!buf) {
+		ret = -ENOBUFS;
+		goto done;
+	}
+
+	ret = import_single_range(READ, buf, len, &iov, &iter);
+	if (unlikely(ret)) {
+		io_kbuf_recycle(req, issue_flags);
+		goto done;
+	}
+
+	ppos = io_kiocb_update_pos(req);
+	ret = rw_verify_area(READ, req->file, ppos, len);
+	if (likely(!ret))
+		ret = io_iter_do_read(rw, &iter);
+
+	if (ret == -EAGAIN) {
+		io_kbuf_recycle(req, issue_flags);
+		if (issue_flags & IO_URING_F_MULTISHOT)
+			return IOU_ISSUE_SKIP_COMPLETE;
+		/* arm poll */
+		return -EAGAIN;
+	}
+	if (req->flags & REQ_F_CUR_POS)
+		req->file->f_pos = kiocb->ki_pos;
+
+	if (ret <= 0) {
+		io_kbuf_recycle(req, issue_flags);
+		goto done;
+	}
+
+	cflags = io_put_kbuf(req, issue_flags);
+	/* keep reading, poll won't trigger again while data is pending */
+	if (io_post_aux_cqe(req->ctx, req->cqe.user_data, ret,
+			    cflags | IORING_CQE_F_MORE, false))
+		goto retry;
+
+	/*
+	 * Otherwise stop multishot but use the current result, it may end
+	 * up in the overflow list.
+	 */
+done:
+	if (ret < 0) {
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		req_set_fail(req);
+	}
+	io_req_set_res(req, ret, cflags);
+	if (issue_flags & IO_URING_F_MULTISHOT)
+		return IOU_STOP_MULTISHOT;
+	return IOU_OK;
+}
+
 int io_write(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
@@ -945,7 +1054,8 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 			 * the bytes already written.
 			 */
 			iov_iter_save_state(&s->iter, &s->iter_state);
-			ret = io_setup_async_rw(req, iovec, s, true);
+			ret = io_setup_async_rw(req, iovec, s, true,
+						issue_flags);
 
 			io = req->async_data;
 			if (io)
@@ -960,7 +1070,7 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 	} else {
 copy_iov:
 		iov_iter_restore(&s->iter, &s->iter_state);
-		ret = io_setup_async_rw(req, iovec, s, false);
+		ret = io_setup_async_rw(req, iovec, s, false, issue_flags);
 		if (!ret) {
 			if (kiocb->ki_flags & IOCB_WRITE)
 				kiocb_end_write(req);
@@ -6,11 +6,13 @@
 #include <linux/kernel.h>
 #include <linux/errno.h>
 #include <linux/file.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/audit.h>
 #include <linux/security.h>
 #include <linux/io_uring.h>
+#include <linux/sched/cpufreq.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -18,6 +20,9 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+#define IORING_SQPOLL_MAX_WEIGHT	32
+/* cpufreq hint of a submission batch of at least the fairness cap */
+#define IORING_SQPOLL_HINT_US		1000
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -74,14 +79,36 @@ void io_put_sq_data(struct io_sq_data *sqd)
 	}
 }
 
-static __cold void io_sqd_update_thread_idle(struct io_sq_data *sqd)
+/*
+ * The thread keeps spinning after the last submission of a ring for four
+ * times the average gap between its submissions, within the idle period of
+ * the ring. When the submissions come further apart than the idle period,
+ * spinning would only delay the sleep the next submission has to wake the
+ * thread from anyway, so the thread spins only for a sixteenth of it.
+ */
+static void io_sq_update_idle(struct io_ring_ctx *ctx, u64 now)
+{
+	u64 max_idle = jiffies_to_nsecs(ctx->sq_thread_idle);
+	u64 gap = min(now - ctx->sq_last_ns, max_idle);
+	u64 idle;
+
+	ctx->sq_last_ns = now;
+	ctx->sq_gap_ns = (7 * ctx->sq_gap_ns + gap) / 8;
+
+	idle = 4 * ctx->sq_gap_ns;
+	if (idle > max_idle)
+		idle = 0;
+	ctx->sq_idle_ns = max(idle, max_idle / 16);
+}
+
+static u64 io_sqd_idle_ns(struct io_sq_data *sqd)
 {
 	struct io_ring_ctx *ctx;
-	unsigned sq_thread_idle = 0;
+	u64 idle = 0;
 
 	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
-		sq_thread_idle = max(sq_thread_idle, ctx->sq_thread_idle);
-	sqd->sq_thread_idle = sq_thread_idle;
+		idle = max(idle, ctx->sq_idle_ns);
+	return idle;
 }
 
 void io_sq_thread_finish(struct io_ring_ctx *ctx)
@@ -91,7 +118,6 @@ void io_sq_thread_finish(struct io_ring_ctx *ctx)
 	if (sqd) {
 		io_sq_thread_park(sqd);
 		list_del_init(&ctx->sqd_list);
-		io_sqd_update_thread_idle(sqd);
 		io_sq_thread_unpark(sqd);
 
 		io_put_sq_data(sqd);
@@ -166,13 +192,18 @@ static inline bool io_sqd_events_pending(struct io_sq_data *sqd)
 
 static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 {
-	unsigned int to_submit;
+	unsigned int to_submit, cap;
 	int ret = 0;
 
+	ctx->sq_polls++;
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	/*
+	 * if we're handling multiple rings, cap submit size for fairness,
+	 * in proportion to the weight of the ring
+	 */
+	cap = IORING_SQPOLL_CAP_ENTRIES_VALUE * READ_ONCE(ctx->sq_weight);
+	if (cap_entries && to_submit > cap)
+		to_submit = cap;
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -199,6 +230,13 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 			revert_creds(creds);
 	}
 
+	if (ret > 0) {
+		ctx->sq_submitted += ret;
+		io_sq_update_idle(ctx, ktime_get_ns());
+		if (ret >= IORING_SQPOLL_CAP_ENTRIES_VALUE)
+			cpufreq_util_hint(SCHED_CAPACITY_SCALE,
+					  IORING_SQPOLL_HINT_US);
+	}
 	return ret;
 }
 
@@ -222,7 +260,7 @@ static int io_sq_thread(void *data)
 {
 	struct io_sq_data *sqd = data;
 	struct io_ring_ctx *ctx;
-	unsigned long timeout = 0;
+	u64 timeout = 0;
 	char buf[TASK_COMM_LEN];
 	DEFINE_WAIT(wait);
 
@@ -242,7 +280,7 @@ static int io_sq_thread(void *data)
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = ktime_get_ns() + io_sqd_idle_ns(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
@@ -255,10 +293,10 @@ static int io_sq_thread(void *data)
 		if (io_run_task_work())
 			sqt_spin = true;
 
-		if (sqt_spin || !time_after(jiffies, timeout)) {
+		if (sqt_spin || ktime_get_ns() <= timeout) {
 			cond_resched();
 			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+				timeout = ktime_get_ns() + io_sqd_idle_ns(sqd);
 			continue;
 		}
 
@@ -288,9 +326,12 @@ static int io_sq_thread(void *data)
 			}
 
 			if (needs_sched) {
+				u64 start = ktime_get_ns();
+
 				mutex_unlock(&sqd->lock);
 				schedule();
 				mutex_lock(&sqd->lock);
+				sqd->idle_ns += ktime_get_ns() - start;
 			}
 			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
 				atomic_andnot(IORING_SQ_NEED_WAKEUP,
@@ -298,7 +339,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = ktime_get_ns() + io_sqd_idle_ns(sqd);
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -330,6 +371,21 @@ int io_sqpoll_wait_sq(struct io_ring_ctx *ctx)
 	return 0;
 }
 
+/*
+ * The weight scales the number of submissions taken from the ring at each
+ * pass of a shared SQPOLL thread, letting a ring get ahead of the others.
+ */
+int io_sqpoll_set_weight(struct io_ring_ctx *ctx, unsigned int weight)
+{
+	if (!(ctx->flags & IORING_SETUP_SQPOLL))
+		return -EINVAL;
+	if (!weight || weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+
+	WRITE_ONCE(ctx->sq_weight, weight);
+	return 0;
+}
+
 __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 				struct io_uring_params *p)
 {
@@ -369,10 +425,14 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_weight = 1;
+		/* spin for the whole idle period until submissions come in */
+		ctx->sq_idle_ns = jiffies_to_nsecs(ctx->sq_thread_idle);
+		ctx->sq_gap_ns = ctx->sq_idle_ns / 4;
+		ctx->sq_last_ns = ktime_get_ns();
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
-		io_sqd_update_thread_idle(sqd);
 		/* don't attach to a dying SQPOLL thread, would be racy */
 		ret = (attached && !sqd->thread) ? -ENXIO : 0;
 		io_sq_thread_unpark(sqd);
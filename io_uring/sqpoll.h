@@ -11,13 +11,15 @@ struct io_sq_data {
 	struct task_struct	*thread;
 	struct wait_queue_head	wait;
 
-	unsigned		sq_thread_idle;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
 
 	unsigned long		state;
 	struct completion	exited;
+
+	/* time the thread spent sleeping */
+	u64			idle_ns;
 };
 
 int io_sq_offload_create(struct io_ring_ctx *ctx, struct io_uring_params *p);
@@ -27,3 +29,4 @@ void io_sq_thread_park(struct io_sq_data *sqd);
 void io_sq_thread_unpark(struct io_sq_data *sqd);
 void io_put_sq_data(struct io_sq_data *sqd);
 int io_sqpoll_wait_sq(struct io_ring_ctx *ctx);
+int io_sqpoll_set_weight(struct io_ring_ctx *ctx, unsigned int weight);
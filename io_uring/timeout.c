@@ -483,7 +483,8 @@ static int __io_timeout_prep(struct io_kiocb *req,
 
 	if (WARN_ON_ONCE(req_has_async_data(req)))
 		return -EFAULT;
-	if (io_alloc_async_data(req))
+	/* prep runs under ->uring_lock */
+	if (io_alloc_cached_async_data(req, 0))
 		return -ENOMEM;
 
 	data = req->async_data;
@@ -425,6 +425,30 @@ static struct workqueue_struct *cpuset_migrate_mm_wq;
 static void cpuset_hotplug_workfn(struct work_struct *work);
 static DECLARE_WORK(cpuset_hotplug_work, cpuset_hotplug_workfn);
 
+/*
+ * The rebuilds of the sched domains requested while changing a cpuset are
+ * done once, at the end of the change.  The rebuild is skipped altogether
+ * when the partitioning of the domains turns out unchanged, which is the
+ * common case when resizing a cpuset which is not a partition root.  Both
+ * protected by cpuset_rwsem.
+ */
+static bool sched_domains_rebuild_pending;
+
+static struct sched_domains_stat {
+	u64 nr_rebuilds;	/* rebuilds done */
+	u64 nr_unchanged;	/* rebuilds skipped, domains unchanged */
+	u64 nr_coalesced;	/* requests merged into a pending rebuild */
+	u64 total_ns;		/* time spent in the rebuilds */
+	u64 max_ns;		/* longest rebuild */
+} sched_domains_stat;
+
+/*
+ * CPUs of the isolated partitions, also isolated from the housekeeping
+ * work, protected by callback_lock. The housekeeping update is done
+ * asynchronously as well.
+ */
+static cpumask_var_t isolated_cpus, isolated_cpus_tmp;
+
 static DECLARE_WAIT_QUEUE_HEAD(cpuset_attach_wq);
 
 static inline void check_insane_mems_config(nodemask_t *nodes)
@@ -1111,14 +1135,85 @@ static void rebuild_root_domains(void)
 	rcu_read_unlock();
 }
 
-static void
+/*
+ * Unless @force is set, leave the domains and their deadline accounting
+ * alone if @doms_new and @dattr_new match the current partitioning.
+ * Return whether the domains were rebuilt.
+ */
+static bool
 partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
-				    struct sched_domain_attr *dattr_new)
+				    struct sched_domain_attr *dattr_new,
+				    bool force)
 {
+	bool rebuilt = true;
+
 	mutex_lock(&sched_domains_mutex);
-	partition_sched_domains_locked(ndoms_new, doms_new, dattr_new);
-	rebuild_root_domains();
+	if (!force && sched_domains_unchanged_locked(ndoms_new, doms_new,
+						     dattr_new)) {
+		free_sched_domains(doms_new, ndoms_new);
+		kfree(dattr_new);
+		rebuilt = false;
+	} else {
+		partition_sched_domains_locked(ndoms_new, doms_new, dattr_new);
+		rebuild_root_domains();
+	}
 	mutex_unlock(&sched_domains_mutex);
+
+	return rebuilt;
+}
+
+static void cpuset_isolation_workfn(struct work_struct *work)
+{
+	cpumask_var_t isolated;
+	int ret;
+
+	if (!alloc_cpumask_var(&isolated, GFP_KERNEL))
+		return;
+
+	spin_lock_irq(&callback_lock);
+	cpumask_copy(isolated, isolated_cpus);
+	spin_unlock_irq(&callback_lock);
+
+	ret = housekeeping_update_isolated(isolated);
+	if (ret)
+		pr_warn("cpuset: failed to isolate CPUs %*pbl from housekeeping: %d\n",
+			cpumask_pr_args(isolated), ret);
+
+	free_cpumask_var(isolated);
+}
+
+static DECLARE_WORK(cpuset_isolation_work, cpuset_isolation_workfn);
+
+/*
+ * Track the CPUs of the isolated partitions. The housekeeping update
+ * sleeps and takes the CPU hotplug lock, it is done from a work item.
+ *
+ * Call with cpuset_rwsem held.
+ */
+static void update_isolated_cpus(void)
+{
+	struct cgroup_subsys_state *pos_css;
+	struct cpuset *cs;
+
+	percpu_rwsem_assert_held(&cpuset_rwsem);
+
+	cpumask_clear(isolated_cpus_tmp);
+	rcu_read_lock();
+	cpuset_for_each_descendant_pre(cs, pos_css, &top_cpuset) {
+		if (cs->partition_root_state == PRS_ISOLATED)
+			cpumask_or(isolated_cpus_tmp, isolated_cpus_tmp,
+				   cs->effective_cpus);
+	}
+	rcu_read_unlock();
+
+	if (cpumask_equal(isolated_cpus_tmp, isolated_cpus))
+		return;
+
+	spin_lock_irq(&callback_lock);
+	cpumask_copy(isolated_cpus, isolated_cpus_tmp);
+	spin_unlock_irq(&callback_lock);
+
+	queue_work(system_unbound_wq, &cpuset_isolation_work);
 }
 
 /*
@@ -1130,19 +1225,25 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
  * 'cpus' is removed, then call this routine to rebuild the
  * scheduler's dynamic sched domains.
  *
+ * Without @force, the domains aren't rebuilt if their partitioning
+ * doesn't change.
+ *
  * Call with cpuset_rwsem held.  Takes cpus_read_lock().
  */
-static void rebuild_sched_domains_locked(void)
+static void __rebuild_sched_domains_locked(bool force)
 {
 	struct cgroup_subsys_state *pos_css;
 	struct sched_domain_attr *attr;
 	cpumask_var_t *doms;
 	struct cpuset *cs;
+	u64 start, delta;
 	int ndoms;
 
 	lockdep_assert_cpus_held();
 	percpu_rwsem_assert_held(&cpuset_rwsem);
 
+	sched_domains_rebuild_pending = false;
+
 	/*
 	 * If we have raced with CPU hotplug, return early to avoid
 	 * passing doms with offlined cpu to partition_sched_domains().
@@ -1177,18 +1278,59 @@ static void rebuild_sched_domains_locked(void)
 		rcu_read_unlock();
 	}
 
+	start = ktime_get_ns();
+
 	/* Generate domain masks and attrs */
 	ndoms = generate_sched_domains(&doms, &attr);
 
 	/* Have scheduler rebuild the domains */
-	partition_and_rebuild_sched_domains(ndoms, doms, attr);
+	if (partition_and_rebuild_sched_domains(ndoms, doms, attr, force))
+		sched_domains_stat.nr_rebuilds++;
+	else
+		sched_domains_stat.nr_unchanged++;
+
+	update_isolated_cpus();
+
+	delta = ktime_get_ns() - start;
+	sched_domains_stat.total_ns += delta;
+	sched_domains_stat.max_ns = max(sched_domains_stat.max_ns, delta);
 }
 #else /* !CONFIG_SMP */
-static void rebuild_sched_domains_locked(void)
+static void __rebuild_sched_domains_locked(bool force)
 {
+	sched_domains_rebuild_pending = false;
 }
 #endif /* CONFIG_SMP */
 
+static void rebuild_sched_domains_locked(void)
+{
+	__rebuild_sched_domains_locked(true);
+}
+
+/*
+ * Request a rebuild of the sched domains, done by
+ * rebuild_sched_domains_pending() once the cpuset change is complete.
+ *
+ * Call with cpuset_rwsem held.
+ */
+static void request_rebuild_sched_domains(void)
+{
+	percpu_rwsem_assert_held(&cpuset_rwsem);
+
+	if (sched_domains_rebuild_pending)
+		sched_domains_stat.nr_coalesced++;
+	sched_domains_rebuild_pending = true;
+}
+
+/*
+ * Call with cpuset_rwsem held.  Takes cpus_read_lock().
+ */
+static void rebuild_sched_domains_pending(void)
+{
+	if (sched_domains_rebuild_pending)
+		__rebuild_sched_domains_locked(false);
+}
+
 void rebuild_sched_domains(void)
 {
 	cpus_read_lock();
@@ -1677,7 +1819,7 @@ static void update_cpumasks_hier(struct cpuset *cs, struct tmpmasks *tmp,
 	rcu_read_unlock();
 
 	if (need_rebuild_sched_domains)
-		rebuild_sched_domains_locked();
+		request_rebuild_sched_domains();
 }
 
 /**
@@ -2132,7 +2274,7 @@ static int update_relax_domain_level(struct cpuset *cs, s64 val)
 		cs->relax_domain_level = val;
 		if (!cpumask_empty(cs->cpus_allowed) &&
 		    is_sched_load_balance(cs))
-			rebuild_sched_domains_locked();
+			request_rebuild_sched_domains();
 	}
 
 	return 0;
@@ -2198,7 +2340,7 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	spin_unlock_irq(&callback_lock);
 
 	if (!cpumask_empty(trialcs->cpus_allowed) && balance_flag_changed)
-		rebuild_sched_domains_locked();
+		request_rebuild_sched_domains();
 
 	if (spread_flag_changed)
 		update_tasks_flags(cs);
@@ -2311,7 +2453,7 @@ static int update_prstate(struct cpuset *cs, int new_prs)
 		update_sibling_cpumasks(parent, cs, &tmpmask);
 
 	if (!sched_domain_rebuilt)
-		rebuild_sched_domains_locked();
+		request_rebuild_sched_domains();
 out:
 	/*
 	 * Make partition invalid if an error happen
@@ -2578,6 +2720,7 @@ typedef enum {
 	FILE_EFFECTIVE_CPULIST,
 	FILE_EFFECTIVE_MEMLIST,
 	FILE_SUBPARTS_CPULIST,
+	FILE_ISOLATED_CPULIST,
 	FILE_CPU_EXCLUSIVE,
 	FILE_MEM_EXCLUSIVE,
 	FILE_MEM_HARDWALL,
@@ -2633,6 +2776,7 @@ static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
 		retval = -EINVAL;
 		break;
 	}
+	rebuild_sched_domains_pending();
 out_unlock:
 	percpu_up_write(&cpuset_rwsem);
 	cpus_read_unlock();
@@ -2659,6 +2803,7 @@ static int cpuset_write_s64(struct cgroup_subsys_state *css, struct cftype *cft,
 		retval = -EINVAL;
 		break;
 	}
+	rebuild_sched_domains_pending();
 out_unlock:
 	percpu_up_write(&cpuset_rwsem);
 	cpus_read_unlock();
@@ -2724,6 +2869,7 @@ static ssize_t cpuset_write_resmask(struct kernfs_open_file *of,
 	}
 
 	free_cpuset(trialcs);
+	rebuild_sched_domains_pending();
 out_unlock:
 	percpu_up_write(&cpuset_rwsem);
 	cpus_read_unlock();
@@ -2765,6 +2911,9 @@ static int cpuset_common_seq_show(struct seq_file *sf, void *v)
 	case FILE_SUBPARTS_CPULIST:
 		seq_printf(sf, "%*pbl\n", cpumask_pr_args(cs->subparts_cpus));
 		break;
+	case FILE_ISOLATED_CPULIST:
+		seq_printf(sf, "%*pbl\n", cpumask_pr_args(isolated_cpus));
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -2878,6 +3027,7 @@ static ssize_t sched_partition_write(struct kernfs_open_file *of, char *buf,
 		goto out_unlock;
 
 	retval = update_prstate(cs, val);
+	rebuild_sched_domains_pending();
 out_unlock:
 	percpu_up_write(&cpuset_rwsem);
 	cpus_read_unlock();
@@ -2885,6 +3035,25 @@ static ssize_t sched_partition_write(struct kernfs_open_file *of, char *buf,
 	return retval ?: nbytes;
 }
 
+static int sched_domains_stat_show(struct seq_file *seq, void *v)
+{
+	struct sched_domains_stat stat;
+
+	percpu_down_read(&cpuset_rwsem);
+	stat = sched_domains_stat;
+	percpu_up_read(&cpuset_rwsem);
+
+	seq_printf(seq, "nr_rebuilds %llu\n"
+		   "nr_unchanged %llu\n"
+		   "nr_coalesced %llu\n"
+		   "total_usec %llu\n"
+		   "max_usec %llu\n",
+		   stat.nr_rebuilds, stat.nr_unchanged, stat.nr_coalesced,
+		   div_u64(stat.total_ns, NSEC_PER_USEC),
+		   div_u64(stat.max_ns, NSEC_PER_USEC));
+	return 0;
+}
+
 /*
  * for the common functions, 'private' gives the type of file
  */
@@ -2988,6 +3157,12 @@ static struct cftype legacy_files[] = {
 		.private = FILE_MEMORY_PRESSURE_ENABLED,
 	},
 
+	{
+		.name = "sched_domains.stat",
+		.seq_show = sched_domains_stat_show,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+
 	{ }	/* terminate */
 };
 
@@ -3042,6 +3217,19 @@ static struct cftype dfl_files[] = {
 		.flags = CFTYPE_DEBUG,
 	},
 
+	{
+		.name = "cpus.isolated",
+		.seq_show = cpuset_common_seq_show,
+		.private = FILE_ISOLATED_CPULIST,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+
+	{
+		.name = "sched_domains.stat",
+		.seq_show = sched_domains_stat_show,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+
 	{ }	/* terminate */
 };
 
@@ -3180,6 +3368,8 @@ static void cpuset_css_offline(struct cgroup_subsys_state *css)
 		parent->child_ecpus_count--;
 	}
 
+	rebuild_sched_domains_pending();
+
 	cpuset_dec();
 	clear_bit(CS_ONLINE, &cs->flags);
 
@@ -3267,6 +3457,8 @@ int __init cpuset_init(void)
 	top_cpuset.relax_domain_level = -1;
 
 	BUG_ON(!alloc_cpumask_var(&cpus_attach, GFP_KERNEL));
+	BUG_ON(!zalloc_cpumask_var(&isolated_cpus, GFP_KERNEL));
+	BUG_ON(!alloc_cpumask_var(&isolated_cpus_tmp, GFP_KERNEL));
 
 	return 0;
 }
@@ -3678,6 +3870,40 @@ void cpuset_cpus_allowed(struct task_struct *tsk, struct cpumask *pmask)
 	spin_unlock_irqrestore(&callback_lock, flags);
 }
 
+/**
+ * cpuset_cgroup_fd_cpus - return the effective cpus of a cpuset cgroup.
+ * @fd: file descriptor of the cgroup directory
+ * @pmask: pointer to struct cpumask variable to receive the effective cpus.
+ *
+ * Description: Looks up the cgroup @fd refers to and copies the
+ * effective_cpus of its cpuset to @pmask. The mask may contain cpus that
+ * go offline as soon as callback_lock is dropped, callers that care must
+ * hold the cpu hotplug lock.
+ *
+ * Returns 0 on success, or the error of cgroup_get_from_fd().
+ **/
+
+int cpuset_cgroup_fd_cpus(int fd, struct cpumask *pmask)
+{
+	struct cgroup_subsys_state *css;
+	struct cgroup *cgrp;
+	unsigned long flags;
+
+	cgrp = cgroup_get_from_fd(fd);
+	if (IS_ERR(cgrp))
+		return PTR_ERR(cgrp);
+
+	css = cgroup_get_e_css(cgrp, &cpuset_cgrp_subsys);
+	cgroup_put(cgrp);
+
+	spin_lock_irqsave(&callback_lock, flags);
+	cpumask_copy(pmask, css_cs(css)->effective_cpus);
+	spin_unlock_irqrestore(&callback_lock, flags);
+
+	css_put(css);
+	return 0;
+}
+
 /**
  * cpuset_cpus_allowed_fallback - final fallback before complete catastrophe.
  * @tsk: pointer to task_struct with which the scheduler is struggling
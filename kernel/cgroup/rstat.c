@@ -1,15 +1,25 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include "cgroup-internal.h"
 
+#include <linux/sched/clock.h>
 #include <linux/sched/cputime.h>
 
 #include <linux/bpf.h>
 #include <linux/btf.h>
 #include <linux/btf_ids.h>
 
+#include <trace/events/cgroup.h>
+
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * The cgroup whose subtree is being flushed.  Set under cgroup_rstat_lock
+ * by the first of the concurrent flushes and cleared, with its
+ * ->rstat_flush_done completed, at the end of that flush.
+ */
+static struct cgroup *cgroup_rstat_ongoing_flusher;
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -170,14 +180,54 @@ __weak noinline void bpf_rstat_flush(struct cgroup *cgrp,
 
 __diag_pop();
 
+/**
+ * cgroup_rstat_flush_ongoing - find an ongoing flush covering a cgroup
+ * @cgrp: target cgroup
+ *
+ * Return: the cgroup being flushed if @cgrp is in its subtree, %NULL
+ * otherwise.  As an ancestor of @cgrp, the returned cgroup stays
+ * accessible as long as @cgrp is.
+ */
+static struct cgroup *cgroup_rstat_flush_ongoing(struct cgroup *cgrp)
+{
+	struct cgroup *ongoing;
+
+	/* the cgroups are freed after a grace period */
+	rcu_read_lock();
+	ongoing = READ_ONCE(cgroup_rstat_ongoing_flusher);
+	if (ongoing && !cgroup_is_descendant(cgrp, ongoing))
+		ongoing = NULL;
+	rcu_read_unlock();
+
+	return ongoing;
+}
+
 /* see cgroup_rstat_flush() */
 static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 	__releases(&cgroup_rstat_lock) __acquires(&cgroup_rstat_lock)
 {
+	unsigned int nr_flushed = 0;
+	bool ongoing = false;
+	u64 start = 0;
 	int cpu;
 
 	lockdep_assert_held(&cgroup_rstat_lock);
 
+	if (trace_cgroup_rstat_flush_enabled())
+		start = local_clock();
+
+	/*
+	 * Let the flushes of @cgrp's subtree issued from now on wait for this
+	 * one instead of contending on cgroup_rstat_lock.  The lock may be
+	 * dropped below, a flush getting it then leaves the ongoing flush as
+	 * it is.
+	 */
+	if (!cgroup_rstat_ongoing_flusher) {
+		reinit_completion(&cgrp->rstat_flush_done);
+		smp_store_release(&cgroup_rstat_ongoing_flusher, cgrp);
+		ongoing = true;
+	}
+
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
@@ -198,6 +248,7 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 
 			cgroup_base_stat_flush(pos, cpu);
 			bpf_rstat_flush(pos, cgroup_parent(pos), cpu);
+			nr_flushed++;
 
 			rcu_read_lock();
 			list_for_each_entry_rcu(css, &pos->rstat_css_list,
@@ -216,6 +267,15 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 			spin_lock_irq(&cgroup_rstat_lock);
 		}
 	}
+
+	if (ongoing) {
+		WRITE_ONCE(cgroup_rstat_ongoing_flusher, NULL);
+		complete_all(&cgrp->rstat_flush_done);
+	}
+
+	if (trace_cgroup_rstat_flush_enabled())
+		trace_cgroup_rstat_flush(cgrp, nr_flushed,
+					 local_clock() - start, ongoing);
 }
 
 /**
@@ -229,12 +289,29 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
  * This also gets all cgroups in the subtree including @cgrp off the
  * ->updated_children lists.
  *
+ * If the subtree of an ongoing flush covers @cgrp, this function waits for
+ * that flush instead of running its own.  The stats may then miss the
+ * updates made on the cpus the ongoing flush had already gone through,
+ * like they miss the updates racing with any flush.
+ *
  * This function may block.
  */
 void cgroup_rstat_flush(struct cgroup *cgrp)
 {
+	struct cgroup *ongoing;
+	u64 start;
+
 	might_sleep();
 
+	ongoing = cgroup_rstat_flush_ongoing(cgrp);
+	if (ongoing) {
+		start = local_clock();
+		wait_for_completion(&ongoing->rstat_flush_done);
+		trace_cgroup_rstat_flush_wait(cgrp, ongoing,
+					      local_clock() - start);
+		return;
+	}
+
 	spin_lock_irq(&cgroup_rstat_lock);
 	cgroup_rstat_flush_locked(cgrp, true);
 	spin_unlock_irq(&cgroup_rstat_lock);
@@ -244,12 +321,20 @@ void cgroup_rstat_flush(struct cgroup *cgrp)
  * cgroup_rstat_flush_irqsafe - irqsafe version of cgroup_rstat_flush()
  * @cgrp: target cgroup
  *
- * This function can be called from any context.
+ * This function can be called from any context.  It can't wait for an
+ * ongoing flush covering @cgrp, and returns without flushing instead.
  */
 void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
 {
+	struct cgroup *ongoing;
 	unsigned long flags;
 
+	ongoing = cgroup_rstat_flush_ongoing(cgrp);
+	if (ongoing) {
+		trace_cgroup_rstat_flush_wait(cgrp, ongoing, 0);
+		return;
+	}
+
 	spin_lock_irqsave(&cgroup_rstat_lock, flags);
 	cgroup_rstat_flush_locked(cgrp, false);
 	spin_unlock_irqrestore(&cgroup_rstat_lock, flags);
@@ -292,6 +377,8 @@ int cgroup_rstat_init(struct cgroup *cgrp)
 			return -ENOMEM;
 	}
 
+	init_completion(&cgrp->rstat_flush_done);
+
 	/* ->updated_children list is self terminated */
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
@@ -307,7 +394,10 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 {
 	int cpu;
 
-	cgroup_rstat_flush(cgrp);
+	/* an ongoing flush may leave @cgrp on the updated lists, don't wait */
+	spin_lock_irq(&cgroup_rstat_lock);
+	cgroup_rstat_flush_locked(cgrp, true);
+	spin_unlock_irq(&cgroup_rstat_lock);
 
 	/* sanity check */
 	for_each_possible_cpu(cpu) {
@@ -79,6 +79,10 @@ static void em_debug_create_pd(struct device *dev)
 	debugfs_create_file("flags", 0444, d, dev->em_pd,
 			    &em_debug_flags_fops);
 
+	if (em_is_accel(dev->em_pd))
+		debugfs_create_ulong("wake_energy", 0444, d,
+				     &dev->em_pd->wake_energy);
+
 	/* Create a sub-directory for each performance state */
 	for (i = 0; i < dev->em_pd->nr_perf_states; i++)
 		em_debug_create_ps(&dev->em_pd->table[i], d);
@@ -314,35 +318,14 @@ struct em_perf_domain *em_cpu_get(int cpu)
 }
 EXPORT_SYMBOL_GPL(em_cpu_get);
 
-/**
- * em_dev_register_perf_domain() - Register the Energy Model (EM) for a device
- * @dev		: Device for which the EM is to register
- * @nr_states	: Number of performance states to register
- * @cb		: Callback functions providing the data of the Energy Model
- * @cpus	: Pointer to cpumask_t, which in case of a CPU device is
- *		obligatory. It can be taken from i.e. 'policy->cpus'. For other
- *		type of devices this should be set to NULL.
- * @microwatts	: Flag indicating that the power values are in micro-Watts or
- *		in some other scale. It must be set properly.
- *
- * Create Energy Model tables for a performance domain using the callbacks
- * defined in cb.
- *
- * The @microwatts is important to set with correct value. Some kernel
- * sub-systems might rely on this flag and check if all devices in the EM are
- * using the same scale.
- *
- * If multiple clients register the same performance domain, all but the first
- * registration will be ignored.
- *
- * Return 0 on success
- */
-int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
-				struct em_data_callback *cb, cpumask_t *cpus,
-				bool microwatts)
+static int __em_dev_register_perf_domain(struct device *dev,
+					 unsigned int nr_states,
+					 struct em_data_callback *cb,
+					 cpumask_t *cpus, bool microwatts,
+					 unsigned long flags,
+					 unsigned long wake_energy)
 {
 	unsigned long cap, prev_cap = 0;
-	unsigned long flags = 0;
 	int cpu, ret;
 
 	if (!dev || !nr_states || !cb)
@@ -399,6 +382,7 @@ int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 		goto unlock;
 
 	dev->em_pd->flags |= flags;
+	dev->em_pd->wake_energy = wake_energy;
 
 	em_cpufreq_update_efficiencies(dev);
 
@@ -409,8 +393,106 @@ int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 	mutex_unlock(&em_pd_mutex);
 	return ret;
 }
+
+/**
+ * em_dev_register_perf_domain() - Register the Energy Model (EM) for a device
+ * @dev		: Device for which the EM is to register
+ * @nr_states	: Number of performance states to register
+ * @cb		: Callback functions providing the data of the Energy Model
+ * @cpus	: Pointer to cpumask_t, which in case of a CPU device is
+ *		obligatory. It can be taken from i.e. 'policy->cpus'. For other
+ *		type of devices this should be set to NULL.
+ * @microwatts	: Flag indicating that the power values are in micro-Watts or
+ *		in some other scale. It must be set properly.
+ *
+ * Create Energy Model tables for a performance domain using the callbacks
+ * defined in cb.
+ *
+ * The @microwatts is important to set with correct value. Some kernel
+ * sub-systems might rely on this flag and check if all devices in the EM are
+ * using the same scale.
+ *
+ * If multiple clients register the same performance domain, all but the first
+ * registration will be ignored.
+ *
+ * Return 0 on success
+ */
+int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
+				struct em_data_callback *cb, cpumask_t *cpus,
+				bool microwatts)
+{
+	return __em_dev_register_perf_domain(dev, nr_states, cb, cpus,
+					     microwatts, 0, 0);
+}
 EXPORT_SYMBOL_GPL(em_dev_register_perf_domain);
 
+/**
+ * em_dev_register_accel_perf_domain() - Register the Energy Model (EM) of an
+ *		accelerator
+ * @dev		: Accelerator device, e.g. a remote processor or a
+ *		programmable logic engine, but not a CPU
+ * @nr_states	: Number of performance states to register
+ * @cb		: Callback functions providing the data of the Energy Model
+ * @wake_energy	: Energy spent powering up @dev for a piece of work, in
+ *		nano-Joules if @microwatts is set, in the scale of the power
+ *		values multiplied by the milli-seconds otherwise
+ * @microwatts	: Flag indicating that the power values are in micro-Watts or
+ *		in some other scale. It must be set properly.
+ *
+ * Create the Energy Model tables of a device work can be offloaded to. The
+ * frequencies of the table are the ones the accelerator counts its work in,
+ * which lets em_dev_work_energy() compare it with the CPUs.
+ *
+ * Return 0 on success
+ */
+int em_dev_register_accel_perf_domain(struct device *dev,
+				      unsigned int nr_states,
+				      struct em_data_callback *cb,
+				      unsigned long wake_energy,
+				      bool microwatts)
+{
+	if (!dev || _is_cpu_device(dev))
+		return -EINVAL;
+
+	return __em_dev_register_perf_domain(dev, nr_states, cb, NULL,
+					     microwatts, EM_PERF_DOMAIN_ACCEL,
+					     wake_energy);
+}
+EXPORT_SYMBOL_GPL(em_dev_register_accel_perf_domain);
+
+/**
+ * em_dev_work_energy() - Estimate the energy of running a piece of work on a
+ *		device
+ * @dev		: Device running the work, a CPU or an accelerator
+ * @freq	: Lowest frequency in kHz of @dev meeting the deadline of the
+ *		work
+ * @cycles	: Length of the work, in cycles of @dev
+ * @powered	: Whether @dev is already powered up
+ *
+ * Lets the drivers offloading work choose the cheaper of the CPUs and the
+ * accelerators. The energy of an accelerator which is powered off includes
+ * the energy of waking it up, a CPU is assumed to be running already.
+ *
+ * Return: the energy of the work in the scale of em_pd_work_energy(), or
+ * U64_MAX if @dev has no Energy Model.
+ */
+u64 em_dev_work_energy(struct device *dev, unsigned long freq, u64 cycles,
+		       bool powered)
+{
+	struct em_perf_domain *pd = em_pd_get(dev);
+	u64 energy;
+
+	if (!pd)
+		return U64_MAX;
+
+	energy = em_pd_work_energy(pd, freq, cycles);
+	if (em_is_accel(pd) && !powered)
+		energy += pd->wake_energy;
+
+	return energy;
+}
+EXPORT_SYMBOL_GPL(em_dev_work_energy);
+
 /**
  * em_dev_unregister_perf_domain() - Unregister Energy Model (EM) for a device
  * @dev		: Device for which the EM is registered
@@ -28,7 +28,9 @@
 #include <linux/gfp.h>
 #include <linux/syscore_ops.h>
 #include <linux/ctype.h>
+#include <linux/crypto.h>
 #include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/security.h>
 #include <linux/secretmem.h>
 #include <trace/events/power.h>
@@ -46,6 +48,91 @@ dev_t swsusp_resume_device;
 sector_t swsusp_resume_block;
 __visible int in_suspend __nosavedata;
 
+/* Compressors of the image, recorded in its header by an SF_ flag */
+static const struct {
+	const char *name;
+	unsigned int flag;
+} hib_compressors[] = {
+	{ "lzo",	0 },
+	{ "lz4",	SF_COMPRESSION_ALG_LZ4 },
+	{ "zstd",	SF_COMPRESSION_ALG_ZSTD },
+};
+
+static const char *hib_comp_name = CONFIG_HIBERNATION_DEF_COMP;
+
+static int hibernate_compressor_set(const char *val,
+				    const struct kernel_param *kp)
+{
+	unsigned int sleep_flags, i;
+	const char *name;
+
+	for (i = 0; i < ARRAY_SIZE(hib_compressors); i++) {
+		name = hib_compressors[i].name;
+		if (!sysfs_streq(val, name))
+			continue;
+
+		/* No crypto algorithm is registered yet at early boot */
+		if (system_state == SYSTEM_RUNNING &&
+		    !crypto_has_comp(name, 0, 0))
+			return -ENOENT;
+
+		sleep_flags = lock_system_sleep();
+		hib_comp_name = name;
+		unlock_system_sleep(sleep_flags);
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+static int hibernate_compressor_get(char *buffer,
+				    const struct kernel_param *kp)
+{
+	return scnprintf(buffer, PAGE_SIZE, "%s\n", hib_comp_name);
+}
+
+static const struct kernel_param_ops hibernate_compressor_ops = {
+	.set	= hibernate_compressor_set,
+	.get	= hibernate_compressor_get,
+};
+module_param_cb(compressor, &hibernate_compressor_ops, NULL, 0644);
+MODULE_PARM_DESC(compressor,
+		 "Compressor of the hibernation image: lzo, lz4 or zstd (default: " CONFIG_HIBERNATION_DEF_COMP ")");
+
+unsigned int hib_comp_threads;
+module_param_named(compression_threads, hib_comp_threads, uint, 0644);
+MODULE_PARM_DESC(compression_threads,
+		 "Number of threads compressing and decompressing the image (default: 0, one per CPU but one)");
+
+static unsigned int hibernate_comp_flag(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(hib_compressors); i++)
+		if (!strcmp(hib_compressors[i].name, hib_comp_name))
+			return hib_compressors[i].flag;
+
+	return 0;
+}
+
+/**
+ * hibernate_comp_algo - Name of the compressor of a hibernation image.
+ * @flags: Flags of the image header.
+ *
+ * Return: the crypto API name of the compressor, NULL if it is unknown.
+ */
+const char *hibernate_comp_algo(unsigned int flags)
+{
+	unsigned int i;
+
+	flags &= SF_COMPRESSION_ALG_LZ4 | SF_COMPRESSION_ALG_ZSTD;
+	for (i = 0; i < ARRAY_SIZE(hib_compressors); i++)
+		if (hib_compressors[i].flag == flags)
+			return hib_compressors[i].name;
+
+	return NULL;
+}
+
 enum {
 	HIBERNATION_INVALID,
 	HIBERNATION_PLATFORM,
@@ -762,7 +849,7 @@ int hibernate(void)
 		if (nocompress)
 			flags |= SF_NOCOMPRESS_MODE;
 		else
-		        flags |= SF_CRC32_MODE;
+		        flags |= SF_CRC32_MODE | hibernate_comp_flag();
 
 		pm_pr_dbg("Writing hibernation image.\n");
 		error = swsusp_write(flags);
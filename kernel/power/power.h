@@ -171,6 +171,8 @@ extern int swsusp_swap_in_use(void);
 #define SF_NOCOMPRESS_MODE	2
 #define SF_CRC32_MODE	        4
 #define SF_HW_SIG		8
+#define SF_COMPRESSION_ALG_LZ4	16
+#define SF_COMPRESSION_ALG_ZSTD	32
 
 /* kernel/power/hibernate.c */
 extern int swsusp_check(void);
@@ -178,6 +180,8 @@ extern void swsusp_free(void);
 extern int swsusp_read(unsigned int *flags_p);
 extern int swsusp_write(unsigned int flags);
 extern void swsusp_close(fmode_t);
+extern const char *hibernate_comp_algo(unsigned int flags);
+extern unsigned int hib_comp_threads;
 #ifdef CONFIG_SUSPEND
 extern int swsusp_unmark(void);
 #endif
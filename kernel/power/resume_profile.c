@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Device resume time profile
+ *
+ * Records the duration of the resume callbacks the devices run during the
+ * last system resume and lists the slowest ones in
+ * /sys/kernel/debug/resume_profile, telling whether each device resumed
+ * asynchronously. Comparing the sum of the callback durations with the span
+ * from the first callback to the last shows how much the asynchronous
+ * callbacks overlapped.
+ */
+
+#define pr_fmt(fmt) "PM: " fmt
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
+#include <linux/timekeeping.h>
+#include <trace/events/power.h>
+
+#define RESUME_PROFILE_SLOTS	16
+
+#define PM_EVENT_RESUME_MASK	(PM_EVENT_RESUME | PM_EVENT_THAW | \
+				 PM_EVENT_RESTORE | PM_EVENT_RECOVER)
+
+struct resume_profile_entry {
+	char device[32];
+	char driver[24];
+	const char *pm_ops;
+	u64 duration;
+	bool async;
+};
+
+/* Protected by resume_profile_lock */
+static struct {
+	struct resume_profile_entry slowest[RESUME_PROFILE_SLOTS];
+	unsigned int nr_slowest;
+	unsigned int nr_callbacks;
+	u64 total;
+	u64 first_start;
+	u64 last_end;
+} resume_profile;
+
+static DEFINE_SPINLOCK(resume_profile_lock);
+
+static void resume_profile_cb_start(void *data, struct device *dev,
+				    const char *pm_ops, int event)
+{
+	if (!(event & PM_EVENT_RESUME_MASK)) {
+		dev->power.resume_start = 0;
+		return;
+	}
+
+	dev->power.resume_ops = pm_ops;
+	dev->power.resume_start = ktime_get_ns();
+}
+
+static void resume_profile_cb_end(void *data, struct device *dev, int error)
+{
+	struct resume_profile_entry *entry;
+	u64 start = dev->power.resume_start;
+	u64 now, duration;
+	unsigned long flags;
+	int i;
+
+	if (!start)
+		return;
+
+	dev->power.resume_start = 0;
+	now = ktime_get_ns();
+	duration = now - start;
+
+	spin_lock_irqsave(&resume_profile_lock, flags);
+
+	if (!resume_profile.first_start || start < resume_profile.first_start)
+		resume_profile.first_start = start;
+	if (now > resume_profile.last_end)
+		resume_profile.last_end = now;
+	resume_profile.nr_callbacks++;
+	resume_profile.total += duration;
+
+	/* Keep the slowest callbacks sorted by decreasing duration */
+	for (i = resume_profile.nr_slowest; i > 0; i--)
+		if (resume_profile.slowest[i - 1].duration >= duration)
+			break;
+	if (i == RESUME_PROFILE_SLOTS)
+		goto unlock;
+
+	if (resume_profile.nr_slowest < RESUME_PROFILE_SLOTS)
+		resume_profile.nr_slowest++;
+	memmove(&resume_profile.slowest[i + 1], &resume_profile.slowest[i],
+		(resume_profile.nr_slowest - i - 1) * sizeof(*entry));
+
+	entry = &resume_profile.slowest[i];
+	strscpy(entry->device, dev_name(dev), sizeof(entry->device));
+	strscpy(entry->driver, dev_driver_string(dev), sizeof(entry->driver));
+	entry->pm_ops = dev->power.resume_ops ?: "none ";
+	entry->duration = duration;
+	entry->async = dev->power.async_suspend;
+
+unlock:
+	spin_unlock_irqrestore(&resume_profile_lock, flags);
+}
+
+static int resume_profile_pm_notify(struct notifier_block *nb,
+				    unsigned long action, void *data)
+{
+	unsigned long flags;
+
+	switch (action) {
+	case PM_SUSPEND_PREPARE:
+	case PM_HIBERNATION_PREPARE:
+		spin_lock_irqsave(&resume_profile_lock, flags);
+		memset(&resume_profile, 0, sizeof(resume_profile));
+		spin_unlock_irqrestore(&resume_profile_lock, flags);
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block resume_profile_pm_nb = {
+	.notifier_call = resume_profile_pm_notify,
+};
+
+static int resume_profile_show(struct seq_file *s, void *unused)
+{
+	struct resume_profile_entry *entry;
+	unsigned int i;
+
+	spin_lock_irq(&resume_profile_lock);
+
+	seq_printf(s, "callbacks: %u\ntotal_us: %llu\nspan_us: %llu\n",
+		   resume_profile.nr_callbacks,
+		   div_u64(resume_profile.total, NSEC_PER_USEC),
+		   div_u64(resume_profile.last_end - resume_profile.first_start,
+			   NSEC_PER_USEC));
+
+	seq_puts(s, "slowest:\n");
+	for (i = 0; i < resume_profile.nr_slowest; i++) {
+		entry = &resume_profile.slowest[i];
+		seq_printf(s, "  %10llu us  %s %s, %s[%s]\n",
+			   div_u64(entry->duration, NSEC_PER_USEC),
+			   entry->driver, entry->device, entry->pm_ops,
+			   entry->async ? "async" : "sync");
+	}
+
+	spin_unlock_irq(&resume_profile_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(resume_profile);
+
+static int __init resume_profile_init(void)
+{
+	int ret;
+
+	ret = register_trace_device_pm_callback_start(resume_profile_cb_start,
+						      NULL);
+	if (ret)
+		goto err;
+
+	ret = register_trace_device_pm_callback_end(resume_profile_cb_end,
+						    NULL);
+	if (ret)
+		goto err_start;
+
+	register_pm_notifier(&resume_profile_pm_nb);
+	debugfs_create_file("resume_profile", 0444, NULL, NULL,
+			    &resume_profile_fops);
+
+	return 0;
+
+err_start:
+	unregister_trace_device_pm_callback_start(resume_profile_cb_start,
+						  NULL);
+err:
+	pr_warn("resume profile unavailable: %d\n", ret);
+	return ret;
+}
+late_initcall(resume_profile_init);
@@ -2053,6 +2053,8 @@ static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 
 	if (!(flags & ENQUEUE_RESTORE)) {
 		sched_info_enqueue(rq, p);
+		if (flags & ENQUEUE_WAKEUP)
+			sched_info_wakeup(p);
 		psi_enqueue(p, flags & ENQUEUE_WAKEUP);
 	}
 
@@ -3795,6 +3797,7 @@ bool cpus_share_cache(int this_cpu, int that_cpu)
 
 	return per_cpu(sd_llc_id, this_cpu) == per_cpu(sd_llc_id, that_cpu);
 }
+EXPORT_SYMBOL_GPL(cpus_share_cache);
 
 static inline bool ttwu_queue_cond(struct task_struct *p, int cpu)
 {
@@ -4587,6 +4590,9 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		} else if (PRIO_TO_NICE(p->static_prio) < 0)
 			p->static_prio = NICE_TO_PRIO(0);
 
+		if (p->se.latency_nice < 0)
+			p->se.latency_nice = 0;
+
 		p->prio = p->normal_prio = p->static_prio;
 		set_load_weight(p, false);
 
@@ -7351,6 +7357,13 @@ static void __setscheduler_params(struct task_struct *p,
 	set_load_weight(p, true);
 }
 
+static void __setscheduler_latency(struct task_struct *p,
+				   const struct sched_attr *attr)
+{
+	if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE)
+		p->se.latency_nice = attr->sched_latency_nice;
+}
+
 /*
  * Check the target process has a UID that matches the current process's:
  */
@@ -7382,6 +7395,11 @@ static int user_check_sched_setscheduler(struct task_struct *p,
 			goto req_priv;
 	}
 
+	/* Can't lower the latency nice value: */
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    attr->sched_latency_nice < p->se.latency_nice)
+		goto req_priv;
+
 	if (rt_policy(policy)) {
 		unsigned long rlim_rtprio = task_rlimit(p, RLIMIT_RTPRIO);
 
@@ -7471,6 +7489,11 @@ static int __sched_setscheduler(struct task_struct *p,
 	    (rt_policy(policy) != (attr->sched_priority != 0)))
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    (attr->sched_latency_nice < MIN_LATENCY_NICE ||
+	     attr->sched_latency_nice > MAX_LATENCY_NICE))
+		return -EINVAL;
+
 	if (user) {
 		retval = user_check_sched_setscheduler(p, attr, policy, reset_on_fork);
 		if (retval)
@@ -7525,6 +7548,9 @@ static int __sched_setscheduler(struct task_struct *p,
 			goto change;
 		if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP)
 			goto change;
+		if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+		    attr->sched_latency_nice != p->se.latency_nice)
+			goto change;
 
 		p->sched_reset_on_fork = reset_on_fork;
 		retval = 0;
@@ -7614,6 +7640,7 @@ static int __sched_setscheduler(struct task_struct *p,
 		__setscheduler_prio(p, newprio);
 	}
 	__setscheduler_uclamp(p, attr);
+	__setscheduler_latency(p, attr);
 
 	if (queued) {
 		/*
@@ -7823,6 +7850,10 @@ static int sched_copy_attr(struct sched_attr __user *uattr, struct sched_attr *a
 	    size < SCHED_ATTR_SIZE_VER1)
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    size < SCHED_ATTR_SIZE_VER2)
+		return -EINVAL;
+
 	/*
 	 * XXX: Do we want to be lenient like existing syscalls; or do we want
 	 * to be strict and return an error on out-of-bounds values?
@@ -8069,6 +8100,7 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	kattr.sched_util_min = p->uclamp_req[UCLAMP_MIN].value;
 	kattr.sched_util_max = p->uclamp_req[UCLAMP_MAX].value;
 #endif
+	kattr.sched_latency_nice = p->se.latency_nice;
 
 	rcu_read_unlock();
 
@@ -9624,6 +9656,10 @@ int in_sched_functions(unsigned long addr)
 struct task_group root_task_group;
 LIST_HEAD(task_groups);
 
+#ifdef CONFIG_SCHED_INFO
+static DEFINE_PER_CPU(struct sched_wakeup_hist, root_wakeup_hist);
+#endif
+
 /* Cacheline aligned slab cache for task_group */
 static struct kmem_cache *task_group_cache __read_mostly;
 #endif
@@ -9689,6 +9725,9 @@ void __init sched_init(void)
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
+#ifdef CONFIG_SCHED_INFO
+	root_task_group.wakeup_hist = &root_wakeup_hist;
+#endif
 	autogroup_init(&init_task);
 #endif /* CONFIG_CGROUP_SCHED */
 
@@ -9703,6 +9742,7 @@ void __init sched_init(void)
 		init_cfs_rq(&rq->cfs);
 		init_rt_rq(&rq->rt);
 		init_dl_rq(&rq->dl);
+		fair_server_init(rq);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
 		rq->tmp_alone_branch = &rq->leaf_cfs_rq_list;
@@ -10079,6 +10119,10 @@ static inline void alloc_uclamp_sched_group(struct task_group *tg,
 
 static void sched_free_group(struct task_group *tg)
 {
+	sched_core_cgroup_free(tg);
+#ifdef CONFIG_SCHED_INFO
+	free_percpu(tg->wakeup_hist);
+#endif
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
 	autogroup_free(tg);
@@ -10116,6 +10160,12 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+#ifdef CONFIG_SCHED_INFO
+	tg->wakeup_hist = alloc_percpu(struct sched_wakeup_hist);
+	if (!tg->wakeup_hist)
+		goto err;
+#endif
+
 	alloc_uclamp_sched_group(tg, parent);
 
 	return tg;
@@ -10323,8 +10373,12 @@ static void cpu_cgroup_attach(struct cgroup_taskset *tset)
 	struct task_struct *task;
 	struct cgroup_subsys_state *css;
 
-	cgroup_taskset_for_each(task, css, tset)
+	cgroup_taskset_for_each(task, css, tset) {
+		struct task_group *from = task_group(task);
+
 		sched_move_task(task);
+		sched_core_cgroup_attach(task, from);
+	}
 }
 
 #ifdef CONFIG_UCLAMP_TASK_GROUP
@@ -10883,6 +10937,57 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 {
 	return sched_group_set_idle(css_tg(css), idle);
 }
+
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return css_tg(css)->latency_nice;
+}
+
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, s64 nice)
+{
+	return sched_group_set_latency(css_tg(css), nice);
+}
+#endif
+
+#ifdef CONFIG_SCHED_CORE
+static u64 cpu_core_tag_read_u64(struct cgroup_subsys_state *css,
+				 struct cftype *cft)
+{
+	return sched_core_cgroup_tag_read(css_tg(css));
+}
+
+static int cpu_core_tag_write_u64(struct cgroup_subsys_state *css,
+				  struct cftype *cft, u64 tag)
+{
+	return sched_core_cgroup_tag_write(css_tg(css), tag);
+}
+#endif
+
+#ifdef CONFIG_SCHED_INFO
+static int cpu_wakeup_latency_show(struct seq_file *sf, void *v)
+{
+	struct task_group *tg = css_tg(seq_css(sf));
+	u64 count[SCHED_WAKEUP_HIST_BUCKETS] = { };
+	unsigned int i;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct sched_wakeup_hist *hist;
+
+		hist = per_cpu_ptr(tg->wakeup_hist, cpu);
+
+		for (i = 0; i < SCHED_WAKEUP_HIST_BUCKETS; i++)
+			count[i] += READ_ONCE(hist->count[i]);
+	}
+
+	for (i = 0; i < SCHED_WAKEUP_HIST_BUCKETS; i++)
+		seq_printf(sf, "%llu %llu\n", sched_wakeup_hist_lower(i),
+			   count[i]);
+
+	return 0;
+}
 #endif
 
 static struct cftype cpu_legacy_files[] = {
@@ -10897,6 +11002,11 @@ static struct cftype cpu_legacy_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency_nice",
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -10944,6 +11054,20 @@ static struct cftype cpu_legacy_files[] = {
 		.seq_show = cpu_uclamp_max_show,
 		.write = cpu_uclamp_max_write,
 	},
+#endif
+#ifdef CONFIG_SCHED_CORE
+	{
+		.name = "core_tag",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_core_tag_read_u64,
+		.write_u64 = cpu_core_tag_write_u64,
+	},
+#endif
+#ifdef CONFIG_SCHED_INFO
+	{
+		.name = "wakeup_latency",
+		.seq_show = cpu_wakeup_latency_show,
+	},
 #endif
 	{ }	/* Terminate */
 };
@@ -11114,6 +11238,12 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -11142,6 +11272,20 @@ static struct cftype cpu_files[] = {
 		.seq_show = cpu_uclamp_max_show,
 		.write = cpu_uclamp_max_write,
 	},
+#endif
+#ifdef CONFIG_SCHED_CORE
+	{
+		.name = "core_tag",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_core_tag_read_u64,
+		.write_u64 = cpu_core_tag_write_u64,
+	},
+#endif
+#ifdef CONFIG_SCHED_INFO
+	{
+		.name = "wakeup_latency",
+		.seq_show = cpu_wakeup_latency_show,
+	},
 #endif
 	{ }	/* terminate */
 };
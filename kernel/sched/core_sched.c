@@ -107,10 +107,32 @@ static unsigned long sched_core_clone_cookie(struct task_struct *p)
 	return cookie;
 }
 
+#ifdef CONFIG_CGROUP_SCHED
+static unsigned long sched_core_group_cookie(struct task_group *tg);
+#endif
+
 void sched_core_fork(struct task_struct *p)
 {
+#ifdef CONFIG_CGROUP_SCHED
+	struct task_group *tg = task_group(p), *parent_tg = task_group(current);
+#endif
+
 	RB_CLEAR_NODE(&p->core_node);
 	p->core_cookie = sched_core_clone_cookie(current);
+
+#ifdef CONFIG_CGROUP_SCHED
+	/*
+	 * Forked into another group with CLONE_INTO_CGROUP, same as moving
+	 * it there: see sched_core_cgroup_attach(). The parent still holds
+	 * its cookie, dropping ours can't free it.
+	 */
+	if (tg != parent_tg && (sched_core_group_cookie(tg) ||
+				sched_core_group_cookie(parent_tg))) {
+		sched_core_put_cookie(p->core_cookie);
+		p->core_cookie =
+			sched_core_get_cookie(sched_core_group_cookie(tg));
+	}
+#endif
 }
 
 void sched_core_free(struct task_struct *p)
@@ -234,6 +256,109 @@ int sched_core_share_pid(unsigned int cmd, pid_t pid, enum pid_type type,
 	return err;
 }
 
+#ifdef CONFIG_CGROUP_SCHED
+
+/*
+ * Groups of the cpu controller can be tagged through cpu.core_tag: all the
+ * tasks of a tagged group and of its descendants then share the cookie of
+ * the group, unless a descendant is tagged itself. This lets tenants that
+ * trust each other be nested under a tagged group and share SMT siblings,
+ * while tasks of different tagged groups never do.
+ *
+ * The group cookie replaces the PR_SCHED_CORE cookies of the tasks: tagging
+ * or untagging a group, and moving a task into or out of a tagged group,
+ * sets the cookie of the tasks to that of their group. Both are done with
+ * cgroup_threadgroup_rwsem write-held, which also keeps forks out.
+ *
+ * The forced idle time the tasks of a group cause is accounted along with
+ * their cputime, see core_sched.force_idle_usec in cpu.stat.
+ */
+static unsigned long sched_core_group_cookie(struct task_group *tg)
+{
+	for (; tg; tg = tg->parent) {
+		if (tg->core_cookie)
+			return tg->core_cookie;
+	}
+
+	return 0;
+}
+
+/* Called from cpu_cgroup_attach(), after @p moved out of @from */
+void sched_core_cgroup_attach(struct task_struct *p, struct task_group *from)
+{
+	unsigned long cookie = sched_core_group_cookie(task_group(p));
+
+	if (cookie || sched_core_group_cookie(from))
+		__sched_core_set(p, cookie);
+}
+
+void sched_core_cgroup_free(struct task_group *tg)
+{
+	sched_core_put_cookie(tg->core_cookie);
+}
+
+u64 sched_core_cgroup_tag_read(struct task_group *tg)
+{
+	return !!READ_ONCE(tg->core_cookie);
+}
+
+int sched_core_cgroup_tag_write(struct task_group *tg, u64 tag)
+{
+	struct cgroup_subsys_state *css;
+	unsigned long cookie = 0, old;
+
+	if (tag > 1)
+		return -ERANGE;
+
+	/* sched_core_get() may have to take the CPU hotplug lock */
+	if (tag) {
+		cookie = sched_core_alloc_cookie();
+		if (!cookie)
+			return -ENOMEM;
+	}
+
+	percpu_down_write(&cgroup_threadgroup_rwsem);
+
+	if (!tg->core_cookie == !cookie)
+		goto unlock;
+
+	old = tg->core_cookie;
+	WRITE_ONCE(tg->core_cookie, cookie);
+	cookie = old;
+
+	rcu_read_lock();
+	css_for_each_descendant_pre(css, &tg->css) {
+		struct task_group *child;
+		struct css_task_iter it;
+		struct task_struct *p;
+		unsigned long group_cookie;
+
+		child = container_of(css, struct task_group, css);
+
+		/* Tagged descendants keep their own cookie */
+		if (css != &tg->css && child->core_cookie) {
+			css = css_rightmost_descendant(css);
+			continue;
+		}
+
+		group_cookie = sched_core_group_cookie(child);
+
+		css_task_iter_start(css, 0, &it);
+		while ((p = css_task_iter_next(&it)))
+			__sched_core_set(p, group_cookie);
+		css_task_iter_end(&it);
+	}
+	rcu_read_unlock();
+
+unlock:
+	percpu_up_write(&cgroup_threadgroup_rwsem);
+	sched_core_put_cookie(cookie);
+
+	return 0;
+}
+
+#endif /* CONFIG_CGROUP_SCHED */
+
 #ifdef CONFIG_SCHEDSTATS
 
 /* REQUIRES: rq->core's clock recently updated. */
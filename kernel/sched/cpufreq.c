@@ -8,6 +8,20 @@
 
 DEFINE_PER_CPU(struct update_util_data __rcu *, cpufreq_update_util_data);
 
+/*
+ * Utilization floor hinted by the drivers: @util holds until @expires and
+ * then halves every tick.
+ */
+struct cpufreq_hint {
+	unsigned long	util;
+	u64		expires;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_hint, cpufreq_hint);
+
+/* Number of ticks after which an expired hint has decayed entirely */
+#define CPUFREQ_HINT_DECAY_TICKS	10
+
 /**
  * cpufreq_add_update_util_hook - Populate the CPU's update_util_data pointer.
  * @cpu: The CPU to set the pointer for.
@@ -72,3 +86,83 @@ bool cpufreq_this_cpu_can_update(struct cpufreq_policy *policy)
 		(policy->dvfs_possible_from_any_cpu &&
 		 rcu_dereference_sched(*this_cpu_ptr(&cpufreq_update_util_data)));
 }
+
+/**
+ * cpufreq_get_util_hint - Get the utilization hinted for a CPU.
+ * @cpu: CPU to get the hint of.
+ * @time: Current time, in the rq clock base.
+ *
+ * Return the utilization floor hinted by the drivers for @cpu at @time, in
+ * SCHED_CAPACITY_SCALE units, decayed if the hint has expired.
+ */
+unsigned long cpufreq_get_util_hint(int cpu, u64 time)
+{
+	struct cpufreq_hint *hint = &per_cpu(cpufreq_hint, cpu);
+	unsigned long util = READ_ONCE(hint->util);
+	s64 delta_ns = time - READ_ONCE(hint->expires);
+
+	if (!util || delta_ns <= 0)
+		return util;
+
+	if (delta_ns >= CPUFREQ_HINT_DECAY_TICKS * TICK_NSEC)
+		return 0;
+
+	return util >> (div_u64(delta_ns, TICK_NSEC) + 1);
+}
+
+/**
+ * cpufreq_util_hint - Hint the utilization of a burst of work.
+ * @util: Utilization floor of the local CPU, in SCHED_CAPACITY_SCALE units.
+ * @duration_us: Time the floor holds for, in microseconds.
+ *
+ * Drivers processing bursts of work outside of the tasks, e.g. from NAPI or DMA
+ * completion handlers, can use this to have the CPU run at the performance
+ * level of the burst right away instead of waiting for PELT to catch up.
+ *
+ * The governor keeps the CPU utilization at @util at least for @duration_us.
+ * The floor then halves every tick. A weaker hint does not override a
+ * stronger one still in effect. A hint raising the floor triggers a frequency
+ * update right away, ignoring the rate limit of the governor.
+ *
+ * Context: Any context, with no runqueue lock held.
+ */
+void cpufreq_util_hint(unsigned long util, unsigned int duration_us)
+{
+	struct cpufreq_hint *hint;
+	unsigned long flags, cur;
+	struct rq_flags rf;
+	u64 now, expires;
+	struct rq *rq;
+	int cpu;
+
+	util = min_t(unsigned long, util, SCHED_CAPACITY_SCALE);
+	if (!util || !duration_us)
+		return;
+
+	local_irq_save(flags);
+
+	cpu = smp_processor_id();
+	hint = this_cpu_ptr(&cpufreq_hint);
+	now = sched_clock_cpu(cpu);
+	expires = now + (u64)duration_us * NSEC_PER_USEC;
+
+	cur = cpufreq_get_util_hint(cpu, now);
+	if (util < cur || (util == cur && hint->expires >= expires))
+		goto out;
+
+	WRITE_ONCE(hint->util, util);
+	WRITE_ONCE(hint->expires, expires);
+
+	if (util == cur)
+		goto out;
+
+	rq = cpu_rq(cpu);
+	rq_lock(rq, &rf);
+	update_rq_clock(rq);
+	cpufreq_update_util(rq, SCHED_CPUFREQ_HINT);
+	rq_unlock(rq, &rf);
+
+out:
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(cpufreq_util_hint);
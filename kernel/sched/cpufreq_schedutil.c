@@ -286,6 +286,27 @@ static void sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time)
 		sg_cpu->util = boost;
 }
 
+/**
+ * sugov_hint_apply() - Apply the utilization hinted by the drivers to a CPU.
+ * @sg_cpu: the sugov data for the cpu to boost
+ * @time: the update time from the caller
+ *
+ * See cpufreq_util_hint().
+ */
+static void sugov_hint_apply(struct sugov_cpu *sg_cpu, u64 time)
+{
+	unsigned long hint = cpufreq_get_util_hint(sg_cpu->cpu, time);
+
+	if (!hint)
+		return;
+
+	/* The hint is in SCHED_CAPACITY_SCALE, like the IO boost */
+	hint = (hint * sg_cpu->max) >> SCHED_CAPACITY_SHIFT;
+	hint = uclamp_rq_util_with(cpu_rq(sg_cpu->cpu), hint, NULL);
+	if (sg_cpu->util < hint)
+		sg_cpu->util = hint;
+}
+
 #ifdef CONFIG_NO_HZ_COMMON
 static bool sugov_cpu_is_busy(struct sugov_cpu *sg_cpu)
 {
@@ -309,6 +330,16 @@ static inline void ignore_dl_rate_limit(struct sugov_cpu *sg_cpu)
 		sg_cpu->sg_policy->limits_changed = true;
 }
 
+/*
+ * Likewise when a driver has raised the utilization hint of the CPU.
+ */
+static inline void ignore_hint_rate_limit(struct sugov_cpu *sg_cpu,
+					  unsigned int flags)
+{
+	if (flags & SCHED_CPUFREQ_HINT)
+		sg_cpu->sg_policy->limits_changed = true;
+}
+
 static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 					      u64 time, unsigned int flags)
 {
@@ -316,12 +347,14 @@ static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu);
+	ignore_hint_rate_limit(sg_cpu, flags);
 
 	if (!sugov_should_update_freq(sg_cpu->sg_policy, time))
 		return false;
 
 	sugov_get_util(sg_cpu);
 	sugov_iowait_apply(sg_cpu, time);
+	sugov_hint_apply(sg_cpu, time);
 
 	return true;
 }
@@ -417,6 +450,7 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 
 		sugov_get_util(j_sg_cpu);
 		sugov_iowait_apply(j_sg_cpu, time);
+		sugov_hint_apply(j_sg_cpu, time);
 		j_util = j_sg_cpu->util;
 		j_max = j_sg_cpu->max;
 
@@ -442,6 +476,7 @@ sugov_update_shared(struct update_util_data *hook, u64 time, unsigned int flags)
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu);
+	ignore_hint_rate_limit(sg_cpu, flags);
 
 	if (sugov_should_update_freq(sg_policy, time)) {
 		next_f = sugov_next_freq_shared(sg_cpu, time);
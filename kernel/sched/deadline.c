@@ -62,12 +62,22 @@ static inline struct rq *rq_of_dl_rq(struct dl_rq *dl_rq)
 	return container_of(dl_rq, struct rq, dl);
 }
 
-static inline struct dl_rq *dl_rq_of_se(struct sched_dl_entity *dl_se)
+static inline bool dl_server(struct sched_dl_entity *dl_se)
 {
-	struct task_struct *p = dl_task_of(dl_se);
-	struct rq *rq = task_rq(p);
+	return dl_se->dl_server;
+}
+
+static inline struct rq *rq_of_dl_se(struct sched_dl_entity *dl_se)
+{
+	if (dl_server(dl_se))
+		return dl_se->rq;
+
+	return task_rq(dl_task_of(dl_se));
+}
 
-	return &rq->dl;
+static inline struct dl_rq *dl_rq_of_se(struct sched_dl_entity *dl_se)
+{
+	return &rq_of_dl_se(dl_se)->dl;
 }
 
 static inline int on_dl_rq(struct sched_dl_entity *dl_se)
@@ -480,10 +490,9 @@ static void task_contending(struct sched_dl_entity *dl_se, int flags)
 	}
 }
 
-static inline int is_leftmost(struct task_struct *p, struct dl_rq *dl_rq)
+static inline int is_leftmost(struct sched_dl_entity *dl_se,
+			      struct dl_rq *dl_rq)
 {
-	struct sched_dl_entity *dl_se = &p->dl;
-
 	return rb_first_cached(&dl_rq->root) == &dl_se->rb_node;
 }
 
@@ -573,8 +582,12 @@ static void update_dl_migration(struct dl_rq *dl_rq)
 
 static void inc_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 {
-	struct task_struct *p = dl_task_of(dl_se);
+	struct task_struct *p;
+
+	if (dl_server(dl_se))
+		return;
 
+	p = dl_task_of(dl_se);
 	if (p->nr_cpus_allowed > 1)
 		dl_rq->dl_nr_migratory++;
 
@@ -583,8 +596,12 @@ static void inc_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 
 static void dec_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 {
-	struct task_struct *p = dl_task_of(dl_se);
+	struct task_struct *p;
 
+	if (dl_server(dl_se))
+		return;
+
+	p = dl_task_of(dl_se);
 	if (p->nr_cpus_allowed > 1)
 		dl_rq->dl_nr_migratory--;
 
@@ -766,6 +783,8 @@ static inline void deadline_queue_pull_task(struct rq *rq)
 }
 #endif /* CONFIG_SMP */
 
+static void enqueue_dl_entity(struct sched_dl_entity *dl_se, int flags);
+static void dequeue_dl_entity(struct sched_dl_entity *dl_se);
 static void enqueue_task_dl(struct rq *rq, struct task_struct *p, int flags);
 static void __dequeue_task_dl(struct rq *rq, struct task_struct *p, int flags);
 static void check_preempt_curr_dl(struct rq *rq, struct task_struct *p, int flags);
@@ -1041,17 +1060,17 @@ static inline u64 dl_next_period(struct sched_dl_entity *dl_se)
  * If the entity depleted all its runtime, and if we want it to sleep
  * while waiting for some new execution time to become available, we
  * set the bandwidth replenishment timer to the replenishment instant
- * and try to activate it.
+ * and try to activate it. A deferred server instead sets it to its
+ * zero-laxity instant.
  *
  * Notice that it is important for the caller to know if the timer
  * actually started or not (i.e., the replenishment instant is in
  * the future or in the past).
  */
-static int start_dl_timer(struct task_struct *p)
+static int start_dl_timer(struct sched_dl_entity *dl_se)
 {
-	struct sched_dl_entity *dl_se = &p->dl;
 	struct hrtimer *timer = &dl_se->dl_timer;
-	struct rq *rq = task_rq(p);
+	struct rq *rq = rq_of_dl_se(dl_se);
 	ktime_t now, act;
 	s64 delta;
 
@@ -1062,7 +1081,10 @@ static int start_dl_timer(struct task_struct *p)
 	 * that it is actually coming from rq->clock and not from
 	 * hrtimer's time base reading.
 	 */
-	act = ns_to_ktime(dl_next_period(dl_se));
+	if (dl_se->dl_defer_armed)
+		act = ns_to_ktime(dl_se->deadline - dl_se->runtime);
+	else
+		act = ns_to_ktime(dl_next_period(dl_se));
 	now = hrtimer_cb_get_time(timer);
 	delta = ktime_to_ns(now) - rq_clock(rq);
 	act = ktime_add_ns(act, delta);
@@ -1085,13 +1107,96 @@ static int start_dl_timer(struct task_struct *p)
 	 * and observe our state.
 	 */
 	if (!hrtimer_is_queued(timer)) {
-		get_task_struct(p);
+		if (!dl_server(dl_se))
+			get_task_struct(dl_task_of(dl_se));
 		hrtimer_start(timer, act, HRTIMER_MODE_ABS_HARD);
 	}
 
 	return 1;
 }
 
+static void dl_server_enqueue(struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+
+	dl_se->dl_defer_armed = 0;
+	dl_se->dl_throttled = 0;
+	enqueue_dl_entity(dl_se, 0);
+
+	if (!dl_task(rq->curr) || dl_entity_preempt(dl_se, &rq->curr->dl))
+		resched_curr(rq);
+}
+
+/*
+ * A server does not run as soon as its class has runnable tasks: those
+ * run by themselves as long as no RT or DL task starves them. It is
+ * instead armed to be enqueued at its zero-laxity instant, deadline -
+ * runtime, the last instant at which it can still provide its runtime
+ * to the class before the deadline. The time the class gets in the
+ * meanwhile is charged to the server (see dl_server_update()), pushing
+ * the zero-laxity instant back, so that the server only runs when the
+ * class did not get its runtime in the current period.
+ */
+static void dl_server_defer(struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+	u64 now = rq_clock(rq);
+
+	/* A server yields when its class has nothing left to run */
+	if (dl_se->dl_yielded && dl_se->runtime > 0)
+		dl_se->runtime = 0;
+	dl_se->dl_yielded = 0;
+
+	if (dl_se->runtime <= 0 || !dl_time_before(now, dl_se->deadline)) {
+		u64 start = dl_next_period(dl_se);
+
+		if (dl_time_before(start, now))
+			start = now;
+
+		dl_se->deadline = start + dl_se->dl_deadline;
+		dl_se->runtime = dl_se->dl_runtime;
+	}
+
+	dl_se->dl_throttled = 1;
+	dl_se->dl_defer_armed = 1;
+
+	/* Enqueue the server right away if it is already late */
+	if (!start_dl_timer(dl_se))
+		dl_server_enqueue(dl_se);
+}
+
+static enum hrtimer_restart dl_server_timer(struct hrtimer *timer,
+					    struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+
+	/* The server might have been stopped or restarted meanwhile */
+	if (!dl_se->dl_server_active || !dl_se->dl_throttled ||
+	    !dl_se->dl_defer_armed)
+		goto unlock;
+
+	sched_clock_tick();
+	update_rq_clock(rq);
+
+	/*
+	 * Running its class meanwhile might have moved the zero-laxity
+	 * instant of the server to the future, re-arm it in that case.
+	 */
+	if (dl_se->runtime > 0 && dl_se->server_has_tasks(dl_se) &&
+	    !dl_time_before(rq_clock(rq), dl_se->deadline - dl_se->runtime))
+		dl_server_enqueue(dl_se);
+	else
+		dl_server_defer(dl_se);
+
+unlock:
+	rq_unlock(rq, &rf);
+
+	return HRTIMER_NORESTART;
+}
+
 /*
  * This is the bandwidth enforcement timer callback. If here, we know
  * a task is not on its dl_rq, since the fact that the timer was running
@@ -1114,6 +1219,9 @@ static enum hrtimer_restart dl_task_timer(struct hrtimer *timer)
 	struct rq_flags rf;
 	struct rq *rq;
 
+	if (dl_server(dl_se))
+		return dl_server_timer(timer, dl_se);
+
 	rq = task_rq_lock(p, &rf);
 
 	/*
@@ -1245,7 +1353,7 @@ static inline void dl_check_constrained_dl(struct sched_dl_entity *dl_se)
 
 	if (dl_time_before(dl_se->deadline, rq_clock(rq)) &&
 	    dl_time_before(rq_clock(rq), dl_next_period(dl_se))) {
-		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(p)))
+		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(dl_se)))
 			return;
 		dl_se->dl_throttled = 1;
 		if (dl_se->runtime > 0)
@@ -1301,43 +1409,21 @@ static u64 grub_reclaim(u64 delta, struct rq *rq, struct sched_dl_entity *dl_se)
 }
 
 /*
- * Update the current task's runtime statistics (provided it is still
- * a -deadline task and has not been removed from the dl_rq).
+ * Charge @delta_exec of runtime to @dl_se, a -deadline task or a server
+ * still on the dl_rq, and throttle it once it is exhausted.
  */
-static void update_curr_dl(struct rq *rq)
+static void update_curr_dl_se(struct rq *rq, struct sched_dl_entity *dl_se,
+			      s64 delta_exec)
 {
-	struct task_struct *curr = rq->curr;
-	struct sched_dl_entity *dl_se = &curr->dl;
-	u64 delta_exec, scaled_delta_exec;
+	u64 scaled_delta_exec;
 	int cpu = cpu_of(rq);
-	u64 now;
-
-	if (!dl_task(curr) || !on_dl_rq(dl_se))
-		return;
 
-	/*
-	 * Consumed budget is computed considering the time as
-	 * observed by schedulable tasks (excluding time spent
-	 * in hardirq context, etc.). Deadlines are instead
-	 * computed using hard walltime. This seems to be the more
-	 * natural solution, but the full ramifications of this
-	 * approach need further study.
-	 */
-	now = rq_clock_task(rq);
-	delta_exec = now - curr->se.exec_start;
-	if (unlikely((s64)delta_exec <= 0)) {
+	if (unlikely(delta_exec <= 0)) {
 		if (unlikely(dl_se->dl_yielded))
 			goto throttle;
 		return;
 	}
 
-	schedstat_set(curr->stats.exec_max,
-		      max(curr->stats.exec_max, delta_exec));
-
-	trace_sched_stat_runtime(curr, delta_exec, 0);
-
-	update_current_exec_runtime(curr, now, delta_exec);
-
 	if (dl_entity_is_special(dl_se))
 		return;
 
@@ -1351,7 +1437,7 @@ static void update_curr_dl(struct rq *rq)
 	if (unlikely(dl_se->flags & SCHED_FLAG_RECLAIM)) {
 		scaled_delta_exec = grub_reclaim(delta_exec,
 						 rq,
-						 &curr->dl);
+						 dl_se);
 	} else {
 		unsigned long scale_freq = arch_scale_freq_capacity(cpu);
 		unsigned long scale_cpu = arch_scale_cpu_capacity(cpu);
@@ -1364,6 +1450,8 @@ static void update_curr_dl(struct rq *rq)
 
 throttle:
 	if (dl_runtime_exceeded(dl_se) || dl_se->dl_yielded) {
+		struct task_struct *curr;
+
 		dl_se->dl_throttled = 1;
 
 		/* If requested, inform the user about runtime overruns. */
@@ -1371,14 +1459,26 @@ static void update_curr_dl(struct rq *rq)
 		    (dl_se->flags & SCHED_FLAG_DL_OVERRUN))
 			dl_se->dl_overrun = 1;
 
+		if (dl_server(dl_se)) {
+			dequeue_dl_entity(dl_se);
+			dl_server_defer(dl_se);
+			resched_curr(rq);
+			return;
+		}
+
+		curr = dl_task_of(dl_se);
 		__dequeue_task_dl(rq, curr, 0);
-		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(curr)))
+		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(dl_se)))
 			enqueue_task_dl(rq, curr, ENQUEUE_REPLENISH);
 
-		if (!is_leftmost(curr, &rq->dl))
+		if (!is_leftmost(dl_se, &rq->dl))
 			resched_curr(rq);
 	}
 
+	/* The time of a server is accounted by the class it serves */
+	if (dl_server(dl_se))
+		return;
+
 	/*
 	 * Because -- for now -- we share the rt bandwidth, we need to
 	 * account our runtime there too, otherwise actual rt tasks
@@ -1405,6 +1505,202 @@ static void update_curr_dl(struct rq *rq)
 	}
 }
 
+/*
+ * Update the current task's runtime statistics (provided it is still
+ * a -deadline task and has not been removed from the dl_rq).
+ */
+static void update_curr_dl(struct rq *rq)
+{
+	struct task_struct *curr = rq->curr;
+	struct sched_dl_entity *dl_se = &curr->dl;
+	u64 delta_exec;
+	u64 now;
+
+	if (!dl_task(curr) || !on_dl_rq(dl_se))
+		return;
+
+	/*
+	 * Consumed budget is computed considering the time as
+	 * observed by schedulable tasks (excluding time spent
+	 * in hardirq context, etc.). Deadlines are instead
+	 * computed using hard walltime. This seems to be the more
+	 * natural solution, but the full ramifications of this
+	 * approach need further study.
+	 */
+	now = rq_clock_task(rq);
+	delta_exec = now - curr->se.exec_start;
+	if (unlikely((s64)delta_exec <= 0)) {
+		if (unlikely(dl_se->dl_yielded))
+			update_curr_dl_se(rq, dl_se, 0);
+		return;
+	}
+
+	schedstat_set(curr->stats.exec_max,
+		      max(curr->stats.exec_max, delta_exec));
+
+	trace_sched_stat_runtime(curr, delta_exec, 0);
+
+	update_current_exec_runtime(curr, now, delta_exec);
+
+	update_curr_dl_se(rq, dl_se, delta_exec);
+}
+
+/**
+ * dl_server_update - Charge the execution time of a served class
+ * @dl_se: server of the class
+ * @delta_exec: time the class ran for
+ *
+ * The class is charged whether it ran through the server or by itself,
+ * only the time it gets through the server counts as actual runtime of
+ * the server though, see dl_server_defer().
+ */
+void dl_server_update(struct sched_dl_entity *dl_se, s64 delta_exec)
+{
+	if (!dl_se->dl_server_active)
+		return;
+
+	if (dl_se->dl_defer_armed)
+		dl_se->runtime -= delta_exec;
+	else if (on_dl_rq(dl_se))
+		update_curr_dl_se(dl_se->rq, dl_se, delta_exec);
+}
+
+/**
+ * dl_server_start - Start a server once its class has runnable tasks
+ * @dl_se: server
+ *
+ * Context: rq lock held, with the rq clock updated.
+ */
+void dl_server_start(struct sched_dl_entity *dl_se)
+{
+	if (dl_se->dl_server_active || !dl_se->dl_runtime)
+		return;
+
+	dl_se->dl_server_active = 1;
+	dl_server_defer(dl_se);
+}
+
+/**
+ * dl_server_stop - Stop a server once its class has no runnable tasks
+ * @dl_se: server
+ *
+ * Context: rq lock held.
+ */
+void dl_server_stop(struct sched_dl_entity *dl_se)
+{
+	if (!dl_se->dl_server_active)
+		return;
+
+	hrtimer_try_to_cancel(&dl_se->dl_timer);
+	dequeue_dl_entity(dl_se);
+	dl_se->dl_defer_armed = 0;
+	dl_se->dl_throttled = 0;
+	dl_se->dl_server_active = 0;
+}
+
+/*
+ * The bandwidth of a server is accounted in the root domain of its CPU
+ * while the CPU is online. Return the number of CPUs it is spread over,
+ * 0 when it is not accounted.
+ */
+static inline int dl_server_cpus(struct rq *rq)
+{
+#ifdef CONFIG_SMP
+	return rq->online ? cpumask_weight(rq->rd->span) : 0;
+#else
+	return 1;
+#endif
+}
+
+static void __dl_server_set_params(struct sched_dl_entity *dl_se,
+				   u64 runtime, u64 period)
+{
+	dl_se->dl_runtime = runtime;
+	dl_se->dl_deadline = period;
+	dl_se->dl_period = period;
+	dl_se->dl_bw = to_ratio(period, runtime);
+	dl_se->dl_density = to_ratio(period, runtime);
+	dl_se->runtime = 0;
+	dl_se->deadline = 0;
+}
+
+/**
+ * dl_server_init - Initialize a server entity
+ * @dl_se: server
+ * @rq: runqueue of the server
+ * @runtime: runtime of the server in each period, 0 to disable it
+ * @period: period of the server
+ * @has_tasks: tells if the served class has runnable tasks
+ * @pick: picks the next task of the served class
+ */
+void dl_server_init(struct sched_dl_entity *dl_se, struct rq *rq,
+		    u64 runtime, u64 period,
+		    dl_server_has_tasks_f has_tasks,
+		    dl_server_pick_f pick)
+{
+	RB_CLEAR_NODE(&dl_se->rb_node);
+	init_dl_task_timer(dl_se);
+#ifdef CONFIG_RT_MUTEXES
+	dl_se->pi_se = dl_se;
+#endif
+
+	dl_se->rq = rq;
+	dl_se->server_has_tasks = has_tasks;
+	dl_se->server_pick = pick;
+	dl_se->dl_server = 1;
+	__dl_server_set_params(dl_se, runtime, period);
+
+#ifndef CONFIG_SMP
+	/* With SMP the bandwidth is accounted once the rq goes online */
+	__dl_add(&rq->dl.dl_bw, dl_se->dl_bw, 1);
+#endif
+}
+
+/**
+ * dl_server_apply_params - Change the parameters of a server
+ * @dl_se: server, stopped
+ * @runtime: new runtime of the server in each period, 0 to disable it
+ * @period: new period of the server
+ *
+ * Context: rq lock held.
+ *
+ * Return: 0 on success, -EBUSY if the new bandwidth does not fit in the
+ * root domain.
+ */
+int dl_server_apply_params(struct sched_dl_entity *dl_se,
+			   u64 runtime, u64 period)
+{
+	u64 new_bw = to_ratio(period, runtime);
+	struct rq *rq = dl_se->rq;
+	int cpu = cpu_of(rq);
+	struct dl_bw *dl_b;
+	int cpus, ret = 0;
+
+	lockdep_assert_rq_held(rq);
+
+	dl_b = dl_bw_of(cpu);
+	raw_spin_lock(&dl_b->lock);
+
+	cpus = dl_server_cpus(rq);
+	if (cpus) {
+		if (__dl_overflow(dl_b, dl_bw_capacity(cpu), dl_se->dl_bw,
+				  new_bw)) {
+			ret = -EBUSY;
+			goto unlock;
+		}
+
+		__dl_sub(dl_b, dl_se->dl_bw, cpus);
+		__dl_add(dl_b, new_bw, cpus);
+	}
+
+	__dl_server_set_params(dl_se, runtime, period);
+
+unlock:
+	raw_spin_unlock(&dl_b->lock);
+
+	return ret;
+}
+
 static enum hrtimer_restart inactive_task_timer(struct hrtimer *timer)
 {
 	struct sched_dl_entity *dl_se = container_of(timer,
@@ -1505,12 +1801,14 @@ static inline void dec_dl_deadline(struct dl_rq *dl_rq, u64 deadline) {}
 static inline
 void inc_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 {
-	int prio = dl_task_of(dl_se)->prio;
 	u64 deadline = dl_se->deadline;
 
-	WARN_ON(!dl_prio(prio));
 	dl_rq->dl_nr_running++;
-	add_nr_running(rq_of_dl_rq(dl_rq), 1);
+	/* The tasks run by a server are counted by their own class */
+	if (!dl_server(dl_se)) {
+		WARN_ON(!dl_prio(dl_task_of(dl_se)->prio));
+		add_nr_running(rq_of_dl_rq(dl_rq), 1);
+	}
 
 	inc_dl_deadline(dl_rq, deadline);
 	inc_dl_migration(dl_se, dl_rq);
@@ -1519,12 +1817,12 @@ void inc_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 static inline
 void dec_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 {
-	int prio = dl_task_of(dl_se)->prio;
-
-	WARN_ON(!dl_prio(prio));
 	WARN_ON(!dl_rq->dl_nr_running);
 	dl_rq->dl_nr_running--;
-	sub_nr_running(rq_of_dl_rq(dl_rq), 1);
+	if (!dl_server(dl_se)) {
+		WARN_ON(!dl_prio(dl_task_of(dl_se)->prio));
+		sub_nr_running(rq_of_dl_rq(dl_rq), 1);
+	}
 
 	dec_dl_deadline(dl_rq, dl_se->deadline);
 	dec_dl_migration(dl_se, dl_rq);
@@ -2018,12 +2316,23 @@ static struct task_struct *pick_task_dl(struct rq *rq)
 	struct dl_rq *dl_rq = &rq->dl;
 	struct task_struct *p;
 
+again:
 	if (!sched_dl_runnable(rq))
 		return NULL;
 
 	dl_se = pick_next_dl_entity(dl_rq);
 	WARN_ON_ONCE(!dl_se);
-	p = dl_task_of(dl_se);
+
+	if (!dl_server(dl_se))
+		return dl_task_of(dl_se);
+
+	p = dl_se->server_pick(dl_se);
+	if (!p) {
+		/* Nothing to serve, give the rest of the period back */
+		dl_se->dl_yielded = 1;
+		update_curr_dl_se(rq, dl_se, 0);
+		goto again;
+	}
 
 	return p;
 }
@@ -2033,7 +2342,13 @@ static struct task_struct *pick_next_task_dl(struct rq *rq)
 	struct task_struct *p;
 
 	p = pick_task_dl(rq);
-	if (p)
+	if (!p)
+		return p;
+
+	/* A task picked through a server runs in its own class */
+	if (p->sched_class != &dl_sched_class)
+		p->sched_class->set_next_task(rq, p, true);
+	else
 		set_next_task_dl(rq, p, true);
 
 	return p;
@@ -2073,7 +2388,7 @@ static void task_tick_dl(struct rq *rq, struct task_struct *p, int queued)
 	 * be set and schedule() will start a new hrtick for the next task.
 	 */
 	if (hrtick_enabled_dl(rq) && queued && p->dl.runtime > 0 &&
-	    is_leftmost(p, &rq->dl))
+	    is_leftmost(&p->dl, &rq->dl))
 		start_hrtick_dl(rq, p);
 }
 
@@ -2527,6 +2842,10 @@ static void rq_online_dl(struct rq *rq)
 	cpudl_set_freecpu(&rq->rd->cpudl, rq->cpu);
 	if (rq->dl.dl_nr_running > 0)
 		cpudl_set(&rq->rd->cpudl, rq->cpu, rq->dl.earliest_dl.curr);
+
+	raw_spin_lock(&rq->rd->dl_bw.lock);
+	__dl_add(&rq->rd->dl_bw, rq->fair_server.dl_bw, dl_server_cpus(rq));
+	raw_spin_unlock(&rq->rd->dl_bw.lock);
 }
 
 /* Assumes rq->lock is held */
@@ -2537,6 +2856,10 @@ static void rq_offline_dl(struct rq *rq)
 
 	cpudl_clear(&rq->rd->cpudl, rq->cpu);
 	cpudl_clear_freecpu(&rq->rd->cpudl, rq->cpu);
+
+	raw_spin_lock(&rq->rd->dl_bw.lock);
+	__dl_sub(&rq->rd->dl_bw, rq->fair_server.dl_bw, dl_server_cpus(rq));
+	raw_spin_unlock(&rq->rd->dl_bw.lock);
 }
 
 void __init init_sched_dl_class(void)
@@ -2575,9 +2898,14 @@ void dl_add_task_root_domain(struct task_struct *p)
 void dl_clear_root_domain(struct root_domain *rd)
 {
 	unsigned long flags;
+	int i;
 
 	raw_spin_lock_irqsave(&rd->dl_bw.lock, flags);
 	rd->dl_bw.total_bw = 0;
+
+	/* The servers of the online CPUs stay accounted, see rq_online_dl() */
+	for_each_cpu(i, rd->online)
+		rd->dl_bw.total_bw += cpu_rq(i)->fair_server.dl_bw;
 	raw_spin_unlock_irqrestore(&rd->dl_bw.lock, flags);
 }
 
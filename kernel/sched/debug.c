@@ -296,6 +296,133 @@ static const struct file_operations sched_debug_fops = {
 
 static struct dentry *debugfs_sched;
 
+/* Bounds of the period of the fair server, in ns */
+#define FAIR_SERVER_PERIOD_MIN	(100 * NSEC_PER_USEC)
+#define FAIR_SERVER_PERIOD_MAX	((1ULL << 22) * NSEC_PER_USEC)
+
+static ssize_t sched_fair_server_write(struct file *filp,
+				       const char __user *ubuf, size_t cnt,
+				       loff_t *ppos, bool is_runtime)
+{
+	long cpu = (long)((struct seq_file *)filp->private_data)->private;
+	struct rq *rq = cpu_rq(cpu);
+	struct sched_dl_entity *dl_se = &rq->fair_server;
+	u64 value, runtime, period;
+	struct rq_flags rf;
+	int err;
+
+	err = kstrtoull_from_user(ubuf, cnt, 10, &value);
+	if (err)
+		return err;
+
+	rq_lock_irqsave(rq, &rf);
+	update_rq_clock(rq);
+
+	runtime = is_runtime ? value : dl_se->dl_runtime;
+	period = is_runtime ? dl_se->dl_period : value;
+	if (period < FAIR_SERVER_PERIOD_MIN ||
+	    period > FAIR_SERVER_PERIOD_MAX || runtime > period) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	/* A runtime of 0 disables the server, and restores RT throttling */
+	dl_server_stop(dl_se);
+	err = dl_server_apply_params(dl_se, runtime, period);
+	if (rq->cfs.h_nr_running)
+		dl_server_start(dl_se);
+
+unlock:
+	rq_unlock_irqrestore(rq, &rf);
+
+	if (err)
+		return err;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static ssize_t sched_fair_server_runtime_write(struct file *filp,
+					       const char __user *ubuf,
+					       size_t cnt, loff_t *ppos)
+{
+	return sched_fair_server_write(filp, ubuf, cnt, ppos, true);
+}
+
+static int sched_fair_server_runtime_show(struct seq_file *m, void *v)
+{
+	long cpu = (long)m->private;
+
+	seq_printf(m, "%llu\n", cpu_rq(cpu)->fair_server.dl_runtime);
+	return 0;
+}
+
+static int sched_fair_server_runtime_open(struct inode *inode,
+					  struct file *filp)
+{
+	return single_open(filp, sched_fair_server_runtime_show,
+			   inode->i_private);
+}
+
+static const struct file_operations fair_server_runtime_fops = {
+	.open		= sched_fair_server_runtime_open,
+	.write		= sched_fair_server_runtime_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t sched_fair_server_period_write(struct file *filp,
+					      const char __user *ubuf,
+					      size_t cnt, loff_t *ppos)
+{
+	return sched_fair_server_write(filp, ubuf, cnt, ppos, false);
+}
+
+static int sched_fair_server_period_show(struct seq_file *m, void *v)
+{
+	long cpu = (long)m->private;
+
+	seq_printf(m, "%llu\n", cpu_rq(cpu)->fair_server.dl_period);
+	return 0;
+}
+
+static int sched_fair_server_period_open(struct inode *inode,
+					 struct file *filp)
+{
+	return single_open(filp, sched_fair_server_period_show,
+			   inode->i_private);
+}
+
+static const struct file_operations fair_server_period_fops = {
+	.open		= sched_fair_server_period_open,
+	.write		= sched_fair_server_period_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static __init void debugfs_fair_server_init(void)
+{
+	struct dentry *d_fair;
+	long cpu;
+
+	d_fair = debugfs_create_dir("fair_server", debugfs_sched);
+
+	for_each_possible_cpu(cpu) {
+		struct dentry *d_cpu;
+		char buf[32];
+
+		snprintf(buf, sizeof(buf), "cpu%ld", cpu);
+		d_cpu = debugfs_create_dir(buf, d_fair);
+
+		debugfs_create_file("runtime", 0644, d_cpu, (void *)cpu,
+				    &fair_server_runtime_fops);
+		debugfs_create_file("period", 0644, d_cpu, (void *)cpu,
+				    &fair_server_period_fops);
+	}
+}
+
 static __init int sched_init_debug(void)
 {
 	struct dentry __maybe_unused *numa;
@@ -338,6 +465,8 @@ static __init int sched_init_debug(void)
 
 	debugfs_create_file("debug", 0444, debugfs_sched, NULL, &sched_debug_fops);
 
+	debugfs_fair_server_init();
+
 	return 0;
 }
 late_initcall(sched_init_debug);
@@ -964,6 +1093,7 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 	nr_switches = p->nvcsw + p->nivcsw;
 
 	P(se.nr_migrations);
+	P(se.latency_nice);
 
 	if (schedstat_enabled()) {
 		u64 avg_atom, avg_per_cpu;
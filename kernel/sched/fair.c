@@ -717,11 +717,24 @@ static u64 __sched_period(unsigned long nr_running)
 
 static bool sched_idle_cfs_rq(struct cfs_rq *cfs_rq);
 
+/*
+ * Latency nice shifts the wakeup preemption of an entity by up to one
+ * sched_latency: -20 preempts as if it had run sched_latency less, 19 as if
+ * it had run about sched_latency more.
+ */
+static inline s64 latency_offset(struct sched_entity *se)
+{
+	return div_s64((s64)sysctl_sched_latency * se->latency_nice,
+		       -MIN_LATENCY_NICE);
+}
+
 /*
  * We calculate the wall-time slice from the period by taking a part
  * proportional to the weight.
  *
  * s = p*P[w/rw]
+ *
+ * and scale it by [0.5 .. 1.5) with the latency nice of the entity.
  */
 static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
@@ -752,6 +765,11 @@ static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		slice = __calc_delta(slice, se->load.weight, load);
 	}
 
+	if (init_se->latency_nice) {
+		slice *= LATENCY_NICE_WIDTH + init_se->latency_nice;
+		slice = div_u64(slice, LATENCY_NICE_WIDTH);
+	}
+
 	if (sched_feat(BASE_SLICE)) {
 		if (se_is_idle(init_se) && !sched_idle_cfs_rq(cfs_rq))
 			min_gran = sysctl_sched_idle_min_granularity;
@@ -914,6 +932,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 		trace_sched_stat_runtime(curtask, delta_exec, curr->vruntime);
 		cgroup_account_cputime(curtask, delta_exec);
 		account_group_exec_runtime(curtask, delta_exec);
+		dl_server_update(&rq_of(cfs_rq)->fair_server, delta_exec);
 	}
 
 	account_cfs_rq_runtime(cfs_rq, delta_exec);
@@ -5225,6 +5244,10 @@ static bool throttle_cfs_rq(struct cfs_rq *cfs_rq)
 	/* At this point se is NULL and we are at root level*/
 	sub_nr_running(rq, task_delta);
 
+	/* Stop the fair server if throttling left no runnable task */
+	if (!rq->cfs.h_nr_running)
+		dl_server_stop(&rq->fair_server);
+
 done:
 	/*
 	 * Note: distribution will already see us throttled via the
@@ -5310,6 +5333,10 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, task_delta);
 
+	/* Start the fair server if unthrottling made the first tasks runnable */
+	if (rq->cfs.h_nr_running == task_delta)
+		dl_server_start(&rq->fair_server);
+
 unthrottle_throttle:
 	assert_list_leaf_cfs_rq(rq);
 
@@ -5970,6 +5997,9 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, 1);
 
+	if (rq->cfs.h_nr_running == 1)
+		dl_server_start(&rq->fair_server);
+
 	/*
 	 * Since new tasks are assigned an initial util_avg equal to
 	 * half of the spare capacity of their CPU, tiny tasks have the
@@ -6061,6 +6091,9 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	/* At this point se is NULL and we are at root level*/
 	sub_nr_running(rq, 1);
 
+	if (!rq->cfs.h_nr_running)
+		dl_server_stop(&rq->fair_server);
+
 	/* balance early to pull high priority tasks */
 	if (unlikely(!was_sched_idle && sched_idle_rq(rq)))
 		rq->next_balance = jiffies;
@@ -6427,6 +6460,38 @@ static inline int __select_idle_cpu(int cpu, struct task_struct *p)
 	return -1;
 }
 
+/**
+ * update_idle_cpus - Track the idle CPUs of the LLC domain of a CPU
+ * @rq: runqueue of the CPU
+ * @idle: whether the CPU enters or leaves idle
+ *
+ * The bit is only written when it changes, so that a CPU going idle and
+ * busy again within a domain that is mostly busy does not keep bouncing
+ * the shared cacheline.
+ */
+void update_idle_cpus(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+	struct cpumask *mask;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (!sds)
+		goto unlock;
+
+	mask = sds_idle_cpus(sds);
+	if (cpumask_test_cpu(cpu, mask) == idle)
+		goto unlock;
+
+	if (idle)
+		cpumask_set_cpu(cpu, mask);
+	else
+		cpumask_clear_cpu(cpu, mask);
+unlock:
+	rcu_read_unlock();
+}
+
 #ifdef CONFIG_SCHED_SMT
 DEFINE_STATIC_KEY_FALSE(sched_smt_present);
 EXPORT_SYMBOL_GPL(sched_smt_present);
@@ -6570,6 +6635,18 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
 
+	/*
+	 * The CPUs of an idle core are all in the idle mask, so the filter
+	 * holds for the idle core search too.
+	 */
+	if (sched_feat(SIS_FILTER)) {
+		sd_share = rcu_dereference(per_cpu(sd_llc_shared, target));
+		if (sd_share)
+			cpumask_and(cpus, cpus, sds_idle_cpus(sd_share));
+	}
+
+	schedstat_inc(this_rq->sis_search);
+
 	if (sched_feat(SIS_PROP) && !has_idle_core) {
 		u64 avg_cost, avg_idle, span_avg;
 		unsigned long now = jiffies;
@@ -6614,14 +6691,17 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	}
 
 	for_each_cpu_wrap(cpu, cpus, target + 1) {
+		schedstat_inc(this_rq->sis_scanned);
 		if (has_idle_core) {
 			i = select_idle_core(p, cpu, cpus, &idle_cpu);
 			if ((unsigned int)i < nr_cpumask_bits)
 				return i;
 
 		} else {
-			if (!--nr)
+			if (!--nr) {
+				schedstat_inc(this_rq->sis_failed);
 				return -1;
+			}
 			idle_cpu = __select_idle_cpu(cpu, p);
 			if ((unsigned int)idle_cpu < nr_cpumask_bits)
 				break;
@@ -6631,6 +6711,9 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	if (has_idle_core)
 		set_idle_cores(target, false);
 
+	if ((unsigned int)idle_cpu >= nr_cpumask_bits)
+		schedstat_inc(this_rq->sis_failed);
+
 	if (sched_feat(SIS_PROP) && this_sd && !has_idle_core) {
 		time = cpu_clock(this) - time;
 
@@ -7352,6 +7435,10 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	/* Bias by the latency requirements of both entities */
+	if (se->latency_nice != curr->latency_nice)
+		vdiff += latency_offset(curr) - latency_offset(se);
+
 	if (vdiff <= 0)
 		return -1;
 
@@ -7490,7 +7577,6 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 		set_last_buddy(se);
 }
 
-#ifdef CONFIG_SMP
 static struct task_struct *pick_task_fair(struct rq *rq)
 {
 	struct sched_entity *se;
@@ -7521,7 +7607,26 @@ static struct task_struct *pick_task_fair(struct rq *rq)
 
 	return task_of(se);
 }
-#endif
+
+static bool fair_server_has_tasks(struct sched_dl_entity *dl_se)
+{
+	return !!dl_se->rq->cfs.h_nr_running;
+}
+
+static struct task_struct *fair_server_pick(struct sched_dl_entity *dl_se)
+{
+	return pick_task_fair(dl_se->rq);
+}
+
+/*
+ * The fair server guarantees the fair tasks 50ms every second when RT and
+ * DL tasks starve them, like the default RT throttling used to.
+ */
+void fair_server_init(struct rq *rq)
+{
+	dl_server_init(&rq->fair_server, rq, 50 * NSEC_PER_MSEC, NSEC_PER_SEC,
+		       fair_server_has_tasks, fair_server_pick);
+}
 
 struct task_struct *
 pick_next_task_fair(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
@@ -11985,6 +12090,7 @@ void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 	se->my_q = cfs_rq;
 	/* guarantee group entities always have weight */
 	update_load_set(&se->load, NICE_0_LOAD);
+	se->latency_nice = tg->latency_nice;
 	se->parent = parent;
 }
 
@@ -12113,6 +12219,38 @@ int sched_group_set_idle(struct task_group *tg, long idle)
 	return 0;
 }
 
+int sched_group_set_latency(struct task_group *tg, s64 nice)
+{
+	int i;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (nice < MIN_LATENCY_NICE || nice > MAX_LATENCY_NICE)
+		return -EINVAL;
+
+	mutex_lock(&shares_mutex);
+
+	if (tg->latency_nice == nice) {
+		mutex_unlock(&shares_mutex);
+		return 0;
+	}
+
+	tg->latency_nice = nice;
+
+	for_each_possible_cpu(i) {
+		struct rq *rq = cpu_rq(i);
+		struct rq_flags rf;
+
+		rq_lock_irqsave(rq, &rf);
+		tg->se[i]->latency_nice = nice;
+		rq_unlock_irqrestore(rq, &rf);
+	}
+
+	mutex_unlock(&shares_mutex);
+	return 0;
+}
+
 #else /* CONFIG_FAIR_GROUP_SCHED */
 
 void free_fair_sched_group(struct task_group *tg) { }
@@ -20,6 +20,15 @@ enum hk_flags {
 	HK_FLAG_KTHREAD		= BIT(HK_TYPE_KTHREAD),
 };
 
+/*
+ * Housekeeping types the CPUs can be isolated from at runtime. The tick
+ * and the scheduler domains are only set up at boot (nohz_full= and
+ * isolcpus=, cpuset partitions for the domains).
+ */
+#define HK_FLAG_RUNTIME		(HK_FLAG_TIMER | HK_FLAG_RCU | \
+				 HK_FLAG_MISC | HK_FLAG_WQ | \
+				 HK_FLAG_MANAGED_IRQ | HK_FLAG_KTHREAD)
+
 DEFINE_STATIC_KEY_FALSE(housekeeping_overridden);
 EXPORT_SYMBOL_GPL(housekeeping_overridden);
 
@@ -30,6 +39,17 @@ struct housekeeping {
 
 static struct housekeeping housekeeping;
 
+/*
+ * Runtime isolation: the housekeeping CPUs of the boot command line, the
+ * CPUs isolated at runtime on top of them and the CPUs whose RCU callbacks
+ * got offloaded because of it.
+ */
+static DEFINE_MUTEX(housekeeping_mutex);
+static cpumask_var_t housekeeping_boot[HK_TYPE_MAX];
+static cpumask_var_t housekeeping_isolated;
+static cpumask_var_t housekeeping_offloaded;
+static bool housekeeping_runtime;
+
 bool housekeeping_enabled(enum hk_type type)
 {
 	return !!(housekeeping.flags & BIT(type));
@@ -79,6 +99,159 @@ bool housekeeping_test_cpu(int cpu, enum hk_type type)
 }
 EXPORT_SYMBOL_GPL(housekeeping_test_cpu);
 
+/*
+ * Move @cpus in or out of the housekeeping mask of @type. The mask is
+ * updated in place under its readers: growing it to the union of the old
+ * and new masks first ensures they never see a mask without any of the
+ * CPUs in both.
+ */
+static void housekeeping_set_cpumask(enum hk_type type,
+				     const struct cpumask *mask)
+{
+	cpumask_or(housekeeping.cpumasks[type], housekeeping.cpumasks[type],
+		   mask);
+	cpumask_copy(housekeeping.cpumasks[type], mask);
+}
+
+static void housekeeping_update_rcu(const struct cpumask *isolated)
+{
+	int cpu;
+
+	/*
+	 * Only the CPUs of rcu_nocbs= can have their callbacks offloaded,
+	 * leave the others and the ones offloaded at boot alone.
+	 */
+	for_each_possible_cpu(cpu) {
+		bool offloaded = cpumask_test_cpu(cpu, housekeeping_offloaded);
+
+		if (cpumask_test_cpu(cpu, isolated) && !offloaded) {
+			if (!rcu_nocb_cpu_offload(cpu))
+				cpumask_set_cpu(cpu, housekeeping_offloaded);
+		} else if (!cpumask_test_cpu(cpu, isolated) && offloaded) {
+			if (!rcu_nocb_cpu_deoffload(cpu))
+				cpumask_clear_cpu(cpu, housekeeping_offloaded);
+		}
+	}
+}
+
+/**
+ * housekeeping_update_isolated - Isolate CPUs from housekeeping at runtime
+ * @isolated: CPUs to isolate, on top of the CPUs isolated at boot
+ *
+ * Remove @isolated from the housekeeping CPUs of the timer, RCU, misc,
+ * workqueue, managed IRQ and kthread types. The CPUs isolated by a previous
+ * call but not in @isolated go back to housekeeping. The work that is
+ * queued or started later avoids the isolated CPUs. The unbound workqueues
+ * and kthreadd are moved off them right away, and their RCU callbacks are
+ * offloaded when they are in rcu_nocbs=. The timers already queued and
+ * the managed IRQs already started on the isolated CPUs stay there.
+ *
+ * Context: Process context, takes the CPU hotplug lock.
+ *
+ * Return: 0 on success, -ENODEV if runtime isolation is not available,
+ * -EINVAL if a housekeeping type would be left without an online CPU,
+ * another negative error code otherwise. Nothing is changed on error.
+ */
+int housekeeping_update_isolated(const struct cpumask *isolated)
+{
+	unsigned long runtime_flags = HK_FLAG_RUNTIME;
+	cpumask_var_t mask;
+	enum hk_type type;
+	int ret = 0;
+
+	if (!READ_ONCE(housekeeping_runtime))
+		return -ENODEV;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	mutex_lock(&housekeeping_mutex);
+
+	/* We need at least one CPU to handle housekeeping work */
+	for_each_set_bit(type, &runtime_flags, HK_TYPE_MAX) {
+		cpumask_andnot(mask, housekeeping_boot[type], isolated);
+		if (!cpumask_intersects(mask, cpu_online_mask)) {
+			ret = -EINVAL;
+			goto unlock;
+		}
+	}
+
+	/*
+	 * Move the unbound workqueues first, so that nothing has changed yet
+	 * when it fails. This overrides the mask set through sysfs.
+	 */
+	cpumask_andnot(mask, housekeeping_boot[HK_TYPE_WQ], isolated);
+	ret = workqueue_set_unbound_cpumask(mask);
+	if (ret)
+		goto unlock;
+
+	for_each_set_bit(type, &runtime_flags, HK_TYPE_MAX) {
+		cpumask_andnot(mask, housekeeping_boot[type], isolated);
+		housekeeping_set_cpumask(type, mask);
+	}
+
+	/* The masks of the types unset at boot hold all the possible CPUs */
+	if (!cpumask_empty(isolated) &&
+	    (housekeeping.flags & HK_FLAG_RUNTIME) != HK_FLAG_RUNTIME) {
+		WRITE_ONCE(housekeeping.flags,
+			   housekeeping.flags | HK_FLAG_RUNTIME);
+		static_branch_enable(&housekeeping_overridden);
+	}
+
+	set_cpus_allowed_ptr(kthreadd_task,
+			     housekeeping.cpumasks[HK_TYPE_KTHREAD]);
+
+	housekeeping_update_rcu(isolated);
+
+	cpumask_copy(housekeeping_isolated, isolated);
+	pr_info("Housekeeping: runtime isolated CPUs: %*pbl\n",
+		cpumask_pr_args(isolated));
+
+unlock:
+	mutex_unlock(&housekeeping_mutex);
+	free_cpumask_var(mask);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(housekeeping_update_isolated);
+
+/*
+ * Runtime isolation allocates the masks of the types left unset at boot,
+ * which still hold all the possible CPUs until a CPU gets isolated.
+ */
+static int __init housekeeping_runtime_init(void)
+{
+	unsigned long runtime_flags = HK_FLAG_RUNTIME;
+	enum hk_type type;
+
+	if (!zalloc_cpumask_var(&housekeeping_isolated, GFP_KERNEL) ||
+	    !zalloc_cpumask_var(&housekeeping_offloaded, GFP_KERNEL))
+		return -ENOMEM;
+
+	for_each_set_bit(type, &runtime_flags, HK_TYPE_MAX) {
+		if (!alloc_cpumask_var(&housekeeping_boot[type], GFP_KERNEL))
+			return -ENOMEM;
+
+		if (housekeeping.flags & BIT(type)) {
+			cpumask_copy(housekeeping_boot[type],
+				     housekeeping.cpumasks[type]);
+			continue;
+		}
+
+		if (!alloc_cpumask_var(&housekeeping.cpumasks[type],
+				       GFP_KERNEL))
+			return -ENOMEM;
+
+		cpumask_copy(housekeeping_boot[type], cpu_possible_mask);
+		cpumask_copy(housekeeping.cpumasks[type], cpu_possible_mask);
+	}
+
+	WRITE_ONCE(housekeeping_runtime, true);
+
+	return 0;
+}
+core_initcall(housekeeping_runtime_init);
+
 void __init housekeeping_init(void)
 {
 	enum hk_type type;
@@ -306,9 +306,11 @@ static int membarrier_global_expedited(void)
 	return 0;
 }
 
-static int membarrier_private_expedited(int flags, int cpu_id)
+static int membarrier_private_expedited(int flags, int cpu_id, int cpuset_fd)
 {
-	cpumask_var_t tmpmask;
+	const struct cpumask *cpus = cpu_online_mask;
+	cpumask_var_t tmpmask, scope;
+	int ret = 0;
 	struct mm_struct *mm = current->mm;
 	smp_call_func_t ipi_func = ipi_mb;
 
@@ -333,9 +335,21 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 			return -EPERM;
 	}
 
+	/*
+	 * Resolve the cpuset first, so that a bad file descriptor is
+	 * reported even when no IPI would be needed.
+	 */
+	if (cpuset_fd >= 0) {
+		if (!alloc_cpumask_var(&scope, GFP_KERNEL))
+			return -ENOMEM;
+		ret = cpuset_cgroup_fd_cpus(cpuset_fd, scope);
+		if (ret)
+			goto free_scope;
+	}
+
 	if (flags != MEMBARRIER_FLAG_SYNC_CORE &&
 	    (atomic_read(&mm->mm_users) == 1 || num_online_cpus() == 1))
-		return 0;
+		goto free_scope;
 
 	/*
 	 * Matches memory barriers around rq->curr modification in
@@ -343,8 +357,10 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	 */
 	smp_mb();	/* system call entry is not a mb. */
 
-	if (cpu_id < 0 && !zalloc_cpumask_var(&tmpmask, GFP_KERNEL))
-		return -ENOMEM;
+	if (cpu_id < 0 && !zalloc_cpumask_var(&tmpmask, GFP_KERNEL)) {
+		ret = -ENOMEM;
+		goto free_scope;
+	}
 
 	cpus_read_lock();
 
@@ -363,8 +379,14 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	} else {
 		int cpu;
 
+		/* Only IPI the CPUs of the cpuset that are still online */
+		if (cpuset_fd >= 0) {
+			cpumask_and(scope, scope, cpu_online_mask);
+			cpus = scope;
+		}
+
 		rcu_read_lock();
-		for_each_online_cpu(cpu) {
+		for_each_cpu(cpu, cpus) {
 			struct task_struct *p;
 
 			p = rcu_dereference(cpu_rq(cpu)->curr);
@@ -419,7 +441,10 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	 */
 	smp_mb();	/* exit from system call is not a mb */
 
-	return 0;
+free_scope:
+	if (cpuset_fd >= 0)
+		free_cpumask_var(scope);
+	return ret;
 }
 
 static int sync_runqueues_membarrier_state(struct mm_struct *mm)
@@ -543,14 +568,19 @@ static int membarrier_register_private_expedited(int flags)
 /**
  * sys_membarrier - issue memory barriers on a set of threads
  * @cmd:    Takes command values defined in enum membarrier_cmd.
- * @flags:  Currently needs to be 0 for all commands other than
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ: in the latter
- *          case it can be MEMBARRIER_CMD_FLAG_CPU, indicating that @cpu_id
- *          contains the CPU on which to interrupt (= restart)
+ * @flags:  Currently needs to be 0 for all commands other than the
+ *          MEMBARRIER_CMD_PRIVATE_EXPEDITED ones. Those can be passed
+ *          MEMBARRIER_CMD_FLAG_CPUSET, indicating that @cpu_id contains
+ *          the file descriptor of a cgroup whose cpuset limits the
+ *          targeted CPUs. MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ can
+ *          instead be passed MEMBARRIER_CMD_FLAG_CPU, indicating that
+ *          @cpu_id contains the CPU on which to interrupt (= restart)
  *          the RSEQ critical section.
  * @cpu_id: if @flags == MEMBARRIER_CMD_FLAG_CPU, indicates the cpu on which
  *          RSEQ CS should be interrupted (@cmd must be
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ).
+ *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ). If @flags ==
+ *          MEMBARRIER_CMD_FLAG_CPUSET, indicates the cgroup file
+ *          descriptor.
  *
  * If this system call is not implemented, -ENOSYS is returned. If the
  * command specified does not exist, not available on the running
@@ -578,9 +608,17 @@ static int membarrier_register_private_expedited(int flags)
  */
 SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 {
+	int cpuset_fd = -1;
+
 	switch (cmd) {
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
-		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU))
+		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU &&
+			     flags != MEMBARRIER_CMD_FLAG_CPUSET))
+			return -EINVAL;
+		break;
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
+		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPUSET))
 			return -EINVAL;
 		break;
 	default:
@@ -588,6 +626,11 @@ SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 			return -EINVAL;
 	}
 
+	if (flags & MEMBARRIER_CMD_FLAG_CPUSET) {
+		if (unlikely(cpu_id < 0))
+			return -EBADF;
+		cpuset_fd = cpu_id;
+	}
 	if (!(flags & MEMBARRIER_CMD_FLAG_CPU))
 		cpu_id = -1;
 
@@ -612,15 +655,17 @@ SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 	case MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED:
 		return membarrier_register_global_expedited();
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
-		return membarrier_private_expedited(0, cpu_id);
+		return membarrier_private_expedited(0, cpu_id, cpuset_fd);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED:
 		return membarrier_register_private_expedited(0);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE, cpu_id);
+		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE,
+						    cpu_id, cpuset_fd);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_SYNC_CORE);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ, cpu_id);
+		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ,
+						    cpu_id, cpuset_fd);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_RSEQ);
 	default:
@@ -998,10 +998,19 @@ static inline int rt_se_prio(struct sched_rt_entity *rt_se)
 static int sched_rt_runtime_exceeded(struct rt_rq *rt_rq)
 {
 	u64 runtime = sched_rt_runtime(rt_rq);
+	struct rq *rq;
 
 	if (rt_rq->rt_throttled)
 		return rt_rq_throttled(rt_rq);
 
+	/*
+	 * The fair server protects the fair tasks from starvation, only
+	 * throttle the root RT runqueue when it has been disabled.
+	 */
+	rq = rq_of_rt_rq(rt_rq);
+	if (rt_rq == &rq->rt && rq->fair_server.dl_runtime)
+		return 0;
+
 	if (runtime >= sched_rt_period(rt_rq))
 		return 0;
 
@@ -2214,7 +2223,41 @@ static void push_rt_tasks(struct rq *rq)
  * priority task, even if the iterator is in the middle of a scan. Incrementing
  * the rt_loop_next will cause the iterator to perform another scan.
  *
+ * Each scan is limited to the LLCs of the CPUs that asked for it, when they
+ * have overloaded CPUs in their own LLC: those tasks are the cheapest to
+ * migrate, and with many RT tasks waking up at once, as with per device
+ * capture threads, it keeps the IPI chain from crossing every cluster of the
+ * root domain. A CPU with no overloaded CPU in its LLC still gets the whole
+ * rto_mask scanned.
  */
+static void rto_update_scope(struct root_domain *rd)
+{
+	struct sched_domain *sd;
+	bool all = false;
+	int cpu;
+
+	cpumask_clear(rd->rto_scope);
+
+	rcu_read_lock();
+	for_each_cpu(cpu, rd->rto_pull_mask) {
+		cpumask_clear_cpu(cpu, rd->rto_pull_mask);
+		if (all)
+			continue;
+
+		sd = rcu_dereference(per_cpu(sd_llc, cpu));
+		if (!sd ||
+		    !cpumask_intersects(rd->rto_mask, sched_domain_span(sd)))
+			all = true;
+		else
+			cpumask_or(rd->rto_scope, rd->rto_scope,
+				   sched_domain_span(sd));
+	}
+	rcu_read_unlock();
+
+	if (all || cpumask_empty(rd->rto_scope))
+		cpumask_setall(rd->rto_scope);
+}
+
 static int rto_next_cpu(struct root_domain *rd)
 {
 	int next;
@@ -2235,8 +2278,13 @@ static int rto_next_cpu(struct root_domain *rd)
 	 */
 	for (;;) {
 
+		/* A new scan covers the CPUs that asked for it */
+		if (rd->rto_cpu < 0)
+			rto_update_scope(rd);
+
 		/* When rto_cpu is -1 this acts like cpumask_first() */
-		cpu = cpumask_next(rd->rto_cpu, rd->rto_mask);
+		cpu = cpumask_next_and(rd->rto_cpu, rd->rto_mask,
+				       rd->rto_scope);
 
 		rd->rto_cpu = cpu;
 
@@ -2276,6 +2324,13 @@ static void tell_cpu_to_push(struct rq *rq)
 {
 	int cpu = -1;
 
+	/*
+	 * Have the next scan cover this CPU. Ordered before the increment,
+	 * matches the ACQUIRE of rto_loop_next in rto_next_cpu().
+	 */
+	cpumask_set_cpu(rq->cpu, rq->rd->rto_pull_mask);
+	smp_mb__before_atomic();
+
 	/* Keep the loop going if the IPI is currently active */
 	atomic_inc(&rq->rd->rto_loop_next);
 
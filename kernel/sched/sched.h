@@ -365,6 +365,11 @@ struct cfs_bandwidth {
 #endif
 };
 
+/* Per CPU wakeup latency histogram of a task group */
+struct sched_wakeup_hist {
+	u64			count[SCHED_WAKEUP_HIST_BUCKETS];
+};
+
 /* Task group related information */
 struct task_group {
 	struct cgroup_subsys_state css;
@@ -378,6 +383,8 @@ struct task_group {
 
 	/* A positive value indicates that this is a SCHED_IDLE group. */
 	int			idle;
+	/* Latency nice value of the group entities */
+	int			latency_nice;
 
 #ifdef	CONFIG_SMP
 	/*
@@ -418,6 +425,15 @@ struct task_group {
 	struct uclamp_se	uclamp[UCLAMP_CNT];
 #endif
 
+#ifdef CONFIG_SCHED_INFO
+	/* Wakeup latency histogram of the tasks of the group and below */
+	struct sched_wakeup_hist __percpu *wakeup_hist;
+#endif
+
+#ifdef CONFIG_SCHED_CORE
+	/* Core scheduling cookie of the tasks of the group, if tagged */
+	unsigned long		core_cookie;
+#endif
 };
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -488,6 +504,8 @@ extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 
 extern int sched_group_set_idle(struct task_group *tg, long idle);
 
+extern int sched_group_set_latency(struct task_group *tg, s64 nice);
+
 #ifdef CONFIG_SMP
 extern void set_task_rq_fair(struct sched_entity *se,
 			     struct cfs_rq *prev, struct cfs_rq *next);
@@ -866,6 +884,10 @@ struct root_domain {
 	/* These atomics are updated outside of a lock */
 	atomic_t		rto_loop_next;
 	atomic_t		rto_loop_start;
+	/* CPUs that asked for a pull since the last scan started */
+	cpumask_var_t		rto_pull_mask;
+	/* CPUs visited by the current scan, updated within rto_lock */
+	cpumask_var_t		rto_scope;
 #endif
 	/*
 	 * The "RT overload" flag: it gets set if a CPU has more than
@@ -990,6 +1012,8 @@ struct rq {
 	struct cfs_rq		cfs;
 	struct rt_rq		rt;
 	struct dl_rq		dl;
+	/* Deadline server protecting the fair tasks from starvation */
+	struct sched_dl_entity	fair_server;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this CPU: */
@@ -1120,6 +1144,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/* select_idle_cpu() stats */
+	unsigned int		sis_search;
+	unsigned int		sis_scanned;
+	unsigned int		sis_failed;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1300,6 +1329,14 @@ extern void sched_core_dequeue(struct rq *rq, struct task_struct *p, int flags);
 extern void sched_core_get(void);
 extern void sched_core_put(void);
 
+#ifdef CONFIG_CGROUP_SCHED
+extern void sched_core_cgroup_attach(struct task_struct *p,
+				     struct task_group *from);
+extern void sched_core_cgroup_free(struct task_group *tg);
+extern u64 sched_core_cgroup_tag_read(struct task_group *tg);
+extern int sched_core_cgroup_tag_write(struct task_group *tg, u64 tag);
+#endif
+
 #else /* !CONFIG_SCHED_CORE */
 
 static inline bool sched_core_enabled(struct rq *rq)
@@ -1338,6 +1375,12 @@ static inline bool sched_group_cookie_match(struct rq *rq,
 {
 	return true;
 }
+
+#ifdef CONFIG_CGROUP_SCHED
+static inline void sched_core_cgroup_attach(struct task_struct *p,
+					    struct task_group *from) { }
+static inline void sched_core_cgroup_free(struct task_group *tg) { }
+#endif
 #endif /* CONFIG_SCHED_CORE */
 
 static inline void lockdep_assert_rq_held(struct rq *rq)
@@ -1398,6 +1441,12 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpus(struct rq *rq, bool idle);
+#else
+static inline void update_idle_cpus(struct rq *rq, bool idle) { }
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static inline struct task_struct *task_of(struct sched_entity *se)
 {
@@ -2358,6 +2407,17 @@ extern void init_dl_bandwidth(struct dl_bandwidth *dl_b, u64 period, u64 runtime
 extern void init_dl_task_timer(struct sched_dl_entity *dl_se);
 extern void init_dl_inactive_task_timer(struct sched_dl_entity *dl_se);
 
+extern void dl_server_update(struct sched_dl_entity *dl_se, s64 delta_exec);
+extern void dl_server_start(struct sched_dl_entity *dl_se);
+extern void dl_server_stop(struct sched_dl_entity *dl_se);
+extern void dl_server_init(struct sched_dl_entity *dl_se, struct rq *rq,
+			   u64 runtime, u64 period,
+			   dl_server_has_tasks_f has_tasks,
+			   dl_server_pick_f pick);
+extern int dl_server_apply_params(struct sched_dl_entity *dl_se,
+				  u64 runtime, u64 period);
+extern void fair_server_init(struct rq *rq);
+
 #define BW_SHIFT		20
 #define BW_UNIT			(1 << BW_SHIFT)
 #define RATIO_SHIFT		8
@@ -2829,6 +2889,8 @@ static inline u64 irq_time_read(int cpu)
 #ifdef CONFIG_CPU_FREQ
 DECLARE_PER_CPU(struct update_util_data __rcu *, cpufreq_update_util_data);
 
+extern unsigned long cpufreq_get_util_hint(int cpu, u64 time);
+
 /**
  * cpufreq_update_util - Take a note about CPU utilization changes.
  * @rq: Runqueue to carry out the update for.
@@ -226,10 +226,36 @@ static inline void sched_info_dequeue(struct rq *rq, struct task_struct *t)
 	delta = rq_clock(rq) - t->sched_info.last_queued;
 	t->sched_info.last_queued = 0;
 	t->sched_info.run_delay += delta;
+	if (t->sched_info.wakeup_pending)
+		t->sched_info.wakeup_delay += delta;
 
 	rq_sched_info_dequeue(rq, delta);
 }
 
+/*
+ * Count the wakeup latency in the histograms of the task and of its task
+ * groups. It is charged to every ancestor like cpuacct charges cputime, so
+ * that reading a group needs no walk and nothing is lost when a child group
+ * goes away.
+ */
+static inline void sched_info_wakeup_account(struct task_struct *t,
+					     unsigned long long delta)
+{
+	unsigned int bucket;
+#ifdef CONFIG_CGROUP_SCHED
+	struct task_group *tg;
+#endif
+
+	bucket = min_t(unsigned int, fls64(delta >> SCHED_WAKEUP_HIST_SHIFT),
+		       SCHED_WAKEUP_HIST_BUCKETS - 1);
+	t->sched_info.wakeup_hist[bucket]++;
+
+#ifdef CONFIG_CGROUP_SCHED
+	for (tg = task_group(t); tg; tg = tg->parent)
+		__this_cpu_inc(tg->wakeup_hist->count[bucket]);
+#endif
+}
+
 /*
  * Called when a task finally hits the CPU.  We can now calculate how
  * long it was waiting to run.  We also note when it began so that we
@@ -249,6 +275,11 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.last_arrival = now;
 	t->sched_info.pcount++;
 
+	if (t->sched_info.wakeup_pending) {
+		t->sched_info.wakeup_pending = 0;
+		sched_info_wakeup_account(t, t->sched_info.wakeup_delay + delta);
+	}
+
 	rq_sched_info_arrive(rq, delta);
 }
 
@@ -263,6 +294,17 @@ static inline void sched_info_enqueue(struct rq *rq, struct task_struct *t)
 		t->sched_info.last_queued = rq_clock(rq);
 }
 
+/*
+ * Called from enqueue_task() for wakeups, after sched_info_enqueue(). The
+ * latency is counted when the task hits the CPU, including the time spent
+ * queued on other runqueues if it is migrated in between.
+ */
+static inline void sched_info_wakeup(struct task_struct *t)
+{
+	t->sched_info.wakeup_pending = 1;
+	t->sched_info.wakeup_delay = 0;
+}
+
 /*
  * Called when a process ceases being the active-running process involuntarily
  * due, typically, to expiring its time slice (this may also be called when
@@ -304,6 +346,7 @@ sched_info_switch(struct rq *rq, struct task_struct *prev, struct task_struct *n
 #else /* !CONFIG_SCHED_INFO: */
 # define sched_info_enqueue(rq, t)	do { } while (0)
 # define sched_info_dequeue(rq, t)	do { } while (0)
+# define sched_info_wakeup(t)		do { } while (0)
 # define sched_info_switch(rq, t, next)	do { } while (0)
 #endif /* CONFIG_SCHED_INFO */
 
@@ -475,6 +475,10 @@ static void free_rootdomain(struct rcu_head *rcu)
 	cpupri_cleanup(&rd->cpupri);
 	cpudl_cleanup(&rd->cpudl);
 	free_cpumask_var(rd->dlo_mask);
+#ifdef HAVE_RT_PUSH_IPI
+	free_cpumask_var(rd->rto_scope);
+	free_cpumask_var(rd->rto_pull_mask);
+#endif
 	free_cpumask_var(rd->rto_mask);
 	free_cpumask_var(rd->online);
 	free_cpumask_var(rd->span);
@@ -544,6 +548,11 @@ static int init_rootdomain(struct root_domain *rd)
 		goto free_dlo_mask;
 
 #ifdef HAVE_RT_PUSH_IPI
+	if (!zalloc_cpumask_var(&rd->rto_pull_mask, GFP_KERNEL))
+		goto free_rto_mask;
+	if (!zalloc_cpumask_var(&rd->rto_scope, GFP_KERNEL))
+		goto free_rto_pull_mask;
+
 	rd->rto_cpu = -1;
 	raw_spin_lock_init(&rd->rto_lock);
 	rd->rto_push_work = IRQ_WORK_INIT_HARD(rto_push_irq_work_func);
@@ -552,7 +561,7 @@ static int init_rootdomain(struct root_domain *rd)
 	rd->visit_gen = 0;
 	init_dl_bw(&rd->dl_bw);
 	if (cpudl_init(&rd->cpudl) != 0)
-		goto free_rto_mask;
+		goto free_rto_scope;
 
 	if (cpupri_init(&rd->cpupri) != 0)
 		goto free_cpudl;
@@ -560,6 +569,12 @@ static int init_rootdomain(struct root_domain *rd)
 
 free_cpudl:
 	cpudl_cleanup(&rd->cpudl);
+free_rto_scope:
+#ifdef HAVE_RT_PUSH_IPI
+	free_cpumask_var(rd->rto_scope);
+free_rto_pull_mask:
+	free_cpumask_var(rd->rto_pull_mask);
+#endif
 free_rto_mask:
 	free_cpumask_var(rd->rto_mask);
 free_dlo_mask:
@@ -1641,6 +1656,8 @@ sd_init(struct sched_domain_topology_level *tl,
 		sd->shared = *per_cpu_ptr(sdd->sds, sd_id);
 		atomic_inc(&sd->shared->ref);
 		atomic_set(&sd->shared->nr_busy_cpus, sd_weight);
+		/* Stale idle bits are fine, select_idle_cpu() checks them */
+		cpumask_copy(sds_idle_cpus(sd->shared), sd_span);
 	}
 
 	sd->private = sdd;
@@ -2106,7 +2123,8 @@ static int __sdt_alloc(const struct cpumask *cpu_map)
 
 			*per_cpu_ptr(sdd->sd, j) = sd;
 
-			sds = kzalloc_node(sizeof(struct sched_domain_shared),
+			sds = kzalloc_node(sizeof(struct sched_domain_shared) +
+					cpumask_size(),
 					GFP_KERNEL, cpu_to_node(j));
 			if (!sds)
 				return -ENOMEM;
@@ -2635,6 +2653,41 @@ void partition_sched_domains_locked(int ndoms_new, cpumask_var_t doms_new[],
 	update_sched_domain_debugfs();
 }
 
+/*
+ * Return whether the 'ndoms_new' cpumasks in doms_new[] and their
+ * attributes match the current sched domain partitioning, in any order,
+ * i.e. partition_sched_domains_locked() would neither destroy nor build a
+ * domain.  A NULL doms_new[] never matches, and the topology changes
+ * reported by the architecture are not accounted for: the callers asking
+ * for a rebuild after those must not skip it.
+ *
+ * Call with hotplug lock and sched_domains_mutex held
+ */
+bool sched_domains_unchanged_locked(int ndoms_new, cpumask_var_t doms_new[],
+				    struct sched_domain_attr *dattr_new)
+{
+	int i, j;
+
+	lockdep_assert_held(&sched_domains_mutex);
+
+	if (!doms_new || doms_cur == &fallback_doms || ndoms_new != ndoms_cur)
+		return false;
+
+	/* The domains don't overlap, each one can only match once */
+	for (i = 0; i < ndoms_new; i++) {
+		for (j = 0; j < ndoms_cur; j++) {
+			if (cpumask_equal(doms_new[i], doms_cur[j]) &&
+			    dattrs_equal(dattr_new, i, dattr_cur, j))
+				goto match;
+		}
+		return false;
+match:
+		;
+	}
+
+	return true;
+}
+
 /*
  * Call with hotplug lock held
  */
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0 OR MIT
+/*
+ * Batches of ChaCha20Poly1305 messages sharing a key
+ *
+ * Callers holding several messages under the same key, like the WireGuard
+ * encryption workers with the packets of a peer, hand them over at once, so
+ * that implementations working on several messages in parallel can keep all
+ * their lanes busy. The messages are otherwise processed one after the other.
+ */
+
+#include <crypto/chacha20poly1305.h>
+
+#include <linux/export.h>
+#include <linux/kernel.h>
+
+/**
+ * chacha20poly1305_encrypt_sg_inplace_batch - Encrypt a batch of messages
+ * @reqs: messages, each with its own length and nonce and without associated
+ *	  data, with room for the authentication tag after the plaintext
+ * @nr: number of messages, at most CHACHA20POLY1305_BATCH_MAX
+ * @key: key shared by the messages
+ *
+ * Return: true when all the messages were encrypted, false otherwise.
+ */
+bool chacha20poly1305_encrypt_sg_inplace_batch(struct chacha20poly1305_sg_req *reqs,
+					       unsigned int nr,
+					       const u8 key[CHACHA20POLY1305_KEY_SIZE])
+{
+	bool ret = true;
+	unsigned int i;
+
+	if (WARN_ON(nr > CHACHA20POLY1305_BATCH_MAX))
+		return false;
+
+	for (i = 0; i < nr; i++)
+		ret &= chacha20poly1305_encrypt_sg_inplace(reqs[i].src,
+							   reqs[i].src_len,
+							   NULL, 0,
+							   reqs[i].nonce, key);
+	return ret;
+}
+EXPORT_SYMBOL(chacha20poly1305_encrypt_sg_inplace_batch);
@@ -1027,7 +1027,7 @@ static __poll_t vsock_poll(struct file *file, struct socket *sock,
 	poll_wait(file, sk_sleep(sk), wait);
 	mask = 0;
 
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty_lockless(&sk->sk_error_queue))
 		/* Signify that there has been an error on this socket. */
 		mask |= EPOLLERR;
 
@@ -1589,6 +1589,35 @@ static void vsock_update_buffer_size(struct vsock_sock *vsk,
 	vsk->buffer_size = val;
 }
 
+/* The connectible sockets have SOCK_CUSTOM_SOCKOPT set to get their
+ * SOL_SOCKET options here, only to allow SO_ZEROCOPY.
+ */
+static int vsock_connectible_sol_socket_setsockopt(struct socket *sock,
+						   int optname,
+						   sockptr_t optval,
+						   unsigned int optlen)
+{
+	struct sock *sk = sock->sk;
+	int val;
+
+	if (optname != SO_ZEROCOPY)
+		return sock_setsockopt(sock, SOL_SOCKET, optname, optval,
+				       optlen);
+
+	if (optlen < sizeof(val))
+		return -EINVAL;
+	if (copy_from_sockptr(&val, optval, sizeof(val)))
+		return -EFAULT;
+	if (val < 0 || val > 1)
+		return -EINVAL;
+
+	lock_sock(sk);
+	sock_valbool_flag(sk, SOCK_ZEROCOPY, val);
+	release_sock(sk);
+
+	return 0;
+}
+
 static int vsock_connectible_setsockopt(struct socket *sock,
 					int level,
 					int optname,
@@ -1601,6 +1630,10 @@ static int vsock_connectible_setsockopt(struct socket *sock,
 	const struct vsock_transport *transport;
 	u64 val;
 
+	if (level == SOL_SOCKET)
+		return vsock_connectible_sol_socket_setsockopt(sock, optname,
+							       optval, optlen);
+
 	if (level != AF_VSOCK)
 		return -ENOPROTOOPT;
 
@@ -2096,6 +2129,12 @@ vsock_connectible_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	int err;
 
 	sk = sock->sk;
+
+	/* MSG_ZEROCOPY completions */
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sk, msg, len, SOL_VSOCK,
+					  VSOCK_RECVERR);
+
 	vsk = vsock_sk(sk);
 	err = 0;
 
@@ -2230,9 +2269,11 @@ static int vsock_create(struct net *net, struct socket *sock,
 		break;
 	case SOCK_STREAM:
 		sock->ops = &vsock_stream_ops;
+		set_bit(SOCK_CUSTOM_SOCKOPT, &sock->flags);
 		break;
 	case SOCK_SEQPACKET:
 		sock->ops = &vsock_seqpacket_ops;
+		set_bit(SOCK_CUSTOM_SOCKOPT, &sock->flags);
 		break;
 	default:
 		return -ESOCKTNOSUPPORT;
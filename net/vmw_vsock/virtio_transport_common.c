@@ -37,15 +37,63 @@ virtio_transport_get_ops(struct vsock_sock *vsk)
 	return container_of(t, struct virtio_transport, transport);
 }
 
+/* Pin the pages of a MSG_ZEROCOPY payload instead of copying it. The
+ * sender is notified once the packet is freed. Returns the number of bytes
+ * pinned, less than @len if the message buffer is scattered.
+ */
+static ssize_t virtio_transport_pin_msg(struct virtio_vsock_pkt *pkt,
+					struct msghdr *msg, size_t len)
+{
+	struct sock *sk = sk_vsock(pkt->vsk);
+	struct page **pages = NULL;
+	size_t off;
+	ssize_t n;
+
+	pkt->uarg = msg_zerocopy_realloc(sk, len, NULL);
+	if (!pkt->uarg)
+		return -ENOBUFS;
+
+	n = iov_iter_get_pages_alloc2(&msg->msg_iter, &pages, len, &off);
+	if (n <= 0) {
+		net_zcopy_put_abort(pkt->uarg, true);
+		pkt->uarg = NULL;
+		return n ? n : -EFAULT;
+	}
+
+	pkt->pages = pages;
+	pkt->nr_pages = DIV_ROUND_UP(off + n, PAGE_SIZE);
+	pkt->page_off = off;
+
+	return n;
+}
+
+/* The transport copies the payload, tell the sender it can reuse it */
+static int virtio_transport_msg_copied(struct sock *sk, size_t len)
+{
+	struct ubuf_info *uarg;
+
+	uarg = msg_zerocopy_realloc(sk, len, NULL);
+	if (!uarg)
+		return -ENOBUFS;
+
+	uarg_to_msgzc(uarg)->zerocopy = 0;
+	net_zcopy_put(uarg);
+
+	return 0;
+}
+
 static struct virtio_vsock_pkt *
 virtio_transport_alloc_pkt(struct virtio_vsock_pkt_info *info,
 			   size_t len,
+			   bool msgzerocopy,
 			   u32 src_cid,
 			   u32 src_port,
 			   u32 dst_cid,
 			   u32 dst_port)
 {
 	struct virtio_vsock_pkt *pkt;
+	bool zerocopy = false;
+	ssize_t pinned;
 	int err;
 
 	pkt = kzalloc(sizeof(*pkt), GFP_KERNEL);
@@ -64,7 +112,20 @@ virtio_transport_alloc_pkt(struct virtio_vsock_pkt_info *info,
 	pkt->reply		= info->reply;
 	pkt->vsk		= info->vsk;
 
-	if (info->msg && len > 0) {
+	if (info->msg && len > 0 && info->vsk &&
+	    (info->msg->msg_flags & MSG_ZEROCOPY) &&
+	    sock_flag(sk_vsock(info->vsk), SOCK_ZEROCOPY))
+		zerocopy = true;
+
+	if (zerocopy && msgzerocopy && user_backed_iter(&info->msg->msg_iter)) {
+		pinned = virtio_transport_pin_msg(pkt, info->msg, len);
+		if (pinned < 0)
+			goto out_pkt;
+
+		len = pinned;
+		pkt->len = len;
+		pkt->hdr.len = cpu_to_le32(len);
+	} else if (info->msg && len > 0) {
 		pkt->buf = kmalloc(len, GFP_KERNEL);
 		if (!pkt->buf)
 			goto out_pkt;
@@ -75,6 +136,12 @@ virtio_transport_alloc_pkt(struct virtio_vsock_pkt_info *info,
 		if (err)
 			goto out;
 
+		if (zerocopy &&
+		    virtio_transport_msg_copied(sk_vsock(info->vsk), len))
+			goto out;
+	}
+
+	if (info->msg && len > 0) {
 		if (msg_data_left(info->msg) == 0 &&
 		    info->type == VIRTIO_VSOCK_TYPE_SEQPACKET) {
 			pkt->hdr.flags |= cpu_to_le32(VIRTIO_VSOCK_SEQ_EOM);
@@ -114,7 +181,6 @@ static struct sk_buff *virtio_transport_build_skb(void *opaque)
 	 * care of the offset in the original packet.
 	 */
 	payload_len = le32_to_cpu(pkt->hdr.len);
-	payload_buf = pkt->buf + pkt->off;
 
 	skb = alloc_skb(sizeof(*hdr) + sizeof(pkt->hdr) + payload_len,
 			GFP_ATOMIC);
@@ -156,8 +222,23 @@ static struct sk_buff *virtio_transport_build_skb(void *opaque)
 
 	skb_put_data(skb, &pkt->hdr, sizeof(pkt->hdr));
 
-	if (payload_len) {
-		skb_put_data(skb, payload_buf, payload_len);
+	if (payload_len && !pkt->pages) {
+		skb_put_data(skb, pkt->buf + pkt->off, payload_len);
+	} else if (payload_len) {
+		size_t off = pkt->page_off + pkt->off;
+		size_t copied = 0;
+
+		payload_buf = skb_put(skb, payload_len);
+		while (copied < payload_len) {
+			size_t n = min_t(size_t, payload_len - copied,
+					 PAGE_SIZE - offset_in_page(off));
+
+			memcpy_from_page(payload_buf + copied,
+					 pkt->pages[off >> PAGE_SHIFT],
+					 offset_in_page(off), n);
+			copied += n;
+			off += n;
+		}
 	}
 
 	return skb;
@@ -173,6 +254,44 @@ void virtio_transport_deliver_tap_pkt(struct virtio_vsock_pkt *pkt)
 }
 EXPORT_SYMBOL_GPL(virtio_transport_deliver_tap_pkt);
 
+/**
+ * virtio_transport_pkt_copy - Copy the payload of a packet
+ * @pkt: packet
+ * @off: offset in the payload
+ * @len: number of bytes to copy
+ * @to: destination
+ *
+ * The payload is either in the buffer of the packet or, for MSG_ZEROCOPY,
+ * in the pinned pages of the sender.
+ *
+ * Return: the number of bytes copied.
+ */
+size_t virtio_transport_pkt_copy(struct virtio_vsock_pkt *pkt, size_t off,
+				 size_t len, struct iov_iter *to)
+{
+	size_t copied = 0;
+
+	if (!pkt->pages)
+		return copy_to_iter(pkt->buf + off, len, to);
+
+	off += pkt->page_off;
+	while (copied < len) {
+		size_t n = min_t(size_t, len - copied,
+				 PAGE_SIZE - offset_in_page(off));
+		size_t ret;
+
+		ret = copy_page_to_iter(pkt->pages[off >> PAGE_SHIFT],
+					offset_in_page(off), n, to);
+		copied += ret;
+		off += ret;
+		if (ret != n)
+			break;
+	}
+
+	return copied;
+}
+EXPORT_SYMBOL_GPL(virtio_transport_pkt_copy);
+
 static u16 virtio_transport_get_type(struct sock *sk)
 {
 	if (sk->sk_type == SOCK_STREAM)
@@ -224,7 +343,7 @@ static int virtio_transport_send_pkt_info(struct vsock_sock *vsk,
 	if (pkt_len == 0 && info->op == VIRTIO_VSOCK_OP_RW)
 		return pkt_len;
 
-	pkt = virtio_transport_alloc_pkt(info, pkt_len,
+	pkt = virtio_transport_alloc_pkt(info, pkt_len, t_ops->msgzerocopy,
 					 src_cid, src_port,
 					 dst_cid, dst_port);
 	if (!pkt) {
@@ -232,6 +351,10 @@ static int virtio_transport_send_pkt_info(struct vsock_sock *vsk,
 		return -ENOMEM;
 	}
 
+	/* A scattered MSG_ZEROCOPY buffer is sent in several packets */
+	if (pkt->len < pkt_len)
+		virtio_transport_put_credit(vvs, pkt_len - pkt->len);
+
 	virtio_transport_inc_tx_pkt(vvs, pkt);
 
 	return t_ops->send_pkt(pkt);
@@ -838,7 +961,7 @@ static int virtio_transport_reset_no_sock(const struct virtio_transport *t,
 	if (le16_to_cpu(pkt->hdr.op) == VIRTIO_VSOCK_OP_RST)
 		return 0;
 
-	reply = virtio_transport_alloc_pkt(&info, 0,
+	reply = virtio_transport_alloc_pkt(&info, 0, false,
 					   le64_to_cpu(pkt->hdr.dst_cid),
 					   le32_to_cpu(pkt->hdr.dst_port),
 					   le64_to_cpu(pkt->hdr.src_cid),
@@ -1339,6 +1462,12 @@ EXPORT_SYMBOL_GPL(virtio_transport_recv_pkt);
 
 void virtio_transport_free_pkt(struct virtio_vsock_pkt *pkt)
 {
+	if (pkt->pages) {
+		release_pages(pkt->pages, pkt->nr_pages);
+		kvfree(pkt->pages);
+		/* Notify the sender that it can reuse its buffer */
+		net_zcopy_put(pkt->uarg);
+	}
 	kvfree(pkt->buf);
 	kfree(pkt);
 }
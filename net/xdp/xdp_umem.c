@@ -57,6 +57,7 @@ static void xdp_umem_release(struct xdp_umem *umem)
 	umem->zc = false;
 	ida_free(&umem_ida, umem->id);
 
+	xp_dma_flush_umem(umem);
 	xdp_umem_addr_unmap(umem);
 	xdp_umem_unpin_pages(umem);
 
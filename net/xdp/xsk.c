@@ -40,6 +40,7 @@ void xsk_set_rx_need_wakeup(struct xsk_buff_pool *pool)
 		return;
 
 	pool->fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+	pool->fq->wakeups_required++;
 	pool->cached_need_wakeup |= XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_set_rx_need_wakeup);
@@ -54,6 +55,7 @@ void xsk_set_tx_need_wakeup(struct xsk_buff_pool *pool)
 	rcu_read_lock();
 	list_for_each_entry_rcu(xs, &pool->xsk_tx_list, tx_list) {
 		xs->tx->ring->flags |= XDP_RING_NEED_WAKEUP;
+		xs->tx->wakeups_required++;
 	}
 	rcu_read_unlock();
 
@@ -134,14 +136,15 @@ int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 	return 0;
 }
 
-static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
+			u32 flags)
 {
 	struct xdp_buff_xsk *xskb = container_of(xdp, struct xdp_buff_xsk, xdp);
 	u64 addr;
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, flags);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -169,14 +172,82 @@ static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+/* Copy a packet that does not fit in one buffer, or that has fragments, to
+ * as many buffers as needed. The descriptors of all but the last buffer get
+ * XDP_PKT_CONTD. The packet is dropped rather than partially received when
+ * there is not enough room for all of it.
+ */
+static int __xsk_rcv_sg(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
+			u32 frame_size)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	struct xdp_buff *bufs[XSK_DESC_MAX_FRAGS];
+	u32 nb_bufs, copied, copy, i, frag = 0;
+	void *src = xdp->data;
+	u32 src_len = xdp->data_end - xdp->data;
+
+	nb_bufs = DIV_ROUND_UP(len, frame_size);
+	if (nb_bufs > XSK_DESC_MAX_FRAGS) {
+		xs->rx_dropped++;
+		return -ENOSPC;
+	}
+
+	if (xskq_prod_nb_free(xs->rx, nb_bufs) < nb_bufs) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
+	}
+
+	for (i = 0; i < nb_bufs; i++) {
+		bufs[i] = xsk_buff_alloc(xs->pool);
+		if (!bufs[i]) {
+			while (i--)
+				xsk_buff_free(bufs[i]);
+			xs->rx_dropped++;
+			return -ENOMEM;
+		}
+	}
+
+	/* Only the metadata, the data is copied below */
+	xsk_copy_xdp(bufs[0], xdp, 0);
+
+	for (i = 0; i < nb_bufs; i++) {
+		u32 buf_len = min(frame_size, len - i * frame_size);
+		void *dst = bufs[i]->data;
+
+		for (copied = 0; copied < buf_len; copied += copy) {
+			while (!src_len) {
+				skb_frag_t *f = &sinfo->frags[frag++];
+
+				src = skb_frag_address(f);
+				src_len = skb_frag_size(f);
+			}
+
+			copy = min(buf_len - copied, src_len);
+			memcpy(dst + copied, src, copy);
+			src += copy;
+			src_len -= copy;
+		}
+
+		/* Can't fail, the room was checked above */
+		__xsk_rcv_zc(xs, bufs[i], buf_len,
+			     i < nb_bufs - 1 ? XDP_PKT_CONTD : 0);
+	}
+
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
+	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
 	struct xdp_buff *xsk_xdp;
 	int err;
 	u32 len;
 
-	len = xdp->data_end - xdp->data;
-	if (len > xsk_pool_get_rx_frame_size(xs->pool)) {
+	len = xdp_get_buff_len(xdp);
+	if (unlikely(len > frame_size || xdp_buff_has_frags(xdp))) {
+		if (xs->rx->sg)
+			return __xsk_rcv_sg(xs, xdp, len, frame_size);
+
 		xs->rx_dropped++;
 		return -ENOSPC;
 	}
@@ -188,7 +259,7 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 	}
 
 	xsk_copy_xdp(xsk_xdp, xdp, len);
-	err = __xsk_rcv_zc(xs, xsk_xdp, len);
+	err = __xsk_rcv_zc(xs, xsk_xdp, len, 0);
 	if (err) {
 		xsk_buff_free(xsk_xdp);
 		return err;
@@ -237,6 +308,7 @@ int xsk_generic_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
 	int err;
 
+	xs = xsk_map_fanout_select(xs, xdp);
 	spin_lock_bh(&xs->rx_lock);
 	err = xsk_rcv_check(xs, xdp);
 	if (!err) {
@@ -258,7 +330,7 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 
 	if (xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL) {
 		len = xdp->data_end - xdp->data;
-		return __xsk_rcv_zc(xs, xdp, len);
+		return __xsk_rcv_zc(xs, xdp, len, 0);
 	}
 
 	err = __xsk_rcv(xs, xdp);
@@ -272,6 +344,7 @@ int __xsk_map_redirect(struct xdp_sock *xs, struct xdp_buff *xdp)
 	struct list_head *flush_list = this_cpu_ptr(&xskmap_flush_list);
 	int err;
 
+	xs = xsk_map_fanout_select(xs, xdp);
 	err = xsk_rcv(xs, xdp);
 	if (err)
 		return err;
@@ -404,6 +477,11 @@ static int xsk_wakeup(struct xdp_sock *xs, u8 flags)
 {
 	struct net_device *dev = xs->dev;
 
+	if ((flags & XDP_WAKEUP_RX) && xs->pool->fq)
+		xs->pool->fq->wakeups_issued++;
+	if ((flags & XDP_WAKEUP_TX) && xs->tx)
+		xs->tx->wakeups_issued++;
+
 	return dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
 }
 
@@ -420,15 +498,38 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Addresses to complete for an skb built from several descriptors */
+struct xsk_tx_addrs {
+	u32 nb_addrs;
+	u64 addrs[];
+};
+
+static void xsk_destruct_skb_sg(struct sk_buff *skb)
+{
+	struct xsk_tx_addrs *tx_addrs = skb_shinfo(skb)->destructor_arg;
+	struct xdp_sock *xs = xdp_sk(skb->sk);
+	unsigned long flags;
+	u32 i;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	for (i = 0; i < tx_addrs->nb_addrs; i++)
+		xskq_prod_submit_addr(xs->pool->cq, tx_addrs->addrs[i]);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+
+	kfree(tx_addrs);
+	sock_wfree(skb);
+}
+
 static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
-					      struct xdp_desc *desc)
+					      struct xdp_desc *descs,
+					      u32 nb_descs)
 {
 	struct xsk_buff_pool *pool = xs->pool;
-	u32 hr, len, ts, offset, copy, copied;
+	u32 hr, len, ts, offset, copy, copied, d;
 	struct sk_buff *skb;
 	struct page *page;
 	void *buffer;
-	int err, i;
+	int err, i = 0;
 	u64 addr;
 
 	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
@@ -439,86 +540,137 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 
 	skb_reserve(skb, hr);
 
-	addr = desc->addr;
-	len = desc->len;
-	ts = pool->unaligned ? len : pool->chunk_size;
+	for (d = 0; d < nb_descs; d++) {
+		addr = descs[d].addr;
+		len = descs[d].len;
+		ts = pool->unaligned ? len : pool->chunk_size;
 
-	buffer = xsk_buff_raw_get_data(pool, addr);
-	offset = offset_in_page(buffer);
-	addr = buffer - pool->addrs;
+		buffer = xsk_buff_raw_get_data(pool, addr);
+		offset = offset_in_page(buffer);
+		addr = buffer - pool->addrs;
 
-	for (copied = 0, i = 0; copied < len; i++) {
-		page = pool->umem->pgs[addr >> PAGE_SHIFT];
-		get_page(page);
+		for (copied = 0; copied < len; i++) {
+			if (unlikely(i >= MAX_SKB_FRAGS)) {
+				kfree_skb(skb);
+				return ERR_PTR(-EOVERFLOW);
+			}
 
-		copy = min_t(u32, PAGE_SIZE - offset, len - copied);
-		skb_fill_page_desc(skb, i, page, offset, copy);
+			page = pool->umem->pgs[addr >> PAGE_SHIFT];
+			get_page(page);
 
-		copied += copy;
-		addr += copy;
-		offset = 0;
-	}
+			copy = min_t(u32, PAGE_SIZE - offset, len - copied);
+			skb_fill_page_desc(skb, i, page, offset, copy);
+
+			copied += copy;
+			addr += copy;
+			offset = 0;
+		}
 
-	skb->len += len;
-	skb->data_len += len;
-	skb->truesize += ts;
+		skb->len += len;
+		skb->data_len += len;
+		skb->truesize += ts;
 
-	refcount_add(ts, &xs->sk.sk_wmem_alloc);
+		refcount_add(ts, &xs->sk.sk_wmem_alloc);
+	}
 
 	return skb;
 }
 
 static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
-				     struct xdp_desc *desc)
+				     struct xdp_desc *descs, u32 nb_descs)
 {
+	struct xsk_tx_addrs *tx_addrs = NULL;
 	struct net_device *dev = xs->dev;
 	struct sk_buff *skb;
+	u32 i;
+
+	if (nb_descs > 1) {
+		tx_addrs = kmalloc(struct_size(tx_addrs, addrs, nb_descs),
+				   GFP_KERNEL);
+		if (!tx_addrs)
+			return ERR_PTR(-ENOMEM);
+	}
 
 	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
-		skb = xsk_build_skb_zerocopy(xs, desc);
-		if (IS_ERR(skb))
+		skb = xsk_build_skb_zerocopy(xs, descs, nb_descs);
+		if (IS_ERR(skb)) {
+			kfree(tx_addrs);
 			return skb;
+		}
 	} else {
-		u32 hr, tr, len;
+		u32 hr, tr, len = 0, offset = 0;
 		void *buffer;
 		int err;
 
 		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
 		tr = dev->needed_tailroom;
-		len = desc->len;
+		for (i = 0; i < nb_descs; i++)
+			len += descs[i].len;
 
 		skb = sock_alloc_send_skb(&xs->sk, hr + len + tr, 1, &err);
-		if (unlikely(!skb))
+		if (unlikely(!skb)) {
+			kfree(tx_addrs);
 			return ERR_PTR(err);
+		}
 
 		skb_reserve(skb, hr);
 		skb_put(skb, len);
 
-		buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		if (unlikely(err)) {
-			kfree_skb(skb);
-			return ERR_PTR(err);
+		for (i = 0; i < nb_descs; i++) {
+			buffer = xsk_buff_raw_get_data(xs->pool, descs[i].addr);
+			err = skb_store_bits(skb, offset, buffer, descs[i].len);
+			if (unlikely(err)) {
+				kfree_skb(skb);
+				kfree(tx_addrs);
+				return ERR_PTR(err);
+			}
+			offset += descs[i].len;
 		}
 	}
 
 	skb->dev = dev;
 	skb->priority = xs->sk.sk_priority;
 	skb->mark = xs->sk.sk_mark;
-	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
-	skb->destructor = xsk_destruct_skb;
+	if (tx_addrs) {
+		tx_addrs->nb_addrs = nb_descs;
+		for (i = 0; i < nb_descs; i++)
+			tx_addrs->addrs[i] = descs[i].addr;
+		skb_shinfo(skb)->destructor_arg = tx_addrs;
+		skb->destructor = xsk_destruct_skb_sg;
+	} else {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)descs->addr;
+		skb->destructor = xsk_destruct_skb;
+	}
 
 	return skb;
 }
 
+/* Peek the descriptors of the next packet to send, returns their number */
+static u32 xsk_generic_peek_pkt(struct xdp_sock *xs, struct xdp_desc *descs)
+{
+	int nb_descs;
+
+	if (!xs->tx->sg)
+		return xskq_cons_peek_desc(xs->tx, descs, xs->pool) ? 1 : 0;
+
+	/* Invalid packets are skipped */
+	do {
+		nb_descs = xskq_cons_peek_pkt(xs->tx, descs, XSK_DESC_MAX_FRAGS,
+					      xs->pool);
+	} while (nb_descs < 0);
+
+	return nb_descs;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
 	struct xdp_sock *xs = xdp_sk(sk);
+	struct xdp_desc descs[XSK_DESC_MAX_FRAGS];
 	u32 max_batch = TX_BATCH_SIZE;
 	bool sent_frame = false;
-	struct xdp_desc desc;
 	struct sk_buff *skb;
 	unsigned long flags;
+	u32 nb_descs;
 	int err = 0;
 
 	mutex_lock(&xs->mutex);
@@ -532,7 +684,7 @@ static int xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
+	while ((nb_descs = xsk_generic_peek_pkt(xs, descs))) {
 		if (max_batch-- == 0) {
 			err = -EAGAIN;
 			goto out;
@@ -544,27 +696,37 @@ static int xsk_generic_xmit(struct sock *sk)
 		 * any buffering in the Tx path.
 		 */
 		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
+		if (xskq_prod_nb_free(xs->pool->cq, nb_descs) < nb_descs) {
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 			goto out;
 		}
+		xs->pool->cq->cached_prod += nb_descs;
 		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 
-		skb = xsk_build_skb(xs, &desc);
+		skb = xsk_build_skb(xs, descs, nb_descs);
 		if (IS_ERR(skb)) {
 			err = PTR_ERR(skb);
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			xskq_prod_cancel_n(xs->pool->cq, nb_descs);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+			if (err != -EOVERFLOW)
+				goto out;
+
+			/* More fragments than an skb holds, drop the packet */
+			xs->tx->invalid_descs += nb_descs;
+			xskq_cons_release_n(xs->tx, nb_descs);
+			err = 0;
+			continue;
 		}
 
 		err = __dev_direct_xmit(skb, xs->queue_id);
 		if  (err == NETDEV_TX_BUSY) {
 			/* Tell user-space to retry the send */
+			if (skb->destructor == xsk_destruct_skb_sg)
+				kfree(skb_shinfo(skb)->destructor_arg);
 			skb->destructor = sock_wfree;
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			xskq_prod_cancel_n(xs->pool->cq, nb_descs);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 			/* Free skb without triggering the perf drop trace */
 			consume_skb(skb);
@@ -572,7 +734,7 @@ static int xsk_generic_xmit(struct sock *sk)
 			goto out;
 		}
 
-		xskq_cons_release(xs->tx);
+		xskq_cons_release_n(xs->tx, nb_descs);
 		/* Ignore NET_XMIT_CN as packet might have been sent */
 		if (err == NET_XMIT_DROP) {
 			/* SKB completed but not sent */
@@ -889,9 +1051,13 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG))
 		return -EINVAL;
 
+	/* Multi-buffer packets are only supported in copy mode */
+	if ((flags & XDP_USE_SG) && (flags & XDP_ZEROCOPY))
+		return -EOPNOTSUPP;
+
 	rtnl_lock();
 	mutex_lock(&xs->mutex);
 	if (xs->state != XSK_READY) {
@@ -942,6 +1108,12 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			goto out_unlock;
 		}
 
+		if ((flags & XDP_USE_SG) && umem_xs->zc) {
+			err = -EOPNOTSUPP;
+			sockfd_put(sock);
+			goto out_unlock;
+		}
+
 		if (umem_xs->queue_id != qid || umem_xs->dev != dev) {
 			/* Share the umem with another socket on another qid
 			 * and/or device.
@@ -1002,6 +1174,9 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			goto out_unlock;
 		}
 
+		/* Multi-buffer packets are only supported in copy mode */
+		if (flags & XDP_USE_SG)
+			flags |= XDP_COPY;
 		err = xp_assign_dev(xs->pool, dev, qid, flags);
 		if (err) {
 			xp_destroy(xs->pool);
@@ -1017,6 +1192,10 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 	xs->dev = dev;
 	xs->zc = xs->umem->zc;
 	xs->queue_id = qid;
+	if (xs->rx)
+		xs->rx->sg = flags & XDP_USE_SG;
+	if (xs->tx)
+		xs->tx->sg = flags & XDP_USE_SG;
 	xp_add_xsk(xs->pool, xs);
 
 out_unlock:
@@ -1355,6 +1534,7 @@ static int xsk_notifier(struct notifier_block *this,
 			mutex_unlock(&xs->mutex);
 		}
 		mutex_unlock(&net->xdp.lock);
+		xp_dma_flush_netdev(dev);
 		break;
 	}
 	return NOTIFY_DONE;
@@ -44,5 +44,9 @@ void xsk_map_try_sock_delete(struct xsk_map *map, struct xdp_sock *xs,
 void xsk_clear_pool_at_qid(struct net_device *dev, u16 queue_id);
 int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 			u16 queue_id);
+struct xdp_sock *xsk_map_fanout_select(struct xdp_sock *xs,
+				       struct xdp_buff *xdp);
+void xp_dma_flush_umem(struct xdp_umem *umem);
+void xp_dma_flush_netdev(struct net_device *netdev);
 
 #endif /* XSK_H_ */
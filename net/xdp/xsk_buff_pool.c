@@ -282,12 +282,33 @@ bool xp_put_pool(struct xsk_buff_pool *pool)
 	return false;
 }
 
-static struct xsk_dma_map *xp_find_dma_map(struct xsk_buff_pool *pool)
+/* The DMA mappings of a umem are cached per device. A mapping without any
+ * user is kept on xsk_dma_idle_list until the umem is released or its
+ * netdev goes away, so binding again to the same device only costs a
+ * lookup. The mappings are protected by the RTNL lock, which all the
+ * callers of xp_dma_map() and xp_dma_unmap() hold.
+ */
+struct xsk_dma_cache_entry {
+	struct xsk_dma_map map;
+	struct list_head idle_node;
+	unsigned long attrs;
+	u32 nr_mapped;
+};
+
+static LIST_HEAD(xsk_dma_idle_list);
+
+static struct xsk_dma_cache_entry *to_dma_cache_entry(struct xsk_dma_map *map)
+{
+	return container_of(map, struct xsk_dma_cache_entry, map);
+}
+
+static struct xsk_dma_map *xp_find_dma_map(struct xdp_umem *umem,
+					   struct device *dev)
 {
 	struct xsk_dma_map *dma_map;
 
-	list_for_each_entry(dma_map, &pool->umem->xsk_dma_list, list) {
-		if (dma_map->netdev == pool->netdev)
+	list_for_each_entry(dma_map, &umem->xsk_dma_list, list) {
+		if (dma_map->dev == dev)
 			return dma_map;
 	}
 
@@ -297,32 +318,50 @@ static struct xsk_dma_map *xp_find_dma_map(struct xsk_buff_pool *pool)
 static struct xsk_dma_map *xp_create_dma_map(struct device *dev, struct net_device *netdev,
 					     u32 nr_pages, struct xdp_umem *umem)
 {
+	struct xsk_dma_cache_entry *entry;
 	struct xsk_dma_map *dma_map;
 
-	dma_map = kzalloc(sizeof(*dma_map), GFP_KERNEL);
-	if (!dma_map)
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
 		return NULL;
 
+	dma_map = &entry->map;
 	dma_map->dma_pages = kvcalloc(nr_pages, sizeof(*dma_map->dma_pages), GFP_KERNEL);
 	if (!dma_map->dma_pages) {
-		kfree(dma_map);
+		kfree(entry);
 		return NULL;
 	}
 
+	INIT_LIST_HEAD(&entry->idle_node);
 	dma_map->netdev = netdev;
 	dma_map->dev = dev;
 	dma_map->dma_need_sync = false;
 	dma_map->dma_pages_cnt = nr_pages;
-	refcount_set(&dma_map->users, 1);
+	refcount_set(&dma_map->users, 0);
 	list_add(&dma_map->list, &umem->xsk_dma_list);
 	return dma_map;
 }
 
 static void xp_destroy_dma_map(struct xsk_dma_map *dma_map)
 {
+	struct xsk_dma_cache_entry *entry = to_dma_cache_entry(dma_map);
+
 	list_del(&dma_map->list);
+	list_del(&entry->idle_node);
 	kvfree(dma_map->dma_pages);
-	kfree(dma_map);
+	kfree(entry);
+}
+
+/* Park a mapping without users, still mapped, on the idle list */
+static void xp_dma_cache_put(struct xsk_dma_map *dma_map,
+			     struct net_device *netdev, unsigned long attrs)
+{
+	struct xsk_dma_cache_entry *entry = to_dma_cache_entry(dma_map);
+
+	entry->attrs = attrs;
+	if (netdev)
+		dma_map->netdev = netdev;
+	list_move_tail(&entry->idle_node, &xsk_dma_idle_list);
 }
 
 static void __xp_dma_unmap(struct xsk_dma_map *dma_map, unsigned long attrs)
@@ -350,22 +389,58 @@ void xp_dma_unmap(struct xsk_buff_pool *pool, unsigned long attrs)
 	if (pool->dma_pages_cnt == 0)
 		return;
 
-	dma_map = xp_find_dma_map(pool);
+	dma_map = xp_find_dma_map(pool->umem, pool->dev);
 	if (!dma_map) {
 		WARN(1, "Could not find dma_map for device");
 		return;
 	}
 
-	if (!refcount_dec_and_test(&dma_map->users))
-		return;
+	/* Keep the pages mapped for the next bind to the device */
+	if (refcount_dec_and_test(&dma_map->users))
+		xp_dma_cache_put(dma_map, pool->netdev, attrs);
 
-	__xp_dma_unmap(dma_map, attrs);
 	kvfree(pool->dma_pages);
+	pool->dma_pages = NULL;
 	pool->dma_pages_cnt = 0;
 	pool->dev = NULL;
 }
 EXPORT_SYMBOL(xp_dma_unmap);
 
+/**
+ * xp_dma_flush_umem - Unmap the cached DMA mappings of a umem
+ * @umem: umem being released
+ *
+ * Context: Process context, takes the RTNL lock.
+ */
+void xp_dma_flush_umem(struct xdp_umem *umem)
+{
+	struct xsk_dma_map *dma_map, *tmp;
+
+	rtnl_lock();
+	list_for_each_entry_safe(dma_map, tmp, &umem->xsk_dma_list, list) {
+		WARN_ON_ONCE(refcount_read(&dma_map->users));
+		__xp_dma_unmap(dma_map, to_dma_cache_entry(dma_map)->attrs);
+	}
+	rtnl_unlock();
+}
+
+/**
+ * xp_dma_flush_netdev - Unmap the unused DMA mappings made for a netdev
+ * @netdev: netdev being unregistered
+ *
+ * Context: Process context, with the RTNL lock held.
+ */
+void xp_dma_flush_netdev(struct net_device *netdev)
+{
+	struct xsk_dma_cache_entry *entry, *tmp;
+
+	ASSERT_RTNL();
+	list_for_each_entry_safe(entry, tmp, &xsk_dma_idle_list, idle_node) {
+		if (entry->map.netdev == netdev)
+			__xp_dma_unmap(&entry->map, entry->attrs);
+	}
+}
+
 static void xp_check_dma_contiguity(struct xsk_dma_map *dma_map)
 {
 	u32 i;
@@ -406,13 +481,19 @@ static int xp_init_dma_info(struct xsk_buff_pool *pool, struct xsk_dma_map *dma_
 int xp_dma_map(struct xsk_buff_pool *pool, struct device *dev,
 	       unsigned long attrs, struct page **pages, u32 nr_pages)
 {
+	struct xsk_dma_cache_entry *entry;
 	struct xsk_dma_map *dma_map;
 	dma_addr_t dma;
 	int err;
 	u32 i;
 
-	dma_map = xp_find_dma_map(pool);
-	if (dma_map) {
+	dma_map = xp_find_dma_map(pool->umem, dev);
+	if (!dma_map) {
+		dma_map = xp_create_dma_map(dev, pool->netdev, nr_pages,
+					    pool->umem);
+		if (!dma_map)
+			return -ENOMEM;
+	} else if (refcount_read(&dma_map->users)) {
 		err = xp_init_dma_info(pool, dma_map);
 		if (err)
 			return err;
@@ -421,20 +502,20 @@ int xp_dma_map(struct xsk_buff_pool *pool, struct device *dev,
 		return 0;
 	}
 
-	dma_map = xp_create_dma_map(dev, pool->netdev, nr_pages, pool->umem);
-	if (!dma_map)
-		return -ENOMEM;
-
-	for (i = 0; i < dma_map->dma_pages_cnt; i++) {
+	/* Only map what a cached mapping that failed half way is missing */
+	entry = to_dma_cache_entry(dma_map);
+	for (i = entry->nr_mapped; i < dma_map->dma_pages_cnt; i++) {
 		dma = dma_map_page_attrs(dev, pages[i], 0, PAGE_SIZE,
 					 DMA_BIDIRECTIONAL, attrs);
 		if (dma_mapping_error(dev, dma)) {
-			__xp_dma_unmap(dma_map, attrs);
+			xp_dma_cache_put(dma_map, pool->netdev, attrs);
 			return -ENOMEM;
 		}
 		if (dma_need_sync(dev, dma))
 			dma_map->dma_need_sync = true;
 		dma_map->dma_pages[i] = dma;
+		entry->nr_mapped++;
+		cond_resched();
 	}
 
 	if (pool->unaligned)
@@ -442,10 +523,13 @@ int xp_dma_map(struct xsk_buff_pool *pool, struct device *dev,
 
 	err = xp_init_dma_info(pool, dma_map);
 	if (err) {
-		__xp_dma_unmap(dma_map, attrs);
+		xp_dma_cache_put(dma_map, pool->netdev, attrs);
 		return err;
 	}
 
+	list_del_init(&entry->idle_node);
+	dma_map->netdev = pool->netdev;
+	refcount_set(&dma_map->users, 1);
 	return 0;
 }
 EXPORT_SYMBOL(xp_dma_map);
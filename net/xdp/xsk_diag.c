@@ -89,6 +89,43 @@ static int xsk_diag_put_stats(const struct xdp_sock *xs, struct sk_buff *nlskb)
 	return nla_put(nlskb, XDP_DIAG_STATS, sizeof(du), &du);
 }
 
+static int xsk_diag_put_ring_stats(struct xsk_queue *queue, int nl_type,
+				   struct sk_buff *nlskb)
+{
+	struct xdp_diag_ring_stats drs = {};
+	int i;
+
+	if (!queue)
+		return 0;
+
+	for (i = 0; i < XDP_DIAG_RING_HIST_BUCKETS; i++)
+		drs.occupancy[i] = READ_ONCE(queue->occupancy[i]);
+	drs.stalled_ns = xskq_stall_ns(queue);
+	drs.n_wakeups_required = READ_ONCE(queue->wakeups_required);
+	drs.n_wakeups_issued = READ_ONCE(queue->wakeups_issued);
+	return nla_put(nlskb, nl_type, sizeof(drs), &drs);
+}
+
+static int xsk_diag_put_rings_stats(const struct xdp_sock *xs,
+				    struct sk_buff *nlskb)
+{
+	struct xsk_buff_pool *pool = xs->pool;
+	int err;
+
+	err = xsk_diag_put_ring_stats(xs->rx, XDP_DIAG_RX_RING_STATS, nlskb);
+	if (!err)
+		err = xsk_diag_put_ring_stats(xs->tx, XDP_DIAG_TX_RING_STATS,
+					      nlskb);
+	if (!err && pool)
+		err = xsk_diag_put_ring_stats(pool->fq,
+					      XDP_DIAG_UMEM_FILL_RING_STATS,
+					      nlskb);
+	if (!err && pool)
+		err = xsk_diag_put_ring_stats(pool->cq,
+				XDP_DIAG_UMEM_COMPLETION_RING_STATS, nlskb);
+	return err;
+}
+
 static int xsk_diag_fill(struct sock *sk, struct sk_buff *nlskb,
 			 struct xdp_diag_req *req,
 			 struct user_namespace *user_ns,
@@ -135,6 +172,10 @@ static int xsk_diag_fill(struct sock *sk, struct sk_buff *nlskb,
 	    xsk_diag_put_stats(xs, nlskb))
 		goto out_nlmsg_trim;
 
+	if ((req->xdiag_show & XDP_SHOW_RING_STATS) &&
+	    xsk_diag_put_rings_stats(xs, nlskb))
+		goto out_nlmsg_trim;
+
 	mutex_unlock(&xs->mutex);
 	nlmsg_end(nlskb, nlh);
 	return 0;
@@ -32,6 +32,7 @@ struct xsk_queue *xskq_create(u32 nentries, bool umem_queue)
 
 	q->nentries = nentries;
 	q->ring_mask = nentries - 1;
+	q->hist_shift = ilog2(nentries);
 
 	gfp_flags = GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN |
 		    __GFP_COMP  | __GFP_NORETRY;
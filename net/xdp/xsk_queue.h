@@ -8,6 +8,8 @@
 
 #include <linux/types.h>
 #include <linux/if_xdp.h>
+#include <linux/sched/clock.h>
+#include <linux/xdp_diag.h>
 #include <net/xdp_sock.h>
 #include <net/xsk_buff_pool.h>
 
@@ -45,8 +47,24 @@ struct xsk_queue {
 	struct xdp_ring *ring;
 	u64 invalid_descs;
 	u64 queue_empty_descs;
+	/* Packets may span several descriptors, see XDP_USE_SG */
+	bool sg;
+	/* Diagnostics, see struct xdp_diag_ring_stats */
+	u8 hist_shift;
+	u32 nb_refresh;
+	u64 stall_start;
+	u64 stall_ns;
+	u64 wakeups_required;
+	u64 wakeups_issued;
+	u64 occupancy[XDP_DIAG_RING_HIST_BUCKETS];
 };
 
+/* One in that many refreshes of the other end's pointer samples occupancy */
+#define XSKQ_SAMPLE_PERIOD 64
+
+/* Most descriptors a multi-buffer packet can span */
+#define XSK_DESC_MAX_FRAGS (MAX_SKB_FRAGS + 1)
+
 /* The structure of the shared state of the rings are a simple
  * circular buffer, as outlined in
  * Documentation/core-api/circular-buffers.rst. For the Rx and
@@ -144,7 +162,7 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 	if (chunk >= pool->addrs_cnt)
 		return false;
 
-	if (desc->options)
+	if (desc->options & ~XDP_PKT_CONTD)
 		return false;
 	return true;
 }
@@ -164,7 +182,7 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
 
-	if (desc->options)
+	if (desc->options & ~XDP_PKT_CONTD)
 		return false;
 	return true;
 }
@@ -180,7 +198,8 @@ static inline bool xskq_cons_is_valid_desc(struct xsk_queue *q,
 					   struct xdp_desc *d,
 					   struct xsk_buff_pool *pool)
 {
-	if (!xp_validate_desc(pool, d)) {
+	if (!xp_validate_desc(pool, d) ||
+	    (!q->sg && (d->options & XDP_PKT_CONTD))) {
 		q->invalid_descs++;
 		return false;
 	}
@@ -236,6 +255,29 @@ static inline u32 xskq_cons_read_desc_batch(struct xsk_queue *q, struct xsk_buff
 	return nb_entries;
 }
 
+/* Called whenever the pointer of the other end has been refreshed */
+static inline void xskq_account(struct xsk_queue *q, bool stalled)
+{
+	u32 bucket;
+
+	if (unlikely(!(++q->nb_refresh & (XSKQ_SAMPLE_PERIOD - 1)))) {
+		bucket = ((u64)(q->cached_prod - q->cached_cons) *
+			  XDP_DIAG_RING_HIST_BUCKETS) >> q->hist_shift;
+		q->occupancy[min_t(u32, bucket,
+				   XDP_DIAG_RING_HIST_BUCKETS - 1)]++;
+	}
+
+	if (likely(stalled == !!q->stall_start))
+		return;
+
+	if (stalled) {
+		q->stall_start = local_clock() ?: 1;
+	} else {
+		q->stall_ns += local_clock() - q->stall_start;
+		q->stall_start = 0;
+	}
+}
+
 /* Functions for consumers */
 
 static inline void __xskq_cons_release(struct xsk_queue *q)
@@ -247,6 +289,7 @@ static inline void __xskq_cons_peek(struct xsk_queue *q)
 {
 	/* Refresh the local pointer */
 	q->cached_prod = smp_load_acquire(&q->ring->producer);  /* C, matches B */
+	xskq_account(q, q->cached_prod == q->cached_cons);
 }
 
 static inline void xskq_cons_get_entries(struct xsk_queue *q)
@@ -289,6 +332,51 @@ static inline bool xskq_cons_peek_desc(struct xsk_queue *q,
 	return xskq_cons_read_desc(q, desc, pool);
 }
 
+/* Reads the descriptors of the next packet of a multi-buffer queue without
+ * consuming them. Returns their number, or 0 if the last descriptor of the
+ * packet is not in the ring yet. The descriptors of a packet that is invalid
+ * or longer than @max are all consumed and -EINVAL returned.
+ */
+static inline int xskq_cons_peek_pkt(struct xsk_queue *q,
+				     struct xdp_desc *descs, u32 max,
+				     struct xsk_buff_pool *pool)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 cached_cons = q->cached_cons, nb_entries = 0, i;
+	struct xdp_desc desc;
+	bool valid = true;
+
+	do {
+		if (cached_cons == q->cached_prod) {
+			xskq_cons_get_entries(q);
+			if (cached_cons == q->cached_prod)
+				return 0;
+		}
+
+		desc = ring->desc[cached_cons++ & q->ring_mask];
+		if (nb_entries < max)
+			descs[nb_entries] = desc;
+		nb_entries++;
+	} while ((desc.options & XDP_PKT_CONTD) && nb_entries <= max);
+
+	if (nb_entries > max) {
+		q->invalid_descs++;
+		valid = false;
+	}
+
+	for (i = 0; i < min(nb_entries, max); i++) {
+		if (!xskq_cons_is_valid_desc(q, &descs[i], pool))
+			valid = false;
+	}
+
+	if (!valid) {
+		xskq_cons_release_n(q, nb_entries);
+		return -EINVAL;
+	}
+
+	return nb_entries;
+}
+
 /* To improve performance in the xskq_cons_release functions, only update local state here.
  * Reflect this to global state when we get new entries from the ring in
  * xskq_cons_get_entries() and whenever Rx or Tx processing are completed in the NAPI loop.
@@ -316,6 +404,7 @@ static inline u32 xskq_prod_nb_free(struct xsk_queue *q, u32 max)
 	/* Refresh the local tail pointer */
 	q->cached_cons = READ_ONCE(q->ring->consumer);
 	free_entries = q->nentries - (q->cached_prod - q->cached_cons);
+	xskq_account(q, !free_entries);
 
 	return free_entries >= max ? max : free_entries;
 }
@@ -330,6 +419,11 @@ static inline void xskq_prod_cancel(struct xsk_queue *q)
 	q->cached_prod--;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
 static inline int xskq_prod_reserve(struct xsk_queue *q)
 {
 	if (xskq_prod_is_full(q))
@@ -366,7 +460,7 @@ static inline void xskq_prod_write_addr_batch(struct xsk_queue *q, struct xdp_de
 }
 
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 flags)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -378,6 +472,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = flags;
 
 	return 0;
 }
@@ -420,6 +515,17 @@ static inline u64 xskq_nb_invalid_descs(struct xsk_queue *q)
 	return q ? q->invalid_descs : 0;
 }
 
+static inline u64 xskq_stall_ns(struct xsk_queue *q)
+{
+	u64 start = READ_ONCE(q->stall_start);
+	u64 stall_ns = READ_ONCE(q->stall_ns);
+
+	/* Account for a stall that is still going on */
+	if (start)
+		stall_ns += local_clock() - start;
+	return stall_ns;
+}
+
 static inline u64 xskq_nb_queue_empty_descs(struct xsk_queue *q)
 {
 	return q ? q->queue_empty_descs : 0;
@@ -10,9 +10,24 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/btf_ids.h>
+#include <linux/etherdevice.h>
 
 #include "xsk.h"
 
+/* Most sockets a BPF_F_XSK_FANOUT group spans */
+#define XSK_MAP_FANOUT_MAX	64
+
+/* Group of the last BPF_F_XSK_FANOUT redirect of the CPU, picked by
+ * xsk_map_redirect() and consumed by the redirect of the packet.
+ */
+struct xsk_map_fanout {
+	struct xsk_map *map;
+	struct xdp_sock *leader;
+	u32 base;
+};
+
+static DEFINE_PER_CPU(struct xsk_map_fanout, xsk_map_fanout);
+
 static struct xsk_map_node *xsk_map_node_alloc(struct xsk_map *map,
 					       struct xdp_sock __rcu **map_entry)
 {
@@ -233,8 +248,79 @@ static int xsk_map_delete_elem(struct bpf_map *map, void *key)
 
 static int xsk_map_redirect(struct bpf_map *map, u32 ifindex, u64 flags)
 {
-	return __bpf_xdp_redirect_map(map, ifindex, flags, 0,
-				      __xsk_map_lookup_elem);
+	struct xsk_map_fanout *fanout = this_cpu_ptr(&xsk_map_fanout);
+	int ret;
+
+	ret = __bpf_xdp_redirect_map(map, ifindex, flags, BPF_F_XSK_FANOUT,
+				     __xsk_map_lookup_elem);
+	if (ret == XDP_REDIRECT && (flags & BPF_F_XSK_FANOUT)) {
+		fanout->map = container_of(map, struct xsk_map, map);
+		fanout->leader = this_cpu_ptr(&bpf_redirect_info)->tgt_value;
+		fanout->base = ifindex;
+	} else {
+		fanout->map = NULL;
+	}
+
+	return ret;
+}
+
+static u32 xsk_map_flow_hash(struct xdp_buff *xdp)
+{
+	int hlen = xdp->data_end - xdp->data;
+	const struct ethhdr *eth = xdp->data;
+	struct flow_keys keys;
+
+	if (hlen < ETH_HLEN)
+		return 0;
+
+	memset(&keys, 0, sizeof(keys));
+	if (!__skb_flow_dissect(dev_net(xdp->rxq->dev), NULL,
+				&flow_keys_dissector, &keys, xdp->data,
+				eth->h_proto, ETH_HLEN, hlen, 0))
+		return 0;
+
+	return flow_hash_from_keys(&keys);
+}
+
+/**
+ * xsk_map_fanout_select - Pick the socket of a fanout group for a packet
+ * @xs: socket the XDP program redirected to
+ * @xdp: packet
+ *
+ * Return: a socket of the group starting at @xs if the packet was
+ *	   redirected with BPF_F_XSK_FANOUT, @xs otherwise.
+ *
+ * Context: Softirq context, from the redirect following the XDP program.
+ */
+struct xdp_sock *xsk_map_fanout_select(struct xdp_sock *xs,
+				       struct xdp_buff *xdp)
+{
+	struct xsk_map_fanout *fanout = this_cpu_ptr(&xsk_map_fanout);
+	struct xsk_map *m = fanout->map;
+	struct xdp_sock *member;
+	u32 n, max;
+
+	if (likely(!m))
+		return xs;
+
+	fanout->map = NULL;
+	if (fanout->leader != xs)
+		return xs;
+
+	max = min_t(u32, XSK_MAP_FANOUT_MAX, m->map.max_entries - fanout->base);
+	for (n = 1; n < max; n++) {
+		if (!rcu_access_pointer(m->xsk_map[fanout->base + n]))
+			break;
+	}
+	if (n == 1)
+		return xs;
+
+	n = reciprocal_scale(xsk_map_flow_hash(xdp), n);
+	member = rcu_dereference_check(m->xsk_map[fanout->base + n],
+				       rcu_read_lock_bh_held());
+
+	/* The entry may have been deleted since the group was counted */
+	return member ?: xs;
 }
 
 void xsk_map_try_sock_delete(struct xsk_map *map, struct xdp_sock *xs,
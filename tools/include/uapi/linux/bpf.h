@@ -2652,12 +2652,18 @@ union bpf_attr {
  * 		the map lookup fails. This is so that the return value can be
  * 		one of the XDP program return codes up to **XDP_TX**, as chosen
  * 		by the caller. The higher bits of *flags* can be set to
- * 		BPF_F_BROADCAST or BPF_F_EXCLUDE_INGRESS as defined below.
+ * 		BPF_F_BROADCAST, BPF_F_EXCLUDE_INGRESS or BPF_F_XSK_FANOUT
+ * 		as defined below.
  *
  * 		With BPF_F_BROADCAST the packet will be broadcasted to all the
  * 		interfaces in the map, with BPF_F_EXCLUDE_INGRESS the ingress
  * 		interface will be excluded when do broadcasting.
  *
+ * 		With BPF_F_XSK_FANOUT, for an XSKMAP, *key* is the first entry
+ * 		of a group of consecutive entries holding sockets that share
+ * 		a umem and a queue. The group ends at the first empty entry
+ * 		and the packet is sent to one of its sockets by flow hash.
+ *
  * 		See also **bpf_redirect**\ (), which only supports redirecting
  * 		to an ifindex, but doesn't require a map to do so.
  * 	Return
@@ -5833,6 +5839,7 @@ enum {
 enum {
 	BPF_F_BROADCAST		= (1ULL << 3),
 	BPF_F_EXCLUDE_INGRESS	= (1ULL << 4),
+	BPF_F_XSK_FANOUT	= (1ULL << 5),
 };
 
 #define __bpf_md_ptr(type, name)	\
@@ -51,6 +51,13 @@ int bench_inject_build_id(int argc, const char **argv);
 int bench_evlist_open_close(int argc, const char **argv);
 int bench_breakpoint_thread(int argc, const char **argv);
 int bench_breakpoint_enable(int argc, const char **argv);
+int bench_io_uring_nop(int argc, const char **argv);
+int bench_io_uring_read(int argc, const char **argv);
+int bench_io_uring_recv(int argc, const char **argv);
+int bench_xdp_rxdrop(int argc, const char **argv);
+int bench_xdp_txonly(int argc, const char **argv);
+int bench_xdp_l2fwd(int argc, const char **argv);
+int bench_dma_memcpy(int argc, const char **argv);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
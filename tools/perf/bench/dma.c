@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * dma.c
+ *
+ * dma: Benchmark for the memcpy throughput of the dmaengine channels
+ *
+ * The copies are run by the dmatest module, configured through its
+ * module parameters: each run starts the test with "run", then reads
+ * "wait", which returns once all the threads have completed their
+ * iterations. Verification is disabled so that the runtime only covers
+ * the submission and the completion of the transfers. Without --channel,
+ * dmatest picks the first channel capable of memcpy.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+
+#include <subcmd/parse-options.h>
+#include "bench.h"
+#include "io-stats.h"
+
+#include <err.h>
+
+#define DMATEST_PARAMS	"/sys/module/dmatest/parameters/"
+
+static const char *channel = "";
+static unsigned int buf_size = 16384;
+static unsigned int iterations = 1000;
+static unsigned int nthreads = 1;
+static bool polled;
+
+static const struct option options[] = {
+	OPT_STRING(  'c', "channel", &channel, "chan", "Specify channel to test, e.g. dma0chan0 (default: any)"),
+	OPT_UINTEGER('s', "size", &buf_size, "Specify size of the copies"),
+	OPT_UINTEGER('l', "loops", &iterations, "Specify number of copies per thread and run"),
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify number of threads per channel"),
+	OPT_BOOLEAN( 'p', "polled", &polled, "Poll for the completions instead of waiting for the interrupts"),
+	OPT_END()
+};
+
+static const char * const bench_dma_usage[] = {
+	"perf bench dma <options>",
+	NULL
+};
+
+static void dmatest_write(const char *param, const char *fmt, ...)
+{
+	char path[128], buf[64];
+	va_list ap;
+	int fd, len;
+
+	va_start(ap, fmt);
+	len = vscnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	scnprintf(path, sizeof(path), DMATEST_PARAMS "%s", param);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		err(EXIT_FAILURE, "open %s", path);
+	if (write(fd, buf, len) != len)
+		err(EXIT_FAILURE, "write %s to %s", buf, path);
+	close(fd);
+}
+
+/* Reading "wait" blocks until the test threads are done */
+static void dmatest_wait(void)
+{
+	char buf[8];
+	int fd;
+
+	fd = open(DMATEST_PARAMS "wait", O_RDONLY);
+	if (fd < 0)
+		err(EXIT_FAILURE, "open " DMATEST_PARAMS "wait");
+	if (read(fd, buf, sizeof(buf)) < 0)
+		err(EXIT_FAILURE, "read " DMATEST_PARAMS "wait");
+	close(fd);
+}
+
+static void dmatest_setup(void)
+{
+	/* Plain full size memcpy, without verification */
+	dmatest_write("dmatest", "0");
+	dmatest_write("noverify", "Y");
+	dmatest_write("norandom", "Y");
+	dmatest_write("transfer_size", "0");
+	dmatest_write("test_buf_size", "%u", buf_size);
+	dmatest_write("iterations", "%u", iterations);
+	dmatest_write("threads_per_chan", "%u", nthreads);
+	dmatest_write("polled", "%c", polled ? 'Y' : 'N');
+	dmatest_write("max_channels", "1");
+}
+
+int bench_dma_memcpy(int argc, const char **argv)
+{
+	struct bench_io_stats stats;
+	char config[64];
+	unsigned int i;
+	u64 start, elapsed, ops;
+
+	argc = parse_options(argc, argv, options, bench_dma_usage, 0);
+	if (argc)
+		usage_with_options(bench_dma_usage, options);
+
+	if (!buf_size || !iterations || !nthreads) {
+		fprintf(stderr, "Invalid size, loops or threads\n");
+		return -1;
+	}
+
+	if (access(DMATEST_PARAMS, F_OK)) {
+		fprintf(stderr, "The dmatest module is not loaded\n");
+		return -1;
+	}
+	if (access(DMATEST_PARAMS "run", W_OK)) {
+		fprintf(stderr, "Configuring dmatest requires root\n");
+		return -1;
+	}
+
+	dmatest_setup();
+
+	scnprintf(config, sizeof(config), "%s,size=%u,threads=%u%s",
+		  *channel ? channel : "any", buf_size, nthreads,
+		  polled ? ",polled" : "");
+	bench_io_stats__init(&stats, "dma/memcpy", config);
+
+	for (i = 0; i < bench_repeat; i++) {
+		/* Setting the channel creates the threads of the run */
+		if (*channel)
+			dmatest_write("channel", "%s", channel);
+
+		start = bench_io_now_ns();
+		dmatest_write("run", "1");
+		dmatest_wait();
+		elapsed = bench_io_now_ns() - start;
+
+		ops = (u64)iterations * nthreads;
+		bench_io_stats__add_sample(&stats, ops, ops * buf_size,
+					   elapsed);
+		/* Each thread runs its copies one after the other */
+		bench_io_stats__add_lat(&stats, elapsed / iterations);
+	}
+
+	bench_io_stats__print(&stats);
+
+	return 0;
+}
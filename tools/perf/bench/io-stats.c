@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * io-stats.c
+ *
+ * Common reporting of the I/O path benchmarks. Each benchmark adds one
+ * sample per run (or per second of runtime) and, when it can time the
+ * operations individually, their latencies. The default format is meant
+ * for humans, the simple one prints a single line of space separated
+ * fields:
+ *
+ *   <name> <config> <ops/s> <stddev%> <MB/s> <lat avg> <lat min> <lat max>
+ *
+ * with the latencies in nsecs, or 0 when they are not measured.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/compiler.h>
+
+#include "bench.h"
+#include "io-stats.h"
+
+void bench_io_stats__init(struct bench_io_stats *s, const char *name,
+			  const char *config)
+{
+	memset(s, 0, sizeof(*s));
+	s->name = name;
+	s->config = config && *config ? config : "default";
+	init_stats(&s->ops);
+	init_stats(&s->bytes);
+	init_stats(&s->lat);
+}
+
+void bench_io_stats__add_sample(struct bench_io_stats *s, u64 ops, u64 bytes,
+				u64 elapsed_ns)
+{
+	double secs = (double)elapsed_ns / 1e9;
+
+	if (!elapsed_ns)
+		return;
+
+	update_stats(&s->ops, (double)ops / secs);
+	update_stats(&s->bytes, (double)bytes / secs);
+}
+
+void bench_io_stats__add_lat(struct bench_io_stats *s, u64 lat_ns)
+{
+	update_stats(&s->lat, lat_ns);
+}
+
+void bench_io_stats__print(struct bench_io_stats *s)
+{
+	double ops = avg_stats(&s->ops);
+	double ops_stddev = rel_stddev_stats(stddev_stats(&s->ops), ops);
+	double mbs = avg_stats(&s->bytes) / (1024 * 1024);
+	bool has_lat = s->lat.n > 0;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %s (%s), %.0f samples\n", s->name, s->config,
+		       s->ops.n);
+		printf(" %14s: %'.0f ops/sec (+- %.2f%%)\n", "Throughput", ops,
+		       ops_stddev);
+		if (mbs)
+			printf(" %14s: %'.2f MB/sec\n", "Bandwidth", mbs);
+		if (has_lat)
+			printf(" %14s: %'.0f nsecs avg, %'" PRIu64 " min, %'" PRIu64 " max (+- %.2f%%)\n",
+			       "Latency", avg_stats(&s->lat), s->lat.min,
+			       s->lat.max,
+			       rel_stddev_stats(stddev_stats(&s->lat),
+						avg_stats(&s->lat)));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%s %s %.0f %.2f %.2f %.0f %" PRIu64 " %" PRIu64 "\n",
+		       s->name, s->config, ops, ops_stddev, mbs,
+		       has_lat ? avg_stats(&s->lat) : 0,
+		       has_lat ? s->lat.min : 0, has_lat ? s->lat.max : 0);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+	}
+}
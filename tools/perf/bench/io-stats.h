@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Common reporting of the I/O path benchmarks (io_uring, AF_XDP and
+ * dmaengine), so that their results can be compared across kernels and
+ * boards.
+ */
+
+#ifndef _BENCH_IO_STATS_H
+#define _BENCH_IO_STATS_H
+
+#include <time.h>
+#include <linux/types.h>
+#include "../util/stat.h"
+
+struct bench_io_stats {
+	const char	*name;		/* e.g. "io_uring/nop" */
+	const char	*config;	/* setup flags, copy mode, channel... */
+	struct stats	ops;		/* operations per second */
+	struct stats	bytes;		/* bytes per second */
+	struct stats	lat;		/* latency of the operations (nsecs) */
+};
+
+static inline u64 bench_io_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void bench_io_stats__init(struct bench_io_stats *s, const char *name,
+			  const char *config);
+void bench_io_stats__add_sample(struct bench_io_stats *s, u64 ops, u64 bytes,
+				u64 elapsed_ns);
+void bench_io_stats__add_lat(struct bench_io_stats *s, u64 lat_ns);
+void bench_io_stats__print(struct bench_io_stats *s);
+
+#endif /* _BENCH_IO_STATS_H */
@@ -0,0 +1,538 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * io-uring.c
+ *
+ * io_uring: Benchmark for the latency and throughput of io_uring requests
+ *
+ * The ring is driven through the raw system calls, so that the benchmark
+ * only depends on the uapi header. Each run completes --loops requests,
+ * keeping --depth of them in flight, and times each request from its
+ * submission to the reaping of its completion.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/compiler.h>
+#include <linux/io_uring.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+
+#include <subcmd/parse-options.h>
+#include "bench.h"
+#include "io-stats.h"
+
+#include <err.h>
+
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup	425
+#endif
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter	426
+#endif
+
+#define IO_URING_FILE_SIZE	(16 << 20)
+
+static unsigned int loops = 100000;
+static unsigned int depth = 1;
+static unsigned int block_size = 4096;
+static const char *filename;
+static bool sqpoll, iopoll, coop_taskrun, single_issuer, defer_taskrun;
+static bool direct, inet;
+
+static const struct option options[] = {
+	OPT_UINTEGER('l', "loops", &loops, "Specify number of requests per run"),
+	OPT_UINTEGER('d', "depth", &depth, "Specify number of requests in flight"),
+	OPT_BOOLEAN( 'S', "sqpoll", &sqpoll, "Use IORING_SETUP_SQPOLL"),
+	OPT_BOOLEAN( 'P', "iopoll", &iopoll, "Use IORING_SETUP_IOPOLL (read only, implies --direct)"),
+	OPT_BOOLEAN( 'C', "coop-taskrun", &coop_taskrun, "Use IORING_SETUP_COOP_TASKRUN"),
+	OPT_BOOLEAN( 'I', "single-issuer", &single_issuer, "Use IORING_SETUP_SINGLE_ISSUER"),
+	OPT_BOOLEAN( 'D', "defer-taskrun", &defer_taskrun, "Use IORING_SETUP_DEFER_TASKRUN (implies --single-issuer)"),
+	OPT_UINTEGER('b', "block-size", &block_size, "Specify size of the reads and receives"),
+	OPT_STRING(  'F', "file", &filename, "file", "Specify file to read (default: temporary file)"),
+	OPT_BOOLEAN( 'O', "direct", &direct, "Open the file to read with O_DIRECT"),
+	OPT_BOOLEAN( 'T', "tcp", &inet, "Receive from a TCP loopback connection instead of a UNIX socket"),
+	OPT_END()
+};
+
+static const char * const bench_io_uring_usage[] = {
+	"perf bench io_uring <options>",
+	NULL
+};
+
+struct io_ring {
+	int			fd;
+	unsigned int		flags;
+	unsigned int		sq_mask;
+	unsigned int		*sq_head;
+	unsigned int		*sq_tail;
+	unsigned int		*sq_flags;
+	unsigned int		*sq_array;
+	struct io_uring_sqe	*sqes;
+	unsigned int		cq_mask;
+	unsigned int		*cq_head;
+	unsigned int		*cq_tail;
+	struct io_uring_cqe	*cqes;
+	void			*sq_ptr, *cq_ptr;
+	size_t			sq_len, cq_len, sqes_len;
+	unsigned int		to_submit;
+};
+
+/* Per slot state of the requests in flight */
+struct io_slot {
+	u64	submit_ns;
+	void	*buf;
+};
+
+typedef void (*io_prep_fn_t)(struct io_uring_sqe *sqe, struct io_slot *slot);
+
+static int io_fd = -1;
+static u64 io_off, io_size;
+
+static int ring_setup(struct io_ring *ring, unsigned int entries)
+{
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	p.flags = ring->flags;
+	if (sqpoll)
+		p.sq_thread_idle = 1000;
+
+	ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return -errno;
+
+	ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	ring->cq_len = p.cq_off.cqes +
+		       p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		ring->sq_len = ring->cq_len = max(ring->sq_len, ring->cq_len);
+
+	ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring->fd,
+			    IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED)
+		return -errno;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ptr = ring->sq_ptr;
+	} else {
+		ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+				    MAP_SHARED | MAP_POPULATE, ring->fd,
+				    IORING_OFF_CQ_RING);
+		if (ring->cq_ptr == MAP_FAILED)
+			return -errno;
+	}
+
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+		return -errno;
+
+	ring->sq_head = ring->sq_ptr + p.sq_off.head;
+	ring->sq_tail = ring->sq_ptr + p.sq_off.tail;
+	ring->sq_flags = ring->sq_ptr + p.sq_off.flags;
+	ring->sq_array = ring->sq_ptr + p.sq_off.array;
+	ring->sq_mask = *(unsigned int *)(ring->sq_ptr + p.sq_off.ring_mask);
+	ring->cq_head = ring->cq_ptr + p.cq_off.head;
+	ring->cq_tail = ring->cq_ptr + p.cq_off.tail;
+	ring->cq_mask = *(unsigned int *)(ring->cq_ptr + p.cq_off.ring_mask);
+	ring->cqes = ring->cq_ptr + p.cq_off.cqes;
+
+	return 0;
+}
+
+static void ring_exit(struct io_ring *ring)
+{
+	munmap(ring->sqes, ring->sqes_len);
+	if (ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_len);
+	munmap(ring->sq_ptr, ring->sq_len);
+	close(ring->fd);
+}
+
+static struct io_uring_sqe *ring_get_sqe(struct io_ring *ring)
+{
+	unsigned int idx = *ring->sq_tail & ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_array[idx] = idx;
+
+	return sqe;
+}
+
+/* Hand the entry returned by ring_get_sqe() over to the kernel */
+static void ring_commit_sqe(struct io_ring *ring)
+{
+	/* Pairs with the kernel's acquire load of the tail */
+	__atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+	ring->to_submit++;
+}
+
+static int ring_enter(struct io_ring *ring, unsigned int min_complete)
+{
+	unsigned int flags = IORING_ENTER_GETEVENTS;
+	unsigned int to_submit = ring->to_submit;
+	int ret;
+
+	if (ring->flags & IORING_SETUP_SQPOLL) {
+		/* Order the tail store before the test of the wakeup flag */
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) &
+		    IORING_SQ_NEED_WAKEUP)
+			flags |= IORING_ENTER_SQ_WAKEUP;
+		to_submit = 0;
+	}
+
+	ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+		      flags, NULL, 0);
+	if (ret < 0)
+		return -errno;
+
+	ring->to_submit = 0;
+	return ret;
+}
+
+static void io_prep_nop(struct io_uring_sqe *sqe,
+			struct io_slot *slot __maybe_unused)
+{
+	sqe->opcode = IORING_OP_NOP;
+}
+
+static void io_prep_read(struct io_uring_sqe *sqe, struct io_slot *slot)
+{
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = io_fd;
+	sqe->addr = (unsigned long)slot->buf;
+	sqe->len = block_size;
+	sqe->off = io_off;
+
+	io_off += block_size;
+	if (io_off + block_size > io_size)
+		io_off = 0;
+}
+
+static void io_prep_recv(struct io_uring_sqe *sqe, struct io_slot *slot)
+{
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = io_fd;
+	sqe->addr = (unsigned long)slot->buf;
+	sqe->len = block_size;
+}
+
+static void io_submit(struct io_ring *ring, struct io_slot *slots,
+		      unsigned int idx, io_prep_fn_t prep)
+{
+	struct io_uring_sqe *sqe = ring_get_sqe(ring);
+
+	prep(sqe, &slots[idx]);
+	sqe->user_data = idx;
+	slots[idx].submit_ns = bench_io_now_ns();
+	ring_commit_sqe(ring);
+}
+
+/* Complete one run of --loops requests */
+static int io_run(struct io_ring *ring, struct io_slot *slots,
+		  io_prep_fn_t prep, struct bench_io_stats *stats)
+{
+	unsigned int submitted = 0, completed = 0, i;
+	u64 start, bytes = 0;
+	int ret;
+
+	start = bench_io_now_ns();
+
+	for (i = 0; i < depth && submitted < loops; i++, submitted++)
+		io_submit(ring, slots, i, prep);
+
+	while (completed < loops) {
+		unsigned int head, tail;
+
+		ret = ring_enter(ring, 1);
+		if (ret < 0 && ret != -EINTR && ret != -EAGAIN)
+			return ret;
+
+		head = *ring->cq_head;
+		/* Pairs with the kernel's release store of the tail */
+		tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe;
+			unsigned int idx;
+			u64 now = bench_io_now_ns();
+
+			cqe = &ring->cqes[head & ring->cq_mask];
+			idx = cqe->user_data;
+
+			if (cqe->res < 0) {
+				__atomic_store_n(ring->cq_head, head + 1,
+						 __ATOMIC_RELEASE);
+				return cqe->res;
+			}
+
+			bytes += cqe->res;
+			bench_io_stats__add_lat(stats,
+						now - slots[idx].submit_ns);
+			completed++;
+
+			if (submitted < loops) {
+				io_submit(ring, slots, idx, prep);
+				submitted++;
+			}
+		}
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	bench_io_stats__add_sample(stats, completed, bytes,
+				   bench_io_now_ns() - start);
+	return 0;
+}
+
+static unsigned int io_setup_flags(char *buf, size_t size)
+{
+	static const struct {
+		bool		*opt;
+		unsigned int	flag;
+		const char	*name;
+	} setup_flags[] = {
+		{ &sqpoll,		IORING_SETUP_SQPOLL,		"sqpoll"	},
+		{ &iopoll,		IORING_SETUP_IOPOLL,		"iopoll"	},
+		{ &coop_taskrun,	IORING_SETUP_COOP_TASKRUN,	"coop-taskrun"	},
+		{ &single_issuer,	IORING_SETUP_SINGLE_ISSUER,	"single-issuer"	},
+		{ &defer_taskrun,	IORING_SETUP_DEFER_TASKRUN,	"defer-taskrun"	},
+	};
+	unsigned int flags = 0, i;
+	int len;
+
+	if (defer_taskrun)
+		single_issuer = true;
+
+	len = scnprintf(buf, size, "depth=%u", depth);
+	for (i = 0; i < ARRAY_SIZE(setup_flags); i++) {
+		if (!*setup_flags[i].opt)
+			continue;
+		flags |= setup_flags[i].flag;
+		len += scnprintf(buf + len, size - len, ",%s",
+				 setup_flags[i].name);
+	}
+
+	return flags;
+}
+
+static void io_parse_options(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, options, bench_io_uring_usage, 0);
+	if (argc)
+		usage_with_options(bench_io_uring_usage, options);
+
+	if (!depth || !loops || !block_size) {
+		fprintf(stderr, "Invalid depth, loops or block size\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static int bench_io_uring(const char *name, io_prep_fn_t prep, bool buffers)
+{
+	struct bench_io_stats stats;
+	struct io_ring ring;
+	struct io_slot *slots;
+	char config[128];
+	unsigned int i;
+	int ret;
+
+	memset(&ring, 0, sizeof(ring));
+	ring.flags = io_setup_flags(config, sizeof(config));
+
+	slots = calloc(depth, sizeof(*slots));
+	if (!slots)
+		err(EXIT_FAILURE, "calloc");
+	for (i = 0; buffers && i < depth; i++) {
+		/* Aligned for O_DIRECT */
+		if (posix_memalign(&slots[i].buf, 4096, block_size))
+			err(EXIT_FAILURE, "posix_memalign");
+	}
+
+	ret = ring_setup(&ring, roundup_pow_of_two(depth));
+	if (ret) {
+		errno = -ret;
+		err(EXIT_FAILURE, "io_uring_setup");
+	}
+
+	bench_io_stats__init(&stats, name, config);
+	for (i = 0; i < bench_repeat; i++) {
+		ret = io_run(&ring, slots, prep, &stats);
+		if (ret) {
+			errno = -ret;
+			err(EXIT_FAILURE, "%s", name);
+		}
+	}
+	bench_io_stats__print(&stats);
+
+	ring_exit(&ring);
+	for (i = 0; buffers && i < depth; i++)
+		free(slots[i].buf);
+	free(slots);
+
+	return 0;
+}
+
+int bench_io_uring_nop(int argc, const char **argv)
+{
+	io_parse_options(argc, argv);
+
+	return bench_io_uring("io_uring/nop", io_prep_nop, false);
+}
+
+static int io_open_tmpfile(void)
+{
+	char path[] = "/tmp/perf-bench-io_uring-XXXXXX";
+	char *buf;
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		err(EXIT_FAILURE, "mkstemp");
+	unlink(path);
+
+	buf = malloc(1 << 20);
+	if (!buf)
+		err(EXIT_FAILURE, "malloc");
+	memset(buf, 0xa5, 1 << 20);
+	for (io_size = 0; io_size < IO_URING_FILE_SIZE; io_size += 1 << 20) {
+		if (write(fd, buf, 1 << 20) != 1 << 20)
+			err(EXIT_FAILURE, "write");
+	}
+	free(buf);
+	fsync(fd);
+
+	return fd;
+}
+
+int bench_io_uring_read(int argc, const char **argv)
+{
+	struct stat st;
+	int ret;
+
+	io_parse_options(argc, argv);
+	if (iopoll)
+		direct = true;
+
+	if (filename) {
+		io_fd = open(filename, O_RDONLY | (direct ? O_DIRECT : 0));
+		if (io_fd < 0)
+			err(EXIT_FAILURE, "open %s", filename);
+		if (fstat(io_fd, &st))
+			err(EXIT_FAILURE, "fstat");
+		io_size = st.st_size;
+	} else {
+		io_fd = io_open_tmpfile();
+		if (direct && fcntl(io_fd, F_SETFL, O_DIRECT))
+			err(EXIT_FAILURE, "O_DIRECT");
+	}
+
+	if (io_size < block_size) {
+		fprintf(stderr, "File smaller than the block size\n");
+		close(io_fd);
+		return -1;
+	}
+
+	io_off = 0;
+	ret = bench_io_uring("io_uring/read", io_prep_read, true);
+	close(io_fd);
+
+	return ret;
+}
+
+static bool recv_done;
+
+/* Keep the receiving end of the connection busy */
+static void *io_sender(void *arg)
+{
+	int fd = (long)arg;
+	char *buf;
+
+	buf = calloc(1, block_size);
+	if (!buf)
+		err(EXIT_FAILURE, "calloc");
+
+	while (!__atomic_load_n(&recv_done, __ATOMIC_RELAXED)) {
+		if (write(fd, buf, block_size) < 0)
+			break;
+	}
+	free(buf);
+
+	return NULL;
+}
+
+static void io_tcp_pair(int fds[2])
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int lfd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (lfd < 0)
+		err(EXIT_FAILURE, "socket");
+	if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(lfd, 1) ||
+	    getsockname(lfd, (struct sockaddr *)&addr, &len))
+		err(EXIT_FAILURE, "listen");
+
+	fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+	if (fds[1] < 0 ||
+	    connect(fds[1], (struct sockaddr *)&addr, sizeof(addr)))
+		err(EXIT_FAILURE, "connect");
+	fds[0] = accept(lfd, NULL, NULL);
+	if (fds[0] < 0)
+		err(EXIT_FAILURE, "accept");
+	close(lfd);
+}
+
+int bench_io_uring_recv(int argc, const char **argv)
+{
+	pthread_t sender;
+	int fds[2];
+	int ret;
+
+	io_parse_options(argc, argv);
+	if (iopoll) {
+		fprintf(stderr, "IORING_SETUP_IOPOLL does not support sockets\n");
+		return -1;
+	}
+
+	if (inet)
+		io_tcp_pair(fds);
+	else if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+		err(EXIT_FAILURE, "socketpair");
+	io_fd = fds[0];
+
+	recv_done = false;
+	if (pthread_create(&sender, NULL, io_sender, (void *)(long)fds[1]))
+		err(EXIT_FAILURE, "pthread_create");
+
+	ret = bench_io_uring(inet ? "io_uring/recv-tcp" : "io_uring/recv",
+			     io_prep_recv, true);
+
+	__atomic_store_n(&recv_done, true, __ATOMIC_RELAXED);
+	/* Unblock the sender */
+	shutdown(fds[0], SHUT_RDWR);
+	pthread_join(sender, NULL);
+	close(fds[0]);
+	close(fds[1]);
+
+	return ret;
+}
@@ -0,0 +1,547 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * xdp.c
+ *
+ * xdp: Benchmark for the packet rate of AF_XDP sockets
+ *
+ *  rxdrop: receive and drop the packets of a queue
+ *  txonly: transmit as many packets as the queue takes
+ *  l2fwd:  send the received packets back, with their MACs swapped
+ *
+ * The socket and its rings are set up through the raw uapi. The receive
+ * benchmarks attach a minimal XDP program redirecting the packets of the
+ * queue to the socket, so the interface must be fed with traffic from a
+ * generator. Every second of --runtime is one sample of the report.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/bpf.h>
+#include <linux/compiler.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/kernel.h>
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include <subcmd/parse-options.h>
+#include "bench.h"
+#include "io-stats.h"
+
+#include <err.h>
+
+#ifndef AF_XDP
+# define AF_XDP		44
+#endif
+#ifndef SOL_XDP
+# define SOL_XDP	283
+#endif
+
+#define XSK_RING_SIZE	2048
+#define XSK_NUM_FRAMES	(2 * XSK_RING_SIZE)
+
+static const char *ifname;
+static unsigned int queue;
+static unsigned int frame_size = 4096;
+static unsigned int batch = 64;
+static unsigned int pkt_size = 64;
+static unsigned int nsecs = 5;
+static bool copy, zero_copy, skb_mode, use_poll;
+
+static const struct option options[] = {
+	OPT_STRING(  'i', "interface", &ifname, "ifname", "Specify network interface"),
+	OPT_UINTEGER('q', "queue", &queue, "Specify queue of the interface"),
+	OPT_BOOLEAN( 'c', "copy", &copy, "Force copy mode"),
+	OPT_BOOLEAN( 'z', "zero-copy", &zero_copy, "Force zero-copy mode"),
+	OPT_BOOLEAN( 'S', "skb-mode", &skb_mode, "Attach the XDP program in generic (skb) mode"),
+	OPT_UINTEGER('f', "frame-size", &frame_size, "Specify size of the UMEM frames (2048 or 4096)"),
+	OPT_UINTEGER('b', "batch", &batch, "Specify number of packets processed per batch"),
+	OPT_UINTEGER('s', "packet-size", &pkt_size, "Specify size of the transmitted packets"),
+	OPT_UINTEGER('r', "runtime", &nsecs, "Specify runtime (in seconds)"),
+	OPT_BOOLEAN( 'p', "poll", &use_poll, "Wait for packets with poll(2) instead of busy looping"),
+	OPT_END()
+};
+
+static const char * const bench_xdp_usage[] = {
+	"perf bench xdp <options>",
+	NULL
+};
+
+enum xdp_bench {
+	XDP_BENCH_RXDROP,
+	XDP_BENCH_TXONLY,
+	XDP_BENCH_L2FWD,
+};
+
+struct xsk_ring {
+	u32	*producer;
+	u32	*consumer;
+	u32	*flags;
+	void	*descs;
+	u32	mask;
+	void	*map;
+	size_t	map_len;
+};
+
+struct xsk {
+	int		fd;
+	int		ifindex;
+	void		*umem;
+	size_t		umem_len;
+	struct xsk_ring	rx, tx, fill, comp;
+	u64		*free_frames;
+	unsigned int	nr_free;
+	unsigned int	tx_pending;
+	u64		pkts, bytes;
+};
+
+static u32 xsk_prod_free(struct xsk_ring *ring)
+{
+	/* Pairs with the kernel's release store of the consumer */
+	return ring->mask + 1 -
+	       (*ring->producer - __atomic_load_n(ring->consumer,
+						  __ATOMIC_ACQUIRE));
+}
+
+static u32 xsk_cons_avail(struct xsk_ring *ring)
+{
+	/* Pairs with the kernel's release store of the producer */
+	return __atomic_load_n(ring->producer, __ATOMIC_ACQUIRE) -
+	       *ring->consumer;
+}
+
+static bool xsk_need_wakeup(struct xsk_ring *ring)
+{
+	return __atomic_load_n(ring->flags, __ATOMIC_RELAXED) &
+	       XDP_RING_NEED_WAKEUP;
+}
+
+static void xsk_ring_map(struct xsk *xsk, struct xsk_ring *ring,
+			 const struct xdp_ring_offset *off, size_t desc_size,
+			 off_t pgoff)
+{
+	void *map;
+
+	ring->map_len = off->desc + XSK_RING_SIZE * desc_size;
+	map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, xsk->fd, pgoff);
+	if (map == MAP_FAILED)
+		err(EXIT_FAILURE, "mmap ring");
+
+	ring->map = map;
+	ring->producer = map + off->producer;
+	ring->consumer = map + off->consumer;
+	ring->flags = map + off->flags;
+	ring->descs = map + off->desc;
+	ring->mask = XSK_RING_SIZE - 1;
+}
+
+static void xsk_ring_unmap(struct xsk_ring *ring)
+{
+	if (ring->map)
+		munmap(ring->map, ring->map_len);
+}
+
+static void xsk_free_frame(struct xsk *xsk, u64 addr)
+{
+	/* Back to the start of the frame in aligned mode */
+	xsk->free_frames[xsk->nr_free++] = addr & ~((u64)frame_size - 1);
+}
+
+static void xsk_setup(struct xsk *xsk, enum xdp_bench bench)
+{
+	struct xdp_umem_reg mr;
+	struct xdp_mmap_offsets off;
+	struct sockaddr_xdp sxdp;
+	socklen_t optlen = sizeof(off);
+	int ring_size = XSK_RING_SIZE;
+	unsigned int i;
+
+	xsk->ifindex = if_nametoindex(ifname);
+	if (!xsk->ifindex)
+		err(EXIT_FAILURE, "%s", ifname);
+
+	xsk->umem_len = (size_t)XSK_NUM_FRAMES * frame_size;
+	xsk->umem = mmap(NULL, xsk->umem_len, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (xsk->umem == MAP_FAILED)
+		err(EXIT_FAILURE, "mmap umem");
+
+	xsk->fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (xsk->fd < 0)
+		err(EXIT_FAILURE, "socket(AF_XDP)");
+
+	memset(&mr, 0, sizeof(mr));
+	mr.addr = (unsigned long)xsk->umem;
+	mr.len = xsk->umem_len;
+	mr.chunk_size = frame_size;
+	if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)))
+		err(EXIT_FAILURE, "XDP_UMEM_REG");
+
+	if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size,
+		       sizeof(ring_size)) ||
+	    setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size,
+		       sizeof(ring_size)))
+		err(EXIT_FAILURE, "XDP_UMEM rings");
+	if (bench != XDP_BENCH_TXONLY &&
+	    setsockopt(xsk->fd, SOL_XDP, XDP_RX_RING, &ring_size,
+		       sizeof(ring_size)))
+		err(EXIT_FAILURE, "XDP_RX_RING");
+	if (bench != XDP_BENCH_RXDROP &&
+	    setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING, &ring_size,
+		       sizeof(ring_size)))
+		err(EXIT_FAILURE, "XDP_TX_RING");
+
+	if (getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen))
+		err(EXIT_FAILURE, "XDP_MMAP_OFFSETS");
+
+	xsk_ring_map(xsk, &xsk->fill, &off.fr, sizeof(u64),
+		     XDP_UMEM_PGOFF_FILL_RING);
+	xsk_ring_map(xsk, &xsk->comp, &off.cr, sizeof(u64),
+		     XDP_UMEM_PGOFF_COMPLETION_RING);
+	if (bench != XDP_BENCH_TXONLY)
+		xsk_ring_map(xsk, &xsk->rx, &off.rx, sizeof(struct xdp_desc),
+			     XDP_PGOFF_RX_RING);
+	if (bench != XDP_BENCH_RXDROP)
+		xsk_ring_map(xsk, &xsk->tx, &off.tx, sizeof(struct xdp_desc),
+			     XDP_PGOFF_TX_RING);
+
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = xsk->ifindex;
+	sxdp.sxdp_queue_id = queue;
+	sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+	if (copy)
+		sxdp.sxdp_flags |= XDP_COPY;
+	if (zero_copy)
+		sxdp.sxdp_flags |= XDP_ZEROCOPY;
+	if (bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)))
+		err(EXIT_FAILURE, "bind %s queue %u", ifname, queue);
+
+	xsk->free_frames = calloc(XSK_NUM_FRAMES, sizeof(u64));
+	if (!xsk->free_frames)
+		err(EXIT_FAILURE, "calloc");
+	for (i = 0; i < XSK_NUM_FRAMES; i++)
+		xsk_free_frame(xsk, (u64)i * frame_size);
+}
+
+static void xsk_teardown(struct xsk *xsk)
+{
+	xsk_ring_unmap(&xsk->tx);
+	xsk_ring_unmap(&xsk->rx);
+	xsk_ring_unmap(&xsk->comp);
+	xsk_ring_unmap(&xsk->fill);
+	close(xsk->fd);
+	munmap(xsk->umem, xsk->umem_len);
+	free(xsk->free_frames);
+}
+
+/* Redirect the packets of the queue to the socket, or pass them on */
+static int xdp_load_prog(int map_fd)
+{
+	struct bpf_insn insns[] = {
+		BPF_LDX_MEM(BPF_W, BPF_REG_2, BPF_REG_1,
+			    offsetof(struct xdp_md, rx_queue_index)),
+		BPF_LD_MAP_FD(BPF_REG_1, map_fd),
+		BPF_MOV64_IMM(BPF_REG_3, XDP_PASS),
+		BPF_EMIT_CALL(BPF_FUNC_redirect_map),
+		BPF_EXIT_INSN(),
+	};
+
+	return bpf_prog_load(BPF_PROG_TYPE_XDP, "xsk_redirect", "GPL", insns,
+			     ARRAY_SIZE(insns), NULL);
+}
+
+static int xdp_attach_prog(struct xsk *xsk, u32 xdp_flags)
+{
+	int map_fd, prog_fd, ret;
+
+	map_fd = bpf_map_create(BPF_MAP_TYPE_XSKMAP, "xsks_map", sizeof(int),
+				sizeof(int), queue + 1, NULL);
+	if (map_fd < 0)
+		return map_fd;
+
+	ret = bpf_map_update_elem(map_fd, &queue, &xsk->fd, 0);
+	if (ret)
+		goto out;
+
+	prog_fd = xdp_load_prog(map_fd);
+	if (prog_fd < 0) {
+		ret = prog_fd;
+		goto out;
+	}
+
+	ret = bpf_xdp_attach(xsk->ifindex, prog_fd, xdp_flags, NULL);
+	close(prog_fd);
+out:
+	/* The program holds the map */
+	close(map_fd);
+	return ret;
+}
+
+static void xsk_fill(struct xsk *xsk)
+{
+	struct xsk_ring *ring = &xsk->fill;
+	u32 n = min(xsk_prod_free(ring), xsk->nr_free);
+	u64 *addrs = ring->descs;
+	u32 prod = *ring->producer;
+	u32 i;
+
+	if (!n)
+		return;
+
+	for (i = 0; i < n; i++)
+		addrs[prod++ & ring->mask] = xsk->free_frames[--xsk->nr_free];
+	__atomic_store_n(ring->producer, prod, __ATOMIC_RELEASE);
+}
+
+static void xsk_complete(struct xsk *xsk, bool count)
+{
+	struct xsk_ring *ring = &xsk->comp;
+	u32 n = xsk_cons_avail(ring);
+	u64 *addrs = ring->descs;
+	u32 cons = *ring->consumer;
+	u32 i;
+
+	for (i = 0; i < n; i++)
+		xsk_free_frame(xsk, addrs[cons++ & ring->mask]);
+	__atomic_store_n(ring->consumer, cons, __ATOMIC_RELEASE);
+
+	xsk->tx_pending -= n;
+	if (count) {
+		xsk->pkts += n;
+		xsk->bytes += (u64)n * pkt_size;
+	}
+}
+
+static void xsk_kick_tx(struct xsk *xsk)
+{
+	if (!xsk->tx_pending || !xsk_need_wakeup(&xsk->tx))
+		return;
+
+	if (sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0 &&
+	    errno != EAGAIN && errno != EBUSY && errno != ENOBUFS &&
+	    errno != ENETDOWN)
+		err(EXIT_FAILURE, "sendto");
+}
+
+static void xsk_wait_rx(struct xsk *xsk)
+{
+	struct pollfd pfd = { .fd = xsk->fd, .events = POLLIN };
+
+	if (use_poll)
+		poll(&pfd, 1, 100);
+	else if (xsk_need_wakeup(&xsk->fill))
+		recvfrom(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+}
+
+static void xsk_swap_macs(void *data)
+{
+	struct ethhdr *eth = data;
+	u8 tmp[ETH_ALEN];
+
+	memcpy(tmp, eth->h_source, ETH_ALEN);
+	memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
+	memcpy(eth->h_dest, tmp, ETH_ALEN);
+}
+
+static void xsk_rx(struct xsk *xsk, bool fwd)
+{
+	struct xsk_ring *rx = &xsk->rx, *tx = &xsk->tx;
+	struct xdp_desc *rx_descs = rx->descs, *tx_descs = tx->descs;
+	u32 n = min(xsk_cons_avail(rx), batch);
+	u32 cons = *rx->consumer, prod = 0, room = 0;
+	u32 i;
+
+	if (!n) {
+		xsk_wait_rx(xsk);
+		return;
+	}
+
+	if (fwd) {
+		prod = *tx->producer;
+		room = xsk_prod_free(tx);
+	}
+
+	for (i = 0; i < n; i++) {
+		struct xdp_desc *desc = &rx_descs[cons++ & rx->mask];
+
+		xsk->pkts++;
+		xsk->bytes += desc->len;
+
+		if (!room) {
+			xsk_free_frame(xsk, desc->addr);
+			continue;
+		}
+
+		xsk_swap_macs(xsk->umem + desc->addr);
+		tx_descs[prod++ & tx->mask] = *desc;
+		xsk->tx_pending++;
+		room--;
+	}
+	__atomic_store_n(rx->consumer, cons, __ATOMIC_RELEASE);
+
+	if (fwd)
+		__atomic_store_n(tx->producer, prod, __ATOMIC_RELEASE);
+}
+
+static void xsk_tx(struct xsk *xsk)
+{
+	struct xsk_ring *tx = &xsk->tx;
+	struct xdp_desc *descs = tx->descs;
+	u32 n = min(xsk_prod_free(tx), xsk->nr_free);
+	u32 prod = *tx->producer;
+	u32 i;
+
+	n = min(n, batch);
+
+	for (i = 0; i < n; i++) {
+		struct xdp_desc *desc = &descs[prod++ & tx->mask];
+
+		desc->addr = xsk->free_frames[--xsk->nr_free];
+		desc->len = pkt_size;
+		desc->options = 0;
+	}
+	__atomic_store_n(tx->producer, prod, __ATOMIC_RELEASE);
+	xsk->tx_pending += n;
+}
+
+/* Locally administered MACs and the local experimental EtherType */
+static void xsk_init_packets(struct xsk *xsk)
+{
+	static const u8 dst[ETH_ALEN] = { 0x02, 0, 0, 0, 0, 0x02 };
+	static const u8 src[ETH_ALEN] = { 0x02, 0, 0, 0, 0, 0x01 };
+	unsigned int i;
+
+	for (i = 0; i < XSK_NUM_FRAMES; i++) {
+		struct ethhdr *eth = xsk->umem + (size_t)i * frame_size;
+
+		memcpy(eth->h_dest, dst, ETH_ALEN);
+		memcpy(eth->h_source, src, ETH_ALEN);
+		eth->h_proto = htons(ETH_P_802_EX1);
+	}
+}
+
+static void xsk_config(struct xsk *xsk, char *buf, size_t size)
+{
+	struct xdp_options opts = { 0 };
+	socklen_t optlen = sizeof(opts);
+
+	getsockopt(xsk->fd, SOL_XDP, XDP_OPTIONS, &opts, &optlen);
+	scnprintf(buf, size, "%s:%u,%s,%s", ifname, queue,
+		  opts.flags & XDP_OPTIONS_ZEROCOPY ? "zero-copy" : "copy",
+		  skb_mode ? "skb" : "drv");
+}
+
+static int bench_xdp(int argc, const char **argv, const char *name,
+		     enum xdp_bench bench)
+{
+	u32 xdp_flags = skb_mode ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE;
+	struct bench_io_stats stats;
+	u64 start, now, end, last_pkts = 0, last_bytes = 0;
+	struct xsk xsk;
+	char config[64];
+	int ret;
+
+	argc = parse_options(argc, argv, options, bench_xdp_usage, 0);
+	if (argc)
+		usage_with_options(bench_xdp_usage, options);
+
+	if (!ifname) {
+		fprintf(stderr, "Missing --interface\n");
+		return -1;
+	}
+	if (copy && zero_copy) {
+		fprintf(stderr, "--copy and --zero-copy are exclusive\n");
+		return -1;
+	}
+	if ((frame_size != 2048 && frame_size != 4096) || !batch ||
+	    pkt_size < ETH_HLEN || pkt_size > frame_size) {
+		fprintf(stderr, "Invalid frame size, batch or packet size\n");
+		return -1;
+	}
+
+	memset(&xsk, 0, sizeof(xsk));
+	xsk_setup(&xsk, bench);
+
+	if (bench != XDP_BENCH_TXONLY) {
+		ret = xdp_attach_prog(&xsk,
+				      xdp_flags | XDP_FLAGS_UPDATE_IF_NOEXIST);
+		if (ret) {
+			errno = -ret;
+			err(EXIT_FAILURE, "attach XDP program to %s", ifname);
+		}
+		xsk_fill(&xsk);
+	} else {
+		xsk_init_packets(&xsk);
+	}
+
+	xsk_config(&xsk, config, sizeof(config));
+	bench_io_stats__init(&stats, name, config);
+
+	start = bench_io_now_ns();
+	end = start + (u64)nsecs * 1000000000ULL;
+
+	do {
+		switch (bench) {
+		case XDP_BENCH_RXDROP:
+			xsk_rx(&xsk, false);
+			xsk_fill(&xsk);
+			break;
+		case XDP_BENCH_TXONLY:
+			xsk_complete(&xsk, true);
+			xsk_tx(&xsk);
+			xsk_kick_tx(&xsk);
+			break;
+		case XDP_BENCH_L2FWD:
+			xsk_complete(&xsk, false);
+			xsk_rx(&xsk, true);
+			xsk_kick_tx(&xsk);
+			xsk_fill(&xsk);
+			break;
+		}
+
+		now = bench_io_now_ns();
+		if (now - start >= 1000000000ULL || now >= end) {
+			bench_io_stats__add_sample(&stats,
+						   xsk.pkts - last_pkts,
+						   xsk.bytes - last_bytes,
+						   now - start);
+			last_pkts = xsk.pkts;
+			last_bytes = xsk.bytes;
+			start = now;
+		}
+	} while (now < end);
+
+	bench_io_stats__print(&stats);
+
+	if (bench != XDP_BENCH_TXONLY)
+		bpf_xdp_detach(xsk.ifindex, xdp_flags, NULL);
+	xsk_teardown(&xsk);
+
+	return 0;
+}
+
+int bench_xdp_rxdrop(int argc, const char **argv)
+{
+	return bench_xdp(argc, argv, "xdp/rxdrop", XDP_BENCH_RXDROP);
+}
+
+int bench_xdp_txonly(int argc, const char **argv)
+{
+	return bench_xdp(argc, argv, "xdp/txonly", XDP_BENCH_TXONLY);
+}
+
+int bench_xdp_l2fwd(int argc, const char **argv)
+{
+	return bench_xdp(argc, argv, "xdp/l2fwd", XDP_BENCH_L2FWD);
+}
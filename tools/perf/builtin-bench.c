@@ -16,6 +16,9 @@
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
  *  epoll ... Event poll performance
+ *  io_uring ... io_uring request performance
+ *  xdp   ... AF_XDP packet rate
+ *  dma   ... dmaengine copy performance
  */
 #include <subcmd/parse-options.h>
 #include "builtin.h"
@@ -99,6 +102,28 @@ static struct bench breakpoint_benchmarks[] = {
 	{ NULL,	NULL, NULL },
 };
 
+static struct bench io_uring_benchmarks[] = {
+	{ "nop",	"Benchmark for IORING_OP_NOP requests",		bench_io_uring_nop	},
+	{ "read",	"Benchmark for IORING_OP_READ requests",	bench_io_uring_read	},
+	{ "recv",	"Benchmark for IORING_OP_RECV requests",	bench_io_uring_recv	},
+	{ "all",	"Run all io_uring benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
+#ifdef HAVE_LIBBPF_SUPPORT
+static struct bench xdp_benchmarks[] = {
+	{ "rxdrop",	"Benchmark for AF_XDP receive and drop",	bench_xdp_rxdrop	},
+	{ "txonly",	"Benchmark for AF_XDP transmit",		bench_xdp_txonly	},
+	{ "l2fwd",	"Benchmark for AF_XDP receive and forward",	bench_xdp_l2fwd		},
+	{ NULL,		NULL,						NULL			}
+};
+#endif
+
+static struct bench dma_benchmarks[] = {
+	{ "memcpy",	"Benchmark for dmaengine memcpy through dmatest", bench_dma_memcpy	},
+	{ NULL,		NULL,						NULL			}
+};
+
 struct collection {
 	const char	*name;
 	const char	*summary;
@@ -118,6 +143,11 @@ static struct collection collections[] = {
 #endif
 	{ "internals",	"Perf-internals benchmarks",			internals_benchmarks	},
 	{ "breakpoint",	"Breakpoint benchmarks",			breakpoint_benchmarks	},
+	{ "io_uring",	"io_uring benchmarks",				io_uring_benchmarks	},
+#ifdef HAVE_LIBBPF_SUPPORT
+	{ "xdp",	"AF_XDP benchmarks",				xdp_benchmarks		},
+#endif
+	{ "dma",	"dmaengine benchmarks",				dma_benchmarks		},
 	{ "all",	"All benchmarks",				NULL			},
 	{ NULL,		NULL,						NULL			}
 };
@@ -14,6 +14,7 @@
 #include "util/thread.h"
 #include "util/string2.h"
 #include "util/callchain.h"
+#include "util/tracepoint.h"
 #include "util/evsel_fprintf.h"
 
 #include <subcmd/pager.h>
@@ -42,6 +43,22 @@
 #define PRINT_LATENCY_HEADER_WIDTH (PRINT_LATENCY_WIDTH + PRINT_TIME_UNIT_MESC_WIDTH)
 #define PRINT_TIMEHIST_CPU_WIDTH (PRINT_CPU_WIDTH + PRINT_BRACKETPAIR_WIDTH)
 #define PRINT_TIMESTAMP_HEADER_WIDTH (PRINT_TIMESTAMP_WIDTH + PRINT_TIME_UNIT_SEC_WIDTH)
+#define PRINT_HIST_VALUE_WIDTH 10
+#define PRINT_HIST_BAR_WIDTH 40
+
+/*
+ * Log2 histogram of the runtimes or of the delays of a kwork, in usecs:
+ * bucket n > 0 counts the values in [2^(n-1), 2^n), the last bucket also
+ * counts all the longer ones.
+ */
+#define KWORK_HIST_BUCKETS 26
+
+struct kwork_work_hist {
+	struct kwork_work work;
+	u64               buckets[KWORK_HIST_BUCKETS];
+};
+
+static bool show_hist;
 
 struct sort_dimension {
 	const char      *name;
@@ -308,13 +325,15 @@ static void work_insert(struct rb_root_cached *root,
 static struct kwork_work *work_new(struct kwork_work *key)
 {
 	int i;
-	struct kwork_work *work = zalloc(sizeof(*work));
+	struct kwork_work *work;
+	struct kwork_work_hist *hist = zalloc(sizeof(*hist));
 
-	if (work == NULL) {
+	if (hist == NULL) {
 		pr_err("Failed to zalloc kwork work\n");
 		return NULL;
 	}
 
+	work = &hist->work;
 	for (i = 0; i < KWORK_TRACE_MAX; i++)
 		INIT_LIST_HEAD(&work->atom_list[i]);
 
@@ -341,6 +360,15 @@ static struct kwork_work *work_findnew(struct rb_root_cached *root,
 	return work;
 }
 
+static void work_hist_add(struct kwork_work *work, u64 delta)
+{
+	struct kwork_work_hist *hist = container_of(work, struct kwork_work_hist,
+						    work);
+	unsigned int bucket = fls64(delta / NSEC_PER_USEC);
+
+	hist->buckets[min_t(unsigned int, bucket, KWORK_HIST_BUCKETS - 1)]++;
+}
+
 static void profile_update_timespan(struct perf_kwork *kwork,
 				    struct perf_sample *sample)
 {
@@ -480,6 +508,7 @@ static void report_update_exit_event(struct kwork_work *work,
 			work->max_runtime_start = entry_time;
 			work->max_runtime_end = exit_time;
 		}
+		work_hist_add(work, delta);
 		work->total_runtime += delta;
 		work->nr_atoms++;
 	}
@@ -535,6 +564,7 @@ static void latency_update_entry_event(struct kwork_work *work,
 			work->max_latency_start = raise_time;
 			work->max_latency_end = entry_time;
 		}
+		work_hist_add(work, delta);
 		work->total_latency += delta;
 		work->nr_atoms++;
 	}
@@ -824,6 +854,27 @@ static struct kwork_class kwork_irq = {
 	.work_name      = irq_work_name,
 };
 
+/*
+ * The polls of the NAPI instances run from the NET_RX softirq, and only
+ * report their end. napi_poll_start[cpu] is the end of the previous poll
+ * of the NET_RX softirq running on the cpu, or its entry for the first
+ * poll. It is 0 outside of the softirq: the busy polls and the threaded
+ * NAPI polls can't be timed.
+ */
+#define NET_RX_SOFTIRQ 3
+
+static u64 napi_poll_start[MAX_NR_CPUS];
+
+static void napi_update_softirq(struct evsel *evsel,
+				struct perf_sample *sample, bool entry)
+{
+	if ((sample->cpu >= MAX_NR_CPUS) ||
+	    (evsel__intval(evsel, sample, "vec") != NET_RX_SOFTIRQ))
+		return;
+
+	napi_poll_start[sample->cpu] = entry ? sample->time : 0;
+}
+
 static struct kwork_class kwork_softirq;
 static int process_softirq_raise_event(struct perf_tool *tool,
 				       struct evsel *evsel,
@@ -846,6 +897,8 @@ static int process_softirq_entry_event(struct perf_tool *tool,
 {
 	struct perf_kwork *kwork = container_of(tool, struct perf_kwork, tool);
 
+	napi_update_softirq(evsel, sample, true);
+
 	if (kwork->tp_handler->entry_event)
 		return kwork->tp_handler->entry_event(kwork, &kwork_softirq,
 						      evsel, sample, machine);
@@ -860,6 +913,8 @@ static int process_softirq_exit_event(struct perf_tool *tool,
 {
 	struct perf_kwork *kwork = container_of(tool, struct perf_kwork, tool);
 
+	napi_update_softirq(evsel, sample, false);
+
 	if (kwork->tp_handler->exit_event)
 		return kwork->tp_handler->exit_event(kwork, &kwork_softirq,
 						     evsel, sample, machine);
@@ -945,6 +1000,192 @@ static struct kwork_class kwork_softirq = {
 	.work_name      = softirq_work_name,
 };
 
+/*
+ * The NAPI and tasklet classes break the time of the NET_RX and TASKLET
+ * softirqs down by NAPI instance and by tasklet function. They come with
+ * the softirq class, and their tracepoints are only recorded when the
+ * kernel has them. As they have no raise event, they have no latency.
+ */
+static struct kwork_class kwork_napi;
+static int process_napi_poll_event(struct perf_tool *tool,
+				   struct evsel *evsel,
+				   struct perf_sample *sample,
+				   struct machine *machine)
+{
+	struct perf_kwork *kwork = container_of(tool, struct perf_kwork, tool);
+	struct kwork_atom atom = { .time = 0, };
+	struct kwork_work *work, key;
+	struct addr_location al;
+
+	if (sample->cpu >= MAX_NR_CPUS)
+		return 0;
+
+	/* the next poll of the softirq starts where this one ends */
+	atom.time = napi_poll_start[sample->cpu];
+	if (atom.time == 0)
+		return 0;
+	napi_poll_start[sample->cpu] = sample->time;
+
+	if (kwork->report == KWORK_REPORT_LATENCY)
+		return 0;
+
+	kwork_napi.work_init(&kwork_napi, &key, evsel, sample, machine);
+	work = work_findnew(&kwork_napi.work_root, &key, &kwork->cmp_id);
+	if (work == NULL)
+		return -1;
+
+	if (!profile_event_match(kwork, work, sample))
+		return 0;
+
+	if (kwork->report == KWORK_REPORT_RUNTIME) {
+		report_update_exit_event(work, &atom, sample);
+		return 0;
+	}
+
+	if (machine__resolve(machine, &al, sample) < 0) {
+		pr_debug("Problem processing event, skipping it\n");
+		return -1;
+	}
+
+	timehist_save_callchain(kwork, sample, evsel, machine);
+	work->nr_atoms++;
+	timehist_print_event(kwork, work, &atom, sample, &al);
+	return 0;
+}
+
+const struct evsel_str_handler napi_tp_handlers[] = {
+	{ "napi:napi_poll", process_napi_poll_event, },
+};
+
+static int napi_class_init(struct kwork_class *class,
+			   struct perf_session *session)
+{
+	if (perf_session__set_tracepoints_handlers(session, napi_tp_handlers)) {
+		pr_err("Failed to set napi tracepoints handlers\n");
+		return -1;
+	}
+
+	class->work_root = RB_ROOT_CACHED;
+	return 0;
+}
+
+static void napi_work_init(struct kwork_class *class,
+			   struct kwork_work *work,
+			   struct evsel *evsel,
+			   struct perf_sample *sample,
+			   struct machine *machine __maybe_unused)
+{
+	work->class = class;
+	work->cpu = sample->cpu;
+	work->id = evsel__intval(evsel, sample, "napi");
+	work->name = evsel__strval(evsel, sample, "dev_name");
+}
+
+static void napi_work_name(struct kwork_work *work, char *buf, int len)
+{
+	snprintf(buf, len, "(n)%s:%" PRIx64, work->name, work->id);
+}
+
+static struct kwork_class kwork_napi = {
+	.name           = "napi",
+	.type           = KWORK_CLASS_SOFTIRQ,
+	.nr_tracepoints = 1,
+	.tp_handlers    = napi_tp_handlers,
+	.class_init     = napi_class_init,
+	.work_init      = napi_work_init,
+	.work_name      = napi_work_name,
+};
+
+static struct kwork_class kwork_tasklet;
+static int process_tasklet_entry_event(struct perf_tool *tool,
+				       struct evsel *evsel,
+				       struct perf_sample *sample,
+				       struct machine *machine)
+{
+	struct perf_kwork *kwork = container_of(tool, struct perf_kwork, tool);
+
+	if ((kwork->report != KWORK_REPORT_LATENCY) &&
+	    kwork->tp_handler->entry_event)
+		return kwork->tp_handler->entry_event(kwork, &kwork_tasklet,
+						      evsel, sample, machine);
+
+	return 0;
+}
+
+static int process_tasklet_exit_event(struct perf_tool *tool,
+				      struct evsel *evsel,
+				      struct perf_sample *sample,
+				      struct machine *machine)
+{
+	struct perf_kwork *kwork = container_of(tool, struct perf_kwork, tool);
+
+	if ((kwork->report != KWORK_REPORT_LATENCY) &&
+	    kwork->tp_handler->exit_event)
+		return kwork->tp_handler->exit_event(kwork, &kwork_tasklet,
+						     evsel, sample, machine);
+
+	return 0;
+}
+
+const struct evsel_str_handler tasklet_tp_handlers[] = {
+	{ "irq:tasklet_entry", process_tasklet_entry_event, },
+	{ "irq:tasklet_exit",  process_tasklet_exit_event,  },
+};
+
+static int tasklet_class_init(struct kwork_class *class,
+			      struct perf_session *session)
+{
+	if (perf_session__set_tracepoints_handlers(session,
+						   tasklet_tp_handlers)) {
+		pr_err("Failed to set tasklet tracepoints handlers\n");
+		return -1;
+	}
+
+	class->work_root = RB_ROOT_CACHED;
+	return 0;
+}
+
+static void tasklet_work_init(struct kwork_class *class,
+			      struct kwork_work *work,
+			      struct evsel *evsel,
+			      struct perf_sample *sample,
+			      struct machine *machine)
+{
+	char *modp = NULL;
+	unsigned long long function_addr = evsel__intval(evsel,
+							 sample, "func");
+
+	/* the tasklets running the same function are accounted together */
+	work->class = class;
+	work->cpu = sample->cpu;
+	work->id = function_addr;
+	work->name = function_addr == 0 ? NULL :
+		machine__resolve_kernel_addr(machine, &function_addr, &modp);
+}
+
+static void tasklet_work_name(struct kwork_work *work, char *buf, int len)
+{
+	if (work->name != NULL)
+		snprintf(buf, len, "(t)%s", work->name);
+	else
+		snprintf(buf, len, "(t)0x%" PRIx64, work->id);
+}
+
+static struct kwork_class kwork_tasklet = {
+	.name           = "tasklet",
+	.type           = KWORK_CLASS_SOFTIRQ,
+	.nr_tracepoints = 2,
+	.tp_handlers    = tasklet_tp_handlers,
+	.class_init     = tasklet_class_init,
+	.work_init      = tasklet_work_init,
+	.work_name      = tasklet_work_name,
+};
+
+static bool is_softirq_item_class(struct kwork_class *class)
+{
+	return (class == &kwork_napi) || (class == &kwork_tasklet);
+}
+
 static struct kwork_class kwork_workqueue;
 static int process_workqueue_activate_work_event(struct perf_tool *tool,
 						 struct evsel *evsel,
@@ -1170,6 +1411,59 @@ static int report_print_header(struct perf_kwork *kwork)
 	return ret;
 }
 
+static void report_print_hist(struct perf_kwork *kwork,
+			      struct kwork_work *work)
+{
+	int i, first = -1, last = -1;
+	u64 low, high, max_count = 0;
+	char kwork_name[PRINT_KWORK_NAME_WIDTH];
+	char bar[PRINT_HIST_BAR_WIDTH + 1];
+	struct kwork_work_hist *hist = container_of(work, struct kwork_work_hist,
+						    work);
+
+	for (i = 0; i < KWORK_HIST_BUCKETS; i++) {
+		if (hist->buckets[i] == 0)
+			continue;
+		if (first < 0)
+			first = i;
+		last = i;
+		max_count = max(max_count, hist->buckets[i]);
+	}
+
+	/* the BPF reports only have the totals */
+	if (first < 0)
+		return;
+
+	if (work->class && work->class->work_name)
+		work->class->work_name(work, kwork_name,
+				       PRINT_KWORK_NAME_WIDTH);
+	else
+		kwork_name[0] = '\0';
+
+	printf("\n  %s, cpu %0*d, %s\n", kwork_name, PRINT_CPU_WIDTH,
+	       work->cpu, kwork->report == KWORK_REPORT_RUNTIME ?
+	       "runtime" : "delay");
+	printf("  %*s : %-*s distribution\n",
+	       2 * PRINT_HIST_VALUE_WIDTH + 4, "usecs",
+	       PRINT_COUNT_WIDTH, "count");
+
+	memset(bar, '*', PRINT_HIST_BAR_WIDTH);
+	bar[PRINT_HIST_BAR_WIDTH] = '\0';
+
+	for (i = first; i <= last; i++) {
+		low = i ? 1ULL << (i - 1) : 0;
+		high = i ? (1ULL << i) - 1 : 0;
+		printf("  %*" PRIu64 " -> %-*" PRIu64 " : %-*" PRIu64 " |%-*.*s|\n",
+		       PRINT_HIST_VALUE_WIDTH, low,
+		       PRINT_HIST_VALUE_WIDTH, high,
+		       PRINT_COUNT_WIDTH, hist->buckets[i],
+		       PRINT_HIST_BAR_WIDTH,
+		       (int)(hist->buckets[i] * PRINT_HIST_BAR_WIDTH /
+			      max_count),
+		       bar);
+	}
+}
+
 static void timehist_print_header(void)
 {
 	/*
@@ -1505,7 +1799,9 @@ static int perf_kwork__report(struct perf_kwork *kwork)
 
 		if (work->nr_atoms != 0) {
 			report_print_work(kwork, work);
-			if (kwork->summary) {
+			/* already accounted to their softirq */
+			if (kwork->summary &&
+			    !is_softirq_item_class(work->class)) {
 				kwork->all_runtime += work->total_runtime;
 				kwork->all_count += work->nr_atoms;
 			}
@@ -1523,6 +1819,18 @@ static int perf_kwork__report(struct perf_kwork *kwork)
 	print_skipped_events(kwork);
 	printf("\n");
 
+	if (!show_hist)
+		return 0;
+
+	next = rb_first_cached(&kwork->sorted_work_root);
+	while (next) {
+		work = rb_entry(next, struct kwork_work, node);
+		if (work->nr_atoms != 0)
+			report_print_hist(kwork, work);
+		next = rb_next(next);
+	}
+	printf("\n");
+
 	return 0;
 }
 
@@ -1612,6 +1920,14 @@ static void setup_event_list(struct perf_kwork *kwork,
 		}
 	}
 
+	list_for_each_entry(class, &kwork->class_list, list) {
+		if (class == &kwork_softirq) {
+			list_add_tail(&kwork_napi.list, &kwork->class_list);
+			list_add_tail(&kwork_tasklet.list, &kwork->class_list);
+			break;
+		}
+	}
+
 	pr_debug("Config event list:");
 	list_for_each_entry(class, &kwork->class_list, list)
 		pr_debug(" %s", class->name);
@@ -1635,8 +1951,17 @@ static int perf_kwork__record(struct perf_kwork *kwork,
 
 	rec_argc = ARRAY_SIZE(record_args) + argc - 1;
 
-	list_for_each_entry(class, &kwork->class_list, list)
-		rec_argc += 2 * class->nr_tracepoints;
+	list_for_each_entry(class, &kwork->class_list, list) {
+		for (j = 0; j < class->nr_tracepoints; j++) {
+			if (is_softirq_item_class(class) &&
+			    !is_valid_tracepoint(class->tp_handlers[j].name)) {
+				pr_debug("tracepoint %s is not available\n",
+					 class->tp_handlers[j].name);
+				continue;
+			}
+			rec_argc += 2;
+		}
+	}
 
 	rec_argv = calloc(rec_argc + 1, sizeof(char *));
 	if (rec_argv == NULL)
@@ -1647,6 +1972,9 @@ static int perf_kwork__record(struct perf_kwork *kwork,
 
 	list_for_each_entry(class, &kwork->class_list, list) {
 		for (j = 0; j < class->nr_tracepoints; j++) {
+			if (is_softirq_item_class(class) &&
+			    !is_valid_tracepoint(class->tp_handlers[j].name))
+				continue;
 			rec_argv[i++] = strdup("-e");
 			rec_argv[i++] = strdup(class->tp_handlers[j].name);
 		}
@@ -1722,6 +2050,8 @@ int cmd_kwork(int argc, const char **argv)
 		   "input file name"),
 	OPT_BOOLEAN('S', "with-summary", &kwork.summary,
 		    "Show summary with statistics"),
+	OPT_BOOLEAN(0, "hist", &show_hist,
+		    "Show the histogram of the runtimes of each kwork"),
 #ifdef HAVE_BPF_SKEL
 	OPT_BOOLEAN('b', "use-bpf", &kwork.use_bpf,
 		    "Use BPF to measure kwork runtime"),
@@ -1739,6 +2069,8 @@ int cmd_kwork(int argc, const char **argv)
 		   "Time span for analysis (start,stop)"),
 	OPT_STRING('i', "input", &input_name, "file",
 		   "input file name"),
+	OPT_BOOLEAN(0, "hist", &show_hist,
+		    "Show the histogram of the delays of each kwork"),
 #ifdef HAVE_BPF_SKEL
 	OPT_BOOLEAN('b', "use-bpf", &kwork.use_bpf,
 		    "Use BPF to measure kwork latency"),
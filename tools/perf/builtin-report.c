@@ -66,6 +66,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <linux/mman.h>
+#include <pthread.h>
+
+struct report_shard;
 
 struct report {
 	struct perf_tool	tool;
@@ -113,6 +116,22 @@ struct report {
 	bool			total_cycles_mode;
 	struct block_report	*block_reports;
 	int			nr_block_reports;
+	struct report_shard	*shards;
+	unsigned int		nr_threads;
+	unsigned int		shard;
+};
+
+/*
+ * With --num-threads, each thread processes the whole data in its own
+ * session, so that every thread sees all the side-band events, but only
+ * adds the samples of its shard to its hists. The hists of the shards
+ * are merged into the ones of the main session when collapsing them.
+ */
+struct report_shard {
+	struct report		rep;
+	struct perf_data	data;
+	pthread_t		thread;
+	int			err;
 };
 
 static int report__config(const char *var, const char *value, void *cb)
@@ -252,6 +271,18 @@ static int process_feature_event(struct perf_session *session,
 	return 0;
 }
 
+/* Each sample belongs to a single shard, picked by CPU or else by thread */
+static bool report__skip_sample(struct report *rep, struct perf_sample *sample)
+{
+	u32 key;
+
+	if (!rep->shards)
+		return false;
+
+	key = sample->cpu != (u32)-1 ? sample->cpu : sample->tid;
+	return key % rep->nr_threads != rep->shard;
+}
+
 static int process_sample_event(struct perf_tool *tool,
 				union perf_event *event,
 				struct perf_sample *sample,
@@ -268,6 +299,9 @@ static int process_sample_event(struct perf_tool *tool,
 	};
 	int ret = 0;
 
+	if (report__skip_sample(rep, sample))
+		return 0;
+
 	if (perf_time__ranges_skip_sample(rep->ptime_range, rep->range_num,
 					  sample->time)) {
 		return 0;
@@ -678,6 +712,96 @@ static int report__browse_hists(struct report *rep)
 	return ret;
 }
 
+static void he_stat__merge(struct he_stat *dest, struct he_stat *src)
+{
+	dest->period		+= src->period;
+	dest->period_sys	+= src->period_sys;
+	dest->period_us		+= src->period_us;
+	dest->period_guest_sys	+= src->period_guest_sys;
+	dest->period_guest_us	+= src->period_guest_us;
+	dest->weight1		+= src->weight1;
+	dest->weight2		+= src->weight2;
+	dest->weight3		+= src->weight3;
+	dest->nr_events		+= src->nr_events;
+}
+
+/*
+ * Pair the collapsed entries of both hists, adding empty copies of the
+ * entries only found in @src, and fold the pairs into @hists.
+ */
+static int hists__merge_shard(struct hists *hists, struct hists *src)
+{
+	struct rb_root_cached *root;
+	struct rb_node *nd;
+	int ret = 0;
+
+	hists__match(hists, src);
+	hists__link(hists, src);
+
+	if (hists__has(hists, need_collapse))
+		root = &hists->entries_collapsed;
+	else
+		root = hists->entries_in;
+
+	for (nd = rb_first_cached(root); nd && !ret; nd = rb_next(nd)) {
+		struct hist_entry *he, *pair;
+
+		he = rb_entry(nd, struct hist_entry, rb_node_in);
+		list_for_each_entry(pair, &he->pairs.head, pairs.node) {
+			if (pair->hists != src)
+				continue;
+
+			he_stat__merge(&he->stat, &pair->stat);
+			if (symbol_conf.cumulate_callchain)
+				he_stat__merge(he->stat_acc, pair->stat_acc);
+			if (hist_entry__has_callchains(he) &&
+			    symbol_conf.use_callchain)
+				ret = callchain_merge(&callchain_cursor,
+						      he->callchain,
+						      pair->callchain);
+			he->dummy = false;
+		}
+	}
+
+	hists__unlink(src);
+
+	hists->stats.nr_samples += src->stats.nr_samples;
+	hists->stats.nr_non_filtered_samples +=
+		src->stats.nr_non_filtered_samples;
+	hists->callchain_period += src->callchain_period;
+	hists->callchain_non_filtered_period +=
+		src->callchain_non_filtered_period;
+
+	return ret;
+}
+
+static int report__merge_shards(struct report *rep, struct evsel *evsel)
+{
+	struct hists *hists = evsel__hists(evsel);
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; rep->shards && i < rep->nr_threads - 1 && !ret; i++) {
+		struct perf_session *session = rep->shards[i].rep.session;
+		struct evsel *pos;
+		struct hists *src;
+
+		pos = evlist__find_evsel(session->evlist, evsel->core.idx);
+		if (!pos)
+			return -EINVAL;
+
+		src = evsel__hists(pos);
+		src->symbol_filter_str = hists->symbol_filter_str;
+		src->socket_filter = hists->socket_filter;
+
+		ret = hists__collapse_resort(src, NULL);
+		if (!ret)
+			ret = hists__merge_shard(hists, src);
+	}
+
+	return ret;
+}
+
 static int report__collapse_hists(struct report *rep)
 {
 	struct ui_progress prog;
@@ -698,6 +822,10 @@ static int report__collapse_hists(struct report *rep)
 		if (ret < 0)
 			break;
 
+		ret = report__merge_shards(rep, pos);
+		if (ret < 0)
+			break;
+
 		/* Non-group events are considered as leader */
 		if (symbol_conf.event_group && !evsel__is_group_leader(pos)) {
 			struct hists *leader_hists = evsel__hists(evsel__leader(pos));
@@ -937,6 +1065,139 @@ static int tasks_print(struct report *rep, FILE *fp)
 	return 0;
 }
 
+static bool report__can_shard(struct report *rep)
+{
+	struct perf_session *session = rep->session;
+
+	if (rep->nr_threads < 2)
+		return false;
+
+	/*
+	 * The output of these modes is not built from the hists only, or
+	 * their hists refer to the annotations and to the events of the
+	 * main session.
+	 */
+	if (perf_data__is_pipe(session->data) || rep->stats_mode ||
+	    rep->tasks_mode || rep->show_threads || rep->symbol_ipc ||
+	    rep->total_cycles_mode || rep->mem_mode ||
+	    sort__mode == SORT_MODE__BRANCH || symbol_conf.report_hierarchy ||
+	    ui__has_annotation() || rep->evswitch.on || rep->evswitch.off ||
+	    perf_header__has_feat(&session->header, HEADER_AUXTRACE)) {
+		pr_debug("Processing the samples with a single thread\n");
+		return false;
+	}
+
+	return true;
+}
+
+static void report__delete_shards(struct report *rep)
+{
+	unsigned int i;
+
+	for (i = 0; rep->shards && i < rep->nr_threads - 1; i++) {
+		struct perf_session *session = rep->shards[i].rep.session;
+
+		if (IS_ERR_OR_NULL(session))
+			continue;
+
+		zstd_fini(&session->zstd_data);
+		perf_session__delete(session);
+	}
+	zfree(&rep->shards);
+}
+
+static int report__create_shards(struct report *rep)
+{
+	struct perf_session *session = rep->session;
+	unsigned int i;
+
+	rep->shards = calloc(rep->nr_threads - 1, sizeof(*rep->shards));
+	if (!rep->shards)
+		return -ENOMEM;
+
+	for (i = 0; i < rep->nr_threads - 1; i++) {
+		struct report_shard *shard = &rep->shards[i];
+		struct perf_session *s;
+
+		shard->rep = *rep;
+		shard->rep.shard = i + 1;
+		shard->data.path = session->data->path;
+		shard->data.mode = PERF_DATA_MODE_READ;
+		shard->data.force = session->data->force;
+
+		s = perf_session__new(&shard->data, &shard->rep.tool);
+		if (IS_ERR(s))
+			return PTR_ERR(s);
+		shard->rep.session = s;
+
+		if (zstd_init(&s->zstd_data, 0) < 0)
+			pr_warning("Decompression initialization failed. Reported data may be incomplete.\n");
+
+		if (rep->queue_size) {
+			ordered_events__set_alloc_size(&s->ordered_events,
+						       rep->queue_size);
+		}
+
+		s->itrace_synth_opts = session->itrace_synth_opts;
+		setup_forced_leader(&shard->rep, s->evlist);
+
+		if (s->tevent.pevent &&
+		    tep_set_function_resolver(s->tevent.pevent,
+					      machine__resolve_kernel_addr,
+					      &s->machines.host) < 0)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void *report__shard_thread(void *arg)
+{
+	struct report_shard *shard = arg;
+
+	shard->err = perf_session__process_events(shard->rep.session);
+	return NULL;
+}
+
+static int report__process_events(struct report *rep)
+{
+	unsigned int i, nr_started;
+	int ret;
+
+	if (!report__can_shard(rep))
+		return perf_session__process_events(rep->session);
+
+	ret = report__create_shards(rep);
+	if (ret) {
+		report__delete_shards(rep);
+		return ret;
+	}
+
+	for (nr_started = 0; nr_started < rep->nr_threads - 1; nr_started++) {
+		struct report_shard *shard = &rep->shards[nr_started];
+
+		ret = pthread_create(&shard->thread, NULL, report__shard_thread,
+				     shard);
+		if (ret) {
+			ret = -ret;
+			/* The samples of the remaining shards would be lost */
+			session_done = 1;
+			break;
+		}
+	}
+
+	if (!ret)
+		ret = perf_session__process_events(rep->session);
+
+	for (i = 0; i < nr_started; i++) {
+		pthread_join(rep->shards[i].thread, NULL);
+		if (!ret)
+			ret = rep->shards[i].err;
+	}
+
+	return ret;
+}
+
 static int __cmd_report(struct report *rep)
 {
 	int ret;
@@ -974,7 +1235,7 @@ static int __cmd_report(struct report *rep)
 	if (rep->tasks_mode)
 		tasks_setup(rep);
 
-	ret = perf_session__process_events(session);
+	ret = report__process_events(rep);
 	if (ret) {
 		ui__error("failed to process sample\n");
 		return ret;
@@ -1381,6 +1642,8 @@ int cmd_report(int argc, const char **argv)
 		    "Disable raw trace ordering"),
 	OPT_BOOLEAN(0, "skip-empty", &report.skip_empty,
 		    "Do not display empty (or dummy) events in the output"),
+	OPT_UINTEGER(0, "num-threads", &report.nr_threads,
+		     "Process the samples with n threads, sharded by CPU"),
 	OPT_END()
 	};
 	struct perf_data data = {
@@ -1674,6 +1937,7 @@ int cmd_report(int argc, const char **argv)
 	ret = __cmd_report(&report);
 	if (ret == K_SWITCH_INPUT_DATA || ret == K_RELOAD) {
 		perf_session__delete(session);
+		report__delete_shards(&report);
 		last_key = K_SWITCH_INPUT_DATA;
 		goto repeat;
 	} else
@@ -1693,6 +1957,8 @@ int cmd_report(int argc, const char **argv)
 
 	zstd_fini(&(session->zstd_data));
 	perf_session__delete(session);
+	/* After the main session, whose hists refer to their threads */
+	report__delete_shards(&report);
 exit:
 	free(sort_order_help);
 	free(field_order_help);